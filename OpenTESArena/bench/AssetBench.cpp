@@ -0,0 +1,406 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "../src/Assets/CFAFile.h"
+#include "../src/Assets/CIFFile.h"
+#include "../src/Assets/COLFile.h"
+#include "../src/Assets/DFAFile.h"
+#include "../src/Assets/FLCFile.h"
+#include "../src/Assets/IMGFile.h"
+#include "../src/Assets/INFFile.h"
+#include "../src/Assets/MIFFile.h"
+#include "../src/Assets/RCIFile.h"
+#include "../src/Assets/RMDFile.h"
+#include "../src/Assets/SETFile.h"
+#include "../src/Assets/VOCFile.h"
+#include "../src/Media/Palette.h"
+#include "../src/Media/PaletteFile.h"
+#include "../src/Media/PaletteName.h"
+#include "../src/Utilities/Debug.h"
+#include "../src/Utilities/File.h"
+#include "../src/Utilities/String.h"
+
+#include "components/vfs/manager.hpp"
+
+// Benchmark for the asset loaders. It goes through every file that VFS::Manager lists
+// (GLOBAL.BSA entries and loose files), decodes each one with the loader for its
+// extension, and reports for each format the bytes read, the bytes decoded, the time,
+// and the number and size of heap allocations. Nothing here uses SDL.
+
+// Images are decoded to 32-bit pixels with the default palette, or only to palette
+// indices when "indexed" is given, like the game does with the indexed images option.
+// Bytes out are the decoded pixels, PCM samples, palette colors, or voxel maps. .INF
+// files are parsed into structures rather than a buffer, so they have no bytes out.
+
+// Usage: arena_asset_bench [ARENA path] [JSON output path] [indexed]
+
+namespace
+{
+	// Counted by the global allocation functions below.
+	std::atomic<uint64_t> AllocationCount(0);
+	std::atomic<uint64_t> AllocatedBytes(0);
+}
+
+void *operator new(size_t size)
+{
+	AllocationCount++;
+	AllocatedBytes += size;
+
+	void *ptr = std::malloc((size > 0) ? size : 1);
+	if (ptr == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+
+	return ptr;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+namespace
+{
+	const std::string DefaultArenaPath = "data/ARENA";
+
+	// Times each format's files are decoded after a first unmeasured pass (which also
+	// pages in the archive).
+	const int MeasuredPasses = 5;
+
+	// Decodes the file and returns the number of bytes it decoded to.
+	typedef std::function<uint64_t(const std::string&)> DecodeFunction;
+
+	struct AssetFormat
+	{
+		std::string extension;
+		DecodeFunction decode;
+		std::vector<std::string> filenames;
+	};
+
+	struct FormatResult
+	{
+		std::string extension;
+		int fileCount;
+		uint64_t bytesIn, bytesOut; // Per pass.
+		uint64_t allocationCount, allocatedBytes; // Per pass.
+		double seconds; // Per pass.
+	};
+
+	// Gets the decoded size of palette-indexed images, which is four bytes per pixel
+	// when converted with a palette.
+	uint64_t getImageBytes(uint64_t pixelCount, bool indexed)
+	{
+		return pixelCount * (indexed ? 1 : 4);
+	}
+
+	std::vector<AssetFormat> makeFormats(const Palette &palette, bool indexed)
+	{
+		const Palette *palettePtr = &palette;
+
+		std::vector<AssetFormat> formats;
+		auto addFormat = [&formats](const std::string &extension,
+			const DecodeFunction &decode)
+		{
+			AssetFormat format;
+			format.extension = extension;
+			format.decode = decode;
+			formats.push_back(std::move(format));
+		};
+
+		addFormat(".IMG", [palettePtr, indexed](const std::string &filename)
+		{
+			const IMGFile img = indexed ? IMGFile(filename) : IMGFile(filename, palettePtr);
+			return getImageBytes(img.getWidth() * img.getHeight(), indexed);
+		});
+
+		addFormat(".CIF", [palettePtr, indexed](const std::string &filename)
+		{
+			const CIFFile cif = indexed ? CIFFile(filename) : CIFFile(filename, *palettePtr);
+			uint64_t pixelCount = 0;
+			for (int i = 0; i < cif.getImageCount(); i++)
+			{
+				pixelCount += cif.getWidth(i) * cif.getHeight(i);
+			}
+
+			return getImageBytes(pixelCount, indexed);
+		});
+
+		addFormat(".SET", [palettePtr, indexed](const std::string &filename)
+		{
+			const SETFile set = indexed ? SETFile(filename) : SETFile(filename, *palettePtr);
+			return getImageBytes(set.getImageCount() * SETFile::CHUNK_WIDTH *
+				SETFile::CHUNK_HEIGHT, indexed);
+		});
+
+		addFormat(".CFA", [palettePtr, indexed](const std::string &filename)
+		{
+			const CFAFile cfa = indexed ? CFAFile(filename) : CFAFile(filename, *palettePtr);
+			return getImageBytes(cfa.getImageCount() * cfa.getWidth() * cfa.getHeight(),
+				indexed);
+		});
+
+		addFormat(".DFA", [palettePtr, indexed](const std::string &filename)
+		{
+			const DFAFile dfa = indexed ? DFAFile(filename) : DFAFile(filename, *palettePtr);
+			return getImageBytes(dfa.getImageCount() * dfa.getWidth() * dfa.getHeight(),
+				indexed);
+		});
+
+		// FLCs have their own palettes, so they're always 32-bit.
+		addFormat(".FLC", [](const std::string &filename)
+		{
+			const FLCFile flc(filename);
+			return getImageBytes(flc.getFrameCount() * flc.getWidth() * flc.getHeight(),
+				false);
+		});
+
+		addFormat(".RCI", [palettePtr, indexed](const std::string &filename)
+		{
+			const RCIFile rci = indexed ? RCIFile(filename) : RCIFile(filename, *palettePtr);
+			return getImageBytes(rci.getCount() * RCIFile::FRAME_WIDTH *
+				RCIFile::FRAME_HEIGHT, indexed);
+		});
+
+		addFormat(".COL", [](const std::string &filename)
+		{
+			Palette colPalette;
+			COLFile::toPalette(filename, colPalette);
+			return static_cast<uint64_t>(sizeof(colPalette.get()));
+		});
+
+		addFormat(".VOC", [](const std::string &filename)
+		{
+			const VOCFile voc(filename);
+			return static_cast<uint64_t>(voc.getAudioData().size());
+		});
+
+		addFormat(".INF", [](const std::string &filename)
+		{
+			const INFFile inf(filename);
+			static_cast<void>(inf);
+			return static_cast<uint64_t>(0);
+		});
+
+		addFormat(".MIF", [](const std::string &filename)
+		{
+			const MIFFile mif(filename);
+			uint64_t bytes = 0;
+			for (const auto &level : mif.getLevels())
+			{
+				bytes += level.voxels.size() * sizeof(uint16_t);
+				bytes += level.flat.size() + level.inns.size() + level.loot.size() +
+					level.targ.size();
+			}
+
+			return bytes;
+		});
+
+		addFormat(".RMD", [](const std::string &filename)
+		{
+			const RMDFile rmd(filename);
+			return static_cast<uint64_t>(sizeof(rmd.getFLOR()) + sizeof(rmd.getMAP1()) +
+				sizeof(rmd.getMAP2()));
+		});
+
+		return formats;
+	}
+
+	// Sorts every listed file into the format for its extension. Names are listed once
+	// for each place they're found, but they're opened the same way regardless of case,
+	// so each is only kept once.
+	void findFiles(std::vector<AssetFormat> &formats)
+	{
+		std::unordered_set<std::string> visited;
+		for (const std::string &name : VFS::Manager::get().list())
+		{
+			const std::string filename = String::toUppercase(name);
+			const std::string extension = String::getExtension(filename);
+			const auto formatIter = std::find_if(formats.begin(), formats.end(),
+				[&extension](const AssetFormat &format) { return format.extension == extension; });
+
+			if ((formatIter != formats.end()) && visited.insert(filename).second)
+			{
+				formatIter->filenames.push_back(filename);
+			}
+		}
+
+		for (AssetFormat &format : formats)
+		{
+			std::sort(format.filenames.begin(), format.filenames.end());
+		}
+	}
+
+	FormatResult runFormat(const AssetFormat &format)
+	{
+		FormatResult result;
+		result.extension = format.extension;
+		result.fileCount = static_cast<int>(format.filenames.size());
+		result.bytesIn = 0;
+		result.bytesOut = 0;
+
+		for (const std::string &filename : format.filenames)
+		{
+			result.bytesIn += VFS::Manager::get().openView(filename).size();
+			result.bytesOut += format.decode(filename);
+		}
+
+		const uint64_t startAllocationCount = AllocationCount;
+		const uint64_t startAllocatedBytes = AllocatedBytes;
+		const auto startTime = std::chrono::high_resolution_clock::now();
+
+		for (int i = 0; i < MeasuredPasses; i++)
+		{
+			for (const std::string &filename : format.filenames)
+			{
+				format.decode(filename);
+			}
+		}
+
+		const double seconds = std::chrono::duration<double>(
+			std::chrono::high_resolution_clock::now() - startTime).count();
+		result.seconds = seconds / static_cast<double>(MeasuredPasses);
+		result.allocationCount = (AllocationCount - startAllocationCount) / MeasuredPasses;
+		result.allocatedBytes = (AllocatedBytes - startAllocatedBytes) / MeasuredPasses;
+		return result;
+	}
+
+	std::string toMegabytes(uint64_t bytes)
+	{
+		return String::fixedPrecision(static_cast<double>(bytes) / 1000000.0, 3);
+	}
+
+	// Gets the speed in MB/s of file bytes read.
+	std::string getSpeed(const FormatResult &result)
+	{
+		const double megabytes = static_cast<double>(result.bytesIn) / 1000000.0;
+		return (result.seconds > 0.0) ?
+			String::fixedPrecision(megabytes / result.seconds, 2) : std::string("0");
+	}
+
+	FormatResult getTotals(const std::vector<FormatResult> &results)
+	{
+		FormatResult totals;
+		totals.extension = "total";
+		totals.fileCount = 0;
+		totals.bytesIn = 0;
+		totals.bytesOut = 0;
+		totals.allocationCount = 0;
+		totals.allocatedBytes = 0;
+		totals.seconds = 0.0;
+
+		for (const FormatResult &result : results)
+		{
+			totals.fileCount += result.fileCount;
+			totals.bytesIn += result.bytesIn;
+			totals.bytesOut += result.bytesOut;
+			totals.allocationCount += result.allocationCount;
+			totals.allocatedBytes += result.allocatedBytes;
+			totals.seconds += result.seconds;
+		}
+
+		return totals;
+	}
+
+	std::string makeResultJSON(const FormatResult &result)
+	{
+		std::stringstream ss;
+		ss << "{ \"format\": \"" << result.extension << "\", \"files\": " <<
+			result.fileCount << ", \"bytesIn\": " << result.bytesIn << ", \"bytesOut\": " <<
+			result.bytesOut << ", \"ms\": " <<
+			String::fixedPrecision(result.seconds * 1000.0, 3) << ", \"mbPerSecond\": " <<
+			getSpeed(result) << ", \"allocations\": " << result.allocationCount <<
+			", \"allocatedBytes\": " << result.allocatedBytes << " }";
+		return ss.str();
+	}
+
+	std::string makeJSON(const std::vector<FormatResult> &results, bool indexed)
+	{
+		std::stringstream ss;
+		ss << "{\n";
+		ss << "  \"indexed\": " << (indexed ? "true" : "false") << ",\n";
+		ss << "  \"passes\": " << MeasuredPasses << ",\n";
+		ss << "  \"total\": " << makeResultJSON(getTotals(results)) << ",\n";
+		ss << "  \"formats\": [\n";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			ss << "    " << makeResultJSON(results[i]) <<
+				(((i + 1) < results.size()) ? "," : "") << "\n";
+		}
+
+		ss << "  ]\n";
+		ss << "}\n";
+		return ss.str();
+	}
+
+	void printResult(const FormatResult &result)
+	{
+		std::cout << "  " << result.extension << ": " << result.fileCount << " files, " <<
+			toMegabytes(result.bytesIn) << " MB in, " << toMegabytes(result.bytesOut) <<
+			" MB out, " << String::fixedPrecision(result.seconds * 1000.0, 3) << " ms (" <<
+			getSpeed(result) << " MB/s), " << result.allocationCount << " allocations (" <<
+			toMegabytes(result.allocatedBytes) << " MB)\n";
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const std::string arenaPath = (argc > 1) ? argv[1] : DefaultArenaPath;
+	const std::string jsonPath = (argc > 2) ? argv[2] : std::string();
+	const bool indexed = (argc > 3) && (std::string(argv[3]) == "indexed");
+
+	DebugAssert(File::exists(arenaPath + "/GLOBAL.BSA"),
+		"\"" + arenaPath + "\" not a valid ARENA path.");
+
+	VFS::Manager::get().initialize(std::string(arenaPath));
+
+	Palette palette;
+	COLFile::toPalette(PaletteFile::fromName(PaletteName::Default), palette);
+
+	std::vector<AssetFormat> formats = makeFormats(palette, indexed);
+	findFiles(formats);
+
+	std::vector<FormatResult> results;
+	for (const AssetFormat &format : formats)
+	{
+		results.push_back(runFormat(format));
+	}
+
+	std::cout << "Per pass (" << (indexed ? "indexed" : "32-bit") << " images):\n";
+	for (const FormatResult &result : results)
+	{
+		printResult(result);
+	}
+
+	printResult(getTotals(results));
+
+	if (jsonPath.size() > 0)
+	{
+		std::ofstream jsonFile(jsonPath);
+		DebugAssert(jsonFile.is_open(), "Could not open \"" + jsonPath + "\".");
+		jsonFile << makeJSON(results, indexed);
+	}
+
+	return EXIT_SUCCESS;
+}
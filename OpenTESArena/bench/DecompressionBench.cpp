@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "../src/Assets/Compression.h"
+#include "../src/Utilities/Bytes.h"
+#include "../src/Utilities/Debug.h"
+#include "../src/Utilities/File.h"
+#include "../src/Utilities/String.h"
+
+#include "components/vfs/manager.hpp"
+
+// Benchmark for the type 4 and type 8 decoders. It finds every compressed image in the
+// archive's .IMG and .CIF files, decodes all of them with both the current decoders and
+// the reference ones they replaced, makes sure the output is the same, and reports the
+// speed of each in MB/s of decoded pixels. .SET files are stored uncompressed, so there
+// is nothing in them to decode.
+
+// Usage: arena_decompression_bench [ARENA path]
+
+namespace
+{
+	const std::string DefaultArenaPath = "data/ARENA";
+
+	// Times each decoder goes through all of the images.
+	const int MeasuredPasses = 20;
+
+	// Headerless files with hardcoded dimensions (from IMGFile and CIFFile). Their first
+	// bytes are pixels, so they can look like a compressed header.
+	const std::unordered_set<std::string> RawFilenames =
+	{
+		"ARENARW.IMG", "CITY.IMG", "DITHER.IMG", "DITHER2.IMG", "DUNGEON.IMG",
+		"DZTTAV.IMG", "NOCAMP.IMG", "NOSPELL.IMG", "P1.IMG", "POPTALK.IMG", "S2.IMG",
+		"SLIDER.IMG", "TOWN.IMG", "UPDOWN.IMG", "VILLAGE.IMG", "BRASS.CIF", "BRASS2.CIF",
+		"MARBLE.CIF", "MARBLE2.CIF", "PARCH.CIF", "SCROLL.CIF"
+	};
+
+	// One compressed image, with the bytes given to its decoder.
+	struct CompressedImage
+	{
+		std::string filename;
+		std::vector<uint8_t> data;
+		int decodedSize;
+	};
+
+	typedef std::function<void(const uint8_t*, const uint8_t*, std::vector<uint8_t>&)>
+		DecodeFunction;
+
+	// The decoders as they were before their fast paths, kept for comparison.
+	void referenceDecodeType04(const uint8_t *src, const uint8_t *srcend,
+		std::vector<uint8_t> &out)
+	{
+		auto dst = out.begin();
+
+		std::array<uint8_t, 4096> history;
+		history.fill(0x20);
+		int historypos = 0;
+
+		// This appears to be some form of LZ compression. It starts with a 1-byte-
+		// wide bitmask, where each bit declares if the next pixel comes directly
+		// from the input, or refers back to a previous run of output pixels that
+		// get duplicated. After each bit in the mask is used, another byte is read
+		// for another bitmask and the cycle repeats until the end of input.
+		int bitcount = 0;
+		int mask = 0;
+		while (src != srcend)
+		{
+			if (!bitcount)
+			{
+				bitcount = 8;
+				mask = *(src++);
+			}
+			else
+			{
+				mask >>= 1;
+			}
+
+			if ((mask & 1))
+			{
+				if (src == srcend)
+				{
+					throw std::runtime_error("Unexpected end of image.");
+				}
+
+				if (dst == out.end())
+				{
+					throw std::runtime_error("Decoded image overflow.");
+				}
+
+				history[historypos++ & 0x0FFF] = *src;
+				*(dst++) = *(src++);
+			}
+			else
+			{
+				if (std::distance(src, srcend) < 2)
+				{
+					throw std::runtime_error("Unexpected end of image.");
+				}
+
+				uint8_t byte1 = *(src++);
+				uint8_t byte2 = *(src++);
+				int tocopy = (byte2 & 0x0F) + 3;
+				int copypos = (((byte2 & 0xF0) << 4) | byte1) + 18;
+
+				if (std::distance(dst, out.end()) < tocopy)
+				{
+					throw std::runtime_error("Decoded image overflow.");
+				}
+
+				for (int i = 0; i < tocopy; i++)
+				{
+					*dst = history[copypos++ & 0x0FFF];
+					history[historypos++ & 0x0FFF] = *(dst++);
+				}
+			}
+
+			bitcount--;
+		}
+
+		std::fill(dst, out.end(), 0);
+	}
+
+	void referenceDecodeType08(const uint8_t *src, const uint8_t *srcend,
+		std::vector<uint8_t> &out)
+	{
+		static const std::array<uint8_t, 256> highOffsetBits{
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+			0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+			0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+			0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+			0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+			0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09,
+			0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0B, 0x0B, 0x0B, 0x0B, 0x0B, 0x0B, 0x0B, 0x0B,
+			0x0C, 0x0C, 0x0C, 0x0C, 0x0D, 0x0D, 0x0D, 0x0D, 0x0E, 0x0E, 0x0E, 0x0E, 0x0F, 0x0F, 0x0F, 0x0F,
+			0x10, 0x10, 0x10, 0x10, 0x11, 0x11, 0x11, 0x11, 0x12, 0x12, 0x12, 0x12, 0x13, 0x13, 0x13, 0x13,
+			0x14, 0x14, 0x14, 0x14, 0x15, 0x15, 0x15, 0x15, 0x16, 0x16, 0x16, 0x16, 0x17, 0x17, 0x17, 0x17,
+			0x18, 0x18, 0x19, 0x19, 0x1A, 0x1A, 0x1B, 0x1B, 0x1C, 0x1C, 0x1D, 0x1D, 0x1E, 0x1E, 0x1F, 0x1F,
+			0x20, 0x20, 0x21, 0x21, 0x22, 0x22, 0x23, 0x23, 0x24, 0x24, 0x25, 0x25, 0x26, 0x26, 0x27, 0x27,
+			0x28, 0x28, 0x29, 0x29, 0x2A, 0x2A, 0x2B, 0x2B, 0x2C, 0x2C, 0x2D, 0x2D, 0x2E, 0x2E, 0x2F, 0x2F,
+			0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F
+		};
+		static const std::array<uint8_t, 256> lowOffsetBitCount{
+			0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+			0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+			0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+			0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+			0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+			0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+			0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+			0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+			0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+			0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+			0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+			0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+			0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+			0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+			0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+			0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08
+		};
+
+		std::array<uint8_t, 4096> history;
+		history.fill(0x20);
+		int historypos = 0;
+
+		std::array<uint16_t, 941> NodeIdxMap;
+		std::iota(NodeIdxMap.begin(), NodeIdxMap.begin() + 626, 0);
+		std::for_each(NodeIdxMap.begin(), NodeIdxMap.begin() + 626,
+			[](uint16_t &val) { val = (val >> 1) + 314; }
+		);
+
+		NodeIdxMap[626] = 0;
+		std::iota(NodeIdxMap.begin() + 627, NodeIdxMap.end(), 0);
+
+		std::array<uint16_t, 627> NodeTree;
+		std::iota(NodeTree.begin(), NodeTree.begin() + 314, 627);
+		std::iota(NodeTree.begin() + 314, NodeTree.end(), 0);
+		std::for_each(NodeTree.begin() + 314, NodeTree.end(),
+			[](uint16_t &val) { val *= 2; }
+		);
+
+		std::array<uint16_t, 627> NodeFreq;
+		std::fill(NodeFreq.begin(), NodeFreq.begin() + 314, 1);
+		{
+			auto iter = NodeFreq.begin();
+			std::for_each(NodeFreq.begin() + 314, NodeFreq.begin() + 627,
+				[&iter](uint16_t &val)
+			{
+				val = *(iter++);
+				val += *(iter++);
+			});
+		}
+
+		uint16_t bitmask = 0;
+		uint8_t validbits = 0;
+
+		// This feels like some form of adaptive Huffman coding, with a form of LZ
+		// compression. DEFLATE?
+		auto dst = out.begin();
+		while (dst != out.end())
+		{
+			// Starting with the root, append bits from the input while traversing
+			// the tree until a leaf node is found (indicated by being >= 627).
+			uint16_t node = NodeTree[626];
+			while (node < 627)
+			{
+				while (validbits < 9)
+				{
+					if (src != srcend)
+					{
+						bitmask |= *(src++) << (8 - validbits);
+					}
+
+					validbits += 8;
+				}
+
+				node = NodeTree.at(node + ((bitmask >> 15) & 1));
+				bitmask <<= 1;
+				validbits--;
+			}
+
+			// Increment the use count (frequency) of this node, and ensure the
+			// tree remains sorted.
+			uint16_t freqidx = NodeIdxMap.at(node);
+			do {
+				NodeFreq.at(freqidx) += 1;
+				uint16_t freq = NodeFreq[freqidx];
+				uint16_t nextidx = freqidx + 1;
+				if (nextidx < NodeFreq.size() && NodeFreq[nextidx] < freq)
+				{
+					// Find the next frequency count that's not greater than the new frequency.
+					do {
+						nextidx++;
+					} while (nextidx < NodeFreq.size() && NodeFreq[nextidx] < freq);
+					nextidx--;
+
+					// Swap 'em, placing the new frequency just before the next
+					// greater one. Since the freq only incremented by 1, this
+					// won't put it out of order.
+					NodeFreq[freqidx] = NodeFreq[nextidx];
+					NodeFreq[nextidx] = freq;
+
+					std::iter_swap(NodeTree.begin() + freqidx, NodeTree.begin() + nextidx);
+
+					// Update the index mappings
+					uint16_t mapidx = NodeTree[nextidx];
+					NodeIdxMap.at(mapidx) = nextidx;
+					if (mapidx < 627)
+					{
+						NodeIdxMap[mapidx + 1] = nextidx;
+					}
+
+					mapidx = NodeTree[freqidx];
+					NodeIdxMap.at(mapidx) = freqidx;
+					if (mapidx < 627)
+					{
+						NodeIdxMap[mapidx + 1] = freqidx;
+					}
+
+					freqidx = nextidx;
+				}
+				// Recurse up the tree
+				freqidx = NodeIdxMap[freqidx];
+			} while (freqidx != 0);
+
+			// Get the value from the node. If it's less than 256, it's a direct pixel value.
+			uint16_t codeword = node - 627;
+			if (codeword < 256)
+			{
+				uint8_t codewordByte = static_cast<uint8_t>(codeword);
+				history[historypos++ & 0x0FFF] = codewordByte;
+				*(dst++) = codewordByte;
+			}
+			else
+			{
+				// Otherwise, get the next 8 bits from input to construct the
+				// offset to previous pixels to repeat, with the count being
+				// derived from the node's value.
+				while (validbits < 9)
+				{
+					if (src != srcend)
+					{
+						bitmask |= *(src++) << (8 - validbits);
+					}
+
+					validbits += 8;
+				}
+
+				uint8_t tableidx = bitmask >> 8;
+				bitmask <<= 8;
+				validbits -= 8;
+
+				uint16_t offsetHigh = highOffsetBits[tableidx] << 6;
+				uint16_t bitcount = lowOffsetBitCount[tableidx] - 2;
+				uint16_t offsetLow = tableidx;
+				for (uint16_t i = 0; i < bitcount; i++)
+				{
+					while (validbits < 9)
+					{
+						if (src != srcend)
+						{
+							bitmask |= *(src++) << (8 - validbits);
+						}
+
+						validbits += 8;
+					}
+
+					offsetLow = (offsetLow << 1) | ((bitmask >> 15) & 1);
+					bitmask <<= 1;
+					validbits--;
+				}
+
+				uint16_t copypos = historypos - (offsetHigh | (offsetLow & 0x003F)) - 1;
+				uint16_t tocopy = codeword - 256 + 3;
+				for (uint16_t i = 0; i < tocopy; i++)
+				{
+					*dst = history[copypos++ & 0x0FFF];
+					history[historypos++ & 0x0FFF] = *(dst++);
+				}
+			}
+		}
+	}
+
+	std::vector<uint8_t> readFile(const std::string &filename)
+	{
+		VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
+		DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
+
+		stream->seekg(0, std::ios::end);
+		std::vector<uint8_t> srcData(stream->tellg());
+		stream->seekg(0, std::ios::beg);
+		stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+		return srcData;
+	}
+
+	// Adds the image whose 12-byte header is at the given offset if it's type 4 or 8 and
+	// fits in the file. Returns the offset of the next header, or the end of the file if
+	// there isn't one.
+	size_t addImage(const std::string &filename, const std::vector<uint8_t> &srcData,
+		size_t offset, std::vector<CompressedImage> &type04Images,
+		std::vector<CompressedImage> &type08Images)
+	{
+		const int headerSize = 12;
+		if ((offset + headerSize) > srcData.size())
+		{
+			return srcData.size();
+		}
+
+		const uint8_t *header = srcData.data() + offset;
+		const uint16_t width = Bytes::getLE16(header + 4);
+		const uint16_t height = Bytes::getLE16(header + 6);
+		const uint16_t flags = Bytes::getLE16(header + 8);
+		const uint16_t len = Bytes::getLE16(header + 10);
+
+		const size_t dataEnd = offset + headerSize + len;
+		const bool isType04 = (flags & 0x00FF) == 0x0004;
+		const bool isType08 = (flags & 0x00FF) == 0x0008;
+		if ((!isType04 && !isType08) || ((width * height) == 0) ||
+			(dataEnd > srcData.size()) || (isType08 && (len < 2)))
+		{
+			return srcData.size();
+		}
+
+		// Type 8 data starts with a 2 byte decompressed length, which the decoder skips.
+		const size_t dataStart = offset + headerSize + (isType08 ? 2 : 0);
+
+		CompressedImage image;
+		image.filename = filename;
+		image.data = std::vector<uint8_t>(srcData.begin() + dataStart,
+			srcData.begin() + dataEnd);
+		image.decodedSize = width * height;
+
+		// Skip images the reference decoder can't decode.
+		try
+		{
+			std::vector<uint8_t> out(image.decodedSize);
+			const uint8_t *begin = image.data.data();
+			if (isType04)
+			{
+				referenceDecodeType04(begin, begin + image.data.size(), out);
+			}
+			else
+			{
+				referenceDecodeType08(begin, begin + image.data.size(), out);
+			}
+		}
+		catch (const std::runtime_error&)
+		{
+			return srcData.size();
+		}
+
+		(isType04 ? type04Images : type08Images).push_back(std::move(image));
+		return dataEnd;
+	}
+
+	// Finds the compressed images in every .IMG and .CIF file. IMGs have one image, and
+	// CIFs have one after another until the end of the file.
+	void findImages(std::vector<CompressedImage> &type04Images,
+		std::vector<CompressedImage> &type08Images)
+	{
+		std::unordered_set<std::string> visited;
+		for (const std::string &name : VFS::Manager::get().list())
+		{
+			const std::string filename = String::toUppercase(name);
+			const std::string extension = String::getExtension(filename);
+			const bool isIMG = extension == ".IMG";
+			const bool isCIF = extension == ".CIF";
+
+			if ((!isIMG && !isCIF) || (RawFilenames.find(filename) != RawFilenames.end()) ||
+				!visited.insert(filename).second)
+			{
+				continue;
+			}
+
+			const std::vector<uint8_t> srcData = readFile(name);
+
+			// 4096-byte IMGs are walls with no header.
+			if (isIMG && (srcData.size() != 4096))
+			{
+				addImage(filename, srcData, 0, type04Images, type08Images);
+			}
+			else if (isCIF)
+			{
+				size_t offset = 0;
+				while (offset < srcData.size())
+				{
+					offset = addImage(filename, srcData, offset, type04Images, type08Images);
+				}
+			}
+		}
+	}
+
+	// Returns whether both decoders give the same pixels for every image.
+	bool compareDecoders(const std::vector<CompressedImage> &images,
+		const DecodeFunction &reference, const DecodeFunction &current)
+	{
+		bool matches = true;
+		for (const CompressedImage &image : images)
+		{
+			std::vector<uint8_t> referenceOut(image.decodedSize);
+			std::vector<uint8_t> currentOut(image.decodedSize);
+			const uint8_t *begin = image.data.data();
+			const uint8_t *end = begin + image.data.size();
+			reference(begin, end, referenceOut);
+			current(begin, end, currentOut);
+
+			if (referenceOut != currentOut)
+			{
+				std::cout << "Decoded pixels differ in \"" << image.filename << "\".\n";
+				matches = false;
+			}
+		}
+
+		return matches;
+	}
+
+	// Gets the decoding speed in MB/s of decoded pixels.
+	double measureDecoder(const std::vector<CompressedImage> &images,
+		const DecodeFunction &decode)
+	{
+		int maxDecodedSize = 0;
+		double decodedBytes = 0.0;
+		for (const CompressedImage &image : images)
+		{
+			maxDecodedSize = std::max(maxDecodedSize, image.decodedSize);
+			decodedBytes += static_cast<double>(image.decodedSize);
+		}
+
+		std::vector<uint8_t> out(maxDecodedSize);
+		const auto startTime = std::chrono::high_resolution_clock::now();
+
+		for (int i = 0; i < MeasuredPasses; i++)
+		{
+			for (const CompressedImage &image : images)
+			{
+				out.resize(image.decodedSize);
+				const uint8_t *begin = image.data.data();
+				decode(begin, begin + image.data.size(), out);
+			}
+		}
+
+		const double seconds = std::chrono::duration<double>(
+			std::chrono::high_resolution_clock::now() - startTime).count();
+		return (decodedBytes * static_cast<double>(MeasuredPasses)) /
+			(seconds * 1000000.0);
+	}
+
+	// Compares and times both decoders for one compression type. Returns whether they
+	// matched.
+	bool runType(const std::string &typeName, const std::vector<CompressedImage> &images,
+		const DecodeFunction &reference, const DecodeFunction &current)
+	{
+		double decodedBytes = 0.0;
+		for (const CompressedImage &image : images)
+		{
+			decodedBytes += static_cast<double>(image.decodedSize);
+		}
+
+		std::cout << typeName << ": " << images.size() << " images, " <<
+			String::fixedPrecision(decodedBytes / 1000000.0, 2) << " MB decoded per pass\n";
+
+		if (images.size() == 0)
+		{
+			return true;
+		}
+
+		const bool matches = compareDecoders(images, reference, current);
+		const double referenceSpeed = measureDecoder(images, reference);
+		const double currentSpeed = measureDecoder(images, current);
+
+		std::cout << "  before: " << String::fixedPrecision(referenceSpeed, 1) << " MB/s\n";
+		std::cout << "  after: " << String::fixedPrecision(currentSpeed, 1) << " MB/s (" <<
+			String::fixedPrecision(currentSpeed / referenceSpeed, 2) << "x)\n";
+		return matches;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const std::string arenaPath = (argc > 1) ? argv[1] : DefaultArenaPath;
+
+	DebugAssert(File::exists(arenaPath + "/GLOBAL.BSA"),
+		"\"" + arenaPath + "\" not a valid ARENA path.");
+
+	VFS::Manager::get().initialize(std::string(arenaPath));
+
+	std::vector<CompressedImage> type04Images, type08Images;
+	findImages(type04Images, type08Images);
+
+	const bool type04Matches = runType("Type 4", type04Images, referenceDecodeType04,
+		Compression::decodeType04);
+	const bool type08Matches = runType("Type 8", type08Images, referenceDecodeType08,
+		static_cast<void(*)(const uint8_t*, const uint8_t*, std::vector<uint8_t>&)>(
+			Compression::decodeType08));
+
+	return (type04Matches && type08Matches) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
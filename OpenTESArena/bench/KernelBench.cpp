@@ -0,0 +1,585 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/Math/Constants.h"
+#include "../src/Math/Vector2.h"
+#include "../src/Math/Vector3.h"
+#include "../src/Rendering/SoftwareRenderer.h"
+#include "../src/Rendering/SpanShading.h"
+#include "../src/Utilities/Debug.h"
+#include "../src/Utilities/File.h"
+#include "../src/Utilities/String.h"
+
+// Microbenchmark for the software renderer's intersection helpers and column kernels. Each
+// one is timed on its own with synthetic inputs (procedural textures, a fan of rays through
+// one voxel), so a regression shows up in the primitive that caused it instead of being
+// spread over a whole frame. It needs no game data.
+
+// Kernels that shade pixels are run once with each span shading instruction set the build
+// and CPU support. Pixel math precision is chosen at compile time, so comparing double with
+// float takes two builds (see TES_FLOAT_PIXEL_MATH).
+
+// Usage: arena_kernel_bench [baseline path]
+// With a baseline path, the results are written there if the file doesn't exist yet, and
+// compared against it otherwise. That way a float build can be compared against a double
+// build, or a change against the commit before it.
+
+namespace
+{
+	const int FrameWidth = 1280;
+	const int FrameHeight = 720;
+	const double VerticalFOV = 60.0;
+
+	// Each kernel is timed in batches until this much time has passed, and its fastest
+	// batch is reported, so one-off interruptions from the OS don't count.
+	const double MeasuredSeconds = 0.25;
+
+	// Operations per batch for the intersection helpers, which take nanoseconds each. The
+	// column kernels do one screen-wide pass per batch instead.
+	const int HelperBatchOps = 4096;
+
+	// Number of different rays the intersection helpers cycle through.
+	const int RayCount = 1024;
+
+	struct KernelResult
+	{
+		std::string name;
+		std::string variant; // Instruction set, or empty if the kernel doesn't shade.
+		double nsPerOp;
+		double pixelsPerOp; // Zero if the kernel doesn't draw pixels.
+
+		std::string getKey() const
+		{
+			return (this->variant.size() > 0) ? (this->name + '/' + this->variant) : this->name;
+		}
+	};
+
+	// Gets the name of the precision used by the renderer's per-pixel math in this build.
+	const char *getPixelMathName()
+	{
+#if defined(TES_FLOAT_PIXEL_MATH)
+		return "float";
+#else
+		return "double";
+#endif
+	}
+
+	// Times batches of the operation until the measured time is used up, and returns the
+	// fastest batch's nanoseconds per operation. Templated so the operation is inlined and
+	// the cheapest helpers aren't measured mostly by call overhead.
+	template <typename Function>
+	double measure(int batchOps, const Function &function)
+	{
+		// One untimed batch first to warm up the caches.
+		for (int i = 0; i < batchOps; i++)
+		{
+			function(i);
+		}
+
+		double bestSeconds = std::numeric_limits<double>::infinity();
+		double totalSeconds = 0.0;
+		while (totalSeconds < MeasuredSeconds)
+		{
+			const auto startTime = std::chrono::high_resolution_clock::now();
+
+			for (int i = 0; i < batchOps; i++)
+			{
+				function(i);
+			}
+
+			const double seconds = std::chrono::duration<double>(
+				std::chrono::high_resolution_clock::now() - startTime).count();
+			bestSeconds = std::min(bestSeconds, seconds);
+			totalSeconds += seconds;
+		}
+
+		return (bestSeconds * 1000000000.0) / static_cast<double>(batchOps);
+	}
+
+	// Writes the results to the baseline file if it doesn't exist, or prints how each one
+	// compares to the baseline's.
+	void compareBaseline(const std::vector<KernelResult> &results, const std::string &path)
+	{
+		if (!File::exists(path))
+		{
+			std::ofstream file(path);
+			DebugAssert(file.is_open(), "Could not open \"" + path + "\".");
+
+			for (const KernelResult &result : results)
+			{
+				file << result.getKey() << ' ' << String::fixedPrecision(result.nsPerOp, 3) << '\n';
+			}
+
+			std::cout << "Wrote baseline (" << getPixelMathName() << " pixel math) to \"" <<
+				path << "\".\n";
+			return;
+		}
+
+		std::ifstream file(path);
+		DebugAssert(file.is_open(), "Could not open \"" + path + "\".");
+
+		std::vector<std::pair<std::string, double>> baseline;
+		std::string key;
+		double nsPerOp;
+		while (file >> key >> nsPerOp)
+		{
+			baseline.push_back(std::make_pair(key, nsPerOp));
+		}
+
+		std::cout << "Compared against baseline in \"" << path << "\" (speedup):\n";
+
+		for (const KernelResult &result : results)
+		{
+			const auto iter = std::find_if(baseline.begin(), baseline.end(),
+				[&result](const std::pair<std::string, double> &pair)
+			{
+				return pair.first == result.getKey();
+			});
+
+			std::cout << result.getKey() << ": ";
+			if (iter == baseline.end())
+			{
+				std::cout << "not in baseline\n";
+			}
+			else
+			{
+				std::cout << String::fixedPrecision(iter->second / result.nsPerOp, 2) << "x\n";
+			}
+		}
+	}
+
+	void printResults(const std::vector<KernelResult> &results)
+	{
+		std::cout << "Renderer kernels, " << FrameWidth << "x" << FrameHeight << " frame, " <<
+			getPixelMathName() << " pixel math:\n";
+
+		for (const KernelResult &result : results)
+		{
+			std::cout << result.getKey() << ": " <<
+				String::fixedPrecision(result.nsPerOp, 2) << " ns/op";
+
+			if (result.pixelsPerOp > 0.0)
+			{
+				const double pixelsPerSecond = (result.pixelsPerOp * 1000000000.0) /
+					result.nsPerOp;
+				std::cout << ", " << String::fixedPrecision(pixelsPerSecond / 1000000.0, 1) <<
+					" Mpixels/s";
+			}
+
+			std::cout << '\n';
+		}
+	}
+}
+
+// Friend of SoftwareRenderer, so its private static helpers can be called directly.
+class KernelBench
+{
+private:
+	typedef SoftwareRenderer::VoxelTexture VoxelTexture;
+	typedef SoftwareRenderer::FlatTexture FlatTexture;
+
+	// A wall texture of colored stripes, with texels on a checkerboard made transparent
+	// when it's for the transparent kernel.
+	static std::unique_ptr<VoxelTexture> makeVoxelTexture(bool transparent)
+	{
+		auto texture = std::make_unique<VoxelTexture>();
+		for (int x = 0; x < VoxelTexture::WIDTH; x++)
+		{
+			for (int y = 0; y < VoxelTexture::HEIGHT; y++)
+			{
+				SoftwareRenderer::VoxelTexel &texel =
+					texture->texels[VoxelTexture::getTexelIndex(x, y, VoxelTexture::WIDTH)];
+				texel.r = static_cast<uint8_t>(x * 4);
+				texel.g = static_cast<uint8_t>(y * 4);
+				texel.b = static_cast<uint8_t>((x ^ y) * 4);
+				texel.a = (transparent && ((((x / 8) + (y / 8)) % 2) == 0)) ? 0 : 255;
+			}
+		}
+
+		texture->generateMipmaps();
+		return texture;
+	}
+
+	// A sprite-like flat texture: an opaque disc with transparent corners.
+	static FlatTexture makeFlatTexture()
+	{
+		const int size = 64;
+		const double radius = static_cast<double>(size) / 2.0;
+
+		FlatTexture texture;
+		texture.width = size;
+		texture.height = size;
+		texture.texels.resize(size * size);
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				const double dx = (static_cast<double>(x) + 0.50) - radius;
+				const double dy = (static_cast<double>(y) + 0.50) - radius;
+				SoftwareRenderer::FlatTexel &texel = texture.texels[x + (y * size)];
+				texel.r = static_cast<uint8_t>(x * 4);
+				texel.g = static_cast<uint8_t>(y * 4);
+				texel.b = 128;
+				texel.a = (((dx * dx) + (dy * dy)) < (radius * radius)) ? 255 : 0;
+			}
+		}
+
+		texture.updateRuns();
+		return texture;
+	}
+
+	// Daytime interior-like shading with no lights, and a sky row color for each row.
+	static SoftwareRenderer::ShadingInfo makeShadingInfo(
+		const std::vector<uint32_t> &skyRowColors)
+	{
+		SoftwareRenderer::ShadingInfo shadingInfo(Double3(0.50, 0.60, 0.80),
+			Double3(0.20, 0.30, 0.60), Double3(1.0, 1.0, 1.0),
+			Double3(0.30, 0.80, 0.20).normalized(), 0.60, 25.0, -Double3::UnitX,
+			VoxelTexture::MIP_LEVEL_COUNT - 1);
+		shadingInfo.skyRowColors = skyRowColors.data();
+		return shadingInfo;
+	}
+
+	// Rays fanned out across the camera's view, all passing through the same voxel. The
+	// eye is in the middle of voxel (0, 0) looking down +X, so each ray enters voxel (1, 0)
+	// on its -X face and leaves through its +X face.
+	struct RayInput
+	{
+		SoftwareRenderer::Ray ray;
+		Double2 nearPoint, farPoint; // Where the ray enters and leaves voxel (1, 0).
+
+		RayInput(double angle)
+			: ray(std::cos(angle), std::sin(angle))
+		{
+			const double slope = std::tan(angle);
+			this->nearPoint = Double2(1.0, 0.50 + (slope * 0.50));
+			this->farPoint = Double2(2.0, 0.50 + (slope * 1.50));
+		}
+	};
+
+	static std::vector<RayInput> makeRays()
+	{
+		std::vector<RayInput> rays;
+		rays.reserve(RayCount);
+		for (int i = 0; i < RayCount; i++)
+		{
+			const double percent = static_cast<double>(i) / static_cast<double>(RayCount - 1);
+			rays.push_back(RayInput((percent - 0.50) * 0.60));
+		}
+
+		return rays;
+	}
+
+	static std::vector<KernelResult> runHelpers()
+	{
+		const Double3 eye(0.50, 0.60, 0.50);
+		const SoftwareRenderer::Camera camera(eye, Double3::UnitX, VerticalFOV,
+			static_cast<double>(FrameWidth) / static_cast<double>(FrameHeight));
+		const std::vector<RayInput> rays = makeRays();
+		const std::array<VoxelData::Facing, 4> facings =
+		{
+			VoxelData::Facing::PositiveX, VoxelData::Facing::NegativeX,
+			VoxelData::Facing::PositiveZ, VoxelData::Facing::NegativeZ
+		};
+
+		const std::array<VoxelData::DoorData::Type, 3> doorTypes =
+		{
+			VoxelData::DoorData::Type::Swinging, VoxelData::DoorData::Type::Sliding,
+			VoxelData::DoorData::Type::Raising
+		};
+
+		// Hit results are summed so the calls can't be optimized out.
+		volatile double sink = 0.0;
+		auto addResult = [&sink](bool success, const SoftwareRenderer::RayHit &hit)
+		{
+			sink = sink + (success ? hit.u : 0.0);
+		};
+
+		auto makeResult = [](const std::string &name, double nsPerOp)
+		{
+			KernelResult result;
+			result.name = name;
+			result.nsPerOp = nsPerOp;
+			result.pixelsPerOp = 0.0;
+			return result;
+		};
+
+		std::vector<KernelResult> results;
+		results.push_back(makeResult("findDiag1Intersection",
+			measure(HelperBatchOps, [&rays, &addResult](int i)
+		{
+			const RayInput &input = rays[i % RayCount];
+			SoftwareRenderer::RayHit hit;
+			addResult(SoftwareRenderer::findDiag1Intersection(1, 0, input.nearPoint,
+				input.farPoint, hit), hit);
+		})));
+
+		results.push_back(makeResult("findDiag2Intersection",
+			measure(HelperBatchOps, [&rays, &addResult](int i)
+		{
+			const RayInput &input = rays[i % RayCount];
+			SoftwareRenderer::RayHit hit;
+			addResult(SoftwareRenderer::findDiag2Intersection(1, 0, input.nearPoint,
+				input.farPoint, hit), hit);
+		})));
+
+		results.push_back(makeResult("findInitialEdgeIntersection",
+			measure(HelperBatchOps, [&rays, &facings, &camera, &eye, &addResult](int i)
+		{
+			const RayInput &input = rays[i % RayCount];
+			SoftwareRenderer::RayHit hit;
+			addResult(SoftwareRenderer::findInitialEdgeIntersection(0, 0, facings[i % 4],
+				Double2(eye.x, eye.z), input.nearPoint, camera, input.ray, hit), hit);
+		})));
+
+		results.push_back(makeResult("findEdgeIntersection",
+			measure(HelperBatchOps, [&rays, &facings, &camera, &addResult](int i)
+		{
+			const RayInput &input = rays[i % RayCount];
+			SoftwareRenderer::RayHit hit;
+			addResult(SoftwareRenderer::findEdgeIntersection(1, 0, facings[i % 4],
+				VoxelData::Facing::NegativeX, input.nearPoint, input.farPoint,
+				input.nearPoint.y, camera, input.ray, hit), hit);
+		})));
+
+		results.push_back(makeResult("findDoorIntersection",
+			measure(HelperBatchOps, [&rays, &doorTypes, &addResult](int i)
+		{
+			const RayInput &input = rays[i % RayCount];
+			SoftwareRenderer::RayHit hit;
+			const double openPercent = 0.125 + (0.25 * static_cast<double>(i % 4));
+			const double wallU = input.nearPoint.y - std::floor(input.nearPoint.y);
+			addResult(SoftwareRenderer::findDoorIntersection(doorTypes[i % 3], openPercent,
+				input.nearPoint, input.farPoint, -Double3::UnitX, wallU, hit), hit);
+		})));
+
+		results.push_back(makeResult("getChasmFarFacing",
+			measure(HelperBatchOps, [&rays, &camera, &sink](int i)
+		{
+			const RayInput &input = rays[i % RayCount];
+			const VoxelData::Facing facing = SoftwareRenderer::getChasmFarFacing(1, 0,
+				VoxelData::Facing::NegativeX, camera, input.ray);
+			sink = sink + static_cast<int>(facing);
+		})));
+
+		return results;
+	}
+
+	// Times the column kernels with the current span shading instruction set. Each batch
+	// draws every column of the frame once.
+	static std::vector<KernelResult> runKernels(const std::string &variant)
+	{
+		std::vector<uint32_t> colorBuffer(FrameWidth * FrameHeight);
+		std::vector<SoftwareRenderer::DepthValue> depthBuffer(FrameWidth * FrameHeight,
+			std::numeric_limits<SoftwareRenderer::DepthValue>::infinity());
+		const SoftwareRenderer::FrameView frame(colorBuffer.data(), depthBuffer.data(),
+			FrameWidth, FrameHeight, false);
+
+		const std::vector<uint32_t> skyRowColors(FrameHeight, 0xFF8090C0);
+		const SoftwareRenderer::ShadingInfo shadingInfo = makeShadingInfo(skyRowColors);
+		const std::unique_ptr<VoxelTexture> wallTexture = makeVoxelTexture(false);
+		const std::unique_ptr<VoxelTexture> transparentTexture = makeVoxelTexture(true);
+		const FlatTexture flatTexture = makeFlatTexture();
+		const double heightReal = static_cast<double>(FrameHeight);
+		const double horizonY = heightReal / 2.0;
+
+		auto makeResult = [&variant](const std::string &name, double nsPerOp,
+			double pixelsPerOp)
+		{
+			KernelResult result;
+			result.name = name;
+			result.variant = variant;
+			result.nsPerOp = nsPerOp;
+			result.pixelsPerOp = pixelsPerOp;
+			return result;
+		};
+
+		// Walls get farther from left to right, so the columns use several mip levels.
+		auto getWallDepth = [](int x)
+		{
+			return 1.0 + ((static_cast<double>(x) / static_cast<double>(FrameWidth)) * 8.0);
+		};
+
+		auto getWallRange = [&getWallDepth, horizonY](int x, double *projectedYStart,
+			double *projectedYEnd, int *yStart, int *yEnd)
+		{
+			const double halfHeight = (horizonY * 0.75) / getWallDepth(x);
+			*projectedYStart = horizonY - halfHeight;
+			*projectedYEnd = horizonY + halfHeight;
+			*yStart = std::max(0, static_cast<int>(std::ceil(*projectedYStart - 0.50)));
+			*yEnd = std::min(FrameHeight, static_cast<int>(std::floor(*projectedYEnd + 0.50)));
+		};
+
+		double wallPixels = 0.0;
+		for (int x = 0; x < FrameWidth; x++)
+		{
+			double projectedYStart, projectedYEnd;
+			int yStart, yEnd;
+			getWallRange(x, &projectedYStart, &projectedYEnd, &yStart, &yEnd);
+			wallPixels += static_cast<double>(yEnd - yStart);
+		}
+
+		const double wallPixelsPerOp = wallPixels / static_cast<double>(FrameWidth);
+
+		// Each column starts out unoccluded, like the first voxel a ray reaches.
+		auto drawWall = [&getWallDepth, &getWallRange, &shadingInfo, &frame](
+			const VoxelTexture &texture, bool transparent, int x)
+		{
+			double projectedYStart, projectedYEnd;
+			int yStart, yEnd;
+			getWallRange(x, &projectedYStart, &projectedYEnd, &yStart, &yEnd);
+
+			const double depth = getWallDepth(x);
+			const double u = std::fmod(static_cast<double>(x) * 0.01, 1.0);
+			SoftwareRenderer::OcclusionData occlusion(0, FrameHeight, true);
+
+			if (transparent)
+			{
+				SoftwareRenderer::drawTransparentPixels(x, yStart, yEnd, projectedYStart,
+					projectedYEnd, depth, u, 0.0, Constants::JustBelowOne, -Double3::UnitX,
+					texture, nullptr, shadingInfo, occlusion, frame);
+			}
+			else
+			{
+				SoftwareRenderer::drawPixels(x, yStart, yEnd, projectedYStart, projectedYEnd,
+					depth, u, 0.0, Constants::JustBelowOne, -Double3::UnitX, texture,
+					shadingInfo, occlusion, frame);
+			}
+		};
+
+		std::vector<KernelResult> results;
+		results.push_back(makeResult("drawPixels",
+			measure(FrameWidth, [&drawWall, &wallTexture](int x)
+		{
+			drawWall(*wallTexture, false, x);
+		}), wallPixelsPerOp));
+
+		// A floor from a few voxels away up to the bottom of the screen.
+		const double floorDepthStart = 8.0;
+		const double floorDepthEnd = 1.0;
+		const double floorProjectedYStart = horizonY + (horizonY / floorDepthStart);
+		const double floorProjectedYEnd = heightReal;
+		const int floorYStart = static_cast<int>(std::ceil(floorProjectedYStart - 0.50));
+		const int floorYEnd = FrameHeight;
+
+		results.push_back(makeResult("drawPerspectivePixels",
+			measure(FrameWidth, [&wallTexture, &shadingInfo, &frame, floorDepthStart,
+				floorDepthEnd, floorProjectedYStart, floorProjectedYEnd, floorYStart,
+				floorYEnd](int x)
+		{
+			const double percent = (static_cast<double>(x) + 0.50) /
+				static_cast<double>(FrameWidth);
+			const Double2 direction = Double2(1.0, percent - 0.50).normalized();
+			const Double2 eye2D(0.50, 0.50);
+			SoftwareRenderer::OcclusionData occlusion(0, FrameHeight, true);
+
+			SoftwareRenderer::drawPerspectivePixels(x, floorYStart, floorYEnd,
+				floorProjectedYStart, floorProjectedYEnd, eye2D + (direction * floorDepthStart),
+				eye2D + (direction * floorDepthEnd), floorDepthStart, floorDepthEnd,
+				Double3::UnitY, *wallTexture, shadingInfo, occlusion, frame);
+		}), static_cast<double>(floorYEnd - floorYStart)));
+
+		// Transparent columns fall back to the depth test, so each one clears its column to
+		// the background first, like the first transparent voxel in a column does in game.
+		results.push_back(makeResult("drawTransparentPixels",
+			measure(FrameWidth, [&drawWall, &transparentTexture](int x)
+		{
+			drawWall(*transparentTexture, true, x);
+		}), wallPixelsPerOp));
+
+		// A flat two voxels ahead covering the middle of the screen, drawn one column tile
+		// at a time like the render threads do. The depth buffer is cleared first, so no
+		// pixel is thrown out by the transparent columns' depths.
+		std::fill(depthBuffer.begin(), depthBuffer.end(),
+			std::numeric_limits<SoftwareRenderer::DepthValue>::infinity());
+
+		SoftwareRenderer::FlatFrame flatFrame;
+		flatFrame.topStart = Double3(2.50, 1.0, 1.0);
+		flatFrame.topEnd = Double3(2.50, 1.0, 0.0);
+		flatFrame.bottomStart = Double3(2.50, 0.0, 1.0);
+		flatFrame.bottomEnd = Double3(2.50, 0.0, 0.0);
+		flatFrame.startX = 0.25;
+		flatFrame.endX = 0.75;
+		flatFrame.startY = 0.20;
+		flatFrame.endY = 0.80;
+		flatFrame.z = 2.0;
+		flatFrame.textureID = 0;
+		flatFrame.flipped = false;
+		flatFrame.flatIndex = 0;
+		flatFrame.lodLevel = 0;
+		flatFrame.drawsAsDot = false;
+
+		const int tileWidth = SoftwareRenderer::COLUMN_TILE_WIDTH;
+		const int flatStartX = static_cast<int>(flatFrame.startX * FrameWidth);
+		const int flatEndX = static_cast<int>(flatFrame.endX * FrameWidth);
+		const int flatTileCount = (flatEndX - flatStartX) / tileWidth;
+		const double flatPixelsPerOp = static_cast<double>(tileWidth) *
+			((flatFrame.endY - flatFrame.startY) * heightReal);
+
+		results.push_back(makeResult("drawFlat",
+			measure(flatTileCount, [&flatFrame, &shadingInfo, &flatTexture, &frame,
+				flatStartX, tileWidth](int i)
+		{
+			const int startX = flatStartX + (i * tileWidth);
+			SoftwareRenderer::drawFlat(startX, startX + tileWidth, flatFrame, false,
+				Double2(0.50, 0.50), shadingInfo, flatTexture, frame);
+		}), flatPixelsPerOp));
+
+		return results;
+	}
+public:
+	static std::vector<KernelResult> run()
+	{
+		std::vector<KernelResult> results = KernelBench::runHelpers();
+
+		const SpanShading::InstructionSet bestSet = SpanShading::getBestInstructionSet();
+		const std::array<SpanShading::InstructionSet, 4> instructionSets =
+		{
+			SpanShading::InstructionSet::Scalar, SpanShading::InstructionSet::SSE2,
+			SpanShading::InstructionSet::AVX2, SpanShading::InstructionSet::NEON
+		};
+
+		for (const SpanShading::InstructionSet instructionSet : instructionSets)
+		{
+			// Unsupported instruction sets fall back to scalar, which was already timed.
+			SpanShading::setInstructionSet(instructionSet);
+			if (SpanShading::getInstructionSet() != instructionSet)
+			{
+				continue;
+			}
+
+			const std::vector<KernelResult> kernelResults = KernelBench::runKernels(
+				SpanShading::getInstructionSetName(instructionSet));
+			results.insert(results.end(), kernelResults.begin(), kernelResults.end());
+		}
+
+		SpanShading::setInstructionSet(bestSet);
+		return results;
+	}
+};
+
+int main(int argc, char *argv[])
+{
+	const std::string baselinePath = (argc > 1) ? argv[1] : std::string();
+
+	const std::vector<KernelResult> results = KernelBench::run();
+	printResults(results);
+
+	if (baselinePath.size() > 0)
+	{
+		compareBaseline(results, baselinePath);
+	}
+
+	return EXIT_SUCCESS;
+}
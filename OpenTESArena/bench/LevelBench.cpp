@@ -0,0 +1,639 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "SDL.h"
+
+#include "../src/Assets/AssetCache.h"
+#include "../src/Assets/CityDataFile.h"
+#include "../src/Assets/ExeData.h"
+#include "../src/Assets/INFFile.h"
+#include "../src/Assets/MIFFile.h"
+#include "../src/Assets/MiscAssets.h"
+#include "../src/Assets/RMDFile.h"
+#include "../src/Media/TextureManager.h"
+#include "../src/Rendering/SoftwareRenderer.h"
+#include "../src/Utilities/Debug.h"
+#include "../src/Utilities/File.h"
+#include "../src/Utilities/JobSystem.h"
+#include "../src/Utilities/LoadProgress.h"
+#include "../src/Utilities/Platform.h"
+#include "../src/Utilities/String.h"
+#include "../src/World/ClimateType.h"
+#include "../src/World/LevelData.h"
+#include "../src/World/Location.h"
+#include "../src/World/LocationType.h"
+#include "../src/World/WeatherType.h"
+#include "../src/World/WorldData.h"
+
+#include "components/vfs/manager.hpp"
+
+// Benchmark for level loading. It goes through every interior .MIF, every main quest
+// dungeon, each province's first named dungeon, a sample of generated cities, and
+// wilderness blocks covering every .RMD, and times three phases of loading each one:
+// - parse: reading the .MIF (or .RMD) and .INF files, bypassing their caches,
+// - load: building the world with WorldData::load*() once the files are cached,
+// - textures: decoding the starting level's voxel textures with a new texture manager
+//   and converting them for the software renderer, like WorldData::setLevelActive().
+// The slowest locations and the totals for each kind are printed, and also written as
+// JSON when a path is given.
+
+// Usage: arena_level_bench [ARENA path] [JSON output path]
+
+namespace
+{
+	const std::string DefaultArenaPath = "data/ARENA";
+
+	// Number of slowest locations in the summary.
+	const int SlowestCount = 10;
+
+	// Local city IDs of each province's first city-state, town, and village.
+	const std::vector<int> SampleCityIDs = { 0, 8, 16 };
+
+	// Named dungeons past the two main quest ones in each province.
+	const int SampleDungeonID = 2;
+
+	// Wilderness blocks that the game picks from (WILD005.RMD to WILD070.RMD).
+	const int FirstRmdID = 5;
+	const int LastRmdID = 70;
+
+	// Same values the game uses for its test locations.
+	const ClimateType BenchClimate = ClimateType::Temperate;
+	const WeatherType BenchWeather = WeatherType::Clear;
+
+	struct BenchLocation
+	{
+		std::string name, kind;
+
+		// Parses the location's files without their caches, then gets them through the
+		// caches so the load doesn't parse them again.
+		std::function<void()> parse;
+		std::function<void()> warmCaches;
+		std::function<WorldData()> load;
+	};
+
+	struct LocationResult
+	{
+		std::string name, kind;
+		double parseSeconds, loadSeconds, textureSeconds;
+
+		double getTotalSeconds() const
+		{
+			return this->parseSeconds + this->loadSeconds + this->textureSeconds;
+		}
+	};
+
+	double secondsSince(const std::chrono::high_resolution_clock::time_point &startTime)
+	{
+		return std::chrono::duration<double>(
+			std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	// Parses a .MIF and the .INF of each of its levels.
+	void parseMIF(const std::string &mifName)
+	{
+		const MIFFile mif(mifName);
+		std::unordered_set<std::string> infNames;
+		for (const auto &level : mif.getLevels())
+		{
+			const std::string infName = String::toUppercase(level.info);
+			if (infNames.insert(infName).second)
+			{
+				const INFFile inf(infName);
+				static_cast<void>(inf);
+			}
+		}
+	}
+
+	void warmMIF(const std::string &mifName)
+	{
+		for (const auto &level : MIFFile::get(mifName).getLevels())
+		{
+			INFFile::get(String::toUppercase(level.info));
+		}
+	}
+
+	BenchLocation makeInterior(const std::string &mifName, const std::string &kind)
+	{
+		BenchLocation location;
+		location.name = mifName;
+		location.kind = kind;
+		location.parse = [mifName]() { parseMIF(mifName); };
+		location.warmCaches = [mifName]() { warmMIF(mifName); };
+		location.load = [mifName]() { return WorldData::loadInterior(MIFFile::get(mifName)); };
+		return location;
+	}
+
+	BenchLocation makeDungeon(const std::string &name, uint32_t seed)
+	{
+		// Same parameters as GameData::loadNamedDungeon().
+		BenchLocation location;
+		location.name = name;
+		location.kind = "dungeon";
+		location.parse = []() { parseMIF("RANDOM1.MIF"); };
+		location.warmCaches = []() { warmMIF("RANDOM1.MIF"); };
+		location.load = [seed]() { return WorldData::loadDungeon(seed, 2, 1, false); };
+		return location;
+	}
+
+	// Picks the city's template the same way as GameData::makeCityWorld().
+	BenchLocation makeCity(int localCityID, int provinceID, const MiscAssets &miscAssets,
+		JobSystem &jobSystem)
+	{
+		const int globalCityID = CityDataFile::getGlobalCityID(localCityID, provinceID);
+		const LocationType locationType = Location::getCityType(localCityID);
+		const ExeData::CityGeneration &cityGen = miscAssets.getExeData().getCityGen();
+		const bool isCityState = locationType == LocationType::CityState;
+		const bool isCoastal = std::find(cityGen.coastalCityList.begin(),
+			cityGen.coastalCityList.end(), globalCityID) != cityGen.coastalCityList.end();
+		const int templateCount = CityDataFile::getCityTemplateCount(isCoastal, isCityState);
+		const int templateID = globalCityID % templateCount;
+
+		const int nameIndex = CityDataFile::getCityTemplateNameIndex(locationType, isCoastal);
+		const std::string mifName = String::toUppercase(String::replace(
+			cityGen.templateFilenames.at(nameIndex), "%d", std::to_string(templateID + 1)));
+
+		const int cityDim = CityDataFile::getCityDimensions(locationType);
+		const std::vector<uint8_t> reservedBlocks = cityGen.reservedBlockLists.at(
+			CityDataFile::getCityReservedBlockListIndex(isCoastal, templateID));
+		const auto &startPair = cityGen.startingPositions.at(
+			CityDataFile::getCityStartingPositionIndex(locationType, isCoastal, templateID));
+		const Int2 startPosition(startPair.first, startPair.second);
+
+		const ClimateType climateType = Location::getCityClimateType(
+			localCityID, provinceID, miscAssets);
+		const std::string infName = WorldData::generateCityInfName(climateType, BenchWeather);
+
+		BenchLocation location;
+		location.name = mifName + " (city " + std::to_string(localCityID) + ", province " +
+			std::to_string(provinceID) + ")";
+		location.kind = "city";
+		location.parse = [mifName, infName]()
+		{
+			const MIFFile mif(mifName);
+			const INFFile inf(infName);
+			static_cast<void>(mif);
+			static_cast<void>(inf);
+		};
+
+		location.warmCaches = [mifName, infName]()
+		{
+			MIFFile::get(mifName);
+			INFFile::get(infName);
+		};
+
+		const MiscAssets *miscAssetsPtr = &miscAssets;
+		JobSystem *jobSystemPtr = &jobSystem;
+		location.load = [localCityID, provinceID, mifName, cityDim, reservedBlocks,
+			startPosition, miscAssetsPtr, jobSystemPtr]()
+		{
+			LoadProgress progress;
+			return WorldData::loadCity(localCityID, provinceID, MIFFile::get(mifName), cityDim,
+				reservedBlocks, startPosition, BenchWeather, *miscAssetsPtr, *jobSystemPtr,
+				progress);
+		};
+
+		return location;
+	}
+
+	BenchLocation makePremadeCity()
+	{
+		const std::string infName = WorldData::generateCityInfName(BenchClimate, BenchWeather);
+
+		BenchLocation location;
+		location.name = "IMPERIAL.MIF";
+		location.kind = "city";
+		location.parse = [infName]()
+		{
+			const MIFFile mif("IMPERIAL.MIF");
+			const INFFile inf(infName);
+			static_cast<void>(mif);
+			static_cast<void>(inf);
+		};
+
+		location.warmCaches = [infName]()
+		{
+			MIFFile::get("IMPERIAL.MIF");
+			INFFile::get(infName);
+		};
+
+		location.load = []()
+		{
+			return WorldData::loadPremadeCity(MIFFile::get("IMPERIAL.MIF"), BenchClimate,
+				BenchWeather);
+		};
+
+		return location;
+	}
+
+	BenchLocation makeWilderness(int rmdTR, int rmdTL, int rmdBR, int rmdBL)
+	{
+		const std::vector<int> rmdIDs = { rmdTR, rmdTL, rmdBR, rmdBL };
+		const std::string infName = WorldData::generateWildernessInfName(
+			BenchClimate, BenchWeather);
+
+		BenchLocation location;
+		location.name = "WILD.MIF (" + std::to_string(rmdTR) + ", " + std::to_string(rmdTL) +
+			", " + std::to_string(rmdBR) + ", " + std::to_string(rmdBL) + ")";
+		location.kind = "wilderness";
+		location.parse = [rmdIDs, infName]()
+		{
+			for (const int rmdID : rmdIDs)
+			{
+				const RMDFile rmd(RMDFile::getFilename(rmdID));
+				static_cast<void>(rmd);
+			}
+
+			const INFFile inf(infName);
+			static_cast<void>(inf);
+		};
+
+		location.warmCaches = [rmdIDs, infName]()
+		{
+			for (const int rmdID : rmdIDs)
+			{
+				RMDFile::get(rmdID);
+			}
+
+			INFFile::get(infName);
+		};
+
+		location.load = [rmdTR, rmdTL, rmdBR, rmdBL]()
+		{
+			return WorldData::loadWilderness(rmdTR, rmdTL, rmdBR, rmdBL, BenchClimate,
+				BenchWeather);
+		};
+
+		return location;
+	}
+
+	// Returns whether the .MIF is an exterior, or a set of dungeon chunks, instead of an
+	// interior that can be loaded on its own.
+	bool isExteriorMIF(const std::string &mifName, const ExeData &exeData)
+	{
+		if ((mifName == "IMPERIAL.MIF") || (mifName == "RANDOM1.MIF") ||
+			(mifName.compare(0, 4, "WILD") == 0))
+		{
+			return true;
+		}
+
+		// City templates are a name followed by a number (i.e., TOWN1.MIF).
+		for (const std::string &templateFilename : exeData.getCityGen().templateFilenames)
+		{
+			const std::string prefix = String::toUppercase(
+				templateFilename.substr(0, templateFilename.find("%d")));
+			const size_t suffixStart = mifName.find_first_of("0123456789");
+			if ((suffixStart != std::string::npos) &&
+				(mifName.substr(0, suffixStart) == prefix) &&
+				(mifName.find_first_not_of("0123456789", suffixStart) ==
+					mifName.find(".MIF")))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Returns whether every level of the .MIF names its .INF. Pieces of other locations
+	// (like city blocks) might not, and can't be loaded on their own.
+	bool hasInfNames(const std::string &mifName)
+	{
+		const auto &levels = MIFFile::get(mifName).getLevels();
+		return (levels.size() > 0) && std::all_of(levels.begin(), levels.end(),
+			[](const MIFFile::Level &level) { return level.info.size() > 0; });
+	}
+
+	std::vector<BenchLocation> makeLocations(const MiscAssets &miscAssets,
+		JobSystem &jobSystem)
+	{
+		const ExeData &exeData = miscAssets.getExeData();
+		const CityDataFile &cityData = miscAssets.getCityDataFile();
+		std::vector<BenchLocation> locations;
+
+		// The start dungeon, two dungeons in each staff province, and the final dungeon.
+		std::unordered_set<std::string> mainQuestNames = { "START.MIF" };
+		for (const int provinceID : exeData.getLocations().staffProvinces)
+		{
+			for (int localDungeonID = 0; localDungeonID < 2; localDungeonID++)
+			{
+				const uint32_t dungeonSeed = cityData.getDungeonSeed(localDungeonID, provinceID);
+				mainQuestNames.insert(CityDataFile::getMainQuestDungeonMifName(dungeonSeed));
+			}
+		}
+
+		mainQuestNames.insert("IMPPAL.MIF");
+
+		std::vector<std::string> mifNames;
+		std::unordered_set<std::string> visited;
+		for (const std::string &name : VFS::Manager::get().list())
+		{
+			const std::string mifName = String::toUppercase(name);
+			if ((String::getExtension(mifName) == ".MIF") && visited.insert(mifName).second)
+			{
+				mifNames.push_back(mifName);
+			}
+		}
+
+		std::sort(mifNames.begin(), mifNames.end());
+		for (const std::string &mifName : mifNames)
+		{
+			if (mainQuestNames.find(mifName) != mainQuestNames.end())
+			{
+				locations.push_back(makeInterior(mifName, "main quest"));
+			}
+			else if (!isExteriorMIF(mifName, exeData) && hasInfNames(mifName))
+			{
+				locations.push_back(makeInterior(mifName, "interior"));
+			}
+		}
+
+		for (int provinceID = 0; provinceID < (CityDataFile::PROVINCE_COUNT - 1); provinceID++)
+		{
+			const uint32_t dungeonSeed = cityData.getDungeonSeed(SampleDungeonID, provinceID);
+			locations.push_back(makeDungeon("Dungeon " + std::to_string(SampleDungeonID) +
+				", province " + std::to_string(provinceID), dungeonSeed));
+		}
+
+		locations.push_back(makePremadeCity());
+		for (int provinceID = 0; provinceID < (CityDataFile::PROVINCE_COUNT - 1); provinceID++)
+		{
+			for (const int localCityID : SampleCityIDs)
+			{
+				locations.push_back(makeCity(localCityID, provinceID, miscAssets, jobSystem));
+			}
+		}
+
+		// Four blocks at a time, so every block is loaded once.
+		for (int rmdID = FirstRmdID; rmdID <= LastRmdID; rmdID += 4)
+		{
+			auto getID = [rmdID](int offset) { return std::min(rmdID + offset, LastRmdID); };
+			locations.push_back(makeWilderness(getID(0), getID(1), getID(2), getID(3)));
+		}
+
+		return locations;
+	}
+
+	// Decodes and converts the voxel textures of the level, like WorldData::setLevelActive()
+	// does with the game's renderer.
+	void loadVoxelTextures(const LevelData &level, TextureManager &textureManager,
+		SoftwareRenderer &renderer)
+	{
+		renderer.clearTextures();
+
+		const INFFile &inf = INFFile::get(level.getInfName());
+		const int voxelTextureCount = static_cast<int>(inf.getVoxelTextures().size());
+		for (int i = 0; i < voxelTextureCount; i++)
+		{
+			const auto &textureData = inf.getVoxelTextures().at(i);
+			const std::string textureName = String::toUppercase(textureData.filename);
+			const std::string extension = String::getExtension(textureName);
+
+			if (extension == ".SET")
+			{
+				textureManager.prefetchSet(textureName);
+			}
+			else if (extension == ".IMG")
+			{
+				textureManager.prefetch(textureName);
+			}
+		}
+
+		std::vector<int> ids;
+		std::vector<const uint32_t*> srcTexels;
+		for (int i = 0; i < voxelTextureCount; i++)
+		{
+			const auto &textureData = inf.getVoxelTextures().at(i);
+			const std::string textureName = String::toUppercase(textureData.filename);
+			const std::string extension = String::getExtension(textureName);
+
+			if (extension == ".SET")
+			{
+				const auto &surfaces = textureManager.getSurfaces(textureName);
+				const SDL_Surface *surface = surfaces.at(textureData.setIndex);
+				ids.push_back(i);
+				srcTexels.push_back(static_cast<const uint32_t*>(surface->pixels));
+			}
+			else if (extension == ".IMG")
+			{
+				const SDL_Surface *surface = textureManager.getSurface(textureName);
+				ids.push_back(i);
+				srcTexels.push_back(static_cast<const uint32_t*>(surface->pixels));
+			}
+		}
+
+		renderer.setVoxelTextures(ids, srcTexels);
+	}
+
+	LocationResult runLocation(const BenchLocation &location, JobSystem &jobSystem,
+		SoftwareRenderer &renderer)
+	{
+		LocationResult result;
+		result.name = location.name;
+		result.kind = location.kind;
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		location.parse();
+		result.parseSeconds = secondsSince(startTime);
+
+		location.warmCaches();
+
+		startTime = std::chrono::high_resolution_clock::now();
+		const WorldData worldData = location.load();
+		result.loadSeconds = secondsSince(startTime);
+
+		// A new texture manager each time, so no textures are left from the last location.
+		auto textureManager = std::make_unique<TextureManager>();
+		textureManager->init(jobSystem);
+
+		startTime = std::chrono::high_resolution_clock::now();
+		loadVoxelTextures(worldData.getActiveLevel(), *textureManager, renderer);
+		result.textureSeconds = secondsSince(startTime);
+
+		return result;
+	}
+
+	std::string toMilliseconds(double seconds)
+	{
+		return String::fixedPrecision(seconds * 1000.0, 3);
+	}
+
+	// Gets each phase's total over the results of the given kind, or all of them if the
+	// kind is empty.
+	LocationResult getTotals(const std::vector<LocationResult> &results,
+		const std::string &kind)
+	{
+		LocationResult totals;
+		totals.name = kind;
+		totals.kind = kind;
+		totals.parseSeconds = 0.0;
+		totals.loadSeconds = 0.0;
+		totals.textureSeconds = 0.0;
+
+		for (const LocationResult &result : results)
+		{
+			if ((kind.size() == 0) || (result.kind == kind))
+			{
+				totals.parseSeconds += result.parseSeconds;
+				totals.loadSeconds += result.loadSeconds;
+				totals.textureSeconds += result.textureSeconds;
+			}
+		}
+
+		return totals;
+	}
+
+	std::vector<std::string> getKinds(const std::vector<LocationResult> &results)
+	{
+		std::vector<std::string> kinds;
+		for (const LocationResult &result : results)
+		{
+			if (std::find(kinds.begin(), kinds.end(), result.kind) == kinds.end())
+			{
+				kinds.push_back(result.kind);
+			}
+		}
+
+		return kinds;
+	}
+
+	std::vector<LocationResult> getSlowest(const std::vector<LocationResult> &results)
+	{
+		std::vector<LocationResult> slowest = results;
+		std::sort(slowest.begin(), slowest.end(),
+			[](const LocationResult &a, const LocationResult &b)
+		{
+			return a.getTotalSeconds() > b.getTotalSeconds();
+		});
+
+		slowest.resize(std::min(static_cast<int>(slowest.size()), SlowestCount));
+		return slowest;
+	}
+
+	std::string makePhasesJSON(const LocationResult &result)
+	{
+		std::stringstream ss;
+		ss << "\"parseMs\": " << toMilliseconds(result.parseSeconds) <<
+			", \"loadMs\": " << toMilliseconds(result.loadSeconds) <<
+			", \"texturesMs\": " << toMilliseconds(result.textureSeconds) <<
+			", \"totalMs\": " << toMilliseconds(result.getTotalSeconds());
+		return ss.str();
+	}
+
+	std::string makeJSON(const std::vector<LocationResult> &results)
+	{
+		std::stringstream ss;
+		ss << "{\n";
+		ss << "  \"totals\": { \"count\": " << results.size() << ", " <<
+			makePhasesJSON(getTotals(results, std::string())) << " },\n";
+
+		const std::vector<std::string> kinds = getKinds(results);
+		ss << "  \"kinds\": [\n";
+		for (size_t i = 0; i < kinds.size(); i++)
+		{
+			const int count = static_cast<int>(std::count_if(results.begin(), results.end(),
+				[&kinds, i](const LocationResult &result) { return result.kind == kinds[i]; }));
+			ss << "    { \"kind\": \"" << kinds[i] << "\", \"count\": " << count << ", " <<
+				makePhasesJSON(getTotals(results, kinds[i])) << " }" <<
+				(((i + 1) < kinds.size()) ? "," : "") << "\n";
+		}
+
+		ss << "  ],\n";
+
+		auto writeLocations = [&ss](const std::string &key,
+			const std::vector<LocationResult> &locationResults, bool isLast)
+		{
+			ss << "  \"" << key << "\": [\n";
+			for (size_t i = 0; i < locationResults.size(); i++)
+			{
+				const LocationResult &result = locationResults[i];
+				ss << "    { \"name\": \"" << result.name << "\", \"kind\": \"" <<
+					result.kind << "\", " << makePhasesJSON(result) << " }" <<
+					(((i + 1) < locationResults.size()) ? "," : "") << "\n";
+			}
+
+			ss << "  ]" << (isLast ? "" : ",") << "\n";
+		};
+
+		writeLocations("slowest", getSlowest(results), false);
+		writeLocations("locations", results, true);
+		ss << "}\n";
+		return ss.str();
+	}
+
+	void printSummary(const std::vector<LocationResult> &results)
+	{
+		auto printPhases = [](const LocationResult &result)
+		{
+			std::cout << toMilliseconds(result.getTotalSeconds()) << " (parse " <<
+				toMilliseconds(result.parseSeconds) << ", load " <<
+				toMilliseconds(result.loadSeconds) << ", textures " <<
+				toMilliseconds(result.textureSeconds) << ")\n";
+		};
+
+		std::cout << results.size() << " locations (ms):\n";
+		for (const std::string &kind : getKinds(results))
+		{
+			std::cout << "  " << kind << ": ";
+			printPhases(getTotals(results, kind));
+		}
+
+		std::cout << "  total: ";
+		printPhases(getTotals(results, std::string()));
+
+		std::cout << "Slowest:\n";
+		for (const LocationResult &result : getSlowest(results))
+		{
+			std::cout << "  " << result.name << ": ";
+			printPhases(result);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const std::string arenaPath = (argc > 1) ? argv[1] : DefaultArenaPath;
+	const std::string jsonPath = (argc > 2) ? argv[2] : std::string();
+
+	DebugAssert(File::exists(arenaPath + "/GLOBAL.BSA"),
+		"\"" + arenaPath + "\" not a valid ARENA path.");
+
+	VFS::Manager::get().initialize(std::string(arenaPath));
+
+	JobSystem jobSystem(Platform::getThreadCount());
+
+	// The decoded asset cache isn't used, so the executable data is always decoded.
+	AssetCache assetCache;
+	assetCache.init(std::string());
+	MiscAssets miscAssets;
+	miscAssets.init(assetCache, jobSystem);
+
+	// Only its textures are used. Its frame size doesn't matter.
+	SoftwareRenderer renderer(320, 200, jobSystem);
+
+	std::vector<LocationResult> results;
+	for (const BenchLocation &location : makeLocations(miscAssets, jobSystem))
+	{
+		results.push_back(runLocation(location, jobSystem, renderer));
+	}
+
+	printSummary(results);
+
+	if (jsonPath.size() > 0)
+	{
+		std::ofstream jsonFile(jsonPath);
+		DebugAssert(jsonFile.is_open(), "Could not open \"" + jsonPath + "\".");
+		jsonFile << makeJSON(results);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,441 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "SDL.h"
+
+#include "../src/Assets/INFFile.h"
+#include "../src/Assets/MIFFile.h"
+#include "../src/Entities/Player.h"
+#include "../src/Math/Constants.h"
+#include "../src/Math/Vector2.h"
+#include "../src/Math/Vector3.h"
+#include "../src/Media/TextureManager.h"
+#include "../src/Rendering/SoftwareRenderer.h"
+#include "../src/Utilities/Debug.h"
+#include "../src/Utilities/File.h"
+#include "../src/Utilities/JobSystem.h"
+#include "../src/Utilities/Platform.h"
+#include "../src/Utilities/String.h"
+#include "../src/World/ClimateType.h"
+#include "../src/World/LevelData.h"
+#include "../src/World/WeatherType.h"
+#include "../src/World/WorldData.h"
+
+#include "components/vfs/manager.hpp"
+
+// Headless benchmark for the software renderer. It loads a fixed set of interiors and
+// exteriors, flies the same scripted camera path through each one into an offscreen
+// buffer, and reports frame times and the renderer's per-frame counters. Nothing is
+// random, so two runs on the same machine draw exactly the same frames.
+
+// Usage: arena_render_bench [ARENA path] [JSON output path] [reference frames path]
+// The summary is always printed, and the JSON file is only written when a path is given.
+// With a reference frames path, the last frame of each scene is written there if the file
+// doesn't exist yet, and compared against it otherwise. That way a build with different
+// precision options (i.e., TES_FLOAT_PIXEL_MATH) can be checked against a double build.
+
+namespace
+{
+	const std::string DefaultArenaPath = "data/ARENA";
+
+	const int FrameWidth = 1280;
+	const int FrameHeight = 720;
+	const int WarmupFrames = 10;
+	const int MeasuredFrames = 240;
+	const double VerticalFOV = 60.0;
+
+	// The camera circles its start point while turning all the way around, and bobs its
+	// pitch up and down, so every scene is seen from all directions.
+	const double PathRadius = 1.50;
+	const double PathPitch = 0.20;
+
+	// Same values the game uses for interiors and clear weather.
+	const double InteriorFogDistance = 25.0;
+	const double ExteriorFogDistance = 100.0;
+
+	struct BenchScene
+	{
+		std::string name;
+		std::function<WorldData()> load;
+		bool isInterior;
+	};
+
+	struct SceneResult
+	{
+		std::string name;
+		std::vector<double> frameSeconds;
+		SoftwareRenderer::RenderStats totalStats; // Summed over all measured frames.
+		std::vector<uint32_t> lastFrame; // Color buffer of the last measured frame.
+	};
+
+	std::vector<BenchScene> makeScenes()
+	{
+		auto makeInterior = [](const std::string &mifName)
+		{
+			BenchScene scene;
+			scene.name = mifName;
+			scene.load = [mifName]() { return WorldData::loadInterior(MIFFile(mifName)); };
+			scene.isInterior = true;
+			return scene;
+		};
+
+		BenchScene premadeCity;
+		premadeCity.name = "IMPERIAL.MIF";
+		premadeCity.load = []()
+		{
+			return WorldData::loadPremadeCity(MIFFile("IMPERIAL.MIF"),
+				ClimateType::Temperate, WeatherType::Clear);
+		};
+		premadeCity.isInterior = false;
+
+		BenchScene wilderness;
+		wilderness.name = "WILD.MIF";
+		wilderness.load = []()
+		{
+			return WorldData::loadWilderness(10, 20, 30, 40,
+				ClimateType::Temperate, WeatherType::Clear);
+		};
+		wilderness.isInterior = false;
+
+		return std::vector<BenchScene>
+		{
+			makeInterior("START.MIF"),
+			makeInterior("TAVERN1.MIF"),
+			makeInterior("PALACE1.MIF"),
+			premadeCity,
+			wilderness
+		};
+	}
+
+	// Loads the level's .INF voxel textures into the renderer, like WorldData does when a
+	// level becomes active in the game.
+	void loadVoxelTextures(const LevelData &level, TextureManager &textureManager,
+		SoftwareRenderer &renderer)
+	{
+		renderer.clearTextures();
+
+		const INFFile inf(level.getInfName());
+		const int voxelTextureCount = static_cast<int>(inf.getVoxelTextures().size());
+		for (int i = 0; i < voxelTextureCount; i++)
+		{
+			const auto &textureData = inf.getVoxelTextures().at(i);
+			const std::string textureName = String::toUppercase(textureData.filename);
+			const std::string extension = String::getExtension(textureName);
+
+			if (extension == ".SET")
+			{
+				const auto &surfaces = textureManager.getSurfaces(textureName);
+				const SDL_Surface *surface = surfaces.at(textureData.setIndex);
+				renderer.setVoxelTexture(i, static_cast<const uint32_t*>(surface->pixels));
+			}
+			else if (extension == ".IMG")
+			{
+				const SDL_Surface *surface = textureManager.getSurface(textureName);
+				renderer.setVoxelTexture(i, static_cast<const uint32_t*>(surface->pixels));
+			}
+		}
+	}
+
+	SceneResult runScene(const BenchScene &scene, TextureManager &textureManager,
+		SoftwareRenderer &renderer, std::vector<uint32_t> &colorBuffer)
+	{
+		const WorldData worldData = scene.load();
+		const LevelData &level = worldData.getActiveLevel();
+		loadVoxelTextures(level, textureManager, renderer);
+
+		// Interiors have a single sky color, and exteriors use the daytime sky.
+		if (scene.isInterior)
+		{
+			const uint32_t skyColor = level.getInteriorSkyColor();
+			renderer.setSkyPalette(&skyColor, 1);
+			renderer.setFogDistance(InteriorFogDistance);
+		}
+		else
+		{
+			const SDL_Surface *palette = textureManager.getSurface("DAYTIME.COL");
+			renderer.setSkyPalette(static_cast<const uint32_t*>(palette->pixels),
+				palette->w * palette->h);
+			renderer.setFogDistance(ExteriorFogDistance);
+		}
+
+		// Start in the middle of the map when there are no start points (i.e., the wilderness).
+		const Double2 startPoint = (worldData.getStartPoints().size() > 0) ?
+			worldData.getStartPoints().front() : Double2(63.50, 63.50);
+		const double eyeHeight = 1.0 + Player::HEIGHT;
+		const double ambient = scene.isInterior ? 1.0 : 0.80;
+		const double daytimePercent = 0.50;
+
+		auto renderFrame = [&level, &renderer, &colorBuffer, &startPoint, eyeHeight, ambient,
+			daytimePercent](int frameIndex)
+		{
+			const double percent = static_cast<double>(frameIndex) /
+				static_cast<double>(MeasuredFrames);
+			const double angle = percent * (2.0 * Constants::Pi);
+
+			const Double3 eye(
+				startPoint.x + (std::cos(angle) * PathRadius),
+				eyeHeight,
+				startPoint.y + (std::sin(angle) * PathRadius));
+			const Double3 direction = Double3(
+				std::cos(angle + (Constants::Pi / 2.0)),
+				std::sin(angle * 2.0) * PathPitch,
+				std::sin(angle + (Constants::Pi / 2.0))).normalized();
+
+			const auto startTime = std::chrono::high_resolution_clock::now();
+			renderer.render(eye, direction, VerticalFOV, ambient, daytimePercent,
+				level.getCeilingHeight(), level.getVoxelGrid(), colorBuffer.data());
+			return std::chrono::duration<double>(
+				std::chrono::high_resolution_clock::now() - startTime).count();
+		};
+
+		// Let caches and the thread pool settle before measuring.
+		for (int i = 0; i < WarmupFrames; i++)
+		{
+			renderFrame(i);
+		}
+
+		SceneResult result;
+		result.name = scene.name;
+		result.frameSeconds.reserve(MeasuredFrames);
+
+		for (int i = 0; i < MeasuredFrames; i++)
+		{
+			result.frameSeconds.push_back(renderFrame(i));
+			result.totalStats.add(renderer.getRenderStats());
+		}
+
+		result.lastFrame = colorBuffer;
+		return result;
+	}
+
+	// Gets the name of the precision used by the renderer's per-pixel math in this build.
+	const char *getPixelMathName()
+	{
+#if defined(TES_FLOAT_PIXEL_MATH)
+		return "float";
+#else
+		return "double";
+#endif
+	}
+
+	// Writes each scene's last frame to the reference file if it doesn't exist, or
+	// compares them against it and prints how many pixels differ and by how much.
+	void compareReferenceFrames(const std::vector<SceneResult> &results,
+		const std::string &path)
+	{
+		if (!File::exists(path))
+		{
+			std::ofstream file(path, std::ios::binary);
+			DebugAssert(file.is_open(), "Could not open \"" + path + "\".");
+
+			for (const SceneResult &result : results)
+			{
+				file.write(reinterpret_cast<const char*>(result.lastFrame.data()),
+					result.lastFrame.size() * sizeof(uint32_t));
+			}
+
+			std::cout << "Wrote reference frames (" << getPixelMathName() <<
+				" pixel math) to \"" << path << "\".\n";
+			return;
+		}
+
+		std::ifstream file(path, std::ios::binary);
+		DebugAssert(file.is_open(), "Could not open \"" + path + "\".");
+
+		std::cout << "Compared against reference frames in \"" << path << "\":\n";
+
+		std::vector<uint32_t> referenceFrame(FrameWidth * FrameHeight);
+		for (const SceneResult &result : results)
+		{
+			file.read(reinterpret_cast<char*>(referenceFrame.data()),
+				referenceFrame.size() * sizeof(uint32_t));
+			DebugAssert(file.good(), "\"" + path + "\" has too few frames.");
+
+			int differentPixels = 0;
+			int maxChannelDiff = 0;
+			for (size_t i = 0; i < referenceFrame.size(); i++)
+			{
+				const uint32_t color = result.lastFrame[i];
+				const uint32_t reference = referenceFrame[i];
+				if (color != reference)
+				{
+					differentPixels++;
+
+					for (int shift = 0; shift < 24; shift += 8)
+					{
+						const int channel = static_cast<int>((color >> shift) & 0xFF);
+						const int referenceChannel = static_cast<int>((reference >> shift) & 0xFF);
+						maxChannelDiff = std::max(maxChannelDiff,
+							std::abs(channel - referenceChannel));
+					}
+				}
+			}
+
+			const double differentPercent = (static_cast<double>(differentPixels) * 100.0) /
+				static_cast<double>(referenceFrame.size());
+			std::cout << result.name << ": " << differentPixels << " pixels differ (" <<
+				String::fixedPrecision(differentPercent, 3) << "%), max channel difference " <<
+				maxChannelDiff << "\n";
+		}
+	}
+
+	// Gets the value at some percent through the sorted frame times.
+	double getPercentile(const std::vector<double> &sortedSeconds, double percent)
+	{
+		const int lastIndex = static_cast<int>(sortedSeconds.size()) - 1;
+		const int index = std::min(static_cast<int>(
+			percent * static_cast<double>(sortedSeconds.size())), lastIndex);
+		return sortedSeconds.at(index);
+	}
+
+	std::string makeJSON(const std::vector<SceneResult> &results)
+	{
+		auto toMilliseconds = [](double seconds)
+		{
+			return String::fixedPrecision(seconds * 1000.0, 4);
+		};
+
+		std::stringstream ss;
+		ss << "{\n";
+		ss << "  \"width\": " << FrameWidth << ",\n";
+		ss << "  \"height\": " << FrameHeight << ",\n";
+		ss << "  \"frames\": " << MeasuredFrames << ",\n";
+		ss << "  \"scenes\": [\n";
+
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const SceneResult &result = results[i];
+			const SoftwareRenderer::RenderStats &stats = result.totalStats;
+			const double frameCount = static_cast<double>(result.frameSeconds.size());
+
+			std::vector<double> sortedSeconds = result.frameSeconds;
+			std::sort(sortedSeconds.begin(), sortedSeconds.end());
+
+			double totalSeconds = 0.0;
+			for (const double seconds : sortedSeconds)
+			{
+				totalSeconds += seconds;
+			}
+
+			// Counters are averaged per frame.
+			auto perFrame = [frameCount](int count)
+			{
+				return String::fixedPrecision(static_cast<double>(count) / frameCount, 1);
+			};
+
+			ss << "    {\n";
+			ss << "      \"name\": \"" << result.name << "\",\n";
+			ss << "      \"minMs\": " << toMilliseconds(sortedSeconds.front()) << ",\n";
+			ss << "      \"medianMs\": " << toMilliseconds(getPercentile(sortedSeconds, 0.50)) << ",\n";
+			ss << "      \"p99Ms\": " << toMilliseconds(getPercentile(sortedSeconds, 0.99)) << ",\n";
+			ss << "      \"maxMs\": " << toMilliseconds(sortedSeconds.back()) << ",\n";
+			ss << "      \"meanMs\": " << toMilliseconds(totalSeconds / frameCount) << ",\n";
+			ss << "      \"phasesMs\": {\n";
+			ss << "        \"setup\": " << toMilliseconds(stats.setupSeconds / frameCount) << ",\n";
+			ss << "        \"voxels\": " << toMilliseconds(stats.voxelSeconds / frameCount) << ",\n";
+			ss << "        \"flats\": " << toMilliseconds(stats.flatSeconds / frameCount) << "\n";
+			ss << "      },\n";
+			ss << "      \"counters\": {\n";
+			ss << "        \"voxelSteps\": " << perFrame(stats.voxelSteps) << ",\n";
+			ss << "        \"voxelColumns\": " << perFrame(stats.voxelColumns) << ",\n";
+			ss << "        \"occludedColumns\": " << perFrame(stats.occludedColumns) << ",\n";
+			ss << "        \"wallPixels\": " << perFrame(stats.wallPixels) << ",\n";
+			ss << "        \"perspectivePixels\": " << perFrame(stats.perspectivePixels) << ",\n";
+			ss << "        \"transparentPixels\": " << perFrame(stats.transparentPixels) << ",\n";
+			ss << "        \"flatPixels\": " << perFrame(stats.flatPixels) << ",\n";
+			ss << "        \"flatFragments\": " << perFrame(stats.flatFragments) << ",\n";
+			ss << "        \"clearedPixels\": " << perFrame(stats.clearedPixels) << ",\n";
+			ss << "        \"depthRejects\": " << perFrame(stats.depthRejects) << ",\n";
+			ss << "        \"occludedFlatColumns\": " <<
+				perFrame(stats.occludedFlatColumns) << ",\n";
+			ss << "        \"visibleFlats\": " << perFrame(stats.visibleFlats) << ",\n";
+			ss << "        \"flatDraws\": " << perFrame(stats.flatDraws) << "\n";
+			ss << "      }\n";
+			ss << "    }" << (((i + 1) < results.size()) ? "," : "") << "\n";
+		}
+
+		ss << "  ]\n";
+		ss << "}\n";
+		return ss.str();
+	}
+
+	void printSummary(const std::vector<SceneResult> &results)
+	{
+		std::cout << "Frames of " << FrameWidth << "x" << FrameHeight << ", " <<
+			MeasuredFrames << " per scene, " << getPixelMathName() << " pixel math (ms):\n";
+
+		for (const SceneResult &result : results)
+		{
+			const SoftwareRenderer::RenderStats &stats = result.totalStats;
+			const double frameCount = static_cast<double>(result.frameSeconds.size());
+
+			std::vector<double> sortedSeconds = result.frameSeconds;
+			std::sort(sortedSeconds.begin(), sortedSeconds.end());
+
+			std::cout << result.name << ": min " <<
+				String::fixedPrecision(sortedSeconds.front() * 1000.0, 2) << ", median " <<
+				String::fixedPrecision(getPercentile(sortedSeconds, 0.50) * 1000.0, 2) <<
+				", p99 " <<
+				String::fixedPrecision(getPercentile(sortedSeconds, 0.99) * 1000.0, 2) <<
+				" (setup " << String::fixedPrecision(
+					(stats.setupSeconds / frameCount) * 1000.0, 2) <<
+				", voxels " << String::fixedPrecision(
+					(stats.voxelSeconds / frameCount) * 1000.0, 2) <<
+				", flats " << String::fixedPrecision(
+					(stats.flatSeconds / frameCount) * 1000.0, 2) << ")\n";
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const std::string arenaPath = (argc > 1) ? argv[1] : DefaultArenaPath;
+	const std::string jsonPath = (argc > 2) ? argv[2] : std::string();
+	const std::string referencePath = (argc > 3) ? argv[3] : std::string();
+
+	DebugAssert(File::exists(arenaPath + "/GLOBAL.BSA"),
+		"\"" + arenaPath + "\" not a valid ARENA path.");
+
+	VFS::Manager::get().initialize(std::string(arenaPath));
+
+	JobSystem jobSystem(Platform::getThreadCount());
+
+	TextureManager textureManager;
+	textureManager.init(jobSystem);
+
+	// Voxel counters and phase times are only kept when asked for.
+	SoftwareRenderer renderer(FrameWidth, FrameHeight, jobSystem);
+	renderer.setRenderStatsEnabled(true);
+	std::vector<uint32_t> colorBuffer(FrameWidth * FrameHeight);
+
+	std::vector<SceneResult> results;
+	for (const BenchScene &scene : makeScenes())
+	{
+		results.push_back(runScene(scene, textureManager, renderer, colorBuffer));
+	}
+
+	printSummary(results);
+
+	if (jsonPath.size() > 0)
+	{
+		std::ofstream jsonFile(jsonPath);
+		DebugAssert(jsonFile.is_open(), "Could not open \"" + jsonPath + "\".");
+		jsonFile << makeJSON(results);
+	}
+
+	if (referencePath.size() > 0)
+	{
+		compareReferenceFrames(results, referencePath);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#include "AssetCache.h"
+#include "../Utilities/Bytes.h"
+#include "../Utilities/Debug.h"
+
+#include "components/archives/mappedfile.hpp"
+
+namespace
+{
+	// Each entry file has a header followed by the decoded data. Increment the version
+	// whenever what gets cached changes, so old entries aren't used.
+	const char HeaderTag[8] = { 'O', 'T', 'A', 'C', 'A', 'C', 'H', 'E' };
+	const uint32_t CacheVersion = 1;
+	const size_t HeaderSize = 32;
+
+	const std::string EntryExtension = ".cache";
+
+	uint64_t getLE64(const uint8_t *buf)
+	{
+		return static_cast<uint64_t>(Bytes::getLE32(buf)) |
+			(static_cast<uint64_t>(Bytes::getLE32(buf + 4)) << 32);
+	}
+
+	void setLE64(uint8_t *buf, uint64_t value)
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			buf[i] = static_cast<uint8_t>(value >> (i * 8));
+		}
+	}
+}
+
+std::string AssetCache::getEntryPath(const std::string &name) const
+{
+	return this->path + name + EntryExtension;
+}
+
+uint64_t AssetCache::hash(const uint8_t *data, size_t size)
+{
+	return Bytes::hash(data, size);
+}
+
+bool AssetCache::isEnabled() const
+{
+	return this->path.size() > 0;
+}
+
+VFS::DataView AssetCache::read(const std::string &name, uint64_t sourceHash) const
+{
+	if (!this->isEnabled())
+	{
+		return VFS::DataView();
+	}
+
+	auto file = std::make_shared<Archives::MappedFile>();
+	if (!file->open(this->getEntryPath(name)) || (file->size() < HeaderSize))
+	{
+		return VFS::DataView();
+	}
+
+	const uint8_t *header = file->data();
+	const uint32_t version = Bytes::getLE32(header + 8);
+	const uint64_t entryHash = getLE64(header + 16);
+	const uint64_t dataSize = getLE64(header + 24);
+
+	const bool valid = (std::memcmp(header, HeaderTag, sizeof(HeaderTag)) == 0) &&
+		(version == CacheVersion) && (entryHash == sourceHash) &&
+		(dataSize == (file->size() - HeaderSize));
+
+	if (!valid)
+	{
+		DebugMention("Cached \"" + name + "\" is out of date.");
+		return VFS::DataView();
+	}
+
+	const uint8_t *data = header + HeaderSize;
+	return VFS::DataView(data, static_cast<size_t>(dataSize), std::move(file));
+}
+
+void AssetCache::write(const std::string &name, uint64_t sourceHash, const uint8_t *data,
+	size_t size) const
+{
+	if (!this->isEnabled())
+	{
+		return;
+	}
+
+	std::array<uint8_t, HeaderSize> header;
+	header.fill(0);
+	std::memcpy(header.data(), HeaderTag, sizeof(HeaderTag));
+	header[8] = static_cast<uint8_t>(CacheVersion);
+	header[9] = static_cast<uint8_t>(CacheVersion >> 8);
+	header[10] = static_cast<uint8_t>(CacheVersion >> 16);
+	header[11] = static_cast<uint8_t>(CacheVersion >> 24);
+	setLE64(header.data() + 16, sourceHash);
+	setLE64(header.data() + 24, static_cast<uint64_t>(size));
+
+	// Write to a temporary file first so a partly written entry is never read.
+	const std::string entryPath = this->getEntryPath(name);
+	const std::string tempPath = entryPath + ".tmp";
+
+	{
+		std::ofstream ofs(tempPath, std::ios::binary | std::ios::trunc);
+		ofs.write(reinterpret_cast<const char*>(header.data()), header.size());
+		ofs.write(reinterpret_cast<const char*>(data), size);
+
+		if (!ofs.good())
+		{
+			DebugWarning("Could not write \"" + tempPath + "\".");
+			ofs.close();
+			std::remove(tempPath.c_str());
+			return;
+		}
+	}
+
+	// Windows can't rename over an existing file.
+	std::remove(entryPath.c_str());
+	if (std::rename(tempPath.c_str(), entryPath.c_str()) != 0)
+	{
+		DebugWarning("Could not move \"" + tempPath + "\" to \"" + entryPath + "\".");
+		std::remove(tempPath.c_str());
+	}
+}
+
+void AssetCache::init(const std::string &path)
+{
+	this->path = path;
+}
@@ -0,0 +1,42 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "components/vfs/manager.hpp"
+
+// Decoded asset data kept in files in the user's cache folder, so startup doesn't have
+// to decode the same things every time. Each entry has a hash of the data it was decoded
+// from and is only used while that still matches, so changing the Arena files makes the
+// entry be decoded and written again. Entries are memory-mapped when read.
+
+class AssetCache
+{
+private:
+	std::string path; // Cache folder, or empty if the cache is disabled.
+
+	// Gets the path of the file for the given entry.
+	std::string getEntryPath(const std::string &name) const;
+public:
+	// Gets the hash of the data an entry is decoded from.
+	static uint64_t hash(const uint8_t *data, size_t size);
+
+	// Whether entries are read and written.
+	bool isEnabled() const;
+
+	// Gets the entry's data if it exists and was decoded from data with the given hash.
+	// Otherwise, isOpen() on the view is false.
+	VFS::DataView read(const std::string &name, uint64_t sourceHash) const;
+
+	// Writes an entry, replacing any old one with the same name. If it can't be written,
+	// the data is just decoded again next time.
+	void write(const std::string &name, uint64_t sourceHash, const uint8_t *data,
+		size_t size) const;
+
+	// An empty path disables the cache.
+	void init(const std::string &path);
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include <array>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "AssetName.h"
+
+#include "components/archives/archive.hpp"
+
+size_t AssetName::Hash::operator()(const AssetName &name) const
+{
+	return std::hash<const Entry*>()(name.entry);
+}
+
+AssetName::Extension AssetName::parseExtension(StringView name)
+{
+	size_t dotPos = StringView::NPOS;
+	for (size_t i = 0; i < name.size(); i++)
+	{
+		if (name[i] == '.')
+		{
+			dotPos = i;
+		}
+	}
+
+	if (dotPos == StringView::NPOS)
+	{
+		return Extension::None;
+	}
+
+	const StringView extension = name.substr(dotPos + 1);
+	const std::array<std::pair<const char*, Extension>, 14> extensions =
+	{
+		{
+			{ "CEL", Extension::CEL }, { "CFA", Extension::CFA }, { "CIF", Extension::CIF },
+			{ "COL", Extension::COL }, { "DFA", Extension::DFA }, { "FLC", Extension::FLC },
+			{ "IMG", Extension::IMG }, { "INF", Extension::INF }, { "MIF", Extension::MIF },
+			{ "MNU", Extension::MNU }, { "RCI", Extension::RCI }, { "SET", Extension::SET },
+			{ "VOC", Extension::VOC }, { "XMI", Extension::XMI }
+		}
+	};
+
+	for (const auto &pair : extensions)
+	{
+		if (Archives::foldedEquals(extension.data(), extension.size(), pair.first, 3))
+		{
+			return pair.second;
+		}
+	}
+
+	return Extension::Other;
+}
+
+const AssetName::Entry *AssetName::intern(StringView name)
+{
+	// Entries in a deque keep their address as more are added.
+	static std::deque<Entry> entries;
+	static std::unordered_multimap<uint64_t, const Entry*> entriesByHash;
+	static std::mutex mutex;
+
+	const uint64_t hash = Archives::foldedHash(name.data(), name.size());
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto range = entriesByHash.equal_range(hash);
+	for (auto iter = range.first; iter != range.second; ++iter)
+	{
+		const std::string &entryName = iter->second->name;
+		if (Archives::foldedEquals(name.data(), name.size(), entryName.data(),
+			entryName.size()))
+		{
+			return iter->second;
+		}
+	}
+
+	entries.push_back(Entry { name.toString(), AssetName::parseExtension(name) });
+	const Entry *entry = &entries.back();
+	entriesByHash.emplace(hash, entry);
+	return entry;
+}
+
+AssetName::AssetName(StringView name)
+{
+	this->entry = AssetName::intern(name);
+}
+
+AssetName::AssetName()
+	: AssetName(StringView()) { }
+
+const std::string &AssetName::getString() const
+{
+	return this->entry->name;
+}
+
+AssetName::Extension AssetName::getExtension() const
+{
+	return this->entry->extension;
+}
+
+bool AssetName::empty() const
+{
+	return this->entry->name.empty();
+}
+
+bool AssetName::operator==(const AssetName &other) const
+{
+	return this->entry == other.entry;
+}
+
+bool AssetName::operator!=(const AssetName &other) const
+{
+	return this->entry != other.entry;
+}
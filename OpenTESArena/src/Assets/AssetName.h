@@ -0,0 +1,65 @@
+#ifndef ASSET_NAME_H
+#define ASSET_NAME_H
+
+#include <cstddef>
+#include <string>
+
+#include "../Utilities/StringView.h"
+
+// Name of an asset file (i.e., "PAL.COL") that ignores case, interned in a global table so
+// a name is only a pointer to its entry. Making a name that's been seen before hashes its
+// characters as they are and compares them in place, so it doesn't allocate. Caches keyed
+// by these don't need uppercase copies of every name they're given, and extension checks
+// are enum comparisons.
+
+// Entries are never freed, since Arena only has so many files. Names can be made from any
+// thread.
+
+class AssetName
+{
+public:
+	// File extensions that asset loaders tell apart.
+	enum class Extension
+	{
+		None, // No '.' in the name.
+		CEL, CFA, CIF, COL, DFA, FLC, IMG, INF, MIF, MNU, RCI, SET, VOC, XMI,
+		Other
+	};
+
+	struct Hash
+	{
+		size_t operator()(const AssetName &name) const;
+	};
+private:
+	struct Entry
+	{
+		std::string name; // As first given.
+		Extension extension;
+	};
+
+	const Entry *entry;
+
+	// Gets a name's extension, ignoring case.
+	static Extension parseExtension(StringView name);
+
+	// Gets the table's entry for a name, adding it the first time.
+	static const Entry *intern(StringView name);
+public:
+	// Gets the interned name for the characters, adding it the first time.
+	explicit AssetName(StringView name);
+
+	// The empty name.
+	AssetName();
+
+	// Gets the name as it was first given, in whatever case that was.
+	const std::string &getString() const;
+
+	Extension getExtension() const;
+
+	bool empty() const;
+
+	bool operator==(const AssetName &other) const;
+	bool operator!=(const AssetName &other) const;
+};
+
+#endif
@@ -3,20 +3,45 @@
 
 #include "CFAFile.h"
 #include "Compression.h"
+#include "../Media/PaletteTable.h"
 #include "../Utilities/Bytes.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/JobSystem.h"
+#include "../Utilities/Profiler.h"
 
 #include "components/vfs/manager.hpp"
 
+CFAFile::CFAFile(const std::string &filename)
+{
+	this->init(filename, nullptr);
+}
+
+CFAFile::CFAFile(const std::string &filename, JobSystem &jobSystem)
+{
+	this->init(filename, &jobSystem);
+}
+
 CFAFile::CFAFile(const std::string &filename, const Palette &palette)
+	: CFAFile(filename)
+{
+	// Create 32-bit images using each frame's palette indices.
+	const int pixelCount = this->width * this->height;
+	const PaletteTable paletteTable(palette);
+	for (const auto &frame : this->rawPixels)
+	{
+		this->pixels.push_back(std::make_unique<uint32_t[]>(pixelCount));
+		uint32_t *pixels = this->pixels.back().get();
+
+		paletteTable.expand(frame.get(), pixelCount, pixels);
+	}
+}
+
+void CFAFile::init(const std::string &filename, JobSystem *jobSystem)
 {
-	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
-	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
+	ProfileScope("CFAFile::init");
 
-	stream->seekg(0, std::ios::end);
-	std::vector<uint8_t> srcData(stream->tellg());
-	stream->seekg(0, std::ios::beg);
-	stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+	const VFS::DataView srcData = VFS::Manager::get().openView(filename);
+	DebugAssert(srcData.isOpen(), "Could not open \"" + filename + "\".");
 
 	// Read CFA header. Fortunately, all CFAs have headers, unlike IMGs and CIFs.
 	const uint16_t widthUncompressed = Bytes::getLE16(srcData.data());
@@ -34,14 +59,6 @@ CFAFile::CFAFile(const std::string &filename, const Palette &palette)
 	// are converted into useful palette indices.
 	const uint8_t *lookUpTable = srcData.data() + 76;
 
-	// Line buffer (generously over-allocated for demuxing).
-	std::vector<uint8_t> encoded(widthUncompressed + 16);
-	std::fill(encoded.begin(), encoded.end(), 0);
-
-	// Index values from demuxing are stored here each pass, and are
-	// eventually translated into color indices.
-	std::array<uint8_t, 8> translate;
-
 	// Worse-case buffer for decompressed data (due to possible padding
 	// with demux alignment).
 	std::vector<uint8_t> decomp(widthCompressed * height * frameCount *
@@ -51,20 +68,31 @@ CFAFile::CFAFile(const std::string &filename, const Palette &palette)
 	Compression::decodeRLE(srcData.data() + headerSize, 
 		widthCompressed * height * frameCount, decomp);
 
-	// Temporary buffers for frame palette indices.
-	std::vector<std::vector<uint8_t>> frames;
-
-	// Byte offset into bit-packed data. All frames are packed together,
-	// so this value can simply be incremented by the compressed width.
-	uint32_t offset = 0;
 
+	// The RLE data runs across frames, so it's decoded in one go above, but each frame's
+	// bit-packed lines only depend on themselves and can be demuxed separately.
 	for (uint32_t frameNum = 0; frameNum < frameCount; frameNum++)
 	{
-		// Allocate a new output frame.
-		frames.push_back(std::vector<uint8_t>(widthUncompressed * height));
+		this->rawPixels.push_back(std::make_unique<uint8_t[]>(widthUncompressed * height));
+	}
+
+	auto demuxFrame = [this, &decomp, lookUpTable, widthUncompressed, widthCompressed,
+		height, bitsPerPixel](int frameNum)
+	{
+		// Line buffer (generously over-allocated for demuxing).
+		std::vector<uint8_t> encoded(widthUncompressed + 16);
+		std::fill(encoded.begin(), encoded.end(), 0);
+
+		// Index values from demuxing are stored here each pass, and are
+		// eventually translated into color indices.
+		std::array<uint8_t, 8> translate;
+
+		// Byte offset into bit-packed data. All frames are packed together,
+		// so this value can simply be incremented by the compressed width.
+		uint32_t offset = frameNum * widthCompressed * height;
 
 		// Destination buffer for the frame's decompressed palette indices.
-		std::vector<uint8_t> &dst = frames.back();
+		uint8_t *dst = this->rawPixels[frameNum].get();
 		uint32_t dstOffset = 0;
 
 		for (uint32_t y = 0; y < height; y++)
@@ -76,7 +104,7 @@ CFAFile::CFAFile(const std::string &filename, const Palette &palette)
 			std::copy(decompPtr, decompPtr + widthCompressed, encoded.begin());
 
 			// Lambda for which demux routine to do, based on bits per pixel.
-			auto runDemux = [&dst, dstOffset, &count, &encoded, &translate, lookUpTable](
+			auto runDemux = [dst, dstOffset, &count, &encoded, &translate, lookUpTable](
 				uint32_t end, void(*demux)(const uint8_t*, uint8_t*),
 				uint32_t demuxMultiplier, uint32_t upToMin)
 			{
@@ -89,7 +117,7 @@ CFAFile::CFAFile(const std::string &filename, const Palette &palette)
 
 					for (uint32_t i = 0; i < upTo; i++)
 					{
-						dst.at((x * upToMin) + i + dstOffset) = lookUpTable[translate.at(i)];
+						dst[(x * upToMin) + i + dstOffset] = lookUpTable[translate.at(i)];
 					}
 				}
 			};
@@ -100,7 +128,7 @@ CFAFile::CFAFile(const std::string &filename, const Palette &palette)
 				// No demuxing needed.
 				for (uint32_t x = 0; x < widthCompressed; x++)
 				{
-					dst.at(x + dstOffset) = encoded.at(x);
+					dst[x + dstOffset] = encoded.at(x);
 				}
 			}
 			else if (bitsPerPixel == 7)
@@ -136,30 +164,29 @@ CFAFile::CFAFile(const std::string &filename, const Palette &palette)
 			offset += widthCompressed;
 			dstOffset += widthUncompressed;
 		}
+	};
+
+	if ((jobSystem != nullptr) && (frameCount > 1))
+	{
+		jobSystem->parallelFor(frameCount, demuxFrame);
+	}
+	else
+	{
+		for (int frameNum = 0; frameNum < frameCount; frameNum++)
+		{
+			demuxFrame(frameNum);
+		}
 	}
 
 	this->width = widthUncompressed;
 	this->height = height;
 	this->xOffset = xOffset;
 	this->yOffset = yOffset;
-
-	// Finally, create 32-bit images using each frame's palette indices.
-	for (const auto &frame : frames)
-	{
-		this->pixels.push_back(std::make_unique<uint32_t[]>(this->width * this->height));
-		uint32_t *pixels = this->pixels.back().get();
-
-		std::transform(frame.begin(), frame.begin() + frame.size(), pixels,
-			[&palette](uint8_t col) -> uint32_t
-		{
-			return palette.get()[col].toARGB();
-		});
-	}
 }
 
 int CFAFile::getImageCount() const
 {
-	return static_cast<int>(this->pixels.size());
+	return static_cast<int>(this->rawPixels.size());
 }
 
 int CFAFile::getWidth() const
@@ -182,6 +209,11 @@ int CFAFile::getYOffset() const
 	return this->yOffset;
 }
 
+uint8_t *CFAFile::getRawPixels(int index) const
+{
+	return this->rawPixels.at(index).get();
+}
+
 uint32_t *CFAFile::getPixels(int index) const
 {
 	return this->pixels.at(index).get();
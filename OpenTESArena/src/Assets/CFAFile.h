@@ -10,10 +10,13 @@
 
 // A CFA file is for creatures and spell animations.
 
+class JobSystem;
+
 class CFAFile
 {
 private:
-	std::vector<std::unique_ptr<uint32_t[]>> pixels;
+	std::vector<std::unique_ptr<uint8_t[]>> rawPixels;
+	std::vector<std::unique_ptr<uint32_t[]>> pixels; // Empty if no palette was given.
 	int width, height, xOffset, yOffset;
 
 	// CFA files have their palette indices compressed into fewer bits depending
@@ -26,7 +29,14 @@ private:
 	static void demux5(const uint8_t *src, uint8_t *dst);
 	static void demux6(const uint8_t *src, uint8_t *dst);
 	static void demux7(const uint8_t *src, uint8_t *dst);
+
+	// Reads the frames, demuxing them on the job system if it's given.
+	void init(const std::string &filename, JobSystem *jobSystem);
 public:
+	// Loads a CFA from file. Without a palette, only the palette indices are kept. With a
+	// job system, frames are demuxed in parallel.
+	CFAFile(const std::string &filename);
+	CFAFile(const std::string &filename, JobSystem &jobSystem);
 	CFAFile(const std::string &filename, const Palette &palette);
 
 	// Gets the number of images in the CFA file.
@@ -44,6 +54,9 @@ public:
 	// Gets the Y offset of all images in the CFA file.
 	int getYOffset() const;
 
+	// Gets a pointer to the raw (unconverted) pixels for an image in the CFA file.
+	uint8_t *getRawPixels(int index) const;
+
 	// Gets a pointer to the pixels for an image in the CFA file.
 	uint32_t *getPixels(int index) const;
 };
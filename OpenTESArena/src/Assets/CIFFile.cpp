@@ -3,8 +3,11 @@
 
 #include "CIFFile.h"
 #include "Compression.h"
+#include "../Media/PaletteTable.h"
 #include "../Utilities/Bytes.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/JobSystem.h"
+#include "../Utilities/Profiler.h"
 
 #include "components/vfs/manager.hpp"
 
@@ -23,15 +26,22 @@ namespace
 	};
 }
 
-CIFFile::CIFFile(const std::string &filename, const Palette &palette)
+CIFFile::CIFFile(const std::string &filename)
 {
-	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
-	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
+	this->init(filename, nullptr);
+}
 
-	stream->seekg(0, std::ios::end);
-	std::vector<uint8_t> srcData(stream->tellg());
-	stream->seekg(0, std::ios::beg);
-	stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+CIFFile::CIFFile(const std::string &filename, JobSystem &jobSystem)
+{
+	this->init(filename, &jobSystem);
+}
+
+void CIFFile::init(const std::string &filename, JobSystem *jobSystem)
+{
+	ProfileScope("CIFFile::init");
+
+	const VFS::DataView srcData = VFS::Manager::get().openView(filename);
+	DebugAssert(srcData.isOpen(), "Could not open \"" + filename + "\".");
 
 	// X and Y offset might be useful for weapon positions on the screen.
 	uint16_t xoff, yoff, width, height, flags, len;
@@ -63,9 +73,12 @@ CIFFile::CIFFile(const std::string &filename, const Palette &palette)
 
 	const int headerSize = 12;
 
-	if ((flags & 0x00FF) == 0x0002)
-	{		
-		// Type 2 CIF.
+	const int compression = flags & 0x00FF;
+	if ((compression == 0x0002) || (compression == 0x0004) || (compression == 0x0008))
+	{
+		// Type 2 (RLE), 4, or 8 CIF. Each image is compressed on its own, so only finding
+		// where each one starts walks the file in order.
+		std::vector<int> imageOffsets;
 		int offset = 0;
 
 		while ((srcData.begin() + offset) < srcData.end())
@@ -75,106 +88,52 @@ CIFFile::CIFFile(const std::string &filename, const Palette &palette)
 			yoff = Bytes::getLE16(header + 2);
 			width = Bytes::getLE16(header + 4);
 			height = Bytes::getLE16(header + 6);
-			flags = Bytes::getLE16(header + 8);
 			len = Bytes::getLE16(header + 10);
 
-			std::vector<uint8_t> decomp(width * height);
-			Compression::decodeRLE(header + 12, width * height, decomp);
-
+			imageOffsets.push_back(offset);
 			this->rawPixels.push_back(std::make_unique<uint8_t[]>(width * height));
-			this->pixels.push_back(std::make_unique<uint32_t[]>(width * height));
 			this->offsets.push_back(Int2(xoff, yoff));
 			this->dimensions.push_back(Int2(width, height));
 
-			const uint8_t *imagePixels = decomp.data();
-			uint8_t *dstRawPixels = this->rawPixels.back().get();
-			uint32_t *dstPixels = this->pixels.back().get();
-
-			std::copy(imagePixels, imagePixels + (width * height), dstRawPixels);
-			std::transform(imagePixels, imagePixels + (width * height), dstPixels,
-				[&palette](uint8_t col) -> uint32_t
-			{
-				return palette.get()[col].toARGB();
-			});
-
 			offset += (headerSize + len);
 		}
-	}
-	else if ((flags & 0x00FF) == 0x0004)
-	{
-		// Type 4 CIF.
-		int offset = 0;
 
-		while ((srcData.begin() + offset) < srcData.end())
+		auto decodeImage = [this, &srcData, &imageOffsets, compression](int index)
 		{
-			const uint8_t *header = srcData.data() + offset;
-			xoff = Bytes::getLE16(header);
-			yoff = Bytes::getLE16(header + 2);
-			width = Bytes::getLE16(header + 4);
-			height = Bytes::getLE16(header + 6);
-			flags = Bytes::getLE16(header + 8);
-			len = Bytes::getLE16(header + 10);
+			const uint8_t *header = srcData.data() + imageOffsets[index];
+			const uint16_t len = Bytes::getLE16(header + 10);
+			const Int2 &dims = this->dimensions[index];
 
-			std::vector<uint8_t> decomp(width * height);
-			Compression::decodeType04(header + 12, header + 12 + len, decomp);
-
-			this->rawPixels.push_back(std::make_unique<uint8_t[]>(width * height));
-			this->pixels.push_back(std::make_unique<uint32_t[]>(width * height));
-			this->offsets.push_back(Int2(xoff, yoff));
-			this->dimensions.push_back(Int2(width, height));
-
-			const uint8_t *imagePixels = decomp.data();
-			uint8_t *dstRawPixels = this->rawPixels.back().get();
-			uint32_t *dstPixels = this->pixels.back().get();
-
-			std::copy(imagePixels, imagePixels + (width * height), dstRawPixels);
-			std::transform(imagePixels, imagePixels + (width * height), dstPixels,
-				[&palette](uint8_t col) -> uint32_t
+			std::vector<uint8_t> decomp(dims.x * dims.y);
+			if (compression == 0x0002)
+			{
+				Compression::decodeRLE(header + 12, dims.x * dims.y, decomp);
+			}
+			else if (compression == 0x0004)
 			{
-				return palette.get()[col].toARGB();
-			});
+				Compression::decodeType04(header + 12, header + 12 + len, decomp);
+			}
+			else
+			{
+				// Contains a 2 byte decompressed length after the header, so skip that 
+				// (should be equivalent to width * height).
+				Compression::decodeType08(header + 12 + 2, header + 12 + len, decomp);
+			}
 
-			offset += (headerSize + len);
-		}
-	}
-	else if ((flags & 0x00FF) == 0x0008)
-	{
-		// Type 8 CIF.
-		int offset = 0;
+			std::copy(decomp.begin(), decomp.end(), this->rawPixels[index].get());
+		};
 
-		while ((srcData.begin() + offset) < srcData.end())
+		const int imageCount = static_cast<int>(imageOffsets.size());
+		if ((jobSystem != nullptr) && (imageCount > 1))
 		{
-			const uint8_t *header = srcData.data() + offset;
-			xoff = Bytes::getLE16(header);
-			yoff = Bytes::getLE16(header + 2);
-			width = Bytes::getLE16(header + 4);
-			height = Bytes::getLE16(header + 6);
-			flags = Bytes::getLE16(header + 8);
-			len = Bytes::getLE16(header + 10);
-
-			std::vector<uint8_t> decomp(width * height);
-
-			// Contains a 2 byte decompressed length after the header, so skip that 
-			// (should be equivalent to width * height).
-			Compression::decodeType08(header + 12 + 2, header + 12 + len, decomp);
-
-			this->rawPixels.push_back(std::make_unique<uint8_t[]>(width * height));
-			this->pixels.push_back(std::make_unique<uint32_t[]>(width * height));
-			this->offsets.push_back(Int2(xoff, yoff));
-			this->dimensions.push_back(Int2(width, height));
-
-			const uint8_t *imagePixels = decomp.data();
-			uint8_t *dstRawPixels = this->rawPixels.back().get();
-			uint32_t *dstPixels = this->pixels.back().get();
-
-			std::copy(imagePixels, imagePixels + (width * height), dstRawPixels);
-			std::transform(imagePixels, imagePixels + (width * height), dstPixels,
-				[&palette](uint8_t col) -> uint32_t
+			jobSystem->parallelFor(imageCount, decodeImage);
+		}
+		else
+		{
+			for (int i = 0; i < imageCount; i++)
 			{
-				return palette.get()[col].toARGB();
-			});
-
-			offset += (headerSize + len);
+				decodeImage(i);
+			}
 		}
 	}
 	else if (isRaw)
@@ -185,20 +144,13 @@ CIFFile::CIFFile(const std::string &filename, const Palette &palette)
 		for (int i = 0; i < imageCount; i++)
 		{
 			this->rawPixels.push_back(std::make_unique<uint8_t[]>(width * height));
-			this->pixels.push_back(std::make_unique<uint32_t[]>(width * height));
 			this->offsets.push_back(Int2(xoff, yoff));
 			this->dimensions.push_back(Int2(width, height));
 
 			const uint8_t *imagePixels = srcData.data() + (i * len);
 			uint8_t *dstRawPixels = this->rawPixels.back().get();
-			uint32_t *dstPixels = this->pixels.back().get();
 
 			std::copy(imagePixels, imagePixels + len, dstRawPixels);
-			std::transform(imagePixels, imagePixels + len, dstPixels,
-				[&palette](uint8_t col) -> uint32_t
-			{
-				return palette.get()[col].toARGB();
-			});
 		}
 	}
 	else if ((flags & 0x00FF) == 0)
@@ -218,20 +170,13 @@ CIFFile::CIFFile(const std::string &filename, const Palette &palette)
 			len = Bytes::getLE16(header + 10);
 
 			this->rawPixels.push_back(std::make_unique<uint8_t[]>(width * height));
-			this->pixels.push_back(std::make_unique<uint32_t[]>(width * height));
 			this->offsets.push_back(Int2(xoff, yoff));
 			this->dimensions.push_back(Int2(width, height));
 
 			const uint8_t *imagePixels = header + headerSize;
 			uint8_t *dstRawPixels = this->rawPixels.back().get();
-			uint32_t *dstPixels = this->pixels.back().get();
 
 			std::copy(imagePixels, imagePixels + len, dstRawPixels);
-			std::transform(imagePixels, imagePixels + len, dstPixels,
-				[&palette](uint8_t col) -> uint32_t
-			{
-				return palette.get()[col].toARGB();
-			});
 
 			// Skip to the next image header.
 			offset += (headerSize + len);
@@ -243,9 +188,24 @@ CIFFile::CIFFile(const std::string &filename, const Palette &palette)
 	}
 }
 
+CIFFile::CIFFile(const std::string &filename, const Palette &palette)
+	: CIFFile(filename)
+{
+	// Create 32-bit images using each image's palette indices.
+	const PaletteTable paletteTable(palette);
+	for (size_t i = 0; i < this->rawPixels.size(); i++)
+	{
+		const Int2 &dims = this->dimensions[i];
+		const uint8_t *srcPixels = this->rawPixels[i].get();
+		this->pixels.push_back(std::make_unique<uint32_t[]>(dims.x * dims.y));
+
+		paletteTable.expand(srcPixels, dims.x * dims.y, this->pixels.back().get());
+	}
+}
+
 int CIFFile::getImageCount() const
 {
-	return static_cast<int>(this->pixels.size());
+	return static_cast<int>(this->rawPixels.size());
 }
 
 int CIFFile::getXOffset(int index) const
@@ -13,14 +13,23 @@
 // with it. Examples of CIF images are character faces, cursors, and weapon 
 // animations.
 
+class JobSystem;
+
 class CIFFile
 {
 private:
 	std::vector<std::unique_ptr<uint8_t[]>> rawPixels;
-	std::vector<std::unique_ptr<uint32_t[]>> pixels;
+	std::vector<std::unique_ptr<uint32_t[]>> pixels; // Empty if no palette was given.
 	std::vector<Int2> offsets;
 	std::vector<Int2> dimensions;
+
+	// Reads the images, decompressing them on the job system if it's given.
+	void init(const std::string &filename, JobSystem *jobSystem);
 public:
+	// Loads a CIF from file. Without a palette, only the palette indices are kept. With a
+	// job system, compressed images are decoded in parallel.
+	CIFFile(const std::string &filename);
+	CIFFile(const std::string &filename, JobSystem &jobSystem);
 	CIFFile(const std::string &filename, const Palette &palette);
 
 	// Gets the number of images in the CIF file.
@@ -4,12 +4,15 @@
 #include "COLFile.h"
 #include "../Utilities/Bytes.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/Profiler.h"
 #include "../Utilities/String.h"
 
 #include "components/vfs/manager.hpp"
 
 void COLFile::toPalette(const std::string &filename, Palette &dstPalette)
 {
+	ProfileScope("COLFile::toPalette");
+
 	bool failed = false;
 	std::array<uint8_t, 776> rawpal;
 	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
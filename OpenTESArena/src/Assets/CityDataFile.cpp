@@ -7,11 +7,32 @@
 #include "../Math/Random.h"
 #include "../Utilities/Bytes.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/Profiler.h"
 #include "../World/Location.h"
 #include "../World/LocationType.h"
 
 #include "components/vfs/manager.hpp"
 
+namespace
+{
+	// Dimensions of the screen-space cells that locations are bucketed into. The province
+	// map is 320x200, and locations are spread fairly evenly over it.
+	const int LocationCellSize = 32;
+	const int LocationCellsX = 10;
+	const int LocationCellsY = 7;
+	const int LocationCount = 48;
+
+	int getLocationCellX(int x)
+	{
+		return std::max(std::min(x / LocationCellSize, LocationCellsX - 1), 0);
+	}
+
+	int getLocationCellY(int y)
+	{
+		return std::max(std::min(y / LocationCellSize, LocationCellsY - 1), 0);
+	}
+}
+
 bool CityDataFile::ProvinceData::LocationData::isVisible() const
 {
 	return (this->visibility & 0x2) != 0;
@@ -67,6 +88,110 @@ const CityDataFile::ProvinceData::LocationData &CityDataFile::ProvinceData::getL
 	}
 }
 
+int CityDataFile::ProvinceData::getClosestVisibleLocationID(const Int2 &point) const
+{
+	DebugAssert(this->locationCellStarts.size() == ((LocationCellsX * LocationCellsY) + 1),
+		"Location cells not initialized.");
+
+	// Points outside the map start from the nearest edge cell.
+	const int startX = getLocationCellX(point.x);
+	const int startY = getLocationCellY(point.y);
+
+	int closestID = -1;
+	int closestDistSqr = 0;
+
+	// Search rings of cells around the point's cell. Every cell beyond ring N is at least
+	// N cells away from the point, so once the closest location is within that distance,
+	// no further rings can have a closer one.
+	const int maxRing = std::max(LocationCellsX, LocationCellsY);
+	for (int ring = 0; ring <= maxRing; ring++)
+	{
+		const int minX = std::max(startX - ring, 0);
+		const int maxX = std::min(startX + ring, LocationCellsX - 1);
+		const int minY = std::max(startY - ring, 0);
+		const int maxY = std::min(startY + ring, LocationCellsY - 1);
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			const bool edgeRow = (y == (startY - ring)) || (y == (startY + ring));
+			for (int x = minX; x <= maxX; x++)
+			{
+				// Only visit the cells on this ring's border; inner ones were already searched.
+				const bool edgeColumn = (x == (startX - ring)) || (x == (startX + ring));
+				if (!edgeRow && !edgeColumn)
+				{
+					continue;
+				}
+
+				const int cellIndex = x + (y * LocationCellsX);
+				const int begin = this->locationCellStarts[cellIndex];
+				const int end = this->locationCellStarts[cellIndex + 1];
+				for (int i = begin; i < end; i++)
+				{
+					const int locationID = this->locationCellIDs[i];
+					const auto &locationData = this->getLocationData(locationID);
+					if (!locationData.isVisible())
+					{
+						continue;
+					}
+
+					const int diffX = locationData.x - point.x;
+					const int diffY = locationData.y - point.y;
+					const int distSqr = (diffX * diffX) + (diffY * diffY);
+					const bool isCloser = (closestID < 0) || (distSqr < closestDistSqr) ||
+						((distSqr == closestDistSqr) && (locationID < closestID));
+
+					if (isCloser)
+					{
+						closestID = locationID;
+						closestDistSqr = distSqr;
+					}
+				}
+			}
+		}
+
+		const int ringDist = ring * LocationCellSize;
+		if ((closestID >= 0) && (closestDistSqr <= (ringDist * ringDist)))
+		{
+			break;
+		}
+	}
+
+	return closestID;
+}
+
+void CityDataFile::ProvinceData::initLocationCells()
+{
+	const int cellCount = LocationCellsX * LocationCellsY;
+	std::array<int, LocationCount> locationCells;
+	std::vector<int> cellSizes(cellCount, 0);
+	for (int i = 0; i < LocationCount; i++)
+	{
+		const auto &locationData = this->getLocationData(i);
+		const int cellIndex = getLocationCellX(locationData.x) +
+			(getLocationCellY(locationData.y) * LocationCellsX);
+		locationCells[i] = cellIndex;
+		cellSizes[cellIndex]++;
+	}
+
+	this->locationCellStarts = std::vector<int>(cellCount + 1, 0);
+	for (int i = 0; i < cellCount; i++)
+	{
+		this->locationCellStarts[i + 1] = this->locationCellStarts[i] + cellSizes[i];
+	}
+
+	// Fill in ascending ID order so each cell's IDs are sorted.
+	std::vector<int> cellOffsets(this->locationCellStarts.begin(),
+		this->locationCellStarts.end() - 1);
+	this->locationCellIDs = std::vector<int>(LocationCount);
+	for (int i = 0; i < LocationCount; i++)
+	{
+		const int cellIndex = locationCells[i];
+		this->locationCellIDs[cellOffsets[cellIndex]] = i;
+		cellOffsets[cellIndex]++;
+	}
+}
+
 const int CityDataFile::PROVINCE_COUNT = 9;
 
 CityDataFile::ProvinceData &CityDataFile::getProvinceData(int index)
@@ -233,9 +358,9 @@ int CityDataFile::getGlobalQuarter(const Int2 &globalPoint) const
 	return globalQuarter;
 }
 
-int CityDataFile::getTravelDays(int startLocationID, int startProvinceID, int endLocationID,
-	int endProvinceID, int month, const std::array<WeatherType, 36> &weathers,
-	ArenaRandom &random, const MiscAssets &miscAssets) const
+CityDataFile::TravelRoute CityDataFile::getTravelRoute(int startLocationID,
+	int startProvinceID, int endLocationID, int endProvinceID,
+	const MiscAssets &miscAssets) const
 {
 	auto getGlobalPoint = [this](int locationID, int provinceID)
 	{
@@ -252,42 +377,92 @@ int CityDataFile::getTravelDays(int startLocationID, int startProvinceID, int en
 	// Get all the points along the line between the two points.
 	const std::vector<Int2> points = Int2::bresenhamLine(startGlobalPoint, endGlobalPoint);
 
-	int totalTime = 0;
+	TravelRoute route;
+	const auto &worldMapTerrain = miscAssets.getWorldMapTerrain();
 	for (const Int2 &point : points)
 	{
-		const int monthIndex = (month + (totalTime / 3000)) % 12;
-		const int weatherIndex = [this, &weathers, &point]()
-		{
-			// Find which province quarter the global point is in.
-			const int quarterIndex = this->getGlobalQuarter(point);
-
-			// Convert the weather type to its equivalent index.
-			return static_cast<int>(weathers.at(quarterIndex));
-		}();
-
-		// The type of terrain at the world map point.
-		const auto &worldMapTerrain = miscAssets.getWorldMapTerrain();
+		// The type of terrain at the world map point, and which province quarter it's in.
 		const uint8_t terrainIndex = MiscAssets::WorldMapTerrain::getNormalizedIndex(
 			worldMapTerrain.getAt(point.x, point.y));
+		const uint8_t quarterIndex = static_cast<uint8_t>(this->getGlobalQuarter(point));
+
+		const bool continuesRun = !route.runs.empty() &&
+			(route.runs.back().terrainIndex == terrainIndex) &&
+			(route.runs.back().quarterIndex == quarterIndex);
 
-		// Calculate the travel speed based on climate and weather.
-		const auto &exeData = miscAssets.getExeData();
-		const auto &climateSpeedTables = exeData.locations.climateSpeedTables;
-		const auto &weatherSpeedTables = exeData.locations.weatherSpeedTables;
-		const int climateSpeed = climateSpeedTables.at(terrainIndex).at(monthIndex);
-		const int weatherMod = [terrainIndex, weatherIndex, &weatherSpeedTables]()
+		if (continuesRun)
+		{
+			route.runs.back().pixelCount++;
+		}
+		else
 		{
-			const int weatherSpeed = weatherSpeedTables.at(terrainIndex).at(weatherIndex);
+			TravelRoute::Run run;
+			run.terrainIndex = terrainIndex;
+			run.quarterIndex = quarterIndex;
+			run.pixelCount = 1;
+			route.runs.push_back(run);
+		}
+	}
 
-			// Special case: 0 equals 100.
-			return (weatherSpeed == 0) ? 100 : weatherSpeed;
-		}();
+	return route;
+}
 
-		const int travelSpeed = (climateSpeed * weatherMod) / 100;
+int CityDataFile::getTravelDays(const CityDataFile::TravelRoute &route, int month,
+	const std::array<WeatherType, 36> &weathers, ArenaRandom &random,
+	const MiscAssets &miscAssets)
+{
+	const auto &exeData = miscAssets.getExeData();
+	const auto &climateSpeedTables = exeData.getLocations().climateSpeedTables;
+	const auto &weatherSpeedTables = exeData.getLocations().weatherSpeedTables;
+
+	// Each month lasts 3000 units of travel time.
+	const int monthTime = 3000;
+
+	int totalTime = 0;
+	for (const TravelRoute::Run &run : route.runs)
+	{
+		const int terrainIndex = run.terrainIndex;
+
+		// Convert the weather type to its equivalent index.
+		const int weatherIndex = static_cast<int>(weathers.at(run.quarterIndex));
 
-		// Add the pixel's travel time onto the total time.
-		const int pixelTravelTime = 2000 / travelSpeed;
-		totalTime += pixelTravelTime;
+		// Every pixel in the run takes the same time until the month changes.
+		int pixelsLeft = run.pixelCount;
+		while (pixelsLeft > 0)
+		{
+			const int monthIndex = (month + (totalTime / monthTime)) % 12;
+
+			// Calculate the travel speed based on climate and weather.
+			const int climateSpeed = climateSpeedTables.at(terrainIndex).at(monthIndex);
+			const int weatherMod = [terrainIndex, weatherIndex, &weatherSpeedTables]()
+			{
+				const int weatherSpeed = weatherSpeedTables.at(terrainIndex).at(weatherIndex);
+
+				// Special case: 0 equals 100.
+				return (weatherSpeed == 0) ? 100 : weatherSpeed;
+			}();
+
+			const int travelSpeed = (climateSpeed * weatherMod) / 100;
+			const int pixelTravelTime = 2000 / travelSpeed;
+
+			// Number of pixels until the total time reaches the next month.
+			const int pixelCount = [totalTime, monthTime, pixelTravelTime, pixelsLeft]()
+			{
+				if (pixelTravelTime == 0)
+				{
+					return pixelsLeft;
+				}
+
+				const int timeLeftInMonth = monthTime - (totalTime % monthTime);
+				const int pixelsLeftInMonth =
+					(timeLeftInMonth + pixelTravelTime - 1) / pixelTravelTime;
+				return std::min(pixelsLeftInMonth, pixelsLeft);
+			}();
+
+			// Add the pixels' travel time onto the total time.
+			totalTime += pixelCount * pixelTravelTime;
+			pixelsLeft -= pixelCount;
+		}
 	}
 
 	// Calculate the actual travel days based on the total time.
@@ -308,6 +483,15 @@ int CityDataFile::getTravelDays(int startLocationID, int startProvinceID, int en
 	return travelDays;
 }
 
+int CityDataFile::getTravelDays(int startLocationID, int startProvinceID, int endLocationID,
+	int endProvinceID, int month, const std::array<WeatherType, 36> &weathers,
+	ArenaRandom &random, const MiscAssets &miscAssets) const
+{
+	const TravelRoute route = this->getTravelRoute(startLocationID, startProvinceID,
+		endLocationID, endProvinceID, miscAssets);
+	return CityDataFile::getTravelDays(route, month, weathers, random, miscAssets);
+}
+
 uint32_t CityDataFile::getCitySeed(int localCityID, int provinceID) const
 {
 	const auto &province = this->getProvinceData(provinceID);
@@ -351,13 +535,10 @@ uint32_t CityDataFile::getWildernessDungeonSeed(int provinceID,
 
 void CityDataFile::init(const std::string &filename)
 {
-	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
-	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
+	ProfileScope("CityDataFile::init");
 
-	stream->seekg(0, std::ios::end);
-	std::vector<uint8_t> srcData(stream->tellg());
-	stream->seekg(0, std::ios::beg);
-	stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+	const VFS::DataView srcData = VFS::Manager::get().openView(filename);
+	DebugAssert(srcData.isOpen(), "Could not open \"" + filename + "\".");
 
 	// Iterate over each province and initialize the location data.
 	for (size_t i = 0; i < this->provinces.size(); i++)
@@ -429,5 +610,7 @@ void CityDataFile::init(const std::string &filename)
 			// Read the random dungeon data.
 			initLocation(dungeon);
 		}
+
+		province.initLocationCells();
 	}
 }
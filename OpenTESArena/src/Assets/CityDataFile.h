@@ -4,6 +4,7 @@
 #include <array>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "../Math/Rect.h"
 #include "../Math/Vector2.h"
@@ -23,6 +24,20 @@ enum class WeatherType;
 class CityDataFile
 {
 public:
+	// The world map pixels between two locations, as runs of pixels with the same terrain
+	// and province quarter. Only the month and weather change between trips along it.
+	struct TravelRoute
+	{
+		struct Run
+		{
+			uint8_t terrainIndex; // Normalized, so sea = 0.
+			uint8_t quarterIndex; // Global province quarter, for weather.
+			uint16_t pixelCount;
+		};
+
+		std::vector<Run> runs;
+	};
+
 	// Each province contains 8 city-states, 8 towns, 16 villages, 2 main quest dungeons,
 	// and 14 spaces for random dungeons. The center province is an exception; it has just 1 
 	// city (all others are zeroed out).
@@ -47,11 +62,24 @@ public:
 		LocationData firstDungeon; // Staff map dungeon.
 		std::array<LocationData, 14> randomDungeons; // Random names, fixed locations.
 
+		// Location IDs bucketed by their position on screen, so the location closest to a
+		// point can be found without checking every location. Each cell's IDs start at its
+		// entry in the starts list, and end at the next one's.
+		std::vector<int> locationCellStarts, locationCellIDs;
+
 		// Creates a rectangle from the province's global {X,Y,W,H} values.
 		Rect getGlobalRect() const;
 
 		// Gets the location associated with the given location ID.
 		const CityDataFile::ProvinceData::LocationData &getLocationData(int locationID) const;
+
+		// Gets the ID of the visible location closest to the given point in 320x200 space,
+		// or -1 if no locations are visible. Ties go to the lower location ID.
+		int getClosestVisibleLocationID(const Int2 &point) const;
+
+		// Buckets all location IDs by screen position. Positions never change after loading,
+		// so this only needs doing once.
+		void initLocationCells();
 	};
 private:
 	// These are ordered the same as usual (read left to right, and center is last).
@@ -103,6 +131,15 @@ public:
 	// Gets the quarter within a province (to determine weather).
 	int getGlobalQuarter(const Int2 &globalPoint) const;
 
+	// Gets the route between two locations for calculating travel days.
+	CityDataFile::TravelRoute getTravelRoute(int startLocationID, int startProvinceID,
+		int endLocationID, int endProvinceID, const MiscAssets &miscAssets) const;
+
+	// Gets the number of days required to travel a route, starting in the given month.
+	static int getTravelDays(const CityDataFile::TravelRoute &route, int month,
+		const std::array<WeatherType, 36> &weathers, ArenaRandom &random,
+		const MiscAssets &miscAssets);
+
 	// Gets the number of days required to travel from one location to another.
 	int getTravelDays(int startLocationID, int startProvinceID, int endLocationID,
 		int endProvinceID, int month, const std::array<WeatherType, 36> &weathers,
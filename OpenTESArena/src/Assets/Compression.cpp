@@ -1,6 +1,150 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
 #include "Compression.h"
 #include "../Utilities/Bytes.h"
 
+namespace
+{
+	// Both LZ decoders have a 4 KB history that starts out filled with spaces. Everything
+	// written to the history is also written to the output, so the output itself is used
+	// as the history, and only positions from before the start of the output need the
+	// fill value.
+	const int HistorySize = 4096;
+	const uint8_t HistoryFill = 0x20;
+
+	// Copies a back-reference that starts the given distance behind the destination.
+	void copyBackReference(uint8_t *dst, const uint8_t *dstBegin, int distance, int count)
+	{
+		const uint8_t *copySrc = dst - distance;
+		if (copySrc >= dstBegin)
+		{
+			if (distance >= count)
+			{
+				// The source run ends before the destination starts.
+				std::memcpy(dst, copySrc, count);
+			}
+			else
+			{
+				// Overlapping runs repeat the bytes just written, so they're copied in order.
+				for (int i = 0; i < count; i++)
+				{
+					dst[i] = copySrc[i];
+				}
+			}
+		}
+		else
+		{
+			// Starts before the output, in the part of the history that was never written.
+			for (int i = 0; i < count; i++)
+			{
+				const uint8_t *pos = copySrc + i;
+				dst[i] = (pos >= dstBegin) ? *pos : HistoryFill;
+			}
+		}
+	}
+
+	// Reads bits most significant first. Past the end of the input, the bits are zero.
+	class BitReader
+	{
+	private:
+		const uint8_t *src, *srcEnd;
+		uint32_t buffer; // Unread bits, starting at the top.
+		int count;
+
+		void refill()
+		{
+			while (this->count <= 24)
+			{
+				const uint32_t byte = (this->src != this->srcEnd) ? *(this->src++) : 0;
+				this->buffer |= byte << (24 - this->count);
+				this->count += 8;
+			}
+		}
+	public:
+		BitReader(const uint8_t *src, const uint8_t *srcEnd)
+			: src(src), srcEnd(srcEnd)
+		{
+			this->buffer = 0;
+			this->count = 0;
+		}
+
+		int getBit()
+		{
+			if (this->count == 0)
+			{
+				this->refill();
+			}
+
+			const int bit = static_cast<int>(this->buffer >> 31);
+			this->buffer <<= 1;
+			this->count--;
+			return bit;
+		}
+
+		// Gets 1 to 24 bits at once.
+		int getBits(int bitCount)
+		{
+			assert((bitCount > 0) && (bitCount <= 24));
+
+			if (this->count < bitCount)
+			{
+				this->refill();
+			}
+
+			const int bits = static_cast<int>(this->buffer >> (32 - bitCount));
+			this->buffer <<= bitCount;
+			this->count -= bitCount;
+			return bits;
+		}
+	};
+
+	const std::array<uint8_t, 256> HighOffsetBits =
+	{
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+		0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+		0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+		0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+		0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09,
+		0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0B, 0x0B, 0x0B, 0x0B, 0x0B, 0x0B, 0x0B, 0x0B,
+		0x0C, 0x0C, 0x0C, 0x0C, 0x0D, 0x0D, 0x0D, 0x0D, 0x0E, 0x0E, 0x0E, 0x0E, 0x0F, 0x0F, 0x0F, 0x0F,
+		0x10, 0x10, 0x10, 0x10, 0x11, 0x11, 0x11, 0x11, 0x12, 0x12, 0x12, 0x12, 0x13, 0x13, 0x13, 0x13,
+		0x14, 0x14, 0x14, 0x14, 0x15, 0x15, 0x15, 0x15, 0x16, 0x16, 0x16, 0x16, 0x17, 0x17, 0x17, 0x17,
+		0x18, 0x18, 0x19, 0x19, 0x1A, 0x1A, 0x1B, 0x1B, 0x1C, 0x1C, 0x1D, 0x1D, 0x1E, 0x1E, 0x1F, 0x1F,
+		0x20, 0x20, 0x21, 0x21, 0x22, 0x22, 0x23, 0x23, 0x24, 0x24, 0x25, 0x25, 0x26, 0x26, 0x27, 0x27,
+		0x28, 0x28, 0x29, 0x29, 0x2A, 0x2A, 0x2B, 0x2B, 0x2C, 0x2C, 0x2D, 0x2D, 0x2E, 0x2E, 0x2F, 0x2F,
+		0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F
+	};
+
+	const std::array<uint8_t, 256> LowOffsetBitCount =
+	{
+		0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+		0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+		0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+		0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+		0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+		0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+		0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+		0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+		0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+		0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+		0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+		0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+		0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08
+	};
+}
+
 void Compression::decodeRLE(const uint8_t *src, int stopCount,
 	std::vector<uint8_t> &out)
 {
@@ -41,6 +185,94 @@ void Compression::decodeRLE(const uint8_t *src, int stopCount,
 	}
 }
 
+bool Compression::decodeRLE(const uint8_t *src, const uint8_t *srcEnd, int stopCount,
+	std::vector<uint8_t> &out)
+{
+	if (static_cast<int>(out.size()) < stopCount)
+	{
+		return false;
+	}
+
+	int o = 0;
+	while (o < stopCount)
+	{
+		if (src == srcEnd)
+		{
+			return false;
+		}
+
+		const uint8_t sample = *src;
+		src++;
+
+		// Repeat packets have one value, and literal packets have all of theirs.
+		const bool isRepeat = (sample & 0x80) != 0;
+		const int count = isRepeat ? (static_cast<int>(sample) - 0x7F) :
+			(static_cast<int>(sample) + 1);
+		const int srcCount = isRepeat ? 1 : count;
+		if (((srcEnd - src) < srcCount) || ((stopCount - o) < count))
+		{
+			return false;
+		}
+
+		if (isRepeat)
+		{
+			std::fill(out.begin() + o, out.begin() + o + count, *src);
+		}
+		else
+		{
+			std::copy(src, src + count, out.begin() + o);
+		}
+
+		src += srcCount;
+		o += count;
+	}
+
+	return true;
+}
+
+void Compression::encodeRLE(const uint8_t *src, int count, std::vector<uint8_t> &out)
+{
+	// Repeat packets hold 1 to 129 bytes, and literal packets 1 to 128.
+	const int maxRepeat = 129;
+	const int maxLiteral = 128;
+
+	int i = 0;
+	while (i < count)
+	{
+		// Length of the run of equal bytes starting here.
+		int runLength = 1;
+		while (((i + runLength) < count) && (src[i + runLength] == src[i]) &&
+			(runLength < maxRepeat))
+		{
+			runLength++;
+		}
+
+		if (runLength >= 3)
+		{
+			out.push_back(static_cast<uint8_t>(0x7F + runLength));
+			out.push_back(src[i]);
+			i += runLength;
+			continue;
+		}
+
+		// Copy bytes until the next run worth a repeat packet.
+		const int literalStart = i;
+		while ((i < count) && ((i - literalStart) < maxLiteral))
+		{
+			if (((i + 2) < count) && (src[i] == src[i + 1]) && (src[i] == src[i + 2]))
+			{
+				break;
+			}
+
+			i++;
+		}
+
+		const int literalLength = i - literalStart;
+		out.push_back(static_cast<uint8_t>(literalLength - 1));
+		out.insert(out.end(), src + literalStart, src + i);
+	}
+}
+
 void Compression::decodeRLEWords(const uint8_t *src, int stopCount, 
 	std::vector<uint8_t> &out)
 {
@@ -82,3 +314,211 @@ void Compression::decodeRLEWords(const uint8_t *src, int stopCount,
 		}
 	}
 }
+
+
+void Compression::decodeType04(const uint8_t *src, const uint8_t *srcEnd,
+	std::vector<uint8_t> &out)
+{
+	uint8_t *const dstBegin = out.data();
+	uint8_t *const dstEnd = dstBegin + out.size();
+	uint8_t *dst = dstBegin;
+
+	// This appears to be some form of LZ compression. It starts with a 1-byte-
+	// wide bitmask, where each bit declares if the next pixel comes directly
+	// from the input, or refers back to a previous run of output pixels that
+	// get duplicated. After each bit in the mask is used, another byte is read
+	// for another bitmask and the cycle repeats until the end of input.
+	while (src != srcEnd)
+	{
+		const int mask = *(src++);
+
+		// Eight literals in a row can be copied at once.
+		if ((mask == 0xFF) && ((srcEnd - src) >= 8) && ((dstEnd - dst) >= 8))
+		{
+			std::memcpy(dst, src, 8);
+			src += 8;
+			dst += 8;
+			continue;
+		}
+
+		// The first bit is used even if the mask was the last byte, so a truncated image
+		// is still an error.
+		for (int bit = 0; (bit == 0) || ((bit < 8) && (src != srcEnd)); bit++)
+		{
+			if (((mask >> bit) & 1) != 0)
+			{
+				if (src == srcEnd)
+				{
+					throw std::runtime_error("Unexpected end of image.");
+				}
+
+				if (dst == dstEnd)
+				{
+					throw std::runtime_error("Decoded image overflow.");
+				}
+
+				*(dst++) = *(src++);
+			}
+			else
+			{
+				if ((srcEnd - src) < 2)
+				{
+					throw std::runtime_error("Unexpected end of image.");
+				}
+
+				const uint8_t byte1 = *(src++);
+				const uint8_t byte2 = *(src++);
+				const int tocopy = (byte2 & 0x0F) + 3;
+				const int copypos = (((byte2 & 0xF0) << 4) | byte1) + 18;
+
+				if ((dstEnd - dst) < tocopy)
+				{
+					throw std::runtime_error("Decoded image overflow.");
+				}
+
+				// The copy position is absolute in the history, so it's turned into a
+				// distance back from the current position. Zero means the oldest byte.
+				const int historypos = static_cast<int>(dst - dstBegin);
+				int distance = (historypos - copypos) & (HistorySize - 1);
+				if (distance == 0)
+				{
+					distance = HistorySize;
+				}
+
+				copyBackReference(dst, dstBegin, distance, tocopy);
+				dst += tocopy;
+			}
+		}
+	}
+
+	std::fill(dst, dstEnd, 0);
+}
+
+void Compression::decodeType08(const uint8_t *src, const uint8_t *srcEnd,
+	std::vector<uint8_t> &out)
+{
+	Compression::decodeType08(src, srcEnd, out.data(), out.data() + out.size());
+}
+
+void Compression::decodeType08(const uint8_t *src, const uint8_t *srcEnd, uint8_t *dstBegin,
+	uint8_t *dstEnd)
+{
+	std::array<uint16_t, 941> NodeIdxMap;
+	std::iota(NodeIdxMap.begin(), NodeIdxMap.begin() + 626, 0);
+	std::for_each(NodeIdxMap.begin(), NodeIdxMap.begin() + 626,
+		[](uint16_t &val) { val = (val >> 1) + 314; }
+	);
+
+	NodeIdxMap[626] = 0;
+	std::iota(NodeIdxMap.begin() + 627, NodeIdxMap.end(), 0);
+
+	std::array<uint16_t, 627> NodeTree;
+	std::iota(NodeTree.begin(), NodeTree.begin() + 314, 627);
+	std::iota(NodeTree.begin() + 314, NodeTree.end(), 0);
+	std::for_each(NodeTree.begin() + 314, NodeTree.end(),
+		[](uint16_t &val) { val *= 2; }
+	);
+
+	// The last frequency is a sentinel that's never less than another, so searching
+	// through the frequencies doesn't need to check the end.
+	std::array<uint16_t, 628> NodeFreq;
+	std::fill(NodeFreq.begin(), NodeFreq.begin() + 314, 1);
+	{
+		auto iter = NodeFreq.begin();
+		std::for_each(NodeFreq.begin() + 314, NodeFreq.begin() + 627,
+			[&iter](uint16_t &val)
+		{
+			val = *(iter++);
+			val += *(iter++);
+		});
+	}
+
+	NodeFreq[627] = std::numeric_limits<uint16_t>::max();
+
+	BitReader bits(src, srcEnd);
+
+	// This feels like some form of adaptive Huffman coding, with a form of LZ
+	// compression. DEFLATE?
+	uint8_t *dst = dstBegin;
+	while (dst != dstEnd)
+	{
+		// Starting with the root, append bits from the input while traversing
+		// the tree until a leaf node is found (indicated by being >= 627).
+		uint16_t node = NodeTree[626];
+		while (node < 627)
+		{
+			assert((node + 1) < static_cast<int>(NodeTree.size()));
+			node = NodeTree[node + bits.getBit()];
+		}
+
+		// Increment the use count (frequency) of this node, and ensure the
+		// tree remains sorted.
+		uint16_t freqidx = NodeIdxMap[node];
+		do {
+			NodeFreq[freqidx] += 1;
+			uint16_t freq = NodeFreq[freqidx];
+			uint16_t nextidx = freqidx + 1;
+			if (NodeFreq[nextidx] < freq)
+			{
+				// Find the next frequency count that's not greater than the new frequency.
+				do {
+					nextidx++;
+				} while (NodeFreq[nextidx] < freq);
+				nextidx--;
+
+				// Swap 'em, placing the new frequency just before the next
+				// greater one. Since the freq only incremented by 1, this
+				// won't put it out of order.
+				NodeFreq[freqidx] = NodeFreq[nextidx];
+				NodeFreq[nextidx] = freq;
+
+				std::iter_swap(NodeTree.begin() + freqidx, NodeTree.begin() + nextidx);
+
+				// Update the index mappings
+				uint16_t mapidx = NodeTree[nextidx];
+				NodeIdxMap[mapidx] = nextidx;
+				if (mapidx < 627)
+				{
+					NodeIdxMap[mapidx + 1] = nextidx;
+				}
+
+				mapidx = NodeTree[freqidx];
+				NodeIdxMap[mapidx] = freqidx;
+				if (mapidx < 627)
+				{
+					NodeIdxMap[mapidx + 1] = freqidx;
+				}
+
+				freqidx = nextidx;
+			}
+			// Recurse up the tree
+			freqidx = NodeIdxMap[freqidx];
+		} while (freqidx != 0);
+
+		// Get the value from the node. If it's less than 256, it's a direct pixel value.
+		uint16_t codeword = node - 627;
+		if (codeword < 256)
+		{
+			*(dst++) = static_cast<uint8_t>(codeword);
+		}
+		else
+		{
+			// Otherwise, get the next 8 bits from input to construct the
+			// offset to previous pixels to repeat, with the count being
+			// derived from the node's value. The rest of the offset's low bits
+			// are read all at once.
+			const uint8_t tableidx = static_cast<uint8_t>(bits.getBits(8));
+			const int offsetHigh = HighOffsetBits[tableidx] << 6;
+			const int bitcount = LowOffsetBitCount[tableidx] - 2;
+			const int offsetLow = (tableidx << bitcount) | bits.getBits(bitcount);
+
+			const int distance = (offsetHigh | (offsetLow & 0x003F)) + 1;
+
+			// The last run can't go past the end of the output.
+			const int tocopy = std::min(static_cast<int>(codeword) - 256 + 3,
+				static_cast<int>(dstEnd - dst));
+			copyBackReference(dst, dstBegin, distance, tocopy);
+			dst += tocopy;
+		}
+	}
+}
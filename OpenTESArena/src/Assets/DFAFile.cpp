@@ -2,20 +2,45 @@
 
 #include "Compression.h"
 #include "DFAFile.h"
+#include "../Media/PaletteTable.h"
 #include "../Utilities/Bytes.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/JobSystem.h"
+#include "../Utilities/Profiler.h"
 
 #include "components/vfs/manager.hpp"
 
+DFAFile::DFAFile(const std::string &filename)
+{
+	this->init(filename, nullptr);
+}
+
+DFAFile::DFAFile(const std::string &filename, JobSystem &jobSystem)
+{
+	this->init(filename, &jobSystem);
+}
+
 DFAFile::DFAFile(const std::string &filename, const Palette &palette)
+	: DFAFile(filename)
 {
-	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
-	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
+	// Create 32-bit images using each frame's palette indices.
+	const int pixelCount = this->width * this->height;
+	const PaletteTable paletteTable(palette);
+	for (const auto &frame : this->rawPixels)
+	{
+		this->pixels.push_back(std::make_unique<uint32_t[]>(pixelCount));
+		uint32_t *dstPixels = this->pixels.back().get();
+
+		paletteTable.expand(frame.get(), pixelCount, dstPixels);
+	}
+}
 
-	stream->seekg(0, std::ios::end);
-	std::vector<uint8_t> srcData(stream->tellg());
-	stream->seekg(0, std::ios::beg);
-	stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+void DFAFile::init(const std::string &filename, JobSystem *jobSystem)
+{
+	ProfileScope("DFAFile::init");
+
+	const VFS::DataView srcData = VFS::Manager::get().openView(filename);
+	DebugAssert(srcData.isOpen(), "Could not open \"" + filename + "\".");
 
 	// Read DFA header data.
 	const uint16_t imageCount = Bytes::getLE16(srcData.data());
@@ -25,33 +50,51 @@ DFAFile::DFAFile(const std::string &filename, const Palette &palette)
 	const uint16_t height = Bytes::getLE16(srcData.data() + 8);
 	const uint16_t compressedLength = Bytes::getLE16(srcData.data() + 10); // First frame.
 
-	// Frame data with palette indices.
-	std::vector<std::vector<uint8_t>> frames;
+	const int pixelCount = width * height;
 
 	// Uncompress the initial frame.
-	frames.push_back(std::vector<uint8_t>(width * height));
-	Compression::decodeRLE(srcData.data() + 12, width * height, frames.front());
+	std::vector<uint8_t> firstFrame(pixelCount);
+	Compression::decodeRLE(srcData.data() + 12, pixelCount, firstFrame);
 
-	// Make copies of the original frame for each update chunk.
-	for (int i = 1; i < imageCount; i++)
+	// Each later frame is a copy of the initial frame with its own update chunk applied,
+	// so frames don't depend on each other. Only finding where each chunk starts has to
+	// walk the file in order. Skip the first frame because that's the full image.
+	std::vector<uint32_t> chunkOffsets(imageCount, 0);
+	uint32_t offset = 12 + compressedLength;
+	for (uint32_t frameIndex = 1; frameIndex < imageCount; ++frameIndex)
 	{
-		frames.push_back(frames.front());
+		chunkOffsets[frameIndex] = offset;
+
+		const uint8_t *chunkData = srcData.data() + offset;
+		const uint16_t chunkCount = Bytes::getLE16(chunkData + 2);
+		offset += 4;
+
+		for (uint32_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+		{
+			const uint16_t updateCount = Bytes::getLE16(srcData.data() + offset + 2);
+			offset += 4 + updateCount;
+		}
 	}
 
-	// Offset to the beginning of the chunk data; advances as the chunk data is read.
-	uint32_t offset = 12 + compressedLength;
+	for (int i = 0; i < imageCount; i++)
+	{
+		this->rawPixels.push_back(std::make_unique<uint8_t[]>(pixelCount));
+	}
 
-	// Start reading chunks for each update group. Skip the first frame because 
-	// that's the full image.
-	for (uint32_t frameIndex = 1; frameIndex < imageCount; ++frameIndex)
+	auto buildFrame = [this, &srcData, &firstFrame, &chunkOffsets, pixelCount](int frameIndex)
 	{
-		// Select the frame buffer at the current frame index.
-		std::vector<uint8_t> &frame = frames.at(frameIndex);
+		uint8_t *frame = this->rawPixels[frameIndex].get();
+		std::copy(firstFrame.begin(), firstFrame.end(), frame);
+
+		if (frameIndex == 0)
+		{
+			return;
+		}
 
 		// Pointer to the beginning of the chunk data. Each update chunk
 		// changes a group of pixels in a copy of the original image.
+		uint32_t offset = chunkOffsets[frameIndex];
 		const uint8_t *chunkData = srcData.data() + offset;
-		const uint16_t chunkSize = Bytes::getLE16(chunkData);
 		const uint16_t chunkCount = Bytes::getLE16(chunkData + 2);
 
 		// Move the offset past the chunk header.
@@ -66,34 +109,33 @@ DFAFile::DFAFile(const std::string &filename, const Palette &palette)
 			// Move the offset past the update header.
 			offset += 4;
 
-			for (uint32_t i = 0; i < updateCount; i++)
-			{
-				frame.at(updateOffset + i) = *(srcData.begin() + offset);
-				offset++;
-			}
+			DebugAssert((updateOffset + updateCount) <= pixelCount,
+				"DFA update out of range.");
+			const uint8_t *updatePixels = srcData.data() + offset;
+			std::copy(updatePixels, updatePixels + updateCount, frame + updateOffset);
+			offset += updateCount;
 		}
-	}
-
-	this->width = width;
-	this->height = height;
+	};
 
-	// Finally, create 32-bit images using each frame's palette indices.
-	for (const auto &frame : frames)
+	if ((jobSystem != nullptr) && (imageCount > 1))
 	{
-		this->pixels.push_back(std::make_unique<uint32_t[]>(this->width * this->height));
-		uint32_t *dstPixels = this->pixels.back().get();
-
-		std::transform(frame.begin(), frame.begin() + frame.size(), dstPixels,
-			[&palette](uint8_t col) -> uint32_t
+		jobSystem->parallelFor(imageCount, buildFrame);
+	}
+	else
+	{
+		for (int frameIndex = 0; frameIndex < imageCount; frameIndex++)
 		{
-			return palette.get()[col].toARGB();
-		});
+			buildFrame(frameIndex);
+		}
 	}
+
+	this->width = width;
+	this->height = height;
 }
 
 int DFAFile::getImageCount() const
 {
-	return static_cast<int>(this->pixels.size());
+	return static_cast<int>(this->rawPixels.size());
 }
 
 int DFAFile::getWidth() const
@@ -106,6 +148,11 @@ int DFAFile::getHeight() const
 	return this->height;
 }
 
+uint8_t *DFAFile::getRawPixels(int index) const
+{
+	return this->rawPixels.at(index).get();
+}
+
 uint32_t *DFAFile::getPixels(int index) const
 {
 	return this->pixels.at(index).get();
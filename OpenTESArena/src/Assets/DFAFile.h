@@ -11,12 +11,22 @@
 // A DFA file contains images for entities that animate but don't move in the world, 
 // like shopkeepers, tavern folk, lamps, fountains, staff pieces, and torches.
 
+class JobSystem;
+
 class DFAFile
 {
 private:
-	std::vector<std::unique_ptr<uint32_t[]>> pixels;
+	std::vector<std::unique_ptr<uint8_t[]>> rawPixels;
+	std::vector<std::unique_ptr<uint32_t[]>> pixels; // Empty if no palette was given.
 	int width, height;
+
+	// Reads the frames, building them on the job system if it's given.
+	void init(const std::string &filename, JobSystem *jobSystem);
 public:
+	// Loads a DFA from file. Without a palette, only the palette indices are kept. With a
+	// job system, frames are built in parallel.
+	DFAFile(const std::string &filename);
+	DFAFile(const std::string &filename, JobSystem &jobSystem);
 	DFAFile(const std::string &filename, const Palette &palette);
 
 	// Gets the number of images in the DFA file.
@@ -28,6 +38,9 @@ public:
 	// Gets the height of an image in the DFA file.
 	int getHeight() const;
 
+	// Gets a pointer to the raw (unconverted) pixels for an image in the DFA file.
+	uint8_t *getRawPixels(int index) const;
+
 	// Gets a pointer to the pixels for an image in the DFA file.
 	uint32_t *getPixels(int index) const;
 };
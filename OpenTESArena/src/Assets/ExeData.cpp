@@ -1,12 +1,15 @@
 #include <algorithm>
+#include <memory>
 #include <sstream>
 
+#include "AssetCache.h"
 #include "ExeData.h"
 #include "ExeUnpacker.h"
 #include "../Utilities/Bytes.h"
 #include "../Utilities/Debug.h"
 #include "../Utilities/KeyValueMap.h"
 #include "../Utilities/Platform.h"
+#include "../Utilities/Profiler.h"
 #include "../Utilities/String.h"
 
 namespace
@@ -524,38 +527,127 @@ std::string ExeData::readFixedString(const char *data, const std::pair<int, int>
 	return ExeData::readString(data + pair.first, pair.second);
 }
 
+ExeData::ExeData()
+{
+	this->floppyVersion = false;
+}
+
+// Out of line so the key-value map's type is complete where it's freed.
+ExeData::~ExeData() = default;
+
+template <typename T>
+const T &ExeData::getSection(const LazySection<T> &lazySection) const
+{
+	DebugAssert(this->keyValueMap != nullptr, "Executable data not initialized.");
+
+	std::call_once(lazySection.parsed, [this, &lazySection]()
+	{
+		const char *exeDataPtr = reinterpret_cast<const char*>(this->exeView.data());
+		lazySection.section.init(exeDataPtr, *this->keyValueMap);
+	});
+
+	return lazySection.section;
+}
+
+const ExeData::Calendar &ExeData::getCalendar() const
+{
+	return this->getSection(this->calendar);
+}
+
+const ExeData::CharacterClasses &ExeData::getCharClasses() const
+{
+	return this->getSection(this->charClasses);
+}
+
+const ExeData::CharacterCreation &ExeData::getCharCreation() const
+{
+	return this->getSection(this->charCreation);
+}
+
+const ExeData::CityGeneration &ExeData::getCityGen() const
+{
+	return this->getSection(this->cityGen);
+}
+
+const ExeData::Entities &ExeData::getEntities() const
+{
+	return this->getSection(this->entities);
+}
+
+const ExeData::Equipment &ExeData::getEquipment() const
+{
+	return this->getSection(this->equipment);
+}
+
+const ExeData::Locations &ExeData::getLocations() const
+{
+	return this->getSection(this->locations);
+}
+
+const ExeData::Logbook &ExeData::getLogbook() const
+{
+	return this->getSection(this->logbook);
+}
+
+const ExeData::Meta &ExeData::getMeta() const
+{
+	return this->getSection(this->meta);
+}
+
+const ExeData::Races &ExeData::getRaces() const
+{
+	return this->getSection(this->races);
+}
+
+const ExeData::Status &ExeData::getStatus() const
+{
+	return this->getSection(this->status);
+}
+
+const ExeData::Travel &ExeData::getTravel() const
+{
+	return this->getSection(this->travel);
+}
+
+const ExeData::WallHeightTables &ExeData::getWallHeightTables() const
+{
+	return this->getSection(this->wallHeightTables);
+}
+
 bool ExeData::isFloppyVersion() const
 {
 	return this->floppyVersion;
 }
 
-void ExeData::init(bool floppyVersion)
+void ExeData::init(bool floppyVersion, const AssetCache &assetCache)
 {
-	// Load executable.
+	ProfileScope("ExeData::init");
+
+	// Load executable. Unpacking it is most of the startup time, so the unpacked data is
+	// cached, keyed by the packed executable.
 	const std::string &exeFilename = floppyVersion ?
 		ExeData::FLOPPY_VERSION_EXE_FILENAME : ExeData::CD_VERSION_EXE_FILENAME;
-	const ExeUnpacker exe(exeFilename);
-	const char *exeDataPtr = reinterpret_cast<const char*>(exe.getData().data());
+	const VFS::DataView packedExe = VFS::Manager::get().openView(exeFilename);
+	DebugAssert(packedExe.isOpen(), "Could not open \"" + exeFilename + "\".");
+
+	const uint64_t exeHash = AssetCache::hash(packedExe.data(), packedExe.size());
+	VFS::DataView exeView = assetCache.read(exeFilename, exeHash);
+
+	if (!exeView.isOpen())
+	{
+		// The view keeps the unpacker alive for as long as sections might be parsed.
+		const auto exe = std::make_shared<const ExeUnpacker>(exeFilename);
+		const std::vector<uint8_t> &exeBytes = exe->getData();
+		assetCache.write(exeFilename, exeHash, exeBytes.data(), exeBytes.size());
+		exeView = VFS::DataView(exeBytes.data(), exeBytes.size(), exe);
+	}
+
+	this->exeView = exeView;
 
-	// Load key-value map file.
+	// Load key-value map file. Sections are parsed with it when they're first asked for.
 	const std::string &mapFilename = floppyVersion ?
 		ExeData::FLOPPY_VERSION_MAP_FILENAME : ExeData::CD_VERSION_MAP_FILENAME;
-	const KeyValueMap keyValueMap(Platform::getBasePath() + mapFilename);
-
-	// Initialize members with the executable mappings.
-	this->calendar.init(exeDataPtr, keyValueMap);
-	this->charClasses.init(exeDataPtr, keyValueMap);
-	this->charCreation.init(exeDataPtr, keyValueMap);
-	this->cityGen.init(exeDataPtr, keyValueMap);
-	this->entities.init(exeDataPtr, keyValueMap);
-	this->equipment.init(exeDataPtr, keyValueMap);
-	this->locations.init(exeDataPtr, keyValueMap);
-	this->logbook.init(exeDataPtr, keyValueMap);
-	this->meta.init(exeDataPtr, keyValueMap);
-	this->races.init(exeDataPtr, keyValueMap);
-	this->status.init(exeDataPtr, keyValueMap);
-	this->travel.init(exeDataPtr, keyValueMap);
-	this->wallHeightTables.init(exeDataPtr, keyValueMap);
+	this->keyValueMap = std::make_unique<KeyValueMap>(Platform::getBasePath() + mapFilename);
 
 	this->floppyVersion = floppyVersion;
 }
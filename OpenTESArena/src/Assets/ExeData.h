@@ -3,15 +3,24 @@
 
 #include <array>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "components/vfs/manager.hpp"
+
 // This class stores data from the Arena executable. In other words, it represents a
 // kind of "view" into the executable's data.
 
+// The unpacked executable is kept, and each section is only parsed the first time it's
+// asked for, since most of them are only needed by a few panels. Sections can be asked
+// for from any thread.
+
 // When expanding this to work with both A.EXE and ACD.EXE, maybe use a union for
 // members that differ between the two executables, with an _a/_acd suffix.
 
+class AssetCache;
 class KeyValueMap;
 
 class ExeData
@@ -319,27 +328,58 @@ private:
 	// and an offset + length pair.
 	static std::string readFixedString(const char *data, const std::pair<int, int> &pair);
 
+	// A section that's parsed by the first thread to ask for it.
+	template <typename T>
+	struct LazySection
+	{
+		mutable std::once_flag parsed;
+		mutable T section;
+	};
+
+	VFS::DataView exeView; // Unpacked executable, either cached or owning its unpacker.
+	std::unique_ptr<KeyValueMap> keyValueMap; // Offsets of each section's data.
+	LazySection<Calendar> calendar;
+	LazySection<CharacterClasses> charClasses;
+	LazySection<CharacterCreation> charCreation;
+	LazySection<CityGeneration> cityGen;
+	LazySection<Entities> entities;
+	LazySection<Equipment> equipment;
+	LazySection<Locations> locations;
+	LazySection<Logbook> logbook;
+	LazySection<Meta> meta;
+	LazySection<Races> races;
+	LazySection<Status> status;
+	LazySection<Travel> travel;
+	LazySection<WallHeightTables> wallHeightTables;
 	bool floppyVersion;
+
+	// Gets the section, parsing it from the executable if it hasn't been yet.
+	template <typename T>
+	const T &getSection(const LazySection<T> &lazySection) const;
 public:
-	Calendar calendar;
-	CharacterClasses charClasses;
-	CharacterCreation charCreation;
-	CityGeneration cityGen;
-	Entities entities;
-	Equipment equipment;
-	Locations locations;
-	Logbook logbook;
-	Meta meta;
-	Races races;
-	Status status;
-	Travel travel;
-	WallHeightTables wallHeightTables;
+	ExeData();
+	~ExeData();
+
+	const Calendar &getCalendar() const;
+	const CharacterClasses &getCharClasses() const;
+	const CharacterCreation &getCharCreation() const;
+	const CityGeneration &getCityGen() const;
+	const Entities &getEntities() const;
+	const Equipment &getEquipment() const;
+	const Locations &getLocations() const;
+	const Logbook &getLogbook() const;
+	const Meta &getMeta() const;
+	const Races &getRaces() const;
+	const Status &getStatus() const;
+	const Travel &getTravel() const;
+	const WallHeightTables &getWallHeightTables() const;
 
 	bool isFloppyVersion() const;
 
 	// The floppy version boolean determines which strings file to use, and potentially
-	// how to interpret various data structures in the executable.
-	void init(bool floppyVersion);
+	// how to interpret various data structures in the executable. The unpacked executable
+	// is read from the asset cache if it's there.
+	void init(bool floppyVersion, const AssetCache &assetCache);
 };
 
 #endif
@@ -1,135 +1,70 @@
 #include <algorithm>
-#include <array>
 #include <cassert>
-#include <memory>
 
 #include "ExeUnpacker.h"
 #include "../Utilities/Bytes.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/Profiler.h"
 #include "../Utilities/String.h"
 
 #include "components/vfs/manager.hpp"
 
 namespace
 {
-	// Performance optimization for bit reading (replaces the unnecessary heap 
-	// allocation of std::vector<bool>). Use BitVector::bitsUsed instead of 
-	// BitVector::bits.size().
-	struct BitVector
+	// Decodes a prefix code with one lookup, indexed by the next bits of the bit stream.
+	// The table has an entry for every combination of the longest code's length in bits,
+	// and each code fills all of the entries whose low bits match it. Bits are read least
+	// significant first, so a code's first bit is bit 0 of the index.
+	class BitTable
 	{
-		std::array<bool, 9> bits;
-		int bitsUsed;
-
-		BitVector()
+	public:
+		struct Entry
 		{
-			this->bits.fill(false);
-			this->bitsUsed = 0;
-		}
-	};
-
-	// A simple binary tree for retrieving a decoded value, given a vector of bits.
-	class BitTree
-	{
+			int value;
+			int length; // Zero if no code matches.
+		};
 	private:
-		struct Node
+		std::vector<BitTable::Entry> entries;
+		int bitCount;
+	public:
+		BitTable(int bitCount)
+			: entries(1 << bitCount, BitTable::Entry { 0, 0 })
 		{
-			// Only leaves will have non-null values.
-			std::unique_ptr<int> value;
-			std::unique_ptr<Node> left;
-			std::unique_ptr<Node> right;
-		};
+			this->bitCount = bitCount;
+		}
 
-		BitTree::Node root;
-	public:
-		// Inserts a node into the tree, overwriting any existing entry.
+		// Inserts a code into the table, overwriting any existing entry.
 		void insert(const std::vector<bool> &bits, int value)
 		{
-			BitTree::Node *node = &this->root;
+			const int length = static_cast<int>(bits.size());
+			assert(length <= this->bitCount);
 
-			// Walk the tree, creating new nodes as necessary. Internal nodes have null values.
-			for (size_t i = 0; i < bits.size(); i++)
+			uint32_t code = 0;
+			for (int i = 0; i < length; i++)
 			{
-				const bool bit = bits.at(i);
-
-				// Decide which branch to use.
-				if (bit)
-				{
-					// Right.
-					if (node->right.get() == nullptr)
-					{
-						// Make a new node.
-						node->right = std::make_unique<BitTree::Node>();
-					}
-
-					node = node->right.get();
-				}
-				else
-				{
-					// Left.
-					if (node->left.get() == nullptr)
-					{
-						// Make a new node.
-						node->left = std::make_unique<BitTree::Node>();
-					}
-
-					node = node->left.get();
-				}
-				
-				// Set the node's value if it's the desired leaf.
-				if (i == (bits.size() - 1))
-				{
-					node->value = std::make_unique<int>(value);
-				}
+				code |= (bits.at(i) ? 1 : 0) << i;
 			}
-		}
 
-		// Returns a pointer to a decoded value in the tree, or null if no entry exists.
-		const int *get(const BitVector &bitVector)
-		{
-			const int *value = nullptr;
-			const BitTree::Node *left = this->root.left.get();
-			const BitTree::Node *right = this->root.right.get();
-
-			// Walk the tree.
-			for (int i = 0; i < bitVector.bitsUsed; i++)
+			// Every combination of the bits after the code decodes to it.
+			const int step = 1 << length;
+			for (int i = code; i < static_cast<int>(this->entries.size()); i += step)
 			{
-				const bool bit = bitVector.bits.at(i);
-
-				// Decide which branch to use.
-				if (bit)
-				{
-					// Right.
-					assert(right != nullptr);
-
-					// Check if it's a leaf.
-					if ((right->left.get() == nullptr) && (right->right.get() == nullptr))
-					{
-						value = right->value.get();
-					}
-
-					left = right->left.get();
-					right = right->right.get();
-				}
-				else
-				{
-					// Left.
-					assert(left != nullptr);
-
-					// Check if it's a leaf.
-					if ((left->left.get() == nullptr) && (left->right.get() == nullptr))
-					{
-						value = left->value.get();
-					}
-
-					right = left->right.get();
-					left = left->left.get();
-				}
+				this->entries[i] = BitTable::Entry { value, length };
 			}
+		}
 
-			return value;
+		// Gets the code at the start of the given bits. Bits past the table's bit count
+		// are ignored.
+		const BitTable::Entry &get(uint32_t bits) const
+		{
+			return this->entries[bits & ((1 << this->bitCount) - 1)];
 		}
 	};
 
+	// Value of the special case in the first bit table, where the byte count is read from
+	// the compressed data instead.
+	const int DuplicationSpecialCase = -1;
+
 	// Bit table from pklite_specification.md, section 4.3.1 "Number of bytes".
 	// The decoded value for a given vector is (index + 2) before index 11, and
 	// (index + 1) after index 11.
@@ -202,33 +137,31 @@ namespace
 
 ExeUnpacker::ExeUnpacker(const std::string &filename)
 {
-	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
-	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
+	ProfileScope("ExeUnpacker::ExeUnpacker");
 
-	stream->seekg(0, std::ios::end);
-	std::vector<uint8_t> srcData(stream->tellg());
-	stream->seekg(0, std::ios::beg);
-	stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+	const VFS::DataView srcData = VFS::Manager::get().openView(filename);
+	DebugAssert(srcData.isOpen(), "Could not open \"" + filename + "\".");
 
-	// Generate the bit trees for "duplication mode". Since the Duplication1 table has 
-	// a special case at index 11, split the insertions up for the first bit tree.
-	BitTree bitTree1, bitTree2;
+	// Generate the bit tables for "duplication mode", sized for the longest code in each.
+	// Since the Duplication1 table has a special case at index 11, split the insertions up
+	// for the first bit table.
+	BitTable bitTable1(9), bitTable2(7);
 
 	for (int i = 0; i < 11; i++)
 	{
-		bitTree1.insert(Duplication1.at(i), i + 2);
+		bitTable1.insert(Duplication1.at(i), i + 2);
 	}
 
-	bitTree1.insert(Duplication1.at(11), 13);
+	bitTable1.insert(Duplication1.at(11), DuplicationSpecialCase);
 
-	for (int i = 12; i < Duplication1.size(); i++)
+	for (int i = 12; i < static_cast<int>(Duplication1.size()); i++)
 	{
-		bitTree1.insert(Duplication1.at(i), i + 1);
+		bitTable1.insert(Duplication1.at(i), i + 1);
 	}
 
-	for (int i = 0; i < Duplication2.size(); i++)
+	for (int i = 0; i < static_cast<int>(Duplication2.size()); i++)
 	{
-		bitTree2.insert(Duplication2.at(i), i);
+		bitTable2.insert(Duplication2.at(i), i);
 	}
 
 	// Beginning and end of compressed data in the executable.
@@ -297,51 +230,46 @@ ExeUnpacker::ExeUnpacker(const std::string &filename)
 			return bit;
 		};
 
+		// Lambda for looking at the next bits in the bit stream without consuming them.
+		// No bytes are read in the middle of a code, so the next bit array is still at
+		// the byte index, and a code never spans more than it and the current one.
+		auto peekBits = [compressedStart, &bitArray, &bitsRead, &byteIndex]()
+		{
+			const uint32_t nextArray = Bytes::getLE16(compressedStart + byteIndex);
+			return (static_cast<uint32_t>(bitArray) >> bitsRead) |
+				(nextArray << (16 - bitsRead));
+		};
+
+		// Lambda for consuming bits looked at with peekBits(). Codes are shorter than a
+		// bit array, so at most one new array is read.
+		auto skipBits = [&bitArray, &bitsRead, &getNextByte](int count)
+		{
+			bitsRead += count;
+
+			if (bitsRead >= 16)
+			{
+				bitsRead -= 16;
+
+				const uint8_t byte1 = getNextByte();
+				const uint8_t byte2 = getNextByte();
+				bitArray = byte1 | (byte2 << 8);
+			}
+		};
+
 		// Decide which mode to use for the current bit.
 		if (getNextBit())
 		{
 			// "Duplication" mode.
 			// Calculate which bytes in the decompressed data to duplicate and append.
-			BitVector copyBits;
-			const int *copyPtr = nullptr;
-
-			// Read bits until they match a bit tree leaf.
-			while (copyPtr == nullptr)
-			{
-				copyBits.bits.at(copyBits.bitsUsed) = getNextBit();
-				copyBits.bitsUsed++;
-				copyPtr = bitTree1.get(copyBits);
-			}
+			const BitTable::Entry &copyEntry = bitTable1.get(peekBits());
+			DebugAssert(copyEntry.length > 0, "Invalid byte count code.");
+			skipBits(copyEntry.length);
 
 			// Calculate the number of bytes in the decompressed data to copy.
 			uint16_t copyCount = 0;
 
-			// Lambda for comparing a bit vector's equality with the special case.
-			auto matchesSpecialCase = [](const BitVector &bitVector)
-			{
-				const std::vector<bool> &specialCase = Duplication1.at(11);
-				const bool equalSize = bitVector.bitsUsed == specialCase.size();
-
-				if (!equalSize)
-				{
-					return false;
-				}
-				else
-				{
-					for (int i = 0; i < bitVector.bitsUsed; i++)
-					{
-						if (bitVector.bits.at(i) != specialCase.at(i))
-						{
-							return false;
-						}
-					}
-
-					return true;
-				}
-			};
-
 			// Check for the special bit vector case "011100".
-			if (matchesSpecialCase(copyBits))
+			if (copyEntry.value == DuplicationSpecialCase)
 			{
 				// Read a compressed byte.
 				const uint8_t encryptedByte = getNextByte();
@@ -365,7 +293,7 @@ ExeUnpacker::ExeUnpacker(const std::string &filename)
 			else
 			{
 				// Use the decoded value from the first bit table.
-				copyCount = *copyPtr;
+				copyCount = copyEntry.value;
 			}
 
 			// Calculate the offset in decompressed data. It is a two byte value.
@@ -375,19 +303,12 @@ ExeUnpacker::ExeUnpacker(const std::string &filename)
 			// If the copy count is not 2, decode the most significant byte.
 			if (copyCount != 2)
 			{
-				BitVector offsetBits;
-				const int* offsetPtr = nullptr;
-
-				// Read bits until they match a bit tree leaf.
-				while (offsetPtr == nullptr)
-				{
-					offsetBits.bits.at(offsetBits.bitsUsed) = getNextBit();
-					offsetBits.bitsUsed++;
-					offsetPtr = bitTree2.get(offsetBits);
-				}
+				const BitTable::Entry &offsetEntry = bitTable2.get(peekBits());
+				DebugAssert(offsetEntry.length > 0, "Invalid offset code.");
+				skipBits(offsetEntry.length);
 
 				// Use the decoded value from the second bit table.
-				mostSigByte = *offsetPtr;
+				mostSigByte = offsetEntry.value;
 			}
 
 			// Get the least significant byte of the two bytes.
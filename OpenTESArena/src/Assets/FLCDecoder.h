@@ -0,0 +1,83 @@
+#ifndef FLC_DECODER_H
+#define FLC_DECODER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Media/Palette.h"
+
+#include "components/vfs/manager.hpp"
+
+// Decodes the frames of an FLC or CEL file one at a time. Only a view of the compressed
+// file, the current frame's palette indices, and the palette are kept, so a video can be
+// played without converting every frame to 32-bit pixels up front.
+
+// Each FLC frame after the first is a delta of the one before it, so frames can only be
+// decoded in order. Going back to an earlier frame means starting over with rewind().
+
+class FLCDecoder
+{
+private:
+	VFS::DataView srcData;
+	std::vector<uint8_t> frameIndices; // Palette indices of the current frame.
+	Palette palette;
+	double frameDuration;
+	int width, height;
+	int frameCount;
+	int frameIndex; // Index of the current frame, or -1 before the first one.
+
+	// Position of the next chunk to read. The chunk count is the number of chunks left
+	// in the current FLC frame.
+	uint32_t frameOffset, chunkOffset;
+	int remainingChunks;
+
+	// Reads a palette chunk into the palette.
+	void readPaletteData(const uint8_t *chunkData);
+
+	// Decodes a fullscreen FLC chunk into the frame indices. Reads stop at the chunk size
+	// (of the data after the chunk header), so a short chunk leaves the rest as it was.
+	void decodeFullFrame(const uint8_t *chunkData, int chunkSize);
+
+	// Decodes a delta FLC chunk by partially updating the frame indices.
+	void decodeDeltaFrame(const uint8_t *chunkData, int chunkSize);
+
+	// Reads chunks until one with an image is decoded. Returns false at the end of the
+	// file. When the decode flag is false, only the chunk headers are read, for counting
+	// frames.
+	bool readNextImageChunk(bool decode);
+public:
+	FLCDecoder(const std::string &filename);
+
+	// Gets the number of frames in the FLC file.
+	int getFrameCount() const;
+
+	// Gets the duration of each frame in seconds in the FLC file.
+	double getFrameDuration() const;
+
+	// Gets the width of each frame in the FLC file.
+	int getWidth() const;
+
+	// Gets the height of each frame in the FLC file.
+	int getHeight() const;
+
+	// Gets the index of the current frame, or -1 if no frame has been decoded yet.
+	int getFrameIndex() const;
+
+	// Gets the palette indices of the current frame.
+	const uint8_t *getFrameIndices() const;
+
+	// Gets the palette of the current frame. Some FLCs change it partway through.
+	const Palette &getPalette() const;
+
+	// Decodes the next frame. Returns false if the current frame is the last one.
+	bool decodeNextFrame();
+
+	// Goes back to before the first frame.
+	void rewind();
+
+	// Writes the current frame as 32-bit pixels. The pitch is in pixels.
+	void writePixels(uint32_t *dst, int pitch) const;
+};
+
+#endif
@@ -6,8 +6,6 @@
 #include <string>
 #include <vector>
 
-#include "../Media/Palette.h"
-
 // An FLC file is a video file. CEL files are nearly identical to FLCs, though with 
 // an extra chunk of header data (which can probably be skipped).
 
@@ -32,20 +30,9 @@ private:
 	double frameDuration;
 	int width;
 	int height;
-
-	// Reads a palette chunk and writes the results to the given palette reference.
-	void readPaletteData(const uint8_t *chunkData, Palette &dstPalette);
-
-	// Decodes a fullscreen FLC chunk by updating the initial frame indices and
-	// returning a complete frame.
-	std::unique_ptr<uint32_t[]> decodeFullFrame(const uint8_t *chunkData, int chunkSize,
-		const Palette &palette, std::vector<uint8_t> &initialFrame);
-
-	// Decodes a delta FLC chunk by partially updating the initial frame indices and
-	// returning a complete frame.
-	std::unique_ptr<uint32_t[]> decodeDeltaFrame(const uint8_t *chunkData, int chunkSize,
-		const Palette &palette, std::vector<uint8_t> &initialFrame);
 public:
+	// Decodes every frame up front. FLCDecoder should be used instead for playing a
+	// video, so the frames don't all have to be in memory at once.
 	FLCFile(const std::string &filename);
 
 	// Gets the number of frames in the FLC file.
@@ -6,6 +6,7 @@
 #include "../Media/Font.h"
 #include "../Media/FontName.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/Profiler.h"
 
 #include "components/vfs/manager.hpp"
 
@@ -27,16 +28,13 @@ namespace
 
 FontFile::FontFile(const std::string &filename)
 {
-	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
-	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
+	ProfileScope("FontFile::FontFile");
 
-	stream->seekg(0, std::ios::end);
-	std::vector<uint8_t> srcData(stream->tellg());
-	stream->seekg(0, std::ios::beg);
-	stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+	const VFS::DataView srcData = VFS::Manager::get().openView(filename);
+	DebugAssert(srcData.isOpen(), "Could not open \"" + filename + "\".");
 
 	// The character height is in the first byte.
-	const uint8_t charHeight = srcData.front();
+	const uint8_t charHeight = srcData[0];
 	const uint8_t *counts = srcData.data();
 	const uint16_t *lines = reinterpret_cast<const uint16_t*>(counts + 95);
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -5,8 +6,10 @@
 #include "IMGFile.h"
 #include "../Math/Vector2.h"
 #include "../Media/Color.h"
+#include "../Media/PaletteTable.h"
 #include "../Utilities/Bytes.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/Profiler.h"
 
 #include "components/vfs/manager.hpp"
 
@@ -40,26 +43,23 @@ namespace
 	};
 }
 
-IMGFile::IMGFile(const std::string &filename, const Palette *palette)
+IMGFile::IMGFile(const std::string &filename)
 {
+	ProfileScope("IMGFile::IMGFile");
+
 	// There are a couple .INFs that reference misspelled .IMGs. Arena doesn't seem
 	// to use them, so if they are requested here, just return a dummy image.
 	if (MisspelledIMGs.find(filename) != MisspelledIMGs.end())
 	{
 		this->width = 1;
 		this->height = 1;
-		this->pixels = std::make_unique<uint32_t[]>(this->width * this->height);
-		this->pixels[0] = Color::Black.toARGB();
+		this->rawPixels = std::make_unique<uint8_t[]>(this->width * this->height);
+		this->rawPixels[0] = 0;
 		return;
 	}
 
-	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
-	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
-
-	stream->seekg(0, std::ios::end);
-	std::vector<uint8_t> srcData(stream->tellg());
-	stream->seekg(0, std::ios::beg);
-	stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+	const VFS::DataView srcData = VFS::Manager::get().openView(filename);
+	DebugAssert(srcData.isOpen(), "Could not open \"" + filename + "\".");
 
 	uint16_t xoff, yoff, width, height, flags, len;
 
@@ -100,36 +100,21 @@ IMGFile::IMGFile(const std::string &filename, const Palette *palette)
 
 	const int headerSize = 12;
 
-	// Try and read the IMG's built-in palette if the given palette is null.
-	Palette builtInPalette;
-	const bool useBuiltInPalette = palette == nullptr;
-
-	if (useBuiltInPalette)
+	// Read the IMG's built-in palette if it has one. Raw and wall IMGs never do, and
+	// their flags are zero or garbage.
+	if (!isRaw && (srcData.size() != 4096) && ((flags & 0x0100) != 0))
 	{
-		// This code might run even if the IMG doesn't have a palette, because
-		// some IMGs have no header and are not "raw" (like walls, for instance).
-		DebugAssert((flags & 0x0100) != 0, "\"" + filename + 
-			"\" does not have a built-in palette.");
-
-		// Read the palette data and write it to the destination palette.
-		IMGFile::readPalette(srcData.data() + headerSize + len, builtInPalette);
+		this->builtInPalette = std::make_unique<Palette>();
+		IMGFile::readPalette(srcData.data() + headerSize + len, *this->builtInPalette);
 	}
 
-	// Choose which palette to use.
-	const Palette &paletteRef = useBuiltInPalette ? builtInPalette : (*palette);
-
-	// Lambda for setting IMGFile members and constructing the final image.
-	auto makeImage = [this, &paletteRef](int width, int height, const uint8_t *data)
+	// Lambda for setting IMGFile members and copying the palette indices.
+	auto makeImage = [this](int width, int height, const uint8_t *data)
 	{
 		this->width = width;
 		this->height = height;
-		this->pixels = std::make_unique<uint32_t[]>(width * height);
-
-		std::transform(data, data + (width * height), this->pixels.get(),
-			[&paletteRef](uint8_t col) -> uint32_t
-		{
-			return paletteRef.get()[col].toARGB();
-		});
+		this->rawPixels = std::make_unique<uint8_t[]>(width * height);
+		std::copy(data, data + (width * height), this->rawPixels.get());
 	};
 
 	// Decide how to use the pixel data.
@@ -141,9 +126,9 @@ IMGFile::IMGFile(const std::string &filename, const Palette *palette)
 		{
 			this->width = 64;
 			this->height = 64;
-			this->pixels = std::make_unique<uint32_t[]>(this->width * this->height);
-			std::fill(this->pixels.get(), this->pixels.get() + (this->width * this->height),
-				paletteRef.get()[0].toARGB());
+			this->rawPixels = std::make_unique<uint8_t[]>(this->width * this->height);
+			std::fill(this->rawPixels.get(),
+				this->rawPixels.get() + (this->width * this->height), 0);
 
 			for (int y = 0; y < height; y++)
 			{
@@ -152,8 +137,7 @@ IMGFile::IMGFile(const std::string &filename, const Palette *palette)
 					// Offset the destination X by 32 so it matches DZTTEP.IMG.
 					const int srcIndex = x + (y * width);
 					const int dstIndex = (x + 32) + (y * this->width);
-					const uint8_t color = *(srcData.data() + srcIndex);
-					this->pixels[dstIndex] = paletteRef.get()[color].toARGB();
+					this->rawPixels[dstIndex] = *(srcData.data() + srcIndex);
 				}
 			}
 		}
@@ -180,8 +164,8 @@ IMGFile::IMGFile(const std::string &filename, const Palette *palette)
 		{
 			// Type 4 compression.
 			std::vector<uint8_t> decomp(width * height);
-			Compression::decodeType04(srcData.begin() + headerSize,
-				srcData.begin() + headerSize + len, decomp);
+			Compression::decodeType04(srcData.data() + headerSize,
+				srcData.data() + headerSize + len, decomp);
 
 			// Create 32-bit image.
 			makeImage(width, height, decomp.data());
@@ -191,8 +175,8 @@ IMGFile::IMGFile(const std::string &filename, const Palette *palette)
 			// Type 8 compression. Contains a 2 byte decompressed length after
 			// the header, so skip that (should be equivalent to width * height).
 			std::vector<uint8_t> decomp(width * height);
-			Compression::decodeType08(srcData.begin() + headerSize + 2,
-				srcData.begin() + headerSize + len, decomp);
+			Compression::decodeType08(srcData.data() + headerSize + 2,
+				srcData.data() + headerSize + len, decomp);
 
 			// Create 32-bit image.
 			makeImage(width, height, decomp.data());
@@ -204,6 +188,26 @@ IMGFile::IMGFile(const std::string &filename, const Palette *palette)
 	}
 }
 
+IMGFile::IMGFile(const std::string &filename, const Palette *palette)
+	: IMGFile(filename)
+{
+	// Use the IMG's built-in palette if the given palette is null.
+	if (palette == nullptr)
+	{
+		// This code might run even if the IMG doesn't have a palette, because
+		// some IMGs have no header and are not "raw" (like walls, for instance).
+		DebugAssert(this->builtInPalette.get() != nullptr, "\"" + filename +
+			"\" does not have a built-in palette.");
+	}
+
+	// Choose which palette to use.
+	const Palette &paletteRef = (palette == nullptr) ? (*this->builtInPalette) : (*palette);
+
+	// Create the 32-bit image.
+	this->pixels = std::make_unique<uint32_t[]>(this->width * this->height);
+	this->writePixels(paletteRef, this->pixels.get(), this->width);
+}
+
 void IMGFile::readPalette(const uint8_t *paletteData, Palette &dstPalette)
 {
 	// The palette data is 768 bytes, starting after the pixel data ends.
@@ -229,13 +233,8 @@ void IMGFile::readPalette(const uint8_t *paletteData, Palette &dstPalette)
 
 void IMGFile::extractPalette(const std::string &filename, Palette &dstPalette)
 {
-	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
-	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
-
-	stream->seekg(0, std::ios::end);
-	std::vector<uint8_t> srcData(stream->tellg());
-	stream->seekg(0, std::ios::beg);
-	stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+	const VFS::DataView srcData = VFS::Manager::get().openView(filename);
+	DebugAssert(srcData.isOpen(), "Could not open \"" + filename + "\".");
 
 	// Read the flags and IMG file length. Skip the X and Y offsets and dimensions.
 	// No need to check for raw override. All given filenames should point to IMGs
@@ -263,7 +262,23 @@ int IMGFile::getHeight() const
 	return this->height;
 }
 
+const Palette *IMGFile::getBuiltInPalette() const
+{
+	return this->builtInPalette.get();
+}
+
+uint8_t *IMGFile::getRawPixels() const
+{
+	return this->rawPixels.get();
+}
+
 uint32_t *IMGFile::getPixels() const
 {
 	return this->pixels.get();
 }
+
+void IMGFile::writePixels(const Palette &palette, uint32_t *dst, int pitch) const
+{
+	const PaletteTable paletteTable(palette);
+	paletteTable.expand(this->rawPixels.get(), this->width, this->height, dst, pitch);
+}
@@ -14,12 +14,18 @@
 class IMGFile
 {
 private:
-	std::unique_ptr<uint32_t[]> pixels;
+	std::unique_ptr<uint8_t[]> rawPixels;
+	std::unique_ptr<uint32_t[]> pixels; // Null if no palette was given.
+	std::unique_ptr<Palette> builtInPalette; // Null if the IMG doesn't have one.
 	int width, height;
 
 	// Reads the palette from an IMG file and writes into the given palette reference.
 	static void readPalette(const uint8_t *paletteData, Palette &dstPalette);
 public:
+	// Loads an IMG from file. Only the palette indices and the built-in palette (if any)
+	// are kept.
+	IMGFile(const std::string &filename);
+
 	// Loads an IMG from file. Uses the given palette unless it is null, then it 
 	// refers to the IMG's built-in palette instead if it has one.
 	IMGFile(const std::string &filename, const Palette *palette);
@@ -34,8 +40,19 @@ public:
 	// Gets the height of the IMG in pixels.
 	int getHeight() const;
 
+	// Gets the IMG's built-in palette, or null if it doesn't have one.
+	const Palette *getBuiltInPalette() const;
+
+	// Gets a pointer to the raw (unconverted) pixel data for the IMG.
+	uint8_t *getRawPixels() const;
+
 	// Gets a pointer to the pixel data for the IMG.
 	uint32_t *getPixels() const;
+
+	// Writes the IMG as 32-bit pixels with the given palette into caller-owned memory
+	// (i.e., a surface's pixels), so no 32-bit copy of the IMG is needed. The pitch is in
+	// pixels.
+	void writePixels(const Palette &palette, uint32_t *dst, int pitch) const;
 };
 
 #endif
@@ -1,11 +1,12 @@
 #include <algorithm>
 #include <cctype>
-#include <sstream>
 #include <unordered_set>
 
 #include "INFFile.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/Profiler.h"
 #include "../Utilities/String.h"
+#include "../Utilities/StringView.h"
 
 #include "components/vfs/manager.hpp"
 
@@ -109,6 +110,70 @@ namespace
 			this->id = id;
 		}
 	};
+
+	// Splits a line on runs of spaces and tabs. Unlike StringView::split(), there are no
+	// empty tokens, so leading and trailing whitespace is ignored.
+	void splitWhitespace(StringView line, std::vector<StringView> &tokens)
+	{
+		tokens.clear();
+
+		auto isWhitespace = [](char c)
+		{
+			return (c == ' ') || (c == '\t');
+		};
+
+		size_t i = 0;
+		while (i < line.size())
+		{
+			if (isWhitespace(line[i]))
+			{
+				i++;
+			}
+			else
+			{
+				const size_t tokenStart = i;
+				while ((i < line.size()) && !isWhitespace(line[i]))
+				{
+					i++;
+				}
+
+				tokens.push_back(line.substr(tokenStart, i - tokenStart));
+			}
+		}
+	}
+
+	// Copies the text with each run of spaces and tabs replaced by a single space.
+	std::string collapseWhitespace(StringView text)
+	{
+		std::string collapsed;
+		collapsed.reserve(text.size());
+
+		bool prevWhitespace = false;
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			const char c = text[i];
+			const bool isWhitespace = (c == ' ') || (c == '\t');
+			if (!isWhitespace)
+			{
+				collapsed += c;
+			}
+			else if (!prevWhitespace)
+			{
+				collapsed += ' ';
+			}
+
+			prevWhitespace = isWhitespace;
+		}
+
+		return collapsed;
+	}
+
+	// Appends the line and a newline to the text.
+	void appendLine(std::string &text, StringView line)
+	{
+		text.append(line.data(), line.size());
+		text += '\n';
+	}
 }
 
 INFFile::VoxelTextureData::VoxelTextureData(const std::string &filename, int setIndex)
@@ -162,21 +227,28 @@ INFFile::TextData::TextData(bool displayedOnce)
 
 const int INFFile::NO_INDEX = -1;
 
+std::unordered_map<AssetName, std::unique_ptr<const INFFile>, AssetName::Hash> INFFile::cache;
+std::mutex INFFile::cacheMutex;
+
 INFFile::INFFile(const std::string &filename)
 {
-	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
-	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
+	ProfileScope("INFFile::INFFile");
 
-	stream->seekg(0, std::ios::end);
-	std::vector<uint8_t> srcData(stream->tellg());
-	stream->seekg(0, std::ios::beg);
-	stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+	const VFS::DataView srcView = VFS::Manager::get().openView(filename);
+	DebugAssert(srcView.isOpen(), "Could not open \"" + filename + "\".");
 
-	// Check if the .INF is encrypted.
+	// Check if the .INF is encrypted. Unencrypted ones are parsed straight from the file
+	// data, and encrypted ones are decoded once into a buffer that every line and token
+	// below is a view into.
 	const bool isEncrypted = UnencryptedINFs.find(filename) == UnencryptedINFs.end();
 
+	std::vector<char> decodedData;
+	StringView text(reinterpret_cast<const char*>(srcView.data()), srcView.size());
+
 	if (isEncrypted)
 	{
+		decodedData.resize(srcView.size());
+
 		// Adapted from BSATool.
 		const std::array<uint8_t, 8> encryptionKeys =
 		{
@@ -187,12 +259,15 @@ INFFile::INFFile(const std::string &filename)
 		// The count repeats every 256 bytes, and the key repeats every 8 bytes.
 		uint8_t keyIndex = 0;
 		uint8_t count = 0;
-		for (uint8_t &encryptedByte : srcData)
+		for (size_t i = 0; i < srcView.size(); i++)
 		{
-			encryptedByte ^= count + encryptionKeys.at(keyIndex);
+			const uint8_t decodedByte = srcView[i] ^ (count + encryptionKeys.at(keyIndex));
+			decodedData[i] = static_cast<char>(decodedByte);
 			keyIndex = (keyIndex + 1) % encryptionKeys.size();
 			count++;
 		}
+
+		text = StringView(decodedData.data(), decodedData.size());
 	}
 
 	this->name = filename;
@@ -208,13 +283,6 @@ INFFile::INFFile(const std::string &filename)
 	this->levelUpIndex = INFFile::NO_INDEX;
 	this->wetChasmIndex = INFFile::NO_INDEX;
 
-	// Assign the data (now decoded if it was encoded) to the text member exposed
-	// to the rest of the program.
-	std::string text(reinterpret_cast<char*>(srcData.data()), srcData.size());
-
-	// Remove carriage returns (newlines are nicer to work with).
-	text = String::replace(text, "\r", "");
-
 	// The parse mode indicates which '@' section is currently being parsed.
 	enum class ParseMode
 	{
@@ -229,6 +297,9 @@ INFFile::INFFile(const std::string &filename)
 	std::unique_ptr<FlatState> flatState;
 	std::unique_ptr<TextState> textState;
 
+	// Shared by the line parsers so splitting doesn't allocate on every line.
+	std::vector<StringView> tokens;
+
 	// Lambda for flushing state to the INFFile. This is useful during the parse loop,
 	// but it's also sometimes necessary at the end of the file because the last element 
 	// of certain sections (i.e., @TEXT) might get missed if there is no data after them.
@@ -279,7 +350,7 @@ INFFile::INFFile(const std::string &filename)
 	};
 
 	// Lambdas for parsing a line of text.
-	auto parseFloorLine = [this, &floorState](const std::string &line)
+	auto parseFloorLine = [this, &floorState, &tokens](StringView line)
 	{
 		const char TYPE_CHAR = '*';
 
@@ -293,19 +364,18 @@ INFFile::INFFile(const std::string &filename)
 				floorState = std::make_unique<FloorState>();
 			}
 
-			const std::string BOXCAP_STR = "BOXCAP";
-			const std::string CEILING_STR = "CEILING";
-			const std::string TOP_STR = "TOP"; // Only occurs in LABRNTH{1,2}.INF.
+			const char BOXCAP_STR[] = "BOXCAP";
+			const char CEILING_STR[] = "CEILING";
+			const char TOP_STR[] = "TOP"; // Only occurs in LABRNTH{1,2}.INF.
 
 			// See what the type in the line is.
-			const std::vector<std::string> tokens = String::split(line);
-			const std::string firstToken = tokens.at(0);
-			const std::string firstTokenType = firstToken.substr(1, firstToken.size() - 1);
+			StringView::split(line, ' ', tokens);
+			const StringView firstTokenType = tokens.at(0).substr(1);
 
 			if (firstTokenType == BOXCAP_STR)
 			{
 				// Write the *BOXCAP's ID to the floor state.
-				floorState->boxCapID = std::stoi(tokens.at(1));
+				floorState->boxCapID = StringView::toInt(tokens.at(1));
 				floorState->mode = FloorState::Mode::BoxCap;
 			}
 			else if (firstTokenType == CEILING_STR)
@@ -318,13 +388,13 @@ INFFile::INFFile(const std::string &filename)
 				// and indoor/outdoor dungeon boolean. Sometimes there are no numbers.
 				if (tokens.size() >= 2)
 				{
-					floorState->ceilingData->height = std::stoi(tokens.at(1));
+					floorState->ceilingData->height = StringView::toInt(tokens.at(1));
 				}
 
 				if (tokens.size() >= 3)
 				{
 					// To do: This might need some more math. (Y * boxScale) / 256?
-					floorState->ceilingData->boxScale = std::stoi(tokens.at(2));
+					floorState->ceilingData->boxScale = StringView::toInt(tokens.at(2));
 				}
 
 				if (tokens.size() == 4)
@@ -339,25 +409,25 @@ INFFile::INFFile(const std::string &filename)
 			}
 			else
 			{
-				DebugCrash("Unrecognized @FLOOR section \"" + tokens.at(0) + "\".");
+				DebugCrash("Unrecognized @FLOOR section \"" + tokens.at(0).toString() + "\".");
 			}
 		}
 		else if (floorState.get() == nullptr)
 		{
 			// No current floor state, so the current line is a loose texture filename
 			// (found in some city .INFs).
-			const std::vector<std::string> tokens = String::split(line, '#');
+			StringView::split(line, '#', tokens);
 
 			if (tokens.size() == 1)
 			{
 				// A regular filename (like an .IMG).
-				this->voxelTextures.push_back(VoxelTextureData(line));
+				this->voxelTextures.push_back(VoxelTextureData(line.toString()));
 			}
 			else
 			{
 				// A .SET filename. Expand it for each of the .SET indices.
-				const std::string textureName = String::trimBack(tokens.at(0));
-				const int setSize = std::stoi(tokens.at(1));
+				const std::string textureName = StringView::trimBack(tokens.at(0)).toString();
+				const int setSize = StringView::toInt(tokens.at(1));
 
 				for (int i = 0; i < setSize; i++)
 				{
@@ -369,16 +439,16 @@ INFFile::INFFile(const std::string &filename)
 		{
 			// There is existing floor state (or it is in the default state with box cap 
 			// ID unset), so this line is expected to be a filename.
-			const int currentIndex = [this, &floorState, &line]()
+			const int currentIndex = [this, &floorState, &tokens, line]()
 			{
 				// If the line contains a '#', it's a .SET file.
-				const std::vector<std::string> tokens = String::split(line, '#');
+				StringView::split(line, '#', tokens);
 
 				// Assign texture data depending on whether the line is for a .SET file.
 				if (tokens.size() == 1)
 				{
 					// Just a regular texture (like an .IMG).
-					floorState->textureName = line;
+					floorState->textureName = line.toString();
 
 					this->voxelTextures.push_back(VoxelTextureData(floorState->textureName));
 					return static_cast<int>(this->voxelTextures.size()) - 1;
@@ -386,8 +456,8 @@ INFFile::INFFile(const std::string &filename)
 				else
 				{
 					// Left side is the filename, right side is the .SET size.
-					floorState->textureName = String::trimBack(tokens.at(0));
-					const int setSize = std::stoi(tokens.at(1));
+					floorState->textureName = StringView::trimBack(tokens.at(0)).toString();
+					const int setSize = StringView::toInt(tokens.at(1));
 
 					for (int i = 0; i < setSize; i++)
 					{
@@ -421,7 +491,7 @@ INFFile::INFFile(const std::string &filename)
 		}
 	};
 
-	auto parseWallLine = [this, &wallState](const std::string &line)
+	auto parseWallLine = [this, &wallState, &tokens](StringView line)
 	{
 		const char TYPE_CHAR = '*';
 
@@ -436,33 +506,32 @@ INFFile::INFFile(const std::string &filename)
 			}
 
 			// All the different possible '*' sections for walls.
-			const std::string BOXCAP_STR = "BOXCAP";
-			const std::string BOXSIDE_STR = "BOXSIDE";
-			const std::string DOOR_STR = "DOOR"; // *DOOR is ignored.
-			const std::string DRYCHASM_STR = "DRYCHASM";
-			const std::string LAVACHASM_STR = "LAVACHASM";
-			const std::string LEVELDOWN_STR = "LEVELDOWN";
-			const std::string LEVELUP_STR = "LEVELUP";
-			const std::string MENU_STR = "MENU"; // Exterior <-> interior transitions.
-			const std::string TRANS_STR = "TRANS"; // *TRANS is ignored.
-			const std::string TRANSWALKTHRU_STR = "TRANSWALKTHRU"; // *TRANSWALKTHRU is ignored.
-			const std::string WALKTHRU_STR = "WALKTHRU"; // *WALKTHRU is ignored.
-			const std::string WETCHASM_STR = "WETCHASM";
+			const char BOXCAP_STR[] = "BOXCAP";
+			const char BOXSIDE_STR[] = "BOXSIDE";
+			const char DOOR_STR[] = "DOOR"; // *DOOR is ignored.
+			const char DRYCHASM_STR[] = "DRYCHASM";
+			const char LAVACHASM_STR[] = "LAVACHASM";
+			const char LEVELDOWN_STR[] = "LEVELDOWN";
+			const char LEVELUP_STR[] = "LEVELUP";
+			const char MENU_STR[] = "MENU"; // Exterior <-> interior transitions.
+			const char TRANS_STR[] = "TRANS"; // *TRANS is ignored.
+			const char TRANSWALKTHRU_STR[] = "TRANSWALKTHRU"; // *TRANSWALKTHRU is ignored.
+			const char WALKTHRU_STR[] = "WALKTHRU"; // *WALKTHRU is ignored.
+			const char WETCHASM_STR[] = "WETCHASM";
 
 			// See what the type in the line is.
-			const std::vector<std::string> tokens = String::split(line);
-			const std::string firstToken = tokens.at(0);
-			const std::string firstTokenType = firstToken.substr(1, firstToken.size() - 1);
+			StringView::split(line, ' ', tokens);
+			const StringView firstTokenType = tokens.at(0).substr(1);
 
 			if (firstTokenType == BOXCAP_STR)
 			{
 				wallState->mode = WallState::Mode::BoxCap;
-				wallState->boxCapIDs.push_back(std::stoi(tokens.at(1)));
+				wallState->boxCapIDs.push_back(StringView::toInt(tokens.at(1)));
 			}
 			else if (firstTokenType == BOXSIDE_STR)
 			{
 				wallState->mode = WallState::Mode::BoxSide;
-				wallState->boxSideIDs.push_back(std::stoi(tokens.at(1)));
+				wallState->boxSideIDs.push_back(StringView::toInt(tokens.at(1)));
 			}
 			else if (firstTokenType == DOOR_STR)
 			{
@@ -490,7 +559,7 @@ INFFile::INFFile(const std::string &filename)
 			else if (firstTokenType == MENU_STR)
 			{
 				wallState->mode = WallState::Mode::Menu;
-				wallState->menuID = std::stoi(tokens.at(1));
+				wallState->menuID = StringView::toInt(tokens.at(1));
 			}
 			else if (firstTokenType == TRANS_STR)
 			{
@@ -514,24 +583,24 @@ INFFile::INFFile(const std::string &filename)
 			}
 			else
 			{
-				DebugCrash("Unrecognized @WALLS section \"" + firstTokenType + "\".");
+				DebugCrash("Unrecognized @WALLS section \"" + firstTokenType.toString() + "\".");
 			}
 		}
 		else if (wallState.get() == nullptr)
 		{
 			// No existing wall state, so this line contains a "loose" texture name.
-			const std::vector<std::string> tokens = String::split(line, '#');
+			StringView::split(line, '#', tokens);
 
 			if (tokens.size() == 1)
 			{
 				// A regular filename (like an .IMG).
-				this->voxelTextures.push_back(VoxelTextureData(line));
+				this->voxelTextures.push_back(VoxelTextureData(line.toString()));
 			}
 			else
 			{
 				// A .SET filename. Expand it for each of the .SET indices.
-				const std::string textureName = String::trimBack(tokens.at(0));
-				const int setSize = std::stoi(tokens.at(1));
+				const std::string textureName = StringView::trimBack(tokens.at(0)).toString();
+				const int setSize = StringView::toInt(tokens.at(1));
 
 				for (int i = 0; i < setSize; i++)
 				{
@@ -543,16 +612,16 @@ INFFile::INFFile(const std::string &filename)
 		{
 			// There is existing wall state, so this line contains a texture name associated 
 			// with some '*' section(s).
-			const int currentIndex = [this, &wallState, &line]()
+			const int currentIndex = [this, &wallState, &tokens, line]()
 			{
 				// If the line contains a '#', it's a .SET file.
-				const std::vector<std::string> tokens = String::split(line, '#');
+				StringView::split(line, '#', tokens);
 
 				// Assign texture data depending on whether the line is for a .SET file.
 				if (tokens.size() == 1)
 				{
 					// Just a regular texture (like an .IMG).
-					wallState->textureName = line;
+					wallState->textureName = line.toString();
 
 					this->voxelTextures.push_back(VoxelTextureData(wallState->textureName));
 					return static_cast<int>(this->voxelTextures.size()) - 1;
@@ -560,8 +629,8 @@ INFFile::INFFile(const std::string &filename)
 				else
 				{
 					// Left side is the filename, right side is the .SET size.
-					wallState->textureName = String::trimBack(tokens.at(0));
-					const int setSize = std::stoi(tokens.at(1));
+					wallState->textureName = StringView::trimBack(tokens.at(0)).toString();
+					const int setSize = StringView::toInt(tokens.at(1));
 
 					for (int i = 0; i < setSize; i++)
 					{
@@ -618,7 +687,7 @@ INFFile::INFFile(const std::string &filename)
 		}
 	};
 
-	auto parseFlatLine = [this, &flatState](const std::string &line)
+	auto parseFlatLine = [this, &flatState, &tokens](StringView line)
 	{
 		const char TYPE_CHAR = '*';
 
@@ -632,21 +701,20 @@ INFFile::INFFile(const std::string &filename)
 				flatState = std::make_unique<FlatState>();
 			}
 
-			const std::string ITEM_STR = "ITEM";
+			const char ITEM_STR[] = "ITEM";
 
 			// See what the type in the line is.
-			const std::vector<std::string> tokens = String::split(line);
-			const std::string firstToken = tokens.at(0);
-			const std::string firstTokenType = firstToken.substr(1, firstToken.size() - 1);
+			StringView::split(line, ' ', tokens);
+			const StringView firstTokenType = tokens.at(0).substr(1);
 
 			if (firstTokenType == ITEM_STR)
 			{
 				flatState->mode = FlatState::Mode::Item;
-				flatState->itemID = std::stoi(tokens.at(1));
+				flatState->itemID = StringView::toInt(tokens.at(1));
 			}
 			else
 			{
-				DebugCrash("Unrecognized @FLATS section \"" + firstTokenType + "\".");
+				DebugCrash("Unrecognized @FLATS section \"" + firstTokenType.toString() + "\".");
 			}
 		}
 		else
@@ -658,27 +726,17 @@ INFFile::INFFile(const std::string &filename)
 			// modifiers on the right. Each token might be split by tabs or spaces, so always 
 			// check for both cases. The texture name always has a tab on the right though 
 			// (if there's any whitespace).
-			const std::vector<std::string> tokens = [&line, MODIFIER_SEPARATOR]()
+			// Special case at *ITEM 55 in CRYSTAL3.INF: do not split on whitespace,
+			// because there are no modifiers.
+			if (line.find(MODIFIER_SEPARATOR) == StringView::NPOS)
 			{
-				// Trim any extra whitespace (so there are no adjacent duplicates).
-				const std::string trimmedStr = String::trimExtra(line);
-
-				// Replace tabs with spaces.
-				const std::string replacedStr = String::replace(trimmedStr, '\t', ' ');
-
-				// Special case at *ITEM 55 in CRYSTAL3.INF: do not split on whitespace,
-				// because there are no modifiers.
-				if (replacedStr.find(MODIFIER_SEPARATOR) == std::string::npos)
-				{
-					return std::vector<std::string>{ replacedStr };
-				}
-				else
-				{
-					// To do: refine String::split() to account for whitespace in general so
-					// we can avoid doing the extra steps above.
-					return String::split(replacedStr);
-				}
-			}();
+				tokens.clear();
+				tokens.push_back(line);
+			}
+			else
+			{
+				splitWhitespace(line, tokens);
+			}
 
 			// Creature flats are between *ITEM 32 and *ITEM 54. These do not need their
 			// texture line parsed.
@@ -696,10 +754,10 @@ INFFile::INFFile(const std::string &filename)
 				else
 				{
 					// It's not a creature flat. Return the string, excluding any dash.
-					const std::string &firstToken = tokens.at(0);
-					const bool hasDash = firstToken.at(0) == '-'; // To do: not sure what this is.
-					return String::toUppercase(hasDash ? 
-						firstToken.substr(1, firstToken.size() - 1) : firstToken);
+					const StringView firstToken = tokens.at(0);
+					const bool hasDash = firstToken.front() == '-'; // To do: not sure what this is.
+					return String::toUppercase(collapseWhitespace(
+						hasDash ? firstToken.substr(1) : firstToken));
 				}
 			}();
 
@@ -734,13 +792,15 @@ INFFile::INFFile(const std::string &filename)
 					const char LIGHT_MODIFIER = 'S';
 					const char Y_OFFSET_MODIFIER = 'Y';
 
-					const std::string &modifierStr = tokens.at(i);
-					const char modifierType = std::toupper(modifierStr.at(0));
+					const StringView modifierStr = tokens.at(i);
+					const char modifierType = std::toupper(modifierStr.front());
 
 					// The modifier value comes after the modifier separator.
-					const std::vector<std::string> modifierTokens =
-						String::split(modifierStr, MODIFIER_SEPARATOR);
-					const int modifierValue = std::stoi(modifierTokens.at(1));
+					const size_t separatorIndex = modifierStr.find(MODIFIER_SEPARATOR);
+					DebugAssert(separatorIndex != StringView::NPOS,
+						"Missing modifier value in \"" + modifierStr.toString() + "\".");
+					const int modifierValue =
+						StringView::toInt(modifierStr.substr(separatorIndex + 1));
 
 					if (modifierType == FLAT_PROPERTIES_MODIFIER)
 					{
@@ -775,17 +835,17 @@ INFFile::INFFile(const std::string &filename)
 		}
 	};
 
-	auto parseSoundLine = [this](const std::string &line)
+	auto parseSoundLine = [this, &tokens](StringView line)
 	{
 		// Split into the filename and ID. Make sure the filename is all caps.
-		const std::vector<std::string> tokens = String::split(line);
-		const std::string vocFilename = String::toUppercase(tokens.front());
-		const int vocID = std::stoi(tokens.at(1));
+		StringView::split(line, ' ', tokens);
+		const std::string vocFilename = String::toUppercase(tokens.front().toString());
+		const int vocID = StringView::toInt(tokens.at(1));
 
 		this->sounds.insert(std::make_pair(vocID, vocFilename));
 	};
 
-	auto parseTextLine = [this, &textState, &flushTextState](const std::string &line)
+	auto parseTextLine = [this, &textState, &tokens, &flushTextState](StringView line)
 	{
 		// Start a new text state after each *TEXT tag.
 		const char TEXT_CHAR = '*';
@@ -797,10 +857,10 @@ INFFile::INFFile(const std::string &filename)
 		// Otherwise, parse the line based on the current mode.
 		if (line.front() == TEXT_CHAR)
 		{
-			const std::vector<std::string> tokens = String::split(line);
+			StringView::split(line, ' ', tokens);
 
 			// Get the ID after *TEXT.
-			const int textID = std::stoi(tokens.at(1));
+			const int textID = StringView::toInt(tokens.at(1));
 
 			// If there is existing text state present, save it.
 			if (textState.get() != nullptr)
@@ -814,8 +874,7 @@ INFFile::INFFile(const std::string &filename)
 		else if (line.front() == KEY_INDEX_CHAR)
 		{
 			// Get key number. No need for a key section here since it's only one line.
-			const std::string keyStr = line.substr(1, line.size() - 1);
-			const int keyNumber = std::stoi(keyStr);
+			const int keyNumber = StringView::toInt(line.substr(1));
 
 			textState->mode = TextState::Mode::Key;
 			textState->keyData = std::make_unique<KeyData>(keyNumber);
@@ -823,10 +882,9 @@ INFFile::INFFile(const std::string &filename)
 		else if (line.front() == RIDDLE_CHAR)
 		{
 			// Get riddle numbers.
-			const std::string numbers = line.substr(1, line.size() - 1);
-			const std::vector<std::string> tokens = String::split(numbers);
-			const int firstNumber = std::stoi(tokens.at(0));
-			const int secondNumber = std::stoi(tokens.at(1));
+			StringView::split(line.substr(1), ' ', tokens);
+			const int firstNumber = StringView::toInt(tokens.at(0));
+			const int secondNumber = StringView::toInt(tokens.at(1));
 
 			textState->mode = TextState::Mode::Riddle;
 			textState->riddleState = std::make_unique<TextState::RiddleState>(
@@ -840,7 +898,7 @@ INFFile::INFFile(const std::string &filename)
 			textState->textData = std::make_unique<TextData>(displayedOnce);
 
 			// Append the rest of the line to the text data.
-			textState->textData->text += line.substr(1, line.size() - 1) + '\n';
+			appendLine(textState->textData->text, line.substr(1));
 		}
 		else if (textState->mode == TextState::Mode::Riddle)
 		{
@@ -850,15 +908,14 @@ INFFile::INFFile(const std::string &filename)
 			if (line.front() == ANSWER_CHAR)
 			{
 				// Add the answer to the answers data.
-				const std::string answer = line.substr(1, line.size() - 1);
-				textState->riddleState->data.answers.push_back(answer);
+				textState->riddleState->data.answers.push_back(line.substr(1).toString());
 			}
 			else if (line.front() == RESPONSE_SECTION_CHAR)
 			{
 				// Change riddle mode based on the response section.
-				const std::string CORRECT_STR = "CORRECT";
-				const std::string WRONG_STR = "WRONG";
-				const std::string responseSection = line.substr(1, line.size() - 1);
+				const char CORRECT_STR[] = "CORRECT";
+				const char WRONG_STR[] = "WRONG";
+				const StringView responseSection = line.substr(1);
 
 				if (responseSection == CORRECT_STR)
 				{
@@ -872,23 +929,23 @@ INFFile::INFFile(const std::string &filename)
 			else if (textState->riddleState->mode == TextState::RiddleState::Mode::Riddle)
 			{
 				// Read the line into the riddle text.
-				textState->riddleState->data.riddle += line + '\n';
+				appendLine(textState->riddleState->data.riddle, line);
 			}
 			else if (textState->riddleState->mode == TextState::RiddleState::Mode::Correct)
 			{
 				// Read the line into the correct text.
-				textState->riddleState->data.correct += line + '\n';
+				appendLine(textState->riddleState->data.correct, line);
 			}
 			else if (textState->riddleState->mode == TextState::RiddleState::Mode::Wrong)
 			{
 				// Read the line into the wrong text.
-				textState->riddleState->data.wrong += line + '\n';
+				appendLine(textState->riddleState->data.wrong, line);
 			}
 		}
 		else if (textState->mode == TextState::Mode::Text)
 		{
 			// Read the line into the text data.
-			textState->textData->text += line + '\n';
+			appendLine(textState->textData->text, line);
 		}
 		else
 		{
@@ -911,7 +968,7 @@ INFFile::INFFile(const std::string &filename)
 			}
 
 			// Read the line into the text data.
-			textState->textData->text += line + '\n';
+			appendLine(textState->textData->text, line);
 		}
 	};
 
@@ -919,13 +976,34 @@ INFFile::INFFile(const std::string &filename)
 	// tag even when it's needed.
 	ParseMode parseMode = ParseMode::Floors;
 
-	std::stringstream ss(text);
-	std::string line;
+	// The sections that an '@' line can start.
+	const std::array<std::pair<const char*, ParseMode>, 5> Sections =
+	{
+		{
+			{ "@FLOORS", ParseMode::Floors },
+			{ "@WALLS", ParseMode::Walls },
+			{ "@FLATS", ParseMode::Flats },
+			{ "@SOUND", ParseMode::Sound },
+			{ "@TEXT", ParseMode::Text }
+		}
+	};
 
-	while (std::getline(ss, line))
+	size_t lineStart = 0;
+	while (lineStart < text.size())
 	{
 		const char SECTION_SEPARATOR = '@';
 
+		// Get the next line like std::getline(), without any carriage returns at the end
+		// (newlines are nicer to work with).
+		const size_t lineSize = text.substr(lineStart).find('\n');
+		StringView line = text.substr(lineStart, lineSize);
+		lineStart = (lineSize != StringView::NPOS) ? (lineStart + lineSize + 1) : text.size();
+
+		while (!line.empty() && (line.back() == '\r'))
+		{
+			line = line.substr(0, line.size() - 1);
+		}
+
 		// First check if the line is empty. Then check the first character for any changes 
 		// in the current section. Otherwise, parse the line depending on the current mode.
 		if (line.size() == 0)
@@ -946,22 +1024,18 @@ INFFile::INFFile(const std::string &filename)
 		}
 		else if (line.front() == SECTION_SEPARATOR)
 		{
-			const std::unordered_map<std::string, ParseMode> Sections =
-			{
-				{ "@FLOORS", ParseMode::Floors },
-				{ "@WALLS", ParseMode::Walls },
-				{ "@FLATS", ParseMode::Flats },
-				{ "@SOUND", ParseMode::Sound },
-				{ "@TEXT", ParseMode::Text }
-			};
-
 			// Separate the '@' token from other things in the line (like @FLATS NOSHOW).
-			line = String::split(line).front();
+			const StringView sectionName = line.substr(0, line.find(' '));
 
 			// See which token the section is.
-			const auto sectionIter = Sections.find(line);
+			const auto sectionIter = std::find_if(Sections.begin(), Sections.end(),
+				[sectionName](const std::pair<const char*, ParseMode> &section)
+			{
+				return sectionName == section.first;
+			});
+
 			DebugAssert(sectionIter != Sections.end(),
-				"Unrecognized .INF section \"" + line + "\".");
+				"Unrecognized .INF section \"" + sectionName.toString() + "\".");
 
 			// Flush any existing state.
 			flushAllStates();
@@ -997,6 +1071,28 @@ INFFile::INFFile(const std::string &filename)
 	flushAllStates();
 }
 
+const INFFile &INFFile::get(const std::string &filename)
+{
+	const AssetName key(filename);
+
+	{
+		std::lock_guard<std::mutex> lock(INFFile::cacheMutex);
+		const auto iter = INFFile::cache.find(key);
+		if (iter != INFFile::cache.end())
+		{
+			return *iter->second;
+		}
+	}
+
+	// Parse without the lock so other files can be looked up meanwhile. If another thread
+	// parsed the same file first, its copy is kept.
+	std::unique_ptr<const INFFile> inf = std::make_unique<const INFFile>(filename);
+
+	std::lock_guard<std::mutex> lock(INFFile::cacheMutex);
+	const auto iter = INFFile::cache.emplace(key, std::move(inf)).first;
+	return *iter->second;
+}
+
 const std::vector<INFFile::VoxelTextureData> &INFFile::getVoxelTextures() const
 {
 	return this->voxelTextures;
@@ -1046,6 +1142,11 @@ int INFFile::getMenuIndex(int textureID) const
 		static_cast<int>(iter - this->menus.begin()) : -1;
 }
 
+int INFFile::getFlatCount() const
+{
+	return static_cast<int>(this->flats.size());
+}
+
 const INFFile::FlatData &INFFile::getFlat(int index) const
 {
 	return this->flats.at(index);
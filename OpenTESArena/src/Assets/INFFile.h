@@ -3,10 +3,13 @@
 
 #include <array>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "AssetName.h"
+
 // An .INF file contains definitions of what the IDs in a .MIF file point to. These 
 // are mostly texture IDs, but also text IDs and sound IDs telling which voxels have 
 // which kinds of triggers, etc..
@@ -133,9 +136,19 @@ private:
 
 	// Ceiling data (height, box scale(?), etc.).
 	CeilingData ceiling;
+
+	// Every .INF file parsed by get(), by filename ignoring case. They're never freed,
+	// since there are only a few dozen and they're small.
+	static std::unordered_map<AssetName, std::unique_ptr<const INFFile>, AssetName::Hash> cache;
+	static std::mutex cacheMutex;
 public:
 	INFFile(const std::string &filename);
 
+	// Gets the .INF file with the given name, decrypting and parsing it only the first time
+	// it's asked for. The reference stays valid for the rest of the program. Safe to call
+	// from any thread.
+	static const INFFile &get(const std::string &filename);
+
 	// Arbitrary index used for unset indices.
 	static const int NO_INDEX;
 
@@ -145,6 +158,7 @@ public:
 	const int *getBoxSide(int index) const;
 	const int *getMenu(int index) const;
 	int getMenuIndex(int textureID) const; // Temporary hack?
+	int getFlatCount() const;
 	const FlatData &getFlat(int index) const;
 	const FlatData &getItem(int index) const;
 	const std::string &getSound(int index) const;
@@ -5,6 +5,7 @@
 #include "MIFFile.h"
 #include "../Utilities/Bytes.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/Profiler.h"
 
 #include "components/vfs/manager.hpp"
 
@@ -45,6 +46,9 @@ namespace
 MIFFile::Level::Level()
 {
 	this->numf = 0;
+	this->florOffset = -1;
+	this->map1Offset = -1;
+	this->map2Offset = -1;
 }
 
 const uint8_t MIFFile::DRY_CHASM = 0xC;
@@ -52,15 +56,15 @@ const uint8_t MIFFile::WET_CHASM = 0xD;
 const uint8_t MIFFile::LAVA_CHASM = 0xE;
 const double MIFFile::ARENA_UNITS = 128.0;
 
+std::unordered_map<AssetName, std::unique_ptr<const MIFFile>, AssetName::Hash> MIFFile::cache;
+std::mutex MIFFile::cacheMutex;
+
 MIFFile::MIFFile(const std::string &filename)
 {
-	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
-	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
+	ProfileScope("MIFFile::MIFFile");
 
-	stream->seekg(0, std::ios::end);
-	std::vector<uint8_t> srcData(stream->tellg());
-	stream->seekg(0, std::ios::beg);
-	stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+	const VFS::DataView srcData = VFS::Manager::get().openView(filename);
+	DebugAssert(srcData.isOpen(), "Could not open \"" + filename + "\".");
 
 	// Get data from the header (after "MHDR"). Constant for all levels. The header 
 	// size should be 61.
@@ -147,6 +151,28 @@ const std::array<Double2, 4> &MIFFile::getStartPoints() const
 	return this->startPoints;
 }
 
+const MIFFile &MIFFile::get(const std::string &filename)
+{
+	const AssetName key(filename);
+
+	{
+		std::lock_guard<std::mutex> lock(MIFFile::cacheMutex);
+		const auto iter = MIFFile::cache.find(key);
+		if (iter != MIFFile::cache.end())
+		{
+			return *iter->second;
+		}
+	}
+
+	// Parse without the lock so other files can be looked up meanwhile. If another thread
+	// parsed the same file first, its copy is kept.
+	std::unique_ptr<const MIFFile> mif = std::make_unique<const MIFFile>(filename);
+
+	std::lock_guard<std::mutex> lock(MIFFile::cacheMutex);
+	const auto iter = MIFFile::cache.emplace(key, std::move(mif)).first;
+	return *iter->second;
+}
+
 const std::vector<MIFFile::Level> &MIFFile::getLevels() const
 {
 	return this->levels;
@@ -160,6 +186,21 @@ int MIFFile::Level::load(const uint8_t *levelStart)
 	// Move the tag pointer while there are tags to read in the current level.
 	const uint8_t *tagStart = levelStart + 6;
 	const uint8_t *levelEnd = tagStart + levelSize;
+
+	// Reserve room for all of the level's voxel tags first, so decoding each one doesn't
+	// move the ones before it. Every tag's size is at the same place.
+	size_t voxelCount = 0;
+	for (const uint8_t *ptr = tagStart; ptr < levelEnd; ptr += Bytes::getLE16(ptr + 4) + 6)
+	{
+		const std::string tag = std::string(ptr, ptr + 4);
+		if ((tag == Tag_FLOR) || (tag == Tag_MAP1) || (tag == Tag_MAP2))
+		{
+			voxelCount += Bytes::getLE16(ptr + 6) / 2;
+		}
+	}
+
+	this->voxels.reserve(voxelCount);
+
 	while (tagStart < levelEnd)
 	{
 		// Check what the four letter tag is (FLOR, MAP1, etc., never LEVL).
@@ -183,10 +224,29 @@ int MIFFile::Level::load(const uint8_t *levelStart)
 	return static_cast<int>(levelEnd - levelStart);
 }
 
+int MIFFile::Level::loadVoxels(MIFFile::Level &level, const uint8_t *tagStart, int *offset)
+{
+	const uint16_t compressedSize = Bytes::getLE16(tagStart + 4);
+	const uint16_t uncompressedSize = Bytes::getLE16(tagStart + 6);
+
+	// Append space for these voxels, using 2 bytes per voxel.
+	*offset = static_cast<int>(level.voxels.size());
+	level.voxels.resize(level.voxels.size() + (uncompressedSize / 2), 0);
+
+	// Decode the data with type 8 decompression straight into the buffer (staying in
+	// little-endian).
+	const uint8_t *tagDataStart = tagStart + 8;
+	uint8_t *dstBegin = reinterpret_cast<uint8_t*>(level.voxels.data() + *offset);
+	Compression::decodeType08(tagDataStart, tagDataStart + compressedSize, dstBegin,
+		dstBegin + uncompressedSize);
+
+	return compressedSize + 6;
+}
+
 int MIFFile::Level::getHeight() const
 {
 	// If there is MAP2 data, then check through each voxel to find the highest point.
-	if (this->map2.size() > 0)
+	if (this->map2Offset >= 0)
 	{
 		// To do: look at MAP2 voxels and determine highest column.
 		return 6;
@@ -198,6 +258,21 @@ int MIFFile::Level::getHeight() const
 	}
 }
 
+const uint16_t *MIFFile::Level::getFLOR() const
+{
+	return (this->florOffset >= 0) ? (this->voxels.data() + this->florOffset) : nullptr;
+}
+
+const uint16_t *MIFFile::Level::getMAP1() const
+{
+	return (this->map1Offset >= 0) ? (this->voxels.data() + this->map1Offset) : nullptr;
+}
+
+const uint16_t *MIFFile::Level::getMAP2() const
+{
+	return (this->map2Offset >= 0) ? (this->voxels.data() + this->map2Offset) : nullptr;
+}
+
 int MIFFile::Level::loadFLAT(MIFFile::Level &level, const uint8_t *tagStart)
 {
 	const uint16_t size = Bytes::getLE16(tagStart + 4);
@@ -212,22 +287,7 @@ int MIFFile::Level::loadFLAT(MIFFile::Level &level, const uint8_t *tagStart)
 
 int MIFFile::Level::loadFLOR(MIFFile::Level &level, const uint8_t *tagStart)
 {
-	const uint16_t compressedSize = Bytes::getLE16(tagStart + 4);
-	const uint16_t uncompressedSize = Bytes::getLE16(tagStart + 6);
-
-	// Allocate space for this floor, using 2 bytes per voxel.
-	std::vector<uint8_t> decomp = std::vector<uint8_t>(uncompressedSize);
-	std::fill(decomp.begin(), decomp.end(), 0);
-
-	// Decode the data with type 8 decompression.
-	const uint8_t *tagDataStart = tagStart + 8;
-	Compression::decodeType08(tagDataStart, tagDataStart + compressedSize, decomp);
-
-	// Write into 16-bit vector (in little-endian).
-	level.flor.resize(decomp.size() / 2);
-	std::copy(decomp.begin(), decomp.end(), reinterpret_cast<uint8_t*>(level.flor.data()));
-
-	return compressedSize + 6;
+	return MIFFile::Level::loadVoxels(level, tagStart, &level.florOffset);
 }
 
 int MIFFile::Level::loadINFO(MIFFile::Level &level, const uint8_t *tagStart)
@@ -293,42 +353,12 @@ int MIFFile::Level::loadLOOT(MIFFile::Level &level, const uint8_t *tagStart)
 
 int MIFFile::Level::loadMAP1(MIFFile::Level &level, const uint8_t *tagStart)
 {
-	const uint16_t compressedSize = Bytes::getLE16(tagStart + 4);
-	const uint16_t uncompressedSize = Bytes::getLE16(tagStart + 6);
-
-	// Allocate space for this floor, using 2 bytes per voxel.
-	std::vector<uint8_t> decomp = std::vector<uint8_t>(uncompressedSize);
-	std::fill(decomp.begin(), decomp.end(), 0);
-
-	// Decode the data with type 8 decompression.
-	const uint8_t *tagDataStart = tagStart + 8;
-	Compression::decodeType08(tagDataStart, tagDataStart + compressedSize, decomp);
-
-	// Write into 16-bit vector (in little-endian).
-	level.map1.resize(decomp.size() / 2);
-	std::copy(decomp.begin(), decomp.end(), reinterpret_cast<uint8_t*>(level.map1.data()));
-
-	return compressedSize + 6;
+	return MIFFile::Level::loadVoxels(level, tagStart, &level.map1Offset);
 }
 
 int MIFFile::Level::loadMAP2(MIFFile::Level &level, const uint8_t *tagStart)
 {
-	const uint16_t compressedSize = Bytes::getLE16(tagStart + 4);
-	const uint16_t uncompressedSize = Bytes::getLE16(tagStart + 6);
-
-	// Allocate space for this floor, using 2 bytes per voxel.
-	std::vector<uint8_t> decomp = std::vector<uint8_t>(uncompressedSize);
-	std::fill(decomp.begin(), decomp.end(), 0);
-
-	// Decode the data with type 8 decompression.
-	const uint8_t *tagDataStart = tagStart + 8;
-	Compression::decodeType08(tagDataStart, tagDataStart + compressedSize, decomp);
-
-	// Write into 16-bit vector (in little-endian).
-	level.map2.resize(decomp.size() / 2);
-	std::copy(decomp.begin(), decomp.end(), reinterpret_cast<uint8_t*>(level.map2.data()));
-
-	return compressedSize + 6;
+	return MIFFile::Level::loadVoxels(level, tagStart, &level.map2Offset);
 }
 
 int MIFFile::Level::loadNAME(MIFFile::Level &level, const uint8_t *tagStart)
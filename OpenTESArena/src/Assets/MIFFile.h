@@ -3,9 +3,13 @@
 
 #include <array>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "AssetName.h"
 #include "../Math/Vector2.h"
 
 // A MIF file contains map information. It defines the dimensions of a particular area 
@@ -32,9 +36,13 @@ public:
 		std::string name, info; // Name of level and associated INF filename.
 		int numf; // Number of floor textures.
 
-		// Various data, not always present. FLOR and MAP1 are probably always present.
+		// FLOR, MAP1, and MAP2 voxels, decoded into one buffer per level. Offsets are -1 for
+		// tags the level doesn't have. FLOR and MAP1 are probably always present.
 		// - To do: maybe store MAP2 data with each voxel's extended height?
-		std::vector<uint16_t> flor, map1, map2;
+		std::vector<uint16_t> voxels;
+		int florOffset, map1Offset, map2Offset;
+
+		// Various data, not always present.
 		std::vector<uint8_t> flat, inns, loot, targ;
 		std::vector<MIFFile::Level::Lock> lock;
 		std::vector<MIFFile::Level::Trigger> trig;
@@ -50,6 +58,12 @@ public:
 		// in the MAP2 data, otherwise it drops back to a default value.
 		int getHeight() const;
 
+		// Read-only views of the level's voxels, two bytes each (little-endian) in .MIF
+		// order, or null if the level doesn't have them. They're valid as long as the level.
+		const uint16_t *getFLOR() const;
+		const uint16_t *getMAP1() const;
+		const uint16_t *getMAP2() const;
+
 		// Loading methods for each .MIF level tag (FLOR, MAP1, etc.), called by Level::load(). 
 		// The return value is the offset from the current tag to where the next tag would be.
 		static int loadFLAT(MIFFile::Level &level, const uint8_t *tagStart);
@@ -64,6 +78,10 @@ public:
 		static int loadNUMF(MIFFile::Level &level, const uint8_t *tagStart);
 		static int loadTARG(MIFFile::Level &level, const uint8_t *tagStart);
 		static int loadTRIG(MIFFile::Level &level, const uint8_t *tagStart);
+
+		// Decodes a FLOR, MAP1, or MAP2 tag onto the end of the level's voxels and sets the
+		// given offset to where it starts.
+		static int loadVoxels(MIFFile::Level &level, const uint8_t *tagStart, int *offset);
 	};
 private:
 	int width, depth;
@@ -71,11 +89,22 @@ private:
 	std::array<Double2, 4> startPoints; // Entrance locations for the level (not always full).
 	std::vector<MIFFile::Level> levels;
 	std::string name;
+
+	// Every .MIF file parsed by get(), by filename ignoring case. They're never freed, so
+	// locations visited again and ones prepared ahead of travel don't have to be parsed
+	// twice.
+	static std::unordered_map<AssetName, std::unique_ptr<const MIFFile>, AssetName::Hash> cache;
+	static std::mutex cacheMutex;
 	// Should a vector of levels be exposed, or does the caller want a nicer format?
 	// VoxelGrid? Array of VoxelData?
 public:
 	MIFFile(const std::string &filename);
 
+	// Gets the .MIF file with the given name, parsing it only the first time it's asked
+	// for. The reference stays valid for the rest of the program. Safe to call from any
+	// thread.
+	static const MIFFile &get(const std::string &filename);
+
 	// Identifiers for various chasms in Arena's voxel data.
 	static const uint8_t DRY_CHASM;
 	static const uint8_t WET_CHASM;
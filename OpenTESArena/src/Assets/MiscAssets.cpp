@@ -1,6 +1,9 @@
 #include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <chrono>
+#include <deque>
+#include <functional>
 #include <numeric>
 #include <sstream>
 
@@ -11,7 +14,9 @@
 #include "../Math/Random.h"
 #include "../Utilities/Bytes.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/JobSystem.h"
 #include "../Utilities/Platform.h"
+#include "../Utilities/Profiler.h"
 #include "../Utilities/String.h"
 #include "../World/ClimateType.h"
 
@@ -19,6 +24,16 @@
 
 namespace
 {
+	// How long one of the parsers in MiscAssets::init() took.
+	struct ParserTiming
+	{
+		const char *name;
+		double seconds;
+
+		ParserTiming(const char *name)
+			: name(name), seconds(0.0) { }
+	};
+
 	// Discriminated union for name composition rules used with NAMECHNK.DAT.
 	// Each rule is either:
 	// - Index
@@ -312,55 +327,114 @@ MiscAssets::MiscAssets()
 	// Initialized by init().
 }
 
-void MiscAssets::init()
+void MiscAssets::init(const AssetCache &assetCache, JobSystem &jobSystem)
 {
+	ProfileScope("MiscAssets::init");
+
 	DebugMention("Initializing.");
 
+	this->assetCache = assetCache;
+
+	// Each file goes into its own members, so the parsers run as separate jobs. Only
+	// CLASSES.DAT needs the executable data first.
+	// A deque so each job's timing stays in place while more are added.
+	std::deque<ParserTiming> timings;
+
+	// Adds a job that runs the parser and records how long it took.
+	auto addParser = [&jobSystem, &timings](const char *name,
+		const std::function<void()> &parser, const std::vector<JobSystem::JobHandle> &dependencies)
+	{
+		timings.push_back(ParserTiming(name));
+		ParserTiming &timing = timings.back();
+
+		return jobSystem.add([&timing, parser]()
+		{
+			const auto startTime = std::chrono::steady_clock::now();
+			parser();
+			timing.seconds = std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - startTime).count();
+		}, dependencies);
+	};
+
+	const std::vector<JobSystem::JobHandle> noDependencies;
+
 	// Load the executable data.
-	this->parseExecutableData();
+	const JobSystem::JobHandle exeJob = addParser("executable", [this, &assetCache]()
+	{
+		this->parseExecutableData(assetCache);
+	}, noDependencies);
+
+	const std::vector<JobSystem::JobHandle> jobs =
+	{
+		exeJob,
+
+		// Read in CLASSES.DAT.
+		addParser("CLASSES.DAT", [this]() { this->parseClasses(this->getExeData()); },
+			{ exeJob }),
+
+		// Read in TEMPLATE.DAT, using "#..." as keys and the text as values.
+		addParser("TEMPLATE.DAT", [this]() { this->parseTemplateDat(); }, noDependencies),
+
+		// Read in QUESTION.TXT and create character question objects.
+		addParser("QUESTION.TXT", [this]() { this->parseQuestionTxt(); }, noDependencies),
 
-	// Read in TEMPLATE.DAT, using "#..." as keys and the text as values.
-	this->parseTemplateDat();
+		// Read in DUNGEON.TXT and pair each dungeon name with its description.
+		addParser("DUNGEON.TXT", [this]() { this->parseDungeonTxt(); }, noDependencies),
 
-	// Read in QUESTION.TXT and create character question objects.
-	this->parseQuestionTxt();
+		// Read in ARTFACT1.DAT and ARTFACT2.DAT.
+		addParser("ARTFACT*.DAT", [this]() { this->parseArtifactText(); }, noDependencies),
 
-	// Read in CLASSES.DAT.
-	this->parseClasses(this->getExeData());
+		// Read in EQUIP.DAT, MUGUILD.DAT, SELLING.DAT, and TAVERN.DAT.
+		addParser("trade text", [this]() { this->parseTradeText(); }, noDependencies),
 
-	// Read in DUNGEON.TXT and pair each dungeon name with its description.
-	this->parseDungeonTxt();
+		// Read in NAMECHNK.DAT.
+		addParser("NAMECHNK.DAT", [this]() { this->parseNameChunks(); }, noDependencies),
 
-	// Read in ARTFACT1.DAT and ARTFACT2.DAT.
-	this->parseArtifactText();
+		// Read in SPELLSG.65.
+		addParser("SPELLSG.65", [this]() { this->parseStandardSpells(); }, noDependencies),
 
-	// Read in EQUIP.DAT, MUGUILD.DAT, SELLING.DAT, and TAVERN.DAT.
-	this->parseTradeText();
+		// Read in SPELLMKR.TXT.
+		addParser("SPELLMKR.TXT", [this]() { this->parseSpellMakerDescriptions(); },
+			noDependencies),
 
-	// Read in NAMECHNK.DAT.
-	this->parseNameChunks();
+		// Read city data file.
+		addParser("CITYDATA.00", [this]() { this->cityDataFile.init("CITYDATA.00"); },
+			noDependencies),
 
-	// Read in SPELLSG.65.
-	this->parseStandardSpells();
+		// Read in the world map mask data from TAMRIEL.MNU.
+		addParser("TAMRIEL.MNU", [this]() { this->parseWorldMapMasks(); }, noDependencies),
 
-	// Read in SPELLMKR.TXT.
-	this->parseSpellMakerDescriptions();
+		// Read in the terrain map from TERRAIN.IMG.
+		addParser("TERRAIN.IMG", [this]() { this->worldMapTerrain.init(); }, noDependencies)
+	};
 
-	// Read city data file.
-	this->cityDataFile.init("CITYDATA.00");
+	for (const JobSystem::JobHandle &job : jobs)
+	{
+		jobSystem.wait(job);
+	}
 
-	// Read in the world map mask data from TAMRIEL.MNU.
-	this->parseWorldMapMasks();
+	// Slowest first, so the ones worth looking at stand out.
+	std::sort(timings.begin(), timings.end(),
+		[](const ParserTiming &a, const ParserTiming &b)
+	{
+		return a.seconds > b.seconds;
+	});
 
-	// Read in the terrain map from TERRAIN.IMG.
-	this->worldMapTerrain.init();
+	std::string timingText;
+	for (const ParserTiming &timing : timings)
+	{
+		timingText += (timingText.size() > 0 ? ", " : "") + std::string(timing.name) + " " +
+			String::fixedPrecision(timing.seconds * 1000.0, 1) + "ms";
+	}
+
+	DebugMention("Parse times: " + timingText + ".");
 }
 
-void MiscAssets::parseExecutableData()
+void MiscAssets::parseExecutableData(const AssetCache &assetCache)
 {
 	// For now, just read the floppy disk executable.
 	const bool floppyVersion = true;
-	this->exeData.init(floppyVersion);
+	this->exeData.init(floppyVersion, assetCache);
 }
 
 void MiscAssets::parseTemplateDat()
@@ -590,17 +664,17 @@ void MiscAssets::parseClasses(const ExeData &exeData)
 
 	// Now read in the character class data from A.EXE. Some of it also depends on
 	// data from CLASSES.DAT.
-	const auto &classNameStrs = exeData.charClasses.classNames;
-	const auto &allowedArmorsValues = exeData.charClasses.allowedArmors;
-	const auto &allowedShieldsLists = exeData.charClasses.allowedShieldsLists;
-	const auto &allowedShieldsIndices = exeData.charClasses.allowedShieldsIndices;
-	const auto &allowedWeaponsLists = exeData.charClasses.allowedWeaponsLists;
-	const auto &allowedWeaponsIndices = exeData.charClasses.allowedWeaponsIndices;
-	const auto &preferredAttributesStrs = exeData.charClasses.preferredAttributes;
-	const auto &classNumbersToIDsValues = exeData.charClasses.classNumbersToIDs;
-	const auto &initialExpCapValues = exeData.charClasses.initialExperienceCaps;
-	const auto &healthDiceValues = exeData.charClasses.healthDice;
-	const auto &lockpickingDivisorValues = exeData.charClasses.lockpickingDivisors;
+	const auto &classNameStrs = exeData.getCharClasses().classNames;
+	const auto &allowedArmorsValues = exeData.getCharClasses().allowedArmors;
+	const auto &allowedShieldsLists = exeData.getCharClasses().allowedShieldsLists;
+	const auto &allowedShieldsIndices = exeData.getCharClasses().allowedShieldsIndices;
+	const auto &allowedWeaponsLists = exeData.getCharClasses().allowedWeaponsLists;
+	const auto &allowedWeaponsIndices = exeData.getCharClasses().allowedWeaponsIndices;
+	const auto &preferredAttributesStrs = exeData.getCharClasses().preferredAttributes;
+	const auto &classNumbersToIDsValues = exeData.getCharClasses().classNumbersToIDs;
+	const auto &initialExpCapValues = exeData.getCharClasses().initialExperienceCaps;
+	const auto &healthDiceValues = exeData.getCharClasses().healthDice;
+	const auto &lockpickingDivisorValues = exeData.getCharClasses().lockpickingDivisors;
 
 	const int classCount = 18;
 	for (int i = 0; i < classCount; i++)
@@ -928,11 +1002,11 @@ void MiscAssets::parseNameChunks()
 
 void MiscAssets::parseStandardSpells()
 {
-	// The filename has different casing between the floppy and CD version, so use a
-	// case-insensitive open method so it works on case-sensitive systems (i.e., Unix).
+	// The filename has different casing between the floppy and CD version, which the
+	// file system's lookups ignore.
 	const std::string filename = "SPELLSG.65";
 
-	VFS::IStreamPtr stream = VFS::Manager::get().openCaseInsensitive(filename);
+	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
 	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
 
 	stream->seekg(0, std::ios::end);
@@ -1099,6 +1173,11 @@ void MiscAssets::parseWorldMapMasks()
 	}
 }
 
+const AssetCache &MiscAssets::getAssetCache() const
+{
+	return this->assetCache;
+}
+
 const ExeData &MiscAssets::getExeData() const
 {
 	return this->exeData;
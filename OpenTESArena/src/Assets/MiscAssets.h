@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "AssetCache.h"
 #include "CityDataFile.h"
 #include "ExeData.h"
 #include "WorldMapMask.h"
@@ -19,6 +20,7 @@
 // when this object is created.
 
 class ArenaRandom;
+class JobSystem;
 
 enum class ClimateType;
 
@@ -97,6 +99,7 @@ public:
 		void init();
 	};
 private:
+	AssetCache assetCache;
 	ExeData exeData; // Either floppy version or CD version (depends on ArenaPath).
 	std::unordered_map<std::string, std::string> templateDat;
 	std::vector<CharacterQuestion> questionTxt;
@@ -114,7 +117,7 @@ private:
 
 	// Loads the executable associated with the current Arena data path (either A.EXE
 	// for the floppy version or ACD.EXE for the CD version).
-	void parseExecutableData();
+	void parseExecutableData(const AssetCache &assetCache);
 
 	// Load TEMPLATE.DAT, grouping blocks of text by their #ID.
 	void parseTemplateDat();
@@ -148,6 +151,9 @@ private:
 public:
 	MiscAssets();
 
+	// Gets the cache that decoded data and generated levels are kept in.
+	const AssetCache &getAssetCache() const;
+
 	// Gets the ExeData object. There may be slight differences between A.EXE and ACD.EXE,
 	// but only one will be available at a time for the lifetime of the program (dependent
 	// on the Arena path in the options).
@@ -193,7 +199,10 @@ public:
 	// Gets the world map terrain used with climate and travel calculations.
 	const WorldMapTerrain &getWorldMapTerrain() const;
 
-	void init();
+	// Decoded data is read from and written to the asset cache when it's enabled. The
+	// files are parsed in parallel on the job system, and init() returns once all of them
+	// are done.
+	void init(const AssetCache &assetCache, JobSystem &jobSystem);
 };
 
 #endif
@@ -1,7 +1,9 @@
 #include <algorithm>
 
 #include "RCIFile.h"
+#include "../Media/PaletteTable.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/Profiler.h"
 
 #include "components/vfs/manager.hpp"
 
@@ -9,39 +11,49 @@ const int RCIFile::FRAME_WIDTH = 320;
 const int RCIFile::FRAME_HEIGHT = 100;
 const int RCIFile::FRAME_SIZE = RCIFile::FRAME_WIDTH * RCIFile::FRAME_HEIGHT;
 
-RCIFile::RCIFile(const std::string &filename, const Palette &palette)
+RCIFile::RCIFile(const std::string &filename)
 {
-	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
-	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
+	ProfileScope("RCIFile::RCIFile");
 
-	stream->seekg(0, std::ios::end);
-	std::vector<uint8_t> srcData(stream->tellg());
-	stream->seekg(0, std::ios::beg);
-	stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+	const VFS::DataView srcData = VFS::Manager::get().openView(filename);
+	DebugAssert(srcData.isOpen(), "Could not open \"" + filename + "\".");
 
 	// Number of uncompressed frames packed in the RCI.
 	const int frameCount = static_cast<int>(srcData.size()) / RCIFile::FRAME_SIZE;
 
-	// Create an image for each uncompressed frame using the given palette.
+	// Copy out each uncompressed frame.
 	for (int frameIndex = 0; frameIndex < frameCount; frameIndex++)
 	{
-		this->frames.push_back(std::make_unique<uint32_t[]>(RCIFile::FRAME_SIZE));
+		this->rawFrames.push_back(std::make_unique<uint8_t[]>(RCIFile::FRAME_SIZE));
 
 		const int byteOffset = RCIFile::FRAME_SIZE * frameIndex;
-
-		std::transform(srcData.begin() + byteOffset,
+		std::copy(srcData.begin() + byteOffset,
 			srcData.begin() + byteOffset + RCIFile::FRAME_SIZE,
-			this->frames.at(frameIndex).get(),
-			[&palette](uint8_t col) -> uint32_t
-		{
-			return palette.get()[col].toARGB();
-		});
+			this->rawFrames.back().get());
+	}
+}
+
+RCIFile::RCIFile(const std::string &filename, const Palette &palette)
+	: RCIFile(filename)
+{
+	// Create an image for each frame using the given palette.
+	const PaletteTable paletteTable(palette);
+	for (const auto &rawFrame : this->rawFrames)
+	{
+		this->frames.push_back(std::make_unique<uint32_t[]>(RCIFile::FRAME_SIZE));
+
+		paletteTable.expand(rawFrame.get(), RCIFile::FRAME_SIZE, this->frames.back().get());
 	}
 }
 
 int RCIFile::getCount() const
 {
-	return static_cast<int>(this->frames.size());
+	return static_cast<int>(this->rawFrames.size());
+}
+
+uint8_t *RCIFile::getRawPixels(int index) const
+{
+	return this->rawFrames.at(index).get();
 }
 
 uint32_t *RCIFile::getPixels(int index) const
@@ -14,12 +14,16 @@
 class RCIFile
 {
 private:
-	// One unique_ptr for each frame of the RCI.
+	// One unique_ptr for each frame of the RCI. The 32-bit frames are empty if no palette
+	// was given.
+	std::vector<std::unique_ptr<uint8_t[]>> rawFrames;
 	std::vector<std::unique_ptr<uint32_t[]>> frames;
 
 	// Number of bytes in a 320x100 frame (should be 32000).
 	static const int FRAME_SIZE;
 public:
+	// Loads an RCI from file. Without a palette, only the palette indices are kept.
+	RCIFile(const std::string &filename);
 	RCIFile(const std::string &filename, const Palette &palette);
 
 	// All individual frames of an RCI are 320x100.
@@ -29,6 +33,9 @@ public:
 	// Gets the number of frames in the RCI (should be 5).
 	int getCount() const;
 
+	// Gets the raw (unconverted) pixel data for a 320x100 frame of an RCI file.
+	uint8_t *getRawPixels(int index) const;
+
 	// Gets the pixel data for a 320x100 frame of an RCI file.
 	uint32_t *getPixels(int index) const;
 };
@@ -1,25 +1,31 @@
 #include <algorithm>
+#include <iomanip>
+#include <sstream>
 #include <vector>
 
 #include "Compression.h"
 #include "RMDFile.h"
 #include "../Utilities/Bytes.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/MemoryTracker.h"
+#include "../Utilities/Profiler.h"
 
 #include "components/vfs/manager.hpp"
 
 const int RMDFile::WIDTH = 64;
 const int RMDFile::DEPTH = RMDFile::WIDTH;
 
+std::unordered_map<int, RMDFile::CacheEntry> RMDFile::cache;
+std::list<int> RMDFile::cacheOrder;
+size_t RMDFile::cacheBudget = 0;
+std::mutex RMDFile::cacheMutex;
+
 RMDFile::RMDFile(const std::string &filename)
 {
-	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
-	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
+	ProfileScope("RMDFile::RMDFile");
 
-	stream->seekg(0, std::ios::end);
-	std::vector<uint8_t> srcData(stream->tellg());
-	stream->seekg(0, std::ios::beg);
-	stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+	const VFS::DataView srcData = VFS::Manager::get().openView(filename);
+	DebugAssert(srcData.isOpen(), "Could not open \"" + filename + "\".");
 
 	// The first word is the uncompressed length. Some .RMD files (#001 - #004) have 0 for 
 	// this value. They are used for storing uncompressed quarters of cities when in the 
@@ -62,6 +68,74 @@ RMDFile::RMDFile(const std::string &filename)
 	}
 }
 
+void RMDFile::trimCache()
+{
+	if (RMDFile::cacheBudget == 0)
+	{
+		return;
+	}
+
+	while (!RMDFile::cacheOrder.empty() &&
+		((RMDFile::cacheOrder.size() * sizeof(RMDFile)) > RMDFile::cacheBudget))
+	{
+		RMDFile::cache.erase(RMDFile::cacheOrder.back());
+		RMDFile::cacheOrder.pop_back();
+		MemoryTracker::remove(MemoryTag::LevelCaches, sizeof(RMDFile));
+	}
+}
+
+std::string RMDFile::getFilename(int rmdID)
+{
+	std::stringstream ss;
+	ss << std::setw(3) << std::setfill('0') << rmdID;
+	return "WILD" + ss.str() + ".RMD";
+}
+
+std::shared_ptr<const RMDFile> RMDFile::get(int rmdID)
+{
+	{
+		std::lock_guard<std::mutex> lock(RMDFile::cacheMutex);
+		const auto iter = RMDFile::cache.find(rmdID);
+		if (iter != RMDFile::cache.end())
+		{
+			RMDFile::cacheOrder.splice(RMDFile::cacheOrder.begin(), RMDFile::cacheOrder,
+				iter->second.orderIter);
+			return iter->second.rmd;
+		}
+	}
+
+	// Decode without the lock so other blocks can be looked up meanwhile. If another thread
+	// decoded the same block first, its copy is kept.
+	std::shared_ptr<const RMDFile> rmd =
+		std::make_shared<const RMDFile>(RMDFile::getFilename(rmdID));
+
+	std::lock_guard<std::mutex> lock(RMDFile::cacheMutex);
+	const auto iter = RMDFile::cache.find(rmdID);
+	if (iter != RMDFile::cache.end())
+	{
+		RMDFile::cacheOrder.splice(RMDFile::cacheOrder.begin(), RMDFile::cacheOrder,
+			iter->second.orderIter);
+		return iter->second.rmd;
+	}
+
+	RMDFile::cacheOrder.push_front(rmdID);
+	CacheEntry entry;
+	entry.rmd = rmd;
+	entry.orderIter = RMDFile::cacheOrder.begin();
+	RMDFile::cache.emplace(rmdID, std::move(entry));
+	MemoryTracker::add(MemoryTag::LevelCaches, sizeof(RMDFile));
+
+	RMDFile::trimCache();
+	return rmd;
+}
+
+void RMDFile::setCacheBudget(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(RMDFile::cacheMutex);
+	RMDFile::cacheBudget = bytes;
+	RMDFile::trimCache();
+}
+
 const RMDFile::ArrayType &RMDFile::getFLOR() const
 {
 	return this->flor;
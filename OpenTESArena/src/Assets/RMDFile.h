@@ -3,14 +3,40 @@
 
 #include <array>
 #include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+
+// A 64x64 wilderness block with its three floors decoded.
+
+// Decoded blocks are kept in a cache by their wilderness ID, since nearby parts of the
+// wilderness share most of their blocks. Getting one that's cached is only a copy instead
+// of a decompression. Past the cache's budget, the least recently used blocks are dropped.
 
 class RMDFile
 {
 public:
 	typedef std::array<uint16_t, 4096> ArrayType;
 private:
+	// A cached block and its place in the recently used list.
+	struct CacheEntry
+	{
+		std::shared_ptr<const RMDFile> rmd;
+		std::list<int>::iterator orderIter;
+	};
+
+	static std::unordered_map<int, CacheEntry> cache;
+	static std::list<int> cacheOrder; // Wilderness IDs, most recently used first.
+	static size_t cacheBudget; // Zero if unlimited.
+	static std::mutex cacheMutex;
+
 	RMDFile::ArrayType flor, map1, map2;
+
+	// Drops least recently used blocks until the cache fits its budget. The cache mutex
+	// must be locked.
+	static void trimCache();
 public:
 	RMDFile(const std::string &filename);
 
@@ -18,6 +44,17 @@ public:
 	static const int WIDTH;
 	static const int DEPTH;
 
+	// Gets the filename of the block with the given wilderness ID (like WILD001.RMD).
+	static std::string getFilename(int rmdID);
+
+	// Gets the decoded block with the given wilderness ID, decoding it if it isn't cached.
+	// Any thread can call this. The block stays valid while held, even if it leaves the
+	// cache.
+	static std::shared_ptr<const RMDFile> get(int rmdID);
+
+	// Sets how many bytes of decoded blocks the cache can keep (zero for no limit).
+	static void setCacheBudget(size_t bytes);
+
 	// Get voxel data for each floor. Each should be 8192 bytes.
 	const RMDFile::ArrayType &getFLOR() const;
 	const RMDFile::ArrayType &getMAP1() const;
@@ -1,7 +1,9 @@
 #include <algorithm>
 
 #include "SETFile.h"
+#include "../Media/PaletteTable.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/Profiler.h"
 
 #include "components/vfs/manager.hpp"
 
@@ -9,15 +11,14 @@ const int SETFile::CHUNK_WIDTH = 64;
 const int SETFile::CHUNK_HEIGHT = 64;
 const int SETFile::CHUNK_SIZE = SETFile::CHUNK_WIDTH * SETFile::CHUNK_HEIGHT;
 
-SETFile::SETFile(const std::string &filename, const Palette &palette)
+SETFile::SETFile(const std::string &filename)
 {
-	VFS::IStreamPtr stream = VFS::Manager::get().open(filename);
-	DebugAssert(stream != nullptr, "Could not open \"" + filename + "\".");
+	ProfileScope("SETFile::SETFile");
+
+	const VFS::DataView srcView = VFS::Manager::get().openView(filename);
+	DebugAssert(srcView.isOpen(), "Could not open \"" + filename + "\".");
 
-	stream->seekg(0, std::ios::end);
-	std::vector<uint8_t> srcData(stream->tellg());
-	stream->seekg(0, std::ios::beg);
-	stream->read(reinterpret_cast<char*>(srcData.data()), srcData.size());
+	std::vector<uint8_t> srcData(srcView.begin(), srcView.end());
 
 	// There is one .SET file with a file size of 0x3FFF, so it is a special case.
 	const bool isSpecialCase = filename == "TBS2.SET";
@@ -31,26 +32,39 @@ SETFile::SETFile(const std::string &filename, const Palette &palette)
 	// Number of uncompressed chunks packed in the SET.
 	const int chunkCount = static_cast<int>(srcData.size()) / SETFile::CHUNK_SIZE;
 
-	// Create an image for each uncompressed chunk using the given palette.
+	// Copy out each uncompressed chunk.
 	for (int chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
 	{
-		this->chunks.push_back(std::make_unique<uint32_t[]>(SETFile::CHUNK_SIZE));
+		this->rawChunks.push_back(std::make_unique<uint8_t[]>(SETFile::CHUNK_SIZE));
 
 		const int byteOffset = SETFile::CHUNK_SIZE * chunkIndex;
 		const auto chunkStart = srcData.begin() + byteOffset;
 		const auto chunkEnd = chunkStart + SETFile::CHUNK_SIZE;
+		std::copy(chunkStart, chunkEnd, this->rawChunks.back().get());
+	}
+}
 
-		std::transform(chunkStart, chunkEnd, this->chunks.at(chunkIndex).get(),
-			[&palette](uint8_t col) -> uint32_t
-		{
-			return palette.get()[col].toARGB();
-		});
+SETFile::SETFile(const std::string &filename, const Palette &palette)
+	: SETFile(filename)
+{
+	// Create an image for each chunk using the given palette.
+	const PaletteTable paletteTable(palette);
+	for (const auto &rawChunk : this->rawChunks)
+	{
+		this->chunks.push_back(std::make_unique<uint32_t[]>(SETFile::CHUNK_SIZE));
+
+		paletteTable.expand(rawChunk.get(), SETFile::CHUNK_SIZE, this->chunks.back().get());
 	}
 }
 
 int SETFile::getImageCount() const
 {
-	return static_cast<int>(this->chunks.size());
+	return static_cast<int>(this->rawChunks.size());
+}
+
+uint8_t *SETFile::getRawPixels(int index) const
+{
+	return this->rawChunks.at(index).get();
 }
 
 uint32_t *SETFile::getPixels(int index) const
@@ -14,12 +14,16 @@
 class SETFile
 {
 private:
-	// One unique_ptr for each 64x64 image of the SET.
+	// One unique_ptr for each 64x64 image of the SET. The 32-bit chunks are empty if no
+	// palette was given.
+	std::vector<std::unique_ptr<uint8_t[]>> rawChunks;
 	std::vector<std::unique_ptr<uint32_t[]>> chunks;
 
 	// Number of bytes in a 64x64 image (should be 4096).
 	static const int CHUNK_SIZE;
 public:
+	// Loads a SET from file. Without a palette, only the palette indices are kept.
+	SETFile(const std::string &filename);
 	SETFile(const std::string &filename, const Palette &palette);
 
 	// All individual images (chunks) of a SET are 64x64.
@@ -29,6 +33,9 @@ public:
 	// Gets the number of images in the SET.
 	int getImageCount() const;
 
+	// Gets the raw (unconverted) pixel data for a 64x64 chunk of a SET file.
+	uint8_t *getRawPixels(int index) const;
+
 	// Gets the pixel data for a 64x64 chunk of a SET file.
 	uint32_t *getPixels(int index) const;
 };
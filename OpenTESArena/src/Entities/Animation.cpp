@@ -1,41 +1,73 @@
+#include <algorithm>
+#include <cmath>
+
 #include "Animation.h"
+#include "AnimationLibrary.h"
 
-Animation::Animation(const std::vector<int> &ids, double timePerFrame, bool loop)
-	: ids(ids)
+Animation::Animation(int definitionIndex, double phaseOffset)
 {
-	this->timePerFrame = timePerFrame;
-	this->currentTime = 0.0;
-	this->index = 0;
-	this->loop = loop;
+	this->definitionIndex = definitionIndex;
+	this->time = phaseOffset;
 }
 
-int Animation::getCurrentID() const
-{
-	return this->ids.at(!this->isFinished() ? this->index : (this->ids.size() - 1));
-}
+Animation::Animation(int definitionIndex)
+	: Animation(definitionIndex, 0.0) { }
 
-bool Animation::isFinished() const
+int Animation::getDefinitionIndex() const
 {
-	return !this->loop && (this->index == this->ids.size());
+	return this->definitionIndex;
 }
 
-void Animation::tick(double dt)
+int Animation::getFrameIndex(const AnimationLibrary &library) const
 {
-	if (this->index < this->ids.size())
-	{
-		this->currentTime += dt;
+	const AnimationLibrary::Definition &definition =
+		library.getDefinition(this->definitionIndex);
+	const int frameCount = static_cast<int>(definition.ids.size());
 
-		// Step to the next ID if its duration has passed.
-		while (this->currentTime >= this->timePerFrame)
+	if (definition.loop)
+	{
+		// Wrap the shared clock around the animation's length.
+		const double length = definition.timePerFrame * static_cast<double>(frameCount);
+		double loopTime = std::fmod(library.getTime() + this->time, length);
+		if (loopTime < 0.0)
 		{
-			this->currentTime -= this->timePerFrame;
-			this->index++;
-
-			// Return to the beginning if at the end and looping is enabled.
-			if (this->loop && (this->index == this->ids.size()))
-			{
-				this->index = 0;
-			}
+			loopTime += length;
 		}
+
+		const int frameIndex = static_cast<int>(loopTime / definition.timePerFrame);
+		return std::min(frameIndex, frameCount - 1);
+	}
+	else
+	{
+		const int frameIndex = static_cast<int>(this->time / definition.timePerFrame);
+		return std::min(frameIndex, frameCount);
+	}
+}
+
+int Animation::getCurrentID(const AnimationLibrary &library) const
+{
+	const AnimationLibrary::Definition &definition =
+		library.getDefinition(this->definitionIndex);
+	const int frameIndex = this->getFrameIndex(library);
+	return definition.ids[std::min(frameIndex, static_cast<int>(definition.ids.size()) - 1)];
+}
+
+bool Animation::isFinished(const AnimationLibrary &library) const
+{
+	const AnimationLibrary::Definition &definition =
+		library.getDefinition(this->definitionIndex);
+	return !definition.loop &&
+		(this->getFrameIndex(library) == static_cast<int>(definition.ids.size()));
+}
+
+void Animation::tick(const AnimationLibrary &library, double dt)
+{
+	const AnimationLibrary::Definition &definition =
+		library.getDefinition(this->definitionIndex);
+
+	// Only animations that play once keep their own time, and it stops once they're done.
+	if (!definition.loop && !this->isFinished(library))
+	{
+		this->time += dt;
 	}
 }
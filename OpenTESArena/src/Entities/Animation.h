@@ -1,32 +1,37 @@
 #ifndef ANIMATION_H
 #define ANIMATION_H
 
-#include <cstddef>
-#include <vector>
+// Stores the current state of a sprite animation whose definition is in an animation
+// library. Looping animations follow the library's clock offset by a phase, so they have
+// no per-instance timer. Animations that play once keep their own elapsed time.
 
-// Stores the current state of a sprite animation. The IDs each reference a texture
-// in the software renderer.
+class AnimationLibrary;
 
 class Animation
 {
 private:
-	std::vector<int> ids;
-	double timePerFrame, currentTime;
-	size_t index;
-	bool loop;
+	int definitionIndex;
+	double time; // Phase offset for looping animations, elapsed time otherwise.
+
+	// Gets the index of the current frame, which is past the last one when an animation
+	// that doesn't loop is finished.
+	int getFrameIndex(const AnimationLibrary &library) const;
 public:
-	Animation(const std::vector<int> &ids, double timePerFrame, bool loop);
+	Animation(int definitionIndex, double phaseOffset);
+	Animation(int definitionIndex);
+
+	int getDefinitionIndex() const;
 
 	// Gets the current texture ID. If the animation doesn't loop and is finished, it
 	// returns the last ID.
-	int getCurrentID() const;
+	int getCurrentID(const AnimationLibrary &library) const;
 
-	// Returns whether the animation has gone through all of its IDs. If 'loop' is true,
-	// this method always returns false.
-	bool isFinished() const;
+	// Returns whether the animation has gone through all of its IDs. If the animation
+	// loops, this method always returns false.
+	bool isFinished(const AnimationLibrary &library) const;
 
-	// Tick the animation by delta time.
-	void tick(double dt);
+	// Tick the animation by delta time. Looping animations don't need it.
+	void tick(const AnimationLibrary &library, double dt);
 };
 
 #endif
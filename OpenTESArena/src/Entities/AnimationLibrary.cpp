@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+#include "AnimationLibrary.h"
+#include "../Utilities/Debug.h"
+
+AnimationLibrary::AnimationLibrary()
+{
+	this->time = 0.0;
+}
+
+int AnimationLibrary::addDefinition(const std::vector<int> &ids, double timePerFrame, bool loop)
+{
+	DebugAssert(ids.size() > 0, "Animation must have at least one ID.");
+	DebugAssert(timePerFrame > 0.0, "Animation time per frame must be positive.");
+
+	// There are only a few distinct animations in a world, so a linear search is fine.
+	const auto iter = std::find_if(this->definitions.begin(), this->definitions.end(),
+		[&ids, timePerFrame, loop](const Definition &definition)
+	{
+		return (definition.ids == ids) && (definition.timePerFrame == timePerFrame) &&
+			(definition.loop == loop);
+	});
+
+	if (iter != this->definitions.end())
+	{
+		return static_cast<int>(std::distance(this->definitions.begin(), iter));
+	}
+
+	Definition definition;
+	definition.ids = ids;
+	definition.timePerFrame = timePerFrame;
+	definition.loop = loop;
+	this->definitions.push_back(std::move(definition));
+	return static_cast<int>(this->definitions.size()) - 1;
+}
+
+const AnimationLibrary::Definition &AnimationLibrary::getDefinition(int index) const
+{
+	// Called for every animated entity each tick, so no error message is built here.
+	assert((index >= 0) && (index < static_cast<int>(this->definitions.size())));
+	return this->definitions[index];
+}
+
+double AnimationLibrary::getTime() const
+{
+	return this->time;
+}
+
+void AnimationLibrary::tick(double dt)
+{
+	this->time += dt;
+}
@@ -0,0 +1,39 @@
+#ifndef ANIMATION_LIBRARY_H
+#define ANIMATION_LIBRARY_H
+
+#include <vector>
+
+// Immutable sprite animation definitions shared by every entity that plays them, so
+// identical animations are only stored once. It also keeps one clock that drives all
+// looping animations, so they don't need per-entity timers.
+
+class AnimationLibrary
+{
+public:
+	struct Definition
+	{
+		std::vector<int> ids; // Texture IDs in the software renderer.
+		double timePerFrame;
+		bool loop;
+	};
+private:
+	std::vector<Definition> definitions;
+	double time; // Seconds the looping clock has run.
+public:
+	AnimationLibrary();
+
+	// Adds an animation definition and returns its index. An identical definition that was
+	// added before is reused.
+	int addDefinition(const std::vector<int> &ids, double timePerFrame, bool loop);
+
+	// Gets the definition at the given index.
+	const Definition &getDefinition(int index) const;
+
+	// Gets the time of the clock that looping animations are driven by.
+	double getTime() const;
+
+	// Advances the looping clock by delta time.
+	void tick(double dt);
+};
+
+#endif
@@ -1,5 +1,7 @@
+#include "AnimationLibrary.h"
 #include "Doodad.h"
 #include "EntityType.h"
+#include "EntityWorldView.h"
 
 Doodad::Doodad(const Animation &animation, const Double3 &position,
 	EntityManager &entityManager)
@@ -25,9 +27,11 @@ bool Doodad::facesPlayer() const
 	return true;
 }
 
-void Doodad::tick(Game &game, double dt)
+void Doodad::tick(const EntityWorldView &worldView, double dt,
+	EntityCommandBuffer&)
 {
-	// Animate.
-	this->animation.tick(dt);
-	this->textureID = this->animation.getCurrentID();
+	// Animate. Looping animations follow the library's clock.
+	const AnimationLibrary &animationLibrary = worldView.getAnimationLibrary();
+	this->animation.tick(animationLibrary, dt);
+	this->setTextureID(this->animation.getCurrentID(animationLibrary));
 }
@@ -9,6 +9,8 @@ Entity::Entity(EntityManager &entityManager)
 	this->id = entityManager.nextID();
 	this->textureID = 0;
 	this->flipped = false;
+	this->flatDirty = true;
+	this->skippedTime = 0.0;
 }
 
 int Entity::getID() const
@@ -25,3 +27,46 @@ bool Entity::getFlipped() const
 {
 	return this->flipped;
 }
+
+bool Entity::isFlatDirty() const
+{
+	return this->flatDirty;
+}
+
+void Entity::setTextureID(int textureID)
+{
+	if (this->textureID != textureID)
+	{
+		this->textureID = textureID;
+		this->flatDirty = true;
+	}
+}
+
+void Entity::setFlipped(bool flipped)
+{
+	if (this->flipped != flipped)
+	{
+		this->flipped = flipped;
+		this->flatDirty = true;
+	}
+}
+
+void Entity::setFlatDirty()
+{
+	this->flatDirty = true;
+}
+
+void Entity::clearFlatDirty()
+{
+	this->flatDirty = false;
+}
+
+double Entity::getSkippedTime() const
+{
+	return this->skippedTime;
+}
+
+void Entity::setSkippedTime(double skippedTime)
+{
+	this->skippedTime = skippedTime;
+}
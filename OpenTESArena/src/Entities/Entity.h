@@ -10,8 +10,9 @@
 
 // Not all sprites turn to face the camera (such as doors and portcullises).
 
+class EntityCommandBuffer;
 class EntityManager;
-class Game;
+class EntityWorldView;
 
 enum class EntityType;
 
@@ -19,10 +20,21 @@ class Entity
 {
 private:
 	int id;
-protected:
+
 	// Texture ID and flip state are updated by the derived entity's tick() method.
 	int textureID;
 	bool flipped;
+
+	// Whether the renderer's flat is out of date with the entity.
+	bool flatDirty;
+
+	// Simulation time that passed while the entity's update tier skipped its ticks.
+	double skippedTime;
+protected:
+	// Setters for the derived entity's tick() method. The flat only becomes dirty if the
+	// value actually changes.
+	void setTextureID(int textureID);
+	void setFlipped(bool flipped);
 public:
 	Entity(EntityManager &entityManager);
 	Entity(const Entity&) = delete;
@@ -46,6 +58,22 @@ public:
 	// to the player.
 	bool getFlipped() const;
 
+	// Returns whether the entity's position, texture, or flip state changed since its flat
+	// was last sent to the renderer. New entities start out dirty.
+	bool isFlatDirty() const;
+
+	// Marks the flat as out of date. Derived entities must call this when their position
+	// changes.
+	void setFlatDirty();
+
+	// Called once the entity's flat has been sent to the renderer.
+	void clearFlatDirty();
+
+	// Gets and sets the simulation time the entity hasn't been ticked by yet. Entities far
+	// from the player tick less often, and get the time they missed in their next tick.
+	double getSkippedTime() const;
+	void setSkippedTime(double skippedTime);
+
 	virtual EntityType getEntityType() const = 0;
 
 	// Gets the 3D position of the entity. The semantics of this depends on how it is 
@@ -56,8 +84,10 @@ public:
 	// Returns whether the entity's 3D flat faces the player (like a sprite).
 	virtual bool facesPlayer() const = 0;
 
-	// Animates the entity's state by delta time.
-	virtual void tick(Game &game, double dt) = 0;
+	// Animates the entity's state by delta time. Entities of the same type tick in parallel,
+	// so this may only change the entity itself. Anything else goes in the command buffer.
+	virtual void tick(const EntityWorldView &worldView, double dt,
+		EntityCommandBuffer &commands) = 0;
 };
 
 #endif
@@ -0,0 +1,16 @@
+#include "EntityCommandBuffer.h"
+
+void EntityCommandBuffer::add(const std::function<void(Game&)> &command)
+{
+	this->commands.push_back(command);
+}
+
+void EntityCommandBuffer::apply(Game &game)
+{
+	for (const auto &command : this->commands)
+	{
+		command(game);
+	}
+
+	this->commands.clear();
+}
@@ -0,0 +1,26 @@
+#ifndef ENTITY_COMMAND_BUFFER_H
+#define ENTITY_COMMAND_BUFFER_H
+
+#include <functional>
+#include <vector>
+
+// Side effects that entities want to have on the game, recorded while they tick in
+// parallel and applied on the main thread afterwards. Each batch of entities gets its
+// own buffer, and buffers are applied in batch order so the results don't depend on
+// thread timing.
+
+class Game;
+
+class EntityCommandBuffer
+{
+private:
+	std::vector<std::function<void(Game&)>> commands;
+public:
+	// Records a command to run when the buffer is applied.
+	void add(const std::function<void(Game&)> &command);
+
+	// Runs each command in the order they were added, then empties the buffer.
+	void apply(Game &game);
+};
+
+#endif
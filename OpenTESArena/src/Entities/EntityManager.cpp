@@ -1,76 +1,410 @@
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
 
 #include "Entity.h"
 #include "EntityManager.h"
 #include "EntityType.h"
 
+namespace
+{
+	const int EntityTypeCount = static_cast<int>(EntityType::Transition) + 1;
+}
+
+const int EntityManager::SLOT_BITS = 20;
+const int EntityManager::SLOT_MASK = (1 << EntityManager::SLOT_BITS) - 1;
+const int EntityManager::GENERATION_MASK = (1 << (31 - EntityManager::SLOT_BITS)) - 1;
+
+EntityManager::Slot::Slot()
+{
+	this->generation = 0;
+	this->groupIndex = 0;
+	this->entityIndex = -1;
+}
+
+EntityManager::Iterator::Iterator(const EntityGroup *group, const EntityGroup *groupEnd)
+{
+	this->group = group;
+	this->groupEnd = groupEnd;
+	this->index = 0;
+	this->skipEmptyGroups();
+}
+
+void EntityManager::Iterator::skipEmptyGroups()
+{
+	while ((this->group != this->groupEnd) &&
+		(this->index == static_cast<int>(this->group->entities.size())))
+	{
+		this->group++;
+		this->index = 0;
+	}
+}
+
+Entity *EntityManager::Iterator::operator*() const
+{
+	return this->group->entities[this->index].get();
+}
+
+EntityManager::Iterator &EntityManager::Iterator::operator++()
+{
+	this->index++;
+	this->skipEmptyGroups();
+	return *this;
+}
+
+bool EntityManager::Iterator::operator!=(const Iterator &other) const
+{
+	return (this->group != other.group) || (this->index != other.index);
+}
+
+EntityManager::Range::Range(const Iterator &beginIter, const Iterator &endIter)
+	: beginIter(beginIter), endIter(endIter) { }
+
+EntityManager::Iterator EntityManager::Range::begin() const
+{
+	return this->beginIter;
+}
+
+EntityManager::Iterator EntityManager::Range::end() const
+{
+	return this->endIter;
+}
+
 EntityManager::EntityManager()
+	: groups(EntityTypeCount) { }
+
+int EntityManager::makeID(int slotIndex, int generation)
 {
+	return slotIndex | (generation << EntityManager::SLOT_BITS);
+}
 
+Int2 EntityManager::getCell(const Double3 &position)
+{
+	return Int2(static_cast<int>(std::floor(position.x)),
+		static_cast<int>(std::floor(position.z)));
 }
 
 Entity *EntityManager::at(int id) const
 {
-	const auto entityIter = this->entities.find(id);
-	return (entityIter != this->entities.end()) ?
-		entityIter->second.get() : nullptr;
+	const int slotIndex = id & EntityManager::SLOT_MASK;
+	if ((id < 0) || (slotIndex >= static_cast<int>(this->slots.size())))
+	{
+		return nullptr;
+	}
+
+	// The slot might have been reused by a newer entity.
+	const Slot &slot = this->slots[slotIndex];
+	if ((slot.entityIndex < 0) || (id != EntityManager::makeID(slotIndex, slot.generation)))
+	{
+		return nullptr;
+	}
+
+	return this->groups[slot.groupIndex].entities[slot.entityIndex].get();
 }
 
-std::vector<Entity*> EntityManager::getAllEntities() const
+EntityManager::Range EntityManager::getAllEntities() const
 {
-	std::vector<Entity*> entityPtrs;
+	const EntityGroup *groupsBegin = this->groups.data();
+	const EntityGroup *groupsEnd = groupsBegin + this->groups.size();
+	return Range(Iterator(groupsBegin, groupsEnd), Iterator(groupsEnd, groupsEnd));
+}
 
-	for (const auto &pair : this->entities)
+EntityManager::Range EntityManager::getEntities(EntityType entityType) const
+{
+	const EntityGroup *group = this->groups.data() + static_cast<int>(entityType);
+	return Range(Iterator(group, group + 1), Iterator(group + 1, group + 1));
+}
+
+int EntityManager::getEntityCount(EntityType entityType) const
+{
+	const EntityGroup &group = this->groups[static_cast<int>(entityType)];
+	return static_cast<int>(group.entities.size());
+}
+
+Entity *EntityManager::getEntity(EntityType entityType, int index) const
+{
+	const EntityGroup &group = this->groups[static_cast<int>(entityType)];
+	assert((index >= 0) && (index < static_cast<int>(group.entities.size())));
+	return group.entities[index].get();
+}
+
+int EntityManager::nextID() const
+{
+	// Reuse the most recently freed slot if there is one.
+	if (this->freeSlots.size() > 0)
+	{
+		const int slotIndex = this->freeSlots.back();
+		return EntityManager::makeID(slotIndex, this->slots[slotIndex].generation);
+	}
+	else
+	{
+		const int slotIndex = static_cast<int>(this->slots.size());
+		assert(slotIndex <= EntityManager::SLOT_MASK);
+		return EntityManager::makeID(slotIndex, 0);
+	}
+}
+
+void EntityManager::add(std::unique_ptr<Entity> entity)
+{
+	assert(entity.get() != nullptr);
+
+	// Programmer error if the entity's ID isn't the next available one.
+	const int entityID = entity->getID();
+	assert(entityID == this->nextID());
+
+	const int slotIndex = entityID & EntityManager::SLOT_MASK;
+	if (this->freeSlots.size() > 0)
 	{
-		Entity *entity = pair.second.get();
-		entityPtrs.push_back(entity);
+		this->freeSlots.pop_back();
 	}
+	else
+	{
+		this->slots.push_back(Slot());
+	}
+
+	// Append the entity to its type's group.
+	const int groupIndex = static_cast<int>(entity->getEntityType());
+	EntityGroup &group = this->groups[groupIndex];
+
+	Slot &slot = this->slots[slotIndex];
+	slot.groupIndex = groupIndex;
+	slot.entityIndex = static_cast<int>(group.entities.size());
+	slot.cell = EntityManager::getCell(entity->getPosition());
+	this->addToCell(entityID, slot.cell);
 
-	return entityPtrs;
+	group.entities.push_back(std::move(entity));
+	group.slotIndices.push_back(slotIndex);
 }
 
-std::vector<Entity*> EntityManager::getEntities(EntityType entityType) const
+void EntityManager::releaseSlot(int slotIndex)
 {
-	std::vector<Entity*> entityPtrs;
+	Slot &slot = this->slots[slotIndex];
+	slot.generation = (slot.generation + 1) & EntityManager::GENERATION_MASK;
+	slot.entityIndex = -1;
+	this->freeSlots.push_back(slotIndex);
+}
+
+void EntityManager::addToCell(int id, const Int2 &cell)
+{
+	this->cells[cell].push_back(id);
+}
+
+void EntityManager::removeFromCell(int id, const Int2 &cell)
+{
+	auto cellIter = this->cells.find(cell);
+	assert(cellIter != this->cells.end());
+
+	// Order within a cell doesn't matter, so the last ID takes the removed one's place.
+	std::vector<int> &ids = cellIter->second;
+	const auto idIter = std::find(ids.begin(), ids.end(), id);
+	assert(idIter != ids.end());
+	*idIter = ids.back();
+	ids.pop_back();
+
+	if (ids.size() == 0)
+	{
+		this->cells.erase(cellIter);
+	}
+}
+
+void EntityManager::remove(int id)
+{
+	if (this->at(id) == nullptr)
+	{
+		return;
+	}
+
+	const int slotIndex = id & EntityManager::SLOT_MASK;
+	const Slot &slot = this->slots[slotIndex];
+	EntityGroup &group = this->groups[slot.groupIndex];
+	const int entityIndex = slot.entityIndex;
+	this->removeFromCell(id, slot.cell);
 
-	// Gather up entities whose type matches the given type.
-	for (const auto &pair : this->entities)
+	// Move the group's last entity into the removed one's place so the group stays dense.
+	const int lastIndex = static_cast<int>(group.entities.size()) - 1;
+	if (entityIndex != lastIndex)
 	{
-		Entity *entity = pair.second.get();
-		if (entity->getEntityType() == entityType)
+		group.entities[entityIndex] = std::move(group.entities[lastIndex]);
+		group.slotIndices[entityIndex] = group.slotIndices[lastIndex];
+		this->slots[group.slotIndices[entityIndex]].entityIndex = entityIndex;
+	}
+
+	group.entities.pop_back();
+	group.slotIndices.pop_back();
+	this->releaseSlot(slotIndex);
+}
+
+void EntityManager::clear()
+{
+	for (EntityGroup &group : this->groups)
+	{
+		for (const int slotIndex : group.slotIndices)
 		{
-			entityPtrs.push_back(entity);
+			this->releaseSlot(slotIndex);
 		}
+
+		group.entities.clear();
+		group.slotIndices.clear();
 	}
 
-	return entityPtrs;
+	this->cells.clear();
 }
 
-int EntityManager::nextID() const
+void EntityManager::updateCell(int id)
 {
-	// Iterate through IDs from 0 to infinity until one is available.
-	int id = 0;
-	while (this->entities.find(id) != this->entities.end())
+	const Entity *entity = this->at(id);
+	assert(entity != nullptr);
+
+	Slot &slot = this->slots[id & EntityManager::SLOT_MASK];
+	const Int2 cell = EntityManager::getCell(entity->getPosition());
+	if (cell != slot.cell)
 	{
-		id++;
+		this->removeFromCell(id, slot.cell);
+		this->addToCell(id, cell);
+		slot.cell = cell;
 	}
+}
 
-	return id;
+void EntityManager::getEntitiesInCell(const Int2 &cell, std::vector<Entity*> &entities) const
+{
+	const auto cellIter = this->cells.find(cell);
+	if (cellIter != this->cells.end())
+	{
+		for (const int id : cellIter->second)
+		{
+			entities.push_back(this->at(id));
+		}
+	}
 }
 
-void EntityManager::add(std::unique_ptr<Entity> entity)
+void EntityManager::getEntitiesInRadius(const Double3 &point, double radius,
+	std::vector<Entity*> &entities) const
 {
-	assert(entity.get() != nullptr);
+	const Int2 startCell = EntityManager::getCell(Double3(point.x - radius, 0.0, point.z - radius));
+	const Int2 endCell = EntityManager::getCell(Double3(point.x + radius, 0.0, point.z + radius));
+	const double radiusSquared = radius * radius;
 
-	// Programmer error if two entities have the same ID.
-	assert(this->entities.find(entity->getID()) == this->entities.end());
+	auto addCellEntities = [this, &point, &entities, radiusSquared](const std::vector<int> &ids)
+	{
+		for (const int id : ids)
+		{
+			Entity *entity = this->at(id);
+			if ((entity->getPosition() - point).lengthSquared() <= radiusSquared)
+			{
+				entities.push_back(entity);
+			}
+		}
+	};
 
-	// Add the pair to the entities map.
-	int entityID = entity->getID();
-	this->entities.insert(std::make_pair(entityID, std::move(entity)));
+	// A radius covering more voxels than there are occupied ones is quicker to answer by
+	// going through the occupied ones.
+	const double cellCount = (static_cast<double>(endCell.x - startCell.x) + 1.0) *
+		(static_cast<double>(endCell.y - startCell.y) + 1.0);
+	if (cellCount > static_cast<double>(this->cells.size()))
+	{
+		for (const auto &pair : this->cells)
+		{
+			addCellEntities(pair.second);
+		}
+
+		return;
+	}
+
+	for (int z = startCell.y; z <= endCell.y; z++)
+	{
+		for (int x = startCell.x; x <= endCell.x; x++)
+		{
+			const auto cellIter = this->cells.find(Int2(x, z));
+			if (cellIter != this->cells.end())
+			{
+				addCellEntities(cellIter->second);
+			}
+		}
+	}
 }
 
-void EntityManager::remove(int id)
+Entity *EntityManager::getEntityOnRay(const Double3 &origin, const Double3 &direction,
+	double maxDistance, double radius, double *hitDistance) const
 {
-	this->entities.erase(id);
+	// An entity within one voxel of the ray in X and Z is hashed in a voxel next to one the
+	// ray passes through, so only those are searched.
+	assert(radius <= 1.0);
+	assert(std::isfinite(maxDistance));
+
+	const double radiusSquared = radius * radius;
+	Entity *hitEntity = nullptr;
+	double hitT = maxDistance;
+
+	// Step through the ray's voxels in XZ, nearest first.
+	const double infinity = std::numeric_limits<double>::infinity();
+	const Int2 originCell = EntityManager::getCell(origin);
+	int cellX = originCell.x;
+	int cellZ = originCell.y;
+	const int stepX = (direction.x > 0.0) ? 1 : -1;
+	const int stepZ = (direction.z > 0.0) ? 1 : -1;
+	const double deltaX = (direction.x != 0.0) ? std::abs(1.0 / direction.x) : infinity;
+	const double deltaZ = (direction.z != 0.0) ? std::abs(1.0 / direction.z) : infinity;
+	double nextX = (direction.x != 0.0) ? (((stepX > 0) ?
+		(static_cast<double>(cellX + 1) - origin.x) : (origin.x - static_cast<double>(cellX))) *
+		deltaX) : infinity;
+	double nextZ = (direction.z != 0.0) ? (((stepZ > 0) ?
+		(static_cast<double>(cellZ + 1) - origin.z) : (origin.z - static_cast<double>(cellZ))) *
+		deltaZ) : infinity;
+	double cellT = 0.0; // Distance at which the ray entered the current voxel.
+
+	// A hit that's nearer than the current one is found by the time the ray reaches its
+	// distance, so voxels past the nearest hit are never searched.
+	while (cellT <= hitT)
+	{
+		for (int z = cellZ - 1; z <= cellZ + 1; z++)
+		{
+			for (int x = cellX - 1; x <= cellX + 1; x++)
+			{
+				const auto cellIter = this->cells.find(Int2(x, z));
+				if (cellIter == this->cells.end())
+				{
+					continue;
+				}
+
+				for (const int id : cellIter->second)
+				{
+					Entity *entity = this->at(id);
+					const Double3 offset = entity->getPosition() - origin;
+					const double t = offset.dot(direction);
+					if ((t < 0.0) || (t >= hitT))
+					{
+						continue;
+					}
+
+					if ((offset - (direction * t)).lengthSquared() <= radiusSquared)
+					{
+						hitEntity = entity;
+						hitT = t;
+					}
+				}
+			}
+		}
+
+		if (nextX < nextZ)
+		{
+			cellX += stepX;
+			cellT = nextX;
+			nextX += deltaX;
+		}
+		else
+		{
+			cellZ += stepZ;
+			cellT = nextZ;
+			nextZ += deltaZ;
+		}
+	}
+
+	if ((hitEntity != nullptr) && (hitDistance != nullptr))
+	{
+		*hitDistance = hitT;
+	}
+
+	return hitEntity;
 }
@@ -6,13 +6,86 @@
 #include <vector>
 
 #include "../Entities/Entity.h"
+#include "../Math/Vector2.h"
+#include "../Math/Vector3.h"
+
+// Entities are kept in a generational slot map. An entity's ID is a handle made of its slot
+// index and the slot's generation, so IDs of removed entities never find a newer entity
+// that reused the slot. Entities of each type are stored contiguously for iteration.
+
+// Entities are also hashed by the XZ voxel their position is in, so finding the ones near a
+// point or along a ray only looks at the entities around it instead of all of them.
 
 enum class EntityType;
 
 class EntityManager
 {
 private:
-	std::unordered_map<int, std::unique_ptr<Entity>> entities;
+	// Entities of one type, plus the slot that refers to each one.
+	struct EntityGroup
+	{
+		std::vector<std::unique_ptr<Entity>> entities;
+		std::vector<int> slotIndices;
+	};
+
+	struct Slot
+	{
+		int generation;
+		int groupIndex, entityIndex; // Entity index is -1 if the slot is free.
+		Int2 cell; // XZ voxel the entity is hashed in.
+
+		Slot();
+	};
+public:
+	// Iterates over entity groups without allocating. Adding or removing entities
+	// invalidates iterators.
+	class Iterator
+	{
+	private:
+		const EntityGroup *group, *groupEnd;
+		int index;
+
+		void skipEmptyGroups();
+	public:
+		Iterator(const EntityGroup *group, const EntityGroup *groupEnd);
+
+		Entity *operator*() const;
+		Iterator &operator++();
+		bool operator!=(const Iterator &other) const;
+	};
+
+	// Range of entities for range-based for loops.
+	class Range
+	{
+	private:
+		Iterator beginIter, endIter;
+	public:
+		Range(const Iterator &beginIter, const Iterator &endIter);
+
+		Iterator begin() const;
+		Iterator end() const;
+	};
+private:
+	// Number of bits for the slot index in an entity ID. The rest are the generation.
+	static const int SLOT_BITS;
+	static const int SLOT_MASK;
+	static const int GENERATION_MASK;
+
+	std::vector<EntityGroup> groups; // One per entity type.
+	std::vector<Slot> slots;
+	std::vector<int> freeSlots;
+	std::unordered_map<Int2, std::vector<int>> cells; // IDs of the entities in each XZ voxel.
+
+	static int makeID(int slotIndex, int generation);
+
+	// Gets the XZ voxel an entity at the given position is hashed in.
+	static Int2 getCell(const Double3 &position);
+
+	// Frees an entity's slot so its ID no longer refers to anything.
+	void releaseSlot(int slotIndex);
+
+	void addToCell(int id, const Int2 &cell);
+	void removeFromCell(int id, const Int2 &cell);
 public:
 	EntityManager();
 	EntityManager(EntityManager &&entityManager) = default;
@@ -23,10 +96,16 @@ public:
 	Entity *at(int id) const;
 
 	// Gets all entities of all types.
-	std::vector<Entity*> getAllEntities() const;
+	Range getAllEntities() const;
 
 	// Gets all entities of the given type.
-	std::vector<Entity*> getEntities(EntityType entityType) const;
+	Range getEntities(EntityType entityType) const;
+
+	// Gets the number of entities of the given type, and one of them by its index among
+	// them, for splitting a type's entities into batches. Indices change when entities of
+	// the type are added or removed.
+	int getEntityCount(EntityType entityType) const;
+	Entity *getEntity(EntityType entityType, int index) const;
 
 	// Obtains an available ID to be assigned to a new entity.
 	int nextID() const;
@@ -36,6 +115,27 @@ public:
 
 	// Deletes an entity.
 	void remove(int id);
+
+	// Deletes all entities.
+	void clear();
+
+	// Moves an entity to the XZ voxel of its current position in the spatial hash. Must be
+	// called after an entity moves, before the next query.
+	void updateCell(int id);
+
+	// Appends the entities whose position is in the given XZ voxel.
+	void getEntitiesInCell(const Int2 &cell, std::vector<Entity*> &entities) const;
+
+	// Appends the entities within the radius of the point.
+	void getEntitiesInRadius(const Double3 &point, double radius,
+		std::vector<Entity*> &entities) const;
+
+	// Gets the nearest entity whose position is within the radius of the ray, for picking
+	// and hit tests. The direction must be normalized, and the radius can't be more than
+	// one voxel. Returns null if none is closer than the max distance. The hit distance is
+	// optional.
+	Entity *getEntityOnRay(const Double3 &origin, const Double3 &direction,
+		double maxDistance, double radius, double *hitDistance) const;
 };
 
 #endif
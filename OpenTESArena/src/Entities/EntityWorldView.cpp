@@ -0,0 +1,31 @@
+#include "EntityWorldView.h"
+
+EntityWorldView::EntityWorldView(const VoxelGrid &voxelGrid, const NavigationGrid &navigation,
+	const AnimationLibrary &animationLibrary, const Clock &clock, const Double3 &playerPosition)
+	: voxelGrid(voxelGrid), navigation(navigation), animationLibrary(animationLibrary),
+	clock(clock), playerPosition(playerPosition) { }
+
+const VoxelGrid &EntityWorldView::getVoxelGrid() const
+{
+	return this->voxelGrid;
+}
+
+const NavigationGrid &EntityWorldView::getNavigation() const
+{
+	return this->navigation;
+}
+
+const AnimationLibrary &EntityWorldView::getAnimationLibrary() const
+{
+	return this->animationLibrary;
+}
+
+const Clock &EntityWorldView::getClock() const
+{
+	return this->clock;
+}
+
+const Double3 &EntityWorldView::getPlayerPosition() const
+{
+	return this->playerPosition;
+}
@@ -0,0 +1,45 @@
+#ifndef ENTITY_WORLD_VIEW_H
+#define ENTITY_WORLD_VIEW_H
+
+#include "../Math/Vector3.h"
+
+// Read-only parts of the game world that entities can look at while they tick. Entities
+// tick in parallel, so this is all they see of the world, and nothing in it changes until
+// every entity is done.
+
+class AnimationLibrary;
+class Clock;
+class NavigationGrid;
+class VoxelGrid;
+
+class EntityWorldView
+{
+private:
+	const VoxelGrid &voxelGrid;
+	const NavigationGrid &navigation;
+	const AnimationLibrary &animationLibrary;
+	const Clock &clock;
+	Double3 playerPosition;
+public:
+	EntityWorldView(const VoxelGrid &voxelGrid, const NavigationGrid &navigation,
+		const AnimationLibrary &animationLibrary, const Clock &clock,
+		const Double3 &playerPosition);
+
+	// Gets the voxel grid of the active level.
+	const VoxelGrid &getVoxelGrid() const;
+
+	// Gets the flow fields of the active level, for steering toward shared goals like the
+	// player.
+	const NavigationGrid &getNavigation() const;
+
+	// Gets the animation definitions that entity animations refer to.
+	const AnimationLibrary &getAnimationLibrary() const;
+
+	// Gets the current time of day.
+	const Clock &getClock() const;
+
+	// Gets the player's position at the start of the tick.
+	const Double3 &getPlayerPosition() const;
+};
+
+#endif
@@ -1,4 +1,6 @@
+#include "AnimationLibrary.h"
 #include "EntityType.h"
+#include "EntityWorldView.h"
 #include "NonPlayer.h"
 #include "../Math/Constants.h"
 
@@ -50,10 +52,12 @@ bool NonPlayer::facesPlayer() const
 	return true;
 }
 
-void NonPlayer::tick(Game &game, double dt)
+void NonPlayer::tick(const EntityWorldView &worldView, double dt,
+	EntityCommandBuffer&)
 {
 	// Animate first animation for now. It will depend on player position eventually.
+	const AnimationLibrary &animationLibrary = worldView.getAnimationLibrary();
 	Animation &animation = this->idleAnimations.at(0);
-	animation.tick(dt);
-	this->textureID = animation.getCurrentID();
+	animation.tick(animationLibrary, dt);
+	this->setTextureID(animation.getCurrentID(animationLibrary));
 }
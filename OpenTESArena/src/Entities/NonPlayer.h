@@ -46,7 +46,8 @@ public:
 	virtual const Double3 &getPosition() const override;
 	virtual bool facesPlayer() const override;
 
-	virtual void tick(Game &game, double dt) override;
+	virtual void tick(const EntityWorldView &worldView, double dt,
+		EntityCommandBuffer &commands) override;
 };
 
 #endif
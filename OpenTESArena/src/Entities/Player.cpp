@@ -11,6 +11,7 @@
 #include "../Math/Constants.h"
 #include "../Math/Random.h"
 #include "../Utilities/String.h"
+#include "../World/CollisionGrid.h"
 #include "../World/VoxelData.h"
 #include "../World/VoxelDataType.h"
 #include "../World/VoxelGrid.h"
@@ -162,9 +163,7 @@ bool Player::onGround(const WorldData &worldData) const
 	// Don't try to dereference the voxel grid if the player's feet are outside.
 	if (insideWorld)
 	{
-		const char feetVoxelID = voxelGrid.getVoxels()[feetVoxel.x +
-			(feetVoxel.y * voxelGrid.getWidth()) +
-			(feetVoxel.z * voxelGrid.getWidth() * voxelGrid.getHeight())];
+		const char feetVoxelID = voxelGrid.getVoxel(feetVoxel.x, feetVoxel.y, feetVoxel.z);
 		const VoxelData &voxelData = voxelGrid.getVoxelData(feetVoxelID);
 
 		return (this->velocity.y == 0.0) && !voxelData.isAir() &&
@@ -192,106 +191,27 @@ void Player::lookAt(const Double3 &point)
 
 void Player::handleCollision(const WorldData &worldData, double dt)
 {
-	auto getVoxel = [&worldData](int x, int y, int z) -> VoxelData
-	{
-		const auto &level = worldData.getLevels().at(worldData.getCurrentLevel());
-		const VoxelGrid &voxelGrid = level.getVoxelGrid();
-
-		// Voxels outside the world are air.
-		if ((x < 0) || (x >= voxelGrid.getWidth()) ||
-			(y < 0) || (y >= voxelGrid.getHeight()) ||
-			(z < 0) || (z >= voxelGrid.getDepth()))
-		{
-			return VoxelData();
-		}
-		else
-		{
-			return voxelGrid.getVoxelData(voxelGrid.getVoxels()[x +
-				(y * voxelGrid.getWidth()) +
-				(z * voxelGrid.getWidth() * voxelGrid.getHeight())]);
-		}
-	};
-
-	const double feetY = this->getFeetY();
-
-	// Coordinates of the base of the voxel the feet are in.
-	const double feetVoxelYPos = std::floor(feetY + (this->velocity.y * dt));
-
-	// Get the voxel data for each voxel the player would touch on each axis.
-	const Int3 playerVoxel = this->getVoxelPosition();
-	const VoxelData &xVoxel = getVoxel(
-		static_cast<int>(std::floor(this->camera.position.x + (this->velocity.x * dt))),
-		playerVoxel.y,
-		playerVoxel.z);
-	const VoxelData &yVoxel = getVoxel(
-		playerVoxel.x,
-		static_cast<int>(feetVoxelYPos),
-		playerVoxel.z);
-	const VoxelData &zVoxel = getVoxel(
-		playerVoxel.x,
-		playerVoxel.y,
-		static_cast<int>(std::floor(this->camera.position.z + (this->velocity.z * dt))));
-
-	// Check horizontal collisions.
+	const auto &level = worldData.getActiveLevel();
+	const CollisionGrid &collisionGrid = level.getVoxelGrid().getCollisionGrid();
 
-	// -- Temp hack until Y collision detection is implemented --
-	// - To do: formalize the collision calculation and get rid of this hack.
-	//   We should be able to cover all collision cases in Arena now.
-	auto wouldCollideWithVoxel = [](const VoxelData &voxelData)
-	{
-		if (voxelData.dataType == VoxelDataType::TransparentWall)
-		{
-			// Transparent wall collision.
-			const VoxelData::TransparentWallData &transparent = voxelData.transparentWall;
-			return transparent.collider;
-		}
-		else if (voxelData.dataType == VoxelDataType::Edge)
-		{
-			// Edge collision.
-			// - To do: treat as edge, not solid voxel.
-			const VoxelData::EdgeData &edge = voxelData.edge;
-			return edge.collider;
-		}
-		else
-		{
-			// General voxel collision.
-			const bool isEmpty = voxelData.dataType == VoxelDataType::None;
-			const bool isDoor = voxelData.dataType == VoxelDataType::Door;
-
-			// -- Temporary hack for "on voxel enter" transitions --
-			// - To do: replace with "on would enter voxel" event and near facing check.			
-			const bool isLevelUpDown = [&voxelData]()
-			{
-				if (voxelData.dataType == VoxelDataType::Wall)
-				{
-					const VoxelData::WallData::Type wallType = voxelData.wall.type;
-					return (wallType == VoxelData::WallData::Type::LevelUp) ||
-						(wallType == VoxelData::WallData::Type::LevelDown);
-				}
-				else
-				{
-					return false;
-				}
-			}();
-
-			return !isEmpty && !isDoor && !isLevelUpDown;
-		}
-	};
+	// Check horizontal collisions. The player is a point at eye height for now.
+	// - To do: use an axis-aligned bounding box or cylinder instead of a point.
+	const Double3 displacement(this->velocity.x * dt, 0.0, this->velocity.z * dt);
+	const Double3 allowedDisplacement = collisionGrid.sweepBox(this->camera.position,
+		this->camera.position, displacement, CollisionGrid::SOLID);
 
-	if (wouldCollideWithVoxel(xVoxel))
+	if (allowedDisplacement.x != displacement.x)
 	{
 		this->velocity.x = 0.0;
 	}
 
-	if (wouldCollideWithVoxel(zVoxel))
+	if (allowedDisplacement.z != displacement.z)
 	{
 		this->velocity.z = 0.0;
 	}
 
+	// -- Temp hack until Y collision detection is implemented --
 	this->velocity.y = 0.0;
-	// -- end hack --
-
-	// To do: use an axis-aligned bounding box or cylinder instead of a point?
 }
 
 void Player::setVelocityToZero()
@@ -389,7 +309,7 @@ void Player::tick(Game &game, double dt)
 {
 	// Update player position and velocity due to collisions.
 	this->updatePhysics(game.getGameData().getWorldData(), 
-		game.getOptions().getCollision(), dt);
+		game.getOptions().getSnapshot().collision, dt);
 
 	// Tick weapon animation.
 	this->weaponAnimation.tick(dt);
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <cmath>
@@ -5,29 +6,52 @@
 #include <sstream>
 #include <string>
 #include <thread>
+#include <typeinfo>
 
 #include "SDL.h"
 
 #include "Game.h"
 #include "Options.h"
 #include "PlayerInterface.h"
+#include "../Assets/AssetCache.h"
 #include "../Assets/CityDataFile.h"
+#include "../Assets/RMDFile.h"
 #include "../Interface/Panel.h"
 #include "../Media/FontManager.h"
 #include "../Media/MusicFile.h"
 #include "../Media/MusicName.h"
 #include "../Media/TextureManager.h"
 #include "../Rendering/Renderer.h"
+#include "../Rendering/RendererAutotune.h"
+#include "../Rendering/SpanShading.h"
 #include "../Rendering/Surface.h"
+#include "../Utilities/AllocationCounter.h"
 #include "../Utilities/Debug.h"
 #include "../Utilities/File.h"
 #include "../Utilities/Platform.h"
+#include "../Utilities/StartupTimeline.h"
+#include "../Utilities/Profiler.h"
 #include "../Utilities/String.h"
 
 #include "components/vfs/manager.hpp"
 
+const int Game::IDLE_WAIT_MS = 250;
+const int Game::BACKGROUND_WAIT_MS = 100;
+const int Game::SPIN_WAIT_MICROSECONDS = 2000;
+const int Game::TRACE_CAPTURE_FRAMES = 120;
+const std::string Game::TRACE_FILENAME = "trace.json";
+const std::string Game::INPUT_RECORDING_FILENAME = "input-recording.bin";
+const int Game::SCREENSHOT_BURST_FRAMES = 30;
+const int Game::MAX_PENDING_SCREENSHOTS = 4;
+
+Game::PooledPanel::PooledPanel(const std::type_index &type, std::unique_ptr<Panel> panel)
+	: type(type), panel(std::move(panel)) { }
+
 Game::Game()
+	: jobSystem(Platform::getThreadCount())
 {
+	StartupTimeline::mark("Job system");
+
 	DebugMention("Initializing (Platform: " + Platform::getPlatform() + ").");
 
 	// Get the current working directory. This is most relevant for platforms
@@ -41,6 +65,44 @@ Game::Game()
 	// Parse options-default.txt and options-changes.txt (if it exists). Always prefer the
 	// default file before the "changes" file.
 	this->initOptions(this->basePath, this->optionsPath);
+	StartupTimeline::mark("Options");
+
+	// The job system's threads can be kept on one performance core each.
+	if (this->options.getPinWorkerThreads())
+	{
+		const int pinnedCount = this->jobSystem.pinThreads(
+			Platform::getCpuTopology().performanceProcessors);
+		DebugMention("Pinned " + std::to_string(pinnedCount) + " of " +
+			std::to_string(this->jobSystem.getThreadCount() + 1) +
+			" threads to performance cores.");
+	}
+
+	// Workers match their priority to each job's, which only needs setting up once.
+	this->jobSystem.setThreadPriorities(this->options.getThreadPriorities());
+
+	// Headless runs have no window to bring up SDL's event queue, so it's started here for
+	// replays to push their quit event to (and for quitting on an interrupt signal).
+	const bool headless = this->options.getHeadless() != 0;
+	if (headless)
+	{
+		DebugMention("Running headless.");
+		if (SDL_Init(SDL_INIT_EVENTS) != 0)
+		{
+			DebugWarning("Couldn't start SDL events, " + std::string(SDL_GetError()) + ".");
+		}
+	}
+
+	// Recordings and replays start here, before anything reads input or makes a random
+	// generator, so a replayed session starts out the same.
+	const int inputRecording = this->options.getInputRecording();
+	if (inputRecording == 1)
+	{
+		this->inputManager.startRecording(this->optionsPath + Game::INPUT_RECORDING_FILENAME);
+	}
+	else if (inputRecording == 2)
+	{
+		this->inputManager.startReplay(this->optionsPath + Game::INPUT_RECORDING_FILENAME);
+	}
 
 	// Verify that GLOBAL.BSA (the most important Arena file) exists.
 	const bool arenaPathIsRelative = File::pathIsRelative(
@@ -58,24 +120,60 @@ Game::Game()
 	// Initialize virtual file system using the Arena path in the options file.
 	VFS::Manager::get().initialize(std::string(
 		(arenaPathIsRelative ? this->basePath : "") + this->options.getArenaPath()));
+	StartupTimeline::mark("Virtual file system");
 
-	// Initialize the OpenAL Soft audio manager.
-	const bool midiPathIsRelative = File::pathIsRelative(this->options.getMidiConfig());
-	const std::string midiPath = (midiPathIsRelative ? this->basePath : "") +
-		this->options.getMidiConfig();
-
-	this->audioManager.init(this->options.getMusicVolume(), this->options.getSoundVolume(),
-		this->options.getSoundChannels(), this->options.getSoundResampling(), midiPath);
+	// Initialize the OpenAL Soft audio manager. Headless runs leave it silent.
+	if (!headless)
+	{
+		const bool midiPathIsRelative = File::pathIsRelative(this->options.getMidiConfig());
+		const std::string midiPath = (midiPathIsRelative ? this->basePath : "") +
+			this->options.getMidiConfig();
+
+		this->audioManager.init(this->options.getMusicVolume(),
+			this->options.getSoundVolume(), this->options.getSoundChannels(),
+			this->options.getSoundResampling(), this->options.getPresampleSounds(), midiPath,
+			this->jobSystem);
+		this->audioManager.setMusicCacheBudget(
+			static_cast<size_t>(this->options.getMusicCacheBudget()) * 1024 * 1024);
+		this->audioManager.setSoundCacheBudget(
+			static_cast<size_t>(this->options.getSoundCacheBudget()) * 1024 * 1024);
+		this->audioManager.setMusicThreadPriority(this->options.getThreadPriorities());
+		StartupTimeline::mark("Audio (OpenAL, WildMidi)");
+	}
 
-	// Initialize the SDL renderer and window with the given settings.
+	// Initialize the SDL renderer and window with the given settings, or an offscreen
+	// target when headless.
 	this->renderer.init(this->options.getScreenWidth(), this->options.getScreenHeight(),
-		this->options.getFullscreen(), this->options.getLetterboxAspect());
+		this->options.getFullscreen(), this->options.getLetterboxAspect(),
+		this->options.getVSync(), headless, this->jobSystem);
+	this->options.addListener([this](OptionName name) { this->handleOptionChange(name); });
+	StartupTimeline::mark("Renderer (SDL)");
 
 	// Initialize the texture manager.
-	this->textureManager.init();
+	this->textureManager.init(this->jobSystem);
+	this->textureManager.setIndexedImages(this->options.getIndexedImages());
+	StartupTimeline::mark("Texture manager");
+
+	// Headless runs are for comparing builds, so they keep the settings they were given.
+	if (!headless)
+	{
+		this->autotuneRenderer();
+	}
+
+	SpanShading::setInstructionSet(
+		RendererAutotune::getInstructionSet(this->options.getSpanInstructionSet()));
+
+	// Decoded wilderness blocks are kept for walking back into them.
+	RMDFile::setCacheBudget(
+		static_cast<size_t>(this->options.getWildernessCacheBudget()) * 1024);
 
-	// Load various miscellaneous assets.
-	this->miscAssets.init();
+	// Load various miscellaneous assets. Their decoded data is cached on disk so it only
+	// needs decoding again when the Arena files change.
+	AssetCache assetCache;
+	assetCache.init(this->options.getCacheDecodedAssets() ?
+		Platform::getCachePath() : std::string());
+	this->miscAssets.init(assetCache, this->jobSystem);
+	StartupTimeline::mark("Misc assets");
 
 	// Load and set window icon.
 	const Surface icon = [this]()
@@ -91,13 +189,18 @@ Game::Game()
 	}();
 
 	this->renderer.setWindowIcon(icon.get());
+	StartupTimeline::mark("Window icon");
 
 	// Initialize panel and music to default.
 	this->panel = Panel::defaultPanel(*this);
 	this->setMusic(MusicName::PercIntro);
+	StartupTimeline::mark("First panel and music");
 
 	// Use a texture as the cursor instead.
-	SDL_ShowCursor(SDL_FALSE);
+	if (!headless)
+	{
+		SDL_ShowCursor(SDL_FALSE);
+	}
 
 	// Leave some members null for now. The game data is initialized when the player 
 	// enters the game world, and the "next panel" is a temporary used by the game
@@ -109,6 +212,14 @@ Game::Game()
 	// This keeps the programmer from deleting a sub-panel the same frame it's in use.
 	// The pop is delayed until the beginning of the next frame.
 	this->requestedSubPanelPop = false;
+	this->nextPanelPooled = false;
+	this->screenshotIndex = 0;
+	this->screenshotFramesLeft = 0;
+	this->windowFocused = true;
+	this->windowVisible = true;
+	this->windowExposed = false;
+	this->allocationCount = AllocationCounter::getCount();
+	this->lastFrameAllocations = 0;
 }
 
 AudioManager &Game::getAudioManager()
@@ -126,6 +237,11 @@ FontManager &Game::getFontManager()
 	return this->fontManager;
 }
 
+TextRenderer &Game::getTextRenderer()
+{
+	return this->textRenderer;
+}
+
 bool Game::gameDataIsActive() const
 {
 	return this->gameData.get() != nullptr;
@@ -149,6 +265,21 @@ Renderer &Game::getRenderer()
 	return this->renderer;
 }
 
+JobSystem &Game::getJobSystem()
+{
+	return this->jobSystem;
+}
+
+FrameAllocator &Game::getFrameAllocator()
+{
+	return this->frameAllocator;
+}
+
+uint64_t Game::getLastFrameAllocationCount() const
+{
+	return this->lastFrameAllocations;
+}
+
 TextureManager &Game::getTextureManager()
 {
 	return this->textureManager;
@@ -166,7 +297,9 @@ const FPSCounter &Game::getFPSCounter() const
 
 void Game::setPanel(std::unique_ptr<Panel> nextPanel)
 {
+	this->takePooledPanel(typeid(*nextPanel));
 	this->nextPanel = std::move(nextPanel);
+	this->nextPanelPooled = false;
 }
 
 void Game::pushSubPanel(std::unique_ptr<Panel> nextSubPanel)
@@ -195,6 +328,8 @@ void Game::setMusic(MusicName name)
 
 void Game::setGameData(std::unique_ptr<GameData> gameData)
 {
+	// Pooled panels were built from the old game data.
+	this->panelPool.clear();
 	this->gameData = std::move(gameData);
 }
 
@@ -225,22 +360,164 @@ void Game::resizeWindow(int width, int height)
 	// Resize the window, and the 3D renderer if initialized.
 	const bool fullGameWindow = this->options.getModernInterface();
 	this->renderer.resize(width, height, this->options.getResolutionScale(), fullGameWindow);
+	this->dynamicResolution.reset();
 }
 
-void Game::saveScreenshot(const Surface &surface)
+void Game::handleOptionChange(OptionName name)
 {
-	// Get the path + filename to use for the new screenshot.
-	const std::string screenshotPath = []()
+	const OptionsSnapshot &options = this->options.getSnapshot();
+	if ((name == OptionName::ResolutionScale) || (name == OptionName::ModernInterface))
+	{
+		const Int2 windowDimensions = this->renderer.getWindowDimensions();
+		this->resizeWindow(windowDimensions.x, windowDimensions.y);
+	}
+	else if (name == OptionName::LetterboxAspect)
+	{
+		this->renderer.setLetterboxAspect(options.letterboxAspect);
+	}
+	else if (name == OptionName::Fullscreen)
+	{
+		this->renderer.setFullscreen(options.fullscreen);
+	}
+	else if (name == OptionName::WildernessCacheBudget)
+	{
+		RMDFile::setCacheBudget(static_cast<size_t>(options.wildernessCacheBudget) * 1024);
+	}
+	else if (name == OptionName::MusicCacheBudget)
+	{
+		this->audioManager.setMusicCacheBudget(
+			static_cast<size_t>(options.musicCacheBudget) * 1024 * 1024);
+	}
+	else if (name == OptionName::SoundCacheBudget)
+	{
+		this->audioManager.setSoundCacheBudget(
+			static_cast<size_t>(options.soundCacheBudget) * 1024 * 1024);
+	}
+	else if (name == OptionName::SpanInstructionSet)
+	{
+		// A pipelined frame might still be shading with the old one.
+		this->renderer.waitForWorldRendering();
+		SpanShading::setInstructionSet(
+			RendererAutotune::getInstructionSet(options.spanInstructionSet));
+	}
+}
+
+void Game::autotuneRenderer()
+{
+	const OptionsSnapshot &options = this->options.getSnapshot();
+	if ((options.rendererAutotune == 0) || options.hardwareRendering ||
+		(options.inputRecording == 2))
+	{
+		return;
+	}
+
+	// The game world's resolution, like the renderer makes it when the game starts.
+	const Int2 windowDimensions = this->renderer.getWindowDimensions();
+	const int viewHeight = options.modernInterface ?
+		windowDimensions.y : this->renderer.getViewHeight();
+	const int renderWidth = std::max(
+		static_cast<int>(windowDimensions.x * options.resolutionScale), 1);
+	const int renderHeight = std::max(
+		static_cast<int>(viewHeight * options.resolutionScale), 1);
+
+	const std::string signature = RendererAutotune::getSignature(renderWidth, renderHeight);
+	if ((options.rendererAutotune == 1) && (signature == options.autotuneSignature))
+	{
+		return;
+	}
+
+	DebugMention("Tuning the software renderer for \"" + signature + "\".");
+	const RendererAutotune::Settings settings = RendererAutotune::run(renderWidth,
+		renderHeight, options, this->textureManager, this->jobSystem);
+
+	DebugMention("Fastest settings: column-major " +
+		std::string(settings.columnMajorRendering ? "on" : "off") + ", row planes " +
+		(settings.rowPlaneRendering ? "on" : "off") + ", " +
+		SpanShading::getInstructionSetName(settings.instructionSet) + " (" +
+		String::fixedPrecision(settings.frameSeconds * 1000.0, 2) + "ms a frame).");
+
+	this->options.setColumnMajorRendering(settings.columnMajorRendering);
+	this->options.setRowPlaneRendering(settings.rowPlaneRendering);
+	this->options.setSpanInstructionSet(
+		RendererAutotune::getOptionValue(settings.instructionSet));
+	this->options.setAutotuneSignature(signature);
+	this->options.setRendererAutotune(1);
+	this->options.saveChanges();
+	StartupTimeline::mark("Renderer autotune");
+}
+
+void Game::updateDynamicResolution(double workTime, double dt)
+{
+	this->dynamicResolution.updateWorkTime(workTime, dt);
+
+	const OptionsSnapshot &options = this->options.getSnapshot();
+	if (!options.dynamicResolution)
+	{
+		return;
+	}
+
+	const double minScale = options.dynamicResolutionMinScale;
+	const double maxScale = std::max(options.dynamicResolutionMaxScale, minScale);
+	const double targetFrameTime = 1.0 / static_cast<double>(options.targetFPS);
+
+	const double currentScale = this->renderer.getResolutionScale();
+	const double nextScale = this->dynamicResolution.getNextScale(
+		currentScale, minScale, maxScale, targetFrameTime);
+
+	if (nextScale != currentScale)
+	{
+		this->renderer.setResolutionScale(nextScale);
+	}
+}
+
+void Game::saveScreenshot()
+{
+	// Reuse the pixels of screenshots that are done, waiting for the oldest one if too
+	// many are still being saved.
+	while (!this->pendingScreenshots.empty())
+	{
+		const PendingScreenshot &oldest = this->pendingScreenshots.front();
+		const bool tooMany = static_cast<int>(this->pendingScreenshots.size()) >=
+			Game::MAX_PENDING_SCREENSHOTS;
+
+		if (tooMany)
+		{
+			this->jobSystem.wait(oldest.job);
+		}
+		else if (!this->jobSystem.isDone(oldest.job))
+		{
+			break;
+		}
+
+		this->screenshotBuffers.push_back(oldest.pixels);
+		this->pendingScreenshots.pop_front();
+	}
+
+	std::shared_ptr<std::vector<uint32_t>> pixels;
+	if (this->screenshotBuffers.size() > 0)
+	{
+		pixels = this->screenshotBuffers.back();
+		this->screenshotBuffers.pop_back();
+	}
+	else
+	{
+		pixels = std::make_shared<std::vector<uint32_t>>();
+	}
+
+	const Int2 dimensions = this->renderer.getScreenshot(*pixels);
+
+	// Get the path + filename to use for the new screenshot. Indices are handed out here
+	// so screenshots saved at the same time don't pick the same one.
+	const std::string screenshotPath = [this]()
 	{
 		const std::string screenshotFolder = Platform::getScreenshotPath();
 		const std::string screenshotPrefix("screenshot");
-		int imageIndex = 0;
 
-		auto getNextAvailablePath = [&screenshotFolder, &screenshotPrefix, &imageIndex]()
+		auto getNextAvailablePath = [this, &screenshotFolder, &screenshotPrefix]()
 		{
 			std::stringstream ss;
-			ss << std::setw(3) << std::setfill('0') << imageIndex;
-			imageIndex++;
+			ss << std::setw(3) << std::setfill('0') << this->screenshotIndex;
+			this->screenshotIndex++;
 			return screenshotFolder + screenshotPrefix + ss.str() + ".bmp";
 		};
 
@@ -253,17 +530,107 @@ void Game::saveScreenshot(const Surface &surface)
 		return path;
 	}();
 
-	const int status = SDL_SaveBMP(surface.get(), screenshotPath.c_str());
+	// Encoding and writing happen on a worker. The error is copied there, since SDL's
+	// error string belongs to the thread that set it.
+	auto error = std::make_shared<std::string>();
+	PendingScreenshot pending;
+	pending.pixels = pixels;
+	pending.job = this->jobSystem.add([pixels, dimensions, screenshotPath, error]()
+	{
+		Surface surface(Surface::createSurfaceWithFormatFrom(pixels->data(),
+			dimensions.x, dimensions.y, Renderer::DEFAULT_BPP,
+			dimensions.x * static_cast<int>(sizeof(uint32_t)), Renderer::DEFAULT_PIXELFORMAT));
+
+		const int status = SDL_SaveBMP(surface.get(), screenshotPath.c_str());
+		if (status != 0)
+		{
+			*error = SDL_GetError();
+
+			// SDL_GetError() might be empty if the failure wasn't SDL's own.
+			if (error->empty())
+			{
+				*error = "unknown error";
+			}
+		}
+	}, std::vector<JobSystem::JobHandle>(), [screenshotPath, error]()
+	{
+		if (error->empty())
+		{
+			DebugMention("Screenshot saved to \"" + screenshotPath + "\".");
+		}
+		else
+		{
+			DebugCrash("Failed to save screenshot to \"" + screenshotPath + "\": " + *error);
+		}
+	});
+
+	this->pendingScreenshots.push_back(pending);
+}
+
+void Game::toggleVideoCapture()
+{
+	if (this->videoCapture.isRecording())
+	{
+		this->videoCapture.stop();
+		return;
+	}
 
-	if (status == 0)
+	const std::string videoFolder = Platform::getScreenshotPath();
+	std::string path;
+	for (int i = 0; path.empty() || File::exists(path); i++)
 	{
-		DebugMention("Screenshot saved to \"" + screenshotPath + "\".");
+		std::stringstream ss;
+		ss << videoFolder << "recording" << std::setw(3) << std::setfill('0') << i << ".avi";
+		path = ss.str();
 	}
-	else
+
+	this->videoCapture.start(path);
+}
+
+void Game::poolPanel(std::unique_ptr<Panel> panel)
+{
+	const size_t budget = static_cast<size_t>(
+		this->options.getSnapshot().panelPoolBudget) * 1024 * 1024;
+	// Pooled panels are made from the game data, so they're dropped along with it.
+	if (!panel->isPoolable() || (budget == 0) || !this->gameDataIsActive())
+	{
+		return;
+	}
+
+	const std::type_index type(typeid(*panel));
+	this->takePooledPanel(type);
+	this->panelPool.emplace_back(type, std::move(panel));
+
+	// The newest panel is evicted too if it doesn't fit by itself.
+	size_t totalBytes = 0;
+	for (const PooledPanel &pooledPanel : this->panelPool)
+	{
+		totalBytes += pooledPanel.panel->getPooledBytes();
+	}
+
+	while ((totalBytes > budget) && (this->panelPool.size() > 0))
+	{
+		totalBytes -= this->panelPool.front().panel->getPooledBytes();
+		this->panelPool.erase(this->panelPool.begin());
+	}
+}
+
+std::unique_ptr<Panel> Game::takePooledPanel(const std::type_index &type)
+{
+	const auto iter = std::find_if(this->panelPool.begin(), this->panelPool.end(),
+		[&type](const PooledPanel &pooledPanel)
+	{
+		return pooledPanel.type == type;
+	});
+
+	if (iter == this->panelPool.end())
 	{
-		DebugCrash("Failed to save screenshot to \"" + screenshotPath + "\": " +
-			std::string(SDL_GetError()));
+		return nullptr;
 	}
+
+	std::unique_ptr<Panel> panel = std::move(iter->panel);
+	this->panelPool.erase(iter);
+	return panel;
 }
 
 void Game::handlePanelChanges()
@@ -285,7 +652,21 @@ void Game::handlePanelChanges()
 	// (i.e., there are no sub-panels), then subsequent events will be sent to it.
 	if (this->nextPanel.get() != nullptr)
 	{
+		if (this->panel.get() != nullptr)
+		{
+			this->poolPanel(std::move(this->panel));
+		}
+
 		this->panel = std::move(this->nextPanel);
+
+		if (this->nextPanelPooled)
+		{
+			// The window might have been resized while the panel was suspended.
+			const Int2 windowDimensions = this->renderer.getWindowDimensions();
+			this->panel->resize(windowDimensions.x, windowDimensions.y);
+			this->panel->resume();
+			this->nextPanelPooled = false;
+		}
 	}
 }
 
@@ -293,18 +674,49 @@ void Game::handleEvents(bool &running)
 {
 	// Handle events for the current game state.
 	SDL_Event e;
-	while (SDL_PollEvent(&e) != 0)
+	while (this->inputManager.pollEvent(e))
 	{
 		// Application events and window resizes are handled here.
 		bool applicationExit = this->inputManager.applicationExit(e);
 		bool resized = this->inputManager.windowResized(e);
 		bool takeScreenshot = this->inputManager.keyPressed(e, SDLK_PRINTSCREEN);
+#if defined(TES_PROFILER)
+		bool captureTrace = this->inputManager.keyPressed(e, SDLK_F12);
+#endif
 
 		if (applicationExit)
 		{
 			running = false;
 		}
 
+		// Track whether the window is in the background.
+		if (e.type == SDL_WINDOWEVENT)
+		{
+			switch (e.window.event)
+			{
+			case SDL_WINDOWEVENT_FOCUS_GAINED:
+				this->windowFocused = true;
+				break;
+			case SDL_WINDOWEVENT_FOCUS_LOST:
+				this->windowFocused = false;
+				break;
+			case SDL_WINDOWEVENT_SHOWN:
+			case SDL_WINDOWEVENT_RESTORED:
+			case SDL_WINDOWEVENT_MAXIMIZED:
+				this->windowVisible = true;
+				break;
+			case SDL_WINDOWEVENT_HIDDEN:
+			case SDL_WINDOWEVENT_MINIMIZED:
+				this->windowVisible = false;
+				break;
+			case SDL_WINDOWEVENT_EXPOSED:
+				this->windowExposed = true;
+				break;
+			default:
+				break;
+			}
+		}
+
 		if (resized)
 		{
 			int width = e.window.data1;
@@ -322,13 +734,27 @@ void Game::handleEvents(bool &running)
 			}
 		}
 
-		if (takeScreenshot)
+		if (takeScreenshot && this->inputManager.keyIsDown(SDL_SCANCODE_LCTRL))
+		{
+			// Record video of the frames from now on, or stop recording.
+			this->toggleVideoCapture();
+		}
+		else if (takeScreenshot)
+		{
+			// Save this frame (or a burst of frames with shift) to the local folder once
+			// it's drawn.
+			const bool burst = this->inputManager.keyIsDown(SDL_SCANCODE_LSHIFT);
+			this->screenshotFramesLeft = burst ? Game::SCREENSHOT_BURST_FRAMES : 1;
+		}
+
+#if defined(TES_PROFILER)
+		if (captureTrace)
 		{
-			// Save a screenshot to the local folder.
-			const auto &renderer = this->getRenderer();
-			const Surface screenshot = renderer.getScreenshot();
-			this->saveScreenshot(screenshot);
+			// Record the next few frames for finding hitches.
+			Profiler::beginCapture(Game::TRACE_CAPTURE_FRAMES,
+				this->optionsPath + Game::TRACE_FILENAME);
 		}
+#endif
 
 		// Panel-specific events are handled by the active panel or sub-panel. If any 
 		// sub-panels exist, choose the top one. Otherwise, choose the main panel.
@@ -348,6 +774,8 @@ void Game::handleEvents(bool &running)
 
 void Game::tick(double dt)
 {
+	ProfileScope("Game::tick");
+
 	// If any sub-panels are active, tick the top one by delta time. Otherwise, 
 	// tick the main panel.
 	if (this->subPanels.size() > 0)
@@ -365,13 +793,43 @@ void Game::tick(double dt)
 
 void Game::render()
 {
-	// Draw the panel's main content.
-	this->panel->render(this->renderer);
+	ProfileScope("Game::render");
+
+	// The frame responds to the input handled during the tick. Panels that take input
+	// later in the frame set it again.
+	this->renderer.setFrameInput(this->inputManager.getInputTime(),
+		this->inputManager.inputWasPressed());
+	this->renderer.setLatencyFlash(this->options.getSnapshot().latencyFlash);
+
+	// Screenshots and video read the frame back after it's presented, which only the
+	// native frame buffer allows.
+	this->renderer.setKeepNativeFrame(
+		(this->screenshotFramesLeft > 0) || this->videoCapture.isRecording());
+
+	// Panels beneath the top-most opaque sub-panel are hidden, so they aren't drawn (which
+	// skips the game world under a full-screen pop-up). Only the letterbox is cleared for
+	// them.
+	int firstSubPanel = static_cast<int>(this->subPanels.size()) - 1;
+	while ((firstSubPanel >= 0) && !this->subPanels[firstSubPanel]->isOpaque())
+	{
+		firstSubPanel--;
+	}
 
-	// Draw any sub-panels back to front.
-	for (auto &subPanel : this->subPanels)
+	if (firstSubPanel >= 0)
 	{
-		subPanel->render(this->renderer);
+		this->renderer.clear();
+	}
+	else
+	{
+		// Draw the panel's main content.
+		this->panel->render(this->renderer);
+		firstSubPanel = 0;
+	}
+
+	// Draw any visible sub-panels back to front.
+	for (int i = firstSubPanel; i < static_cast<int>(this->subPanels.size()); i++)
+	{
+		this->subPanels[i]->render(this->renderer);
 	}
 
 	const bool subPanelsExist = this->subPanels.size() > 0;
@@ -398,12 +856,32 @@ void Game::render()
 		// The panel should not be drawing the cursor themselves. It's done here 
 		// just to make sure that the cursor is drawn only once and is always drawn last.
 		this->renderer.drawCursor(cursor.first, cursor.second,
-			this->inputManager.getMousePosition(), this->options.getCursorScale());
+			this->inputManager.getMousePosition(), this->options.getSnapshot().cursorScale);
 	}
 
 	this->renderer.present();
 }
 
+bool Game::isIdle() const
+{
+	return (this->subPanels.size() > 0) ? this->subPanels.back()->isIdle() :
+		this->panel->isIdle();
+}
+
+int Game::getBackgroundMode() const
+{
+	// Headless runs have no window, and recordings and replays need every frame to go
+	// the same way.
+	const OptionsSnapshot &options = this->options.getSnapshot();
+	if ((options.headless != 0) || (this->inputManager.getMode() != InputManager::Mode::Live) ||
+		(this->windowFocused && this->windowVisible))
+	{
+		return 0;
+	}
+
+	return this->gameDataIsActive() ? options.gameBackgroundMode : options.menuBackgroundMode;
+}
+
 void Game::loop()
 {
 	// Longest allowed frame time in microseconds.
@@ -411,6 +889,17 @@ void Game::loop()
 
 	auto thisTime = std::chrono::high_resolution_clock::now();
 
+	// Whether the last wait for events on an idle panel timed out without any, in which
+	// case the screen doesn't need redrawing.
+	bool idleTimeout = false;
+
+	// Seconds since the frame time statistics were last saved.
+	double frameStatsTime = 0.0;
+
+	// Whether the last frame was throttled in the background, so its time says nothing
+	// about how long frames take.
+	bool backgroundFrame = false;
+
 	// Primary game loop.
 	bool running = true;
 	while (running)
@@ -418,43 +907,217 @@ void Game::loop()
 		const auto lastTime = thisTime;
 		thisTime = std::chrono::high_resolution_clock::now();
 
+		// Everything allocated for the previous frame is done with.
+		this->frameAllocator.reset();
+
+		const uint64_t allocationCount = AllocationCounter::getCount();
+		this->lastFrameAllocations = allocationCount - this->allocationCount;
+		this->allocationCount = allocationCount;
+
+		const OptionsSnapshot &options = this->options.getSnapshot();
+
 		// Fastest allowed frame time in microseconds.
 		const std::chrono::duration<int64_t, std::micro> minimumMS(
-			1000000 / this->options.getTargetFPS());
-
-		// Delay the current frame if the previous one was too fast.
+			1000000 / options.targetFPS);
+
+		// When presenting waits for vertical sync and the target frame rate is at least the
+		// display's, the driver already paces frames, and limiting them here too would only
+		// make them miss a refresh.
+		const int refreshRate = this->renderer.getRefreshRate();
+		const bool paceWithVSync = this->renderer.isVSyncEnabled() && (refreshRate > 0) &&
+			(options.targetFPS >= refreshRate);
+
+		// Headless runs go as fast as they can. With a fixed step, every frame advances
+		// the game by the target frame time no matter how long it took.
+		const bool headless = options.headless != 0;
+		const bool fixedStep = options.headless == 2;
+
+		// Delay the current frame if the previous one was too fast. The time before 
+		// sleeping is how long the previous frame actually took to run.
 		auto frameTime = std::chrono::duration_cast<std::chrono::microseconds>(thisTime - lastTime);
-		if (frameTime < minimumMS)
+		const double workTime = static_cast<double>(frameTime.count()) / 1000000.0;
+		if (!headless && !paceWithVSync && (frameTime < minimumMS))
 		{
-			const auto sleepTime = minimumMS - frameTime;
-			std::this_thread::sleep_for(sleepTime);
+			const auto targetTime = lastTime + minimumMS;
+
+			// A plain sleep often wakes up late, so the precise limiter sleeps until just
+			// before the end of the frame and yields for the rest.
+			if (options.preciseFramePacing)
+			{
+				const std::chrono::microseconds spinTime(Game::SPIN_WAIT_MICROSECONDS);
+				const auto sleepTime = (minimumMS - frameTime) - spinTime;
+				if (sleepTime.count() > 0)
+				{
+					std::this_thread::sleep_for(sleepTime);
+				}
+
+				while (std::chrono::high_resolution_clock::now() < targetTime)
+				{
+					std::this_thread::yield();
+				}
+			}
+			else
+			{
+				std::this_thread::sleep_until(targetTime);
+			}
+
 			thisTime = std::chrono::high_resolution_clock::now();
 			frameTime = std::chrono::duration_cast<std::chrono::microseconds>(thisTime - lastTime);
 		}
 
-		// Clamp the delta time to at most the maximum frame time.
-		const double dt = std::fmin(frameTime.count(), maximumMS.count()) / 1000000.0;
-
-		// Update the input manager's state.
-		this->inputManager.update();
+		// Update the input manager's state, with the delta time clamped to at most the
+		// maximum frame time. A replay gives back the recorded delta time instead.
+		const double frameSeconds = fixedStep ?
+			(static_cast<double>(minimumMS.count()) / 1000000.0) :
+			(std::fmin(frameTime.count(), maximumMS.count()) / 1000000.0);
+		const double dt = this->inputManager.update(frameSeconds);
 
 		// Update the audio manager, checking for finished sounds.
 		this->audioManager.update();
 
-		// Update FPS counter.
+		// Update FPS counter. The statistics get the unclamped frame time so long frames
+		// aren't hidden, along with the type of the panel that's on top.
 		this->fpsCounter.updateFrameTime(dt);
 
+		const double rawFrameTime = static_cast<double>(frameTime.count()) / 1000000.0;
+		const Panel &topPanel = (this->subPanels.size() > 0) ?
+			*this->subPanels.back() : *this->panel;
+		if (!backgroundFrame)
+		{
+			this->fpsCounter.recordFrameTime(rawFrameTime,
+				static_cast<double>(options.hitchThreshold) / 1000.0,
+				typeid(topPanel).name());
+		}
+
+		// Periodically save the statistics if enabled.
+		const int frameStatsInterval = options.frameStatsInterval;
+		frameStatsTime += rawFrameTime;
+		if ((frameStatsInterval > 0) &&
+			(frameStatsTime >= static_cast<double>(frameStatsInterval)))
+		{
+			this->fpsCounter.saveStatistics(this->optionsPath);
+			frameStatsTime = 0.0;
+		}
+
+		// Adjust the game world resolution to stay within the frame time budget.
+		if (!backgroundFrame)
+		{
+			this->updateDynamicResolution(workTime, dt);
+		}
+
+		// The game world might still be drawing the previous frame. It reads its own copy
+		// of the game state, so the next frame is ticked alongside it. A profiler capture
+		// is the exception, since one can only be saved once no other thread is in a
+		// profiled scope.
+		if (Profiler::isCapturing())
+		{
+			this->renderer.waitForWorldRendering();
+		}
+
+		Profiler::endFrame();
+
 		// Listen for input events.
 		this->handleEvents(running);
+		const int backgroundMode = this->getBackgroundMode();
 
 		// Animate the current game state by delta time.
 		this->tick(dt);
 
-		// Draw to the screen.
-		this->render();
+		// Draw to the screen, unless the window is in the background and nothing covering
+		// part of it moved away.
+		if (!idleTimeout && ((backgroundMode == 0) || this->windowExposed))
+		{
+			this->windowExposed = false;
+			this->render();
+
+			const double inputLatency = this->renderer.getInputLatency();
+			if (inputLatency >= 0.0)
+			{
+				this->fpsCounter.recordInputLatency(inputLatency);
+			}
+		}
+
+		if (this->screenshotFramesLeft > 0)
+		{
+			this->saveScreenshot();
+			this->screenshotFramesLeft--;
+		}
+
+		// The video gets the unclamped frame time, so hitches last as long as they did.
+		this->videoCapture.captureFrame(this->renderer, rawFrameTime);
+
+		// Startup is over once the first frame is presented.
+		if (!StartupTimeline::isFinished())
+		{
+			StartupTimeline::mark("First frame");
+			StartupTimeline::finish(this->options.getSaveStartupTimeline() ?
+				this->optionsPath : std::string());
+		}
+
+		// Finish up jobs that need the main thread (for SDL and OpenAL calls) in whatever
+		// is left of this frame's time, so background work doesn't make the frame late.
+		// The rest wait for the next frame.
+		const std::chrono::duration<double> frameElapsed =
+			std::chrono::high_resolution_clock::now() - thisTime;
+		const double frameBudget = paceWithVSync ? (1.0 / static_cast<double>(refreshRate)) :
+			(static_cast<double>(minimumMS.count()) / 1000000.0);
+		this->jobSystem.runMainThreadCallbacks(
+			std::max(frameBudget - frameElapsed.count(), 0.0));
+
+		// The frame is presented, so images that weren't used in it can be freed if the
+		// texture caches are over budget.
+		this->textureManager.setMemoryBudget(
+			static_cast<size_t>(options.textureMemoryBudget) * 1024 * 1024);
+		this->textureManager.setIndexedImages(options.indexedImages);
+		this->textureManager.endFrame();
+
+		// An idle panel only changes in response to events, so instead of redrawing it at
+		// the target frame rate, block until the next one. The wait isn't frame time.
+		// Replays have no real events to wait for.
+		// In the background, the game either keeps updating a few times a second without
+		// drawing, or stops until the window is back. Paused time isn't frame time, so the
+		// game resumes where it was.
+		idleTimeout = false;
+		backgroundFrame = backgroundMode != 0;
+		if (running && (backgroundMode == 2))
+		{
+			const auto waitStartTime = std::chrono::high_resolution_clock::now();
+			while (running && (this->getBackgroundMode() == 2))
+			{
+				SDL_WaitEventTimeout(nullptr, Game::IDLE_WAIT_MS);
+				this->handleEvents(running);
+				this->audioManager.update();
+
+				// An unfocused window can still be partly on screen, so it's redrawn as is
+				// when exposed.
+				if (running && this->windowExposed)
+				{
+					this->windowExposed = false;
+					this->render();
+				}
+			}
+
+			thisTime += std::chrono::high_resolution_clock::now() - waitStartTime;
+		}
+		else if (running && (backgroundMode == 1))
+		{
+			SDL_WaitEventTimeout(nullptr, Game::BACKGROUND_WAIT_MS);
+		}
+		else if (running && !headless && this->isIdle() && (this->screenshotFramesLeft == 0) &&
+			(this->inputManager.getMode() != InputManager::Mode::Replaying))
+		{
+			const auto waitStartTime = std::chrono::high_resolution_clock::now();
+			idleTimeout = SDL_WaitEventTimeout(nullptr, Game::IDLE_WAIT_MS) == 0;
+			thisTime += std::chrono::high_resolution_clock::now() - waitStartTime;
+		}
 	}
 
 	// At this point, the program has received an exit signal, and is now 
 	// quitting peacefully.
 	this->options.saveChanges();
+
+	if (this->options.getFrameStatsInterval() > 0)
+	{
+		this->fpsCounter.saveStatistics(this->optionsPath);
+	}
 }
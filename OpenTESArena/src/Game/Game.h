@@ -1,8 +1,12 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <string>
+#include <typeindex>
+#include <typeinfo>
 #include <vector>
 
 #include "GameData.h"
@@ -11,10 +15,15 @@
 #include "../Assets/MiscAssets.h"
 #include "../Interface/FPSCounter.h"
 #include "../Interface/Panel.h"
+#include "../Interface/TextRenderer.h"
 #include "../Media/AudioManager.h"
 #include "../Media/FontManager.h"
 #include "../Media/TextureManager.h"
+#include "../Rendering/DynamicResolution.h"
 #include "../Rendering/Renderer.h"
+#include "../Rendering/VideoCapture.h"
+#include "../Utilities/FrameAllocator.h"
+#include "../Utilities/JobSystem.h"
 
 // This class holds the current game data, manages the primary game loop, and 
 // updates the game state each frame.
@@ -33,6 +42,52 @@ enum class MusicName;
 class Game
 {
 private:
+	// Longest time the game loop waits for an event while the active panel is idle, so
+	// things like finished sounds are still checked regularly.
+	static const int IDLE_WAIT_MS;
+
+	// Time the game loop waits for an event between updates while it's in the background
+	// and not drawing.
+	static const int BACKGROUND_WAIT_MS;
+
+	// How long before the end of a frame the precise frame limiter stops sleeping and
+	// yields instead, since a sleep can overshoot by about a scheduler tick.
+	static const int SPIN_WAIT_MICROSECONDS;
+
+	// Number of frames recorded by a trace capture, and the file it's saved to in the
+	// options folder. Captures only exist when the profiler is compiled in.
+	static const int TRACE_CAPTURE_FRAMES;
+	static const std::string TRACE_FILENAME;
+
+	// Input recording in the options folder, written or replayed depending on the options.
+	static const std::string INPUT_RECORDING_FILENAME;
+
+	// Number of frames saved by a burst screenshot (Shift + Print Screen), and the most
+	// screenshots that can be waiting on workers before the next one waits for them.
+	static const int SCREENSHOT_BURST_FRAMES;
+	static const int MAX_PENDING_SCREENSHOTS;
+
+	// A screenshot being saved by a worker. Its pixels go back to the free buffers once
+	// it's done.
+	struct PendingScreenshot
+	{
+		JobSystem::JobHandle job;
+		std::shared_ptr<std::vector<uint32_t>> pixels;
+	};
+
+	// A replaced panel kept for resuming later, by its type.
+	struct PooledPanel
+	{
+		std::type_index type;
+		std::unique_ptr<Panel> panel;
+
+		PooledPanel(const std::type_index &type, std::unique_ptr<Panel> panel);
+	};
+
+	// Worker threads shared by everything in the game. It's declared first so it's
+	// destroyed after anything that might have jobs in it.
+	JobSystem jobSystem;
+
 	// A vector of sub-panels treated like a stack. The top of the stack is the back.
 	// Sub-panels are more lightweight than panels and are intended to be like pop-ups.
 	std::vector<std::unique_ptr<Panel>> subPanels;
@@ -43,21 +98,58 @@ private:
 	std::unique_ptr<GameData> gameData;
 	Options options;
 	std::unique_ptr<Panel> panel, nextPanel, nextSubPanel;
+	std::vector<PooledPanel> panelPool; // Suspended panels, least recently used first.
 	Renderer renderer;
+	TextRenderer textRenderer;
 	TextureManager textureManager;
+	VideoCapture videoCapture; // Toggled with Ctrl + Print Screen.
 	MiscAssets miscAssets;
 	FPSCounter fpsCounter;
+	DynamicResolution dynamicResolution;
+	FrameAllocator frameAllocator; // Reset at the top of each frame.
 	std::string basePath, optionsPath;
+	std::deque<PendingScreenshot> pendingScreenshots; // Oldest first.
+	std::vector<std::shared_ptr<std::vector<uint32_t>>> screenshotBuffers; // Free to reuse.
+	int screenshotIndex; // Lowest index that might not have a screenshot file yet.
+	int screenshotFramesLeft; // Frames still to be saved as screenshots.
+	uint64_t allocationCount; // Heap allocations counted before the current frame.
+	uint64_t lastFrameAllocations; // Heap allocations in the previous frame.
+	bool windowFocused, windowVisible; // From window events, for the background modes.
+	bool windowExposed; // Whether the window needs redrawing while in the background.
 	bool requestedSubPanelPop;
+	bool nextPanelPooled; // Whether the next panel is resumed from the pool.
 
 	void initOptions(const std::string &basePath, const std::string &optionsPath);
 
 	// Resizes the SDL renderer and any other renderer-associated components.
 	void resizeWindow(int width, int height);
 
-	// Saves the given surface as a BMP file in the screenshots folder at the lowest
-	// available index.
-	void saveScreenshot(const Surface &surface);
+	// Brings the renderer up to date with an option that was just set.
+	void handleOptionChange(OptionName name);
+
+	// Times the software renderer's settings that don't change the picture and saves the
+	// fastest, if autotuning is on and they weren't tuned for this CPU and resolution.
+	void autotuneRenderer();
+
+	// Changes the game world's resolution scale if dynamic resolution is enabled and the 
+	// most recent frame times call for it.
+	void updateDynamicResolution(double workTime, double dt);
+
+	// Reads the frame and saves it on a worker as a BMP file in the screenshots folder,
+	// at the lowest available index.
+	void saveScreenshot();
+
+	// Starts recording video to the screenshots folder at the lowest available index, or
+	// stops the recording in progress.
+	void toggleVideoCapture();
+
+	// Keeps a replaced panel in the pool if it's poolable, evicting the least recently
+	// used ones while the pool is over its budget.
+	void poolPanel(std::unique_ptr<Panel> panel);
+
+	// Takes the pooled panel of the given type out of the pool, or returns null if there
+	// isn't one.
+	std::unique_ptr<Panel> takePooledPanel(const std::type_index &type);
 
 	// Handles any changes in panels after an SDL event or game tick.
 	void handlePanelChanges();
@@ -70,6 +162,14 @@ private:
 
 	// Runs the current panel's render method for drawing to the screen.
 	void render();
+
+	// Returns whether the top-most panel is idle, so nothing needs redrawing until the
+	// next event.
+	bool isIdle() const;
+
+	// Gets the background mode option for the menus or the game world if the window is in
+	// the background (minimized, hidden, or unfocused), or 0 (keep running) otherwise.
+	int getBackgroundMode() const;
 public:
 	Game();
 	Game(const Game&) = delete;
@@ -88,6 +188,9 @@ public:
 	// Gets the font manager object for creating text with.
 	FontManager &getFontManager();
 
+	// Gets the text renderer for drawing text that changes often.
+	TextRenderer &getTextRenderer();
+
 	// Determines if a game session is currently running. This is true when a player
 	// is loaded into memory.
 	bool gameDataIsActive() const;
@@ -102,6 +205,17 @@ public:
 	// Gets the renderer object for rendering methods.
 	Renderer &getRenderer();
 
+	// Gets the job system for running work on other threads.
+	JobSystem &getJobSystem();
+
+	// Gets the allocator for memory that's only needed until the end of the frame. It's
+	// for the main thread only.
+	FrameAllocator &getFrameAllocator();
+
+	// Gets the number of heap allocations made by all threads in the previous frame.
+	// Always zero unless AllocationCounter::isEnabled().
+	uint64_t getLastFrameAllocationCount() const;
+
 	// Gets the texture manager object for loading images from file.
 	TextureManager &getTextureManager();
 
@@ -117,7 +231,24 @@ public:
 	template <class T, typename... Args>
 	void setPanel(Args&&... args)
 	{
+		// A newly constructed panel replaces any pooled one of its type.
+		this->takePooledPanel(typeid(T));
 		this->nextPanel = std::make_unique<T>(std::forward<Args>(args)...);
+		this->nextPanelPooled = false;
+	}
+
+	// Like setPanel(), but resumes the pooled panel of the same type if there is one,
+	// instead of constructing it. The arguments are only used when constructing, so this
+	// is for panels that don't depend on them changing.
+	template <class T, typename... Args>
+	void setPooledPanel(Args&&... args)
+	{
+		this->nextPanel = this->takePooledPanel(typeid(T));
+		this->nextPanelPooled = this->nextPanel.get() != nullptr;
+		if (!this->nextPanelPooled)
+		{
+			this->nextPanel = std::make_unique<T>(std::forward<Args>(args)...);
+		}
 	}
 
 	// Non-templated substitute for setPanel(), for when the panel takes considerable
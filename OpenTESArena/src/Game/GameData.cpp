@@ -62,6 +62,34 @@ namespace
 		{ WeatherType::Overcast2, 30.0 },
 		{ WeatherType::SnowOvercast2, 20.0 }
 	};
+
+	// Keys of prepared worlds, from what each kind of location is built from.
+	std::string makeInteriorKey(const std::string &mifName)
+	{
+		return "Interior " + String::toUppercase(mifName);
+	}
+
+	std::string makeDungeonKey(uint32_t seed, bool isArtifactDungeon)
+	{
+		return "Dungeon " + std::to_string(seed) + (isArtifactDungeon ? " artifact" : "");
+	}
+
+	std::string makePremadeCityKey(const std::string &mifName, WeatherType weatherType)
+	{
+		return "City " + String::toUppercase(mifName) + " " +
+			std::to_string(static_cast<int>(weatherType));
+	}
+
+	std::string makeWildDungeonKey(uint32_t seed)
+	{
+		return "Wild dungeon " + std::to_string(seed);
+	}
+
+	std::string makeCityKey(int localCityID, int provinceID, WeatherType weatherType)
+	{
+		return "City " + std::to_string(localCityID) + " " + std::to_string(provinceID) +
+			" " + std::to_string(static_cast<int>(weatherType));
+	}
 }
 
 // Arbitrary value for testing. One real second = six game minutes.
@@ -70,6 +98,17 @@ const double GameData::TIME_SCALE = static_cast<double>(Clock::SECONDS_IN_A_DAY)
 
 const double GameData::DEFAULT_INTERIOR_FOG_DIST = 25.0;
 
+const int GameData::MAX_CACHED_WORLDS = 4;
+
+GameData::WorldSource::WorldSource()
+{
+	this->kind = Kind::None;
+	this->isArtifactDungeon = false;
+	this->wildBlockX = 0;
+	this->wildBlockY = 0;
+	this->rmdIDs.fill(0);
+}
+
 GameData::GameData(Player &&player, const MiscAssets &miscAssets)
 	: player(std::move(player)), triggerText(0.0, nullptr), actionText(0.0, nullptr),
 	effectText(0.0, nullptr)
@@ -223,11 +262,258 @@ MusicName GameData::getInteriorMusicName(const std::string &mifName, Random &ran
 	}
 }
 
+WorldData GameData::makeCityWorld(int localCityID, int provinceID, WeatherType weatherType,
+	const MiscAssets &miscAssets, JobSystem &jobSystem, LoadProgress &progress)
+{
+	const int globalCityID = CityDataFile::getGlobalCityID(localCityID, provinceID);
+
+	// Check that the IDs are in the proper range. Although 256 is a valid city ID,
+	// loadPremadeCity() should be called instead for that case.
+	DebugAssert(provinceID != 8, "Use loadPremadeCity() instead for center province.");
+	DebugAssert((globalCityID >= 0) && (globalCityID < 256),
+		"Invalid city ID \"" + std::to_string(globalCityID) + "\".");
+	
+	// Determine city traits from the given city ID.
+	const LocationType locationType = Location::getCityType(localCityID);
+	const ExeData::CityGeneration &cityGen = miscAssets.getExeData().getCityGen();
+	const bool isCityState = locationType == LocationType::CityState;
+	const bool isCoastal = std::find(cityGen.coastalCityList.begin(),
+		cityGen.coastalCityList.end(), globalCityID) != cityGen.coastalCityList.end();
+	const int templateCount = CityDataFile::getCityTemplateCount(isCoastal, isCityState);
+	const int templateID = globalCityID % templateCount;
+
+	const MIFFile &mif = [locationType, &cityGen, isCoastal, templateID]() -> const MIFFile&
+	{
+		// Get the index into the template names array (town%d.mif, ..., cityw%d.mif).
+		const int nameIndex = CityDataFile::getCityTemplateNameIndex(locationType, isCoastal);
+
+		// Get the template name associated with the city ID.
+		std::string templateName = cityGen.templateFilenames.at(nameIndex);
+		templateName = String::replace(templateName, "%d", std::to_string(templateID + 1));
+		templateName = String::toUppercase(templateName);
+
+		return MIFFile::get(templateName);
+	}();
+
+	// City block count (6x6, 5x5, 4x4).
+	const int cityDim = CityDataFile::getCityDimensions(locationType);
+
+	// Get the reserved block list for the given city.
+	const std::vector<uint8_t> &reservedBlocks = [&cityGen, isCoastal, templateID]()
+	{
+		const int index = CityDataFile::getCityReservedBlockListIndex(isCoastal, templateID);
+		return cityGen.reservedBlockLists.at(index);
+	}();
+
+	// Get the starting position of city blocks within the city skeleton.
+	const Int2 startPosition = [locationType, &cityGen, isCoastal, templateID]()
+	{
+		const int index = CityDataFile::getCityStartingPositionIndex(
+			locationType, isCoastal, templateID);
+
+		const auto &pair = cityGen.startingPositions.at(index);
+		return Int2(pair.first, pair.second);
+	}();
+
+	// Call city WorldData loader.
+	return WorldData::loadCity(localCityID, provinceID, mif, cityDim, reservedBlocks,
+		startPosition, weatherType, miscAssets, jobSystem, progress);
+}
+
+void GameData::prepareWorld(const std::string &key,
+	const std::function<WorldData(LoadProgress&)> &load, TextureManager &textureManager,
+	JobSystem &jobSystem)
+{
+	if ((this->preparedWorld.get() != nullptr) && (this->preparedWorld->key == key))
+	{
+		return;
+	}
+
+	// A world being replaced doesn't need to finish.
+	this->cancelPreparedWorld();
+
+	// The job and its callback only hold the world and its progress, so they're fine to
+	// outlive both this prepared world and the game data.
+	auto worldData = std::make_shared<WorldData>();
+	auto progress = std::make_shared<LoadProgress>();
+	this->preparedWorld = std::make_unique<PreparedWorld>();
+	this->preparedWorld->key = key;
+	this->preparedWorld->worldData = worldData;
+	this->preparedWorld->progress = progress;
+	this->preparedWorld->jobSystem = &jobSystem;
+	this->preparedWorld->job = jobSystem.add([load, worldData, progress]()
+	{
+		// Loads that don't report stages of their own are one stage.
+		progress->beginStage("Building world");
+		WorldData loadedWorldData = load(*progress);
+
+		if (!progress->isCancelled())
+		{
+			*worldData = std::move(loadedWorldData);
+		}
+	}, std::vector<JobSystem::JobHandle>(), [worldData, &textureManager, &jobSystem]()
+	{
+		// Does nothing if the world was already taken or the build was cancelled.
+		worldData->prefetchLevel(worldData->getCurrentLevel(), textureManager, jobSystem);
+	});
+}
+
+void GameData::cacheWorld(const std::string &nextKey, TextureManager &textureManager,
+	Renderer &renderer)
+{
+	if (this->worldKey.size() > 0)
+	{
+		// What the world drew is kept with it for when it's entered again.
+		this->worldData.recordTextureWorkingSet(textureManager, renderer);
+
+		// Changes the player made there aren't kept when travelling, the same as when the
+		// world is generated again.
+		this->worldData.reset();
+
+		CachedWorld cachedWorld;
+		cachedWorld.key = std::move(this->worldKey);
+		cachedWorld.worldData = std::move(this->worldData);
+		this->cachedWorlds.insert(this->cachedWorlds.begin(), std::move(cachedWorld));
+
+		if (this->cachedWorlds.size() > static_cast<size_t>(GameData::MAX_CACHED_WORLDS))
+		{
+			this->cachedWorlds.pop_back();
+		}
+	}
+
+	this->worldKey = nextKey;
+}
+
+WorldData GameData::takePreparedWorld(const std::string &key,
+	const std::function<WorldData(LoadProgress&)> &load, TextureManager &textureManager,
+	Renderer &renderer)
+{
+	this->cacheWorld(key, textureManager, renderer);
+
+	const auto cachedIter = std::find_if(this->cachedWorlds.begin(), this->cachedWorlds.end(),
+		[&key](const CachedWorld &cachedWorld)
+	{
+		return cachedWorld.key == key;
+	});
+
+	if (cachedIter != this->cachedWorlds.end())
+	{
+		// A world prepared for the same place isn't needed anymore.
+		if ((this->preparedWorld.get() != nullptr) && (this->preparedWorld->key == key))
+		{
+			this->cancelPreparedWorld();
+		}
+
+		WorldData worldData = std::move(cachedIter->worldData);
+		this->cachedWorlds.erase(cachedIter);
+		return worldData;
+	}
+
+	std::unique_ptr<PreparedWorld> prepared = std::move(this->preparedWorld);
+	if ((prepared.get() == nullptr) || (prepared->key != key))
+	{
+		if (prepared.get() != nullptr)
+		{
+			prepared->progress->cancel();
+		}
+
+		LoadProgress progress;
+		return load(progress);
+	}
+
+	prepared->jobSystem->wait(prepared->job);
+	return std::move(*prepared->worldData);
+}
+
+bool GameData::preparedWorldIsBuilt() const
+{
+	return (this->preparedWorld.get() == nullptr) ||
+		this->preparedWorld->jobSystem->isDone(this->preparedWorld->job);
+}
+
+const LoadProgress &GameData::getPreparedWorldProgress() const
+{
+	DebugAssert(this->preparedWorld.get() != nullptr, "No world is prepared.");
+	return *this->preparedWorld->progress;
+}
+
+void GameData::prefetchPreparedWorld(TextureManager &textureManager) const
+{
+	DebugAssert(this->preparedWorldIsBuilt(), "The prepared world isn't built yet.");
+
+	if (this->preparedWorld.get() != nullptr)
+	{
+		WorldData &worldData = *this->preparedWorld->worldData;
+		worldData.prefetchLevel(worldData.getCurrentLevel(), textureManager,
+			*this->preparedWorld->jobSystem);
+	}
+}
+
+void GameData::cancelPreparedWorld()
+{
+	if (this->preparedWorld.get() != nullptr)
+	{
+		this->preparedWorld->progress->cancel();
+		this->preparedWorld = nullptr;
+	}
+}
+
+void GameData::prepareInterior(const std::string &mifName, TextureManager &textureManager,
+	JobSystem &jobSystem)
+{
+	this->prepareWorld(makeInteriorKey(mifName), [mifName](LoadProgress&)
+	{
+		return WorldData::loadInterior(MIFFile::get(mifName));
+	}, textureManager, jobSystem);
+}
+
+void GameData::prepareNamedDungeon(int localDungeonID, int provinceID, bool isArtifactDungeon,
+	TextureManager &textureManager, JobSystem &jobSystem)
+{
+	// Same parameters as loadNamedDungeon().
+	const uint32_t dungeonSeed = this->cityData.getDungeonSeed(localDungeonID, provinceID);
+	const int widthChunks = 2;
+	const int depthChunks = 1;
+	this->prepareWorld(makeDungeonKey(dungeonSeed, isArtifactDungeon),
+		[dungeonSeed, widthChunks, depthChunks, isArtifactDungeon](LoadProgress&)
+	{
+		return WorldData::loadDungeon(dungeonSeed, widthChunks, depthChunks, isArtifactDungeon);
+	}, textureManager, jobSystem);
+}
+
+void GameData::preparePremadeCity(const std::string &mifName, WeatherType weatherType,
+	const MiscAssets &miscAssets, TextureManager &textureManager, JobSystem &jobSystem)
+{
+	// Same climate as loadPremadeCity().
+	const ClimateType climateType = Location::getCityClimateType(0, 8, miscAssets);
+	this->prepareWorld(makePremadeCityKey(mifName, weatherType),
+		[mifName, climateType, weatherType](LoadProgress&)
+	{
+		return WorldData::loadPremadeCity(MIFFile::get(mifName), climateType, weatherType);
+	}, textureManager, jobSystem);
+}
+
+void GameData::prepareCity(int localCityID, int provinceID, WeatherType weatherType,
+	const MiscAssets &miscAssets, TextureManager &textureManager, JobSystem &jobSystem)
+{
+	// The misc assets and job system live as long as the game, so the job can refer to them.
+	this->prepareWorld(makeCityKey(localCityID, provinceID, weatherType),
+		[localCityID, provinceID, weatherType, &miscAssets, &jobSystem](LoadProgress &progress)
+	{
+		return GameData::makeCityWorld(localCityID, provinceID, weatherType, miscAssets,
+			jobSystem, progress);
+	}, textureManager, jobSystem);
+}
+
 void GameData::loadInterior(const MIFFile &mif, const Location &location,
 	TextureManager &textureManager, Renderer &renderer)
 {
-	// Call interior WorldData loader.
-	this->worldData = WorldData::loadInterior(mif);
+	// Call interior WorldData loader, unless it was prepared already.
+	this->worldData = this->takePreparedWorld(makeInteriorKey(mif.getName()),
+		[&mif](LoadProgress&)
+	{
+		return WorldData::loadInterior(mif);
+	}, textureManager, renderer);
 	this->worldData.setLevelActive(this->worldData.getCurrentLevel(), textureManager, renderer);
 
 	// Set player starting position and velocity.
@@ -237,9 +523,12 @@ void GameData::loadInterior(const MIFFile &mif, const Location &location,
 
 	// Set location.
 	this->location = location;
+	this->worldSource = WorldSource();
+	this->worldSource.kind = WorldSource::Kind::Interior;
+	this->worldSource.mifName = mif.getName();
 
 	// Set interior sky palette.
-	const auto &level = this->worldData.getLevels().at(this->worldData.getCurrentLevel());
+	const auto &level = this->worldData.getActiveLevel();
 	const uint32_t skyColor = level.getInteriorSkyColor();
 	renderer.setSkyPalette(&skyColor, 1);
 
@@ -260,11 +549,15 @@ void GameData::loadNamedDungeon(int localDungeonID, int provinceID, bool isArtif
 	// Generate dungeon seed.
 	const uint32_t dungeonSeed = this->cityData.getDungeonSeed(localDungeonID, provinceID);
 
-	// Call dungeon WorldData loader with parameters specific to named dungeons.
+	// Call dungeon WorldData loader with parameters specific to named dungeons, unless it
+	// was prepared already.
 	const int widthChunks = 2;
 	const int depthChunks = 1;
-	this->worldData = WorldData::loadDungeon(
-		dungeonSeed, widthChunks, depthChunks, isArtifactDungeon);
+	this->worldData = this->takePreparedWorld(makeDungeonKey(dungeonSeed, isArtifactDungeon),
+		[dungeonSeed, widthChunks, depthChunks, isArtifactDungeon](LoadProgress&)
+	{
+		return WorldData::loadDungeon(dungeonSeed, widthChunks, depthChunks, isArtifactDungeon);
+	}, textureManager, renderer);
 	this->worldData.setLevelActive(this->worldData.getCurrentLevel(), textureManager, renderer);
 
 	// Set player starting position and velocity.
@@ -274,9 +567,12 @@ void GameData::loadNamedDungeon(int localDungeonID, int provinceID, bool isArtif
 
 	// Set location.
 	this->location = Location::makeDungeon(localDungeonID, provinceID);
+	this->worldSource = WorldSource();
+	this->worldSource.kind = WorldSource::Kind::NamedDungeon;
+	this->worldSource.isArtifactDungeon = isArtifactDungeon;
 
 	// Set interior sky palette.
-	const auto &level = this->worldData.getLevels().at(this->worldData.getCurrentLevel());
+	const auto &level = this->worldData.getActiveLevel();
 	const uint32_t skyColor = level.getInteriorSkyColor();
 	renderer.setSkyPalette(&skyColor, 1);
 
@@ -304,8 +600,12 @@ void GameData::loadWildernessDungeon(int provinceID, int wildBlockX, int wildBlo
 	const int widthChunks = 2;
 	const int depthChunks = 2;
 	const bool isArtifactDungeon = false;
-	this->worldData = WorldData::loadDungeon(
-		wildDungeonSeed, widthChunks, depthChunks, isArtifactDungeon);
+	this->worldData = this->takePreparedWorld(makeWildDungeonKey(wildDungeonSeed),
+		[wildDungeonSeed, widthChunks, depthChunks, isArtifactDungeon](LoadProgress&)
+	{
+		return WorldData::loadDungeon(wildDungeonSeed, widthChunks, depthChunks,
+			isArtifactDungeon);
+	}, textureManager, renderer);
 	this->worldData.setLevelActive(this->worldData.getCurrentLevel(), textureManager, renderer);
 
 	// Set player starting position and velocity.
@@ -316,9 +616,13 @@ void GameData::loadWildernessDungeon(int provinceID, int wildBlockX, int wildBlo
 	// Set location (since wilderness dungeons aren't their own location, use a placeholder
 	// value for testing).
 	this->location = Location::makeSpecialCase(Location::SpecialCaseType::WildDungeon, provinceID);
+	this->worldSource = WorldSource();
+	this->worldSource.kind = WorldSource::Kind::WildernessDungeon;
+	this->worldSource.wildBlockX = wildBlockX;
+	this->worldSource.wildBlockY = wildBlockY;
 
 	// Set interior sky palette.
-	const auto &level = this->worldData.getLevels().at(this->worldData.getCurrentLevel());
+	const auto &level = this->worldData.getActiveLevel();
 	const uint32_t skyColor = level.getInteriorSkyColor();
 	renderer.setSkyPalette(&skyColor, 1);
 
@@ -338,8 +642,12 @@ void GameData::loadPremadeCity(const MIFFile &mif, WeatherType weatherType,
 	const ClimateType climateType = Location::getCityClimateType(
 		localCityID, provinceID, miscAssets);
 
-	// Call premade WorldData loader.
-	this->worldData = WorldData::loadPremadeCity(mif, climateType, weatherType);
+	// Call premade WorldData loader, unless it was prepared already.
+	this->worldData = this->takePreparedWorld(makePremadeCityKey(mif.getName(), weatherType),
+		[&mif, climateType, weatherType](LoadProgress&)
+	{
+		return WorldData::loadPremadeCity(mif, climateType, weatherType);
+	}, textureManager, renderer);
 	this->worldData.setLevelActive(this->worldData.getCurrentLevel(), textureManager, renderer);
 
 	// Set player starting position and velocity.
@@ -349,6 +657,9 @@ void GameData::loadPremadeCity(const MIFFile &mif, WeatherType weatherType,
 
 	// Set location.
 	this->location = Location::makeCity(localCityID, provinceID);
+	this->worldSource = WorldSource();
+	this->worldSource.kind = WorldSource::Kind::PremadeCity;
+	this->worldSource.mifName = mif.getName();
 
 	// Regular sky palette based on weather.
 	const std::vector<uint32_t> skyPalette =
@@ -364,61 +675,16 @@ void GameData::loadPremadeCity(const MIFFile &mif, WeatherType weatherType,
 }
 
 void GameData::loadCity(int localCityID, int provinceID, WeatherType weatherType,
-	const MiscAssets &miscAssets, TextureManager &textureManager, Renderer &renderer)
+	const MiscAssets &miscAssets, TextureManager &textureManager, Renderer &renderer,
+	JobSystem &jobSystem)
 {
-	const int globalCityID = CityDataFile::getGlobalCityID(localCityID, provinceID);
-
-	// Check that the IDs are in the proper range. Although 256 is a valid city ID,
-	// loadPremadeCity() should be called instead for that case.
-	DebugAssert(provinceID != 8, "Use loadPremadeCity() instead for center province.");
-	DebugAssert((globalCityID >= 0) && (globalCityID < 256),
-		"Invalid city ID \"" + std::to_string(globalCityID) + "\".");
-	
-	// Determine city traits from the given city ID.
-	const LocationType locationType = Location::getCityType(localCityID);
-	const ExeData::CityGeneration &cityGen = miscAssets.getExeData().cityGen;
-	const bool isCityState = locationType == LocationType::CityState;
-	const bool isCoastal = std::find(cityGen.coastalCityList.begin(),
-		cityGen.coastalCityList.end(), globalCityID) != cityGen.coastalCityList.end();
-	const int templateCount = CityDataFile::getCityTemplateCount(isCoastal, isCityState);
-	const int templateID = globalCityID % templateCount;
-
-	const MIFFile mif = [locationType, &cityGen, isCoastal, templateID]()
-	{
-		// Get the index into the template names array (town%d.mif, ..., cityw%d.mif).
-		const int nameIndex = CityDataFile::getCityTemplateNameIndex(locationType, isCoastal);
-
-		// Get the template name associated with the city ID.
-		std::string templateName = cityGen.templateFilenames.at(nameIndex);
-		templateName = String::replace(templateName, "%d", std::to_string(templateID + 1));
-		templateName = String::toUppercase(templateName);
-
-		return MIFFile(templateName);
-	}();
-
-	// City block count (6x6, 5x5, 4x4).
-	const int cityDim = CityDataFile::getCityDimensions(locationType);
-
-	// Get the reserved block list for the given city.
-	const std::vector<uint8_t> &reservedBlocks = [&cityGen, isCoastal, templateID]()
+	// Call city WorldData loader, unless it was prepared already.
+	this->worldData = this->takePreparedWorld(makeCityKey(localCityID, provinceID, weatherType),
+		[localCityID, provinceID, weatherType, &miscAssets, &jobSystem](LoadProgress &progress)
 	{
-		const int index = CityDataFile::getCityReservedBlockListIndex(isCoastal, templateID);
-		return cityGen.reservedBlockLists.at(index);
-	}();
-
-	// Get the starting position of city blocks within the city skeleton.
-	const Int2 startPosition = [locationType, &cityGen, isCoastal, templateID]()
-	{
-		const int index = CityDataFile::getCityStartingPositionIndex(
-			locationType, isCoastal, templateID);
-
-		const auto &pair = cityGen.startingPositions.at(index);
-		return Int2(pair.first, pair.second);
-	}();
-
-	// Call city WorldData loader.
-	this->worldData = WorldData::loadCity(localCityID, provinceID, mif, cityDim,
-		reservedBlocks, startPosition, weatherType, miscAssets);
+		return GameData::makeCityWorld(localCityID, provinceID, weatherType, miscAssets,
+			jobSystem, progress);
+	}, textureManager, renderer);
 	this->worldData.setLevelActive(this->worldData.getCurrentLevel(), textureManager, renderer);
 
 	// Set player starting position and velocity.
@@ -428,6 +694,8 @@ void GameData::loadCity(int localCityID, int provinceID, WeatherType weatherType
 
 	// Set location.
 	this->location = Location::makeCity(localCityID, provinceID);
+	this->worldSource = WorldSource();
+	this->worldSource.kind = WorldSource::Kind::City;
 
 	// Regular sky palette based on weather.
 	const std::vector<uint32_t> skyPalette =
@@ -450,18 +718,24 @@ void GameData::loadWilderness(int localCityID, int provinceID, int rmdTR, int rm
 	const ClimateType climateType = Location::getCityClimateType(
 		localCityID, provinceID, miscAssets);
 
-	// Call wilderness WorldData loader.
+	// Call wilderness WorldData loader. The wilderness isn't kept when left, since its
+	// window onto the blocks scrolls.
+	this->cacheWorld(std::string(), textureManager, renderer);
 	this->worldData = WorldData::loadWilderness(
 		rmdTR, rmdTL, rmdBR, rmdBL, climateType, weatherType);
 	this->worldData.setLevelActive(this->worldData.getCurrentLevel(), textureManager, renderer);
 
 	// Set arbitrary player starting position and velocity (no starting point in WILD.MIF).
+	// This is where the four blocks meet.
 	const Double2 startPoint(63.50, 63.50);
 	this->player.teleport(Double3(startPoint.x, 1.0 + Player::HEIGHT, startPoint.y));
 	this->player.setVelocityToZero();
 
 	// Set location.
 	this->location = Location::makeCity(localCityID, provinceID);
+	this->worldSource = WorldSource();
+	this->worldSource.kind = WorldSource::Kind::Wilderness;
+	this->worldSource.rmdIDs = { rmdTR, rmdTL, rmdBR, rmdBL };
 
 	// Regular sky palette based on weather.
 	const std::vector<uint32_t> skyPalette =
@@ -491,11 +765,21 @@ std::pair<double, std::unique_ptr<TextBox>> &GameData::getEffectText()
 	return this->effectText;
 }
 
+std::array<WeatherType, 36> &GameData::getWeathersArray()
+{
+	return this->weathers;
+}
+
 const std::array<WeatherType, 36> &GameData::getWeathersArray() const
 {
 	return this->weathers;
 }
 
+const GameData::WorldSource &GameData::getWorldSource() const
+{
+	return this->worldSource;
+}
+
 Player &GameData::getPlayer()
 {
 	return this->player;
@@ -531,6 +815,11 @@ ArenaRandom &GameData::getRandom()
 	return this->arenaRandom;
 }
 
+TravelRouteTable &GameData::getTravelRoutes()
+{
+	return this->travelRoutes;
+}
+
 double GameData::getDaytimePercent() const
 {
 	return this->clock.getPreciseTotalSeconds() /
@@ -627,7 +916,7 @@ void GameData::updateWeather(const ExeData &exeData)
 
 	for (size_t i = 0; i < this->weathers.size(); i++)
 	{
-		const int climateIndex = exeData.locations.climates.at(i);
+		const int climateIndex = exeData.getLocations().climates.at(i);
 		const int variantIndex = [this]()
 		{
 			// 40% for 2, 20% for 1, 20% for 3, 10% for 0, and 10% for 4.
@@ -657,7 +946,7 @@ void GameData::updateWeather(const ExeData &exeData)
 
 		const int weatherTableIndex = (climateIndex * 20) + (seasonIndex * 5) + variantIndex;
 		this->weathers.at(i) = static_cast<WeatherType>(
-			exeData.locations.weatherTable.at(weatherTableIndex));
+			exeData.getLocations().weatherTable.at(weatherTableIndex));
 	}
 }
 
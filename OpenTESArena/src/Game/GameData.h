@@ -1,6 +1,7 @@
 #ifndef GAME_DATA_H
 #define GAME_DATA_H
 
+#include <array>
 #include <functional>
 #include <memory>
 #include <string>
@@ -15,7 +16,10 @@
 #include "../Entities/Player.h"
 #include "../Math/Random.h"
 #include "../Math/Vector2.h"
+#include "../Utilities/JobSystem.h"
+#include "../Utilities/LoadProgress.h"
 #include "../World/Location.h"
+#include "../World/TravelRouteTable.h"
 #include "../World/WorldData.h"
 
 // Intended to be a container for the player and world data that is currently active 
@@ -40,6 +44,32 @@ enum class WorldType;
 
 class GameData
 {
+public:
+	// What the current world was built from, so a saved game can build it again. The
+	// location, weather, and city data cover the rest.
+	struct WorldSource
+	{
+		enum class Kind
+		{
+			None,
+			Interior,
+			NamedDungeon,
+			WildernessDungeon,
+			PremadeCity,
+			City,
+			Wilderness
+		};
+
+		Kind kind;
+		std::string mifName; // Interiors and the premade city.
+		bool isArtifactDungeon; // Named dungeons.
+		int wildBlockX, wildBlockY; // Wilderness dungeons.
+
+		// Wilderness blocks, in top right, top left, bottom right, and bottom left order.
+		std::array<int, 4> rmdIDs;
+
+		WorldSource();
+	};
 private:
 	// The time scale determines how long or short a real-time second is. If the time 
 	// scale is 5.0, then each real-time second is five game seconds, etc..
@@ -48,6 +78,28 @@ private:
 	// Arbitrary value for interior fog distance (mostly for testing purposes).
 	static const double DEFAULT_INTERIOR_FOG_DIST;
 
+	// A world being built on a worker before the player travels there. The key names the
+	// location and conditions it was built for, so arriving anywhere else builds as usual.
+	struct PreparedWorld
+	{
+		std::string key;
+		std::shared_ptr<WorldData> worldData;
+		std::shared_ptr<LoadProgress> progress;
+		JobSystem::JobHandle job;
+		JobSystem *jobSystem;
+	};
+
+	// A world the player left, reset to how it was generated, so going back to it is a
+	// move instead of a generation. The key is the same one prepared worlds use.
+	struct CachedWorld
+	{
+		std::string key;
+		WorldData worldData;
+	};
+
+	// Number of recently left worlds kept.
+	static const int MAX_CACHED_WORLDS;
+
 	std::unordered_map<Int2, std::string> textTriggers, soundTriggers;
 
 	// Game world interface display texts with their associated time remaining. These values 
@@ -64,22 +116,54 @@ private:
 	WorldData worldData;
 	Location location;
 	CityDataFile cityData;
+	TravelRouteTable travelRoutes;
 	Date date;
 	Clock clock;
 	ArenaRandom arenaRandom;
 	double fogDistance;
 	WeatherType weatherType;
+	WorldSource worldSource;
 
 	// Custom function for *LEVELUP voxel enter events. If no function is set, the default
 	// behavior is to decrement the world's level index.
 	std::function<void(Game&)> onLevelUpVoxelEnter;
 
+	// The most recently prepared destination, if any.
+	std::unique_ptr<PreparedWorld> preparedWorld;
+
+	// Recently left worlds, most recent first, and the key of the current world (empty if
+	// it isn't kept when left, like the wilderness, whose window scrolls).
+	std::vector<CachedWorld> cachedWorlds;
+	std::string worldKey;
+
 	// Creates a sky palette from the given weather. This palette covers the entire day
 	// (including night colors).
 	static std::vector<uint32_t> makeExteriorSkyPalette(WeatherType weatherType,
 		TextureManager &textureManager);
 
 	static double getFogDistanceFromWeather(WeatherType weatherType);
+
+	// Builds the world for a city after determining its .MIF file.
+	static WorldData makeCityWorld(int localCityID, int provinceID, WeatherType weatherType,
+		const MiscAssets &miscAssets, JobSystem &jobSystem, LoadProgress &progress);
+
+	// Starts building a world on a worker, replacing any prepared before. Once it's built,
+	// its starting level's voxel textures start decoding too.
+	void prepareWorld(const std::string &key,
+		const std::function<WorldData(LoadProgress&)> &load, TextureManager &textureManager,
+		JobSystem &jobSystem);
+
+	// Keeps the current world (if it has a key) in the recently left worlds before another
+	// one with the given key replaces it, along with the textures its level drew.
+	void cacheWorld(const std::string &nextKey, TextureManager &textureManager,
+		Renderer &renderer);
+
+	// Gets the world with the given key from the recently left worlds, or the one prepared
+	// with it, waiting for it if it's still being built. If neither has it, it's built
+	// here instead. The current world is kept for later.
+	WorldData takePreparedWorld(const std::string &key,
+		const std::function<WorldData(LoadProgress&)> &load, TextureManager &textureManager,
+		Renderer &renderer);
 public:
 	// Creates incomplete game data with no active world, to be further initialized later.
 	GameData(Player &&player, const MiscAssets &miscAssets);
@@ -119,19 +203,47 @@ public:
 	// Reads in data from a city after determining its .MIF file, and writes it to the game
 	// data. The local ID is the 0-31 location index within a province.
 	void loadCity(int localCityID, int provinceID, WeatherType weatherType,
-		const MiscAssets &miscAssets, TextureManager &textureManager, Renderer &renderer);
+		const MiscAssets &miscAssets, TextureManager &textureManager, Renderer &renderer,
+		JobSystem &jobSystem);
 
 	// Reads in data from wilderness and writes it to the game data.
 	void loadWilderness(int localCityID, int provinceID, int rmdTR, int rmdTL, int rmdBR,
 		int rmdBL, WeatherType weatherType, const MiscAssets &miscAssets,
 		TextureManager &textureManager, Renderer &renderer);
 
+	// Start building the world of a likely travel destination in the background. The
+	// matching load method above picks it up when the travel happens, and anything else
+	// just leaves it unused.
+	void prepareInterior(const std::string &mifName, TextureManager &textureManager,
+		JobSystem &jobSystem);
+	void prepareNamedDungeon(int localDungeonID, int provinceID, bool isArtifactDungeon,
+		TextureManager &textureManager, JobSystem &jobSystem);
+	void preparePremadeCity(const std::string &mifName, WeatherType weatherType,
+		const MiscAssets &miscAssets, TextureManager &textureManager, JobSystem &jobSystem);
+	void prepareCity(int localCityID, int provinceID, WeatherType weatherType,
+		const MiscAssets &miscAssets, TextureManager &textureManager, JobSystem &jobSystem);
+
+	// Returns whether the prepared world is done being built. True if there isn't one.
+	bool preparedWorldIsBuilt() const;
+
+	// Gets the build progress of the prepared world. There must be one.
+	const LoadProgress &getPreparedWorldProgress() const;
+
+	// Starts decoding the textures of the prepared world's starting level. It must be built.
+	void prefetchPreparedWorld(TextureManager &textureManager) const;
+
+	// Throws away the prepared world, if any, and stops its build early.
+	void cancelPreparedWorld();
+
 	std::pair<double, std::unique_ptr<TextBox>> &getTriggerText();
 	std::pair<double, std::unique_ptr<TextBox>> &getActionText();
 	std::pair<double, std::unique_ptr<TextBox>> &getEffectText();
 
+	std::array<WeatherType, 36> &getWeathersArray();
 	const std::array<WeatherType, 36> &getWeathersArray() const;
 
+	const WorldSource &getWorldSource() const;
+
 	Player &getPlayer();
 	WorldData &getWorldData();
 	Location &getLocation();
@@ -139,6 +251,7 @@ public:
 	Date &getDate();
 	Clock &getClock();
 	ArenaRandom &getRandom();
+	TravelRouteTable &getTravelRoutes();
 
 	// Gets a percentage representing how far along the current day is. 0.0 is 
 	// 12:00am and 0.50 is noon.
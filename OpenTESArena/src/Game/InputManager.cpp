@@ -1,7 +1,207 @@
+#include <algorithm>
+#include <ctime>
+
 #include "InputManager.h"
+#include "../Math/Random.h"
+#include "../Utilities/Debug.h"
+
+namespace
+{
+	template <typename T>
+	void WriteValue(std::ofstream &stream, const T &value)
+	{
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	template <typename T>
+	bool ReadValue(std::ifstream &stream, T &value)
+	{
+		stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+		return static_cast<bool>(stream);
+	}
+}
+
+// "OTAI" and the format version. Recordings from other versions aren't replayed.
+const uint32_t InputManager::RECORDING_MAGIC = 0x4941544F;
+const uint32_t InputManager::RECORDING_VERSION = 1;
 
 InputManager::InputManager()
-	: mouseDelta(0, 0) { }
+	: mouseDelta(0, 0), lateMouseDelta(0, 0), latchedMouseDelta(0, 0), mousePosition(0, 0)
+{
+	this->mode = InputManager::Mode::Live;
+	this->nextFrameEvent = 0;
+	this->keyboardState.fill(0);
+	this->mouseButtons = 0;
+	this->frameTime = 0.0;
+	this->inputPressed = false;
+}
+
+bool InputManager::isRecordable(const SDL_Event &e)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 5)
+	if (e.type == SDL_DROPTEXT)
+	{
+		return false;
+	}
+#endif
+
+	return (e.type != SDL_SYSWMEVENT) && (e.type != SDL_DROPFILE) &&
+		(e.type < SDL_USEREVENT);
+}
+
+void InputManager::updateInputTime(const SDL_Event &e)
+{
+	const bool pressed = (e.type == SDL_KEYDOWN) || (e.type == SDL_MOUSEBUTTONDOWN);
+	if (!pressed && (e.type != SDL_MOUSEMOTION) && (e.type != SDL_MOUSEWHEEL))
+	{
+		return;
+	}
+
+	// SDL's ticks and the event's timestamp share a clock, so the difference is how long
+	// the event has been waiting.
+	const uint32_t ageMS = SDL_GetTicks() - e.common.timestamp;
+	const auto eventTime = std::chrono::steady_clock::now() -
+		std::chrono::milliseconds(std::min(ageMS, static_cast<uint32_t>(1000)));
+
+	this->inputTime = std::max(this->inputTime, eventTime);
+	this->inputPressed |= pressed;
+}
+
+const uint8_t *InputManager::getKeyboardState() const
+{
+	return (this->mode == InputManager::Mode::Replaying) ?
+		this->keyboardState.data() : SDL_GetKeyboardState(nullptr);
+}
+
+void InputManager::writeFrame()
+{
+	// The keyboard state rarely changes between frames, so it's only written when it does.
+	const uint8_t *keys = SDL_GetKeyboardState(nullptr);
+	const uint8_t keyboardChanged = std::equal(this->keyboardState.begin(),
+		this->keyboardState.end(), keys) ? 0 : 1;
+
+	int mouseX, mouseY;
+	const uint32_t mouseButtons = SDL_GetMouseState(&mouseX, &mouseY);
+
+	WriteValue(this->recordingFile, this->frameTime);
+	WriteValue(this->recordingFile, static_cast<int32_t>(this->mouseDelta.x));
+	WriteValue(this->recordingFile, static_cast<int32_t>(this->mouseDelta.y));
+	WriteValue(this->recordingFile, static_cast<int32_t>(mouseX));
+	WriteValue(this->recordingFile, static_cast<int32_t>(mouseY));
+	WriteValue(this->recordingFile, mouseButtons);
+	WriteValue(this->recordingFile, keyboardChanged);
+	if (keyboardChanged != 0)
+	{
+		std::copy(keys, keys + this->keyboardState.size(), this->keyboardState.begin());
+		WriteValue(this->recordingFile, this->keyboardState);
+	}
+
+	WriteValue(this->recordingFile, static_cast<uint32_t>(this->frameEvents.size()));
+	for (const SDL_Event &e : this->frameEvents)
+	{
+		WriteValue(this->recordingFile, e);
+	}
+
+	this->frameEvents.clear();
+}
+
+bool InputManager::readFrame()
+{
+	int32_t mouseDeltaX, mouseDeltaY, mouseX, mouseY;
+	uint8_t keyboardChanged;
+	if (!ReadValue(this->replayFile, this->frameTime) ||
+		!ReadValue(this->replayFile, mouseDeltaX) ||
+		!ReadValue(this->replayFile, mouseDeltaY) ||
+		!ReadValue(this->replayFile, mouseX) ||
+		!ReadValue(this->replayFile, mouseY) ||
+		!ReadValue(this->replayFile, this->mouseButtons) ||
+		!ReadValue(this->replayFile, keyboardChanged))
+	{
+		return false;
+	}
+
+	if ((keyboardChanged != 0) && !ReadValue(this->replayFile, this->keyboardState))
+	{
+		return false;
+	}
+
+	uint32_t eventCount;
+	if (!ReadValue(this->replayFile, eventCount))
+	{
+		return false;
+	}
+
+	this->frameEvents.resize(eventCount);
+	for (SDL_Event &e : this->frameEvents)
+	{
+		if (!ReadValue(this->replayFile, e))
+		{
+			return false;
+		}
+	}
+
+	this->mouseDelta = Int2(mouseDeltaX, mouseDeltaY);
+	this->latchedMouseDelta = Int2(0, 0);
+	this->mousePosition = Int2(mouseX, mouseY);
+	this->nextFrameEvent = 0;
+	return true;
+}
+
+InputManager::Mode InputManager::getMode() const
+{
+	return this->mode;
+}
+
+void InputManager::startRecording(const std::string &filename)
+{
+	this->recordingFile.open(filename, std::ios::binary | std::ios::trunc);
+	if (!this->recordingFile.is_open())
+	{
+		DebugWarning("Couldn't open \"" + filename + "\" for recording input.");
+		return;
+	}
+
+	// Generators that would be seeded with the time are seeded from here instead.
+	const int32_t seed = static_cast<int32_t>(std::time(nullptr));
+	Random::setDefaultSeed(seed);
+
+	WriteValue(this->recordingFile, InputManager::RECORDING_MAGIC);
+	WriteValue(this->recordingFile, InputManager::RECORDING_VERSION);
+	WriteValue(this->recordingFile, static_cast<uint32_t>(sizeof(SDL_Event)));
+	WriteValue(this->recordingFile, seed);
+
+	this->mode = InputManager::Mode::Recording;
+	DebugMention("Recording input to \"" + filename + "\".");
+}
+
+void InputManager::startReplay(const std::string &filename)
+{
+	this->replayFile.open(filename, std::ios::binary);
+	if (!this->replayFile.is_open())
+	{
+		DebugWarning("Couldn't open \"" + filename + "\" for replaying input.");
+		return;
+	}
+
+	// SDL events are written as they are, so their size has to match too.
+	uint32_t magic, version, eventSize;
+	int32_t seed;
+	if (!ReadValue(this->replayFile, magic) || !ReadValue(this->replayFile, version) ||
+		!ReadValue(this->replayFile, eventSize) || !ReadValue(this->replayFile, seed) ||
+		(magic != InputManager::RECORDING_MAGIC) ||
+		(version != InputManager::RECORDING_VERSION) ||
+		(eventSize != static_cast<uint32_t>(sizeof(SDL_Event))))
+	{
+		DebugWarning("\"" + filename + "\" isn't an input recording for this build.");
+		this->replayFile.close();
+		return;
+	}
+
+	Random::setDefaultSeed(seed);
+
+	this->mode = InputManager::Mode::Replaying;
+	DebugMention("Replaying input from \"" + filename + "\".");
+}
 
 bool InputManager::keyPressed(const SDL_Event &e, SDL_Keycode keycode) const
 {
@@ -15,13 +215,13 @@ bool InputManager::keyReleased(const SDL_Event &e, SDL_Keycode keycode) const
 
 bool InputManager::keyIsDown(SDL_Scancode scancode) const
 {
-	const uint8_t *keys = SDL_GetKeyboardState(nullptr);
+	const uint8_t *keys = this->getKeyboardState();
 	return keys[scancode] != 0;
 }
 
 bool InputManager::keyIsUp(SDL_Scancode scancode) const
 {
-	const uint8_t *keys = SDL_GetKeyboardState(nullptr);
+	const uint8_t *keys = this->getKeyboardState();
 	return keys[scancode] == 0;
 }
 
@@ -37,13 +237,15 @@ bool InputManager::mouseButtonReleased(const SDL_Event &e, uint8_t button) const
 
 bool InputManager::mouseButtonIsDown(uint8_t button) const
 {
-	const uint32_t mouse = SDL_GetMouseState(nullptr, nullptr);
+	const uint32_t mouse = (this->mode == InputManager::Mode::Replaying) ?
+		this->mouseButtons : SDL_GetMouseState(nullptr, nullptr);
 	return (mouse & SDL_BUTTON(button)) != 0;
 }
 
 bool InputManager::mouseButtonIsUp(uint8_t button) const
 {
-	const uint32_t mouse = SDL_GetMouseState(nullptr, nullptr);
+	const uint32_t mouse = (this->mode == InputManager::Mode::Replaying) ?
+		this->mouseButtons : SDL_GetMouseState(nullptr, nullptr);
 	return (mouse & SDL_BUTTON(button)) == 0;
 }
 
@@ -69,6 +271,11 @@ bool InputManager::applicationExit(const SDL_Event &e) const
 
 Int2 InputManager::getMousePosition() const
 {
+	if (this->mode == InputManager::Mode::Replaying)
+	{
+		return this->mousePosition;
+	}
+
 	int x, y;
 	SDL_GetMouseState(&x, &y);
 	return Int2(x, y);
@@ -79,14 +286,132 @@ Int2 InputManager::getMouseDelta() const
 	return this->mouseDelta;
 }
 
+Int2 InputManager::getLatchedMouseDelta() const
+{
+	return this->latchedMouseDelta;
+}
+
+Int2 InputManager::latchMouseDelta()
+{
+	// Recordings only have one mouse delta per frame.
+	if (this->mode != InputManager::Mode::Live)
+	{
+		return Int2(0, 0);
+	}
+
+	// Pumped events wait in SDL's queue for the next frame's pollEvent().
+	SDL_PumpEvents();
+
+	Int2 delta;
+	SDL_GetRelativeMouseState(&delta.x, &delta.y);
+	this->lateMouseDelta = this->lateMouseDelta + delta;
+
+	// The motion events stay queued, but the frame now responds to them. Only the first
+	// few are peeked, so the newest one might be missed when there are lots of them.
+	std::array<SDL_Event, 64> motionEvents;
+	const int motionEventCount = SDL_PeepEvents(motionEvents.data(),
+		static_cast<int>(motionEvents.size()), SDL_PEEKEVENT, SDL_MOUSEMOTION, SDL_MOUSEMOTION);
+	if (motionEventCount > 0)
+	{
+		this->updateInputTime(motionEvents[motionEventCount - 1]);
+	}
+
+	return delta;
+}
+
+std::chrono::steady_clock::time_point InputManager::getInputTime() const
+{
+	return this->inputTime;
+}
+
+bool InputManager::inputWasPressed() const
+{
+	return this->inputPressed;
+}
+
 void InputManager::setRelativeMouseMode(bool active)
 {
 	SDL_bool enabled = active ? SDL_TRUE : SDL_FALSE;
 	SDL_SetRelativeMouseMode(enabled);
 }
 
-void InputManager::update()
+bool InputManager::pollEvent(SDL_Event &e)
+{
+	if (this->mode == InputManager::Mode::Replaying)
+	{
+		// The window still needs its events handled, but only quitting gets through so the
+		// replay can be stopped.
+		while (SDL_PollEvent(&e) != 0)
+		{
+			if (e.type == SDL_QUIT)
+			{
+				return true;
+			}
+		}
+
+		if (this->nextFrameEvent < this->frameEvents.size())
+		{
+			e = this->frameEvents[this->nextFrameEvent];
+			this->nextFrameEvent++;
+			return true;
+		}
+
+		return false;
+	}
+
+	const bool hasEvent = SDL_PollEvent(&e) != 0;
+	if (hasEvent)
+	{
+		this->updateInputTime(e);
+	}
+
+	if (this->mode == InputManager::Mode::Recording)
+	{
+		if (!hasEvent)
+		{
+			// The state is taken after all events are handled, matching what SDL gives
+			// the rest of the frame.
+			this->writeFrame();
+		}
+		else if (InputManager::isRecordable(e))
+		{
+			this->frameEvents.push_back(e);
+		}
+	}
+
+	return hasEvent;
+}
+
+double InputManager::update(double dt)
 {
-	// Refresh the mouse delta.
+	this->inputTime = std::chrono::steady_clock::time_point();
+	this->inputPressed = false;
+
+	if (this->mode == InputManager::Mode::Replaying)
+	{
+		if (this->readFrame())
+		{
+			return this->frameTime;
+		}
+
+		// Quitting at the end lets a replay run unattended, with frame statistics saved
+		// on exit like any other session.
+		DebugMention("Input replay finished.");
+		this->replayFile.close();
+		this->frameEvents.clear();
+		this->mode = InputManager::Mode::Live;
+
+		SDL_Event quitEvent = SDL_Event();
+		quitEvent.type = SDL_QUIT;
+		SDL_PushEvent(&quitEvent);
+	}
+
+	// Refresh the mouse delta. Motion taken late last frame is added back so the delta
+	// still covers the whole frame.
 	SDL_GetRelativeMouseState(&this->mouseDelta.x, &this->mouseDelta.y);
+	this->mouseDelta = this->mouseDelta + this->lateMouseDelta;
+	this->latchedMouseDelta = this->lateMouseDelta;
+	this->lateMouseDelta = Int2(0, 0);
+	this->frameTime = dt;
+	return dt;
 }
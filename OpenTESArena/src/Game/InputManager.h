@@ -1,7 +1,12 @@
 #ifndef INPUT_MANAGER_H
 #define INPUT_MANAGER_H
 
+#include <array>
+#include <chrono>
 #include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
 
 #include "SDL.h"
 
@@ -12,13 +17,79 @@
 // This became a necessity after seeing that SDL_GetRelativeMouseState() can only be 
 // called once per frame, so its value must be stored somewhere.
 
+// Mouse motion can also be taken again right before the game world is drawn, so the camera
+// turns by what happened during the frame's tick instead of waiting for the next frame.
+// SDL's events have to be pumped on the main thread, so this is done there instead of on
+// an input thread, and only while input is live.
+
+// The newest input event of each frame is timestamped, so the time from it to the frame
+// being presented can be measured. SDL's event times are in milliseconds, so they're turned
+// into how long the event waited and taken off the time it was polled.
+
+// Input can also be recorded to a file and replayed from it, for running the same session
+// on different builds. Each frame's delta time, events, and mouse and keyboard state are
+// written as they are (in the machine's byte order), along with the seed for unseeded
+// random generators. A replay gives all of that back instead of SDL, so the game sees
+// exactly what it saw while recording.
+
 class InputManager
 {
-private:	
+public:
+	enum class Mode { Live, Recording, Replaying };
+private:
+	static const uint32_t RECORDING_MAGIC;
+	static const uint32_t RECORDING_VERSION;
+
+	Mode mode;
 	Int2 mouseDelta;
+	Int2 lateMouseDelta; // Taken by latchMouseDelta() since the last update.
+	Int2 latchedMouseDelta; // Part of the mouse delta that was already taken late.
+
+	// When the frame's newest input event happened, or zero if there was none, and whether
+	// any of the frame's input was a key or mouse button press.
+	std::chrono::steady_clock::time_point inputTime;
+	bool inputPressed;
+
+	// The frame's events and state when recording or replaying. Replayed state is used
+	// instead of SDL's.
+	std::ofstream recordingFile;
+	std::ifstream replayFile;
+	std::vector<SDL_Event> frameEvents;
+	size_t nextFrameEvent; // Next replayed event to give out.
+	std::array<uint8_t, SDL_NUM_SCANCODES> keyboardState; // Last recorded or replayed.
+	Int2 mousePosition;
+	uint32_t mouseButtons;
+	double frameTime;
+
+	// Returns whether an event can be written as its bytes. Events that point to memory
+	// owned by SDL or the sender aren't recorded.
+	static bool isRecordable(const SDL_Event &e);
+
+	// Moves the frame's input time up to the given event's time if it's a newer input event.
+	void updateInputTime(const SDL_Event &e);
+
+	// Gets the keyboard state from SDL, or the replayed one.
+	const uint8_t *getKeyboardState() const;
+
+	// Writes the current frame to the recording file.
+	void writeFrame();
+
+	// Reads the next frame from the replay file. Returns false at the end of the replay.
+	bool readFrame();
 public:
 	InputManager();
 
+	// Gets whether input is live, being recorded, or being replayed.
+	Mode getMode() const;
+
+	// Starts writing each frame's input to the given file. Must be called before anything
+	// creates an unseeded random generator, since their seeds are recorded from here on.
+	void startRecording(const std::string &filename);
+
+	// Starts reading each frame's input from the given file instead of SDL. Has the same
+	// order requirement as startRecording(). Stays live if the file can't be replayed.
+	void startReplay(const std::string &filename);
+
 	bool keyPressed(const SDL_Event &e, SDL_Keycode keycode) const;
 	bool keyReleased(const SDL_Event &e, SDL_Keycode keycode) const;
 	bool keyIsDown(SDL_Scancode scancode) const;
@@ -34,12 +105,34 @@ public:
 	Int2 getMousePosition() const;
 	Int2 getMouseDelta() const;
 
+	// Gets the part of the mouse delta that latchMouseDelta() already returned last frame,
+	// so it isn't applied twice.
+	Int2 getLatchedMouseDelta() const;
+
+	// Pumps SDL's events and returns the mouse motion since the last update or latch.
+	// It's still part of the next frame's mouse delta. Returns zero unless input is live.
+	Int2 latchMouseDelta();
+
+	// Gets when the newest input event this frame happened, or zero if there wasn't one.
+	// Replayed input has no times.
+	std::chrono::steady_clock::time_point getInputTime() const;
+
+	// Gets whether a key or mouse button was pressed this frame.
+	bool inputWasPressed() const;
+
 	// Sets whether the mouse should move during motion events (for player camera).
 	void setRelativeMouseMode(bool active);
 
+	// Gets the next event for this frame, like SDL_PollEvent(). When replaying, SDL's own
+	// events are dropped except for quitting. The frame is written to the recording once
+	// this returns false, so it must be called until then every frame.
+	bool pollEvent(SDL_Event &e);
+
 	// Updates input values whose associated SDL functions should only be called once 
-	// per frame.
-	void update();
+	// per frame. Returns the delta time the frame should use, which is the recorded one
+	// when replaying. When a replay runs out, input goes back to live and the game is
+	// sent a quit event.
+	double update(double dt);
 };
 
 #endif
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <fstream>
 
@@ -21,25 +22,65 @@ namespace
 		{ "ScreenHeight", { OptionName::ScreenHeight, OptionType::Int } },
 		{ "Fullscreen", { OptionName::Fullscreen, OptionType::Bool } },
 		{ "TargetFPS", { OptionName::TargetFPS, OptionType::Int } },
+		{ "VSync", { OptionName::VSync, OptionType::Bool } },
+		{ "PreciseFramePacing", { OptionName::PreciseFramePacing, OptionType::Bool } },
+		{ "MenuBackgroundMode", { OptionName::MenuBackgroundMode, OptionType::Int } },
+		{ "GameBackgroundMode", { OptionName::GameBackgroundMode, OptionType::Int } },
 		{ "ResolutionScale", { OptionName::ResolutionScale, OptionType::Double } },
+		{ "DynamicResolution", { OptionName::DynamicResolution, OptionType::Bool } },
+		{ "DynamicResolutionMinScale", { OptionName::DynamicResolutionMinScale, OptionType::Double } },
+		{ "DynamicResolutionMaxScale", { OptionName::DynamicResolutionMaxScale, OptionType::Double } },
 		{ "VerticalFieldOfView", { OptionName::VerticalFOV, OptionType::Double } },
 		{ "LetterboxAspect", { OptionName::LetterboxAspect, OptionType::Double } },
 		{ "CursorScale", { OptionName::CursorScale, OptionType::Double } },
 		{ "ModernInterface", { OptionName::ModernInterface, OptionType::Bool } },
+		{ "ForceBaseMipLevel", { OptionName::ForceBaseMipLevel, OptionType::Bool } },
+		{ "PipelinedRendering", { OptionName::PipelinedRendering, OptionType::Bool } },
+		{ "PalettedRendering", { OptionName::PalettedRendering, OptionType::Bool } },
+		{ "ColumnMajorRendering", { OptionName::ColumnMajorRendering, OptionType::Bool } },
+		{ "PerspectiveSpanLength", { OptionName::PerspectiveSpanLength, OptionType::Int } },
+		{ "RowPlaneRendering", { OptionName::RowPlaneRendering, OptionType::Bool } },
+		{ "DeferredShading", { OptionName::DeferredShading, OptionType::Bool } },
+		{ "InterlacedRendering", { OptionName::InterlacedRendering, OptionType::Bool } },
+		{ "FoveatedRendering", { OptionName::FoveatedRendering, OptionType::Int } },
+		{ "ReducedColorDepth", { OptionName::ReducedColorDepth, OptionType::Bool } },
+		{ "AdaptiveRenderThreads", { OptionName::AdaptiveRenderThreads, OptionType::Bool } },
+		{ "HardwareRendering", { OptionName::HardwareRendering, OptionType::Bool } },
+		{ "PinWorkerThreads", { OptionName::PinWorkerThreads, OptionType::Bool } },
+		{ "ThreadPriorities", { OptionName::ThreadPriorities, OptionType::Bool } },
+		{ "SpanInstructionSet", { OptionName::SpanInstructionSet, OptionType::Int } },
+		{ "RendererAutotune", { OptionName::RendererAutotune, OptionType::Int } },
+		{ "AutotuneSignature", { OptionName::AutotuneSignature, OptionType::String } },
 
 		{ "HorizontalSensitivity", { OptionName::HorizontalSensitivity, OptionType::Double } },
 		{ "VerticalSensitivity", { OptionName::VerticalSensitivity, OptionType::Double } },
+		{ "LateMouseLook", { OptionName::LateMouseLook, OptionType::Bool } },
 
 		{ "MusicVolume", { OptionName::MusicVolume, OptionType::Double } },
 		{ "SoundVolume", { OptionName::SoundVolume, OptionType::Double } },
 		{ "MidiConfig", { OptionName::MidiConfig, OptionType::String } },
 		{ "SoundChannels", { OptionName::SoundChannels, OptionType::Int } },
 		{ "SoundResampling", { OptionName::SoundResampling, OptionType::Int } },
+		{ "PresampleSounds", { OptionName::PresampleSounds, OptionType::Bool } },
+		{ "MusicCacheBudget", { OptionName::MusicCacheBudget, OptionType::Int } },
+		{ "SoundCacheBudget", { OptionName::SoundCacheBudget, OptionType::Int } },
 
 		{ "ArenaPath", { OptionName::ArenaPath, OptionType::String } },
 		{ "Collision", { OptionName::Collision, OptionType::Bool } },
 		{ "SkipIntro", { OptionName::SkipIntro, OptionType::Bool } },
 		{ "ShowDebug", { OptionName::ShowDebug, OptionType::Bool } },
+		{ "ShowRenderStats", { OptionName::ShowRenderStats, OptionType::Bool } },
+		{ "FrameStatsInterval", { OptionName::FrameStatsInterval, OptionType::Int } },
+		{ "HitchThreshold", { OptionName::HitchThreshold, OptionType::Int } },
+		{ "LatencyFlash", { OptionName::LatencyFlash, OptionType::Bool } },
+		{ "SaveStartupTimeline", { OptionName::SaveStartupTimeline, OptionType::Bool } },
+		{ "InputRecording", { OptionName::InputRecording, OptionType::Int } },
+		{ "Headless", { OptionName::Headless, OptionType::Int } },
+		{ "TextureMemoryBudget", { OptionName::TextureMemoryBudget, OptionType::Int } },
+		{ "WildernessCacheBudget", { OptionName::WildernessCacheBudget, OptionType::Int } },
+		{ "PanelPoolBudget", { OptionName::PanelPoolBudget, OptionType::Int } },
+		{ "IndexedImages", { OptionName::IndexedImages, OptionType::Bool } },
+		{ "CacheDecodedAssets", { OptionName::CacheDecodedAssets, OptionType::Bool } },
 		{ "ShowCompass", { OptionName::ShowCompass, OptionType::Bool } }
 	};
 }
@@ -58,6 +99,7 @@ const double Options::MIN_VERTICAL_FOV = 40.0;
 const double Options::MAX_VERTICAL_FOV = 150.0;
 const double Options::MIN_CURSOR_SCALE = 0.50;
 const double Options::MAX_CURSOR_SCALE = 8.0;
+const int Options::MAX_PERSPECTIVE_SPAN_LENGTH = 32;
 const double Options::MIN_LETTERBOX_ASPECT = 0.75;
 const double Options::MAX_LETTERBOX_ASPECT = 3.0;
 const double Options::MIN_HORIZONTAL_SENSITIVITY = 0.50;
@@ -67,6 +109,18 @@ const double Options::MAX_VERTICAL_SENSITIVITY = 50.0;
 const double Options::MIN_VOLUME = 0.0;
 const double Options::MAX_VOLUME = 1.0;
 const int Options::RESAMPLING_OPTION_COUNT = 4;
+const int Options::INPUT_RECORDING_OPTION_COUNT = 3;
+const int Options::HEADLESS_OPTION_COUNT = 3;
+const int Options::BACKGROUND_MODE_OPTION_COUNT = 3;
+const int Options::SPAN_INSTRUCTION_SET_OPTION_COUNT = 5;
+const int Options::RENDERER_AUTOTUNE_OPTION_COUNT = 3;
+const int Options::FOVEATED_RENDERING_OPTION_COUNT = 3;
+
+Options::Options()
+{
+	this->nextListenerID = 0;
+	this->revision = 0;
+}
 
 void Options::load(const std::string &filename, Options::BoolMap &boolMap,
 	Options::IntegerMap &integerMap, Options::DoubleMap &doubleMap,
@@ -180,6 +234,14 @@ const std::string &Options::getString(OptionName key) const
 	return get(key, this->defaultStrings, this->changedStrings);
 }
 
+template <typename T>
+bool contains(OptionName key, const std::unordered_map<OptionName, T> &defaultMap,
+	const std::unordered_map<OptionName, T> &changedMap)
+{
+	return (changedMap.find(key) != changedMap.end()) ||
+		(defaultMap.find(key) != defaultMap.end());
+}
+
 template <typename T>
 void set(OptionName key, const T &value,
 	std::unordered_map<OptionName, T> &changedMap)
@@ -201,21 +263,264 @@ void set(OptionName key, const T &value,
 void Options::setBool(OptionName key, bool value)
 {
 	set(key, value, this->changedBools);
+	this->publishChange(key);
 }
 
 void Options::setInt(OptionName key, int value)
 {
 	set(key, value, this->changedInts);
+	this->publishChange(key);
 }
 
 void Options::setDouble(OptionName key, double value)
 {
 	set(key, value, this->changedDoubles);
+	this->publishChange(key);
 }
 
 void Options::setString(OptionName key, const std::string &value)
 {
 	set(key, value, this->changedStrings);
+	this->publishChange(key);
+}
+
+void Options::publish(OptionName key)
+{
+	// The typed getters check each value on its way in.
+	switch (key)
+	{
+	case OptionName::ScreenWidth:
+		this->snapshot.screenWidth = this->getScreenWidth();
+		break;
+	case OptionName::ScreenHeight:
+		this->snapshot.screenHeight = this->getScreenHeight();
+		break;
+	case OptionName::Fullscreen:
+		this->snapshot.fullscreen = this->getFullscreen();
+		break;
+	case OptionName::TargetFPS:
+		this->snapshot.targetFPS = this->getTargetFPS();
+		break;
+	case OptionName::VSync:
+		this->snapshot.vsync = this->getVSync();
+		break;
+	case OptionName::PreciseFramePacing:
+		this->snapshot.preciseFramePacing = this->getPreciseFramePacing();
+		break;
+	case OptionName::MenuBackgroundMode:
+		this->snapshot.menuBackgroundMode = this->getMenuBackgroundMode();
+		break;
+	case OptionName::GameBackgroundMode:
+		this->snapshot.gameBackgroundMode = this->getGameBackgroundMode();
+		break;
+	case OptionName::ResolutionScale:
+		this->snapshot.resolutionScale = this->getResolutionScale();
+		break;
+	case OptionName::DynamicResolution:
+		this->snapshot.dynamicResolution = this->getDynamicResolution();
+		break;
+	case OptionName::DynamicResolutionMinScale:
+		this->snapshot.dynamicResolutionMinScale = this->getDynamicResolutionMinScale();
+		break;
+	case OptionName::DynamicResolutionMaxScale:
+		this->snapshot.dynamicResolutionMaxScale = this->getDynamicResolutionMaxScale();
+		break;
+	case OptionName::VerticalFOV:
+		this->snapshot.verticalFOV = this->getVerticalFOV();
+		break;
+	case OptionName::LetterboxAspect:
+		this->snapshot.letterboxAspect = this->getLetterboxAspect();
+		break;
+	case OptionName::CursorScale:
+		this->snapshot.cursorScale = this->getCursorScale();
+		break;
+	case OptionName::ModernInterface:
+		this->snapshot.modernInterface = this->getModernInterface();
+		break;
+	case OptionName::ForceBaseMipLevel:
+		this->snapshot.forceBaseMipLevel = this->getForceBaseMipLevel();
+		break;
+	case OptionName::PipelinedRendering:
+		this->snapshot.pipelinedRendering = this->getPipelinedRendering();
+		break;
+	case OptionName::PalettedRendering:
+		this->snapshot.palettedRendering = this->getPalettedRendering();
+		break;
+	case OptionName::ColumnMajorRendering:
+		this->snapshot.columnMajorRendering = this->getColumnMajorRendering();
+		break;
+	case OptionName::PerspectiveSpanLength:
+		this->snapshot.perspectiveSpanLength = this->getPerspectiveSpanLength();
+		break;
+	case OptionName::RowPlaneRendering:
+		this->snapshot.rowPlaneRendering = this->getRowPlaneRendering();
+		break;
+	case OptionName::DeferredShading:
+		this->snapshot.deferredShading = this->getDeferredShading();
+		break;
+	case OptionName::InterlacedRendering:
+		this->snapshot.interlacedRendering = this->getInterlacedRendering();
+		break;
+	case OptionName::FoveatedRendering:
+		this->snapshot.foveatedRendering = this->getFoveatedRendering();
+		break;
+	case OptionName::ReducedColorDepth:
+		this->snapshot.reducedColorDepth = this->getReducedColorDepth();
+		break;
+	case OptionName::AdaptiveRenderThreads:
+		this->snapshot.adaptiveRenderThreads = this->getAdaptiveRenderThreads();
+		break;
+	case OptionName::HardwareRendering:
+		this->snapshot.hardwareRendering = this->getHardwareRendering();
+		break;
+	case OptionName::PinWorkerThreads:
+		this->snapshot.pinWorkerThreads = this->getPinWorkerThreads();
+		break;
+	case OptionName::ThreadPriorities:
+		this->snapshot.threadPriorities = this->getThreadPriorities();
+		break;
+	case OptionName::SpanInstructionSet:
+		this->snapshot.spanInstructionSet = this->getSpanInstructionSet();
+		break;
+	case OptionName::RendererAutotune:
+		this->snapshot.rendererAutotune = this->getRendererAutotune();
+		break;
+	case OptionName::AutotuneSignature:
+		this->snapshot.autotuneSignature = this->getAutotuneSignature();
+		break;
+	case OptionName::HorizontalSensitivity:
+		this->snapshot.horizontalSensitivity = this->getHorizontalSensitivity();
+		break;
+	case OptionName::VerticalSensitivity:
+		this->snapshot.verticalSensitivity = this->getVerticalSensitivity();
+		break;
+	case OptionName::LateMouseLook:
+		this->snapshot.lateMouseLook = this->getLateMouseLook();
+		break;
+	case OptionName::MusicVolume:
+		this->snapshot.musicVolume = this->getMusicVolume();
+		break;
+	case OptionName::SoundVolume:
+		this->snapshot.soundVolume = this->getSoundVolume();
+		break;
+	case OptionName::MidiConfig:
+		this->snapshot.midiConfig = this->getMidiConfig();
+		break;
+	case OptionName::SoundChannels:
+		this->snapshot.soundChannels = this->getSoundChannels();
+		break;
+	case OptionName::SoundResampling:
+		this->snapshot.soundResampling = this->getSoundResampling();
+		break;
+	case OptionName::PresampleSounds:
+		this->snapshot.presampleSounds = this->getPresampleSounds();
+		break;
+	case OptionName::MusicCacheBudget:
+		this->snapshot.musicCacheBudget = this->getMusicCacheBudget();
+		break;
+	case OptionName::SoundCacheBudget:
+		this->snapshot.soundCacheBudget = this->getSoundCacheBudget();
+		break;
+	case OptionName::ArenaPath:
+		this->snapshot.arenaPath = this->getArenaPath();
+		break;
+	case OptionName::Collision:
+		this->snapshot.collision = this->getCollision();
+		break;
+	case OptionName::SkipIntro:
+		this->snapshot.skipIntro = this->getSkipIntro();
+		break;
+	case OptionName::ShowDebug:
+		this->snapshot.showDebug = this->getShowDebug();
+		break;
+	case OptionName::ShowRenderStats:
+		this->snapshot.showRenderStats = this->getShowRenderStats();
+		break;
+	case OptionName::FrameStatsInterval:
+		this->snapshot.frameStatsInterval = this->getFrameStatsInterval();
+		break;
+	case OptionName::HitchThreshold:
+		this->snapshot.hitchThreshold = this->getHitchThreshold();
+		break;
+	case OptionName::LatencyFlash:
+		this->snapshot.latencyFlash = this->getLatencyFlash();
+		break;
+	case OptionName::SaveStartupTimeline:
+		this->snapshot.saveStartupTimeline = this->getSaveStartupTimeline();
+		break;
+	case OptionName::InputRecording:
+		this->snapshot.inputRecording = this->getInputRecording();
+		break;
+	case OptionName::Headless:
+		this->snapshot.headless = this->getHeadless();
+		break;
+	case OptionName::TextureMemoryBudget:
+		this->snapshot.textureMemoryBudget = this->getTextureMemoryBudget();
+		break;
+	case OptionName::WildernessCacheBudget:
+		this->snapshot.wildernessCacheBudget = this->getWildernessCacheBudget();
+		break;
+	case OptionName::PanelPoolBudget:
+		this->snapshot.panelPoolBudget = this->getPanelPoolBudget();
+		break;
+	case OptionName::IndexedImages:
+		this->snapshot.indexedImages = this->getIndexedImages();
+		break;
+	case OptionName::CacheDecodedAssets:
+		this->snapshot.cacheDecodedAssets = this->getCacheDecodedAssets();
+		break;
+	case OptionName::ShowCompass:
+		this->snapshot.showCompass = this->getShowCompass();
+		break;
+	default:
+		DebugCrash("Option " + std::to_string(static_cast<int>(key)) + " not in snapshot.");
+		break;
+	}
+}
+
+void Options::publishAll()
+{
+	// Options missing from both files are left for their getters to report.
+	for (const auto &pair : OptionMappings)
+	{
+		const OptionName name = pair.second.first;
+		const OptionType type = pair.second.second;
+		const bool hasValue = [this, name, type]()
+		{
+			if (type == OptionType::Bool)
+			{
+				return contains(name, this->defaultBools, this->changedBools);
+			}
+			else if (type == OptionType::Int)
+			{
+				return contains(name, this->defaultInts, this->changedInts);
+			}
+			else if (type == OptionType::Double)
+			{
+				return contains(name, this->defaultDoubles, this->changedDoubles);
+			}
+			else
+			{
+				return contains(name, this->defaultStrings, this->changedStrings);
+			}
+		}();
+
+		if (hasValue)
+		{
+			this->publish(name);
+		}
+	}
+}
+
+void Options::publishChange(OptionName key)
+{
+	this->publish(key);
+	this->revision++;
+
+	for (const auto &pair : this->listeners)
+	{
+		pair.second(key);
+	}
 }
 
 void Options::checkScreenWidth(int value) const
@@ -234,6 +539,22 @@ void Options::checkTargetFPS(int value) const
 		std::to_string(Options::MIN_FPS) + ".");
 }
 
+void Options::checkMenuBackgroundMode(int value) const
+{
+	DebugAssert(value >= 0, "Menu background mode cannot be negative.");
+	DebugAssert(value < Options::BACKGROUND_MODE_OPTION_COUNT,
+		"Menu background mode cannot be greater than " +
+		std::to_string(Options::BACKGROUND_MODE_OPTION_COUNT - 1) + ".");
+}
+
+void Options::checkGameBackgroundMode(int value) const
+{
+	DebugAssert(value >= 0, "Game background mode cannot be negative.");
+	DebugAssert(value < Options::BACKGROUND_MODE_OPTION_COUNT,
+		"Game background mode cannot be greater than " +
+		std::to_string(Options::BACKGROUND_MODE_OPTION_COUNT - 1) + ".");
+}
+
 void Options::checkResolutionScale(double value) const
 {
 	DebugAssert(value >= Options::MIN_RESOLUTION_SCALE,
@@ -244,6 +565,26 @@ void Options::checkResolutionScale(double value) const
 		String::fixedPrecision(Options::MAX_RESOLUTION_SCALE, 2) + ".");
 }
 
+void Options::checkDynamicResolutionMinScale(double value) const
+{
+	DebugAssert(value >= Options::MIN_RESOLUTION_SCALE,
+		"Dynamic resolution min scale cannot be less than " +
+		String::fixedPrecision(Options::MIN_RESOLUTION_SCALE, 2) + ".");
+	DebugAssert(value <= Options::MAX_RESOLUTION_SCALE,
+		"Dynamic resolution min scale cannot be greater than " +
+		String::fixedPrecision(Options::MAX_RESOLUTION_SCALE, 2) + ".");
+}
+
+void Options::checkDynamicResolutionMaxScale(double value) const
+{
+	DebugAssert(value >= Options::MIN_RESOLUTION_SCALE,
+		"Dynamic resolution max scale cannot be less than " +
+		String::fixedPrecision(Options::MIN_RESOLUTION_SCALE, 2) + ".");
+	DebugAssert(value <= Options::MAX_RESOLUTION_SCALE,
+		"Dynamic resolution max scale cannot be greater than " +
+		String::fixedPrecision(Options::MAX_RESOLUTION_SCALE, 2) + ".");
+}
+
 void Options::checkVerticalFOV(double value) const
 {
 	DebugAssert(value >= Options::MIN_VERTICAL_FOV, "Vertical FOV cannot be less than " +
@@ -272,6 +613,38 @@ void Options::checkCursorScale(double value) const
 		String::fixedPrecision(Options::MAX_CURSOR_SCALE, 1) + ".");
 }
 
+void Options::checkPerspectiveSpanLength(int value) const
+{
+	DebugAssert(value >= 1, "Perspective span length must be positive.");
+	DebugAssert(value <= Options::MAX_PERSPECTIVE_SPAN_LENGTH,
+		"Perspective span length cannot be greater than " +
+		std::to_string(Options::MAX_PERSPECTIVE_SPAN_LENGTH) + ".");
+}
+
+void Options::checkFoveatedRendering(int value) const
+{
+	DebugAssert(value >= 0, "Foveated rendering value cannot be negative.");
+	DebugAssert(value < Options::FOVEATED_RENDERING_OPTION_COUNT,
+		"Foveated rendering value cannot be greater than " +
+		std::to_string(Options::FOVEATED_RENDERING_OPTION_COUNT - 1) + ".");
+}
+
+void Options::checkSpanInstructionSet(int value) const
+{
+	DebugAssert(value >= 0, "Span instruction set value cannot be negative.");
+	DebugAssert(value < Options::SPAN_INSTRUCTION_SET_OPTION_COUNT,
+		"Span instruction set value cannot be greater than " +
+		std::to_string(Options::SPAN_INSTRUCTION_SET_OPTION_COUNT - 1) + ".");
+}
+
+void Options::checkRendererAutotune(int value) const
+{
+	DebugAssert(value >= 0, "Renderer autotune value cannot be negative.");
+	DebugAssert(value < Options::RENDERER_AUTOTUNE_OPTION_COUNT,
+		"Renderer autotune value cannot be greater than " +
+		std::to_string(Options::RENDERER_AUTOTUNE_OPTION_COUNT - 1) + ".");
+}
+
 void Options::checkHorizontalSensitivity(double value) const
 {
 	DebugAssert(value >= Options::MIN_HORIZONTAL_SENSITIVITY,
@@ -319,12 +692,65 @@ void Options::checkSoundResampling(int value) const
 		std::to_string(Options::RESAMPLING_OPTION_COUNT - 1) + ".");
 }
 
+void Options::checkMusicCacheBudget(int value) const
+{
+	DebugAssert(value >= 0, "Music cache budget cannot be negative.");
+}
+
+void Options::checkSoundCacheBudget(int value) const
+{
+	DebugAssert(value >= 0, "Sound cache budget cannot be negative.");
+}
+
+void Options::checkFrameStatsInterval(int value) const
+{
+	DebugAssert(value >= 0, "Frame stats interval cannot be negative.");
+}
+
+void Options::checkHitchThreshold(int value) const
+{
+	DebugAssert(value >= 1, "Hitch threshold must be positive.");
+}
+
+void Options::checkInputRecording(int value) const
+{
+	DebugAssert(value >= 0, "Input recording value cannot be negative.");
+	DebugAssert(value < Options::INPUT_RECORDING_OPTION_COUNT,
+		"Input recording value cannot be greater than " +
+		std::to_string(Options::INPUT_RECORDING_OPTION_COUNT - 1) + ".");
+}
+
+void Options::checkHeadless(int value) const
+{
+	DebugAssert(value >= 0, "Headless value cannot be negative.");
+	DebugAssert(value < Options::HEADLESS_OPTION_COUNT,
+		"Headless value cannot be greater than " +
+		std::to_string(Options::HEADLESS_OPTION_COUNT - 1) + ".");
+}
+
+void Options::checkTextureMemoryBudget(int value) const
+{
+	DebugAssert(value >= 0, "Texture memory budget cannot be negative.");
+}
+
+void Options::checkWildernessCacheBudget(int value) const
+{
+	DebugAssert(value >= 0, "Wilderness cache budget cannot be negative.");
+}
+
+void Options::checkPanelPoolBudget(int value) const
+{
+	DebugAssert(value >= 0, "Panel pool budget cannot be negative.");
+}
+
 void Options::loadDefaults(const std::string &filename)
 {
 	DebugMention("Reading defaults \"" + filename + "\".");
 
 	Options::load(filename, this->defaultBools, this->defaultInts,
 		this->defaultDoubles, this->defaultStrings);
+	this->publishAll();
+	this->revision++;
 }
 
 void Options::loadChanges(const std::string &filename)
@@ -333,6 +759,39 @@ void Options::loadChanges(const std::string &filename)
 
 	Options::load(filename, this->changedBools, this->changedInts,
 		this->changedDoubles, this->changedStrings);
+	this->publishAll();
+	this->revision++;
+}
+
+int Options::getRevision() const
+{
+	return this->revision;
+}
+
+const OptionsSnapshot &Options::getSnapshot() const
+{
+	return this->snapshot;
+}
+
+int Options::addListener(const Options::Listener &listener)
+{
+	const int listenerID = this->nextListenerID;
+	this->nextListenerID++;
+	this->listeners.push_back(std::make_pair(listenerID, listener));
+	return listenerID;
+}
+
+void Options::removeListener(int listenerID)
+{
+	const auto iter = std::find_if(this->listeners.begin(), this->listeners.end(),
+		[listenerID](const std::pair<int, Options::Listener> &pair)
+	{
+		return pair.first == listenerID;
+	});
+
+	DebugAssert(iter != this->listeners.end(),
+		"No options listener " + std::to_string(listenerID) + ".");
+	this->listeners.erase(iter);
 }
 
 void Options::saveChanges()
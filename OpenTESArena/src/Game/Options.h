@@ -1,12 +1,20 @@
 #ifndef OPTIONS_H
 #define OPTIONS_H
 
+#include <functional>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "OptionsSnapshot.h"
 
 // Settings found in the options menu are saved in this object, which should live in
 // the game state object since it persists for the lifetime of the program.
 
+// Every option's value is also copied into a snapshot for code that reads them each frame,
+// and listeners are told about each option set at runtime so they don't have to poll.
+
 enum class PlayerInterface;
 
 // Maps to each option in the options file. Intended to be used behind the scenes
@@ -17,25 +25,65 @@ enum class OptionName
 	ScreenHeight,
 	Fullscreen,
 	TargetFPS,
+	VSync,
+	PreciseFramePacing,
+	MenuBackgroundMode,
+	GameBackgroundMode,
 	ResolutionScale,
+	DynamicResolution,
+	DynamicResolutionMinScale,
+	DynamicResolutionMaxScale,
 	VerticalFOV,
 	LetterboxAspect,
 	CursorScale,
 	ModernInterface,
+	ForceBaseMipLevel,
+	PipelinedRendering,
+	PalettedRendering,
+	ColumnMajorRendering,
+	PerspectiveSpanLength,
+	RowPlaneRendering,
+	DeferredShading,
+	InterlacedRendering,
+	FoveatedRendering,
+	ReducedColorDepth,
+	AdaptiveRenderThreads,
+	HardwareRendering,
+	PinWorkerThreads,
+	ThreadPriorities,
+	SpanInstructionSet,
+	RendererAutotune,
+	AutotuneSignature,
 
 	HorizontalSensitivity,
 	VerticalSensitivity,
+	LateMouseLook,
 
 	MusicVolume,
 	SoundVolume,
 	MidiConfig,
 	SoundChannels,
 	SoundResampling,
+	PresampleSounds,
+	MusicCacheBudget,
+	SoundCacheBudget,
 
 	ArenaPath,
 	Collision,
 	SkipIntro,
 	ShowDebug,
+	ShowRenderStats,
+	FrameStatsInterval,
+	HitchThreshold,
+	LatencyFlash,
+	SaveStartupTimeline,
+	InputRecording,
+	Headless,
+	TextureMemoryBudget,
+	WildernessCacheBudget,
+	PanelPoolBudget,
+	IndexedImages,
+	CacheDecodedAssets,
 	ShowCompass
 };
 
@@ -54,6 +102,9 @@ namespace std
 
 class Options
 {
+public:
+	// Called with the name of each option set at runtime, after the new value is in place.
+	typedef std::function<void(OptionName)> Listener;
 private:
 	typedef std::unordered_map<OptionName, bool> BoolMap;
 	typedef std::unordered_map<OptionName, int> IntegerMap;
@@ -67,6 +118,13 @@ private:
 	Options::DoubleMap defaultDoubles, changedDoubles;
 	Options::StringMap defaultStrings, changedStrings;
 
+	OptionsSnapshot snapshot;
+	std::vector<std::pair<int, Options::Listener>> listeners;
+	int nextListenerID;
+
+	// Incremented whenever an option is loaded or set.
+	int revision;
+
 	// Opens the given file and reads its key-value pairs into the given maps.
 	static void load(const std::string &filename, Options::BoolMap &boolMap,
 		Options::IntegerMap &integerMap, Options::DoubleMap &doubleMap,
@@ -81,6 +139,15 @@ private:
 	void setInt(OptionName key, int value);
 	void setDouble(OptionName key, double value);
 	void setString(OptionName key, const std::string &value);
+
+	// Copies an option's current value into the snapshot.
+	void publish(OptionName key);
+
+	// Publishes every option that has a value, after reading an options file.
+	void publishAll();
+
+	// Publishes an option set at runtime and tells the listeners.
+	void publishChange(OptionName key);
 public:
 	// Filename of the default options file.
 	static const std::string DEFAULT_FILENAME;
@@ -96,6 +163,7 @@ public:
 	static const double MAX_VERTICAL_FOV;
 	static const double MIN_CURSOR_SCALE;
 	static const double MAX_CURSOR_SCALE;
+	static const int MAX_PERSPECTIVE_SPAN_LENGTH;
 	static const double MIN_LETTERBOX_ASPECT;
 	static const double MAX_LETTERBOX_ASPECT;
 	static const double MIN_HORIZONTAL_SENSITIVITY;
@@ -105,6 +173,14 @@ public:
 	static const double MIN_VOLUME;
 	static const double MAX_VOLUME;
 	static const int RESAMPLING_OPTION_COUNT;
+	static const int INPUT_RECORDING_OPTION_COUNT;
+	static const int HEADLESS_OPTION_COUNT;
+	static const int BACKGROUND_MODE_OPTION_COUNT;
+	static const int SPAN_INSTRUCTION_SET_OPTION_COUNT;
+	static const int RENDERER_AUTOTUNE_OPTION_COUNT;
+	static const int FOVEATED_RENDERING_OPTION_COUNT;
+
+	Options();
 
 #define OPTION_BOOL(name) \
 bool get##name() const \
@@ -159,27 +235,79 @@ void set##name(const std::string &value) \
 	OPTION_INT(ScreenHeight)
 	OPTION_BOOL(Fullscreen)
 	OPTION_INT(TargetFPS)
+	OPTION_BOOL(VSync)
+	OPTION_BOOL(PreciseFramePacing)
+	OPTION_INT(MenuBackgroundMode)
+	OPTION_INT(GameBackgroundMode)
 	OPTION_DOUBLE(ResolutionScale)
+	OPTION_BOOL(DynamicResolution)
+	OPTION_DOUBLE(DynamicResolutionMinScale)
+	OPTION_DOUBLE(DynamicResolutionMaxScale)
 	OPTION_DOUBLE(VerticalFOV)
 	OPTION_DOUBLE(LetterboxAspect)
 	OPTION_DOUBLE(CursorScale)
 	OPTION_BOOL(ModernInterface)
+	OPTION_BOOL(ForceBaseMipLevel)
+	OPTION_BOOL(PipelinedRendering)
+	OPTION_BOOL(PalettedRendering)
+	OPTION_BOOL(ColumnMajorRendering)
+	OPTION_INT(PerspectiveSpanLength)
+	OPTION_BOOL(RowPlaneRendering)
+	OPTION_BOOL(DeferredShading)
+	OPTION_BOOL(InterlacedRendering)
+	OPTION_INT(FoveatedRendering)
+	OPTION_BOOL(ReducedColorDepth)
+	OPTION_BOOL(AdaptiveRenderThreads)
+	OPTION_BOOL(HardwareRendering)
+	OPTION_BOOL(PinWorkerThreads)
+	OPTION_BOOL(ThreadPriorities)
+	OPTION_INT(SpanInstructionSet)
+	OPTION_INT(RendererAutotune)
+	OPTION_STRING(AutotuneSignature)
 
 	OPTION_DOUBLE(HorizontalSensitivity)
 	OPTION_DOUBLE(VerticalSensitivity)
+	OPTION_BOOL(LateMouseLook)
 
 	OPTION_DOUBLE(MusicVolume)
 	OPTION_DOUBLE(SoundVolume)
 	OPTION_STRING(MidiConfig)
 	OPTION_INT(SoundChannels)
 	OPTION_INT(SoundResampling)
+	OPTION_BOOL(PresampleSounds)
+	OPTION_INT(MusicCacheBudget)
+	OPTION_INT(SoundCacheBudget)
 
 	OPTION_STRING(ArenaPath)
 	OPTION_BOOL(Collision)
 	OPTION_BOOL(SkipIntro)
 	OPTION_BOOL(ShowDebug)
+	OPTION_BOOL(ShowRenderStats)
+	OPTION_INT(FrameStatsInterval)
+	OPTION_INT(HitchThreshold)
+	OPTION_BOOL(LatencyFlash)
+	OPTION_BOOL(SaveStartupTimeline)
+	OPTION_INT(InputRecording)
+	OPTION_INT(Headless)
+	OPTION_INT(TextureMemoryBudget)
+	OPTION_INT(WildernessCacheBudget)
+	OPTION_INT(PanelPoolBudget)
+	OPTION_BOOL(IndexedImages)
+	OPTION_BOOL(CacheDecodedAssets)
 	OPTION_BOOL(ShowCompass)
 
+	// Gets a number that changes whenever any option does, so things that depend on 
+	// several options can tell whether they need refreshing.
+	int getRevision() const;
+
+	// Gets every option's current value. The reference stays valid, and its values change
+	// only when options are loaded or set.
+	const OptionsSnapshot &getSnapshot() const;
+
+	// Adds a function to call whenever an option is set, returning an ID for removing it.
+	int addListener(const Options::Listener &listener);
+	void removeListener(int listenerID);
+
 	// Reads all the key-values pairs from the given absolute path into the default members.
 	void loadDefaults(const std::string &filename);
 
@@ -0,0 +1,67 @@
+#include "OptionsSnapshot.h"
+
+OptionsSnapshot::OptionsSnapshot()
+{
+	// Placeholders until the options files are read.
+	this->screenWidth = 0;
+	this->screenHeight = 0;
+	this->fullscreen = false;
+	this->targetFPS = 0;
+	this->vsync = false;
+	this->preciseFramePacing = false;
+	this->menuBackgroundMode = 0;
+	this->gameBackgroundMode = 0;
+	this->resolutionScale = 0.0;
+	this->dynamicResolution = false;
+	this->dynamicResolutionMinScale = 0.0;
+	this->dynamicResolutionMaxScale = 0.0;
+	this->verticalFOV = 0.0;
+	this->letterboxAspect = 0.0;
+	this->cursorScale = 0.0;
+	this->modernInterface = false;
+	this->forceBaseMipLevel = false;
+	this->pipelinedRendering = false;
+	this->palettedRendering = false;
+	this->columnMajorRendering = false;
+	this->perspectiveSpanLength = 0;
+	this->rowPlaneRendering = false;
+	this->deferredShading = false;
+	this->interlacedRendering = false;
+	this->foveatedRendering = 0;
+	this->reducedColorDepth = false;
+	this->adaptiveRenderThreads = false;
+	this->hardwareRendering = false;
+	this->pinWorkerThreads = false;
+	this->threadPriorities = true;
+	this->spanInstructionSet = 0;
+	this->rendererAutotune = 0;
+
+	this->horizontalSensitivity = 0.0;
+	this->verticalSensitivity = 0.0;
+	this->lateMouseLook = false;
+
+	this->musicVolume = 0.0;
+	this->soundVolume = 0.0;
+	this->soundChannels = 0;
+	this->soundResampling = 0;
+	this->presampleSounds = false;
+	this->musicCacheBudget = 0;
+	this->soundCacheBudget = 0;
+
+	this->collision = false;
+	this->skipIntro = false;
+	this->showDebug = false;
+	this->showRenderStats = false;
+	this->frameStatsInterval = 0;
+	this->hitchThreshold = 0;
+	this->latencyFlash = false;
+	this->saveStartupTimeline = false;
+	this->inputRecording = 0;
+	this->headless = 0;
+	this->textureMemoryBudget = 0;
+	this->wildernessCacheBudget = 0;
+	this->panelPoolBudget = 0;
+	this->indexedImages = false;
+	this->cacheDecodedAssets = false;
+	this->showCompass = false;
+}
@@ -0,0 +1,77 @@
+#ifndef OPTIONS_SNAPSHOT_H
+#define OPTIONS_SNAPSHOT_H
+
+#include <string>
+
+// Plain copy of every option's current value, kept up to date by the options object
+// whenever one is loaded or set. Code that reads options every frame should use this
+// rather than the named getters, which look values up in hash maps and check them.
+
+// Values are checked when they enter the snapshot, so they're always in range.
+
+struct OptionsSnapshot
+{
+	int screenWidth, screenHeight;
+	bool fullscreen;
+	int targetFPS;
+	bool vsync;
+	bool preciseFramePacing;
+	int menuBackgroundMode, gameBackgroundMode;
+	double resolutionScale;
+	bool dynamicResolution;
+	double dynamicResolutionMinScale, dynamicResolutionMaxScale;
+	double verticalFOV;
+	double letterboxAspect;
+	double cursorScale;
+	bool modernInterface;
+	bool forceBaseMipLevel;
+	bool pipelinedRendering;
+	bool palettedRendering;
+	bool columnMajorRendering;
+	int perspectiveSpanLength;
+	bool rowPlaneRendering;
+	bool deferredShading;
+	bool interlacedRendering;
+	int foveatedRendering;
+	bool reducedColorDepth;
+	bool adaptiveRenderThreads;
+	bool hardwareRendering;
+	bool pinWorkerThreads;
+	bool threadPriorities;
+	int spanInstructionSet;
+	int rendererAutotune;
+	std::string autotuneSignature;
+
+	double horizontalSensitivity, verticalSensitivity;
+	bool lateMouseLook;
+
+	double musicVolume, soundVolume;
+	std::string midiConfig;
+	int soundChannels;
+	int soundResampling;
+	bool presampleSounds;
+	int musicCacheBudget;
+	int soundCacheBudget;
+
+	std::string arenaPath;
+	bool collision;
+	bool skipIntro;
+	bool showDebug;
+	bool showRenderStats;
+	int frameStatsInterval;
+	int hitchThreshold;
+	bool latencyFlash;
+	bool saveStartupTimeline;
+	int inputRecording;
+	int headless;
+	int textureMemoryBudget;
+	int wildernessCacheBudget;
+	int panelPoolBudget;
+	bool indexedImages;
+	bool cacheDecodedAssets;
+	bool showCompass;
+
+	OptionsSnapshot();
+};
+
+#endif
@@ -0,0 +1,807 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "Game.h"
+#include "GameData.h"
+#include "SaveGame.h"
+#include "../Assets/Compression.h"
+#include "../Assets/MIFFile.h"
+#include "../Utilities/Debug.h"
+#include "../World/LevelData.h"
+#include "../World/Location.h"
+#include "../World/LocationDataType.h"
+#include "../World/VoxelGrid.h"
+#include "../World/WeatherType.h"
+#include "../World/WorldData.h"
+
+namespace
+{
+	const char Magic[4] = { 'T', 'E', 'S', 'S' };
+
+	// Header flag for an RLE-compressed payload. Payloads that don't get smaller are
+	// stored as-is.
+	const uint32_t FlagRLE = 1;
+
+	// The file starts with this, never compressed.
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t flags;
+		uint32_t payloadSize; // Bytes after decompressing.
+		uint32_t storedSize; // Bytes in the file after the header.
+		uint32_t checksum; // Of the decompressed payload.
+	};
+
+	// The first record of the payload. Offsets are from the start of the payload.
+	struct SnapshotRecord
+	{
+		double playerPosition[3];
+		double playerDirection[3];
+		double fractionOfSecond;
+		int32_t year, month, day;
+		int32_t hours, minutes, seconds;
+		uint32_t randomSeed;
+		int32_t worldKind; // GameData::WorldSource::Kind.
+		int32_t locationDataType, locationLocalID, provinceID;
+		int32_t isArtifactDungeon, wildBlockX, wildBlockY;
+		int32_t rmdIDs[4];
+		int32_t wildOriginX, wildOriginZ; // Block at the top right of the wilderness window.
+		int32_t weatherType;
+		int32_t currentLevel;
+		char mifName[32]; // Null-terminated.
+		uint8_t weathers[36];
+		uint32_t levelCount;
+		uint32_t levelsOffset; // Array of LevelRecord.
+	};
+
+	struct LevelRecord
+	{
+		int32_t width, height, depth;
+		int32_t voxelDataCount; // Saved voxel IDs are below this.
+		uint32_t voxelChangeCount;
+		uint32_t voxelChangesOffset; // Array of VoxelChangeRecord.
+		uint32_t textTriggerCount;
+		uint32_t textTriggersOffset; // Array of TextTriggerRecord.
+	};
+
+	// One entry of a level's journal (see LevelData::Journal).
+	struct VoxelChangeRecord
+	{
+		int32_t x, y, z;
+		uint32_t id;
+	};
+
+	// A text trigger that has been displayed.
+	struct TextTriggerRecord
+	{
+		int32_t x, z;
+	};
+
+	static_assert(sizeof(FileHeader) == 24, "Unexpected FileHeader padding.");
+	static_assert(sizeof(SnapshotRecord) == 224, "Unexpected SnapshotRecord padding.");
+	static_assert(sizeof(LevelRecord) == 32, "Unexpected LevelRecord padding.");
+	static_assert(sizeof(VoxelChangeRecord) == 16, "Unexpected VoxelChangeRecord padding.");
+	static_assert(sizeof(TextTriggerRecord) == 8, "Unexpected TextTriggerRecord padding.");
+
+	bool IsLittleEndian()
+	{
+		const uint16_t value = 1;
+		uint8_t firstByte;
+		std::memcpy(&firstByte, &value, 1);
+		return firstByte == 1;
+	}
+
+	template <typename T>
+	void SwapBytes(T &value)
+	{
+		uint8_t *bytes = reinterpret_cast<uint8_t*>(&value);
+		std::reverse(bytes, bytes + sizeof(T));
+	}
+
+	template <typename T, size_t N>
+	void SwapBytes(T (&values)[N])
+	{
+		for (T &value : values)
+		{
+			SwapBytes(value);
+		}
+	}
+
+	void SwapRecord(FileHeader &header)
+	{
+		SwapBytes(header.version);
+		SwapBytes(header.flags);
+		SwapBytes(header.payloadSize);
+		SwapBytes(header.storedSize);
+		SwapBytes(header.checksum);
+	}
+
+	void SwapRecord(SnapshotRecord &snapshot)
+	{
+		SwapBytes(snapshot.playerPosition);
+		SwapBytes(snapshot.playerDirection);
+		SwapBytes(snapshot.fractionOfSecond);
+		SwapBytes(snapshot.year);
+		SwapBytes(snapshot.month);
+		SwapBytes(snapshot.day);
+		SwapBytes(snapshot.hours);
+		SwapBytes(snapshot.minutes);
+		SwapBytes(snapshot.seconds);
+		SwapBytes(snapshot.randomSeed);
+		SwapBytes(snapshot.worldKind);
+		SwapBytes(snapshot.locationDataType);
+		SwapBytes(snapshot.locationLocalID);
+		SwapBytes(snapshot.provinceID);
+		SwapBytes(snapshot.isArtifactDungeon);
+		SwapBytes(snapshot.wildBlockX);
+		SwapBytes(snapshot.wildBlockY);
+		SwapBytes(snapshot.rmdIDs);
+		SwapBytes(snapshot.wildOriginX);
+		SwapBytes(snapshot.wildOriginZ);
+		SwapBytes(snapshot.weatherType);
+		SwapBytes(snapshot.currentLevel);
+		SwapBytes(snapshot.levelCount);
+		SwapBytes(snapshot.levelsOffset);
+	}
+
+	void SwapRecord(LevelRecord &level)
+	{
+		SwapBytes(level.width);
+		SwapBytes(level.height);
+		SwapBytes(level.depth);
+		SwapBytes(level.voxelDataCount);
+		SwapBytes(level.voxelChangeCount);
+		SwapBytes(level.voxelChangesOffset);
+		SwapBytes(level.textTriggerCount);
+		SwapBytes(level.textTriggersOffset);
+	}
+
+	void SwapRecord(VoxelChangeRecord &change)
+	{
+		SwapBytes(change.x);
+		SwapBytes(change.y);
+		SwapBytes(change.z);
+		SwapBytes(change.id);
+	}
+
+	void SwapRecord(TextTriggerRecord &textTrigger)
+	{
+		SwapBytes(textTrigger.x);
+		SwapBytes(textTrigger.z);
+	}
+
+	template <typename T>
+	void SwapRecords(T *records, uint32_t count)
+	{
+		std::for_each(records, records + count, [](T &record) { SwapRecord(record); });
+	}
+
+	// FNV-1a, which is plenty for catching a damaged file.
+	uint32_t GetChecksum(const uint8_t *data, size_t size)
+	{
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ data[i]) * 16777619u;
+		}
+
+		return hash;
+	}
+
+	// Gets a record in the payload, or null if it doesn't fit or isn't aligned.
+	template <typename T>
+	T *GetRecords(std::vector<uint8_t> &payload, uint32_t offset, uint32_t count)
+	{
+		const uint64_t end = static_cast<uint64_t>(offset) +
+			(static_cast<uint64_t>(count) * sizeof(T));
+		if ((end > payload.size()) || ((offset % alignof(T)) != 0))
+		{
+			return nullptr;
+		}
+
+		return reinterpret_cast<T*>(payload.data() + offset);
+	}
+
+	// Swaps the payload's records from the file's byte order to this machine's, one at a
+	// time so each record's offsets are native before they're followed. Every offset is
+	// checked whether or not anything is swapped. Returns an empty string if the payload
+	// is usable.
+	std::string FixUpPayload(std::vector<uint8_t> &payload)
+	{
+		const bool swap = !IsLittleEndian();
+		SnapshotRecord *snapshot = GetRecords<SnapshotRecord>(payload, 0, 1);
+		if (snapshot == nullptr)
+		{
+			return "Save is too small for its snapshot.";
+		}
+
+		if (swap)
+		{
+			SwapRecord(*snapshot);
+		}
+
+		LevelRecord *levels = GetRecords<LevelRecord>(
+			payload, snapshot->levelsOffset, snapshot->levelCount);
+		if (levels == nullptr)
+		{
+			return "Save has invalid level records.";
+		}
+
+		for (uint32_t i = 0; i < snapshot->levelCount; i++)
+		{
+			LevelRecord &level = levels[i];
+			if (swap)
+			{
+				SwapRecord(level);
+			}
+
+			VoxelChangeRecord *voxelChanges = GetRecords<VoxelChangeRecord>(
+				payload, level.voxelChangesOffset, level.voxelChangeCount);
+			TextTriggerRecord *textTriggers = GetRecords<TextTriggerRecord>(
+				payload, level.textTriggersOffset, level.textTriggerCount);
+			if ((voxelChanges == nullptr) || (textTriggers == nullptr))
+			{
+				return "Save has invalid journal records in level " + std::to_string(i) + ".";
+			}
+
+			if (swap)
+			{
+				SwapRecords(voxelChanges, level.voxelChangeCount);
+				SwapRecords(textTriggers, level.textTriggerCount);
+			}
+		}
+
+		return std::string();
+	}
+
+	// The reverse of FixUpPayload() for a payload this machine made, so offsets are read
+	// before each record is swapped.
+	void SwapPayloadToFileOrder(std::vector<uint8_t> &payload)
+	{
+		SnapshotRecord &snapshot = *reinterpret_cast<SnapshotRecord*>(payload.data());
+		LevelRecord *levels = reinterpret_cast<LevelRecord*>(
+			payload.data() + snapshot.levelsOffset);
+		for (uint32_t i = 0; i < snapshot.levelCount; i++)
+		{
+			LevelRecord &level = levels[i];
+			SwapRecords(reinterpret_cast<VoxelChangeRecord*>(
+				payload.data() + level.voxelChangesOffset), level.voxelChangeCount);
+			SwapRecords(reinterpret_cast<TextTriggerRecord*>(
+				payload.data() + level.textTriggersOffset), level.textTriggerCount);
+			SwapRecord(level);
+		}
+
+		SwapRecord(snapshot);
+	}
+
+	// Copies the game state into a payload. This is the only part of saving on the main
+	// thread, and it only copies values and the level journals.
+	std::vector<uint8_t> MakePayload(GameData &gameData)
+	{
+		const WorldData &worldData = gameData.getWorldData();
+		const size_t levelCount = static_cast<size_t>(worldData.getLevelCount());
+
+		size_t voxelChangeCount = 0;
+		size_t textTriggerCount = 0;
+		for (size_t i = 0; i < levelCount; i++)
+		{
+			const LevelData *level = worldData.findLevel(static_cast<int>(i));
+			if (level != nullptr)
+			{
+				const LevelData::Journal &journal = level->getJournal();
+				voxelChangeCount += journal.voxels.size();
+				textTriggerCount += journal.displayedTextTriggers.size();
+			}
+		}
+
+		// Records with bigger alignment first so all offsets stay aligned.
+		const size_t levelsOffset = sizeof(SnapshotRecord);
+		const size_t voxelChangesOffset = levelsOffset + (levelCount * sizeof(LevelRecord));
+		const size_t textTriggersOffset = voxelChangesOffset +
+			(voxelChangeCount * sizeof(VoxelChangeRecord));
+		std::vector<uint8_t> payload(
+			textTriggersOffset + (textTriggerCount * sizeof(TextTriggerRecord)), 0);
+
+		SnapshotRecord &snapshot = *reinterpret_cast<SnapshotRecord*>(payload.data());
+		Player &player = gameData.getPlayer();
+		const Double3 &position = player.getPosition();
+		const Double3 &direction = player.getDirection();
+		snapshot.playerPosition[0] = position.x;
+		snapshot.playerPosition[1] = position.y;
+		snapshot.playerPosition[2] = position.z;
+		snapshot.playerDirection[0] = direction.x;
+		snapshot.playerDirection[1] = direction.y;
+		snapshot.playerDirection[2] = direction.z;
+
+		const Date &date = gameData.getDate();
+		const Clock &clock = gameData.getClock();
+		snapshot.fractionOfSecond = clock.getFractionOfSecond();
+		snapshot.year = date.getYear();
+		snapshot.month = date.getMonth();
+		snapshot.day = date.getDay();
+		snapshot.hours = clock.getHours24();
+		snapshot.minutes = clock.getMinutes();
+		snapshot.seconds = clock.getSeconds();
+		snapshot.randomSeed = gameData.getRandom().getSeed();
+
+		const GameData::WorldSource &worldSource = gameData.getWorldSource();
+		const Location &location = gameData.getLocation();
+		snapshot.worldKind = static_cast<int32_t>(worldSource.kind);
+		snapshot.locationDataType = static_cast<int32_t>(location.dataType);
+		snapshot.locationLocalID = (location.dataType == LocationDataType::SpecialCase) ?
+			static_cast<int32_t>(location.specialCaseType) : location.localCityID;
+		snapshot.provinceID = location.provinceID;
+		snapshot.isArtifactDungeon = worldSource.isArtifactDungeon ? 1 : 0;
+		snapshot.wildBlockX = worldSource.wildBlockX;
+		snapshot.wildBlockY = worldSource.wildBlockY;
+		std::copy(worldSource.rmdIDs.begin(), worldSource.rmdIDs.end(), snapshot.rmdIDs);
+
+		// The player's position is in the wilderness window's coordinates, so the window's
+		// place is needed too.
+		const Int2 *wildOrigin = worldData.getActiveLevel().getWildernessOrigin();
+		snapshot.wildOriginX = (wildOrigin != nullptr) ? wildOrigin->x : 0;
+		snapshot.wildOriginZ = (wildOrigin != nullptr) ? wildOrigin->y : 0;
+		snapshot.weatherType = static_cast<int32_t>(gameData.getWeatherType());
+		snapshot.currentLevel = worldData.getCurrentLevel();
+
+		DebugAssert(worldSource.mifName.size() < sizeof(snapshot.mifName),
+			"MIF name \"" + worldSource.mifName + "\" too long for a save.");
+		std::copy(worldSource.mifName.begin(), worldSource.mifName.end(), snapshot.mifName);
+
+		const auto &weathers = gameData.getWeathersArray();
+		std::transform(weathers.begin(), weathers.end(), snapshot.weathers,
+			[](WeatherType weatherType) { return static_cast<uint8_t>(weatherType); });
+
+		snapshot.levelCount = static_cast<uint32_t>(levelCount);
+		snapshot.levelsOffset = static_cast<uint32_t>(levelsOffset);
+
+		LevelRecord *levelRecords = reinterpret_cast<LevelRecord*>(
+			payload.data() + levelsOffset);
+		VoxelChangeRecord *voxelChangeRecords = reinterpret_cast<VoxelChangeRecord*>(
+			payload.data() + voxelChangesOffset);
+		TextTriggerRecord *textTriggerRecords = reinterpret_cast<TextTriggerRecord*>(
+			payload.data() + textTriggersOffset);
+		for (size_t i = 0; i < levelCount; i++)
+		{
+			// Levels that haven't been generated have no changes, and an empty record says so.
+			LevelRecord &levelRecord = levelRecords[i];
+			const LevelData *level = worldData.findLevel(static_cast<int>(i));
+			if (level == nullptr)
+			{
+				levelRecord.voxelChangesOffset = static_cast<uint32_t>(
+					reinterpret_cast<uint8_t*>(voxelChangeRecords) - payload.data());
+				levelRecord.textTriggersOffset = static_cast<uint32_t>(
+					reinterpret_cast<uint8_t*>(textTriggerRecords) - payload.data());
+				continue;
+			}
+
+			const VoxelGrid &voxelGrid = level->getVoxelGrid();
+			const LevelData::Journal &journal = level->getJournal();
+			levelRecord.width = voxelGrid.getWidth();
+			levelRecord.height = voxelGrid.getHeight();
+			levelRecord.depth = voxelGrid.getDepth();
+			levelRecord.voxelDataCount = voxelGrid.getVoxelDataCount();
+			levelRecord.voxelChangeCount = static_cast<uint32_t>(journal.voxels.size());
+			levelRecord.voxelChangesOffset = static_cast<uint32_t>(
+				reinterpret_cast<uint8_t*>(voxelChangeRecords) - payload.data());
+			levelRecord.textTriggerCount =
+				static_cast<uint32_t>(journal.displayedTextTriggers.size());
+			levelRecord.textTriggersOffset = static_cast<uint32_t>(
+				reinterpret_cast<uint8_t*>(textTriggerRecords) - payload.data());
+
+			for (const LevelData::Journal::VoxelChange &change : journal.voxels)
+			{
+				voxelChangeRecords->x = change.x;
+				voxelChangeRecords->y = change.y;
+				voxelChangeRecords->z = change.z;
+				voxelChangeRecords->id = change.id;
+				voxelChangeRecords++;
+			}
+
+			for (const Int2 &voxel : journal.displayedTextTriggers)
+			{
+				textTriggerRecords->x = voxel.x;
+				textTriggerRecords->z = voxel.y;
+				textTriggerRecords++;
+			}
+		}
+
+		return payload;
+	}
+
+	// Reads and decompresses a save file into a payload ready for use. Returns an empty
+	// string on success.
+	std::string ReadPayload(const std::string &filename, std::vector<uint8_t> &payload)
+	{
+		std::ifstream ifs(filename, std::ios::binary | std::ios::ate);
+		if (!ifs.is_open())
+		{
+			return "Couldn't open save \"" + filename + "\".";
+		}
+
+		const std::streamoff fileSize = ifs.tellg();
+		if (fileSize < static_cast<std::streamoff>(sizeof(FileHeader)))
+		{
+			return "Save \"" + filename + "\" is too small.";
+		}
+
+		// The whole file in one read.
+		std::vector<uint8_t> bytes(static_cast<size_t>(fileSize));
+		ifs.seekg(0);
+		ifs.read(reinterpret_cast<char*>(bytes.data()), fileSize);
+		if (!ifs)
+		{
+			return "Couldn't read save \"" + filename + "\".";
+		}
+
+		FileHeader header;
+		std::memcpy(&header, bytes.data(), sizeof(header));
+		if (!IsLittleEndian())
+		{
+			SwapRecord(header);
+		}
+
+		if (!std::equal(Magic, Magic + sizeof(Magic), header.magic))
+		{
+			return "\"" + filename + "\" isn't a save.";
+		}
+		else if (header.version != SaveGame::VERSION)
+		{
+			return "Save \"" + filename + "\" is version " + std::to_string(header.version) +
+				" instead of " + std::to_string(SaveGame::VERSION) + ".";
+		}
+		else if (header.storedSize != (bytes.size() - sizeof(FileHeader)))
+		{
+			return "Save \"" + filename + "\" is the wrong size.";
+		}
+
+		const uint8_t *stored = bytes.data() + sizeof(FileHeader);
+		if ((header.flags & FlagRLE) != 0)
+		{
+			payload.resize(header.payloadSize);
+			if (!Compression::decodeRLE(stored, stored + header.storedSize,
+				static_cast<int>(header.payloadSize), payload))
+			{
+				return "Save \"" + filename + "\" couldn't be decompressed.";
+			}
+		}
+		else
+		{
+			payload.assign(stored, stored + header.storedSize);
+		}
+
+		if ((payload.size() != header.payloadSize) ||
+			(GetChecksum(payload.data(), payload.size()) != header.checksum))
+		{
+			return "Save \"" + filename + "\" is damaged.";
+		}
+
+		const std::string error = FixUpPayload(payload);
+		return error.empty() ? error : ("\"" + filename + "\": " + error);
+	}
+
+	// Builds the saved world like travelling there would. Returns false if it can't.
+	bool LoadWorld(const GameData::WorldSource &worldSource, const Location &location,
+		WeatherType weatherType, Game &game)
+	{
+		GameData &gameData = game.getGameData();
+		auto &textureManager = game.getTextureManager();
+		auto &renderer = game.getRenderer();
+		const auto &miscAssets = game.getMiscAssets();
+
+		switch (worldSource.kind)
+		{
+		case GameData::WorldSource::Kind::Interior:
+			gameData.loadInterior(MIFFile(worldSource.mifName), location, textureManager,
+				renderer);
+			return true;
+		case GameData::WorldSource::Kind::NamedDungeon:
+			gameData.loadNamedDungeon(location.localDungeonID, location.provinceID,
+				worldSource.isArtifactDungeon, textureManager, renderer);
+			return true;
+		case GameData::WorldSource::Kind::WildernessDungeon:
+			gameData.loadWildernessDungeon(location.provinceID, worldSource.wildBlockX,
+				worldSource.wildBlockY, gameData.getCityDataFile(), textureManager, renderer);
+			return true;
+		case GameData::WorldSource::Kind::PremadeCity:
+			gameData.loadPremadeCity(MIFFile(worldSource.mifName), weatherType, miscAssets,
+				textureManager, renderer);
+			return true;
+		case GameData::WorldSource::Kind::City:
+			gameData.loadCity(location.localCityID, location.provinceID, weatherType,
+				miscAssets, textureManager, renderer, game.getJobSystem());
+			return true;
+		case GameData::WorldSource::Kind::Wilderness:
+			gameData.loadWilderness(location.localCityID, location.provinceID,
+				worldSource.rmdIDs[0], worldSource.rmdIDs[1], worldSource.rmdIDs[2],
+				worldSource.rmdIDs[3], weatherType, miscAssets, textureManager, renderer);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool IsExterior(GameData::WorldSource::Kind kind)
+	{
+		return (kind == GameData::WorldSource::Kind::PremadeCity) ||
+			(kind == GameData::WorldSource::Kind::City) ||
+			(kind == GameData::WorldSource::Kind::Wilderness);
+	}
+
+	// Puts the fixed-up payload's state into the game. Returns an empty string on success.
+	std::string ApplyPayload(std::vector<uint8_t> &payload, Game &game)
+	{
+		const SnapshotRecord &snapshot = *reinterpret_cast<const SnapshotRecord*>(payload.data());
+		const int maxWeather = static_cast<int>(WeatherType::SnowOvercast2);
+		const bool weathersValid = std::all_of(snapshot.weathers,
+			snapshot.weathers + sizeof(snapshot.weathers),
+			[maxWeather](uint8_t weather) { return weather <= maxWeather; });
+		if ((snapshot.worldKind <= static_cast<int32_t>(GameData::WorldSource::Kind::None)) ||
+			(snapshot.worldKind > static_cast<int32_t>(GameData::WorldSource::Kind::Wilderness)) ||
+			(snapshot.locationDataType < 0) ||
+			(snapshot.locationDataType > static_cast<int32_t>(LocationDataType::SpecialCase)) ||
+			(snapshot.weatherType < 0) || (snapshot.weatherType > maxWeather) ||
+			!weathersValid || (snapshot.mifName[sizeof(snapshot.mifName) - 1] != '\0'))
+		{
+			return "Save has an unknown world.";
+		}
+		else if ((snapshot.year < 1) || (snapshot.month < 0) ||
+			(snapshot.month >= Date::MONTHS_PER_YEAR) || (snapshot.day < 0) ||
+			(snapshot.day >= Date::DAYS_PER_MONTH) || (snapshot.hours < 0) ||
+			(snapshot.hours >= 24) || (snapshot.minutes < 0) || (snapshot.minutes >= 60) ||
+			(snapshot.seconds < 0) || (snapshot.seconds >= 60))
+		{
+			return "Save has an invalid date or time.";
+		}
+
+		GameData::WorldSource worldSource;
+		worldSource.kind = static_cast<GameData::WorldSource::Kind>(snapshot.worldKind);
+		worldSource.mifName = snapshot.mifName;
+		worldSource.isArtifactDungeon = snapshot.isArtifactDungeon != 0;
+		worldSource.wildBlockX = snapshot.wildBlockX;
+		worldSource.wildBlockY = snapshot.wildBlockY;
+		std::copy(snapshot.rmdIDs, snapshot.rmdIDs + 4, worldSource.rmdIDs.begin());
+
+		const LocationDataType locationDataType =
+			static_cast<LocationDataType>(snapshot.locationDataType);
+		const Location location = [&snapshot, locationDataType]()
+		{
+			if (locationDataType == LocationDataType::City)
+			{
+				return Location::makeCity(snapshot.locationLocalID, snapshot.provinceID);
+			}
+			else if (locationDataType == LocationDataType::Dungeon)
+			{
+				return Location::makeDungeon(snapshot.locationLocalID, snapshot.provinceID);
+			}
+			else
+			{
+				return Location::makeSpecialCase(
+					static_cast<Location::SpecialCaseType>(snapshot.locationLocalID),
+					snapshot.provinceID);
+			}
+		}();
+
+		const WeatherType weatherType = static_cast<WeatherType>(snapshot.weatherType);
+
+		// The world only needs building again if it's a different one. Otherwise its
+		// journals are undone and the saved ones replayed.
+		GameData &gameData = game.getGameData();
+		const GameData::WorldSource &currentSource = gameData.getWorldSource();
+		const Location &currentLocation = gameData.getLocation();
+		const bool sameWorld = (currentSource.kind == worldSource.kind) &&
+			(currentSource.mifName == worldSource.mifName) &&
+			(currentSource.isArtifactDungeon == worldSource.isArtifactDungeon) &&
+			(currentSource.wildBlockX == worldSource.wildBlockX) &&
+			(currentSource.wildBlockY == worldSource.wildBlockY) &&
+			(currentSource.rmdIDs == worldSource.rmdIDs) &&
+			(currentLocation.dataType == location.dataType) &&
+			(currentLocation.provinceID == location.provinceID) &&
+			((location.dataType == LocationDataType::SpecialCase) ?
+				(currentLocation.specialCaseType == location.specialCaseType) :
+				(currentLocation.localCityID == location.localCityID)) &&
+			(!IsExterior(worldSource.kind) || (gameData.getWeatherType() == weatherType));
+
+		if (!sameWorld && !LoadWorld(worldSource, location, weatherType, game))
+		{
+			return "Save's world can't be built.";
+		}
+
+		WorldData &worldData = gameData.getWorldData();
+		const size_t levelCount = static_cast<size_t>(worldData.getLevelCount());
+		const LevelRecord *levelRecords = reinterpret_cast<const LevelRecord*>(
+			payload.data() + snapshot.levelsOffset);
+		if ((levelCount != snapshot.levelCount) || (snapshot.currentLevel < 0) ||
+			(snapshot.currentLevel >= static_cast<int32_t>(levelCount)))
+		{
+			return "Save's levels don't match its world.";
+		}
+
+		// Wilderness windows go back to where they were, loading their blocks here. Their voxel
+		// data count depends on which blocks they've had, so saves with voxel changes in a
+		// wilderness only load if it comes out the same.
+		for (size_t i = 0; i < levelCount; i++)
+		{
+			LevelData *level = worldData.findLevel(static_cast<int>(i));
+			if ((level != nullptr) && (level->getWildernessOrigin() != nullptr))
+			{
+				level->setWildernessOrigin(Int2(snapshot.wildOriginX, snapshot.wildOriginZ));
+			}
+		}
+
+		// Empty records are levels that hadn't been generated when saving. Any others are
+		// generated now so their changes can be replayed.
+		auto isEmptyRecord = [](const LevelRecord &levelRecord)
+		{
+			return (levelRecord.width == 0) && (levelRecord.height == 0) &&
+				(levelRecord.depth == 0);
+		};
+
+		for (size_t i = 0; i < levelCount; i++)
+		{
+			const LevelRecord &levelRecord = levelRecords[i];
+			if (isEmptyRecord(levelRecord))
+			{
+				continue;
+			}
+
+			// Saved voxel IDs only mean the same voxel data if the level has as many.
+			const VoxelGrid &voxelGrid = worldData.getLevel(static_cast<int>(i)).getVoxelGrid();
+			if ((levelRecord.width != voxelGrid.getWidth()) ||
+				(levelRecord.height != voxelGrid.getHeight()) ||
+				(levelRecord.depth != voxelGrid.getDepth()) ||
+				((levelRecord.voxelChangeCount > 0) &&
+					(levelRecord.voxelDataCount != voxelGrid.getVoxelDataCount())))
+			{
+				return "Save's level " + std::to_string(i) + " doesn't match its world.";
+			}
+		}
+
+		for (size_t i = 0; i < levelCount; i++)
+		{
+			const LevelRecord &levelRecord = levelRecords[i];
+			if (isEmptyRecord(levelRecord))
+			{
+				LevelData *level = worldData.findLevel(static_cast<int>(i));
+				if (level != nullptr)
+				{
+					level->revertJournal();
+				}
+
+				continue;
+			}
+
+			const VoxelChangeRecord *voxelChangeRecords =
+				reinterpret_cast<const VoxelChangeRecord*>(
+					payload.data() + levelRecord.voxelChangesOffset);
+			const TextTriggerRecord *textTriggerRecords =
+				reinterpret_cast<const TextTriggerRecord*>(
+					payload.data() + levelRecord.textTriggersOffset);
+
+			LevelData::Journal journal;
+			journal.voxels.resize(levelRecord.voxelChangeCount);
+			for (uint32_t j = 0; j < levelRecord.voxelChangeCount; j++)
+			{
+				// Out-of-range IDs are left for applyJournal() to reject.
+				const VoxelChangeRecord &record = voxelChangeRecords[j];
+				LevelData::Journal::VoxelChange &change = journal.voxels[j];
+				change.x = record.x;
+				change.y = record.y;
+				change.z = record.z;
+				change.id = static_cast<uint16_t>(std::min<uint32_t>(record.id, UINT16_MAX));
+				change.originalID = 0;
+			}
+
+			journal.displayedTextTriggers.reserve(levelRecord.textTriggerCount);
+			for (uint32_t j = 0; j < levelRecord.textTriggerCount; j++)
+			{
+				const TextTriggerRecord &record = textTriggerRecords[j];
+				journal.displayedTextTriggers.push_back(Int2(record.x, record.z));
+			}
+
+			LevelData &level = worldData.getLevel(static_cast<int>(i));
+			level.revertJournal();
+			level.applyJournal(journal);
+		}
+
+		if (snapshot.currentLevel != worldData.getCurrentLevel())
+		{
+			worldData.setLevelActive(snapshot.currentLevel, game.getTextureManager(),
+				game.getRenderer());
+		}
+
+		Player &player = gameData.getPlayer();
+		const Double3 position(snapshot.playerPosition[0], snapshot.playerPosition[1],
+			snapshot.playerPosition[2]);
+		const Double3 direction(snapshot.playerDirection[0], snapshot.playerDirection[1],
+			snapshot.playerDirection[2]);
+		player.teleport(position);
+		player.lookAt(position + direction);
+		player.setVelocityToZero();
+
+		gameData.getDate() = Date(snapshot.year, snapshot.month, snapshot.day);
+		gameData.getClock() = Clock(snapshot.hours, snapshot.minutes, snapshot.seconds,
+			std::min(std::max(snapshot.fractionOfSecond, 0.0), 1.0));
+		gameData.getRandom().srand(snapshot.randomSeed);
+
+		auto &weathers = gameData.getWeathersArray();
+		std::transform(snapshot.weathers, snapshot.weathers + sizeof(snapshot.weathers),
+			weathers.begin(), [](uint8_t weather) { return static_cast<WeatherType>(weather); });
+
+		if (IsExterior(worldSource.kind))
+		{
+			game.getRenderer().setNightLightsActive(gameData.getClock().nightLightsAreActive());
+		}
+
+		return std::string();
+	}
+}
+
+const uint32_t SaveGame::VERSION = 3;
+const std::string SaveGame::QUICKSAVE_FILENAME = "quicksave.sav";
+
+JobSystem::JobHandle SaveGame::save(GameData &gameData, const std::string &filename,
+	JobSystem &jobSystem)
+{
+	auto payload = std::make_shared<std::vector<uint8_t>>(MakePayload(gameData));
+	return jobSystem.add([payload, filename]()
+	{
+		if (!IsLittleEndian())
+		{
+			SwapPayloadToFileOrder(*payload);
+		}
+
+		FileHeader header;
+		std::copy(Magic, Magic + sizeof(Magic), header.magic);
+		header.version = SaveGame::VERSION;
+		header.payloadSize = static_cast<uint32_t>(payload->size());
+		header.checksum = GetChecksum(payload->data(), payload->size());
+
+		std::vector<uint8_t> compressed;
+		compressed.reserve(payload->size());
+		Compression::encodeRLE(payload->data(), static_cast<int>(payload->size()), compressed);
+
+		const bool useCompressed = compressed.size() < payload->size();
+		const std::vector<uint8_t> &stored = useCompressed ? compressed : *payload;
+		header.flags = useCompressed ? FlagRLE : 0;
+		header.storedSize = static_cast<uint32_t>(stored.size());
+		if (!IsLittleEndian())
+		{
+			SwapRecord(header);
+		}
+
+		std::ofstream ofs(filename, std::ios::binary);
+		ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		ofs.write(reinterpret_cast<const char*>(stored.data()), stored.size());
+		if (!ofs)
+		{
+			DebugWarning("Couldn't write save \"" + filename + "\".");
+		}
+	});
+}
+
+void SaveGame::load(const std::string &filename, Game &game)
+{
+	auto payload = std::make_shared<std::vector<uint8_t>>();
+	auto error = std::make_shared<std::string>();
+	game.getJobSystem().add([filename, payload, error]()
+	{
+		*error = ReadPayload(filename, *payload);
+	}, std::vector<JobSystem::JobHandle>(), [&game, payload, error]()
+	{
+		if (error->empty() && game.gameDataIsActive())
+		{
+			*error = ApplyPayload(*payload, game);
+		}
+
+		if (!error->empty())
+		{
+			DebugWarning(*error);
+		}
+	});
+}
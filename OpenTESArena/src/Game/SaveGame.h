@@ -0,0 +1,46 @@
+#ifndef SAVE_GAME_H
+#define SAVE_GAME_H
+
+#include <cstdint>
+#include <string>
+
+#include "../Utilities/JobSystem.h"
+
+// Static class for saving the game session to a binary file and loading it back.
+
+// A save is a small header followed by one block of fixed-size little-endian records: the
+// player, date and time, weather, what the world was built from, and each level's journal
+// of changes since it loaded. Loading reads the whole file at once and uses the
+// records where they are, after checking their offsets (and swapping bytes on big-endian
+// machines), so there's no per-field parsing. The block is RLE-compressed, which is
+// done on a worker both ways.
+
+// Loading the save of the world the player is already in only undoes its journals and
+// replays the saved ones on the main thread. Otherwise the world is built again first, the
+// same as travelling to it.
+
+class Game;
+class GameData;
+
+class SaveGame
+{
+private:
+	SaveGame() = delete;
+	~SaveGame() = delete;
+public:
+	// Changes whenever the records change. Saves from other versions aren't loaded.
+	static const uint32_t VERSION;
+
+	// Name of the quicksave file in the options folder.
+	static const std::string QUICKSAVE_FILENAME;
+
+	// Copies the game state right away, then compresses and writes it on a worker.
+	static JobSystem::JobHandle save(GameData &gameData, const std::string &filename,
+		JobSystem &jobSystem);
+
+	// Reads and decompresses the save on a worker, then applies it on the main thread if
+	// a game session is still active by then. Problems with the file are warnings.
+	static void load(const std::string &filename, Game &game);
+};
+
+#endif
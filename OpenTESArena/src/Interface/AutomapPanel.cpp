@@ -28,8 +28,8 @@
 #include "../Rendering/Renderer.h"
 #include "../Rendering/Surface.h"
 #include "../Utilities/Debug.h"
-#include "../World/VoxelData.h"
-#include "../World/VoxelDataType.h"
+#include "../World/AutomapImage.h"
+#include "../World/LevelData.h"
 #include "../World/VoxelGrid.h"
 
 namespace std
@@ -56,18 +56,8 @@ namespace
 	// The "canvas" area for drawing automap content.
 	const Rect DrawingArea(25, 40, 179, 125);
 
-	// Colors for automap pixels. Ground pixels (y == 0) are transparent.
+	// Color of the player's arrow. The level's colors are in the automap image.
 	const Color AutomapPlayer(247, 255, 0);
-	const Color AutomapFloor(0, 0, 0, 0);
-	const Color AutomapWall(130, 89, 48);
-	const Color AutomapRaised(97, 85, 60);
-	const Color AutomapDoor(146, 0, 0);
-	const Color AutomapLevelUp(0, 105, 0);
-	const Color AutomapLevelDown(0, 0, 255);
-	const Color AutomapDryChasm(20, 40, 40);
-	const Color AutomapWetChasm(109, 138, 174);
-	const Color AutomapLavaChasm(255, 0, 0);
-	const Color AutomapNotImplemented(255, 0, 255);
 
 	// Sets of sub-pixel coordinates for drawing each of the player's arrow directions. 
 	// These are offsets from the top-left corner of the 3x3 map pixel that the player 
@@ -86,9 +76,17 @@ namespace
 }
 
 AutomapPanel::AutomapPanel(Game &game, const Double2 &playerPosition,
-	const Double2 &playerDirection, const VoxelGrid &voxelGrid, const std::string &locationName)
+	const Double2 &playerDirection, LevelData &level, const std::string &locationName)
 	: Panel(game), automapOffset(playerPosition)
 {
+	auto &textureManager = game.getTextureManager();
+	this->backgroundHandle = textureManager.getImageHandle(
+		TextureFile::fromName(TextureName::Automap),
+		PaletteFile::fromName(PaletteName::BuiltIn));
+	this->cursorHandle = textureManager.getImageHandle(
+		TextureFile::fromName(TextureName::QuillCursor),
+		TextureFile::fromName(TextureName::Automap));
+
 	this->locationTextBox = [&game, &locationName]()
 	{
 		const Int2 center(120, 28);
@@ -111,207 +109,38 @@ AutomapPanel::AutomapPanel(Game &game, const Double2 &playerPosition,
 		int height = 13;
 		auto function = [](Game &game)
 		{
-			game.setPanel<GameWorldPanel>(game);
+			game.setPooledPanel<GameWorldPanel>(game);
 		};
 		return Button<Game&>(center, width, height, function);
 	}();
 
-	this->mapTexture = [this, &playerPosition, &playerDirection, &voxelGrid]()
-	{
-		// Create scratch surface. For the purposes of the automap, the bottom left corner
-		// is (0, 0), left to right is the Z axis, and up and down is the X axis, because 
-		// north is +X in-game. It is scaled by 3 so that all directions of the player's 
-		// arrow are representable.
-		SDL_Surface *surface = Surface::createSurfaceWithFormat(
-			voxelGrid.getDepth() * 3, voxelGrid.getWidth() * 3, Renderer::DEFAULT_BPP,
-			Renderer::DEFAULT_PIXELFORMAT);
-
-		// Fill with transparent color first (used by floor voxels).
-		SDL_FillRect(surface, nullptr, AutomapFloor.toARGB());
-
-		// Lambda for filling in a square in the map surface.
-		auto drawSquare = [surface](int x, int z, const Color &color)
-		{
-			SDL_Rect rect;
-			rect.x = z * 3;
-			rect.y = surface->h - 3 - (x * 3);
-			rect.w = 3;
-			rect.h = 3;
-
-			SDL_FillRect(surface, &rect, color.toARGB());
-		};
+	// Only the chunks of the level changed since the automap was last open are redrawn,
+	// then the whole image is uploaded at once.
+	const VoxelGrid &voxelGrid = level.getVoxelGrid();
+	AutomapImage &automap = level.getAutomap();
+	automap.update(voxelGrid);
 
-		auto getVoxelData = [&voxelGrid](int x, int y, int z) -> const VoxelData&
-		{
-			const uint16_t *voxels = voxelGrid.getVoxels();
-			const uint16_t id = voxels[x + (y * voxelGrid.getWidth()) +
-				(z * voxelGrid.getWidth() * voxelGrid.getHeight())];
-			return voxelGrid.getVoxelData(id);
-		};
-
-		// For each voxel, start at the lowest Y and walk upwards. The color depends 
-		// on a couple factors, like whether the voxel is a wall, a door, water, etc.,
-		// and some context-sensitive cases like whether a dry chasm has a wall
-		// over it.
-		for (int x = 0; x < voxelGrid.getWidth(); x++)
-		{
-			for (int z = 0; z < voxelGrid.getDepth(); z++)
-			{
-				const VoxelData &floorData = getVoxelData(x, 0, z);
-				const VoxelData &wallData = getVoxelData(x, 1, z);
-
-				// Decide which color to use for the automap pixel.
-				const Color &color = AutomapPanel::getPixelColor(floorData, wallData);
-
-				// Draw the automap pixel.
-				drawSquare(x, z, color);
-			}
-		}
-
-		// Lambda for drawing the player's arrow in the automap. It's drawn differently 
-		// depending on their direction.
-		auto drawPlayer = [surface](int x, int z, const Double2 &direction)
-		{
-			const CardinalDirectionName cardinalDirection =
-				CardinalDirection::getDirectionName(direction);
-
-			const int surfaceX = z * 3;
-			const int surfaceY = surface->h - 3 - (x * 3);
-
-			uint32_t *pixels = static_cast<uint32_t*>(surface->pixels);
-
-			// Draw the player's arrow within the 3x3 map pixel.
-			const std::vector<Int2> &offsets = AutomapPlayerArrowPatterns.at(cardinalDirection);
-			for (const auto &offset : offsets)
-			{
-				const int index = (surfaceX + offset.x) +
-					((surfaceY + offset.y) * surface->w);
-				pixels[index] = AutomapPlayer.toARGB();
-			}
-		};
-
-		const int playerVoxelX = static_cast<int>(std::floor(playerPosition.x));
-		const int playerVoxelZ = static_cast<int>(std::floor(playerPosition.y));
-
-		// Draw player last. Verify that the player is within the bounds of the map 
-		// before drawing.
-		if ((playerVoxelX >= 0) && (playerVoxelX < voxelGrid.getWidth()) &&
-			(playerVoxelZ >= 0) && (playerVoxelZ < voxelGrid.getDepth()))
-		{
-			drawPlayer(playerVoxelX, playerVoxelZ, playerDirection);
-		}
-
-		auto &renderer = this->getGame().getRenderer();
-		Texture texture(renderer.createTextureFromSurface(surface));
-		SDL_FreeSurface(surface);
-
-		return texture;
-	}();
-}
-
-const Color &AutomapPanel::getPixelColor(const VoxelData &floorData, const VoxelData &wallData)
-{
-	const VoxelDataType floorDataType = floorData.dataType;
-	const VoxelDataType wallDataType = wallData.dataType;
-
-	if (floorDataType == VoxelDataType::Chasm)
+	this->mapTexture = [&game, &automap]()
 	{
-		const VoxelData::ChasmData::Type chasmType = floorData.chasm.type;
+		auto &renderer = game.getRenderer();
+		SDL_Texture *texture = renderer.createTexture(Renderer::DEFAULT_PIXELFORMAT,
+			SDL_TEXTUREACCESS_STATIC, automap.getWidth(), automap.getHeight());
+		DebugAssert(texture != nullptr, "Couldn't create automap texture, " +
+			std::string(SDL_GetError()));
+
+		SDL_UpdateTexture(texture, nullptr, automap.getPixels(),
+			automap.getWidth() * static_cast<int>(sizeof(uint32_t)));
+		SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		return Texture(texture);
+	}();
 
-		if (chasmType == VoxelData::ChasmData::Type::Dry)
-		{
-			// Dry chasms are a different color if a wall is over them.
-			return (wallDataType == VoxelDataType::Wall) ? AutomapRaised : AutomapDryChasm;
-		}
-		else if (chasmType == VoxelData::ChasmData::Type::Lava)
-		{
-			// Lava chasms ignore all but raised platforms.
-			return (wallDataType == VoxelDataType::Raised) ? AutomapRaised : AutomapLavaChasm;
-		}
-		else if (chasmType == VoxelData::ChasmData::Type::Wet)
-		{
-			// Water chasms ignore all but raised platforms.
-			return (wallDataType == VoxelDataType::Raised) ? AutomapRaised : AutomapWetChasm;
-		}
-		else
-		{
-			DebugWarning("Unrecognized chasm type \"" +
-				std::to_string(static_cast<int>(chasmType)) + "\".");
-			return AutomapNotImplemented;
-		}
-	}
-	else if (floorDataType == VoxelDataType::Floor)
-	{
-		// If nothing is over the floor, return transparent. Otherwise, choose from
-		// a number of cases.
-		if (wallDataType == VoxelDataType::None)
-		{
-			return AutomapFloor;
-		}
-		else if (wallDataType == VoxelDataType::Wall)
-		{
-			const VoxelData::WallData::Type wallType = wallData.wall.type;
-
-			if (wallType == VoxelData::WallData::Type::Solid)
-			{
-				return AutomapWall;
-			}
-			else if (wallType == VoxelData::WallData::Type::LevelUp)
-			{
-				return AutomapLevelUp;
-			}
-			else if (wallType == VoxelData::WallData::Type::LevelDown)
-			{
-				return AutomapLevelDown;
-			}
-			else if (wallType == VoxelData::WallData::Type::Menu)
-			{
-				// Menu blocks are the same color as doors.
-				return AutomapDoor;
-			}
-			else
-			{
-				DebugWarning("Unrecognized wall type \"" +
-					std::to_string(static_cast<int>(wallType)) + "\".");
-				return AutomapNotImplemented;
-			}
-		}
-		else if (wallDataType == VoxelDataType::Raised)
-		{
-			return AutomapRaised;
-		}
-		else if (wallDataType == VoxelDataType::Diagonal)
-		{
-			return AutomapFloor;
-		}
-		else if (wallDataType == VoxelDataType::Door)
-		{
-			return AutomapDoor;
-		}
-		else if (wallDataType == VoxelDataType::TransparentWall)
-		{
-			// Transparent walls with collision (hedges) are shown, while
-			// ones without collision (archways) are not.
-			const VoxelData::TransparentWallData &transparentWallData = wallData.transparentWall;
-			return transparentWallData.collider ? AutomapWall : AutomapFloor;
-		}
-		else if (wallDataType == VoxelDataType::Edge)
-		{
-			return AutomapWall;
-		}
-		else
-		{
-			DebugWarning("Unrecognized wall data type \"" +
-				std::to_string(static_cast<int>(wallDataType)) + "\".");
-			return AutomapNotImplemented;
-		}
-	}
-	else
-	{
-		DebugWarning("Unrecognized floor data type \"" +
-			std::to_string(static_cast<int>(floorDataType)) + "\".");
-		return AutomapNotImplemented;
-	}
+	// The player's arrow is drawn over the map each frame, if the player is on it.
+	const int playerVoxelX = static_cast<int>(std::floor(playerPosition.x));
+	const int playerVoxelZ = static_cast<int>(std::floor(playerPosition.y));
+	this->playerVisible = (playerVoxelX >= 0) && (playerVoxelX < voxelGrid.getWidth()) &&
+		(playerVoxelZ >= 0) && (playerVoxelZ < voxelGrid.getDepth());
+	this->playerVoxel = Int2(playerVoxelX, playerVoxelZ);
+	this->playerDirectionName = CardinalDirection::getDirectionName(playerDirection);
 }
 
 std::pair<SDL_Texture*, CursorAlignment> AutomapPanel::getCurrentCursor() const
@@ -319,9 +148,7 @@ std::pair<SDL_Texture*, CursorAlignment> AutomapPanel::getCurrentCursor() const
 	auto &game = this->getGame();
 	auto &renderer = game.getRenderer();
 	auto &textureManager = game.getTextureManager();
-	const auto &texture = textureManager.getTexture(
-		TextureFile::fromName(TextureName::QuillCursor),
-		TextureFile::fromName(TextureName::Automap), renderer);
+	const auto &texture = textureManager.getTexture(this->cursorHandle, renderer);
 	return std::make_pair(texture.get(), CursorAlignment::BottomLeft);
 }
 
@@ -421,8 +248,7 @@ void AutomapPanel::render(Renderer &renderer)
 
 	// Draw automap background.
 	const auto &automapBackground = textureManager.getTexture(
-		TextureFile::fromName(TextureName::Automap),
-		PaletteFile::fromName(PaletteName::BuiltIn), renderer);
+		this->backgroundHandle, renderer);
 	renderer.drawOriginal(automapBackground.get());
 
 	// Only draw the part of the automap within the drawing area.
@@ -438,6 +264,22 @@ void AutomapPanel::render(Renderer &renderer)
 		this->mapTexture.getHeight();
 	renderer.drawOriginal(this->mapTexture.get(), mapX, mapY);
 
+	// Draw the player's arrow within their 3x3 map pixel. The map's bottom left is (0, 0).
+	if (this->playerVisible)
+	{
+		const int squareSize = AutomapImage::PIXELS_PER_VOXEL;
+		const int arrowX = mapX + (this->playerVoxel.y * squareSize);
+		const int arrowY = mapY + this->mapTexture.getHeight() - squareSize -
+			(this->playerVoxel.x * squareSize);
+
+		const std::vector<Int2> &offsets =
+			AutomapPlayerArrowPatterns.at(this->playerDirectionName);
+		for (const Int2 &offset : offsets)
+		{
+			renderer.fillOriginalRect(AutomapPlayer, arrowX + offset.x, arrowY + offset.y, 1, 1);
+		}
+	}
+
 	// Reset renderer clipping to normal.
 	renderer.setClipRect(nullptr);
 
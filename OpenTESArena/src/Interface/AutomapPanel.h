@@ -8,11 +8,11 @@
 #include "../Math/Vector2.h"
 #include "../Rendering/Texture.h"
 
-class Color;
+class LevelData;
 class Renderer;
 class TextBox;
-class VoxelData;
-class VoxelGrid;
+
+enum class CardinalDirectionName;
 
 class AutomapPanel : public Panel
 {
@@ -21,10 +21,10 @@ private:
 	Button<Game&> backToGameButton;
 	Texture mapTexture;
 	Double2 automapOffset; // Displayed XZ coordinate offset from (0, 0).
-
-	// Gets the display color for a pixel on the automap, given its associated floor
-	// and wall voxel data definitions.
-	static const Color &getPixelColor(const VoxelData &floorData, const VoxelData &wallData);
+	Int2 playerVoxel; // XZ voxel the player's arrow is drawn in.
+	CardinalDirectionName playerDirectionName;
+	bool playerVisible; // Whether the player is within the level's bounds.
+	int backgroundHandle, cursorHandle; // Texture manager handles of per-frame images.
 
 	// Listen for when the LMB is held on a compass direction.
 	void handleMouse(double dt);
@@ -32,7 +32,7 @@ private:
 	void drawTooltip(const std::string &text, Renderer &renderer);
 public:
 	AutomapPanel(Game &game, const Double2 &playerPosition, const Double2 &playerDirection,
-		const VoxelGrid &voxelGrid, const std::string &locationName);
+		LevelData &level, const std::string &locationName);
 	virtual ~AutomapPanel() = default;
 
 	virtual std::pair<SDL_Texture*, CursorAlignment> getCurrentCursor() const override;
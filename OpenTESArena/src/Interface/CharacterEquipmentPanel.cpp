@@ -52,7 +52,7 @@ CharacterEquipmentPanel::CharacterEquipmentPanel(Game &game)
 
 		const auto &player = game.getGameData().getPlayer();
 		const auto &exeData = game.getMiscAssets().getExeData();
-		const std::string &text = exeData.races.singularNames.at(player.getRaceID());
+		const std::string &text = exeData.getRaces().singularNames.at(player.getRaceID());
 
 		const RichTextString richText(
 			text,
@@ -87,7 +87,7 @@ CharacterEquipmentPanel::CharacterEquipmentPanel(Game &game)
 		int height = 12;
 		auto function = [](Game &game)
 		{
-			game.setPanel<CharacterPanel>(game);
+			game.setPooledPanel<CharacterPanel>(game);
 		};
 		return Button<Game&>(x, y, width, height, function);
 	}();
@@ -148,7 +148,7 @@ CharacterEquipmentPanel::CharacterEquipmentPanel(Game &game)
 	const auto &player = this->getGame().getGameData().getPlayer();
 	const std::string &headsFilename = PortraitFile::getHeads(
 		player.getGenderName(), player.getRaceID(), false);
-	CIFFile cifFile(headsFilename, Palette());
+	CIFFile cifFile(headsFilename);
 
 	for (int i = 0; i < cifFile.getImageCount(); i++)
 	{
@@ -167,6 +167,11 @@ std::pair<SDL_Texture*, CursorAlignment> CharacterEquipmentPanel::getCurrentCurs
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool CharacterEquipmentPanel::isIdle() const
+{
+	return true;
+}
+
 void CharacterEquipmentPanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
@@ -240,26 +245,28 @@ void CharacterEquipmentPanel::render(Renderer &renderer)
 
 	// Draw the current portrait and clothes.
 	const Int2 &headOffset = this->headOffsets.at(player.getPortraitID());
-	const auto &head = textureManager.getTextures(headsFilename,
-		PaletteFile::fromName(PaletteName::CharSheet), renderer).at(player.getPortraitID());
-	const auto &body = textureManager.getTexture(bodyFilename, renderer);
-	const auto &shirt = textureManager.getTexture(shirtFilename, renderer);
-	const auto &pants = textureManager.getTexture(pantsFilename, renderer);
-	renderer.drawOriginal(body.get(), Renderer::ORIGINAL_WIDTH - body.getWidth(), 0);
-	renderer.drawOriginal(pants.get(), pantsOffset.x, pantsOffset.y);
-	renderer.drawOriginal(head.get(), headOffset.x, headOffset.y);
-	renderer.drawOriginal(shirt.get(), shirtOffset.x, shirtOffset.y);
+	const auto head = textureManager.getAtlasRegion(headsFilename,
+		PaletteFile::fromName(PaletteName::CharSheet), player.getPortraitID(), renderer);
+	const auto body = textureManager.getAtlasRegion(bodyFilename, renderer);
+	const auto shirt = textureManager.getAtlasRegion(shirtFilename, renderer);
+	const auto pants = textureManager.getAtlasRegion(pantsFilename, renderer);
+	this->interfaceBatch.add(body, Renderer::ORIGINAL_WIDTH - body.width, 0);
+	this->interfaceBatch.add(pants, pantsOffset.x, pantsOffset.y);
+	this->interfaceBatch.add(head, headOffset.x, headOffset.y);
+	this->interfaceBatch.add(shirt, shirtOffset.x, shirtOffset.y);
 
 	// Draw character equipment background.
 	const auto &equipmentBackground = textureManager.getTexture(
 		TextureFile::fromName(TextureName::CharacterEquipment), renderer);
-	renderer.drawOriginal(equipmentBackground.get());
+	this->interfaceBatch.add(equipmentBackground.get(), 0, 0);
 
 	// Draw text boxes: player name, race, class.
-	renderer.drawOriginal(this->playerNameTextBox->getTexture(),
+	this->interfaceBatch.add(this->playerNameTextBox->getTexture(),
 		this->playerNameTextBox->getX(), this->playerNameTextBox->getY());
-	renderer.drawOriginal(this->playerRaceTextBox->getTexture(),
+	this->interfaceBatch.add(this->playerRaceTextBox->getTexture(),
 		this->playerRaceTextBox->getX(), this->playerRaceTextBox->getY());
-	renderer.drawOriginal(this->playerClassTextBox->getTexture(),
+	this->interfaceBatch.add(this->playerClassTextBox->getTexture(),
 		this->playerClassTextBox->getX(), this->playerClassTextBox->getY());
+
+	this->interfaceBatch.flush(renderer);
 }
@@ -6,6 +6,7 @@
 #include "Button.h"
 #include "Panel.h"
 #include "../Math/Vector2.h"
+#include "../Rendering/InterfaceBatch.h"
 
 class Renderer;
 class TextBox;
@@ -20,11 +21,13 @@ private:
 	Button<Game&, int> dropButton;
 	Button<CharacterEquipmentPanel*> scrollDownButton, scrollUpButton;
 	std::vector<Int2> headOffsets;
+	InterfaceBatch interfaceBatch;
 public:
 	CharacterEquipmentPanel(Game &game);
 	virtual ~CharacterEquipmentPanel() = default;
 
 	virtual std::pair<SDL_Texture*, CursorAlignment> getCurrentCursor() const override;
+	virtual bool isIdle() const override;
 	virtual void handleEvent(const SDL_Event &e) override;
 	virtual void render(Renderer &renderer) override;
 };
@@ -54,7 +54,7 @@ CharacterPanel::CharacterPanel(Game &game)
 
 		const auto &player = game.getGameData().getPlayer();
 		const auto &exeData = game.getMiscAssets().getExeData();
-		const std::string &text = exeData.races.singularNames.at(player.getRaceID());
+		const std::string &text = exeData.getRaces().singularNames.at(player.getRaceID());
 
 		const RichTextString richText(
 			text,
@@ -88,7 +88,7 @@ CharacterPanel::CharacterPanel(Game &game)
 		int height = 13;
 		auto function = [](Game &game)
 		{
-			game.setPanel<GameWorldPanel>(game);
+			game.setPooledPanel<GameWorldPanel>(game);
 		};
 		return Button<Game&>(center, width, height, function);
 	}();
@@ -110,7 +110,7 @@ CharacterPanel::CharacterPanel(Game &game)
 	const auto &player = this->getGame().getGameData().getPlayer();
 	const std::string &headsFilename = PortraitFile::getHeads(
 		player.getGenderName(), player.getRaceID(), false);
-	CIFFile cifFile(headsFilename, Palette());
+	CIFFile cifFile(headsFilename);
 
 	for (int i = 0; i < cifFile.getImageCount(); i++)
 	{
@@ -118,6 +118,18 @@ CharacterPanel::CharacterPanel(Game &game)
 	}
 }
 
+bool CharacterPanel::isPoolable() const
+{
+	return true;
+}
+
+size_t CharacterPanel::getPooledBytes() const
+{
+	return this->playerNameTextBox->getBytes() +
+		this->playerRaceTextBox->getBytes() +
+		this->playerClassTextBox->getBytes();
+}
+
 std::pair<SDL_Texture*, CursorAlignment> CharacterPanel::getCurrentCursor() const
 {
 	auto &game = this->getGame();
@@ -129,6 +141,11 @@ std::pair<SDL_Texture*, CursorAlignment> CharacterPanel::getCurrentCursor() cons
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool CharacterPanel::isIdle() const
+{
+	return true;
+}
+
 void CharacterPanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
@@ -189,31 +206,33 @@ void CharacterPanel::render(Renderer &renderer)
 
 	// Draw the current portrait and clothes.
 	const Int2 &headOffset = this->headOffsets.at(player.getPortraitID());
-	const auto &head = textureManager.getTextures(headsFilename,
-		PaletteFile::fromName(PaletteName::CharSheet), renderer).at(player.getPortraitID());
-	const auto &body = textureManager.getTexture(bodyFilename, renderer);
-	const auto &shirt = textureManager.getTexture(shirtFilename, renderer);
-	const auto &pants = textureManager.getTexture(pantsFilename, renderer);
-	renderer.drawOriginal(body.get(), Renderer::ORIGINAL_WIDTH - body.getWidth(), 0);
-	renderer.drawOriginal(pants.get(), pantsOffset.x, pantsOffset.y);
-	renderer.drawOriginal(head.get(), headOffset.x, headOffset.y);
-	renderer.drawOriginal(shirt.get(), shirtOffset.x, shirtOffset.y);
+	const auto head = textureManager.getAtlasRegion(headsFilename,
+		PaletteFile::fromName(PaletteName::CharSheet), player.getPortraitID(), renderer);
+	const auto body = textureManager.getAtlasRegion(bodyFilename, renderer);
+	const auto shirt = textureManager.getAtlasRegion(shirtFilename, renderer);
+	const auto pants = textureManager.getAtlasRegion(pantsFilename, renderer);
+	this->interfaceBatch.add(body, Renderer::ORIGINAL_WIDTH - body.width, 0);
+	this->interfaceBatch.add(pants, pantsOffset.x, pantsOffset.y);
+	this->interfaceBatch.add(head, headOffset.x, headOffset.y);
+	this->interfaceBatch.add(shirt, shirtOffset.x, shirtOffset.y);
 
 	// Draw character stats background.
 	const auto &statsBackground = textureManager.getTexture(
 		TextureFile::fromName(TextureName::CharacterStats), renderer);
-	renderer.drawOriginal(statsBackground.get());
+	this->interfaceBatch.add(statsBackground.get(), 0, 0);
 
 	// Draw "Next Page" texture.
-	const auto &nextPageTexture = textureManager.getTexture(
+	const auto nextPageRegion = textureManager.getAtlasRegion(
 		TextureFile::fromName(TextureName::NextPage), renderer);
-	renderer.drawOriginal(nextPageTexture.get(), 108, 179);
+	this->interfaceBatch.add(nextPageRegion, 108, 179);
 
 	// Draw text boxes: player name, race, class.
-	renderer.drawOriginal(this->playerNameTextBox->getTexture(),
+	this->interfaceBatch.add(this->playerNameTextBox->getTexture(),
 		this->playerNameTextBox->getX(), this->playerNameTextBox->getY());
-	renderer.drawOriginal(this->playerRaceTextBox->getTexture(),
+	this->interfaceBatch.add(this->playerRaceTextBox->getTexture(),
 		this->playerRaceTextBox->getX(), this->playerRaceTextBox->getY());
-	renderer.drawOriginal(this->playerClassTextBox->getTexture(),
+	this->interfaceBatch.add(this->playerClassTextBox->getTexture(),
 		this->playerClassTextBox->getX(), this->playerClassTextBox->getY());
+
+	this->interfaceBatch.flush(renderer);
 }
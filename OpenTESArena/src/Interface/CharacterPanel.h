@@ -6,6 +6,7 @@
 #include "Button.h"
 #include "Panel.h"
 #include "../Math/Vector2.h"
+#include "../Rendering/InterfaceBatch.h"
 
 // Maybe rename this to "CharacterStatsPanel"?
 
@@ -22,11 +23,15 @@ private:
 		playerClassTextBox;
 	Button<Game&> doneButton, nextPageButton;
 	std::vector<Int2> headOffsets;
+	InterfaceBatch interfaceBatch;
 public:
 	CharacterPanel(Game &game);
 	virtual ~CharacterPanel() = default;
 
 	virtual std::pair<SDL_Texture*, CursorAlignment> getCurrentCursor() const override;
+	virtual bool isPoolable() const override;
+	virtual size_t getPooledBytes() const override;
+	virtual bool isIdle() const override;
 	virtual void handleEvent(const SDL_Event &e) override;
 	virtual void render(Renderer &renderer) override;
 };
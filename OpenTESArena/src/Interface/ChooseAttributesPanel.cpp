@@ -69,7 +69,7 @@ ChooseAttributesPanel::ChooseAttributesPanel(Game &game,
 		const int y = 17;
 
 		const auto &exeData = game.getMiscAssets().getExeData();
-		const std::string &text = exeData.races.singularNames.at(raceID);
+		const std::string &text = exeData.getRaces().singularNames.at(raceID);
 
 		const RichTextString richText(
 			text,
@@ -121,7 +121,7 @@ ChooseAttributesPanel::ChooseAttributesPanel(Game &game,
 			messageBoxTitle.textBox = [&game, raceID, &renderer]()
 			{
 				const auto &exeData = game.getMiscAssets().getExeData();
-				const std::string &text = exeData.charCreation.chooseAttributes;
+				const std::string &text = exeData.getCharCreation().chooseAttributes;
 
 				const Color textColor(199, 199, 199);
 
@@ -158,7 +158,7 @@ ChooseAttributesPanel::ChooseAttributesPanel(Game &game,
 			messageBoxSave.textBox = [&game, &renderer, &buttonTextColor]()
 			{
 				const auto &exeData = game.getMiscAssets().getExeData();
-				std::string text = exeData.charCreation.chooseAttributesSave;
+				std::string text = exeData.getCharCreation().chooseAttributesSave;
 
 				// To do: use the formatting characters in the string for color.
 				// - For now, just delete them.
@@ -197,7 +197,7 @@ ChooseAttributesPanel::ChooseAttributesPanel(Game &game,
 				const std::string text = [&game]()
 				{
 					const auto &exeData = game.getMiscAssets().getExeData();
-					std::string segment = exeData.charCreation.chooseAppearance;
+					std::string segment = exeData.getCharCreation().chooseAppearance;
 					segment = String::replace(segment, '\r', '\n');
 
 					return segment;
@@ -234,7 +234,8 @@ ChooseAttributesPanel::ChooseAttributesPanel(Game &game,
 						const auto &miscAssets = game.getMiscAssets();
 						const bool fullGameWindow = game.getOptions().getModernInterface();
 						renderer.initializeWorldRendering(
-							game.getOptions().getResolutionScale(), fullGameWindow);
+							game.getOptions().getResolutionScale(), fullGameWindow,
+							game.getOptions().getHardwareRendering());
 
 						std::unique_ptr<GameData> gameData = [this, &name, gender, raceID,
 							&charClass, &miscAssets]()
@@ -336,7 +337,8 @@ ChooseAttributesPanel::ChooseAttributesPanel(Game &game,
 
 								auto &renderer = game.getRenderer();
 								gameData.loadCity(localCityID, provinceID, weatherType,
-									game.getMiscAssets(), game.getTextureManager(), renderer);
+									game.getMiscAssets(), game.getTextureManager(), renderer,
+									game.getJobSystem());
 
 								// Set music based on weather and time.
 								const auto &clock = gameData.getClock();
@@ -391,7 +393,7 @@ ChooseAttributesPanel::ChooseAttributesPanel(Game &game,
 			messageBoxReroll.textBox = [&game, &renderer, &buttonTextColor]()
 			{
 				const auto &exeData = game.getMiscAssets().getExeData();
-				std::string text = exeData.charCreation.chooseAttributesReroll;
+				std::string text = exeData.getCharCreation().chooseAttributesReroll;
 
 				// To do: use the formatting characters in the string for color.
 				// - For now, just delete them.
@@ -472,7 +474,7 @@ ChooseAttributesPanel::ChooseAttributesPanel(Game &game,
 
 	// Get pixel offsets for each head.
 	const std::string &headsFilename = PortraitFile::getHeads(gender, raceID, false);
-	CIFFile cifFile(headsFilename, Palette());
+	CIFFile cifFile(headsFilename);
 
 	for (int i = 0; i < cifFile.getImageCount(); i++)
 	{
@@ -494,7 +496,7 @@ ChooseAttributesPanel::ChooseAttributesPanel(Game &game,
 		const std::string text = [&game]()
 		{
 			const auto &exeData = game.getMiscAssets().getExeData();
-			std::string segment = exeData.charCreation.distributeClassPoints;
+			std::string segment = exeData.getCharCreation().distributeClassPoints;
 			segment = String::replace(segment, '\r', '\n');
 
 			return segment;
@@ -541,6 +543,11 @@ std::pair<SDL_Texture*, CursorAlignment> ChooseAttributesPanel::getCurrentCursor
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool ChooseAttributesPanel::isIdle() const
+{
+	return true;
+}
+
 void ChooseAttributesPanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
@@ -40,6 +40,7 @@ public:
 	virtual ~ChooseAttributesPanel() = default;
 
 	virtual std::pair<SDL_Texture*, CursorAlignment> getCurrentCursor() const override;
+	virtual bool isIdle() const override;
 	virtual void handleEvent(const SDL_Event &e) override;
 	virtual void render(Renderer &renderer) override;
 };
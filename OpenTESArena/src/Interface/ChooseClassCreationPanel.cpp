@@ -39,7 +39,7 @@ ChooseClassCreationPanel::ChooseClassCreationPanel(Game &game)
 		const Int2 center((Renderer::ORIGINAL_WIDTH / 2) - 1, 80);
 
 		const auto &exeData = game.getMiscAssets().getExeData();
-		std::string text = exeData.charCreation.chooseClassCreation;
+		std::string text = exeData.getCharCreation().chooseClassCreation;
 		text = String::replace(text, '\r', '\n');
 
 		const int lineSpacing = 1;
@@ -60,7 +60,7 @@ ChooseClassCreationPanel::ChooseClassCreationPanel(Game &game)
 		const Int2 center((Renderer::ORIGINAL_WIDTH / 2) - 1, 120);
 
 		const auto &exeData = game.getMiscAssets().getExeData();
-		const std::string &text = exeData.charCreation.chooseClassCreationGenerate;
+		const std::string &text = exeData.getCharCreation().chooseClassCreationGenerate;
 
 		const RichTextString richText(
 			text,
@@ -77,7 +77,7 @@ ChooseClassCreationPanel::ChooseClassCreationPanel(Game &game)
 		const Int2 center((Renderer::ORIGINAL_WIDTH / 2) - 1, 160);
 
 		const auto &exeData = game.getMiscAssets().getExeData();
-		const std::string &text = exeData.charCreation.chooseClassCreationSelect;
+		const std::string &text = exeData.getCharCreation().chooseClassCreationSelect;
 
 		const RichTextString richText(
 			text,
@@ -131,6 +131,11 @@ std::pair<SDL_Texture*, CursorAlignment> ChooseClassCreationPanel::getCurrentCur
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool ChooseClassCreationPanel::isIdle() const
+{
+	return true;
+}
+
 void ChooseClassCreationPanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
@@ -28,6 +28,7 @@ public:
 	virtual ~ChooseClassCreationPanel() = default;
 
 	virtual std::pair<SDL_Texture*, CursorAlignment> getCurrentCursor() const override;
+	virtual bool isIdle() const override;
 	virtual void handleEvent(const SDL_Event &e) override;
 	virtual void render(Renderer &renderer) override;
 };
@@ -55,7 +55,7 @@ ChooseClassPanel::ChooseClassPanel(Game &game)
 		const int y = 32;
 
 		const auto &exeData = game.getMiscAssets().getExeData();
-		const std::string &text = exeData.charCreation.chooseClassList;
+		const std::string &text = exeData.getCharCreation().chooseClassList;
 
 		const RichTextString richText(
 			text,
@@ -88,8 +88,7 @@ ChooseClassPanel::ChooseClassPanel(Game &game)
 			elements,
 			FontName::A,
 			maxDisplayed,
-			game.getFontManager(),
-			game.getRenderer());
+			game.getFontManager());
 	}();
 
 	this->backToClassCreationButton = []()
@@ -161,6 +160,11 @@ std::pair<SDL_Texture*, CursorAlignment> ChooseClassPanel::getCurrentCursor() co
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool ChooseClassPanel::isIdle() const
+{
+	return true;
+}
+
 void ChooseClassPanel::handleEvent(const SDL_Event &e)
 {
 	// Eventually handle mouse motion: if mouse is over scroll bar and
@@ -319,7 +323,7 @@ std::string ChooseClassPanel::getClassWeapons(const CharacterClass &characterCla
 	
 	// Get weapon names from the executable.
 	const auto &exeData = this->getGame().getMiscAssets().getExeData();
-	const auto &weaponStrings = exeData.equipment.weaponNames;
+	const auto &weaponStrings = exeData.getEquipment().weaponNames;
 
 	// Sort as they are listed in the CharacterClassParser.
 	std::vector<int> allowedWeapons = characterClass.getAllowedWeapons();
@@ -434,9 +438,8 @@ void ChooseClassPanel::render(Renderer &renderer)
 	// Draw text: title, list.
 	renderer.drawOriginal(this->titleTextBox->getTexture(),
 		this->titleTextBox->getX(), this->titleTextBox->getY());
-	renderer.drawOriginal(this->classesListBox->getTexture(),
-		this->classesListBox->getPoint().x,
-		this->classesListBox->getPoint().y);
+	this->classesListBox->draw(this->getGame().getTextRenderer(),
+		this->getGame().getFontManager(), renderer);
 
 	// Draw tooltip if over a valid element in the list box.
 	const auto &inputManager = this->getGame().getInputManager();
@@ -39,7 +39,7 @@ ChooseGenderPanel::ChooseGenderPanel(Game &game, const CharacterClass &charClass
 		const Int2 center(Renderer::ORIGINAL_WIDTH / 2, 80);
 
 		const auto &exeData = game.getMiscAssets().getExeData();
-		const std::string &text = exeData.charCreation.chooseGender;
+		const std::string &text = exeData.getCharCreation().chooseGender;
 
 		const RichTextString richText(
 			text,
@@ -56,7 +56,7 @@ ChooseGenderPanel::ChooseGenderPanel(Game &game, const CharacterClass &charClass
 		const Int2 center(Renderer::ORIGINAL_WIDTH / 2, 120);
 
 		const auto &exeData = game.getMiscAssets().getExeData();
-		const std::string &text = exeData.charCreation.chooseGenderMale;
+		const std::string &text = exeData.getCharCreation().chooseGenderMale;
 
 		const RichTextString richText(
 			text,
@@ -73,7 +73,7 @@ ChooseGenderPanel::ChooseGenderPanel(Game &game, const CharacterClass &charClass
 		const Int2 center(Renderer::ORIGINAL_WIDTH / 2, 160);
 
 		const auto &exeData = game.getMiscAssets().getExeData();
-		const std::string &text = exeData.charCreation.chooseGenderFemale;
+		const std::string &text = exeData.getCharCreation().chooseGenderFemale;
 
 		const RichTextString richText(
 			text,
@@ -130,6 +130,11 @@ std::pair<SDL_Texture*, CursorAlignment> ChooseGenderPanel::getCurrentCursor() c
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool ChooseGenderPanel::isIdle() const
+{
+	return true;
+}
+
 void ChooseGenderPanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
@@ -42,7 +42,7 @@ ChooseNamePanel::ChooseNamePanel(Game &game, const CharacterClass &charClass)
 		const int y = 82;
 
 		const auto &exeData = game.getMiscAssets().getExeData();
-		std::string text = exeData.charCreation.chooseName;
+		std::string text = exeData.getCharCreation().chooseName;
 		text = String::replace(text, "%s", charClass.getName());
 
 		const RichTextString richText(
@@ -106,6 +106,11 @@ std::pair<SDL_Texture*, CursorAlignment> ChooseNamePanel::getCurrentCursor() con
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool ChooseNamePanel::isIdle() const
+{
+	return true;
+}
+
 void ChooseNamePanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
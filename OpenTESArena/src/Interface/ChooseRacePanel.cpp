@@ -61,12 +61,12 @@ ChooseRacePanel::ChooseRacePanel(Game &game, const CharacterClass &charClass,
 			messageBoxTitle.textBox = [&game, raceID, &renderer, &textColor]()
 			{
 				const auto &exeData = game.getMiscAssets().getExeData();
-				std::string text = exeData.charCreation.confirmRace;
+				std::string text = exeData.getCharCreation().confirmRace;
 				text = String::replace(text, '\r', '\n');
 
 				const std::string &provinceName =
-					exeData.locations.charCreationProvinceNames.at(raceID);
-				const std::string &pluralRaceName = exeData.races.pluralNames.at(raceID);
+					exeData.getLocations().charCreationProvinceNames.at(raceID);
+				const std::string &pluralRaceName = exeData.getRaces().pluralNames.at(raceID);
 
 				// Replace first %s with province name.
 				size_t index = text.find("%s");
@@ -152,7 +152,7 @@ ChooseRacePanel::ChooseRacePanel(Game &game, const CharacterClass &charClass,
 					const std::string text = [&game]()
 					{
 						const auto &exeData = game.getMiscAssets().getExeData();
-						std::string segment = exeData.charCreation.confirmedRace4;
+						std::string segment = exeData.getCharCreation().confirmedRace4;
 						segment = String::replace(segment, '\r', '\n');
 
 						return segment;
@@ -193,11 +193,13 @@ ChooseRacePanel::ChooseRacePanel(Game &game, const CharacterClass &charClass,
 					const std::string text = [&game, &charClass]()
 					{
 						const auto &exeData = game.getMiscAssets().getExeData();
-						std::string segment = exeData.charCreation.confirmedRace3;
+						std::string segment = exeData.getCharCreation().confirmedRace3;
 						segment = String::replace(segment, '\r', '\n');
 
+						const auto &preferredAttributesList =
+							exeData.getCharClasses().preferredAttributes;
 						const std::string &preferredAttributes =
-							exeData.charClasses.preferredAttributes.at(charClass.getClassIndex());
+							preferredAttributesList.at(charClass.getClassIndex());
 
 						// Replace first %s with desired class attributes.
 						size_t index = segment.find("%s");
@@ -245,7 +247,7 @@ ChooseRacePanel::ChooseRacePanel(Game &game, const CharacterClass &charClass,
 					const std::string text = [&game, raceID]()
 					{
 						const auto &exeData = game.getMiscAssets().getExeData();
-						std::string segment = exeData.charCreation.confirmedRace2;
+						std::string segment = exeData.getCharCreation().confirmedRace2;
 						segment = String::replace(segment, '\r', '\n');
 
 						// Get race description from TEMPLATE.DAT.
@@ -298,12 +300,13 @@ ChooseRacePanel::ChooseRacePanel(Game &game, const CharacterClass &charClass,
 					const std::string text = [&game, &charClass, &name, gender, raceID]()
 					{
 						const auto &exeData = game.getMiscAssets().getExeData();
-						std::string segment = exeData.charCreation.confirmedRace1;
+						std::string segment = exeData.getCharCreation().confirmedRace1;
 						segment = String::replace(segment, '\r', '\n');
 
 						const std::string &provinceName =
-							exeData.locations.charCreationProvinceNames.at(raceID);
-						const std::string &pluralRaceName = exeData.races.pluralNames.at(raceID);
+							exeData.getLocations().charCreationProvinceNames.at(raceID);
+						const std::string &pluralRaceName =
+							exeData.getRaces().pluralNames.at(raceID);
 
 						// Replace first %s with player class.
 						size_t index = segment.find("%s");
@@ -435,7 +438,7 @@ std::unique_ptr<Panel> ChooseRacePanel::getInitialSubPanel(Game &game,
 	const std::string text = [&game, &charClass, &name]()
 	{
 		const auto &exeData = game.getMiscAssets().getExeData();
-		std::string segment = exeData.charCreation.chooseRace;
+		std::string segment = exeData.getCharCreation().chooseRace;
 		segment = String::replace(segment, '\r', '\n');
 
 		// Replace first "%s" with player name.
@@ -521,6 +524,11 @@ std::pair<SDL_Texture*, CursorAlignment> ChooseRacePanel::getCurrentCursor() con
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool ChooseRacePanel::isIdle() const
+{
+	return true;
+}
+
 void ChooseRacePanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
@@ -554,7 +562,7 @@ void ChooseRacePanel::drawProvinceTooltip(int provinceID, Renderer &renderer)
 {
 	// Get the race name associated with the province.
 	const auto &exeData = this->getGame().getMiscAssets().getExeData();
-	const std::string &raceName = exeData.races.pluralNames.at(provinceID);
+	const std::string &raceName = exeData.getRaces().pluralNames.at(provinceID);
 
 	const Texture tooltip(Panel::createTooltip(
 		"Land of the " + raceName, FontName::D, this->getGame().getFontManager(), renderer));
@@ -1,12 +1,19 @@
+#include <algorithm>
 #include <cassert>
 
 #include "SDL.h"
 
 #include "CinematicPanel.h"
+#include "../Assets/AssetName.h"
+#include "../Assets/FLCDecoder.h"
 #include "../Game/Game.h"
+#include "../Media/IndexedImage.h"
 #include "../Media/TextureManager.h"
 #include "../Rendering/Renderer.h"
-#include "../Rendering/Texture.h"
+#include "../Utilities/Debug.h"
+#include "../Utilities/MemoryTracker.h"
+
+const int CinematicPanel::FRAMES_AHEAD = 4;
 
 CinematicPanel::CinematicPanel(Game &game,
 	const std::string &paletteName, const std::string &sequenceName,
@@ -21,6 +28,189 @@ CinematicPanel::CinematicPanel(Game &game,
 	this->secondsPerImage = secondsPerImage;
 	this->currentSeconds = 0.0;
 	this->imageIndex = 0;
+	this->decoderFinished = false;
+
+	// Videos are streamed so they don't need every frame in memory before starting.
+	const AssetName::Extension extension = AssetName(sequenceName).getExtension();
+	const bool isVideo = (extension == AssetName::Extension::FLC) ||
+		(extension == AssetName::Extension::CEL);
+
+	int width, height;
+	if (isVideo)
+	{
+		this->decoder = std::make_unique<FLCDecoder>(sequenceName);
+		this->frameCount = this->decoder->getFrameCount();
+		width = this->decoder->getWidth();
+		height = this->decoder->getHeight();
+	}
+	else
+	{
+		auto &textureManager = game.getTextureManager();
+		const auto &images = textureManager.getImages(sequenceName, paletteName);
+		DebugAssert(images.size() > 0, "No images in \"" + sequenceName + "\".");
+
+		this->frameCount = static_cast<int>(images.size());
+		width = images.front().getWidth();
+		height = images.front().getHeight();
+	}
+
+	auto &renderer = game.getRenderer();
+	SDL_Texture *texture = renderer.createTexture(Renderer::DEFAULT_PIXELFORMAT,
+		SDL_TEXTUREACCESS_STREAMING, width, height);
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	this->videoTexture = Texture(texture);
+
+	// The first frame is decoded here so it can be shown right away, and the worker
+	// starts on the ones after it.
+	this->frameBufferBytes = 0;
+	if (isVideo)
+	{
+		std::vector<uint32_t> pixels(width * height);
+		this->frameBufferBytes += pixels.size() * sizeof(uint32_t);
+		MemoryTracker::add(MemoryTag::Cinematics, pixels.size() * sizeof(uint32_t));
+		this->decoder->decodeNextFrame();
+		this->decoder->writePixels(pixels.data(), width);
+		this->updateVideoTexture(pixels.data());
+		this->freeBuffers.push_back(std::move(pixels));
+		this->startDecodeJob();
+	}
+	else
+	{
+		auto &textureManager = game.getTextureManager();
+		this->updateVideoTexture(
+			textureManager.getImages(sequenceName, paletteName).front());
+	}
+
+	this->shownFrameIndex = 0;
+}
+
+CinematicPanel::~CinematicPanel()
+{
+	// The job uses the decoder, so it has to finish before the decoder is destroyed.
+	auto &game = this->getGame();
+	if (this->decodeJob.get() != nullptr)
+	{
+		game.getJobSystem().wait(this->decodeJob);
+	}
+
+	if (this->decoder.get() == nullptr)
+	{
+		game.getTextureManager().unloadSet(this->sequenceName, this->paletteName);
+	}
+
+	MemoryTracker::remove(MemoryTag::Cinematics, this->frameBufferBytes);
+}
+
+void CinematicPanel::startDecodeJob()
+{
+	const int count = CinematicPanel::FRAMES_AHEAD -
+		static_cast<int>(this->decodedFrames.size());
+	if ((this->decodeJob.get() != nullptr) || this->decoderFinished || (count <= 0))
+	{
+		return;
+	}
+
+	FLCDecoder *decoder = this->decoder.get();
+	const int width = decoder->getWidth();
+	const int pixelCount = width * decoder->getHeight();
+
+	auto frames = std::make_shared<std::vector<DecodedFrame>>(count);
+	for (DecodedFrame &frame : *frames)
+	{
+		if (this->freeBuffers.size() > 0)
+		{
+			frame.pixels = std::move(this->freeBuffers.back());
+			this->freeBuffers.pop_back();
+		}
+		else
+		{
+			frame.pixels.resize(pixelCount);
+			this->frameBufferBytes += pixelCount * sizeof(uint32_t);
+			MemoryTracker::add(MemoryTag::Cinematics, pixelCount * sizeof(uint32_t));
+		}
+
+		frame.index = -1;
+	}
+
+	this->jobFrames = frames;
+	this->decodeJob = this->getGame().getJobSystem().add([decoder, frames, width]()
+	{
+		for (DecodedFrame &frame : *frames)
+		{
+			if (!decoder->decodeNextFrame())
+			{
+				break;
+			}
+
+			decoder->writePixels(frame.pixels.data(), width);
+			frame.index = decoder->getFrameIndex();
+		}
+	});
+}
+
+void CinematicPanel::finishDecodeJob(bool wait)
+{
+	if (this->decodeJob.get() == nullptr)
+	{
+		return;
+	}
+
+	auto &jobSystem = this->getGame().getJobSystem();
+	if (!wait && !jobSystem.isDone(this->decodeJob))
+	{
+		return;
+	}
+
+	jobSystem.wait(this->decodeJob);
+
+	for (DecodedFrame &frame : *this->jobFrames)
+	{
+		if (frame.index >= 0)
+		{
+			this->decodedFrames.push_back(std::move(frame));
+		}
+		else
+		{
+			this->decoderFinished = true;
+			this->freeBuffers.push_back(std::move(frame.pixels));
+		}
+	}
+
+	this->decodeJob = nullptr;
+	this->jobFrames = nullptr;
+}
+
+void CinematicPanel::updateVideoTexture(const uint32_t *pixels)
+{
+	const int width = this->videoTexture.getWidth();
+	const int height = this->videoTexture.getHeight();
+
+	void *dst;
+	int pitch;
+	SDL_LockTexture(this->videoTexture.get(), nullptr, &dst, &pitch);
+	for (int y = 0; y < height; y++)
+	{
+		const uint32_t *srcRow = pixels + (y * width);
+		uint32_t *dstRow = reinterpret_cast<uint32_t*>(
+			static_cast<uint8_t*>(dst) + (y * pitch));
+		std::copy(srcRow, srcRow + width, dstRow);
+	}
+
+	SDL_UnlockTexture(this->videoTexture.get());
+}
+
+void CinematicPanel::updateVideoTexture(const IndexedImage &image)
+{
+	DebugAssert((image.getWidth() == this->videoTexture.getWidth()) &&
+		(image.getHeight() == this->videoTexture.getHeight()),
+		"Images in \"" + this->sequenceName + "\" are not all the same size.");
+
+	void *pixels;
+	int pitch;
+	SDL_LockTexture(this->videoTexture.get(), nullptr, &pixels, &pitch);
+	image.writePixels(static_cast<uint32_t*>(pixels),
+		pitch / static_cast<int>(sizeof(uint32_t)));
+	SDL_UnlockTexture(this->videoTexture.get());
 }
 
 void CinematicPanel::handleEvent(const SDL_Event &e)
@@ -50,19 +240,71 @@ void CinematicPanel::tick(double dt)
 		this->imageIndex++;
 	}
 
-	// Get a reference to all images in the sequence.
 	auto &game = this->getGame();
-	auto &renderer = game.getRenderer();
-	auto &textureManager = game.getTextureManager();
-	const auto &textures = textureManager.getTextures(
-		this->sequenceName, this->paletteName, renderer);
 
 	// If at the end, then prepare for the next panel.
-	if (this->imageIndex >= textures.size())
+	if (this->imageIndex >= this->frameCount)
 	{
-		this->imageIndex = static_cast<int>(textures.size() - 1);
+		this->imageIndex = this->frameCount - 1;
 		this->skipButton.click(game);
+		return;
+	}
+
+	if (this->decoder.get() == nullptr)
+	{
+		// Only the shown image is converted from the set's palette indices.
+		if (this->shownFrameIndex != this->imageIndex)
+		{
+			auto &textureManager = game.getTextureManager();
+			const auto &images = textureManager.getImages(
+				this->sequenceName, this->paletteName);
+			this->updateVideoTexture(images.at(this->imageIndex));
+			this->shownFrameIndex = this->imageIndex;
+		}
+
+		return;
+	}
+
+	this->finishDecodeJob(false);
+
+	// Frames can't be shown out of order, so skipped ones are dropped and only the last
+	// one is uploaded.
+	std::vector<uint32_t> shownPixels;
+	bool frameChanged = false;
+	while (this->shownFrameIndex < this->imageIndex)
+	{
+		if (this->decodedFrames.size() == 0)
+		{
+			// The worker fell behind, so wait for it.
+			this->startDecodeJob();
+			if (this->decodeJob.get() == nullptr)
+			{
+				break;
+			}
+
+			this->finishDecodeJob(true);
+			continue;
+		}
+
+		if (frameChanged)
+		{
+			this->freeBuffers.push_back(std::move(shownPixels));
+		}
+
+		DecodedFrame &frame = this->decodedFrames.front();
+		shownPixels = std::move(frame.pixels);
+		this->shownFrameIndex = frame.index;
+		this->decodedFrames.pop_front();
+		frameChanged = true;
 	}
+
+	if (frameChanged)
+	{
+		this->updateVideoTexture(shownPixels.data());
+		this->freeBuffers.push_back(std::move(shownPixels));
+	}
+
+	this->startDecodeJob();
 }
 
 void CinematicPanel::render(Renderer &renderer)
@@ -70,12 +312,5 @@ void CinematicPanel::render(Renderer &renderer)
 	// Clear full screen.
 	renderer.clear();
 
-	// Get a reference to all images in the sequence.
-	auto &textureManager = this->getGame().getTextureManager();
-	const auto &textures = textureManager.getTextures(
-		this->sequenceName, this->paletteName, renderer);
-
-	// Draw image.
-	const auto &texture = textures.at(this->imageIndex);
-	renderer.drawOriginal(texture.get());
+	renderer.drawOriginal(this->videoTexture.get());
 }
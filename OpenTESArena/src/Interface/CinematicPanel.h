@@ -1,31 +1,79 @@
 #ifndef CINEMATIC_PANEL_H
 #define CINEMATIC_PANEL_H
 
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "Button.h"
 #include "Panel.h"
+#include "../Rendering/Texture.h"
+#include "../Utilities/JobSystem.h"
 
 // Designed for sets of images (i.e., videos) that play one after another and
 // eventually lead to another panel. Skipping is available, too.
 
+class FLCDecoder;
 class Game;
+class IndexedImage;
 class Renderer;
 
 class CinematicPanel : public Panel
 {
 private:
+	// A video frame decoded by a worker, as 32-bit pixels.
+	struct DecodedFrame
+	{
+		std::vector<uint32_t> pixels;
+		int index; // -1 if the video ended before this frame.
+	};
+
 	Button<Game&> skipButton;
 	std::string paletteName;
 	std::string sequenceName;
+	std::unique_ptr<FLCDecoder> decoder; // Null if the sequence isn't an FLC or CEL.
+	Texture videoTexture; // Streaming texture that each shown frame is written to.
+
+	// Frames decoded ahead of the shown one, oldest first, and pixel buffers to reuse.
+	std::deque<DecodedFrame> decodedFrames;
+	std::vector<std::vector<uint32_t>> freeBuffers;
+	size_t frameBufferBytes; // Pixel bytes of every frame buffer, for the memory tracker.
+
+	// The job decoding more frames and the frames it writes to. The decoder is only used
+	// by the job while one is running.
+	JobSystem::JobHandle decodeJob;
+	std::shared_ptr<std::vector<DecodedFrame>> jobFrames;
+
 	double secondsPerImage, currentSeconds;
 	int imageIndex;
+	int frameCount;
+	int shownFrameIndex; // Index of the frame in the video texture.
+	bool decoderFinished; // Whether the decoder has reached the last frame.
+
+	// Number of frames decoded ahead of the shown one.
+	static const int FRAMES_AHEAD;
+
+	// Starts a job decoding the next few frames unless one is running, enough are
+	// decoded already, or the video has ended.
+	void startDecodeJob();
+
+	// Takes the running job's frames if it's done, optionally waiting for it first.
+	void finishDecodeJob(bool wait);
+
+	// Writes a frame to the video texture.
+	void updateVideoTexture(const uint32_t *pixels);
+	void updateVideoTexture(const IndexedImage &image);
 public:
+	// FLC and CEL videos are decoded by a worker a few frames ahead of the one being
+	// shown. Other image sets are kept as palette indices while they play, and only the
+	// shown image is converted. Nothing stays cached once the panel is gone.
 	CinematicPanel(Game &game, const std::string &paletteName,
 		const std::string &sequenceName, double secondsPerImage,
 		const std::function<void(Game&)> &endingAction);
-	virtual ~CinematicPanel() = default;
+	virtual ~CinematicPanel();
 
 	virtual void handleEvent(const SDL_Event &e) override;
 	virtual void tick(double dt) override;
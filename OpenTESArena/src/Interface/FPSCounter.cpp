@@ -1,12 +1,72 @@
 #include <algorithm>
 #include <cmath>
+#include <fstream>
 #include <numeric>
 
 #include "FPSCounter.h"
+#include "../Utilities/Debug.h"
+#include "../Utilities/String.h"
+
+const double FPSCounter::HISTOGRAM_BUCKET_MS = 2.0;
+const int FPSCounter::HISTOGRAM_BUCKET_COUNT = 64;
+const int FPSCounter::WINDOW_SIZE = 600;
+const int FPSCounter::MAX_HITCHES = 256;
+const std::string FPSCounter::SUMMARY_FILENAME = "frame-stats.csv";
+const std::string FPSCounter::HISTOGRAM_FILENAME = "frame-histogram.csv";
+const std::string FPSCounter::HITCHES_FILENAME = "frame-hitches.csv";
+
+namespace
+{
+	// Gets the nearest-rank percentile of the times on a copy, since the ring buffers are
+	// in arrival order.
+	double GetPercentile(const std::vector<double> &times, double percent)
+	{
+		if (times.size() == 0)
+		{
+			return 0.0;
+		}
+
+		std::vector<double> sorted(times);
+		const int lastIndex = static_cast<int>(sorted.size()) - 1;
+		const int index = std::max(0, std::min(lastIndex, static_cast<int>(
+			std::ceil((percent / 100.0) * static_cast<double>(sorted.size()))) - 1));
+
+		std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+		return sorted[index];
+	}
+
+	// Adds the time to the ring buffer, replacing the oldest one once it's full.
+	void AddToWindow(std::vector<double> &times, int &index, double time, int windowSize)
+	{
+		if (static_cast<int>(times.size()) < windowSize)
+		{
+			times.push_back(time);
+		}
+		else
+		{
+			times[index] = time;
+			index = (index + 1) % windowSize;
+		}
+	}
+
+	// Gets the time's histogram bucket. The last one counts every longer time too.
+	int GetHistogramBucket(double seconds, double bucketMS, int bucketCount)
+	{
+		return std::min(bucketCount - 1, static_cast<int>((seconds * 1000.0) / bucketMS));
+	}
+}
 
 FPSCounter::FPSCounter()
 {
 	this->frameTimes.fill(0.0);
+	this->histogram = std::vector<int>(FPSCounter::HISTOGRAM_BUCKET_COUNT, 0);
+	this->window.reserve(FPSCounter::WINDOW_SIZE);
+	this->latencyHistogram = std::vector<int>(FPSCounter::HISTOGRAM_BUCKET_COUNT, 0);
+	this->latencyWindow.reserve(FPSCounter::WINDOW_SIZE);
+	this->elapsedTime = 0.0;
+	this->windowIndex = 0;
+	this->latencyWindowIndex = 0;
+	this->summaryStarted = false;
 }
 
 double FPSCounter::getAverageFrameTime() const
@@ -21,6 +81,35 @@ double FPSCounter::getFPS() const
 	return std::isfinite(fps) ? fps : 0.0;
 }
 
+double FPSCounter::getFrameTimeDeviation() const
+{
+	const double average = this->getAverageFrameTime();
+	const double sumSquares = std::accumulate(this->frameTimes.begin(),
+		this->frameTimes.end(), 0.0, [average](double sum, double frameTime)
+	{
+		const double difference = frameTime - average;
+		return sum + (difference * difference);
+	});
+
+	return std::sqrt(sumSquares / static_cast<double>(this->frameTimes.size()));
+}
+
+double FPSCounter::getFrameTimePercentile(double percent) const
+{
+	return GetPercentile(this->window, percent);
+}
+
+double FPSCounter::getInputLatencyPercentile(double percent) const
+{
+	return GetPercentile(this->latencyWindow, percent);
+}
+
+double FPSCounter::getMaxFrameTime() const
+{
+	return (this->window.size() > 0) ?
+		*std::max_element(this->window.begin(), this->window.end()) : 0.0;
+}
+
 void FPSCounter::updateFrameTime(double dt)
 {
 	// Rotate the array right by one index (this puts the last value at the front).
@@ -29,3 +118,108 @@ void FPSCounter::updateFrameTime(double dt)
 
 	this->frameTimes.front() = dt;
 }
+
+void FPSCounter::recordFrameTime(double frameTime, double hitchThreshold,
+	const char *panelName)
+{
+	this->elapsedTime += frameTime;
+
+	const int bucket = GetHistogramBucket(frameTime, FPSCounter::HISTOGRAM_BUCKET_MS,
+		FPSCounter::HISTOGRAM_BUCKET_COUNT);
+	this->histogram.at(bucket)++;
+
+	AddToWindow(this->window, this->windowIndex, frameTime, FPSCounter::WINDOW_SIZE);
+
+	if (frameTime >= hitchThreshold)
+	{
+		if (static_cast<int>(this->hitches.size()) == FPSCounter::MAX_HITCHES)
+		{
+			this->hitches.pop_front();
+		}
+
+		Hitch hitch;
+		hitch.time = this->elapsedTime;
+		hitch.frameTime = frameTime;
+		hitch.panelName = panelName;
+		this->hitches.push_back(std::move(hitch));
+	}
+}
+
+void FPSCounter::recordInputLatency(double latency)
+{
+	const int bucket = GetHistogramBucket(latency, FPSCounter::HISTOGRAM_BUCKET_MS,
+		FPSCounter::HISTOGRAM_BUCKET_COUNT);
+	this->latencyHistogram.at(bucket)++;
+
+	AddToWindow(this->latencyWindow, this->latencyWindowIndex, latency,
+		FPSCounter::WINDOW_SIZE);
+}
+
+void FPSCounter::saveStatistics(const std::string &directory)
+{
+	// The summary is a time series over the whole session, so only its first write
+	// replaces an older file.
+	const std::string summaryFilename(directory + FPSCounter::SUMMARY_FILENAME);
+	std::ofstream summary(summaryFilename, this->summaryStarted ?
+		std::ios::app : std::ios::trunc);
+	if (!summary.is_open())
+	{
+		DebugWarning("Could not open \"" + summaryFilename + "\" for writing.");
+		return;
+	}
+
+	if (!this->summaryStarted)
+	{
+		summary << "time_s,fps,p50_ms,p95_ms,p99_ms,max_ms,hitches," <<
+			"latency_p50_ms,latency_p95_ms" << '\n';
+		this->summaryStarted = true;
+	}
+
+	summary << String::fixedPrecision(this->elapsedTime, 2) << ',' <<
+		String::fixedPrecision(this->getFPS(), 1) << ',' <<
+		String::fixedPrecision(this->getFrameTimePercentile(50.0) * 1000.0, 2) << ',' <<
+		String::fixedPrecision(this->getFrameTimePercentile(95.0) * 1000.0, 2) << ',' <<
+		String::fixedPrecision(this->getFrameTimePercentile(99.0) * 1000.0, 2) << ',' <<
+		String::fixedPrecision(this->getMaxFrameTime() * 1000.0, 2) << ',' <<
+		std::to_string(this->hitches.size()) << ',' <<
+		String::fixedPrecision(this->getInputLatencyPercentile(50.0) * 1000.0, 2) << ',' <<
+		String::fixedPrecision(this->getInputLatencyPercentile(95.0) * 1000.0, 2) << '\n';
+
+	const std::string histogramFilename(directory + FPSCounter::HISTOGRAM_FILENAME);
+	std::ofstream histogram(histogramFilename);
+	if (histogram.is_open())
+	{
+		histogram << "min_ms,max_ms,frames,inputs" << '\n';
+		for (int i = 0; i < FPSCounter::HISTOGRAM_BUCKET_COUNT; i++)
+		{
+			const double minMS = static_cast<double>(i) * FPSCounter::HISTOGRAM_BUCKET_MS;
+			const bool isLast = i == (FPSCounter::HISTOGRAM_BUCKET_COUNT - 1);
+			histogram << String::fixedPrecision(minMS, 1) << ',' <<
+				(isLast ? std::string() : String::fixedPrecision(
+					minMS + FPSCounter::HISTOGRAM_BUCKET_MS, 1)) << ',' <<
+				std::to_string(this->histogram[i]) << ',' <<
+				std::to_string(this->latencyHistogram[i]) << '\n';
+		}
+	}
+	else
+	{
+		DebugWarning("Could not open \"" + histogramFilename + "\" for writing.");
+	}
+
+	const std::string hitchesFilename(directory + FPSCounter::HITCHES_FILENAME);
+	std::ofstream hitches(hitchesFilename);
+	if (hitches.is_open())
+	{
+		hitches << "time_s,frame_ms,panel" << '\n';
+		for (const Hitch &hitch : this->hitches)
+		{
+			hitches << String::fixedPrecision(hitch.time, 2) << ',' <<
+				String::fixedPrecision(hitch.frameTime * 1000.0, 2) << ',' <<
+				hitch.panelName << '\n';
+		}
+	}
+	else
+	{
+		DebugWarning("Could not open \"" + hitchesFilename + "\" for writing.");
+	}
+}
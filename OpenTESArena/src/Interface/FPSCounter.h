@@ -2,11 +2,52 @@
 #define FPS_COUNTER_H
 
 #include <array>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Tracks recent frame times for the frame rate, and keeps longer-running statistics
+// (a histogram, percentiles, and a log of hitches) that can be saved for finding
+// stutters that an average hides. Input latencies (from an input event to the first
+// present that shows it) are kept the same way, so changes to pipelining and pacing can be
+// judged on both.
 
 class FPSCounter
 {
 private:
+	// A frame that took longer than the hitch threshold.
+	struct Hitch
+	{
+		double time; // Seconds since the counter started.
+		double frameTime;
+		const char *panelName; // Static storage, like a type name.
+	};
+
+	// Width of a histogram bucket in milliseconds, and the number of buckets. The last
+	// bucket also counts every frame longer than the others cover.
+	static const double HISTOGRAM_BUCKET_MS;
+	static const int HISTOGRAM_BUCKET_COUNT;
+
+	// Number of frame times the percentiles are calculated from.
+	static const int WINDOW_SIZE;
+
+	// Max number of hitches kept. The oldest ones are dropped first.
+	static const int MAX_HITCHES;
+
+	// Filenames of the saved statistics.
+	static const std::string SUMMARY_FILENAME;
+	static const std::string HISTOGRAM_FILENAME;
+	static const std::string HITCHES_FILENAME;
+
 	std::array<double, 20> frameTimes;
+	std::vector<int> histogram;
+	std::vector<double> window; // Ring buffer of frame times.
+	std::vector<int> latencyHistogram;
+	std::vector<double> latencyWindow; // Ring buffer of input latencies.
+	std::deque<Hitch> hitches;
+	double elapsedTime;
+	int windowIndex, latencyWindowIndex;
+	bool summaryStarted; // Whether the summary file has its header this session.
 
 	// Calculates average frame time based on previous frames.
 	double getAverageFrameTime() const;
@@ -16,9 +57,37 @@ public:
 	// Gets the average frames per second based on recent data.
 	double getFPS() const;
 
+	// Gets the standard deviation of recent frame times in seconds. Uneven frame pacing
+	// shows up here even when the average frame rate looks fine.
+	double getFrameTimeDeviation() const;
+
+	// Gets the frame time in seconds that the given percent (between 0 and 100) of
+	// frames in the sliding window are at or under.
+	double getFrameTimePercentile(double percent) const;
+
+	// Gets the input latency in seconds that the given percent of recent inputs are at or
+	// under.
+	double getInputLatencyPercentile(double percent) const;
+
+	// Gets the longest frame time in seconds in the sliding window.
+	double getMaxFrameTime() const;
+
 	// Sets the frame time of the most recent frame. This should be called once
 	// per frame.
 	void updateFrameTime(double dt);
+
+	// Adds the unclamped time of the most recent frame to the statistics. Frames of at
+	// least the hitch threshold (in seconds) are logged along with the given name of the
+	// panel that was active, which must outlive the counter (i.e., a type name or a string
+	// literal). This should be called once per frame.
+	void recordFrameTime(double frameTime, double hitchThreshold, const char *panelName);
+
+	// Adds the seconds from an input to the present that showed it to the statistics.
+	void recordInputLatency(double latency);
+
+	// Writes the statistics as CSV files to the given directory. The summary file gets a
+	// row appended each time, and the histogram and hitch files are overwritten.
+	void saveStatistics(const std::string &directory);
 };
 
 #endif
@@ -21,6 +21,8 @@
 #include "../Assets/MiscAssets.h"
 #include "../Entities/CharacterClass.h"
 #include "../Entities/Entity.h"
+#include "../Entities/EntityType.h"
+#include "../Entities/EntityWorldView.h"
 #include "../Entities/Player.h"
 #include "../Game/CardinalDirection.h"
 #include "../Game/CardinalDirectionName.h"
@@ -28,6 +30,7 @@
 #include "../Game/Game.h"
 #include "../Game/Options.h"
 #include "../Game/PlayerInterface.h"
+#include "../Game/SaveGame.h"
 #include "../Math/Constants.h"
 #include "../Math/Random.h"
 #include "../Math/Vector2.h"
@@ -45,15 +48,20 @@
 #include "../Media/TextureManager.h"
 #include "../Media/TextureName.h"
 #include "../Rendering/Renderer.h"
+#include "../Rendering/SpanShading.h"
 #include "../Rendering/Surface.h"
 #include "../Rendering/Texture.h"
+#include "../Utilities/AllocationCounter.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/MemoryTracker.h"
+#include "../Utilities/Platform.h"
 #include "../Utilities/String.h"
 #include "../World/Location.h"
 #include "../World/LocationDataType.h"
 #include "../World/LocationType.h"
 #include "../World/VoxelData.h"
 #include "../World/VoxelDataType.h"
+#include "../World/VoxelRayQuery.h"
 #include "../World/WorldType.h"
 
 namespace
@@ -80,6 +88,44 @@ namespace
 	const Color EffectTextColor(251, 239, 77);
 	const Color EffectTextShadowColor(190, 113, 0);
 
+	// Length of a game world simulation step. The game world is simulated at this rate 
+	// regardless of the frame rate.
+	const double SimulationStepSeconds = 1.0 / 60.0;
+
+	// How close in voxels the player must be to a level up/down voxel before the level
+	// past it starts loading its textures.
+	const int LevelPrefetchDistance = 4;
+
+	// Number of entities of one type ticked together by a worker. Large enough that job
+	// overhead doesn't outweigh cheap ticks like doodad animations.
+	const int EntityTickBatchSize = 64;
+
+	// Entities tick at a rate from their update tier. Entities within the full tick distance
+	// of the player tick every step, and the rest tick every few steps. Ones that are also
+	// out of view and past the coarse distance tick rarely. A tick gets all the time since
+	// the entity's last one, so it ends up in the same state. The coarse interval must be a
+	// multiple of the reduced one.
+	enum class EntityUpdateTier { Full, Reduced, Coarse };
+	const double EntityFullTickDistance = 12.0;
+	const double EntityCoarseTickDistance = 32.0;
+	const int EntityReducedTickInterval = 4;
+	const int EntityCoarseTickInterval = 16;
+
+	// Angle past the sides of the view that still counts as in view for update tiers, so
+	// flats partly on-screen and turning around a little don't make entities pop.
+	const double EntityViewMarginDegrees = 15.0;
+
+	// How far away the player can open a door from.
+	const double DoorReachDistance = 1.50;
+
+	// Number of steps the day is split into for deciding whether the game world needs 
+	// rendering again. Ambient light and the sky change too little within one step to see.
+	const double WorldFrameDaytimeSteps = 4096.0;
+
+	// Number of steps the colors of wet and lava chasms cycle by in a day, which is about
+	// eight a second at the game's usual time scale.
+	const double LiquidCycleDaySteps = 1920.0;
+
 	// Arrow cursor alignments. These offset the drawn cursor relative to the mouse 
 	// position so the cursor's click area is closer to the tip of each arrow, as is 
 	// done in the original game (slightly differently, though. I think the middle 
@@ -96,6 +142,73 @@ namespace
 		CursorAlignment::Bottom,
 		CursorAlignment::Right
 	};
+
+	// Appends pieces of debug text to a frame string. Numbers are formatted into small
+	// temporary strings first, which don't allocate with the small string optimization.
+	void AppendPiece(FrameString &text, const char *str)
+	{
+		text.append(str);
+	}
+
+	void AppendPiece(FrameString &text, const std::string &str)
+	{
+		text.append(str.data(), str.size());
+	}
+
+	template <typename... Args>
+	void AppendText(FrameString &text, const Args&... args)
+	{
+		// Appends each argument in order.
+		const int pieces[] = { (AppendPiece(text, args), 0)... };
+		static_cast<void>(pieces);
+	}
+
+	// Gets an entity's update tier from its offset from the player, the player's unit XZ
+	// direction, and the cosine of the angle from it that's still in view.
+	EntityUpdateTier GetEntityUpdateTier(const Double3 &offset, const Double2 &viewDirection,
+		double viewCos)
+	{
+		const Double2 offsetXZ(offset.x, offset.z);
+		const double distanceSquared = offsetXZ.lengthSquared();
+		if (distanceSquared < (EntityFullTickDistance * EntityFullTickDistance))
+		{
+			return EntityUpdateTier::Full;
+		}
+		else if (distanceSquared < (EntityCoarseTickDistance * EntityCoarseTickDistance))
+		{
+			return EntityUpdateTier::Reduced;
+		}
+
+		// Compared without dividing by the distance, which is known to be positive here.
+		const bool inView = offsetXZ.dot(viewDirection) >= (viewCos * std::sqrt(distanceSquared));
+		return inView ? EntityUpdateTier::Reduced : EntityUpdateTier::Coarse;
+	}
+}
+
+bool GameWorldPanel::WorldFrameKey::operator==(const WorldFrameKey &other) const
+{
+	return (this->position == other.position) && (this->direction == other.direction) &&
+		(this->ceilingHeight == other.ceilingHeight) && (this->voxelGrid == other.voxelGrid) &&
+		(this->daytimeStep == other.daytimeStep) &&
+		(this->voxelRevision == other.voxelRevision) &&
+		(this->rendererRevision == other.rendererRevision) &&
+		(this->optionsRevision == other.optionsRevision);
+}
+
+bool GameWorldPanel::InterfaceLayerKey::operator==(const InterfaceLayerKey &other) const
+{
+	return (this->interfaceTexture == other.interfaceTexture) &&
+		(this->statusTexture == other.statusTexture) &&
+		(this->portraitTexture == other.portraitTexture) &&
+		(this->noSpellTexture == other.noSpellTexture) &&
+		(this->playerNameTexture == other.playerNameTexture);
+}
+
+bool GameWorldPanel::CompassLayerKey::operator==(const CompassLayerKey &other) const
+{
+	return (this->sliderTexture == other.sliderTexture) &&
+		(this->frameTexture == other.frameTexture) &&
+		(this->sliderOffset == other.sliderOffset);
 }
 
 GameWorldPanel::GameWorldPanel(Game &game)
@@ -103,6 +216,43 @@ GameWorldPanel::GameWorldPanel(Game &game)
 {
 	assert(game.gameDataIsActive());
 
+	this->worldFrameRendered = false;
+	this->showMemoryReport = false;
+	this->simulationTime = 0.0;
+	this->entityTierCounts.fill(0);
+	this->entityTickStep = 0;
+
+	// Interface images are always drawn with the default palette.
+	auto &textureManager = game.getTextureManager();
+	const std::string &defaultPalette = PaletteFile::fromName(PaletteName::Default);
+	this->gameWorldInterfaceHandle = textureManager.getImageHandle(
+		TextureFile::fromName(TextureName::GameWorldInterface), defaultPalette);
+	this->compassSliderHandle = textureManager.getImageHandle(
+		TextureFile::fromName(TextureName::CompassSlider), defaultPalette);
+	this->compassFrameHandle = textureManager.getImageHandle(
+		TextureFile::fromName(TextureName::CompassFrame), defaultPalette);
+	this->noSpellHandle = textureManager.getImageHandle(
+		TextureFile::fromName(TextureName::NoSpell), defaultPalette);
+
+	// Decode them in the background so the first frame doesn't have to, and keep them
+	// loaded since they're drawn every frame.
+	for (const int handle : { this->gameWorldInterfaceHandle, this->compassSliderHandle,
+		this->compassFrameHandle, this->noSpellHandle })
+	{
+		textureManager.prefetch(handle);
+		textureManager.setPinned(handle, true);
+	}
+	this->previousPlayerPosition = game.getGameData().getPlayer().getPosition();
+
+	auto &audioManager = game.getAudioManager();
+	this->swishSoundID = audioManager.getSoundID(SoundFile::fromName(SoundName::Swish));
+	this->arrowFireSoundID = audioManager.getSoundID(SoundFile::fromName(SoundName::ArrowFire));
+
+	// Attacks are played often and should never wait on decoding.
+	audioManager.setSoundPinned(this->swishSoundID, true);
+	audioManager.setSoundPinned(this->arrowFireSoundID, true);
+	this->preloadSounds();
+
 	this->playerNameTextBox = [&game]()
 	{
 		const int x = 17;
@@ -122,7 +272,7 @@ GameWorldPanel::GameWorldPanel(Game &game)
 	{
 		auto function = [](Game &game)
 		{
-			game.setPanel<CharacterPanel>(game);
+			game.setPooledPanel<CharacterPanel>(game);
 		};
 		return Button<Game&>(14, 166, 40, 29, function);
 	}();
@@ -231,13 +381,13 @@ GameWorldPanel::GameWorldPanel(Game &game)
 					}();
 
 					const std::string &timeOfDayString =
-						exeData.calendar.timesOfDay.at(timeOfDayIndex);
+						exeData.getCalendar().timesOfDay.at(timeOfDayIndex);
 
 					return clockTimeString + " " + timeOfDayString;
 				}();
 
 				// Get the base status text.
-				std::string baseText = exeData.status.popUp;
+				std::string baseText = exeData.getStatus().popUp;
 
 				// Replace carriage returns with newlines.
 				baseText = String::replace(baseText, '\r', '\n');
@@ -255,14 +405,14 @@ GameWorldPanel::GameWorldPanel(Game &game)
 				const auto &date = gameData.getDate();
 				const std::string dateString = [&exeData, &date]()
 				{
-					std::string text = exeData.status.date;
+					std::string text = exeData.getStatus().date;
 
 					// Replace carriage returns with newlines.
 					text = String::replace(text, '\r', '\n');
 
 					// Replace first %s with weekday.
 					const std::string &weekdayString =
-						exeData.calendar.weekdayNames.at(date.getWeekday());
+						exeData.getCalendar().weekdayNames.at(date.getWeekday());
 					size_t index = text.find("%s");
 					text = text.replace(index, 2, weekdayString);
 
@@ -273,7 +423,7 @@ GameWorldPanel::GameWorldPanel(Game &game)
 
 					// Replace third %s with month.
 					const std::string &monthString =
-						exeData.calendar.monthNames.at(date.getMonth());
+						exeData.getCalendar().monthNames.at(date.getMonth());
 					index = text.find("%s");
 					text = text.replace(index, 2, monthString);
 
@@ -299,13 +449,13 @@ GameWorldPanel::GameWorldPanel(Game &game)
 				// Append the list of effects at the bottom (healthy/diseased...).
 				const std::string effectText = [&exeData]()
 				{
-					std::string text = exeData.status.effect;
+					std::string text = exeData.getStatus().effect;
 
 					// Replace carriage returns with newlines.
 					text = String::replace(text, '\r', '\n');
 
 					// Replace %s with placeholder.
-					const std::string &effectStr = exeData.status.effectsList.front();
+					const std::string &effectStr = exeData.getStatus().effectsList.front();
 					size_t index = text.find("%s");
 					text = text.replace(index, 2, effectStr);
 
@@ -361,7 +511,7 @@ GameWorldPanel::GameWorldPanel(Game &game)
 	{
 		auto function = [](Game &game)
 		{
-			game.setPanel<LogbookPanel>(game);
+			game.setPooledPanel<LogbookPanel>(game);
 		};
 		return Button<Game&>(118, 175, 29, 22, function);
 	}();
@@ -415,7 +565,7 @@ GameWorldPanel::GameWorldPanel(Game &game)
 	{
 		auto function = [](Game &game)
 		{
-			game.setPanel<PauseMenuPanel>(game);
+			game.setPooledPanel<PauseMenuPanel>(game);
 		};
 		return Button<Game&>(function);
 	}();
@@ -428,8 +578,8 @@ GameWorldPanel::GameWorldPanel(Game &game)
 			{
 				auto &gameData = game.getGameData();
 				const auto &exeData = game.getMiscAssets().getExeData();
-				const auto &worldData = gameData.getWorldData();
-				const auto &level = worldData.getLevels().at(worldData.getCurrentLevel());
+				auto &worldData = gameData.getWorldData();
+				auto &level = worldData.getActiveLevel();
 				const auto &player = gameData.getPlayer();
 				const Location &location = gameData.getLocation();
 				const Double3 &position = player.getPosition();
@@ -461,7 +611,7 @@ GameWorldPanel::GameWorldPanel(Game &game)
 				}();
 
 				game.setPanel<AutomapPanel>(game, Double2(position.x, position.z), 
-					player.getGroundDirection(), level.getVoxelGrid(), automapLocationName);
+					player.getGroundDirection(), level, automapLocationName);
 			}
 			else
 			{
@@ -484,7 +634,7 @@ GameWorldPanel::GameWorldPanel(Game &game)
 	if (!weaponAnimation.isRanged())
 	{
 		// Melee weapon offsets.
-		const CIFFile cifFile(weaponFilename, Palette());
+		const CIFFile cifFile(weaponFilename);
 
 		for (int i = 0; i < cifFile.getImageCount(); i++)
 		{
@@ -494,7 +644,7 @@ GameWorldPanel::GameWorldPanel(Game &game)
 	else
 	{
 		// Ranged weapon offsets.
-		const CFAFile cfaFile(weaponFilename, Palette());
+		const CFAFile cfaFile(weaponFilename);
 
 		for (int i = 0; i < cfaFile.getImageCount(); i++)
 		{
@@ -546,7 +696,12 @@ void GameWorldPanel::handleEvent(const SDL_Event &e)
 	auto &player = game.getGameData().getPlayer();
 	const auto &inputManager = game.getInputManager();
 	bool escapePressed = inputManager.keyPressed(e, SDLK_ESCAPE);
+	bool f3Pressed = inputManager.keyPressed(e, SDLK_F3);
 	bool f4Pressed = inputManager.keyPressed(e, SDLK_F4);
+	bool f5Pressed = inputManager.keyPressed(e, SDLK_F5);
+	bool quicksavePressed = inputManager.keyPressed(e, SDLK_F6);
+	bool f7Pressed = inputManager.keyPressed(e, SDLK_F7);
+	bool quickloadPressed = inputManager.keyPressed(e, SDLK_F9);
 
 	if (escapePressed)
 	{
@@ -557,6 +712,69 @@ void GameWorldPanel::handleEvent(const SDL_Event &e)
 		// Toggle debug display.
 		options.setShowDebug(!options.getShowDebug());
 	}
+	else if (f5Pressed && options.getShowDebug())
+	{
+		// Switch between the general debug text and the memory report.
+		this->showMemoryReport = !this->showMemoryReport;
+	}
+	else if (quicksavePressed)
+	{
+		// The state is copied now and written in the background.
+		SaveGame::save(game.getGameData(),
+			Platform::getOptionsPath() + SaveGame::QUICKSAVE_FILENAME, game.getJobSystem());
+	}
+	else if (quickloadPressed)
+	{
+		SaveGame::load(Platform::getOptionsPath() + SaveGame::QUICKSAVE_FILENAME, game);
+	}
+	else if (f3Pressed && options.getShowDebug())
+	{
+		// Cycle through the 3D renderer's occlusion modes, for checking that culling 
+		// matches the depth-tested output.
+		auto &renderer = game.getRenderer();
+		const SoftwareRenderer::OcclusionMode occlusionMode = [&renderer]()
+		{
+			const SoftwareRenderer::OcclusionMode currentMode = renderer.getOcclusionMode();
+			if (currentMode == SoftwareRenderer::OcclusionMode::Culling)
+			{
+				return SoftwareRenderer::OcclusionMode::Compare;
+			}
+			else if (currentMode == SoftwareRenderer::OcclusionMode::Compare)
+			{
+				return SoftwareRenderer::OcclusionMode::DepthTest;
+			}
+			else
+			{
+				return SoftwareRenderer::OcclusionMode::Culling;
+			}
+		}();
+
+		renderer.setOcclusionMode(occlusionMode);
+	}
+	else if (f7Pressed && options.getShowDebug())
+	{
+		// Cycle through the 3D renderer's cost heatmaps, for finding expensive columns
+		// and overdraw.
+		auto &renderer = game.getRenderer();
+		const SoftwareRenderer::CostView costView = [&renderer]()
+		{
+			const SoftwareRenderer::CostView currentView = renderer.getCostView();
+			if (currentView == SoftwareRenderer::CostView::Off)
+			{
+				return SoftwareRenderer::CostView::Columns;
+			}
+			else if (currentView == SoftwareRenderer::CostView::Columns)
+			{
+				return SoftwareRenderer::CostView::Overdraw;
+			}
+			else
+			{
+				return SoftwareRenderer::CostView::Off;
+			}
+		}();
+
+		renderer.setCostView(costView);
+	}
 
 	// Listen for hotkeys.
 	bool drawWeaponHotkeyPressed = inputManager.keyPressed(e, SDLK_f);
@@ -606,7 +824,7 @@ void GameWorldPanel::handleEvent(const SDL_Event &e)
 		// Refresh player coordinates display (probably intended for debugging in the
 		// original game). These coordinates are in Arena's coordinate system.
 		const auto &worldData = game.getGameData().getWorldData();
-		const auto &voxelGrid = worldData.getLevels().at(0).getVoxelGrid();
+		const auto &voxelGrid = worldData.getActiveLevel().getVoxelGrid();
 		const Int2 originalVoxel = VoxelGrid::getTransformedCoordinate(
 			Int2(player.getVoxelPosition().x, player.getVoxelPosition().z),
 			voxelGrid.getWidth(), voxelGrid.getDepth());
@@ -690,8 +908,11 @@ void GameWorldPanel::handleEvent(const SDL_Event &e)
 			{
 				this->campButton.click();
 			}
-
-			// Later... any entities in the world clicked?
+			else if (originalPosition.y < (Renderer::ORIGINAL_HEIGHT - 53))
+			{
+				// Later... any entities in the world clicked?
+				this->openDoorInFront();
+			}
 		}
 		else if (rightClick)
 		{
@@ -701,6 +922,35 @@ void GameWorldPanel::handleEvent(const SDL_Event &e)
 			}
 		}
 	}
+	else if (leftClick)
+	{
+		// The cursor is always in the middle of the screen.
+		this->openDoorInFront();
+	}
+}
+
+bool GameWorldPanel::isPoolable() const
+{
+	// Its interface layers are window-sized render targets, so keeping it saves the most.
+	return true;
+}
+
+size_t GameWorldPanel::getPooledBytes() const
+{
+	return this->playerNameTextBox->getBytes() + this->interfaceLayer.getBytes() +
+		this->compassLayer.getBytes();
+}
+
+void GameWorldPanel::resume()
+{
+	// The game went on without the panel, so nothing from its last frame carries over.
+	auto &player = this->getGame().getGameData().getPlayer();
+	this->previousPlayerPosition = player.getPosition();
+	this->resetFlatInterpolation();
+	this->simulationTime = 0.0;
+	this->worldFrameRendered = false;
+	this->interfaceLayer.invalidate();
+	this->compassLayer.invalidate();
 }
 
 void GameWorldPanel::resize(int windowWidth, int windowHeight)
@@ -720,7 +970,7 @@ void GameWorldPanel::handlePlayerTurning(double dt, const Int2 &mouseDelta)
 	// get the swing direction and swing.
 	const auto &inputManager = this->getGame().getInputManager();
 
-	const bool modernInterface = this->getGame().getOptions().getModernInterface();
+	const bool modernInterface = this->getGame().getOptions().getSnapshot().modernInterface;
 	if (!modernInterface)
 	{
 		// Classic interface mode.
@@ -730,7 +980,7 @@ void GameWorldPanel::handlePlayerTurning(double dt, const Int2 &mouseDelta)
 		// Holding the LMB in the left, right, upper left, or upper right parts of the
 		// screen turns the player. A and D turn the player as well.
 
-		const auto &options = this->getGame().getOptions();
+		const OptionsSnapshot &options = this->getGame().getOptions().getSnapshot();
 		auto &player = this->getGame().getGameData().getPlayer();
 
 		// Listen for LMB, A, or D. Don't turn if Ctrl is held.
@@ -785,8 +1035,8 @@ void GameWorldPanel::handlePlayerTurning(double dt, const Int2 &mouseDelta)
 			// Yaw the camera left or right. No vertical movement in classic camera mode.
 			// Multiply turning speed by delta time so it behaves correctly with different
 			// frame rates.
-			player.rotate(dx * dt, 0.0, options.getHorizontalSensitivity(),
-				options.getVerticalSensitivity());
+			player.rotate(dx * dt, 0.0, options.horizontalSensitivity,
+				options.verticalSensitivity);
 		}
 		else if (!lCtrl)
 		{
@@ -797,14 +1047,14 @@ void GameWorldPanel::handlePlayerTurning(double dt, const Int2 &mouseDelta)
 			if (left)
 			{
 				// Turn left at a fixed angular velocity.
-				player.rotate(-turnSpeed * dt, 0.0, options.getHorizontalSensitivity(),
-					options.getVerticalSensitivity());
+				player.rotate(-turnSpeed * dt, 0.0, options.horizontalSensitivity,
+					options.verticalSensitivity);
 			}
 			else if (right)
 			{
 				// Turn right at a fixed angular velocity.
-				player.rotate(turnSpeed * dt, 0.0, options.getHorizontalSensitivity(),
-					options.getVerticalSensitivity());
+				player.rotate(turnSpeed * dt, 0.0, options.horizontalSensitivity,
+					options.verticalSensitivity);
 			}
 		}
 	}
@@ -813,31 +1063,56 @@ void GameWorldPanel::handlePlayerTurning(double dt, const Int2 &mouseDelta)
 		// Modern interface. Make the camera look around.
 		// - Relative mouse state isn't called because it can only be called once per frame,
 		//   and its value is used in multiple places.
-		const int dx = mouseDelta.x;
-		const int dy = mouseDelta.y;
+		// - Motion already applied by late mouse look last frame is left out.
+		this->handleMouseLook(mouseDelta - inputManager.getLatchedMouseDelta());
+	}
+}
 
-		bool leftClick = inputManager.mouseButtonIsDown(SDL_BUTTON_LEFT);
-		bool turning = ((dx != 0) || (dy != 0)) && leftClick;
+void GameWorldPanel::handleMouseLook(const Int2 &mouseDelta)
+{
+	const auto &inputManager = this->getGame().getInputManager();
+	const int dx = mouseDelta.x;
+	const int dy = mouseDelta.y;
 
-		if (turning)
-		{
-			const Int2 dimensions = this->getGame().getRenderer().getWindowDimensions();
+	bool leftClick = inputManager.mouseButtonIsDown(SDL_BUTTON_LEFT);
+	bool turning = ((dx != 0) || (dy != 0)) && leftClick;
 
-			// Get the smaller of the two dimensions, so the look sensitivity is relative 
-			// to a square instead of a rectangle. This keeps the camera look independent 
-			// of the aspect ratio.
-			const int minDimension = std::min(dimensions.x, dimensions.y);
+	if (turning)
+	{
+		const Int2 dimensions = this->getGame().getRenderer().getWindowDimensions();
 
-			double dxx = static_cast<double>(dx) / static_cast<double>(minDimension);
-			double dyy = static_cast<double>(dy) / static_cast<double>(minDimension);
+		// Get the smaller of the two dimensions, so the look sensitivity is relative 
+		// to a square instead of a rectangle. This keeps the camera look independent 
+		// of the aspect ratio.
+		const int minDimension = std::min(dimensions.x, dimensions.y);
 
-			// Pitch and/or yaw the camera.
-			const auto &options = this->getGame().getOptions();
-			auto &player = this->getGame().getGameData().getPlayer();
-			player.rotate(dxx, -dyy, options.getHorizontalSensitivity(),
-				options.getVerticalSensitivity());
-		}
+		double dxx = static_cast<double>(dx) / static_cast<double>(minDimension);
+		double dyy = static_cast<double>(dy) / static_cast<double>(minDimension);
+
+		// Pitch and/or yaw the camera.
+		const OptionsSnapshot &options = this->getGame().getOptions().getSnapshot();
+		auto &player = this->getGame().getGameData().getPlayer();
+		player.rotate(dxx, -dyy, options.horizontalSensitivity,
+			options.verticalSensitivity);
+	}
+}
+
+void GameWorldPanel::handleLateMouseLook()
+{
+	const OptionsSnapshot &options = this->getGame().getOptions().getSnapshot();
+	if (!options.lateMouseLook || !options.modernInterface)
+	{
+		return;
 	}
+
+	// The tick can take a while at low frame rates, so the motion during it is applied
+	// now instead of next frame. The next tick skips it.
+	auto &inputManager = this->getGame().getInputManager();
+	this->handleMouseLook(inputManager.latchMouseDelta());
+
+	// The latched motion is likely newer than the tick's input.
+	this->getGame().getRenderer().setFrameInput(inputManager.getInputTime(),
+		inputManager.inputWasPressed());
 }
 
 void GameWorldPanel::handlePlayerMovement(double dt)
@@ -854,7 +1129,7 @@ void GameWorldPanel::handlePlayerMovement(double dt)
 
 	const auto &worldData = this->getGame().getGameData().getWorldData();
 
-	const bool modernInterface = this->getGame().getOptions().getModernInterface();
+	const bool modernInterface = this->getGame().getOptions().getSnapshot().modernInterface;
 	if (!modernInterface)
 	{
 		// Classic interface mode.
@@ -1167,7 +1442,7 @@ void GameWorldPanel::handlePlayerAttack(const Int2 &mouseDelta)
 				}
 
 				// Play the swing sound.
-				audioManager.playSound(SoundFile::fromName(SoundName::Swish));
+				audioManager.playSound(this->swishSoundID, AudioManager::DEFAULT_PRIORITY + 1);
 			}
 		}
 		else
@@ -1210,7 +1485,8 @@ void GameWorldPanel::handlePlayerAttack(const Int2 &mouseDelta)
 				weaponAnimation.setState(WeaponAnimation::State::Firing);
 
 				// Play the firing sound.
-				audioManager.playSound(SoundFile::fromName(SoundName::ArrowFire));
+				audioManager.playSound(this->arrowFireSoundID,
+					AudioManager::DEFAULT_PRIORITY + 1);
 			}
 		}
 	}	
@@ -1220,7 +1496,7 @@ void GameWorldPanel::handleTriggers(const Int2 &voxel)
 {
 	auto &game = this->getGame();
 	auto &worldData = game.getGameData().getWorldData();
-	auto &level = worldData.getLevels().at(worldData.getCurrentLevel());
+	auto &level = worldData.getActiveLevel();
 
 	// See if there's a text trigger.
 	LevelData::TextTrigger *textTrigger = level.getTextTrigger(voxel);
@@ -1265,7 +1541,7 @@ void GameWorldPanel::handleTriggers(const Int2 &voxel)
 
 			// Set the text trigger as activated (regardless of whether or not it's single-shot,
 			// just for consistency).
-			textTrigger->setPreviouslyDisplayed(true);
+			level.setTextTriggerDisplayed(voxel);
 		}
 	}
 
@@ -1284,7 +1560,7 @@ void GameWorldPanel::handleLevelTransition(const Int2 &playerVoxel, const Int2 &
 	auto &game = this->getGame();
 	auto &gameData = game.getGameData();
 	auto &worldData = game.getGameData().getWorldData();
-	const auto &level = worldData.getLevels().at(worldData.getCurrentLevel());
+	const auto &level = worldData.getActiveLevel();
 	const auto &voxelGrid = level.getVoxelGrid();
 
 	// Get the voxel data associated with the voxel.
@@ -1295,8 +1571,7 @@ void GameWorldPanel::handleLevelTransition(const Int2 &playerVoxel, const Int2 &
 			const int x = transitionVoxel.x;
 			const int y = 1;
 			const int z = transitionVoxel.y;
-			return voxelGrid.getVoxels()[x + (y * voxelGrid.getWidth()) +
-				(z * voxelGrid.getWidth() * voxelGrid.getHeight())];
+			return voxelGrid.getVoxel(x, y, z);
 		}();
 
 		return voxelGrid.getVoxelData(voxelID);
@@ -1374,6 +1649,7 @@ void GameWorldPanel::handleLevelTransition(const Int2 &playerVoxel, const Int2 &
 			{
 				worldData.setLevelActive(worldData.getCurrentLevel() - 1,
 					game.getTextureManager(), game.getRenderer());
+				worldData.packInactiveLevels(game.getJobSystem());
 
 				player.teleport(destinationPoint);
 				player.lookAt(player.getPosition() + dirToNewVoxel);
@@ -1386,6 +1662,7 @@ void GameWorldPanel::handleLevelTransition(const Int2 &playerVoxel, const Int2 &
 		{
 			worldData.setLevelActive(worldData.getCurrentLevel() + 1,
 				game.getTextureManager(), game.getRenderer());
+			worldData.packInactiveLevels(game.getJobSystem());
 
 			player.teleport(destinationPoint);
 			player.lookAt(player.getPosition() + dirToNewVoxel);
@@ -1394,6 +1671,75 @@ void GameWorldPanel::handleLevelTransition(const Int2 &playerVoxel, const Int2 &
 	}
 }
 
+void GameWorldPanel::preloadSounds()
+{
+	auto &game = this->getGame();
+	const auto &worldData = game.getGameData().getWorldData();
+
+	std::vector<std::string> filenames =
+	{
+		SoundFile::fromName(SoundName::Swish),
+		SoundFile::fromName(SoundName::ArrowFire)
+	};
+
+	// Levels that haven't been generated yet get theirs when they become active.
+	for (int i = 0; i < worldData.getLevelCount(); i++)
+	{
+		const LevelData *level = worldData.findLevel(i);
+		if (level != nullptr)
+		{
+			for (const auto &pair : level->getSoundTriggers())
+			{
+				filenames.push_back(pair.second);
+			}
+		}
+	}
+
+	// Duplicates and already loaded sounds are skipped by the audio manager.
+	game.getAudioManager().preloadSounds(filenames, game.getJobSystem());
+}
+
+void GameWorldPanel::prefetchNearbyLevels(const Int2 &playerVoxel)
+{
+	auto &game = this->getGame();
+	auto &gameData = game.getGameData();
+	auto &worldData = gameData.getWorldData();
+	const int currentLevel = worldData.getCurrentLevel();
+	const auto &voxelGrid = worldData.getActiveLevel().getVoxelGrid();
+
+	const int startX = std::max(playerVoxel.x - LevelPrefetchDistance, 0);
+	const int endX = std::min(playerVoxel.x + LevelPrefetchDistance, voxelGrid.getWidth() - 1);
+	const int startZ = std::max(playerVoxel.y - LevelPrefetchDistance, 0);
+	const int endZ = std::min(playerVoxel.y + LevelPrefetchDistance, voxelGrid.getDepth() - 1);
+
+	for (int z = startZ; z <= endZ; z++)
+	{
+		for (int x = startX; x <= endX; x++)
+		{
+			const VoxelData &voxelData = voxelGrid.getVoxelData(voxelGrid.getVoxel(x, 1, z));
+			if (voxelData.dataType != VoxelDataType::Wall)
+			{
+				continue;
+			}
+
+			// Level up voxels with a custom function don't go to another level of this
+			// world, so there's nothing to prepare for them here.
+			const VoxelData::WallData::Type type = voxelData.wall.type;
+			if ((type == VoxelData::WallData::Type::LevelUp) &&
+				!gameData.getOnLevelUpVoxelEnter())
+			{
+				worldData.prefetchLevel(currentLevel - 1, game.getTextureManager(),
+					game.getJobSystem());
+			}
+			else if (type == VoxelData::WallData::Type::LevelDown)
+			{
+				worldData.prefetchLevel(currentLevel + 1, game.getTextureManager(),
+					game.getJobSystem());
+			}
+		}
+	}
+}
+
 void GameWorldPanel::drawTooltip(const std::string &text, Renderer &renderer)
 {
 	const Texture tooltip(Panel::createTooltip(
@@ -1401,7 +1747,7 @@ void GameWorldPanel::drawTooltip(const std::string &text, Renderer &renderer)
 
 	auto &textureManager = this->getGame().getTextureManager();
 	const auto &gameInterface = textureManager.getTexture(
-		TextureFile::fromName(TextureName::GameWorldInterface), renderer);
+		this->gameWorldInterfaceHandle, renderer);
 
 	renderer.drawOriginal(tooltip.get(), 0, Renderer::ORIGINAL_HEIGHT -
 		gameInterface.getHeight() - tooltip.getHeight());
@@ -1412,7 +1758,9 @@ void GameWorldPanel::drawCompass(const Double2 &direction,
 {
 	// Draw compass slider based on player direction. +X is north, +Z is east.
 	const auto &compassSlider = textureManager.getTexture(
-		TextureFile::fromName(TextureName::CompassSlider), renderer);
+		this->compassSliderHandle, renderer);
+	const auto &compassFrame = textureManager.getTexture(
+		this->compassFrameHandle, renderer);
 
 	// Angle between 0 and 2 pi.
 	const double angle = std::atan2(direction.y, direction.x);
@@ -1430,18 +1778,141 @@ void GameWorldPanel::drawCompass(const Double2 &direction,
 	const int sliderX = (Renderer::ORIGINAL_WIDTH / 2) - (clipRect.getWidth() / 2);
 	const int sliderY = clipRect.getHeight();
 
-	// Since there are some off-by-one rounding errors with SDL_RenderCopy,
-	// draw a black rectangle behind the slider to cover up gaps.
-	renderer.fillOriginalRect(Color::Black, sliderX - 1, sliderY - 1,
-		clipRect.getWidth() + 2, clipRect.getHeight() + 2);
+	// The slider only moves when the player turns far enough to change the offset, so the
+	// compass is drawn from a cached layer until then.
+	CompassLayerKey layerKey;
+	layerKey.sliderTexture = compassSlider.get();
+	layerKey.frameTexture = compassFrame.get();
+	layerKey.sliderOffset = xOffset;
+
+	if (!this->compassLayer.isValid() || !(layerKey == this->compassLayerKey))
+	{
+		// The layer covers the frame and the black border around the slider.
+		const int frameX = (Renderer::ORIGINAL_WIDTH / 2) - (compassFrame.getWidth() / 2);
+		const int layerLeft = std::min(frameX, sliderX - 1);
+		const int layerRight = std::max(frameX + compassFrame.getWidth(),
+			sliderX + clipRect.getWidth() + 1);
+		const int layerBottom = std::max(compassFrame.getHeight(),
+			sliderY + clipRect.getHeight() + 1);
+		this->compassLayer.init(layerLeft, 0, layerRight - layerLeft, layerBottom, renderer);
+		this->compassLayer.begin(renderer);
+
+		// Since there are some off-by-one rounding errors with SDL_RenderCopy,
+		// draw a black rectangle behind the slider to cover up gaps.
+		this->compassLayer.fillRect(Color::Black, sliderX - 1, sliderY - 1,
+			clipRect.getWidth() + 2, clipRect.getHeight() + 2, renderer);
+
+		this->compassLayer.drawClipped(compassSlider.get(), clipRect, sliderX, sliderY,
+			renderer);
+
+		// Draw the compass frame over the slider.
+		this->compassLayer.draw(compassFrame.get(), frameX, 0, renderer);
+		this->compassLayerKey = layerKey;
+	}
 
-	renderer.drawOriginalClipped(compassSlider.get(), clipRect, sliderX, sliderY);
+	this->compassLayer.present(renderer);
+}
 
-	// Draw the compass frame over the slider.
-	const auto &compassFrame = textureManager.getTexture(
-		TextureFile::fromName(TextureName::CompassFrame), renderer);
-	renderer.drawOriginal(compassFrame.get(),
-		(Renderer::ORIGINAL_WIDTH / 2) - (compassFrame.getWidth() / 2), 0);
+std::string GameWorldPanel::getOcclusionText(const Renderer &renderer)
+{
+	const SoftwareRenderer::OcclusionMode occlusionMode = renderer.getOcclusionMode();
+	if (occlusionMode == SoftwareRenderer::OcclusionMode::DepthTest)
+	{
+		return "depth test";
+	}
+	else if (occlusionMode == SoftwareRenderer::OcclusionMode::Culling)
+	{
+		return "culling";
+	}
+	else
+	{
+		return "compare, " + std::to_string(renderer.getOcclusionMismatchCount()) + 
+			" mismatched pixels";
+	}
+}
+
+std::string GameWorldPanel::getCostViewText(const Renderer &renderer)
+{
+	const SoftwareRenderer::CostView costView = renderer.getCostView();
+	if (costView == SoftwareRenderer::CostView::Columns)
+	{
+		return "column cost";
+	}
+	else if (costView == SoftwareRenderer::CostView::Overdraw)
+	{
+		return "overdraw";
+	}
+	else
+	{
+		return "off";
+	}
+}
+
+std::string GameWorldPanel::getInterlaceText(const Renderer &renderer)
+{
+	const auto &stats = renderer.getRenderStats();
+	const int skippedColumns = stats.reusedColumns + stats.interpolatedColumns +
+		stats.foveatedColumns;
+	if (skippedColumns == 0)
+	{
+		return "off";
+	}
+
+	const int castPercent = (stats.castColumns * 100) / (stats.castColumns + skippedColumns);
+	return std::to_string(castPercent) + "% of columns cast, rest " +
+		((stats.reusedColumns > 0) ? "from last frame" :
+		((stats.foveatedColumns > 0) ? "interpolated at the edges" : "interpolated"));
+}
+
+void GameWorldPanel::appendRenderThreadText(const Renderer &renderer, FrameString &text) const
+{
+	// Busy and idle milliseconds of each 3D render thread, a few threads per line.
+	const auto &threadTimes = renderer.getRenderThreadTimes();
+	const int threadsPerLine = 4;
+
+	// Threads left out by adaptive thread counts have no busy time.
+	const auto activeThreadCount = std::count_if(threadTimes.begin(), threadTimes.end(),
+		[](const SoftwareRenderer::ThreadTimes &times) { return times.busySeconds > 0.0; });
+
+	AppendText(text, "Span shading: ",
+		SpanShading::getInstructionSetName(SpanShading::getInstructionSet()), "\n",
+		"Occlusion (F3): ", GameWorldPanel::getOcclusionText(renderer), "\n",
+		"Cost view (F7): ", GameWorldPanel::getCostViewText(renderer), "\n",
+		"Skipped columns: ", GameWorldPanel::getInterlaceText(renderer), "\n",
+		"Render threads (busy/idle ms, ", std::to_string(activeThreadCount), " active):");
+	for (size_t i = 0; i < threadTimes.size(); i++)
+	{
+		const auto &times = threadTimes[i];
+		AppendText(text, ((i % threadsPerLine) == 0) ? "\n" : " ",
+			String::fixedPrecision(times.busySeconds * 1000.0, 1), "/",
+			String::fixedPrecision(times.idleSeconds * 1000.0, 1));
+	}
+}
+
+void GameWorldPanel::appendRenderStatsText(const Renderer &renderer, FrameString &text)
+{
+	const auto &stats = renderer.getRenderStats();
+
+	auto toMilliseconds = [](double seconds)
+	{
+		return String::fixedPrecision(seconds * 1000.0, 2);
+	};
+
+	AppendText(text, "Voxel steps: ", std::to_string(stats.voxelSteps),
+		", columns: ", std::to_string(stats.voxelColumns),
+		", occluded: ", std::to_string(stats.occludedColumns), "\n",
+		"Pixels wall/persp/transp/flat: ", std::to_string(stats.wallPixels), "/",
+		std::to_string(stats.perspectivePixels), "/",
+		std::to_string(stats.transparentPixels), "/",
+		std::to_string(stats.flatPixels), ", flat fragments: ",
+		std::to_string(stats.flatFragments), "\n",
+		"Cleared: ", std::to_string(stats.clearedPixels),
+		", depth rejects: ", std::to_string(stats.depthRejects),
+		", occluded flat columns: ", std::to_string(stats.occludedFlatColumns), "\n",
+		"Flats visible/draws: ", std::to_string(stats.visibleFlats), "/",
+		std::to_string(stats.flatDraws), "\n",
+		"Setup/voxels/flats (ms): ", toMilliseconds(stats.setupSeconds), "/",
+		toMilliseconds(stats.voxelSeconds), "/", toMilliseconds(stats.flatSeconds));
 }
 
 void GameWorldPanel::drawDebugText(Renderer &renderer)
@@ -1449,7 +1920,7 @@ void GameWorldPanel::drawDebugText(Renderer &renderer)
 	const Int2 windowDims = renderer.getWindowDimensions();
 
 	auto &game = this->getGame();
-	const double resolutionScale = game.getOptions().getResolutionScale();
+	const double resolutionScale = renderer.getResolutionScale();
 
 	auto &gameData = game.getGameData();
 	const auto &player = gameData.getPlayer();
@@ -1457,33 +1928,89 @@ void GameWorldPanel::drawDebugText(Renderer &renderer)
 	const Double3 &direction = player.getDirection();
 
 	const auto &worldData = gameData.getWorldData();
-	const auto &level = worldData.getLevels().at(worldData.getCurrentLevel());
-
-	const std::string text =
-		"Screen: " + std::to_string(windowDims.x) + "x" + std::to_string(windowDims.y) + "\n" +
-		"Resolution scale: " + String::fixedPrecision(resolutionScale, 2) + "\n" +
-		"FPS: " + String::fixedPrecision(game.getFPSCounter().getFPS(), 1) + "\n" +
-		"Map: " + worldData.getMifName() + "\n" +
-		"Info: " + level.getInfName() + "\n" +
-		"X: " + String::fixedPrecision(position.x, 5) + "\n" +
-		"Y: " + String::fixedPrecision(position.y, 5) + "\n" +
-		"Z: " + String::fixedPrecision(position.z, 5) + "\n" +
-		"DirX: " + String::fixedPrecision(direction.x, 5) + "\n" +
-		"DirY: " + String::fixedPrecision(direction.y, 5) + "\n" +
-		"DirZ: " + String::fixedPrecision(direction.z, 5);
-
-	const RichTextString richText(
-		text,
-		FontName::D,
-		Color::White,
-		TextAlignment::Left,
-		game.getFontManager());
+	const auto &level = worldData.getActiveLevel();
+
+	// The text is rebuilt every frame, so it goes in frame memory instead of the heap.
+	FrameString text(game.getFrameAllocator());
+	text.reserve(1024);
+
+	if (this->showMemoryReport)
+	{
+		// The second page (F5) shows where memory goes, for checking budgets.
+		AppendText(text, MemoryTracker::getReport());
+	}
+	else
+	{
+		const FPSCounter &fpsCounter = game.getFPSCounter();
+		AppendText(text,
+			"Screen: ", std::to_string(windowDims.x), "x", std::to_string(windowDims.y), "\n",
+			"Resolution scale: ", String::fixedPrecision(resolutionScale, 2), "\n",
+			"FPS: ", String::fixedPrecision(game.getFPSCounter().getFPS(), 1), "\n",
+			"Frame time deviation: ", String::fixedPrecision(
+				game.getFPSCounter().getFrameTimeDeviation() * 1000.0, 2), " ms\n",
+			"Input latency (p50/p95): ",
+				String::fixedPrecision(fpsCounter.getInputLatencyPercentile(50.0) * 1000.0, 1),
+				"/",
+				String::fixedPrecision(fpsCounter.getInputLatencyPercentile(95.0) * 1000.0, 1),
+				" ms\n",
+			"Deferred main thread jobs: ",
+				std::to_string(game.getJobSystem().getMainThreadCallbackCount()), "\n",
+			"Texture memory: ", String::fixedPrecision(static_cast<double>(
+				game.getTextureManager().getMemoryStats().getTotalBytes()) /
+				(1024.0 * 1024.0), 1), " MB\n");
+
+		if (AllocationCounter::isEnabled())
+		{
+			AppendText(text, "Heap allocations last frame: ",
+				std::to_string(game.getLastFrameAllocationCount()), "\n");
+		}
+
+		// Entities in each update tier last simulation step.
+		AppendText(text, "Entity ticks: ",
+			std::to_string(this->entityTierCounts[static_cast<int>(EntityUpdateTier::Full)]),
+			" full, ",
+			std::to_string(this->entityTierCounts[static_cast<int>(EntityUpdateTier::Reduced)]),
+			" reduced, ",
+			std::to_string(this->entityTierCounts[static_cast<int>(EntityUpdateTier::Coarse)]),
+			" coarse\n");
+
+		AppendText(text,
+			"Map: ", worldData.getMifName(), "\n",
+			"Info: ", level.getInfName(), "\n",
+			"X: ", String::fixedPrecision(position.x, 5), "\n",
+			"Y: ", String::fixedPrecision(position.y, 5), "\n",
+			"Z: ", String::fixedPrecision(position.z, 5), "\n",
+			"DirX: ", String::fixedPrecision(direction.x, 5), "\n",
+			"DirY: ", String::fixedPrecision(direction.y, 5), "\n",
+			"DirZ: ", String::fixedPrecision(direction.z, 5), "\n");
+
+		// The threads, occlusion, and counters are only for the software renderer.
+		if (renderer.isHardwareRendering())
+		{
+			AppendText(text, "World renderer: OpenGL");
+		}
+		else
+		{
+			this->appendRenderThreadText(renderer, text);
+
+			if (game.getOptions().getShowRenderStats())
+			{
+				AppendText(text, "\n");
+				GameWorldPanel::appendRenderStatsText(renderer, text);
+			}
+		}
+	}
+
+	// The text changes every frame, so it's drawn from the font's glyph atlas instead of
+	// making a text box.
+	auto &fontManager = game.getFontManager();
+	this->debugTextLayout.set(StringView(text.data(), text.size()), FontName::D,
+		TextAlignment::Left, fontManager);
 
 	const int x = 2;
 	const int y = 2;
-	const TextBox tempText(x, y, richText, renderer);
-
-	renderer.drawOriginal(tempText.getTexture(), tempText.getX(), tempText.getY());
+	game.getTextRenderer().draw(this->debugTextLayout, x, y, Color::White,
+		fontManager, renderer);
 }
 
 void GameWorldPanel::updateCursorRegions(int width, int height)
@@ -1525,21 +2052,19 @@ void GameWorldPanel::updateCursorRegions(int width, int height)
 	this->nativeCursorRegions.at(8) = scaleRect(BottomRightRegion);
 }
 
-void GameWorldPanel::tick(double dt)
+void GameWorldPanel::tickSimulation(double dt)
 {
 	auto &game = this->getGame();
-	assert(game.gameDataIsActive());
+	auto &gameData = game.getGameData();
+	auto &player = gameData.getPlayer();
 
-	// Get the relative mouse state (can only be called once per frame).	
-	const auto &inputManager = game.getInputManager();
-	const Int2 mouseDelta = inputManager.getMouseDelta();
+	// Keep where the player was at the start of the step for interpolating between steps.
+	this->previousPlayerPosition = player.getPosition();
 
 	// Handle input for player motion.
-	this->handlePlayerTurning(dt, mouseDelta);
 	this->handlePlayerMovement(dt);
 
 	// Tick the game world clock time.
-	auto &gameData = game.getGameData();
 	const Clock oldClock = gameData.getClock();
 	gameData.tickTime(dt, game);
 	const Clock newClock = gameData.getClock();
@@ -1610,28 +2135,14 @@ void GameWorldPanel::tick(double dt)
 	// To do: tick effect text, and draw in render().
 
 	// Tick the player.
-	auto &player = gameData.getPlayer();
 	const Int3 oldPlayerVoxel = player.getVoxelPosition();
 	player.tick(game, dt);
 	const Int3 newPlayerVoxel = player.getVoxelPosition();
 
-	// Handle input for the player's attack.
-	this->handlePlayerAttack(mouseDelta);
-
-	// Update entities and their state in the renderer.
-	auto &entityManager = worldData.getEntityManager();
-	for (auto *entity : entityManager.getAllEntities())
-	{
-		// Tick entity state.
-		entity->tick(game, dt);
+	// Tick entity state. Their flats are updated in the renderer once per frame.
+	this->tickEntities(dt);
 
-		// Update entity flat properties for rendering.
-		const Double3 position = entity->getPosition();
-		const int textureID = entity->getTextureID();
-		const bool flipped = entity->getFlipped();
-		renderer.updateFlat(entity->getID(), &position, nullptr, nullptr,
-			&textureID, &flipped);
-	}
+	this->tickDoors(dt);
 
 	// See if the player changed voxels in the XZ plane. If so, trigger text and
 	// sound events, and handle any level transition.
@@ -1644,7 +2155,7 @@ void GameWorldPanel::tick(double dt)
 		// Don't handle triggers and level transitions if outside the voxel grid.
 		const bool inVoxelGrid = [&worldData, &newPlayerVoxelXZ]()
 		{
-			const auto &level = worldData.getLevels().at(worldData.getCurrentLevel());
+			const auto &level = worldData.getActiveLevel();
 			const auto &voxelGrid = level.getVoxelGrid();
 			return (newPlayerVoxelXZ.x >= 0) && (newPlayerVoxelXZ.x < voxelGrid.getWidth()) &&
 				(newPlayerVoxelXZ.y >= 0) && (newPlayerVoxelXZ.y < voxelGrid.getDepth());
@@ -1656,11 +2167,338 @@ void GameWorldPanel::tick(double dt)
 
 			// To do: determine if the player would collide with the voxel instead
 			// of checking that they're in the voxel.
+			const Double3 positionBeforeTransition = player.getPosition();
 			this->handleLevelTransition(oldPlayerVoxelXZ, newPlayerVoxelXZ);
+
+			// Don't interpolate across a teleport, or between entities of different levels.
+			if (player.getPosition() != positionBeforeTransition)
+			{
+				this->previousPlayerPosition = player.getPosition();
+				this->resetFlatInterpolation();
+				this->preloadSounds();
+			}
+
+			const Int3 playerVoxel = player.getVoxelPosition();
+			this->prefetchNearbyLevels(Int2(playerVoxel.x, playerVoxel.z));
+		}
+	}
+
+	// Bring in wilderness blocks around the player. When the level moves over by a block,
+	// the player moves with it so the step interpolates the same as before.
+	if (worldType == WorldType::Wilderness)
+	{
+		auto &level = worldData.getActiveLevel();
+		const Int2 levelShift = level.updateWilderness(player.getPosition(),
+			game.getJobSystem());
+		if (levelShift != Int2())
+		{
+			const Double3 offset(static_cast<double>(levelShift.x), 0.0,
+				static_cast<double>(levelShift.y));
+			player.teleport(player.getPosition() + offset);
+			this->previousPlayerPosition = this->previousPlayerPosition + offset;
+
+			// The renderer's doors are by voxel, so any open ones are given again.
+			const ActiveDoors &activeDoors = level.getActiveDoors();
+			renderer.clearDoors();
+			for (int i = 0; i < activeDoors.getCount(); i++)
+			{
+				const ActiveDoors::Door &door = activeDoors.getDoor(i);
+				renderer.setDoorOpenPercent(door.voxel, door.openPercent);
+			}
 		}
 	}
 }
 
+void GameWorldPanel::openDoorInFront()
+{
+	auto &gameData = this->getGame().getGameData();
+	const auto &player = gameData.getPlayer();
+	auto &level = gameData.getWorldData().getActiveLevel();
+	const VoxelGrid &voxelGrid = level.getVoxelGrid();
+
+	const VoxelRayQuery::Hit hit = VoxelRayQuery::castRay(voxelGrid, VoxelRayQuery::Ray(
+		player.getPosition(), player.getDirection(), DoorReachDistance));
+	if (hit.type != VoxelRayQuery::Hit::Type::Voxel)
+	{
+		return;
+	}
+
+	const Int3 &voxel = hit.voxel;
+	const VoxelData &voxelData = voxelGrid.getVoxelData(
+		voxelGrid.getVoxel(voxel.x, voxel.y, voxel.z));
+	if (voxelData.dataType == VoxelDataType::Door)
+	{
+		level.getActiveDoors().open(voxel, voxelData.door.type);
+	}
+}
+
+void GameWorldPanel::tickDoors(double dt)
+{
+	auto &game = this->getGame();
+	auto &level = game.getGameData().getWorldData().getActiveLevel();
+	ActiveDoors &activeDoors = level.getActiveDoors();
+	if (activeDoors.isEmpty())
+	{
+		return;
+	}
+
+	activeDoors.tick(dt, this->doorChanges);
+
+	auto &renderer = game.getRenderer();
+	NavigationGrid &navigation = level.getNavigation();
+	for (const ActiveDoors::Change &change : this->doorChanges)
+	{
+		renderer.setDoorOpenPercent(change.voxel, change.openPercent);
+
+		// NPCs can only walk through doors that are all the way open.
+		navigation.setDoorOpen(change.voxel, change.openPercent >= 1.0);
+	}
+}
+
+void GameWorldPanel::tickEntities(double dt)
+{
+	auto &game = this->getGame();
+	auto &gameData = game.getGameData();
+	auto &worldData = gameData.getWorldData();
+	auto &entityManager = worldData.getEntityManager();
+	auto &jobSystem = game.getJobSystem();
+
+	// Looping animations all follow the library's clock, so it's ticked once for all of them.
+	auto &animationLibrary = worldData.getAnimationLibrary();
+	animationLibrary.tick(dt);
+
+	// The player's flow field is only kept up to date while there are NPCs to follow it.
+	auto &level = worldData.getActiveLevel();
+	NavigationGrid &navigation = level.getNavigation();
+	if (entityManager.getEntityCount(EntityType::NonPlayer) > 0)
+	{
+		const Int3 playerVoxel = gameData.getPlayer().getVoxelPosition();
+		navigation.setGoal(NavigationGrid::PLAYER_GOAL, { Int2(playerVoxel.x, playerVoxel.z) });
+	}
+
+	navigation.update(level.getVoxelGrid(), jobSystem);
+
+	const EntityWorldView worldView(level.getVoxelGrid(), navigation, animationLibrary,
+		gameData.getClock(), gameData.getPlayer().getPosition());
+
+	// Whether an entity is in view is tested against a cone around the camera's horizontal
+	// field of view instead of read back from the renderer, since a pipelined frame is
+	// still being drawn while entities tick.
+	const Player &player = gameData.getPlayer();
+	const Double3 &playerPosition = player.getPosition();
+	const Double2 viewDirection = Double2(player.getDirection().x,
+		player.getDirection().z).normalized();
+	const double viewCos = [&game]()
+	{
+		const auto &renderer = game.getRenderer();
+		const double viewAspect = static_cast<double>(renderer.getWindowDimensions().x) /
+			static_cast<double>(std::max(renderer.getViewHeight(), 1));
+		const double halfFovY = game.getOptions().getSnapshot().verticalFOV *
+			0.50 * Constants::DegToRad;
+		const double halfFovX = std::atan(std::tan(halfFovY) * viewAspect);
+		return std::cos(std::min(halfFovX + (EntityViewMarginDegrees * Constants::DegToRad),
+			Constants::Pi));
+	}();
+
+	this->entityTierCounts.fill(0);
+	const int reducedPhase = this->entityTickStep % EntityReducedTickInterval;
+	const int coarsePhase = this->entityTickStep;
+	this->entityTickStep = (this->entityTickStep + 1) % EntityCoarseTickInterval;
+
+	int batchOffset = 0;
+	const int entityTypeCount = static_cast<int>(EntityType::Transition) + 1;
+	for (int typeIndex = 0; typeIndex < entityTypeCount; typeIndex++)
+	{
+		const EntityType entityType = static_cast<EntityType>(typeIndex);
+		const int entityCount = entityManager.getEntityCount(entityType);
+		if (entityCount == 0)
+		{
+			continue;
+		}
+
+		// Entities are given their tick times here, so the batches only tick the ones that
+		// are due. Each entity's ID staggers which step it's due on.
+		this->entityTickPositions.resize(entityCount);
+		this->entityTickTimes.resize(entityCount);
+		for (int i = 0; i < entityCount; i++)
+		{
+			Entity *entity = entityManager.getEntity(entityType, i);
+			const Double3 &position = entity->getPosition();
+			this->entityTickPositions[i] = position;
+
+			const EntityUpdateTier tier = GetEntityUpdateTier(position - playerPosition,
+				viewDirection, viewCos);
+			this->entityTierCounts[static_cast<int>(tier)]++;
+
+			const bool due = [tier, entity, reducedPhase, coarsePhase]()
+			{
+				switch (tier)
+				{
+				case EntityUpdateTier::Full:
+					return true;
+				case EntityUpdateTier::Reduced:
+					return (entity->getID() % EntityReducedTickInterval) == reducedPhase;
+				default:
+					return (entity->getID() % EntityCoarseTickInterval) == coarsePhase;
+				}
+			}();
+
+			const double tickTime = entity->getSkippedTime() + dt;
+			this->entityTickTimes[i] = due ? tickTime : 0.0;
+			entity->setSkippedTime(due ? 0.0 : tickTime);
+		}
+
+		const int batchCount = (entityCount + EntityTickBatchSize - 1) / EntityTickBatchSize;
+		if (static_cast<int>(this->entityCommandBuffers.size()) < (batchOffset + batchCount))
+		{
+			this->entityCommandBuffers.resize(batchOffset + batchCount);
+		}
+
+		// Each batch only touches its own entities and command buffer.
+		auto &commandBuffers = this->entityCommandBuffers;
+		const auto &tickTimes = this->entityTickTimes;
+		jobSystem.parallelFor(batchCount, [&entityManager, &worldView, &commandBuffers,
+			&tickTimes, entityType, entityCount, batchOffset](int batchIndex)
+		{
+			EntityCommandBuffer &commands = commandBuffers[batchOffset + batchIndex];
+			const int startIndex = batchIndex * EntityTickBatchSize;
+			const int endIndex = std::min(startIndex + EntityTickBatchSize, entityCount);
+			for (int i = startIndex; i < endIndex; i++)
+			{
+				const double tickTime = tickTimes[i];
+				if (tickTime > 0.0)
+				{
+					entityManager.getEntity(entityType, i)->tick(worldView, tickTime, commands);
+				}
+			}
+		});
+
+		// Only entities that moved this step are interpolated, and hashed again.
+		for (int i = 0; i < entityCount; i++)
+		{
+			Entity *entity = entityManager.getEntity(entityType, i);
+			const Double3 &previousPosition = this->entityTickPositions[i];
+
+			if (entity->getPosition() != previousPosition)
+			{
+				this->previousFlatPositions[entity->getID()] = previousPosition;
+				entityManager.updateCell(entity->getID());
+			}
+			else if (this->previousFlatPositions.erase(entity->getID()) > 0)
+			{
+				// It stopped, so its flat needs to be moved to where it ended up.
+				entity->setFlatDirty();
+			}
+		}
+
+		batchOffset += batchCount;
+	}
+
+	// Now that nothing is ticking, apply side effects in type and batch order so they
+	// come out the same no matter how the batches were scheduled.
+	for (int i = 0; i < batchOffset; i++)
+	{
+		this->entityCommandBuffers[i].apply(game);
+	}
+}
+
+double GameWorldPanel::getSimulationPercent() const
+{
+	return this->simulationTime / SimulationStepSeconds;
+}
+
+void GameWorldPanel::updateFlats()
+{
+	auto &game = this->getGame();
+	auto &renderer = game.getRenderer();
+	auto &worldData = game.getGameData().getWorldData();
+	auto &entityManager = worldData.getEntityManager();
+	const double percent = this->getSimulationPercent();
+	this->flatUpdates.clear();
+
+	// Moving entities are sent every frame since their interpolated position changes.
+	for (const auto &pair : this->previousFlatPositions)
+	{
+		Entity *entity = entityManager.at(pair.first);
+		if (entity != nullptr)
+		{
+			Renderer::FlatUpdate flatUpdate;
+			flatUpdate.id = entity->getID();
+			flatUpdate.position = pair.second.lerp(entity->getPosition(), percent);
+			flatUpdate.textureID = entity->getTextureID();
+			flatUpdate.flipped = entity->getFlipped();
+			this->flatUpdates.push_back(flatUpdate);
+			entity->clearFlatDirty();
+		}
+	}
+
+	// Other entities are only sent when something about them changed.
+	for (auto *entity : entityManager.getAllEntities())
+	{
+		if (entity->isFlatDirty())
+		{
+			Renderer::FlatUpdate flatUpdate;
+			flatUpdate.id = entity->getID();
+			flatUpdate.position = entity->getPosition();
+			flatUpdate.textureID = entity->getTextureID();
+			flatUpdate.flipped = entity->getFlipped();
+			this->flatUpdates.push_back(flatUpdate);
+			entity->clearFlatDirty();
+		}
+	}
+
+	renderer.updateFlats(this->flatUpdates);
+}
+
+void GameWorldPanel::resetFlatInterpolation()
+{
+	auto &worldData = this->getGame().getGameData().getWorldData();
+	auto &entityManager = worldData.getEntityManager();
+
+	for (const auto &pair : this->previousFlatPositions)
+	{
+		Entity *entity = entityManager.at(pair.first);
+		if (entity != nullptr)
+		{
+			entity->setFlatDirty();
+		}
+	}
+
+	this->previousFlatPositions.clear();
+}
+
+void GameWorldPanel::tick(double dt)
+{
+	auto &game = this->getGame();
+	assert(game.gameDataIsActive());
+
+	// Get the relative mouse state (can only be called once per frame).	
+	const auto &inputManager = game.getInputManager();
+	const Int2 mouseDelta = inputManager.getMouseDelta();
+
+	// The camera turns with the mouse every frame so it stays responsive.
+	this->handlePlayerTurning(dt, mouseDelta);
+
+	// Everything else in the game world is simulated in fixed steps, so it behaves the 
+	// same at any frame rate. Time left over is carried into the next frame.
+	this->simulationTime += dt;
+	while (this->simulationTime >= SimulationStepSeconds)
+	{
+		this->tickSimulation(SimulationStepSeconds);
+		this->simulationTime -= SimulationStepSeconds;
+	}
+
+	// Handle input for the player's attack.
+	this->handlePlayerAttack(mouseDelta);
+
+	// Flats are drawn partway between their last two simulated positions.
+	this->updateFlats();
+
+	// Positional sounds are heard from the player's ears.
+	const auto &player = game.getGameData().getPlayer();
+	game.getAudioManager().setListener(player.getPosition(), player.getDirection());
+}
+
 void GameWorldPanel::render(Renderer &renderer)
 {
 	assert(this->getGame().gameDataIsActive());
@@ -1674,8 +2512,8 @@ void GameWorldPanel::render(Renderer &renderer)
 	auto &gameData = this->getGame().getGameData();
 	auto &player = gameData.getPlayer();
 	const auto &worldData = gameData.getWorldData();
-	const auto &level = worldData.getLevels().at(worldData.getCurrentLevel());
-	const auto &options = this->getGame().getOptions();
+	const auto &level = worldData.getActiveLevel();
+	const OptionsSnapshot &options = this->getGame().getOptions().getSnapshot();
 	const double ambientPercent = [&gameData, &worldData]()
 	{
 		// Interiors are always completely dark, but for testing purposes, they
@@ -1691,55 +2529,126 @@ void GameWorldPanel::render(Renderer &renderer)
 		}
 	}();
 
-	renderer.renderWorld(player.getPosition(), player.getDirection(),
-		options.getVerticalFOV(), ambientPercent, gameData.getDaytimePercent(), 
-		level.getCeilingHeight(), level.getVoxelGrid());
+	renderer.setForceBaseMipLevel(options.forceBaseMipLevel);
+	renderer.setPipelinedRendering(options.pipelinedRendering);
+	renderer.setPalettedRendering(options.palettedRendering);
+	renderer.setColumnMajorRendering(options.columnMajorRendering);
+	renderer.setPerspectiveSpanLength(options.perspectiveSpanLength);
+	renderer.setRowPlaneRendering(options.rowPlaneRendering);
+	renderer.setDeferredShading(options.deferredShading);
+	renderer.setInterlacedRendering(options.interlacedRendering);
+	renderer.setFoveatedColumnStride(options.foveatedRendering + 1);
+	renderer.setReducedColorDepth(options.reducedColorDepth);
+	renderer.setRenderThreadBudget(options.adaptiveRenderThreads ?
+		(1.0 / static_cast<double>(options.targetFPS)) : 0.0);
+	renderer.setRenderStatsEnabled(options.showDebug && options.showRenderStats);
+
+	// Liquids follow the game clock, so they stop while the game is paused.
+	renderer.setLiquidCycleStep(static_cast<int>(
+		gameData.getDaytimePercent() * LiquidCycleDaySteps));
+
+	// The camera's direction is read below, so it has to be turned first.
+	this->handleLateMouseLook();
+
+	// Only render the game world if something it depends on changed since the last frame.
+	// The render settings above come from the options, so they're covered by the options'
+	// revision.
+	const VoxelGrid &voxelGrid = level.getVoxelGrid();
+	WorldFrameKey worldFrameKey;
+	worldFrameKey.position = this->previousPlayerPosition.lerp(
+		player.getPosition(), this->getSimulationPercent());
+	worldFrameKey.direction = player.getDirection();
+	worldFrameKey.ceilingHeight = level.getCeilingHeight();
+	worldFrameKey.voxelGrid = &voxelGrid;
+	worldFrameKey.daytimeStep = static_cast<int>(
+		gameData.getDaytimePercent() * WorldFrameDaytimeSteps);
+	worldFrameKey.voxelRevision = voxelGrid.getRevision();
+	worldFrameKey.rendererRevision = renderer.getWorldRevision();
+	worldFrameKey.optionsRevision = this->getGame().getOptions().getRevision();
+
+	// An interlaced frame with blended columns keeps being redrawn until the last frame
+	// can fill them in instead.
+	const bool worldFrameComplete = renderer.getRenderStats().interpolatedColumns == 0;
+
+	if (this->worldFrameRendered && (worldFrameKey == this->worldFrameKey) &&
+		worldFrameComplete)
+	{
+		renderer.redrawWorld();
+	}
+	else
+	{
+		renderer.renderWorld(worldFrameKey.position, worldFrameKey.direction,
+			options.verticalFOV, ambientPercent, gameData.getDaytimePercent(), 
+			worldFrameKey.ceilingHeight, voxelGrid);
+
+		this->worldFrameKey = worldFrameKey;
+		this->worldFrameRendered = true;
+	}
 
 	auto &textureManager = this->getGame().getTextureManager();
 	textureManager.setPalette(PaletteFile::fromName(PaletteName::Default));
 
 	const auto &gameInterface = textureManager.getTexture(
-		TextureFile::fromName(TextureName::GameWorldInterface), renderer);
+		this->gameWorldInterfaceHandle, renderer);
 
 	const auto &inputManager = this->getGame().getInputManager();
 	const Int2 mousePosition = inputManager.getMousePosition();
-	const bool modernInterface = options.getModernInterface();
+	const bool modernInterface = options.modernInterface;
 
 	// Continue drawing more interface objects if in classic mode.
 	// - To do: clamp game world interface to screen edges, not letterbox edges.
 	if (!modernInterface)
 	{
-		// Draw game world interface.
-		const auto &gameInterface = textureManager.getTexture(
-			TextureFile::fromName(TextureName::GameWorldInterface), renderer);
-		renderer.drawOriginal(gameInterface.get(), 0,
-			Renderer::ORIGINAL_HEIGHT - gameInterface.getHeight());
-
-		// Draw player portrait.
 		const auto &headsFilename = PortraitFile::getHeads(
 			player.getGenderName(), player.getRaceID(), true);
 		const auto &portrait = textureManager.getTextures(
 			headsFilename, renderer).at(player.getPortraitID());
 		const auto &status = textureManager.getTextures(
 			TextureFile::fromName(TextureName::StatusGradients), renderer).at(0);
-		renderer.drawOriginal(status.get(), 14, 166);
-		renderer.drawOriginal(portrait.get(), 14, 166);
 
-		// If the player's class can't use magic, show the darkened spell icon.
-		if (!player.getCharacterClass().canCastMagic())
+		// If the player's class can't use magic, the darkened spell icon is shown.
+		SDL_Texture *nonMagicTexture = player.getCharacterClass().canCastMagic() ? nullptr :
+			textureManager.getTexture(this->noSpellHandle, renderer).get();
+
+		// The interface bar only changes when one of its parts does, so it's drawn from
+		// a cached layer until then.
+		InterfaceLayerKey layerKey;
+		layerKey.interfaceTexture = gameInterface.get();
+		layerKey.statusTexture = status.get();
+		layerKey.portraitTexture = portrait.get();
+		layerKey.noSpellTexture = nonMagicTexture;
+		layerKey.playerNameTexture = this->playerNameTextBox->getTexture();
+
+		if (!this->interfaceLayer.isValid() || !(layerKey == this->interfaceLayerKey))
 		{
-			const auto &nonMagicIcon = textureManager.getTexture(
-				TextureFile::fromName(TextureName::NoSpell), renderer);
-			renderer.drawOriginal(nonMagicIcon.get(), 91, 177);
+			const int interfaceY = Renderer::ORIGINAL_HEIGHT - gameInterface.getHeight();
+			this->interfaceLayer.init(0, interfaceY, gameInterface.getWidth(),
+				gameInterface.getHeight(), renderer);
+			this->interfaceLayer.begin(renderer);
+
+			// Draw game world interface.
+			this->interfaceLayer.draw(gameInterface.get(), 0, interfaceY, renderer);
+
+			// Draw player portrait.
+			this->interfaceLayer.draw(status.get(), 14, 166, renderer);
+			this->interfaceLayer.draw(portrait.get(), 14, 166, renderer);
+
+			if (nonMagicTexture != nullptr)
+			{
+				this->interfaceLayer.draw(nonMagicTexture, 91, 177, renderer);
+			}
+
+			// Draw text: player name.
+			this->interfaceLayer.draw(this->playerNameTextBox->getTexture(),
+				this->playerNameTextBox->getX(), this->playerNameTextBox->getY(), renderer);
+			this->interfaceLayerKey = layerKey;
 		}
 
-		// Draw text: player name.
-		renderer.drawOriginal(this->playerNameTextBox->getTexture(),
-			this->playerNameTextBox->getX(), this->playerNameTextBox->getY());
+		this->interfaceLayer.present(renderer);
 	}
 
 	// Draw some optional debug text.
-	if (options.getShowDebug())
+	if (options.showDebug)
 	{
 		this->drawDebugText(renderer);
 	}
@@ -1755,12 +2664,12 @@ void GameWorldPanel::renderSecondary(Renderer &renderer)
 	textureManager.setPalette(PaletteFile::fromName(PaletteName::Default));
 
 	const auto &gameInterface = textureManager.getTexture(
-		TextureFile::fromName(TextureName::GameWorldInterface), renderer);
+		this->gameWorldInterfaceHandle, renderer);
 
 	auto &gameData = this->getGame().getGameData();
 	auto &player = gameData.getPlayer();
-	const auto &options = this->getGame().getOptions();
-	const bool modernInterface = options.getModernInterface();
+	const OptionsSnapshot &options = this->getGame().getOptions().getSnapshot();
+	const bool modernInterface = options.modernInterface;
 
 	// Display player's weapon if unsheathed. The position also depends on whether
 	// the interface is in classic or modern mode.
@@ -1814,7 +2723,7 @@ void GameWorldPanel::renderSecondary(Renderer &renderer)
 	}
 
 	// Draw the visible portion of the compass slider, and the frame over it.
-	if (options.getShowCompass())
+	if (options.showCompass)
 	{
 		this->drawCompass(player.getGroundDirection(), textureManager, renderer);
 	}
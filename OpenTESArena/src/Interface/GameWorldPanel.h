@@ -2,11 +2,20 @@
 #define GAME_WORLD_PANEL_H
 
 #include <array>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Button.h"
 #include "Panel.h"
+#include "TextRenderer.h"
+#include "../Entities/EntityCommandBuffer.h"
 #include "../Math/Rect.h"
+#include "../Math/Vector3.h"
+#include "../Rendering/RenderLayer.h"
+#include "../Rendering/Renderer.h"
+#include "../Utilities/FrameAllocator.h"
+#include "../World/ActiveDoors.h"
 
 // When the GameWorldPanel is active, the game world is ticking.
 
@@ -15,13 +24,47 @@
 // - A modern version: only compass and stat bars with free-look mouse.
 
 class Player;
-class Renderer;
 class TextBox;
 class TextureManager;
+class VoxelGrid;
+
+struct SDL_Texture;
 
 class GameWorldPanel : public Panel
 {
 private:
+	// Everything the game world frame depends on. When it's the same as the last rendered
+	// frame's, that frame is shown again instead of rendering a new one (i.e., while the 
+	// player stands still or a sub-panel is open).
+	struct WorldFrameKey
+	{
+		Double3 position, direction;
+		double ceilingHeight;
+		const VoxelGrid *voxelGrid;
+		int daytimeStep, voxelRevision, rendererRevision, optionsRevision;
+
+		bool operator==(const WorldFrameKey &other) const;
+	};
+
+	// What went into the cached interface layers, so they're only composed again when one
+	// of their parts changes. Textures can be reloaded by the texture manager, so they're
+	// part of the keys too.
+	struct InterfaceLayerKey
+	{
+		SDL_Texture *interfaceTexture, *statusTexture, *portraitTexture, *noSpellTexture,
+			*playerNameTexture;
+
+		bool operator==(const InterfaceLayerKey &other) const;
+	};
+
+	struct CompassLayerKey
+	{
+		SDL_Texture *sliderTexture, *frameTexture;
+		int sliderOffset;
+
+		bool operator==(const CompassLayerKey &other) const;
+	};
+
 	std::unique_ptr<TextBox> playerNameTextBox;
 	Button<Game&> characterSheetButton, statusButton,
 		logbookButton, pauseButton;
@@ -32,6 +75,28 @@ private:
 	std::array<Rect, 9> nativeCursorRegions;
 	std::vector<Int2> weaponOffsets;
 
+	// Texture manager handles of interface images drawn every frame.
+	int gameWorldInterfaceHandle, compassSliderHandle, compassFrameHandle, noSpellHandle;
+
+	WorldFrameKey worldFrameKey; // Of the last rendered game world frame.
+	bool worldFrameRendered; // Whether the world frame key is valid.
+	RenderLayer interfaceLayer, compassLayer; // Classic mode interface bar, and compass.
+	InterfaceLayerKey interfaceLayerKey;
+	CompassLayerKey compassLayerKey;
+	std::unordered_map<int, Double3> previousFlatPositions; // Of moving entities, by ID.
+	std::vector<Renderer::FlatUpdate> flatUpdates; // Reused by updateFlats() each frame.
+	std::vector<EntityCommandBuffer> entityCommandBuffers; // One per entity tick batch.
+	std::vector<Double3> entityTickPositions; // Entity positions before they tick.
+	std::vector<double> entityTickTimes; // Time each entity ticks by this step, or 0 if none.
+	std::array<int, 3> entityTierCounts; // Entities in each update tier last step.
+	int entityTickStep; // Counts simulation steps, for staggering the ticks of far entities.
+	std::vector<ActiveDoors::Change> doorChanges; // Reused by tickDoors() each step.
+	Double3 previousPlayerPosition; // At the start of the last simulation step.
+	int swishSoundID, arrowFireSoundID; // Weapon sounds, resolved once.
+	TextRenderer::Layout debugTextLayout; // Laid out again only when the text changes.
+	bool showMemoryReport; // Whether the debug text shows the memory tracker instead.
+	double simulationTime; // Time not yet simulated, less than one step.
+
 	// Modifies the values in the native cursor regions array so rectangles in
 	// the current window correctly represent regions for different arrow cursors.
 	void updateCursorRegions(int width, int height);
@@ -39,6 +104,13 @@ private:
 	// Handles input for the player camera.
 	void handlePlayerTurning(double dt, const Int2 &mouseDelta);
 
+	// Pitches and yaws the camera by the mouse motion if it's in free-look.
+	void handleMouseLook(const Int2 &mouseDelta);
+
+	// Turns the camera by mouse motion since the tick, right before the game world is drawn
+	// (late mouse look).
+	void handleLateMouseLook();
+
 	// Handles input for player movement in the game world.
 	void handlePlayerMovement(double dt);
 
@@ -46,6 +118,31 @@ private:
 	// the previous frame.
 	void handlePlayerAttack(const Int2 &mouseDelta);
 
+	// Advances the player, entities, and the rest of the game world by one fixed step.
+	void tickSimulation(double dt);
+
+	// Ticks entities in parallel batches of each type, then applies their side effects
+	// in batch order. Entities far from the player or out of view tick less often.
+	void tickEntities(double dt);
+
+	// Opens the door the player is looking at, if one is within reach.
+	void openDoorInFront();
+
+	// Moves the active level's open doors along and gives the renderer the ones that
+	// changed. Costs nothing while every door is closed.
+	void tickDoors(double dt);
+
+	// Gets how far the current frame is between the last simulation step and the next one,
+	// for interpolating positions.
+	double getSimulationPercent() const;
+
+	// Updates the flats of dirty and moving entities in the renderer, using interpolated
+	// positions for moving ones. Unchanged entities cost nothing here.
+	void updateFlats();
+
+	// Marks the flats of moving entities dirty and stops interpolating them.
+	void resetFlatInterpolation();
+
 	// Sends an "on voxel enter" message for the given voxel and triggers any text or
 	// sound events.
 	void handleTriggers(const Int2 &voxel);
@@ -54,6 +151,14 @@ private:
 	// and changes the current level if it is.
 	void handleLevelTransition(const Int2 &playerVoxel, const Int2 &transitionVoxel);
 
+	// Starts decoding the textures of any level the player could move to through a level
+	// up/down voxel near them, so the level switch itself doesn't hitch.
+	void prefetchNearbyLevels(const Int2 &playerVoxel);
+
+	// Starts decoding the weapon sounds and every sound trigger in the world's levels, so
+	// playing one for the first time doesn't hitch.
+	void preloadSounds();
+
 	// Draws a tooltip sitting on the top left of the game interface.
 	void drawTooltip(const std::string &text, Renderer &renderer);
 
@@ -61,6 +166,22 @@ private:
 	void drawCompass(const Double2 &direction, TextureManager &textureManager,
 		Renderer &renderer);
 
+	// Gets the debug description of the 3D renderer's occlusion mode.
+	static std::string getOcclusionText(const Renderer &renderer);
+
+	// Gets the debug description of the 3D renderer's cost view.
+	static std::string getCostViewText(const Renderer &renderer);
+
+	// Gets the debug description of how much of the last 3D frame was ray cast, and how
+	// interlacing or foveated rendering filled in the rest.
+	static std::string getInterlaceText(const Renderer &renderer);
+
+	// Appends the debug text showing how busy each 3D render thread was last frame.
+	void appendRenderThreadText(const Renderer &renderer, FrameString &text) const;
+
+	// Appends the debug text showing the 3D renderer's work counters from last frame.
+	static void appendRenderStatsText(const Renderer &renderer, FrameString &text);
+
 	// Draws some debug text.
 	void drawDebugText(Renderer &renderer);
 public:
@@ -70,6 +191,9 @@ public:
 	virtual ~GameWorldPanel() = default;
 
 	virtual std::pair<SDL_Texture*, CursorAlignment> getCurrentCursor() const override;
+	virtual bool isPoolable() const override;
+	virtual size_t getPooledBytes() const override;
+	virtual void resume() override;
 	virtual void handleEvent(const SDL_Event &e) override;
 	virtual void resize(int windowWidth, int windowHeight) override;
 	virtual void tick(double dt) override;
@@ -13,6 +13,8 @@
 #include "../Rendering/Renderer.h"
 #include "../Rendering/Texture.h"
 
+const int ImageSequencePanel::PREFETCH_COUNT = 2;
+
 ImageSequencePanel::ImageSequencePanel(Game &game,
 	const std::vector<std::string> &paletteNames,
 	const std::vector<std::string> &textureNames,
@@ -29,8 +31,55 @@ ImageSequencePanel::ImageSequencePanel(Game &game,
 		return Button<Game&>(endingAction);
 	}();
 
+	auto &textureManager = game.getTextureManager();
+	for (size_t i = 0; i < textureNames.size(); i++)
+	{
+		this->imageHandles.push_back(textureManager.getImageHandle(
+			textureNames.at(i), paletteNames.at(i)));
+	}
+
 	this->currentSeconds = 0.0;
 	this->imageIndex = 0;
+
+	this->updateStreaming();
+}
+
+ImageSequencePanel::~ImageSequencePanel()
+{
+	// Nothing from the sequence stays cached after it's done.
+	auto &textureManager = this->getGame().getTextureManager();
+	for (const int imageHandle : this->imageHandles)
+	{
+		textureManager.unload(imageHandle);
+	}
+}
+
+void ImageSequencePanel::updateStreaming()
+{
+	auto &textureManager = this->getGame().getTextureManager();
+	const int imageCount = static_cast<int>(this->imageHandles.size());
+
+	// The current image is included in case it hasn't been started yet.
+	const int prefetchEnd = std::min(
+		this->imageIndex + ImageSequencePanel::PREFETCH_COUNT + 1, imageCount);
+	for (int i = this->imageIndex; i < prefetchEnd; i++)
+	{
+		textureManager.prefetch(this->imageHandles.at(i));
+	}
+
+	// Images already shown were presented in an earlier frame, so their textures are
+	// no longer referenced.
+	const int shownEnd = std::min(this->imageIndex, imageCount);
+	for (int i = 0; i < shownEnd; i++)
+	{
+		const int imageHandle = this->imageHandles.at(i);
+		const auto upcomingBegin = this->imageHandles.begin() + shownEnd;
+		if (std::find(upcomingBegin, this->imageHandles.end(), imageHandle) ==
+			this->imageHandles.end())
+		{
+			textureManager.unload(imageHandle);
+		}
+	}
 }
 
 void ImageSequencePanel::handleEvent(const SDL_Event &e)
@@ -58,6 +107,10 @@ void ImageSequencePanel::handleEvent(const SDL_Event &e)
 		{
 			this->skipButton.click(this->getGame());
 		}
+		else
+		{
+			this->updateStreaming();
+		}
 	}	
 }
 
@@ -81,6 +134,10 @@ void ImageSequencePanel::tick(double dt)
 			{
 				this->skipButton.click(this->getGame());
 			}
+			else
+			{
+				this->updateStreaming();
+			}
 		}
 	}
 
@@ -97,7 +154,6 @@ void ImageSequencePanel::render(Renderer &renderer)
 
 	// Draw image.
 	const auto &image = textureManager.getTexture(
-		this->textureNames.at(this->imageIndex),
-		this->paletteNames.at(this->imageIndex), renderer);
+		this->imageHandles.at(this->imageIndex), renderer);
 	renderer.drawOriginal(image.get());
 }
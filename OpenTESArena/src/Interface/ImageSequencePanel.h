@@ -20,15 +20,25 @@ private:
 	std::vector<std::string> paletteNames;
 	std::vector<std::string> textureNames;
 	std::vector<double> imageDurations;
+	std::vector<int> imageHandles; // Texture manager handles of each image.
 	double currentSeconds;
 	int imageIndex;
+
+	// Number of images after the current one that are decoded ahead of time.
+	static const int PREFETCH_COUNT;
+
+	// Prefetches the images coming up after the current one, and unloads the ones
+	// before it that aren't shown again. Called whenever the image index changes.
+	void updateStreaming();
 public:
+	// Images are decoded a few at a time on worker threads as the sequence plays, and are
+	// unloaded once they've been shown, so only a handful are ever in memory.
 	ImageSequencePanel(Game &game,
 		const std::vector<std::string> &paletteNames,
 		const std::vector<std::string> &textureNames,
 		const std::vector<double> &imageDurations,
 		const std::function<void(Game&)> &endingAction);
-	virtual ~ImageSequencePanel() = default;
+	virtual ~ImageSequencePanel();
 
 	virtual void handleEvent(const SDL_Event &e) override;
 	virtual void tick(double dt) override;
@@ -1,27 +1,25 @@
 #include <algorithm>
 #include <cassert>
 
-#include "SDL.h"
-
 #include "ListBox.h"
-#include "RichTextString.h"
 #include "TextAlignment.h"
-#include "TextBox.h"
 #include "../Math/Rect.h"
 #include "../Math/Vector2.h"
 #include "../Media/Color.h"
 #include "../Media/Font.h"
 #include "../Media/FontManager.h"
 #include "../Rendering/Renderer.h"
-#include "../Rendering/Surface.h"
 #include "../Utilities/String.h"
 
+const int ListBox::ROW_MARGIN = 2;
+
 ListBox::ListBox(int x, int y, const Color &textColor, const std::vector<std::string> &elements,
-	FontName fontName, int maxDisplayed, FontManager &fontManager, Renderer &renderer)
+	FontName fontName, int maxDisplayed, FontManager &fontManager)
 	: textColor(textColor), point(x, y), fontName(fontName)
 {
 	assert(maxDisplayed > 0);
 
+	this->maxDisplayed = maxDisplayed;
 	this->scrollIndex = 0;
 
 	// Get the font data associated with the font name.
@@ -29,70 +27,39 @@ ListBox::ListBox(int x, int y, const Color &textColor, const std::vector<std::st
 
 	this->characterHeight = font.getCharacterHeight();
 
-	// Make text boxes for getting list box dimensions now and drawing later.
-	// It's okay for there to be zero elements. Just be blank, then!
+	// Keep the elements as text only. It's okay for there to be zero elements. Just be
+	// blank, then!
+	this->elements.reserve(elements.size());
 	for (const auto &element : elements)
 	{
 		// Remove any new lines.
-		std::string trimmedElement = String::trimLines(element);
-
-		const int x = 0;
-		const int y = 0;
-
-		const RichTextString richText(
-			trimmedElement,
-			font.getFontName(),
-			textColor,
-			TextAlignment::Left,
-			fontManager);
-
-		// Store the text box for later.
-		auto textBox = std::make_unique<TextBox>(x, y, richText, renderer);
-		this->textBoxes.push_back(std::move(textBox));
+		this->elements.push_back(String::trimLines(element));
 	}
 
-	// Calculate the dimensions of the displayed list box area.
-	const int width = [this]()
+	// The list box is as wide as its widest element. Widths come from the font's glyphs,
+	// so nothing needs drawing to find them.
+	this->width = 0;
+	for (const auto &element : this->elements)
 	{
-		int maxWidth = 0;
-		for (const auto &textBox : this->textBoxes)
+		int elementWidth = 0;
+		for (const char c : element)
 		{
-			int textBoxWidth;
-			SDL_QueryTexture(textBox->getTexture(), nullptr, nullptr, &textBoxWidth, nullptr);
-
-			if (textBoxWidth > maxWidth)
-			{
-				maxWidth = textBoxWidth;
-			}
+			elementWidth += font.getSurface(c)->w;
 		}
 
-		return maxWidth;
-	}();
-
-	const int height = font.getCharacterHeight() * maxDisplayed;
-
-	// Create the clear surface. This exists because the text box surfaces can't
-	// currently have an arbitrary size (otherwise they could extend to the end of 
-	// each row), and because SDL_UpdateTexture requires pixels (so this avoids an 
-	// allocation each time the update method is called).
-	this->clearSurface = Surface::createSurfaceWithFormat(width, height,
-		Renderer::DEFAULT_BPP, Renderer::DEFAULT_PIXELFORMAT);
-	SDL_FillRect(this->clearSurface, nullptr, 
-		SDL_MapRGBA(clearSurface->format, 0, 0, 0, 0));
+		this->width = std::max(this->width, elementWidth);
+	}
 
-	// Create the visible texture. This will be updated when scrolling the list box.
-	this->texture = renderer.createTexture(Renderer::DEFAULT_PIXELFORMAT,
-		SDL_TEXTUREACCESS_STREAMING, width, height);
-	SDL_SetTextureBlendMode(this->texture, SDL_BLENDMODE_BLEND);
+	this->height = this->characterHeight * maxDisplayed;
 
-	// Draw the text boxes to the texture.
-	this->updateDisplay();
-}
+	// Enough rows for the visible elements and the margin on either side.
+	this->rows.resize(maxDisplayed + (ListBox::ROW_MARGIN * 2));
+	for (auto &row : this->rows)
+	{
+		row.elementIndex = -1;
+	}
 
-ListBox::~ListBox()
-{
-	SDL_FreeSurface(this->clearSurface);
-	SDL_DestroyTexture(this->texture);
+	this->updateRows(fontManager);
 }
 
 int ListBox::getScrollIndex() const
@@ -102,15 +69,12 @@ int ListBox::getScrollIndex() const
 
 int ListBox::getElementCount() const
 {
-	return static_cast<int>(this->textBoxes.size());
+	return static_cast<int>(this->elements.size());
 }
 
 int ListBox::getMaxDisplayedCount() const
 {
-	int height;
-	SDL_QueryTexture(this->getTexture(), nullptr, nullptr, nullptr, &height);
-
-	return height / this->characterHeight;
+	return this->maxDisplayed;
 }
 
 const Int2 &ListBox::getPoint() const
@@ -118,62 +82,65 @@ const Int2 &ListBox::getPoint() const
 	return this->point;
 }
 
-SDL_Texture *ListBox::getTexture() const
-{
-	return this->texture;
-}
-
 bool ListBox::contains(const Int2 &point)
 {
-	int width, height;
-	SDL_QueryTexture(this->texture, nullptr, nullptr, &width, &height);
-
-	Rect rect(this->point.x, this->point.y, width, height);
+	Rect rect(this->point.x, this->point.y, this->width, this->height);
 	return rect.contains(point);
 }
 
 int ListBox::getClickedIndex(const Int2 &point) const
 {
 	// Only the Y component of the point really matters here.
-	const int index = this->scrollIndex + 
+	const int index = this->scrollIndex +
 		((point.y - this->point.y) / this->characterHeight);
 	return index;
 }
 
-void ListBox::updateDisplay()
+void ListBox::updateRows(FontManager &fontManager)
 {
-	// Clear the display texture. Otherwise, remnants of previous text might be left over.
-	SDL_UpdateTexture(this->texture, nullptr, clearSurface->pixels, clearSurface->pitch);
+	const int rowCount = static_cast<int>(this->rows.size());
+	const int indexStart = std::max(this->scrollIndex - ListBox::ROW_MARGIN, 0);
+	const int indexEnd = std::min(this->scrollIndex + this->maxDisplayed + ListBox::ROW_MARGIN,
+		this->getElementCount());
 
-	// Prepare the range of text boxes that will be displayed.
-	const int totalElements = static_cast<int>(this->textBoxes.size());
-	const int maxDisplayed = this->getMaxDisplayedCount();
-	const int indexEnd = std::min(this->scrollIndex + maxDisplayed, totalElements);
-
-	// Draw the relevant text boxes according to scroll index.
-	for (int i = this->scrollIndex; i < indexEnd; i++)
+	// Rows whose element scrolled out of range are reused for the ones coming in.
+	for (int i = indexStart; i < indexEnd; i++)
 	{
-		const SDL_Surface *surface = this->textBoxes.at(i)->getSurface();
-
-		SDL_Rect rect;
-		rect.x = 0;
-		rect.y = (i - this->scrollIndex) * surface->h;
-		rect.w = surface->w;
-		rect.h = surface->h;
-
-		// Update the texture's pixels at the correct height offset.
-		SDL_UpdateTexture(this->texture, &rect, surface->pixels, surface->pitch);
+		Row &row = this->rows[i % rowCount];
+		if (row.elementIndex != i)
+		{
+			row.layout.set(this->elements[i], this->fontName, TextAlignment::Left,
+				fontManager);
+			row.elementIndex = i;
+		}
 	}
 }
 
 void ListBox::scrollUp()
 {
 	this->scrollIndex -= 1;
-	this->updateDisplay();
 }
 
 void ListBox::scrollDown()
 {
 	this->scrollIndex += 1;
-	this->updateDisplay();
+}
+
+void ListBox::draw(TextRenderer &textRenderer, FontManager &fontManager,
+	Renderer &renderer)
+{
+	this->updateRows(fontManager);
+
+	// Draw the elements in view according to scroll index.
+	const int rowCount = static_cast<int>(this->rows.size());
+	const int indexStart = std::max(this->scrollIndex, 0);
+	const int indexEnd = std::min(this->scrollIndex + this->maxDisplayed,
+		this->getElementCount());
+	for (int i = indexStart; i < indexEnd; i++)
+	{
+		const Row &row = this->rows[i % rowCount];
+		const int y = this->point.y + ((i - this->scrollIndex) * this->characterHeight);
+		textRenderer.draw(row.layout, this->point.x, y, this->textColor, fontManager,
+			renderer);
+	}
 }
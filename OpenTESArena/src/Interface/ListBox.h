@@ -1,67 +1,75 @@
 #ifndef LIST_BOX_H
 #define LIST_BOX_H
 
-#include <memory>
 #include <string>
 #include <vector>
 
+#include "TextRenderer.h"
 #include "../Math/Vector2.h"
 #include "../Media/Color.h"
 
-// This class defines a list of displayed text boxes. The index of a clicked text 
-// box can be obtained, and the list can be scrolled up and down. A list box is
-// intended to only be left-aligned.
+// This class defines a list of displayed lines of text. The index of a clicked line
+// can be obtained, and the list can be scrolled up and down. A list box is intended
+// to only be left-aligned.
 
 // Though the index of a selected item can be obtained, this class is not intended
 // for holding data about those selected items. It is simply a view for the text.
 
+// Only the rows around the visible ones are laid out, and they're drawn from the text
+// renderer's glyph atlas, so a long list costs no more to show than a short one. Rows
+// are kept in a ring by element index, so scrolling only lays out the rows coming
+// into range.
+
 class FontManager;
 class Renderer;
-class TextBox;
 
 enum class FontName;
 
-struct SDL_Surface;
-struct SDL_Texture;
-
 class ListBox
 {
 private:
-	std::vector<std::unique_ptr<TextBox>> textBoxes;
+	// Rows laid out above and below the visible ones, so scrolling by a few doesn't
+	// need any new layouts.
+	static const int ROW_MARGIN;
+
+	struct Row
+	{
+		TextRenderer::Layout layout;
+		int elementIndex; // -1 if not laid out.
+	};
+
+	std::vector<std::string> elements;
+	std::vector<Row> rows; // Element i is in row (i % rows.size()) while in range.
 	Color textColor;
 	Int2 point;
 	FontName fontName;
-	SDL_Surface *clearSurface; // For clearing the texture upon updating.
-	SDL_Texture *texture;
+	int width, height;
+	int maxDisplayed;
 	int scrollIndex;
 	int characterHeight;
 
-	// Updates the texture to show the currently visible text boxes.
-	void updateDisplay();
+	// Lays out the rows in range of the scroll index that aren't already.
+	void updateRows(FontManager &fontManager);
 public:
-	ListBox(int x, int y, const Color &textColor, const std::vector<std::string> &elements, 
-		FontName fontName, int maxDisplayed, FontManager &fontManager, Renderer &renderer);
-	~ListBox();
+	ListBox(int x, int y, const Color &textColor, const std::vector<std::string> &elements,
+		FontName fontName, int maxDisplayed, FontManager &fontManager);
 
 	// Gets the index of the top-most displayed element.
 	int getScrollIndex() const;
 
-	// Gets the total number of text boxes (elements) in the list box.
+	// Gets the total number of elements in the list box.
 	int getElementCount() const;
 
-	// Gets the max number of displayed text boxes.
+	// Gets the max number of displayed elements.
 	int getMaxDisplayedCount() const;
 
 	// Gets the top left corner of the list box.
 	const Int2 &getPoint() const;
 
-	// Gets the texture for drawing to the screen.
-	SDL_Texture *getTexture() const;
-
 	// Returns whether the given point is within the bounds of the list box.
 	bool contains(const Int2 &point);
 
-	// Gets the index of a clicked element. ListBox::contains() should be called 
+	// Gets the index of a clicked element. ListBox::contains() should be called
 	// beforehand to make sure the given point is within the list box's bounds.
 	int getClickedIndex(const Int2 &point) const;
 
@@ -69,10 +77,14 @@ public:
 	// it will go out-of-bounds when the scroll index is -1.
 	void scrollUp();
 
-	// Increment the scroll index by one. Without bounds checking on the caller's behalf, 
+	// Increment the scroll index by one. Without bounds checking on the caller's behalf,
 	// it can keep scrolling down for a really long time.
 	void scrollDown();
 
+	// Draws the visible elements in original screen space, laying out any rows that
+	// scrolled into range.
+	void draw(TextRenderer &textRenderer, FontManager &fontManager, Renderer &renderer);
+
 	// Instead of a remove() method, just recreate the list box.
 };
 
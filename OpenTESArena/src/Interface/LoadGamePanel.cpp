@@ -33,7 +33,7 @@ LoadGamePanel::LoadGamePanel(Game &game)
 			// Back button behavior depends on whether game data is active.
 			if (game.gameDataIsActive())
 			{
-				game.setPanel<PauseMenuPanel>(game);
+				game.setPooledPanel<PauseMenuPanel>(game);
 			}
 			else
 			{
@@ -55,6 +55,11 @@ std::pair<SDL_Texture*, CursorAlignment> LoadGamePanel::getCurrentCursor() const
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool LoadGamePanel::isIdle() const
+{
+	return true;
+}
+
 void LoadGamePanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
@@ -0,0 +1,115 @@
+#include <cmath>
+#include <string>
+
+#include "SDL.h"
+
+#include "LoadingPanel.h"
+#include "RichTextString.h"
+#include "TextAlignment.h"
+#include "TextBox.h"
+#include "../Game/Game.h"
+#include "../Game/GameData.h"
+#include "../Media/Color.h"
+#include "../Media/FontManager.h"
+#include "../Media/FontName.h"
+#include "../Media/TextureManager.h"
+#include "../Rendering/Renderer.h"
+#include "../Utilities/LoadProgress.h"
+
+LoadingPanel::LoadingPanel(Game &game, const std::function<void(Game&)> &onLoaded,
+	const std::function<void(Game&)> &onCancelled)
+	: Panel(game), onLoaded(onLoaded), onCancelled(onCancelled)
+{
+	this->texturesPrefetched = false;
+	this->done = false;
+}
+
+void LoadingPanel::handleEvent(const SDL_Event &e)
+{
+	auto &game = this->getGame();
+	const auto &inputManager = game.getInputManager();
+	const bool escapePressed = inputManager.keyPressed(e, SDLK_ESCAPE);
+
+	if (escapePressed && !this->done)
+	{
+		game.getGameData().cancelPreparedWorld();
+		this->done = true;
+		this->onCancelled(game);
+	}
+}
+
+void LoadingPanel::tick(double dt)
+{
+	static_cast<void>(dt);
+
+	if (this->done)
+	{
+		return;
+	}
+
+	auto &game = this->getGame();
+	auto &gameData = game.getGameData();
+	auto &textureManager = game.getTextureManager();
+
+	if (!gameData.preparedWorldIsBuilt())
+	{
+		return;
+	}
+
+	// Decode the textures before the loaded action, so setting the level active only
+	// has to hand them to the renderer.
+	if (!this->texturesPrefetched)
+	{
+		gameData.prefetchPreparedWorld(textureManager);
+		this->texturesPrefetched = true;
+	}
+
+	if (textureManager.getPrefetchCount() == 0)
+	{
+		this->done = true;
+		this->onLoaded(game);
+	}
+}
+
+void LoadingPanel::render(Renderer &renderer)
+{
+	renderer.clear();
+
+	auto &game = this->getGame();
+	const auto &gameData = game.getGameData();
+
+	// The world might already be taken by the loaded action.
+	std::string stageName = "Loading";
+	double stagePercent = 1.0;
+	if (!gameData.preparedWorldIsBuilt())
+	{
+		const LoadProgress &progress = gameData.getPreparedWorldProgress();
+		stageName = progress.getStageName();
+		stagePercent = progress.getStagePercent();
+	}
+	else if (this->texturesPrefetched)
+	{
+		stageName = "Loading textures";
+	}
+
+	const int percent = static_cast<int>(std::round(stagePercent * 100.0));
+	const RichTextString richText(
+		stageName + "... " + std::to_string(percent) + "%\n\nEsc to cancel",
+		FontName::Arena,
+		Color::White,
+		TextAlignment::Center,
+		game.getFontManager());
+
+	const Int2 center(Renderer::ORIGINAL_WIDTH / 2, (Renderer::ORIGINAL_HEIGHT / 2) - 10);
+	const TextBox textBox(center, richText, renderer);
+	renderer.drawOriginal(textBox.getTexture(), textBox.getX(), textBox.getY());
+
+	// Progress bar for the current stage, above the text.
+	const int barWidth = 160;
+	const int barHeight = 6;
+	const int barX = (Renderer::ORIGINAL_WIDTH / 2) - (barWidth / 2);
+	const int barY = textBox.getY() - barHeight - 8;
+	renderer.fillOriginalRect(Color::Gray, barX, barY, barWidth, barHeight);
+	renderer.fillOriginalRect(Color::White, barX, barY,
+		static_cast<int>(barWidth * stagePercent), barHeight);
+}
@@ -0,0 +1,29 @@
+#ifndef LOADING_PANEL_H
+#define LOADING_PANEL_H
+
+#include <functional>
+
+#include "Panel.h"
+
+// Shown while the game data's prepared world is built in the background, so the game
+// loop keeps handling events and drawing. It shows the progress of each load stage, and
+// when the world and its textures are ready, it runs the loaded action (which should take
+// the prepared world and change panels). Escape cancels the load.
+
+class LoadingPanel : public Panel
+{
+private:
+	std::function<void(Game&)> onLoaded, onCancelled;
+	bool texturesPrefetched; // Whether the built world's textures were started yet.
+	bool done; // Whether one of the actions has run.
+public:
+	LoadingPanel(Game &game, const std::function<void(Game&)> &onLoaded,
+		const std::function<void(Game&)> &onCancelled);
+	virtual ~LoadingPanel() = default;
+
+	virtual void handleEvent(const SDL_Event &e) override;
+	virtual void tick(double dt) override;
+	virtual void render(Renderer &renderer) override;
+};
+
+#endif
@@ -34,7 +34,7 @@ LogbookPanel::LogbookPanel(Game &game)
 			Renderer::ORIGINAL_HEIGHT / 2);
 
 		const auto &exeData = game.getMiscAssets().getExeData();
-		const std::string &text = exeData.logbook.logbookIsEmpty;
+		const std::string &text = exeData.getLogbook().logbookIsEmpty;
 
 		const RichTextString richText(
 			text,
@@ -54,12 +54,22 @@ LogbookPanel::LogbookPanel(Game &game)
 
 		auto function = [](Game &game)
 		{
-			game.setPanel<GameWorldPanel>(game);
+			game.setPooledPanel<GameWorldPanel>(game);
 		};
 		return Button<Game&>(center, 34, 14, function);
 	}();
 }
 
+bool LogbookPanel::isPoolable() const
+{
+	return true;
+}
+
+size_t LogbookPanel::getPooledBytes() const
+{
+	return this->titleTextBox->getBytes();
+}
+
 std::pair<SDL_Texture*, CursorAlignment> LogbookPanel::getCurrentCursor() const
 {
 	auto &game = this->getGame();
@@ -71,6 +81,11 @@ std::pair<SDL_Texture*, CursorAlignment> LogbookPanel::getCurrentCursor() const
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool LogbookPanel::isIdle() const
+{
+	return true;
+}
+
 void LogbookPanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
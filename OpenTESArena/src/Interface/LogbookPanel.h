@@ -17,6 +17,9 @@ public:
 	virtual ~LogbookPanel() = default;
 
 	virtual std::pair<SDL_Texture*, CursorAlignment> getCurrentCursor() const override;
+	virtual bool isPoolable() const override;
+	virtual size_t getPooledBytes() const override;
+	virtual bool isIdle() const override;
 	virtual void handleEvent(const SDL_Event &e) override;
 	virtual void render(Renderer &renderer) override;
 };
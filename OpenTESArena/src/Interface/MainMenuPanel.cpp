@@ -89,7 +89,7 @@ namespace
 		else
 		{
 			// Generate the location from the executable data.
-			const auto &staffProvinces = exeData.locations.staffProvinces;
+			const auto &staffProvinces = exeData.getLocations().staffProvinces;
 			const int localDungeonID = testIndex % 2;
 			const int provinceID = staffProvinces.at((testIndex - 1) / 2);
 			return Location::makeDungeon(localDungeonID, provinceID);
@@ -242,7 +242,8 @@ MainMenuPanel::MainMenuPanel(Game &game)
 			auto &renderer = game.getRenderer();
 			const auto &options = game.getOptions();
 			const bool fullGameWindow = options.getModernInterface();
-			renderer.initializeWorldRendering(options.getResolutionScale(), fullGameWindow);
+			renderer.initializeWorldRendering(options.getResolutionScale(), fullGameWindow,
+				options.getHardwareRendering());
 
 			// Game data instance, to be initialized further by one of the loading methods below.
 			// Create a player with random data for testing.
@@ -293,7 +294,7 @@ MainMenuPanel::MainMenuPanel(Game &game)
 
 					// Load city into game data. Location data is loaded, too.
 					gameData->loadCity(localCityID, provinceID, weatherType, miscAssets,
-						game.getTextureManager(), renderer);
+						game.getTextureManager(), renderer, game.getJobSystem());
 				}
 			}
 			else if (worldType == WorldType::Interior)
@@ -730,6 +731,11 @@ std::pair<SDL_Texture*, CursorAlignment> MainMenuPanel::getCurrentCursor() const
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool MainMenuPanel::isIdle() const
+{
+	return true;
+}
+
 void MainMenuPanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
@@ -32,6 +32,11 @@ std::pair<SDL_Texture*, CursorAlignment> MessageBoxSubPanel::getCurrentCursor()
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool MessageBoxSubPanel::isIdle() const
+{
+	return true;
+}
+
 void MessageBoxSubPanel::handleEvent(const SDL_Event &e)
 {
 	auto &game = this->getGame();
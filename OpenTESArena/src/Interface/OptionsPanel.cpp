@@ -301,7 +301,7 @@ OptionsPanel::OptionsPanel(Game &game)
 
 		auto function = [](Game &game)
 		{
-			game.setPanel<PauseMenuPanel>(game);
+			game.setPooledPanel<PauseMenuPanel>(game);
 		};
 		return Button<Game&>(center, 40, 16, function);
 	}();
@@ -342,20 +342,14 @@ OptionsPanel::OptionsPanel(Game &game)
 		const int y = 61;
 		const int width = 8;
 		const int height = 8;
-		auto function = [](OptionsPanel &panel, Options &options, Renderer &renderer)
+		auto function = [](OptionsPanel &panel, Options &options)
 		{
 			const double newResolutionScale = std::min(
 				options.getResolutionScale() + 0.05, options.MAX_RESOLUTION_SCALE);
 			options.setResolutionScale(newResolutionScale);
 			panel.updateResolutionScaleText(newResolutionScale);
-
-			// Resize the game world rendering.
-			const Int2 windowDimensions = renderer.getWindowDimensions();
-			const bool fullGameWindow = options.getModernInterface();
-			renderer.resize(windowDimensions.x, windowDimensions.y,
-				newResolutionScale, fullGameWindow);
 		};
-		return Button<OptionsPanel&, Options&, Renderer&>(x, y, width, height, function);
+		return Button<OptionsPanel&, Options&>(x, y, width, height, function);
 	}();
 
 	this->resolutionScaleDownButton = [this]()
@@ -365,20 +359,14 @@ OptionsPanel::OptionsPanel(Game &game)
 			this->resolutionScaleUpButton.getHeight();
 		const int width = this->resolutionScaleUpButton.getWidth();
 		const int height = this->resolutionScaleUpButton.getHeight();
-		auto function = [](OptionsPanel &panel, Options &options, Renderer &renderer)
+		auto function = [](OptionsPanel &panel, Options &options)
 		{
 			const double newResolutionScale = std::max(
 				options.getResolutionScale() - 0.05, options.MIN_RESOLUTION_SCALE);
 			options.setResolutionScale(newResolutionScale);
 			panel.updateResolutionScaleText(newResolutionScale);
-
-			// Resize the game world rendering.
-			const Int2 windowDimensions = renderer.getWindowDimensions();
-			const bool fullGameWindow = options.getModernInterface();
-			renderer.resize(windowDimensions.x, windowDimensions.y,
-				newResolutionScale, fullGameWindow);
 		};
-		return Button<OptionsPanel&, Options&, Renderer&>(x, y, width, height, function);
+		return Button<OptionsPanel&, Options&>(x, y, width, height, function);
 	}();
 
 	this->playerInterfaceButton = []()
@@ -387,8 +375,7 @@ OptionsPanel::OptionsPanel(Game &game)
 		const int y = 86;
 		const int width = ToggleButtonSize;
 		const int height = ToggleButtonSize;
-		auto function = [](OptionsPanel &panel, Options &options,
-			Player &player, Renderer &renderer)
+		auto function = [](OptionsPanel &panel, Options &options, Player &player)
 		{
 			// Toggle the player interface option.
 			const auto newPlayerInterface = options.getModernInterface() ?
@@ -405,14 +392,8 @@ OptionsPanel::OptionsPanel(Game &game)
 					Double3(groundDirection.x, 0.0, groundDirection.y);
 				player.lookAt(lookAtPoint);
 			}
-
-			// Resize the game world rendering.
-			const Int2 windowDimensions = renderer.getWindowDimensions();
-			const bool fullGameWindow = newPlayerInterface == PlayerInterface::Modern;
-			renderer.resize(windowDimensions.x, windowDimensions.y,
-				options.getResolutionScale(), fullGameWindow);
 		};
-		return Button<OptionsPanel&, Options&, Player&, Renderer&>(x, y, width, height, function);
+		return Button<OptionsPanel&, Options&, Player&>(x, y, width, height, function);
 	}();
 
 	this->verticalFOVUpButton = []()
@@ -485,15 +466,14 @@ OptionsPanel::OptionsPanel(Game &game)
 		const int y = 141;
 		const int width = 8;
 		const int height = 8;
-		auto function = [](OptionsPanel &panel, Options &options, Renderer &renderer)
+		auto function = [](OptionsPanel &panel, Options &options)
 		{
 			const double newLetterboxAspect = std::min(options.getLetterboxAspect() + 0.010,
 				Options::MAX_LETTERBOX_ASPECT);
 			options.setLetterboxAspect(newLetterboxAspect);
 			panel.updateLetterboxAspectText(newLetterboxAspect);
-			renderer.setLetterboxAspect(newLetterboxAspect);
 		};
-		return Button<OptionsPanel&, Options&, Renderer&>(x, y, width, height, function);
+		return Button<OptionsPanel&, Options&>(x, y, width, height, function);
 	}();
 
 	this->letterboxAspectDownButton = [this]()
@@ -503,15 +483,14 @@ OptionsPanel::OptionsPanel(Game &game)
 			this->letterboxAspectUpButton.getHeight();
 		const int width = this->letterboxAspectUpButton.getWidth();
 		const int height = this->letterboxAspectUpButton.getHeight();
-		auto function = [](OptionsPanel &panel, Options &options, Renderer &renderer)
+		auto function = [](OptionsPanel &panel, Options &options)
 		{
 			const double newLetterboxAspect = std::max(options.getLetterboxAspect() - 0.010,
 				Options::MIN_LETTERBOX_ASPECT);
 			options.setLetterboxAspect(newLetterboxAspect);
 			panel.updateLetterboxAspectText(newLetterboxAspect);
-			renderer.setLetterboxAspect(newLetterboxAspect);
 		};
-		return Button<OptionsPanel&, Options&, Renderer&>(x, y, width, height, function);
+		return Button<OptionsPanel&, Options&>(x, y, width, height, function);
 	}();
 
 	this->hSensitivityUpButton = []()
@@ -618,15 +597,14 @@ OptionsPanel::OptionsPanel(Game &game)
 		const int y = 110;
 		const int width = ToggleButtonSize;
 		const int height = ToggleButtonSize;
-		auto function = [](OptionsPanel &panel, Options &options, Renderer &renderer)
+		auto function = [](OptionsPanel &panel, Options &options)
 		{
 			// Toggle the fullscreen option.
 			const bool newFullscreen = !options.getFullscreen();
 			options.setFullscreen(newFullscreen);
-			renderer.setFullscreen(newFullscreen);
 			panel.updateFullscreenText(newFullscreen);
 		};
-		return Button<OptionsPanel&, Options&, Renderer&>(x, y, width, height, function);
+		return Button<OptionsPanel&, Options&>(x, y, width, height, function);
 	}();
 
 	this->soundResamplingButton = []()
@@ -962,6 +940,28 @@ void OptionsPanel::drawTooltip(const std::string &text, Renderer &renderer)
 	renderer.drawOriginal(tooltip.get(), x, y);
 }
 
+bool OptionsPanel::isPoolable() const
+{
+	// The options shown are only changed through this panel, so its text stays current.
+	return true;
+}
+
+size_t OptionsPanel::getPooledBytes() const
+{
+	size_t bytes = 0;
+	for (const std::unique_ptr<TextBox> *textBox : {
+		&this->titleTextBox, &this->backToPauseTextBox, &this->fpsTextBox,
+		&this->resolutionScaleTextBox, &this->playerInterfaceTextBox, &this->verticalFOVTextBox,
+		&this->cursorScaleTextBox, &this->letterboxAspectTextBox, &this->hSensitivityTextBox,
+		&this->vSensitivityTextBox, &this->collisionTextBox, &this->skipIntroTextBox,
+		&this->fullscreenTextBox, &this->soundResamplingTextBox })
+	{
+		bytes += (*textBox)->getBytes();
+	}
+
+	return bytes;
+}
+
 std::pair<SDL_Texture*, CursorAlignment> OptionsPanel::getCurrentCursor() const
 {
 	auto &game = this->getGame();
@@ -973,6 +973,11 @@ std::pair<SDL_Texture*, CursorAlignment> OptionsPanel::getCurrentCursor() const
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool OptionsPanel::isIdle() const
+{
+	return true;
+}
+
 void OptionsPanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
@@ -1002,18 +1007,16 @@ void OptionsPanel::handleEvent(const SDL_Event &e)
 		}
 		else if (this->resolutionScaleUpButton.contains(mouseOriginalPoint))
 		{
-			this->resolutionScaleUpButton.click(*this, this->getGame().getOptions(),
-				this->getGame().getRenderer());
+			this->resolutionScaleUpButton.click(*this, this->getGame().getOptions());
 		}
 		else if (this->resolutionScaleDownButton.contains(mouseOriginalPoint))
 		{
-			this->resolutionScaleDownButton.click(*this, this->getGame().getOptions(),
-				this->getGame().getRenderer());
+			this->resolutionScaleDownButton.click(*this, this->getGame().getOptions());
 		}
 		else if (this->playerInterfaceButton.contains(mouseOriginalPoint))
 		{
 			this->playerInterfaceButton.click(*this, this->getGame().getOptions(),
-				this->getGame().getGameData().getPlayer(), this->getGame().getRenderer());
+				this->getGame().getGameData().getPlayer());
 		}
 		else if (this->verticalFOVUpButton.contains(mouseOriginalPoint))
 		{
@@ -1033,13 +1036,11 @@ void OptionsPanel::handleEvent(const SDL_Event &e)
 		}
 		else if (this->letterboxAspectUpButton.contains(mouseOriginalPoint))
 		{
-			this->letterboxAspectUpButton.click(*this, this->getGame().getOptions(),
-				this->getGame().getRenderer());
+			this->letterboxAspectUpButton.click(*this, this->getGame().getOptions());
 		}
 		else if (this->letterboxAspectDownButton.contains(mouseOriginalPoint))
 		{
-			this->letterboxAspectDownButton.click(*this, this->getGame().getOptions(),
-				this->getGame().getRenderer());
+			this->letterboxAspectDownButton.click(*this, this->getGame().getOptions());
 		}
 		else if (this->hSensitivityUpButton.contains(mouseOriginalPoint))
 		{
@@ -1067,8 +1068,7 @@ void OptionsPanel::handleEvent(const SDL_Event &e)
 		}
 		else if (this->fullscreenButton.contains(mouseOriginalPoint))
 		{
-			this->fullscreenButton.click(*this, this->getGame().getOptions(),
-				this->getGame().getRenderer());
+			this->fullscreenButton.click(*this, this->getGame().getOptions());
 		}
 		else if (this->soundResamplingButton.contains(mouseOriginalPoint))
 		{
@@ -38,12 +38,10 @@ private:
 	Button<OptionsPanel&, Options&> fpsUpButton, fpsDownButton,
 		verticalFOVUpButton, verticalFOVDownButton, cursorScaleUpButton, cursorScaleDownButton,
 		hSensitivityUpButton, hSensitivityDownButton, vSensitivityUpButton, vSensitivityDownButton,
-		collisionButton, skipIntroButton;
-	Button<OptionsPanel&, Options&, Renderer&> resolutionScaleUpButton,
-		resolutionScaleDownButton, letterboxAspectUpButton, letterboxAspectDownButton,
-		fullscreenButton;
+		collisionButton, skipIntroButton, resolutionScaleUpButton, resolutionScaleDownButton,
+		letterboxAspectUpButton, letterboxAspectDownButton, fullscreenButton;
 	Button<OptionsPanel&, Options&, AudioManager&> soundResamplingButton;
-	Button<OptionsPanel&, Options&, Player&, Renderer&> playerInterfaceButton;
+	Button<OptionsPanel&, Options&, Player&> playerInterfaceButton;
 
 	static std::string getPlayerInterfaceString(bool modernInterface);
 	static std::string getSoundResamplingString(int resamplingOption);
@@ -67,6 +65,9 @@ public:
 	virtual ~OptionsPanel() = default;
 
 	virtual std::pair<SDL_Texture*, CursorAlignment> getCurrentCursor() const override;
+	virtual bool isPoolable() const override;
+	virtual size_t getPooledBytes() const override;
+	virtual bool isIdle() const override;
 	virtual void handleEvent(const SDL_Event &e) override;
 	virtual void render(Renderer &renderer) override;
 };
@@ -184,6 +184,34 @@ std::pair<SDL_Texture*, CursorAlignment> Panel::getCurrentCursor() const
 	return std::make_pair(nullptr, CursorAlignment::TopLeft);
 }
 
+bool Panel::isIdle() const
+{
+	// Redrawn every frame by default.
+	return false;
+}
+
+bool Panel::isPoolable() const
+{
+	// Constructed again each time by default.
+	return false;
+}
+
+bool Panel::isOpaque() const
+{
+	// Assumed to let some of the panels beneath show through by default.
+	return false;
+}
+
+size_t Panel::getPooledBytes() const
+{
+	return 0;
+}
+
+void Panel::resume()
+{
+	// Do nothing by default.
+}
+
 void Panel::resize(int windowWidth, int windowHeight)
 {
 	// Do nothing by default.
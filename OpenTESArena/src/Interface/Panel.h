@@ -1,6 +1,7 @@
 #ifndef PANEL_H
 #define PANEL_H
 
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -48,6 +49,29 @@ public:
 	// the texture manager.
 	virtual std::pair<SDL_Texture*, CursorAlignment> getCurrentCursor() const;
 
+	// Returns whether the panel looks the same until the next input event, so the game
+	// loop can wait for events instead of redrawing it every frame. Override this if the
+	// panel only changes in response to events. Panels that animate must not be idle.
+	virtual bool isIdle() const;
+
+	// Returns whether the game may keep this panel suspended after it's replaced, so being
+	// set again with Game::setPooledPanel() resumes it with its textures intact instead of
+	// constructing it. Only panels built from nothing but the game state should be pooled.
+	// False by default.
+	virtual bool isPoolable() const;
+
+	// Returns whether render() covers the whole original screen with opaque pixels, so when
+	// this panel is a sub-panel, the panels beneath it are hidden and aren't drawn. The game
+	// clears the letterbox around it. False by default.
+	virtual bool isOpaque() const;
+
+	// Gets about how many bytes of textures the panel keeps, for the panel pool's budget.
+	virtual size_t getPooledBytes() const;
+
+	// Called when the panel is resumed from the pool. Override this to refresh anything
+	// that could have changed while it was suspended. Does nothing by default.
+	virtual void resume();
+
 	// Handles panel-specific events. Application events like closing and resizing
 	// are handled by the game loop.
 	virtual void handleEvent(const SDL_Event &e) = 0;
@@ -159,7 +159,7 @@ PauseMenuPanel::PauseMenuPanel(Game &game)
 		const int y = 118;
 		auto function = [](Game &game)
 		{
-			game.setPanel<GameWorldPanel>(game);
+			game.setPooledPanel<GameWorldPanel>(game);
 		};
 		return Button<Game&>(x, y, 64, 29, function);
 	}();
@@ -170,7 +170,7 @@ PauseMenuPanel::PauseMenuPanel(Game &game)
 		const int y = 89;
 		auto function = [](Game &game)
 		{
-			game.setPanel<OptionsPanel>(game);
+			game.setPooledPanel<OptionsPanel>(game);
 		};
 		return Button<Game&>(x, y, 145, 14, function);
 	}();
@@ -284,6 +284,19 @@ void PauseMenuPanel::updateSoundText(double volume)
 	}();
 }
 
+bool PauseMenuPanel::isPoolable() const
+{
+	return true;
+}
+
+size_t PauseMenuPanel::getPooledBytes() const
+{
+	return this->playerNameTextBox->getBytes() +
+		this->musicTextBox->getBytes() +
+		this->soundTextBox->getBytes() +
+		this->optionsTextBox->getBytes();
+}
+
 std::pair<SDL_Texture*, CursorAlignment> PauseMenuPanel::getCurrentCursor() const
 {
 	auto &game = this->getGame();
@@ -295,6 +308,11 @@ std::pair<SDL_Texture*, CursorAlignment> PauseMenuPanel::getCurrentCursor() cons
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool PauseMenuPanel::isIdle() const
+{
+	return true;
+}
+
 void PauseMenuPanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
@@ -385,35 +403,38 @@ void PauseMenuPanel::render(Renderer &renderer)
 	const auto &player = this->getGame().getGameData().getPlayer();
 	const auto &headsFilename = PortraitFile::getHeads(
 		player.getGenderName(), player.getRaceID(), true);
-	const auto &portrait = textureManager.getTextures(
-		headsFilename, renderer).at(player.getPortraitID());
-	const auto &status = textureManager.getTextures(
-		TextureFile::fromName(TextureName::StatusGradients), renderer).at(0);
-	renderer.drawOriginal(status.get(), 14, 166);
-	renderer.drawOriginal(portrait.get(), 14, 166);
+	const std::string &paletteName = PaletteFile::fromName(PaletteName::Default);
+	const auto portrait = textureManager.getAtlasRegion(
+		headsFilename, paletteName, player.getPortraitID(), renderer);
+	const auto status = textureManager.getAtlasRegion(
+		TextureFile::fromName(TextureName::StatusGradients), paletteName, 0, renderer);
+	this->interfaceBatch.add(status, 14, 166);
+	this->interfaceBatch.add(portrait, 14, 166);
 
 	// If the player's class can't use magic, show the darkened spell icon.
 	if (!player.getCharacterClass().canCastMagic())
 	{
-		const auto &nonMagicIcon = textureManager.getTexture(
+		const auto nonMagicIcon = textureManager.getAtlasRegion(
 			TextureFile::fromName(TextureName::NoSpell), renderer);
-		renderer.drawOriginal(nonMagicIcon.get(), 91, 177);
+		this->interfaceBatch.add(nonMagicIcon, 91, 177);
 	}
 
 	// Cover up the detail slider with a new options background.
 	Texture optionsBackground(Texture::generate(Texture::PatternType::Custom1,
 		this->optionsButton.getWidth(), this->optionsButton.getHeight(),
 		textureManager, renderer));
-	renderer.drawOriginal(optionsBackground.get(), this->optionsButton.getX(),
+	this->interfaceBatch.add(optionsBackground.get(), this->optionsButton.getX(),
 		this->optionsButton.getY());
 
 	// Draw text: player's name, music volume, sound volume, options.
-	renderer.drawOriginal(this->playerNameTextBox->getTexture(),
+	this->interfaceBatch.add(this->playerNameTextBox->getTexture(),
 		this->playerNameTextBox->getX(), this->playerNameTextBox->getY());
-	renderer.drawOriginal(this->musicTextBox->getTexture(),
+	this->interfaceBatch.add(this->musicTextBox->getTexture(),
 		this->musicTextBox->getX(), this->musicTextBox->getY());
-	renderer.drawOriginal(this->soundTextBox->getTexture(),
+	this->interfaceBatch.add(this->soundTextBox->getTexture(),
 		this->soundTextBox->getX(), this->soundTextBox->getY());
-	renderer.drawOriginal(this->optionsTextBox->getTexture(),
+	this->interfaceBatch.add(this->optionsTextBox->getTexture(),
 		this->optionsTextBox->getX() - 1, this->optionsTextBox->getY());
+
+	this->interfaceBatch.flush(renderer);
 }
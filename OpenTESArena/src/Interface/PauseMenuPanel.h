@@ -5,6 +5,7 @@
 
 #include "Button.h"
 #include "Panel.h"
+#include "../Rendering/InterfaceBatch.h"
 
 class AudioManager;
 class Options;
@@ -20,6 +21,7 @@ private:
 	Button<Game&> newButton, saveButton, resumeButton, optionsButton;
 	Button<Options&, AudioManager&, PauseMenuPanel&> musicUpButton,
 		musicDownButton, soundUpButton, soundDownButton;
+	InterfaceBatch interfaceBatch;
 
 	void updateMusicText(double volume);
 	void updateSoundText(double volume);
@@ -28,6 +30,9 @@ public:
 	virtual ~PauseMenuPanel() = default;
 
 	virtual std::pair<SDL_Texture*, CursorAlignment> getCurrentCursor() const override;
+	virtual bool isPoolable() const override;
+	virtual size_t getPooledBytes() const override;
+	virtual bool isIdle() const override;
 	virtual void handleEvent(const SDL_Event &e) override;
 	virtual void render(Renderer &renderer) override;
 };
@@ -8,6 +8,7 @@
 
 #include "CursorAlignment.h"
 #include "GameWorldPanel.h"
+#include "LoadingPanel.h"
 #include "ProvinceButtonName.h"
 #include "ProvinceMapPanel.h"
 #include "RichTextString.h"
@@ -76,11 +77,23 @@ namespace
 	};
 }
 
-ProvinceMapPanel::TravelData::TravelData(int locationID, int provinceID, int travelDays)
+ProvinceMapPanel::TravelData::TravelData(int locationID, int provinceID, int travelDays,
+	WeatherType weatherType)
 {
 	this->locationID = locationID;
 	this->provinceID = provinceID;
 	this->travelDays = travelDays;
+	this->weatherType = weatherType;
+}
+
+bool ProvinceMapPanel::LocationLayerKey::operator==(const LocationLayerKey &other) const
+{
+	return (this->cityStateTexture == other.cityStateTexture) &&
+		(this->townTexture == other.townTexture) &&
+		(this->villageTexture == other.villageTexture) &&
+		(this->dungeonTexture == other.dungeonTexture) &&
+		(this->staffDungeonTexture == other.staffDungeonTexture) &&
+		(this->visibleLocations == other.visibleLocations);
 }
 
 const double ProvinceMapPanel::BLINK_PERIOD = 1.0 / 5.0;
@@ -125,7 +138,7 @@ ProvinceMapPanel::ProvinceMapPanel(Game &game, int provinceID,
 				const auto &exeData = game.getMiscAssets().getExeData();
 				const std::string errorText = [&exeData]()
 				{
-					std::string text = exeData.travel.noDestination;
+					std::string text = exeData.getTravel().noDestination;
 
 					// Remove carriage return at end.
 					text.pop_back();
@@ -171,6 +184,12 @@ ProvinceMapPanel::ProvinceMapPanel(Game &game, int provinceID,
 		const std::string &cifName = TextureFile::fromName(TextureName::StaffDungeonIcons);
 		this->staffDungeonCif = std::make_unique<CIFFile>(cifName, this->provinceMapPalette);
 	}
+
+	// Build the routes from the player's location while they pick a destination.
+	auto &gameData = game.getGameData();
+	gameData.getTravelRoutes().prepare(this->getCurrentLocationID(),
+		gameData.getLocation().provinceID, gameData.getCityDataFile(), game.getMiscAssets(),
+		game.getJobSystem());
 }
 
 std::pair<SDL_Texture*, CursorAlignment> ProvinceMapPanel::getCurrentCursor() const
@@ -223,42 +242,7 @@ void ProvinceMapPanel::handleEvent(const SDL_Event &e)
 			// Check locations for clicks. Get the current location to compare with.
 			auto &gameData = game.getGameData();
 			const auto &currentLocation = gameData.getLocation();
-			const int currentLocationID = [&currentLocation]()
-			{
-				if (currentLocation.dataType == LocationDataType::City)
-				{
-					return Location::cityToLocationID(currentLocation.localCityID);
-				}
-				else if (currentLocation.dataType == LocationDataType::Dungeon)
-				{
-					return Location::dungeonToLocationID(currentLocation.localDungeonID);
-				}
-				else if (currentLocation.dataType == LocationDataType::SpecialCase)
-				{
-					const Location::SpecialCaseType specialCaseType =
-						currentLocation.specialCaseType;
-
-					if (specialCaseType == Location::SpecialCaseType::StartDungeon)
-					{
-						// Technically this shouldn't be allowed, so just use a placeholder.
-						return Location::dungeonToLocationID(0);
-					}
-					else if (specialCaseType == Location::SpecialCaseType::WildDungeon)
-					{
-						return Location::cityToLocationID(currentLocation.localCityID);
-					}
-					else
-					{
-						throw std::runtime_error("Bad special location type \"" +
-							std::to_string(static_cast<int>(specialCaseType)) + "\".");
-					}
-				}
-				else
-				{
-					throw std::runtime_error("Bad location data type \"" +
-						std::to_string(static_cast<int>(currentLocation.dataType)) + "\".");
-				}
-			}();
+			const int currentLocationID = this->getCurrentLocationID();
 
 			const int closestLocationID = this->getClosestLocationID(originalPosition);
 
@@ -273,14 +257,21 @@ void ProvinceMapPanel::handleEvent(const SDL_Event &e)
 				const auto &miscAssets = game.getMiscAssets();
 				const auto &cityData = gameData.getCityDataFile();
 				const Date &currentDate = gameData.getDate();
-				const int travelDays = cityData.getTravelDays(
+				const int travelDays = gameData.getTravelRoutes().getTravelDays(
 					currentLocationID, currentLocation.provinceID,
 					closestLocationID, this->provinceID, currentDate.getMonth(),
-					gameData.getWeathersArray(), gameData.getRandom(), miscAssets);
+					gameData.getWeathersArray(), gameData.getRandom(), cityData, miscAssets);
+				// To do: get weather type from MiscAssets + global quarter + season + variant.
+				Random random;
+				const WeatherType weatherType = static_cast<WeatherType>(random.next(8));
+
 				this->travelData = std::make_unique<TravelData>(
-					closestLocationID, this->provinceID, travelDays);
+					closestLocationID, this->provinceID, travelDays, weatherType);
 				this->blinkTimer = 0.0;
 
+				// The player will most likely travel there next.
+				this->prepareFastTravel(*this->travelData.get());
+
 				// Create pop-up travel dialog.
 				const std::string travelText = this->makeTravelText(currentLocationID,
 					currentLocation, closestLocationID, *this->travelData.get());
@@ -294,7 +285,7 @@ void ProvinceMapPanel::handleEvent(const SDL_Event &e)
 				{
 					const auto &cityData = gameData.getCityDataFile();
 					const auto &exeData = game.getMiscAssets().getExeData();
-					std::string text = exeData.travel.alreadyAtDestination;
+					std::string text = exeData.getTravel().alreadyAtDestination;
 
 					// Remove carriage return at end.
 					text.pop_back();
@@ -319,7 +310,7 @@ void ProvinceMapPanel::handleEvent(const SDL_Event &e)
 std::string ProvinceMapPanel::getBackgroundFilename() const
 {
 	const auto &exeData = this->getGame().getMiscAssets().getExeData();
-	const auto &provinceImgFilenames = exeData.locations.provinceImgFilenames;
+	const auto &provinceImgFilenames = exeData.getLocations().provinceImgFilenames;
 	const std::string &filename = provinceImgFilenames.at(this->provinceID);
 
 	// Set all characters to uppercase because the texture manager expects 
@@ -327,42 +318,50 @@ std::string ProvinceMapPanel::getBackgroundFilename() const
 	return String::toUppercase(filename);
 }
 
-int ProvinceMapPanel::getClosestLocationID(const Int2 &originalPosition) const
+int ProvinceMapPanel::getCurrentLocationID() const
 {
-	// Initialize the current closest position to something very far away (watch out for
-	// integer multiplication overflow with closest distance).
-	Int2 closestPosition(-1000, -1000);
-
-	// Lambda for comparing distances of two location points to the mouse position.
-	auto closerThanCurrentClosest = [&originalPosition, &closestPosition](const Int2 &point)
+	const auto &currentLocation = this->getGame().getGameData().getLocation();
+	if (currentLocation.dataType == LocationDataType::City)
 	{
-		const Int2 diff = point - originalPosition;
-		const Int2 closestDiff = closestPosition - originalPosition;
-		const double distance = std::sqrt((diff.x * diff.x) + (diff.y * diff.y));
-		const double closestDistance = std::sqrt(
-			(closestDiff.x * closestDiff.x) + (closestDiff.y * closestDiff.y));
-		return distance < closestDistance;
-	};
-
-	// Look through all visible locations to find the one closest to the mouse.
-	int closestID = -1;
-	const auto &cityData = this->getGame().getGameData().getCityDataFile();
-	const auto &provinceData = cityData.getProvinceData(this->provinceID);
-	for (int i = 0; i < 48; i++)
+		return Location::cityToLocationID(currentLocation.localCityID);
+	}
+	else if (currentLocation.dataType == LocationDataType::Dungeon)
+	{
+		return Location::dungeonToLocationID(currentLocation.localDungeonID);
+	}
+	else if (currentLocation.dataType == LocationDataType::SpecialCase)
 	{
-		const auto &locationData = provinceData.getLocationData(i);
+		const Location::SpecialCaseType specialCaseType =
+			currentLocation.specialCaseType;
 
-		if (locationData.isVisible())
+		if (specialCaseType == Location::SpecialCaseType::StartDungeon)
 		{
-			const Int2 point(locationData.x, locationData.y);
-
-			if (closerThanCurrentClosest(point))
-			{
-				closestPosition = point;
-				closestID = i;
-			}
+			// Technically this shouldn't be allowed, so just use a placeholder.
+			return Location::dungeonToLocationID(0);
+		}
+		else if (specialCaseType == Location::SpecialCaseType::WildDungeon)
+		{
+			return Location::cityToLocationID(currentLocation.localCityID);
+		}
+		else
+		{
+			throw std::runtime_error("Bad special location type \"" +
+				std::to_string(static_cast<int>(specialCaseType)) + "\".");
 		}
 	}
+	else
+	{
+		throw std::runtime_error("Bad location data type \"" +
+			std::to_string(static_cast<int>(currentLocation.dataType)) + "\".");
+	}
+}
+
+int ProvinceMapPanel::getClosestLocationID(const Int2 &originalPosition) const
+{
+	// The province's location cells only look at locations near the mouse.
+	const auto &cityData = this->getGame().getGameData().getCityDataFile();
+	const auto &provinceData = cityData.getProvinceData(this->provinceID);
+	const int closestID = provinceData.getClosestVisibleLocationID(originalPosition);
 
 	DebugAssert(closestID >= 0, "No closest location ID found.");
 	return closestID;
@@ -404,7 +403,7 @@ std::string ProvinceMapPanel::makeTravelText(int currentLocationID,
 				if (closestLocationID < 32)
 				{
 					// City format.
-					std::string text = exeData.travel.locationFormatTexts.at(2);
+					std::string text = exeData.getTravel().locationFormatTexts.at(2);
 
 					// Replace first %s with location type.
 					const std::string &locationTypeName = [&exeData, closestLocationID]()
@@ -412,17 +411,17 @@ std::string ProvinceMapPanel::makeTravelText(int currentLocationID,
 						if (closestLocationID < 8)
 						{
 							// City.
-							return exeData.locations.locationTypes.front();
+							return exeData.getLocations().locationTypes.front();
 						}
 						else if (closestLocationID < 16)
 						{
 							// Town.
-							return exeData.locations.locationTypes.at(1);
+							return exeData.getLocations().locationTypes.at(1);
 						}
 						else
 						{
 							// Village.
-							return exeData.locations.locationTypes.at(2);
+							return exeData.getLocations().locationTypes.at(2);
 						}
 					}();
 
@@ -442,7 +441,7 @@ std::string ProvinceMapPanel::makeTravelText(int currentLocationID,
 				else
 				{
 					// Dungeon format.
-					std::string text = exeData.travel.locationFormatTexts.at(0);
+					std::string text = exeData.getTravel().locationFormatTexts.at(0);
 
 					// Replace first %s with dungeon name.
 					size_t index = text.find("%s");
@@ -458,7 +457,7 @@ std::string ProvinceMapPanel::makeTravelText(int currentLocationID,
 			else
 			{
 				// Center province format (always the center city).
-				std::string text = exeData.travel.locationFormatTexts.at(1);
+				std::string text = exeData.getTravel().locationFormatTexts.at(1);
 
 				// Replace first %s with center province city name.
 				size_t index = text.find("%s");
@@ -480,7 +479,7 @@ std::string ProvinceMapPanel::makeTravelText(int currentLocationID,
 	// Lambda for getting the date string for a given date.
 	auto getDateString = [&exeData](const Date &date)
 	{
-		std::string text = exeData.status.date;
+		std::string text = exeData.getStatus().date;
 
 		// Replace carriage returns with newlines.
 		text = String::replace(text, '\r', '\n');
@@ -490,7 +489,7 @@ std::string ProvinceMapPanel::makeTravelText(int currentLocationID,
 
 		// Replace first %s with weekday.
 		const std::string &weekdayString =
-			exeData.calendar.weekdayNames.at(date.getWeekday());
+			exeData.getCalendar().weekdayNames.at(date.getWeekday());
 		size_t index = text.find("%s");
 		text = text.replace(index, 2, weekdayString);
 
@@ -501,7 +500,7 @@ std::string ProvinceMapPanel::makeTravelText(int currentLocationID,
 
 		// Replace third %s with month.
 		const std::string &monthString =
-			exeData.calendar.monthNames.at(date.getMonth());
+			exeData.getCalendar().monthNames.at(date.getMonth());
 		index = text.find("%s");
 		text = text.replace(index, 2, monthString);
 
@@ -515,7 +514,7 @@ std::string ProvinceMapPanel::makeTravelText(int currentLocationID,
 	const std::string startDateString = [&exeData, &getDateString, &currentDate]()
 	{
 		// The date prefix is shared between the province map pop-up and the arrival pop-up.
-		const std::string datePrefix = exeData.travel.arrivalPopUpDate;
+		const std::string datePrefix = exeData.getTravel().arrivalPopUpDate;
 
 		// Replace carriage returns with newlines.
 		return String::replace(datePrefix + getDateString(currentDate), '\r', '\n');
@@ -523,10 +522,10 @@ std::string ProvinceMapPanel::makeTravelText(int currentLocationID,
 
 	const std::string dayString = [&exeData, &travelData]()
 	{
-		const std::string &dayStringPrefix = exeData.travel.dayPrediction.front();
+		const std::string &dayStringPrefix = exeData.getTravel().dayPrediction.front();
 		const std::string dayStringBody = [&exeData, &travelData]()
 		{
-			std::string text = exeData.travel.dayPrediction.back();
+			std::string text = exeData.getTravel().dayPrediction.back();
 
 			// Replace %d with travel days.
 			const size_t index = text.find("%d");
@@ -561,7 +560,7 @@ std::string ProvinceMapPanel::makeTravelText(int currentLocationID,
 
 	const std::string distanceString = [&exeData, travelDistance]()
 	{
-		std::string text = exeData.travel.distancePrediction;
+		std::string text = exeData.getTravel().distancePrediction;
 
 		// Replace %d with travel distance.
 		const size_t index = text.find("%d");
@@ -573,7 +572,7 @@ std::string ProvinceMapPanel::makeTravelText(int currentLocationID,
 
 	const std::string arrivalDateString = [&exeData, &getDateString, &destinationDate]()
 	{
-		const std::string text = exeData.travel.arrivalDatePrediction;
+		const std::string text = exeData.getTravel().arrivalDatePrediction;
 
 		// Replace carriage returns with newlines.
 		return String::replace(text + getDateString(destinationDate), '\r', '\n');
@@ -630,8 +629,32 @@ void ProvinceMapPanel::tick(double dt)
 void ProvinceMapPanel::handleFastTravel(const ProvinceMapPanel::TravelData &travelData) const
 {
 	auto &game = this->getGame();
+
+	// The destination is built in the background while a loading panel is shown. It was
+	// most likely started already when the destination was selected.
+	this->prepareFastTravel(travelData);
+
+	const ProvinceMapPanel::TravelData loadedTravelData = travelData;
+	auto onLoaded = [loadedTravelData](Game &game)
+	{
+		ProvinceMapPanel::finishFastTravel(game, loadedTravelData);
+	};
+
+	// Nothing has changed yet, so cancelling goes back to the province map as it was.
+	auto onCancelled = [loadedTravelData](Game &game)
+	{
+		game.setPanel<ProvinceMapPanel>(game, loadedTravelData.provinceID,
+			std::make_unique<ProvinceMapPanel::TravelData>(loadedTravelData));
+	};
+
+	game.setPanel<LoadingPanel>(game, onLoaded, onCancelled);
+}
+
+void ProvinceMapPanel::finishFastTravel(Game &game,
+	const ProvinceMapPanel::TravelData &travelData)
+{
 	auto &gameData = game.getGameData();
-	const int provinceID = this->provinceID;
+	const int provinceID = travelData.provinceID;
 	Random random;
 
 	// Tick the game date by the number of travel days.
@@ -649,18 +672,17 @@ void ProvinceMapPanel::handleFastTravel(const ProvinceMapPanel::TravelData &trav
 	const int locationID = travelData.locationID;
 	if (locationID < 32)
 	{
-		// To do: get weather type from MiscAssets + global quarter + season + variant.
-		const WeatherType weatherType = static_cast<WeatherType>(random.next(8));
+		const WeatherType weatherType = travelData.weatherType;
 
 		// Load the destination city. For the center province, use the specialized method.
 		if (provinceID != 8)
 		{
-			gameData.loadCity(locationID, provinceID, weatherType,
-				game.getMiscAssets(), game.getTextureManager(), game.getRenderer());
+			gameData.loadCity(locationID, provinceID, weatherType, game.getMiscAssets(),
+				game.getTextureManager(), game.getRenderer(), game.getJobSystem());
 		}
 		else
 		{
-			const MIFFile mif("IMPERIAL.MIF");
+			const MIFFile &mif = MIFFile::get("IMPERIAL.MIF");
 			gameData.loadPremadeCity(mif, weatherType, game.getMiscAssets(),
 				game.getTextureManager(), game.getRenderer());
 		}
@@ -679,7 +701,7 @@ void ProvinceMapPanel::handleFastTravel(const ProvinceMapPanel::TravelData &trav
 			const auto &cityData = gameData.getCityDataFile();
 			const uint32_t dungeonSeed = cityData.getDungeonSeed(localDungeonID, provinceID);
 			const std::string mifName = CityDataFile::getMainQuestDungeonMifName(dungeonSeed);
-			const MIFFile mif(mifName);
+			const MIFFile &mif = MIFFile::get(mifName);
 			const Location location = Location::makeDungeon(localDungeonID, provinceID);
 			gameData.loadInterior(mif, location,
 				game.getTextureManager(), game.getRenderer());
@@ -699,6 +721,49 @@ void ProvinceMapPanel::handleFastTravel(const ProvinceMapPanel::TravelData &trav
 	game.setPanel<GameWorldPanel>(game);
 }
 
+void ProvinceMapPanel::prepareFastTravel(const ProvinceMapPanel::TravelData &travelData) const
+{
+	auto &game = this->getGame();
+	auto &gameData = game.getGameData();
+	auto &textureManager = game.getTextureManager();
+	auto &jobSystem = game.getJobSystem();
+	const int provinceID = travelData.provinceID;
+
+	// Same choice of location as handleFastTravel().
+	const int locationID = travelData.locationID;
+	if (locationID < 32)
+	{
+		if (provinceID != 8)
+		{
+			gameData.prepareCity(locationID, provinceID, travelData.weatherType,
+				game.getMiscAssets(), textureManager, jobSystem);
+		}
+		else
+		{
+			gameData.preparePremadeCity("IMPERIAL.MIF", travelData.weatherType,
+				game.getMiscAssets(), textureManager, jobSystem);
+		}
+	}
+	else
+	{
+		const int localDungeonID = locationID - 32;
+
+		if ((localDungeonID == 0) || (localDungeonID == 1))
+		{
+			const auto &cityData = gameData.getCityDataFile();
+			const uint32_t dungeonSeed = cityData.getDungeonSeed(localDungeonID, provinceID);
+			gameData.prepareInterior(CityDataFile::getMainQuestDungeonMifName(dungeonSeed),
+				textureManager, jobSystem);
+		}
+		else
+		{
+			const bool isArtifactDungeon = false;
+			gameData.prepareNamedDungeon(localDungeonID, provinceID, isArtifactDungeon,
+				textureManager, jobSystem);
+		}
+	}
+}
+
 void ProvinceMapPanel::drawCenteredIcon(const Texture &texture,
 	const Int2 &point, Renderer &renderer)
 {
@@ -710,18 +775,6 @@ void ProvinceMapPanel::drawCenteredIcon(const Texture &texture,
 void ProvinceMapPanel::drawVisibleLocations(const std::string &backgroundFilename,
 	TextureManager &textureManager, Renderer &renderer)
 {
-	// Lambda for drawing a location icon if it's visible.
-	auto drawIconIfVisible = [this, &renderer](
-		const CityDataFile::ProvinceData::LocationData &location, const Texture &icon)
-	{
-		// Only draw visible locations.
-		if (location.isVisible())
-		{
-			const Int2 point(location.x, location.y);
-			this->drawCenteredIcon(icon, point, renderer);
-		}
-	};
-
 	const auto &cityStateIcon = textureManager.getTexture(
 		TextureFile::fromName(TextureName::CityStateIcon), backgroundFilename, renderer);
 	const auto &townIcon = textureManager.getTexture(
@@ -731,9 +784,54 @@ void ProvinceMapPanel::drawVisibleLocations(const std::string &backgroundFilenam
 	const auto &dungeonIcon = textureManager.getTexture(
 		TextureFile::fromName(TextureName::DungeonIcon), backgroundFilename, renderer);
 
+	// Only draw staff dungeon if not the center province.
+	const Texture *staffDungeonIcon = (this->provinceID != 8) ?
+		&textureManager.getTextures(TextureFile::fromName(TextureName::StaffDungeonIcons),
+			backgroundFilename, renderer).at(this->provinceID) : nullptr;
+
 	const auto &cityData = this->getGame().getGameData().getCityDataFile();
 	const auto &province = cityData.getProvinceData(this->provinceID);
 
+	LocationLayerKey layerKey;
+	layerKey.cityStateTexture = cityStateIcon.get();
+	layerKey.townTexture = townIcon.get();
+	layerKey.villageTexture = villageIcon.get();
+	layerKey.dungeonTexture = dungeonIcon.get();
+	layerKey.staffDungeonTexture = (staffDungeonIcon != nullptr) ?
+		staffDungeonIcon->get() : nullptr;
+	layerKey.visibleLocations = 0;
+
+	for (int i = 0; i < 48; i++)
+	{
+		if (province.getLocationData(i).isVisible())
+		{
+			layerKey.visibleLocations |= static_cast<uint64_t>(1) << i;
+		}
+	}
+
+	if (this->locationLayer.isValid() && (layerKey == this->locationLayerKey))
+	{
+		this->locationLayer.present(renderer);
+		return;
+	}
+
+	this->locationLayer.init(0, 0, Renderer::ORIGINAL_WIDTH, Renderer::ORIGINAL_HEIGHT,
+		renderer);
+	this->locationLayer.begin(renderer);
+
+	// Lambda for drawing a location icon into the layer if it's visible.
+	auto drawIconIfVisible = [this, &renderer](
+		const CityDataFile::ProvinceData::LocationData &location, const Texture &icon)
+	{
+		// Only draw visible locations.
+		if (location.isVisible())
+		{
+			this->locationLayer.draw(icon.get(),
+				location.x - (icon.getWidth() / 2),
+				location.y - (icon.getHeight() / 2), renderer);
+		}
+	};
+
 	// Draw city-state icons.
 	for (const auto &cityState : province.cityStates)
 	{
@@ -755,19 +853,18 @@ void ProvinceMapPanel::drawVisibleLocations(const std::string &backgroundFilenam
 	// Draw dungeon icons.
 	drawIconIfVisible(province.firstDungeon, dungeonIcon);
 
-	if (this->provinceID != 8)
+	if (staffDungeonIcon != nullptr)
 	{
-		// Only draw staff dungeon if not the center province.
-		const auto &staffDungeonIcon = textureManager.getTextures(
-			TextureFile::fromName(TextureName::StaffDungeonIcons),
-			backgroundFilename, renderer).at(this->provinceID);
-		drawIconIfVisible(province.secondDungeon, staffDungeonIcon);
+		drawIconIfVisible(province.secondDungeon, *staffDungeonIcon);
 	}
 
 	for (const auto &dungeon : province.randomDungeons)
 	{
 		drawIconIfVisible(dungeon, dungeonIcon);
 	}
+
+	this->locationLayerKey = layerKey;
+	this->locationLayer.present(renderer);
 }
 
 void ProvinceMapPanel::drawLocationHighlight(const Location &location,
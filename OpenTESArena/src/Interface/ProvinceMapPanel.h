@@ -1,6 +1,7 @@
 #ifndef PROVINCE_MAP_PANEL_H
 #define PROVINCE_MAP_PANEL_H
 
+#include <cstdint>
 #include <string>
 
 #include "Button.h"
@@ -8,13 +9,17 @@
 #include "../Assets/CIFFile.h"
 #include "../Math/Vector2.h"
 #include "../Media/Palette.h"
+#include "../Rendering/RenderLayer.h"
 
 class Location;
 class Renderer;
 class Texture;
 class TextureManager;
 
+struct SDL_Texture;
+
 enum class ProvinceButtonName;
+enum class WeatherType;
 
 class ProvinceMapPanel : public Panel
 {
@@ -25,7 +30,11 @@ public:
 	{
 		int locationID, provinceID, travelDays;
 
-		TravelData(int locationID, int provinceID, int travelDays);
+		// Chosen along with the destination, so the destination can be prepared ahead of
+		// the travel itself.
+		WeatherType weatherType;
+
+		TravelData(int locationID, int provinceID, int travelDays, WeatherType weatherType);
 	};
 private:
 	// Current is where the player is. Selected is which location (if any) has been selected.
@@ -34,18 +43,34 @@ private:
 	static const double BLINK_PERIOD; // Duration of blink period in seconds.
 	static const double BLINK_PERIOD_PERCENT_ON; // Percentage of each period spent "on".
 
+	// What went into the cached location icon layer, so it's only composed again when a
+	// location's visibility or one of the icon textures changes.
+	struct LocationLayerKey
+	{
+		SDL_Texture *cityStateTexture, *townTexture, *villageTexture, *dungeonTexture,
+			*staffDungeonTexture;
+		uint64_t visibleLocations; // One bit per location ID.
+
+		bool operator==(const LocationLayerKey &other) const;
+	};
+
 	Button<> searchButton;
 	Button<Game&, ProvinceMapPanel&> travelButton;
 	Button<Game&, std::unique_ptr<ProvinceMapPanel::TravelData>> backToWorldMapButton;
 	std::unique_ptr<CIFFile> staffDungeonCif; // For obtaining palette indices.
 	std::unique_ptr<TravelData> travelData;
 	Palette provinceMapPalette;
+	RenderLayer locationLayer; // Icons of visible locations.
+	LocationLayerKey locationLayerKey;
 	double blinkTimer;
 	int provinceID;
 
 	// Gets the .IMG filename of the background image.
 	std::string getBackgroundFilename() const;
 
+	// Gets the location ID of the player's current location within its province.
+	int getCurrentLocationID() const;
+
 	// Gets the location ID of the location closest to the mouse in 320x200 space.
 	int getClosestLocationID(const Int2 &originalPosition) const;
 
@@ -63,10 +88,19 @@ private:
 	// and changing to the game world panel.
 	void handleFastTravel(const ProvinceMapPanel::TravelData &travelData) const;
 
+	// Loads the target destination once it's been prepared, and changes to the game world
+	// panel. Static, since the loading panel has replaced this panel by then.
+	static void finishFastTravel(Game &game, const ProvinceMapPanel::TravelData &travelData);
+
+	// Starts building the target destination in the background, so fast traveling to it
+	// doesn't have to build it all at once.
+	void prepareFastTravel(const ProvinceMapPanel::TravelData &travelData) const;
+
 	// Draws an icon (i.e., location or highlight) centered at the given point.
 	void drawCenteredIcon(const Texture &texture, const Int2 &point, Renderer &renderer);
 
-	// Draws the icons of all visible locations in the province.
+	// Draws the icons of all visible locations in the province, composing the location
+	// layer again if needed.
 	void drawVisibleLocations(const std::string &backgroundFilename,
 		TextureManager &textureManager, Renderer &renderer);
 
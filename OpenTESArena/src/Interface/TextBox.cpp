@@ -192,6 +192,12 @@ const RichTextString &TextBox::getRichText() const
 	return this->richText;
 }
 
+size_t TextBox::getBytes() const
+{
+	const SDL_Surface *surface = this->surface.get();
+	return static_cast<size_t>(surface->w * surface->h) * sizeof(uint32_t) * 2;
+}
+
 Rect TextBox::getRect() const
 {
 	return Rect(this->x, this->y, this->surface.get()->w, this->surface.get()->h);
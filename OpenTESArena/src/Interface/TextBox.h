@@ -1,6 +1,7 @@
 #ifndef TEXT_BOX_H
 #define TEXT_BOX_H
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -32,7 +33,7 @@ public:
 	};
 private:
 	RichTextString richText;
-	Surface surface; // For ListBox compatibility. Identical to "texture".
+	Surface surface; // For callers that read its pixels or size. Identical to "texture".
 	Texture texture;
 	int x, y;
 public:
@@ -53,6 +54,9 @@ public:
 
 	SDL_Surface *getSurface() const;
 	SDL_Texture *getTexture() const;
+
+	// Gets the bytes taken by the text box's surface and texture.
+	size_t getBytes() const;
 };
 
 #endif
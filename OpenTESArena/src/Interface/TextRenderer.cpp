@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cassert>
+
+#include "SDL.h"
+
+#include "TextAlignment.h"
+#include "TextRenderer.h"
+#include "../Media/Font.h"
+#include "../Media/FontName.h"
+#include "../Rendering/Renderer.h"
+#include "../Rendering/Surface.h"
+#include "../Utilities/Debug.h"
+
+namespace
+{
+	// Characters in each font, starting with space (ASCII 32).
+	const int GlyphCount = 96;
+}
+
+TextRenderer::Layout::Layout()
+{
+	this->fontName = static_cast<FontName>(0);
+	this->alignment = TextAlignment::Left;
+	this->lineSpacing = 0;
+	this->valid = false;
+}
+
+void TextRenderer::Layout::set(StringView text, FontName fontName,
+	TextAlignment alignment, int lineSpacing, FontManager &fontManager)
+{
+	if (this->valid && (StringView(this->text) == text) && (this->fontName == fontName) &&
+		(this->alignment == alignment) && (this->lineSpacing == lineSpacing))
+	{
+		return;
+	}
+
+	this->text.assign(text.data(), text.size());
+	this->fontName = fontName;
+	this->alignment = alignment;
+	this->lineSpacing = lineSpacing;
+	this->glyphPositions.clear();
+	this->glyphIndices.clear();
+
+	const Font &font = fontManager.getFont(fontName);
+	const int characterHeight = font.getCharacterHeight();
+
+	// Line widths come first so centered lines know where to start. An empty string is
+	// one empty line, the same as a rich text string.
+	std::vector<int> &lineWidths = this->lineWidths;
+	lineWidths.assign(1, 0);
+	for (const char c : this->text)
+	{
+		if (c == '\n')
+		{
+			lineWidths.push_back(0);
+		}
+		else
+		{
+			lineWidths.back() += font.getSurface(c)->w;
+		}
+	}
+
+	const int maxWidth = *std::max_element(lineWidths.begin(), lineWidths.end());
+	const int lineCount = static_cast<int>(lineWidths.size());
+	this->dimensions = Int2(maxWidth,
+		(characterHeight * lineCount) + (lineSpacing * (lineCount - 1)));
+
+	auto getLineStart = [this, &lineWidths, maxWidth](int lineIndex)
+	{
+		if (this->alignment == TextAlignment::Left)
+		{
+			return 0;
+		}
+		else if (this->alignment == TextAlignment::Center)
+		{
+			return (maxWidth / 2) - (lineWidths[lineIndex] / 2);
+		}
+		else
+		{
+			DebugCrash("Alignment \"" +
+				std::to_string(static_cast<int>(this->alignment)) + "\" unrecognized.");
+			return 0;
+		}
+	};
+
+	int lineIndex = 0;
+	int xOffset = getLineStart(lineIndex);
+	int yOffset = 0;
+	for (const char c : this->text)
+	{
+		if (c == '\n')
+		{
+			lineIndex++;
+			xOffset = getLineStart(lineIndex);
+			yOffset += characterHeight + lineSpacing;
+			continue;
+		}
+
+		// Spaces are transparent, so they only move the next glyph.
+		const int glyphIndex = TextRenderer::getGlyphIndex(c);
+		if (glyphIndex != 0)
+		{
+			this->glyphPositions.push_back(Int2(xOffset, yOffset));
+			this->glyphIndices.push_back(glyphIndex);
+		}
+
+		xOffset += font.getSurface(c)->w;
+	}
+
+	this->valid = true;
+}
+
+void TextRenderer::Layout::set(StringView text, FontName fontName,
+	TextAlignment alignment, FontManager &fontManager)
+{
+	this->set(text, fontName, alignment, 0, fontManager);
+}
+
+bool TextRenderer::Layout::isValid() const
+{
+	return this->valid;
+}
+
+FontName TextRenderer::Layout::getFontName() const
+{
+	return this->fontName;
+}
+
+const Int2 &TextRenderer::Layout::getDimensions() const
+{
+	return this->dimensions;
+}
+
+int TextRenderer::Layout::getGlyphCount() const
+{
+	return static_cast<int>(this->glyphIndices.size());
+}
+
+const Int2 &TextRenderer::Layout::getGlyphPosition(int index) const
+{
+	return this->glyphPositions[index];
+}
+
+int TextRenderer::Layout::getGlyphIndex(int index) const
+{
+	return this->glyphIndices[index];
+}
+
+int TextRenderer::getGlyphIndex(char c)
+{
+	// Same fallback as the font, which also warns about it when laying out. Bytes above
+	// 127 are negative where char is signed, so the range is checked unsigned.
+	const int code = static_cast<unsigned char>(c);
+	return ((code >= 32) && (code <= 127)) ? (code - 32) : 0;
+}
+
+const TextRenderer::Atlas &TextRenderer::getAtlas(FontName fontName,
+	FontManager &fontManager, Renderer &renderer)
+{
+	auto iter = this->atlases.find(fontName);
+	if (iter != this->atlases.end())
+	{
+		return iter->second;
+	}
+
+	// Put every glyph side by side in one row.
+	const Font &font = fontManager.getFont(fontName);
+	const int height = font.getCharacterHeight();
+
+	Atlas atlas;
+	int width = 0;
+	for (int i = 0; i < GlyphCount; i++)
+	{
+		const SDL_Surface *glyph = font.getSurface(static_cast<char>(i + 32));
+		atlas.glyphRects.push_back(Rect(width, 0, glyph->w, height));
+		width += glyph->w;
+	}
+
+	Surface surface(Surface::createSurfaceWithFormat(width, height,
+		Renderer::DEFAULT_BPP, Renderer::DEFAULT_PIXELFORMAT));
+	SDL_Surface *atlasSurface = surface.get();
+	const uint32_t transparent = SDL_MapRGBA(atlasSurface->format, 0, 0, 0, 0);
+	const uint32_t white = SDL_MapRGBA(atlasSurface->format, 255, 255, 255, 255);
+	SDL_FillRect(atlasSurface, nullptr, transparent);
+
+	// Copy each glyph in white, so the color can be applied when drawing.
+	for (int i = 0; i < GlyphCount; i++)
+	{
+		const SDL_Surface *glyph = font.getSurface(static_cast<char>(i + 32));
+		const Rect &glyphRect = atlas.glyphRects[i];
+		for (int y = 0; y < glyph->h; y++)
+		{
+			const uint32_t *srcRow = reinterpret_cast<const uint32_t*>(
+				static_cast<const uint8_t*>(glyph->pixels) + (y * glyph->pitch));
+			uint32_t *dstRow = reinterpret_cast<uint32_t*>(
+				static_cast<uint8_t*>(atlasSurface->pixels) + (y * atlasSurface->pitch));
+
+			for (int x = 0; x < glyph->w; x++)
+			{
+				dstRow[glyphRect.getLeft() + x] = (srcRow[x] != transparent) ?
+					white : transparent;
+			}
+		}
+	}
+
+	atlas.texture = Texture(renderer.createTextureFromSurface(atlasSurface));
+	SDL_SetTextureBlendMode(atlas.texture.get(), SDL_BLENDMODE_BLEND);
+
+	iter = this->atlases.insert(std::make_pair(fontName, std::move(atlas))).first;
+	return iter->second;
+}
+
+void TextRenderer::draw(const Layout &layout, int x, int y, const Color &color,
+	FontManager &fontManager, Renderer &renderer)
+{
+	assert(layout.isValid());
+
+	const Atlas &atlas = this->getAtlas(layout.getFontName(), fontManager, renderer);
+	SDL_Texture *texture = atlas.texture.get();
+	SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+	SDL_SetTextureAlphaMod(texture, color.a);
+
+	// One copy per glyph from the same texture, so the renderer can batch them.
+	const int glyphCount = layout.getGlyphCount();
+	for (int i = 0; i < glyphCount; i++)
+	{
+		const Int2 &position = layout.getGlyphPosition(i);
+		const Rect &glyphRect = atlas.glyphRects[layout.getGlyphIndex(i)];
+		renderer.drawOriginalClipped(texture, glyphRect, x + position.x, y + position.y);
+	}
+}
+
+void TextRenderer::clear()
+{
+	this->atlases.clear();
+}
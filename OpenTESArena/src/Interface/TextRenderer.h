@@ -0,0 +1,82 @@
+#ifndef TEXT_RENDERER_H
+#define TEXT_RENDERER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Math/Rect.h"
+#include "../Math/Vector2.h"
+#include "../Media/Color.h"
+#include "../Media/FontManager.h"
+#include "../Rendering/Texture.h"
+#include "../Utilities/StringView.h"
+
+// Draws text from one texture atlas per font instead of rasterizing a new surface and
+// texture for each string like a text box does. Intended for text that changes often,
+// like the debug overlay. The atlas glyphs are white and get tinted when drawn.
+
+class Renderer;
+
+enum class FontName;
+enum class TextAlignment;
+
+class TextRenderer
+{
+public:
+	// A string laid out as glyphs of one font. Setting the same text and style again keeps
+	// the existing layout.
+	class Layout
+	{
+	private:
+		std::vector<Int2> glyphPositions; // Top-left corner of each glyph in the layout.
+		std::vector<int> glyphIndices; // Into the font's atlas.
+		std::vector<int> lineWidths; // Kept so laying out again doesn't allocate.
+		std::string text;
+		FontName fontName;
+		TextAlignment alignment;
+		Int2 dimensions;
+		int lineSpacing;
+		bool valid;
+	public:
+		Layout();
+
+		// Lays out the text if it or its style changed since the last call. The text is
+		// copied, so it can be a view of something temporary.
+		void set(StringView text, FontName fontName, TextAlignment alignment,
+			int lineSpacing, FontManager &fontManager);
+		void set(StringView text, FontName fontName, TextAlignment alignment,
+			FontManager &fontManager);
+
+		bool isValid() const;
+		FontName getFontName() const;
+		const Int2 &getDimensions() const;
+		int getGlyphCount() const;
+		const Int2 &getGlyphPosition(int index) const;
+		int getGlyphIndex(int index) const;
+	};
+private:
+	struct Atlas
+	{
+		Texture texture;
+		std::vector<Rect> glyphRects; // One for each character from ASCII 32 to 127.
+	};
+
+	std::unordered_map<FontName, Atlas> atlases;
+
+	// Gets the font's atlas, making it the first time.
+	const Atlas &getAtlas(FontName fontName, FontManager &fontManager, Renderer &renderer);
+public:
+	// Gets the atlas index of a character, using space for ones the fonts don't have.
+	static int getGlyphIndex(char c);
+
+	// Draws the layout with its top-left corner at the given point in original screen
+	// space, tinted with the given color.
+	void draw(const Layout &layout, int x, int y, const Color &color,
+		FontManager &fontManager, Renderer &renderer);
+
+	// Frees the atlases. They are made again when next drawn.
+	void clear();
+};
+
+#endif
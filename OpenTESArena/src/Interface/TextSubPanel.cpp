@@ -21,6 +21,7 @@ TextSubPanel::TextSubPanel(Game &game, const Int2 &textCenter,
 	textureCenter(textureCenter)
 {
 	this->textBox = std::make_unique<TextBox>(textCenter, richText, game.getRenderer());
+	this->opaque = false;
 }
 
 TextSubPanel::TextSubPanel(Game &game, const Int2 &textCenter,
@@ -38,6 +39,32 @@ std::pair<SDL_Texture*, CursorAlignment> TextSubPanel::getCurrentCursor() const
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool TextSubPanel::isIdle() const
+{
+	return true;
+}
+
+bool TextSubPanel::isOpaque() const
+{
+	if (!this->opaque || (this->texture.get() == nullptr))
+	{
+		return false;
+	}
+
+	const Rect textureRect(
+		this->textureCenter.x - (this->texture.getWidth() / 2),
+		this->textureCenter.y - (this->texture.getHeight() / 2),
+		this->texture.getWidth(),
+		this->texture.getHeight());
+	const Rect screenRect(Renderer::ORIGINAL_WIDTH, Renderer::ORIGINAL_HEIGHT);
+	return textureRect.containsInclusive(screenRect);
+}
+
+void TextSubPanel::setOpaque(bool opaque)
+{
+	this->opaque = opaque;
+}
+
 void TextSubPanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
@@ -20,6 +20,7 @@ private:
 	std::function<void(Game&)> endingAction;
 	Texture texture;
 	Int2 textureCenter;
+	bool opaque; // Whether the background texture has no transparent texels.
 public:
 	TextSubPanel(Game &game, const Int2 &textCenter, const RichTextString &richText,
 		const std::function<void(Game&)> &endingAction, Texture &&texture,
@@ -28,7 +29,13 @@ public:
 		const std::function<void(Game&)> &endingAction);
 	virtual ~TextSubPanel() = default;
 
+	// Sets whether the background texture is fully opaque. A background that's opaque and
+	// covers the original screen hides the panels beneath, so they aren't drawn.
+	void setOpaque(bool opaque);
+
 	virtual std::pair<SDL_Texture*, CursorAlignment> getCurrentCursor() const override;
+	virtual bool isIdle() const override;
+	virtual bool isOpaque() const override;
 	virtual void handleEvent(const SDL_Event &e) override;
 	virtual void render(Renderer &renderer) override;
 };
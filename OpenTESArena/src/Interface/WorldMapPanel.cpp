@@ -33,7 +33,7 @@ WorldMapPanel::WorldMapPanel(Game &game, std::unique_ptr<ProvinceMapPanel::Trave
 		int height = 9;
 		auto function = [](Game &game)
 		{
-			game.setPanel<GameWorldPanel>(game);
+			game.setPooledPanel<GameWorldPanel>(game);
 		};
 		return Button<Game&>(center, width, height, function);
 	}();
@@ -49,7 +49,7 @@ WorldMapPanel::WorldMapPanel(Game &game, std::unique_ptr<ProvinceMapPanel::Trave
 	}();
 
 	// Load province name offsets.
-	const CIFFile cif("OUTPROV.CIF", Palette());
+	const CIFFile cif("OUTPROV.CIF");
 	for (int i = 0; i < static_cast<int>(this->provinceNameOffsets.size()); i++)
 	{
 		this->provinceNameOffsets.at(i) = Int2(cif.getXOffset(i), cif.getYOffset(i));
@@ -67,6 +67,11 @@ std::pair<SDL_Texture*, CursorAlignment> WorldMapPanel::getCurrentCursor() const
 	return std::make_pair(texture.get(), CursorAlignment::TopLeft);
 }
 
+bool WorldMapPanel::isIdle() const
+{
+	return true;
+}
+
 void WorldMapPanel::handleEvent(const SDL_Event &e)
 {
 	const auto &inputManager = this->getGame().getInputManager();
@@ -149,7 +149,7 @@ Weapon::Weapon(int weaponID, MetalType metalType,
 	assert(weaponID != -1);
 
 	this->weaponID = weaponID;
-	this->weaponName = exeData.equipment.weaponNames.at(weaponID);
+	this->weaponName = exeData.getEquipment().weaponNames.at(weaponID);
 }
 
 Weapon::Weapon(int weaponID, MetalType metalType, const ExeData &exeData)
@@ -3,6 +3,7 @@
 #include "SDL.h"
 
 #include "Game/Game.h"
+#include "Utilities/StartupTimeline.h"
 
 int main(int argc, char *argv[])
 {
@@ -10,6 +11,8 @@ int main(int argc, char *argv[])
 	static_cast<void>(argc);
 	static_cast<void>(argv);
 
+	StartupTimeline::start();
+
 	Game g;
 	g.loop();
 
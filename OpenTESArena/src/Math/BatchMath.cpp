@@ -0,0 +1,139 @@
+#include <cmath>
+
+#include "BatchMath.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#define BATCH_MATH_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+// 32-bit ARM has no NEON square root or division, so it uses the scalar loops.
+#define BATCH_MATH_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// Matrix values in float, by column.
+	struct FloatMatrix
+	{
+		float m[4][4];
+
+		FloatMatrix(const Matrix4d &matrix)
+		{
+			const Double4 *columns[] = { &matrix.x, &matrix.y, &matrix.z, &matrix.w };
+			for (int i = 0; i < 4; i++)
+			{
+				this->m[i][0] = static_cast<float>(columns[i]->x);
+				this->m[i][1] = static_cast<float>(columns[i]->y);
+				this->m[i][2] = static_cast<float>(columns[i]->z);
+				this->m[i][3] = static_cast<float>(columns[i]->w);
+			}
+		}
+	};
+}
+
+void BatchMath::transformPoints(const Matrix4d &matrix, const float *x, const float *y,
+	const float *z, int count, float *outX, float *outY, float *outZ, float *outW)
+{
+	const FloatMatrix fm(matrix);
+	const auto &m = fm.m;
+	int i = 0;
+
+#if defined(BATCH_MATH_SSE)
+	// Each output component is a dot product of the point with a row, so put each matrix
+	// value in all four lanes.
+	__m128 rows[4][4];
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			rows[row][column] = _mm_set1_ps(m[column][row]);
+		}
+	}
+
+	float *outputs[] = { outX, outY, outZ, outW };
+	for (; (i + 4) <= count; i += 4)
+	{
+		const __m128 px = _mm_loadu_ps(x + i);
+		const __m128 py = _mm_loadu_ps(y + i);
+		const __m128 pz = _mm_loadu_ps(z + i);
+
+		for (int row = 0; row < 4; row++)
+		{
+			const __m128 sum = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(rows[row][0], px), _mm_mul_ps(rows[row][1], py)),
+				_mm_add_ps(_mm_mul_ps(rows[row][2], pz), rows[row][3]));
+			_mm_storeu_ps(outputs[row] + i, sum);
+		}
+	}
+#elif defined(BATCH_MATH_NEON)
+	float32x4_t rows[4][4];
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			rows[row][column] = vdupq_n_f32(m[column][row]);
+		}
+	}
+
+	float *outputs[] = { outX, outY, outZ, outW };
+	for (; (i + 4) <= count; i += 4)
+	{
+		const float32x4_t px = vld1q_f32(x + i);
+		const float32x4_t py = vld1q_f32(y + i);
+		const float32x4_t pz = vld1q_f32(z + i);
+
+		for (int row = 0; row < 4; row++)
+		{
+			float32x4_t sum = vmlaq_f32(rows[row][3], rows[row][0], px);
+			sum = vmlaq_f32(sum, rows[row][1], py);
+			sum = vmlaq_f32(sum, rows[row][2], pz);
+			vst1q_f32(outputs[row] + i, sum);
+		}
+	}
+#endif
+
+	// Points left over from the last group of four.
+	for (; i < count; i++)
+	{
+		const float px = x[i];
+		const float py = y[i];
+		const float pz = z[i];
+		outX[i] = (m[0][0] * px) + (m[1][0] * py) + (m[2][0] * pz) + m[3][0];
+		outY[i] = (m[0][1] * px) + (m[1][1] * py) + (m[2][1] * pz) + m[3][1];
+		outZ[i] = (m[0][2] * px) + (m[1][2] * py) + (m[2][2] * pz) + m[3][2];
+		outW[i] = (m[0][3] * px) + (m[1][3] * py) + (m[2][3] * pz) + m[3][3];
+	}
+}
+
+void BatchMath::normalize2D(float *x, float *y, int count)
+{
+	int i = 0;
+
+#if defined(BATCH_MATH_SSE)
+	for (; (i + 4) <= count; i += 4)
+	{
+		const __m128 vx = _mm_loadu_ps(x + i);
+		const __m128 vy = _mm_loadu_ps(y + i);
+		const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)));
+		_mm_storeu_ps(x + i, _mm_div_ps(vx, length));
+		_mm_storeu_ps(y + i, _mm_div_ps(vy, length));
+	}
+#elif defined(BATCH_MATH_NEON)
+	for (; (i + 4) <= count; i += 4)
+	{
+		const float32x4_t vx = vld1q_f32(x + i);
+		const float32x4_t vy = vld1q_f32(y + i);
+		const float32x4_t length = vsqrtq_f32(vmlaq_f32(vmulq_f32(vx, vx), vy, vy));
+		vst1q_f32(x + i, vdivq_f32(vx, length));
+		vst1q_f32(y + i, vdivq_f32(vy, length));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const float length = std::sqrt((x[i] * x[i]) + (y[i] * y[i]));
+		x[i] /= length;
+		y[i] /= length;
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef BATCH_MATH_H
+#define BATCH_MATH_H
+
+#include "Matrix4.h"
+
+// Static class for math operations on many vectors at once. Vectors are given as separate
+// arrays of each component (i.e., all X values, then all Y values) so four of them fit in
+// one SSE or NEON register. Platforms without either use the same loops one vector at a
+// time.
+
+// Values are floats, so results can differ from the double versions in the last few
+// digits. That's plenty for screen positions and ray directions. Arrays don't need any
+// particular alignment.
+
+class BatchMath
+{
+private:
+	BatchMath() = delete;
+	~BatchMath() = delete;
+public:
+	// Transforms points by a matrix, with an implied W of 1 for each input point. Each
+	// output W is written so the caller can do its own perspective divide. The matrix is
+	// converted to floats once per call.
+	static void transformPoints(const Matrix4d &matrix, const float *x, const float *y,
+		const float *z, int count, float *outX, float *outY, float *outZ, float *outW);
+
+	// Normalizes 2D vectors in place. Zero-length vectors are not handled.
+	static void normalize2D(float *x, float *y, int count);
+};
+
+#endif
@@ -1,8 +1,22 @@
+#include <atomic>
 #include <ctime>
 #include <limits>
 
 #include "Random.h"
 
+namespace
+{
+	// Set by Random::setDefaultSeed().
+	std::atomic<bool> DefaultSeedIsFixed(false);
+	std::atomic<int> NextDefaultSeed(0);
+
+	int GetDefaultSeed()
+	{
+		return DefaultSeedIsFixed ? NextDefaultSeed.fetch_add(1) :
+			static_cast<int>(time(nullptr));
+	}
+}
+
 Random::Random(int seed)
 {
 	this->generator = std::default_random_engine(seed);
@@ -13,7 +27,13 @@ Random::Random(int seed)
 }
 
 Random::Random()
-	: Random(static_cast<int>(time(nullptr))) { }
+	: Random(GetDefaultSeed()) { }
+
+void Random::setDefaultSeed(int seed)
+{
+	NextDefaultSeed = seed;
+	DefaultSeedIsFixed = true;
+}
 
 int Random::next()
 {
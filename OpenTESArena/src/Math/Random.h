@@ -14,9 +14,13 @@ public:
 	// Initialized with the given seed.
 	Random(int seed);
 
-	// Initialized with the current time.
+	// Initialized with the current time, or the next fixed default seed if there is one.
 	Random();
 
+	// Makes generators initialized without a seed use seeds counting up from the given one
+	// instead of the current time, so a recorded session comes out the same when replayed.
+	static void setDefaultSeed(int seed);
+
 	// Includes 0 to ~2.14 billion.
 	int next();
 
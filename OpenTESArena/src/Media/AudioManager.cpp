@@ -2,9 +2,14 @@
 #include <array>
 #include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdint>
 #include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
@@ -16,9 +21,17 @@
 #include "alext.h" // Using local copy (+ "efx.h") to guarantee existence on system.
 #include "AudioManager.h"
 #include "WildMidi.h"
+#include "../Assets/AssetName.h"
 #include "../Assets/VOCFile.h"
 #include "../Game/Options.h"
+#include "../Math/Constants.h"
 #include "../Utilities/Debug.h"
+#include "../Utilities/JobSystem.h"
+#include "../Utilities/MemoryTracker.h"
+#include "../Utilities/Platform.h"
+#include "../Utilities/Profiler.h"
+
+#include "components/vfs/manager.hpp"
 
 namespace
 {
@@ -29,6 +42,55 @@ namespace
 	{
 		"DRUMS.VOC"
 	};
+
+	// Input samples on each side of an output sample in the windowed sinc used for
+	// resampling sounds when they're loaded, and the fraction of the lower Nyquist frequency
+	// it passes. The transition band above the cutoff keeps aliasing out of the output.
+	const int PresampleHalfTaps = 16;
+	const double PresampleCutoff = 0.95;
+
+	// Resamples 8-bit unsigned PCM to 16-bit at another rate with a Blackman-windowed sinc.
+	// Each output sample's weights are normalized, so the gain is the same at every phase.
+	void ResampleToPCM16(const std::vector<uint8_t> &src, int srcRate, int dstRate,
+		std::vector<int16_t> &dst)
+	{
+		const double step = static_cast<double>(srcRate) / static_cast<double>(dstRate);
+		const size_t dstCount = static_cast<size_t>(std::ceil(
+			static_cast<double>(src.size()) / step));
+		dst.resize(dstCount);
+
+		// Cutoff in cycles per input sample. Downsampling lowers it to the output's Nyquist.
+		const double cutoff = 0.50 * PresampleCutoff * std::min(1.0, 1.0 / step);
+		const double halfWidth = static_cast<double>(PresampleHalfTaps) / std::min(1.0, 1.0 / step);
+		const int srcCount = static_cast<int>(src.size());
+
+		for (size_t i = 0; i < dstCount; i++)
+		{
+			const double position = static_cast<double>(i) * step;
+			const int start = static_cast<int>(std::ceil(position - halfWidth));
+			const int end = static_cast<int>(std::floor(position + halfWidth));
+
+			double sum = 0.0;
+			double weightSum = 0.0;
+			for (int j = std::max(start, 0); j <= std::min(end, srcCount - 1); j++)
+			{
+				const double x = static_cast<double>(j) - position;
+				const double sincX = 2.0 * cutoff * x;
+				const double sinc = (sincX != 0.0) ?
+					(std::sin(Constants::Pi * sincX) / (Constants::Pi * sincX)) : 1.0;
+				const double windowX = Constants::Pi * x / halfWidth;
+				const double window = 0.42 + (0.50 * std::cos(windowX)) +
+					(0.08 * std::cos(2.0 * windowX));
+				const double weight = sinc * window;
+
+				sum += weight * (static_cast<double>(src[j]) - 128.0);
+				weightSum += weight;
+			}
+
+			const double sample = (weightSum != 0.0) ? ((sum / weightSum) * 256.0) : 0.0;
+			dst[i] = static_cast<int16_t>(std::max(std::min(sample, 32767.0), -32768.0));
+		}
+	}
 }
 
 std::unique_ptr<MidiDevice> MidiDevice::sInstance;
@@ -47,10 +109,162 @@ private:
 	// if the resampling extension is unsupported.
 	static ALint getResamplingIndex(int value);
 
-	// Returns whether the given sound is currently playing. Intended for limiting certain
-	// sounds to only have one instance at a time.
-	bool soundIsPlaying(const std::string &filename) const;
+	// Most voice states checked by one update(), so the per-frame cost doesn't grow with
+	// the number of sounds playing.
+	static const int MAX_VOICE_POLLS_PER_UPDATE;
+
+	// Mixing updates per second asked of the OpenAL context. Most devices default to 50,
+	// and a higher rate shortens the delay before sounds like UI clicks are heard.
+	static const int LOW_LATENCY_REFRESH_RATE;
+
+	// Voices per OpenAL source for sounds to play in, so inaudible and outranked sounds can
+	// keep playing virtually without a source.
+	static const int VOICES_PER_SOURCE;
+
+	// Most voices given a source or having theirs taken by one update(), so crowds of
+	// positional sounds moving in and out of range don't stall a frame.
+	static const int MAX_VOICE_SWAPS_PER_UPDATE;
+
+	// Positional sounds are at full volume up to the reference distance, and fade linearly
+	// until the max distance, past which they can't be heard.
+	static const double SOUND_REFERENCE_DISTANCE;
+	static const double SOUND_MAX_DISTANCE;
+
+	// How much louder a virtual voice must be than the quietest voice with a source (of the
+	// same priority) to take its source, so voices near the same distance don't trade
+	// sources back and forth.
+	static const float AUDIBILITY_SWAP_MARGIN;
+
+	// Device mixing rate that sounds are resampled to when loaded, or 0 if OpenAL resamples
+	// them while playing.
+	int mPresampleRate;
+
+	// A sound's PCM data. It's either the .VOC file's 8-bit samples, or 16-bit samples at
+	// the device rate if the sound was resampled.
+	struct SoundData
+	{
+		std::vector<uint8_t> samples8;
+		std::vector<int16_t> samples16;
+		int sampleRate;
+	};
+
+	// Reads a sound file, resampling it to the given rate unless it's 0. Safe to call from
+	// worker threads.
+	static void loadSoundData(const std::string &filename, int presampleRate,
+		SoundData &soundData);
+
+	// A song synthesized to PCM ahead of time, so playing it is only copying samples.
+	struct RenderedSong
+	{
+		std::vector<char> samples; // 16-bit stereo frames.
+		int sampleRate;
+		bool overBudget; // Whether rendering stopped because the song can't fit the cache.
+
+		RenderedSong() : sampleRate(0), overBudget(false) { }
+	};
+
+	// A rendered song in the music cache, and when it was last played.
+	struct CachedSong
+	{
+		std::shared_ptr<const RenderedSong> song;
+		uint32_t lastPlayed;
+	};
+
+	// Music rendered on the job system, kept by filename up to the budget in bytes. Songs
+	// not rendered yet are synthesized live while they render, and songs too big for the
+	// budget are always synthesized live, so they aren't rendered again every time.
+	std::unordered_map<AssetName, CachedSong, AssetName::Hash> mRenderedSongs;
+	std::unordered_map<AssetName, JobSystem::JobHandle, AssetName::Hash> mRenderingSongs;
+	std::unordered_set<AssetName, AssetName::Hash> mLiveSongs;
+	size_t mMusicCacheBudget, mMusicCacheBytes;
+
+	// Set when the manager is being destroyed, so song renders stop early and their
+	// completion callbacks leave the manager alone.
+	std::shared_ptr<std::atomic<bool>> mCancelSongRenders;
+	uint32_t mMusicPlayCount;
+	JobSystem *mJobSystem;
+
+	// Synthesizes a song on a worker and puts it in the music cache when it's done. Songs
+	// bigger than the budget are given up on and remembered as live songs.
+	void renderSong(const std::string &filename);
+
+	// Removes the least recently played songs until the cache fits in its budget.
+	void trimMusicCache();
+
+	// Bytes of sound samples in OpenAL buffers, and the most to keep (zero if no limit).
+	// Sounds past the budget are unloaded and decoded again the next time they play.
+	size_t mSoundCacheBudget, mSoundCacheBytes;
+	uint32_t mSoundPlayCount;
+
+	// Unloads the least recently played sounds until the sound buffers fit in their budget.
+	// Sounds that are pinned or that any voice is playing (even virtually, since it gets
+	// the buffer back with a source) are kept.
+	void trimSoundCache();
+
+	// Gets the seconds since the manager was made, for voices' places in their sound.
+	double getTime() const;
+
+	// Makes the voice stop and return to the free voices, and invalidates its handles.
+	void releaseVoice(int voiceIndex);
+
+	// Gets a voice for a new sound with the given priority, stealing the lowest priority
+	// voice (oldest first) if none are free. Returns -1 if every voice has a higher priority.
+	int acquireVoice(int priority);
+
+	// Returns whether the voice has finished playing, with or without a source.
+	bool voiceIsStopped(int voiceIndex) const;
+
+	// Gets how loud the voice is from the listener's position, from 0 to 1.
+	float getAudibility(int voiceIndex) const;
+
+	// Returns whether the first voice should have a source over the second. Higher priority
+	// wins, then louder by the margin, then newer.
+	bool voiceOutranks(int voiceIndex, int otherIndex, float margin) const;
+
+	// Gets the lowest ranked voice with a source, or -1 if none have one.
+	int getWeakestSourcedVoice() const;
+
+	// Gives a virtual voice a free source and plays it from where it should be by now.
+	void giveVoiceSource(int voiceIndex);
+
+	// Takes a voice's source back, leaving the voice to play virtually.
+	void takeVoiceSource(int voiceIndex);
 public:
+	// A sound file resolved to an ID, so playing it again doesn't need string lookups.
+	struct Sound
+	{
+		std::string filename;
+		ALuint buffer;
+		size_t bufferBytes; // Sample bytes given to OpenAL, for the memory tracker.
+		bool loaded, pending; // Pending means a preload is decoding it.
+		bool singleInstance;
+		bool pinned; // Never unloaded if true.
+		int voiceCount; // Number of voices playing it.
+		uint32_t lastPlayed; // For unloading the least recently played first.
+		double duration; // In seconds, once loaded.
+	};
+
+	// Gives a sound's PCM data to an OpenAL buffer, and makes it the sound's buffer.
+	void setSoundBuffer(Sound &sound, ALuint bufferID, const SoundData &soundData);
+
+	// A playing instance of a sound. Voices that can't be heard or were outranked are
+	// virtual: they have no OpenAL source, and only their start time keeps their place in
+	// the sound. Handles to a voice hold its generation, so they stop working once the
+	// voice is reused.
+	struct Voice
+	{
+		ALuint source; // 0 if virtual.
+		uint32_t generation;
+		int soundID; // -1 if free.
+		int priority;
+		uint32_t startOrder; // For stealing the oldest of equal priority voices.
+		int activeIndex; // Position in the active voice list.
+		double startTime; // When the sound started, from getTime().
+		float audibility; // Last found by getAudibility().
+		bool positional;
+		Double3 position; // In the world, if positional.
+	};
+
 	float mMusicVolume;
 	float mSfxVolume;
 	bool mHasResamplerExtension; // Whether AL_SOFT_source_resampler is supported.
@@ -59,38 +273,119 @@ public:
 	MidiSongPtr mCurrentSong;
 	std::unique_ptr<OpenALStream> mSongStream;
 
-	// Loaded sound buffers from .VOC files.
-	std::unordered_map<std::string, ALuint> mSoundBuffers;
+	// Sounds by ID, and the IDs of their filenames (ignoring case).
+	std::vector<Sound> mSounds;
+	std::unordered_map<AssetName, int, AssetName::Hash> mSoundIDs;
+
+	// Reads of preloaded sounds that might not be done, so they can be canceled at
+	// shutdown (a finished read signals the job system).
+	std::vector<VFS::ReadRequestPtr> mPreloadReads;
 
-	// A deque of available sources to play sounds and streams with.
+	// Fixed set of voices made in init(), the indices of free ones, and the indices of
+	// ones playing. Update polls the active voices round-robin from the poll index.
+	std::vector<Voice> mVoices;
+	std::vector<int> mFreeVoices;
+	std::vector<int> mActiveVoices;
+	int mPollIndex;
+	uint32_t mNextStartOrder;
+
+	// Sources that voices play through, and the ones no voice has.
+	std::vector<ALuint> mVoiceSources;
+	std::vector<ALuint> mFreeVoiceSources;
+
+	// Sources for streaming music with.
 	std::deque<ALuint> mFreeSources;
 
-	// A deque of currently used sources for sounds (the music source is owned 
-	// by OpenALStream). The string is the filename and the integer is the ID.
-	// The filename is required for some sounds that can only have one instance
-	// active at a time.
-	std::deque<std::pair<std::string, ALuint>> mUsedSources;
+	// Where positional sounds are heard from.
+	Double3 mListenerPosition;
+	std::chrono::steady_clock::time_point mStartTime;
+
+	// Number of times music playback ran out of queued audio. Written by stream threads.
+	std::atomic<int> mMusicUnderrunCount;
+
+	// Whether stream threads ask for audio thread priority. Read when a stream starts.
+	std::atomic<bool> mRaiseMusicPriority;
 
 	AudioManagerImpl();
 	~AudioManagerImpl();
 
 	void init(double musicVolume, double soundVolume, int maxChannels,
-		int resamplingOption, const std::string &midiConfig);
+		int resamplingOption, bool presampleSounds, const std::string &midiConfig,
+		JobSystem &jobSystem);
 
 	void playMusic(const std::string &filename);
-	void playSound(const std::string &filename);
+	void setMusicCacheBudget(size_t bytes);
+	void setSoundCacheBudget(size_t bytes);
+	void setMusicThreadPriority(bool raised);
+	int getSoundID(const std::string &filename);
+	void setSoundPinned(int soundID, bool pinned);
+	AudioManager::SoundHandle playSound(int soundID, int priority, bool positional,
+		const Double3 &position);
+	void setListener(const Double3 &position, const Double3 &direction);
+	void preloadSounds(const std::vector<std::string> &filenames, JobSystem &jobSystem);
 
 	void stopMusic();
 	void stopSound();
+	void stopSound(AudioManager::SoundHandle handle);
+	bool soundIsPlaying(AudioManager::SoundHandle handle) const;
 
 	void setMusicVolume(double percent);
 	void setSoundVolume(double percent);
 	void setResamplingOption(int value);
 
+	int getMusicUnderrunCount() const;
+
 	void update();
 };
 
 const ALint AudioManagerImpl::UNSUPPORTED_EXTENSION = -1;
+const int AudioManagerImpl::MAX_VOICE_POLLS_PER_UPDATE = 4;
+const int AudioManagerImpl::LOW_LATENCY_REFRESH_RATE = 100;
+const int AudioManagerImpl::VOICES_PER_SOURCE = 4;
+const int AudioManagerImpl::MAX_VOICE_SWAPS_PER_UPDATE = 2;
+const double AudioManagerImpl::SOUND_REFERENCE_DISTANCE = 2.0;
+const double AudioManagerImpl::SOUND_MAX_DISTANCE = 24.0;
+const float AudioManagerImpl::AUDIBILITY_SWAP_MARGIN = 1.50f;
+
+// Plays a song that was synthesized ahead of time from its samples in the music cache.
+class RenderedMidiSong : public MidiSong
+{
+private:
+	std::shared_ptr<const std::vector<char>> mSamples;
+	int mSampleRate;
+	size_t mFrame;
+
+	static const size_t sFrameSize = 4;
+public:
+	RenderedMidiSong(const std::shared_ptr<const std::vector<char>> &samples, int sampleRate)
+		: mSamples(samples), mSampleRate(sampleRate), mFrame(0) { }
+
+	virtual void getFormat(int *sampleRate) override
+	{
+		*sampleRate = mSampleRate;
+	}
+
+	virtual size_t read(char *buffer, size_t count) override
+	{
+		const size_t frameCount = mSamples->size() / sFrameSize;
+		const size_t got = std::min(count, frameCount - mFrame);
+		std::copy(mSamples->begin() + (mFrame * sFrameSize),
+			mSamples->begin() + ((mFrame + got) * sFrameSize), buffer);
+		mFrame += got;
+		return got;
+	}
+
+	virtual bool seek(size_t offset) override
+	{
+		if (offset > (mSamples->size() / sFrameSize))
+		{
+			return false;
+		}
+
+		mFrame = offset;
+		return true;
+	}
+};
 
 class OpenALStream
 {
@@ -98,13 +393,24 @@ private:
 	AudioManagerImpl *mManager;
 	MidiSong *mSong;
 
-	/* Background thread and control. */
+	/* Background thread and control. The thread sleeps on the condition
+	 * variable until the playing buffer should be done, or until it's told
+	 * to quit.
+	 */
 	std::atomic<bool> mQuit;
 	std::thread mThread;
+	std::mutex mWakeMutex;
+	std::condition_variable mWakeCondition;
 
-	/* Playback source and buffer queue. */
-	static const int sBufferFrames = 16384;
+	/* Playback source and buffer queue. Each buffer covers a few device
+	 * mixing periods, so the queue outlasts the main thread holding the
+	 * context for a while without needing huge buffers.
+	 */
+	static const int sPeriodsPerBuffer = 8;
+	static const int sMinBufferFrames = 1024;
+	static const int sMaxBufferFrames = 16384;
 	ALuint mSource;
+	ALuint mBufferFrames;
 	std::array<ALuint, 4> mBuffers;
 	ALuint mBufferIdx;
 
@@ -167,8 +473,15 @@ private:
 		/* Temporary storage to read samples into, before passing to OpenAL.
 		 * Kept here to avoid reallocating it during playback.
 		 */
-		std::vector<char> buffer(sBufferFrames * mFrameSize);
+		std::vector<char> buffer(mBufferFrames * mFrameSize);
 
+		/* Music stutters as soon as this thread is late refilling the queue, so
+		 * it's scheduled ahead of the game's own threads when allowed.
+		 */
+		if (mManager->mRaiseMusicPriority.load())
+			Platform::setCurrentThreadPriority(Platform::ThreadPriority::Audio);
+
+		bool started = false;
 		while (!mQuit.load())
 		{
 			/* First, make sure the buffer queue is filled. */
@@ -178,6 +491,10 @@ private:
 			alGetSourcei(mSource, AL_SOURCE_STATE, &state);
 			if (state != AL_PLAYING && state != AL_PAUSED)
 			{
+				/* Stopping after having started means the queue ran dry. */
+				if (started)
+					mManager->mMusicUnderrunCount++;
+
 				/* If the source is not playing or paused, it either underrun
 				 * or hasn't started at all yet. So remove any buffers that
 				 * have been played (will be 0 when first starting).
@@ -203,18 +520,31 @@ private:
 
 				/* Now start the sound source. */
 				alSourcePlay(mSource);
+				started = true;
 			}
 
 			ALint processed;
 			alGetSourcei(mSource, AL_BUFFERS_PROCESSED, &processed);
 			if (processed == 0)
 			{
-				/* Wait until a buffer in the queue has been processed. */
-				do {
-					std::this_thread::sleep_for(std::chrono::milliseconds(50));
-					if (mQuit.load()) break;
-					alGetSourcei(mSource, AL_BUFFERS_PROCESSED, &processed);
-				} while (processed == 0);
+				/* Sleep until the front buffer should be done. The offset is
+				 * into the front buffer when none are processed yet. If the
+				 * wake-up is a bit early, the next loop just waits again.
+				 */
+				ALint offset;
+				alGetSourcei(mSource, AL_SAMPLE_OFFSET, &offset);
+				const ALint framesLeft = std::max(
+					static_cast<ALint>(mBufferFrames) - offset, 0);
+				const auto waitTime = std::chrono::microseconds(
+					(static_cast<int64_t>(framesLeft) * 1000000) / mSampleRate) +
+					std::chrono::milliseconds(1);
+
+				std::unique_lock<std::mutex> lock(mWakeMutex);
+				mWakeCondition.wait_for(lock, waitTime, [this]() { return mQuit.load(); });
+				lock.unlock();
+
+				if (mQuit.load()) break;
+				alGetSourcei(mSource, AL_BUFFERS_PROCESSED, &processed);
 			}
 			/* Remove processed buffers, then restart the loop to keep the
 			 * queue filled.
@@ -228,9 +558,19 @@ private:
 		}
 	}
 
+	/* Tells the background thread to quit and wakes it if it's waiting. */
+	void requestQuit()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mWakeMutex);
+			mQuit.store(true);
+		}
+		mWakeCondition.notify_all();
+	}
+
 public:
 	OpenALStream(AudioManagerImpl *manager, MidiSong *song)
-		: mManager(manager), mSong(song), mQuit(false), mSource(0)
+		: mManager(manager), mSong(song), mQuit(false), mSource(0), mBufferFrames(0)
 		, mBufferIdx(0), mSampleRate(0)
 	{
 		// Using std::array::fill() for mBuffers since VS2013 doesn't support mBuffers{0}.
@@ -242,7 +582,7 @@ public:
 		if (mThread.get_id() != std::thread::id())
 		{
 			/* Tell the thread to quit and wait for it to stop. */
-			mQuit.store(true);
+			requestQuit();
 			mThread.join();
 		}
 		if (mSource)
@@ -284,7 +624,7 @@ public:
 	{
 		if (mThread.get_id() != std::thread::id())
 		{
-			mQuit.store(true);
+			requestQuit();
 			mThread.join();
 		}
 
@@ -348,6 +688,18 @@ public:
 		mFrameSize = 4;
 		mSampleRate = srate;
 
+		/* Size the buffers from the device's mixing period. */
+		ALCint refreshRate = 0;
+		ALCdevice *device = alcGetContextsDevice(alcGetCurrentContext());
+		if (device != nullptr)
+			alcGetIntegerv(device, ALC_REFRESH, 1, &refreshRate);
+		if (refreshRate <= 0)
+			refreshRate = 50;
+
+		const ALuint periodFrames = mSampleRate / static_cast<ALuint>(refreshRate);
+		mBufferFrames = std::min(std::max(periodFrames * sPeriodsPerBuffer,
+			static_cast<ALuint>(sMinBufferFrames)), static_cast<ALuint>(sMaxBufferFrames));
+
 		mSource = source;
 		return true;
 	}
@@ -356,7 +708,12 @@ public:
 // Audio Manager Impl
 
 AudioManagerImpl::AudioManagerImpl()
-	: mMusicVolume(1.0f), mSfxVolume(1.0f), mHasResamplerExtension(false)
+	: mPresampleRate(0), mMusicCacheBudget(0), mMusicCacheBytes(0),
+	mCancelSongRenders(std::make_shared<std::atomic<bool>>(false)), mMusicPlayCount(0),
+	mJobSystem(nullptr), mSoundCacheBudget(0), mSoundCacheBytes(0), mSoundPlayCount(0),
+	mMusicVolume(1.0f), mSfxVolume(1.0f), mHasResamplerExtension(false),
+	mPollIndex(0), mNextStartOrder(0), mStartTime(std::chrono::steady_clock::now()),
+	mMusicUnderrunCount(0), mRaiseMusicPriority(false)
 {
 
 }
@@ -366,6 +723,27 @@ AudioManagerImpl::~AudioManagerImpl()
 	this->stopMusic();
 	this->stopSound();
 
+	// Song renders use the MIDI device on workers, so they have to finish before it's shut
+	// down.
+	mCancelSongRenders->store(true);
+	for (const auto &pair : mRenderingSongs)
+	{
+		mJobSystem->wait(pair.second);
+	}
+
+	mRenderingSongs.clear();
+
+	for (const VFS::ReadRequestPtr &read : mPreloadReads)
+	{
+		read->cancel();
+	}
+
+	mPreloadReads.clear();
+
+	MemoryTracker::remove(MemoryTag::MusicCache, mMusicCacheBytes);
+	mRenderedSongs.clear();
+	mMusicCacheBytes = 0;
+
 	MidiDevice::shutdown();
 
 	ALCcontext *context = alcGetCurrentContext();
@@ -381,13 +759,28 @@ AudioManagerImpl::~AudioManagerImpl()
 
 	mFreeSources.clear();
 
-	for (auto &pair : mSoundBuffers)
+	for (const ALuint source : mVoiceSources)
+	{
+		alDeleteSources(1, &source);
+	}
+
+	mVoices.clear();
+	mFreeVoices.clear();
+	mVoiceSources.clear();
+	mFreeVoiceSources.clear();
+
+	for (const Sound &sound : mSounds)
 	{
-		ALuint buffer = pair.second;
-		alDeleteBuffers(1, &buffer);
+		if (sound.loaded)
+		{
+			alDeleteBuffers(1, &sound.buffer);
+			MemoryTracker::remove(MemoryTag::SoundBuffers, sound.bufferBytes);
+		}
 	}
 
-	mSoundBuffers.clear();
+	mSounds.clear();
+	mSoundIDs.clear();
+	mSoundCacheBytes = 0;
 
 	ALCdevice *device = alcGetContextsDevice(context);
 	alcMakeContextCurrent(nullptr);
@@ -427,23 +820,263 @@ ALint AudioManagerImpl::getResamplingIndex(int resamplingOption)
 	}
 }
 
-bool AudioManagerImpl::soundIsPlaying(const std::string &filename) const
+void AudioManagerImpl::loadSoundData(const std::string &filename, int presampleRate,
+	SoundData &soundData)
 {
-	// Check through used sources' filenames.
-	const auto iter = std::find_if(mUsedSources.begin(), mUsedSources.end(),
-		[&filename](const std::pair<std::string, ALuint> &pair)
+	const VOCFile voc(filename);
+	if ((presampleRate > 0) && (voc.getSampleRate() != presampleRate))
 	{
-		return pair.first == filename;
-	});
+		ResampleToPCM16(voc.getAudioData(), voc.getSampleRate(), presampleRate,
+			soundData.samples16);
+		soundData.samples8.clear();
+		soundData.sampleRate = presampleRate;
+	}
+	else
+	{
+		soundData.samples8 = voc.getAudioData();
+		soundData.samples16.clear();
+		soundData.sampleRate = voc.getSampleRate();
+	}
+}
+
+void AudioManagerImpl::setSoundBuffer(Sound &sound, ALuint bufferID,
+	const SoundData &soundData)
+{
+	size_t sampleCount;
+	if (soundData.samples16.size() > 0)
+	{
+		sampleCount = soundData.samples16.size();
+		sound.bufferBytes = sampleCount * sizeof(int16_t);
+		alBufferData(bufferID, AL_FORMAT_MONO16,
+			static_cast<const ALvoid*>(soundData.samples16.data()),
+			static_cast<ALsizei>(sound.bufferBytes),
+			static_cast<ALsizei>(soundData.sampleRate));
+	}
+	else
+	{
+		sampleCount = soundData.samples8.size();
+		sound.bufferBytes = sampleCount;
+		alBufferData(bufferID, AL_FORMAT_MONO8,
+			static_cast<const ALvoid*>(soundData.samples8.data()),
+			static_cast<ALsizei>(sound.bufferBytes),
+			static_cast<ALsizei>(soundData.sampleRate));
+	}
+
+	sound.buffer = bufferID;
+	sound.duration = static_cast<double>(sampleCount) /
+		static_cast<double>(std::max(soundData.sampleRate, 1));
+	sound.loaded = true;
+	mSoundCacheBytes += sound.bufferBytes;
+	MemoryTracker::add(MemoryTag::SoundBuffers, sound.bufferBytes);
+}
+
+double AudioManagerImpl::getTime() const
+{
+	const std::chrono::duration<double> time = std::chrono::steady_clock::now() - mStartTime;
+	return time.count();
+}
+
+void AudioManagerImpl::releaseVoice(int voiceIndex)
+{
+	Voice &voice = mVoices[voiceIndex];
+	if (voice.source != 0)
+	{
+		this->takeVoiceSource(voiceIndex);
+	}
+
+	Sound &sound = mSounds[voice.soundID];
+	sound.voiceCount--;
+	voice.soundID = -1;
+	// Generation zero is skipped so no handle equals NO_SOUND.
+	voice.generation = (voice.generation + 1) & AudioManager::HANDLE_GENERATION_MASK;
+	if (voice.generation == 0)
+	{
+		voice.generation = 1;
+	}
+
+	// Swap-remove from the active list.
+	const int lastVoiceIndex = mActiveVoices.back();
+	mActiveVoices[voice.activeIndex] = lastVoiceIndex;
+	mVoices[lastVoiceIndex].activeIndex = voice.activeIndex;
+	mActiveVoices.pop_back();
+	voice.activeIndex = -1;
+
+	mFreeVoices.push_back(voiceIndex);
+
+	// The sound can be unloaded now that nothing plays it, if the buffers are over budget.
+	if (sound.voiceCount == 0)
+	{
+		this->trimSoundCache();
+	}
+}
+
+int AudioManagerImpl::acquireVoice(int priority)
+{
+	if (mFreeVoices.empty())
+	{
+		// Reclaim finished voices first. This is bounded by the channel count, and only
+		// happens when every voice is busy.
+		for (int i = static_cast<int>(mActiveVoices.size()) - 1; i >= 0; i--)
+		{
+			const int voiceIndex = mActiveVoices[i];
+			if (this->voiceIsStopped(voiceIndex))
+			{
+				this->releaseVoice(voiceIndex);
+			}
+		}
+	}
+
+	if (mFreeVoices.empty())
+	{
+		// Steal the lowest priority voice, oldest first, unless they all outrank the
+		// new sound.
+		int stealIndex = -1;
+		for (const int voiceIndex : mActiveVoices)
+		{
+			const Voice &voice = mVoices[voiceIndex];
+			if (voice.priority > priority)
+			{
+				continue;
+			}
+
+			if ((stealIndex < 0) || (voice.priority < mVoices[stealIndex].priority) ||
+				((voice.priority == mVoices[stealIndex].priority) &&
+				(voice.startOrder < mVoices[stealIndex].startOrder)))
+			{
+				stealIndex = voiceIndex;
+			}
+		}
+
+		if (stealIndex < 0)
+		{
+			return -1;
+		}
+
+		this->releaseVoice(stealIndex);
+	}
+
+	const int voiceIndex = mFreeVoices.back();
+	mFreeVoices.pop_back();
+	return voiceIndex;
+}
+
+bool AudioManagerImpl::voiceIsStopped(int voiceIndex) const
+{
+	const Voice &voice = mVoices[voiceIndex];
+	if (voice.source != 0)
+	{
+		ALint state;
+		alGetSourcei(voice.source, AL_SOURCE_STATE, &state);
+		return state == AL_STOPPED;
+	}
+	else
+	{
+		return (this->getTime() - voice.startTime) >= mSounds[voice.soundID].duration;
+	}
+}
+
+float AudioManagerImpl::getAudibility(int voiceIndex) const
+{
+	const Voice &voice = mVoices[voiceIndex];
+	if (!voice.positional)
+	{
+		return 1.0f;
+	}
+
+	// Same as OpenAL's linear clamped distance model.
+	const double referenceDistance = AudioManagerImpl::SOUND_REFERENCE_DISTANCE;
+	const double maxDistance = AudioManagerImpl::SOUND_MAX_DISTANCE;
+	const double distance = (voice.position - mListenerPosition).length();
+	const double clampedDistance = std::max(std::min(distance, maxDistance), referenceDistance);
+	return static_cast<float>(1.0 - ((clampedDistance - referenceDistance) /
+		(maxDistance - referenceDistance)));
+}
 
-	return iter != mUsedSources.end();
+bool AudioManagerImpl::voiceOutranks(int voiceIndex, int otherIndex, float margin) const
+{
+	const Voice &voice = mVoices[voiceIndex];
+	const Voice &other = mVoices[otherIndex];
+	if (voice.priority != other.priority)
+	{
+		return voice.priority > other.priority;
+	}
+	else if (voice.audibility > (other.audibility * margin))
+	{
+		return true;
+	}
+	else if ((voice.audibility * margin) < other.audibility)
+	{
+		return false;
+	}
+	else
+	{
+		// Start orders wrap, so newer is compared by difference.
+		return static_cast<int32_t>(voice.startOrder - other.startOrder) > 0;
+	}
+}
+
+int AudioManagerImpl::getWeakestSourcedVoice() const
+{
+	int weakestIndex = -1;
+	for (const int voiceIndex : mActiveVoices)
+	{
+		if ((mVoices[voiceIndex].source != 0) &&
+			((weakestIndex < 0) || this->voiceOutranks(weakestIndex, voiceIndex, 1.0f)))
+		{
+			weakestIndex = voiceIndex;
+		}
+	}
+
+	return weakestIndex;
+}
+
+void AudioManagerImpl::giveVoiceSource(int voiceIndex)
+{
+	assert(!mFreeVoiceSources.empty());
+
+	Voice &voice = mVoices[voiceIndex];
+	assert(voice.source == 0);
+	voice.source = mFreeVoiceSources.back();
+	mFreeVoiceSources.pop_back();
+
+	// Non-positional sounds are at the listener.
+	const Double3 position = voice.positional ? voice.position : Double3();
+	alSourcei(voice.source, AL_BUFFER, mSounds[voice.soundID].buffer);
+	alSourcei(voice.source, AL_SOURCE_RELATIVE, voice.positional ? AL_FALSE : AL_TRUE);
+	alSource3f(voice.source, AL_POSITION, static_cast<ALfloat>(position.x),
+		static_cast<ALfloat>(position.y), static_cast<ALfloat>(position.z));
+	alSourcei(voice.source, AL_SOURCE_RESAMPLER_SOFT, mResampler);
+
+	// A voice that was virtual picks up where it would be by now.
+	const double offset = this->getTime() - voice.startTime;
+	if (offset > 0.0)
+	{
+		alSourcef(voice.source, AL_SEC_OFFSET, static_cast<ALfloat>(offset));
+	}
+
+	alSourcePlay(voice.source);
+}
+
+void AudioManagerImpl::takeVoiceSource(int voiceIndex)
+{
+	Voice &voice = mVoices[voiceIndex];
+	assert(voice.source != 0);
+	alSourceStop(voice.source);
+	alSourceRewind(voice.source);
+	alSourcei(voice.source, AL_BUFFER, 0);
+
+	mFreeVoiceSources.push_back(voice.source);
+	voice.source = 0;
 }
 
 void AudioManagerImpl::init(double musicVolume, double soundVolume, int maxChannels,
-	int resamplingOption, const std::string &midiConfig)
+	int resamplingOption, bool presampleSounds, const std::string &midiConfig,
+	JobSystem &jobSystem)
 {
 	DebugMention("Initializing.");
 
+	mJobSystem = &jobSystem;
+
 #ifdef HAVE_WILDMIDI
 	WildMidiDevice::init(midiConfig);
 #endif
@@ -455,7 +1088,13 @@ void AudioManagerImpl::init(double musicVolume, double soundVolume, int maxChann
 		DebugWarning("alcOpenDevice() failed (error " + std::to_string(alGetError()) + ").");
 	}
 
-	ALCcontext *context = alcCreateContext(device, nullptr);
+	// Ask for a faster mixing rate than the default. The device can still pick its own.
+	const std::array<ALCint, 3> contextAttributes =
+	{
+		ALC_REFRESH, AudioManagerImpl::LOW_LATENCY_REFRESH_RATE, 0
+	};
+
+	ALCcontext *context = alcCreateContext(device, contextAttributes.data());
 	if (context == nullptr)
 	{
 		DebugWarning("alcCreateContext() failed (error " + std::to_string(alGetError()) + ").");
@@ -468,12 +1107,21 @@ void AudioManagerImpl::init(double musicVolume, double soundVolume, int maxChann
 			std::to_string(alGetError()) + ").");
 	}
 
+	// Sounds resampled to the mixing rate when they're loaded play without OpenAL
+	// resampling them on every mix.
+	if (presampleSounds && (device != nullptr))
+	{
+		ALCint frequency = 0;
+		alcGetIntegerv(device, ALC_FREQUENCY, 1, &frequency);
+		mPresampleRate = std::max(frequency, 0);
+	}
+
 	mHasResamplerExtension = alIsExtensionPresent("AL_SOFT_source_resampler") != AL_FALSE;
 	mResampler = mHasResamplerExtension ? 
 		AudioManagerImpl::getResamplingIndex(resamplingOption) :
 		AudioManagerImpl::UNSUPPORTED_EXTENSION;
 
-	// Generate the sound sources.
+	// Generate the sound sources. The first one is kept for music and the rest are voices.
 	for (int i = 0; i < maxChannels; i++)
 	{
 		ALuint source;
@@ -491,7 +1139,47 @@ void AudioManagerImpl::init(double musicVolume, double soundVolume, int maxChann
 			alSourcei(source, AL_SOURCE_RESAMPLER_SOFT, mResampler);
 		}
 
-		mFreeSources.push_back(source);
+		if (i == 0)
+		{
+			mFreeSources.push_back(source);
+		}
+		else
+		{
+			// Positional sounds fade out over the same distance that getAudibility() uses.
+			alSourcef(source, AL_REFERENCE_DISTANCE,
+				static_cast<ALfloat>(AudioManagerImpl::SOUND_REFERENCE_DISTANCE));
+			alSourcef(source, AL_MAX_DISTANCE,
+				static_cast<ALfloat>(AudioManagerImpl::SOUND_MAX_DISTANCE));
+			alSourcef(source, AL_ROLLOFF_FACTOR, 1.0f);
+			mVoiceSources.push_back(source);
+		}
+	}
+
+	alDistanceModel(AL_LINEAR_DISTANCE_CLAMPED);
+	mFreeVoiceSources = mVoiceSources;
+
+	// Voices are handed sources as they're needed, so there are more voices than sources
+	// for virtual ones to play in.
+	const int voiceCount = std::min(
+		static_cast<int>(mVoiceSources.size()) * AudioManagerImpl::VOICES_PER_SOURCE,
+		static_cast<int>(AudioManager::HANDLE_VOICE_MASK + 1));
+	DebugAssert(static_cast<int>(mVoiceSources.size()) <= voiceCount,
+		"Too many sound channels (" + std::to_string(maxChannels) + ").");
+
+	for (int i = 0; i < voiceCount; i++)
+	{
+		Voice voice;
+		voice.source = 0;
+		voice.generation = 1;
+		voice.soundID = -1;
+		voice.priority = 0;
+		voice.startOrder = 0;
+		voice.activeIndex = -1;
+		voice.startTime = 0.0;
+		voice.audibility = 0.0f;
+		voice.positional = false;
+		mFreeVoices.push_back(static_cast<int>(mVoices.size()));
+		mVoices.push_back(voice);
 	}
 
 	this->setMusicVolume(musicVolume);
@@ -504,8 +1192,28 @@ void AudioManagerImpl::playMusic(const std::string &filename)
 
 	if (!mFreeSources.empty())
 	{
-		if (MidiDevice::isInited())
+		// Play the rendered song if there is one. Otherwise, synthesize it live and render
+		// it for next time.
+		const auto cacheIter = mRenderedSongs.find(AssetName(filename));
+		if (cacheIter != mRenderedSongs.end())
+		{
+			CachedSong &cachedSong = cacheIter->second;
+			cachedSong.lastPlayed = ++mMusicPlayCount;
+
+			const std::shared_ptr<const std::vector<char>> samples(cachedSong.song,
+				&cachedSong.song->samples);
+			mCurrentSong = std::make_unique<RenderedMidiSong>(samples,
+				cachedSong.song->sampleRate);
+		}
+		else if (MidiDevice::isInited())
+		{
 			mCurrentSong = MidiDevice::get().open(filename);
+			if (mCurrentSong && (mMusicCacheBudget > 0))
+			{
+				this->renderSong(filename);
+			}
+		}
+
 		if (!mCurrentSong)
 		{
 			DebugMention("Failed to play " + filename + ".");
@@ -526,50 +1234,406 @@ void AudioManagerImpl::playMusic(const std::string &filename)
 	}
 }
 
-void AudioManagerImpl::playSound(const std::string &filename)
+void AudioManagerImpl::setMusicCacheBudget(size_t bytes)
 {
+	// Songs that were too big might fit a bigger budget.
+	if (bytes > mMusicCacheBudget)
+	{
+		mLiveSongs.clear();
+	}
+
+	mMusicCacheBudget = bytes;
+	this->trimMusicCache();
+}
+
+void AudioManagerImpl::renderSong(const std::string &filename)
+{
+	const AssetName name(filename);
+	if ((mJobSystem == nullptr) || (mRenderingSongs.find(name) != mRenderingSongs.end()) ||
+		(mLiveSongs.find(name) != mLiveSongs.end()))
+	{
+		return;
+	}
+
+	// The worker opens its own song, so it doesn't share a read position with the live one.
+	auto renderedSong = std::make_shared<RenderedSong>();
+	const size_t maxBytes = mMusicCacheBudget;
+	const std::shared_ptr<std::atomic<bool>> cancelled = mCancelSongRenders;
+	const JobSystem::JobHandle job = mJobSystem->add([renderedSong, filename, maxBytes,
+		cancelled]()
+	{
+		MidiSongPtr song = MidiDevice::get().open(filename);
+		if (!song)
+		{
+			return;
+		}
+
+		// Read until the song ends instead of looping like the stream does.
+		const size_t frameSize = 4;
+		const size_t chunkFrames = 16384;
+		std::vector<char> &samples = renderedSong->samples;
+		song->getFormat(&renderedSong->sampleRate);
+		while (true)
+		{
+			if (cancelled->load())
+			{
+				samples.clear();
+				samples.shrink_to_fit();
+				return;
+			}
+
+			const size_t oldSize = samples.size();
+			if ((oldSize + (chunkFrames * frameSize)) > maxBytes)
+			{
+				// Too big for the cache to ever hold, so it stays live.
+				samples.clear();
+				samples.shrink_to_fit();
+				renderedSong->overBudget = true;
+				return;
+			}
+
+			samples.resize(oldSize + (chunkFrames * frameSize));
+			const size_t got = song->read(samples.data() + oldSize, chunkFrames);
+			samples.resize(oldSize + (got * frameSize));
+			if (got < chunkFrames)
+			{
+				break;
+			}
+		}
+
+		samples.shrink_to_fit();
+	}, std::vector<JobSystem::JobHandle>(), [this, name, renderedSong, cancelled]()
+	{
+		if (cancelled->load())
+		{
+			return;
+		}
+
+		mRenderingSongs.erase(name);
+
+		if (renderedSong->overBudget)
+		{
+			mLiveSongs.insert(name);
+			return;
+		}
+
+		// The budget might have shrunk while it was rendering.
+		const size_t size = renderedSong->samples.size();
+		if ((size == 0) || (size > mMusicCacheBudget))
+		{
+			return;
+		}
+
+		CachedSong cachedSong;
+		cachedSong.song = renderedSong;
+		cachedSong.lastPlayed = ++mMusicPlayCount;
+		mRenderedSongs[name] = cachedSong;
+		mMusicCacheBytes += size;
+		MemoryTracker::add(MemoryTag::MusicCache, size);
+		this->trimMusicCache();
+	}, JobSystem::Priority::Background);
+
+	mRenderingSongs.insert(std::make_pair(name, job));
+}
+
+void AudioManagerImpl::trimMusicCache()
+{
+	while (mMusicCacheBytes > mMusicCacheBudget)
+	{
+		auto oldestIter = mRenderedSongs.begin();
+		for (auto iter = mRenderedSongs.begin(); iter != mRenderedSongs.end(); ++iter)
+		{
+			if (iter->second.lastPlayed < oldestIter->second.lastPlayed)
+			{
+				oldestIter = iter;
+			}
+		}
+
+		// A song that's playing keeps its samples until its stream is done with them.
+		const size_t size = oldestIter->second.song->samples.size();
+		mMusicCacheBytes -= size;
+		MemoryTracker::remove(MemoryTag::MusicCache, size);
+		mRenderedSongs.erase(oldestIter);
+	}
+}
+
+void AudioManagerImpl::setSoundCacheBudget(size_t bytes)
+{
+	mSoundCacheBudget = bytes;
+	this->trimSoundCache();
+}
+
+void AudioManagerImpl::setMusicThreadPriority(bool raised)
+{
+	mRaiseMusicPriority.store(raised);
+}
+
+void AudioManagerImpl::trimSoundCache()
+{
+	if (mSoundCacheBudget == 0)
+	{
+		return;
+	}
+
+	while (mSoundCacheBytes > mSoundCacheBudget)
+	{
+		int oldestID = -1;
+		for (int i = 0; i < static_cast<int>(mSounds.size()); i++)
+		{
+			const Sound &sound = mSounds[i];
+			if (sound.loaded && !sound.pinned && (sound.voiceCount == 0) &&
+				((oldestID < 0) || (sound.lastPlayed < mSounds[oldestID].lastPlayed)))
+			{
+				oldestID = i;
+			}
+		}
+
+		// Everything left is playing or pinned.
+		if (oldestID < 0)
+		{
+			break;
+		}
+
+		// No source has the buffer, since voices detach it when they give theirs up.
+		Sound &sound = mSounds[oldestID];
+		alDeleteBuffers(1, &sound.buffer);
+		mSoundCacheBytes -= sound.bufferBytes;
+		MemoryTracker::remove(MemoryTag::SoundBuffers, sound.bufferBytes);
+		sound.buffer = 0;
+		sound.bufferBytes = 0;
+		sound.loaded = false;
+	}
+}
+
+int AudioManagerImpl::getSoundID(const std::string &filename)
+{
+	const AssetName name(filename);
+	const auto iter = mSoundIDs.find(name);
+	if (iter != mSoundIDs.end())
+	{
+		return iter->second;
+	}
+
+	Sound sound;
+	sound.filename = filename;
+	sound.buffer = 0;
+	sound.bufferBytes = 0;
+	sound.loaded = false;
+	sound.pending = false;
+	sound.singleInstance = SingleInstanceSounds.find(filename) != SingleInstanceSounds.end();
+	sound.pinned = false;
+	sound.voiceCount = 0;
+	sound.lastPlayed = 0;
+	sound.duration = 0.0;
+
+	const int soundID = static_cast<int>(mSounds.size());
+	mSounds.push_back(std::move(sound));
+	mSoundIDs.insert(std::make_pair(name, soundID));
+	return soundID;
+}
+
+void AudioManagerImpl::setSoundPinned(int soundID, bool pinned)
+{
+	mSounds[soundID].pinned = pinned;
+	if (!pinned)
+	{
+		this->trimSoundCache();
+	}
+}
+
+AudioManager::SoundHandle AudioManagerImpl::playSound(int soundID, int priority,
+	bool positional, const Double3 &position)
+{
+	ProfileScope("AudioManagerImpl::playSound");
+
+	Sound &sound = mSounds[soundID];
+
 	// Certain sounds (like DRUMS.VOC) should only have one live instance at a time.
 	// This is purely an arbitrary rule to avoid having long sounds overlap each other
 	// which would ultimately be very annoying and/or distracting for the player.
-	const bool isSingleInstance =
-		SingleInstanceSounds.find(filename) != SingleInstanceSounds.end();
-	const bool allowedToPlay = !isSingleInstance ||
-		(isSingleInstance && !this->soundIsPlaying(filename));
+	if (sound.singleInstance && (sound.voiceCount > 0))
+	{
+		return AudioManager::NO_SOUND;
+	}
+
+	const int voiceIndex = this->acquireVoice(priority);
+	if (voiceIndex < 0)
+	{
+		return AudioManager::NO_SOUND;
+	}
+
+	const bool newlyLoaded = !sound.loaded;
+	if (newlyLoaded)
+	{
+		// The sound wasn't preloaded (or is still decoding, or was unloaded), so load the
+		// .VOC file here. A preload that finishes later keeps this buffer.
+		SoundData soundData;
+		AudioManagerImpl::loadSoundData(sound.filename, mPresampleRate, soundData);
+
+		ALuint bufferID;
+		alGenBuffers(1, &bufferID);
+		DebugAssert(alGetError() == AL_NO_ERROR, "alGenBuffers");
 
-	if (!mFreeSources.empty() && allowedToPlay)
+		this->setSoundBuffer(sound, bufferID, soundData);
+	}
+
+	sound.lastPlayed = ++mSoundPlayCount;
+
+	Voice &voice = mVoices[voiceIndex];
+	voice.soundID = soundID;
+	voice.priority = priority;
+	voice.startOrder = mNextStartOrder;
+	voice.activeIndex = static_cast<int>(mActiveVoices.size());
+	voice.startTime = this->getTime();
+	voice.positional = positional;
+	voice.position = position;
+	mNextStartOrder++;
+	mActiveVoices.push_back(voiceIndex);
+	sound.voiceCount++;
+
+	// Its voice keeps it loaded, so only other sounds can make room.
+	if (newlyLoaded)
 	{
-		auto vocIter = mSoundBuffers.find(filename);
+		this->trimSoundCache();
+	}
 
-		if (vocIter == mSoundBuffers.end())
+	// Play it through a source if it can be heard and one is free, or if it outranks a
+	// voice with one. Otherwise it starts out virtual, and update() gives it a source
+	// once it's among the loudest.
+	voice.audibility = this->getAudibility(voiceIndex);
+	if (voice.audibility > 0.0f)
+	{
+		if (mFreeVoiceSources.empty())
 		{
-			// Load the .VOC file and give its PCM data to a new OpenAL buffer.
-			const VOCFile voc(filename);
+			const int weakestIndex = this->getWeakestSourcedVoice();
+			if ((weakestIndex >= 0) && this->voiceOutranks(voiceIndex, weakestIndex, 1.0f))
+			{
+				this->takeVoiceSource(weakestIndex);
+			}
+		}
+
+		if (!mFreeVoiceSources.empty())
+		{
+			this->giveVoiceSource(voiceIndex);
+		}
+	}
 
-			ALuint bufferID;
-			alGenBuffers(1, &bufferID);
-			DebugAssert(alGetError() == AL_NO_ERROR, "alGenBuffers");
+	return static_cast<AudioManager::SoundHandle>(voiceIndex) |
+		(static_cast<AudioManager::SoundHandle>(voice.generation) <<
+		AudioManager::HANDLE_VOICE_BITS);
+}
 
-			const std::vector<uint8_t> &audioData = voc.getAudioData();
+void AudioManagerImpl::preloadSounds(const std::vector<std::string> &filenames,
+	JobSystem &jobSystem)
+{
+	struct DecodedSound
+	{
+		int soundID;
+		std::string filename;
+		SoundData soundData;
+	};
 
-			alBufferData(bufferID, AL_FORMAT_MONO8,
-				static_cast<const ALvoid*>(audioData.data()),
-				static_cast<ALsizei>(audioData.size()),
-				static_cast<ALsizei>(voc.getSampleRate()));
+	// Without voices (i.e., audio was never initialized), nothing could play them.
+	if (mVoices.empty())
+	{
+		return;
+	}
 
-			vocIter = mSoundBuffers.insert(std::make_pair(filename, bufferID)).first;
+	// Shared with the jobs, so they don't depend on this manager while running.
+	auto sounds = std::make_shared<std::vector<DecodedSound>>();
+	for (const std::string &filename : filenames)
+	{
+		const int soundID = this->getSoundID(filename);
+		Sound &sound = mSounds[soundID];
+		if (!sound.loaded && !sound.pending)
+		{
+			DecodedSound decodedSound;
+			decodedSound.soundID = soundID;
+			decodedSound.filename = filename;
+			decodedSound.soundData.sampleRate = 0;
+			sounds->push_back(std::move(decodedSound));
+			sound.pending = true;
 		}
+	}
 
-		// Set up the sound source.
-		const ALuint source = mFreeSources.front();
-		alSourcei(source, AL_BUFFER, vocIter->second);
-		alSourcei(source, AL_SOURCE_RESAMPLER_SOFT, mResampler);
+	if (sounds->empty())
+	{
+		return;
+	}
 
-		// Play the sound.
-		alSourcePlay(source);
+	// The files are read ahead of textures and level prefetches on the VFS's I/O thread,
+	// all in one batch.
+	std::vector<std::string> soundFilenames;
+	for (const DecodedSound &decodedSound : *sounds)
+	{
+		soundFilenames.push_back(decodedSound.filename);
+	}
+
+	const VFS::ReadRequestPtr read = VFS::Manager::get().readAsync(
+		std::move(soundFilenames), VFS::ReadPriority::Audio);
+
+	// The decode jobs are only queued once the batch is read (by whichever thread finishes
+	// it), so none of them holds up a worker on the disk.
+	const JobSystem::JobHandle readJob = jobSystem.addSignal(JobSystem::Priority::Background);
+	read->onDone([&jobSystem, readJob]()
+	{
+		jobSystem.signal(readJob);
+	});
 
-		mUsedSources.push_front(std::make_pair(filename, source));
-		mFreeSources.pop_front();
+	mPreloadReads.erase(std::remove_if(mPreloadReads.begin(), mPreloadReads.end(),
+		[](const VFS::ReadRequestPtr &preloadRead)
+	{
+		return preloadRead->isDone();
+	}), mPreloadReads.end());
+	mPreloadReads.push_back(read);
+
+	// Resampling is done by the jobs too, so it never happens on the main thread for
+	// preloaded sounds.
+	std::vector<JobSystem::JobHandle> decodeJobs;
+	const int presampleRate = mPresampleRate;
+	for (size_t i = 0; i < sounds->size(); i++)
+	{
+		decodeJobs.push_back(jobSystem.add([sounds, i, presampleRate]()
+		{
+			DecodedSound &sound = (*sounds)[i];
+			AudioManagerImpl::loadSoundData(sound.filename, presampleRate, sound.soundData);
+		}, { readJob }, std::function<void()>(), JobSystem::Priority::Background));
 	}
+
+	// Make the buffers for the whole list in one main thread callback.
+	jobSystem.add([]() { }, decodeJobs, [this, sounds]()
+	{
+		// Skip sounds that playSound() had to load in the meantime.
+		std::vector<const DecodedSound*> newSounds;
+		for (const DecodedSound &decodedSound : *sounds)
+		{
+			Sound &sound = mSounds[decodedSound.soundID];
+			sound.pending = false;
+			if (!sound.loaded)
+			{
+				newSounds.push_back(&decodedSound);
+			}
+		}
+
+		if (newSounds.empty())
+		{
+			return;
+		}
+
+		std::vector<ALuint> bufferIDs(newSounds.size());
+		alGenBuffers(static_cast<ALsizei>(bufferIDs.size()), bufferIDs.data());
+		DebugAssert(alGetError() == AL_NO_ERROR, "alGenBuffers");
+
+		for (size_t i = 0; i < newSounds.size(); i++)
+		{
+			const DecodedSound &decodedSound = *newSounds[i];
+			Sound &sound = mSounds[decodedSound.soundID];
+			this->setSoundBuffer(sound, bufferIDs[i], decodedSound.soundData);
+			sound.lastPlayed = ++mSoundPlayCount;
+		}
+
+		this->trimSoundCache();
+	});
 }
 
 void AudioManagerImpl::stopMusic()
@@ -585,17 +1649,38 @@ void AudioManagerImpl::stopMusic()
 
 void AudioManagerImpl::stopSound()
 {
-	// Reset all used sources and return them to the free sources.
-	for (const auto &pair : mUsedSources)
+	// Reset all active voices and return them to the free voices.
+	while (!mActiveVoices.empty())
+	{
+		this->releaseVoice(mActiveVoices.back());
+	}
+}
+
+void AudioManagerImpl::stopSound(AudioManager::SoundHandle handle)
+{
+	if (this->soundIsPlaying(handle))
+	{
+		this->releaseVoice(static_cast<int>(handle & AudioManager::HANDLE_VOICE_MASK));
+	}
+}
+
+bool AudioManagerImpl::soundIsPlaying(AudioManager::SoundHandle handle) const
+{
+	if (handle == AudioManager::NO_SOUND)
 	{
-		const ALuint source = pair.second;
-		alSourceStop(source);
-		alSourceRewind(source);
-		alSourcei(source, AL_BUFFER, 0);
-		mFreeSources.push_front(source);
+		return false;
 	}
 
-	mUsedSources.clear();
+	// The handle is stale if its voice was reused or released.
+	const int voiceIndex = static_cast<int>(handle & AudioManager::HANDLE_VOICE_MASK);
+	const uint32_t generation = handle >> AudioManager::HANDLE_VOICE_BITS;
+	if (voiceIndex >= static_cast<int>(mVoices.size()))
+	{
+		return false;
+	}
+
+	const Voice &voice = mVoices[voiceIndex];
+	return (voice.soundID >= 0) && (voice.generation == generation);
 }
 
 void AudioManagerImpl::setMusicVolume(double percent)
@@ -612,15 +1697,14 @@ void AudioManagerImpl::setSoundVolume(double percent)
 {
 	mSfxVolume = static_cast<float>(percent);
 
-	// Set volumes of free and used sound channels.
+	// Set volumes of all sound channels, free or not.
 	for (const ALuint source : mFreeSources)
 	{
 		alSourcef(source, AL_GAIN, mSfxVolume);
 	}
 
-	for (const auto &pair : mUsedSources)
+	for (const ALuint source : mVoiceSources)
 	{
-		const ALuint source = pair.second;
 		alSourcef(source, AL_GAIN, mSfxVolume);
 	}
 }
@@ -633,49 +1717,142 @@ void AudioManagerImpl::setResamplingOption(int resamplingOption)
 	// Determine which resampling index to use.
 	mResampler = AudioManagerImpl::getResamplingIndex(resamplingOption);
 
-	// Set resampling options for free and used sources.
+	// Set resampling options for all sources.
 	for (const ALuint source : mFreeSources)
 	{
 		alSourcei(source, AL_SOURCE_RESAMPLER_SOFT, mResampler);
 	}
 
-	for (const auto &pair : mUsedSources)
+	for (const ALuint source : mVoiceSources)
 	{
-		const ALuint source = pair.second;
 		alSourcei(source, AL_SOURCE_RESAMPLER_SOFT, mResampler);
 	}
 
 	if (mSongStream != nullptr)
 	{
 		// Not necessary for music itself, but necessary for keeping all sources in line,
-		// and the music source isn't stored in the used sources.
+		// and the music source isn't stored with the voices.
 		mSongStream->setResampler(mResampler);
 	}
 }
 
+int AudioManagerImpl::getMusicUnderrunCount() const
+{
+	return mMusicUnderrunCount.load();
+}
+
 void AudioManagerImpl::update()
 {
-	// If a sound source is done, reset it and return the ID to the free sources.
-	for (size_t i = 0; i < mUsedSources.size(); i++)
+	// Check a few active voices each frame, continuing round-robin from last time, and
+	// release the ones that are done. Voices are also reclaimed when they run out.
+	const int pollCount = std::min(static_cast<int>(mActiveVoices.size()),
+		AudioManagerImpl::MAX_VOICE_POLLS_PER_UPDATE);
+	for (int i = 0; i < pollCount; i++)
 	{
-		const ALuint source = mUsedSources.at(i).second;
+		if (mPollIndex >= static_cast<int>(mActiveVoices.size()))
+		{
+			mPollIndex = 0;
+		}
 
-		ALint state;
-		alGetSourcei(source, AL_SOURCE_STATE, &state);
+		const int voiceIndex = mActiveVoices[mPollIndex];
+		if (this->voiceIsStopped(voiceIndex))
+		{
+			// The last active voice takes this one's place, so poll the same index again.
+			this->releaseVoice(voiceIndex);
+		}
+		else
+		{
+			mPollIndex++;
+		}
+	}
 
-		if (state == AL_STOPPED)
+	// Positional voices get louder and quieter as the listener moves. Ones that can't be
+	// heard anymore give their sources up. Finishing is noticed by polling above.
+	for (const int voiceIndex : mActiveVoices)
+	{
+		Voice &voice = mVoices[voiceIndex];
+		if (voice.positional)
 		{
-			alSourceRewind(source);
-			alSourcei(source, AL_BUFFER, 0);
+			voice.audibility = this->getAudibility(voiceIndex);
+			if ((voice.audibility <= 0.0f) && (voice.source != 0))
+			{
+				this->takeVoiceSource(voiceIndex);
+			}
+		}
+	}
 
-			mFreeSources.push_front(source);
-			mUsedSources.erase(mUsedSources.begin() + i);
+	// Give the best virtual voices free sources, or the sources of voices they clearly
+	// outrank. Only a few move each update.
+	for (int i = 0; i < AudioManagerImpl::MAX_VOICE_SWAPS_PER_UPDATE; i++)
+	{
+		int bestIndex = -1;
+		for (const int voiceIndex : mActiveVoices)
+		{
+			const Voice &voice = mVoices[voiceIndex];
+			if ((voice.source == 0) && (voice.audibility > 0.0f) &&
+				((bestIndex < 0) || this->voiceOutranks(voiceIndex, bestIndex, 1.0f)))
+			{
+				bestIndex = voiceIndex;
+			}
 		}
+
+		if (bestIndex < 0)
+		{
+			break;
+		}
+
+		// A virtual voice that already finished would start over, so it's only released.
+		if (this->voiceIsStopped(bestIndex))
+		{
+			this->releaseVoice(bestIndex);
+			continue;
+		}
+
+		if (mFreeVoiceSources.empty())
+		{
+			const int weakestIndex = this->getWeakestSourcedVoice();
+			if ((weakestIndex < 0) || !this->voiceOutranks(bestIndex, weakestIndex,
+				AudioManagerImpl::AUDIBILITY_SWAP_MARGIN))
+			{
+				break;
+			}
+
+			this->takeVoiceSource(weakestIndex);
+		}
+
+		this->giveVoiceSource(bestIndex);
+	}
+}
+
+void AudioManagerImpl::setListener(const Double3 &position, const Double3 &direction)
+{
+	mListenerPosition = position;
+
+	// Without voices (i.e., audio was never initialized), there's no OpenAL context.
+	if (mVoices.empty())
+	{
+		return;
 	}
+
+	const std::array<ALfloat, 6> orientation =
+	{
+		static_cast<ALfloat>(direction.x), static_cast<ALfloat>(direction.y),
+		static_cast<ALfloat>(direction.z), 0.0f, 1.0f, 0.0f
+	};
+
+	alListener3f(AL_POSITION, static_cast<ALfloat>(position.x),
+		static_cast<ALfloat>(position.y), static_cast<ALfloat>(position.z));
+	alListenerfv(AL_ORIENTATION, orientation.data());
 }
 
 // Audio Manager
 
+const AudioManager::SoundHandle AudioManager::NO_SOUND = 0;
+const int AudioManager::HANDLE_VOICE_BITS = 8;
+const uint32_t AudioManager::HANDLE_VOICE_MASK = (1u << AudioManager::HANDLE_VOICE_BITS) - 1;
+const uint32_t AudioManager::HANDLE_GENERATION_MASK =
+	0xFFFFFFFFu >> AudioManager::HANDLE_VOICE_BITS;
+const int AudioManager::DEFAULT_PRIORITY = 0;
 const double AudioManager::MIN_VOLUME = 0.0;
 const double AudioManager::MAX_VOLUME = 1.0;
 
@@ -688,9 +1865,11 @@ AudioManager::~AudioManager()
 }
 
 void AudioManager::init(double musicVolume, double soundVolume, int maxChannels,
-	int resamplingOption, const std::string &midiConfig)
+	int resamplingOption, bool presampleSounds, const std::string &midiConfig,
+	JobSystem &jobSystem)
 {
-	pImpl->init(musicVolume, soundVolume, maxChannels, resamplingOption, midiConfig);
+	pImpl->init(musicVolume, soundVolume, maxChannels, resamplingOption, presampleSounds,
+		midiConfig, jobSystem);
 }
 
 double AudioManager::getMusicVolume() const
@@ -703,6 +1882,11 @@ double AudioManager::getSoundVolume() const
 	return static_cast<double>(pImpl->mSfxVolume);
 }
 
+int AudioManager::getMusicUnderrunCount() const
+{
+	return pImpl->getMusicUnderrunCount();
+}
+
 bool AudioManager::hasResamplerExtension() const
 {
 	return pImpl->mHasResamplerExtension;
@@ -713,9 +1897,57 @@ void AudioManager::playMusic(const std::string &filename)
 	pImpl->playMusic(filename);
 }
 
-void AudioManager::playSound(const std::string &filename)
+void AudioManager::setMusicCacheBudget(size_t bytes)
 {
-	pImpl->playSound(filename);
+	pImpl->setMusicCacheBudget(bytes);
+}
+
+void AudioManager::setSoundCacheBudget(size_t bytes)
+{
+	pImpl->setSoundCacheBudget(bytes);
+}
+
+void AudioManager::setMusicThreadPriority(bool raised)
+{
+	pImpl->setMusicThreadPriority(raised);
+}
+
+int AudioManager::getSoundID(const std::string &filename)
+{
+	return pImpl->getSoundID(filename);
+}
+
+void AudioManager::setSoundPinned(int soundID, bool pinned)
+{
+	pImpl->setSoundPinned(soundID, pinned);
+}
+
+AudioManager::SoundHandle AudioManager::playSound(int soundID, int priority)
+{
+	return pImpl->playSound(soundID, priority, false, Double3());
+}
+
+AudioManager::SoundHandle AudioManager::playSound(int soundID, int priority,
+	const Double3 &position)
+{
+	return pImpl->playSound(soundID, priority, true, position);
+}
+
+AudioManager::SoundHandle AudioManager::playSound(const std::string &filename)
+{
+	return pImpl->playSound(pImpl->getSoundID(filename), AudioManager::DEFAULT_PRIORITY,
+		false, Double3());
+}
+
+void AudioManager::setListener(const Double3 &position, const Double3 &direction)
+{
+	pImpl->setListener(position, direction);
+}
+
+void AudioManager::preloadSounds(const std::vector<std::string> &filenames,
+	JobSystem &jobSystem)
+{
+	pImpl->preloadSounds(filenames, jobSystem);
 }
 
 void AudioManager::stopMusic()
@@ -728,6 +1960,16 @@ void AudioManager::stopSound()
 	pImpl->stopSound();
 }
 
+void AudioManager::stopSound(SoundHandle handle)
+{
+	pImpl->stopSound(handle);
+}
+
+bool AudioManager::soundIsPlaying(SoundHandle handle) const
+{
+	return pImpl->soundIsPlaying(handle);
+}
+
 void AudioManager::setMusicVolume(double percent)
 {
 	pImpl->setMusicVolume(percent);
@@ -1,24 +1,50 @@
 #ifndef AUDIO_MANAGER_H
 #define AUDIO_MANAGER_H
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
+
+#include "../Math/Vector3.h"
 
 // This class manages what sounds and music are played by OpenAL Soft.
 
+// There are more voices than OpenAL sources, and the loudest voices of the highest
+// priority get the sources. The rest play virtually with no source, keeping only their
+// place in the sound, so crowds of positional sounds cost no more to mix than a few.
+
 class AudioManagerImpl;
+class JobSystem;
 class Options;
 
 class AudioManager
 {
+public:
+	// Identifies one playing instance of a sound. The low bits are the voice index and the
+	// rest are the voice's generation, so a handle goes stale once its voice is reused.
+	typedef uint32_t SoundHandle;
+
+	static const SoundHandle NO_SOUND;
+	static const int HANDLE_VOICE_BITS;
+	static const uint32_t HANDLE_VOICE_MASK;
+	static const uint32_t HANDLE_GENERATION_MASK;
+
+	// Priority of sounds played by filename.
+	static const int DEFAULT_PRIORITY;
 private:
 	std::unique_ptr<AudioManagerImpl> pImpl;
 public:
 	AudioManager();
 	~AudioManager(); // Required for pImpl to stay in .cpp file.
 
+	// Opens the OpenAL device and WildMidi. If it's never called (i.e., when headless),
+	// the manager stays silent and every sound fails to play. Presampling sounds converts
+	// each one to 16-bit at the device rate when it's loaded, so voices don't need
+	// resampling while they play.
     void init(double musicVolume, double soundVolume, int maxChannels, 
-		int resamplingOption, const std::string &midiConfig);
+		int resamplingOption, bool presampleSounds, const std::string &midiConfig,
+		JobSystem &jobSystem);
 
 	static const double MIN_VOLUME;
 	static const double MAX_VOLUME;
@@ -26,14 +52,57 @@ public:
 	double getMusicVolume() const;
 	double getSoundVolume() const;
 
+	// Gets how many times music playback has run out of queued audio and restarted, for
+	// spotting stutters.
+	int getMusicUnderrunCount() const;
+
 	// Returns whether the implementation supports resampling options.
 	bool hasResamplerExtension() const;
 
-	// Plays a music file. All music should loop until changed.
+	// Plays a music file. All music should loop until changed. With a music cache budget,
+	// a song played for the first time is synthesized live while it's also rendered on a
+	// worker, and later plays stream the rendered samples instead.
 	void playMusic(const std::string &filename);
 
-	// Plays a sound file. All sounds should play once.
-	void playSound(const std::string &filename);
+	// Sets how many bytes of rendered music to keep, dropping the least recently played
+	// songs past it. 0 turns rendering off, so music is always synthesized live.
+	void setMusicCacheBudget(size_t bytes);
+
+	// Sets how many bytes of sound samples to keep in OpenAL buffers. Past it, the least
+	// recently played sounds that nothing is playing are unloaded, and decoded again the
+	// next time they play. 0 means no limit.
+	void setSoundCacheBudget(size_t bytes);
+
+	// Sets whether the music stream thread runs at audio priority, so it isn't held up by
+	// the game's other threads. It applies from the next song that starts playing.
+	void setMusicThreadPriority(bool raised);
+
+	// Gets the ID of a sound file for playing it without looking up its filename each time.
+	// IDs stay valid for the manager's lifetime.
+	int getSoundID(const std::string &filename);
+
+	// Sets whether a sound is kept loaded regardless of the sound cache budget, for sounds
+	// like interface clicks and combat that should never wait on decoding.
+	void setSoundPinned(int soundID, bool pinned);
+
+	// Plays a sound once. Sounds that weren't preloaded are decoded on the spot. If every
+	// voice is busy, the lowest priority one (oldest first) is stolen as long as its
+	// priority isn't higher. Returns NO_SOUND if the sound couldn't play. If every source
+	// is taken by voices that outrank it, the sound starts out virtual.
+	SoundHandle playSound(int soundID, int priority);
+	SoundHandle playSound(const std::string &filename);
+
+	// Plays a sound once at a point in the world. It fades with distance from the listener,
+	// and past a few dozen voxels it can't be heard and plays virtually until it can.
+	SoundHandle playSound(int soundID, int priority, const Double3 &position);
+
+	// Sets where positional sounds are heard from, and the direction the listener faces.
+	void setListener(const Double3 &position, const Double3 &direction);
+
+	// Decodes the given sound files on worker threads so playing them later doesn't stall
+	// the frame. Their OpenAL buffers are all made at once on the main thread when the last
+	// one is decoded. Sounds that are already loaded or being loaded are skipped.
+	void preloadSounds(const std::vector<std::string> &filenames, JobSystem &jobSystem);
 
 	// Stops the music.
 	void stopMusic();
@@ -41,6 +110,13 @@ public:
 	// Stops all sounds.
 	void stopSound();
 
+	// Stops a sound if its handle is still playing.
+	void stopSound(SoundHandle handle);
+
+	// Returns whether the handle's sound hasn't been stopped or found finished yet. Finished
+	// sounds are noticed over a few updates, not right away.
+	bool soundIsPlaying(SoundHandle handle) const;
+
 	// Sets the music volume. Percent must be between 0.0 and 1.0.
 	void setMusicVolume(double percent);
 
@@ -53,7 +129,7 @@ public:
 	void setResamplingOption(int resamplingOption);
 
 	// Updates any state not handled by a background thread, such as resetting 
-	// the sources of finished sounds.
+	// the sources of finished sounds. Only a few voices are checked each time.
 	void update();
 };
 
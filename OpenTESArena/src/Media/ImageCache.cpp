@@ -0,0 +1,424 @@
+#include <array>
+#include <cassert>
+#include <iterator>
+#include <thread>
+
+#include "ImageCache.h"
+#include "../Assets/CFAFile.h"
+#include "../Assets/CIFFile.h"
+#include "../Assets/COLFile.h"
+#include "../Assets/DFAFile.h"
+#include "../Assets/FLCDecoder.h"
+#include "../Assets/IMGFile.h"
+#include "../Assets/RCIFile.h"
+#include "../Assets/SETFile.h"
+#include "../Utilities/Debug.h"
+#include "../Utilities/JobSystem.h"
+#include "../Utilities/Profiler.h"
+
+size_t ImageCache::Key::Hash::operator()(const Key &key) const
+{
+	const AssetName::Hash hash;
+	return hash(key.filename) ^ (hash(key.paletteName) * 31);
+}
+
+ImageCache::Key::Key(const std::string &filename, const std::string &paletteName)
+	: filename(filename), paletteName(paletteName) { }
+
+ImageCache::Key::Key() { }
+
+bool ImageCache::Key::operator==(const Key &other) const
+{
+	return (this->filename == other.filename) && (this->paletteName == other.paletteName);
+}
+
+ImageCache::Entry::Entry()
+{
+	this->decoding = false;
+}
+
+const int ImageCache::SHARD_COUNT = 16;
+
+ImageCache::ImageCache()
+	: shards(new Shard[ImageCache::SHARD_COUNT])
+{
+	this->jobSystem = nullptr;
+}
+
+bool ImageCache::isSingleImage(const std::string &filename)
+{
+	const AssetName::Extension extension = AssetName(filename).getExtension();
+	return (extension == AssetName::Extension::COL) ||
+		(extension == AssetName::Extension::IMG) ||
+		(extension == AssetName::Extension::MNU);
+}
+
+IndexedImage ImageCache::decodeImage(const std::string &filename,
+	const std::shared_ptr<const Palette> &palette)
+{
+	ProfileScope("ImageCache::decodeImage");
+
+	// Check what kind of file extension the filename has.
+	const AssetName::Extension extension = AssetName(filename).getExtension();
+	const bool isCOL = extension == AssetName::Extension::COL;
+	const bool isIMG = extension == AssetName::Extension::IMG;
+	const bool isMNU = extension == AssetName::Extension::MNU;
+
+	if (isCOL)
+	{
+		// A palette was requested as the primary image. Show each of its colors once.
+		auto colPalette = std::make_shared<Palette>();
+		COLFile::toPalette(filename, *colPalette);
+
+		assert(colPalette->get().size() == 256);
+		std::array<uint8_t, 256> indices;
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			indices[i] = static_cast<uint8_t>(i);
+		}
+
+		return IndexedImage(16, 16, indices.data(), colPalette);
+	}
+	else if (isIMG || isMNU)
+	{
+		IMGFile img(filename);
+		return IndexedImage(img.getWidth(), img.getHeight(), img.getRawPixels(), palette);
+	}
+	else
+	{
+		DebugCrash("Unrecognized surface format \"" + filename + "\".");
+		return IndexedImage(0, 0, nullptr, palette);
+	}
+}
+
+std::vector<IndexedImage> ImageCache::decodeImageSet(const std::string &filename,
+	const std::shared_ptr<const Palette> &palette, JobSystem *jobSystem)
+{
+	ProfileScope("ImageCache::decodeImageSet");
+
+	// This method deals with animations and movies, so it will check filenames 
+	// for ".CFA", ".CIF", ".DFA", ".FLC", ".SET", etc..
+	const AssetName::Extension extension = AssetName(filename).getExtension();
+	const bool isCFA = extension == AssetName::Extension::CFA;
+	const bool isCIF = extension == AssetName::Extension::CIF;
+	const bool isCEL = extension == AssetName::Extension::CEL;
+	const bool isDFA = extension == AssetName::Extension::DFA;
+	const bool isFLC = extension == AssetName::Extension::FLC;
+	const bool isRCI = extension == AssetName::Extension::RCI;
+	const bool isSET = extension == AssetName::Extension::SET;
+
+	std::vector<IndexedImage> images;
+
+	// CFA, CIF, and DFA frames don't depend on each other, so they're decoded in parallel
+	// if they can be. FLC and CEL frames are deltas of the frame before, and SET and RCI
+	// frames are stored uncompressed.
+	const bool parallelFrames = (jobSystem != nullptr) && (isCFA || isCIF || isDFA);
+
+	if (isCFA)
+	{
+		const CFAFile cfaFile = parallelFrames ? CFAFile(filename, *jobSystem) : CFAFile(filename);
+		for (int i = 0; i < cfaFile.getImageCount(); i++)
+		{
+			images.push_back(IndexedImage(cfaFile.getWidth(), cfaFile.getHeight(),
+				cfaFile.getRawPixels(i), palette));
+		}
+	}
+	else if (isCIF)
+	{
+		const CIFFile cifFile = parallelFrames ? CIFFile(filename, *jobSystem) : CIFFile(filename);
+		for (int i = 0; i < cifFile.getImageCount(); i++)
+		{
+			images.push_back(IndexedImage(cifFile.getWidth(i), cifFile.getHeight(i),
+				cifFile.getRawPixels(i), palette));
+		}
+	}
+	else if (isDFA)
+	{
+		const DFAFile dfaFile = parallelFrames ? DFAFile(filename, *jobSystem) : DFAFile(filename);
+		for (int i = 0; i < dfaFile.getImageCount(); i++)
+		{
+			images.push_back(IndexedImage(dfaFile.getWidth(), dfaFile.getHeight(),
+				dfaFile.getRawPixels(i), palette));
+		}
+	}
+	else if (isFLC || isCEL)
+	{
+		// CELs are basically identical to FLCs. They have their own palettes, which can
+		// change between frames, so frames only share a palette until it changes.
+		FLCDecoder decoder(filename);
+		std::shared_ptr<const Palette> flcPalette;
+		while (decoder.decodeNextFrame())
+		{
+			if ((flcPalette.get() == nullptr) ||
+				(flcPalette->get() != decoder.getPalette().get()))
+			{
+				flcPalette = std::make_shared<const Palette>(decoder.getPalette());
+			}
+
+			images.push_back(IndexedImage(decoder.getWidth(), decoder.getHeight(),
+				decoder.getFrameIndices(), flcPalette));
+		}
+	}
+	else if (isRCI)
+	{
+		RCIFile rciFile(filename);
+		for (int i = 0; i < rciFile.getCount(); i++)
+		{
+			images.push_back(IndexedImage(RCIFile::FRAME_WIDTH, RCIFile::FRAME_HEIGHT,
+				rciFile.getRawPixels(i), palette));
+		}
+	}
+	else if (isSET)
+	{
+		SETFile setFile(filename);
+		for (int i = 0; i < setFile.getImageCount(); i++)
+		{
+			images.push_back(IndexedImage(SETFile::CHUNK_WIDTH, SETFile::CHUNK_HEIGHT,
+				setFile.getRawPixels(i), palette));
+		}
+	}
+	else
+	{
+		DebugCrash("Unrecognized surface list \"" + filename + "\".");
+	}
+
+	return images;
+}
+
+std::shared_ptr<const Palette> ImageCache::loadPalette(const std::string &paletteName)
+{
+	// Get file extension of the palette name.
+	const AssetName::Extension extension = AssetName(paletteName).getExtension();
+	const bool isCOL = extension == AssetName::Extension::COL;
+	const bool isIMG = extension == AssetName::Extension::IMG;
+	const bool isMNU = extension == AssetName::Extension::MNU;
+
+	auto palette = std::make_shared<Palette>();
+	if (isCOL)
+	{
+		COLFile::toPalette(paletteName, *palette);
+	}
+	else if (isIMG || isMNU)
+	{
+		IMGFile::extractPalette(paletteName, *palette);
+	}
+	else
+	{
+		DebugCrash("Unrecognized palette \"" + paletteName + "\".");
+	}
+
+	return palette;
+}
+
+void ImageCache::shareIndices(IndexedImage &image)
+{
+	std::lock_guard<std::mutex> lock(this->sharedIndicesMutex);
+	const uint64_t hash = image.getHash();
+	const auto sharedIter = this->sharedIndices.find(hash);
+	if (sharedIter != this->sharedIndices.end())
+	{
+		const std::shared_ptr<const std::vector<uint8_t>> indices = sharedIter->second.lock();
+		if (indices.get() != nullptr)
+		{
+			// A hash collision leaves the image with its own indices.
+			image.shareIndices(indices);
+			return;
+		}
+
+		// The images that shared these indices are gone, and ones freed along with them
+		// (i.e., by a level change) likely are too, so drop every expired entry.
+		for (auto iter = this->sharedIndices.begin(); iter != this->sharedIndices.end();)
+		{
+			iter = iter->second.expired() ? this->sharedIndices.erase(iter) : std::next(iter);
+		}
+	}
+
+	this->sharedIndices[hash] = image.getSharedIndices();
+}
+
+std::shared_ptr<const Palette> ImageCache::getPalette(const std::string &paletteName)
+{
+	// Palettes are small and few, so they're loaded under the lock. That way no palette
+	// is ever loaded twice.
+	std::lock_guard<std::mutex> lock(this->palettesMutex);
+
+	const AssetName key(paletteName);
+	auto paletteIter = this->palettes.find(key);
+	if (paletteIter == this->palettes.end())
+	{
+		paletteIter = this->palettes.emplace(std::make_pair(
+			key, ImageCache::loadPalette(paletteName))).first;
+	}
+
+	return paletteIter->second;
+}
+
+std::shared_ptr<const Palette> ImageCache::getImagePalette(const std::string &filename,
+	const std::string &paletteName)
+{
+	// Use the filename (i.e., TAMRIEL.IMG) if using the built-in palette. Otherwise, use
+	// the given palette name (i.e., PAL.COL).
+	return this->getPalette(Palette::isBuiltIn(paletteName) ? filename : paletteName);
+}
+
+ImageCache::ImagesPtr ImageCache::decodeImages(const std::string &filename,
+	const std::string &paletteName)
+{
+	// Do not use a built-in palette for image sets.
+	const bool singleImage = ImageCache::isSingleImage(filename);
+	DebugAssert(singleImage || !Palette::isBuiltIn(paletteName),
+		"Image sets (i.e., .SET files) do not have built-in palettes.");
+
+	const std::shared_ptr<const Palette> palette =
+		this->getImagePalette(filename, paletteName);
+
+	auto decodedImages = std::make_shared<std::vector<IndexedImage>>();
+	if (singleImage)
+	{
+		decodedImages->push_back(ImageCache::decodeImage(filename, palette));
+	}
+	else
+	{
+		*decodedImages = ImageCache::decodeImageSet(filename, palette, this->jobSystem);
+	}
+
+	for (IndexedImage &image : *decodedImages)
+	{
+		this->shareIndices(image);
+	}
+
+	return decodedImages;
+}
+
+void ImageCache::finishDecode(Shard &shard, const Key &key, const ImagesPtr &images)
+{
+	JobSystem::JobHandle decodedJob;
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		Entry &entry = shard.entries[key];
+		entry.images = images;
+		entry.decoding = false;
+		decodedJob = std::move(entry.decodedJob);
+		entry.decodedJob = nullptr;
+
+		// Waiting threads look their entry up again, so erasing others here is safe.
+		for (auto iter = shard.entries.begin(); iter != shard.entries.end();)
+		{
+			const Entry &other = iter->second;
+			if (!other.decoding && other.images.expired())
+			{
+				iter = shard.entries.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+	}
+
+	shard.decoded.notify_all();
+
+	if (decodedJob.get() != nullptr)
+	{
+		this->jobSystem->signal(decodedJob);
+	}
+}
+
+ImageCache::ImagesPtr ImageCache::getImages(const std::string &filename,
+	const std::string &paletteName)
+{
+	const Key key(filename, paletteName);
+	Shard &shard = this->shards[Key::Hash()(key) % ImageCache::SHARD_COUNT];
+	const std::thread::id thisThread = std::this_thread::get_id();
+
+	std::unique_lock<std::mutex> lock(shard.mutex);
+	while (true)
+	{
+		// Looked up again after each wait, since the entry might have been pruned.
+		Entry &entry = shard.entries[key];
+		ImagesPtr images = entry.images.lock();
+		if (images.get() != nullptr)
+		{
+			return images;
+		}
+
+		if (!entry.decoding)
+		{
+			break;
+		}
+
+		if (entry.decodingThread == thisThread)
+		{
+			// This thread is decoding the file further up its stack, and got here from a
+			// job it ran while waiting on that decode's jobs. Waiting would never end, so
+			// it decodes a copy of its own.
+			lock.unlock();
+			return this->decodeImages(filename, paletteName);
+		}
+
+		// Run other jobs in the meantime, like with any job being waited on.
+		if (entry.decodedJob.get() != nullptr)
+		{
+			const JobSystem::JobHandle decodedJob = entry.decodedJob;
+			lock.unlock();
+			this->jobSystem->wait(decodedJob);
+			lock.lock();
+		}
+		else
+		{
+			shard.decoded.wait(lock);
+		}
+	}
+
+	// Decode without the lock so other files in the shard can be looked up meanwhile.
+	Entry &entry = shard.entries[key];
+	entry.decoding = true;
+	entry.decodingThread = thisThread;
+	if (this->jobSystem != nullptr)
+	{
+		entry.decodedJob = this->jobSystem->addSignal(JobSystem::Priority::Normal);
+	}
+
+	lock.unlock();
+
+	// If the decode throws, the entry is still finished so threads waiting on it can try
+	// again instead of waiting forever.
+	struct DecodeGuard
+	{
+		ImageCache &imageCache;
+		Shard &shard;
+		const Key &key;
+		bool finished;
+
+		~DecodeGuard()
+		{
+			if (!this->finished)
+			{
+				this->imageCache.finishDecode(this->shard, this->key, nullptr);
+			}
+		}
+	};
+
+	DecodeGuard guard { *this, shard, key, false };
+	ImagesPtr decodedImages = this->decodeImages(filename, paletteName);
+	this->finishDecode(shard, key, decodedImages);
+	guard.finished = true;
+
+	return decodedImages;
+}
+
+ImageCache::ImagesPtr ImageCache::findImages(const std::string &filename,
+	const std::string &paletteName)
+{
+	const Key key(filename, paletteName);
+	Shard &shard = this->shards[Key::Hash()(key) % ImageCache::SHARD_COUNT];
+
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	const auto entryIter = shard.entries.find(key);
+	return (entryIter != shard.entries.end()) ? entryIter->second.images.lock() : nullptr;
+}
+
+void ImageCache::init(JobSystem &jobSystem)
+{
+	this->jobSystem = &jobSystem;
+}
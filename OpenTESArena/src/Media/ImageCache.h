@@ -0,0 +1,142 @@
+#ifndef IMAGE_CACHE_H
+#define IMAGE_CACHE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "IndexedImage.h"
+#include "Palette.h"
+#include "../Assets/AssetName.h"
+#include "../Utilities/JobSystem.h"
+
+// Palettes and images decoded into palette indices, shared by every thread that loads
+// them. Unlike the texture manager, any thread can ask for an image file here, so panels
+// and level loaders can decode what they need from worker threads. Surfaces and textures
+// are still made by the texture manager on the main thread.
+
+// Files are looked up under one of several locks chosen by their name, so threads asking
+// for different files rarely wait on each other. A file being decoded by one thread is
+// waited on by others asking for it, so it's never decoded twice at once, and they run
+// queued jobs while they wait. Decoded images are only kept for as long as something holds
+// them (usually the texture manager's caches), and are decoded again if asked for after
+// that.
+
+class ImageCache
+{
+public:
+	// An image file and the palette it's decoded with, for keying caches without joining
+	// their names into a new string.
+	struct Key
+	{
+		AssetName filename, paletteName;
+
+		struct Hash
+		{
+			size_t operator()(const Key &key) const;
+		};
+
+		Key(const std::string &filename, const std::string &paletteName);
+		Key();
+
+		bool operator==(const Key &other) const;
+	};
+
+	// The images of a file. Single images (i.e., .IMG) have one.
+	typedef std::shared_ptr<const std::vector<IndexedImage>> ImagesPtr;
+private:
+	// A file's images if something still holds them, or whether a thread is decoding it.
+	// Entries whose images are gone are pruned from their shard after each decode.
+	struct Entry
+	{
+		std::weak_ptr<const std::vector<IndexedImage>> images;
+		std::thread::id decodingThread;
+		JobSystem::JobHandle decodedJob; // Signaled when the decode is done, if any.
+		bool decoding;
+
+		Entry();
+	};
+
+	struct Shard
+	{
+		std::unordered_map<Key, Entry, Key::Hash> entries;
+		std::mutex mutex;
+		std::condition_variable decoded; // For waiting on decodes without a job system.
+	};
+
+	// Number of locks the entries are split between.
+	static const int SHARD_COUNT;
+
+	std::unique_ptr<Shard[]> shards;
+
+	// Palettes are shared with the indexed images that use them.
+	std::unordered_map<AssetName, std::shared_ptr<const Palette>, AssetName::Hash> palettes;
+	std::mutex palettesMutex;
+
+	// Palette indices of decoded images by their hash, so identical images (i.e., the same
+	// file under another palette) share one copy for as long as any of them is loaded.
+	std::unordered_map<uint64_t, std::weak_ptr<const std::vector<uint8_t>>> sharedIndices;
+	std::mutex sharedIndicesMutex;
+
+	JobSystem *jobSystem;
+
+	// Decodes an image file into palette indices. An image using its built-in palette
+	// is given that palette (which is stored under its filename).
+	static IndexedImage decodeImage(const std::string &filename,
+		const std::shared_ptr<const Palette> &palette);
+
+	// Decodes each image in an image set (i.e., .SET, .CFA, .FLC) into palette indices.
+	// Formats whose frames are compressed on their own are decoded a frame per job if a
+	// job system is given.
+	static std::vector<IndexedImage> decodeImageSet(const std::string &filename,
+		const std::shared_ptr<const Palette> &palette, JobSystem *jobSystem);
+
+	// Loads a palette file (i.e., .COL, or the palette of an .IMG).
+	static std::shared_ptr<const Palette> loadPalette(const std::string &paletteName);
+
+	// Makes a newly decoded image share the palette indices of an identical image if one is
+	// loaded, otherwise makes its indices available to later images.
+	void shareIndices(IndexedImage &image);
+
+	// Decodes the images of a file with a palette, without looking in the cache.
+	ImagesPtr decodeImages(const std::string &filename, const std::string &paletteName);
+
+	// Ends a decode started by getImages(), storing its images (null if it failed) and
+	// letting go any threads waiting on it. Entries whose images are gone are pruned.
+	void finishDecode(Shard &shard, const Key &key, const ImagesPtr &images);
+public:
+	ImageCache();
+	ImageCache(const ImageCache&) = delete;
+
+	ImageCache &operator=(const ImageCache&) = delete;
+
+	// Returns whether the file is a single image (i.e., .IMG) instead of an image set.
+	static bool isSingleImage(const std::string &filename);
+
+	// Gets a palette by its filename, loading it the first time. Safe to call from any
+	// thread.
+	std::shared_ptr<const Palette> getPalette(const std::string &paletteName);
+
+	// Gets the palette an image is decoded with, which is the image's own if the palette
+	// name is the built-in one. Safe to call from any thread.
+	std::shared_ptr<const Palette> getImagePalette(const std::string &filename,
+		const std::string &paletteName);
+
+	// Gets the images of a file decoded with a palette, decoding them if nothing holds
+	// them, or waiting on the thread decoding them. Safe to call from any thread, including
+	// from a job run by the thread decoding the same file.
+	ImagesPtr getImages(const std::string &filename, const std::string &paletteName);
+
+	// Gets the images of a file if something holds them, without decoding or waiting.
+	// Returns null otherwise. Safe to call from any thread.
+	ImagesPtr findImages(const std::string &filename, const std::string &paletteName);
+
+	void init(JobSystem &jobSystem);
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "IndexedImage.h"
+#include "PaletteTable.h"
+#include "../Utilities/Bytes.h"
+#include "../Utilities/Debug.h"
+
+IndexedImage::IndexedImage(int width, int height, const uint8_t *indices,
+	const std::shared_ptr<const Palette> &palette)
+	: palette(palette)
+{
+	DebugAssert(palette.get() != nullptr, "Indexed image palette cannot be null.");
+
+	const size_t byteCount = width * height;
+	this->indices = std::make_shared<const std::vector<uint8_t>>(
+		indices, indices + byteCount);
+	this->hash = Bytes::hash(indices, byteCount);
+	this->width = width;
+	this->height = height;
+}
+
+int IndexedImage::getWidth() const
+{
+	return this->width;
+}
+
+int IndexedImage::getHeight() const
+{
+	return this->height;
+}
+
+size_t IndexedImage::getByteCount() const
+{
+	return this->indices->size();
+}
+
+const uint8_t *IndexedImage::getIndices() const
+{
+	return this->indices->data();
+}
+
+const Palette &IndexedImage::getPalette() const
+{
+	return *this->palette;
+}
+
+uint64_t IndexedImage::getHash() const
+{
+	return this->hash;
+}
+
+const std::shared_ptr<const std::vector<uint8_t>> &IndexedImage::getSharedIndices() const
+{
+	return this->indices;
+}
+
+bool IndexedImage::shareIndices(const std::shared_ptr<const std::vector<uint8_t>> &indices)
+{
+	DebugAssert(indices.get() != nullptr, "Shared indices cannot be null.");
+
+	if (indices == this->indices)
+	{
+		return true;
+	}
+	else if (*indices != *this->indices)
+	{
+		return false;
+	}
+
+	this->indices = indices;
+	return true;
+}
+
+void IndexedImage::writePixels(uint32_t *dst, int pitch) const
+{
+	const PaletteTable paletteTable(*this->palette);
+	paletteTable.expand(this->indices->data(), this->width, this->height, dst, pitch);
+}
@@ -0,0 +1,59 @@
+#ifndef INDEXED_IMAGE_H
+#define INDEXED_IMAGE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Palette.h"
+
+// An image stored as 8-bit palette indices, with a reference to the palette they index
+// into. Images decoded with the same palette share it. They are a quarter of the size
+// of their 32-bit pixels, which are only made when they're written into a surface or
+// texture.
+
+// Images with the same indices (i.e., one sprite decoded under several palettes) can share
+// one copy of them. The hash of the indices is taken when decoding so finding a match is
+// cheap.
+
+class IndexedImage
+{
+private:
+	std::shared_ptr<const std::vector<uint8_t>> indices;
+	std::shared_ptr<const Palette> palette;
+	uint64_t hash; // Hash of the palette indices.
+	int width, height;
+public:
+	IndexedImage(int width, int height, const uint8_t *indices,
+		const std::shared_ptr<const Palette> &palette);
+
+	// Gets the width of the image in pixels.
+	int getWidth() const;
+
+	// Gets the height of the image in pixels.
+	int getHeight() const;
+
+	// Gets the bytes of palette indices held by the image.
+	size_t getByteCount() const;
+
+	// Gets a pointer to the palette indices of the image.
+	const uint8_t *getIndices() const;
+
+	// Gets the palette the indices refer to.
+	const Palette &getPalette() const;
+
+	// Gets the hash of the palette indices.
+	uint64_t getHash() const;
+
+	// Gets the palette indices of the image, which other images may also be using.
+	const std::shared_ptr<const std::vector<uint8_t>> &getSharedIndices() const;
+
+	// Makes the image use the given palette indices instead of its own if they're equal,
+	// freeing its copy when nothing else uses it. Returns whether they were equal.
+	bool shareIndices(const std::shared_ptr<const std::vector<uint8_t>> &indices);
+
+	// Writes the image as 32-bit pixels. The pitch is in pixels.
+	void writePixels(uint32_t *dst, int pitch) const;
+};
+
+#endif
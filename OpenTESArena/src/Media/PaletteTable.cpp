@@ -0,0 +1,92 @@
+#include "SDL.h"
+
+#include "PaletteTable.h"
+
+// AVX2 is compiled per-function so the rest of the program doesn't require it.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#if defined(__GNUC__) || defined(__clang__)
+#define PALETTE_TABLE_AVX2
+#define PALETTE_TABLE_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define PALETTE_TABLE_AVX2
+#define PALETTE_TABLE_AVX2_TARGET
+#include <immintrin.h>
+#endif
+#endif
+
+namespace
+{
+	void expandScalar(const uint32_t *colors, const uint8_t *src, int count, uint32_t *dst)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			dst[i] = colors[src[i]];
+		}
+	}
+
+#ifdef PALETTE_TABLE_AVX2
+	PALETTE_TABLE_AVX2_TARGET void expandAVX2(const uint32_t *colors, const uint8_t *src,
+		int count, uint32_t *dst)
+	{
+		const int *table = reinterpret_cast<const int*>(colors);
+
+		int i = 0;
+		for (; i <= (count - 8); i += 8)
+		{
+			const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+			const __m256i indices = _mm256_cvtepu8_epi32(bytes);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+				_mm256_i32gather_epi32(table, indices, 4));
+		}
+
+		// Leftover pixels at the end of the run.
+		expandScalar(colors, src + i, count - i, dst + i);
+	}
+
+	const bool UseAVX2 = SDL_HasAVX2() == SDL_TRUE;
+#endif
+}
+
+PaletteTable::PaletteTable(const Palette &palette)
+{
+	const auto &paletteColors = palette.get();
+	for (size_t i = 0; i < this->colors.size(); i++)
+	{
+		this->colors[i] = paletteColors[i].toARGB();
+	}
+}
+
+uint32_t PaletteTable::get(uint8_t index) const
+{
+	return this->colors[index];
+}
+
+void PaletteTable::expand(const uint8_t *src, int count, uint32_t *dst) const
+{
+#ifdef PALETTE_TABLE_AVX2
+	if (UseAVX2)
+	{
+		expandAVX2(this->colors.data(), src, count, dst);
+		return;
+	}
+#endif
+
+	expandScalar(this->colors.data(), src, count, dst);
+}
+
+void PaletteTable::expand(const uint8_t *src, int width, int height, uint32_t *dst,
+	int dstPitch) const
+{
+	// Packed rows can be done as one run.
+	if (dstPitch == width)
+	{
+		this->expand(src, width * height, dst);
+		return;
+	}
+
+	for (int y = 0; y < height; y++)
+	{
+		this->expand(src + (y * width), width, dst + (y * dstPitch));
+	}
+}
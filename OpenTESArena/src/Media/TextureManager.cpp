@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 
 #include "SDL.h"
@@ -5,157 +6,364 @@
 #include "PaletteFile.h"
 #include "PaletteName.h"
 #include "TextureManager.h"
-#include "../Assets/CFAFile.h"
-#include "../Assets/CIFFile.h"
-#include "../Assets/COLFile.h"
-#include "../Assets/Compression.h"
-#include "../Assets/DFAFile.h"
-#include "../Assets/FLCFile.h"
 #include "../Assets/IMGFile.h"
-#include "../Assets/RCIFile.h"
-#include "../Assets/SETFile.h"
 #include "../Math/Vector2.h"
 #include "../Rendering/Renderer.h"
 #include "../Rendering/Surface.h"
 #include "../Utilities/Debug.h"
-#include "../Utilities/String.h"
+#include "../Utilities/MemoryTracker.h"
+#include "../Utilities/Profiler.h"
 
 #include "components/vfs/manager.hpp"
 
+TextureManager::ImageEntry::ImageEntry(const std::string &filename,
+	const std::string &paletteName)
+	: filename(filename), paletteName(paletteName)
+{
+	this->surface = nullptr;
+	this->surfaceBytes = 0;
+	this->textureBytes = 0;
+	this->lastUsedFrame = 0;
+	this->pinned = false;
+}
+
+TextureManager::ImageSet::ImageSet()
+{
+	this->imageBytes = 0;
+	this->surfaceBytes = 0;
+	this->textureBytes = 0;
+	this->lastUsedFrame = 0;
+}
+
+TextureManager::MemoryStats::MemoryStats()
+{
+	this->surfaceBytes = 0;
+	this->textureBytes = 0;
+	this->imageSetBytes = 0;
+	this->surfaceSetBytes = 0;
+	this->textureSetBytes = 0;
+	this->atlasBytes = 0;
+}
+
+size_t TextureManager::MemoryStats::getTotalBytes() const
+{
+	return this->surfaceBytes + this->textureBytes + this->imageSetBytes +
+		this->surfaceSetBytes + this->textureSetBytes + this->atlasBytes;
+}
+
+TextureManager::AtlasPage::AtlasPage(Texture &&texture)
+	: texture(std::move(texture))
+{
+	this->shelfX = 0;
+	this->shelfY = 0;
+	this->shelfHeight = 0;
+}
+
+const int TextureManager::ATLAS_PAGE_SIZE = 512;
+const int TextureManager::MAX_ATLAS_IMAGE_SIZE = 128;
+
+TextureManager::TextureManager()
+{
+	this->memoryBudget = 0;
+	this->frame = 0;
+	this->indexedImages = false;
+	this->jobSystem = nullptr;
+}
+
 TextureManager::~TextureManager()
 {
+	// Prefetches still going use the image cache, and their reads signal the job system
+	// when they're done, so they're canceled and finished first.
+	for (auto &image : this->images)
+	{
+		if (image.pending.get() != nullptr)
+		{
+			image.pending->read->cancel();
+			this->jobSystem->wait(image.pending->job);
+		}
+	}
+
+	for (auto &pair : this->pendingSurfaceSets)
+	{
+		pair.second.read->cancel();
+		this->jobSystem->wait(pair.second.job);
+	}
+
 	// Release the SDL_Surfaces.
-	for (auto &pair : this->surfaces)
+	for (auto &image : this->images)
 	{
-		SDL_FreeSurface(pair.second);
+		if (image.surface != nullptr)
+		{
+			SDL_FreeSurface(image.surface);
+		}
 	}
 
-	for (auto &pair : this->surfaceSets)
+	for (auto &pair : this->imageSets)
 	{
-		for (auto *surface : pair.second)
+		for (auto *surface : pair.second.surfaces)
 		{
 			SDL_FreeSurface(surface);
 		}
 	}
+
+	MemoryTracker::set(MemoryTag::TextureCaches, 0);
 }
 
-void TextureManager::loadCOLPalette(const std::string &colName)
+size_t TextureManager::getSurfaceBytes(const SDL_Surface *surface)
 {
-	Palette dstPalette;
-	COLFile::toPalette(colName, dstPalette);
-	this->palettes.emplace(std::make_pair(colName, dstPalette));
+	return static_cast<size_t>(surface->pitch) * static_cast<size_t>(surface->h);
 }
 
-void TextureManager::loadIMGPalette(const std::string &imgName)
+size_t TextureManager::getTextureBytes(const Texture &texture)
 {
-	Palette dstPalette;
-	IMGFile::extractPalette(imgName, dstPalette);
-	this->palettes.emplace(std::make_pair(imgName, dstPalette));
+	// Textures are always made with the default 32-bit pixel format.
+	return static_cast<size_t>(texture.getWidth()) *
+		static_cast<size_t>(texture.getHeight()) * sizeof(uint32_t);
 }
 
-void TextureManager::loadPalette(const std::string &paletteName)
+SDL_Surface *TextureManager::makeSurface(const IndexedImage &image)
 {
-	// Don't load the same palette more than once.
-	assert(this->palettes.find(paletteName) == this->palettes.end());
+	SDL_Surface *surface = Surface::createSurfaceWithFormat(image.getWidth(),
+		image.getHeight(), Renderer::DEFAULT_BPP, Renderer::DEFAULT_PIXELFORMAT);
+	image.writePixels(static_cast<uint32_t*>(surface->pixels),
+		surface->pitch / static_cast<int>(sizeof(uint32_t)));
+	return surface;
+}
 
-	// Get file extension of the palette name.
-	const std::string extension = String::getExtension(paletteName);
-	const bool isCOL = extension == ".COL";
-	const bool isIMG = extension == ".IMG";
-	const bool isMNU = extension == ".MNU";
+SDL_Texture *TextureManager::makeTexture(int width, int height, const uint32_t *pixels,
+	Renderer &renderer)
+{
+	SDL_Texture *texture = renderer.createTexture(Renderer::DEFAULT_PIXELFORMAT,
+		SDL_TEXTUREACCESS_STATIC, width, height);
+	SDL_UpdateTexture(texture, nullptr, pixels, width * sizeof(*pixels));
+
+	// Set alpha transparency on.
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+	return texture;
+}
+
+SDL_Texture *TextureManager::makeTexture(const IndexedImage &image, Renderer &renderer)
+{
+	std::vector<uint32_t> pixels(image.getWidth() * image.getHeight());
+	image.writePixels(pixels.data(), image.getWidth());
+	return TextureManager::makeTexture(image.getWidth(), image.getHeight(), pixels.data(),
+		renderer);
+}
+
+SDL_Surface *TextureManager::loadSurface(const std::string &filename,
+	const std::string &paletteName)
+{
+	ProfileScope("TextureManager::loadSurface");
 
-	if (isCOL)
+	// A worker thread might have decoded the image already.
+	const ImageCache::ImagesPtr decodedImages =
+		this->imageCache.findImages(filename, paletteName);
+	if (decodedImages.get() != nullptr)
 	{
-		this->loadCOLPalette(paletteName);
+		return TextureManager::makeSurface(decodedImages->front());
 	}
-	else if (isIMG || isMNU)
+
+	const std::shared_ptr<const Palette> palette =
+		this->imageCache.getImagePalette(filename, paletteName);
+
+	// IMGs are written straight into the surface's pixels. COLs are only 256 pixels, so
+	// they can go through an indexed image.
+	const AssetName::Extension extension = AssetName(filename).getExtension();
+	const bool isIMG = extension == AssetName::Extension::IMG;
+	const bool isMNU = extension == AssetName::Extension::MNU;
+
+	if (isIMG || isMNU)
 	{
-		this->loadIMGPalette(paletteName);
+		const IMGFile img(filename);
+		SDL_Surface *surface = Surface::createSurfaceWithFormat(img.getWidth(),
+			img.getHeight(), Renderer::DEFAULT_BPP, Renderer::DEFAULT_PIXELFORMAT);
+		img.writePixels(*palette, static_cast<uint32_t*>(surface->pixels),
+			surface->pitch / static_cast<int>(sizeof(uint32_t)));
+		return surface;
+	}
+
+	return TextureManager::makeSurface(
+		this->imageCache.getImages(filename, paletteName)->front());
+}
+
+SDL_Texture *TextureManager::loadTexture(const std::string &filename,
+	const std::string &paletteName, Renderer &renderer)
+{
+	ProfileScope("TextureManager::loadTexture");
+
+	const std::shared_ptr<const Palette> palette =
+		this->imageCache.getImagePalette(filename, paletteName);
+
+	// Check what kind of file extension the filename has.
+	const AssetName::Extension extension = AssetName(filename).getExtension();
+	const bool isIMG = extension == AssetName::Extension::IMG;
+	const bool isMNU = extension == AssetName::Extension::MNU;
+
+	SDL_Texture *texture = nullptr;
+
+	if (isIMG || isMNU)
+	{
+		// Static textures are updated from a buffer, so the IMG is written into one that's
+		// only as big as the texture.
+		const IMGFile img(filename);
+		std::vector<uint32_t> pixels(img.getWidth() * img.getHeight());
+		img.writePixels(*palette, pixels.data(), img.getWidth());
+		texture = TextureManager::makeTexture(img.getWidth(), img.getHeight(),
+			pixels.data(), renderer);
 	}
 	else
 	{
-		DebugCrash("Unrecognized palette \"" + paletteName + "\".");
+		DebugCrash("Unrecognized texture format \"" + filename + "\".");
 	}
 
-	// Make sure everything above works as intended.
-	assert(this->palettes.find(paletteName) != this->palettes.end());
+	return texture;
 }
 
-SDL_Surface *TextureManager::getSurface(const std::string &filename,
-	const std::string &paletteName)
+void TextureManager::finishPrefetch(int imageHandle)
 {
-	// Use this name when interfacing with the surfaces map.
-	const std::string fullName = filename + paletteName;
+	ImageEntry &image = this->images[imageHandle];
+	if (image.pending.get() == nullptr)
+	{
+		return;
+	}
+
+	// Something needs the image now, so its read goes ahead of other prefetches.
+	VFS::Manager::get().raisePriority(image.pending->read, VFS::ReadPriority::Visible);
+	this->jobSystem->wait(image.pending->job);
 
-	// See if the image file has already been loaded with the palette.
-	auto surfaceIter = this->surfaces.find(fullName);
-	if (surfaceIter != this->surfaces.end())
+	if ((image.surface == nullptr) && (image.indexedImage.get() == nullptr))
 	{
-		// The requested surface exists.
-		return surfaceIter->second;
+		const IndexedImage &decodedImage = (*image.pending->images)->front();
+		if (this->indexedImages)
+		{
+			image.surfaceBytes = decodedImage.getByteCount();
+			image.indexedImage = std::make_unique<IndexedImage>(decodedImage);
+		}
+		else
+		{
+			image.surface = TextureManager::makeSurface(decodedImage);
+			image.surfaceBytes = TextureManager::getSurfaceBytes(image.surface);
+		}
+
+		this->memoryStats.surfaceBytes += image.surfaceBytes;
 	}
 
-	// Attempt to use the image's built-in palette if requested.
-	const bool useBuiltInPalette = Palette::isBuiltIn(paletteName);
+	image.pending = nullptr;
+}
+
+const IndexedImage &TextureManager::getIndexedImage(int imageHandle)
+{
+	ImageEntry &image = this->images[imageHandle];
+	assert(image.surface == nullptr);
 
-	// See if the palette hasn't already been loaded.
-	const bool paletteIsLoaded = this->palettes.find(paletteName) != this->palettes.end();
-	const bool imagePaletteIsLoaded = this->palettes.find(filename) != this->palettes.end();
-	if ((!useBuiltInPalette && !paletteIsLoaded) ||
-		(useBuiltInPalette && !imagePaletteIsLoaded))
+	this->finishPrefetch(imageHandle);
+
+	if (image.indexedImage.get() == nullptr)
 	{
-		// Use the filename (i.e., TAMRIEL.IMG) if using the built-in palette.
-		// Otherwise, use the given palette name (i.e., PAL.COL).
-		this->loadPalette(useBuiltInPalette ? filename : paletteName);
+		image.indexedImage = std::make_unique<IndexedImage>(
+			this->imageCache.getImages(image.filename, image.paletteName)->front());
+		image.surfaceBytes = image.indexedImage->getByteCount();
+		this->memoryStats.surfaceBytes += image.surfaceBytes;
 	}
 
-	// The image hasn't been loaded with the palette yet, so make a new entry.
-	// Check what kind of file extension the filename has.
-	const std::string extension = String::getExtension(filename);
-	const bool isCOL = extension == ".COL";
-	const bool isIMG = extension == ".IMG";
-	const bool isMNU = extension == ".MNU";
+	this->touch(imageHandle);
+	return *image.indexedImage;
+}
+
+void TextureManager::finishPrefetchSet(const ImageKey &key)
+{
+	auto pendingIter = this->pendingSurfaceSets.find(key);
+	if (pendingIter == this->pendingSurfaceSets.end())
+	{
+		return;
+	}
 
-	SDL_Surface *surface = nullptr;
+	const PendingDecode &pending = pendingIter->second;
+	VFS::Manager::get().raisePriority(pending.read, VFS::ReadPriority::Visible);
+	this->jobSystem->wait(pending.job);
 
-	if (isCOL)
+	ImageSet &imageSet = this->imageSets[key];
+	if (imageSet.images.get() == nullptr)
 	{
-		// A palette was requested as the primary image. Convert it to a surface.
-		Palette colPalette;
-		COLFile::toPalette(filename, colPalette);
+		imageSet.images = *pending.images;
+		imageSet.lastUsedFrame = this->frame;
 
-		assert(colPalette.get().size() == 256);
-		surface = Surface::createSurfaceWithFormat(16, 16, Renderer::DEFAULT_BPP, 
-			Renderer::DEFAULT_PIXELFORMAT);
-		
-		uint32_t *pixels = static_cast<uint32_t*>(surface->pixels);
-		for (size_t i = 0; i < colPalette.get().size(); i++)
+		for (const IndexedImage &image : *imageSet.images)
 		{
-			pixels[i] = colPalette.get()[i].toARGB();
+			imageSet.imageBytes += image.getByteCount();
 		}
+
+		this->memoryStats.imageSetBytes += imageSet.imageBytes;
 	}
-	else if (isIMG || isMNU)
-	{
-		// Decide if the IMG will use its own palette or not.
-		const Palette *palette = useBuiltInPalette ? nullptr : 
-			&this->palettes.at(paletteName);
 
-		// Load the IMG file.
-		IMGFile img(filename, palette);
-		
-		// Create a surface from the IMG.
-		surface = Surface::createSurfaceWithFormat(img.getWidth(), img.getHeight(),
-			Renderer::DEFAULT_BPP, Renderer::DEFAULT_PIXELFORMAT);
-		SDL_memcpy(surface->pixels, img.getPixels(), surface->pitch * surface->h);
+	this->pendingSurfaceSets.erase(pendingIter);
+}
+
+int TextureManager::getImageHandle(const std::string &filename,
+	const std::string &paletteName)
+{
+	const ImageKey key(filename, paletteName);
+
+	auto handleIter = this->imageHandles.find(key);
+	if (handleIter != this->imageHandles.end())
+	{
+		return handleIter->second;
 	}
-	else
+
+	// The image hasn't been requested with the palette yet, so make a new entry. It's
+	// loaded when its surface or texture is first requested.
+	const int imageHandle = static_cast<int>(this->images.size());
+	this->images.push_back(ImageEntry(filename, paletteName));
+	this->images.back().lastUsedFrame = this->frame;
+	this->touchedImages.push_back(false);
+	this->imageHandles.emplace(std::make_pair(key, imageHandle));
+	return imageHandle;
+}
+
+int TextureManager::getImageHandle(const std::string &filename)
+{
+	return this->getImageHandle(filename, this->activePalette);
+}
+
+SDL_Surface *TextureManager::getSurface(int imageHandle)
+{
+	assert(imageHandle >= 0);
+	assert(imageHandle < static_cast<int>(this->images.size()));
+
+	ImageEntry &image = this->images[imageHandle];
+	if (image.surface == nullptr)
 	{
-		DebugCrash("Unrecognized surface format \"" + filename + "\".");
+		if (image.pending.get() != nullptr)
+		{
+			this->finishPrefetch(imageHandle);
+		}
+
+		if (image.indexedImage.get() != nullptr)
+		{
+			// The caller wants 32-bit pixels, so the indices aren't needed anymore.
+			this->memoryStats.surfaceBytes -= image.surfaceBytes;
+			image.surface = TextureManager::makeSurface(*image.indexedImage);
+			image.surfaceBytes = TextureManager::getSurfaceBytes(image.surface);
+			this->memoryStats.surfaceBytes += image.surfaceBytes;
+			image.indexedImage = nullptr;
+		}
+		else if (image.surface == nullptr)
+		{
+			image.surface = this->loadSurface(image.filename, image.paletteName);
+			image.surfaceBytes = TextureManager::getSurfaceBytes(image.surface);
+			this->memoryStats.surfaceBytes += image.surfaceBytes;
+		}
 	}
 
-	// Add the new surface and return it.
-	auto iter = this->surfaces.emplace(std::make_pair(fullName, surface)).first;
-	return iter->second;
+	this->touch(imageHandle);
+	return image.surface;
+}
+
+SDL_Surface *TextureManager::getSurface(const std::string &filename,
+	const std::string &paletteName)
+{
+	return this->getSurface(this->getImageHandle(filename, paletteName));
 }
 
 SDL_Surface *TextureManager::getSurface(const std::string &filename)
@@ -163,437 +371,648 @@ SDL_Surface *TextureManager::getSurface(const std::string &filename)
 	return this->getSurface(filename, this->activePalette);
 }
 
-const Texture &TextureManager::getTexture(const std::string &filename,
-	const std::string &paletteName, Renderer &renderer)
+const Texture &TextureManager::getTexture(int imageHandle, Renderer &renderer)
 {
-	// Use this name when interfacing with the textures map.
-	const std::string fullName = filename + paletteName;
+	assert(imageHandle >= 0);
+	assert(imageHandle < static_cast<int>(this->images.size()));
 
-	// See if the image file has already been loaded with the palette.
-	auto textureIter = this->textures.find(fullName);
-	if (textureIter != this->textures.end())
+	ImageEntry &image = this->images[imageHandle];
+	if (image.texture.get() == nullptr)
 	{
-		// The requested texture exists.
-		return textureIter->second;
+		this->finishPrefetch(imageHandle);
+
+		if (image.surface != nullptr)
+		{
+			// The pixels are already decoded, so copy them instead of reading the file.
+			SDL_Texture *texture = renderer.createTexture(Renderer::DEFAULT_PIXELFORMAT,
+				SDL_TEXTUREACCESS_STATIC, image.surface->w, image.surface->h);
+			SDL_UpdateTexture(texture, nullptr, image.surface->pixels, image.surface->pitch);
+			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+			image.texture = std::make_unique<Texture>(texture);
+		}
+		else if (image.indexedImage.get() != nullptr)
+		{
+			// Converted to 32-bit only for the upload.
+			image.texture = std::make_unique<Texture>(
+				TextureManager::makeTexture(*image.indexedImage, renderer));
+		}
+		else
+		{
+			image.texture = std::make_unique<Texture>(
+				this->loadTexture(image.filename, image.paletteName, renderer));
+		}
+
+		image.textureBytes = TextureManager::getTextureBytes(*image.texture);
+		this->memoryStats.textureBytes += image.textureBytes;
 	}
-	// Attempt to use the image's built-in palette if requested.
-	const bool useBuiltInPalette = Palette::isBuiltIn(paletteName);
 
-	// See if the palette hasn't already been loaded.
-	const bool paletteIsLoaded = this->palettes.find(paletteName) != this->palettes.end();
-	const bool imagePaletteIsLoaded = this->palettes.find(filename) != this->palettes.end();
-	if ((!useBuiltInPalette && !paletteIsLoaded) || 
-		(useBuiltInPalette && !imagePaletteIsLoaded))
+	this->touch(imageHandle);
+	return *image.texture;
+}
+
+const Texture &TextureManager::getTexture(const std::string &filename,
+	const std::string &paletteName, Renderer &renderer)
+{
+	return this->getTexture(this->getImageHandle(filename, paletteName), renderer);
+}
+
+const Texture &TextureManager::getTexture(const std::string &filename, Renderer &renderer)
+{
+	return this->getTexture(filename, this->activePalette, renderer);
+}
+
+TextureManager::ImageSet &TextureManager::loadImageSet(const std::string &filename,
+	const std::string &paletteName)
+{
+	const ImageKey key(filename, paletteName);
+
+	// Finish the set first if it was prefetched.
+	this->finishPrefetchSet(key);
+
+	ImageSet &imageSet = this->imageSets[key];
+	imageSet.lastUsedFrame = this->frame;
+
+	if (imageSet.images.get() == nullptr)
 	{
-		// Use the filename (i.e., TAMRIEL.IMG) if using the built-in palette.
-		// Otherwise, use the given palette name (i.e., PAL.COL).
-		this->loadPalette(useBuiltInPalette ? filename : paletteName);
+		// Another thread might be decoding the set, in which case this waits on it.
+		imageSet.images = this->imageCache.getImages(filename, paletteName);
+
+		for (const IndexedImage &image : *imageSet.images)
+		{
+			imageSet.imageBytes += image.getByteCount();
+		}
+
+		this->memoryStats.imageSetBytes += imageSet.imageBytes;
 	}
 
-	// The image hasn't been loaded with the palette yet, so make a new entry.
-	// Check what kind of file extension the filename has.
-	const std::string extension = String::getExtension(filename);
-	const bool isIMG = extension == ".IMG";
-	const bool isMNU = extension == ".MNU";
+	return imageSet;
+}
 
-	SDL_Texture *texture = nullptr;
+const std::vector<SDL_Surface*> &TextureManager::getSurfaces(
+	const std::string &filename, const std::string &paletteName)
+{
+	ProfileScope("TextureManager::getSurfaces");
 
-	if (isIMG || isMNU)
+	ImageSet &imageSet = this->loadImageSet(filename, paletteName);
+	if (imageSet.surfaces.size() == 0)
 	{
-		// Decide if the IMG will use its own palette or not.
-		const Palette *palette = useBuiltInPalette ? nullptr : 
-			&this->palettes.at(paletteName);
+		for (const IndexedImage &image : *imageSet.images)
+		{
+			SDL_Surface *surface = TextureManager::makeSurface(image);
+			imageSet.surfaceBytes += TextureManager::getSurfaceBytes(surface);
+			imageSet.surfaces.push_back(surface);
+		}
 
-		// Load the IMG file.
-		IMGFile img(filename, palette);
+		this->memoryStats.surfaceSetBytes += imageSet.surfaceBytes;
+	}
 
-		// Create a texture from the IMG.
-		texture = renderer.createTexture(Renderer::DEFAULT_PIXELFORMAT,
-			SDL_TEXTUREACCESS_STATIC, img.getWidth(), img.getHeight());
+	return imageSet.surfaces;
+}
 
-		uint32_t *pixels = img.getPixels();
-		SDL_UpdateTexture(texture, nullptr, pixels, img.getWidth() * sizeof(*pixels));
+const std::vector<SDL_Surface*> &TextureManager::getSurfaces(const std::string &filename)
+{
+	return this->getSurfaces(filename, this->activePalette);
+}
 
-		// Set alpha transparency on.
-		SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+const std::vector<Texture> &TextureManager::getTextures(
+	const std::string &filename, const std::string &paletteName, Renderer &renderer)
+{
+	const ImageKey key(filename, paletteName);
+
+	// See if the file has already been loaded with the palette.
+	auto setIter = this->imageSets.find(key);
+	if ((setIter != this->imageSets.end()) && (setIter->second.textures.size() > 0))
+	{
+		// The requested texture set exists.
+		setIter->second.lastUsedFrame = this->frame;
+		return setIter->second.textures;
 	}
-	else
+
+	// Make the textures straight from the set's indexed images, decoding them first if
+	// needed.
+	ImageSet &imageSet = this->loadImageSet(filename, paletteName);
+	for (const IndexedImage &image : *imageSet.images)
 	{
-		DebugCrash("Unrecognized texture format \"" + filename + "\".");
+		Texture texture(TextureManager::makeTexture(image, renderer));
+		imageSet.textureBytes += TextureManager::getTextureBytes(texture);
+		imageSet.textures.push_back(std::move(texture));
 	}
 
-	// Add the new texture and return it.
-	auto iter = this->textures.emplace(std::make_pair(fullName, Texture(texture))).first;
-	return iter->second;
+	this->memoryStats.textureSetBytes += imageSet.textureBytes;
+
+	return imageSet.textures;
 }
 
-const Texture &TextureManager::getTexture(const std::string &filename, Renderer &renderer)
+const std::vector<Texture> &TextureManager::getTextures(const std::string &filename,
+	Renderer &renderer)
 {
-	return this->getTexture(filename, this->activePalette, renderer);
+	return this->getTextures(filename, this->activePalette, renderer);
 }
 
-const std::vector<SDL_Surface*> &TextureManager::getSurfaces(
-	const std::string &filename, const std::string &paletteName)
+const std::vector<IndexedImage> &TextureManager::getImages(const std::string &filename,
+	const std::string &paletteName)
 {
-	// This method deals with animations and movies, so it will check filenames 
-	// for ".CFA", ".CIF", ".DFA", ".FLC", ".SET", etc..
+	return *this->loadImageSet(filename, paletteName).images;
+}
 
-	// Use this name when interfacing with the surface sets map.
-	const std::string fullName = filename + paletteName;
+TextureManager::AtlasRegion TextureManager::packAtlasRegion(int width, int height,
+	const uint32_t *pixels, int pitch, Renderer &renderer)
+{
+	assert(width <= TextureManager::MAX_ATLAS_IMAGE_SIZE);
+	assert(height <= TextureManager::MAX_ATLAS_IMAGE_SIZE);
 
-	// See if the file has already been loaded with the palette.
-	auto setIter = this->surfaceSets.find(fullName);
-	if (setIter != this->surfaceSets.end())
+	// One pixel of space between images, so filtering never reads a neighbor.
+	const int padding = 1;
+	const int pageSize = TextureManager::ATLAS_PAGE_SIZE;
+
+	// Lambda for fitting the image in a page's current shelf or a new one below it.
+	auto tryFit = [width, height, padding, pageSize](AtlasPage &page)
 	{
-		// The requested texture set exists.
-		return setIter->second;
-	}
+		if ((page.shelfX + width) > pageSize)
+		{
+			page.shelfX = 0;
+			page.shelfY += page.shelfHeight + padding;
+			page.shelfHeight = 0;
+		}
 
-	// Do not use a built-in palette for surface sets.
-	DebugAssert(!Palette::isBuiltIn(paletteName), 
-		"Image sets (i.e., .SET files) do not have built-in palettes.");
+		return (page.shelfY + height) <= pageSize;
+	};
 
-	// See if the palette hasn't already been loaded.
-	if (this->palettes.find(paletteName) == this->palettes.end())
+	if (this->atlasPages.empty() || !tryFit(this->atlasPages.back()))
 	{
-		this->loadPalette(paletteName);
+		Texture texture(renderer.createTexture(Renderer::DEFAULT_PIXELFORMAT,
+			SDL_TEXTUREACCESS_STATIC, pageSize, pageSize));
+
+		// Unused space has to be transparent.
+		const std::vector<uint32_t> clearPixels(pageSize * pageSize, 0);
+		SDL_UpdateTexture(texture.get(), nullptr, clearPixels.data(),
+			pageSize * sizeof(uint32_t));
+		SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+
+		this->memoryStats.atlasBytes += TextureManager::getTextureBytes(texture);
+		this->atlasPages.push_back(AtlasPage(std::move(texture)));
 	}
 
-	// The file hasn't been loaded with the palette yet, so make a new entry.
-	auto iter = this->surfaceSets.emplace(std::make_pair(
-		fullName, std::vector<SDL_Surface*>())).first;
+	AtlasPage &page = this->atlasPages.back();
+	AtlasRegion region;
+	region.texture = page.texture.get();
+	region.x = page.shelfX;
+	region.y = page.shelfY;
+	region.width = width;
+	region.height = height;
 
-	std::vector<SDL_Surface*> &surfaceSet = iter->second;
-	const Palette &palette = this->palettes.at(paletteName);
+	const SDL_Rect rect = { region.x, region.y, width, height };
+	SDL_UpdateTexture(page.texture.get(), &rect, pixels, pitch);
 
-	const std::string extension = String::getExtension(filename);
-	const bool isCFA = extension == ".CFA";
-	const bool isCIF = extension == ".CIF";
-	const bool isCEL = extension == ".CEL";
-	const bool isDFA = extension == ".DFA";
-	const bool isFLC = extension == ".FLC";
-	const bool isRCI = extension == ".RCI";
-	const bool isSET = extension == ".SET";
+	page.shelfX += width + padding;
+	page.shelfHeight = std::max(page.shelfHeight, height);
 
-	if (isCFA)
+	return region;
+}
+
+TextureManager::AtlasRegion TextureManager::getAtlasRegion(int imageHandle,
+	Renderer &renderer)
+{
+	auto iter = this->atlasRegions.find(imageHandle);
+	if (iter != this->atlasRegions.end())
 	{
-		// Load the CFA file.
-		CFAFile cfaFile(filename, palette);
+		return iter->second;
+	}
 
-		// Create an SDL_Surface for each image in the CFA.
-		const int imageCount = cfaFile.getImageCount();
-		for (int i = 0; i < imageCount; i++)
-		{
-			uint32_t *pixels = cfaFile.getPixels(i);
-			SDL_Surface *surface = Surface::createSurfaceWithFormat(
-				cfaFile.getWidth(), cfaFile.getHeight(),
-				Renderer::DEFAULT_BPP, Renderer::DEFAULT_PIXELFORMAT);
-			SDL_memcpy(surface->pixels, pixels, surface->pitch * surface->h);
+	const bool useIndexedImage = this->indexedImages &&
+		(this->images[imageHandle].surface == nullptr);
+	const SDL_Surface *surface = useIndexedImage ? nullptr : this->getSurface(imageHandle);
+	const IndexedImage *indexedImage = useIndexedImage ?
+		&this->getIndexedImage(imageHandle) : nullptr;
+	const int width = useIndexedImage ? indexedImage->getWidth() : surface->w;
+	const int height = useIndexedImage ? indexedImage->getHeight() : surface->h;
 
-			surfaceSet.push_back(surface);
-		}
+	if ((width > TextureManager::MAX_ATLAS_IMAGE_SIZE) ||
+		(height > TextureManager::MAX_ATLAS_IMAGE_SIZE))
+	{
+		// Too large; use the image's own texture.
+		const Texture &texture = this->getTexture(imageHandle, renderer);
+		return AtlasRegion { texture.get(), 0, 0, texture.getWidth(), texture.getHeight() };
 	}
-	else if (isCIF)
+
+	AtlasRegion region;
+	if (useIndexedImage)
 	{
-		// Load the CIF file.
-		CIFFile cifFile(filename, palette);
+		std::vector<uint32_t> pixels(width * height);
+		indexedImage->writePixels(pixels.data(), width);
+		region = this->packAtlasRegion(width, height, pixels.data(),
+			width * sizeof(uint32_t), renderer);
+	}
+	else
+	{
+		region = this->packAtlasRegion(width, height,
+			static_cast<const uint32_t*>(surface->pixels), surface->pitch, renderer);
+	}
 
-		// Create an SDL_Surface for each image in the CIF.
-		const int imageCount = cifFile.getImageCount();
-		for (int i = 0; i < imageCount; i++)
-		{
-			uint32_t *pixels = cifFile.getPixels(i);
-			SDL_Surface *surface = Surface::createSurfaceWithFormat(
-				cifFile.getWidth(i), cifFile.getHeight(i),
-				Renderer::DEFAULT_BPP, Renderer::DEFAULT_PIXELFORMAT);
-			SDL_memcpy(surface->pixels, pixels, surface->pitch * surface->h);
+	this->atlasRegions.insert(std::make_pair(imageHandle, region));
+	return region;
+}
 
-			surfaceSet.push_back(surface);
-		}
-	}
-	else if (isDFA)
+TextureManager::AtlasRegion TextureManager::getAtlasRegion(const std::string &filename,
+	const std::string &paletteName, Renderer &renderer)
+{
+	return this->getAtlasRegion(this->getImageHandle(filename, paletteName), renderer);
+}
+
+TextureManager::AtlasRegion TextureManager::getAtlasRegion(const std::string &filename,
+	Renderer &renderer)
+{
+	return this->getAtlasRegion(filename, this->activePalette, renderer);
+}
+
+TextureManager::AtlasRegion TextureManager::getAtlasRegion(const std::string &filename,
+	const std::string &paletteName, int index, Renderer &renderer)
+{
+	const ImageKey key(filename, paletteName);
+	auto iter = this->atlasSetRegions.find(key);
+	if (iter == this->atlasSetRegions.end())
 	{
-		// Load the DFA file.
-		DFAFile dfaFile(filename, palette);
+		// Pack the whole set at once, since its images are usually drawn together.
+		const ImageSet &imageSet = this->loadImageSet(filename, paletteName);
+		std::vector<AtlasRegion> regions;
 
-		// Create an SDL_Surface for each image in the DFA.
-		const int imageCount = dfaFile.getImageCount();
-		for (int i = 0; i < imageCount; i++)
+		for (const IndexedImage &image : *imageSet.images)
 		{
-			uint32_t *pixels = dfaFile.getPixels(i);
-			SDL_Surface *surface = Surface::createSurfaceWithFormat(
-				dfaFile.getWidth(), dfaFile.getHeight(),
-				Renderer::DEFAULT_BPP, Renderer::DEFAULT_PIXELFORMAT);
-			SDL_memcpy(surface->pixels, pixels, surface->pitch * surface->h);
-
-			surfaceSet.push_back(surface);
+			const int width = image.getWidth();
+			const int height = image.getHeight();
+			if ((width > TextureManager::MAX_ATLAS_IMAGE_SIZE) ||
+				(height > TextureManager::MAX_ATLAS_IMAGE_SIZE))
+			{
+				regions.push_back(AtlasRegion { nullptr, 0, 0, width, height });
+			}
+			else
+			{
+				std::vector<uint32_t> pixels(width * height);
+				image.writePixels(pixels.data(), width);
+				regions.push_back(this->packAtlasRegion(width, height, pixels.data(),
+					width * sizeof(uint32_t), renderer));
+			}
 		}
+
+		iter = this->atlasSetRegions.insert(
+			std::make_pair(key, std::move(regions))).first;
 	}
-	else if (isFLC || isCEL)
+
+	const AtlasRegion &region = iter->second.at(index);
+	if (region.texture == nullptr)
 	{
-		// Load the FLC file. CELs are basically identical to FLCs.
-		FLCFile flcFile(filename);
+		// Too large; use the image's own texture.
+		const Texture &texture = this->getTextures(filename, paletteName, renderer).at(index);
+		return AtlasRegion { texture.get(), 0, 0, texture.getWidth(), texture.getHeight() };
+	}
 
-		// Create an SDL_Surface for each frame in the FLC.
-		const int imageCount = flcFile.getFrameCount();
-		for (int i = 0; i < imageCount; i++)
-		{
-			uint32_t *pixels = flcFile.getPixels(i);
-			SDL_Surface *surface = Surface::createSurfaceWithFormat(
-				flcFile.getWidth(), flcFile.getHeight(),
-				Renderer::DEFAULT_BPP, Renderer::DEFAULT_PIXELFORMAT);
-			SDL_memcpy(surface->pixels, pixels, surface->pitch * surface->h);
+	return region;
+}
 
-			surfaceSet.push_back(surface);
-		}
+void TextureManager::freeImage(int imageHandle)
+{
+	ImageEntry &image = this->images[imageHandle];
+	if (image.surface != nullptr)
+	{
+		SDL_FreeSurface(image.surface);
+		image.surface = nullptr;
 	}
-	else if (isRCI)
+
+	image.indexedImage = nullptr;
+	this->memoryStats.surfaceBytes -= image.surfaceBytes;
+	image.surfaceBytes = 0;
+
+	image.texture = nullptr;
+	this->memoryStats.textureBytes -= image.textureBytes;
+	image.textureBytes = 0;
+}
+
+void TextureManager::freeImageSet(const ImageKey &key)
+{
+	auto setIter = this->imageSets.find(key);
+	if (setIter == this->imageSets.end())
+	{
+		return;
+	}
+
+	ImageSet &imageSet = setIter->second;
+	for (auto *surface : imageSet.surfaces)
+	{
+		SDL_FreeSurface(surface);
+	}
+
+	this->memoryStats.imageSetBytes -= imageSet.imageBytes;
+	this->memoryStats.surfaceSetBytes -= imageSet.surfaceBytes;
+	this->memoryStats.textureSetBytes -= imageSet.textureBytes;
+	this->imageSets.erase(setIter);
+}
+
+void TextureManager::evictUnused()
+{
+	// Entries used this frame aren't candidates, since their callers might still hold
+	// references to them.
+	struct Candidate
 	{
-		// Load the RCI file.
-		RCIFile rciFile(filename, palette);
+		int lastUsedFrame;
+		int imageHandle; // -1 if a set.
+		ImageKey setKey;
+	};
+
+	std::vector<Candidate> candidates;
 
-		// Create an SDL_Surface for each image in the RCI.
-		const int imageCount = rciFile.getCount();
-		for (int i = 0; i < imageCount; i++)
+	for (int i = 0; i < static_cast<int>(this->images.size()); i++)
+	{
+		const ImageEntry &image = this->images[i];
+		const bool isResident = (image.surface != nullptr) ||
+			(image.indexedImage.get() != nullptr) || (image.texture.get() != nullptr);
+		if (isResident && !image.pinned && (image.pending.get() == nullptr) &&
+			!this->touchedImages[i])
 		{
-			uint32_t *pixels = rciFile.getPixels(i);
-			SDL_Surface *surface = Surface::createSurfaceWithFormat(
-				RCIFile::FRAME_WIDTH, RCIFile::FRAME_HEIGHT,
-				Renderer::DEFAULT_BPP, Renderer::DEFAULT_PIXELFORMAT);
-			SDL_memcpy(surface->pixels, pixels, surface->pitch * surface->h);
+			candidates.push_back(Candidate { image.lastUsedFrame, i, ImageKey() });
+		}
+	}
 
-			surfaceSet.push_back(surface);
+	for (const auto &pair : this->imageSets)
+	{
+		if ((pair.second.lastUsedFrame < this->frame) &&
+			(this->pinnedSets.find(pair.first) == this->pinnedSets.end()))
+		{
+			candidates.push_back(Candidate { pair.second.lastUsedFrame, -1, pair.first });
 		}
 	}
-	else if (isSET)
+
+	std::sort(candidates.begin(), candidates.end(),
+		[](const Candidate &a, const Candidate &b)
 	{
-		// Load the SET file.
-		SETFile setFile(filename, palette);
+		return a.lastUsedFrame < b.lastUsedFrame;
+	});
 
-		// Create an SDL_Surface for each image in the SET.
-		const int imageCount = setFile.getImageCount();
-		for (int i = 0; i < imageCount; i++)
+	for (const Candidate &candidate : candidates)
+	{
+		if (this->memoryStats.getTotalBytes() <= this->memoryBudget)
 		{
-			uint32_t *pixels = setFile.getPixels(i);
-			SDL_Surface *surface = Surface::createSurfaceWithFormat(
-				SETFile::CHUNK_WIDTH, SETFile::CHUNK_HEIGHT,
-				Renderer::DEFAULT_BPP, Renderer::DEFAULT_PIXELFORMAT);
-			SDL_memcpy(surface->pixels, pixels, surface->pitch * surface->h);
+			break;
+		}
 
-			surfaceSet.push_back(surface);
+		if (candidate.imageHandle >= 0)
+		{
+			this->freeImage(candidate.imageHandle);
+		}
+		else
+		{
+			this->freeImageSet(candidate.setKey);
 		}
 	}
-	else
-	{
-		DebugCrash("Unrecognized surface list \"" + filename + "\".");
-	}
+}
 
-	return surfaceSet;
+const TextureManager::MemoryStats &TextureManager::getMemoryStats() const
+{
+	return this->memoryStats;
 }
 
-const std::vector<SDL_Surface*> &TextureManager::getSurfaces(const std::string &filename)
+void TextureManager::setMemoryBudget(size_t bytes)
 {
-	return this->getSurfaces(filename, this->activePalette);
+	this->memoryBudget = bytes;
 }
 
-const std::vector<Texture> &TextureManager::getTextures(
-	const std::string &filename, const std::string &paletteName, Renderer &renderer)
+void TextureManager::setIndexedImages(bool indexedImages)
 {
-	// This method deals with animations and movies, so it will check filenames 
-	// for ".CFA", ".CIF", ".DFA", ".FLC", ".SET", etc..
+	this->indexedImages = indexedImages;
+}
 
-	// Use this name when interfacing with the texture sets map.
-	const std::string fullName = filename + paletteName;
+void TextureManager::setPinned(int imageHandle, bool pinned)
+{
+	assert(imageHandle >= 0);
+	assert(imageHandle < static_cast<int>(this->images.size()));
 
-	// See if the file has already been loaded with the palette.
-	auto setIter = this->textureSets.find(fullName);
-	if (setIter != this->textureSets.end())
+	this->images[imageHandle].pinned = pinned;
+}
+
+void TextureManager::setSetPinned(const std::string &filename,
+	const std::string &paletteName, bool pinned)
+{
+	const ImageKey key(filename, paletteName);
+	if (pinned)
 	{
-		// The requested texture set exists.
-		return setIter->second;
+		this->pinnedSets.insert(key);
+	}
+	else
+	{
+		this->pinnedSets.erase(key);
 	}
+}
+
+void TextureManager::touch(int imageHandle)
+{
+	assert(imageHandle >= 0);
+	assert(imageHandle < static_cast<int>(this->images.size()));
 
-	// Do not use a built-in palette for texture sets.
-	DebugAssert(!Palette::isBuiltIn(paletteName), 
-		"Image sets (i.e., .SET files) do not have built-in palettes.");
+	this->images[imageHandle].lastUsedFrame = this->frame;
+	this->touchedImages[imageHandle] = true;
+}
 
-	// See if the palette hasn't already been loaded.
-	if (this->palettes.find(paletteName) == this->palettes.end())
+void TextureManager::touchSet(const std::string &filename, const std::string &paletteName)
+{
+	auto setIter = this->imageSets.find(ImageKey(filename, paletteName));
+	if (setIter != this->imageSets.end())
 	{
-		this->loadPalette(paletteName);
+		setIter->second.lastUsedFrame = this->frame;
 	}
+}
 
-	// The file hasn't been loaded with the palette yet, so make a new entry.
-	auto iter = this->textureSets.emplace(std::make_pair(
-		fullName, std::vector<Texture>())).first;
+void TextureManager::touchSet(const std::string &filename)
+{
+	this->touchSet(filename, this->activePalette);
+}
 
-	std::vector<Texture> &textureSet = iter->second;
-	const Palette &palette = this->palettes.at(paletteName);
+void TextureManager::unload(int imageHandle)
+{
+	assert(imageHandle >= 0);
+	assert(imageHandle < static_cast<int>(this->images.size()));
 
-	const std::string extension = String::getExtension(filename);
-	const bool isCFA = extension == ".CFA";
-	const bool isCIF = extension == ".CIF";
-	const bool isCEL = extension == ".CEL";
-	const bool isDFA = extension == ".DFA";
-	const bool isFLC = extension == ".FLC";
-	const bool isRCI = extension == ".RCI";
-	const bool isSET = extension == ".SET";
+	ImageEntry &image = this->images[imageHandle];
+	if (image.pinned)
+	{
+		return;
+	}
 
-	if (isCFA)
+	// The prefetch's completion callback does nothing once the pending decode is gone.
+	if (image.pending.get() != nullptr)
 	{
-		// Load the CFA file.
-		CFAFile cfaFile(filename, palette);
+		image.pending->read->cancel();
+		this->jobSystem->wait(image.pending->job);
+		image.pending = nullptr;
+	}
 
-		// Create an SDL_Texture for each image in the CFA.
-		const int imageCount = cfaFile.getImageCount();
-		for (int i = 0; i < imageCount; i++)
-		{
-			SDL_Texture *texture = renderer.createTexture(
-				Renderer::DEFAULT_PIXELFORMAT, SDL_TEXTUREACCESS_STATIC,
-				cfaFile.getWidth(), cfaFile.getHeight());
+	this->freeImage(imageHandle);
+}
 
-			const uint32_t *pixels = cfaFile.getPixels(i);
-			SDL_UpdateTexture(texture, nullptr, pixels,
-				cfaFile.getWidth() * sizeof(*pixels));
+void TextureManager::unloadSet(const std::string &filename,
+	const std::string &paletteName)
+{
+	const ImageKey key(filename, paletteName);
+	if (this->pinnedSets.find(key) != this->pinnedSets.end())
+	{
+		return;
+	}
 
-			textureSet.push_back(Texture(texture));
-		}
+	auto pendingIter = this->pendingSurfaceSets.find(key);
+	if (pendingIter != this->pendingSurfaceSets.end())
+	{
+		pendingIter->second.read->cancel();
+		this->jobSystem->wait(pendingIter->second.job);
+		this->pendingSurfaceSets.erase(pendingIter);
 	}
-	else if (isCIF)
+
+	this->freeImageSet(key);
+}
+
+void TextureManager::endFrame()
+{
+	if ((this->memoryBudget > 0) &&
+		(this->memoryStats.getTotalBytes() > this->memoryBudget))
 	{
-		// Load the CIF file.
-		CIFFile cifFile(filename, palette);
+		ProfileScope("TextureManager::evictUnused");
+		this->evictUnused();
+	}
 
-		// Create an SDL_Texture for each image in the CIF.
-		const int imageCount = cifFile.getImageCount();
-		for (int i = 0; i < imageCount; i++)
-		{
-			SDL_Texture *texture = renderer.createTexture(
-				Renderer::DEFAULT_PIXELFORMAT, SDL_TEXTUREACCESS_STATIC,
-				cifFile.getWidth(i), cifFile.getHeight(i));
+	// The caches keep their own totals, so the tracker gets them once a frame.
+	MemoryTracker::set(MemoryTag::TextureCaches, this->memoryStats.getTotalBytes());
 
-			const uint32_t *pixels = cifFile.getPixels(i);
-			SDL_UpdateTexture(texture, nullptr, pixels,
-				cifFile.getWidth(i) * sizeof(*pixels));
+	std::fill(this->touchedImages.begin(), this->touchedImages.end(), false);
+	this->frame++;
+}
 
-			textureSet.push_back(Texture(texture));
-		}
-	}
-	else if (isDFA)
+JobSystem::JobHandle TextureManager::addReadJob(const VFS::ReadRequestPtr &read)
+{
+	// Signaled by whichever thread finishes the read, which can be this one.
+	JobSystem *jobSystem = this->jobSystem;
+	const JobSystem::JobHandle readJob = jobSystem->addSignal(JobSystem::Priority::Background);
+	read->onDone([jobSystem, readJob]()
 	{
-		// Load the DFA file.
-		DFAFile dfaFile(filename, palette);
+		jobSystem->signal(readJob);
+	});
 
-		// Create an SDL_Texture for each image in the DFA.
-		const int imageCount = dfaFile.getImageCount();
-		for (int i = 0; i < imageCount; i++)
-		{
-			SDL_Texture *texture = renderer.createTexture(
-				Renderer::DEFAULT_PIXELFORMAT, SDL_TEXTUREACCESS_STATIC,
-				dfaFile.getWidth(), dfaFile.getHeight());
+	return readJob;
+}
 
-			const uint32_t *pixels = dfaFile.getPixels(i);
-			SDL_UpdateTexture(texture, nullptr, pixels,
-				dfaFile.getWidth() * sizeof(*pixels));
+void TextureManager::prefetch(int imageHandle)
+{
+	assert(imageHandle >= 0);
+	assert(imageHandle < static_cast<int>(this->images.size()));
+	DebugAssert(this->jobSystem != nullptr, "Texture manager is not initialized.");
 
-			textureSet.push_back(Texture(texture));
-		}
-	}
-	else if (isFLC || isCEL)
+	ImageEntry &image = this->images[imageHandle];
+	if ((image.surface != nullptr) || (image.indexedImage.get() != nullptr) ||
+		(image.texture.get() != nullptr) || (image.pending.get() != nullptr))
 	{
-		// Load the FLC file. CELs are basically identical to FLCs.
-		FLCFile flcFile(filename);
+		return;
+	}
 
-		// Create an SDL_Texture for each frame in the FLC.
-		const int imageCount = flcFile.getFrameCount();
-		for (int i = 0; i < imageCount; i++)
-		{
-			SDL_Texture *texture = renderer.createTexture(
-				Renderer::DEFAULT_PIXELFORMAT, SDL_TEXTUREACCESS_STATIC,
-				flcFile.getWidth(), flcFile.getHeight());
+	// The job only touches the image cache, which is shared with workers.
+	auto decodedImages = std::make_shared<ImageCache::ImagesPtr>();
+	ImageCache *imageCache = &this->imageCache;
+	const std::string filename = image.filename;
+	const std::string paletteName = image.paletteName;
 
-			const uint32_t *pixels = flcFile.getPixels(i);
-			SDL_UpdateTexture(texture, nullptr, pixels,
-				flcFile.getWidth() * sizeof(*pixels));
+	// The file is read on the VFS's I/O thread along with other prefetches, and the decode
+	// job is only queued once the read is done, so it doesn't hold up a worker on the disk.
+	const VFS::ReadRequestPtr read = VFS::Manager::get().readAsync({ filename },
+		VFS::ReadPriority::Prefetch);
+	const JobSystem::JobHandle readJob = this->addReadJob(read);
 
-			textureSet.push_back(Texture(texture));
-		}
-	}
-	else if (isRCI)
+	image.pending = std::make_unique<PendingDecode>();
+	image.pending->images = decodedImages;
+	image.pending->read = read;
+	image.pending->job = this->jobSystem->add(
+		[filename, paletteName, decodedImages, imageCache]()
+	{
+		*decodedImages = imageCache->getImages(filename, paletteName);
+	}, { readJob }, [this, imageHandle]()
 	{
-		// Load the RCI file.
-		RCIFile rciFile(filename, palette);
+		this->finishPrefetch(imageHandle);
+	}, JobSystem::Priority::Background);
+}
 
-		// Create an SDL_Texture for each image in the RCI.
-		const int imageCount = rciFile.getCount();
-		for (int i = 0; i < imageCount; i++)
-		{
-			SDL_Texture *texture = renderer.createTexture(
-				Renderer::DEFAULT_PIXELFORMAT, SDL_TEXTUREACCESS_STATIC,
-				RCIFile::FRAME_WIDTH, RCIFile::FRAME_HEIGHT);
+void TextureManager::prefetch(const std::string &filename, const std::string &paletteName)
+{
+	this->prefetch(this->getImageHandle(filename, paletteName));
+}
 
-			const uint32_t *pixels = rciFile.getPixels(i);
-			SDL_UpdateTexture(texture, nullptr, pixels,
-				RCIFile::FRAME_WIDTH * sizeof(*pixels));
+void TextureManager::prefetch(const std::string &filename)
+{
+	this->prefetch(filename, this->activePalette);
+}
 
-			textureSet.push_back(Texture(texture));
-		}
-	}
-	else if (isSET)
+void TextureManager::prefetchSet(const std::string &filename,
+	const std::string &paletteName)
+{
+	DebugAssert(this->jobSystem != nullptr, "Texture manager is not initialized.");
+
+	const ImageKey key(filename, paletteName);
+	if ((this->imageSets.find(key) != this->imageSets.end()) ||
+		(this->pendingSurfaceSets.find(key) != this->pendingSurfaceSets.end()))
 	{
-		// Load the SET file.
-		SETFile setFile(filename, palette);
+		return;
+	}
 
-		// Create an SDL_Texture for each image in the SET.
-		const int imageCount = setFile.getImageCount();
-		for (int i = 0; i < imageCount; i++)
-		{
-			SDL_Texture *texture = renderer.createTexture(
-				Renderer::DEFAULT_PIXELFORMAT, SDL_TEXTUREACCESS_STATIC,
-				SETFile::CHUNK_WIDTH, SETFile::CHUNK_HEIGHT);
+	auto decodedImages = std::make_shared<ImageCache::ImagesPtr>();
+	ImageCache *imageCache = &this->imageCache;
 
-			const uint32_t *pixels = setFile.getPixels(i);
-			SDL_UpdateTexture(texture, nullptr, pixels,
-				SETFile::CHUNK_WIDTH * sizeof(*pixels));
+	const VFS::ReadRequestPtr read = VFS::Manager::get().readAsync({ filename },
+		VFS::ReadPriority::Prefetch);
+	const JobSystem::JobHandle readJob = this->addReadJob(read);
 
-			textureSet.push_back(Texture(texture));
-		}
-	}
-	else
+	PendingDecode pending;
+	pending.images = decodedImages;
+	pending.read = read;
+	pending.job = this->jobSystem->add(
+		[filename, paletteName, decodedImages, imageCache]()
 	{
-		DebugCrash("Unrecognized texture list \"" + filename + "\".");
-	}
+		*decodedImages = imageCache->getImages(filename, paletteName);
+	}, { readJob }, [this, key]()
+	{
+		this->finishPrefetchSet(key);
+	}, JobSystem::Priority::Background);
+
+	this->pendingSurfaceSets.emplace(std::make_pair(key, std::move(pending)));
+}
+
+void TextureManager::prefetchSet(const std::string &filename)
+{
+	this->prefetchSet(filename, this->activePalette);
+}
 
-	// Set alpha transparency on for each texture.
-	for (auto &texture : textureSet)
+int TextureManager::getPrefetchCount() const
+{
+	const int imageCount = static_cast<int>(std::count_if(this->images.begin(),
+		this->images.end(), [](const ImageEntry &image)
 	{
-		SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
-	}
+		return image.pending.get() != nullptr;
+	}));
 
-	return textureSet;
+	return imageCount + static_cast<int>(this->pendingSurfaceSets.size());
 }
 
-const std::vector<Texture> &TextureManager::getTextures(const std::string &filename,
-	Renderer &renderer)
+ImageCache &TextureManager::getImageCache()
 {
-	return this->getTextures(filename, this->activePalette, renderer);
+	return this->imageCache;
 }
 
-void TextureManager::init()
+void TextureManager::init(JobSystem &jobSystem)
 {
 	DebugMention("Initializing.");
 
+	this->jobSystem = &jobSystem;
+	this->imageCache.init(jobSystem);
+
 	// Load default palette.
 	this->setPalette(PaletteFile::fromName(PaletteName::Default));
 }
 
 void TextureManager::setPalette(const std::string &paletteName)
 {
-	// Check if the palette hasn't already been loaded.
-	if (this->palettes.find(paletteName) == this->palettes.end())
-	{
-		this->loadPalette(paletteName);
-	}
-
+	// Load the palette now, so it isn't loaded by the first image using it.
+	this->imageCache.getPalette(paletteName);
 	this->activePalette = paletteName;
 }
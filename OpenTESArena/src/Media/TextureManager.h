@@ -1,53 +1,208 @@
 #ifndef TEXTURE_MANAGER_H
 #define TEXTURE_MANAGER_H
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "ImageCache.h"
+#include "IndexedImage.h"
 #include "Palette.h"
+#include "../Assets/AssetName.h"
 #include "../Rendering/Texture.h"
+#include "../Utilities/JobSystem.h"
+
+#include "components/vfs/manager.hpp"
 
 // Find a way to map original wall and sprite filenames to unique integer IDs 
 // (probably depending on the order they were parsed). Or perhaps the ID could 
 // be their offset in GLOBAL.BSA.
 
+// Surfaces and textures are only made and freed on the main thread, so the texture manager
+// is only for the main thread. Worker threads get decoded images from its image cache
+// instead, which the texture manager shares them with.
+
 class Renderer;
 
 struct SDL_Surface;
 
 class TextureManager
 {
+public:
+	// Bytes of pixel data held by each cache. Atlas pages are never evicted.
+	struct MemoryStats
+	{
+		size_t surfaceBytes, textureBytes, imageSetBytes, surfaceSetBytes, textureSetBytes,
+			atlasBytes;
+
+		MemoryStats();
+
+		size_t getTotalBytes() const;
+	};
+
+	// Where a small interface image is in an atlas page. Images too large for the atlas
+	// get a region covering their own texture instead, which like any other texture is
+	// only valid for the current frame.
+	struct AtlasRegion
+	{
+		SDL_Texture *texture;
+		int x, y, width, height;
+	};
+
+	// Width and height of each atlas page, and the largest image side packed into one.
+	static const int ATLAS_PAGE_SIZE;
+	static const int MAX_ATLAS_IMAGE_SIZE;
 private:
-	std::unordered_map<std::string, Palette> palettes;
-
-	// The filename and palette name are concatenated when mapping to avoid using two 
-	// maps. I.e., "EQUIPMEN.IMG" and "PAL.COL" become "EQUIPMEN.IMGPAL.COL".
-	std::unordered_map<std::string, SDL_Surface*> surfaces;
-	std::unordered_map<std::string, Texture> textures;
-	std::unordered_map<std::string, std::vector<SDL_Surface*>> surfaceSets;
-	std::unordered_map<std::string, std::vector<Texture>> textureSets;
+	// A texture that small interface images are packed into, in shelves filled left to
+	// right. A new shelf starts below the tallest image of the current one.
+	struct AtlasPage
+	{
+		Texture texture;
+		int shelfX, shelfY, shelfHeight;
+
+		AtlasPage(Texture &&texture);
+	};
+
+	typedef ImageCache::Key ImageKey;
+
+	// Decoding work started by a prefetch, finished on the main thread once it's done.
+	// The job writes into its own copy of the images pointer, so it never touches the
+	// texture manager.
+	struct PendingDecode
+	{
+		JobSystem::JobHandle job;
+		std::shared_ptr<ImageCache::ImagesPtr> images;
+		VFS::ReadRequestPtr read; // Pages the file in before the job is queued.
+	};
+
+	// An image file with a palette, referred to by its handle (its index in the entries).
+	// The surface and texture are loaded the first time they're requested, unless the
+	// image was prefetched.
+	struct ImageEntry
+	{
+		std::string filename, paletteName;
+		SDL_Surface *surface;
+
+		// Kept instead of a surface when indexed images are on, until a surface is asked for.
+		std::unique_ptr<IndexedImage> indexedImage;
+
+		std::unique_ptr<Texture> texture; // Pointer so references stay valid.
+		std::unique_ptr<PendingDecode> pending; // Non-null while being prefetched.
+		size_t surfaceBytes, textureBytes; // Surface bytes include the indexed image.
+		int lastUsedFrame;
+		bool pinned; // Never evicted if true.
+
+		ImageEntry(const std::string &filename, const std::string &paletteName);
+	};
+
+	// An image set (i.e., .SET, .CFA, .FLC) decoded once into palette indices, with
+	// surfaces and textures made from them when each is first requested. A set is pinned
+	// by its key in the pinned sets, so it can be pinned before it's loaded.
+	struct ImageSet
+	{
+		ImageCache::ImagesPtr images; // Null until decoded. Shared with the image cache.
+		std::vector<SDL_Surface*> surfaces;
+		std::vector<Texture> textures;
+		size_t imageBytes, surfaceBytes, textureBytes;
+		int lastUsedFrame;
+
+		ImageSet();
+	};
+
+	// Palettes and decoded palette indices, which worker threads can also use.
+	ImageCache imageCache;
+
+	std::unordered_map<ImageKey, int, ImageKey::Hash> imageHandles;
+	std::vector<ImageEntry> images;
+	std::unordered_map<ImageKey, ImageSet, ImageKey::Hash> imageSets;
+	std::unordered_map<ImageKey, PendingDecode, ImageKey::Hash> pendingSurfaceSets;
+	std::unordered_set<ImageKey, ImageKey::Hash> pinnedSets;
+	std::vector<AtlasPage> atlasPages;
+	std::unordered_map<int, AtlasRegion> atlasRegions; // By image handle.
+
+	// By image set key. Images too large for the atlas have a null texture.
+	std::unordered_map<ImageKey, std::vector<AtlasRegion>, ImageKey::Hash> atlasSetRegions;
 	std::string activePalette;
+	MemoryStats memoryStats;
+	size_t memoryBudget; // Zero if unlimited.
+	int frame; // Incremented by endFrame(), for finding the least recently used entries.
+	std::vector<bool> touchedImages; // Whether each image handle was used this frame.
+	bool indexedImages; // Whether images are kept as palette indices between uses.
+	JobSystem *jobSystem;
 
-	// Specialty method for loading a COL file into the palettes map.
-	void loadCOLPalette(const std::string &colName);
+	// Gets the bytes of pixel data in a surface or texture.
+	static size_t getSurfaceBytes(const SDL_Surface *surface);
+	static size_t getTextureBytes(const Texture &texture);
+
+	// Converts an indexed image into a new surface or texture.
+	static SDL_Surface *makeSurface(const IndexedImage &image);
+	static SDL_Texture *makeTexture(const IndexedImage &image, Renderer &renderer);
+
+	// Makes a texture from 32-bit pixels.
+	static SDL_Texture *makeTexture(int width, int height, const uint32_t *pixels,
+		Renderer &renderer);
+
+	// Gets an image set with its indexed images, decoding the file (or finishing its
+	// prefetch) if needed.
+	ImageSet &loadImageSet(const std::string &filename, const std::string &paletteName);
+
+	// Loads an image file with a palette into a new surface or texture.
+	SDL_Surface *loadSurface(const std::string &filename, const std::string &paletteName);
+	SDL_Texture *loadTexture(const std::string &filename, const std::string &paletteName,
+		Renderer &renderer);
 
-	// Specialty method for loading the palette from an IMG file into the palettes map.
-	void loadIMGPalette(const std::string &imgName);
+	// Makes the surface (or indexed image) of a prefetched image, waiting on its decoding
+	// first if needed. Does nothing if the image isn't being prefetched.
+	void finishPrefetch(int imageHandle);
 
-	// Helper method for loading a palette file into the palettes map.
-	void loadPalette(const std::string &paletteName);
+	// Gets an image's palette indices, decoding them if needed. Only for when indexed
+	// images are on and the image has no surface.
+	const IndexedImage &getIndexedImage(int imageHandle);
+
+	// Same as finishPrefetch(), only for an image set.
+	void finishPrefetchSet(const ImageKey &key);
+
+	// Gets a job that's finished once the read request is, for a decode to depend on.
+	JobSystem::JobHandle addReadJob(const VFS::ReadRequestPtr &read);
+
+	// Copies an image's pixels into free space in an atlas page, starting a new page if
+	// none have room.
+	AtlasRegion packAtlasRegion(int width, int height, const uint32_t *pixels, int pitch,
+		Renderer &renderer);
+
+	// Frees an image's surface, indexed image, and texture. The entry and its handle stay,
+	// so it can be loaded again later.
+	void freeImage(int imageHandle);
+
+	// Frees an image set and everything made from it.
+	void freeImageSet(const ImageKey &key);
+
+	// Frees entries that weren't used this frame, least recently used first, until the
+	// caches fit in the memory budget. Pinned and prefetching entries are skipped.
+	void evictUnused();
 public:
+	TextureManager();
 	~TextureManager();
 
 	TextureManager &operator=(TextureManager &&textureManager) = delete;
 
+	// Gets the handle of an image file with a palette, for getting its surface or texture
+	// without building and hashing their names again. Handles stay valid for the texture
+	// manager's lifetime. When no palette name is given, the active one is used.
+	int getImageHandle(const std::string &filename, const std::string &paletteName);
+	int getImageHandle(const std::string &filename);
+
 	// Gets a surface from file. It will be loaded if not already stored with the 
 	// requested palette. A valid filename might be something like "TAMRIEL.IMG".
+	SDL_Surface *getSurface(int imageHandle);
 	SDL_Surface *getSurface(const std::string &filename, const std::string &paletteName);
 	SDL_Surface *getSurface(const std::string &filename);
 
 	// Similar to getSurface(), only now for hardware-accelerated textures.
+	const Texture &getTexture(int imageHandle, Renderer &renderer);
 	const Texture &getTexture(const std::string &filename, const std::string &paletteName,
 		Renderer &renderer);
 	const Texture &getTexture(const std::string &filename, Renderer &renderer);
@@ -61,12 +216,88 @@ public:
 
 	// Gets a set of textures from a file. This is intended for animations and movies, 
 	// where the filename essentially points to several images. When no palette name 
-	// is given, the active one is used.
+	// is given, the active one is used. The file is only decoded once for both this
+	// and getSurfaces(), and surfaces are only made if they're asked for.
 	const std::vector<Texture> &getTextures(const std::string &filename,
 		const std::string &paletteName, Renderer &renderer);
 	const std::vector<Texture> &getTextures(const std::string &filename, Renderer &renderer);
 
-	void init();
+	// Gets the palette indices of each image in a set, without making any surfaces or
+	// textures. For callers that only need one image of a large set at a time.
+	const std::vector<IndexedImage> &getImages(const std::string &filename,
+		const std::string &paletteName);
+
+	// Gets where an image is in the interface atlas, packing it the first time. Consecutive
+	// draws from the same atlas page don't switch textures, so interface images drawn
+	// together in a frame should come from here (see InterfaceBatch).
+	AtlasRegion getAtlasRegion(int imageHandle, Renderer &renderer);
+	AtlasRegion getAtlasRegion(const std::string &filename, const std::string &paletteName,
+		Renderer &renderer);
+	AtlasRegion getAtlasRegion(const std::string &filename, Renderer &renderer);
+
+	// Same as getAtlasRegion(), for one image of an image set.
+	AtlasRegion getAtlasRegion(const std::string &filename, const std::string &paletteName,
+		int index, Renderer &renderer);
+
+	// Starts decoding an image file on a worker thread, so a later request for its
+	// surface or texture doesn't have to. The surface is made on the main thread when the
+	// job system runs its callbacks, or when the image is requested, whichever is first.
+	// Does nothing if the image is already loaded or being prefetched.
+	void prefetch(int imageHandle);
+	void prefetch(const std::string &filename, const std::string &paletteName);
+	void prefetch(const std::string &filename);
+
+	// Similar to prefetch(), only for image sets. A later getSurfaces() or getTextures()
+	// call uses the prefetched images instead of decoding the file again.
+	void prefetchSet(const std::string &filename, const std::string &paletteName);
+	void prefetchSet(const std::string &filename);
+
+	// Gets the number of images and image sets still being prefetched.
+	int getPrefetchCount() const;
+
+	// Gets the cache of decoded images, for loading images from other threads. Images
+	// decoded there are used by the texture manager instead of being decoded again.
+	ImageCache &getImageCache();
+
+	// Gets the resident bytes of each cache.
+	const MemoryStats &getMemoryStats() const;
+
+	// Sets the most bytes the caches should hold. Entries that aren't used in a frame
+	// can be freed at the end of it when the caches are over the budget, so callers
+	// shouldn't keep surfaces or textures past the current frame unless they're pinned.
+	// Zero means no limit.
+	void setMemoryBudget(size_t bytes);
+
+	// Sets whether images that are only needed for making textures and atlas regions are
+	// kept as palette indices (one byte per pixel) instead of 32-bit surfaces. They're
+	// converted when a texture is made from them, or when their surface is asked for.
+	void setIndexedImages(bool indexedImages);
+
+	// Sets whether an image or image set is kept regardless of the memory budget, for
+	// things like interface textures that are always needed.
+	void setPinned(int imageHandle, bool pinned);
+	void setSetPinned(const std::string &filename, const std::string &paletteName,
+		bool pinned);
+
+	// Marks an image or image set as used this frame without getting it, for images whose
+	// pixels were copied into something that still draws them (i.e., the 3D renderer's
+	// voxel textures), so they're evicted after the ones nothing draws. Sets that aren't
+	// loaded are left alone.
+	void touch(int imageHandle);
+	void touchSet(const std::string &filename, const std::string &paletteName);
+	void touchSet(const std::string &filename);
+
+	// Frees an image or image set right away instead of waiting for it to be evicted, for
+	// things like cinematics that are only shown once. A prefetch that's still running is
+	// waited on and thrown away. Pinned entries are kept.
+	void unload(int imageHandle);
+	void unloadSet(const std::string &filename, const std::string &paletteName);
+
+	// Marks the end of a frame. Evicts unused entries if over the memory budget. Must be
+	// called after the frame is presented.
+	void endFrame();
+
+	void init(JobSystem &jobSystem);
 
 	// Sets the palette to use for subsequent images. The source of the palette can be
 	// from a loose .COL file, or can be built into an IMG. If the IMG does not have a 
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <numeric>
+
+#include "DynamicResolution.h"
+
+const double DynamicResolution::SCALE_STEP = 0.05;
+const double DynamicResolution::DECREASE_THRESHOLD = 0.95;
+const double DynamicResolution::INCREASE_THRESHOLD = 0.75;
+const double DynamicResolution::COOLDOWN_SECONDS = 1.0;
+
+DynamicResolution::DynamicResolution()
+{
+	this->reset();
+}
+
+double DynamicResolution::getAverageWorkTime() const
+{
+	const int count = std::min(this->workTimeCount, static_cast<int>(this->workTimes.size()));
+	const double sum = std::accumulate(this->workTimes.begin(),
+		this->workTimes.begin() + count, 0.0);
+	return sum / static_cast<double>(count);
+}
+
+void DynamicResolution::updateWorkTime(double workTime, double dt)
+{
+	// Rotate the array right by one index (this puts the last value at the front).
+	std::rotate(this->workTimes.rbegin(),
+		this->workTimes.rbegin() + 1, this->workTimes.rend());
+
+	this->workTimes.front() = workTime;
+	this->workTimeCount++;
+	this->cooldownSeconds = std::max(this->cooldownSeconds - dt, 0.0);
+}
+
+double DynamicResolution::getNextScale(double currentScale, double minScale,
+	double maxScale, double targetFrameTime)
+{
+	// Wait until the cooldown is over and there are enough frames to average, so a single
+	// hitch (loading, etc.) doesn't change the scale.
+	const bool hasEnoughFrames = this->workTimeCount >= static_cast<int>(this->workTimes.size());
+	if ((this->cooldownSeconds > 0.0) || !hasEnoughFrames)
+	{
+		return std::max(std::min(currentScale, maxScale), minScale);
+	}
+
+	const double averageWorkTime = this->getAverageWorkTime();
+	double nextScale = currentScale;
+
+	if (averageWorkTime > (targetFrameTime * DynamicResolution::DECREASE_THRESHOLD))
+	{
+		nextScale = currentScale - DynamicResolution::SCALE_STEP;
+	}
+	else
+	{
+		// Most of the frame cost is per-pixel, so estimate the frame time at the next scale
+		// up by the change in pixel count.
+		const double increasedScale = currentScale + DynamicResolution::SCALE_STEP;
+		const double pixelRatio = (increasedScale * increasedScale) /
+			(currentScale * currentScale);
+		const double estimatedWorkTime = averageWorkTime * pixelRatio;
+
+		if (estimatedWorkTime < (targetFrameTime * DynamicResolution::INCREASE_THRESHOLD))
+		{
+			nextScale = increasedScale;
+		}
+	}
+
+	nextScale = std::max(std::min(nextScale, maxScale), minScale);
+
+	if (nextScale != currentScale)
+	{
+		// Start over with frame times at the new scale.
+		this->reset();
+		this->cooldownSeconds = DynamicResolution::COOLDOWN_SECONDS;
+	}
+
+	return nextScale;
+}
+
+void DynamicResolution::reset()
+{
+	this->workTimes.fill(0.0);
+	this->workTimeCount = 0;
+	this->cooldownSeconds = 0.0;
+}
@@ -0,0 +1,51 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <array>
+
+// Adjusts the game world's resolution scale to keep frame times within the target frame
+// rate's budget. It watches how long each frame took before the game loop's sleep, and
+// steps the scale down when frames run over budget and back up when they have plenty
+// of room.
+
+// Changes are spaced apart and the thresholds for stepping down and up are far apart,
+// so the scale doesn't oscillate between two values.
+
+class DynamicResolution
+{
+private:
+	// Amount the scale changes by in each step.
+	static const double SCALE_STEP;
+
+	// Percents of the frame budget. Frames slower than the first step the scale down, and
+	// frames that would still be faster than the second after stepping up step it up.
+	static const double DECREASE_THRESHOLD;
+	static const double INCREASE_THRESHOLD;
+
+	// Seconds to wait after a change before considering another one, so the frame times
+	// can reflect the new scale.
+	static const double COOLDOWN_SECONDS;
+
+	std::array<double, 20> workTimes; // Most recent frame times without sleeping.
+	int workTimeCount; // Number of frame times recorded since the last change.
+	double cooldownSeconds; // Time left before the scale can change again.
+
+	// Calculates the average frame time based on the recorded frames.
+	double getAverageWorkTime() const;
+public:
+	DynamicResolution();
+
+	// Records the time a frame took to simulate and draw (without sleeping), and counts
+	// down the cooldown by the frame's delta time.
+	void updateWorkTime(double workTime, double dt);
+
+	// Gets the resolution scale to use given the current one and the allowed range. It
+	// returns the current scale unless a change is warranted.
+	double getNextScale(double currentScale, double minScale, double maxScale,
+		double targetFrameTime);
+
+	// Clears recorded frame times, i.e., after the scale was changed from somewhere else.
+	void reset();
+};
+
+#endif
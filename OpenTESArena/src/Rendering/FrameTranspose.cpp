@@ -0,0 +1,109 @@
+#include <algorithm>
+
+#include "FrameTranspose.h"
+
+// Decide which vector path can be compiled for the target architecture. Both are part of
+// their architecture's baseline, so no run-time check is needed.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FRAME_TRANSPOSE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define FRAME_TRANSPOSE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// Copies a 4x4 square of pixels, where "src" is the top of the first column and "dst"
+	// is the left of the first row.
+	void transpose4x4(const uint32_t *src, int srcStride, uint32_t *dst, int dstStride)
+	{
+#if defined(FRAME_TRANSPOSE_SSE2)
+		const __m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		const __m128i c1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + srcStride));
+		const __m128i c2 = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(src + (srcStride * 2)));
+		const __m128i c3 = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(src + (srcStride * 3)));
+
+		const __m128i t0 = _mm_unpacklo_epi32(c0, c1);
+		const __m128i t1 = _mm_unpacklo_epi32(c2, c3);
+		const __m128i t2 = _mm_unpackhi_epi32(c0, c1);
+		const __m128i t3 = _mm_unpackhi_epi32(c2, c3);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi64(t0, t1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + dstStride),
+			_mm_unpackhi_epi64(t0, t1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (dstStride * 2)),
+			_mm_unpacklo_epi64(t2, t3));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (dstStride * 3)),
+			_mm_unpackhi_epi64(t2, t3));
+#elif defined(FRAME_TRANSPOSE_NEON)
+		const uint32x4x2_t t01 = vtrnq_u32(vld1q_u32(src), vld1q_u32(src + srcStride));
+		const uint32x4x2_t t23 = vtrnq_u32(vld1q_u32(src + (srcStride * 2)),
+			vld1q_u32(src + (srcStride * 3)));
+
+		vst1q_u32(dst, vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0])));
+		vst1q_u32(dst + dstStride,
+			vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1])));
+		vst1q_u32(dst + (dstStride * 2),
+			vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0])));
+		vst1q_u32(dst + (dstStride * 3),
+			vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1])));
+#else
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				dst[j + (i * dstStride)] = src[i + (j * srcStride)];
+			}
+		}
+#endif
+	}
+
+	// Copies pixels one at a time, for the edges of blocks that aren't a multiple of four.
+	void transposeScalar(const uint32_t *columns, int width, int height, int xStart, int xEnd,
+		int yStart, int yEnd, uint32_t *rows)
+	{
+		for (int y = yStart; y < yEnd; y++)
+		{
+			for (int x = xStart; x < xEnd; x++)
+			{
+				rows[x + (y * width)] = columns[y + (x * height)];
+			}
+		}
+	}
+}
+
+const int FrameTranspose::BLOCK_SIZE = 16;
+
+void FrameTranspose::columnsToRows(const uint32_t *columns, int width, int height,
+	int startX, int endX, uint32_t *rows)
+{
+	for (int yBlock = 0; yBlock < height; yBlock += FrameTranspose::BLOCK_SIZE)
+	{
+		const int yBlockEnd = std::min(yBlock + FrameTranspose::BLOCK_SIZE, height);
+		const int yVectorEnd = yBlock + (((yBlockEnd - yBlock) / 4) * 4);
+
+		for (int xBlock = startX; xBlock < endX; xBlock += FrameTranspose::BLOCK_SIZE)
+		{
+			const int xBlockEnd = std::min(xBlock + FrameTranspose::BLOCK_SIZE, endX);
+			const int xVectorEnd = xBlock + (((xBlockEnd - xBlock) / 4) * 4);
+
+			for (int x = xBlock; x < xVectorEnd; x += 4)
+			{
+				for (int y = yBlock; y < yVectorEnd; y += 4)
+				{
+					transpose4x4(columns + (y + (x * height)), height,
+						rows + (x + (y * width)), width);
+				}
+			}
+
+			// Leftover columns on the right, then leftover rows on the bottom.
+			transposeScalar(columns, width, height, xVectorEnd, xBlockEnd,
+				yBlock, yBlockEnd, rows);
+			transposeScalar(columns, width, height, xBlock, xVectorEnd,
+				yVectorEnd, yBlockEnd, rows);
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#ifndef FRAME_TRANSPOSE_H
+#define FRAME_TRANSPOSE_H
+
+#include <cstdint>
+
+// Static class for copying a column-major frame into a row-major one. The software
+// renderer can draw into column-major buffers so each screen column is contiguous, and
+// this class turns the result into the row-major layout the SDL texture expects.
+
+// The copy is done in square blocks that fit in the cache, and each block is transposed
+// four pixels at a time with vector instructions when the build supports them.
+
+class FrameTranspose
+{
+private:
+	// Width and height of a cache block in pixels.
+	static const int BLOCK_SIZE;
+
+	FrameTranspose() = delete;
+	~FrameTranspose() = delete;
+public:
+	// Copies the screen columns in [startX, endX) from a column-major buffer (each column
+	// is "height" pixels long) to a row-major buffer (each row is "width" pixels long).
+	// Separate threads can copy separate column ranges at the same time.
+	static void columnsToRows(const uint32_t *columns, int width, int height,
+		int startX, int endX, uint32_t *rows);
+};
+
+#endif
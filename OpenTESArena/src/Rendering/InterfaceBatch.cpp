@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <functional>
+
+#include "SDL.h"
+
+#include "InterfaceBatch.h"
+#include "Renderer.h"
+
+namespace
+{
+	// Whether two rectangles share any pixels.
+	bool rectsOverlap(const Rect &a, const Rect &b)
+	{
+		return (a.getLeft() < b.getRight()) && (b.getLeft() < a.getRight()) &&
+			(a.getTop() < b.getBottom()) && (b.getTop() < a.getBottom());
+	}
+}
+
+void InterfaceBatch::add(SDL_Texture *texture, int x, int y)
+{
+	int width, height;
+	SDL_QueryTexture(texture, nullptr, nullptr, &width, &height);
+	this->add(texture, Rect(width, height), x, y);
+}
+
+void InterfaceBatch::add(const TextureManager::AtlasRegion &region, int x, int y)
+{
+	this->add(region.texture, Rect(region.x, region.y, region.width, region.height), x, y);
+}
+
+void InterfaceBatch::add(SDL_Texture *texture, const Rect &srcRect, int x, int y)
+{
+	Draw draw;
+	draw.texture = texture;
+	draw.srcRect = srcRect;
+	draw.dstRect = Rect(x, y, srcRect.getWidth(), srcRect.getHeight());
+
+	// Go above every earlier draw this one overlaps. Ones of the same texture can share
+	// its layer, since draws keep their order within a texture.
+	draw.layer = 0;
+	for (const Draw &other : this->draws)
+	{
+		if (rectsOverlap(other.dstRect, draw.dstRect))
+		{
+			const int minLayer = (other.texture == draw.texture) ?
+				other.layer : (other.layer + 1);
+			draw.layer = std::max(draw.layer, minLayer);
+		}
+	}
+
+	this->draws.push_back(draw);
+}
+
+void InterfaceBatch::flush(Renderer &renderer)
+{
+	std::stable_sort(this->draws.begin(), this->draws.end(),
+		[](const Draw &a, const Draw &b)
+	{
+		if (a.layer != b.layer)
+		{
+			return a.layer < b.layer;
+		}
+
+		return std::less<SDL_Texture*>()(a.texture, b.texture);
+	});
+
+	for (const Draw &draw : this->draws)
+	{
+		renderer.drawOriginalClipped(draw.texture, draw.srcRect, draw.dstRect);
+	}
+
+	this->draws.clear();
+}
@@ -0,0 +1,43 @@
+#ifndef INTERFACE_BATCH_H
+#define INTERFACE_BATCH_H
+
+#include <vector>
+
+#include "../Math/Rect.h"
+#include "../Media/TextureManager.h"
+
+// Collects a panel's interface draws for a frame and submits them grouped by texture, so
+// draws from the same atlas page go to the renderer back to back without texture switches.
+// A draw only moves ahead of earlier ones that it doesn't overlap, so the frame looks the
+// same as drawing everything in the order it was added. Coordinates are in original screen
+// space (320x200), like the renderer's drawOriginal() methods.
+
+class Renderer;
+
+struct SDL_Texture;
+
+class InterfaceBatch
+{
+private:
+	struct Draw
+	{
+		SDL_Texture *texture;
+		Rect srcRect, dstRect;
+		int layer; // Draws in a layer don't overlap draws of other textures in it.
+	};
+
+	std::vector<Draw> draws; // Kept between frames to reuse its memory.
+public:
+	// Adds a draw of a whole texture, or an atlas region, with its top left corner at the
+	// given point.
+	void add(SDL_Texture *texture, int x, int y);
+	void add(const TextureManager::AtlasRegion &region, int x, int y);
+
+	// Adds a draw of part of a texture.
+	void add(SDL_Texture *texture, const Rect &srcRect, int x, int y);
+
+	// Draws everything added since the last flush onto the native frame buffer.
+	void flush(Renderer &renderer);
+};
+
+#endif
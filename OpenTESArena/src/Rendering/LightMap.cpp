@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "LightMap.h"
+#include "../Utilities/JobSystem.h"
+#include "../Utilities/Profiler.h"
+
+const int LightMap::SAMPLES_PER_VOXEL = 4;
+
+LightMap::LightMap()
+{
+	this->originX = 0;
+	this->originZ = 0;
+	this->width = 0;
+	this->depth = 0;
+}
+
+void LightMap::bake(const std::vector<Light> &lights, JobSystem &jobSystem)
+{
+	ProfileScope("LightMap::bake");
+
+	*this = LightMap();
+
+	if (lights.size() == 0)
+	{
+		return;
+	}
+
+	// Get the voxel bounds of everything the lights can reach.
+	int minX = std::numeric_limits<int>::max();
+	int minZ = std::numeric_limits<int>::max();
+	int maxX = std::numeric_limits<int>::min();
+	int maxZ = std::numeric_limits<int>::min();
+	for (const Light &light : lights)
+	{
+		minX = std::min(minX, static_cast<int>(std::floor(light.point.x - light.radius)));
+		minZ = std::min(minZ, static_cast<int>(std::floor(light.point.y - light.radius)));
+		maxX = std::max(maxX, static_cast<int>(std::floor(light.point.x + light.radius)));
+		maxZ = std::max(maxZ, static_cast<int>(std::floor(light.point.y + light.radius)));
+	}
+
+	this->originX = minX;
+	this->originZ = minZ;
+	this->width = ((maxX - minX) + 1) * LightMap::SAMPLES_PER_VOXEL;
+	this->depth = ((maxZ - minZ) + 1) * LightMap::SAMPLES_PER_VOXEL;
+	this->emissions.resize(this->width * this->depth);
+
+	// Each job takes every Nth row, so rows near clusters of lights are shared out evenly.
+	const int jobCount = std::min(this->depth, jobSystem.getThreadCount() + 1);
+	jobSystem.parallelFor(jobCount, [this, &lights, jobCount](int jobIndex)
+	{
+		const double sampleSize = 1.0 / static_cast<double>(LightMap::SAMPLES_PER_VOXEL);
+
+		for (int z = jobIndex; z < this->depth; z += jobCount)
+		{
+			const double pointZ = static_cast<double>(this->originZ) +
+				((static_cast<double>(z) + 0.50) * sampleSize);
+
+			for (int x = 0; x < this->width; x++)
+			{
+				const double pointX = static_cast<double>(this->originX) +
+					((static_cast<double>(x) + 0.50) * sampleSize);
+
+				double lightLevel = 0.0;
+				for (const Light &light : lights)
+				{
+					const Double2 diff(pointX - light.point.x, pointZ - light.point.y);
+					const double distSqr = (diff.x * diff.x) + (diff.y * diff.y);
+
+					if (distSqr < (light.radius * light.radius))
+					{
+						lightLevel += light.brightness *
+							(1.0 - (std::sqrt(distSqr) / light.radius));
+					}
+				}
+
+				this->emissions[x + (z * this->width)] =
+					static_cast<uint8_t>(std::min(lightLevel, 1.0) * 255.0);
+			}
+		}
+	});
+}
+
+bool LightMap::isEmpty() const
+{
+	return this->emissions.size() == 0;
+}
+
+size_t LightMap::getBytes() const
+{
+	return this->emissions.size() * sizeof(this->emissions.front());
+}
+
+uint8_t LightMap::getLightEmission(const Double2 &point) const
+{
+	const double samplesPerVoxel = static_cast<double>(LightMap::SAMPLES_PER_VOXEL);
+	const int x = static_cast<int>(std::floor(
+		(point.x - static_cast<double>(this->originX)) * samplesPerVoxel));
+	const int z = static_cast<int>(std::floor(
+		(point.y - static_cast<double>(this->originZ)) * samplesPerVoxel));
+
+	if ((x < 0) || (x >= this->width) || (z < 0) || (z >= this->depth))
+	{
+		return 0;
+	}
+
+	return this->emissions[x + (z * this->width)];
+}
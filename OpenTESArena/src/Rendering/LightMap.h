@@ -0,0 +1,52 @@
+#ifndef LIGHT_MAP_H
+#define LIGHT_MAP_H
+
+#include <cstdint>
+#include <vector>
+
+#include "../Math/Vector2.h"
+
+// Light from a level's static sources (candles, torches, braziers, etc.) baked once into a
+// coarse grid over the XZ plane, so pixels get it with one lookup instead of going through
+// the renderer's light grid. Dynamic lights are left for things that move.
+
+// Lighting is only in the XZ plane, like the rest of the 2.5D geometry, so the same samples
+// light wall faces and floors.
+
+class JobSystem;
+
+class LightMap
+{
+public:
+	// A light that never moves. Its light falls off linearly to nothing at the radius.
+	struct Light
+	{
+		Double2 point;
+		double radius, brightness;
+	};
+private:
+	// Samples along each side of a voxel.
+	static const int SAMPLES_PER_VOXEL;
+
+	std::vector<uint8_t> emissions; // Light emission at each sample, row by row in Z.
+	int originX, originZ; // Voxel coordinate of the first sample.
+	int width, depth; // Number of samples in X and Z.
+public:
+	LightMap();
+
+	// Bakes the lights into samples covering everywhere they reach, with rows of samples
+	// spread across the job system.
+	void bake(const std::vector<Light> &lights, JobSystem &jobSystem);
+
+	// Returns whether no light was baked.
+	bool isEmpty() const;
+
+	// Gets the bytes used by the samples.
+	size_t getBytes() const;
+
+	// Gets the texel emission of the nearest sample to an XZ point, or zero if it's outside
+	// the baked area.
+	uint8_t getLightEmission(const Double2 &point) const;
+};
+
+#endif
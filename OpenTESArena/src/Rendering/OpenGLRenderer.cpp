@@ -0,0 +1,1440 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+#include "SDL.h"
+#include "SDL_opengl.h"
+
+#include "OpenGLRenderer.h"
+#include "../Math/Constants.h"
+#include "../Math/Matrix4.h"
+#include "../Math/Vector2.h"
+#include "../Utilities/Debug.h"
+#include "../World/VoxelDataType.h"
+#include "../World/VoxelGrid.h"
+
+namespace
+{
+	// OpenGL functions used by the renderer. They're all loaded through SDL once there's a
+	// context, so the program doesn't need to link against an OpenGL library.
+#define OPENGL_FUNCTIONS(F) \
+	F(decltype(&glBindTexture), bindTexture, "glBindTexture") \
+	F(decltype(&glClear), clear, "glClear") \
+	F(decltype(&glClearColor), clearColor, "glClearColor") \
+	F(decltype(&glDeleteTextures), deleteTextures, "glDeleteTextures") \
+	F(decltype(&glDepthFunc), depthFunc, "glDepthFunc") \
+	F(decltype(&glDisable), disable, "glDisable") \
+	F(decltype(&glDrawArrays), drawArrays, "glDrawArrays") \
+	F(decltype(&glEnable), enable, "glEnable") \
+	F(decltype(&glFrontFace), frontFace, "glFrontFace") \
+	F(decltype(&glGenTextures), genTextures, "glGenTextures") \
+	F(decltype(&glPixelStorei), pixelStorei, "glPixelStorei") \
+	F(decltype(&glReadPixels), readPixels, "glReadPixels") \
+	F(decltype(&glTexImage2D), texImage2D, "glTexImage2D") \
+	F(decltype(&glTexParameteri), texParameteri, "glTexParameteri") \
+	F(decltype(&glViewport), viewport, "glViewport") \
+	F(PFNGLACTIVETEXTUREPROC, activeTexture, "glActiveTexture") \
+	F(PFNGLATTACHSHADERPROC, attachShader, "glAttachShader") \
+	F(PFNGLBINDBUFFERPROC, bindBuffer, "glBindBuffer") \
+	F(PFNGLBINDFRAMEBUFFERPROC, bindFramebuffer, "glBindFramebuffer") \
+	F(PFNGLBINDRENDERBUFFERPROC, bindRenderbuffer, "glBindRenderbuffer") \
+	F(PFNGLBINDVERTEXARRAYPROC, bindVertexArray, "glBindVertexArray") \
+	F(PFNGLBUFFERDATAPROC, bufferData, "glBufferData") \
+	F(PFNGLCHECKFRAMEBUFFERSTATUSPROC, checkFramebufferStatus, "glCheckFramebufferStatus") \
+	F(PFNGLCOMPILESHADERPROC, compileShader, "glCompileShader") \
+	F(PFNGLCREATEPROGRAMPROC, createProgram, "glCreateProgram") \
+	F(PFNGLCREATESHADERPROC, createShader, "glCreateShader") \
+	F(PFNGLDELETEBUFFERSPROC, deleteBuffers, "glDeleteBuffers") \
+	F(PFNGLDELETEFRAMEBUFFERSPROC, deleteFramebuffers, "glDeleteFramebuffers") \
+	F(PFNGLDELETEPROGRAMPROC, deleteProgram, "glDeleteProgram") \
+	F(PFNGLDELETERENDERBUFFERSPROC, deleteRenderbuffers, "glDeleteRenderbuffers") \
+	F(PFNGLDELETESHADERPROC, deleteShader, "glDeleteShader") \
+	F(PFNGLDELETEVERTEXARRAYSPROC, deleteVertexArrays, "glDeleteVertexArrays") \
+	F(PFNGLDRAWARRAYSINSTANCEDPROC, drawArraysInstanced, "glDrawArraysInstanced") \
+	F(PFNGLENABLEVERTEXATTRIBARRAYPROC, enableVertexAttribArray, "glEnableVertexAttribArray") \
+	F(PFNGLFRAMEBUFFERRENDERBUFFERPROC, framebufferRenderbuffer, "glFramebufferRenderbuffer") \
+	F(PFNGLGENBUFFERSPROC, genBuffers, "glGenBuffers") \
+	F(PFNGLGENERATEMIPMAPPROC, generateMipmap, "glGenerateMipmap") \
+	F(PFNGLGENFRAMEBUFFERSPROC, genFramebuffers, "glGenFramebuffers") \
+	F(PFNGLGENRENDERBUFFERSPROC, genRenderbuffers, "glGenRenderbuffers") \
+	F(PFNGLGENVERTEXARRAYSPROC, genVertexArrays, "glGenVertexArrays") \
+	F(PFNGLGETPROGRAMINFOLOGPROC, getProgramInfoLog, "glGetProgramInfoLog") \
+	F(PFNGLGETPROGRAMIVPROC, getProgramiv, "glGetProgramiv") \
+	F(PFNGLGETSHADERINFOLOGPROC, getShaderInfoLog, "glGetShaderInfoLog") \
+	F(PFNGLGETSHADERIVPROC, getShaderiv, "glGetShaderiv") \
+	F(PFNGLGETUNIFORMLOCATIONPROC, getUniformLocation, "glGetUniformLocation") \
+	F(PFNGLLINKPROGRAMPROC, linkProgram, "glLinkProgram") \
+	F(PFNGLRENDERBUFFERSTORAGEPROC, renderbufferStorage, "glRenderbufferStorage") \
+	F(PFNGLSHADERSOURCEPROC, shaderSource, "glShaderSource") \
+	F(PFNGLTEXIMAGE3DPROC, texImage3D, "glTexImage3D") \
+	F(PFNGLTEXSUBIMAGE3DPROC, texSubImage3D, "glTexSubImage3D") \
+	F(PFNGLUNIFORM1FPROC, uniform1f, "glUniform1f") \
+	F(PFNGLUNIFORM1IPROC, uniform1i, "glUniform1i") \
+	F(PFNGLUNIFORM3FPROC, uniform3f, "glUniform3f") \
+	F(PFNGLUNIFORM4FVPROC, uniform4fv, "glUniform4fv") \
+	F(PFNGLUNIFORMMATRIX4FVPROC, uniformMatrix4fv, "glUniformMatrix4fv") \
+	F(PFNGLUSEPROGRAMPROC, useProgram, "glUseProgram") \
+	F(PFNGLVERTEXATTRIBDIVISORPROC, vertexAttribDivisor, "glVertexAttribDivisor") \
+	F(PFNGLVERTEXATTRIBPOINTERPROC, vertexAttribPointer, "glVertexAttribPointer")
+
+#define OPENGL_DECLARE_FUNCTION(type, member, name) type member;
+
+	struct GLFunctions
+	{
+		OPENGL_FUNCTIONS(OPENGL_DECLARE_FUNCTION)
+	};
+
+#undef OPENGL_DECLARE_FUNCTION
+
+	GLFunctions gl;
+
+	// Loads every function pointer, returning false if any of them are missing.
+	bool loadGLFunctions()
+	{
+		bool success = true;
+
+#define OPENGL_LOAD_FUNCTION(type, member, name) \
+		gl.member = reinterpret_cast<type>(SDL_GL_GetProcAddress(name)); \
+		success &= gl.member != nullptr;
+
+		OPENGL_FUNCTIONS(OPENGL_LOAD_FUNCTION)
+
+#undef OPENGL_LOAD_FUNCTION
+
+		return success;
+	}
+
+#undef OPENGL_FUNCTIONS
+
+	// Shading shared by voxels and flats. It's the same as the software renderer's,
+	// except that fog isn't rounded to a table entry.
+	const char *ShadingSource = R"(
+		uniform vec3 eye;
+		uniform vec3 fogColor;
+		uniform float fogDistance;
+		uniform vec3 sunDirection;
+		uniform vec3 sunColor;
+		uniform float ambient;
+
+		vec3 getShading(vec3 normal)
+		{
+			float lightNormalDot = max(0.0, dot(sunDirection, normal));
+			vec3 sunComponent = clamp(sunColor * lightNormalDot, 0.0, 1.0 - ambient);
+			return vec3(ambient) + sunComponent;
+		}
+
+		vec4 getFinalColor(vec3 color, vec3 shading, float emission, vec3 point)
+		{
+			// Fog depends on the distance in the XZ plane, like ray casted columns.
+			float depth = distance(point.xz, eye.xz);
+			float fogPercent = (fogDistance > 0.0) ? min(depth / fogDistance, 1.0) : 1.0;
+			vec3 shaded = color * min(shading + vec3(emission), vec3(1.0));
+			return vec4(min(mix(shaded, fogColor, fogPercent), vec3(1.0)), 1.0);
+		}
+	)";
+
+	const char *VoxelVertexSource = R"(
+		layout(location = 0) in vec3 position;
+		layout(location = 1) in vec3 texCoord;
+		layout(location = 2) in vec3 normal;
+		layout(location = 3) in float transparent;
+
+		uniform mat4 transform;
+
+		out vec3 fragPosition;
+		out vec3 fragTexCoord;
+		out vec3 fragNormal;
+		flat out float fragTransparent;
+
+		void main()
+		{
+			fragPosition = position;
+			fragTexCoord = texCoord;
+			fragNormal = normal;
+			fragTransparent = transparent;
+			gl_Position = transform * vec4(position, 1.0);
+		}
+	)";
+
+	// Transparent values are 1 for faces seen from both sides, and 2 for faces only seen
+	// from the front (i.e., transparent walls).
+	const char *VoxelFragmentSource = R"(
+		in vec3 fragPosition;
+		in vec3 fragTexCoord;
+		in vec3 fragNormal;
+		flat in float fragTransparent;
+
+		uniform sampler2DArray textures;
+		uniform sampler2DArray lightTextures;
+		uniform bool nightLightsActive;
+		uniform vec3 nightLightColor;
+		uniform int lightCount;
+		uniform vec4 lights[MAX_LIGHTS]; // Point XZ, radius, and brightness.
+
+		out vec4 outColor;
+
+		void main()
+		{
+			if ((fragTransparent > 1.5) && !gl_FrontFacing)
+			{
+				discard;
+			}
+
+			vec4 texel = texture(textures, fragTexCoord);
+			if ((fragTransparent > 0.5) && (texel.a < 0.5))
+			{
+				discard;
+			}
+
+			vec3 color = texel.rgb;
+			float emission = 0.0;
+
+			// Night light texels are stored black, and the light color is added by how
+			// much of the texel they cover.
+			if (nightLightsActive)
+			{
+				float light = texture(lightTextures, fragTexCoord).r;
+				color = min(color + (nightLightColor * light), vec3(1.0));
+				emission = light;
+			}
+
+			float lightLevel = 0.0;
+			for (int i = 0; i < lightCount; i++)
+			{
+				float dist = distance(fragPosition.xz, lights[i].xy);
+				if (dist < lights[i].z)
+				{
+					lightLevel += lights[i].w * (1.0 - (dist / lights[i].z));
+				}
+			}
+
+			emission = min(emission + min(lightLevel, 1.0), 1.0);
+
+			vec3 normal = gl_FrontFacing ? fragNormal : -fragNormal;
+			outColor = getFinalColor(color, getShading(normal), emission, fragPosition);
+		}
+	)";
+
+	// Flats are quads made from a corner (0 to 1 on each axis) and the flat's values.
+	const char *FlatVertexSource = R"(
+		layout(location = 0) in vec2 corner;
+		layout(location = 1) in vec4 flatPosition; // Bottom center and flipped.
+		layout(location = 2) in vec2 flatSize;
+
+		uniform mat4 transform;
+		uniform vec3 flatRight;
+
+		out vec3 fragPosition;
+		out vec2 fragTexCoord;
+
+		void main()
+		{
+			vec3 position = flatPosition.xyz +
+				(flatRight * (flatSize.x * 0.50 * (1.0 - (2.0 * corner.x)))) +
+				vec3(0.0, flatSize.y * corner.y, 0.0);
+			float u = (flatPosition.w > 0.5) ? (1.0 - corner.x) : corner.x;
+
+			fragPosition = position;
+			fragTexCoord = vec2(u, 1.0 - corner.y);
+			gl_Position = transform * vec4(position, 1.0);
+		}
+	)";
+
+	const char *FlatFragmentSource = R"(
+		in vec3 fragPosition;
+		in vec2 fragTexCoord;
+
+		uniform sampler2D flatTexture;
+		uniform vec3 flatNormal;
+
+		out vec4 outColor;
+
+		void main()
+		{
+			vec4 texel = texture(flatTexture, fragTexCoord);
+			if (texel.a < 0.5)
+			{
+				discard;
+			}
+
+			// Flats don't have emission.
+			outColor = getFinalColor(texel.rgb, getShading(flatNormal), 0.0, fragPosition);
+		}
+	)";
+
+	// Compiles a shader from the given source parts. Returns 0 on failure.
+	GLuint compileShader(GLenum type, const std::vector<const char*> &sources)
+	{
+		const GLuint shader = gl.createShader(type);
+		gl.shaderSource(shader, static_cast<GLsizei>(sources.size()), sources.data(), nullptr);
+		gl.compileShader(shader);
+
+		GLint status;
+		gl.getShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (status != GL_TRUE)
+		{
+			GLint logLength;
+			gl.getShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+			std::string log(std::max(logLength, 1), '\0');
+			gl.getShaderInfoLog(shader, logLength, nullptr, &log.front());
+			DebugWarning("Couldn't compile shader, " + log);
+
+			gl.deleteShader(shader);
+			return 0;
+		}
+
+		return shader;
+	}
+
+	// Links a program from vertex and fragment source. Returns 0 on failure.
+	GLuint linkProgram(const char *header, const char *vertexSource,
+		const char *fragmentSource)
+	{
+		const GLuint vertexShader = compileShader(GL_VERTEX_SHADER, { header, vertexSource });
+		const GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER,
+			{ header, ShadingSource, fragmentSource });
+
+		if ((vertexShader == 0) || (fragmentShader == 0))
+		{
+			gl.deleteShader(vertexShader);
+			gl.deleteShader(fragmentShader);
+			return 0;
+		}
+
+		const GLuint program = gl.createProgram();
+		gl.attachShader(program, vertexShader);
+		gl.attachShader(program, fragmentShader);
+		gl.linkProgram(program);
+
+		// The shaders are freed with the program.
+		gl.deleteShader(vertexShader);
+		gl.deleteShader(fragmentShader);
+
+		GLint status;
+		gl.getProgramiv(program, GL_LINK_STATUS, &status);
+		if (status != GL_TRUE)
+		{
+			GLint logLength;
+			gl.getProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+			std::string log(std::max(logLength, 1), '\0');
+			gl.getProgramInfoLog(program, logLength, nullptr, &log.front());
+			DebugWarning("Couldn't link shader program, " + log);
+
+			gl.deleteProgram(program);
+			return 0;
+		}
+
+		return program;
+	}
+
+	// Converts a matrix to the column-major floats GL expects.
+	std::array<GLfloat, 16> toGLMatrix(const Matrix4d &m)
+	{
+		return std::array<GLfloat, 16>
+		{
+			static_cast<GLfloat>(m.x.x), static_cast<GLfloat>(m.x.y),
+			static_cast<GLfloat>(m.x.z), static_cast<GLfloat>(m.x.w),
+			static_cast<GLfloat>(m.y.x), static_cast<GLfloat>(m.y.y),
+			static_cast<GLfloat>(m.y.z), static_cast<GLfloat>(m.y.w),
+			static_cast<GLfloat>(m.z.x), static_cast<GLfloat>(m.z.y),
+			static_cast<GLfloat>(m.z.z), static_cast<GLfloat>(m.z.w),
+			static_cast<GLfloat>(m.w.x), static_cast<GLfloat>(m.w.y),
+			static_cast<GLfloat>(m.w.z), static_cast<GLfloat>(m.w.w)
+		};
+	}
+
+	void setUniform(GLuint program, const char *name, const Double3 &value)
+	{
+		gl.uniform3f(gl.getUniformLocation(program, name), static_cast<GLfloat>(value.x),
+			static_cast<GLfloat>(value.y), static_cast<GLfloat>(value.z));
+	}
+
+	void setUniform(GLuint program, const char *name, double value)
+	{
+		gl.uniform1f(gl.getUniformLocation(program, name), static_cast<GLfloat>(value));
+	}
+
+	void setUniform(GLuint program, const char *name, int value)
+	{
+		gl.uniform1i(gl.getUniformLocation(program, name), value);
+	}
+
+	void setUniform(GLuint program, const char *name, const std::array<GLfloat, 16> &matrix)
+	{
+		gl.uniformMatrix4fv(gl.getUniformLocation(program, name), 1, GL_FALSE, matrix.data());
+	}
+
+	// Makes the renderer's context current for the lifetime of the object, and puts the
+	// previous one back afterwards (i.e., the SDL renderer's).
+	class ContextBinding
+	{
+	private:
+		SDL_Window *previousWindow;
+		SDL_GLContext previousContext;
+	public:
+		ContextBinding(SDL_Window *window, SDL_GLContext context)
+		{
+			this->previousWindow = SDL_GL_GetCurrentWindow();
+			this->previousContext = SDL_GL_GetCurrentContext();
+			SDL_GL_MakeCurrent(window, context);
+		}
+
+		~ContextBinding()
+		{
+			if (this->previousContext != nullptr)
+			{
+				SDL_GL_MakeCurrent(this->previousWindow, this->previousContext);
+			}
+		}
+	};
+}
+
+OpenGLRenderer::FlatTexture::FlatTexture()
+{
+	this->id = 0;
+	this->width = 0;
+	this->height = 0;
+}
+
+OpenGLRenderer::Chunk::Chunk()
+{
+	this->vertexArray = 0;
+	this->vertexBuffer = 0;
+	this->vertexCount = 0;
+	this->revision = -1;
+}
+
+const int OpenGLRenderer::VOXEL_TEXTURE_COUNT = 64;
+const int OpenGLRenderer::VOXEL_TEXTURE_WIDTH = 64;
+const int OpenGLRenderer::VOXEL_TEXTURE_HEIGHT = OpenGLRenderer::VOXEL_TEXTURE_WIDTH;
+const int OpenGLRenderer::MAX_LIGHTS = 32;
+const uint32_t OpenGLRenderer::NIGHT_LIGHT_COLOR = 0xFFA600;
+const double OpenGLRenderer::NEAR_PLANE = 0.01;
+const double OpenGLRenderer::FAR_PLANE = 1000.0;
+
+OpenGLRenderer::OpenGLRenderer(int width, int height)
+{
+	this->window = nullptr;
+	this->context = nullptr;
+	this->frameBuffer = 0;
+	this->colorBuffer = 0;
+	this->depthBuffer = 0;
+	this->voxelProgram = 0;
+	this->flatProgram = 0;
+	this->voxelTextureArray = 0;
+	this->lightTextureArray = 0;
+	this->flatVertexArray = 0;
+	this->flatCornerBuffer = 0;
+	this->flatInstanceBuffer = 0;
+	this->meshedGridID = -1;
+	this->meshedRevision = -1;
+	this->meshedCeilingHeight = 0.0;
+	this->fogDistance = 0.0;
+	this->width = width;
+	this->height = height;
+	this->chunkCountX = 0;
+	this->chunkCountZ = 0;
+	this->functionsLoaded = false;
+	this->nightLightsActive = false;
+	this->forceBaseMipLevel = false;
+	this->baseMipLevelApplied = false;
+}
+
+OpenGLRenderer::~OpenGLRenderer()
+{
+	if (this->context != nullptr)
+	{
+		// Nothing was made with GL if its functions couldn't be loaded.
+		if (this->functionsLoaded)
+		{
+			ContextBinding binding(this->window, this->context);
+			this->destroyChunks();
+			this->destroyFrameBuffer();
+			this->clearTextures();
+
+			const GLuint textures[] = { this->voxelTextureArray, this->lightTextureArray };
+			gl.deleteTextures(2, textures);
+
+			const GLuint buffers[] = { this->flatCornerBuffer, this->flatInstanceBuffer };
+			gl.deleteBuffers(2, buffers);
+			gl.deleteVertexArrays(1, &this->flatVertexArray);
+			gl.deleteProgram(this->voxelProgram);
+			gl.deleteProgram(this->flatProgram);
+		}
+
+		SDL_GL_DeleteContext(this->context);
+	}
+
+	if (this->window != nullptr)
+	{
+		SDL_DestroyWindow(this->window);
+	}
+}
+
+bool OpenGLRenderer::init()
+{
+	// The context needs a window, but nothing is ever shown in it.
+	this->window = SDL_CreateWindow("OpenTESArena OpenGL", 0, 0, 1, 1,
+		SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	if (this->window == nullptr)
+	{
+		DebugWarning("Couldn't create OpenGL window, " + std::string(SDL_GetError()));
+		return false;
+	}
+
+	// Ask for a 3.3 core context, then put the attributes back so nothing else made
+	// later gets them.
+	SDL_Window *previousWindow = SDL_GL_GetCurrentWindow();
+	SDL_GLContext previousContext = SDL_GL_GetCurrentContext();
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	this->context = SDL_GL_CreateContext(this->window);
+	SDL_GL_ResetAttributes();
+
+	if (this->context == nullptr)
+	{
+		DebugWarning("Couldn't create OpenGL 3.3 context, " + std::string(SDL_GetError()));
+		return false;
+	}
+
+	// Creating the context made it current.
+	if (previousContext != nullptr)
+	{
+		SDL_GL_MakeCurrent(previousWindow, previousContext);
+	}
+
+	ContextBinding binding(this->window, this->context);
+
+	if (!loadGLFunctions())
+	{
+		DebugWarning("Couldn't load OpenGL functions.");
+		return false;
+	}
+
+	this->functionsLoaded = true;
+
+	// Constants are given to the shaders in a header.
+	const std::string header = "#version 330 core\n#define MAX_LIGHTS " +
+		std::to_string(OpenGLRenderer::MAX_LIGHTS) + "\n";
+	this->voxelProgram = linkProgram(header.c_str(), VoxelVertexSource, VoxelFragmentSource);
+	this->flatProgram = linkProgram(header.c_str(), FlatVertexSource, FlatFragmentSource);
+	if ((this->voxelProgram == 0) || (this->flatProgram == 0))
+	{
+		return false;
+	}
+
+	gl.useProgram(this->voxelProgram);
+	setUniform(this->voxelProgram, "textures", 0);
+	setUniform(this->voxelProgram, "lightTextures", 1);
+	gl.useProgram(this->flatProgram);
+	setUniform(this->flatProgram, "flatTexture", 0);
+	gl.useProgram(0);
+
+	// Voxel colors and night light coverage, one layer for each texture ID. Every mip
+	// level is allocated up front.
+	auto makeTextureArray = [](GLint internalFormat, GLenum format, GLenum type)
+	{
+		GLuint texture;
+		gl.genTextures(1, &texture);
+		gl.bindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+		int mipWidth = OpenGLRenderer::VOXEL_TEXTURE_WIDTH;
+		int mipHeight = OpenGLRenderer::VOXEL_TEXTURE_HEIGHT;
+		int level = 0;
+		while ((mipWidth > 0) && (mipHeight > 0))
+		{
+			gl.texImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, mipWidth, mipHeight,
+				OpenGLRenderer::VOXEL_TEXTURE_COUNT, 0, format, type, nullptr);
+			mipWidth /= 2;
+			mipHeight /= 2;
+			level++;
+		}
+
+		gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, level - 1);
+		return texture;
+	};
+
+	this->voxelTextureArray = makeTextureArray(GL_RGBA8, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV);
+	this->lightTextureArray = makeTextureArray(GL_R8, GL_RED, GL_UNSIGNED_BYTE);
+	this->baseMipLevelApplied = false;
+
+	// Flat quads are a triangle strip of four corners, and each instance is one flat.
+	gl.genVertexArrays(1, &this->flatVertexArray);
+	gl.bindVertexArray(this->flatVertexArray);
+
+	const GLfloat corners[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+	gl.genBuffers(1, &this->flatCornerBuffer);
+	gl.bindBuffer(GL_ARRAY_BUFFER, this->flatCornerBuffer);
+	gl.bufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	gl.vertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+	gl.enableVertexAttribArray(0);
+
+	// Instance attribute pointers are set for each texture's run of flats when drawing.
+	gl.genBuffers(1, &this->flatInstanceBuffer);
+	gl.enableVertexAttribArray(1);
+	gl.enableVertexAttribArray(2);
+	gl.vertexAttribDivisor(1, 1);
+	gl.vertexAttribDivisor(2, 1);
+	gl.bindVertexArray(0);
+
+	this->createFrameBuffer();
+	return gl.checkFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void OpenGLRenderer::createFrameBuffer()
+{
+	gl.genRenderbuffers(1, &this->colorBuffer);
+	gl.bindRenderbuffer(GL_RENDERBUFFER, this->colorBuffer);
+	gl.renderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, this->width, this->height);
+
+	gl.genRenderbuffers(1, &this->depthBuffer);
+	gl.bindRenderbuffer(GL_RENDERBUFFER, this->depthBuffer);
+	gl.renderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, this->width, this->height);
+
+	gl.genFramebuffers(1, &this->frameBuffer);
+	gl.bindFramebuffer(GL_FRAMEBUFFER, this->frameBuffer);
+	gl.framebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+		this->colorBuffer);
+	gl.framebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+		this->depthBuffer);
+}
+
+void OpenGLRenderer::destroyFrameBuffer()
+{
+	gl.bindFramebuffer(GL_FRAMEBUFFER, 0);
+	gl.deleteFramebuffers(1, &this->frameBuffer);
+
+	const GLuint renderBuffers[] = { this->colorBuffer, this->depthBuffer };
+	gl.deleteRenderbuffers(2, renderBuffers);
+
+	this->frameBuffer = 0;
+	this->colorBuffer = 0;
+	this->depthBuffer = 0;
+}
+
+void OpenGLRenderer::addFlat(int id, const Double3 &position, double width,
+	double height, int textureID)
+{
+	// Verify that the ID is not already in use.
+	DebugAssert(this->flats.find(id) == this->flats.end(),
+		"Flat ID \"" + std::to_string(id) + "\" already taken.");
+
+	OpenGLRenderer::Flat flat;
+	flat.position = position;
+	flat.width = width;
+	flat.height = height;
+	flat.textureID = textureID;
+	flat.flipped = false;
+
+	this->flats.insert(std::make_pair(id, flat));
+}
+
+void OpenGLRenderer::addLight(int id, const Double3 &point, const Double3 &color,
+	double intensity)
+{
+	// Verify that the ID is not already in use.
+	DebugAssert(this->lights.find(id) == this->lights.end(),
+		"Light ID \"" + std::to_string(id) + "\" already taken.");
+
+	OpenGLRenderer::Light light;
+	light.point = point;
+	light.color = color;
+	light.intensity = intensity;
+
+	this->lights.insert(std::make_pair(id, light));
+}
+
+bool OpenGLRenderer::updateFlat(int id, const Double3 *position, const double *width,
+	const double *height, const int *textureID, const bool *flipped)
+{
+	auto flatIter = this->flats.find(id);
+	DebugAssert(flatIter != this->flats.end(),
+		"Cannot update a non-existent flat (" + std::to_string(id) + ").");
+
+	OpenGLRenderer::Flat &flat = flatIter->second;
+	bool changed = false;
+
+	if ((position != nullptr) && (*position != flat.position))
+	{
+		flat.position = *position;
+		changed = true;
+	}
+
+	if ((width != nullptr) && (*width != flat.width))
+	{
+		flat.width = *width;
+		changed = true;
+	}
+
+	if ((height != nullptr) && (*height != flat.height))
+	{
+		flat.height = *height;
+		changed = true;
+	}
+
+	if ((textureID != nullptr) && (*textureID != flat.textureID))
+	{
+		flat.textureID = *textureID;
+		changed = true;
+	}
+
+	if ((flipped != nullptr) && (*flipped != flat.flipped))
+	{
+		flat.flipped = *flipped;
+		changed = true;
+	}
+
+	return changed;
+}
+
+void OpenGLRenderer::updateLight(int id, const Double3 *point,
+	const Double3 *color, const double *intensity)
+{
+	auto lightIter = this->lights.find(id);
+	DebugAssert(lightIter != this->lights.end(),
+		"Cannot update a non-existent light (" + std::to_string(id) + ").");
+
+	OpenGLRenderer::Light &light = lightIter->second;
+
+	if (point != nullptr)
+	{
+		light.point = *point;
+	}
+
+	if (color != nullptr)
+	{
+		light.color = *color;
+	}
+
+	if (intensity != nullptr)
+	{
+		light.intensity = *intensity;
+	}
+}
+
+void OpenGLRenderer::setFogDistance(double fogDistance)
+{
+	this->fogDistance = fogDistance;
+}
+
+void OpenGLRenderer::setVoxelTexture(int id, const uint32_t *srcTexels)
+{
+	DebugAssert((id >= 0) && (id < OpenGLRenderer::VOXEL_TEXTURE_COUNT),
+		"Invalid voxel texture ID \"" + std::to_string(id) + "\".");
+
+	const int texelCount = OpenGLRenderer::VOXEL_TEXTURE_WIDTH *
+		OpenGLRenderer::VOXEL_TEXTURE_HEIGHT;
+	std::vector<uint32_t> colors(srcTexels, srcTexels + texelCount);
+	std::vector<uint8_t> lightTexels(texelCount, 0);
+
+	// White texels are used with night lights, the same as the software renderer. They're
+	// stored black, and the shader lights them at night.
+	for (int i = 0; i < texelCount; i++)
+	{
+		if ((colors[i] & 0xFFFFFF) == 0xFFFFFF)
+		{
+			colors[i] &= 0xFF000000;
+			lightTexels[i] = 255;
+		}
+	}
+
+	ContextBinding binding(this->window, this->context);
+
+	gl.pixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	gl.bindTexture(GL_TEXTURE_2D_ARRAY, this->voxelTextureArray);
+	gl.texSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, id, OpenGLRenderer::VOXEL_TEXTURE_WIDTH,
+		OpenGLRenderer::VOXEL_TEXTURE_HEIGHT, 1, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+		colors.data());
+	gl.generateMipmap(GL_TEXTURE_2D_ARRAY);
+
+	gl.bindTexture(GL_TEXTURE_2D_ARRAY, this->lightTextureArray);
+	gl.texSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, id, OpenGLRenderer::VOXEL_TEXTURE_WIDTH,
+		OpenGLRenderer::VOXEL_TEXTURE_HEIGHT, 1, GL_RED, GL_UNSIGNED_BYTE, lightTexels.data());
+	gl.generateMipmap(GL_TEXTURE_2D_ARRAY);
+}
+
+void OpenGLRenderer::setFlatTexture(int id, const uint32_t *srcTexels, int width, int height)
+{
+	DebugAssert(id >= 0, "Invalid flat texture ID \"" + std::to_string(id) + "\".");
+
+	if (id >= static_cast<int>(this->flatTextures.size()))
+	{
+		this->flatTextures.resize(id + 1);
+	}
+
+	FlatTexture &texture = this->flatTextures[id];
+
+	ContextBinding binding(this->window, this->context);
+
+	if (texture.id == 0)
+	{
+		gl.genTextures(1, &texture.id);
+	}
+
+	texture.width = width;
+	texture.height = height;
+
+	gl.pixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	gl.bindTexture(GL_TEXTURE_2D, texture.id);
+	gl.texImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_BGRA,
+		GL_UNSIGNED_INT_8_8_8_8_REV, srcTexels);
+	gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void OpenGLRenderer::setSkyPalette(const uint32_t *colors, int count)
+{
+	this->skyPalette = std::vector<Double3>(count);
+
+	for (size_t i = 0; i < this->skyPalette.size(); i++)
+	{
+		this->skyPalette[i] = Double3::fromRGB(colors[i]);
+	}
+}
+
+void OpenGLRenderer::setNightLightsActive(bool active)
+{
+	this->nightLightsActive = active;
+}
+
+void OpenGLRenderer::setForceBaseMipLevel(bool forceBaseMipLevel)
+{
+	this->forceBaseMipLevel = forceBaseMipLevel;
+}
+
+void OpenGLRenderer::removeFlat(int id)
+{
+	auto flatIter = this->flats.find(id);
+	DebugAssert(flatIter != this->flats.end(),
+		"Cannot remove a non-existent flat (" + std::to_string(id) + ").");
+
+	this->flats.erase(flatIter);
+}
+
+void OpenGLRenderer::removeFlatTexture(int id)
+{
+	if ((id < 0) || (id >= static_cast<int>(this->flatTextures.size())))
+	{
+		return;
+	}
+
+	FlatTexture &texture = this->flatTextures[id];
+	if (texture.id != 0)
+	{
+		ContextBinding binding(this->window, this->context);
+		gl.deleteTextures(1, &texture.id);
+	}
+
+	texture = FlatTexture();
+}
+
+void OpenGLRenderer::removeLight(int id)
+{
+	auto lightIter = this->lights.find(id);
+	DebugAssert(lightIter != this->lights.end(),
+		"Cannot remove a non-existent light (" + std::to_string(id) + ").");
+
+	this->lights.erase(lightIter);
+}
+
+void OpenGLRenderer::clearTextures()
+{
+	ContextBinding binding(this->window, this->context);
+
+	for (auto &texture : this->flatTextures)
+	{
+		if (texture.id != 0)
+		{
+			gl.deleteTextures(1, &texture.id);
+		}
+
+		texture = FlatTexture();
+	}
+
+	this->flatTextures.clear();
+	this->clearVoxelMeshes();
+}
+
+void OpenGLRenderer::clearVoxelMeshes()
+{
+	// The chunks are made again even if the next grid is the same one.
+	this->meshedGridID = -1;
+}
+
+void OpenGLRenderer::resize(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+
+	ContextBinding binding(this->window, this->context);
+	this->destroyFrameBuffer();
+	this->createFrameBuffer();
+}
+
+void OpenGLRenderer::addVoxelFaces(int voxelX, int voxelY, int voxelZ,
+	const VoxelData &voxelData, double ceilingHeight, std::vector<VoxelVertex> &vertices) const
+{
+	const double voxelXReal = static_cast<double>(voxelX);
+	const double voxelYReal = static_cast<double>(voxelY);
+	const double voxelZReal = static_cast<double>(voxelZ);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	auto addVertex = [&vertices](const Double3 &point, double u, double v, int textureID,
+		const Double3 &normal, double transparent)
+	{
+		VoxelVertex vertex;
+		vertex.x = static_cast<float>(point.x);
+		vertex.y = static_cast<float>(point.y);
+		vertex.z = static_cast<float>(point.z);
+		vertex.u = static_cast<float>(u);
+		vertex.v = static_cast<float>(v);
+		vertex.layer = static_cast<float>(textureID);
+		vertex.normalX = static_cast<float>(normal.x);
+		vertex.normalY = static_cast<float>(normal.y);
+		vertex.normalZ = static_cast<float>(normal.z);
+		vertex.transparent = static_cast<float>(transparent);
+		vertices.push_back(vertex);
+	};
+
+	// Adds a vertical face from the start to the end point in the XZ plane, where the
+	// horizontal texture coordinate goes from 0 to 1. Its front side is the one with the
+	// start point on the left, and the normal points that way.
+	auto addSide = [&addVertex](const Double2 &start, const Double2 &end, double yBottom,
+		double yTop, double vTop, double vBottom, int textureID, double transparent)
+	{
+		const Double3 normal = Double3(-(end.y - start.y), 0.0, end.x - start.x).normalized();
+		const Double3 startBottom(start.x, yBottom, start.y);
+		const Double3 endBottom(end.x, yBottom, end.y);
+		const Double3 endTop(end.x, yTop, end.y);
+		const Double3 startTop(start.x, yTop, start.y);
+
+		addVertex(startBottom, 0.0, vBottom, textureID, normal, transparent);
+		addVertex(endBottom, 1.0, vBottom, textureID, normal, transparent);
+		addVertex(endTop, 1.0, vTop, textureID, normal, transparent);
+		addVertex(startBottom, 0.0, vBottom, textureID, normal, transparent);
+		addVertex(endTop, 1.0, vTop, textureID, normal, transparent);
+		addVertex(startTop, 0.0, vTop, textureID, normal, transparent);
+	};
+
+	// Adds the side of the voxel with the given facing. The texture goes left to right
+	// when seen from outside, like a ray casted wall, or from inside if it's reversed (i.e.,
+	// for chasms).
+	auto addFacingSide = [voxelXReal, voxelZReal, &addSide](VoxelData::Facing facing,
+		double yBottom, double yTop, double vTop, double vBottom, int textureID,
+		double transparent, bool reversed)
+	{
+		Double2 start, end;
+		if (facing == VoxelData::Facing::PositiveX)
+		{
+			start = Double2(voxelXReal + 1.0, voxelZReal + 1.0);
+			end = Double2(voxelXReal + 1.0, voxelZReal);
+		}
+		else if (facing == VoxelData::Facing::NegativeX)
+		{
+			start = Double2(voxelXReal, voxelZReal);
+			end = Double2(voxelXReal, voxelZReal + 1.0);
+		}
+		else if (facing == VoxelData::Facing::PositiveZ)
+		{
+			start = Double2(voxelXReal, voxelZReal + 1.0);
+			end = Double2(voxelXReal + 1.0, voxelZReal + 1.0);
+		}
+		else
+		{
+			start = Double2(voxelXReal + 1.0, voxelZReal);
+			end = Double2(voxelXReal, voxelZReal);
+		}
+
+		if (reversed)
+		{
+			std::swap(start, end);
+		}
+
+		addSide(start, end, yBottom, yTop, vTop, vBottom, textureID, transparent);
+	};
+
+	const std::array<VoxelData::Facing, 4> facings =
+	{
+		VoxelData::Facing::PositiveX,
+		VoxelData::Facing::NegativeX,
+		VoxelData::Facing::PositiveZ,
+		VoxelData::Facing::NegativeZ
+	};
+
+	auto addSides = [&facings, &addFacingSide](double yBottom, double yTop, double vTop,
+		double vBottom, int textureID, double transparent)
+	{
+		for (const VoxelData::Facing facing : facings)
+		{
+			addFacingSide(facing, yBottom, yTop, vTop, vBottom, textureID, transparent, false);
+		}
+	};
+
+	// Adds a horizontal face at the given height. Texture coordinates are the same as the
+	// software renderer's perspective-correct floors and ceilings.
+	auto addHorizontal = [voxelXReal, voxelZReal, &addVertex](double y, int textureID,
+		bool facingUp)
+	{
+		const Double3 normal = facingUp ? Double3::UnitY : -Double3::UnitY;
+		const Double3 p0(voxelXReal, y, voxelZReal);
+		const Double3 p1(voxelXReal, y, voxelZReal + 1.0);
+		const Double3 p2(voxelXReal + 1.0, y, voxelZReal + 1.0);
+		const Double3 p3(voxelXReal + 1.0, y, voxelZReal);
+
+		// Counter-clockwise when seen from the side the normal points to.
+		const std::array<const Double3*, 6> points = facingUp ?
+			std::array<const Double3*, 6> { &p0, &p1, &p2, &p0, &p2, &p3 } :
+			std::array<const Double3*, 6> { &p0, &p2, &p1, &p0, &p3, &p2 };
+
+		for (const Double3 *point : points)
+		{
+			const double u = 1.0 - (point->x - voxelXReal);
+			const double v = 1.0 - (point->z - voxelZReal);
+			addVertex(*point, u, v, textureID, normal, 0.0);
+		}
+	};
+
+	const VoxelDataType dataType = voxelData.dataType;
+	if (dataType == VoxelDataType::Wall)
+	{
+		const VoxelData::WallData &wallData = voxelData.wall;
+		addSides(voxelYReal, voxelYReal + voxelHeight, 0.0, 1.0, wallData.sideID, 0.0);
+		addHorizontal(voxelYReal + voxelHeight, wallData.ceilingID, true);
+		addHorizontal(voxelYReal, wallData.floorID, false);
+	}
+	else if (dataType == VoxelDataType::Floor)
+	{
+		// Floors only have their top rendered.
+		addHorizontal(voxelYReal + voxelHeight, voxelData.floor.id, true);
+	}
+	else if (dataType == VoxelDataType::Ceiling)
+	{
+		// Ceilings only have their bottom rendered, which is always at the ceiling height.
+		addHorizontal(1.0 + ceilingHeight, voxelData.ceiling.id, false);
+	}
+	else if (dataType == VoxelDataType::Raised)
+	{
+		const VoxelData::RaisedData &raisedData = voxelData.raised;
+		const double yBottom = voxelYReal + (raisedData.yOffset * voxelHeight);
+		const double yTop = voxelYReal +
+			((raisedData.yOffset + raisedData.ySize) * voxelHeight);
+		addSides(yBottom, yTop, raisedData.vTop, raisedData.vBottom, raisedData.sideID, 1.0);
+		addHorizontal(yTop, raisedData.ceilingID, true);
+		addHorizontal(yBottom, raisedData.floorID, false);
+	}
+	else if (dataType == VoxelDataType::Diagonal)
+	{
+		const VoxelData::DiagonalData &diagData = voxelData.diagonal;
+		const Double2 start = diagData.type1 ? Double2(voxelXReal, voxelZReal) :
+			Double2(voxelXReal + 1.0, voxelZReal);
+		const Double2 end = diagData.type1 ? Double2(voxelXReal + 1.0, voxelZReal + 1.0) :
+			Double2(voxelXReal, voxelZReal + 1.0);
+		addSide(start, end, voxelYReal, voxelYReal + voxelHeight, 0.0, 1.0, diagData.id, 0.0);
+	}
+	else if (dataType == VoxelDataType::TransparentWall)
+	{
+		// Only front-facing, so nothing is drawn from inside the voxel.
+		addSides(voxelYReal, voxelYReal + voxelHeight, 0.0, 1.0,
+			voxelData.transparentWall.id, 2.0);
+	}
+	else if (dataType == VoxelDataType::Edge)
+	{
+		const VoxelData::EdgeData &edgeData = voxelData.edge;
+		addFacingSide(edgeData.facing, voxelYReal + edgeData.yOffset,
+			voxelYReal + voxelHeight + edgeData.yOffset, 0.0, 1.0, edgeData.id, 1.0, false);
+	}
+	else if (dataType == VoxelDataType::Chasm)
+	{
+		// Chasm walls are usually seen from inside.
+		const VoxelData::ChasmData &chasmData = voxelData.chasm;
+		for (const VoxelData::Facing facing : facings)
+		{
+			if (chasmData.faceIsVisible(facing))
+			{
+				addFacingSide(facing, voxelYReal, voxelYReal + voxelHeight, 0.0, 1.0,
+					chasmData.id, 1.0, true);
+			}
+		}
+	}
+	else if (dataType == VoxelDataType::Door)
+	{
+		// Just render as transparent wall for now, like the software renderer.
+		addSides(voxelYReal, voxelYReal + voxelHeight, 0.0, 1.0, voxelData.door.id, 2.0);
+	}
+}
+
+void OpenGLRenderer::updateChunks(const VoxelGrid &voxelGrid, double ceilingHeight)
+{
+	const int gridWidth = voxelGrid.getWidth();
+	const int gridHeight = voxelGrid.getHeight();
+	const int gridDepth = voxelGrid.getDepth();
+	const int chunkCountX = voxelGrid.getChunkCountX();
+	const int chunkCountZ = voxelGrid.getChunkCountZ();
+
+	// A different grid or ceiling height changes every chunk. Grid IDs are shared by
+	// snapshots, and a grid's voxel data is only ever added to, so otherwise only chunks
+	// with a newer revision have changed.
+	const bool remakeAll = (voxelGrid.getID() != this->meshedGridID) ||
+		(ceilingHeight != this->meshedCeilingHeight) ||
+		(chunkCountX != this->chunkCountX) || (chunkCountZ != this->chunkCountZ);
+
+	if (!remakeAll && (voxelGrid.getRevision() == this->meshedRevision))
+	{
+		return;
+	}
+
+	if (remakeAll)
+	{
+		this->destroyChunks();
+		this->chunks = std::vector<Chunk>(chunkCountX * chunkCountZ);
+		this->chunkCountX = chunkCountX;
+		this->chunkCountZ = chunkCountZ;
+		this->meshedGridID = voxelGrid.getID();
+		this->meshedCeilingHeight = ceilingHeight;
+	}
+
+	this->meshedRevision = voxelGrid.getRevision();
+
+	std::vector<VoxelVertex> vertices;
+	for (int chunkZ = 0; chunkZ < chunkCountZ; chunkZ++)
+	{
+		for (int chunkX = 0; chunkX < chunkCountX; chunkX++)
+		{
+			Chunk &chunk = this->chunks[chunkX + (chunkZ * chunkCountX)];
+			const int chunkRevision = voxelGrid.getChunkRevision(chunkX, chunkZ);
+			if (chunkRevision == chunk.revision)
+			{
+				continue;
+			}
+
+			chunk.revision = chunkRevision;
+
+			const int startX = chunkX * VoxelGrid::CHUNK_SIZE;
+			const int startZ = chunkZ * VoxelGrid::CHUNK_SIZE;
+			const int endX = std::min(startX + VoxelGrid::CHUNK_SIZE, gridWidth);
+			const int endZ = std::min(startZ + VoxelGrid::CHUNK_SIZE, gridDepth);
+
+			vertices.clear();
+			for (int z = startZ; z < endZ; z++)
+			{
+				for (int y = 0; y < gridHeight; y++)
+				{
+					for (int x = startX; x < endX; x++)
+					{
+						const uint16_t voxelID = voxelGrid.getVoxel(x, y, z);
+						const VoxelData &voxelData = voxelGrid.getVoxelData(voxelID);
+						this->addVoxelFaces(x, y, z, voxelData, ceilingHeight, vertices);
+					}
+				}
+			}
+
+			if (chunk.vertexArray == 0)
+			{
+				gl.genVertexArrays(1, &chunk.vertexArray);
+				gl.genBuffers(1, &chunk.vertexBuffer);
+				gl.bindVertexArray(chunk.vertexArray);
+				gl.bindBuffer(GL_ARRAY_BUFFER, chunk.vertexBuffer);
+
+				const GLsizei stride = sizeof(VoxelVertex);
+				gl.vertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride,
+					reinterpret_cast<const void*>(offsetof(VoxelVertex, x)));
+				gl.vertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride,
+					reinterpret_cast<const void*>(offsetof(VoxelVertex, u)));
+				gl.vertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride,
+					reinterpret_cast<const void*>(offsetof(VoxelVertex, normalX)));
+				gl.vertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride,
+					reinterpret_cast<const void*>(offsetof(VoxelVertex, transparent)));
+
+				for (GLuint i = 0; i < 4; i++)
+				{
+					gl.enableVertexAttribArray(i);
+				}
+			}
+			else
+			{
+				gl.bindBuffer(GL_ARRAY_BUFFER, chunk.vertexBuffer);
+			}
+
+			gl.bufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(VoxelVertex),
+				vertices.data(), GL_STATIC_DRAW);
+			chunk.vertexCount = static_cast<int>(vertices.size());
+		}
+	}
+
+	gl.bindVertexArray(0);
+}
+
+void OpenGLRenderer::destroyChunks()
+{
+	for (Chunk &chunk : this->chunks)
+	{
+		if (chunk.vertexArray != 0)
+		{
+			gl.deleteVertexArrays(1, &chunk.vertexArray);
+			gl.deleteBuffers(1, &chunk.vertexBuffer);
+		}
+	}
+
+	this->chunks.clear();
+	this->chunkCountX = 0;
+	this->chunkCountZ = 0;
+}
+
+Double3 OpenGLRenderer::getFogColor(double daytimePercent) const
+{
+	// Get the real index (not the integer index), so the color can be interpolated
+	// between two samples.
+	const double realIndex = static_cast<double>(this->skyPalette.size()) * daytimePercent;
+
+	const size_t index = static_cast<size_t>(realIndex);
+	const size_t nextIndex = (index + 1) % this->skyPalette.size();
+
+	const Double3 &color = this->skyPalette[index];
+	const Double3 &nextColor = this->skyPalette[nextIndex];
+
+	const double percent = realIndex - std::floor(realIndex);
+	return color.lerp(nextColor, percent);
+}
+
+Double3 OpenGLRenderer::getSunDirection(double daytimePercent) const
+{
+	// The sun rises in the east (+Z) and sets in the west (-Z).
+	const double radians = daytimePercent * (2.0 * Constants::Pi);
+	return Double3(0.0, -std::cos(radians), std::sin(radians)).normalized();
+}
+
+void OpenGLRenderer::render(const Double3 &eye, const Double3 &direction, double fovY,
+	double ambient, double daytimePercent, double ceilingHeight, const VoxelGrid &voxelGrid,
+	uint32_t *colorBuffer)
+{
+	ContextBinding binding(this->window, this->context);
+
+	this->updateChunks(voxelGrid, ceilingHeight);
+
+	// Switching mip levels only changes the textures' filters.
+	if (this->forceBaseMipLevel != this->baseMipLevelApplied)
+	{
+		const GLint minFilter = this->forceBaseMipLevel ? GL_NEAREST : GL_NEAREST_MIPMAP_NEAREST;
+		gl.bindTexture(GL_TEXTURE_2D_ARRAY, this->voxelTextureArray);
+		gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, minFilter);
+		gl.bindTexture(GL_TEXTURE_2D_ARRAY, this->lightTextureArray);
+		gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, minFilter);
+		this->baseMipLevelApplied = this->forceBaseMipLevel;
+	}
+
+	// Same camera as the software renderer: it looks straight ahead in the XZ plane, and
+	// the Y component of the direction shears projected Y coordinates instead.
+	const double aspect = static_cast<double>(this->width) / static_cast<double>(this->height);
+	const Double3 forwardXZ = Double3(direction.x, 0.0, direction.z).normalized();
+	const Double3 rightXZ = forwardXZ.cross(Double3::UnitY).normalized();
+	const Matrix4d view = Matrix4d::view(eye, forwardXZ, rightXZ, Double3::UnitY);
+	const Matrix4d projection = Matrix4d::perspective(fovY, aspect,
+		OpenGLRenderer::NEAR_PLANE, OpenGLRenderer::FAR_PLANE);
+
+	const double zoom = 1.0 / std::tan((fovY * 0.5) * Constants::DegToRad);
+	const double xzProjection = std::sqrt((direction.x * direction.x) +
+		(direction.z * direction.z));
+	const double yShear = std::tan(std::atan2(direction.y, xzProjection)) * zoom;
+
+	// Shear the clip space Y coordinate, then flip it so the rows read back from GL are
+	// top to bottom like the software renderer's. Flipping Y also flips the winding, so
+	// front faces are clockwise.
+	Matrix4d shear = Matrix4d::identity();
+	shear.y.y = -1.0;
+	shear.w.y = 2.0 * yShear;
+	const std::array<GLfloat, 16> transform = toGLMatrix(shear * projection * view);
+
+	// Shading values, the same as the software renderer's.
+	const Double3 fogColor = this->getFogColor(daytimePercent);
+	const Double3 sunDirection = this->getSunDirection(daytimePercent);
+	const Double3 sunColor = [&sunDirection]()
+	{
+		const Double3 baseColor(0.90, 0.875, 0.85);
+
+		// Darken the sun color if it's below the horizon so wall faces aren't lit
+		// as much during the night.
+		return (sunDirection.y >= 0.0) ? baseColor :
+			(baseColor * (1.0 - (5.0 * std::abs(sunDirection.y)))).clamped();
+	}();
+
+	auto setSharedUniforms = [&eye, &fogColor, &sunDirection, &sunColor, ambient,
+		&transform, this](GLuint program)
+	{
+		setUniform(program, "transform", transform);
+		setUniform(program, "eye", eye);
+		setUniform(program, "fogColor", fogColor);
+		setUniform(program, "fogDistance", this->fogDistance);
+		setUniform(program, "sunDirection", sunDirection);
+		setUniform(program, "sunColor", sunColor);
+		setUniform(program, "ambient", ambient);
+	};
+
+	gl.bindFramebuffer(GL_FRAMEBUFFER, this->frameBuffer);
+	gl.viewport(0, 0, this->width, this->height);
+	gl.clearColor(static_cast<GLfloat>(fogColor.x), static_cast<GLfloat>(fogColor.y),
+		static_cast<GLfloat>(fogColor.z), 1.0f);
+	gl.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	gl.enable(GL_DEPTH_TEST);
+	gl.depthFunc(GL_LEQUAL);
+	gl.disable(GL_CULL_FACE);
+	gl.frontFace(GL_CW);
+
+	// Voxels.
+	gl.useProgram(this->voxelProgram);
+	setSharedUniforms(this->voxelProgram);
+
+	const Double3 nightLightColor = Double3::fromRGB(OpenGLRenderer::NIGHT_LIGHT_COLOR);
+	setUniform(this->voxelProgram, "nightLightsActive", this->nightLightsActive ? 1 : 0);
+	setUniform(this->voxelProgram, "nightLightColor", nightLightColor);
+
+	// Only the lights nearest to the camera fit in the shader.
+	std::vector<const Light*> nearestLights;
+	for (const auto &pair : this->lights)
+	{
+		nearestLights.push_back(&pair.second);
+	}
+
+	const Double2 eye2D(eye.x, eye.z);
+	auto getLightDistance = [&eye2D](const Light *light)
+	{
+		return (Double2(light->point.x, light->point.z) - eye2D).lengthSquared();
+	};
+
+	std::sort(nearestLights.begin(), nearestLights.end(),
+		[&getLightDistance](const Light *a, const Light *b)
+	{
+		return getLightDistance(a) < getLightDistance(b);
+	});
+
+	const int lightCount = std::min(static_cast<int>(nearestLights.size()),
+		OpenGLRenderer::MAX_LIGHTS);
+	std::vector<GLfloat> lightValues;
+	for (int i = 0; i < lightCount; i++)
+	{
+		// Only the brightness of the color is used, like the software renderer.
+		const Light &light = *nearestLights[i];
+		const double brightness = (light.color.x + light.color.y + light.color.z) / 3.0;
+		lightValues.push_back(static_cast<GLfloat>(light.point.x));
+		lightValues.push_back(static_cast<GLfloat>(light.point.z));
+		lightValues.push_back(static_cast<GLfloat>(light.intensity));
+		lightValues.push_back(static_cast<GLfloat>(brightness));
+	}
+
+	setUniform(this->voxelProgram, "lightCount", lightCount);
+	if (lightCount > 0)
+	{
+		gl.uniform4fv(gl.getUniformLocation(this->voxelProgram, "lights"), lightCount,
+			lightValues.data());
+	}
+
+	gl.activeTexture(GL_TEXTURE0);
+	gl.bindTexture(GL_TEXTURE_2D_ARRAY, this->voxelTextureArray);
+	gl.activeTexture(GL_TEXTURE1);
+	gl.bindTexture(GL_TEXTURE_2D_ARRAY, this->lightTextureArray);
+	gl.activeTexture(GL_TEXTURE0);
+
+	for (const Chunk &chunk : this->chunks)
+	{
+		if (chunk.vertexCount > 0)
+		{
+			gl.bindVertexArray(chunk.vertexArray);
+			gl.drawArrays(GL_TRIANGLES, 0, chunk.vertexCount);
+		}
+	}
+
+	// Flats, one instanced draw for each texture. Their texels are either opaque or
+	// discarded, so they don't need sorting.
+	std::vector<std::pair<int, FlatInstance>> flatInstances;
+	for (const auto &pair : this->flats)
+	{
+		const Flat &flat = pair.second;
+		if ((flat.textureID < 0) ||
+			(flat.textureID >= static_cast<int>(this->flatTextures.size())) ||
+			(this->flatTextures[flat.textureID].id == 0))
+		{
+			continue;
+		}
+
+		FlatInstance instance;
+		instance.x = static_cast<float>(flat.position.x);
+		instance.y = static_cast<float>(flat.position.y);
+		instance.z = static_cast<float>(flat.position.z);
+		instance.flipped = flat.flipped ? 1.0f : 0.0f;
+		instance.width = static_cast<float>(flat.width);
+		instance.height = static_cast<float>(flat.height);
+		flatInstances.push_back(std::make_pair(flat.textureID, instance));
+	}
+
+	if (flatInstances.size() > 0)
+	{
+		std::sort(flatInstances.begin(), flatInstances.end(),
+			[](const std::pair<int, FlatInstance> &a, const std::pair<int, FlatInstance> &b)
+		{
+			return a.first < b.first;
+		});
+
+		std::vector<FlatInstance> instances;
+		for (const auto &pair : flatInstances)
+		{
+			instances.push_back(pair.second);
+		}
+
+		// Each flat shares the same axes, facing opposite to the camera direction.
+		const Double3 flatForward = Double3(-forwardXZ.x, 0.0, -forwardXZ.z).normalized();
+		const Double3 flatRight = flatForward.cross(Double3::UnitY).normalized();
+
+		gl.useProgram(this->flatProgram);
+		setSharedUniforms(this->flatProgram);
+		setUniform(this->flatProgram, "flatRight", flatRight);
+		setUniform(this->flatProgram, "flatNormal", flatForward);
+
+		gl.bindVertexArray(this->flatVertexArray);
+		gl.bindBuffer(GL_ARRAY_BUFFER, this->flatInstanceBuffer);
+		gl.bufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(FlatInstance),
+			instances.data(), GL_STREAM_DRAW);
+
+		size_t runStart = 0;
+		while (runStart < flatInstances.size())
+		{
+			const int textureID = flatInstances[runStart].first;
+			size_t runEnd = runStart + 1;
+			while ((runEnd < flatInstances.size()) && (flatInstances[runEnd].first == textureID))
+			{
+				runEnd++;
+			}
+
+			const size_t offset = runStart * sizeof(FlatInstance);
+			const GLsizei stride = sizeof(FlatInstance);
+			gl.vertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride,
+				reinterpret_cast<const void*>(offset + offsetof(FlatInstance, x)));
+			gl.vertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride,
+				reinterpret_cast<const void*>(offset + offsetof(FlatInstance, width)));
+
+			gl.bindTexture(GL_TEXTURE_2D, this->flatTextures.at(textureID).id);
+			gl.drawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+				static_cast<GLsizei>(runEnd - runStart));
+
+			runStart = runEnd;
+		}
+	}
+
+	gl.bindVertexArray(0);
+	gl.useProgram(0);
+
+	// Read the frame back as ARGB8888.
+	gl.pixelStorei(GL_PACK_ALIGNMENT, 1);
+	gl.readPixels(0, 0, this->width, this->height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+		colorBuffer);
+	gl.bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
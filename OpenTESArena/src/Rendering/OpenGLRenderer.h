@@ -0,0 +1,173 @@
+#ifndef OPENGL_RENDERER_H
+#define OPENGL_RENDERER_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "../Math/Vector3.h"
+
+// Hardware-accelerated alternative to the software renderer for the game world. It draws
+// the same scene with OpenGL 3.3: voxels are meshed into a vertex buffer for each chunk of
+// voxel columns, voxel textures live in one texture array, and flats are drawn as instanced
+// quads. Shading, fog, and lights use the software renderer's formulas in the shaders.
+
+// It renders into an off-screen frame buffer with its own context on a hidden window, and
+// the result is read back into a CPU buffer, so Renderer presents it the same way as a
+// software frame.
+
+// Only the voxel types the software renderer draws are meshed, with the same heights and
+// texture coordinates. Doors are drawn as transparent walls like in the software renderer.
+
+class VoxelData;
+class VoxelGrid;
+
+struct SDL_Window;
+
+class OpenGLRenderer
+{
+private:
+	// A sprite in the world, drawn as a quad that always faces the camera.
+	struct Flat
+	{
+		Double3 position; // Center of the bottom edge.
+		double width, height;
+		int textureID;
+		bool flipped;
+	};
+
+	struct Light
+	{
+		Double3 point, color;
+		double intensity; // Radius in the XZ plane.
+	};
+
+	// Flat textures have different dimensions, so each one is its own GL texture. Flats
+	// are drawn in one instanced call per texture.
+	struct FlatTexture
+	{
+		unsigned int id; // GL texture name, or 0 if unused.
+		int width, height;
+
+		FlatTexture();
+	};
+
+	// Vertex buffer for the voxel faces in a square of voxel columns. The voxel IDs it was
+	// made from are kept, so it's only remade when one of them changes.
+	struct Chunk
+	{
+		unsigned int vertexArray, vertexBuffer;
+		int vertexCount;
+		int revision; // Revision of the grid chunk its vertices were made from.
+
+		Chunk();
+	};
+
+	// A vertex of a voxel face, interleaved in the vertex buffer.
+	struct VoxelVertex
+	{
+		float x, y, z;
+		float u, v, layer;
+		float normalX, normalY, normalZ;
+		float transparent; // Non-zero if texels with no alpha are discarded.
+	};
+
+	// Per-instance values for a flat.
+	struct FlatInstance
+	{
+		float x, y, z, flipped;
+		float width, height;
+	};
+
+	// Number of voxel textures (the same as the software renderer) and their dimensions.
+	static const int VOXEL_TEXTURE_COUNT;
+	static const int VOXEL_TEXTURE_WIDTH;
+	static const int VOXEL_TEXTURE_HEIGHT;
+
+	// Max number of lights given to the shaders each frame. The nearest ones are used.
+	static const int MAX_LIGHTS;
+
+	// Color added to night light texels.
+	static const uint32_t NIGHT_LIGHT_COLOR;
+
+	// Clipping planes. The near plane is further than the software renderer's so the depth
+	// buffer has enough precision.
+	static const double NEAR_PLANE;
+	static const double FAR_PLANE;
+
+	SDL_Window *window; // Hidden window that owns the context.
+	void *context; // SDL_GLContext.
+	unsigned int frameBuffer, colorBuffer, depthBuffer;
+	unsigned int voxelProgram, flatProgram;
+	unsigned int voxelTextureArray, lightTextureArray;
+	unsigned int flatVertexArray, flatCornerBuffer, flatInstanceBuffer;
+	std::vector<FlatTexture> flatTextures;
+	std::unordered_map<int, Flat> flats;
+	std::unordered_map<int, Light> lights;
+	std::vector<Chunk> chunks;
+	std::vector<Double3> skyPalette;
+	int meshedGridID; // ID of the grid the chunks were made from, or -1 if none.
+	int meshedRevision; // Revision of that grid when they were last updated.
+	double meshedCeilingHeight;
+	double fogDistance;
+	int width, height, chunkCountX, chunkCountZ;
+	bool functionsLoaded, nightLightsActive, forceBaseMipLevel, baseMipLevelApplied;
+
+	// Makes the off-screen color and depth buffers for the current dimensions.
+	void createFrameBuffer();
+	void destroyFrameBuffer();
+
+	// Makes the vertices for the faces of one voxel.
+	void addVoxelFaces(int voxelX, int voxelY, int voxelZ, const VoxelData &voxelData,
+		double ceilingHeight, std::vector<VoxelVertex> &vertices) const;
+
+	// Remakes the vertex buffers of chunks whose revision changed in the grid, or all of
+	// them if the grid or ceiling height changed.
+	void updateChunks(const VoxelGrid &voxelGrid, double ceilingHeight);
+	void destroyChunks();
+
+	// Gets the sky color, the same as the software renderer's.
+	Double3 getFogColor(double daytimePercent) const;
+
+	// Gets the direction of the sun, the same as the software renderer's.
+	Double3 getSunDirection(double daytimePercent) const;
+public:
+	OpenGLRenderer(int width, int height);
+	~OpenGLRenderer();
+
+	// Makes the hidden window, the context, and the GL objects. Returns false if OpenGL 3.3
+	// isn't available, in which case the renderer must not be used.
+	bool init();
+
+	// Same methods as the software renderer's for changing the scene.
+	void addFlat(int id, const Double3 &position, double width, double height, int textureID);
+	void addLight(int id, const Double3 &point, const Double3 &color, double intensity);
+	bool updateFlat(int id, const Double3 *position, const double *width,
+		const double *height, const int *textureID, const bool *flipped);
+	void updateLight(int id, const Double3 *point, const Double3 *color,
+		const double *intensity);
+	void setFogDistance(double fogDistance);
+	void setVoxelTexture(int id, const uint32_t *srcTexels);
+	void setFlatTexture(int id, const uint32_t *srcTexels, int width, int height);
+	void setSkyPalette(const uint32_t *colors, int count);
+	void setNightLightsActive(bool active);
+	void setForceBaseMipLevel(bool forceBaseMipLevel);
+	void removeFlat(int id);
+	void removeFlatTexture(int id);
+	void removeLight(int id);
+	void clearTextures();
+
+	// Makes the chunks be remade from the next voxel grid, even if it's at the same address.
+	void clearVoxelMeshes();
+
+	// Resizes the off-screen frame buffer.
+	void resize(int width, int height);
+
+	// Draws the scene and writes it to the given ARGB8888 buffer, which has the renderer's
+	// dimensions.
+	void render(const Double3 &eye, const Double3 &direction, double fovY, double ambient,
+		double daytimePercent, double ceilingHeight, const VoxelGrid &voxelGrid,
+		uint32_t *colorBuffer);
+};
+
+#endif
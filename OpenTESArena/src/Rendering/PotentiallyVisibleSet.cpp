@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "PotentiallyVisibleSet.h"
+#include "../Math/Constants.h"
+#include "../Utilities/JobSystem.h"
+#include "../Utilities/Profiler.h"
+#include "../World/VoxelData.h"
+#include "../World/VoxelDataType.h"
+#include "../World/VoxelGrid.h"
+
+const double PotentiallyVisibleSet::MAX_REACH = 1.0;
+const int PotentiallyVisibleSet::RAYS_PER_COLUMN = 512;
+
+PotentiallyVisibleSet::PotentiallyVisibleSet()
+{
+	this->chunkCountX = 0;
+	this->chunkCountZ = 0;
+	this->wordsPerRow = 0;
+	this->gridID = -1;
+	this->gridRevision = -1;
+}
+
+void PotentiallyVisibleSet::bake(const VoxelGrid &voxelGrid, JobSystem &jobSystem)
+{
+	ProfileScope("PotentiallyVisibleSet::bake");
+
+	*this = PotentiallyVisibleSet();
+
+	const int width = voxelGrid.getWidth();
+	const int depth = voxelGrid.getDepth();
+	if ((width == 0) || (depth == 0) || (voxelGrid.getHeight() < 2))
+	{
+		return;
+	}
+
+	// Only walls on the main floor block sight.
+	std::vector<uint8_t> blocking(width * depth);
+	for (int z = 0; z < depth; z++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			const VoxelData &voxelData = voxelGrid.getVoxelData(voxelGrid.getVoxel(x, 1, z));
+			blocking[x + (z * width)] = voxelData.dataType == VoxelDataType::Wall;
+		}
+	}
+
+	this->chunkCountX = voxelGrid.getChunkCountX();
+	this->chunkCountZ = voxelGrid.getChunkCountZ();
+	const int chunkCount = this->chunkCountX * this->chunkCountZ;
+	this->wordsPerRow = (chunkCount + 63) / 64;
+	this->visibleChunks.resize(chunkCount * this->wordsPerRow, 0);
+	this->gridID = voxelGrid.getID();
+	this->gridRevision = voxelGrid.getRevision();
+
+	// Rays go in the same directions from every column.
+	std::vector<Double2> directions(PotentiallyVisibleSet::RAYS_PER_COLUMN);
+	for (int i = 0; i < PotentiallyVisibleSet::RAYS_PER_COLUMN; i++)
+	{
+		const double angle = ((static_cast<double>(i) + 0.50) * 2.0 * Constants::Pi) /
+			static_cast<double>(PotentiallyVisibleSet::RAYS_PER_COLUMN);
+		directions[i] = Double2(std::cos(angle), std::sin(angle));
+	}
+
+	// Each chunk only writes its own row.
+	jobSystem.parallelFor(chunkCount, [this, &blocking, &directions, width, depth](int chunkIndex)
+	{
+		const int chunkSize = VoxelGrid::CHUNK_SIZE;
+		uint64_t *row = this->visibleChunks.data() + (chunkIndex * this->wordsPerRow);
+
+		// The chunks of the columns around one a ray passes are marked too, so anything
+		// reaching over a chunk's edge is seen with it.
+		auto markColumn = [this, row, width, depth, chunkSize](int x, int z)
+		{
+			const int minChunkX = std::max(x - 1, 0) / chunkSize;
+			const int maxChunkX = std::min(x + 1, width - 1) / chunkSize;
+			const int minChunkZ = std::max(z - 1, 0) / chunkSize;
+			const int maxChunkZ = std::min(z + 1, depth - 1) / chunkSize;
+			for (int chunkZ = minChunkZ; chunkZ <= maxChunkZ; chunkZ++)
+			{
+				for (int chunkX = minChunkX; chunkX <= maxChunkX; chunkX++)
+				{
+					const int index = chunkX + (chunkZ * this->chunkCountX);
+					row[index / 64] |= static_cast<uint64_t>(1) << (index % 64);
+				}
+			}
+		};
+
+		const int startX = (chunkIndex % this->chunkCountX) * chunkSize;
+		const int startZ = (chunkIndex / this->chunkCountX) * chunkSize;
+		const int endX = std::min(startX + chunkSize, width);
+		const int endZ = std::min(startZ + chunkSize, depth);
+		bool hasOpenColumn = false;
+		for (int z = startZ; z < endZ; z++)
+		{
+			for (int x = startX; x < endX; x++)
+			{
+				if (blocking[x + (z * width)])
+				{
+					continue;
+				}
+
+				hasOpenColumn = true;
+				markColumn(x, z);
+
+				// Step through the columns each ray passes from the column's center until
+				// it hits a wall or leaves the grid.
+				for (const Double2 &direction : directions)
+				{
+					const int stepX = (direction.x > 0.0) ? 1 : -1;
+					const int stepZ = (direction.y > 0.0) ? 1 : -1;
+					const double deltaX = (direction.x != 0.0) ? std::abs(1.0 / direction.x) :
+						std::numeric_limits<double>::infinity();
+					const double deltaZ = (direction.y != 0.0) ? std::abs(1.0 / direction.y) :
+						std::numeric_limits<double>::infinity();
+					double sideX = deltaX * 0.50;
+					double sideZ = deltaZ * 0.50;
+					int voxelX = x;
+					int voxelZ = z;
+
+					while (true)
+					{
+						if (sideX < sideZ)
+						{
+							voxelX += stepX;
+							sideX += deltaX;
+						}
+						else
+						{
+							voxelZ += stepZ;
+							sideZ += deltaZ;
+						}
+
+						if ((voxelX < 0) || (voxelX >= width) || (voxelZ < 0) || (voxelZ >= depth))
+						{
+							break;
+						}
+
+						markColumn(voxelX, voxelZ);
+
+						if (blocking[voxelX + (voxelZ * width)])
+						{
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		// A chunk with nowhere to stand can see everything, in case the camera is in a wall.
+		if (!hasOpenColumn)
+		{
+			std::fill(row, row + this->wordsPerRow, ~static_cast<uint64_t>(0));
+		}
+	});
+
+	// Rays from either end can miss each other, so anything seen one way is seen both ways.
+	auto isSet = [this](int from, int to)
+	{
+		const uint64_t word = this->visibleChunks[(from * this->wordsPerRow) + (to / 64)];
+		return ((word >> (to % 64)) & 1) != 0;
+	};
+
+	for (int i = 0; i < chunkCount; i++)
+	{
+		for (int j = 0; j < i; j++)
+		{
+			if (isSet(i, j) != isSet(j, i))
+			{
+				this->visibleChunks[(i * this->wordsPerRow) + (j / 64)] |=
+					static_cast<uint64_t>(1) << (j % 64);
+				this->visibleChunks[(j * this->wordsPerRow) + (i / 64)] |=
+					static_cast<uint64_t>(1) << (i % 64);
+			}
+		}
+	}
+}
+
+bool PotentiallyVisibleSet::isEmpty() const
+{
+	return this->visibleChunks.size() == 0;
+}
+
+size_t PotentiallyVisibleSet::getBytes() const
+{
+	return this->visibleChunks.size() * sizeof(this->visibleChunks.front());
+}
+
+bool PotentiallyVisibleSet::isCurrent(const VoxelGrid &voxelGrid) const
+{
+	return (voxelGrid.getID() == this->gridID) && (voxelGrid.getRevision() == this->gridRevision);
+}
+
+bool PotentiallyVisibleSet::isChunkVisible(const Int2 &fromChunk, const Int2 &toChunk) const
+{
+	auto isInside = [this](const Int2 &chunk)
+	{
+		return (chunk.x >= 0) && (chunk.x < this->chunkCountX) &&
+			(chunk.y >= 0) && (chunk.y < this->chunkCountZ);
+	};
+
+	if (!isInside(fromChunk) || !isInside(toChunk))
+	{
+		return true;
+	}
+
+	const int from = fromChunk.x + (fromChunk.y * this->chunkCountX);
+	const int to = toChunk.x + (toChunk.y * this->chunkCountX);
+	const uint64_t word = this->visibleChunks[(from * this->wordsPerRow) + (to / 64)];
+	return ((word >> (to % 64)) & 1) != 0;
+}
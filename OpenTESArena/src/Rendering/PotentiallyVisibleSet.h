@@ -0,0 +1,56 @@
+#ifndef POTENTIALLY_VISIBLE_SET_H
+#define POTENTIALLY_VISIBLE_SET_H
+
+#include <cstdint>
+#include <vector>
+
+#include "../Math/Vector2.h"
+
+// Which chunks of an interior's voxel grid might be seen from each other chunk, baked once
+// for the level so the renderer can skip anything in a chunk the camera can't see into
+// without testing it. Interiors are mazes under a ceiling, so sight is blocked by the main
+// floor's walls alone. Doors and every other kind of voxel are see-through.
+
+// Visibility is found by casting rays in every direction from each open column, so very
+// narrow gaps far away can be missed. Chunks next to any column a ray passes are counted
+// too, and the set is made symmetric, which covers that in practice.
+
+class JobSystem;
+class VoxelGrid;
+
+class PotentiallyVisibleSet
+{
+public:
+	// How far past its chunk's edges something can reach (i.e., a flat's half width) and
+	// still only be seen when its chunk is.
+	static const double MAX_REACH;
+private:
+	// Rays cast from each open column.
+	static const int RAYS_PER_COLUMN;
+
+	std::vector<uint64_t> visibleChunks; // A row of bits for each chunk, one per chunk.
+	int chunkCountX, chunkCountZ;
+	int wordsPerRow;
+	int gridID, gridRevision; // Of the voxel grid it was baked from.
+public:
+	PotentiallyVisibleSet();
+
+	// Bakes the chunks visible from each chunk of the grid, with rows of chunks spread
+	// across the job system.
+	void bake(const VoxelGrid &voxelGrid, JobSystem &jobSystem);
+
+	// Returns whether nothing was baked.
+	bool isEmpty() const;
+
+	// Gets the bytes used by the visibility bits.
+	size_t getBytes() const;
+
+	// Returns whether the set was baked from the grid as it is now.
+	bool isCurrent(const VoxelGrid &voxelGrid) const;
+
+	// Returns whether anything in the second chunk might be seen from the first. Chunks
+	// outside the grid are always visible.
+	bool isChunkVisible(const Int2 &fromChunk, const Int2 &toChunk) const;
+};
+
+#endif
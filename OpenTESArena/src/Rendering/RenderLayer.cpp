@@ -0,0 +1,89 @@
+#include <cassert>
+
+#include "SDL.h"
+
+#include "Renderer.h"
+#include "RenderLayer.h"
+#include "../Math/Rect.h"
+#include "../Media/Color.h"
+#include "../Utilities/Debug.h"
+
+RenderLayer::RenderLayer()
+{
+	this->x = 0;
+	this->y = 0;
+	this->width = 0;
+	this->height = 0;
+	this->valid = false;
+}
+
+void RenderLayer::init(int x, int y, int width, int height, Renderer &renderer)
+{
+	assert(width > 0);
+	assert(height > 0);
+
+	if ((this->texture.get() == nullptr) || (width != this->width) ||
+		(height != this->height))
+	{
+		SDL_Texture *texture = renderer.createTexture(Renderer::DEFAULT_PIXELFORMAT,
+			SDL_TEXTUREACCESS_TARGET, width, height);
+		DebugAssert(texture != nullptr, "Couldn't create render layer, " +
+			std::string(SDL_GetError()));
+
+		SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		this->texture = Texture(texture);
+	}
+
+	this->x = x;
+	this->y = y;
+	this->width = width;
+	this->height = height;
+	this->valid = false;
+}
+
+bool RenderLayer::isValid() const
+{
+	return this->valid;
+}
+
+size_t RenderLayer::getBytes() const
+{
+	return (this->texture.get() != nullptr) ? (static_cast<size_t>(
+		this->texture.getWidth() * this->texture.getHeight()) * sizeof(uint32_t)) : 0;
+}
+
+void RenderLayer::invalidate()
+{
+	this->valid = false;
+}
+
+void RenderLayer::begin(Renderer &renderer)
+{
+	assert(this->texture.get() != nullptr);
+	renderer.clearTarget(this->texture.get());
+	this->valid = true;
+}
+
+void RenderLayer::draw(SDL_Texture *texture, int x, int y, Renderer &renderer)
+{
+	renderer.drawToTarget(this->texture.get(), texture, x - this->x, y - this->y);
+}
+
+void RenderLayer::drawClipped(SDL_Texture *texture, const Rect &srcRect, int x, int y,
+	Renderer &renderer)
+{
+	renderer.drawToTargetClipped(this->texture.get(), texture, srcRect,
+		x - this->x, y - this->y);
+}
+
+void RenderLayer::fillRect(const Color &color, int x, int y, int w, int h,
+	Renderer &renderer)
+{
+	renderer.fillTargetRect(this->texture.get(), color, x - this->x, y - this->y, w, h);
+}
+
+void RenderLayer::present(Renderer &renderer) const
+{
+	assert(this->valid);
+	renderer.drawOriginal(this->texture.get(), this->x, this->y, this->width, this->height);
+}
@@ -0,0 +1,54 @@
+#ifndef RENDER_LAYER_H
+#define RENDER_LAYER_H
+
+#include <cstddef>
+
+#include "Texture.h"
+
+// A texture that a group of interface draws is composed into once, and then drawn with a
+// single copy each frame until something in it changes. Its coordinates are in original
+// screen space (320x200), like the renderer's drawOriginal() methods. Panels decide when
+// to compose it again, usually by comparing a key of what went into it.
+
+class Color;
+class Rect;
+class Renderer;
+
+struct SDL_Texture;
+
+class RenderLayer
+{
+private:
+	Texture texture;
+	int x, y, width, height; // Area covered in original screen space.
+	bool valid; // Whether the texture holds a composed layer.
+public:
+	RenderLayer();
+
+	// Places the layer in original screen space, making a new texture if the size
+	// changed. The layer must be composed again afterwards.
+	void init(int x, int y, int width, int height, Renderer &renderer);
+
+	// Returns whether the layer has been composed since it was initialized or invalidated.
+	bool isValid() const;
+
+	// Gets the bytes taken by the layer's texture.
+	size_t getBytes() const;
+
+	// Makes the layer need composing again, i.e., if its render target was lost.
+	void invalidate();
+
+	// Clears the layer to transparent before drawing into it again, and marks it valid.
+	void begin(Renderer &renderer);
+
+	// Draws into the layer, in original screen coordinates.
+	void draw(SDL_Texture *texture, int x, int y, Renderer &renderer);
+	void drawClipped(SDL_Texture *texture, const Rect &srcRect, int x, int y,
+		Renderer &renderer);
+	void fillRect(const Color &color, int x, int y, int w, int h, Renderer &renderer);
+
+	// Draws the composed layer onto the native frame buffer.
+	void present(Renderer &renderer) const;
+};
+
+#endif
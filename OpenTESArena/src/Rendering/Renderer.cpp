@@ -20,14 +20,35 @@ const int Renderer::ORIGINAL_HEIGHT = 200;
 const int Renderer::DEFAULT_BPP = 32;
 const uint32_t Renderer::DEFAULT_PIXELFORMAT = SDL_PIXELFORMAT_ARGB8888;
 
+const int Renderer::LATENCY_FLASH_SIZE = 64;
+
+Renderer::FrameInput::FrameInput()
+{
+	this->pressed = false;
+}
+
 Renderer::~Renderer()
 {
 	DebugMention("Closing.");
 
-	SDL_DestroyWindow(this->window);
+	// Let any in-flight game world frame finish before its data goes away.
+	this->waitForWorldRendering();
+
+	// The OpenGL renderer's window and context need SDL to still be running.
+	this->openGLRenderer = nullptr;
+
+	if (this->window != nullptr)
+	{
+		SDL_DestroyWindow(this->window);
+	}
 
 	// This also destroys the frame buffer textures.
 	SDL_DestroyRenderer(this->renderer);
+
+	if (this->offscreenSurface != nullptr)
+	{
+		SDL_FreeSurface(this->offscreenSurface);
+	}
 }
 
 SDL_Renderer *Renderer::createRenderer()
@@ -35,8 +56,27 @@ SDL_Renderer *Renderer::createRenderer()
 	// Automatically choose the best driver.
 	const int bestDriver = -1;
 
+	const uint32_t vsyncFlag = this->vsync ? SDL_RENDERER_PRESENTVSYNC : 0;
+
+	// Without a window, SDL's software renderer draws straight into the offscreen surface.
+	if (this->window == nullptr)
+	{
+		SDL_Renderer *rendererContext = SDL_CreateSoftwareRenderer(this->offscreenSurface);
+		DebugAssert(rendererContext != nullptr, "SDL_CreateSoftwareRenderer");
+
+		SDL_RenderSetLogicalSize(rendererContext, this->offscreenSurface->w,
+			this->offscreenSurface->h);
+		return rendererContext;
+	}
+
+#ifdef SDL_HINT_RENDER_BATCHING
+	// Let SDL merge consecutive copies from the same texture (i.e., an interface atlas
+	// page) into one draw.
+	SDL_SetHint(SDL_HINT_RENDER_BATCHING, "1");
+#endif
+
 	SDL_Renderer *rendererContext = SDL_CreateRenderer(
-		this->window, bestDriver, SDL_RENDERER_ACCELERATED);
+		this->window, bestDriver, SDL_RENDERER_ACCELERATED | vsyncFlag);
 	DebugAssert(rendererContext != nullptr, "SDL_CreateRenderer");
 
 	// Set pixel interpolation hint.
@@ -60,7 +100,8 @@ SDL_Renderer *Renderer::createRenderer()
 
 		SDL_DestroyRenderer(rendererContext);
 
-		rendererContext = SDL_CreateRenderer(this->window, bestDriver, SDL_RENDERER_SOFTWARE);
+		rendererContext = SDL_CreateRenderer(this->window, bestDriver, 
+			SDL_RENDERER_SOFTWARE | vsyncFlag);
 		DebugAssert(rendererContext != nullptr, "SDL_CreateRenderer software");
 
 		nativeSurface = this->getWindowSurface();
@@ -68,6 +109,19 @@ SDL_Renderer *Renderer::createRenderer()
 
 	DebugAssert(nativeSurface != nullptr, "SDL_GetWindowSurface");
 
+	// The driver might not support VSync, in which case the frame limiter does all the 
+	// pacing.
+	if (this->vsync)
+	{
+		SDL_RendererInfo rendererInfo;
+		if ((SDL_GetRendererInfo(rendererContext, &rendererInfo) != 0) ||
+			((rendererInfo.flags & SDL_RENDERER_PRESENTVSYNC) == 0))
+		{
+			DebugMention("VSync not available.");
+			this->vsync = false;
+		}
+	}
+
 	// Set the device-independent resolution for rendering (i.e., the 
 	// "behind-the-scenes" resolution).
 	SDL_RenderSetLogicalSize(rendererContext, nativeSurface->w, nativeSurface->h);
@@ -77,7 +131,8 @@ SDL_Renderer *Renderer::createRenderer()
 
 SDL_Surface *Renderer::getWindowSurface() const
 {
-	return SDL_GetWindowSurface(this->window);
+	return (this->window != nullptr) ? SDL_GetWindowSurface(this->window) :
+		this->offscreenSurface;
 }
 
 Int2 Renderer::getWindowDimensions() const
@@ -101,47 +156,79 @@ int Renderer::getViewHeight() const
 	return viewHeight;
 }
 
-SDL_Rect Renderer::getLetterboxDimensions() const
+double Renderer::getResolutionScale() const
+{
+	return this->resolutionScale;
+}
+
+void Renderer::updateLetterbox() const
 {
 	const auto *nativeSurface = this->getWindowSurface();
-	double nativeAspect = static_cast<double>(nativeSurface->w) /
-		static_cast<double>(nativeSurface->h);
-
-	// Compare the two aspects to decide what the letterbox dimensions are.
-	if (std::abs(nativeAspect - this->letterboxAspect) < Constants::Epsilon)
-	{
-		// Equal aspects. The letterbox is equal to the screen size.
-		SDL_Rect rect;
-		rect.x = 0;
-		rect.y = 0;
-		rect.w = nativeSurface->w;
-		rect.h = nativeSurface->h;
-		return rect;
-	}
-	else if (nativeAspect > this->letterboxAspect)
-	{
-		// Native window is wider = empty left and right.
-		int subWidth = static_cast<int>(std::ceil(
-			static_cast<double>(nativeSurface->h) * this->letterboxAspect));
-		SDL_Rect rect;
-		rect.x = (nativeSurface->w - subWidth) / 2;
-		rect.y = 0;
-		rect.w = subWidth;
-		rect.h = nativeSurface->h;
-		return rect;
-	}
-	else
+	if ((nativeSurface->w == this->letterboxWindowWidth) &&
+		(nativeSurface->h == this->letterboxWindowHeight) &&
+		(this->letterboxAspect == this->letterboxWindowAspect))
 	{
-		// Native window is taller = empty top and bottom.
-		int subHeight = static_cast<int>(std::ceil(
-			static_cast<double>(nativeSurface->w) / this->letterboxAspect));
-		SDL_Rect rect;
-		rect.x = 0;
-		rect.y = (nativeSurface->h - subHeight) / 2;
-		rect.w = nativeSurface->w;
-		rect.h = subHeight;
-		return rect;
+		return;
 	}
+
+	this->letterboxWindowWidth = nativeSurface->w;
+	this->letterboxWindowHeight = nativeSurface->h;
+	this->letterboxWindowAspect = this->letterboxAspect;
+	this->letterbox = [this, nativeSurface]()
+	{
+		double nativeAspect = static_cast<double>(nativeSurface->w) /
+			static_cast<double>(nativeSurface->h);
+
+		// Compare the two aspects to decide what the letterbox dimensions are.
+		if (std::abs(nativeAspect - this->letterboxAspect) < Constants::Epsilon)
+		{
+			// Equal aspects. The letterbox is equal to the screen size.
+			SDL_Rect rect;
+			rect.x = 0;
+			rect.y = 0;
+			rect.w = nativeSurface->w;
+			rect.h = nativeSurface->h;
+			return rect;
+		}
+		else if (nativeAspect > this->letterboxAspect)
+		{
+			// Native window is wider = empty left and right.
+			int subWidth = static_cast<int>(std::ceil(
+				static_cast<double>(nativeSurface->h) * this->letterboxAspect));
+			SDL_Rect rect;
+			rect.x = (nativeSurface->w - subWidth) / 2;
+			rect.y = 0;
+			rect.w = subWidth;
+			rect.h = nativeSurface->h;
+			return rect;
+		}
+		else
+		{
+			// Native window is taller = empty top and bottom.
+			int subHeight = static_cast<int>(std::ceil(
+				static_cast<double>(nativeSurface->w) / this->letterboxAspect));
+			SDL_Rect rect;
+			rect.x = 0;
+			rect.y = (nativeSurface->h - subHeight) / 2;
+			rect.w = nativeSurface->w;
+			rect.h = subHeight;
+			return rect;
+		}
+	}();
+
+	// At whole number scales, original pixels map exactly onto native ones.
+	const int scaleX = this->letterbox.w / Renderer::ORIGINAL_WIDTH;
+	const int scaleY = this->letterbox.h / Renderer::ORIGINAL_HEIGHT;
+	const bool isIntegerScale = (scaleX > 0) && (scaleX == scaleY) &&
+		((scaleX * Renderer::ORIGINAL_WIDTH) == this->letterbox.w) &&
+		((scaleY * Renderer::ORIGINAL_HEIGHT) == this->letterbox.h);
+	this->letterboxScale = isIntegerScale ? scaleX : 0;
+}
+
+SDL_Rect Renderer::getLetterboxDimensions() const
+{
+	this->updateLetterbox();
+	return this->letterbox;
 }
 
 Surface Renderer::getScreenshot() const
@@ -162,16 +249,184 @@ Surface Renderer::getScreenshot() const
 	return Surface(screenshot);
 }
 
+Int2 Renderer::getScreenshot(std::vector<uint32_t> &pixels) const
+{
+	int width, height;
+	SDL_QueryTexture(this->nativeTexture, nullptr, nullptr, &width, &height);
+	pixels.resize(width * height);
+
+	// The native frame buffer keeps its contents after presenting, unlike the window.
+	SDL_SetRenderTarget(this->renderer, this->nativeTexture);
+	const int status = SDL_RenderReadPixels(this->renderer, nullptr,
+		Renderer::DEFAULT_PIXELFORMAT, pixels.data(), width * sizeof(uint32_t));
+
+	if (status != 0)
+	{
+		DebugCrash("Couldn't take screenshot, " + std::string(SDL_GetError()));
+	}
+
+	return Int2(width, height);
+}
+
+const std::vector<SoftwareRenderer::ThreadTimes> &Renderer::getRenderThreadTimes() const
+{
+	// The OpenGL renderer has none of the software renderer's statistics, so the empty
+	// snapshots are given instead.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return this->worldRenderThreadTimes;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+
+	// The 3D renderer's own values might be in the middle of being written when pipelined.
+	return this->pipelinedRendering ? this->worldRenderThreadTimes :
+		this->softwareRenderer->getThreadTimes();
+}
+
+const SoftwareRenderer::RenderStats &Renderer::getRenderStats() const
+{
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return this->worldRenderStats;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	return this->pipelinedRendering ? this->worldRenderStats :
+		this->softwareRenderer->getRenderStats();
+}
+
+int Renderer::getWorldFrameCount()
+{
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return 0;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	return this->softwareRenderer->getFrameCount();
+}
+
+int Renderer::getVoxelTextureLastFrame(int id)
+{
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return -1;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	return this->softwareRenderer->getVoxelTextureLastFrame(id);
+}
+
+int Renderer::getFlatTextureLastFrame(int id)
+{
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return -1;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	return this->softwareRenderer->getFlatTextureLastFrame(id);
+}
+
+SoftwareRenderer::OcclusionMode Renderer::getOcclusionMode() const
+{
+	// The OpenGL renderer always uses its depth buffer.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return SoftwareRenderer::OcclusionMode::DepthTest;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	return this->softwareRenderer->getOcclusionMode();
+}
+
+SoftwareRenderer::CostView Renderer::getCostView() const
+{
+	// Only the software renderer counts its work.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return SoftwareRenderer::CostView::Off;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	return this->softwareRenderer->getCostView();
+}
+
+int Renderer::getOcclusionMismatchCount() const
+{
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return 0;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	return this->pipelinedRendering ? this->worldOcclusionMismatchCount :
+		this->softwareRenderer->getOcclusionMismatchCount();
+}
+
+int Renderer::getWorldRevision() const
+{
+	return this->worldRevision;
+}
+
+bool Renderer::isPipelinedRendering() const
+{
+	return this->pipelinedRendering;
+}
+
+bool Renderer::isHardwareRendering() const
+{
+	return this->openGLRenderer.get() != nullptr;
+}
+
+bool Renderer::isVSyncEnabled() const
+{
+	return this->vsync;
+}
+
+bool Renderer::isHeadless() const
+{
+	return this->window == nullptr;
+}
+
+int Renderer::getRefreshRate() const
+{
+	if (this->window == nullptr)
+	{
+		return 0;
+	}
+
+	const int displayIndex = SDL_GetWindowDisplayIndex(this->window);
+
+	SDL_DisplayMode displayMode;
+	if ((displayIndex < 0) || (SDL_GetCurrentDisplayMode(displayIndex, &displayMode) != 0))
+	{
+		return 0;
+	}
+
+	return displayMode.refresh_rate;
+}
+
 Int2 Renderer::nativeToOriginal(const Int2 &nativePoint) const
 {
 	// From native point to letterbox point.
-	const Int2 windowDimensions = this->getWindowDimensions();
 	const SDL_Rect letterbox = this->getLetterboxDimensions();
 
 	const Int2 letterboxPoint(
 		nativePoint.x - letterbox.x,
 		nativePoint.y - letterbox.y);
 
+	if (this->letterboxScale > 0)
+	{
+		// Whole number scale. Truncates toward zero like the general case.
+		return Int2(letterboxPoint.x / this->letterboxScale,
+			letterboxPoint.y / this->letterboxScale);
+	}
+
 	// Then from letterbox point to original point.
 	const double letterboxXPercent = static_cast<double>(letterboxPoint.x) /
 		static_cast<double>(letterbox.w);
@@ -201,14 +456,22 @@ Rect Renderer::nativeToOriginal(const Rect &nativeRect) const
 
 Int2 Renderer::originalToNative(const Int2 &originalPoint) const
 {
+	const SDL_Rect letterbox = this->getLetterboxDimensions();
+
+	if (this->letterboxScale > 0)
+	{
+		// Whole number scale, so no rounding is needed.
+		return Int2(
+			letterbox.x + (originalPoint.x * this->letterboxScale),
+			letterbox.y + (originalPoint.y * this->letterboxScale));
+	}
+
 	// From original point to letterbox point.
 	const double originalXPercent = static_cast<double>(originalPoint.x) /
 		static_cast<double>(Renderer::ORIGINAL_WIDTH);
 	const double originalYPercent = static_cast<double>(originalPoint.y) /
 		static_cast<double>(Renderer::ORIGINAL_HEIGHT);
 
-	const SDL_Rect letterbox = this->getLetterboxDimensions();
-
 	const double letterboxWidthReal = static_cast<double>(letterbox.w);
 	const double letterboxHeightReal = static_cast<double>(letterbox.h);
 
@@ -254,7 +517,8 @@ SDL_Texture *Renderer::createTextureFromSurface(SDL_Surface *surface)
 	return SDL_CreateTextureFromSurface(this->renderer, surface);
 }
 
-void Renderer::init(int width, int height, bool fullscreen, double letterboxAspect)
+void Renderer::init(int width, int height, bool fullscreen, double letterboxAspect, 
+	bool vsync, bool headless, JobSystem &jobSystem)
 {
 	DebugMention("Initializing.");
 
@@ -262,21 +526,41 @@ void Renderer::init(int width, int height, bool fullscreen, double letterboxAspe
 	assert(height > 0);
 
 	this->letterboxAspect = letterboxAspect;
-
-	// Initialize window. The SDL_Surface is obtained from this window.
-	this->window = [width, height, fullscreen]()
+	this->letterbox = SDL_Rect();
+	this->letterboxWindowWidth = 0;
+	this->letterboxWindowHeight = 0;
+	this->letterboxScale = 0;
+	this->letterboxWindowAspect = 0.0;
+	this->vsync = vsync && !headless;
+	this->jobSystem = &jobSystem;
+	this->window = nullptr;
+	this->offscreenSurface = nullptr;
+
+	if (headless)
 	{
-		const std::string &title = Renderer::DEFAULT_TITLE;
-		const int position = fullscreen ? SDL_WINDOWPOS_UNDEFINED : SDL_WINDOWPOS_CENTERED;
-		const uint32_t flags = SDL_WINDOW_RESIZABLE |
-			(fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0);
-
-		// If fullscreen is true, then width and height are ignored. They are stored
-		// behind the scenes for when the user changes to windowed mode, however.
-		return SDL_CreateWindow(title.c_str(), position, position, width, height, flags);
-	}();
+		// Nothing is shown, so the frame buffers just need somewhere to go.
+		this->offscreenSurface = Surface::createSurfaceWithFormat(width, height,
+			Renderer::DEFAULT_BPP, Renderer::DEFAULT_PIXELFORMAT);
+		DebugAssert(this->offscreenSurface != nullptr,
+			"Couldn't create offscreen surface, " + std::string(SDL_GetError()));
+	}
+	else
+	{
+		// Initialize window. The SDL_Surface is obtained from this window.
+		this->window = [width, height, fullscreen]()
+		{
+			const std::string &title = Renderer::DEFAULT_TITLE;
+			const int position = fullscreen ? SDL_WINDOWPOS_UNDEFINED : SDL_WINDOWPOS_CENTERED;
+			const uint32_t flags = SDL_WINDOW_RESIZABLE |
+				(fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0);
+
+			// If fullscreen is true, then width and height are ignored. They are stored
+			// behind the scenes for when the user changes to windowed mode, however.
+			return SDL_CreateWindow(title.c_str(), position, position, width, height, flags);
+		}();
 
-	DebugAssert(this->window != nullptr, "SDL_CreateWindow");
+		DebugAssert(this->window != nullptr, "SDL_CreateWindow");
+	}
 
 	// Initialize renderer context.
 	this->renderer = this->createRenderer();
@@ -294,7 +578,33 @@ void Renderer::init(int width, int height, bool fullscreen, double letterboxAspe
 	// Don't initialize the game world buffer until the 3D renderer is initialized.
 	this->gameWorldTexture = nullptr;
 	this->softwareRenderer = nullptr;
+	this->openGLRenderer = nullptr;
 	this->fullGameWindow = false;
+	this->resolutionScale = 1.0;
+
+	this->worldRenderJob = nullptr;
+	this->worldFrameIndex = 0;
+	this->worldOcclusionMismatchCount = 0;
+	this->worldRevision = 0;
+	this->pipelinedRendering = false;
+	this->worldFramePending = false;
+	this->worldFrameReady = false;
+	this->pendingDoorsClear = false;
+	this->reducedColorDepth = false;
+	this->inputLatency = -1.0;
+	this->latencyFlash = false;
+	this->keepNativeFrame = false;
+	this->updateFrameTarget();
+}
+
+void Renderer::updateFrameTarget()
+{
+	// At full resolution the game world texture is drawn one-to-one, so nothing needs the
+	// intermediate pass. The headless surface keeps the native frame buffer since it's
+	// only ever read back.
+	const bool direct = !this->keepNativeFrame && !this->isHeadless() &&
+		(this->resolutionScale == 1.0);
+	this->frameTarget = direct ? nullptr : this->nativeTexture;
 }
 
 void Renderer::resize(int width, int height, double resolutionScale, bool fullGameWindow)
@@ -313,175 +623,938 @@ void Renderer::resize(int width, int height, double resolutionScale, bool fullGa
 	DebugAssert(this->nativeTexture != nullptr, 
 		"Couldn't recreate native frame buffer, " + std::string(SDL_GetError()));
 
-	this->fullGameWindow = fullGameWindow;
+	this->fullGameWindow = fullGameWindow;
+
+	// Rebuild the 3D renderer if initialized.
+	this->setResolutionScale(resolutionScale);
+}
+
+void Renderer::setResolutionScale(double resolutionScale)
+{
+	this->resolutionScale = resolutionScale;
+	this->worldRevision++;
+	this->updateFrameTarget();
+
+	// Nothing else to do if the 3D renderer isn't initialized.
+	if ((this->softwareRenderer.get() == nullptr) && (this->openGLRenderer.get() == nullptr))
+	{
+		return;
+	}
+
+	this->waitForWorldRendering();
+
+	// Height of the game world view in pixels. Determined by whether the game 
+	// interface is visible or not.
+	const int screenWidth = this->getWindowDimensions().x;
+	const int viewHeight = this->getViewHeight();
+
+	// Make sure render dimensions are at least 1x1.
+	const int renderWidth = std::max(static_cast<int>(screenWidth * resolutionScale), 1);
+	const int renderHeight = std::max(static_cast<int>(viewHeight * resolutionScale), 1);
+
+	// Reinitialize the game world frame buffer. It's still stretched to the whole view
+	// when drawn, so the window resolution doesn't change.
+	SDL_DestroyTexture(this->gameWorldTexture);
+	this->gameWorldTexture = this->createTexture(this->getGameWorldPixelFormat(),
+		SDL_TEXTUREACCESS_STREAMING, renderWidth, renderHeight);
+	DebugAssert(this->gameWorldTexture != nullptr, 
+		"Couldn't recreate game world texture, " + std::string(SDL_GetError()));
+
+	// Resize 3D renderer.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->resize(renderWidth, renderHeight);
+	}
+	else
+	{
+		this->softwareRenderer->resize(renderWidth, renderHeight);
+	}
+
+	this->resizeWorldFrameBuffers(renderWidth, renderHeight);
+}
+
+void Renderer::setPipelinedRendering(bool pipelinedRendering)
+{
+	// The OpenGL renderer's context is only used on this thread, and the GPU already
+	// works in parallel with it.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		pipelinedRendering = false;
+	}
+
+	if (pipelinedRendering == this->pipelinedRendering)
+	{
+		return;
+	}
+
+	// Finish the in-flight frame and throw it away, since the next frame is drawn
+	// directly into the game world texture.
+	this->waitForWorldRendering();
+	this->worldFrameReady = false;
+	this->pipelinedRendering = pipelinedRendering;
+}
+
+void Renderer::setReducedColorDepth(bool reducedColorDepth)
+{
+	// The OpenGL renderer reads its frames back as 32-bit pixels.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		reducedColorDepth = false;
+	}
+
+	if (reducedColorDepth == this->reducedColorDepth)
+	{
+		return;
+	}
+
+	// Remake the game world texture in the new format.
+	this->waitForWorldRendering();
+	this->reducedColorDepth = reducedColorDepth;
+	this->setResolutionScale(this->resolutionScale);
+}
+
+void Renderer::setFrameInput(std::chrono::steady_clock::time_point time, bool pressed)
+{
+	this->frameInput.time = time;
+	this->frameInput.pressed = pressed;
+	this->presentedInput = this->frameInput;
+}
+
+void Renderer::setKeepNativeFrame(bool keepNativeFrame)
+{
+	this->keepNativeFrame = keepNativeFrame;
+	this->updateFrameTarget();
+}
+
+void Renderer::setLatencyFlash(bool latencyFlash)
+{
+	this->latencyFlash = latencyFlash;
+}
+
+double Renderer::getInputLatency() const
+{
+	return this->inputLatency;
+}
+
+void Renderer::waitForWorldRendering()
+{
+	if (!this->worldFramePending)
+	{
+		return;
+	}
+
+	this->jobSystem->wait(this->worldRenderJob);
+	this->worldRenderJob = nullptr;
+	this->worldFramePending = false;
+
+	// The back buffer is now the newest completed frame.
+	this->worldFrameIndex = (this->worldFrameIndex + 1) %
+		static_cast<int>(this->worldFrameBuffers.size());
+	this->worldFrameReady = true;
+
+	// Keep the frame's statistics so they can be read while the next one is drawn.
+	this->worldRenderThreadTimes = this->softwareRenderer->getThreadTimes();
+	this->worldOcclusionMismatchCount = this->softwareRenderer->getOcclusionMismatchCount();
+	this->worldRenderStats = this->softwareRenderer->getRenderStats();
+
+	// Catch the 3D renderer up on the changes made while the frame was drawn.
+	for (const FlatUpdate &flatUpdate : this->pendingFlatUpdates)
+	{
+		this->softwareRenderer->updateFlat(flatUpdate.id, &flatUpdate.position,
+			nullptr, nullptr, &flatUpdate.textureID, &flatUpdate.flipped);
+	}
+
+	if (this->pendingDoorsClear)
+	{
+		this->softwareRenderer->clearDoors();
+	}
+
+	for (const DoorUpdate &doorUpdate : this->pendingDoorUpdates)
+	{
+		this->softwareRenderer->setDoorOpenPercent(doorUpdate.voxel, doorUpdate.percent);
+	}
+
+	this->pendingFlatUpdates.clear();
+	this->pendingDoorUpdates.clear();
+	this->pendingDoorsClear = false;
+}
+
+void Renderer::resizeWorldFrameBuffers(int width, int height)
+{
+	assert(!this->worldFramePending);
+
+	for (auto &frameBuffer : this->worldFrameBuffers)
+	{
+		frameBuffer.resize(width * height);
+	}
+
+	// The packed copies are only needed in RGB565.
+	for (auto &packedBuffer : this->worldPackedBuffers)
+	{
+		if (this->reducedColorDepth)
+		{
+			packedBuffer.resize(width * height);
+		}
+		else
+		{
+			packedBuffer.clear();
+			packedBuffer.shrink_to_fit();
+		}
+	}
+
+	this->worldFrameReady = false;
+}
+
+uint32_t Renderer::getGameWorldPixelFormat() const
+{
+	return this->reducedColorDepth ? static_cast<uint32_t>(SDL_PIXELFORMAT_RGB565) :
+		static_cast<uint32_t>(Renderer::DEFAULT_PIXELFORMAT);
+}
+
+void Renderer::uploadWorldFrame(int frameIndex)
+{
+	int renderWidth;
+	SDL_QueryTexture(this->gameWorldTexture, nullptr, nullptr, &renderWidth, nullptr);
+
+	int status;
+	if (this->reducedColorDepth)
+	{
+		status = SDL_UpdateTexture(this->gameWorldTexture, nullptr,
+			this->worldPackedBuffers[frameIndex].data(),
+			renderWidth * static_cast<int>(sizeof(uint16_t)));
+	}
+	else
+	{
+		status = SDL_UpdateTexture(this->gameWorldTexture, nullptr,
+			this->worldFrameBuffers[frameIndex].data(),
+			renderWidth * static_cast<int>(sizeof(uint32_t)));
+	}
+
+	DebugAssert(status == 0, "Couldn't update game world texture, " +
+		std::string(SDL_GetError()));
+}
+
+void Renderer::setLetterboxAspect(double letterboxAspect)
+{
+	this->letterboxAspect = letterboxAspect;
+}
+
+void Renderer::setFullscreen(bool fullscreen)
+{
+	if (this->window == nullptr)
+	{
+		return;
+	}
+
+	// Use "fake" fullscreen for now.
+	uint32_t flags = fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0;
+	SDL_SetWindowFullscreen(this->window, flags);
+
+	// Reset the cursor to the center of the screen for consistency.
+	const Int2 windowDims = this->getWindowDimensions();
+	this->warpMouse(windowDims.x / 2, windowDims.y / 2);
+}
+
+void Renderer::setWindowIcon(SDL_Surface *icon)
+{
+	if (this->window != nullptr)
+	{
+		SDL_SetWindowIcon(this->window, icon);
+	}
+}
+
+void Renderer::setWindowTitle(const std::string &title)
+{
+	if (this->window != nullptr)
+	{
+		SDL_SetWindowTitle(this->window, title.c_str());
+	}
+}
+
+void Renderer::warpMouse(int x, int y)
+{
+	if (this->window != nullptr)
+	{
+		SDL_WarpMouseInWindow(this->window, x, y);
+	}
+}
+
+void Renderer::setClipRect(const SDL_Rect *rect)
+{
+	SDL_SetRenderTarget(this->renderer, this->frameTarget);
+	SDL_RenderSetClipRect(this->renderer, rect);
+}
+
+void Renderer::initializeWorldRendering(double resolutionScale, bool fullGameWindow,
+	bool hardwareRendering)
+{
+	this->waitForWorldRendering();
+
+	this->fullGameWindow = fullGameWindow;
+	this->resolutionScale = resolutionScale;
+	this->worldRevision++;
+	this->updateFrameTarget();
+
+	const int screenWidth = this->getWindowDimensions().x;
+
+	// Height of the game world view in pixels, used in place of the screen height.
+	// Its value is a function of whether the game interface is visible or not.
+	const int viewHeight = this->getViewHeight();
+
+	// Make sure render dimensions are at least 1x1.
+	const int renderWidth = std::max(static_cast<int>(screenWidth * resolutionScale), 1);
+	const int renderHeight = std::max(static_cast<int>(viewHeight * resolutionScale), 1);
+
+	// Remove any previous game world frame buffer.
+	if (this->gameWorldTexture != nullptr)
+	{
+		SDL_DestroyTexture(this->gameWorldTexture);
+	}
+
+	// Initialize a new game world frame buffer.
+	this->gameWorldTexture = this->createTexture(this->getGameWorldPixelFormat(),
+		SDL_TEXTUREACCESS_STREAMING, renderWidth, renderHeight);
+	DebugAssert(this->gameWorldTexture != nullptr, 
+		"Couldn't create game world texture, " + std::string(SDL_GetError()));
+
+	// Initialize 3D rendering program. The OpenGL renderer falls back to the software one
+	// if it can't get a context.
+	this->softwareRenderer = nullptr;
+	this->openGLRenderer = nullptr;
+	this->voxelTextureNames.clear();
+
+	// The OpenGL renderer needs a window of its own for its context.
+	if (hardwareRendering && this->isHeadless())
+	{
+		DebugMention("Hardware rendering isn't available when headless.");
+	}
+	else if (hardwareRendering)
+	{
+		this->openGLRenderer = std::make_unique<OpenGLRenderer>(renderWidth, renderHeight);
+		if (!this->openGLRenderer->init())
+		{
+			DebugWarning("Couldn't initialize OpenGL renderer, using software renderer.");
+			this->openGLRenderer = nullptr;
+		}
+		else
+		{
+			// It only draws on this thread.
+			this->setPipelinedRendering(false);
+			this->worldRenderThreadTimes.clear();
+			this->worldOcclusionMismatchCount = 0;
+			this->worldRenderStats = SoftwareRenderer::RenderStats();
+		}
+	}
+
+	if (this->openGLRenderer.get() == nullptr)
+	{
+		this->softwareRenderer = std::make_unique<SoftwareRenderer>(
+			renderWidth, renderHeight, *this->jobSystem);
+	}
+
+	this->resizeWorldFrameBuffers(renderWidth, renderHeight);
+}
+
+void Renderer::addFlat(int id, const Double3 &position, double width, 
+	double height, int textureID)
+{
+	this->worldRevision++;
+
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->addFlat(id, position, width, height, textureID);
+		return;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->addFlat(id, position, width, height, textureID);
+}
+
+void Renderer::addLight(int id, const Double3 &point, const Double3 &color, double intensity)
+{
+	this->worldRevision++;
+
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->addLight(id, point, color, intensity);
+		return;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->addLight(id, point, color, intensity);
+}
+
+void Renderer::updateFlat(int id, const Double3 *position, const double *width, 
+	const double *height, const int *textureID, const bool *flipped)
+{
+	// Entities update their flats every tick, so only actual changes count.
+	bool changed;
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		changed = this->openGLRenderer->updateFlat(
+			id, position, width, height, textureID, flipped);
+	}
+	else
+	{
+		assert(this->softwareRenderer.get() != nullptr);
+		this->waitForWorldRendering();
+		changed = this->softwareRenderer->updateFlat(
+			id, position, width, height, textureID, flipped);
+	}
+
+	if (changed)
+	{
+		this->worldRevision++;
+	}
+}
+
+void Renderer::updateFlats(const std::vector<FlatUpdate> &flatUpdates)
+{
+	if (flatUpdates.size() == 0)
+	{
+		return;
+	}
+
+	// Wait for the world frame once for the whole batch instead of once per flat.
+	bool changed = false;
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		for (const FlatUpdate &flatUpdate : flatUpdates)
+		{
+			changed |= this->openGLRenderer->updateFlat(flatUpdate.id, &flatUpdate.position,
+				nullptr, nullptr, &flatUpdate.textureID, &flatUpdate.flipped);
+		}
+	}
+	else if (this->worldFramePending)
+	{
+		// Hold them until the frame being drawn is done instead of waiting on it. Flats are
+		// only read here, which is safe alongside the frame.
+		for (const FlatUpdate &flatUpdate : flatUpdates)
+		{
+			changed |= this->softwareRenderer->isFlatChanged(flatUpdate.id,
+				flatUpdate.position, flatUpdate.textureID, flatUpdate.flipped);
+		}
+
+		this->pendingFlatUpdates.insert(this->pendingFlatUpdates.end(),
+			flatUpdates.begin(), flatUpdates.end());
+	}
+	else
+	{
+		assert(this->softwareRenderer.get() != nullptr);
+
+		for (const FlatUpdate &flatUpdate : flatUpdates)
+		{
+			changed |= this->softwareRenderer->updateFlat(flatUpdate.id, &flatUpdate.position,
+				nullptr, nullptr, &flatUpdate.textureID, &flatUpdate.flipped);
+		}
+	}
+
+	if (changed)
+	{
+		this->worldRevision++;
+	}
+}
+
+void Renderer::updateLight(int id, const Double3 *point, const Double3 *color, 
+	const double *intensity)
+{
+	this->worldRevision++;
+
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->updateLight(id, point, color, intensity);
+		return;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->updateLight(id, point, color, intensity);
+}
+
+void Renderer::setFogDistance(double fogDistance)
+{
+	this->worldRevision++;
+
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->setFogDistance(fogDistance);
+		return;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setFogDistance(fogDistance);
+}
+
+bool Renderer::hasVoxelTexture(int id, const std::string &name) const
+{
+	return (id >= 0) && (id < static_cast<int>(this->voxelTextureNames.size())) &&
+		(this->voxelTextureNames[id].size() > 0) && (this->voxelTextureNames[id] == name);
+}
+
+void Renderer::setVoxelTexture(int id, const uint32_t *srcTexels)
+{
+	this->setVoxelTexture(id, std::string(), srcTexels);
+}
+
+void Renderer::setVoxelTexture(int id, const std::string &name, const uint32_t *srcTexels)
+{
+	this->worldRevision++;
+
+	if (id >= static_cast<int>(this->voxelTextureNames.size()))
+	{
+		this->voxelTextureNames.resize(id + 1);
+	}
+
+	this->voxelTextureNames[id] = name;
+
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->setVoxelTexture(id, srcTexels);
+		return;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setVoxelTexture(id, srcTexels);
+}
+
+void Renderer::setVoxelTextures(const std::vector<VoxelTextureUpdate> &voxelTextureUpdates)
+{
+	if (voxelTextureUpdates.size() == 0)
+	{
+		return;
+	}
+
+	this->worldRevision++;
+
+	for (const VoxelTextureUpdate &update : voxelTextureUpdates)
+	{
+		if (update.id >= static_cast<int>(this->voxelTextureNames.size()))
+		{
+			this->voxelTextureNames.resize(update.id + 1);
+		}
+
+		this->voxelTextureNames[update.id] = update.name;
+	}
+
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		for (const VoxelTextureUpdate &update : voxelTextureUpdates)
+		{
+			this->openGLRenderer->setVoxelTexture(update.id, update.srcTexels);
+		}
+
+		return;
+	}
+
+	// The software renderer converts the whole batch in parallel.
+	std::vector<int> ids;
+	std::vector<const uint32_t*> srcTexels;
+	ids.reserve(voxelTextureUpdates.size());
+	srcTexels.reserve(voxelTextureUpdates.size());
+	for (const VoxelTextureUpdate &update : voxelTextureUpdates)
+	{
+		ids.push_back(update.id);
+		srcTexels.push_back(update.srcTexels);
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setVoxelTextures(ids, srcTexels);
+}
+
+void Renderer::setFlatTexture(int id, const uint32_t *srcTexels, int width, int height)
+{
+	this->worldRevision++;
 
-	// Rebuild the 3D renderer if initialized.
-	if (this->softwareRenderer.get() != nullptr)
+	if (this->openGLRenderer.get() != nullptr)
 	{
-		// Height of the game world view in pixels. Determined by whether the game 
-		// interface is visible or not.
-		const int viewHeight = this->getViewHeight();
+		this->openGLRenderer->setFlatTexture(id, srcTexels, width, height);
+		return;
+	}
 
-		// Make sure render dimensions are at least 1x1.
-		const int renderWidth = std::max(static_cast<int>(width * resolutionScale), 1);
-		const int renderHeight = std::max(static_cast<int>(viewHeight * resolutionScale), 1);
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setFlatTexture(id, srcTexels, width, height);
+}
 
-		// Reinitialize the game world frame buffer.
-		SDL_DestroyTexture(this->gameWorldTexture);
-		this->gameWorldTexture = this->createTexture(Renderer::DEFAULT_PIXELFORMAT,
-			SDL_TEXTUREACCESS_STREAMING, renderWidth, renderHeight);
-		DebugAssert(this->gameWorldTexture != nullptr, 
-			"Couldn't recreate game world texture, " + std::string(SDL_GetError()));
+void Renderer::setSkyPalette(const uint32_t *colors, int count)
+{
+	this->worldRevision++;
 
-		// Resize 3D renderer.
-		this->softwareRenderer->resize(renderWidth, renderHeight);
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->setSkyPalette(colors, count);
+		return;
 	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setSkyPalette(colors, count);
 }
 
-void Renderer::setLetterboxAspect(double letterboxAspect)
+void Renderer::setNightLightsActive(bool active)
 {
-	this->letterboxAspect = letterboxAspect;
+	this->worldRevision++;
+
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->setNightLightsActive(active);
+		return;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setNightLightsActive(active);
 }
 
-void Renderer::setFullscreen(bool fullscreen)
+void Renderer::setLiquidCycleStep(int step)
 {
-	// Use "fake" fullscreen for now.
-	uint32_t flags = fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0;
-	SDL_SetWindowFullscreen(this->window, flags);
+	// Only the software renderer cycles liquid colors.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
 
-	// Reset the cursor to the center of the screen for consistency.
-	const Int2 windowDims = this->getWindowDimensions();
-	this->warpMouse(windowDims.x / 2, windowDims.y / 2);
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	if (this->softwareRenderer->setLiquidCycleStep(step))
+	{
+		this->worldRevision++;
+	}
 }
 
-void Renderer::setWindowIcon(SDL_Surface *icon)
+std::shared_ptr<const LightMap> Renderer::bakeLightMap(
+	const std::vector<LightMap::Light> &lights)
 {
-	SDL_SetWindowIcon(this->window, icon);
+	auto lightMap = std::make_shared<LightMap>();
+	lightMap->bake(lights, *this->jobSystem);
+	return lightMap;
 }
 
-void Renderer::setWindowTitle(const std::string &title)
+void Renderer::setLightMap(const std::shared_ptr<const LightMap> &lightMap)
 {
-	SDL_SetWindowTitle(this->window, title.c_str());
+	this->worldRevision++;
+
+	// Only the software renderer has static light maps.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setLightMap(lightMap);
 }
 
-void Renderer::warpMouse(int x, int y)
+std::shared_ptr<const PotentiallyVisibleSet> Renderer::bakePotentiallyVisibleSet(
+	const VoxelGrid &voxelGrid)
 {
-	SDL_WarpMouseInWindow(this->window, x, y);
+	auto visibleSet = std::make_shared<PotentiallyVisibleSet>();
+	visibleSet->bake(voxelGrid, *this->jobSystem);
+	return visibleSet;
 }
 
-void Renderer::setClipRect(const SDL_Rect *rect)
+void Renderer::setPotentiallyVisibleSet(
+	const std::shared_ptr<const PotentiallyVisibleSet> &visibleSet)
 {
-	SDL_RenderSetClipRect(this->renderer, rect);
+	this->worldRevision++;
+
+	// Only the software renderer culls flats with it.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setPotentiallyVisibleSet(visibleSet);
 }
 
-void Renderer::initializeWorldRendering(double resolutionScale, bool fullGameWindow)
+void Renderer::setOcclusionMode(SoftwareRenderer::OcclusionMode occlusionMode)
 {
-	this->fullGameWindow = fullGameWindow;
+	this->worldRevision++;
 
-	const int screenWidth = this->getWindowDimensions().x;
+	// Only the software renderer has this setting.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
 
-	// Height of the game world view in pixels, used in place of the screen height.
-	// Its value is a function of whether the game interface is visible or not.
-	const int viewHeight = this->getViewHeight();
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setOcclusionMode(occlusionMode);
+}
 
-	// Make sure render dimensions are at least 1x1.
-	const int renderWidth = std::max(static_cast<int>(screenWidth * resolutionScale), 1);
-	const int renderHeight = std::max(static_cast<int>(viewHeight * resolutionScale), 1);
+void Renderer::setCostView(SoftwareRenderer::CostView costView)
+{
+	this->worldRevision++;
 
-	// Remove any previous game world frame buffer.
-	if (this->softwareRenderer.get() != nullptr)
+	// Only the software renderer has this setting.
+	if (this->openGLRenderer.get() != nullptr)
 	{
-		SDL_DestroyTexture(this->gameWorldTexture);
+		return;
 	}
 
-	// Initialize a new game world frame buffer.
-	this->gameWorldTexture = this->createTexture(Renderer::DEFAULT_PIXELFORMAT,
-		SDL_TEXTUREACCESS_STREAMING, renderWidth, renderHeight);
-	DebugAssert(this->gameWorldTexture != nullptr, 
-		"Couldn't create game world texture, " + std::string(SDL_GetError()));
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setCostView(costView);
+}
+
+void Renderer::setForceBaseMipLevel(bool forceBaseMipLevel)
+{
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->setForceBaseMipLevel(forceBaseMipLevel);
+		return;
+	}
 
-	// Initialize 3D rendering program.
-	this->softwareRenderer = std::make_unique<SoftwareRenderer>(renderWidth, renderHeight);
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setForceBaseMipLevel(forceBaseMipLevel);
 }
 
-void Renderer::addFlat(int id, const Double3 &position, double width, 
-	double height, int textureID)
+void Renderer::setPalettedRendering(bool palettedRendering)
 {
+	// Only the software renderer has this setting.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
+
 	assert(this->softwareRenderer.get() != nullptr);
-	this->softwareRenderer->addFlat(id, position, width, height, textureID);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setPalettedRendering(palettedRendering);
 }
 
-void Renderer::addLight(int id, const Double3 &point, const Double3 &color, double intensity)
+void Renderer::setColumnMajorRendering(bool columnMajorRendering)
 {
+	// Only the software renderer has this setting.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
+
 	assert(this->softwareRenderer.get() != nullptr);
-	this->softwareRenderer->addLight(id, point, color, intensity);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setColumnMajorRendering(columnMajorRendering);
 }
 
-void Renderer::updateFlat(int id, const Double3 *position, const double *width, 
-	const double *height, const int *textureID, const bool *flipped)
+void Renderer::setPerspectiveSpanLength(int perspectiveSpanLength)
 {
+	// Only the software renderer has this setting.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
+
 	assert(this->softwareRenderer.get() != nullptr);
-	this->softwareRenderer->updateFlat(id, position, width, height, textureID, flipped);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setPerspectiveSpanLength(perspectiveSpanLength);
 }
 
-void Renderer::updateLight(int id, const Double3 *point, const Double3 *color, 
-	const double *intensity)
+void Renderer::setRowPlaneRendering(bool rowPlaneRendering)
 {
+	// Only the software renderer has this setting.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
+
 	assert(this->softwareRenderer.get() != nullptr);
-	this->softwareRenderer->updateLight(id, point, color, intensity);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setRowPlaneRendering(rowPlaneRendering);
 }
 
-void Renderer::setFogDistance(double fogDistance)
+void Renderer::setDeferredShading(bool deferredShading)
 {
+	// Only the software renderer has this setting.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
+
 	assert(this->softwareRenderer.get() != nullptr);
-	this->softwareRenderer->setFogDistance(fogDistance);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setDeferredShading(deferredShading);
 }
 
-void Renderer::setVoxelTexture(int id, const uint32_t *srcTexels)
+void Renderer::setInterlacedRendering(bool interlacedRendering)
 {
+	// Only the software renderer has this setting.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
+
 	assert(this->softwareRenderer.get() != nullptr);
-	this->softwareRenderer->setVoxelTexture(id, srcTexels);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setInterlacedRendering(interlacedRendering);
 }
 
-void Renderer::setFlatTexture(int id, const uint32_t *srcTexels, int width, int height)
+void Renderer::setFoveatedColumnStride(int foveatedColumnStride)
 {
+	// Only the software renderer has this setting.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
+
 	assert(this->softwareRenderer.get() != nullptr);
-	this->softwareRenderer->setFlatTexture(id, srcTexels, width, height);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setFoveatedColumnStride(foveatedColumnStride);
 }
 
-void Renderer::setSkyPalette(const uint32_t *colors, int count)
+void Renderer::setRenderThreadBudget(double seconds)
 {
+	// Only the software renderer has render threads.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
+
 	assert(this->softwareRenderer.get() != nullptr);
-	this->softwareRenderer->setSkyPalette(colors, count);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setRenderThreadBudget(seconds);
 }
 
-void Renderer::setNightLightsActive(bool active)
+void Renderer::setRenderStatsEnabled(bool renderStatsEnabled)
 {
+	// Only the software renderer has this setting.
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
+
 	assert(this->softwareRenderer.get() != nullptr);
-	this->softwareRenderer->setNightLightsActive(active);
+	this->waitForWorldRendering();
+	this->softwareRenderer->setRenderStatsEnabled(renderStatsEnabled);
 }
 
 void Renderer::removeFlat(int id)
 {
+	this->worldRevision++;
+
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->removeFlat(id);
+		return;
+	}
+
 	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
 	this->softwareRenderer->removeFlat(id);
 }
 
+void Renderer::removeFlatTexture(int id)
+{
+	this->worldRevision++;
+
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->removeFlatTexture(id);
+		return;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
+	this->softwareRenderer->removeFlatTexture(id);
+}
+
 void Renderer::removeLight(int id)
 {
+	this->worldRevision++;
+
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->removeLight(id);
+		return;
+	}
+
 	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
 	this->softwareRenderer->removeLight(id);
 }
 
+void Renderer::setDoorOpenPercent(const Int3 &voxel, double percent)
+{
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
+
+	this->worldRevision++;
+
+	// Doors move every tick while opening or closing, so they don't wait for the frame
+	// being drawn either.
+	if (this->worldFramePending)
+	{
+		this->pendingDoorUpdates.push_back(DoorUpdate { voxel, percent });
+		return;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->softwareRenderer->setDoorOpenPercent(voxel, percent);
+}
+
+void Renderer::clearDoors()
+{
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		return;
+	}
+
+	this->worldRevision++;
+
+	// Any door changes queued before this are cleared along with the rest.
+	if (this->worldFramePending)
+	{
+		this->pendingDoorUpdates.clear();
+		this->pendingDoorsClear = true;
+		return;
+	}
+
+	assert(this->softwareRenderer.get() != nullptr);
+	this->softwareRenderer->clearDoors();
+}
+
 void Renderer::clearTextures()
 {
+	this->worldRevision++;
+	this->voxelTextureNames.clear();
+
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->clearTextures();
+		return;
+	}
+
 	assert(this->softwareRenderer.get() != nullptr);
+	this->waitForWorldRendering();
 	this->softwareRenderer->clearTextures();
 }
 
+void Renderer::clearVoxelMeshes()
+{
+	this->worldRevision++;
+
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		this->openGLRenderer->clearVoxelMeshes();
+		return;
+	}
+
+	// The software renderer tells grids apart by their revision, which is never reused, so
+	// it has nothing to clear.
+	assert(this->softwareRenderer.get() != nullptr);
+}
+
 void Renderer::clear(const Color &color)
 {
-	SDL_SetRenderTarget(this->renderer, this->nativeTexture);
+	SDL_SetRenderTarget(this->renderer, this->frameTarget);
 	SDL_SetRenderDrawColor(this->renderer, color.r, color.g, color.b, color.a);
 	SDL_RenderClear(this->renderer);
 }
@@ -493,7 +1566,7 @@ void Renderer::clear()
 
 void Renderer::clearOriginal(const Color &color)
 {
-	SDL_SetRenderTarget(this->renderer, this->nativeTexture);
+	SDL_SetRenderTarget(this->renderer, this->frameTarget);
 	SDL_SetRenderDrawColor(this->renderer, color.r, color.g, color.b, color.a);
 
 	const SDL_Rect rect = this->getLetterboxDimensions();
@@ -507,21 +1580,21 @@ void Renderer::clearOriginal()
 
 void Renderer::drawPixel(const Color &color, int x, int y)
 {
-	SDL_SetRenderTarget(this->renderer, this->nativeTexture);
+	SDL_SetRenderTarget(this->renderer, this->frameTarget);
 	SDL_SetRenderDrawColor(this->renderer, color.r, color.g, color.b, color.a);
 	SDL_RenderDrawPoint(this->renderer, x, y);
 }
 
 void Renderer::drawLine(const Color &color, int x1, int y1, int x2, int y2)
 {
-	SDL_SetRenderTarget(this->renderer, this->nativeTexture);
+	SDL_SetRenderTarget(this->renderer, this->frameTarget);
 	SDL_SetRenderDrawColor(this->renderer, color.r, color.g, color.b, color.a);
 	SDL_RenderDrawLine(this->renderer, x1, y1, x2, y2);
 }
 
 void Renderer::drawRect(const Color &color, int x, int y, int w, int h)
 {
-	SDL_SetRenderTarget(this->renderer, this->nativeTexture);
+	SDL_SetRenderTarget(this->renderer, this->frameTarget);
 	SDL_SetRenderDrawColor(this->renderer, color.r, color.g, color.b, color.a);
 
 	SDL_Rect rect;
@@ -535,7 +1608,7 @@ void Renderer::drawRect(const Color &color, int x, int y, int w, int h)
 
 void Renderer::fillRect(const Color &color, int x, int y, int w, int h)
 {
-	SDL_SetRenderTarget(this->renderer, this->nativeTexture);
+	SDL_SetRenderTarget(this->renderer, this->frameTarget);
 	SDL_SetRenderDrawColor(this->renderer, color.r, color.g, color.b, color.a);
 
 	SDL_Rect rect;
@@ -549,7 +1622,7 @@ void Renderer::fillRect(const Color &color, int x, int y, int w, int h)
 
 void Renderer::fillOriginalRect(const Color &color, int x, int y, int w, int h)
 {
-	SDL_SetRenderTarget(this->renderer, this->nativeTexture);
+	SDL_SetRenderTarget(this->renderer, this->frameTarget);
 	SDL_SetRenderDrawColor(this->renderer, color.r, color.g, color.b, color.a);
 
 	const Rect rect = this->originalToNative(Rect(x, y, w, h));
@@ -559,27 +1632,151 @@ void Renderer::fillOriginalRect(const Color &color, int x, int y, int w, int h)
 void Renderer::renderWorld(const Double3 &eye, const Double3 &forward, double fovY,
 	double ambient, double daytimePercent, double ceilingHeight, const VoxelGrid &voxelGrid)
 {
+	const int screenWidth = this->getWindowDimensions().x;
+	const int viewHeight = this->getViewHeight();
+
+	if (this->openGLRenderer.get() != nullptr)
+	{
+		// Read the frame straight into the game world texture.
+		uint32_t *gameWorldPixels;
+		int gameWorldPitch;
+		int status = SDL_LockTexture(this->gameWorldTexture, nullptr,
+			reinterpret_cast<void**>(&gameWorldPixels), &gameWorldPitch);
+		DebugAssert(status == 0, "Couldn't lock game world texture, " +
+			std::string(SDL_GetError()));
+
+		this->openGLRenderer->render(eye, forward, fovY, ambient, daytimePercent,
+			ceilingHeight, voxelGrid, gameWorldPixels);
+
+		SDL_UnlockTexture(this->gameWorldTexture);
+		this->draw(this->gameWorldTexture, 0, 0, screenWidth, viewHeight);
+		return;
+	}
+
 	// The 3D renderer must be initialized.
 	assert(this->softwareRenderer.get() != nullptr);
-	
+
+	if (this->pipelinedRendering)
+	{
+		this->waitForWorldRendering();
+
+		int renderWidth;
+		SDL_QueryTexture(this->gameWorldTexture, nullptr, nullptr, &renderWidth, nullptr);
+		const int packedPitch = renderWidth * static_cast<int>(sizeof(uint16_t));
+
+		// If there's no completed frame yet (i.e., the first frame, or right after a
+		// resize), draw one now so something current is shown.
+		if (!this->worldFrameReady)
+		{
+			auto &frontBuffer = this->worldFrameBuffers[this->worldFrameIndex];
+			this->softwareRenderer->render(eye, forward, fovY, ambient, daytimePercent,
+				ceilingHeight, voxelGrid, frontBuffer.data());
+
+			if (this->reducedColorDepth)
+			{
+				this->softwareRenderer->packRGB565(frontBuffer.data(),
+					this->worldPackedBuffers[this->worldFrameIndex].data(), packedPitch);
+			}
+
+			this->worldFrameInputs[this->worldFrameIndex] = this->frameInput;
+			this->worldRenderThreadTimes = this->softwareRenderer->getThreadTimes();
+			this->worldOcclusionMismatchCount =
+				this->softwareRenderer->getOcclusionMismatchCount();
+			this->worldRenderStats = this->softwareRenderer->getRenderStats();
+			this->worldFrameReady = true;
+		}
+
+		// Upload the newest completed frame and draw it in the game world view.
+		this->uploadWorldFrame(this->worldFrameIndex);
+		this->draw(this->gameWorldTexture, 0, 0, screenWidth, viewHeight);
+		this->presentedInput = this->worldFrameInputs[this->worldFrameIndex];
+
+		// The frame reads its own copy of the voxel grid, so the game can change the real
+		// one while the frame is drawn. Only the chunks changed since last frame are copied.
+		if ((this->worldVoxelGrid.get() == nullptr) ||
+			(this->worldVoxelGrid->getWidth() != voxelGrid.getWidth()) ||
+			(this->worldVoxelGrid->getHeight() != voxelGrid.getHeight()) ||
+			(this->worldVoxelGrid->getDepth() != voxelGrid.getDepth()) ||
+			(this->worldVoxelGrid->getLayout() != voxelGrid.getLayout()))
+		{
+			this->worldVoxelGrid = std::make_unique<VoxelGrid>(voxelGrid.getWidth(),
+				voxelGrid.getHeight(), voxelGrid.getDepth(), voxelGrid.getLayout());
+		}
+
+		this->worldVoxelGrid->copyChangesFrom(voxelGrid);
+
+		// Start drawing the current state into the back buffer while the rest of the
+		// frame is composed and presented, and the next frame is ticked. The camera values
+		// are copied since they're owned by the caller.
+		const int backIndex = (this->worldFrameIndex + 1) %
+			static_cast<int>(this->worldFrameBuffers.size());
+		uint32_t *backPixels = this->worldFrameBuffers[backIndex].data();
+		uint16_t *backPacked = this->reducedColorDepth ?
+			this->worldPackedBuffers[backIndex].data() : nullptr;
+		this->worldFrameInputs[backIndex] = this->frameInput;
+		SoftwareRenderer *softwareRenderer = this->softwareRenderer.get();
+		const VoxelGrid *voxelGridPtr = this->worldVoxelGrid.get();
+		this->worldRenderJob = this->jobSystem->add([softwareRenderer, eye, forward, fovY,
+			ambient, daytimePercent, ceilingHeight, voxelGridPtr, backPixels, backPacked,
+			packedPitch]()
+		{
+			softwareRenderer->render(eye, forward, fovY, ambient, daytimePercent,
+				ceilingHeight, *voxelGridPtr, backPixels);
+
+			if (backPacked != nullptr)
+			{
+				softwareRenderer->packRGB565(backPixels, backPacked, packedPitch);
+			}
+		}, std::vector<JobSystem::JobHandle>(), std::function<void()>(),
+			JobSystem::Priority::Frame);
+
+		this->worldFramePending = true;
+		return;
+	}
+
 	// Lock the game world texture and give the pixel pointer to the software renderer.
 	// - Supposedly this is faster than SDL_UpdateTexture(). In any case, there's one
 	//   less frame buffer to take care of.
-	uint32_t *gameWorldPixels;
+	void *gameWorldPixels;
 	int gameWorldPitch;
 	int status = SDL_LockTexture(this->gameWorldTexture, nullptr, 
-		reinterpret_cast<void**>(&gameWorldPixels), &gameWorldPitch);
+		&gameWorldPixels, &gameWorldPitch);
 	DebugAssert(status == 0, "Couldn't lock game world texture, " +
 		std::string(SDL_GetError()));
 
-	// Render the game world to the game world frame buffer.
-	this->softwareRenderer->render(eye, forward, fovY, ambient, daytimePercent, 
-		ceilingHeight, voxelGrid, gameWorldPixels);
+	// Render the game world to the game world frame buffer. In RGB565 it's drawn into the
+	// unused pipelined frame buffer first and packed into the texture.
+	if (this->reducedColorDepth)
+	{
+		uint32_t *colorBuffer = this->worldFrameBuffers[this->worldFrameIndex].data();
+		this->softwareRenderer->render(eye, forward, fovY, ambient, daytimePercent,
+			ceilingHeight, voxelGrid, colorBuffer);
+		this->softwareRenderer->packRGB565(colorBuffer,
+			static_cast<uint16_t*>(gameWorldPixels), gameWorldPitch);
+	}
+	else
+	{
+		this->softwareRenderer->render(eye, forward, fovY, ambient, daytimePercent,
+			ceilingHeight, voxelGrid, static_cast<uint32_t*>(gameWorldPixels));
+	}
 
-	// Update the game world texture with the new ARGB8888 pixels.
+	// Update the game world texture with the new pixels.
 	SDL_UnlockTexture(this->gameWorldTexture);
 
-	// Now copy to the native frame buffer (stretching if needed).
+	// Now copy into the frame (stretching if needed). At full resolution it goes straight
+	// into the window along with the interface.
+	this->draw(this->gameWorldTexture, 0, 0, screenWidth, viewHeight);
+}
+
+void Renderer::redrawWorld()
+{
+	if (this->worldFramePending)
+	{
+		this->waitForWorldRendering();
+		this->uploadWorldFrame(this->worldFrameIndex);
+		this->presentedInput = this->worldFrameInputs[this->worldFrameIndex];
+	}
+
 	const int screenWidth = this->getWindowDimensions().x;
 	const int viewHeight = this->getViewHeight();
 	this->draw(this->gameWorldTexture, 0, 0, screenWidth, viewHeight);
@@ -652,7 +1849,7 @@ void Renderer::drawCursor(SDL_Texture *cursor, CursorAlignment alignment,
 
 void Renderer::draw(SDL_Texture *texture, int x, int y, int w, int h)
 {
-	SDL_SetRenderTarget(this->renderer, this->nativeTexture);
+	SDL_SetRenderTarget(this->renderer, this->frameTarget);
 
 	SDL_Rect rect;
 	rect.x = x;
@@ -678,7 +1875,7 @@ void Renderer::draw(SDL_Texture *texture)
 
 void Renderer::drawClipped(SDL_Texture *texture, const Rect &srcRect, const Rect &dstRect)
 {
-	SDL_SetRenderTarget(this->renderer, this->nativeTexture);
+	SDL_SetRenderTarget(this->renderer, this->frameTarget);
 	SDL_RenderCopy(this->renderer, texture, &srcRect.getRect(), &dstRect.getRect());
 }
 
@@ -689,7 +1886,7 @@ void Renderer::drawClipped(SDL_Texture *texture, const Rect &srcRect, int x, int
 
 void Renderer::drawOriginal(SDL_Texture *texture, int x, int y, int w, int h)
 {
-	SDL_SetRenderTarget(this->renderer, this->nativeTexture);
+	SDL_SetRenderTarget(this->renderer, this->frameTarget);
 	
 	// The given coordinates and dimensions are in 320x200 space, so transform them
 	// to native space.
@@ -713,7 +1910,7 @@ void Renderer::drawOriginal(SDL_Texture *texture)
 
 void Renderer::drawOriginalClipped(SDL_Texture *texture, const Rect &srcRect, const Rect &dstRect)
 {
-	SDL_SetRenderTarget(this->renderer, this->nativeTexture);
+	SDL_SetRenderTarget(this->renderer, this->frameTarget);
 
 	// The destination coordinates and dimensions are in 320x200 space, so transform 
 	// them to native space.
@@ -730,13 +1927,73 @@ void Renderer::drawOriginalClipped(SDL_Texture *texture, const Rect &srcRect, in
 
 void Renderer::fill(SDL_Texture *texture)
 {
-	SDL_SetRenderTarget(this->renderer, this->nativeTexture);
+	SDL_SetRenderTarget(this->renderer, this->frameTarget);
 	SDL_RenderCopy(this->renderer, texture, nullptr, nullptr);
 }
 
+void Renderer::clearTarget(SDL_Texture *target)
+{
+	SDL_SetRenderTarget(this->renderer, target);
+	SDL_SetRenderDrawColor(this->renderer, 0, 0, 0, 0);
+	SDL_RenderClear(this->renderer);
+}
+
+void Renderer::drawToTarget(SDL_Texture *target, SDL_Texture *texture, int x, int y)
+{
+	SDL_SetRenderTarget(this->renderer, target);
+
+	int width, height;
+	SDL_QueryTexture(texture, nullptr, nullptr, &width, &height);
+
+	const Rect rect(x, y, width, height);
+	SDL_RenderCopy(this->renderer, texture, nullptr, &rect.getRect());
+}
+
+void Renderer::drawToTargetClipped(SDL_Texture *target, SDL_Texture *texture,
+	const Rect &srcRect, int x, int y)
+{
+	SDL_SetRenderTarget(this->renderer, target);
+
+	const Rect rect(x, y, srcRect.getWidth(), srcRect.getHeight());
+	SDL_RenderCopy(this->renderer, texture, &srcRect.getRect(), &rect.getRect());
+}
+
+void Renderer::fillTargetRect(SDL_Texture *target, const Color &color, int x, int y,
+	int w, int h)
+{
+	SDL_SetRenderTarget(this->renderer, target);
+	SDL_SetRenderDrawColor(this->renderer, color.r, color.g, color.b, color.a);
+
+	const Rect rect(x, y, w, h);
+	SDL_RenderFillRect(this->renderer, &rect.getRect());
+}
+
 void Renderer::present()
 {
+	// Each input is only measured by the first present that shows it.
+	const FrameInput &input = this->presentedInput;
+	const bool newInput = input.time > this->latencyInputTime;
+	if (this->latencyFlash)
+	{
+		const Color &color = (newInput && input.pressed) ? Color::White : Color::Black;
+		this->fillRect(color, 0, 0, Renderer::LATENCY_FLASH_SIZE, Renderer::LATENCY_FLASH_SIZE);
+	}
+
+	// A frame composed in the native frame buffer is copied into the window. Otherwise
+	// it's already there.
 	SDL_SetRenderTarget(this->renderer, nullptr);
-	SDL_RenderCopy(this->renderer, this->nativeTexture, nullptr, nullptr);
+	if (this->frameTarget != nullptr)
+	{
+		SDL_RenderCopy(this->renderer, this->frameTarget, nullptr, nullptr);
+	}
+
 	SDL_RenderPresent(this->renderer);
+
+	this->inputLatency = -1.0;
+	if (newInput)
+	{
+		this->inputLatency = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - input.time).count();
+		this->latencyInputTime = input.time;
+	}
 }
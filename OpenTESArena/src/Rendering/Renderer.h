@@ -1,14 +1,20 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include <array>
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "SDL.h"
+
+#include "OpenGLRenderer.h"
 #include "SoftwareRenderer.h"
 #include "../Math/Vector2.h"
 #include "../Math/Vector3.h"
+#include "../Utilities/JobSystem.h"
 
 // Acts as a wrapper for SDL_Renderer operations as well as 3D rendering operations.
 
@@ -21,7 +27,6 @@ class VoxelGrid;
 
 enum class CursorAlignment;
 
-struct SDL_Rect;
 struct SDL_Renderer;
 struct SDL_Surface;
 struct SDL_Texture;
@@ -29,22 +34,133 @@ struct SDL_Window;
 
 class Renderer
 {
+public:
+	// New state for one flat, sent in batches by updateFlats().
+	struct FlatUpdate
+	{
+		int id;
+		Double3 position;
+		int textureID;
+		bool flipped;
+	};
+
+	// A 64x64 voxel texture for a slot, sent in batches by setVoxelTextures().
+	struct VoxelTextureUpdate
+	{
+		int id;
+		std::string name;
+		const uint32_t *srcTexels;
+	};
 private:
 	static const char *DEFAULT_RENDER_SCALE_QUALITY;
 	static const std::string DEFAULT_TITLE;
 
-	SDL_Window *window;
+	SDL_Window *window; // Null when headless.
+	SDL_Surface *offscreenSurface; // Drawn into in place of the window when headless.
 	SDL_Renderer *renderer;
 	SDL_Texture *nativeTexture, *gameWorldTexture; // Frame buffers.
+
+	// Where the frame is composed. When the game world isn't scaled, the frame is drawn
+	// straight into the window (null) so presenting doesn't copy the native frame buffer
+	// too, unless it's kept for reading back (screenshots, video).
+	SDL_Texture *frameTarget;
+	bool keepNativeFrame;
 	std::unique_ptr<SoftwareRenderer> softwareRenderer; // 3D renderer.
+	std::unique_ptr<OpenGLRenderer> openGLRenderer; // Used instead when hardware rendering.
 	double letterboxAspect;
+
+	// The letterbox of the window size and aspect it was last found for, and how many
+	// native pixels each original pixel covers if that's a whole number (else zero), so
+	// converting coordinates for each interface draw doesn't redo the float math.
+	mutable SDL_Rect letterbox;
+	mutable int letterboxWindowWidth, letterboxWindowHeight, letterboxScale;
+	mutable double letterboxWindowAspect;
+	double resolutionScale; // Percent of the window resolution the 3D frame buffer uses.
 	bool fullGameWindow; // Determines height of 3D frame buffer.
+	bool vsync; // Whether presenting waits for the display's vertical sync.
+
+	JobSystem *jobSystem; // For the software renderer's threads and pipelined frames.
+
+	// Pipelined world rendering. The 3D renderer draws the next frame in a job into one
+	// CPU buffer while the newest completed frame in the other is presented.
+	JobSystem::JobHandle worldRenderJob;
+	std::array<std::vector<uint32_t>, 2> worldFrameBuffers;
+	std::vector<SoftwareRenderer::ThreadTimes> worldRenderThreadTimes; // Of the newest frame.
+	int worldFrameIndex; // Index of the newest completed frame buffer.
+	int worldOcclusionMismatchCount; // Of the newest frame.
+	SoftwareRenderer::RenderStats worldRenderStats; // Of the newest frame.
+	bool pipelinedRendering, worldFramePending, worldFrameReady;
+
+	// Whether the game world texture is RGB565, for half the upload bandwidth. The software
+	// renderer's frames are packed into it (or into the pipelined frame's packed copy).
+	std::array<std::vector<uint16_t>, 2> worldPackedBuffers;
+	bool reducedColorDepth;
+
+	// A door's new open percent, held until the frame being drawn is done.
+	struct DoorUpdate
+	{
+		Int3 voxel;
+		double percent;
+	};
+
+	// World state the pipelined frame reads, so the game can tick the next frame while
+	// it's drawn. The voxel grid is a snapshot updated once per frame with just the chunks
+	// that changed, and the per-tick flat and door changes made meanwhile are applied once
+	// the frame is done. Rarer changes (adding flats, textures, etc.) still wait for it.
+	std::unique_ptr<VoxelGrid> worldVoxelGrid;
+	std::vector<FlatUpdate> pendingFlatUpdates;
+	std::vector<DoorUpdate> pendingDoorUpdates;
+	bool pendingDoorsClear; // Whether the doors are cleared before the pending updates.
+
+	// Input a frame responds to, for measuring the time from it to the frame being shown.
+	struct FrameInput
+	{
+		std::chrono::steady_clock::time_point time; // Zero if there was no input.
+		bool pressed; // Whether a key or mouse button was pressed.
+
+		FrameInput();
+	};
+
+	// Side length in pixels of the latency flash marker's square.
+	static const int LATENCY_FLASH_SIZE;
+
+	FrameInput frameInput; // Of the frame being composed.
+	FrameInput presentedInput; // Shown by the next present, which lags behind if pipelined.
+	std::array<FrameInput, 2> worldFrameInputs; // Of each pipelined frame buffer.
+	std::chrono::steady_clock::time_point latencyInputTime; // Newest input shown so far.
+	double inputLatency; // Of the last present, or negative if it showed no new input.
+	bool latencyFlash;
+
+	// Incremented by every change to the 3D scene (flats, lights, textures, etc.) and to the 
+	// game world frame buffer, so callers can tell if the last frame is still current.
+	int worldRevision;
+
+	// Name of the texture in each voxel texture slot of the 3D renderer, or empty if it's
+	// unknown. Level switches only upload the slots whose name changes.
+	std::vector<std::string> voxelTextureNames;
 
 	// Helper method for making a renderer context.
 	SDL_Renderer *createRenderer();
 
 	// For use with window dimensions, etc.. No longer used for rendering.
 	SDL_Surface *getWindowSurface() const;
+
+	// Finds the letterbox again if the window size or letterbox aspect changed.
+	void updateLetterbox() const;
+
+	// Picks the frame target for the resolution scale and whether the native frame buffer
+	// is kept.
+	void updateFrameTarget();
+
+	// Resizes the pipelined frame buffers to the game world texture's dimensions and
+	// discards any completed frame.
+	void resizeWorldFrameBuffers(int width, int height);
+
+	// Gets the pixel format of the game world texture.
+	uint32_t getGameWorldPixelFormat() const;
+
+	// Uploads a completed pipelined frame to the game world texture.
+	void uploadWorldFrame(int frameIndex);
 public:
 	~Renderer();
 
@@ -66,6 +182,9 @@ public:
 	// the interface. The game interface is 53 pixels tall in 320x200.
 	int getViewHeight() const;
 
+	// Gets the percent of the window resolution that the game world is rendered at.
+	double getResolutionScale() const;
+
 	// This is for the "letterbox" part of the screen, scaled to fit the window 
 	// using the given letterbox aspect.
 	SDL_Rect getLetterboxDimensions() const;
@@ -73,6 +192,54 @@ public:
 	// Gets a screenshot of the current window.
 	Surface getScreenshot() const;
 
+	// Reads the native frame buffer into the given pixels (ARGB, top row first), resizing
+	// them if needed, and returns its dimensions. The same pixels can be given each time
+	// so a screenshot doesn't allocate.
+	Int2 getScreenshot(std::vector<uint32_t> &pixels) const;
+
+	// Gets the busy and idle times of each 3D render thread from the most recent frame. 
+	// The 3D renderer must be initialized.
+	const std::vector<SoftwareRenderer::ThreadTimes> &getRenderThreadTimes() const;
+
+	// Gets the 3D renderer's work counters from the most recent frame. The 3D renderer 
+	// must be initialized.
+	const SoftwareRenderer::RenderStats &getRenderStats() const;
+
+	// Gets the number of frames the 3D renderer has drawn, and the frame a voxel or flat
+	// texture was last sampled in, or -1 if it hasn't been since it was set. A pipelined
+	// frame is waited for first. The OpenGL renderer doesn't track them.
+	int getWorldFrameCount();
+	int getVoxelTextureLastFrame(int id);
+	int getFlatTextureLastFrame(int id);
+
+	// Gets the 3D renderer's occlusion mode, and the number of mismatched pixels from the 
+	// most recent comparison frame. The 3D renderer must be initialized.
+	SoftwareRenderer::OcclusionMode getOcclusionMode() const;
+	int getOcclusionMismatchCount() const;
+
+	// Gets the 3D renderer's debug cost view. The 3D renderer must be initialized.
+	SoftwareRenderer::CostView getCostView() const;
+
+	// Gets a number that changes whenever the 3D scene or the game world frame buffer does.
+	// Together with the camera and voxel grid, it says whether renderWorld() would draw 
+	// the same frame as last time.
+	int getWorldRevision() const;
+
+	// Returns whether the game world is rendered one frame ahead on another thread.
+	bool isPipelinedRendering() const;
+
+	// Returns whether the game world is rendered with OpenGL instead of in software.
+	bool isHardwareRendering() const;
+
+	// Returns whether presenting a frame waits for the display's vertical sync.
+	bool isVSyncEnabled() const;
+
+	// Returns whether frames go to an offscreen surface instead of a window.
+	bool isHeadless() const;
+
+	// Gets the refresh rate of the window's display in hertz, or zero if unknown.
+	int getRefreshRate() const;
+
 	// Transforms a native window (i.e., 1920x1080) point or rectangle to an original 
 	// (320x200) point or rectangle. Points outside the letterbox will either be negative 
 	// or outside the 320x200 limit when returned.
@@ -90,11 +257,52 @@ public:
 	SDL_Texture *createTexture(uint32_t format, int access, int w, int h);
 	SDL_Texture *createTextureFromSurface(SDL_Surface *surface);
 
-	void init(int width, int height, bool fullscreen, double letterboxAspect);
+	// The job system must outlive the renderer. When headless, there's no window, and
+	// frames are drawn into an offscreen surface of the given size with SDL's software
+	// renderer instead.
+	void init(int width, int height, bool fullscreen, double letterboxAspect, bool vsync,
+		bool headless, JobSystem &jobSystem);
 
 	// Resizes the renderer dimensions.
 	void resize(int width, int height, double resolutionScale, bool fullGameWindow);
 
+	// Resizes the 3D frame buffer to the given percent of the window resolution, if the 
+	// 3D renderer is initialized. The game world still fills the same area on-screen.
+	void setResolutionScale(double resolutionScale);
+
+	// Sets whether the 3D renderer draws the next frame on another thread while the most
+	// recently completed one is presented. This adds one frame of latency to the game world.
+	void setPipelinedRendering(bool pipelinedRendering);
+
+	// Sets whether the software renderer's frames are converted to 16-bit RGB565 for the
+	// game world texture. Shading is still done at full precision and dithered down. The
+	// OpenGL renderer always uses 32-bit color.
+	void setReducedColorDepth(bool reducedColorDepth);
+
+	// Sets the input the frame being composed responds to. The next present measures the
+	// time from it, unless the game world shown is from an earlier frame (i.e., pipelined).
+	void setFrameInput(std::chrono::steady_clock::time_point time, bool pressed);
+
+	// Sets whether frames are composed in the native frame buffer even when they could be
+	// drawn straight into the window, so it can be read back after presenting. Takes effect
+	// for the next thing drawn, so it should be set before composing a frame.
+	void setKeepNativeFrame(bool keepNativeFrame);
+
+	// Sets whether each present draws a square in the top left corner that's white when
+	// the frame first shows a press and black otherwise, for checking the measured latency
+	// with a photodiode.
+	void setLatencyFlash(bool latencyFlash);
+
+	// Gets the seconds from the newest input shown by the last present until it returned,
+	// or a negative number if that present didn't show any new input.
+	double getInputLatency() const;
+
+	// Blocks until the pipelined 3D renderer is done with the frame it's drawing, if any,
+	// then applies the flat and door updates made while it was drawn. The frame reads its
+	// own snapshot of the voxel grid, so the game state can change while it's drawn.
+	// Renderer methods that change other 3D renderer data call this themselves.
+	void waitForWorldRendering();
+
 	// Sets the letterbox aspect. 1.60 is the default, and 1.33 is the "stretched"
 	// aspect for simulating tall pixels on a 640x480 display.
 	void setLetterboxAspect(double letterboxAspect);
@@ -117,9 +325,11 @@ public:
 
 	// Initialize the renderer for the game world. The "fullGameWindow" argument 
 	// determines whether to render a "fullscreen" 3D image or just the part above 
-	// the game interface. If there is an existing renderer in memory, it will be 
+	// the game interface. If "hardwareRendering" is true, the OpenGL renderer is used
+	// when available. If there is an existing renderer in memory, it will be 
 	// overwritten with the new one.
-	void initializeWorldRendering(double resolutionScale, bool fullGameWindow);
+	void initializeWorldRendering(double resolutionScale, bool fullGameWindow,
+		bool hardwareRendering);
 
 	// Helper methods for changing data in the 3D renderer. Some data, like the voxel
 	// grid, are passed each frame by reference.
@@ -130,17 +340,61 @@ public:
 	void addLight(int id, const Double3 &point, const Double3 &color, double intensity);
 	void updateFlat(int id, const Double3 *position, const double *width, 
 		const double *height, const int *textureID, const bool *flipped);
+	void updateFlats(const std::vector<FlatUpdate> &flatUpdates);
 	void updateLight(int id, const Double3 *point, const Double3 *color,
 		const double *intensity);
 	void setFogDistance(double fogDistance);
 	void setVoxelTexture(int id, const uint32_t *srcTexels);
+	void setVoxelTexture(int id, const std::string &name, const uint32_t *srcTexels);
+	void setVoxelTextures(const std::vector<VoxelTextureUpdate> &voxelTextureUpdates);
 	void setFlatTexture(int id, const uint32_t *srcTexels, int width, int height);
 	void setSkyPalette(const uint32_t *colors, int count);
 	void setNightLightsActive(bool active);
+	void setLiquidCycleStep(int step);
+
+	// Bakes a level's static lights into a light map on the job system. The level keeps it
+	// and gives it back with setLightMap() whenever it becomes active, so it's only baked
+	// once per level.
+	std::shared_ptr<const LightMap> bakeLightMap(const std::vector<LightMap::Light> &lights);
+	void setLightMap(const std::shared_ptr<const LightMap> &lightMap);
+
+	// Bakes which chunks of an interior's voxel grid can see each other on the job system,
+	// kept by the level like its light map.
+	std::shared_ptr<const PotentiallyVisibleSet> bakePotentiallyVisibleSet(
+		const VoxelGrid &voxelGrid);
+	void setPotentiallyVisibleSet(const std::shared_ptr<const PotentiallyVisibleSet> &visibleSet);
+
+	void setOcclusionMode(SoftwareRenderer::OcclusionMode occlusionMode);
+	void setCostView(SoftwareRenderer::CostView costView);
+	void setForceBaseMipLevel(bool forceBaseMipLevel);
+	void setPalettedRendering(bool palettedRendering);
+	void setColumnMajorRendering(bool columnMajorRendering);
+	void setPerspectiveSpanLength(int perspectiveSpanLength);
+	void setRowPlaneRendering(bool rowPlaneRendering);
+	void setDeferredShading(bool deferredShading);
+	void setInterlacedRendering(bool interlacedRendering);
+	void setFoveatedColumnStride(int foveatedColumnStride);
+	void setRenderThreadBudget(double seconds);
+	void setRenderStatsEnabled(bool renderStatsEnabled);
 	void removeFlat(int id);
+	void removeFlatTexture(int id);
 	void removeLight(int id);
 	void clearTextures();
 
+	// Sets how far open the door in the given voxel is, from the level's active doors. Only
+	// doors that are moving or just closed need to be set. The OpenGL renderer draws every
+	// door closed for now.
+	void setDoorOpenPercent(const Int3 &voxel, double percent);
+	void clearDoors();
+
+	// Returns whether the voxel texture slot already holds the texture with the given name,
+	// so it doesn't need to be uploaded again.
+	bool hasVoxelTexture(int id, const std::string &name) const;
+
+	// Makes the 3D renderer treat the next voxel grid it's given as a new one, even if it's
+	// at the same address as the last one. Needed when textures are kept across levels.
+	void clearVoxelMeshes();
+
 	// Fills the native frame buffer with the draw color, or default black/transparent.
 	void clear(const Color &color);
 	void clear();
@@ -157,11 +411,18 @@ public:
 	void fillOriginalRect(const Color &color, int x, int y, int w, int h);
 
 	// Runs the 3D renderer which draws the world onto the native frame buffer.
-	// If the renderer is uninitialized, this causes a crash.
+	// If the renderer is uninitialized, this causes a crash. When pipelined, this draws
+	// the previous frame and starts on this one from a snapshot of the voxel grid.
 	void renderWorld(const Double3 &eye, const Double3 &forward, double fovY, 
 		double ambient, double daytimePercent, double ceilingHeight, 
 		const VoxelGrid &voxelGrid);
 
+	// Draws the most recent game world frame onto the native frame buffer again without 
+	// rendering a new one. Only valid when nothing the frame depends on has changed since
+	// the last renderWorld(). When pipelined, the frame in flight is waited for and shown,
+	// since it's the one with the current state.
+	void redrawWorld();
+
 	// Draws the given cursor texture to the native frame buffer. The exact position 
 	// of the cursor is modified by the cursor alignment.
 	void drawCursor(SDL_Texture *texture, CursorAlignment alignment, 
@@ -182,6 +443,14 @@ public:
 	// Stretches a texture over the entire native frame buffer.
 	void fill(SDL_Texture *texture);
 
+	// Draw methods for composing onto a render target texture (i.e., a render layer), in
+	// the target's own pixel coordinates. Clearing makes the target fully transparent.
+	void clearTarget(SDL_Texture *target);
+	void drawToTarget(SDL_Texture *target, SDL_Texture *texture, int x, int y);
+	void drawToTargetClipped(SDL_Texture *target, SDL_Texture *texture, const Rect &srcRect,
+		int x, int y);
+	void fillTargetRect(SDL_Texture *target, const Color &color, int x, int y, int w, int h);
+
 	// Refreshes the displayed frame buffer.
 	void present();
 };
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "SDL.h"
+
+#include "RendererAutotune.h"
+#include "SoftwareRenderer.h"
+#include "../Assets/INFFile.h"
+#include "../Assets/MIFFile.h"
+#include "../Entities/Player.h"
+#include "../Game/OptionsSnapshot.h"
+#include "../Math/Constants.h"
+#include "../Math/Vector2.h"
+#include "../Math/Vector3.h"
+#include "../Media/TextureManager.h"
+#include "../Utilities/Debug.h"
+#include "../Utilities/Platform.h"
+#include "../Utilities/String.h"
+#include "../World/LevelData.h"
+#include "../World/WorldData.h"
+
+RendererAutotune::Settings::Settings()
+{
+	this->columnMajorRendering = false;
+	this->rowPlaneRendering = false;
+	this->instructionSet = SpanShading::InstructionSet::Scalar;
+	this->frameSeconds = 0.0;
+}
+
+const std::string RendererAutotune::SCENE_MIF_NAME = "START.MIF";
+const int RendererAutotune::WARMUP_FRAMES = 4;
+const int RendererAutotune::MEASURED_FRAMES = 16;
+
+std::string RendererAutotune::getSignature(int renderWidth, int renderHeight)
+{
+	// SDL doesn't give the CPU's model, so a CPU swapped for one with the same layout
+	// keeps its settings.
+	const Platform::CpuTopology &topology = Platform::getCpuTopology();
+	return Platform::getPlatform() + ' ' +
+		std::to_string(topology.logicalCount) + 't' +
+		std::to_string(topology.physicalCount) + 'c' +
+		std::to_string(topology.performanceCount) + 'p' + ' ' +
+		SpanShading::getInstructionSetName(SpanShading::getBestInstructionSet()) + ' ' +
+		std::to_string(renderWidth) + 'x' + std::to_string(renderHeight);
+}
+
+SpanShading::InstructionSet RendererAutotune::getInstructionSet(int optionValue)
+{
+	return (optionValue == 0) ? SpanShading::getBestInstructionSet() :
+		static_cast<SpanShading::InstructionSet>(optionValue - 1);
+}
+
+int RendererAutotune::getOptionValue(SpanShading::InstructionSet instructionSet)
+{
+	return static_cast<int>(instructionSet) + 1;
+}
+
+RendererAutotune::Settings RendererAutotune::run(int renderWidth, int renderHeight,
+	const OptionsSnapshot &options, TextureManager &textureManager, JobSystem &jobSystem)
+{
+	const WorldData worldData = WorldData::loadInterior(
+		MIFFile::get(RendererAutotune::SCENE_MIF_NAME));
+	const LevelData &level = worldData.getActiveLevel();
+
+	SoftwareRenderer renderer(renderWidth, renderHeight, jobSystem);
+	renderer.setForceBaseMipLevel(options.forceBaseMipLevel);
+	renderer.setPalettedRendering(options.palettedRendering);
+	renderer.setPerspectiveSpanLength(options.perspectiveSpanLength);
+	renderer.setDeferredShading(options.deferredShading);
+	renderer.setInterlacedRendering(options.interlacedRendering);
+
+	// Load the level's voxel textures like WorldData does when a level becomes active.
+	const INFFile inf(level.getInfName());
+	const int voxelTextureCount = static_cast<int>(inf.getVoxelTextures().size());
+	for (int i = 0; i < voxelTextureCount; i++)
+	{
+		const auto &textureData = inf.getVoxelTextures().at(i);
+		const std::string textureName = String::toUppercase(textureData.filename);
+		const std::string extension = String::getExtension(textureName);
+
+		if (extension == ".SET")
+		{
+			const auto &surfaces = textureManager.getSurfaces(textureName);
+			const SDL_Surface *surface = surfaces.at(textureData.setIndex);
+			renderer.setVoxelTexture(i, static_cast<const uint32_t*>(surface->pixels));
+		}
+		else if (extension == ".IMG")
+		{
+			const SDL_Surface *surface = textureManager.getSurface(textureName);
+			renderer.setVoxelTexture(i, static_cast<const uint32_t*>(surface->pixels));
+		}
+	}
+
+	const uint32_t skyColor = level.getInteriorSkyColor();
+	renderer.setSkyPalette(&skyColor, 1);
+	renderer.setFogDistance(25.0);
+
+	// The camera circles the start point while turning all the way around, so every
+	// combination draws the same frames.
+	const Double2 startPoint = (worldData.getStartPoints().size() > 0) ?
+		worldData.getStartPoints().front() : Double2(0.50, 0.50);
+	const double eyeHeight = 1.0 + Player::HEIGHT;
+	const double fovY = options.verticalFOV;
+	std::vector<uint32_t> colorBuffer(renderWidth * renderHeight);
+
+	auto renderFrame = [&level, &renderer, &colorBuffer, &startPoint, eyeHeight,
+		fovY](int frameIndex)
+	{
+		const double angle = (static_cast<double>(frameIndex) /
+			static_cast<double>(RendererAutotune::MEASURED_FRAMES)) * (2.0 * Constants::Pi);
+		const Double3 eye(
+			startPoint.x + (std::cos(angle) * 1.50),
+			eyeHeight,
+			startPoint.y + (std::sin(angle) * 1.50));
+		const Double3 direction(
+			std::cos(angle + (Constants::Pi / 2.0)),
+			0.0,
+			std::sin(angle + (Constants::Pi / 2.0)));
+
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		renderer.render(eye, direction, fovY, 1.0, 0.50, level.getCeilingHeight(),
+			level.getVoxelGrid(), colorBuffer.data());
+		return std::chrono::duration<double>(
+			std::chrono::high_resolution_clock::now() - startTime).count();
+	};
+
+	// Instruction sets this build and CPU don't support fall back to scalar, so they're
+	// skipped.
+	const SpanShading::InstructionSet previousSet = SpanShading::getInstructionSet();
+	std::vector<SpanShading::InstructionSet> instructionSets;
+	const SpanShading::InstructionSet allSets[] =
+	{
+		SpanShading::InstructionSet::Scalar,
+		SpanShading::InstructionSet::SSE2,
+		SpanShading::InstructionSet::AVX2,
+		SpanShading::InstructionSet::NEON
+	};
+
+	for (const SpanShading::InstructionSet instructionSet : allSets)
+	{
+		SpanShading::setInstructionSet(instructionSet);
+		if (SpanShading::getInstructionSet() == instructionSet)
+		{
+			instructionSets.push_back(instructionSet);
+		}
+	}
+
+	Settings best;
+	bool hasBest = false;
+	std::vector<double> frameSeconds(RendererAutotune::MEASURED_FRAMES);
+
+	for (const SpanShading::InstructionSet instructionSet : instructionSets)
+	{
+		SpanShading::setInstructionSet(instructionSet);
+
+		for (int i = 0; i < 4; i++)
+		{
+			Settings settings;
+			settings.columnMajorRendering = (i & 1) != 0;
+			settings.rowPlaneRendering = (i & 2) != 0;
+			settings.instructionSet = instructionSet;
+
+			renderer.setColumnMajorRendering(settings.columnMajorRendering);
+			renderer.setRowPlaneRendering(settings.rowPlaneRendering);
+
+			for (int j = 0; j < RendererAutotune::WARMUP_FRAMES; j++)
+			{
+				renderFrame(j);
+			}
+
+			for (int j = 0; j < RendererAutotune::MEASURED_FRAMES; j++)
+			{
+				frameSeconds[j] = renderFrame(j);
+			}
+
+			// The median, so a frame interrupted by the OS doesn't count.
+			std::sort(frameSeconds.begin(), frameSeconds.end());
+			settings.frameSeconds = frameSeconds[frameSeconds.size() / 2];
+
+			if (!hasBest || (settings.frameSeconds < best.frameSeconds))
+			{
+				best = settings;
+				hasBest = true;
+			}
+		}
+	}
+
+	SpanShading::setInstructionSet(previousSet);
+	return best;
+}
@@ -0,0 +1,62 @@
+#ifndef RENDERER_AUTOTUNE_H
+#define RENDERER_AUTOTUNE_H
+
+#include <string>
+
+#include "SpanShading.h"
+
+// Times the software renderer's settings that don't change how the game world looks
+// (column-major buffers, row-by-row floors and ceilings, and the span shading instruction
+// set) on a short built-in scene, so the fastest combination for this machine can be kept
+// in the options. Which one wins depends on the CPU's caches and vector units as well as
+// the render resolution, so it's tuned again when either changes.
+
+// Settings that trade quality for speed (i.e., paletted rendering, perspective spans) are
+// left to the player, and the scene is drawn with them as they are.
+
+class JobSystem;
+class TextureManager;
+
+struct OptionsSnapshot;
+
+class RendererAutotune
+{
+public:
+	struct Settings
+	{
+		bool columnMajorRendering;
+		bool rowPlaneRendering;
+		SpanShading::InstructionSet instructionSet;
+		double frameSeconds; // Median frame time of the scene with these settings.
+
+		Settings();
+	};
+private:
+	// Interior drawn for timing each combination of settings.
+	static const std::string SCENE_MIF_NAME;
+
+	// Frames drawn before timing, for caches and the render threads to settle, and frames
+	// timed for each combination of settings.
+	static const int WARMUP_FRAMES;
+	static const int MEASURED_FRAMES;
+
+	RendererAutotune() = delete;
+	~RendererAutotune() = delete;
+public:
+	// Gets a string naming the CPU (by its core counts and best instruction set) and the
+	// render resolution, for telling whether tuned settings are still for this machine.
+	static std::string getSignature(int renderWidth, int renderHeight);
+
+	// Gets the instruction set for a SpanInstructionSet option value, where 0 is the best
+	// one the build and CPU support, and the option value for an instruction set.
+	static SpanShading::InstructionSet getInstructionSet(int optionValue);
+	static int getOptionValue(SpanShading::InstructionSet instructionSet);
+
+	// Draws the scene with each combination of settings at the given resolution and returns
+	// the fastest one. It takes a second or two. The span shading instruction set is put
+	// back the way it was afterwards.
+	static Settings run(int renderWidth, int renderHeight, const OptionsSnapshot &options,
+		TextureManager &textureManager, JobSystem &jobSystem);
+};
+
+#endif
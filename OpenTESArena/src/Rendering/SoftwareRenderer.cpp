@@ -1,33 +1,180 @@
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <limits>
-#include <thread>
 
+#include "FrameTranspose.h"
 #include "SoftwareRenderer.h"
+#include "../Math/BatchMath.h"
 #include "../Math/Constants.h"
-#include "../Media/Color.h"
+#include "../Utilities/Bytes.h"
 #include "../Utilities/Debug.h"
-#include "../Utilities/Platform.h"
+#include "../Utilities/JobSystem.h"
+#include "../Utilities/MemoryTracker.h"
+#include "../Utilities/Profiler.h"
 #include "../World/VoxelData.h"
 #include "../World/VoxelDataType.h"
 #include "../World/VoxelGrid.h"
 
+SoftwareRenderer::ThreadTimes::ThreadTimes()
+{
+	this->busySeconds = 0.0;
+	this->idleSeconds = 0.0;
+}
+
+SoftwareRenderer::RenderStats::RenderStats()
+{
+	this->voxelSteps = 0;
+	this->voxelColumns = 0;
+	this->occludedColumns = 0;
+	this->wallPixels = 0;
+	this->perspectivePixels = 0;
+	this->transparentPixels = 0;
+	this->flatPixels = 0;
+	this->flatFragments = 0;
+	this->clearedPixels = 0;
+	this->depthRejects = 0;
+	this->occludedFlatColumns = 0;
+	this->visibleFlats = 0;
+	this->flatDraws = 0;
+	this->castColumns = 0;
+	this->reusedColumns = 0;
+	this->interpolatedColumns = 0;
+	this->foveatedColumns = 0;
+	this->setupSeconds = 0.0;
+	this->voxelSeconds = 0.0;
+	this->flatSeconds = 0.0;
+}
+
+void SoftwareRenderer::RenderStats::add(const RenderStats &other)
+{
+	this->voxelSteps += other.voxelSteps;
+	this->voxelColumns += other.voxelColumns;
+	this->occludedColumns += other.occludedColumns;
+	this->wallPixels += other.wallPixels;
+	this->perspectivePixels += other.perspectivePixels;
+	this->transparentPixels += other.transparentPixels;
+	this->flatPixels += other.flatPixels;
+	this->flatFragments += other.flatFragments;
+	this->clearedPixels += other.clearedPixels;
+	this->depthRejects += other.depthRejects;
+	this->occludedFlatColumns += other.occludedFlatColumns;
+	this->visibleFlats += other.visibleFlats;
+	this->flatDraws += other.flatDraws;
+	this->castColumns += other.castColumns;
+	this->reusedColumns += other.reusedColumns;
+	this->interpolatedColumns += other.interpolatedColumns;
+	this->foveatedColumns += other.foveatedColumns;
+	this->setupSeconds += other.setupSeconds;
+	this->voxelSeconds += other.voxelSeconds;
+	this->flatSeconds += other.flatSeconds;
+}
+
 SoftwareRenderer::VoxelTexel::VoxelTexel()
 {
-	this->r = 0.0;
-	this->g = 0.0;
-	this->b = 0.0;
-	this->a = 0.0;
-	this->emission = 0.0;
+	this->r = 0;
+	this->g = 0;
+	this->b = 0;
+	this->a = 0;
+	this->emission = 0;
+	this->index = 0;
+	this->light = 0;
 }
 
 SoftwareRenderer::FlatTexel::FlatTexel()
 {
-	this->r = 0.0;
-	this->g = 0.0;
-	this->b = 0.0;
-	this->a = 0.0;
+	this->r = 0;
+	this->g = 0;
+	this->b = 0;
+	this->a = 0;
+}
+
+int SoftwareRenderer::VoxelTexture::getTexelIndex(int x, int y, int mipWidth)
+{
+	return y + (x * mipWidth);
+}
+
+const SoftwareRenderer::VoxelTexel *SoftwareRenderer::VoxelTexture::getMipTexels(
+	int level) const
+{
+	if (level == 0)
+	{
+		return this->texels.data();
+	}
+
+	// Skip past the smaller levels' texels that come before this one.
+	int offset = 0;
+	for (int i = 1; i < level; i++)
+	{
+		const int levelWidth = VoxelTexture::WIDTH >> i;
+		offset += levelWidth * levelWidth;
+	}
+
+	return this->mipTexels.data() + offset;
+}
+
+void SoftwareRenderer::VoxelTexture::generateMipmaps()
+{
+	const VoxelTexel *srcTexels = this->texels.data();
+	VoxelTexel *dstTexels = this->mipTexels.data();
+
+	for (int level = 1; level < VoxelTexture::MIP_LEVEL_COUNT; level++)
+	{
+		const int srcWidth = VoxelTexture::WIDTH >> (level - 1);
+		const int dstWidth = VoxelTexture::WIDTH >> level;
+
+		for (int y = 0; y < dstWidth; y++)
+		{
+			for (int x = 0; x < dstWidth; x++)
+			{
+				// Average each 2x2 block of texels. The result is opaque if most of the block 
+				// is, and only opaque texels contribute their color so transparent edges 
+				// don't darken it.
+				const std::array<const VoxelTexel*, 4> block =
+				{
+					&srcTexels[VoxelTexture::getTexelIndex(x * 2, y * 2, srcWidth)],
+					&srcTexels[VoxelTexture::getTexelIndex((x * 2) + 1, y * 2, srcWidth)],
+					&srcTexels[VoxelTexture::getTexelIndex(x * 2, (y * 2) + 1, srcWidth)],
+					&srcTexels[VoxelTexture::getTexelIndex((x * 2) + 1, (y * 2) + 1, srcWidth)]
+				};
+
+				int r = 0, g = 0, b = 0, emission = 0, light = 0, opaqueCount = 0;
+				for (const VoxelTexel *texel : block)
+				{
+					if (texel->a > 0)
+					{
+						r += texel->r;
+						g += texel->g;
+						b += texel->b;
+						emission += texel->emission;
+						light += texel->light;
+						opaqueCount++;
+					}
+				}
+
+				VoxelTexel &dstTexel = dstTexels[VoxelTexture::getTexelIndex(x, y, dstWidth)];
+				if (opaqueCount > 0)
+				{
+					dstTexel.r = static_cast<uint8_t>(r / opaqueCount);
+					dstTexel.g = static_cast<uint8_t>(g / opaqueCount);
+					dstTexel.b = static_cast<uint8_t>(b / opaqueCount);
+					dstTexel.emission = static_cast<uint8_t>(emission / opaqueCount);
+					dstTexel.light = static_cast<uint8_t>(light / opaqueCount);
+				}
+				else
+				{
+					dstTexel = VoxelTexel();
+				}
+
+				dstTexel.a = (opaqueCount >= 2) ? 255 : 0;
+			}
+		}
+
+		srcTexels = dstTexels;
+		dstTexels += dstWidth * dstWidth;
+	}
 }
 
 SoftwareRenderer::Camera::Camera(const Double3 &eye, const Double3 &direction,
@@ -113,6 +260,88 @@ SoftwareRenderer::Camera::Camera(const Double3 &eye, const Double3 &direction,
 		// but it would result in far too much skewing.
 		return std::tan(angleRadians) * this->zoom;
 	}();
+
+	DebugAssert(this->transform.y.w == 0.0, "Projected W shouldn't depend on height.");
+}
+
+SoftwareRenderer::HeightProjector::HeightProjector(const Double2 &point, const Camera &camera,
+	double frameHeight)
+{
+	// Projected Y and W of the point at height zero.
+	const Matrix4d &transform = camera.transform;
+	const double projectedY = (transform.x.y * point.x) + (transform.z.y * point.y) +
+		transform.w.y;
+	const double projectedW = (transform.x.w * point.x) + (transform.z.w * point.y) +
+		transform.w.w;
+
+	// Screen Y is relative to the center row of the screen, offset by the Y-shear. The 0.5
+	// is for the correct aspect ratio.
+	const double scale = (-0.50 * frameHeight) / projectedW;
+	this->screenY0 = ((0.50 + camera.yShear) * frameHeight) + (projectedY * scale);
+	this->screenYPerHeight = transform.y.y * scale;
+}
+
+double SoftwareRenderer::HeightProjector::getScreenY(double y) const
+{
+	return this->screenY0 + (this->screenYPerHeight * y);
+}
+
+int SoftwareRenderer::FlatList::getCount() const
+{
+	return static_cast<int>(this->ids.size());
+}
+
+const SoftwareRenderer::FlatArchetype &SoftwareRenderer::FlatList::getArchetype(
+	int flatIndex) const
+{
+	return this->archetypes[this->archetypeIndices[flatIndex]];
+}
+
+int SoftwareRenderer::FlatList::acquireArchetype(double width, double height)
+{
+	// There are only as many archetypes as distinct sizes in the level, so a search is
+	// cheap enough.
+	int freeIndex = -1;
+	for (int i = 0; i < static_cast<int>(this->archetypes.size()); i++)
+	{
+		FlatArchetype &archetype = this->archetypes[i];
+		if (archetype.flatCount == 0)
+		{
+			if (freeIndex == -1)
+			{
+				freeIndex = i;
+			}
+		}
+		else if ((archetype.width == width) && (archetype.height == height))
+		{
+			archetype.flatCount++;
+			return i;
+		}
+	}
+
+	if (freeIndex == -1)
+	{
+		freeIndex = static_cast<int>(this->archetypes.size());
+		this->archetypes.push_back(FlatArchetype());
+	}
+
+	FlatArchetype &archetype = this->archetypes[freeIndex];
+	archetype.width = width;
+	archetype.height = height;
+	archetype.flatCount = 1;
+	return freeIndex;
+}
+
+void SoftwareRenderer::FlatList::releaseArchetype(int archetypeIndex)
+{
+	FlatArchetype &archetype = this->archetypes.at(archetypeIndex);
+	DebugAssert(archetype.flatCount > 0, "Flat archetype not in use.");
+	archetype.flatCount--;
+}
+
+SoftwareRenderer::FlatChunk::FlatChunk()
+{
+	this->maxHalfWidth = 0.0;
 }
 
 SoftwareRenderer::Ray::Ray(double dirX, double dirZ)
@@ -121,47 +350,43 @@ SoftwareRenderer::Ray::Ray(double dirX, double dirZ)
 	this->dirZ = dirZ;
 }
 
-SoftwareRenderer::OcclusionData::OcclusionData(int yMin, int yMax)
+SoftwareRenderer::OcclusionData::OcclusionData(int yMin, int yMax, bool culling)
 {
 	this->yMin = yMin;
 	this->yMax = yMax;
+	this->culling = culling;
+	this->depthTest = !culling;
+	this->hasFlats = false;
 }
 
 SoftwareRenderer::OcclusionData::OcclusionData()
-	: OcclusionData(0, 0) { }
+	: OcclusionData(0, 0, false) { }
 
 void SoftwareRenderer::OcclusionData::clipRange(int *yStart, int *yEnd) const
 {
-	// To do.
-
-	/*const bool occluded = (*yEnd <= this->yMin) || (*yStart >= this->yMax);
-
-	if (occluded)
+	if (!this->culling)
 	{
-		// The drawing range is completely hidden.
-		*yStart = *yEnd;
+		return;
 	}
-	else
-	{
-		// To do: need to handle more cases (yStart == yEnd, outside of screen, etc.).
 
-		// Clip the drawing range.
-		*yStart = std::max(*yStart, this->yMin);
-		*yEnd = std::min(*yEnd, this->yMax);
-	}*/
+	// Clip the drawing range to the unoccluded part of the column. If it's completely
+	// hidden, the range becomes empty.
+	*yStart = std::max(*yStart, this->yMin);
+	*yEnd = std::max(std::min(*yEnd, this->yMax), *yStart);
 }
 
 void SoftwareRenderer::OcclusionData::update(int yStart, int yEnd)
 {
-	// To do.
+	if (!this->culling || (yStart >= yEnd))
+	{
+		return;
+	}
 
-	// Slightly different than clipRange() because values just needs to be adjacent
-	// rather than overlap.
-	/*const bool canIncreaseMin = yStart <= this->yMin;
+	// The range has already been clipped, so it can only grow the occluded range if it 
+	// starts exactly at the min or ends exactly at the max.
+	const bool canIncreaseMin = yStart <= this->yMin;
 	const bool canDecreaseMax = yEnd >= this->yMax;
 
-	// To do: need to handle more cases (yStart == yEnd, outside of screen, etc.).
-
 	// Determine how to update the occlusion ranges.
 	if (canIncreaseMin && canDecreaseMax)
 	{
@@ -176,1598 +401,6372 @@ void SoftwareRenderer::OcclusionData::update(int yStart, int yEnd)
 	else if (canDecreaseMax)
 	{
 		this->yMax = std::max(yStart, this->yMin);
-	}*/
+	}
+	else
+	{
+		// A range in the middle of the column can't be represented by the min and max,
+		// so depth testing has to take over from here.
+		this->depthTest = true;
+	}
 }
 
-SoftwareRenderer::ShadingInfo::ShadingInfo(const Double3 &horizonSkyColor, 
-	const Double3 &zenithSkyColor, const Double3 &sunColor, 
-	const Double3 &sunDirection, double ambient, double fogDistance)
-	: horizonSkyColor(horizonSkyColor), zenithSkyColor(zenithSkyColor),
-	sunColor(sunColor), sunDirection(sunDirection)
+void SoftwareRenderer::OcclusionData::updateTransparent(int yStart, int yEnd)
 {
-	this->ambient = ambient;
-	this->fogDistance = fogDistance;
+	if (yStart < yEnd)
+	{
+		this->depthTest = true;
+	}
 }
 
-SoftwareRenderer::FrameView::FrameView(uint32_t *colorBuffer, double *depthBuffer, 
-	int width, int height)
+bool SoftwareRenderer::OcclusionData::writesDepth() const
 {
-	this->colorBuffer = colorBuffer;
-	this->depthBuffer = depthBuffer;
-	this->width = width;
-	this->height = height;
-	this->widthReal = static_cast<double>(width);
-	this->heightReal = static_cast<double>(height);
+	return this->depthTest || this->hasFlats;
 }
 
-const double SoftwareRenderer::NEAR_PLANE = 0.0001;
-const double SoftwareRenderer::FAR_PLANE = 1000.0;
+SoftwareRenderer::LightGrid::LightGrid()
+{
+	this->originX = 0;
+	this->originZ = 0;
+	this->width = 0;
+	this->depth = 0;
+}
 
-SoftwareRenderer::SoftwareRenderer(int width, int height)
+const std::vector<const SoftwareRenderer::Light*> *SoftwareRenderer::LightGrid::getLights(
+	int voxelX, int voxelZ) const
 {
-	// Initialize 2D frame buffer.
-	const int pixelCount = width * height;
-	this->depthBuffer = std::vector<double>(pixelCount,
-		std::numeric_limits<double>::infinity());
+	const int cellX = voxelX - this->originX;
+	const int cellZ = voxelZ - this->originZ;
+	if ((cellX < 0) || (cellX >= this->width) || (cellZ < 0) || (cellZ >= this->depth))
+	{
+		return nullptr;
+	}
 
-	// Initialize occlusion columns.
-	this->occlusion = std::vector<OcclusionData>(width, OcclusionData(0, height));
+	const std::vector<const Light*> &cell = this->cells[cellX + (cellZ * this->width)];
+	return (cell.size() > 0) ? &cell : nullptr;
+}
 
-	// Initialize flat textures to empty.
-	for (auto &texture : this->flatTextures)
+double SoftwareRenderer::LightGrid::getLightLevel(const Double2 &point) const
+{
+	const std::vector<const Light*> *cellLights = this->getLights(
+		static_cast<int>(std::floor(point.x)), static_cast<int>(std::floor(point.y)));
+
+	if (cellLights == nullptr)
 	{
-		texture.texels = std::vector<FlatTexel>();
-		texture.width = 0;
-		texture.height = 0;
+		return 0.0;
 	}
 
-	this->width = width;
-	this->height = height;
+	double lightLevel = 0.0;
+	for (const Light *light : *cellLights)
+	{
+		const Double2 diff(point.x - light->point.x, point.y - light->point.z);
+		const double distSqr = (diff.x * diff.x) + (diff.y * diff.y);
+		const double radiusSqr = light->intensity * light->intensity;
 
-	// Obtain the number of threads to use.
-	this->renderThreadCount = Platform::getThreadCount();
+		if (distSqr < radiusSqr)
+		{
+			// Emission is a single channel, so a light adds the brightness of its color.
+			const double brightness = (light->color.x + light->color.y + light->color.z) / 3.0;
+			lightLevel += brightness * (1.0 - (std::sqrt(distSqr) / light->intensity));
+		}
+	}
 
-	// Fog distance is zero by default.
-	this->fogDistance = 0.0;
+	return lightLevel;
 }
 
-void SoftwareRenderer::addFlat(int id, const Double3 &position, double width, 
-	double height, int textureID)
+SoftwareRenderer::ShadingInfo::ShadingInfo(const Double3 &horizonSkyColor, 
+	const Double3 &zenithSkyColor, const Double3 &sunColor, 
+	const Double3 &sunDirection, double ambient, double fogDistance, 
+	const Double3 &flatNormal, int maxMipLevel)
+	: horizonSkyColor(horizonSkyColor), zenithSkyColor(zenithSkyColor),
+	sunColor(sunColor), sunDirection(sunDirection)
 {
-	// Verify that the ID is not already in use.
-	DebugAssert(this->flats.find(id) == this->flats.end(), 
-		"Flat ID \"" + std::to_string(id) + "\" already taken.");
+	this->ambient = ambient;
+	this->fogDistance = fogDistance;
+	this->maxMipLevel = maxMipLevel;
+	this->perspectiveSpanLength = 1;
+
+	// Shading for each axis-aligned and diagonal normal, in the same order as
+	// getNormalIndex().
+	const double diagonal = 0.7071068;
+	this->normalShadings[0] = this->calculateShading(Double3::UnitX);
+	this->normalShadings[1] = this->calculateShading(-Double3::UnitX);
+	this->normalShadings[2] = this->calculateShading(Double3::UnitY);
+	this->normalShadings[3] = this->calculateShading(-Double3::UnitY);
+	this->normalShadings[4] = this->calculateShading(Double3::UnitZ);
+	this->normalShadings[5] = this->calculateShading(-Double3::UnitZ);
+	this->normalShadings[6] = this->calculateShading(Double3(diagonal, 0.0, diagonal));
+	this->normalShadings[7] = this->calculateShading(Double3(diagonal, 0.0, -diagonal));
+	this->normalShadings[8] = this->calculateShading(Double3(-diagonal, 0.0, diagonal));
+	this->normalShadings[9] = this->calculateShading(Double3(-diagonal, 0.0, -diagonal));
+	this->flatShading = this->calculateShading(flatNormal);
+
+	// Fog increases linearly up to the fog distance. Depths are rounded to the nearest
+	// table entry, and anything past the end is at maximum fog.
+	const double maxIndex = static_cast<double>(ShadingInfo::FOG_TABLE_SIZE - 1);
+	for (int i = 0; i < ShadingInfo::FOG_TABLE_SIZE; i++)
+	{
+		this->fogPercents[i] = static_cast<double>(i) / maxIndex;
+	}
 
-	SoftwareRenderer::Flat flat;
-	flat.position = position;
-	flat.width = width;
-	flat.height = height;
-	flat.textureID = textureID;
-	flat.flipped = false; // The initial value doesn't matter; it's updated frequently.
+	this->fogDepthScale = maxIndex / fogDistance;
+	this->lightGrid = nullptr;
+	this->lightMap = nullptr;
+	this->columnRays = nullptr;
+	this->nightLightsActive = false;
+	this->nightLightIndex = 0;
+	this->paletteShades = nullptr;
+	this->cycledIndices = nullptr;
+	this->deferred = false;
+	this->skyRowColors = nullptr;
+	this->doorOpenPercents = nullptr;
+}
+
+Double3 SoftwareRenderer::ShadingInfo::calculateShading(const Double3 &normal) const
+{
+	// Contribution from the sun.
+	const double lightNormalDot = std::max(0.0, this->sunDirection.dot(normal));
+	const Double3 sunComponent = (this->sunColor * lightNormalDot).clamped(
+		0.0, 1.0 - this->ambient);
 
-	// Add the flat (sprite, door, store sign, etc.).
-	this->flats.insert(std::make_pair(id, flat));
+	// - To do: contribution from lights.
+	return Double3(
+		this->ambient + sunComponent.x,
+		this->ambient + sunComponent.y,
+		this->ambient + sunComponent.z);
 }
 
-void SoftwareRenderer::addLight(int id, const Double3 &point, const Double3 &color, 
-	double intensity)
+int SoftwareRenderer::ShadingInfo::getNormalIndex(const Double3 &normal) const
 {
-	DebugNotImplemented();
+	// Diagonal walls are the only surfaces with both X and Z in their normal. Every other
+	// normal is on exactly one axis, so its non-zero component decides the index.
+	if ((normal.x != 0.0) && (normal.z != 0.0))
+	{
+		return 6 + ((normal.x > 0.0) ? 0 : 2) + ((normal.z > 0.0) ? 0 : 1);
+	}
+	else if (normal.x != 0.0)
+	{
+		return (normal.x > 0.0) ? 0 : 1;
+	}
+	else if (normal.y != 0.0)
+	{
+		return (normal.y > 0.0) ? 2 : 3;
+	}
+	else
+	{
+		return (normal.z > 0.0) ? 4 : 5;
+	}
 }
 
-void SoftwareRenderer::setVoxelTexture(int id, const uint32_t *srcTexels)
+const Double3 &SoftwareRenderer::ShadingInfo::getNormalShading(const Double3 &normal) const
 {
-	// Clear the selected texture.
-	VoxelTexture &texture = this->voxelTextures.at(id);
-	std::fill(texture.texels.begin(), texture.texels.end(), VoxelTexel());
-	texture.lightTexels.clear();
+	return this->normalShadings[this->getNormalIndex(normal)];
+}
 
-	for (int y = 0; y < VoxelTexture::HEIGHT; y++)
-	{
-		for (int x = 0; x < VoxelTexture::WIDTH; x++)
-		{
-			// To do: change this calculation for rotated textures. Make sure to have a 
-			// source index and destination index.
-			// - "dstX" and "dstY" should be calculated, and also used with lightTexels.
-			const int index = x + (y * VoxelTexture::WIDTH);
-
-			// Convert ARGB color from integer to double-precision format. This does waste
-			// an extreme amount of memory (32 bytes per pixel!), but it's not a big deal
-			// for Arena's textures (eight textures is a megabyte).
-			const Double4 srcTexel = Double4::fromARGB(srcTexels[index]);
-			VoxelTexel &dstTexel = texture.texels[index];
-			dstTexel.r = srcTexel.x;
-			dstTexel.g = srcTexel.y;
-			dstTexel.b = srcTexel.z;
-			dstTexel.a = srcTexel.w;
-
-			// If it's a white texel, it's used with night lights (i.e., yellow at night).
-			const bool isWhite = (srcTexel.x == 1.0) && (srcTexel.y == 1.0) && (srcTexel.z == 1.0);
+const Double3 &SoftwareRenderer::ShadingInfo::getShading(int shadingIndex) const
+{
+	return (shadingIndex == ShadingInfo::FLAT_SHADING_INDEX) ? this->flatShading :
+		this->normalShadings[shadingIndex];
+}
 
-			if (isWhite)
-			{
-				texture.lightTexels.push_back(Int2(x, y));
-			}
-		}
-	}
+double SoftwareRenderer::ShadingInfo::getFogPercent(double depth) const
+{
+	// A zero fog distance gives an infinite (or NaN) scaled depth, which falls through
+	// to maximum fog like the division it replaces.
+	const double scaledDepth = (depth * this->fogDepthScale) + 0.50;
+	const int index = (scaledDepth < static_cast<double>(ShadingInfo::FOG_TABLE_SIZE)) ?
+		static_cast<int>(scaledDepth) : (ShadingInfo::FOG_TABLE_SIZE - 1);
+	return this->fogPercents[index];
 }
 
-void SoftwareRenderer::setFlatTexture(int id, const uint32_t *srcTexels, int width, int height)
+double SoftwareRenderer::ShadingInfo::getDoorOpenPercent(int voxelX, int voxelY,
+	int voxelZ) const
 {
-	const int texelCount = width * height;
+	// Most of the time every door is closed, so there's nothing to look up.
+	if ((this->doorOpenPercents == nullptr) || this->doorOpenPercents->empty())
+	{
+		return 0.0;
+	}
 
-	// Reset the selected texture.
-	FlatTexture &texture = this->flatTextures.at(id);
-	texture.texels = std::vector<FlatTexel>(texelCount);
-	texture.width = width;
-	texture.height = height;
+	const auto iter = this->doorOpenPercents->find(Int3(voxelX, voxelY, voxelZ));
+	return (iter != this->doorOpenPercents->end()) ? iter->second : 0.0;
+}
 
-	for (int i = 0; i < texelCount; i++)
+const uint32_t *SoftwareRenderer::ShadingInfo::getPaletteShades(const Double3 &normal) const
+{
+	if (this->paletteShades == nullptr)
 	{
-		const Double4 srcTexel = Double4::fromARGB(srcTexels[i]);
-		FlatTexel &dstTexel = texture.texels[i];
-		dstTexel.r = srcTexel.x;
-		dstTexel.g = srcTexel.y;
-		dstTexel.b = srcTexel.z;
-		dstTexel.a = srcTexel.w;
+		return nullptr;
 	}
+
+	const int tableSize = SoftwareRenderer::PALETTE_FOG_LEVELS * SoftwareRenderer::PALETTE_SIZE;
+	return this->paletteShades + (this->getNormalIndex(normal) * tableSize);
 }
 
-void SoftwareRenderer::updateFlat(int id, const Double3 *position, const double *width, 
-	const double *height, const int *textureID, const bool *flipped)
+int SoftwareRenderer::ShadingInfo::getPaletteFogLevel(double fogPercent) const
 {
-	const auto flatIter = this->flats.find(id);
-	DebugAssert(flatIter != this->flats.end(), 
-		"Cannot update a non-existent flat (" + std::to_string(id) + ").");
+	const double maxLevel = static_cast<double>(SoftwareRenderer::PALETTE_FOG_LEVELS - 1);
+	return static_cast<int>((fogPercent * maxLevel) + 0.50);
+}
 
-	SoftwareRenderer::Flat &flat = flatIter->second;
+uint32_t SoftwareRenderer::ShadingInfo::getPaletteColor(uint8_t index, uint8_t emission,
+	const uint32_t *shades, int fogLevel) const
+{
+	// Emissive texels use the table after the normal shadings, which is unaffected by light.
+	const int tableSize = SoftwareRenderer::PALETTE_FOG_LEVELS * SoftwareRenderer::PALETTE_SIZE;
+	const uint32_t *table = (emission >= 128) ?
+		(this->paletteShades + (static_cast<int>(this->normalShadings.size()) * tableSize)) :
+		shades;
 
-	// Check which values requested updating and update them.
-	if (position != nullptr)
-	{
-		flat.position = *position;
-	}
+	return table[(fogLevel * SoftwareRenderer::PALETTE_SIZE) + index];
+}
 
-	if (width != nullptr)
+const uint8_t *SoftwareRenderer::ShadingInfo::getCycledIndices(
+	const VoxelData::ChasmData &chasm) const
+{
+	if ((this->cycledIndices == nullptr) || (chasm.type == VoxelData::ChasmData::Type::Dry))
 	{
-		flat.width = *width;
+		return nullptr;
 	}
 
-	if (height != nullptr)
+	return this->cycledIndices + (chasm.id * SoftwareRenderer::PALETTE_SIZE);
+}
+
+SoftwareRenderer::VoxelTexel SoftwareRenderer::ShadingInfo::getLitTexel(
+	const VoxelTexel &texel) const
+{
+	if (!this->nightLightsActive || (texel.light == 0))
 	{
-		flat.height = *height;
+		return texel;
 	}
 
-	if (textureID != nullptr)
+	// Night light texels are black, so the light color scaled by coverage is added onto
+	// whatever a mip level averaged them with.
+	auto addLight = [&texel](uint8_t channel, uint32_t lightChannel)
 	{
-		flat.textureID = *textureID;
-	}
+		const int value = channel + ((static_cast<int>(lightChannel & 0xFF) * texel.light) / 255);
+		return static_cast<uint8_t>(std::min(value, 255));
+	};
+
+	const uint32_t lightColor = SoftwareRenderer::NIGHT_LIGHT_COLOR;
+	VoxelTexel litTexel = texel;
+	litTexel.r = addLight(texel.r, lightColor >> 16);
+	litTexel.g = addLight(texel.g, lightColor >> 8);
+	litTexel.b = addLight(texel.b, lightColor);
+	litTexel.emission = static_cast<uint8_t>(std::min(texel.emission + texel.light, 255));
 
-	if (flipped != nullptr)
+	// Mostly lit texels take the light's palette color.
+	if (texel.light >= 128)
 	{
-		flat.flipped = *flipped;
+		litTexel.index = this->nightLightIndex;
 	}
+
+	return litTexel;
 }
 
-void SoftwareRenderer::updateLight(int id, const Double3 *point,
-	const Double3 *color, const double *intensity)
+bool SoftwareRenderer::ShadingInfo::hasLights() const
 {
-	DebugNotImplemented();
+	return ((this->lightGrid != nullptr) && (this->lightGrid->cells.size() > 0)) ||
+		(this->lightMap != nullptr);
 }
 
-void SoftwareRenderer::setFogDistance(double fogDistance)
+bool SoftwareRenderer::ShadingInfo::hasColumnLights() const
 {
-	this->fogDistance = fogDistance;
+	return !this->deferred && this->hasLights();
 }
 
-void SoftwareRenderer::setSkyPalette(const uint32_t *colors, int count)
+Double2 SoftwareRenderer::ShadingInfo::getColumnPoint(int x, double depth) const
 {
-	this->skyPalette = std::vector<Double3>(count);
-
-	for (size_t i = 0; i < this->skyPalette.size(); i++)
-	{
-		this->skyPalette[i] = Double3::fromRGB(colors[i]);
-	}
+	const Double2 &ray = this->columnRays[x];
+	return Double2(this->eye2D.x + (ray.x * depth), this->eye2D.y + (ray.y * depth));
 }
 
-void SoftwareRenderer::setNightLightsActive(bool active)
+uint8_t SoftwareRenderer::ShadingInfo::getLightEmission(const Double2 &point) const
 {
-	// To do: activate lights (don't worry about textures).
-
-	// Change voxel texels based on whether it's night.
-	const Double4 texelColor = Double4::fromARGB(
-		(active ? Color(255, 166, 0) : Color::Black).toARGB());
-	const double texelEmission = active ? 1.0 : 0.0;
-
-	for (auto &voxelTexture : this->voxelTextures)
+	if (!this->hasLights())
 	{
-		auto &texels = voxelTexture.texels;
+		return 0;
+	}
 
-		for (const auto &lightTexels : voxelTexture.lightTexels)
-		{
-			const int index = lightTexels.x + (lightTexels.y * VoxelTexture::WIDTH);
+	// Light is added like emission, so it brightens texels without a separate shading pass.
+	// Static lights are one lookup in the light map, and only moving ones are summed here.
+	const double lightLevel = this->lightGrid->getLightLevel(point);
+	const int staticEmission = (this->lightMap != nullptr) ?
+		this->lightMap->getLightEmission(point) : 0;
+	const int dynamicEmission = static_cast<int>(std::min(lightLevel, 1.0) * 255.0);
+	return static_cast<uint8_t>(std::min(staticEmission + dynamicEmission, 255));
+}
 
-			VoxelTexel &texel = texels.at(index);
-			texel.r = texelColor.x;
-			texel.g = texelColor.y;
-			texel.b = texelColor.z;
-			texel.a = texelColor.w;
-			texel.emission = texelEmission;
-		}
-	}
+SoftwareRenderer::PlaneBuffer::PlaneBuffer()
+{
+	this->startX = 0;
+	this->yMin = 0;
+	this->yMax = 0;
 }
 
-void SoftwareRenderer::removeFlat(int id)
+void SoftwareRenderer::PlaneBuffer::reset(int startX)
 {
-	// Make sure the flat exists before removing it.
-	const auto flatIter = this->flats.find(id);
-	DebugAssert(flatIter != this->flats.end(), 
-		"Cannot remove a non-existent flat (" + std::to_string(id) + ").");
+	this->spans.clear();
+	this->startX = startX;
+	this->yMin = std::numeric_limits<int>::max();
+	this->yMax = 0;
+}
 
-	this->flats.erase(flatIter);
+SoftwareRenderer::FrameView::FrameView(uint32_t *colorBuffer, DepthValue *depthBuffer, 
+	int width, int height, bool columnMajor)
+{
+	this->colorBuffer = colorBuffer;
+	this->depthBuffer = depthBuffer;
+	this->width = width;
+	this->height = height;
+	this->widthReal = static_cast<double>(width);
+	this->heightReal = static_cast<double>(height);
+	this->xStride = columnMajor ? height : 1;
+	this->yStride = columnMajor ? 1 : width;
+	this->stats = nullptr;
+	this->planes = nullptr;
+	this->tileOcclusion = nullptr;
+	this->fragments = nullptr;
+	this->touchedVoxels = nullptr;
+	this->texelBuffer = nullptr;
+	this->shadingBuffer = nullptr;
+	this->columnParity = -1;
+	this->foveaStart = 0;
+	this->foveaEnd = width;
+	this->edgeColumnStride = 1;
+	this->overdrawCounts = nullptr;
+	this->columnCosts = nullptr;
 }
 
-void SoftwareRenderer::removeLight(int id)
+int SoftwareRenderer::FrameView::getIndex(int x, int y) const
 {
-	DebugNotImplemented();
+	return (x * this->xStride) + (y * this->yStride);
 }
 
-void SoftwareRenderer::clearTextures()
+bool SoftwareRenderer::FrameView::drawsColumn(int x) const
 {
-	for (auto &texture : this->voxelTextures)
+	if (this->columnParity >= 0)
 	{
-		std::fill(texture.texels.begin(), texture.texels.end(), VoxelTexel());
-		texture.lightTexels.clear();
+		return (x & 1) == this->columnParity;
 	}
 
-	for (auto &texture : this->flatTextures)
+	// The edges count out from the fovea, so the columns next to it are always blended
+	// from the fovea's outermost ones.
+	if (x < this->foveaStart)
 	{
-		std::fill(texture.texels.begin(), texture.texels.end(), FlatTexel());
-		texture.width = 0;
-		texture.height = 0;
+		return ((this->foveaStart - x) % this->edgeColumnStride) == 0;
+	}
+	else if (x >= this->foveaEnd)
+	{
+		return ((x - (this->foveaEnd - 1)) % this->edgeColumnStride) == 0;
 	}
+
+	return true;
 }
 
-void SoftwareRenderer::resize(int width, int height)
+void SoftwareRenderer::FrameView::addOverdraw(int index) const
 {
-	const int pixelCount = width * height;
-	this->depthBuffer.resize(pixelCount);
-	std::fill(this->depthBuffer.begin(), this->depthBuffer.end(), 
-		std::numeric_limits<double>::infinity());
+	if ((this->overdrawCounts != nullptr) && (this->overdrawCounts[index] < 255))
+	{
+		this->overdrawCounts[index]++;
+	}
+}
 
-	this->occlusion.resize(width);
-	std::fill(this->occlusion.begin(), this->occlusion.end(), OcclusionData(0, height));
+bool SoftwareRenderer::PixelBatch::add(uint8_t r, uint8_t g, uint8_t b, uint8_t emission,
+	double fogPercent, int index, DepthValue depth)
+{
+	const int i = this->span.count;
+	this->span.r[i] = r;
+	this->span.g[i] = g;
+	this->span.b[i] = b;
+	this->span.emission[i] = emission;
+	this->span.fogPercents[i] = fogPercent;
+	this->indices[i] = index;
+	this->depths[i] = depth;
+	this->span.count++;
+
+	return this->span.count == SpanShading::MAX_PIXELS;
+}
 
-	this->width = width;
-	this->height = height;
+const int SoftwareRenderer::FragmentBuffer::MAX_FRAGMENTS = 4;
+
+SoftwareRenderer::FragmentBuffer::FragmentBuffer()
+{
+	this->columnYMins = std::vector<int>(SoftwareRenderer::COLUMN_TILE_WIDTH);
+	this->columnYMaxes = std::vector<int>(SoftwareRenderer::COLUMN_TILE_WIDTH);
+	this->startX = 0;
+	this->height = 0;
+	this->reset(0, 0);
 }
 
-void SoftwareRenderer::updateVisibleFlats(const Camera &camera)
+void SoftwareRenderer::FragmentBuffer::reset(int startX, int height)
 {
-	this->visibleFlats.clear();
+	if (this->height != height)
+	{
+		this->fragments.clear();
+		this->counts.clear();
+		this->height = height;
+	}
 
-	// Each flat shares the same axes. The forward direction always faces opposite to 
-	// the camera direction.
-	const Double3 flatForward = Double3(-camera.forwardX, 0.0, -camera.forwardZ).normalized();
-	const Double3 flatUp = Double3::UnitY;
-	const Double3 flatRight = flatForward.cross(flatUp).normalized();
+	this->startX = startX;
+	std::fill(this->columnYMins.begin(), this->columnYMins.end(),
+		std::numeric_limits<int>::max());
+	std::fill(this->columnYMaxes.begin(), this->columnYMaxes.end(), 0);
+}
 
-	const Double2 eye2D(camera.eye.x, camera.eye.z);
-	const Double2 direction(camera.forwardX, camera.forwardZ);
+void SoftwareRenderer::FragmentBuffer::add(int x, int y, DepthValue depth, uint32_t color,
+	uint8_t alpha)
+{
+	// Most scenes have no translucent flats, so the buffer isn't made until one is drawn.
+	const int pixelCount = SoftwareRenderer::COLUMN_TILE_WIDTH * this->height;
+	if (this->counts.size() != static_cast<size_t>(pixelCount))
+	{
+		this->fragments = std::vector<Fragment>(pixelCount * FragmentBuffer::MAX_FRAGMENTS);
+		this->counts = std::vector<uint8_t>(pixelCount, 0);
+	}
+
+	const int column = x - this->startX;
+	const int pixelIndex = y + (column * this->height);
+	Fragment *pixelFragments = this->fragments.data() +
+		(pixelIndex * FragmentBuffer::MAX_FRAGMENTS);
+	uint8_t &count = this->counts[pixelIndex];
+
+	Fragment fragment;
+	fragment.depth = depth;
+	fragment.color = color;
+	fragment.alpha = alpha;
 
-	// This is the visible flat determination algorithm. It goes through all flats and sees 
-	// which ones would be at least partially visible in the view frustum.
-	for (const auto &pair : this->flats)
+	if (count < FragmentBuffer::MAX_FRAGMENTS)
 	{
-		const Flat &flat = pair.second;
+		pixelFragments[count] = fragment;
+		count++;
+	}
+	else
+	{
+		// The farthest fragment is the one that would be covered the most.
+		Fragment *farthest = std::max_element(pixelFragments,
+			pixelFragments + FragmentBuffer::MAX_FRAGMENTS,
+			[](const Fragment &a, const Fragment &b) { return a.depth < b.depth; });
 
-		// Scaled axes based on flat dimensions.
-		const Double3 flatRightScaled = flatRight * (flat.width * 0.50);
-		const Double3 flatUpScaled = flatUp * flat.height;
-		
-		// Calculate each corner of the flat in world space.
-		Flat::Frame flatFrame;
-		flatFrame.bottomStart = flat.position + flatRightScaled;
-		flatFrame.bottomEnd = flat.position - flatRightScaled;
-		flatFrame.topStart = flatFrame.bottomStart + flatUpScaled;
-		flatFrame.topEnd = flatFrame.bottomEnd + flatUpScaled;
-
-		// If the flat is somewhere in front of the camera, do further checks.
-		const Double2 flatPosition2D(flat.position.x, flat.position.z);
-		const Double2 flatEyeDiff = (flatPosition2D - eye2D).normalized();
-		const bool inFrontOfCamera = direction.dot(flatEyeDiff) > 0.0;
-
-		if (inFrontOfCamera)
-		{
-			// Now project two of the flat's opposing corner points into camera space.
-			// The Z value is used with flat sorting (not rendering), and the X and Y values 
-			// are used to find where the flat is on-screen.
-			Double4 projStart = camera.transform * Double4(flatFrame.topStart, 1.0);
-			Double4 projEnd = camera.transform * Double4(flatFrame.bottomEnd, 1.0);
-
-			// Normalize coordinates.
-			projStart = projStart / projStart.w;
-			projEnd = projEnd / projEnd.w;
-
-			// Assign each screen value to the flat frame data.
-			flatFrame.startX = 0.50 + (projStart.x * 0.50);
-			flatFrame.endX = 0.50 + (projEnd.x * 0.50);
-			flatFrame.startY = (0.50 + camera.yShear) - (projStart.y * 0.50);
-			flatFrame.endY = (0.50 + camera.yShear) - (projEnd.y * 0.50);
-			flatFrame.z = projStart.z;
-
-			// Check that the Z value is within the clipping planes.
-			const bool inPlanes = (flatFrame.z >= SoftwareRenderer::NEAR_PLANE) &&
-				(flatFrame.z <= SoftwareRenderer::FAR_PLANE);
-
-			if (inPlanes)
-			{
-				// Add the flat data to the draw list.
-				this->visibleFlats.push_back(std::make_pair(&flat, std::move(flatFrame)));
-			}
+		if (depth < farthest->depth)
+		{
+			*farthest = fragment;
 		}
 	}
 
-	// Sort the visible flats farthest to nearest (relevant for transparencies).
-	std::sort(this->visibleFlats.begin(), this->visibleFlats.end(),
-		[](const std::pair<const Flat*, Flat::Frame> &a,
-			const std::pair<const Flat*, Flat::Frame> &b)
-	{
-		return a.second.z > b.second.z;
-	});
+	this->columnYMins[column] = std::min(this->columnYMins[column], y);
+	this->columnYMaxes[column] = std::max(this->columnYMaxes[column], y + 1);
 }
 
-/*Double3 SoftwareRenderer::castRay(const Double3 &direction,
-	const VoxelGrid &voxelGrid) const
+void SoftwareRenderer::FragmentBuffer::resolve(const FrameView &frame)
 {
-	// This is an extension of Lode Vandevenne's DDA algorithm from 2D to 3D.
-	// Technically, it could be considered a "3D-DDA" algorithm. It will eventually 
-	// have some additional features so all of Arena's geometry can be represented.
+	for (int column = 0; column < SoftwareRenderer::COLUMN_TILE_WIDTH; column++)
+	{
+		const int x = this->startX + column;
+		for (int y = this->columnYMins[column]; y < this->columnYMaxes[column]; y++)
+		{
+			const int pixelIndex = y + (column * this->height);
+			uint8_t &count = this->counts[pixelIndex];
+			if (count == 0)
+			{
+				continue;
+			}
 
-	// To do:
-	// - Figure out proper DDA lengths for variable-height voxels, and why using
-	//   voxelHeight squared instead of 1.0 in deltaDist.y looks weird (sideDist.y?).
-	// - Cuboids within voxels (bridges, beds, shelves) with variable Y offset and size.
-	// - Sprites (SpriteGrid? Sprite data, and list of sprite IDs per voxel).
-	// - Transparent textures (check texel alpha in DDA loop).
-	// - Sky (if hitID == 0).
-	// - Shading (shadows from the sun, point lights).
+			Fragment *pixelFragments = this->fragments.data() +
+				(pixelIndex * FragmentBuffer::MAX_FRAGMENTS);
+			const int index = frame.getIndex(x, y);
+			const DepthValue bufferDepth = frame.depthBuffer[index];
 
-	// Some floating point behavior assumptions:
-	// -> (value / 0.0) == infinity
-	// -> (value / infinity) == 0.0
-	// -> (int)(-0.8) == 0
-	// -> (int)floor(-0.8) == -1
-	// -> (int)ceil(-0.8) == 0
+			// Only fragments in front of the opaque pixels are seen, farthest first.
+			Fragment *visibleEnd = std::partition(pixelFragments, pixelFragments + count,
+				[bufferDepth](const Fragment &fragment) { return fragment.depth <= bufferDepth; });
+			std::sort(pixelFragments, visibleEnd,
+				[](const Fragment &a, const Fragment &b) { return a.depth > b.depth; });
 
-	const Double3 dirSquared(
-		direction.x * direction.x,
-		direction.y * direction.y,
-		direction.z * direction.z);
+			uint32_t dstColor = frame.colorBuffer[index];
+			for (const Fragment *fragment = pixelFragments; fragment != visibleEnd; fragment++)
+			{
+				const uint32_t srcAlpha = fragment->alpha;
+				const uint32_t dstAlpha = 255 - srcAlpha;
+				auto blend = [srcAlpha, dstAlpha](uint32_t src, uint32_t dst, int shift)
+				{
+					const uint32_t srcChannel = (src >> shift) & 0xFF;
+					const uint32_t dstChannel = (dst >> shift) & 0xFF;
+					const uint32_t channel =
+						((srcChannel * srcAlpha) + (dstChannel * dstAlpha) + 127) / 255;
+					return channel << shift;
+				};
+
+				dstColor = blend(fragment->color, dstColor, 16) |
+					blend(fragment->color, dstColor, 8) | blend(fragment->color, dstColor, 0);
+				frame.addOverdraw(index);
+			}
 
-	// Height (Y size) of each voxel in the voxel grid. Some levels in Arena have
-	// "tall" voxels, so the voxel height must be a variable.
-	const double voxelHeight = voxelGrid.getVoxelHeight();
+			frame.colorBuffer[index] = dstColor;
+			count = 0;
+		}
+	}
+}
 
-	// A custom variable that represents the Y "floor" of the current voxel.
-	const double eyeYRelativeFloor = std::floor(this->eye.y / voxelHeight) * voxelHeight;
+void SoftwareRenderer::FlatTexture::updateRuns()
+{
+	this->runs.clear();
+	this->columnRuns.resize(this->width + 1);
 
-	// Calculate delta distances along each axis. These determine how far
-	// the ray has to go until the next X, Y, or Z side is hit, respectively.
-	const Double3 deltaDist(
-		std::sqrt(1.0 + (dirSquared.y / dirSquared.x) + (dirSquared.z / dirSquared.x)),
-		std::sqrt(1.0 + (dirSquared.x / dirSquared.y) + (dirSquared.z / dirSquared.y)),
-		std::sqrt(1.0 + (dirSquared.x / dirSquared.z) + (dirSquared.y / dirSquared.z)));
+	for (int x = 0; x < this->width; x++)
+	{
+		this->columnRuns[x] = static_cast<int>(this->runs.size());
 
-	// Booleans for whether a ray component is non-negative. Used with step directions 
-	// and texture coordinates.
-	const bool nonNegativeDirX = direction.x >= 0.0;
-	const bool nonNegativeDirY = direction.y >= 0.0;
-	const bool nonNegativeDirZ = direction.z >= 0.0;
+		auto isOpaque = [this, x](int texelY)
+		{
+			return this->texels[x + (texelY * this->width)].a > 0;
+		};
 
-	// Calculate step directions and initial side distances.
-	Int3 step;
-	Double3 sideDist;
-	if (nonNegativeDirX)
-	{
-		step.x = 1;
-		sideDist.x = (this->startCellReal.x + 1.0 - this->eye.x) * deltaDist.x;
-	}
-	else
-	{
-		step.x = -1;
-		sideDist.x = (this->eye.x - this->startCellReal.x) * deltaDist.x;
-	}
+		int y = 0;
+		while (y < this->height)
+		{
+			if (!isOpaque(y))
+			{
+				y++;
+				continue;
+			}
 
-	if (nonNegativeDirY)
-	{
-		step.y = 1;
-		sideDist.y = (eyeYRelativeFloor + voxelHeight - this->eye.y) * deltaDist.y;
-	}
-	else
-	{
-		step.y = -1;
-		sideDist.y = (this->eye.y - eyeYRelativeFloor) * deltaDist.y;
+			OpaqueRun run;
+			run.start = y;
+			while ((y < this->height) && isOpaque(y))
+			{
+				y++;
+			}
+
+			run.count = y - run.start;
+			this->runs.push_back(run);
+		}
 	}
 
-	if (nonNegativeDirZ)
+	this->columnRuns[this->width] = static_cast<int>(this->runs.size());
+
+	// Average color of what a flat shows, for drawing it as a dot.
+	int opaqueCount = 0;
+	int r = 0, g = 0, b = 0;
+	for (const FlatTexel &texel : this->texels)
 	{
-		step.z = 1;
-		sideDist.z = (this->startCellReal.z + 1.0 - this->eye.z) * deltaDist.z;
+		if (texel.a > 0)
+		{
+			opaqueCount++;
+			r += texel.r;
+			g += texel.g;
+			b += texel.b;
+		}
 	}
-	else
+
+	this->averageTexel = FlatTexel();
+	if (opaqueCount > 0)
 	{
-		step.z = -1;
-		sideDist.z = (this->eye.z - this->startCellReal.z) * deltaDist.z;
+		this->averageTexel.r = static_cast<uint8_t>(r / opaqueCount);
+		this->averageTexel.g = static_cast<uint8_t>(g / opaqueCount);
+		this->averageTexel.b = static_cast<uint8_t>(b / opaqueCount);
+		this->averageTexel.a = 255;
 	}
 
-	// Make a copy of the initial side distances. They are used for the special case 
-	// of the ray ending in the same voxel it started in.
-	const Double3 initialSideDist = sideDist;
-
-	// Make a copy of the step magnitudes, converted to doubles.
-	const Double3 stepReal(
-		static_cast<double>(step.x),
-		static_cast<double>(step.y),
-		static_cast<double>(step.z));
+	const int texelCount = this->width * this->height;
+	this->coverage = (texelCount > 0) ?
+		(static_cast<double>(opaqueCount) / static_cast<double>(texelCount)) : 0.0;
+}
 
-	// Get initial voxel coordinates.
-	Int3 cell = this->startCell;
+void SoftwareRenderer::FlatTexture::makeHalfSize(const FlatTexture &texture)
+{
+	// Odd sizes round up, with the last row or column of blocks being one texel.
+	this->width = (texture.width + 1) / 2;
+	this->height = (texture.height + 1) / 2;
+	this->texels = std::vector<FlatTexel>(this->width * this->height);
 
-	// ID of a hit voxel. Zero (air) by default.
-	char hitID = 0;
+	for (int y = 0; y < this->height; y++)
+	{
+		const int srcYStart = y * 2;
+		const int srcYEnd = std::min(srcYStart + 2, texture.height);
 
-	// Axis of a hit voxel's side. X by default.
-	enum class Axis { X, Y, Z };
-	Axis axis = Axis::X;
+		for (int x = 0; x < this->width; x++)
+		{
+			const int srcXStart = x * 2;
+			const int srcXEnd = std::min(srcXStart + 2, texture.width);
+
+			// Only opaque texels contribute color, so edges don't darken towards the
+			// transparent black around them.
+			int blockCount = 0;
+			int opaqueCount = 0;
+			int r = 0, g = 0, b = 0, a = 0;
+			for (int srcY = srcYStart; srcY < srcYEnd; srcY++)
+			{
+				for (int srcX = srcXStart; srcX < srcXEnd; srcX++)
+				{
+					const FlatTexel &srcTexel = texture.texels[srcX + (srcY * texture.width)];
+					blockCount++;
 
-	// Distance squared (in voxels) that the ray has stepped. Square roots are
-	// too slow to use in the DDA loop, so this is used instead.
-	// - When using variable-sized voxels, this may be calculated differently.
-	double cellDistSquared = 0.0;
+					if (srcTexel.a > 0)
+					{
+						opaqueCount++;
+						r += srcTexel.r;
+						g += srcTexel.g;
+						b += srcTexel.b;
+						a += srcTexel.a;
+					}
+				}
+			}
 
-	// Offset values for which corner of a voxel to compare the distance 
-	// squared against. The correct corner to use is important when culling
-	// shapes at max view distance.
-	const Double3 startCellWithOffset(
-		this->startCellReal.x + ((1.0 + stepReal.x) / 2.0),
-		eyeYRelativeFloor + (((1.0 + stepReal.y) / 2.0) * voxelHeight),
-		this->startCellReal.z + ((1.0 + stepReal.z) / 2.0));
-	const Double3 cellOffset(
-		(1.0 - stepReal.x) / 2.0,
-		((1.0 - stepReal.y) / 2.0) * voxelHeight,
-		(1.0 - stepReal.z) / 2.0);
+			FlatTexel &dstTexel = this->texels[x + (y * this->width)];
+			if ((opaqueCount * 2) >= blockCount)
+			{
+				dstTexel.r = static_cast<uint8_t>(r / opaqueCount);
+				dstTexel.g = static_cast<uint8_t>(g / opaqueCount);
+				dstTexel.b = static_cast<uint8_t>(b / opaqueCount);
+				dstTexel.a = static_cast<uint8_t>(a / opaqueCount);
+			}
+		}
+	}
 
-	// Get dimensions of the voxel grid.
-	const int gridWidth = voxelGrid.getWidth();
-	const int gridHeight = voxelGrid.getHeight();
-	const int gridDepth = voxelGrid.getDepth();
+	this->updateRuns();
+}
 
-	// Check world bounds on the start voxel. Bounds are partially recalculated 
-	// for axes that the DDA loop is stepping through.
-	bool voxelIsValid = (cell.x >= 0) && (cell.y >= 0) && (cell.z >= 0) &&
-		(cell.x < gridWidth) && (cell.y < gridHeight) && (cell.z < gridDepth);
+size_t SoftwareRenderer::FlatTexture::getByteCount() const
+{
+	return (this->texels.capacity() * sizeof(FlatTexel)) +
+		(this->runs.capacity() * sizeof(OpaqueRun)) +
+		(this->columnRuns.capacity() * sizeof(int));
+}
 
-	// Step through the voxel grid while the current coordinate is valid and
-	// the total voxel distance stepped is less than the view distance.
-	// (Note that the "voxel distance" is not the same as "actual" distance.)
-	const char *voxels = voxelGrid.getVoxels();
-	while (voxelIsValid && (cellDistSquared < this->viewDistSquared))
+size_t SoftwareRenderer::FlatTextureSet::getByteCount() const
+{
+	size_t byteCount = this->texture.getByteCount();
+	for (const FlatTexture &lod : this->lods)
 	{
-		// Get the index of the current voxel in the voxel grid.
-		const int gridIndex = cell.x + (cell.y * gridWidth) +
-			(cell.z * gridWidth * gridHeight);
+		byteCount += lod.getByteCount();
+	}
 
-		// Check if the current voxel is solid.
-		const char voxelID = voxels[gridIndex];
+	return byteCount;
+}
 
-		if (voxelID > 0)
-		{
-			hitID = voxelID;
-			break;
-		}
+const int SoftwareRenderer::TileOcclusion::BAND_HEIGHT = 16;
 
-		if ((sideDist.x < sideDist.y) && (sideDist.x < sideDist.z))
-		{
-			sideDist.x += deltaDist.x;
-			cell.x += step.x;
-			axis = Axis::X;
-			voxelIsValid &= (cell.x >= 0) && (cell.x < gridWidth);
-		}
-		else if (sideDist.y < sideDist.z)
+void SoftwareRenderer::TileOcclusion::update(int startX, int endX,
+	const std::vector<OcclusionData> &occlusion, const FrameView &frame)
+{
+	const int bandHeight = TileOcclusion::BAND_HEIGHT;
+	const int bandCount = (frame.height + bandHeight - 1) / bandHeight;
+	const DepthValue infinity = std::numeric_limits<DepthValue>::infinity();
+	this->bandDepths.assign(bandCount, static_cast<DepthValue>(0));
+
+	for (int x = startX; x < endX; x++)
+	{
+		// Culled columns without flats might not have written depth for all of their
+		// pixels, but no flats are drawn in them either. The same goes for columns that
+		// interlacing skipped, which still have the depth of an earlier frame.
+		const OcclusionData &columnOcclusion = occlusion[x];
+		if ((columnOcclusion.culling && !columnOcclusion.hasFlats) || !frame.drawsColumn(x))
 		{
-			sideDist.y += deltaDist.y;
-			cell.y += step.y;
-			axis = Axis::Y;
-			voxelIsValid &= (cell.y >= 0) && (cell.y < gridHeight);
+			continue;
 		}
-		else
+
+		// A culled column's open range was given the background, which is infinitely far,
+		// so those rows don't have to be read.
+		const bool hasOpenRange = !columnOcclusion.depthTest &&
+			(columnOcclusion.yMin < columnOcclusion.yMax);
+
+		for (int band = 0; band < bandCount; band++)
 		{
-			sideDist.z += deltaDist.z;
-			cell.z += step.z;
-			axis = Axis::Z;
-			voxelIsValid &= (cell.z >= 0) && (cell.z < gridDepth);
-		}
+			DepthValue &bandDepth = this->bandDepths[band];
+			if (bandDepth == infinity)
+			{
+				continue;
+			}
 
-		// Refresh how far the current cell is from the start cell, squared.
-		// The "offsets" move each point to the correct corner for each voxel
-		// so that the stepping stops correctly at max view distance.
-		const Double3 cellDiff(
-			(static_cast<double>(cell.x) + cellOffset.x) - startCellWithOffset.x,
-			(static_cast<double>(cell.y) + cellOffset.y) - startCellWithOffset.y,
-			(static_cast<double>(cell.z) + cellOffset.z) - startCellWithOffset.z);
-		cellDistSquared = (cellDiff.x * cellDiff.x) + (cellDiff.y * cellDiff.y) +
-			(cellDiff.z * cellDiff.z);
+			const int bandStart = band * bandHeight;
+			const int bandEnd = std::min(bandStart + bandHeight, frame.height);
+			if (hasOpenRange && (columnOcclusion.yMin < bandEnd) &&
+				(columnOcclusion.yMax > bandStart))
+			{
+				bandDepth = infinity;
+				continue;
+			}
+
+			for (int y = bandStart; y < bandEnd; y++)
+			{
+				bandDepth = std::max(bandDepth, frame.depthBuffer[frame.getIndex(x, y)]);
+			}
+		}
 	}
+}
 
-	// Boolean for whether the ray ended in the same voxel it started in.
-	const bool stoppedInFirstVoxel = cell == this->startCell;
+bool SoftwareRenderer::TileOcclusion::isOccluded(int yStart, int yEnd, DepthValue depth) const
+{
+	if (yStart >= yEnd)
+	{
+		return false;
+	}
 
-	// Get the distance from the camera to the hit point. It is a special case
-	// if the ray stopped in the first voxel.
-	double distance;
-	if (stoppedInFirstVoxel)
+	const int startBand = yStart / TileOcclusion::BAND_HEIGHT;
+	const int endBand = (yEnd - 1) / TileOcclusion::BAND_HEIGHT;
+	for (int band = startBand; band <= endBand; band++)
 	{
-		if ((initialSideDist.x < initialSideDist.y) &&
-			(initialSideDist.x < initialSideDist.z))
+		// Flats pass the depth test when they're as near as the pixel.
+		if (depth <= this->bandDepths[band])
 		{
-			distance = initialSideDist.x;
-			axis = Axis::X;
-		}
-		else if (initialSideDist.y < initialSideDist.z)
-		{
-			distance = initialSideDist.y;
-			axis = Axis::Y;
-		}
-		else
-		{
-			distance = initialSideDist.z;
-			axis = Axis::Z;
+			return false;
 		}
 	}
-	else
-	{
-		const size_t axisIndex = static_cast<size_t>(axis);
 
-		// Assign to distance based on which axis was hit.
-		if (axis == Axis::X)
-		{
-			distance = (static_cast<double>(cell.x) - this->eye.x +
-				((1.0 - stepReal.x) / 2.0)) / direction.x;
-		}
-		else if (axis == Axis::Y)
-		{
-			distance = ((static_cast<double>(cell.y) * voxelHeight) - this->eye.y +
-				(((1.0 - stepReal.y) / 2.0) * voxelHeight)) / direction.y;
-		}
-		else
-		{
-			distance = (static_cast<double>(cell.z) - this->eye.z +
-				((1.0 - stepReal.z) / 2.0)) / direction.z;
-		}
-	}
+	return true;
+}
 
-	// If there was a hit, get the shaded color.
-	if (hitID > 0)
+const double SoftwareRenderer::NEAR_PLANE = 0.0001;
+const double SoftwareRenderer::FAR_PLANE = 1000.0;
+const int SoftwareRenderer::COLUMN_TILE_WIDTH = 16;
+const int SoftwareRenderer::PARALLEL_BLOCK_SIZE = 32;
+const int SoftwareRenderer::FLAT_CHUNK_SIZE = 16;
+const int SoftwareRenderer::PALETTE_SIZE = 256;
+const int SoftwareRenderer::PALETTE_FOG_LEVELS = 32;
+const uint32_t SoftwareRenderer::NIGHT_LIGHT_COLOR = 0xFFA600;
+const int SoftwareRenderer::MAX_FLAT_SORT_MOVES = 4;
+const int SoftwareRenderer::FLAT_LOD_COUNT = 2;
+const int SoftwareRenderer::TEXEL_ROW_FRACTION_BITS = 16;
+const double SoftwareRenderer::MIN_FLAT_PIXEL_COVERAGE = 0.25;
+const double SoftwareRenderer::FLAT_DOT_PIXEL_AREA = 1.0;
+const double SoftwareRenderer::COST_VIEW_VOXEL_STEP_WEIGHT = 4.0;
+const double SoftwareRenderer::COST_VIEW_FLAT_DRAW_WEIGHT = 16.0;
+const double SoftwareRenderer::RENDER_THREAD_BUDGET_TARGET = 0.50;
+const int SoftwareRenderer::RENDER_THREAD_SHRINK_FRAMES = 60;
+const double SoftwareRenderer::FOVEA_WIDTH_PERCENT = 0.50;
+
+SoftwareRenderer::SoftwareRenderer(int width, int height, JobSystem &jobSystem)
+	: jobSystem(jobSystem)
+{
+	// Initialize 2D frame buffer.
+	const int pixelCount = width * height;
+	this->depthBuffer = std::vector<DepthValue>(pixelCount,
+		std::numeric_limits<DepthValue>::infinity());
+
+	// Initialize occlusion columns.
+	this->occlusion = std::vector<OcclusionData>(width, OcclusionData(0, height, false));
+
+	// Column rays are made on the first frame.
+	this->columnRayZoom = 0.0;
+	this->columnRayAspect = 0.0;
+
+	// Voxel data types are read from the first voxel grid rendered.
+	this->voxelDataTypesGrid = nullptr;
+	this->voxelDataTypesRevision = 0;
+
+	// Initialize flat textures to an empty one with empty reduced copies.
+	auto initFlatTexture = [](FlatTexture &texture)
 	{
-		// Intersection point on the voxel.
-		const Double3 hitPoint = this->eye + (direction * distance);
+		texture.coverage = 0.0;
+		texture.width = 0;
+		texture.height = 0;
+	};
 
-		// Boolean for whether the hit point is on the back of a voxel face.
-		const bool backFace = stoppedInFirstVoxel;
+	auto emptyFlatTextureSet = std::make_shared<FlatTextureSet>();
+	initFlatTexture(emptyFlatTextureSet->texture);
+	emptyFlatTextureSet->lods = std::vector<FlatTexture>(SoftwareRenderer::FLAT_LOD_COUNT);
+	for (FlatTexture &lod : emptyFlatTextureSet->lods)
+	{
+		initFlatTexture(lod);
+	}
 
-		// Texture coordinates. U and V are affected by which side is hit (near, far),
-		// and whether the hit point is on the front or back of the voxel face.
-		// - Note, for edge cases where {u,v}Val == 1.0, the texture coordinate is
-		//   out of bounds by one pixel, so instead of 1.0, something like 0.9999999
-		//   should be used instead. std::nextafter(1.0, -INFINITY)?
-		double u, v;
-		if (axis == Axis::X)
-		{
-			const double uVal = hitPoint.z - std::floor(hitPoint.z);
+	emptyFlatTextureSet->hash = 0;
+	this->emptyFlatTextureSet = std::move(emptyFlatTextureSet);
 
-			u = (nonNegativeDirX ^ backFace) ? uVal : (1.0 - uVal);
-			//v = 1.0 - (hitPoint.y - std::floor(hitPoint.y));
-			v = 1.0 - (std::fmod(hitPoint.y, voxelHeight) / voxelHeight);
-		}
-		else if (axis == Axis::Y)
-		{
-			const double vVal = hitPoint.x - std::floor(hitPoint.x);
+	this->flatTextureBytes = 0;
+	MemoryTracker::add(MemoryTag::RendererTextures, sizeof(this->voxelTextures));
 
-			u = hitPoint.z - std::floor(hitPoint.z);
-			v = (nonNegativeDirY ^ backFace) ? vVal : (1.0 - vVal);
-		}
-		else
-		{
-			const double uVal = hitPoint.x - std::floor(hitPoint.x);
+	this->width = width;
+	this->height = height;
 
-			u = (nonNegativeDirZ ^ backFace) ? (1.0 - uVal) : uVal;
-			//v = 1.0 - (hitPoint.y - std::floor(hitPoint.y));
-			v = 1.0 - (std::fmod(hitPoint.y, voxelHeight) / voxelHeight);
-		}
+	// Every worker gets a share of the frame, and so does the thread waiting on them.
+	this->threadCount = jobSystem.getThreadCount() + 1;
+	this->activeThreadCount = this->threadCount;
+	this->threadShrinkFrames = 0;
+	this->renderThreadBudget = 0.0;
+	this->threadTimes = std::vector<ThreadTimes>(this->threadCount);
+	this->threadStats = std::vector<RenderStats>(this->threadCount);
+	this->threadPlanes = std::vector<PlaneBuffer>(this->threadCount);
+	this->threadTileOcclusion = std::vector<TileOcclusion>(this->threadCount);
+	this->threadFragments = std::vector<FragmentBuffer>(this->threadCount);
+	this->renderStatsEnabled = false;
+
+	// No textures have been sampled yet.
+	this->threadTouchedVoxels = std::vector<std::vector<uint8_t>>(this->threadCount);
+	this->touchedVoxelTextures = 0;
+	this->voxelTextureFrames.fill(-1);
+	this->frameCount = 0;
 
-		// -- temp --
-		// Display bad texture coordinates as magenta. If any of these is true, it
-		// means something above is wrong.
-		if ((u < 0.0) || (u >= 1.0) || (v < 0.0) || (v >= 1.0))
-		{
-			return Double3(1.0, 0.0, 1.0);
-		}
-		// -- end temp --
+	// Fog distance is zero by default.
+	this->fogDistance = 0.0;
 
-		// Get the voxel data associated with the ID. Subtract 1 because the first
-		// entry is at index 0 but the lowest hitID is 1.
-		const VoxelData &voxelData = voxelGrid.getVoxelData(hitID - 1);
+	this->forceBaseMipLevel = false;
+	this->palettedRendering = false;
+	this->columnMajorRendering = false;
+	this->perspectiveSpanLength = 1;
+	this->rowPlaneRendering = false;
+	this->deferredShading = false;
+	this->interlacedRendering = false;
+	this->interlaceParity = 0;
+	this->historyFovY = 0.0;
+	this->foveatedColumnStride = 1;
+	this->lightGridDirty = false;
+	this->nightLightsActive = false;
+	this->nightLightIndex = 0;
+	this->liquidTextureMask = 0;
+	this->liquidCycleStep = 0;
+	this->occlusionMode = OcclusionMode::Culling;
+	this->occlusionMismatchCount = 0;
+	this->costView = CostView::Off;
+}
 
-		// Get the texture depending on which face was hit.
-		const TextureData &texture = (axis == Axis::Y) ?
-			this->textures[voxelData.floorAndCeilingID] :
-			this->textures[voxelData.sideID];
+SoftwareRenderer::~SoftwareRenderer()
+{
+	MemoryTracker::remove(MemoryTag::RendererTextures,
+		sizeof(this->voxelTextures) + this->flatTextureBytes);
+}
 
-		// Calculate position in texture.
-		const int textureX = static_cast<int>(u * texture.width);
-		const int textureY = static_cast<int>(v * texture.height);
+void SoftwareRenderer::addFlat(int id, const Double3 &position, double width, 
+	double height, int textureID)
+{
+	// Verify that the ID is not already in use.
+	FlatList &flats = this->flats;
+	DebugAssert(flats.indices.find(id) == flats.indices.end(), 
+		"Flat ID \"" + std::to_string(id) + "\" already taken.");
 
-		// Get the texel color at the hit point.
-		// - Later, the alpha component can be used for transparency and ignoring
-		//   intersections (in the DDA loop).
-		const Double4 &texel = texture.pixels[textureX + (textureY * texture.width)];
+	// Add the flat (sprite, door, store sign, etc.) to the end of the list.
+	const int flatIndex = flats.getCount();
+	flats.ids.push_back(id);
+	flats.positions.push_back(position);
+	flats.archetypeIndices.push_back(flats.acquireArchetype(width, height));
+	flats.textureIDs.push_back(textureID);
+	flats.flipped.push_back(false); // The initial value doesn't matter; it's updated frequently.
+	flats.indices.insert(std::make_pair(id, flatIndex));
 
-		// Convert the texel to a 3-component color.
-		const Double3 color(texel.x, texel.y, texel.z);
+	this->addFlatToChunk(flatIndex);
+}
 
-		// Linearly interpolate with some depth.
-		const double depth = std::min(distance, this->viewDistance) / this->viewDistance;
-		return color.lerp(this->fogColor, depth);
-	}
-	else
-	{
-		// No intersection. Return sky color.
-		return this->fogColor;
-	}
-}*/
+void SoftwareRenderer::addLight(int id, const Double3 &point, const Double3 &color, 
+	double intensity)
+{
+	// Verify that the ID is not already in use.
+	DebugAssert(this->lights.find(id) == this->lights.end(),
+		"Light ID \"" + std::to_string(id) + "\" already taken.");
 
-Double3 SoftwareRenderer::getFogColor(double daytimePercent) const
+	SoftwareRenderer::Light light;
+	light.point = point;
+	light.color = color;
+	light.intensity = intensity;
+
+	this->lights.insert(std::make_pair(id, light));
+	this->lightGridDirty = true;
+}
+
+bool SoftwareRenderer::writeVoxelTexels(VoxelTexture &texture, const uint32_t *srcTexels)
 {
-	// Get the real index (not the integer index), so the color can be interpolated
-	// between two samples.
-	const double realIndex = static_cast<double>(this->skyPalette.size()) * daytimePercent;
+	// Clear the selected texture.
+	std::fill(texture.texels.begin(), texture.texels.end(), VoxelTexel());
+	bool hasLightTexels = false;
 
-	const size_t index = static_cast<size_t>(realIndex);
-	const size_t nextIndex = (index + 1) % this->skyPalette.size();
+	for (int y = 0; y < VoxelTexture::HEIGHT; y++)
+	{
+		for (int x = 0; x < VoxelTexture::WIDTH; x++)
+		{
+			// To do: change this calculation for rotated textures. Make sure to have a 
+			// source index and destination index.
+			// - "dstX" and "dstY" should be calculated.
+			const int srcIndex = x + (y * VoxelTexture::WIDTH);
+			const int dstIndex = VoxelTexture::getTexelIndex(x, y, VoxelTexture::WIDTH);
+
+			// Unpack the ARGB color into separate 8-bit channels.
+			const uint32_t srcTexel = srcTexels[srcIndex];
+			VoxelTexel &dstTexel = texture.texels[dstIndex];
+			dstTexel.r = static_cast<uint8_t>(srcTexel >> 16);
+			dstTexel.g = static_cast<uint8_t>(srcTexel >> 8);
+			dstTexel.b = static_cast<uint8_t>(srcTexel);
+			dstTexel.a = static_cast<uint8_t>(srcTexel >> 24);
+
+			// If it's a white texel, it's used with night lights (i.e., yellow at night). It's
+			// stored black, and shading lights it at night.
+			const bool isWhite = (dstTexel.r == 255) && (dstTexel.g == 255) && (dstTexel.b == 255);
 
-	const Double3 &color = this->skyPalette[index];
-	const Double3 &nextColor = this->skyPalette[nextIndex];
+			if (isWhite)
+			{
+				dstTexel.r = 0;
+				dstTexel.g = 0;
+				dstTexel.b = 0;
+				dstTexel.light = 255;
+				hasLightTexels = true;
+			}
+		}
+	}
 
-	const double percent = realIndex - std::floor(realIndex);
-	return color.lerp(nextColor, percent);
+	texture.generateMipmaps();
+	return hasLightTexels;
 }
 
-Double3 SoftwareRenderer::getSunDirection(double daytimePercent) const
+void SoftwareRenderer::setVoxelTexture(int id, const uint32_t *srcTexels)
 {
-	// The sun rises in the east (+Z) and sets in the west (-Z).
-	const double radians = daytimePercent * (2.0 * Constants::Pi);
-	return Double3(0.0, -std::cos(radians), std::sin(radians)).normalized();
+	this->setVoxelTextures(std::vector<int> { id },
+		std::vector<const uint32_t*> { srcTexels });
 }
 
-double SoftwareRenderer::fullAtan2(double y, double x)
+void SoftwareRenderer::setVoxelTextures(const std::vector<int> &ids,
+	const std::vector<const uint32_t*> &srcTexels)
 {
-	const double angle = std::atan2(y, x);
-	return (angle >= 0.0) ? angle : ((2.0 * Constants::Pi) + angle);
+	DebugAssert(ids.size() == srcTexels.size(), "Mismatched voxel texture ID and texel counts.");
+
+	const int count = static_cast<int>(ids.size());
+	std::vector<VoxelTexture*> textures;
+	textures.reserve(count);
+	for (const int id : ids)
+	{
+		textures.push_back(&this->voxelTextures.at(id));
+		this->voxelTextureFrames[id] = -1;
+	}
+
+	// Hash the source texels so a texture given twice (i.e., one wall used by several
+	// voxel IDs) is only converted once.
+	const size_t srcByteCount = VoxelTexture::TEXEL_COUNT * sizeof(uint32_t);
+	std::vector<uint64_t> hashes(count);
+	this->jobSystem.parallelFor(count, [&srcTexels, &hashes, srcByteCount](int i)
+	{
+		hashes[i] = Bytes::hash(reinterpret_cast<const uint8_t*>(srcTexels[i]), srcByteCount);
+	});
+
+	// Index of the earlier texture each one is a copy of, or -1 if it's converted itself.
+	std::vector<int> copyIndices(count, -1);
+	std::vector<int> convertIndices;
+	std::unordered_map<uint64_t, int> firstIndices;
+	for (int i = 0; i < count; i++)
+	{
+		const auto iter = firstIndices.find(hashes[i]);
+		if ((iter != firstIndices.end()) &&
+			std::equal(srcTexels[i], srcTexels[i] + VoxelTexture::TEXEL_COUNT,
+				srcTexels[iter->second]))
+		{
+			copyIndices[i] = iter->second;
+		}
+		else
+		{
+			firstIndices.emplace(hashes[i], i);
+			convertIndices.push_back(i);
+		}
+	}
+
+	// Converting and mipmapping are per-texture, so they're spread across the workers.
+	std::vector<uint8_t> hasLightTexels(count, 0);
+	this->jobSystem.parallelFor(static_cast<int>(convertIndices.size()),
+		[&textures, &srcTexels, &hasLightTexels, &convertIndices](int j)
+	{
+		const int i = convertIndices[j];
+		hasLightTexels[i] = SoftwareRenderer::writeVoxelTexels(*textures[i], srcTexels[i]);
+	});
+
+	// The palette is shared, so its indices are assigned afterwards in the given order.
+	for (int i = 0; i < count; i++)
+	{
+		// A copy gets the texels and palette indices of the texture it's the same as.
+		if (copyIndices[i] >= 0)
+		{
+			*textures[i] = *textures[copyIndices[i]];
+			continue;
+		}
+
+		// The lit color needs a palette entry for paletted rendering.
+		if (hasLightTexels[i] != 0)
+		{
+			const uint32_t lightColor = SoftwareRenderer::NIGHT_LIGHT_COLOR;
+			this->nightLightIndex = this->getPaletteIndex(
+				static_cast<uint8_t>(lightColor >> 16), static_cast<uint8_t>(lightColor >> 8),
+				static_cast<uint8_t>(lightColor), true);
+		}
+
+		this->updatePaletteIndices(*textures[i]);
+	}
 }
 
-Double3 SoftwareRenderer::getNormal(VoxelData::Facing facing)
+void SoftwareRenderer::setFlatTexture(int id, const uint32_t *srcTexels, int width, int height)
 {
-	// Decide what the normal is, based on the facing. It can only be on the X or Z axis 
-	// because floors and ceilings are drawn separately from walls, and their 
-	// normals are trivial.
-	if (facing == VoxelData::Facing::PositiveX)
+	DebugAssert(id >= 0, "Invalid flat texture ID \"" + std::to_string(id) + "\".");
+
+	// The ID table grows as needed, so there's no fixed limit on flat textures.
+	if (id >= static_cast<int>(this->flatTextures.size()))
 	{
-		return Double3::UnitX;
+		this->flatTextures.resize(id + 1, this->emptyFlatTextureSet);
 	}
-	else if (facing == VoxelData::Facing::NegativeX)
+
+	if (id < static_cast<int>(this->flatTextureFrames.size()))
 	{
-		return -Double3::UnitX;
+		this->flatTextureFrames[id] = -1;
 	}
-	else if (facing == VoxelData::Facing::PositiveZ)
+
+	const int texelCount = width * height;
+	std::vector<FlatTexel> texels(texelCount);
+	for (int i = 0; i < texelCount; i++)
 	{
-		return Double3::UnitZ;
+		const uint32_t srcTexel = srcTexels[i];
+		FlatTexel &dstTexel = texels[i];
+		dstTexel.r = static_cast<uint8_t>(srcTexel >> 16);
+		dstTexel.g = static_cast<uint8_t>(srcTexel >> 8);
+		dstTexel.b = static_cast<uint8_t>(srcTexel);
+		dstTexel.a = static_cast<uint8_t>(srcTexel >> 24);
 	}
-	else
+
+	// Use the set of another ID with the same texels if there is one, so the runs and
+	// reduced copies aren't made again.
+	const uint64_t hash = Bytes::hash(reinterpret_cast<const uint8_t*>(srcTexels),
+		texelCount * sizeof(uint32_t));
+	std::weak_ptr<const FlatTextureSet> &sharedSet = this->flatTextureSets[hash];
+	std::shared_ptr<const FlatTextureSet> textureSet = sharedSet.lock();
+
+	auto isSameTexel = [](const FlatTexel &a, const FlatTexel &b)
 	{
-		return -Double3::UnitZ;
+		return (a.r == b.r) && (a.g == b.g) && (a.b == b.b) && (a.a == b.a);
+	};
+
+	auto isSameTexture = [&texels, width, height, &isSameTexel](const FlatTexture &texture)
+	{
+		return (texture.width == width) && (texture.height == height) &&
+			std::equal(texels.begin(), texels.end(), texture.texels.begin(), isSameTexel);
+	};
+
+	if ((textureSet.get() == nullptr) || !isSameTexture(textureSet->texture))
+	{
+		// A hash collision gets a set of its own and leaves the shared one alone.
+		const bool isCollision = textureSet.get() != nullptr;
+
+		auto newTextureSet = std::make_shared<FlatTextureSet>();
+		FlatTexture &texture = newTextureSet->texture;
+		texture.texels = std::move(texels);
+		texture.width = width;
+		texture.height = height;
+		texture.updateRuns();
+		newTextureSet->hash = hash;
+
+		// Distant flats sample prefiltered copies instead, each half the size of the last.
+		std::vector<FlatTexture> &lods = newTextureSet->lods;
+		lods = std::vector<FlatTexture>(SoftwareRenderer::FLAT_LOD_COUNT);
+		for (size_t i = 0; i < lods.size(); i++)
+		{
+			const FlatTexture &srcTexture = (i == 0) ? texture : lods[i - 1];
+			lods[i].makeHalfSize(srcTexture);
+		}
+
+		textureSet = std::move(newTextureSet);
+		if (!isCollision)
+		{
+			sharedSet = textureSet;
+		}
 	}
+
+	this->setFlatTextureSet(id, std::move(textureSet));
 }
 
-VoxelData::Facing SoftwareRenderer::getInitialChasmFarFacing(int voxelX, int voxelZ,
-	const Double2 &eye, const Ray &ray)
+bool SoftwareRenderer::updateFlat(int id, const Double3 *position, const double *width, 
+	const double *height, const int *textureID, const bool *flipped)
 {
-	// Angle of the ray from the camera eye.
-	const double angle = SoftwareRenderer::fullAtan2(ray.dirX, ray.dirZ);
-
-	// Corners in world space.
-	const Double2 bottomLeftCorner(
-		static_cast<double>(voxelX),
-		static_cast<double>(voxelZ));
-	const Double2 topLeftCorner(
-		bottomLeftCorner.x + 1.0,
-		bottomLeftCorner.y);
-	const Double2 bottomRightCorner(
-		bottomLeftCorner.x,
-		bottomLeftCorner.y + 1.0);
-	const Double2 topRightCorner(
-		topLeftCorner.x,
-		bottomRightCorner.y);
+	FlatList &flats = this->flats;
+	const auto indexIter = flats.indices.find(id);
+	DebugAssert(indexIter != flats.indices.end(), 
+		"Cannot update a non-existent flat (" + std::to_string(id) + ").");
 
-	const Double2 upLeft = (topLeftCorner - eye).normalized();
-	const Double2 upRight = (topRightCorner - eye).normalized();
-	const Double2 downLeft = (bottomLeftCorner - eye).normalized();
-	const Double2 downRight = (bottomRightCorner - eye).normalized();
-	const double upLeftAngle = SoftwareRenderer::fullAtan2(upLeft.x, upLeft.y);
-	const double upRightAngle = SoftwareRenderer::fullAtan2(upRight.x, upRight.y);
-	const double downLeftAngle = SoftwareRenderer::fullAtan2(downLeft.x, downLeft.y);
-	const double downRightAngle = SoftwareRenderer::fullAtan2(downRight.x, downRight.y);
+	const int flatIndex = indexIter->second;
+	Double3 &flatPosition = flats.positions[flatIndex];
+	bool changed = false;
 
-	// Find which range the ray's angle lies within.
-	if ((angle < upRightAngle) || (angle > downRightAngle))
+	// Check which values requested updating and update them. The flat's chunk needs 
+	// refreshing if it moved or got wider.
+	if ((position != nullptr) && (*position != flatPosition))
 	{
-		return VoxelData::Facing::PositiveZ;
+		const bool chunkChanged = SoftwareRenderer::getFlatChunkCoord(*position) !=
+			SoftwareRenderer::getFlatChunkCoord(flatPosition);
+
+		if (chunkChanged)
+		{
+			this->removeFlatFromChunk(flatIndex);
+			flatPosition = *position;
+			this->addFlatToChunk(flatIndex);
+		}
+		else
+		{
+			flatPosition = *position;
+		}
+
+		changed = true;
 	}
-	else if (angle < upLeftAngle)
+
+	// A new size moves the flat to the archetype of that size.
+	const FlatArchetype &archetype = flats.getArchetype(flatIndex);
+	const double newWidth = (width != nullptr) ? *width : archetype.width;
+	const double newHeight = (height != nullptr) ? *height : archetype.height;
+	if ((newWidth != archetype.width) || (newHeight != archetype.height))
 	{
-		return VoxelData::Facing::PositiveX;
+		const int oldArchetypeIndex = flats.archetypeIndices[flatIndex];
+		flats.archetypeIndices[flatIndex] = flats.acquireArchetype(newWidth, newHeight);
+		flats.releaseArchetype(oldArchetypeIndex);
+
+		FlatChunk &chunk = this->flatChunks.at(
+			SoftwareRenderer::getFlatChunkCoord(flatPosition));
+		chunk.maxHalfWidth = std::max(chunk.maxHalfWidth, newWidth * 0.50);
+		changed = true;
 	}
-	else if (angle < downLeftAngle)
+
+	if ((textureID != nullptr) && (*textureID != flats.textureIDs[flatIndex]))
 	{
-		return VoxelData::Facing::NegativeZ;
+		flats.textureIDs[flatIndex] = *textureID;
+		changed = true;
 	}
-	else
+
+	if ((flipped != nullptr) && (*flipped != flats.flipped[flatIndex]))
 	{
-		return VoxelData::Facing::NegativeX;
+		flats.flipped[flatIndex] = *flipped;
+		changed = true;
+	}
+
+	return changed;
+}
+
+bool SoftwareRenderer::isFlatChanged(int id, const Double3 &position, int textureID,
+	bool flipped) const
+{
+	const FlatList &flats = this->flats;
+	const auto indexIter = flats.indices.find(id);
+	DebugAssert(indexIter != flats.indices.end(),
+		"Cannot check a non-existent flat (" + std::to_string(id) + ").");
+
+	const int flatIndex = indexIter->second;
+	return (position != flats.positions[flatIndex]) ||
+		(textureID != flats.textureIDs[flatIndex]) ||
+		(flipped != flats.flipped[flatIndex]);
+}
+
+void SoftwareRenderer::updateLight(int id, const Double3 *point,
+	const Double3 *color, const double *intensity)
+{
+	const auto lightIter = this->lights.find(id);
+	DebugAssert(lightIter != this->lights.end(),
+		"Cannot update a non-existent light (" + std::to_string(id) + ").");
+
+	SoftwareRenderer::Light &light = lightIter->second;
+
+	// Check which values to update.
+	if (point != nullptr)
+	{
+		light.point = *point;
+	}
+
+	if (color != nullptr)
+	{
+		light.color = *color;
+	}
+
+	if (intensity != nullptr)
+	{
+		light.intensity = *intensity;
+	}
+
+	this->lightGridDirty = true;
+}
+
+void SoftwareRenderer::setFogDistance(double fogDistance)
+{
+	this->fogDistance = fogDistance;
+}
+
+void SoftwareRenderer::setSkyPalette(const uint32_t *colors, int count)
+{
+	this->skyPalette = std::vector<Double3>(count);
+
+	for (size_t i = 0; i < this->skyPalette.size(); i++)
+	{
+		this->skyPalette[i] = Double3::fromRGB(colors[i]);
+	}
+}
+
+void SoftwareRenderer::setLightMap(const std::shared_ptr<const LightMap> &lightMap)
+{
+	// An empty map is dropped so the kernels can skip lighting entirely.
+	const bool isEmpty = (lightMap.get() == nullptr) || lightMap->isEmpty();
+	this->lightMap = isEmpty ? nullptr : lightMap;
+}
+
+void SoftwareRenderer::setPotentiallyVisibleSet(
+	const std::shared_ptr<const PotentiallyVisibleSet> &visibleSet)
+{
+	// Its chunks are the voxel grid's, and culling uses them as flat chunks.
+	DebugAssert(SoftwareRenderer::FLAT_CHUNK_SIZE == VoxelGrid::CHUNK_SIZE,
+		"Flat chunks must match voxel grid chunks.");
+
+	const bool isEmpty = (visibleSet.get() == nullptr) || visibleSet->isEmpty();
+	this->visibleSet = isEmpty ? nullptr : visibleSet;
+}
+
+void SoftwareRenderer::setNightLightsActive(bool active)
+{
+	// To do: activate lights (don't worry about textures).
+
+	// Night light texels are lit while shading, so the textures don't change.
+	this->nightLightsActive = active;
+}
+
+bool SoftwareRenderer::setLiquidCycleStep(int step)
+{
+	DebugAssert(step >= 0, "Invalid liquid cycle step \"" + std::to_string(step) + "\".");
+
+	// The liquids are from the last frame's voxel grid. A new grid is drawn anyway.
+	const bool changed = (step != this->liquidCycleStep) && this->palettedRendering &&
+		!this->deferredShading && (this->liquidTextureMask != 0);
+	this->liquidCycleStep = step;
+	return changed;
+}
+
+void SoftwareRenderer::removeFlat(int id)
+{
+	// Make sure the flat exists before removing it.
+	FlatList &flats = this->flats;
+	const auto indexIter = flats.indices.find(id);
+	DebugAssert(indexIter != flats.indices.end(), 
+		"Cannot remove a non-existent flat (" + std::to_string(id) + ").");
+
+	const int flatIndex = indexIter->second;
+	const int lastIndex = flats.getCount() - 1;
+	this->removeFlatFromChunk(flatIndex);
+	flats.releaseArchetype(flats.archetypeIndices[flatIndex]);
+	flats.indices.erase(indexIter);
+
+	// Move the last flat into the removed one's place so the list stays packed.
+	if (flatIndex != lastIndex)
+	{
+		this->removeFlatFromChunk(lastIndex);
+
+		flats.ids[flatIndex] = flats.ids[lastIndex];
+		flats.positions[flatIndex] = flats.positions[lastIndex];
+		flats.archetypeIndices[flatIndex] = flats.archetypeIndices[lastIndex];
+		flats.textureIDs[flatIndex] = flats.textureIDs[lastIndex];
+		flats.flipped[flatIndex] = flats.flipped[lastIndex];
+		flats.indices.at(flats.ids[flatIndex]) = flatIndex;
+
+		this->addFlatToChunk(flatIndex);
+	}
+
+	flats.ids.pop_back();
+	flats.positions.pop_back();
+	flats.archetypeIndices.pop_back();
+	flats.textureIDs.pop_back();
+	flats.flipped.pop_back();
+}
+
+void SoftwareRenderer::removeFlatTexture(int id)
+{
+	if ((id < 0) || (id >= static_cast<int>(this->flatTextures.size())))
+	{
+		return;
+	}
+
+	this->setFlatTextureSet(id, this->emptyFlatTextureSet);
+	if (id < static_cast<int>(this->flatTextureFrames.size()))
+	{
+		this->flatTextureFrames[id] = -1;
+	}
+
+	// Shrink the table when the highest IDs are free.
+	while ((this->flatTextures.size() > 0) &&
+		(this->flatTextures.back() == this->emptyFlatTextureSet))
+	{
+		this->flatTextures.pop_back();
+	}
+}
+
+void SoftwareRenderer::removeLight(int id)
+{
+	// Make sure the light exists before removing it.
+	const auto lightIter = this->lights.find(id);
+	DebugAssert(lightIter != this->lights.end(),
+		"Cannot remove a non-existent light (" + std::to_string(id) + ").");
+
+	this->lights.erase(lightIter);
+	this->lightGridDirty = true;
+}
+
+void SoftwareRenderer::setDoorOpenPercent(const Int3 &voxel, double percent)
+{
+	if (percent > 0.0)
+	{
+		this->doorOpenPercents[voxel] = std::min(percent, 1.0);
+	}
+	else
+	{
+		this->doorOpenPercents.erase(voxel);
+	}
+}
+
+void SoftwareRenderer::clearDoors()
+{
+	this->doorOpenPercents.clear();
+}
+
+void SoftwareRenderer::clearTextures()
+{
+	for (auto &texture : this->voxelTextures)
+	{
+		std::fill(texture.texels.begin(), texture.texels.end(), VoxelTexel());
+		std::fill(texture.mipTexels.begin(), texture.mipTexels.end(), VoxelTexel());
+	}
+
+	// The next textures might use a different palette.
+	this->palette.clear();
+	this->paletteIndices.clear();
+	this->nightLightIndex = 0;
+
+	this->flatTextures.clear();
+	this->flatTextureSets.clear();
+	this->flatTextureSetUses.clear();
+	MemoryTracker::remove(MemoryTag::RendererTextures, this->flatTextureBytes);
+	this->flatTextureBytes = 0;
+
+	this->voxelTextureFrames.fill(-1);
+	this->flatTextureFrames.clear();
+}
+
+void SoftwareRenderer::resize(int width, int height)
+{
+	const int pixelCount = width * height;
+	this->depthBuffer.resize(pixelCount);
+	std::fill(this->depthBuffer.begin(), this->depthBuffer.end(), 
+		std::numeric_limits<DepthValue>::infinity());
+
+	this->occlusion.resize(width);
+	std::fill(this->occlusion.begin(), this->occlusion.end(), 
+		OcclusionData(0, height, false));
+
+	// The column rays depend on the width and aspect ratio, so they are remade next frame.
+	this->columnRayDirections.clear();
+
+	// Skipped columns can't be filled in from a frame of a different size.
+	this->interlaceHistory.clear();
+
+	this->width = width;
+	this->height = height;
+}
+
+const std::vector<SoftwareRenderer::ThreadTimes> &SoftwareRenderer::getThreadTimes() const
+{
+	return this->threadTimes;
+}
+
+int SoftwareRenderer::getFrameCount() const
+{
+	return this->frameCount;
+}
+
+int SoftwareRenderer::getVoxelTextureLastFrame(int id) const
+{
+	return this->voxelTextureFrames.at(id);
+}
+
+int SoftwareRenderer::getFlatTextureLastFrame(int id) const
+{
+	return ((id >= 0) && (id < static_cast<int>(this->flatTextureFrames.size()))) ?
+		this->flatTextureFrames[id] : -1;
+}
+
+void SoftwareRenderer::setRenderThreadBudget(double seconds)
+{
+	this->renderThreadBudget = seconds;
+
+	if (seconds <= 0.0)
+	{
+		this->activeThreadCount = this->threadCount;
+		this->threadShrinkFrames = 0;
+	}
+}
+
+const SoftwareRenderer::RenderStats &SoftwareRenderer::getRenderStats() const
+{
+	return this->renderStats;
+}
+
+void SoftwareRenderer::setRenderStatsEnabled(bool renderStatsEnabled)
+{
+	this->renderStatsEnabled = renderStatsEnabled;
+}
+
+void SoftwareRenderer::setForceBaseMipLevel(bool forceBaseMipLevel)
+{
+	this->forceBaseMipLevel = forceBaseMipLevel;
+}
+
+void SoftwareRenderer::setPalettedRendering(bool palettedRendering)
+{
+	this->palettedRendering = palettedRendering;
+}
+
+void SoftwareRenderer::setColumnMajorRendering(bool columnMajorRendering)
+{
+	this->columnMajorRendering = columnMajorRendering;
+}
+
+void SoftwareRenderer::setPerspectiveSpanLength(int perspectiveSpanLength)
+{
+	DebugAssert(perspectiveSpanLength > 0, "Perspective span length must be positive.");
+	this->perspectiveSpanLength = perspectiveSpanLength;
+}
+
+void SoftwareRenderer::setRowPlaneRendering(bool rowPlaneRendering)
+{
+	this->rowPlaneRendering = rowPlaneRendering;
+}
+
+void SoftwareRenderer::setDeferredShading(bool deferredShading)
+{
+	this->deferredShading = deferredShading;
+}
+
+void SoftwareRenderer::setInterlacedRendering(bool interlacedRendering)
+{
+	this->interlacedRendering = interlacedRendering;
+
+	// The history would be out of date by the time interlacing is used again.
+	if (!interlacedRendering)
+	{
+		this->interlaceHistory.clear();
+	}
+}
+
+void SoftwareRenderer::setFoveatedColumnStride(int foveatedColumnStride)
+{
+	DebugAssert(foveatedColumnStride >= 1, "Foveated column stride must be positive.");
+	this->foveatedColumnStride = foveatedColumnStride;
+}
+
+SoftwareRenderer::OcclusionMode SoftwareRenderer::getOcclusionMode() const
+{
+	return this->occlusionMode;
+}
+
+int SoftwareRenderer::getOcclusionMismatchCount() const
+{
+	return this->occlusionMismatchCount;
+}
+
+void SoftwareRenderer::setOcclusionMode(OcclusionMode occlusionMode)
+{
+	this->occlusionMode = occlusionMode;
+	this->occlusionMismatchCount = 0;
+}
+
+SoftwareRenderer::CostView SoftwareRenderer::getCostView() const
+{
+	return this->costView;
+}
+
+void SoftwareRenderer::setCostView(CostView costView)
+{
+	this->costView = costView;
+}
+
+Int2 SoftwareRenderer::getFlatChunkCoord(const Double3 &point)
+{
+	const double chunkSize = static_cast<double>(SoftwareRenderer::FLAT_CHUNK_SIZE);
+	return Int2(
+		static_cast<int>(std::floor(point.x / chunkSize)),
+		static_cast<int>(std::floor(point.z / chunkSize)));
+}
+
+void SoftwareRenderer::addFlatToChunk(int flatIndex)
+{
+	const Double3 &position = this->flats.positions[flatIndex];
+	FlatChunk &chunk = this->flatChunks[SoftwareRenderer::getFlatChunkCoord(position)];
+	chunk.flatIndices.push_back(flatIndex);
+	chunk.maxHalfWidth = std::max(chunk.maxHalfWidth,
+		this->flats.getArchetype(flatIndex).width * 0.50);
+}
+
+void SoftwareRenderer::removeFlatFromChunk(int flatIndex)
+{
+	const auto chunkIter = this->flatChunks.find(
+		SoftwareRenderer::getFlatChunkCoord(this->flats.positions[flatIndex]));
+	DebugAssert(chunkIter != this->flatChunks.end(), "Flat chunk missing.");
+
+	// Order within a chunk doesn't matter, so swap the flat with the last one.
+	std::vector<int> &chunkFlats = chunkIter->second.flatIndices;
+	const auto iter = std::find(chunkFlats.begin(), chunkFlats.end(), flatIndex);
+	DebugAssert(iter != chunkFlats.end(), "Flat not in its chunk.");
+
+	*iter = chunkFlats.back();
+	chunkFlats.pop_back();
+
+	if (chunkFlats.empty())
+	{
+		this->flatChunks.erase(chunkIter);
+	}
+}
+
+void SoftwareRenderer::updateSkyRowColors(const Camera &camera, const ShadingInfo &shadingInfo)
+{
+	this->skyRowColors.resize(this->height);
+
+	const double heightReal = static_cast<double>(this->height);
+	for (int y = 0; y < this->height; y++)
+	{
+		// Normalized Y of the row's center with the Y-shear removed, like plane rows. Its
+		// ratio to the zoom is the tangent of the row's angle above the horizon.
+		const double rowY = 2.0 * ((0.50 + camera.yShear) -
+			((static_cast<double>(y) + 0.50) / heightReal));
+		const double angle = std::atan2(rowY, camera.zoom);
+		const double zenithPercent = std::max(angle / (Constants::Pi * 0.50), 0.0);
+
+		this->skyRowColors[y] = shadingInfo.horizonSkyColor.lerp(
+			shadingInfo.zenithSkyColor, zenithPercent).toRGB();
+	}
+}
+
+void SoftwareRenderer::updateColumnRayDirections(const Camera &camera)
+{
+	const bool isCurrent = (static_cast<int>(this->columnRayDirections.size()) == this->width) &&
+		(this->columnRayZoom == camera.zoom) && (this->columnRayAspect == camera.aspect);
+
+	if (isCurrent)
+	{
+		return;
+	}
+
+	this->columnRayDirections.resize(this->width);
+	this->columnDepthScales.resize(this->width);
+	this->columnRayZoom = camera.zoom;
+	this->columnRayAspect = camera.aspect;
+
+	const double widthReal = static_cast<double>(this->width);
+
+	// Ray direction through each pixel column relative to the camera, with forward as X
+	// and right as Y, normalized all at once.
+	// - If un-normalized, it uses the Z distance, but the insides of voxels
+	//   don't look right then.
+	std::vector<float> rayX(this->width, static_cast<float>(camera.zoom));
+	std::vector<float> rayY(this->width);
+	for (int x = 0; x < this->width; x++)
+	{
+		// X percent across the screen.
+		const double xPercent = (static_cast<double>(x) + 0.50) / widthReal;
+		rayY[x] = static_cast<float>(camera.aspect * ((2.0 * xPercent) - 1.0));
+	}
+
+	BatchMath::normalize2D(rayX.data(), rayY.data(), this->width);
+
+	for (int x = 0; x < this->width; x++)
+	{
+		this->columnRayDirections[x] = Double2(rayX[x], rayY[x]);
+
+		// Distance along the ray for each unit of distance forward from the camera.
+		this->columnDepthScales[x] = 1.0 / this->columnRayDirections[x].x;
+	}
+}
+
+uint64_t SoftwareRenderer::getVoxelTextureMask(const VoxelData &voxelData)
+{
+	auto getBit = [](int id)
+	{
+		return static_cast<uint64_t>(1) << id;
+	};
+
+	switch (voxelData.dataType)
+	{
+	case VoxelDataType::Wall:
+		return getBit(voxelData.wall.sideID) | getBit(voxelData.wall.floorID) |
+			getBit(voxelData.wall.ceilingID);
+	case VoxelDataType::Floor:
+		return getBit(voxelData.floor.id);
+	case VoxelDataType::Ceiling:
+		return getBit(voxelData.ceiling.id);
+	case VoxelDataType::Raised:
+		return getBit(voxelData.raised.sideID) | getBit(voxelData.raised.floorID) |
+			getBit(voxelData.raised.ceilingID);
+	case VoxelDataType::Diagonal:
+		return getBit(voxelData.diagonal.id);
+	case VoxelDataType::TransparentWall:
+		return getBit(voxelData.transparentWall.id);
+	case VoxelDataType::Edge:
+		return getBit(voxelData.edge.id);
+	case VoxelDataType::Chasm:
+		return getBit(voxelData.chasm.id);
+	case VoxelDataType::Door:
+		return getBit(voxelData.door.id);
+	default:
+		return 0;
+	}
+}
+
+void SoftwareRenderer::updateVoxelDataTypes(const VoxelGrid &voxelGrid)
+{
+	// Revisions are unique across voxel grids, so a new grid at the same address is still
+	// noticed.
+	if ((&voxelGrid == this->voxelDataTypesGrid) &&
+		(voxelGrid.getRevision() == this->voxelDataTypesRevision))
+	{
+		return;
+	}
+
+	const int voxelDataCount = voxelGrid.getVoxelDataCount();
+	this->voxelDataTypes.resize(voxelDataCount);
+	this->voxelTextureMasks.resize(voxelDataCount);
+	this->liquidTextureMask = 0;
+	for (int i = 0; i < voxelDataCount; i++)
+	{
+		const VoxelData &voxelData = voxelGrid.getVoxelData(static_cast<uint16_t>(i));
+		this->voxelDataTypes[i] = static_cast<uint8_t>(voxelData.dataType);
+		this->voxelTextureMasks[i] = SoftwareRenderer::getVoxelTextureMask(voxelData);
+
+		if ((voxelData.dataType == VoxelDataType::Chasm) &&
+			(voxelData.chasm.type != VoxelData::ChasmData::Type::Dry))
+		{
+			this->liquidTextureMask |= this->voxelTextureMasks[i];
+		}
+	}
+
+	this->voxelDataTypesGrid = &voxelGrid;
+	this->voxelDataTypesRevision = voxelGrid.getRevision();
+}
+
+void SoftwareRenderer::updateVisibleFlats(const Camera &camera,
+	const PotentiallyVisibleSet *visibleSet)
+{
+	ProfileScope("SoftwareRenderer::updateVisibleFlats");
+
+	this->visibleFlats.clear();
+
+	// Each flat shares the same axes. The forward direction always faces opposite to 
+	// the camera direction.
+	const Double3 flatForward = Double3(-camera.forwardX, 0.0, -camera.forwardZ).normalized();
+	const Double3 flatUp = Double3::UnitY;
+	const Double3 flatRight = flatForward.cross(flatUp).normalized();
+
+	const Double2 eye2D(camera.eye.x, camera.eye.z);
+	const Double2 direction(camera.forwardX, camera.forwardZ);
+	const Int2 eyeChunk = SoftwareRenderer::getFlatChunkCoord(camera.eye);
+
+	// Left and right edges of the view in the XZ plane, the same as the outermost rays
+	// cast by render(). Each edge gets a normal that points into the view.
+	const Double2 forwardComp = direction.normalized() * camera.zoom;
+	const Double2 right2D = Double2(camera.rightX, camera.rightZ).normalized() * camera.aspect;
+	const Double2 leftEdge = forwardComp - right2D;
+	const Double2 rightEdge = forwardComp + right2D;
+	const Double2 leftNormal = (leftEdge.leftPerp().dot(rightEdge) > 0.0) ?
+		leftEdge.leftPerp() : leftEdge.rightPerp();
+	const Double2 rightNormal = (rightEdge.leftPerp().dot(leftEdge) > 0.0) ?
+		rightEdge.leftPerp() : rightEdge.rightPerp();
+
+	// Flats entirely past the fog distance would only be drawn in the fog color.
+	const double fogDistance = this->fogDistance;
+	const FlatList &flats = this->flats;
+
+	// Returns whether any part of a chunk's XZ rectangle (grown by how far its flats can 
+	// reach) is within the fog distance and on the inner side of all three of the camera's 
+	// XZ planes.
+	auto chunkIsVisible = [&eye2D, &direction, &leftNormal, &rightNormal, fogDistance](
+		const Int2 &chunkCoord, const FlatChunk &chunk)
+	{
+		const double chunkSize = static_cast<double>(SoftwareRenderer::FLAT_CHUNK_SIZE);
+		const double minX = (static_cast<double>(chunkCoord.x) * chunkSize) - chunk.maxHalfWidth;
+		const double maxX = minX + chunkSize + (chunk.maxHalfWidth * 2.0);
+		const double minZ = (static_cast<double>(chunkCoord.y) * chunkSize) - chunk.maxHalfWidth;
+		const double maxZ = minZ + chunkSize + (chunk.maxHalfWidth * 2.0);
+
+		// Distance from the eye to the nearest point of the rectangle.
+		const double nearestX = std::max(std::max(minX - eye2D.x, eye2D.x - maxX), 0.0);
+		const double nearestZ = std::max(std::max(minZ - eye2D.y, eye2D.y - maxZ), 0.0);
+		if (((nearestX * nearestX) + (nearestZ * nearestZ)) >= (fogDistance * fogDistance))
+		{
+			return false;
+		}
+
+		const std::array<Double2, 4> corners =
+		{
+			Double2(minX, minZ) - eye2D,
+			Double2(maxX, minZ) - eye2D,
+			Double2(minX, maxZ) - eye2D,
+			Double2(maxX, maxZ) - eye2D
+		};
+
+		auto allOutside = [&corners](const Double2 &normal)
+		{
+			return std::all_of(corners.begin(), corners.end(), [&normal](const Double2 &corner)
+			{
+				return normal.dot(corner) < 0.0;
+			});
+		};
+
+		return !allOutside(direction) && !allOutside(leftNormal) && !allOutside(rightNormal);
+	};
+
+	// This is the visible flat determination algorithm. It goes through the flats in each
+	// chunk that might be in view and sees which ones would be at least partially visible 
+	// in the view frustum.
+	for (const auto &chunkPair : this->flatChunks)
+	{
+		// Chunks hidden from the eye's chunk are skipped without testing, unless their
+		// flats reach further past them than the visible set accounts for.
+		if ((visibleSet != nullptr) &&
+			(chunkPair.second.maxHalfWidth <= PotentiallyVisibleSet::MAX_REACH) &&
+			!visibleSet->isChunkVisible(eyeChunk, chunkPair.first))
+		{
+			continue;
+		}
+
+		if (!chunkIsVisible(chunkPair.first, chunkPair.second))
+		{
+			continue;
+		}
+
+		for (const int flatIndex : chunkPair.second.flatIndices)
+		{
+			const Double3 &flatPosition = flats.positions[flatIndex];
+			const FlatArchetype &flatArchetype = flats.getArchetype(flatIndex);
+			const double flatWidth = flatArchetype.width;
+
+			// No part of the flat can be nearer than its center minus half its width.
+			const Double2 flatEyeOffset = Double2(flatPosition.x, flatPosition.z) - eye2D;
+			if ((flatEyeOffset.length() - (flatWidth * 0.50)) >= fogDistance)
+			{
+				continue;
+			}
+
+			// Scaled axes based on flat dimensions.
+			const Double3 flatRightScaled = flatRight * (flatWidth * 0.50);
+			const Double3 flatUpScaled = flatUp * flatArchetype.height;
+		
+			// Calculate each corner of the flat in world space.
+			FlatFrame flatFrame;
+			flatFrame.bottomStart = flatPosition + flatRightScaled;
+			flatFrame.bottomEnd = flatPosition - flatRightScaled;
+			flatFrame.topStart = flatFrame.bottomStart + flatUpScaled;
+			flatFrame.topEnd = flatFrame.bottomEnd + flatUpScaled;
+			flatFrame.textureID = flats.textureIDs[flatIndex];
+			flatFrame.flipped = flats.flipped[flatIndex];
+			flatFrame.flatIndex = flatIndex;
+			flatFrame.lodLevel = 0;
+			flatFrame.drawsAsDot = false;
+
+			// If the flat is somewhere in front of the camera, do further checks.
+			const Double2 flatPosition2D(flatPosition.x, flatPosition.z);
+			const Double2 flatEyeDiff = (flatPosition2D - eye2D).normalized();
+			const bool inFrontOfCamera = direction.dot(flatEyeDiff) > 0.0;
+
+			if (inFrontOfCamera)
+			{
+				// Projected below with the rest.
+				this->visibleFlats.push_back(std::move(flatFrame));
+			}
+		}
+	}
+
+	// Now project two of each flat's opposing corner points into camera space, all at
+	// once. The Z value is used with flat sorting (not rendering), and the X and Y values
+	// are used to find where the flat is on-screen. Points are relative to the eye so
+	// they keep their precision as floats far from the origin.
+	const int flatCount = static_cast<int>(this->visibleFlats.size());
+	const int pointCount = flatCount * 2;
+	this->flatPoints.resize(pointCount * 7);
+	float *pointX = this->flatPoints.data();
+	float *pointY = pointX + pointCount;
+	float *pointZ = pointY + pointCount;
+	float *projX = pointZ + pointCount;
+	float *projY = projX + pointCount;
+	float *projZ = projY + pointCount;
+	float *projW = projZ + pointCount;
+
+	for (int i = 0; i < flatCount; i++)
+	{
+		const FlatFrame &flatFrame = this->visibleFlats[i];
+		const Double3 start = flatFrame.topStart - camera.eye;
+		const Double3 end = flatFrame.bottomEnd - camera.eye;
+		pointX[i * 2] = static_cast<float>(start.x);
+		pointY[i * 2] = static_cast<float>(start.y);
+		pointZ[i * 2] = static_cast<float>(start.z);
+		pointX[(i * 2) + 1] = static_cast<float>(end.x);
+		pointY[(i * 2) + 1] = static_cast<float>(end.y);
+		pointZ[(i * 2) + 1] = static_cast<float>(end.z);
+	}
+
+	const Matrix4d eyeTransform = camera.transform *
+		Matrix4d::translation(camera.eye.x, camera.eye.y, camera.eye.z);
+	BatchMath::transformPoints(eyeTransform, pointX, pointY, pointZ, pointCount,
+		projX, projY, projZ, projW);
+
+	const double widthReal = static_cast<double>(this->width);
+	const double heightReal = static_cast<double>(this->height);
+
+	int visibleCount = 0;
+	for (int i = 0; i < flatCount; i++)
+	{
+		FlatFrame &flatFrame = this->visibleFlats[i];
+		const int startIndex = i * 2;
+		const int endIndex = startIndex + 1;
+
+		// Normalize coordinates.
+		const double startX = projX[startIndex] / projW[startIndex];
+		const double startY = projY[startIndex] / projW[startIndex];
+		const double endX = projX[endIndex] / projW[endIndex];
+		const double endY = projY[endIndex] / projW[endIndex];
+
+		// Assign each screen value to the flat frame data.
+		flatFrame.startX = 0.50 + (startX * 0.50);
+		flatFrame.endX = 0.50 + (endX * 0.50);
+		flatFrame.startY = (0.50 + camera.yShear) - (startY * 0.50);
+		flatFrame.endY = (0.50 + camera.yShear) - (endY * 0.50);
+		flatFrame.z = projZ[startIndex] / projW[startIndex];
+
+		// Check that the Z value is within the clipping planes.
+		const bool inPlanes = (flatFrame.z >= SoftwareRenderer::NEAR_PLANE) &&
+			(flatFrame.z <= SoftwareRenderer::FAR_PLANE);
+
+		// Screen area of the flat, so distant flats cost about as much as the pixels
+		// they cover. Those that would cover less than a fraction of a pixel are skipped.
+		const FlatTexture &texture = this->getFlatTextureSet(flatFrame.textureID).texture;
+		const double pixelWidth = std::abs(flatFrame.endX - flatFrame.startX) * widthReal;
+		const double pixelHeight = std::abs(flatFrame.endY - flatFrame.startY) * heightReal;
+		const double pixelArea = pixelWidth * pixelHeight;
+		const bool coversPixels =
+			(pixelArea * texture.coverage) >= SoftwareRenderer::MIN_FLAT_PIXEL_COVERAGE;
+
+		// Flats entirely above or below the screen at the current Y-shear are skipped too,
+		// like voxels outside a column's visible heights.
+		const bool inRows = (std::max(flatFrame.startY, flatFrame.endY) > 0.0) &&
+			(std::min(flatFrame.startY, flatFrame.endY) < 1.0);
+
+		if (inPlanes && coversPixels && inRows)
+		{
+			flatFrame.drawsAsDot = pixelArea < SoftwareRenderer::FLAT_DOT_PIXEL_AREA;
+
+			// Use a smaller copy of the texture once each pixel would skip over texels.
+			const double texelsPerPixel = static_cast<double>(texture.height) / pixelHeight;
+			flatFrame.lodLevel = 0;
+			while ((flatFrame.lodLevel < SoftwareRenderer::FLAT_LOD_COUNT) &&
+				(texelsPerPixel >= static_cast<double>(2 << flatFrame.lodLevel)))
+			{
+				flatFrame.lodLevel++;
+			}
+
+			// Its texture counts as sampled even if walls end up covering it.
+			if ((flatFrame.textureID >= 0) &&
+				(flatFrame.textureID < static_cast<int>(this->touchedFlatTextures.size())))
+			{
+				this->touchedFlatTextures[flatFrame.textureID] = true;
+			}
+
+			// Keep the flat in the draw list.
+			if (visibleCount != i)
+			{
+				this->visibleFlats[visibleCount] = std::move(flatFrame);
+			}
+
+			visibleCount++;
+		}
+	}
+
+	this->visibleFlats.resize(visibleCount);
+
+	// Sort the visible flats farthest to nearest (relevant for transparencies).
+	this->sortVisibleFlats();
+}
+
+void SoftwareRenderer::sortVisibleFlats()
+{
+	ProfileScope("SoftwareRenderer::sortVisibleFlats");
+
+	const int flatCount = static_cast<int>(this->visibleFlats.size());
+	const int listCount = this->flats.getCount();
+	if (this->flatRanks.size() != static_cast<size_t>(listCount))
+	{
+		this->flatRanks.assign(listCount, -1);
+	}
+
+	// The last frame's order is only a starting point, so it's fine if flats were added
+	// or removed since then. Indices past the end of the flat list are just skipped.
+	const int lastCount = static_cast<int>(this->visibleFlatOrder.size());
+	for (int i = 0; i < lastCount; i++)
+	{
+		const int flatIndex = this->visibleFlatOrder[i];
+		if (flatIndex < listCount)
+		{
+			this->flatRanks[flatIndex] = i;
+		}
+	}
+
+	// Flats that were visible last frame go in their old places, and new ones after them.
+	// Removing the unused places keeps both groups in order.
+	std::vector<FlatSortKey> &keys = this->flatSortKeys;
+	keys.assign(lastCount, FlatSortKey { 0.0, -1 });
+
+	int oldCount = 0;
+	for (int i = 0; i < flatCount; i++)
+	{
+		const FlatFrame &flatFrame = this->visibleFlats[i];
+		const int rank = this->flatRanks[flatFrame.flatIndex];
+		if (rank >= 0)
+		{
+			keys[rank] = FlatSortKey { flatFrame.z, i };
+			oldCount++;
+		}
+		else
+		{
+			keys.push_back(FlatSortKey { flatFrame.z, i });
+		}
+	}
+
+	keys.erase(std::remove_if(keys.begin(), keys.end(),
+		[](const FlatSortKey &key) { return key.index < 0; }), keys.end());
+
+	for (int i = 0; i < lastCount; i++)
+	{
+		const int flatIndex = this->visibleFlatOrder[i];
+		if (flatIndex < listCount)
+		{
+			this->flatRanks[flatIndex] = -1;
+		}
+	}
+
+	auto isFarther = [](const FlatSortKey &a, const FlatSortKey &b)
+	{
+		return a.z > b.z;
+	};
+
+	// Insertion sort is linear when the flats barely moved since the last frame, but
+	// quadratic when their order changed a lot (like when turning around), so it gives up
+	// after a few moves per flat.
+	const auto oldEnd = keys.begin() + oldCount;
+	int movesLeft = oldCount * SoftwareRenderer::MAX_FLAT_SORT_MOVES;
+	for (int i = 1; (i < oldCount) && (movesLeft >= 0); i++)
+	{
+		const FlatSortKey key = keys[i];
+		int j = i;
+		while ((j > 0) && isFarther(key, keys[j - 1]) && (movesLeft >= 0))
+		{
+			keys[j] = keys[j - 1];
+			j--;
+			movesLeft--;
+		}
+
+		keys[j] = key;
+	}
+
+	if (movesLeft < 0)
+	{
+		std::sort(keys.begin(), oldEnd, isFarther);
+	}
+
+	// New flats are sorted on their own and merged in.
+	if (oldEnd != keys.end())
+	{
+		std::sort(oldEnd, keys.end(), isFarther);
+		std::inplace_merge(keys.begin(), oldEnd, keys.end(), isFarther);
+	}
+
+	this->sortedFlats.clear();
+	this->visibleFlatOrder.clear();
+	for (const FlatSortKey &key : keys)
+	{
+		this->sortedFlats.push_back(std::move(this->visibleFlats[key.index]));
+		this->visibleFlatOrder.push_back(this->sortedFlats.back().flatIndex);
+	}
+
+	std::swap(this->visibleFlats, this->sortedFlats);
+}
+
+void SoftwareRenderer::updateLightGrid()
+{
+	ProfileScope("SoftwareRenderer::updateLightGrid");
+
+	this->lightGrid = LightGrid();
+
+	if (this->lights.size() == 0)
+	{
+		return;
+	}
+
+	// Get the voxel bounds of everything the lights can reach.
+	auto getMinVoxel = [](double coord, double radius)
+	{
+		return static_cast<int>(std::floor(coord - radius));
+	};
+
+	auto getMaxVoxel = [](double coord, double radius)
+	{
+		return static_cast<int>(std::floor(coord + radius));
+	};
+
+	int minX = std::numeric_limits<int>::max();
+	int minZ = std::numeric_limits<int>::max();
+	int maxX = std::numeric_limits<int>::min();
+	int maxZ = std::numeric_limits<int>::min();
+	for (const auto &pair : this->lights)
+	{
+		const Light &light = pair.second;
+		minX = std::min(minX, getMinVoxel(light.point.x, light.intensity));
+		minZ = std::min(minZ, getMinVoxel(light.point.z, light.intensity));
+		maxX = std::max(maxX, getMaxVoxel(light.point.x, light.intensity));
+		maxZ = std::max(maxZ, getMaxVoxel(light.point.z, light.intensity));
+	}
+
+	this->lightGrid.originX = minX;
+	this->lightGrid.originZ = minZ;
+	this->lightGrid.width = (maxX - minX) + 1;
+	this->lightGrid.depth = (maxZ - minZ) + 1;
+	this->lightGrid.cells.resize(this->lightGrid.width * this->lightGrid.depth);
+
+	// Put each light in every cell of its bounding square. The falloff is checked per
+	// pixel, so the corners don't need to be trimmed.
+	for (const auto &pair : this->lights)
+	{
+		const Light &light = pair.second;
+		const int startX = getMinVoxel(light.point.x, light.intensity) - minX;
+		const int endX = getMaxVoxel(light.point.x, light.intensity) - minX;
+		const int startZ = getMinVoxel(light.point.z, light.intensity) - minZ;
+		const int endZ = getMaxVoxel(light.point.z, light.intensity) - minZ;
+
+		for (int z = startZ; z <= endZ; z++)
+		{
+			for (int x = startX; x <= endX; x++)
+			{
+				this->lightGrid.cells[x + (z * this->lightGrid.width)].push_back(&light);
+			}
+		}
+	}
+}
+
+/*Double3 SoftwareRenderer::castRay(const Double3 &direction,
+	const VoxelGrid &voxelGrid) const
+{
+	// This is an extension of Lode Vandevenne's DDA algorithm from 2D to 3D.
+	// Technically, it could be considered a "3D-DDA" algorithm. It will eventually 
+	// have some additional features so all of Arena's geometry can be represented.
+
+	// To do:
+	// - Figure out proper DDA lengths for variable-height voxels, and why using
+	//   voxelHeight squared instead of 1.0 in deltaDist.y looks weird (sideDist.y?).
+	// - Cuboids within voxels (bridges, beds, shelves) with variable Y offset and size.
+	// - Sprites (SpriteGrid? Sprite data, and list of sprite IDs per voxel).
+	// - Transparent textures (check texel alpha in DDA loop).
+	// - Sky (if hitID == 0).
+	// - Shading (shadows from the sun, point lights).
+
+	// Some floating point behavior assumptions:
+	// -> (value / 0.0) == infinity
+	// -> (value / infinity) == 0.0
+	// -> (int)(-0.8) == 0
+	// -> (int)floor(-0.8) == -1
+	// -> (int)ceil(-0.8) == 0
+
+	const Double3 dirSquared(
+		direction.x * direction.x,
+		direction.y * direction.y,
+		direction.z * direction.z);
+
+	// Height (Y size) of each voxel in the voxel grid. Some levels in Arena have
+	// "tall" voxels, so the voxel height must be a variable.
+	const double voxelHeight = voxelGrid.getVoxelHeight();
+
+	// A custom variable that represents the Y "floor" of the current voxel.
+	const double eyeYRelativeFloor = std::floor(this->eye.y / voxelHeight) * voxelHeight;
+
+	// Calculate delta distances along each axis. These determine how far
+	// the ray has to go until the next X, Y, or Z side is hit, respectively.
+	const Double3 deltaDist(
+		std::sqrt(1.0 + (dirSquared.y / dirSquared.x) + (dirSquared.z / dirSquared.x)),
+		std::sqrt(1.0 + (dirSquared.x / dirSquared.y) + (dirSquared.z / dirSquared.y)),
+		std::sqrt(1.0 + (dirSquared.x / dirSquared.z) + (dirSquared.y / dirSquared.z)));
+
+	// Booleans for whether a ray component is non-negative. Used with step directions 
+	// and texture coordinates.
+	const bool nonNegativeDirX = direction.x >= 0.0;
+	const bool nonNegativeDirY = direction.y >= 0.0;
+	const bool nonNegativeDirZ = direction.z >= 0.0;
+
+	// Calculate step directions and initial side distances.
+	Int3 step;
+	Double3 sideDist;
+	if (nonNegativeDirX)
+	{
+		step.x = 1;
+		sideDist.x = (this->startCellReal.x + 1.0 - this->eye.x) * deltaDist.x;
+	}
+	else
+	{
+		step.x = -1;
+		sideDist.x = (this->eye.x - this->startCellReal.x) * deltaDist.x;
+	}
+
+	if (nonNegativeDirY)
+	{
+		step.y = 1;
+		sideDist.y = (eyeYRelativeFloor + voxelHeight - this->eye.y) * deltaDist.y;
+	}
+	else
+	{
+		step.y = -1;
+		sideDist.y = (this->eye.y - eyeYRelativeFloor) * deltaDist.y;
+	}
+
+	if (nonNegativeDirZ)
+	{
+		step.z = 1;
+		sideDist.z = (this->startCellReal.z + 1.0 - this->eye.z) * deltaDist.z;
+	}
+	else
+	{
+		step.z = -1;
+		sideDist.z = (this->eye.z - this->startCellReal.z) * deltaDist.z;
+	}
+
+	// Make a copy of the initial side distances. They are used for the special case 
+	// of the ray ending in the same voxel it started in.
+	const Double3 initialSideDist = sideDist;
+
+	// Make a copy of the step magnitudes, converted to doubles.
+	const Double3 stepReal(
+		static_cast<double>(step.x),
+		static_cast<double>(step.y),
+		static_cast<double>(step.z));
+
+	// Get initial voxel coordinates.
+	Int3 cell = this->startCell;
+
+	// ID of a hit voxel. Zero (air) by default.
+	char hitID = 0;
+
+	// Axis of a hit voxel's side. X by default.
+	enum class Axis { X, Y, Z };
+	Axis axis = Axis::X;
+
+	// Distance squared (in voxels) that the ray has stepped. Square roots are
+	// too slow to use in the DDA loop, so this is used instead.
+	// - When using variable-sized voxels, this may be calculated differently.
+	double cellDistSquared = 0.0;
+
+	// Offset values for which corner of a voxel to compare the distance 
+	// squared against. The correct corner to use is important when culling
+	// shapes at max view distance.
+	const Double3 startCellWithOffset(
+		this->startCellReal.x + ((1.0 + stepReal.x) / 2.0),
+		eyeYRelativeFloor + (((1.0 + stepReal.y) / 2.0) * voxelHeight),
+		this->startCellReal.z + ((1.0 + stepReal.z) / 2.0));
+	const Double3 cellOffset(
+		(1.0 - stepReal.x) / 2.0,
+		((1.0 - stepReal.y) / 2.0) * voxelHeight,
+		(1.0 - stepReal.z) / 2.0);
+
+	// Get dimensions of the voxel grid.
+	const int gridWidth = voxelGrid.getWidth();
+	const int gridHeight = voxelGrid.getHeight();
+	const int gridDepth = voxelGrid.getDepth();
+
+	// Check world bounds on the start voxel. Bounds are partially recalculated 
+	// for axes that the DDA loop is stepping through.
+	bool voxelIsValid = (cell.x >= 0) && (cell.y >= 0) && (cell.z >= 0) &&
+		(cell.x < gridWidth) && (cell.y < gridHeight) && (cell.z < gridDepth);
+
+	// Step through the voxel grid while the current coordinate is valid and
+	// the total voxel distance stepped is less than the view distance.
+	// (Note that the "voxel distance" is not the same as "actual" distance.)
+	const char *voxels = voxelGrid.getVoxels();
+	while (voxelIsValid && (cellDistSquared < this->viewDistSquared))
+	{
+		// Get the index of the current voxel in the voxel grid.
+		const int gridIndex = cell.x + (cell.y * gridWidth) +
+			(cell.z * gridWidth * gridHeight);
+
+		// Check if the current voxel is solid.
+		const char voxelID = voxels[gridIndex];
+
+		if (voxelID > 0)
+		{
+			hitID = voxelID;
+			break;
+		}
+
+		if ((sideDist.x < sideDist.y) && (sideDist.x < sideDist.z))
+		{
+			sideDist.x += deltaDist.x;
+			cell.x += step.x;
+			axis = Axis::X;
+			voxelIsValid &= (cell.x >= 0) && (cell.x < gridWidth);
+		}
+		else if (sideDist.y < sideDist.z)
+		{
+			sideDist.y += deltaDist.y;
+			cell.y += step.y;
+			axis = Axis::Y;
+			voxelIsValid &= (cell.y >= 0) && (cell.y < gridHeight);
+		}
+		else
+		{
+			sideDist.z += deltaDist.z;
+			cell.z += step.z;
+			axis = Axis::Z;
+			voxelIsValid &= (cell.z >= 0) && (cell.z < gridDepth);
+		}
+
+		// Refresh how far the current cell is from the start cell, squared.
+		// The "offsets" move each point to the correct corner for each voxel
+		// so that the stepping stops correctly at max view distance.
+		const Double3 cellDiff(
+			(static_cast<double>(cell.x) + cellOffset.x) - startCellWithOffset.x,
+			(static_cast<double>(cell.y) + cellOffset.y) - startCellWithOffset.y,
+			(static_cast<double>(cell.z) + cellOffset.z) - startCellWithOffset.z);
+		cellDistSquared = (cellDiff.x * cellDiff.x) + (cellDiff.y * cellDiff.y) +
+			(cellDiff.z * cellDiff.z);
+	}
+
+	// Boolean for whether the ray ended in the same voxel it started in.
+	const bool stoppedInFirstVoxel = cell == this->startCell;
+
+	// Get the distance from the camera to the hit point. It is a special case
+	// if the ray stopped in the first voxel.
+	double distance;
+	if (stoppedInFirstVoxel)
+	{
+		if ((initialSideDist.x < initialSideDist.y) &&
+			(initialSideDist.x < initialSideDist.z))
+		{
+			distance = initialSideDist.x;
+			axis = Axis::X;
+		}
+		else if (initialSideDist.y < initialSideDist.z)
+		{
+			distance = initialSideDist.y;
+			axis = Axis::Y;
+		}
+		else
+		{
+			distance = initialSideDist.z;
+			axis = Axis::Z;
+		}
+	}
+	else
+	{
+		const size_t axisIndex = static_cast<size_t>(axis);
+
+		// Assign to distance based on which axis was hit.
+		if (axis == Axis::X)
+		{
+			distance = (static_cast<double>(cell.x) - this->eye.x +
+				((1.0 - stepReal.x) / 2.0)) / direction.x;
+		}
+		else if (axis == Axis::Y)
+		{
+			distance = ((static_cast<double>(cell.y) * voxelHeight) - this->eye.y +
+				(((1.0 - stepReal.y) / 2.0) * voxelHeight)) / direction.y;
+		}
+		else
+		{
+			distance = (static_cast<double>(cell.z) - this->eye.z +
+				((1.0 - stepReal.z) / 2.0)) / direction.z;
+		}
+	}
+
+	// If there was a hit, get the shaded color.
+	if (hitID > 0)
+	{
+		// Intersection point on the voxel.
+		const Double3 hitPoint = this->eye + (direction * distance);
+
+		// Boolean for whether the hit point is on the back of a voxel face.
+		const bool backFace = stoppedInFirstVoxel;
+
+		// Texture coordinates. U and V are affected by which side is hit (near, far),
+		// and whether the hit point is on the front or back of the voxel face.
+		// - Note, for edge cases where {u,v}Val == 1.0, the texture coordinate is
+		//   out of bounds by one pixel, so instead of 1.0, something like 0.9999999
+		//   should be used instead. std::nextafter(1.0, -INFINITY)?
+		double u, v;
+		if (axis == Axis::X)
+		{
+			const double uVal = hitPoint.z - std::floor(hitPoint.z);
+
+			u = (nonNegativeDirX ^ backFace) ? uVal : (1.0 - uVal);
+			//v = 1.0 - (hitPoint.y - std::floor(hitPoint.y));
+			v = 1.0 - (std::fmod(hitPoint.y, voxelHeight) / voxelHeight);
+		}
+		else if (axis == Axis::Y)
+		{
+			const double vVal = hitPoint.x - std::floor(hitPoint.x);
+
+			u = hitPoint.z - std::floor(hitPoint.z);
+			v = (nonNegativeDirY ^ backFace) ? vVal : (1.0 - vVal);
+		}
+		else
+		{
+			const double uVal = hitPoint.x - std::floor(hitPoint.x);
+
+			u = (nonNegativeDirZ ^ backFace) ? (1.0 - uVal) : uVal;
+			//v = 1.0 - (hitPoint.y - std::floor(hitPoint.y));
+			v = 1.0 - (std::fmod(hitPoint.y, voxelHeight) / voxelHeight);
+		}
+
+		// -- temp --
+		// Display bad texture coordinates as magenta. If any of these is true, it
+		// means something above is wrong.
+		if ((u < 0.0) || (u >= 1.0) || (v < 0.0) || (v >= 1.0))
+		{
+			return Double3(1.0, 0.0, 1.0);
+		}
+		// -- end temp --
+
+		// Get the voxel data associated with the ID. Subtract 1 because the first
+		// entry is at index 0 but the lowest hitID is 1.
+		const VoxelData &voxelData = voxelGrid.getVoxelData(hitID - 1);
+
+		// Get the texture depending on which face was hit.
+		const TextureData &texture = (axis == Axis::Y) ?
+			this->textures[voxelData.floorAndCeilingID] :
+			this->textures[voxelData.sideID];
+
+		// Calculate position in texture.
+		const int textureX = static_cast<int>(u * texture.width);
+		const int textureY = static_cast<int>(v * texture.height);
+
+		// Get the texel color at the hit point.
+		// - Later, the alpha component can be used for transparency and ignoring
+		//   intersections (in the DDA loop).
+		const Double4 &texel = texture.pixels[textureX + (textureY * texture.width)];
+
+		// Convert the texel to a 3-component color.
+		const Double3 color(texel.x, texel.y, texel.z);
+
+		// Linearly interpolate with some depth.
+		const double depth = std::min(distance, this->viewDistance) / this->viewDistance;
+		return color.lerp(this->fogColor, depth);
+	}
+	else
+	{
+		// No intersection. Return sky color.
+		return this->fogColor;
+	}
+}*/
+
+Double3 SoftwareRenderer::getFogColor(double daytimePercent) const
+{
+	// Get the real index (not the integer index), so the color can be interpolated
+	// between two samples.
+	const double realIndex = static_cast<double>(this->skyPalette.size()) * daytimePercent;
+
+	const size_t index = static_cast<size_t>(realIndex);
+	const size_t nextIndex = (index + 1) % this->skyPalette.size();
+
+	const Double3 &color = this->skyPalette[index];
+	const Double3 &nextColor = this->skyPalette[nextIndex];
+
+	const double percent = realIndex - std::floor(realIndex);
+	return color.lerp(nextColor, percent);
+}
+
+Double3 SoftwareRenderer::getSunDirection(double daytimePercent) const
+{
+	// The sun rises in the east (+Z) and sets in the west (-Z).
+	const double radians = daytimePercent * (2.0 * Constants::Pi);
+	return Double3(0.0, -std::cos(radians), std::sin(radians)).normalized();
+}
+
+uint8_t SoftwareRenderer::getPaletteIndex(uint8_t r, uint8_t g, uint8_t b, bool canAdd)
+{
+	const uint32_t color = (r << 16) | (g << 8) | b;
+	const auto iter = this->paletteIndices.find(color);
+	if (iter != this->paletteIndices.end())
+	{
+		return iter->second;
+	}
+
+	// Arena's textures share one 256-color palette, so there is normally room for all of 
+	// their colors.
+	if (canAdd && (static_cast<int>(this->palette.size()) < SoftwareRenderer::PALETTE_SIZE))
+	{
+		const uint8_t index = static_cast<uint8_t>(this->palette.size());
+		this->palette.push_back(color);
+		this->paletteIndices.insert(std::make_pair(color, index));
+		return index;
+	}
+
+	// Otherwise, find the closest color.
+	int nearestIndex = 0;
+	int nearestDistance = std::numeric_limits<int>::max();
+	for (size_t i = 0; i < this->palette.size(); i++)
+	{
+		const uint32_t paletteColor = this->palette[i];
+		const int dr = static_cast<int>((paletteColor >> 16) & 0xFF) - r;
+		const int dg = static_cast<int>((paletteColor >> 8) & 0xFF) - g;
+		const int db = static_cast<int>(paletteColor & 0xFF) - b;
+		const int distance = (dr * dr) + (dg * dg) + (db * db);
+
+		if (distance < nearestDistance)
+		{
+			nearestIndex = static_cast<int>(i);
+			nearestDistance = distance;
+		}
+	}
+
+	return static_cast<uint8_t>(nearestIndex);
+}
+
+void SoftwareRenderer::updatePaletteIndices(VoxelTexture &texture)
+{
+	for (auto &texel : texture.texels)
+	{
+		texel.index = this->getPaletteIndex(texel.r, texel.g, texel.b, true);
+	}
+
+	for (auto &texel : texture.mipTexels)
+	{
+		texel.index = this->getPaletteIndex(texel.r, texel.g, texel.b, false);
+	}
+
+	// Mip levels can have colors the base level doesn't, so they're in the cycle too.
+	std::vector<bool> usedIndices(SoftwareRenderer::PALETTE_SIZE, false);
+	for (const auto &texel : texture.texels)
+	{
+		usedIndices[texel.index] = true;
+	}
+
+	for (const auto &texel : texture.mipTexels)
+	{
+		usedIndices[texel.index] = true;
+	}
+
+	texture.cycleIndices.clear();
+	for (int i = 0; i < SoftwareRenderer::PALETTE_SIZE; i++)
+	{
+		if (usedIndices[i])
+		{
+			texture.cycleIndices.push_back(static_cast<uint8_t>(i));
+		}
+	}
+
+	auto getLuma = [this](uint8_t index)
+	{
+		const uint32_t color = this->palette[index];
+		return (((color >> 16) & 0xFF) * 299) + (((color >> 8) & 0xFF) * 587) +
+			((color & 0xFF) * 114);
+	};
+
+	std::stable_sort(texture.cycleIndices.begin(), texture.cycleIndices.end(),
+		[&getLuma](uint8_t a, uint8_t b)
+	{
+		return getLuma(a) < getLuma(b);
+	});
+}
+
+void SoftwareRenderer::updateCycledIndices()
+{
+	const int textureCount = static_cast<int>(this->voxelTextures.size());
+	this->cycledIndices.resize(textureCount * SoftwareRenderer::PALETTE_SIZE);
+
+	// Only a few textures are liquids, and each table is small, so they're just made again
+	// every frame. Indices not in a texture's cycle stay the same.
+	for (int i = 0; i < textureCount; i++)
+	{
+		if ((this->liquidTextureMask & (static_cast<uint64_t>(1) << i)) == 0)
+		{
+			continue;
+		}
+
+		uint8_t *table = this->cycledIndices.data() + (i * SoftwareRenderer::PALETTE_SIZE);
+		for (int j = 0; j < SoftwareRenderer::PALETTE_SIZE; j++)
+		{
+			table[j] = static_cast<uint8_t>(j);
+		}
+
+		const std::vector<uint8_t> &cycle = this->voxelTextures[i].cycleIndices;
+		const int cycleCount = static_cast<int>(cycle.size());
+		for (int j = 0; j < cycleCount; j++)
+		{
+			table[cycle[j]] = cycle[(j + this->liquidCycleStep) % cycleCount];
+		}
+	}
+}
+
+const SoftwareRenderer::FlatTextureSet &SoftwareRenderer::getFlatTextureSet(int id) const
+{
+	return (id >= 0) && (id < static_cast<int>(this->flatTextures.size())) ?
+		*this->flatTextures[id] : *this->emptyFlatTextureSet;
+}
+
+void SoftwareRenderer::setFlatTextureSet(int id,
+	std::shared_ptr<const FlatTextureSet> textureSet)
+{
+	std::shared_ptr<const FlatTextureSet> &dstTextureSet = this->flatTextures[id];
+	if (dstTextureSet == textureSet)
+	{
+		return;
+	}
+
+	if (textureSet != this->emptyFlatTextureSet)
+	{
+		int &uses = this->flatTextureSetUses[textureSet.get()];
+		if (uses == 0)
+		{
+			const size_t byteCount = textureSet->getByteCount();
+			MemoryTracker::add(MemoryTag::RendererTextures, byteCount);
+			this->flatTextureBytes += byteCount;
+		}
+
+		uses++;
+	}
+
+	const FlatTextureSet *oldTextureSet = dstTextureSet.get();
+	if (dstTextureSet != this->emptyFlatTextureSet)
+	{
+		const auto usesIter = this->flatTextureSetUses.find(oldTextureSet);
+		DebugAssert(usesIter != this->flatTextureSetUses.end(),
+			"Flat texture set of ID " + std::to_string(id) + " isn't counted.");
+
+		usesIter->second--;
+		if (usesIter->second == 0)
+		{
+			this->flatTextureSetUses.erase(usesIter);
+
+			const size_t byteCount = oldTextureSet->getByteCount();
+			MemoryTracker::remove(MemoryTag::RendererTextures, byteCount);
+			this->flatTextureBytes -= byteCount;
+
+			// A hash collision's set was never shared, so it leaves the shared one alone.
+			const auto sharedIter = this->flatTextureSets.find(oldTextureSet->hash);
+			if ((sharedIter != this->flatTextureSets.end()) &&
+				(sharedIter->second.lock().get() == oldTextureSet))
+			{
+				this->flatTextureSets.erase(sharedIter);
+			}
+		}
+	}
+
+	dstTextureSet = std::move(textureSet);
+}
+
+void SoftwareRenderer::updatePaletteShades(const ShadingInfo &shadingInfo)
+{
+	ProfileScope("SoftwareRenderer::updatePaletteShades");
+
+	const int tableSize = SoftwareRenderer::PALETTE_FOG_LEVELS * SoftwareRenderer::PALETTE_SIZE;
+	const int shadingCount = static_cast<int>(shadingInfo.normalShadings.size());
+	this->paletteShades.resize((shadingCount + 1) * tableSize);
+
+	// Emissive texels are at full brightness regardless of the light.
+	const Double3 emissiveShading(1.0, 1.0, 1.0);
+	const Double3 &fogColor = shadingInfo.horizonSkyColor;
+	const double maxLevel = static_cast<double>(SoftwareRenderer::PALETTE_FOG_LEVELS - 1);
+	const int colorCount = static_cast<int>(this->palette.size());
+
+	for (int i = 0; i <= shadingCount; i++)
+	{
+		const Double3 &shading = (i < shadingCount) ?
+			shadingInfo.normalShadings[i] : emissiveShading;
+		uint32_t *table = this->paletteShades.data() + (i * tableSize);
+
+		for (int level = 0; level < SoftwareRenderer::PALETTE_FOG_LEVELS; level++)
+		{
+			const double fogPercent = static_cast<double>(level) / maxLevel;
+			uint32_t *row = table + (level * SoftwareRenderer::PALETTE_SIZE);
+
+			// Same shading and fog as the per-pixel path, so only the fog is quantized.
+			for (int j = 0; j < colorCount; j++)
+			{
+				const Double3 color = Double3::fromRGB(this->palette[j]);
+				const Double3 shaded(
+					color.x * std::min(shading.x, 1.0),
+					color.y * std::min(shading.y, 1.0),
+					color.z * std::min(shading.z, 1.0));
+				row[j] = shaded.lerp(fogColor, fogPercent).clamped().toRGB();
+			}
+		}
+	}
+}
+
+double SoftwareRenderer::fullAtan2(double y, double x)
+{
+	const double angle = std::atan2(y, x);
+	return (angle >= 0.0) ? angle : ((2.0 * Constants::Pi) + angle);
+}
+
+Double3 SoftwareRenderer::getNormal(VoxelData::Facing facing)
+{
+	// Decide what the normal is, based on the facing. It can only be on the X or Z axis 
+	// because floors and ceilings are drawn separately from walls, and their 
+	// normals are trivial.
+	if (facing == VoxelData::Facing::PositiveX)
+	{
+		return Double3::UnitX;
+	}
+	else if (facing == VoxelData::Facing::NegativeX)
+	{
+		return -Double3::UnitX;
+	}
+	else if (facing == VoxelData::Facing::PositiveZ)
+	{
+		return Double3::UnitZ;
+	}
+	else
+	{
+		return -Double3::UnitZ;
+	}
+}
+
+VoxelData::Facing SoftwareRenderer::getInitialChasmFarFacing(int voxelX, int voxelZ,
+	const Double2 &eye, const Ray &ray)
+{
+	// Angle of the ray from the camera eye.
+	const double angle = SoftwareRenderer::fullAtan2(ray.dirX, ray.dirZ);
+
+	// Corners in world space.
+	const Double2 bottomLeftCorner(
+		static_cast<double>(voxelX),
+		static_cast<double>(voxelZ));
+	const Double2 topLeftCorner(
+		bottomLeftCorner.x + 1.0,
+		bottomLeftCorner.y);
+	const Double2 bottomRightCorner(
+		bottomLeftCorner.x,
+		bottomLeftCorner.y + 1.0);
+	const Double2 topRightCorner(
+		topLeftCorner.x,
+		bottomRightCorner.y);
+
+	const Double2 upLeft = (topLeftCorner - eye).normalized();
+	const Double2 upRight = (topRightCorner - eye).normalized();
+	const Double2 downLeft = (bottomLeftCorner - eye).normalized();
+	const Double2 downRight = (bottomRightCorner - eye).normalized();
+	const double upLeftAngle = SoftwareRenderer::fullAtan2(upLeft.x, upLeft.y);
+	const double upRightAngle = SoftwareRenderer::fullAtan2(upRight.x, upRight.y);
+	const double downLeftAngle = SoftwareRenderer::fullAtan2(downLeft.x, downLeft.y);
+	const double downRightAngle = SoftwareRenderer::fullAtan2(downRight.x, downRight.y);
+
+	// Find which range the ray's angle lies within.
+	if ((angle < upRightAngle) || (angle > downRightAngle))
+	{
+		return VoxelData::Facing::PositiveZ;
+	}
+	else if (angle < upLeftAngle)
+	{
+		return VoxelData::Facing::PositiveX;
+	}
+	else if (angle < downLeftAngle)
+	{
+		return VoxelData::Facing::NegativeZ;
+	}
+	else
+	{
+		return VoxelData::Facing::NegativeX;
 	}
 }
 
 VoxelData::Facing SoftwareRenderer::getChasmFarFacing(int voxelX, int voxelZ, 
 	VoxelData::Facing nearFacing, const Camera &camera, const Ray &ray)
 {
-	const Double2 eye2D(camera.eye.x, camera.eye.z);
-	
-	// Angle of the ray from the camera eye.
-	const double angle = SoftwareRenderer::fullAtan2(ray.dirX, ray.dirZ);
+	const Double2 eye2D(camera.eye.x, camera.eye.z);
+	
+	// Angle of the ray from the camera eye.
+	const double angle = SoftwareRenderer::fullAtan2(ray.dirX, ray.dirZ);
+
+	// Corners in world space.
+	const Double2 bottomLeftCorner(
+		static_cast<double>(voxelX),
+		static_cast<double>(voxelZ));
+	const Double2 topLeftCorner(
+		bottomLeftCorner.x + 1.0,
+		bottomLeftCorner.y);
+	const Double2 bottomRightCorner(
+		bottomLeftCorner.x,
+		bottomLeftCorner.y + 1.0);
+	const Double2 topRightCorner(
+		topLeftCorner.x,
+		bottomRightCorner.y);
+
+	const Double2 upLeft = (topLeftCorner - eye2D).normalized();
+	const Double2 upRight = (topRightCorner - eye2D).normalized();
+	const Double2 downLeft = (bottomLeftCorner - eye2D).normalized();
+	const Double2 downRight = (bottomRightCorner - eye2D).normalized();
+	const double upLeftAngle = SoftwareRenderer::fullAtan2(upLeft.x, upLeft.y);
+	const double upRightAngle = SoftwareRenderer::fullAtan2(upRight.x, upRight.y);
+	const double downLeftAngle = SoftwareRenderer::fullAtan2(downLeft.x, downLeft.y);
+	const double downRightAngle = SoftwareRenderer::fullAtan2(downRight.x, downRight.y);
+
+	// Find which side it starts on, then do some checks against line angles.
+	// When the ray origin is at a diagonal to the voxel, ignore the corner
+	// closest to that origin.
+	if (nearFacing == VoxelData::Facing::PositiveX)
+	{
+		// Starts on (1.0, z).
+		const bool onRight = camera.eyeVoxel.z > voxelZ;
+		const bool onLeft = camera.eyeVoxel.z < voxelZ;
+		
+		if (onRight)
+		{
+			// Ignore top-right corner.
+			if (angle < downLeftAngle)
+			{
+				return VoxelData::Facing::NegativeZ;
+			}
+			else
+			{
+				return VoxelData::Facing::NegativeX;
+			}
+		}
+		else if (onLeft)
+		{
+			// Ignore top-left corner.
+			if ((angle > downLeftAngle) && (angle < downRightAngle))
+			{
+				return VoxelData::Facing::NegativeX;
+			}
+			else
+			{
+				return VoxelData::Facing::PositiveZ;
+			}
+		}
+		else
+		{
+			if (angle > downRightAngle)
+			{
+				return VoxelData::Facing::PositiveZ;
+			}
+			else if (angle > downLeftAngle)
+			{
+				return VoxelData::Facing::NegativeX;
+			}
+			else
+			{
+				return VoxelData::Facing::NegativeZ;
+			}
+		}
+	}
+	else if (nearFacing == VoxelData::Facing::NegativeX)
+	{
+		// Starts on (0.0, z).
+		const bool onRight = camera.eyeVoxel.z > voxelZ;
+		const bool onLeft = camera.eyeVoxel.z < voxelZ;
+
+		if (onRight)
+		{
+			// Ignore bottom-right corner.
+			if (angle < upLeftAngle)
+			{
+				return VoxelData::Facing::PositiveX;
+			}
+			else
+			{
+				return VoxelData::Facing::NegativeZ;
+			}
+		}
+		else if (onLeft)
+		{
+			// Ignore bottom-left corner.
+			if (angle < upRightAngle)
+			{
+				return VoxelData::Facing::PositiveZ;
+			}
+			else
+			{
+				return VoxelData::Facing::PositiveX;
+			}
+		}
+		else
+		{
+			if (angle < upRightAngle)
+			{
+				return VoxelData::Facing::PositiveZ;
+			}
+			else if (angle < upLeftAngle)
+			{
+				return VoxelData::Facing::PositiveX;
+			}
+			else
+			{
+				return VoxelData::Facing::NegativeZ;
+			}
+		}
+	}				
+	else if (nearFacing == VoxelData::Facing::PositiveZ)
+	{
+		// Starts on (x, 1.0).
+		const bool onTop = camera.eyeVoxel.x > voxelX;
+		const bool onBottom = camera.eyeVoxel.x < voxelX;
+
+		if (onTop)
+		{
+			// Ignore top-right corner.
+			if (angle < downLeftAngle)
+			{
+				return VoxelData::Facing::NegativeZ;
+			}
+			else
+			{
+				return VoxelData::Facing::NegativeX;
+			}
+		}
+		else if (onBottom)
+		{
+			// Ignore bottom-right corner.
+			if (angle < upLeftAngle)
+			{
+				return VoxelData::Facing::PositiveX;
+			}
+			else
+			{
+				return VoxelData::Facing::NegativeZ;
+			}
+		}
+		else
+		{
+			if (angle < upLeftAngle)
+			{
+				return VoxelData::Facing::PositiveX;
+			}
+			else if (angle < downLeftAngle)
+			{
+				return VoxelData::Facing::NegativeZ;
+			}
+			else
+			{
+				return VoxelData::Facing::NegativeX;
+			}
+		}
+	}
+	else
+	{
+		// Starts on (x, 0.0). This one splits the origin, so it needs some 
+		// special cases.
+		const bool onTop = camera.eyeVoxel.x > voxelX;
+		const bool onBottom = camera.eyeVoxel.x < voxelX;
+
+		if (onTop)
+		{
+			// Ignore top-left corner.
+			if ((angle > downLeftAngle) && (angle < downRightAngle))
+			{
+				return VoxelData::Facing::NegativeX;
+			}
+			else
+			{
+				return VoxelData::Facing::PositiveZ;
+			}
+		}
+		else if (onBottom)
+		{
+			// Ignore bottom-left corner.
+			if ((angle > upRightAngle) && (angle < upLeftAngle))
+			{
+				return VoxelData::Facing::PositiveX;
+			}
+			else
+			{
+				return VoxelData::Facing::PositiveZ;
+			}
+		}
+		else
+		{
+			if ((angle < upRightAngle) || (angle > downRightAngle))
+			{
+				return VoxelData::Facing::PositiveZ;
+			}
+			else if (angle > downLeftAngle)
+			{
+				return VoxelData::Facing::NegativeX;
+			}
+			else
+			{
+				return VoxelData::Facing::PositiveX;
+			}
+		}
+	}
+}
+
+int SoftwareRenderer::getMipLevel(double texelsPerPixel, int maxMipLevel)
+{
+	// Each level halves the texels per pixel. If texels are already at least as big as 
+	// pixels, the full-size level is used. A NaN rate (i.e., from a zero-size range) 
+	// also falls back to the full-size level.
+	int level = 0;
+	while ((level < maxMipLevel) && (texelsPerPixel >= 2.0))
+	{
+		texelsPerPixel *= 0.50;
+		level++;
+	}
+
+	return level;
+}
+
+void SoftwareRenderer::getFixedTexelRows(int yStart, int yEnd, double projectedYStart,
+	double projectedYEnd, double vStart, double vEnd, int mipWidth, int *texelRow,
+	int *texelRowStep)
+{
+	const double mipWidthReal = static_cast<double>(mipWidth);
+	const double columnHeight = projectedYEnd - projectedYStart;
+	const double yPercent =
+		((static_cast<double>(yStart) + 0.50) - projectedYStart) / columnHeight;
+	double row = (vStart + ((vEnd - vStart) * yPercent)) * mipWidthReal;
+	double rowStep = ((vEnd - vStart) * mipWidthReal) / columnHeight;
+
+	// A column much shorter than a pixel can have an enormous step, so keep the row within
+	// a couple of texture heights of the texture and the step within what the drawn pixels
+	// can accumulate. Clamping to the texture's edges hides the difference. NaN (i.e., from
+	// a zero-height column) ends up at the top edge.
+	const double rowLimit = 2.0 * mipWidthReal;
+	const double rowStepLimit = rowLimit / static_cast<double>(std::max(yEnd - yStart, 1));
+	row = (row > -rowLimit) ? std::min(row, rowLimit) : -rowLimit;
+	rowStep = (rowStep > -rowStepLimit) ? std::min(rowStep, rowStepLimit) : -rowStepLimit;
+
+	const double fractionScale =
+		static_cast<double>(1 << SoftwareRenderer::TEXEL_ROW_FRACTION_BITS);
+	*texelRow = static_cast<int>(std::floor(row * fractionScale));
+	*texelRowStep = static_cast<int>(std::floor(rowStep * fractionScale));
+}
+
+int SoftwareRenderer::getLowerBoundedPixel(double projected, int frameDim)
+{
+	return std::min(std::max(0,
+		static_cast<int>(std::ceil(projected - 0.50))), frameDim);
+}
+
+int SoftwareRenderer::getUpperBoundedPixel(double projected, int frameDim)
+{
+	return std::min(std::max(0,
+		static_cast<int>(std::floor(projected + 0.50))), frameDim);
+}
+
+bool SoftwareRenderer::findDiag1Intersection(int voxelX, int voxelZ, const Double2 &nearPoint,
+	const Double2 &farPoint, RayHit &hit)
+{
+	// Start, middle, and end points of the diagonal line segment relative to the grid.
+	const Double2 diagStart(
+		static_cast<double>(voxelX),
+		static_cast<double>(voxelZ));
+	const Double2 diagMiddle(
+		static_cast<double>(voxelX) + 0.50,
+		static_cast<double>(voxelZ) + 0.50);
+	const Double2 diagEnd(
+		static_cast<double>(voxelX) + Constants::JustBelowOne,
+		static_cast<double>(voxelZ) + Constants::JustBelowOne);
+
+	// Normals for the left and right faces of the wall, facing up-left and down-right
+	// respectively (magic number is sqrt(2) / 2).
+	const Double3 leftNormal(0.7071068, 0.0, -0.7071068);
+	const Double3 rightNormal(-0.7071068, 0.0, 0.7071068);
+	
+	// An intersection occurs if the near point and far point are on different sides 
+	// of the diagonal line, or if the near point lies on the diagonal line. No need
+	// to normalize the (localPoint - diagMiddle) vector because it's just checking
+	// if it's greater than zero.
+	const Double2 leftNormal2D(leftNormal.x, leftNormal.z);
+	const bool nearOnLeft = leftNormal2D.dot(nearPoint - diagMiddle) >= 0.0;
+	const bool farOnLeft = leftNormal2D.dot(farPoint - diagMiddle) >= 0.0;
+	const bool intersectionOccurred = (nearOnLeft && !farOnLeft) || (!nearOnLeft && farOnLeft);
+
+	// Only set the output data if an intersection occurred.
+	if (intersectionOccurred)
+	{
+		// Change in X and change in Z of the incoming ray across the voxel.
+		const double dx = farPoint.x - nearPoint.x;
+		const double dz = farPoint.y - nearPoint.y;
+
+		// The hit coordinate is a 0->1 value representing where the diagonal was hit.
+		const double hitCoordinate = [&nearPoint, &diagStart, dx, dz]()
+		{
+			// Special cases: when the slope is horizontal or vertical. This method treats
+			// the X axis as the vertical axis and the Z axis as the horizontal axis.
+			const double isHorizontal = std::abs(dx) < Constants::Epsilon;
+			const double isVertical = std::abs(dz) < Constants::Epsilon;
+
+			if (isHorizontal)
+			{
+				// The X axis intercept is the intersection coordinate.
+				return nearPoint.x - diagStart.x;
+			}
+			else if (isVertical)
+			{
+				// The Z axis intercept is the intersection coordinate.
+				return nearPoint.y - diagStart.y;
+			}
+			else
+			{
+				// Slope of the diagonal line (trivial, x = z).
+				const double diagSlope = 1.0;
+
+				// Vertical axis intercept of the diagonal line.
+				const double diagXIntercept = diagStart.x - diagStart.y;
+
+				// Slope of the incoming ray.
+				const double raySlope = dx / dz;
+
+				// Get the vertical axis intercept of the incoming ray.
+				const double rayXIntercept = nearPoint.x - (raySlope * nearPoint.y);
+
+				// General line intersection calculation.
+				return ((rayXIntercept - diagXIntercept) / 
+					(diagSlope - raySlope)) - diagStart.y;
+			}
+		}();
+
+		// Set the hit data.
+		hit.u = std::max(std::min(hitCoordinate, Constants::JustBelowOne), 0.0);
+		hit.point = Double2(
+			static_cast<double>(voxelX) + hit.u,
+			static_cast<double>(voxelZ) + hit.u);
+		hit.innerZ = (hit.point - nearPoint).length();
+		hit.normal = nearOnLeft ? leftNormal : rightNormal;
+
+		return true;
+	}
+	else
+	{
+		// No intersection.
+		return false;
+	}
+}
+
+bool SoftwareRenderer::findDiag2Intersection(int voxelX, int voxelZ, const Double2 &nearPoint,
+	const Double2 &farPoint, RayHit &hit)
+{
+	// Mostly a copy of findDiag1Intersection(), though with a couple different values
+	// for the diagonal (end points, slope, etc.).
+
+	// Start, middle, and end points of the diagonal line segment relative to the grid.
+	const Double2 diagStart(
+		static_cast<double>(voxelX) + Constants::JustBelowOne,
+		static_cast<double>(voxelZ));
+	const Double2 diagMiddle(
+		static_cast<double>(voxelX) + 0.50,
+		static_cast<double>(voxelZ) + 0.50);
+	const Double2 diagEnd(
+		static_cast<double>(voxelX),
+		static_cast<double>(voxelZ) + Constants::JustBelowOne);
+
+	// Normals for the left and right faces of the wall, facing up-right and down-left
+	// respectively (magic number is sqrt(2) / 2).
+	const Double3 leftNormal(0.7071068, 0.0, 0.7071068);
+	const Double3 rightNormal(-0.7071068, 0.0, -0.7071068);
+
+	// An intersection occurs if the near point and far point are on different sides 
+	// of the diagonal line, or if the near point lies on the diagonal line. No need
+	// to normalize the (localPoint - diagMiddle) vector because it's just checking
+	// if it's greater than zero.
+	const Double2 leftNormal2D(leftNormal.x, leftNormal.z);
+	const bool nearOnLeft = leftNormal2D.dot(nearPoint - diagMiddle) >= 0.0;
+	const bool farOnLeft = leftNormal2D.dot(farPoint - diagMiddle) >= 0.0;
+	const bool intersectionOccurred = (nearOnLeft && !farOnLeft) || (!nearOnLeft && farOnLeft);
+
+	// Only set the output data if an intersection occurred.
+	if (intersectionOccurred)
+	{
+		// Change in X and change in Z of the incoming ray across the voxel.
+		const double dx = farPoint.x - nearPoint.x;
+		const double dz = farPoint.y - nearPoint.y;
+
+		// The hit coordinate is a 0->1 value representing where the diagonal was hit.
+		const double hitCoordinate = [&nearPoint, &diagStart, dx, dz]()
+		{
+			// Special cases: when the slope is horizontal or vertical. This method treats
+			// the X axis as the vertical axis and the Z axis as the horizontal axis.
+			const double isHorizontal = std::abs(dx) < Constants::Epsilon;
+			const double isVertical = std::abs(dz) < Constants::Epsilon;
+
+			if (isHorizontal)
+			{
+				// The X axis intercept is the compliment of the intersection coordinate.
+				return Constants::JustBelowOne - (nearPoint.x - diagStart.x);
+			}
+			else if (isVertical)
+			{
+				// The Z axis intercept is the compliment of the intersection coordinate.
+				return Constants::JustBelowOne - (nearPoint.y - diagStart.y);
+			}
+			else
+			{
+				// Slope of the diagonal line (trivial, x = -z).
+				const double diagSlope = -1.0;
+
+				// Vertical axis intercept of the diagonal line.
+				const double diagXIntercept = diagStart.x + diagStart.y;
+
+				// Slope of the incoming ray.
+				const double raySlope = dx / dz;
+
+				// Get the vertical axis intercept of the incoming ray.
+				const double rayXIntercept = nearPoint.x - (raySlope * nearPoint.y);
+
+				// General line intersection calculation.
+				return ((rayXIntercept - diagXIntercept) /
+					(diagSlope - raySlope)) - diagStart.y;
+			}
+		}();
+
+		// Set the hit data.
+		hit.u = std::max(std::min(hitCoordinate, Constants::JustBelowOne), 0.0);
+		hit.point = Double2(
+			static_cast<double>(voxelX) + (Constants::JustBelowOne - hit.u),
+			static_cast<double>(voxelZ) + hit.u);
+		hit.innerZ = (hit.point - nearPoint).length();
+		hit.normal = nearOnLeft ? leftNormal : rightNormal;
+
+		return true;
+	}
+	else
+	{
+		// No intersection.
+		return false;
+	}
+}
+
+bool SoftwareRenderer::findInitialEdgeIntersection(int voxelX, int voxelZ, 
+	VoxelData::Facing edgeFacing, const Double2 &nearPoint, const Double2 &farPoint,
+	const Camera &camera, const Ray &ray, RayHit &hit)
+{
+	// Reuse the chasm facing code to find which face is intersected.
+	const VoxelData::Facing farFacing = SoftwareRenderer::getInitialChasmFarFacing(
+		voxelX, voxelZ, Double2(camera.eye.x, camera.eye.z), ray);
+
+	// If the edge facing and far facing match, there's an intersection.
+	if (edgeFacing == farFacing)
+	{
+		hit.innerZ = (farPoint - nearPoint).length();
+		hit.u = [&farPoint, farFacing]()
+		{
+			const double uVal = [&farPoint, farFacing]()
+			{
+				if (farFacing == VoxelData::Facing::PositiveX)
+				{
+					return Constants::JustBelowOne - (farPoint.y - std::floor(farPoint.y));
+				}
+				else if (farFacing == VoxelData::Facing::NegativeX)
+				{
+					return farPoint.y - std::floor(farPoint.y);
+				}
+				else if (farFacing == VoxelData::Facing::PositiveZ)
+				{
+					return farPoint.x - std::floor(farPoint.x);
+				}
+				else
+				{
+					return Constants::JustBelowOne - (farPoint.x - std::floor(farPoint.x));
+				}
+			}();
+
+			return std::max(std::min(uVal, Constants::JustBelowOne), 0.0);
+		}();
+
+		hit.point = farPoint;
+		hit.normal = -SoftwareRenderer::getNormal(farFacing);
+		return true;
+	}
+	else
+	{
+		// No intersection.
+		return false;
+	}
+}
+
+bool SoftwareRenderer::findEdgeIntersection(int voxelX, int voxelZ, VoxelData::Facing edgeFacing,
+	VoxelData::Facing nearFacing, const Double2 &nearPoint, const Double2 &farPoint, double nearU,
+	const Camera &camera, const Ray &ray, RayHit &hit)
+{
+	// If the edge facing and near facing match, the intersection is trivial.
+	if (edgeFacing == nearFacing)
+	{
+		hit.innerZ = 0.0;
+		hit.u = nearU;
+		hit.point = nearPoint;
+		hit.normal = SoftwareRenderer::getNormal(nearFacing);
+		return true;
+	}
+	else
+	{
+		// A search is needed to see whether an intersection occurred. Reuse the chasm
+		// facing code to find what the far facing is.
+		const VoxelData::Facing farFacing = SoftwareRenderer::getChasmFarFacing(
+			voxelX, voxelZ, nearFacing, camera, ray);
+
+		// If the edge facing and far facing match, there's an intersection.
+		if (edgeFacing == farFacing)
+		{
+			hit.innerZ = (farPoint - nearPoint).length();
+			hit.u = [&farPoint, farFacing]()
+			{
+				const double uVal = [&farPoint, farFacing]()
+				{
+					if (farFacing == VoxelData::Facing::PositiveX)
+					{
+						return Constants::JustBelowOne - (farPoint.y - std::floor(farPoint.y));
+					}
+					else if (farFacing == VoxelData::Facing::NegativeX)
+					{
+						return farPoint.y - std::floor(farPoint.y);
+					}
+					else if (farFacing == VoxelData::Facing::PositiveZ)
+					{
+						return farPoint.x - std::floor(farPoint.x);
+					}
+					else
+					{
+						return Constants::JustBelowOne - (farPoint.x - std::floor(farPoint.x));
+					}
+				}();
+
+				return std::max(std::min(uVal, Constants::JustBelowOne), 0.0);
+			}();
+
+			hit.point = farPoint;
+			hit.normal = -SoftwareRenderer::getNormal(farFacing);
+			return true;
+		}
+		else
+		{
+			// No intersection.
+			return false;
+		}
+	}
+}
+
+bool SoftwareRenderer::findDoorIntersection(VoxelData::DoorData::Type doorType,
+	double openPercent, const Double2 &nearPoint, const Double2 &farPoint,
+	const Double3 &wallNormal, double wallU, RayHit &hit)
+{
+	if (doorType != VoxelData::DoorData::Type::Swinging)
+	{
+		return false;
+	}
+
+	// The hinge is where U is zero on the near face, and U increases along the tangent.
+	// The door starts flat on the face and turns away from the normal into the voxel.
+	const Double2 normal(wallNormal.x, wallNormal.z);
+	const Double2 tangent = normal.rightPerp();
+	const Double2 hinge = nearPoint - (tangent * wallU);
+
+	const double angle = openPercent * (Constants::Pi / 2.0);
+	const double cosAngle = std::cos(angle);
+	const double sinAngle = std::sin(angle);
+	const Double2 doorDir = (tangent * cosAngle) - (normal * sinAngle);
+
+	// Solve hinge + (doorDir * s) = nearPoint + (rayDir * t), where s is the distance along
+	// the door and t is the percent of the ray's path through the voxel.
+	auto cross = [](const Double2 &a, const Double2 &b)
+	{
+		return (a.x * b.y) - (a.y * b.x);
+	};
+
+	const Double2 rayDir = farPoint - nearPoint;
+	const double denominator = cross(doorDir, rayDir);
+	if (std::abs(denominator) < Constants::Epsilon)
+	{
+		// The ray is parallel to the door.
+		return false;
+	}
+
+	const Double2 hingeToNear = nearPoint - hinge;
+	const double s = cross(hingeToNear, rayDir) / denominator;
+	const double t = cross(hingeToNear, doorDir) / denominator;
+	if ((s < 0.0) || (s >= 1.0) || (t < 0.0) || (t > 1.0))
+	{
+		return false;
+	}
+
+	hit.u = std::min(s, Constants::JustBelowOne);
+	hit.point = hinge + (doorDir * s);
+	hit.innerZ = (hit.point - nearPoint).length();
+
+	// The door's normal turns with it. Shading only has axis and diagonal normals, so use
+	// whichever is closest, flipped if the back of the door is showing.
+	const Double2 doorNormal = [angle, &normal, &tangent]()
+	{
+		if (angle < (Constants::Pi / 8.0))
+		{
+			return normal;
+		}
+		else if (angle > (3.0 * Constants::Pi / 8.0))
+		{
+			return tangent;
+		}
+		else
+		{
+			return (normal + tangent) * 0.7071068;
+		}
+	}();
+
+	const double side = (doorNormal.dot(rayDir) > 0.0) ? -1.0 : 1.0;
+	hit.normal = Double3(doorNormal.x * side, 0.0, doorNormal.y * side);
+	return true;
+}
+
+void SoftwareRenderer::diagProjection(double voxelYReal, double voxelHeight,
+	const Double2 &point, const Camera &camera, int frameHeight, double heightReal,
+	double &diagTopScreenY, double &diagBottomScreenY, int &diagStart, int &diagEnd)
+{
+	// Projected Y coordinates on-screen of the top and bottom of the diagonal wall slice.
+	const HeightProjector projector(point, camera, heightReal);
+	diagTopScreenY = projector.getScreenY(voxelYReal + voxelHeight);
+	diagBottomScreenY = projector.getScreenY(voxelYReal);
+
+	// Y drawing range on-screen.
+	diagStart = std::min(std::max(0,
+		static_cast<int>(std::ceil(diagTopScreenY - 0.50))), frameHeight);
+	diagEnd = std::min(std::max(0,
+		static_cast<int>(std::floor(diagBottomScreenY + 0.50))), frameHeight);
+}
+
+void SoftwareRenderer::flushPixelBatch(PixelBatch &batch, int shadingIndex,
+	const ShadingInfo &shadingInfo, bool writeDepth, const FrameView &frame)
+{
+	// The shading pass needs every pixel's depth for its lights and fog, even where the
+	// column kernels wouldn't write it.
+	if (frame.texelBuffer != nullptr)
+	{
+		const SpanShading::Span &span = batch.span;
+		for (int i = 0; i < span.count; i++)
+		{
+			const int index = batch.indices[i];
+			frame.texelBuffer[index] = static_cast<uint32_t>(span.r[i]) |
+				(static_cast<uint32_t>(span.g[i]) << 8) |
+				(static_cast<uint32_t>(span.b[i]) << 16) |
+				(static_cast<uint32_t>(span.emission[i]) << 24);
+			frame.shadingBuffer[index] = static_cast<uint8_t>(shadingIndex);
+			frame.depthBuffer[index] = batch.depths[i];
+			frame.addOverdraw(index);
+		}
+
+		batch.span.count = 0;
+		return;
+	}
+
+	SpanShading::shade(batch.span, shadingInfo.getShading(shadingIndex),
+		shadingInfo.horizonSkyColor);
+
+	for (int i = 0; i < batch.span.count; i++)
+	{
+		frame.colorBuffer[batch.indices[i]] = batch.span.colors[i];
+		frame.addOverdraw(batch.indices[i]);
+	}
+
+	if (writeDepth)
+	{
+		for (int i = 0; i < batch.span.count; i++)
+		{
+			frame.depthBuffer[batch.indices[i]] = batch.depths[i];
+		}
+	}
+
+	batch.span.count = 0;
+}
+
+void SoftwareRenderer::clearUnoccludedPixels(int x, const OcclusionData &occlusion,
+	const ShadingInfo &shadingInfo, const FrameView &frame)
+{
+	const uint32_t *skyRowColors = shadingInfo.skyRowColors;
+	const DepthValue depthValue = std::numeric_limits<DepthValue>::infinity();
+	const int yStart = occlusion.yMin;
+	const int yEnd = std::max(occlusion.yMax, yStart);
+
+	// The shading pass fills in the sky color when deferring.
+	if (frame.yStride == 1)
+	{
+		// The column's pixels are next to each other, so whole ranges are copied at once.
+		const int startIndex = frame.getIndex(x, yStart);
+		const int count = yEnd - yStart;
+		std::fill(frame.depthBuffer + startIndex, frame.depthBuffer + startIndex + count,
+			depthValue);
+
+		if (frame.shadingBuffer != nullptr)
+		{
+			std::fill(frame.shadingBuffer + startIndex, frame.shadingBuffer + startIndex + count,
+				static_cast<uint8_t>(ShadingInfo::SKY_SHADING_INDEX));
+		}
+		else
+		{
+			std::copy(skyRowColors + yStart, skyRowColors + yEnd,
+				frame.colorBuffer + startIndex);
+		}
+	}
+	else
+	{
+		for (int y = yStart; y < yEnd; y++)
+		{
+			const int index = frame.getIndex(x, y);
+			frame.depthBuffer[index] = depthValue;
+
+			if (frame.shadingBuffer != nullptr)
+			{
+				frame.shadingBuffer[index] = ShadingInfo::SKY_SHADING_INDEX;
+			}
+			else
+			{
+				frame.colorBuffer[index] = skyRowColors[y];
+			}
+		}
+	}
+
+	if (frame.stats != nullptr)
+	{
+		frame.stats->clearedPixels += std::max(occlusion.yMax - occlusion.yMin, 0);
+	}
+}
+
+void SoftwareRenderer::shadeDeferredPixels(int startX, int endX,
+	const ShadingInfo &shadingInfo, const FrameView &frame)
+{
+	ProfileScope("SoftwareRenderer::shadeDeferredPixels");
 
-	// Corners in world space.
-	const Double2 bottomLeftCorner(
-		static_cast<double>(voxelX),
-		static_cast<double>(voxelZ));
-	const Double2 topLeftCorner(
-		bottomLeftCorner.x + 1.0,
-		bottomLeftCorner.y);
-	const Double2 bottomRightCorner(
-		bottomLeftCorner.x,
-		bottomLeftCorner.y + 1.0);
-	const Double2 topRightCorner(
-		topLeftCorner.x,
-		bottomRightCorner.y);
+	const uint32_t *skyRowColors = shadingInfo.skyRowColors;
+	const bool hasLights = shadingInfo.hasLights();
 
-	const Double2 upLeft = (topLeftCorner - eye2D).normalized();
-	const Double2 upRight = (topRightCorner - eye2D).normalized();
-	const Double2 downLeft = (bottomLeftCorner - eye2D).normalized();
-	const Double2 downRight = (bottomRightCorner - eye2D).normalized();
-	const double upLeftAngle = SoftwareRenderer::fullAtan2(upLeft.x, upLeft.y);
-	const double upRightAngle = SoftwareRenderer::fullAtan2(upRight.x, upRight.y);
-	const double downLeftAngle = SoftwareRenderer::fullAtan2(downLeft.x, downLeft.y);
-	const double downRightAngle = SoftwareRenderer::fullAtan2(downRight.x, downRight.y);
+	// The shaded pixels are written to the color buffer like the column kernels' pixels.
+	FrameView shadeFrame = frame;
+	shadeFrame.texelBuffer = nullptr;
+	shadeFrame.shadingBuffer = nullptr;
 
-	// Find which side it starts on, then do some checks against line angles.
-	// When the ray origin is at a diagonal to the voxel, ignore the corner
-	// closest to that origin.
-	if (nearFacing == VoxelData::Facing::PositiveX)
+	// Pixels with the same shading are batched together, so each batch is shaded with
+	// vector instructions by SpanShading.
+	std::array<PixelBatch, ShadingInfo::FLAT_SHADING_INDEX + 1> batches;
+
+	for (int x = startX; x < endX; x++)
 	{
-		// Starts on (1.0, z).
-		const bool onRight = camera.eyeVoxel.z > voxelZ;
-		const bool onLeft = camera.eyeVoxel.z < voxelZ;
-		
-		if (onRight)
+		if (!frame.drawsColumn(x))
 		{
-			// Ignore top-right corner.
-			if (angle < downLeftAngle)
+			continue;
+		}
+
+		for (int y = 0; y < frame.height; y++)
+		{
+			const int index = frame.getIndex(x, y);
+			const int shadingIndex = frame.shadingBuffer[index];
+
+			if (shadingIndex == ShadingInfo::SKY_SHADING_INDEX)
 			{
-				return VoxelData::Facing::NegativeZ;
+				frame.colorBuffer[index] = skyRowColors[y];
+				continue;
 			}
-			else
+
+			const uint32_t texel = frame.texelBuffer[index];
+			const DepthValue bufferDepth = frame.depthBuffer[index];
+			const double depth = static_cast<double>(bufferDepth);
+
+			// Point lights are added to voxels like emission. Flats aren't lit by them.
+			int emission = static_cast<int>(texel >> 24);
+			if (hasLights && (shadingIndex != ShadingInfo::FLAT_SHADING_INDEX))
 			{
-				return VoxelData::Facing::NegativeX;
+				emission = std::min(emission + shadingInfo.getLightEmission(
+					shadingInfo.getColumnPoint(x, depth)), 255);
+			}
+
+			PixelBatch &batch = batches[shadingIndex];
+			if (batch.add(static_cast<uint8_t>(texel), static_cast<uint8_t>(texel >> 8),
+				static_cast<uint8_t>(texel >> 16), static_cast<uint8_t>(emission),
+				shadingInfo.getFogPercent(depth), index, bufferDepth))
+			{
+				SoftwareRenderer::flushPixelBatch(
+					batch, shadingIndex, shadingInfo, false, shadeFrame);
 			}
 		}
-		else if (onLeft)
+	}
+
+	for (int i = 0; i < static_cast<int>(batches.size()); i++)
+	{
+		SoftwareRenderer::flushPixelBatch(batches[i], i, shadingInfo, false, shadeFrame);
+	}
+}
+
+void SoftwareRenderer::drawPixels(int x, int yStart, int yEnd, double projectedYStart,
+	double projectedYEnd, double depth, double u, double vStart, double vEnd,
+	const Double3 &normal, const VoxelTexture &texture, const ShadingInfo &shadingInfo,
+	OcclusionData &occlusion, const FrameView &frame)
+{
+	// Mip level from how many texels each pixel of the projected column spans.
+	const double texelsPerPixel = std::abs(((vEnd - vStart) * 
+		static_cast<double>(VoxelTexture::HEIGHT)) / (projectedYEnd - projectedYStart));
+	const int mipLevel = SoftwareRenderer::getMipLevel(texelsPerPixel, shadingInfo.maxMipLevel);
+	const int mipWidth = VoxelTexture::WIDTH >> mipLevel;
+	const VoxelTexel *mipTexels = texture.getMipTexels(mipLevel);
+
+	// Horizontal offset in texture.
+	const int textureX = static_cast<int>(u * static_cast<double>(mipWidth));
+
+	// Linearly interpolated fog.
+	const double fogPercent = shadingInfo.getFogPercent(depth);
+
+	// Shading on the texture, precalculated for the normal.
+	const int shadingIndex = shadingInfo.getNormalIndex(normal);
+	const uint32_t *paletteShades = shadingInfo.getPaletteShades(normal);
+
+	// Light from nearby point lights. The whole column is at one depth, so it's the same
+	// for every pixel.
+	const uint8_t lightEmission = shadingInfo.hasColumnLights() ?
+		shadingInfo.getLightEmission(shadingInfo.getColumnPoint(x, depth)) : 0;
+
+	// Depth in the depth buffer's precision, so the depth test compares the same values 
+	// that are written.
+	const DepthValue bufferDepth = static_cast<DepthValue>(depth);
+
+	// Clip the Y start and end coordinates as needed, and refresh the occlusion buffer. 
+	// Pixels left after clipping have nothing nearer in front of them unless the column
+	// has fallen back to depth testing.
+	occlusion.clipRange(&yStart, &yEnd);
+	const bool depthTest = occlusion.depthTest;
+	occlusion.update(yStart, yEnd);
+	const bool writeDepth = occlusion.writesDepth();
+
+	// Texel row in fixed point, stepped once per pixel instead of interpolated.
+	int texelRow, texelRowStep;
+	SoftwareRenderer::getFixedTexelRows(yStart, yEnd, projectedYStart, projectedYEnd,
+		vStart, vEnd, mipWidth, &texelRow, &texelRowStep);
+	const int maxTexelRow = (mipWidth << SoftwareRenderer::TEXEL_ROW_FRACTION_BITS) - 1;
+
+	// The unoccluded range hasn't been drawn to yet, so it needs the background color and
+	// depth before the depth test relies on them.
+	if (occlusion.depthTest && !depthTest)
+	{
+		SoftwareRenderer::clearUnoccludedPixels(x, occlusion, shadingInfo, frame);
+	}
+
+	// Draw the column to the output buffer.
+	PixelBatch batch;
+	int shadedCount = 0;
+	int rejectCount = 0;
+	for (int y = yStart; y < yEnd; y++)
+	{
+		const int index = frame.getIndex(x, y);
+
+		// Check depth of the pixel before rendering, unless occlusion already has.
+		if (!depthTest || (bufferDepth <= (frame.depthBuffer[index] - Constants::Epsilon)))
 		{
-			// Ignore top-left corner.
-			if ((angle > downLeftAngle) && (angle < downRightAngle))
+			// Y position in texture, clamped to the texture's edges.
+			const int textureY = std::min(std::max(texelRow, 0), maxTexelRow) >>
+				SoftwareRenderer::TEXEL_ROW_FRACTION_BITS;
+
+			// Alpha is ignored in this loop, so transparent texels will appear black.
+			const int textureIndex = VoxelTexture::getTexelIndex(textureX, textureY, mipWidth);
+			const VoxelTexel texel = shadingInfo.getLitTexel(mipTexels[textureIndex]);
+			const uint8_t emission = static_cast<uint8_t>(
+				std::min(texel.emission + lightEmission, 255));
+
+			shadedCount++;
+
+			// Shading and fog are applied to several pixels at once.
+			if (paletteShades != nullptr)
 			{
-				return VoxelData::Facing::NegativeX;
+				// Shading and fog come from the palette shade table instead.
+				frame.colorBuffer[index] = shadingInfo.getPaletteColor(texel.index, emission,
+					paletteShades, shadingInfo.getPaletteFogLevel(fogPercent));
+				frame.addOverdraw(index);
+
+				if (writeDepth)
+				{
+					frame.depthBuffer[index] = bufferDepth;
+				}
 			}
-			else
+			else if (batch.add(texel.r, texel.g, texel.b, emission, fogPercent, index, bufferDepth))
 			{
-				return VoxelData::Facing::PositiveZ;
+				SoftwareRenderer::flushPixelBatch(
+					batch, shadingIndex, shadingInfo, writeDepth, frame);
 			}
 		}
 		else
 		{
-			if (angle > downRightAngle)
+			rejectCount++;
+		}
+
+		texelRow += texelRowStep;
+	}
+
+	SoftwareRenderer::flushPixelBatch(batch, shadingIndex, shadingInfo, writeDepth, frame);
+
+	if (frame.stats != nullptr)
+	{
+		frame.stats->wallPixels += shadedCount;
+		frame.stats->depthRejects += rejectCount;
+	}
+}
+
+void SoftwareRenderer::drawPerspectivePixels(int x, int yStart, int yEnd, double projectedYStart,
+	double projectedYEnd, const Double2 &startPoint, const Double2 &endPoint, double depthStart,
+	double depthEnd, const Double3 &normal, const VoxelTexture &texture,
+	const ShadingInfo &shadingInfo, OcclusionData &occlusion, const FrameView &frame)
+{
+	// Shading on the texture, precalculated for the normal.
+	const int shadingIndex = shadingInfo.getNormalIndex(normal);
+	const uint32_t *paletteShades = shadingInfo.getPaletteShades(normal);
+	const bool hasLights = shadingInfo.hasColumnLights();
+
+	// Values for perspective-correct interpolation.
+	const double depthStartRecip = 1.0 / depthStart;
+	const double depthEndRecip = 1.0 / depthEnd;
+	const Double2 startPointDiv = startPoint * depthStartRecip;
+	const Double2 endPointDiv = endPoint * depthEndRecip;
+	const Double2 pointDivDiff = endPointDiv - startPointDiv;
+
+	// The reciprocal depth changes by a constant amount per pixel, so the distance the 
+	// surface point moves per pixel is that amount times the depth squared (in texels).
+	const double texelRateScale = std::abs((depthEndRecip - depthStartRecip) /
+		(projectedYEnd - projectedYStart)) * static_cast<double>(VoxelTexture::WIDTH);
+	
+	// Clip the Y start and end coordinates as needed, and refresh the occlusion buffer. 
+	// Pixels left after clipping have nothing nearer in front of them unless the column
+	// has fallen back to depth testing.
+	occlusion.clipRange(&yStart, &yEnd);
+	const bool depthTest = occlusion.depthTest;
+	occlusion.update(yStart, yEnd);
+	const bool writeDepth = occlusion.writesDepth();
+
+	// The unoccluded range hasn't been drawn to yet, so it needs the background color and
+	// depth before the depth test relies on them.
+	if (occlusion.depthTest && !depthTest)
+	{
+		SoftwareRenderer::clearUnoccludedPixels(x, occlusion, shadingInfo, frame);
+	}
+
+	// Calculates the perspective-correct depth and surface point at the center of a pixel
+	// in the column.
+	auto getPerspectiveValues = [projectedYStart, projectedYEnd, depthStartRecip,
+		depthEndRecip, &startPointDiv, &pointDivDiff](int y, double *depth,
+		double *pointX, double *pointY)
+	{
+		// Percent stepped from beginning to end on the column.
+		const double yPercent = 
+			((static_cast<double>(y) + 0.50) - projectedYStart) /
+			(projectedYEnd - projectedYStart);
+
+		// Interpolate between the near and far depth.
+		*depth = 1.0 / (depthStartRecip + ((depthEndRecip - depthStartRecip) * yPercent));
+
+		// Interpolate between start and end points.
+		*pointX = (startPointDiv.x + (pointDivDiff.x * yPercent)) * (*depth);
+		*pointY = (startPointDiv.y + (pointDivDiff.y * yPercent)) * (*depth);
+	};
+
+	// The column is split into spans whose ends are perspective-correct, and the pixels
+	// in each span step linearly between them. With a span length of one, every pixel
+	// is exact.
+	const int spanLength = shadingInfo.perspectiveSpanLength;
+	int spanEndY = yStart;
+	double spanEndDepth, spanEndPointX, spanEndPointY;
+	getPerspectiveValues(yStart, &spanEndDepth, &spanEndPointX, &spanEndPointY);
+
+	double depth = 0.0, currentPointX = 0.0, currentPointY = 0.0;
+	double depthStep = 0.0, pointStepX = 0.0, pointStepY = 0.0;
+
+	// Draw the column to the output buffer.
+	PixelBatch batch;
+	int shadedCount = 0;
+	int rejectCount = 0;
+	for (int y = yStart; y < yEnd; y++)
+	{
+		if (y == spanEndY)
+		{
+			depth = spanEndDepth;
+			currentPointX = spanEndPointX;
+			currentPointY = spanEndPointY;
+
+			spanEndY = std::min(y + spanLength, yEnd);
+			getPerspectiveValues(spanEndY, &spanEndDepth, &spanEndPointX, &spanEndPointY);
+
+			const int spanPixels = spanEndY - y;
+			if (spanPixels > 1)
 			{
-				return VoxelData::Facing::PositiveZ;
+				const double spanPixelsRecip = 1.0 / static_cast<double>(spanPixels);
+				depthStep = (spanEndDepth - depth) * spanPixelsRecip;
+				pointStepX = (spanEndPointX - currentPointX) * spanPixelsRecip;
+				pointStepY = (spanEndPointY - currentPointY) * spanPixelsRecip;
 			}
-			else if (angle > downLeftAngle)
+		}
+
+		const int index = frame.getIndex(x, y);
+		const DepthValue bufferDepth = static_cast<DepthValue>(depth);
+
+		// Check depth of the pixel before rendering, unless occlusion already has.
+		if (!depthTest || (bufferDepth <= frame.depthBuffer[index]))
+		{
+			// Linearly interpolated fog.
+			const double fogPercent = shadingInfo.getFogPercent(depth);
+
+			// Texture coordinates.
+			const double u = std::max(std::min(Constants::JustBelowOne,
+				Constants::JustBelowOne - (currentPointX - std::floor(currentPointX))), 0.0);
+			const double v = std::max(std::min(Constants::JustBelowOne,
+				Constants::JustBelowOne - (currentPointY - std::floor(currentPointY))), 0.0);
+
+			// Mip level from how far the surface point moves between pixels, which grows 
+			// with the square of the depth.
+			const int mipLevel = SoftwareRenderer::getMipLevel(
+				depth * depth * texelRateScale, shadingInfo.maxMipLevel);
+			const int mipWidth = VoxelTexture::WIDTH >> mipLevel;
+			const VoxelTexel *mipTexels = texture.getMipTexels(mipLevel);
+
+			// Offsets in texture.
+			const int textureX = static_cast<int>(u * static_cast<double>(mipWidth));
+			const int textureY = static_cast<int>(v * static_cast<double>(mipWidth));
+
+			// Alpha is ignored in this loop, so transparent texels will appear black.
+			const int textureIndex = VoxelTexture::getTexelIndex(textureX, textureY, mipWidth);
+			const VoxelTexel texel = shadingInfo.getLitTexel(mipTexels[textureIndex]);
+
+			// Light from nearby point lights at this pixel's point on the surface.
+			const uint8_t lightEmission = hasLights ? shadingInfo.getLightEmission(
+				Double2(currentPointX, currentPointY)) : 0;
+			const uint8_t emission = static_cast<uint8_t>(
+				std::min(texel.emission + lightEmission, 255));
+
+			shadedCount++;
+
+			// Shading and fog are applied to several pixels at once.
+			if (paletteShades != nullptr)
 			{
-				return VoxelData::Facing::NegativeX;
+				// Shading and fog come from the palette shade table instead.
+				frame.colorBuffer[index] = shadingInfo.getPaletteColor(texel.index, emission,
+					paletteShades, shadingInfo.getPaletteFogLevel(fogPercent));
+				frame.addOverdraw(index);
+
+				if (writeDepth)
+				{
+					frame.depthBuffer[index] = bufferDepth;
+				}
 			}
-			else
+			else if (batch.add(texel.r, texel.g, texel.b, emission, fogPercent, index, bufferDepth))
 			{
-				return VoxelData::Facing::NegativeZ;
+				SoftwareRenderer::flushPixelBatch(
+					batch, shadingIndex, shadingInfo, writeDepth, frame);
 			}
 		}
+		else
+		{
+			rejectCount++;
+		}
+
+		depth += depthStep;
+		currentPointX += pointStepX;
+		currentPointY += pointStepY;
 	}
-	else if (nearFacing == VoxelData::Facing::NegativeX)
+
+	SoftwareRenderer::flushPixelBatch(batch, shadingIndex, shadingInfo, writeDepth, frame);
+
+	if (frame.stats != nullptr)
 	{
-		// Starts on (0.0, z).
-		const bool onRight = camera.eyeVoxel.z > voxelZ;
-		const bool onLeft = camera.eyeVoxel.z < voxelZ;
+		frame.stats->perspectivePixels += shadedCount;
+		frame.stats->depthRejects += rejectCount;
+	}
+}
 
-		if (onRight)
+void SoftwareRenderer::drawPlanePixels(int x, int yStart, int yEnd, double projectedYStart,
+	double projectedYEnd, const Double2 &startPoint, const Double2 &endPoint, double depthStart,
+	double depthEnd, double planeY, const Double3 &normal, int textureID,
+	const VoxelTextureArray &textures, const ShadingInfo &shadingInfo,
+	OcclusionData &occlusion, const FrameView &frame)
+{
+	PlaneBuffer *planes = frame.planes;
+
+	// The pixels can only be drawn later if nothing else in the column can draw over them,
+	// which is when they join the occluded range at the top or bottom of the column.
+	int clippedStart = yStart;
+	int clippedEnd = yEnd;
+	occlusion.clipRange(&clippedStart, &clippedEnd);
+	const bool canDefer = (planes != nullptr) && occlusion.culling && !occlusion.depthTest &&
+		((clippedStart <= occlusion.yMin) || (clippedEnd >= occlusion.yMax)) &&
+		(planes->spans.size() < std::numeric_limits<uint16_t>::max());
+
+	if (!canDefer)
+	{
+		SoftwareRenderer::drawPerspectivePixels(x, yStart, yEnd, projectedYStart,
+			projectedYEnd, startPoint, endPoint, depthStart, depthEnd, normal,
+			textures.at(textureID), shadingInfo, occlusion, frame);
+		return;
+	}
+
+	occlusion.update(clippedStart, clippedEnd);
+
+	if (clippedStart >= clippedEnd)
+	{
+		return;
+	}
+
+	PlaneSpan span;
+	span.x = x;
+	span.yStart = clippedStart;
+	span.yEnd = clippedEnd;
+	span.textureID = textureID;
+	span.planeY = planeY;
+	planes->spans.push_back(span);
+
+	const uint16_t spanValue = static_cast<uint16_t>(planes->spans.size());
+	const int tileX = x - planes->startX;
+	for (int y = clippedStart; y < clippedEnd; y++)
+	{
+		planes->pixelSpans[tileX + (y * SoftwareRenderer::COLUMN_TILE_WIDTH)] = spanValue;
+	}
+
+	planes->yMin = std::min(planes->yMin, clippedStart);
+	planes->yMax = std::max(planes->yMax, clippedEnd);
+}
+
+void SoftwareRenderer::drawPlaneRows(const Camera &camera, const double *columnDepthScales,
+	const VoxelTextureArray &textures, const ShadingInfo &shadingInfo, const FrameView &frame)
+{
+	ProfileScope("SoftwareRenderer::drawPlaneRows");
+
+	PlaneBuffer &planes = *frame.planes;
+	if (planes.spans.size() == 0)
+	{
+		return;
+	}
+
+	// Planes below the eye are seen from above, and planes above it from below.
+	const int upShadingIndex = shadingInfo.getNormalIndex(Double3::UnitY);
+	const int downShadingIndex = shadingInfo.getNormalIndex(-Double3::UnitY);
+	const uint32_t *upPaletteShades = shadingInfo.getPaletteShades(Double3::UnitY);
+	const uint32_t *downPaletteShades = shadingInfo.getPaletteShades(-Double3::UnitY);
+	const bool hasLights = shadingInfo.hasColumnLights();
+
+	// The distance the surface point moves per pixel down a column is this times the ray
+	// distance and the row's forward distance per unit of height (in texels), the same as 
+	// in drawPerspectivePixels().
+	const double texelRateScale = (2.0 * static_cast<double>(VoxelTexture::WIDTH)) /
+		(frame.heightReal * camera.zoom);
+
+	PixelBatch upBatch, downBatch;
+	int shadedCount = 0;
+	for (int y = planes.yMin; y < planes.yMax; y++)
+	{
+		// Normalized Y of the row's center, with the Y-shear removed. Forward distance to a
+		// plane on this row is its height relative to the eye times this scale.
+		const double rowY = 2.0 * ((0.50 + camera.yShear) -
+			((static_cast<double>(y) + 0.50) / frame.heightReal));
+		const double rowDistanceScale = camera.zoom / rowY;
+
+		uint16_t *rowSpans = planes.pixelSpans.data() + (y * SoftwareRenderer::COLUMN_TILE_WIDTH);
+		for (int tileX = 0; tileX < SoftwareRenderer::COLUMN_TILE_WIDTH; tileX++)
 		{
-			// Ignore bottom-right corner.
-			if (angle < upLeftAngle)
+			const uint16_t spanValue = rowSpans[tileX];
+			if (spanValue == 0)
 			{
-				return VoxelData::Facing::PositiveX;
+				continue;
+			}
+
+			rowSpans[tileX] = 0;
+
+			const PlaneSpan &span = planes.spans[spanValue - 1];
+			const int x = span.x;
+			const int index = frame.getIndex(x, y);
+			const double planeHeight = span.planeY - camera.eye.y;
+			const bool facesUp = planeHeight < 0.0;
+
+			// Forward distance and ray distance to the plane.
+			const double forwardDistance = planeHeight * rowDistanceScale;
+			const double depth = forwardDistance * columnDepthScales[x];
+			const DepthValue bufferDepth = static_cast<DepthValue>(depth);
+
+			// Linearly interpolated fog.
+			const double fogPercent = shadingInfo.getFogPercent(depth);
+
+			// Point on the plane.
+			const Double2 point = shadingInfo.getColumnPoint(x, depth);
+
+			// Texture coordinates.
+			const double u = std::max(std::min(Constants::JustBelowOne,
+				Constants::JustBelowOne - (point.x - std::floor(point.x))), 0.0);
+			const double v = std::max(std::min(Constants::JustBelowOne,
+				Constants::JustBelowOne - (point.y - std::floor(point.y))), 0.0);
+
+			// Mip level from how far the surface point moves between pixels.
+			const int mipLevel = SoftwareRenderer::getMipLevel(
+				std::abs(rowDistanceScale) * depth * texelRateScale, shadingInfo.maxMipLevel);
+			const int mipWidth = VoxelTexture::WIDTH >> mipLevel;
+			const VoxelTexel *mipTexels = textures.at(span.textureID).getMipTexels(mipLevel);
+
+			// Offsets in texture.
+			const int textureX = static_cast<int>(u * static_cast<double>(mipWidth));
+			const int textureY = static_cast<int>(v * static_cast<double>(mipWidth));
+
+			// Alpha is ignored in this loop, so transparent texels will appear black.
+			const int textureIndex = VoxelTexture::getTexelIndex(textureX, textureY, mipWidth);
+			const VoxelTexel texel = shadingInfo.getLitTexel(mipTexels[textureIndex]);
+
+			// Light from nearby point lights at this pixel's point on the surface.
+			const uint8_t lightEmission = hasLights ? shadingInfo.getLightEmission(point) : 0;
+			const uint8_t emission = static_cast<uint8_t>(
+				std::min(texel.emission + lightEmission, 255));
+
+			shadedCount++;
+
+			// Depth is always written since no other voxel pixel is drawn here this frame.
+			const uint32_t *paletteShades = facesUp ? upPaletteShades : downPaletteShades;
+			if (paletteShades != nullptr)
+			{
+				frame.colorBuffer[index] = shadingInfo.getPaletteColor(texel.index, emission,
+					paletteShades, shadingInfo.getPaletteFogLevel(fogPercent));
+				frame.addOverdraw(index);
+				frame.depthBuffer[index] = bufferDepth;
 			}
 			else
 			{
-				return VoxelData::Facing::NegativeZ;
+				PixelBatch &batch = facesUp ? upBatch : downBatch;
+				if (batch.add(texel.r, texel.g, texel.b, emission, fogPercent, index, bufferDepth))
+				{
+					SoftwareRenderer::flushPixelBatch(batch,
+						facesUp ? upShadingIndex : downShadingIndex, shadingInfo, true, frame);
+				}
 			}
 		}
-		else if (onLeft)
+	}
+
+	SoftwareRenderer::flushPixelBatch(upBatch, upShadingIndex, shadingInfo, true, frame);
+	SoftwareRenderer::flushPixelBatch(downBatch, downShadingIndex, shadingInfo, true, frame);
+
+	if (frame.stats != nullptr)
+	{
+		frame.stats->perspectivePixels += shadedCount;
+	}
+}
+
+void SoftwareRenderer::drawTransparentPixels(int x, int yStart, int yEnd, double projectedYStart,
+	double projectedYEnd, double depth, double u, double vStart, double vEnd,
+	const Double3 &normal, const VoxelTexture &texture, const uint8_t *cycledIndices,
+	const ShadingInfo &shadingInfo, OcclusionData &occlusion, const FrameView &frame)
+{
+	// Mip level from how many texels each pixel of the projected column spans.
+	const double texelsPerPixel = std::abs(((vEnd - vStart) * 
+		static_cast<double>(VoxelTexture::HEIGHT)) / (projectedYEnd - projectedYStart));
+	const int mipLevel = SoftwareRenderer::getMipLevel(texelsPerPixel, shadingInfo.maxMipLevel);
+	const int mipWidth = VoxelTexture::WIDTH >> mipLevel;
+	const VoxelTexel *mipTexels = texture.getMipTexels(mipLevel);
+
+	// Horizontal offset in texture.
+	const int textureX = static_cast<int>(u * static_cast<double>(mipWidth));
+
+	// Linearly interpolated fog.
+	const double fogPercent = shadingInfo.getFogPercent(depth);
+
+	// Shading on the texture, precalculated for the normal.
+	const int shadingIndex = shadingInfo.getNormalIndex(normal);
+	const uint32_t *paletteShades = shadingInfo.getPaletteShades(normal);
+
+	// Light from nearby point lights. The whole column is at one depth, so it's the same
+	// for every pixel.
+	const uint8_t lightEmission = shadingInfo.hasColumnLights() ?
+		shadingInfo.getLightEmission(shadingInfo.getColumnPoint(x, depth)) : 0;
+
+	// Depth in the depth buffer's precision, so the depth test compares the same values 
+	// that are written.
+	const DepthValue bufferDepth = static_cast<DepthValue>(depth);
+
+	// Clip the Y start and end coordinates as needed, but do not refresh the occlusion buffer,
+	// because transparent ranges do not occlude as simply as opaque ranges. Anything drawn 
+	// behind them in this column has to be depth tested instead.
+	occlusion.clipRange(&yStart, &yEnd);
+	const bool depthTest = occlusion.depthTest;
+	occlusion.updateTransparent(yStart, yEnd);
+
+	// Texel row in fixed point, stepped once per pixel instead of interpolated.
+	int texelRow, texelRowStep;
+	SoftwareRenderer::getFixedTexelRows(yStart, yEnd, projectedYStart, projectedYEnd,
+		vStart, vEnd, mipWidth, &texelRow, &texelRowStep);
+	const int maxTexelRow = (mipWidth << SoftwareRenderer::TEXEL_ROW_FRACTION_BITS) - 1;
+
+	// Give the unoccluded range its background before drawing the first depth tested pixels.
+	if (occlusion.depthTest && !depthTest)
+	{
+		SoftwareRenderer::clearUnoccludedPixels(x, occlusion, shadingInfo, frame);
+	}
+
+	// Draw the column to the output buffer.
+	PixelBatch batch;
+	int shadedCount = 0;
+	int rejectCount = 0;
+	for (int y = yStart; y < yEnd; y++)
+	{
+		const int index = frame.getIndex(x, y);
+
+		// Check depth of the pixel before rendering.
+		if (bufferDepth <= (frame.depthBuffer[index] - Constants::Epsilon))
 		{
-			// Ignore bottom-left corner.
-			if (angle < upRightAngle)
-			{
-				return VoxelData::Facing::PositiveZ;
-			}
-			else
+			// Y position in texture, clamped to the texture's edges.
+			const int textureY = std::min(std::max(texelRow, 0), maxTexelRow) >>
+				SoftwareRenderer::TEXEL_ROW_FRACTION_BITS;
+
+			// Alpha is checked in this loop, and transparent texels are not drawn.
+			const int textureIndex = VoxelTexture::getTexelIndex(textureX, textureY, mipWidth);
+			const VoxelTexel texel = shadingInfo.getLitTexel(mipTexels[textureIndex]);
+			
+			if (texel.a > 0)
 			{
-				return VoxelData::Facing::PositiveX;
+				const uint8_t emission = static_cast<uint8_t>(
+					std::min(texel.emission + lightEmission, 255));
+
+				shadedCount++;
+
+				// Shading and fog are applied to several pixels at once.
+				if (paletteShades != nullptr)
+				{
+					// Shading and fog come from the palette shade table instead.
+					const uint8_t paletteIndex = (cycledIndices != nullptr) ?
+						cycledIndices[texel.index] : texel.index;
+					frame.colorBuffer[index] = shadingInfo.getPaletteColor(paletteIndex,
+						emission, paletteShades, shadingInfo.getPaletteFogLevel(fogPercent));
+					frame.addOverdraw(index);
+					frame.depthBuffer[index] = bufferDepth;
+				}
+				else if (batch.add(texel.r, texel.g, texel.b, emission, fogPercent, index,
+					bufferDepth))
+				{
+					SoftwareRenderer::flushPixelBatch(
+						batch, shadingIndex, shadingInfo, true, frame);
+				}
 			}
 		}
 		else
 		{
-			if (angle < upRightAngle)
-			{
-				return VoxelData::Facing::PositiveZ;
-			}
-			else if (angle < upLeftAngle)
-			{
-				return VoxelData::Facing::PositiveX;
-			}
-			else
-			{
-				return VoxelData::Facing::NegativeZ;
-			}
+			rejectCount++;
 		}
-	}				
-	else if (nearFacing == VoxelData::Facing::PositiveZ)
+
+		texelRow += texelRowStep;
+	}
+
+	SoftwareRenderer::flushPixelBatch(batch, shadingIndex, shadingInfo, true, frame);
+
+	if (frame.stats != nullptr)
 	{
-		// Starts on (x, 1.0).
-		const bool onTop = camera.eyeVoxel.x > voxelX;
-		const bool onBottom = camera.eyeVoxel.x < voxelX;
+		frame.stats->transparentPixels += shadedCount;
+		frame.stats->depthRejects += rejectCount;
+	}
+}
 
-		if (onTop)
+void SoftwareRenderer::drawDoor(int x, VoxelData::DoorData::Type doorType,
+	double openPercent, double voxelYReal, double voxelHeight, const Double2 &nearPoint,
+	const Double2 &farPoint, double nearZ, double wallU, const Double3 &wallNormal,
+	const Camera &camera,
+	const VoxelTexture &texture, const ShadingInfo &shadingInfo, OcclusionData &occlusion,
+	const FrameView &frame)
+{
+	if (openPercent >= 1.0)
+	{
+		return;
+	}
+
+	// A swinging door turns into the voxel about its hinge, so it's drawn where the ray
+	// hits it, the same as a diagonal.
+	if ((openPercent > 0.0) && (doorType == VoxelData::DoorData::Type::Swinging))
+	{
+		RayHit hit;
+		if (!SoftwareRenderer::findDoorIntersection(doorType, openPercent, nearPoint,
+			farPoint, wallNormal, wallU, hit))
 		{
-			// Ignore top-right corner.
-			if (angle < downLeftAngle)
-			{
-				return VoxelData::Facing::NegativeZ;
-			}
-			else
-			{
-				return VoxelData::Facing::NegativeX;
-			}
+			return;
 		}
-		else if (onBottom)
+
+		const HeightProjector projector(hit.point, camera, frame.heightReal);
+		const double doorTopScreenY = projector.getScreenY(voxelYReal + voxelHeight);
+		const double doorBottomScreenY = projector.getScreenY(voxelYReal);
+		const int doorStart = SoftwareRenderer::getLowerBoundedPixel(
+			doorTopScreenY, frame.height);
+		const int doorEnd = SoftwareRenderer::getUpperBoundedPixel(
+			doorBottomScreenY, frame.height);
+
+		SoftwareRenderer::drawTransparentPixels(x, doorStart, doorEnd, doorTopScreenY,
+			doorBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
+			hit.normal, texture, nullptr, shadingInfo, occlusion, frame);
+		return;
+	}
+
+	// Other doors are drawn as a transparent wall on the near face, with the part that's
+	// still in the doorway cut down by how far open it is.
+	double u = wallU;
+	double floorY = voxelYReal;
+	double vStart = 0.0;
+	if (openPercent > 0.0)
+	{
+		if (doorType == VoxelData::DoorData::Type::Sliding)
 		{
-			// Ignore bottom-right corner.
-			if (angle < upLeftAngle)
-			{
-				return VoxelData::Facing::PositiveX;
-			}
-			else
+			// Slides sideways into the wall past the end of the face.
+			if (wallU < openPercent)
 			{
-				return VoxelData::Facing::NegativeZ;
+				return;
 			}
+
+			u = wallU - openPercent;
 		}
-		else
+		else if (doorType == VoxelData::DoorData::Type::Raising)
 		{
-			if (angle < upLeftAngle)
-			{
-				return VoxelData::Facing::PositiveX;
-			}
-			else if (angle < downLeftAngle)
-			{
-				return VoxelData::Facing::NegativeZ;
-			}
-			else
-			{
-				return VoxelData::Facing::NegativeX;
-			}
+			// Rises into the ceiling, so only the bottom of the texture is still showing.
+			floorY = voxelYReal + (voxelHeight * openPercent);
+			vStart = openPercent;
 		}
 	}
+
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		voxelYReal + voxelHeight,
+		nearPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		floorY,
+		nearPoint.y);
+
+	const HeightProjector projector(nearPoint, camera, frame.heightReal);
+	const double nearCeilingScreenY = projector.getScreenY(nearCeilingPoint.y);
+	const double nearFloorScreenY = projector.getScreenY(nearFloorPoint.y);
+
+	const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
+		nearCeilingScreenY, frame.height);
+	const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearFloorScreenY, frame.height);
+
+	SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+		nearFloorScreenY, nearZ, u, vStart, Constants::JustBelowOne, wallNormal, texture,
+		nullptr, shadingInfo, occlusion, frame);
+}
+
+// Voxel types without a specialization for a position (i.e., floors at eye level, which can
+// only be seen from above) draw nothing there, so their parameters go unnamed.
+
+template <VoxelDataType Type>
+void SoftwareRenderer::drawInitialVoxel(int, int, int, int, const VoxelData&,
+	const Camera&, const Ray&, VoxelData::Facing, const Double3&, const Double2&,
+	const Double2&, const HeightProjector&, const HeightProjector&, double, double, double,
+	const ShadingInfo&, double, const VoxelGrid&, const VoxelTextureArray&, OcclusionData&,
+	const FrameView&)
+{
+	// Nothing to draw.
+}
+
+template <VoxelDataType Type>
+void SoftwareRenderer::drawInitialVoxelBelow(int, int, int, int, const VoxelData&,
+	const Camera&, const Ray&, VoxelData::Facing, const Double3&, const Double2&,
+	const Double2&, const HeightProjector&, const HeightProjector&, double, double, double,
+	const ShadingInfo&, double, const VoxelGrid&, const VoxelTextureArray&, OcclusionData&,
+	const FrameView&)
+{
+	// Nothing to draw.
+}
+
+template <VoxelDataType Type>
+void SoftwareRenderer::drawInitialVoxelAbove(int, int, int, int, const VoxelData&,
+	const Camera&, const Ray&, VoxelData::Facing, const Double3&, const Double2&,
+	const Double2&, const HeightProjector&, const HeightProjector&, double, double, double,
+	const ShadingInfo&, double, const VoxelGrid&, const VoxelTextureArray&, OcclusionData&,
+	const FrameView&)
+{
+	// Nothing to draw.
+}
+
+template <VoxelDataType Type>
+void SoftwareRenderer::drawVoxel(int, int, int, int, const VoxelData&,
+	const Camera&, const Ray&, VoxelData::Facing, const Double3&, const Double2&,
+	const Double2&, const HeightProjector&, const HeightProjector&, double, double, double,
+	const ShadingInfo&, double, const VoxelGrid&, const VoxelTextureArray&, OcclusionData&,
+	const FrameView&)
+{
+	// Nothing to draw.
+}
+
+template <VoxelDataType Type>
+void SoftwareRenderer::drawVoxelBelow(int, int, int, int, const VoxelData&,
+	const Camera&, const Ray&, VoxelData::Facing, const Double3&, const Double2&,
+	const Double2&, const HeightProjector&, const HeightProjector&, double, double, double,
+	const ShadingInfo&, double, const VoxelGrid&, const VoxelTextureArray&, OcclusionData&,
+	const FrameView&)
+{
+	// Nothing to draw.
+}
+
+template <VoxelDataType Type>
+void SoftwareRenderer::drawVoxelAbove(int, int, int, int, const VoxelData&,
+	const Camera&, const Ray&, VoxelData::Facing, const Double3&, const Double2&,
+	const Double2&, const HeightProjector&, const HeightProjector&, double, double, double,
+	const ShadingInfo&, double, const VoxelGrid&, const VoxelTextureArray&, OcclusionData&,
+	const FrameView&)
+{
+	// Nothing to draw.
+}
+
+template <>
+void SoftwareRenderer::drawInitialVoxel<VoxelDataType::Wall>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	// Draw inner ceiling, wall, and floor.
+	const VoxelData::WallData &wallData = voxelData.wall;
+
+	const Double3 farCeilingPoint(
+		farPoint.x,
+		camera.eyeVoxelReal.y + voxelHeight,
+		farPoint.y);
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		farCeilingPoint.y,
+		nearPoint.y);
+	const Double3 farFloorPoint(
+		farPoint.x,
+		camera.eyeVoxelReal.y,
+		farPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		farFloorPoint.y,
+		nearPoint.y);
+
+	const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+	const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+	const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+	const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+
+	const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+		nearCeilingScreenY, frame.height);
+	const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
+		farCeilingScreenY, frame.height);
+	const int wallStart = ceilingEnd;
+	const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+		farFloorScreenY, frame.height);
+	const int floorStart = wallEnd;
+	const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearFloorScreenY, frame.height);
+
+	// Ceiling.
+	SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
+		nearCeilingScreenY, farCeilingScreenY, nearPoint, farPoint, nearZ,
+		farZ, -Double3::UnitY, textures.at(wallData.ceilingID), shadingInfo,
+		occlusion, frame);
+
+	// Side.
+	SoftwareRenderer::drawPixels(x, wallStart, wallEnd, farCeilingScreenY,
+		farFloorScreenY, farZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
+		textures.at(wallData.sideID), shadingInfo, occlusion, frame);
+
+	// Floor.
+	SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
+		farFloorScreenY, nearFloorScreenY, farPoint, nearPoint, farZ,
+		nearZ, Double3::UnitY, textures.at(wallData.floorID), shadingInfo,
+		occlusion, frame);
+}
+
+template <>
+void SoftwareRenderer::drawInitialVoxel<VoxelDataType::Raised>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	const VoxelData::RaisedData &raisedData = voxelData.raised;
+
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		camera.eyeVoxelReal.y + ((raisedData.yOffset + raisedData.ySize) * voxelHeight),
+		nearPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		camera.eyeVoxelReal.y + (raisedData.yOffset * voxelHeight),
+		nearPoint.y);
+
+	// Draw order depends on the player's Y position relative to the platform.
+	if (camera.eye.y > nearCeilingPoint.y)
+	{
+		// Above platform.
+		const Double3 farCeilingPoint(
+			farPoint.x,
+			nearCeilingPoint.y,
+			farPoint.y);
+
+		const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+		const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+
+		const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+			farCeilingScreenY, frame.height);
+		const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
+			nearCeilingScreenY, frame.height);
+
+		// Ceiling.
+		SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
+			farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
+			nearZ, Double3::UnitY, textures.at(raisedData.ceilingID),
+			shadingInfo, occlusion, frame);
+	}
+	else if (camera.eye.y < nearFloorPoint.y)
+	{
+		// Below platform.
+		const Double3 farFloorPoint(
+			farPoint.x,
+			nearFloorPoint.y,
+			farPoint.y);
+
+		const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+		const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+
+		const int floorStart = SoftwareRenderer::getLowerBoundedPixel(
+			nearFloorScreenY, frame.height);
+		const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farFloorScreenY, frame.height);
+
+		// Floor.
+		SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
+			nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
+			farZ, -Double3::UnitY, textures.at(raisedData.floorID),
+			shadingInfo, occlusion, frame);
+	}
 	else
 	{
-		// Starts on (x, 0.0). This one splits the origin, so it needs some 
-		// special cases.
-		const bool onTop = camera.eyeVoxel.x > voxelX;
-		const bool onBottom = camera.eyeVoxel.x < voxelX;
+		// Between top and bottom.
+		const Double3 farCeilingPoint(
+			farPoint.x,
+			nearCeilingPoint.y,
+			farPoint.y);
+		const Double3 farFloorPoint(
+			farPoint.x,
+			nearFloorPoint.y,
+			farPoint.y);
+
+		const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+		const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+		const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+		const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+
+		const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+			nearCeilingScreenY, frame.height);
+		const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farCeilingScreenY, frame.height);
+		const int wallStart = ceilingEnd;
+		const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farFloorScreenY, frame.height);
+		const int floorStart = wallEnd;
+		const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+			nearFloorScreenY, frame.height);
+
+		// Ceiling.
+		SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
+			nearCeilingScreenY, farCeilingScreenY, nearPoint, farPoint, nearZ,
+			farZ, -Double3::UnitY, textures.at(raisedData.ceilingID),
+			shadingInfo, occlusion, frame);
+
+		// Side.
+		SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, farCeilingScreenY,
+			farFloorScreenY, farZ, wallU, raisedData.vTop, raisedData.vBottom,
+			wallNormal, textures.at(raisedData.sideID), nullptr, shadingInfo, occlusion, frame);
+
+		// Floor.
+		SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
+			farFloorScreenY, nearFloorScreenY, farPoint, nearPoint, farZ,
+			nearZ, Double3::UnitY, textures.at(raisedData.floorID),
+			shadingInfo, occlusion, frame);
+	}
+}
+
+template <>
+void SoftwareRenderer::drawInitialVoxel<VoxelDataType::Diagonal>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	const VoxelData::DiagonalData &diagData = voxelData.diagonal;
+
+	// Find intersection.
+	RayHit hit;
+	const bool success = diagData.type1 ?
+		SoftwareRenderer::findDiag1Intersection(voxelX, voxelZ, nearPoint, farPoint, hit) :
+		SoftwareRenderer::findDiag2Intersection(voxelX, voxelZ, nearPoint, farPoint, hit);
+
+	if (success)
+	{
+		double diagTopScreenY, diagBottomScreenY;
+		int diagStart, diagEnd;
+
+		SoftwareRenderer::diagProjection(camera.eyeVoxelReal.y, voxelHeight, hit.point,
+			camera, frame.height, frame.heightReal,
+			diagTopScreenY, diagBottomScreenY, diagStart, diagEnd);
+
+		SoftwareRenderer::drawPixels(x, diagStart, diagEnd, diagTopScreenY,
+			diagBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
+			hit.normal, textures.at(diagData.id), shadingInfo, occlusion, frame);
+	}
+}
+
+template <>
+void SoftwareRenderer::drawInitialVoxel<VoxelDataType::Edge>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	const VoxelData::EdgeData &edgeData = voxelData.edge;
+
+	// Find intersection.
+	RayHit hit;
+	const bool success = SoftwareRenderer::findInitialEdgeIntersection(
+		voxelX, voxelZ, edgeData.facing, nearPoint, farPoint, camera, ray, hit);
+
+	if (success)
+	{
+		const Double3 edgeTopPoint(
+			hit.point.x,
+			camera.eyeVoxelReal.y + voxelHeight + edgeData.yOffset,
+			hit.point.y);
+
+		const Double3 edgeBottomPoint(
+			hit.point.x,
+			camera.eyeVoxelReal.y + edgeData.yOffset,
+			hit.point.y);
+
+		const HeightProjector edgeProjector(hit.point, camera, frame.heightReal);
+		const double edgeTopScreenY = edgeProjector.getScreenY(edgeTopPoint.y);
+		const double edgeBottomScreenY = edgeProjector.getScreenY(edgeBottomPoint.y);
+
+		const int edgeStart = SoftwareRenderer::getLowerBoundedPixel(
+			edgeTopScreenY, frame.height);
+		const int edgeEnd = SoftwareRenderer::getUpperBoundedPixel(
+			edgeBottomScreenY, frame.height);
+
+		SoftwareRenderer::drawTransparentPixels(x, edgeStart, edgeEnd, edgeTopScreenY,
+			edgeBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
+			hit.normal, textures.at(edgeData.id), nullptr, shadingInfo, occlusion, frame);
+	}
+}
+
+template <>
+void SoftwareRenderer::drawInitialVoxel<VoxelDataType::Chasm>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	// Render back-face.
+	const VoxelData::ChasmData &chasmData = voxelData.chasm;
+	const uint8_t *cycledIndices = shadingInfo.getCycledIndices(chasmData);
+
+	// Find which far face on the chasm was intersected.
+	const VoxelData::Facing farFacing = SoftwareRenderer::getInitialChasmFarFacing(
+		voxelX, voxelZ, Double2(camera.eye.x, camera.eye.z), ray);
+
+	// Far.
+	if (chasmData.faceIsVisible(farFacing))
+	{
+		const double farU = [&farPoint, farFacing]()
+		{
+			const double uVal = [&farPoint, farFacing]()
+			{
+				if (farFacing == VoxelData::Facing::PositiveX)
+				{
+					return farPoint.y - std::floor(farPoint.y);
+				}
+				else if (farFacing == VoxelData::Facing::NegativeX)
+				{
+					return Constants::JustBelowOne - (farPoint.y - std::floor(farPoint.y));
+				}
+				else if (farFacing == VoxelData::Facing::PositiveZ)
+				{
+					return Constants::JustBelowOne - (farPoint.x - std::floor(farPoint.x));
+				}
+				else
+				{
+					return farPoint.x - std::floor(farPoint.x);
+				}
+			}();
+
+			return std::max(std::min(uVal, Constants::JustBelowOne), 0.0);
+		}();
+
+		const Double3 farNormal = -SoftwareRenderer::getNormal(farFacing);
+
+		const Double3 farCeilingPoint(
+			farPoint.x,
+			camera.eyeVoxelReal.y + voxelHeight,
+			farPoint.y);
+		const Double3 farFloorPoint(
+			farPoint.x,
+			camera.eyeVoxelReal.y,
+			farPoint.y);
+
+		const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+		const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+
+		const int farStart = SoftwareRenderer::getLowerBoundedPixel(
+			farCeilingScreenY, frame.height);
+		const int farEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farFloorScreenY, frame.height);
+
+		SoftwareRenderer::drawTransparentPixels(x, farStart, farEnd, farCeilingScreenY,
+			farFloorScreenY, farZ, farU, 0.0, Constants::JustBelowOne, farNormal,
+			textures.at(chasmData.id), cycledIndices, shadingInfo, occlusion, frame);
+	}
+}
+
+template <>
+void SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Wall>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	const VoxelData::WallData &wallData = voxelData.wall;
+
+	const Double3 farCeilingPoint(
+		farPoint.x,
+		voxelYReal + voxelHeight,
+		farPoint.y);
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		farCeilingPoint.y,
+		nearPoint.y);
+
+	const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+	const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+
+	const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+		farCeilingScreenY, frame.height);
+	const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearCeilingScreenY, frame.height);
+
+	// Ceiling.
+	SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
+		farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
+		nearZ, Double3::UnitY, textures.at(wallData.ceilingID),
+		shadingInfo, occlusion, frame);
+}
+
+template <>
+void SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Floor>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	// Draw top of floor voxel.
+	const VoxelData::FloorData &floorData = voxelData.floor;
+
+	const Double3 farCeilingPoint(
+		farPoint.x,
+		voxelYReal + voxelHeight,
+		farPoint.y);
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		farCeilingPoint.y,
+		nearPoint.y);
+
+	const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+	const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+
+	const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+		farCeilingScreenY, frame.height);
+	const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearCeilingScreenY, frame.height);
+
+	// Ceiling.
+	SoftwareRenderer::drawPlanePixels(x, ceilingStart, ceilingEnd,
+		farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
+		nearZ, farCeilingPoint.y, Double3::UnitY, floorData.id, textures,
+		shadingInfo, occlusion, frame);
+}
+
+template <>
+void SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Raised>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	const VoxelData::RaisedData &raisedData = voxelData.raised;
+
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		voxelYReal + ((raisedData.yOffset + raisedData.ySize) * voxelHeight),
+		nearPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		voxelYReal + (raisedData.yOffset * voxelHeight),
+		nearPoint.y);
+
+	// Draw order depends on the player's Y position relative to the platform.
+	if (camera.eye.y > nearCeilingPoint.y)
+	{
+		// Above platform.
+		const Double3 farCeilingPoint(
+			farPoint.x,
+			nearCeilingPoint.y,
+			farPoint.y);
+
+		const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+		const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+
+		const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+			farCeilingScreenY, frame.height);
+		const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
+			nearCeilingScreenY, frame.height);
+
+		// Ceiling.
+		SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
+			farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
+			nearZ, Double3::UnitY, textures.at(raisedData.ceilingID),
+			shadingInfo, occlusion, frame);
+	}
+	else if (camera.eye.y < nearFloorPoint.y)
+	{
+		// Below platform.
+		const Double3 farFloorPoint(
+			farPoint.x,
+			nearFloorPoint.y,
+			farPoint.y);
+
+		const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+		const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+
+		const int floorStart = SoftwareRenderer::getLowerBoundedPixel(
+			nearFloorScreenY, frame.height);
+		const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farFloorScreenY, frame.height);
+
+		// Floor.
+		SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
+			nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
+			farZ, -Double3::UnitY, textures.at(raisedData.floorID),
+			shadingInfo, occlusion, frame);
+	}
+	else
+	{
+		// Between top and bottom.
+		const Double3 farCeilingPoint(
+			farPoint.x,
+			nearCeilingPoint.y,
+			farPoint.y);
+		const Double3 farFloorPoint(
+			farPoint.x,
+			nearFloorPoint.y,
+			farPoint.y);
+
+		const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+		const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+		const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+		const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+
+		const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+			nearCeilingScreenY, frame.height);
+		const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farCeilingScreenY, frame.height);
+		const int wallStart = ceilingEnd;
+		const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farFloorScreenY, frame.height);
+		const int floorStart = wallEnd;
+		const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+			nearFloorScreenY, frame.height);
+
+		// Ceiling.
+		SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
+			nearCeilingScreenY, farCeilingScreenY, nearPoint, farPoint, nearZ,
+			farZ, -Double3::UnitY, textures.at(raisedData.ceilingID),
+			shadingInfo, occlusion, frame);
+
+		// Side.
+		SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, farCeilingScreenY,
+			farFloorScreenY, farZ, wallU, raisedData.vTop, raisedData.vBottom,
+			wallNormal, textures.at(raisedData.sideID), nullptr, shadingInfo, occlusion, frame);
+
+		// Floor.
+		SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
+			farFloorScreenY, nearFloorScreenY, farPoint, nearPoint, farZ,
+			nearZ, Double3::UnitY, textures.at(raisedData.floorID),
+			shadingInfo, occlusion, frame);
+	}
+}
+
+template <>
+void SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Diagonal>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	const VoxelData::DiagonalData &diagData = voxelData.diagonal;
+
+	// Find intersection.
+	RayHit hit;
+	const bool success = diagData.type1 ?
+		SoftwareRenderer::findDiag1Intersection(voxelX, voxelZ, nearPoint, farPoint, hit) :
+		SoftwareRenderer::findDiag2Intersection(voxelX, voxelZ, nearPoint, farPoint, hit);
+
+	if (success)
+	{
+		double diagTopScreenY, diagBottomScreenY;
+		int diagStart, diagEnd;
+
+		SoftwareRenderer::diagProjection(voxelYReal, voxelHeight, hit.point,
+			camera, frame.height, frame.heightReal,
+			diagTopScreenY, diagBottomScreenY, diagStart, diagEnd);
+
+		SoftwareRenderer::drawPixels(x, diagStart, diagEnd, diagTopScreenY,
+			diagBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
+			hit.normal, textures.at(diagData.id), shadingInfo, occlusion, frame);
+	}
+}
+
+template <>
+void SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Edge>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	const VoxelData::EdgeData &edgeData = voxelData.edge;
+
+	// Find intersection.
+	RayHit hit;
+	const bool success = SoftwareRenderer::findInitialEdgeIntersection(
+		voxelX, voxelZ, edgeData.facing, nearPoint, farPoint, camera, ray, hit);
+
+	if (success)
+	{
+		const Double3 edgeTopPoint(
+			hit.point.x,
+			voxelYReal + voxelHeight + edgeData.yOffset,
+			hit.point.y);
+
+		const Double3 edgeBottomPoint(
+			hit.point.x,
+			voxelYReal + edgeData.yOffset,
+			hit.point.y);
+
+		const HeightProjector edgeProjector(hit.point, camera, frame.heightReal);
+		const double edgeTopScreenY = edgeProjector.getScreenY(edgeTopPoint.y);
+		const double edgeBottomScreenY = edgeProjector.getScreenY(edgeBottomPoint.y);
+
+		const int edgeStart = SoftwareRenderer::getLowerBoundedPixel(
+			edgeTopScreenY, frame.height);
+		const int edgeEnd = SoftwareRenderer::getUpperBoundedPixel(
+			edgeBottomScreenY, frame.height);
+
+		SoftwareRenderer::drawTransparentPixels(x, edgeStart, edgeEnd, edgeTopScreenY,
+			edgeBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
+			hit.normal, textures.at(edgeData.id), nullptr, shadingInfo, occlusion, frame);
+	}
+}
+
+template <>
+void SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Chasm>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	// Render back-face.
+	const VoxelData::ChasmData &chasmData = voxelData.chasm;
+	const uint8_t *cycledIndices = shadingInfo.getCycledIndices(chasmData);
+
+	// Find which far face on the chasm was intersected.
+	const VoxelData::Facing farFacing = SoftwareRenderer::getInitialChasmFarFacing(
+		voxelX, voxelZ, Double2(camera.eye.x, camera.eye.z), ray);
 
-		if (onTop)
-		{
-			// Ignore top-left corner.
-			if ((angle > downLeftAngle) && (angle < downRightAngle))
-			{
-				return VoxelData::Facing::NegativeX;
-			}
-			else
-			{
-				return VoxelData::Facing::PositiveZ;
-			}
-		}
-		else if (onBottom)
-		{
-			// Ignore bottom-left corner.
-			if ((angle > upRightAngle) && (angle < upLeftAngle))
-			{
-				return VoxelData::Facing::PositiveX;
-			}
-			else
-			{
-				return VoxelData::Facing::PositiveZ;
-			}
-		}
-		else
+	// Far.
+	if (chasmData.faceIsVisible(farFacing))
+	{
+		const double farU = [&farPoint, farFacing]()
 		{
-			if ((angle < upRightAngle) || (angle > downRightAngle))
-			{
-				return VoxelData::Facing::PositiveZ;
-			}
-			else if (angle > downLeftAngle)
-			{
-				return VoxelData::Facing::NegativeX;
-			}
-			else
+			const double uVal = [&farPoint, farFacing]()
 			{
-				return VoxelData::Facing::PositiveX;
-			}
-		}
-	}
-}
+				if (farFacing == VoxelData::Facing::PositiveX)
+				{
+					return farPoint.y - std::floor(farPoint.y);
+				}
+				else if (farFacing == VoxelData::Facing::NegativeX)
+				{
+					return Constants::JustBelowOne - (farPoint.y - std::floor(farPoint.y));
+				}
+				else if (farFacing == VoxelData::Facing::PositiveZ)
+				{
+					return Constants::JustBelowOne - (farPoint.x - std::floor(farPoint.x));
+				}
+				else
+				{
+					return farPoint.x - std::floor(farPoint.x);
+				}
+			}();
+
+			return std::max(std::min(uVal, Constants::JustBelowOne), 0.0);
+		}();
+
+		const Double3 farNormal = -SoftwareRenderer::getNormal(farFacing);
 
-double SoftwareRenderer::getProjectedY(const Double3 &point, 
-	const Matrix4d &transform, double yShear)
-{	
-	// Just do 3D projection for the Y and W coordinates instead of a whole
-	// matrix * vector4 multiplication to keep from doing some unnecessary work.
-	double projectedY, projectedW;
-	transform.ywMultiply(point, projectedY, projectedW);
+		const Double3 farCeilingPoint(
+			farPoint.x,
+			voxelYReal + voxelHeight,
+			farPoint.y);
+		const Double3 farFloorPoint(
+			farPoint.x,
+			voxelYReal,
+			farPoint.y);
 
-	// Convert the projected Y to normalized coordinates.
-	projectedY /= projectedW;
+		const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+		const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
 
-	// Calculate the Y position relative to the center row of the screen, and offset it by 
-	// the Y-shear. Multiply by 0.5 for the correct aspect ratio.
-	return (0.50 + yShear) - (projectedY * 0.50);
+		const int farStart = SoftwareRenderer::getLowerBoundedPixel(
+			farCeilingScreenY, frame.height);
+		const int farEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farFloorScreenY, frame.height);
+
+		SoftwareRenderer::drawTransparentPixels(x, farStart, farEnd, farCeilingScreenY,
+			farFloorScreenY, farZ, farU, 0.0, Constants::JustBelowOne, farNormal,
+			textures.at(chasmData.id), cycledIndices, shadingInfo, occlusion, frame);
+	}
 }
 
-int SoftwareRenderer::getLowerBoundedPixel(double projected, int frameDim)
+template <>
+void SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::Wall>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
 {
-	return std::min(std::max(0,
-		static_cast<int>(std::ceil(projected - 0.50))), frameDim);
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	const VoxelData::WallData &wallData = voxelData.wall;
+
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		voxelYReal,
+		nearPoint.y);
+	const Double3 farFloorPoint(
+		farPoint.x,
+		nearFloorPoint.y,
+		farPoint.y);
+
+	const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+	const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+
+	const int floorStart = SoftwareRenderer::getLowerBoundedPixel(
+		nearFloorScreenY, frame.height);
+	const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+		farFloorScreenY, frame.height);
+
+	// Floor.
+	SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
+		nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
+		farZ, -Double3::UnitY, textures.at(wallData.floorID),
+		shadingInfo, occlusion, frame);
 }
 
-int SoftwareRenderer::getUpperBoundedPixel(double projected, int frameDim)
+template <>
+void SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::Ceiling>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
 {
-	return std::min(std::max(0,
-		static_cast<int>(std::floor(projected + 0.50))), frameDim);
+	// Draw bottom of ceiling voxel.
+	const VoxelData::CeilingData &ceilingData = voxelData.ceiling;
+
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		1.0 + ceilingHeight,
+		nearPoint.y);
+	const Double3 farFloorPoint(
+		farPoint.x,
+		nearFloorPoint.y,
+		farPoint.y);
+
+	const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+	const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+
+	const int floorStart = SoftwareRenderer::getLowerBoundedPixel(
+		nearFloorScreenY, frame.height);
+	const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+		farFloorScreenY, frame.height);
+
+	SoftwareRenderer::drawPlanePixels(x, floorStart, floorEnd,
+		nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
+		farZ, nearFloorPoint.y, -Double3::UnitY, ceilingData.id, textures,
+		shadingInfo, occlusion, frame);
 }
 
-bool SoftwareRenderer::findDiag1Intersection(int voxelX, int voxelZ, const Double2 &nearPoint,
-	const Double2 &farPoint, RayHit &hit)
+template <>
+void SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::Raised>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
 {
-	// Start, middle, and end points of the diagonal line segment relative to the grid.
-	const Double2 diagStart(
-		static_cast<double>(voxelX),
-		static_cast<double>(voxelZ));
-	const Double2 diagMiddle(
-		static_cast<double>(voxelX) + 0.50,
-		static_cast<double>(voxelZ) + 0.50);
-	const Double2 diagEnd(
-		static_cast<double>(voxelX) + Constants::JustBelowOne,
-		static_cast<double>(voxelZ) + Constants::JustBelowOne);
+	const double voxelYReal = static_cast<double>(voxelY);
 
-	// Normals for the left and right faces of the wall, facing up-left and down-right
-	// respectively (magic number is sqrt(2) / 2).
-	const Double3 leftNormal(0.7071068, 0.0, -0.7071068);
-	const Double3 rightNormal(-0.7071068, 0.0, 0.7071068);
-	
-	// An intersection occurs if the near point and far point are on different sides 
-	// of the diagonal line, or if the near point lies on the diagonal line. No need
-	// to normalize the (localPoint - diagMiddle) vector because it's just checking
-	// if it's greater than zero.
-	const Double2 leftNormal2D(leftNormal.x, leftNormal.z);
-	const bool nearOnLeft = leftNormal2D.dot(nearPoint - diagMiddle) >= 0.0;
-	const bool farOnLeft = leftNormal2D.dot(farPoint - diagMiddle) >= 0.0;
-	const bool intersectionOccurred = (nearOnLeft && !farOnLeft) || (!nearOnLeft && farOnLeft);
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
 
-	// Only set the output data if an intersection occurred.
-	if (intersectionOccurred)
+	const VoxelData::RaisedData &raisedData = voxelData.raised;
+
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		voxelYReal + ((raisedData.yOffset + raisedData.ySize) * voxelHeight),
+		nearPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		voxelYReal + (raisedData.yOffset * voxelHeight),
+		nearPoint.y);
+
+	// Draw order depends on the player's Y position relative to the platform.
+	if (camera.eye.y > nearCeilingPoint.y)
 	{
-		// Change in X and change in Z of the incoming ray across the voxel.
-		const double dx = farPoint.x - nearPoint.x;
-		const double dz = farPoint.y - nearPoint.y;
+		// Above platform.
+		const Double3 farCeilingPoint(
+			farPoint.x,
+			nearCeilingPoint.y,
+			farPoint.y);
+
+		const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+		const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+
+		const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+			farCeilingScreenY, frame.height);
+		const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
+			nearCeilingScreenY, frame.height);
+
+		// Ceiling.
+		SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
+			farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
+			nearZ, Double3::UnitY, textures.at(raisedData.ceilingID),
+			shadingInfo, occlusion, frame);
+	}
+	else if (camera.eye.y < nearFloorPoint.y)
+	{
+		// Below platform.
+		const Double3 farFloorPoint(
+			farPoint.x,
+			nearFloorPoint.y,
+			farPoint.y);
+
+		const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+		const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+
+		const int floorStart = SoftwareRenderer::getLowerBoundedPixel(
+			nearFloorScreenY, frame.height);
+		const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farFloorScreenY, frame.height);
+
+		// Floor.
+		SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
+			nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
+			farZ, -Double3::UnitY, textures.at(raisedData.floorID),
+			shadingInfo, occlusion, frame);
+	}
+	else
+	{
+		// Between top and bottom.
+		const Double3 farCeilingPoint(
+			farPoint.x,
+			nearCeilingPoint.y,
+			farPoint.y);
+		const Double3 farFloorPoint(
+			farPoint.x,
+			nearFloorPoint.y,
+			farPoint.y);
+
+		const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+		const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+		const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+		const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+
+		const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+			nearCeilingScreenY, frame.height);
+		const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farCeilingScreenY, frame.height);
+		const int wallStart = ceilingEnd;
+		const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farFloorScreenY, frame.height);
+		const int floorStart = wallEnd;
+		const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+			nearFloorScreenY, frame.height);
+
+		// Ceiling.
+		SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
+			nearCeilingScreenY, farCeilingScreenY, nearPoint, farPoint, nearZ,
+			farZ, -Double3::UnitY, textures.at(raisedData.ceilingID),
+			shadingInfo, occlusion, frame);
+
+		// Side.
+		SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, farCeilingScreenY,
+			farFloorScreenY, farZ, wallU, raisedData.vTop, raisedData.vBottom,
+			wallNormal, textures.at(raisedData.sideID), nullptr, shadingInfo,
+			occlusion, frame);
+
+		// Floor.
+		SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
+			farFloorScreenY, nearFloorScreenY, farPoint, nearPoint, farZ,
+			nearZ, Double3::UnitY, textures.at(raisedData.floorID),
+			shadingInfo, occlusion, frame);
+	}
+}
 
-		// The hit coordinate is a 0->1 value representing where the diagonal was hit.
-		const double hitCoordinate = [&nearPoint, &diagStart, dx, dz]()
-		{
-			// Special cases: when the slope is horizontal or vertical. This method treats
-			// the X axis as the vertical axis and the Z axis as the horizontal axis.
-			const double isHorizontal = std::abs(dx) < Constants::Epsilon;
-			const double isVertical = std::abs(dz) < Constants::Epsilon;
+template <>
+void SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::Diagonal>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
 
-			if (isHorizontal)
-			{
-				// The X axis intercept is the intersection coordinate.
-				return nearPoint.x - diagStart.x;
-			}
-			else if (isVertical)
-			{
-				// The Z axis intercept is the intersection coordinate.
-				return nearPoint.y - diagStart.y;
-			}
-			else
-			{
-				// Slope of the diagonal line (trivial, x = z).
-				const double diagSlope = 1.0;
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
 
-				// Vertical axis intercept of the diagonal line.
-				const double diagXIntercept = diagStart.x - diagStart.y;
+	const VoxelData::DiagonalData &diagData = voxelData.diagonal;
 
-				// Slope of the incoming ray.
-				const double raySlope = dx / dz;
+	// Find intersection.
+	RayHit hit;
+	const bool success = diagData.type1 ?
+		SoftwareRenderer::findDiag1Intersection(voxelX, voxelZ, nearPoint, farPoint, hit) :
+		SoftwareRenderer::findDiag2Intersection(voxelX, voxelZ, nearPoint, farPoint, hit);
 
-				// Get the vertical axis intercept of the incoming ray.
-				const double rayXIntercept = nearPoint.x - (raySlope * nearPoint.y);
+	if (success)
+	{
+		double diagTopScreenY, diagBottomScreenY;
+		int diagStart, diagEnd;
 
-				// General line intersection calculation.
-				return ((rayXIntercept - diagXIntercept) / 
-					(diagSlope - raySlope)) - diagStart.y;
-			}
-		}();
+		SoftwareRenderer::diagProjection(voxelYReal, voxelHeight, hit.point,
+			camera, frame.height, frame.heightReal,
+			diagTopScreenY, diagBottomScreenY, diagStart, diagEnd);
 
-		// Set the hit data.
-		hit.u = std::max(std::min(hitCoordinate, Constants::JustBelowOne), 0.0);
-		hit.point = Double2(
-			static_cast<double>(voxelX) + hit.u,
-			static_cast<double>(voxelZ) + hit.u);
-		hit.innerZ = (hit.point - nearPoint).length();
-		hit.normal = nearOnLeft ? leftNormal : rightNormal;
+		SoftwareRenderer::drawPixels(x, diagStart, diagEnd, diagTopScreenY,
+			diagBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
+			hit.normal, textures.at(diagData.id), shadingInfo, occlusion, frame);
+	}
+}
 
-		return true;
+template <>
+void SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::Edge>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	const VoxelData::EdgeData &edgeData = voxelData.edge;
+
+	// Find intersection.
+	RayHit hit;
+	const bool success = SoftwareRenderer::findInitialEdgeIntersection(
+		voxelX, voxelZ, edgeData.facing, nearPoint, farPoint, camera, ray, hit);
+
+	if (success)
+	{
+		const Double3 edgeTopPoint(
+			hit.point.x,
+			voxelYReal + voxelHeight + edgeData.yOffset,
+			hit.point.y);
+
+		const Double3 edgeBottomPoint(
+			hit.point.x,
+			voxelYReal + edgeData.yOffset,
+			hit.point.y);
+
+		const HeightProjector edgeProjector(hit.point, camera, frame.heightReal);
+		const double edgeTopScreenY = edgeProjector.getScreenY(edgeTopPoint.y);
+		const double edgeBottomScreenY = edgeProjector.getScreenY(edgeBottomPoint.y);
+
+		const int edgeStart = SoftwareRenderer::getLowerBoundedPixel(
+			edgeTopScreenY, frame.height);
+		const int edgeEnd = SoftwareRenderer::getUpperBoundedPixel(
+			edgeBottomScreenY, frame.height);
+
+		SoftwareRenderer::drawTransparentPixels(x, edgeStart, edgeEnd, edgeTopScreenY,
+			edgeBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
+			hit.normal, textures.at(edgeData.id), nullptr, shadingInfo, occlusion, frame);
+	}
+}
+
+template <>
+void SoftwareRenderer::drawVoxel<VoxelDataType::Wall>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	// Draw side.
+	const VoxelData::WallData &wallData = voxelData.wall;
+
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		camera.eyeVoxelReal.y + voxelHeight,
+		nearPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		camera.eyeVoxelReal.y,
+		nearPoint.y);
+
+	const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+	const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+	
+	const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
+		nearCeilingScreenY, frame.height);
+	const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearFloorScreenY, frame.height);
+
+	SoftwareRenderer::drawPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+		nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
+		textures.at(wallData.sideID), shadingInfo, occlusion, frame);
+}
+
+template <>
+void SoftwareRenderer::drawVoxel<VoxelDataType::Raised>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	const VoxelData::RaisedData &raisedData = voxelData.raised;
+
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		camera.eyeVoxelReal.y + ((raisedData.yOffset + raisedData.ySize) * voxelHeight),
+		nearPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		camera.eyeVoxelReal.y + (raisedData.yOffset * voxelHeight),
+		nearPoint.y);
+
+	const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+	const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+
+	const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
+		nearCeilingScreenY, frame.height);
+	const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearFloorScreenY, frame.height);
+
+	// Draw order depends on the player's Y position relative to the platform.
+	if (camera.eye.y > nearCeilingPoint.y)
+	{
+		// Above platform.
+		const Double3 farCeilingPoint(
+			farPoint.x,
+			nearCeilingPoint.y,
+			farPoint.y);
+
+		const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+
+		const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+			farCeilingScreenY, frame.height);
+		const int ceilingEnd = wallStart;
+
+		// Ceiling.
+		SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
+			farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
+			nearZ, Double3::UnitY, textures.at(raisedData.ceilingID),
+			shadingInfo, occlusion, frame);
+
+		// Side.
+		SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+			nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
+			wallNormal, textures.at(raisedData.sideID), nullptr, shadingInfo,
+			occlusion, frame);
+	}
+	else if (camera.eye.y < nearFloorPoint.y)
+	{
+		// Below platform.
+		const Double3 farFloorPoint(
+			farPoint.x,
+			nearFloorPoint.y,
+			farPoint.y);
+
+		const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+
+		const int floorStart = wallEnd;
+		const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farFloorScreenY, frame.height);
+
+		// Side.
+		SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+			nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
+			wallNormal, textures.at(raisedData.sideID), nullptr, shadingInfo, occlusion, frame);
+
+		// Floor.
+		SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
+			nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
+			farZ, -Double3::UnitY, textures.at(raisedData.floorID),
+			shadingInfo, occlusion, frame);
 	}
 	else
 	{
-		// No intersection.
-		return false;
+		// Between top and bottom.
+		SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+			nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
+			wallNormal, textures.at(raisedData.sideID), nullptr, shadingInfo, occlusion, frame);
 	}
 }
 
-bool SoftwareRenderer::findDiag2Intersection(int voxelX, int voxelZ, const Double2 &nearPoint,
-	const Double2 &farPoint, RayHit &hit)
+template <>
+void SoftwareRenderer::drawVoxel<VoxelDataType::Diagonal>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
 {
-	// Mostly a copy of findDiag1Intersection(), though with a couple different values
-	// for the diagonal (end points, slope, etc.).
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
 
-	// Start, middle, and end points of the diagonal line segment relative to the grid.
-	const Double2 diagStart(
-		static_cast<double>(voxelX) + Constants::JustBelowOne,
-		static_cast<double>(voxelZ));
-	const Double2 diagMiddle(
-		static_cast<double>(voxelX) + 0.50,
-		static_cast<double>(voxelZ) + 0.50);
-	const Double2 diagEnd(
-		static_cast<double>(voxelX),
-		static_cast<double>(voxelZ) + Constants::JustBelowOne);
-
-	// Normals for the left and right faces of the wall, facing up-right and down-left
-	// respectively (magic number is sqrt(2) / 2).
-	const Double3 leftNormal(0.7071068, 0.0, 0.7071068);
-	const Double3 rightNormal(-0.7071068, 0.0, -0.7071068);
+	const VoxelData::DiagonalData &diagData = voxelData.diagonal;
 
-	// An intersection occurs if the near point and far point are on different sides 
-	// of the diagonal line, or if the near point lies on the diagonal line. No need
-	// to normalize the (localPoint - diagMiddle) vector because it's just checking
-	// if it's greater than zero.
-	const Double2 leftNormal2D(leftNormal.x, leftNormal.z);
-	const bool nearOnLeft = leftNormal2D.dot(nearPoint - diagMiddle) >= 0.0;
-	const bool farOnLeft = leftNormal2D.dot(farPoint - diagMiddle) >= 0.0;
-	const bool intersectionOccurred = (nearOnLeft && !farOnLeft) || (!nearOnLeft && farOnLeft);
+	// Find intersection.
+	RayHit hit;
+	const bool success = diagData.type1 ?
+		SoftwareRenderer::findDiag1Intersection(voxelX, voxelZ, nearPoint, farPoint, hit) :
+		SoftwareRenderer::findDiag2Intersection(voxelX, voxelZ, nearPoint, farPoint, hit);
 
-	// Only set the output data if an intersection occurred.
-	if (intersectionOccurred)
+	if (success)
 	{
-		// Change in X and change in Z of the incoming ray across the voxel.
-		const double dx = farPoint.x - nearPoint.x;
-		const double dz = farPoint.y - nearPoint.y;
-
-		// The hit coordinate is a 0->1 value representing where the diagonal was hit.
-		const double hitCoordinate = [&nearPoint, &diagStart, dx, dz]()
-		{
-			// Special cases: when the slope is horizontal or vertical. This method treats
-			// the X axis as the vertical axis and the Z axis as the horizontal axis.
-			const double isHorizontal = std::abs(dx) < Constants::Epsilon;
-			const double isVertical = std::abs(dz) < Constants::Epsilon;
+		double diagTopScreenY, diagBottomScreenY;
+		int diagStart, diagEnd;
 
-			if (isHorizontal)
-			{
-				// The X axis intercept is the compliment of the intersection coordinate.
-				return Constants::JustBelowOne - (nearPoint.x - diagStart.x);
-			}
-			else if (isVertical)
-			{
-				// The Z axis intercept is the compliment of the intersection coordinate.
-				return Constants::JustBelowOne - (nearPoint.y - diagStart.y);
-			}
-			else
-			{
-				// Slope of the diagonal line (trivial, x = -z).
-				const double diagSlope = -1.0;
+		SoftwareRenderer::diagProjection(camera.eyeVoxelReal.y, voxelHeight, hit.point,
+			camera, frame.height, frame.heightReal,
+			diagTopScreenY, diagBottomScreenY, diagStart, diagEnd);
 
-				// Vertical axis intercept of the diagonal line.
-				const double diagXIntercept = diagStart.x + diagStart.y;
+		SoftwareRenderer::drawPixels(x, diagStart, diagEnd, diagTopScreenY,
+			diagBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne, 
+			hit.normal, textures.at(diagData.id), shadingInfo, occlusion, frame);
+	}
+}
 
-				// Slope of the incoming ray.
-				const double raySlope = dx / dz;
+template <>
+void SoftwareRenderer::drawVoxel<VoxelDataType::TransparentWall>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	// Draw transparent side.
+	const VoxelData::TransparentWallData &transparentWallData = voxelData.transparentWall;
+
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		camera.eyeVoxelReal.y + voxelHeight,
+		nearPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		camera.eyeVoxelReal.y,
+		nearPoint.y);
+
+	const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+	const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+
+	const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
+		nearCeilingScreenY, frame.height);
+	const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearFloorScreenY, frame.height);
+
+	SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+		nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal, 
+		textures.at(transparentWallData.id), nullptr, shadingInfo, occlusion, frame);
+}
 
-				// Get the vertical axis intercept of the incoming ray.
-				const double rayXIntercept = nearPoint.x - (raySlope * nearPoint.y);
+template <>
+void SoftwareRenderer::drawVoxel<VoxelDataType::Edge>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
 
-				// General line intersection calculation.
-				return ((rayXIntercept - diagXIntercept) /
-					(diagSlope - raySlope)) - diagStart.y;
-			}
-		}();
+	const VoxelData::EdgeData &edgeData = voxelData.edge;
 
-		// Set the hit data.
-		hit.u = std::max(std::min(hitCoordinate, Constants::JustBelowOne), 0.0);
-		hit.point = Double2(
-			static_cast<double>(voxelX) + (Constants::JustBelowOne - hit.u),
-			static_cast<double>(voxelZ) + hit.u);
-		hit.innerZ = (hit.point - nearPoint).length();
-		hit.normal = nearOnLeft ? leftNormal : rightNormal;
+	// Find intersection.
+	RayHit hit;
+	const bool success = SoftwareRenderer::findEdgeIntersection(voxelX, voxelZ,
+		edgeData.facing, facing, nearPoint, farPoint, wallU, camera, ray, hit);
 
-		return true;
-	}
-	else
+	if (success)
 	{
-		// No intersection.
-		return false;
+		const Double3 edgeTopPoint(
+			hit.point.x,
+			camera.eyeVoxelReal.y + voxelHeight + edgeData.yOffset,
+			hit.point.y);
+
+		const Double3 edgeBottomPoint(
+			hit.point.x,
+			camera.eyeVoxelReal.y + edgeData.yOffset,
+			hit.point.y);
+
+		const HeightProjector edgeProjector(hit.point, camera, frame.heightReal);
+		const double edgeTopScreenY = edgeProjector.getScreenY(edgeTopPoint.y);
+		const double edgeBottomScreenY = edgeProjector.getScreenY(edgeBottomPoint.y);
+
+		const int edgeStart = SoftwareRenderer::getLowerBoundedPixel(
+			edgeTopScreenY, frame.height);
+		const int edgeEnd = SoftwareRenderer::getUpperBoundedPixel(
+			edgeBottomScreenY, frame.height);
+
+		SoftwareRenderer::drawTransparentPixels(x, edgeStart, edgeEnd, edgeTopScreenY,
+			edgeBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
+			hit.normal, textures.at(edgeData.id), nullptr, shadingInfo, occlusion, frame);
 	}
 }
 
-bool SoftwareRenderer::findInitialEdgeIntersection(int voxelX, int voxelZ, 
-	VoxelData::Facing edgeFacing, const Double2 &nearPoint, const Double2 &farPoint,
-	const Camera &camera, const Ray &ray, RayHit &hit)
+template <>
+void SoftwareRenderer::drawVoxel<VoxelDataType::Chasm>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
 {
-	// Reuse the chasm facing code to find which face is intersected.
-	const VoxelData::Facing farFacing = SoftwareRenderer::getInitialChasmFarFacing(
-		voxelX, voxelZ, Double2(camera.eye.x, camera.eye.z), ray);
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
 
-	// If the edge facing and far facing match, there's an intersection.
-	if (edgeFacing == farFacing)
+	// Render front and back-faces.
+	const VoxelData::ChasmData &chasmData = voxelData.chasm;
+	const uint8_t *cycledIndices = shadingInfo.getCycledIndices(chasmData);
+
+	// Find which faces on the chasm were intersected.
+	const VoxelData::Facing nearFacing = facing;
+	const VoxelData::Facing farFacing = SoftwareRenderer::getChasmFarFacing(
+		voxelX, voxelZ, nearFacing, camera, ray);
+
+	// Near.
+	if (chasmData.faceIsVisible(nearFacing))
 	{
-		hit.innerZ = (farPoint - nearPoint).length();
-		hit.u = [&farPoint, farFacing]()
+		const double nearU = Constants::JustBelowOne - wallU;
+		const Double3 nearNormal = wallNormal;
+
+		const Double3 nearCeilingPoint(
+			nearPoint.x,
+			camera.eyeVoxelReal.y + voxelHeight,
+			nearPoint.y);
+		const Double3 nearFloorPoint(
+			nearPoint.x,
+			camera.eyeVoxelReal.y,
+			nearPoint.y);
+
+		const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+		const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+
+		const int nearStart = SoftwareRenderer::getLowerBoundedPixel(
+			nearCeilingScreenY, frame.height);
+		const int nearEnd = SoftwareRenderer::getUpperBoundedPixel(
+			nearFloorScreenY, frame.height);
+
+		SoftwareRenderer::drawTransparentPixels(x, nearStart, nearEnd, nearCeilingScreenY,
+			nearFloorScreenY, nearZ, nearU, 0.0, Constants::JustBelowOne, nearNormal,
+			textures.at(chasmData.id), cycledIndices, shadingInfo, occlusion, frame);
+	}
+
+	// Far.
+	if (chasmData.faceIsVisible(farFacing))
+	{
+		const double farU = [&farPoint, farFacing]()
 		{
 			const double uVal = [&farPoint, farFacing]()
 			{
 				if (farFacing == VoxelData::Facing::PositiveX)
 				{
-					return Constants::JustBelowOne - (farPoint.y - std::floor(farPoint.y));
+					return farPoint.y - std::floor(farPoint.y);
 				}
 				else if (farFacing == VoxelData::Facing::NegativeX)
 				{
-					return farPoint.y - std::floor(farPoint.y);
+					return Constants::JustBelowOne - (farPoint.y - std::floor(farPoint.y));
 				}
 				else if (farFacing == VoxelData::Facing::PositiveZ)
 				{
-					return farPoint.x - std::floor(farPoint.x);
+					return Constants::JustBelowOne - (farPoint.x - std::floor(farPoint.x));
 				}
 				else
 				{
-					return Constants::JustBelowOne - (farPoint.x - std::floor(farPoint.x));
+					return farPoint.x - std::floor(farPoint.x);
 				}
 			}();
 
 			return std::max(std::min(uVal, Constants::JustBelowOne), 0.0);
 		}();
 
-		hit.point = farPoint;
-		hit.normal = -SoftwareRenderer::getNormal(farFacing);
-		return true;
-	}
-	else
-	{
-		// No intersection.
-		return false;
+		const Double3 farNormal = -SoftwareRenderer::getNormal(farFacing);
+
+		const Double3 farCeilingPoint(
+			farPoint.x,
+			camera.eyeVoxelReal.y + voxelHeight,
+			farPoint.y);
+		const Double3 farFloorPoint(
+			farPoint.x,
+			camera.eyeVoxelReal.y,
+			farPoint.y);
+
+		const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+		const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+
+		const int farStart = SoftwareRenderer::getLowerBoundedPixel(
+			farCeilingScreenY, frame.height);
+		const int farEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farFloorScreenY, frame.height);
+
+		SoftwareRenderer::drawTransparentPixels(x, farStart, farEnd, farCeilingScreenY,
+			farFloorScreenY, farZ, farU, 0.0, Constants::JustBelowOne, farNormal,
+			textures.at(chasmData.id), cycledIndices, shadingInfo, occlusion, frame);
 	}
 }
 
-bool SoftwareRenderer::findEdgeIntersection(int voxelX, int voxelZ, VoxelData::Facing edgeFacing,
-	VoxelData::Facing nearFacing, const Double2 &nearPoint, const Double2 &farPoint, double nearU,
-	const Camera &camera, const Ray &ray, RayHit &hit)
+template <>
+void SoftwareRenderer::drawVoxel<VoxelDataType::Door>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
 {
-	// If the edge facing and near facing match, the intersection is trivial.
-	if (edgeFacing == nearFacing)
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	const VoxelData::DoorData &doorData = voxelData.door;
+	const double openPercent = shadingInfo.getDoorOpenPercent(voxelX, voxelY, voxelZ);
+	SoftwareRenderer::drawDoor(x, doorData.type, openPercent, camera.eyeVoxelReal.y,
+		voxelHeight, nearPoint, farPoint, nearZ, wallU, wallNormal, camera,
+		textures.at(doorData.id), shadingInfo, occlusion, frame);
+}
+
+template <>
+void SoftwareRenderer::drawVoxelBelow<VoxelDataType::Wall>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	const VoxelData::WallData &wallData = voxelData.wall;
+
+	const Double3 farCeilingPoint(
+		farPoint.x,
+		voxelYReal + voxelHeight,
+		farPoint.y);
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		farCeilingPoint.y,
+		nearPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		voxelYReal,
+		nearPoint.y);
+
+	const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+	const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+	const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+
+	const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+		farCeilingScreenY, frame.height);
+	const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearCeilingScreenY, frame.height);
+	const int wallStart = ceilingEnd;
+	const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearFloorScreenY, frame.height);
+
+	// Ceiling.
+	SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
+		farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
+		nearZ, Double3::UnitY, textures.at(wallData.ceilingID),
+		shadingInfo, occlusion, frame);
+
+	// Side.
+	SoftwareRenderer::drawPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+		nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
+		textures.at(wallData.sideID), shadingInfo, occlusion, frame);
+}
+
+template <>
+void SoftwareRenderer::drawVoxelBelow<VoxelDataType::Floor>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	// Draw top of floor voxel.
+	const VoxelData::FloorData &floorData = voxelData.floor;
+
+	const Double3 farCeilingPoint(
+		farPoint.x,
+		voxelYReal + voxelHeight,
+		farPoint.y);
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		farCeilingPoint.y,
+		nearPoint.y);
+
+	const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+	const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+
+	const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+		farCeilingScreenY, frame.height);
+	const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearCeilingScreenY, frame.height);
+
+	SoftwareRenderer::drawPlanePixels(x, ceilingStart, ceilingEnd,
+		farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
+		nearZ, farCeilingPoint.y, Double3::UnitY, floorData.id, textures,
+		shadingInfo, occlusion, frame);
+}
+
+template <>
+void SoftwareRenderer::drawVoxelBelow<VoxelDataType::Raised>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	const VoxelData::RaisedData &raisedData = voxelData.raised;
+
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		voxelYReal + ((raisedData.yOffset + raisedData.ySize) * voxelHeight),
+		nearPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		voxelYReal + (raisedData.yOffset * voxelHeight),
+		nearPoint.y);
+
+	const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+	const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+
+	const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
+		nearCeilingScreenY, frame.height);
+	const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearFloorScreenY, frame.height);
+
+	// Draw order depends on the player's Y position relative to the platform.
+	if (camera.eye.y > nearCeilingPoint.y)
 	{
-		hit.innerZ = 0.0;
-		hit.u = nearU;
-		hit.point = nearPoint;
-		hit.normal = SoftwareRenderer::getNormal(nearFacing);
-		return true;
+		// Above platform.
+		const Double3 farCeilingPoint(
+			farPoint.x,
+			nearCeilingPoint.y,
+			farPoint.y);
+
+		const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+
+		const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+			farCeilingScreenY, frame.height);
+		const int ceilingEnd = wallStart;
+
+		// Ceiling.
+		SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
+			farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
+			nearZ, Double3::UnitY, textures.at(raisedData.ceilingID),
+			shadingInfo, occlusion, frame);
+
+		// Side.
+		SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+			nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
+			wallNormal, textures.at(raisedData.sideID), nullptr, shadingInfo, 
+			occlusion, frame);
+	}
+	else if (camera.eye.y < nearFloorPoint.y)
+	{
+		// Below platform.
+		const Double3 farFloorPoint(
+			farPoint.x,
+			nearFloorPoint.y,
+			farPoint.y);
+
+		const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+
+		const int floorStart = wallEnd;
+		const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farFloorScreenY, frame.height);
+
+		// Side.
+		SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+			nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
+			wallNormal, textures.at(raisedData.sideID), nullptr, shadingInfo, occlusion, frame);
+
+		// Floor.
+		SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
+			nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
+			farZ, -Double3::UnitY, textures.at(raisedData.floorID),
+			shadingInfo, occlusion, frame);
 	}
 	else
 	{
-		// A search is needed to see whether an intersection occurred. Reuse the chasm
-		// facing code to find what the far facing is.
-		const VoxelData::Facing farFacing = SoftwareRenderer::getChasmFarFacing(
-			voxelX, voxelZ, nearFacing, camera, ray);
+		// Between top and bottom.
+		SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+			nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
+			wallNormal, textures.at(raisedData.sideID), nullptr, shadingInfo, occlusion, frame);
+	}
+}
 
-		// If the edge facing and far facing match, there's an intersection.
-		if (edgeFacing == farFacing)
-		{
-			hit.innerZ = (farPoint - nearPoint).length();
-			hit.u = [&farPoint, farFacing]()
-			{
-				const double uVal = [&farPoint, farFacing]()
-				{
-					if (farFacing == VoxelData::Facing::PositiveX)
-					{
-						return Constants::JustBelowOne - (farPoint.y - std::floor(farPoint.y));
-					}
-					else if (farFacing == VoxelData::Facing::NegativeX)
-					{
-						return farPoint.y - std::floor(farPoint.y);
-					}
-					else if (farFacing == VoxelData::Facing::PositiveZ)
-					{
-						return farPoint.x - std::floor(farPoint.x);
-					}
-					else
-					{
-						return Constants::JustBelowOne - (farPoint.x - std::floor(farPoint.x));
-					}
-				}();
+template <>
+void SoftwareRenderer::drawVoxelBelow<VoxelDataType::Diagonal>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
 
-				return std::max(std::min(uVal, Constants::JustBelowOne), 0.0);
-			}();
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
 
-			hit.point = farPoint;
-			hit.normal = -SoftwareRenderer::getNormal(farFacing);
-			return true;
-		}
-		else
-		{
-			// No intersection.
-			return false;
-		}
+	const VoxelData::DiagonalData &diagData = voxelData.diagonal;
+
+	// Find intersection.
+	RayHit hit;
+	const bool success = diagData.type1 ?
+		SoftwareRenderer::findDiag1Intersection(voxelX, voxelZ, nearPoint, farPoint, hit) :
+		SoftwareRenderer::findDiag2Intersection(voxelX, voxelZ, nearPoint, farPoint, hit);
+
+	if (success)
+	{
+		double diagTopScreenY, diagBottomScreenY;
+		int diagStart, diagEnd;
+
+		SoftwareRenderer::diagProjection(voxelYReal, voxelHeight, hit.point,
+			camera, frame.height, frame.heightReal,
+			diagTopScreenY, diagBottomScreenY, diagStart, diagEnd);
+
+		SoftwareRenderer::drawPixels(x, diagStart, diagEnd, diagTopScreenY,
+			diagBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
+			hit.normal, textures.at(diagData.id), shadingInfo, occlusion, frame);
 	}
 }
 
-bool SoftwareRenderer::findDoorIntersection(int voxelX, int voxelZ, 
-	VoxelData::DoorData::Type doorType, const Double2 &nearPoint, 
-	const Double2 &farPoint, RayHit &hit)
+template <>
+void SoftwareRenderer::drawVoxelBelow<VoxelDataType::TransparentWall>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
 {
-	// To do.
-	return false;
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	// Draw transparent side.
+	const VoxelData::TransparentWallData &transparentWallData = voxelData.transparentWall;
+
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		voxelYReal + voxelHeight,
+		nearPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		voxelYReal,
+		nearPoint.y);
+
+	const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+	const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+
+	const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
+		nearCeilingScreenY, frame.height);
+	const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearFloorScreenY, frame.height);
+
+	SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+		nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
+		textures.at(transparentWallData.id), nullptr, shadingInfo, occlusion, frame);
 }
 
-void SoftwareRenderer::diagProjection(double voxelYReal, double voxelHeight,
-	const Double2 &point, const Matrix4d &transform, double yShear, int frameHeight, 
-	double heightReal, double &diagTopScreenY, double &diagBottomScreenY, 
-	int &diagStart, int &diagEnd)
+template <>
+void SoftwareRenderer::drawVoxelBelow<VoxelDataType::Edge>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
 {
-	// Points in world space for the top and bottom of the diagonal wall slice.
-	const Double3 diagTop(point.x, voxelYReal + voxelHeight, point.y);
-	const Double3 diagBottom(point.x, voxelYReal, point.y);
+	const double voxelYReal = static_cast<double>(voxelY);
 
-	// Projected Y coordinates on-screen.
-	diagTopScreenY = SoftwareRenderer::getProjectedY(
-		diagTop, transform, yShear) * heightReal;
-	diagBottomScreenY = SoftwareRenderer::getProjectedY(
-		diagBottom, transform, yShear) * heightReal;
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
 
-	// Y drawing range on-screen.
-	diagStart = std::min(std::max(0,
-		static_cast<int>(std::ceil(diagTopScreenY - 0.50))), frameHeight);
-	diagEnd = std::min(std::max(0,
-		static_cast<int>(std::floor(diagBottomScreenY + 0.50))), frameHeight);
+	const VoxelData::EdgeData &edgeData = voxelData.edge;
+
+	// Find intersection.
+	RayHit hit;
+	const bool success = SoftwareRenderer::findEdgeIntersection(voxelX, voxelZ,
+		edgeData.facing, facing, nearPoint, farPoint, wallU, camera, ray, hit);
+
+	if (success)
+	{
+		const Double3 edgeTopPoint(
+			hit.point.x,
+			voxelYReal + voxelHeight + edgeData.yOffset,
+			hit.point.y);
+
+		const Double3 edgeBottomPoint(
+			hit.point.x,
+			voxelYReal + edgeData.yOffset,
+			hit.point.y);
+
+		const HeightProjector edgeProjector(hit.point, camera, frame.heightReal);
+		const double edgeTopScreenY = edgeProjector.getScreenY(edgeTopPoint.y);
+		const double edgeBottomScreenY = edgeProjector.getScreenY(edgeBottomPoint.y);
+
+		const int edgeStart = SoftwareRenderer::getLowerBoundedPixel(
+			edgeTopScreenY, frame.height);
+		const int edgeEnd = SoftwareRenderer::getUpperBoundedPixel(
+			edgeBottomScreenY, frame.height);
+
+		SoftwareRenderer::drawTransparentPixels(x, edgeStart, edgeEnd, edgeTopScreenY,
+			edgeBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
+			hit.normal, textures.at(edgeData.id), nullptr, shadingInfo, occlusion, frame);
+	}
 }
 
-void SoftwareRenderer::drawPixels(int x, int yStart, int yEnd, double projectedYStart,
-	double projectedYEnd, double depth, double u, double vStart, double vEnd,
-	const Double3 &normal, const VoxelTexture &texture, const ShadingInfo &shadingInfo,
-	OcclusionData &occlusion, const FrameView &frame)
+template <>
+void SoftwareRenderer::drawVoxelBelow<VoxelDataType::Chasm>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
 {
-	// Horizontal offset in texture.
-	const int textureX = static_cast<int>(u * static_cast<double>(VoxelTexture::WIDTH));
-
-	// Linearly interpolated fog.
-	const Double3 &fogColor = shadingInfo.horizonSkyColor;
-	const double fogPercent = std::min(depth / shadingInfo.fogDistance, 1.0);
+	const double voxelYReal = static_cast<double>(voxelY);
 
-	// Contribution from the sun.
-	const double lightNormalDot = std::max(0.0, shadingInfo.sunDirection.dot(normal));
-	const Double3 sunComponent = (shadingInfo.sunColor * lightNormalDot).clamped(
-		0.0, 1.0 - shadingInfo.ambient);
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
 
-	// Shading on the texture.
-	// - To do: contribution from lights.
-	const Double3 shading(
-		shadingInfo.ambient + sunComponent.x,
-		shadingInfo.ambient + sunComponent.y,
-		shadingInfo.ambient + sunComponent.z);
+	// Render front and back-faces.
+	const VoxelData::ChasmData &chasmData = voxelData.chasm;
+	const uint8_t *cycledIndices = shadingInfo.getCycledIndices(chasmData);
 
-	// Clip the Y start and end coordinates as needed, and refresh the occlusion buffer.
-	occlusion.clipRange(&yStart, &yEnd);
-	occlusion.update(yStart, yEnd);
+	// Find which faces on the chasm were intersected.
+	const VoxelData::Facing nearFacing = facing;
+	const VoxelData::Facing farFacing = SoftwareRenderer::getChasmFarFacing(
+		voxelX, voxelZ, nearFacing, camera, ray);
 
-	// Draw the column to the output buffer.
-	for (int y = yStart; y < yEnd; y++)
+	// Near.
+	if (chasmData.faceIsVisible(nearFacing))
 	{
-		const int index = x + (y * frame.width);
+		const double nearU = Constants::JustBelowOne - wallU;
+		const Double3 nearNormal = wallNormal;
+
+		const Double3 nearCeilingPoint(
+			nearPoint.x,
+			voxelYReal + voxelHeight,
+			nearPoint.y);
+		const Double3 nearFloorPoint(
+			nearPoint.x,
+			voxelYReal,
+			nearPoint.y);
+
+		const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+		const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+
+		const int nearStart = SoftwareRenderer::getLowerBoundedPixel(
+			nearCeilingScreenY, frame.height);
+		const int nearEnd = SoftwareRenderer::getUpperBoundedPixel(
+			nearFloorScreenY, frame.height);
+
+		SoftwareRenderer::drawTransparentPixels(x, nearStart, nearEnd, nearCeilingScreenY,
+			nearFloorScreenY, nearZ, nearU, 0.0, Constants::JustBelowOne, nearNormal,
+			textures.at(chasmData.id), cycledIndices, shadingInfo, occlusion, frame);
+	}
 
-		// Check depth of the pixel before rendering.
-		// - To do: implement occlusion culling and back-to-front transparent rendering so
-		//   this depth check isn't needed.
-		if (depth <= (frame.depthBuffer[index] - Constants::Epsilon))
+	// Far.
+	if (chasmData.faceIsVisible(farFacing))
+	{
+		const double farU = [&farPoint, farFacing]()
 		{
-			// Percent stepped from beginning to end on the column.
-			const double yPercent = 
-				((static_cast<double>(y) + 0.50) - projectedYStart) /
-				(projectedYEnd - projectedYStart);
-
-			// Vertical texture coordinate.
-			const double v = vStart + ((vEnd - vStart) * yPercent);
-
-			// Y position in texture.
-			const int textureY = static_cast<int>(v * static_cast<double>(VoxelTexture::HEIGHT));
+			const double uVal = [&farPoint, farFacing]()
+			{
+				if (farFacing == VoxelData::Facing::PositiveX)
+				{
+					return farPoint.y - std::floor(farPoint.y);
+				}
+				else if (farFacing == VoxelData::Facing::NegativeX)
+				{
+					return Constants::JustBelowOne - (farPoint.y - std::floor(farPoint.y));
+				}
+				else if (farFacing == VoxelData::Facing::PositiveZ)
+				{
+					return Constants::JustBelowOne - (farPoint.x - std::floor(farPoint.x));
+				}
+				else
+				{
+					return farPoint.x - std::floor(farPoint.x);
+				}
+			}();
 
-			// Alpha is ignored in this loop, so transparent texels will appear black.
-			const int textureIndex = textureX + (textureY * VoxelTexture::WIDTH);
-			const VoxelTexel &texel = texture.texels[textureIndex];
+			return std::max(std::min(uVal, Constants::JustBelowOne), 0.0);
+		}();
 
-			// Texture color with shading.
-			const double shadingMax = 1.0;
-			double colorR = texel.r * std::min(shading.x + texel.emission, shadingMax);
-			double colorG = texel.g * std::min(shading.y + texel.emission, shadingMax);
-			double colorB = texel.b * std::min(shading.z + texel.emission, shadingMax);
+		const Double3 farNormal = -SoftwareRenderer::getNormal(farFacing);
 
-			// Linearly interpolate with fog.
-			colorR += (fogColor.x - colorR) * fogPercent;
-			colorG += (fogColor.y - colorG) * fogPercent;
-			colorB += (fogColor.z - colorB) * fogPercent;
+		const Double3 farCeilingPoint(
+			farPoint.x,
+			voxelYReal + voxelHeight,
+			farPoint.y);
+		const Double3 farFloorPoint(
+			farPoint.x,
+			voxelYReal,
+			farPoint.y);
 
-			// Clamp maximum (don't worry about negative values).
-			const double high = 1.0;
-			colorR = (colorR > high) ? high : colorR;
-			colorG = (colorG > high) ? high : colorG;
-			colorB = (colorB > high) ? high : colorB;
+		const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+		const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
 
-			// Convert floats to integers.
-			const uint32_t colorRGB = static_cast<uint32_t>(
-				((static_cast<uint8_t>(colorR * 255.0)) << 16) |
-				((static_cast<uint8_t>(colorG * 255.0)) << 8) |
-				((static_cast<uint8_t>(colorB * 255.0))));
+		const int farStart = SoftwareRenderer::getLowerBoundedPixel(
+			farCeilingScreenY, frame.height);
+		const int farEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farFloorScreenY, frame.height);
 
-			frame.colorBuffer[index] = colorRGB;
-			frame.depthBuffer[index] = depth;
-		}
+		SoftwareRenderer::drawTransparentPixels(x, farStart, farEnd, farCeilingScreenY,
+			farFloorScreenY, farZ, farU, 0.0, Constants::JustBelowOne, farNormal, 
+			textures.at(chasmData.id), cycledIndices, shadingInfo, occlusion, frame);
 	}
 }
 
-void SoftwareRenderer::drawPerspectivePixels(int x, int yStart, int yEnd, double projectedYStart,
-	double projectedYEnd, const Double2 &startPoint, const Double2 &endPoint, double depthStart,
-	double depthEnd, const Double3 &normal, const VoxelTexture &texture,
-	const ShadingInfo &shadingInfo, OcclusionData &occlusion, const FrameView &frame)
+template <>
+void SoftwareRenderer::drawVoxelBelow<VoxelDataType::Door>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
 {
-	// Fog color to interpolate with.
-	const Double3 &fogColor = shadingInfo.horizonSkyColor;
+	const double voxelYReal = static_cast<double>(voxelY);
 
-	// Contribution from the sun.
-	const double lightNormalDot = std::max(0.0, shadingInfo.sunDirection.dot(normal));
-	const Double3 sunComponent = (shadingInfo.sunColor * lightNormalDot).clamped(
-		0.0, 1.0 - shadingInfo.ambient);
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
 
-	// Shading on the texture.
-	// - To do: contribution from lights.
-	const Double3 shading(
-		shadingInfo.ambient + sunComponent.x,
-		shadingInfo.ambient + sunComponent.y,
-		shadingInfo.ambient + sunComponent.z);
+	const VoxelData::DoorData &doorData = voxelData.door;
+	const double openPercent = shadingInfo.getDoorOpenPercent(voxelX, voxelY, voxelZ);
+	SoftwareRenderer::drawDoor(x, doorData.type, openPercent, voxelYReal, voxelHeight,
+		nearPoint, farPoint, nearZ, wallU, wallNormal, camera, textures.at(doorData.id),
+		shadingInfo, occlusion, frame);
+}
 
-	// Values for perspective-correct interpolation.
-	const double depthStartRecip = 1.0 / depthStart;
-	const double depthEndRecip = 1.0 / depthEnd;
-	const Double2 startPointDiv = startPoint * depthStartRecip;
-	const Double2 endPointDiv = endPoint * depthEndRecip;
-	const Double2 pointDivDiff = endPointDiv - startPointDiv;
+template <>
+void SoftwareRenderer::drawVoxelAbove<VoxelDataType::Wall>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	const VoxelData::WallData &wallData = voxelData.wall;
+
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		voxelYReal + voxelHeight,
+		nearPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		voxelYReal,
+		nearPoint.y);
+	const Double3 farFloorPoint(
+		farPoint.x,
+		nearFloorPoint.y,
+		farPoint.y);
+
+	const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+	const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+	const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+
+	const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
+		nearCeilingScreenY, frame.height);
+	const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearFloorScreenY, frame.height);
+	const int floorStart = wallEnd;
+	const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+		farFloorScreenY, frame.height);
 	
-	// Clip the Y start and end coordinates as needed, and refresh the occlusion buffer.
-	occlusion.clipRange(&yStart, &yEnd);
-	occlusion.update(yStart, yEnd);
+	// Side.
+	SoftwareRenderer::drawPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+		nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
+		textures.at(wallData.sideID), shadingInfo, occlusion, frame);
+
+	// Floor.
+	SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
+		nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
+		farZ, -Double3::UnitY, textures.at(wallData.floorID),
+		shadingInfo, occlusion, frame);
+}
 
-	// Draw the column to the output buffer.
-	for (int y = yStart; y < yEnd; y++)
-	{
-		const int index = x + (y * frame.width);
+template <>
+void SoftwareRenderer::drawVoxelAbove<VoxelDataType::Ceiling>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	// Draw bottom of ceiling voxel.
+	const VoxelData::CeilingData &ceilingData = voxelData.ceiling;
+
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		1.0 + ceilingHeight,
+		nearPoint.y);
+	const Double3 farFloorPoint(
+		farPoint.x,
+		nearFloorPoint.y,
+		farPoint.y);
+
+	const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+	const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+
+	const int floorStart = SoftwareRenderer::getLowerBoundedPixel(
+		nearFloorScreenY, frame.height);
+	const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+		farFloorScreenY, frame.height);
+
+	SoftwareRenderer::drawPlanePixels(x, floorStart, floorEnd,
+		nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
+		farZ, nearFloorPoint.y, -Double3::UnitY, ceilingData.id, textures,
+		shadingInfo, occlusion, frame);
+}
 
-		// Percent stepped from beginning to end on the column.
-		const double yPercent = 
-			((static_cast<double>(y) + 0.50) - projectedYStart) /
-			(projectedYEnd - projectedYStart);
+template <>
+void SoftwareRenderer::drawVoxelAbove<VoxelDataType::Raised>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
 
-		// Interpolate between the near and far depth.
-		const double depth = 1.0 / 
-			(depthStartRecip + ((depthEndRecip - depthStartRecip) * yPercent));
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
 
-		// Check depth of the pixel before rendering.
-		// - To do: implement occlusion culling and back-to-front transparent rendering so
-		//   this depth check isn't needed.
-		if (depth <= frame.depthBuffer[index])
-		{
-			// Linearly interpolated fog.
-			const double fogPercent = std::min(depth / shadingInfo.fogDistance, 1.0);
+	const VoxelData::RaisedData &raisedData = voxelData.raised;
 
-			// Interpolate between start and end points.
-			const double currentPointX = (startPointDiv.x + (pointDivDiff.x * yPercent)) * depth;
-			const double currentPointY = (startPointDiv.y + (pointDivDiff.y * yPercent)) * depth;
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		voxelYReal + ((raisedData.yOffset + raisedData.ySize) * voxelHeight),
+		nearPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		voxelYReal + (raisedData.yOffset * voxelHeight),
+		nearPoint.y);
 
-			// Texture coordinates.
-			const double u = std::max(std::min(Constants::JustBelowOne,
-				Constants::JustBelowOne - (currentPointX - std::floor(currentPointX))), 0.0);
-			const double v = std::max(std::min(Constants::JustBelowOne,
-				Constants::JustBelowOne - (currentPointY - std::floor(currentPointY))), 0.0);
+	const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+	const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
 
-			// Offsets in texture.
-			const int textureX = static_cast<int>(u * static_cast<double>(VoxelTexture::WIDTH));
-			const int textureY = static_cast<int>(v * static_cast<double>(VoxelTexture::HEIGHT));
+	const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
+		nearCeilingScreenY, frame.height);
+	const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearFloorScreenY, frame.height);
+
+	// Draw order depends on the player's Y position relative to the platform.
+	if (camera.eye.y > nearCeilingPoint.y)
+	{
+		// Above platform.
+		const Double3 farCeilingPoint(
+			farPoint.x,
+			nearCeilingPoint.y,
+			farPoint.y);
+
+		const double farCeilingScreenY = farProjector.getScreenY(farCeilingPoint.y);
+
+		const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
+			farCeilingScreenY, frame.height);
+		const int ceilingEnd = wallStart;
+
+		// Ceiling.
+		SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
+			farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
+			nearZ, Double3::UnitY, textures.at(raisedData.ceilingID),
+			shadingInfo, occlusion, frame);
+
+		// Side.
+		SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+			nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
+			wallNormal, textures.at(raisedData.sideID), nullptr, shadingInfo, 
+			occlusion, frame);
+	}
+	else if (camera.eye.y < nearFloorPoint.y)
+	{
+		// Below platform.
+		const Double3 farFloorPoint(
+			farPoint.x,
+			nearFloorPoint.y,
+			farPoint.y);
+
+		const double farFloorScreenY = farProjector.getScreenY(farFloorPoint.y);
+
+		const int floorStart = wallEnd;
+		const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
+			farFloorScreenY, frame.height);
+
+		// Side.
+		SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+			nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
+			wallNormal, textures.at(raisedData.sideID), nullptr, shadingInfo, occlusion, frame);
+
+		// Floor.
+		SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
+			nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
+			farZ, -Double3::UnitY, textures.at(raisedData.floorID),
+			shadingInfo, occlusion, frame);
+	}
+	else
+	{
+		// Between top and bottom.
+		SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+			nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
+			wallNormal, textures.at(raisedData.sideID), nullptr, shadingInfo,
+			occlusion, frame);
+	}
+}
+
+template <>
+void SoftwareRenderer::drawVoxelAbove<VoxelDataType::Diagonal>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
 
-			// Alpha is ignored in this loop, so transparent texels will appear black.
-			const int textureIndex = textureX + (textureY * VoxelTexture::WIDTH);
-			const VoxelTexel &texel = texture.texels[textureIndex];
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
 
-			// Texture color with shading.
-			const double shadingMax = 1.0;
-			double colorR = texel.r * std::min(shading.x + texel.emission, shadingMax);
-			double colorG = texel.g * std::min(shading.y + texel.emission, shadingMax);
-			double colorB = texel.b * std::min(shading.z + texel.emission, shadingMax);
+	const VoxelData::DiagonalData &diagData = voxelData.diagonal;
 
-			// Linearly interpolate with fog.
-			colorR += (fogColor.x - colorR) * fogPercent;
-			colorG += (fogColor.y - colorG) * fogPercent;
-			colorB += (fogColor.z - colorB) * fogPercent;
+	// Find intersection.
+	RayHit hit;
+	const bool success = diagData.type1 ?
+		SoftwareRenderer::findDiag1Intersection(voxelX, voxelZ, nearPoint, farPoint, hit) :
+		SoftwareRenderer::findDiag2Intersection(voxelX, voxelZ, nearPoint, farPoint, hit);
 
-			// Clamp maximum (don't worry about negative values).
-			const double high = 1.0;
-			colorR = (colorR > high) ? high : colorR;
-			colorG = (colorG > high) ? high : colorG;
-			colorB = (colorB > high) ? high : colorB;
+	if (success)
+	{
+		double diagTopScreenY, diagBottomScreenY;
+		int diagStart, diagEnd;
 
-			// Convert floats to integers.
-			const uint32_t colorRGB = static_cast<uint32_t>(
-				((static_cast<uint8_t>(colorR * 255.0)) << 16) |
-				((static_cast<uint8_t>(colorG * 255.0)) << 8) |
-				((static_cast<uint8_t>(colorB * 255.0))));
+		SoftwareRenderer::diagProjection(voxelYReal, voxelHeight, hit.point,
+			camera, frame.height, frame.heightReal,
+			diagTopScreenY, diagBottomScreenY, diagStart, diagEnd);
 
-			frame.colorBuffer[index] = colorRGB;
-			frame.depthBuffer[index] = depth;
-		}
+		SoftwareRenderer::drawPixels(x, diagStart, diagEnd, diagTopScreenY,
+			diagBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
+			hit.normal, textures.at(diagData.id), shadingInfo, occlusion, frame);
 	}
 }
 
-void SoftwareRenderer::drawTransparentPixels(int x, int yStart, int yEnd, double projectedYStart,
-	double projectedYEnd, double depth, double u, double vStart, double vEnd,
-	const Double3 &normal, const VoxelTexture &texture, const ShadingInfo &shadingInfo,
-	const OcclusionData &occlusion, const FrameView &frame)
+template <>
+void SoftwareRenderer::drawVoxelAbove<VoxelDataType::TransparentWall>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
 {
-	// Horizontal offset in texture.
-	const int textureX = static_cast<int>(u * static_cast<double>(VoxelTexture::WIDTH));
+	const double voxelYReal = static_cast<double>(voxelY);
+
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+
+	// Draw transparent side.
+	const VoxelData::TransparentWallData &transparentWallData = voxelData.transparentWall;
+
+	const Double3 nearCeilingPoint(
+		nearPoint.x,
+		voxelYReal + voxelHeight,
+		nearPoint.y);
+	const Double3 nearFloorPoint(
+		nearPoint.x,
+		voxelYReal,
+		nearPoint.y);
+
+	const double nearCeilingScreenY = nearProjector.getScreenY(nearCeilingPoint.y);
+	const double nearFloorScreenY = nearProjector.getScreenY(nearFloorPoint.y);
+
+	const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
+		nearCeilingScreenY, frame.height);
+	const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
+		nearFloorScreenY, frame.height);
+
+	SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
+		nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
+		textures.at(transparentWallData.id), nullptr, shadingInfo, occlusion, frame);
+}
 
-	// Linearly interpolated fog.
-	const Double3 &fogColor = shadingInfo.horizonSkyColor;
-	const double fogPercent = std::min(depth / shadingInfo.fogDistance, 1.0);
+template <>
+void SoftwareRenderer::drawVoxelAbove<VoxelDataType::Edge>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
 
-	// Contribution from the sun.
-	const double lightNormalDot = std::max(0.0, shadingInfo.sunDirection.dot(normal));
-	const Double3 sunComponent = (shadingInfo.sunColor * lightNormalDot).clamped(
-		0.0, 1.0 - shadingInfo.ambient);
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
 
-	// Shading on the texture.
-	// - To do: contribution from lights.
-	const Double3 shading(
-		shadingInfo.ambient + sunComponent.x,
-		shadingInfo.ambient + sunComponent.y,
-		shadingInfo.ambient + sunComponent.z);
+	const VoxelData::EdgeData &edgeData = voxelData.edge;
 
-	// Clip the Y start and end coordinates as needed, but do not refresh the occlusion buffer,
-	// because transparent ranges do not occlude as simply as opaque ranges.
-	occlusion.clipRange(&yStart, &yEnd);
+	// Find intersection.
+	RayHit hit;
+	const bool success = SoftwareRenderer::findEdgeIntersection(voxelX, voxelZ,
+		edgeData.facing, facing, nearPoint, farPoint, wallU, camera, ray, hit);
 
-	// Draw the column to the output buffer.
-	for (int y = yStart; y < yEnd; y++)
+	if (success)
 	{
-		const int index = x + (y * frame.width);
-
-		// Check depth of the pixel before rendering.
-		if (depth <= (frame.depthBuffer[index] - Constants::Epsilon))
-		{
-			// Percent stepped from beginning to end on the column.
-			const double yPercent =
-				((static_cast<double>(y) + 0.50) - projectedYStart) /
-				(projectedYEnd - projectedYStart);
+		const Double3 edgeTopPoint(
+			hit.point.x,
+			voxelYReal + voxelHeight + edgeData.yOffset,
+			hit.point.y);
+
+		const Double3 edgeBottomPoint(
+			hit.point.x,
+			voxelYReal + edgeData.yOffset,
+			hit.point.y);
+
+		const HeightProjector edgeProjector(hit.point, camera, frame.heightReal);
+		const double edgeTopScreenY = edgeProjector.getScreenY(edgeTopPoint.y);
+		const double edgeBottomScreenY = edgeProjector.getScreenY(edgeBottomPoint.y);
+
+		const int edgeStart = SoftwareRenderer::getLowerBoundedPixel(
+			edgeTopScreenY, frame.height);
+		const int edgeEnd = SoftwareRenderer::getUpperBoundedPixel(
+			edgeBottomScreenY, frame.height);
+
+		SoftwareRenderer::drawTransparentPixels(x, edgeStart, edgeEnd, edgeTopScreenY,
+			edgeBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
+			hit.normal, textures.at(edgeData.id), nullptr, shadingInfo, occlusion, frame);
+	}
+}
 
-			// Vertical texture coordinate.
-			const double v = vStart + ((vEnd - vStart) * yPercent);
+template <>
+void SoftwareRenderer::drawVoxelAbove<VoxelDataType::Door>(int x, int voxelX, int voxelY,
+	int voxelZ, const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+	VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+	const Double2 &farPoint, const HeightProjector &nearProjector,
+	const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
+{
+	const double voxelYReal = static_cast<double>(voxelY);
 
-			// Y position in texture.
-			const int textureY = static_cast<int>(v * static_cast<double>(VoxelTexture::HEIGHT));
+	// Height of the voxel depends on whether it's the main floor.
+	const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
 
-			// Alpha is checked in this loop, and transparent texels are not drawn.
-			const int textureIndex = textureX + (textureY * VoxelTexture::WIDTH);
-			const VoxelTexel &texel = texture.texels[textureIndex];
-			
-			if (texel.a > 0.0)
-			{
-				// Texture color with shading.
-				const double shadingMax = 1.0;
-				double colorR = texel.r * std::min(shading.x + texel.emission, shadingMax);
-				double colorG = texel.g * std::min(shading.y + texel.emission, shadingMax);
-				double colorB = texel.b * std::min(shading.z + texel.emission, shadingMax);
-
-				// Linearly interpolate with fog.
-				colorR += (fogColor.x - colorR) * fogPercent;
-				colorG += (fogColor.y - colorG) * fogPercent;
-				colorB += (fogColor.z - colorB) * fogPercent;
-				
-				// Clamp maximum (don't worry about negative values).
-				const double high = 1.0;
-				colorR = (colorR > high) ? high : colorR;
-				colorG = (colorG > high) ? high : colorG;
-				colorB = (colorB > high) ? high : colorB;
-
-				// Convert floats to integers.
-				const uint32_t colorRGB = static_cast<uint32_t>(
-					((static_cast<uint8_t>(colorR * 255.0)) << 16) |
-					((static_cast<uint8_t>(colorG * 255.0)) << 8) |
-					((static_cast<uint8_t>(colorB * 255.0))));
-
-				frame.colorBuffer[index] = colorRGB;
-				frame.depthBuffer[index] = depth;
-			}
-		}
-	}
+	const VoxelData::DoorData &doorData = voxelData.door;
+	const double openPercent = shadingInfo.getDoorOpenPercent(voxelX, voxelY, voxelZ);
+	SoftwareRenderer::drawDoor(x, doorData.type, openPercent, voxelYReal, voxelHeight,
+		nearPoint, farPoint, nearZ, wallU, wallNormal, camera, textures.at(doorData.id),
+		shadingInfo, occlusion, frame);
 }
 
+// Per-type voxel drawers, in the same order as VoxelDataType.
+const SoftwareRenderer::VoxelDrawTable SoftwareRenderer::INITIAL_VOXEL_DRAWERS =
+{
+	&SoftwareRenderer::drawInitialVoxel<VoxelDataType::None>,
+	&SoftwareRenderer::drawInitialVoxel<VoxelDataType::Wall>,
+	&SoftwareRenderer::drawInitialVoxel<VoxelDataType::Floor>,
+	&SoftwareRenderer::drawInitialVoxel<VoxelDataType::Ceiling>,
+	&SoftwareRenderer::drawInitialVoxel<VoxelDataType::Raised>,
+	&SoftwareRenderer::drawInitialVoxel<VoxelDataType::Diagonal>,
+	&SoftwareRenderer::drawInitialVoxel<VoxelDataType::TransparentWall>,
+	&SoftwareRenderer::drawInitialVoxel<VoxelDataType::Edge>,
+	&SoftwareRenderer::drawInitialVoxel<VoxelDataType::Chasm>,
+	&SoftwareRenderer::drawInitialVoxel<VoxelDataType::Door>
+};
+
+const SoftwareRenderer::VoxelDrawTable SoftwareRenderer::INITIAL_VOXEL_BELOW_DRAWERS =
+{
+	&SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::None>,
+	&SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Wall>,
+	&SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Floor>,
+	&SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Ceiling>,
+	&SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Raised>,
+	&SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Diagonal>,
+	&SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::TransparentWall>,
+	&SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Edge>,
+	&SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Chasm>,
+	&SoftwareRenderer::drawInitialVoxelBelow<VoxelDataType::Door>
+};
+
+const SoftwareRenderer::VoxelDrawTable SoftwareRenderer::INITIAL_VOXEL_ABOVE_DRAWERS =
+{
+	&SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::None>,
+	&SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::Wall>,
+	&SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::Floor>,
+	&SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::Ceiling>,
+	&SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::Raised>,
+	&SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::Diagonal>,
+	&SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::TransparentWall>,
+	&SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::Edge>,
+	&SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::Chasm>,
+	&SoftwareRenderer::drawInitialVoxelAbove<VoxelDataType::Door>
+};
+
+const SoftwareRenderer::VoxelDrawTable SoftwareRenderer::VOXEL_DRAWERS =
+{
+	&SoftwareRenderer::drawVoxel<VoxelDataType::None>,
+	&SoftwareRenderer::drawVoxel<VoxelDataType::Wall>,
+	&SoftwareRenderer::drawVoxel<VoxelDataType::Floor>,
+	&SoftwareRenderer::drawVoxel<VoxelDataType::Ceiling>,
+	&SoftwareRenderer::drawVoxel<VoxelDataType::Raised>,
+	&SoftwareRenderer::drawVoxel<VoxelDataType::Diagonal>,
+	&SoftwareRenderer::drawVoxel<VoxelDataType::TransparentWall>,
+	&SoftwareRenderer::drawVoxel<VoxelDataType::Edge>,
+	&SoftwareRenderer::drawVoxel<VoxelDataType::Chasm>,
+	&SoftwareRenderer::drawVoxel<VoxelDataType::Door>
+};
+
+const SoftwareRenderer::VoxelDrawTable SoftwareRenderer::VOXEL_BELOW_DRAWERS =
+{
+	&SoftwareRenderer::drawVoxelBelow<VoxelDataType::None>,
+	&SoftwareRenderer::drawVoxelBelow<VoxelDataType::Wall>,
+	&SoftwareRenderer::drawVoxelBelow<VoxelDataType::Floor>,
+	&SoftwareRenderer::drawVoxelBelow<VoxelDataType::Ceiling>,
+	&SoftwareRenderer::drawVoxelBelow<VoxelDataType::Raised>,
+	&SoftwareRenderer::drawVoxelBelow<VoxelDataType::Diagonal>,
+	&SoftwareRenderer::drawVoxelBelow<VoxelDataType::TransparentWall>,
+	&SoftwareRenderer::drawVoxelBelow<VoxelDataType::Edge>,
+	&SoftwareRenderer::drawVoxelBelow<VoxelDataType::Chasm>,
+	&SoftwareRenderer::drawVoxelBelow<VoxelDataType::Door>
+};
+
+const SoftwareRenderer::VoxelDrawTable SoftwareRenderer::VOXEL_ABOVE_DRAWERS =
+{
+	&SoftwareRenderer::drawVoxelAbove<VoxelDataType::None>,
+	&SoftwareRenderer::drawVoxelAbove<VoxelDataType::Wall>,
+	&SoftwareRenderer::drawVoxelAbove<VoxelDataType::Floor>,
+	&SoftwareRenderer::drawVoxelAbove<VoxelDataType::Ceiling>,
+	&SoftwareRenderer::drawVoxelAbove<VoxelDataType::Raised>,
+	&SoftwareRenderer::drawVoxelAbove<VoxelDataType::Diagonal>,
+	&SoftwareRenderer::drawVoxelAbove<VoxelDataType::TransparentWall>,
+	&SoftwareRenderer::drawVoxelAbove<VoxelDataType::Edge>,
+	&SoftwareRenderer::drawVoxelAbove<VoxelDataType::Chasm>,
+	&SoftwareRenderer::drawVoxelAbove<VoxelDataType::Door>
+};
+
 void SoftwareRenderer::drawInitialVoxelColumn(int x, int voxelX, int voxelZ, const Camera &camera,
 	const Ray &ray, VoxelData::Facing facing, const Double2 &nearPoint, const Double2 &farPoint,
 	double nearZ, double farZ, const ShadingInfo &shadingInfo, double ceilingHeight,
-	const VoxelGrid &voxelGrid, const VoxelTextureArray &textures, OcclusionData &occlusion,
-	const FrameView &frame)
+	const VoxelGrid &voxelGrid, const uint8_t *voxelDataTypes, const VoxelTextureArray &textures,
+	OcclusionData &occlusion, const FrameView &frame)
 {
 	// This method handles some special cases such as drawing the back-faces of wall sides.
 
@@ -1806,935 +6805,61 @@ void SoftwareRenderer::drawInitialVoxelColumn(int x, int voxelX, int voxelZ, con
 	// this voxel column.
 	const Double3 wallNormal = -SoftwareRenderer::getNormal(facing);
 
-	auto drawInitialVoxel = [x, voxelX, voxelZ, &camera, &ray, &wallNormal, &nearPoint,
-		&farPoint, nearZ, farZ, wallU, &shadingInfo, ceilingHeight, &voxelGrid,
-		&textures, &occlusion, &frame]()
-	{
-		const int voxelY = camera.eyeVoxel.y;
-		const uint16_t voxelID = voxelGrid.getVoxels()[voxelX + (voxelY * voxelGrid.getWidth()) +
-			(voxelZ * voxelGrid.getWidth() * voxelGrid.getHeight())];
-		const VoxelData &voxelData = voxelGrid.getVoxelData(voxelID);
-
-		// Height of the voxel depends on whether it's the main floor.
-		const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
-
-		if (voxelData.dataType == VoxelDataType::Wall)
-		{
-			// Draw inner ceiling, wall, and floor.
-			const VoxelData::WallData &wallData = voxelData.wall;
-
-			const Double3 farCeilingPoint(
-				farPoint.x,
-				camera.eyeVoxelReal.y + voxelHeight,
-				farPoint.y);
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				farCeilingPoint.y,
-				nearPoint.y);
-			const Double3 farFloorPoint(
-				farPoint.x,
-				camera.eyeVoxelReal.y,
-				farPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				farFloorPoint.y,
-				nearPoint.y);
-
-			const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-				farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-				farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-			const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearCeilingScreenY, frame.height);
-			const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
-				farCeilingScreenY, frame.height);
-			const int wallStart = ceilingEnd;
-			const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-				farFloorScreenY, frame.height);
-			const int floorStart = wallEnd;
-			const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearFloorScreenY, frame.height);
-
-			// Ceiling.
-			SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-				nearCeilingScreenY, farCeilingScreenY, nearPoint, farPoint, nearZ,
-				farZ, -Double3::UnitY, textures.at(wallData.ceilingID), shadingInfo,
-				occlusion, frame);
-
-			// Side.
-			SoftwareRenderer::drawPixels(x, wallStart, wallEnd, farCeilingScreenY,
-				farFloorScreenY, farZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
-				textures.at(wallData.sideID), shadingInfo, occlusion, frame);
-
-			// Floor.
-			SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-				farFloorScreenY, nearFloorScreenY, farPoint, nearPoint, farZ,
-				nearZ, Double3::UnitY, textures.at(wallData.floorID), shadingInfo,
-				occlusion, frame);
-		}
-		else if (voxelData.dataType == VoxelDataType::Floor)
-		{
-			// Do nothing. Floors can only be seen from above.
-		}
-		else if (voxelData.dataType == VoxelDataType::Ceiling)
-		{
-			// Do nothing. Ceilings can only be seen from below.
-		}
-		else if (voxelData.dataType == VoxelDataType::Raised)
-		{
-			const VoxelData::RaisedData &raisedData = voxelData.raised;
-
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				camera.eyeVoxelReal.y + ((raisedData.yOffset + raisedData.ySize) * voxelHeight),
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				camera.eyeVoxelReal.y + (raisedData.yOffset * voxelHeight),
-				nearPoint.y);
-
-			// Draw order depends on the player's Y position relative to the platform.
-			if (camera.eye.y > nearCeilingPoint.y)
-			{
-				// Above platform.
-				const Double3 farCeilingPoint(
-					farPoint.x,
-					nearCeilingPoint.y,
-					farPoint.y);
-
-				const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-					farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-					nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-					farCeilingScreenY, frame.height);
-				const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
-					nearCeilingScreenY, frame.height);
-
-				// Ceiling.
-				SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-					farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
-					nearZ, Double3::UnitY, textures.at(raisedData.ceilingID),
-					shadingInfo, occlusion, frame);
-			}
-			else if (camera.eye.y < nearFloorPoint.y)
-			{
-				// Below platform.
-				const Double3 farFloorPoint(
-					farPoint.x,
-					nearFloorPoint.y,
-					farPoint.y);
-
-				const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-					nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-					farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int floorStart = SoftwareRenderer::getLowerBoundedPixel(
-					nearFloorScreenY, frame.height);
-				const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farFloorScreenY, frame.height);
-
-				// Floor.
-				SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-					nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
-					farZ, -Double3::UnitY, textures.at(raisedData.floorID),
-					shadingInfo, occlusion, frame);
-			}
-			else
-			{
-				// Between top and bottom.
-				const Double3 farCeilingPoint(
-					farPoint.x,
-					nearCeilingPoint.y,
-					farPoint.y);
-				const Double3 farFloorPoint(
-					farPoint.x,
-					nearFloorPoint.y,
-					farPoint.y);
-
-				const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-					farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-					nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-					farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-					nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-					nearCeilingScreenY, frame.height);
-				const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farCeilingScreenY, frame.height);
-				const int wallStart = ceilingEnd;
-				const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farFloorScreenY, frame.height);
-				const int floorStart = wallEnd;
-				const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-					nearFloorScreenY, frame.height);
-
-				// Ceiling.
-				SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-					nearCeilingScreenY, farCeilingScreenY, nearPoint, farPoint, nearZ,
-					farZ, -Double3::UnitY, textures.at(raisedData.ceilingID),
-					shadingInfo, occlusion, frame);
-
-				// Side.
-				SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, farCeilingScreenY,
-					farFloorScreenY, farZ, wallU, raisedData.vTop, raisedData.vBottom,
-					wallNormal, textures.at(raisedData.sideID), shadingInfo, occlusion, frame);
-
-				// Floor.
-				SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-					farFloorScreenY, nearFloorScreenY, farPoint, nearPoint, farZ,
-					nearZ, Double3::UnitY, textures.at(raisedData.floorID),
-					shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::Diagonal)
-		{
-			const VoxelData::DiagonalData &diagData = voxelData.diagonal;
-
-			// Find intersection.
-			RayHit hit;
-			const bool success = diagData.type1 ?
-				SoftwareRenderer::findDiag1Intersection(voxelX, voxelZ, nearPoint, farPoint, hit) :
-				SoftwareRenderer::findDiag2Intersection(voxelX, voxelZ, nearPoint, farPoint, hit);
-
-			if (success)
-			{
-				double diagTopScreenY, diagBottomScreenY;
-				int diagStart, diagEnd;
-
-				SoftwareRenderer::diagProjection(camera.eyeVoxelReal.y, voxelHeight, hit.point,
-					camera.transform, camera.yShear, frame.height, frame.heightReal,
-					diagTopScreenY, diagBottomScreenY, diagStart, diagEnd);
-
-				SoftwareRenderer::drawPixels(x, diagStart, diagEnd, diagTopScreenY,
-					diagBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
-					hit.normal, textures.at(diagData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::TransparentWall)
-		{
-			// Do nothing. Transparent walls have no back-faces.
-		}
-		else if (voxelData.dataType == VoxelDataType::Edge)
-		{
-			const VoxelData::EdgeData &edgeData = voxelData.edge;
-
-			// Find intersection.
-			RayHit hit;
-			const bool success = SoftwareRenderer::findInitialEdgeIntersection(
-				voxelX, voxelZ, edgeData.facing, nearPoint, farPoint, camera, ray, hit);
-
-			if (success)
-			{
-				const Double3 edgeTopPoint(
-					hit.point.x,
-					camera.eyeVoxelReal.y + voxelHeight + edgeData.yOffset,
-					hit.point.y);
-
-				const Double3 edgeBottomPoint(
-					hit.point.x,
-					camera.eyeVoxelReal.y + edgeData.yOffset,
-					hit.point.y);
-
-				const double edgeTopScreenY = SoftwareRenderer::getProjectedY(
-					edgeTopPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double edgeBottomScreenY = SoftwareRenderer::getProjectedY(
-					edgeBottomPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int edgeStart = SoftwareRenderer::getLowerBoundedPixel(
-					edgeTopScreenY, frame.height);
-				const int edgeEnd = SoftwareRenderer::getUpperBoundedPixel(
-					edgeBottomScreenY, frame.height);
-
-				SoftwareRenderer::drawTransparentPixels(x, edgeStart, edgeEnd, edgeTopScreenY,
-					edgeBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
-					hit.normal, textures.at(edgeData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::Chasm)
-		{
-			// Render back-face.
-			const VoxelData::ChasmData &chasmData = voxelData.chasm;
-
-			// Find which far face on the chasm was intersected.
-			const VoxelData::Facing farFacing = SoftwareRenderer::getInitialChasmFarFacing(
-				voxelX, voxelZ, Double2(camera.eye.x, camera.eye.z), ray);
-
-			// Far.
-			if (chasmData.faceIsVisible(farFacing))
-			{
-				const double farU = [&farPoint, farFacing]()
-				{
-					const double uVal = [&farPoint, farFacing]()
-					{
-						if (farFacing == VoxelData::Facing::PositiveX)
-						{
-							return farPoint.y - std::floor(farPoint.y);
-						}
-						else if (farFacing == VoxelData::Facing::NegativeX)
-						{
-							return Constants::JustBelowOne - (farPoint.y - std::floor(farPoint.y));
-						}
-						else if (farFacing == VoxelData::Facing::PositiveZ)
-						{
-							return Constants::JustBelowOne - (farPoint.x - std::floor(farPoint.x));
-						}
-						else
-						{
-							return farPoint.x - std::floor(farPoint.x);
-						}
-					}();
-
-					return std::max(std::min(uVal, Constants::JustBelowOne), 0.0);
-				}();
+	// Voxel IDs in this column, from the bottom up.
+	const uint16_t *column = voxelGrid.getColumn(voxelX, voxelZ);
+	const int columnStride = voxelGrid.getColumnStride();
 
-				const Double3 farNormal = -SoftwareRenderer::getNormal(farFacing);
-
-				const Double3 farCeilingPoint(
-					farPoint.x,
-					camera.eyeVoxelReal.y + voxelHeight,
-					farPoint.y);
-				const Double3 farFloorPoint(
-					farPoint.x,
-					camera.eyeVoxelReal.y,
-					farPoint.y);
-
-				const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-					farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-					farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int farStart = SoftwareRenderer::getLowerBoundedPixel(
-					farCeilingScreenY, frame.height);
-				const int farEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farFloorScreenY, frame.height);
-
-				SoftwareRenderer::drawTransparentPixels(x, farStart, farEnd, farCeilingScreenY,
-					farFloorScreenY, farZ, farU, 0.0, Constants::JustBelowOne, farNormal,
-					textures.at(chasmData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::Door)
-		{
-			// To do: find intersection via SoftwareRenderer::findDoorIntersection().
-			// Render nothing for now.
-		}
-	};
+	// Screen Y of the near and far points at any height, shared by every voxel drawn.
+	const HeightProjector nearProjector(nearPoint, camera, frame.heightReal);
+	const HeightProjector farProjector(farPoint, camera, frame.heightReal);
 
-	auto drawInitialVoxelBelow = [x, voxelX, voxelZ, &camera, &ray, &wallNormal, &nearPoint,
-		&farPoint, nearZ, farZ, wallU, &shadingInfo, ceilingHeight, &voxelGrid,
-		&textures, &occlusion, &frame](int voxelY)
+	auto drawVoxelWith = [x, voxelX, voxelZ, &camera, &ray, facing, &wallNormal, &nearPoint,
+		&farPoint, &nearProjector, &farProjector, nearZ, farZ, wallU, &shadingInfo,
+		ceilingHeight, &voxelGrid, &textures, &occlusion, &frame, column, columnStride,
+		voxelDataTypes](const VoxelDrawTable &drawers, int voxelY)
 	{
-		const uint16_t voxelID = voxelGrid.getVoxels()[voxelX + (voxelY * voxelGrid.getWidth()) +
-			(voxelZ * voxelGrid.getWidth() * voxelGrid.getHeight())];
-		const VoxelData &voxelData = voxelGrid.getVoxelData(voxelID);
-		const double voxelYReal = static_cast<double>(voxelY);
-
-		// Height of the voxel depends on whether it's the main floor.
-		const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
-
-		if (voxelData.dataType == VoxelDataType::Wall)
-		{
-			const VoxelData::WallData &wallData = voxelData.wall;
-
-			const Double3 farCeilingPoint(
-				farPoint.x,
-				voxelYReal + voxelHeight,
-				farPoint.y);
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				farCeilingPoint.y,
-				nearPoint.y);
-
-			const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-				farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-			const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-				farCeilingScreenY, frame.height);
-			const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearCeilingScreenY, frame.height);
-
-			// Ceiling.
-			SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-				farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
-				nearZ, Double3::UnitY, textures.at(wallData.ceilingID),
-				shadingInfo, occlusion, frame);
-		}
-		else if (voxelData.dataType == VoxelDataType::Floor)
-		{
-			// Draw top of floor voxel.
-			const VoxelData::FloorData &floorData = voxelData.floor;
-
-			const Double3 farCeilingPoint(
-				farPoint.x,
-				voxelYReal + voxelHeight,
-				farPoint.y);
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				farCeilingPoint.y,
-				nearPoint.y);
-
-			const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-				farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-			const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-				farCeilingScreenY, frame.height);
-			const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearCeilingScreenY, frame.height);
-
-			// Ceiling.
-			SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-				farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
-				nearZ, Double3::UnitY, textures.at(floorData.id), shadingInfo,
-				occlusion, frame);
-		}
-		else if (voxelData.dataType == VoxelDataType::Ceiling)
-		{
-			// Do nothing. Ceilings can only be seen from below.
-		}
-		else if (voxelData.dataType == VoxelDataType::Raised)
-		{
-			const VoxelData::RaisedData &raisedData = voxelData.raised;
-
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				voxelYReal + ((raisedData.yOffset + raisedData.ySize) * voxelHeight),
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				voxelYReal + (raisedData.yOffset * voxelHeight),
-				nearPoint.y);
-
-			// Draw order depends on the player's Y position relative to the platform.
-			if (camera.eye.y > nearCeilingPoint.y)
-			{
-				// Above platform.
-				const Double3 farCeilingPoint(
-					farPoint.x,
-					nearCeilingPoint.y,
-					farPoint.y);
-
-				const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-					farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-					nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-					farCeilingScreenY, frame.height);
-				const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
-					nearCeilingScreenY, frame.height);
-
-				// Ceiling.
-				SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-					farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
-					nearZ, Double3::UnitY, textures.at(raisedData.ceilingID),
-					shadingInfo, occlusion, frame);
-			}
-			else if (camera.eye.y < nearFloorPoint.y)
-			{
-				// Below platform.
-				const Double3 farFloorPoint(
-					farPoint.x,
-					nearFloorPoint.y,
-					farPoint.y);
-
-				const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-					nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-					farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int floorStart = SoftwareRenderer::getLowerBoundedPixel(
-					nearFloorScreenY, frame.height);
-				const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farFloorScreenY, frame.height);
-
-				// Floor.
-				SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-					nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
-					farZ, -Double3::UnitY, textures.at(raisedData.floorID),
-					shadingInfo, occlusion, frame);
-			}
-			else
-			{
-				// Between top and bottom.
-				const Double3 farCeilingPoint(
-					farPoint.x,
-					nearCeilingPoint.y,
-					farPoint.y);
-				const Double3 farFloorPoint(
-					farPoint.x,
-					nearFloorPoint.y,
-					farPoint.y);
-
-				const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-					farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-					nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-					farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-					nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-					nearCeilingScreenY, frame.height);
-				const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farCeilingScreenY, frame.height);
-				const int wallStart = ceilingEnd;
-				const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farFloorScreenY, frame.height);
-				const int floorStart = wallEnd;
-				const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-					nearFloorScreenY, frame.height);
-
-				// Ceiling.
-				SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-					nearCeilingScreenY, farCeilingScreenY, nearPoint, farPoint, nearZ,
-					farZ, -Double3::UnitY, textures.at(raisedData.ceilingID),
-					shadingInfo, occlusion, frame);
-
-				// Side.
-				SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, farCeilingScreenY,
-					farFloorScreenY, farZ, wallU, raisedData.vTop, raisedData.vBottom,
-					wallNormal, textures.at(raisedData.sideID), shadingInfo, occlusion, frame);
-
-				// Floor.
-				SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-					farFloorScreenY, nearFloorScreenY, farPoint, nearPoint, farZ,
-					nearZ, Double3::UnitY, textures.at(raisedData.floorID),
-					shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::Diagonal)
-		{
-			const VoxelData::DiagonalData &diagData = voxelData.diagonal;
-
-			// Find intersection.
-			RayHit hit;
-			const bool success = diagData.type1 ?
-				SoftwareRenderer::findDiag1Intersection(voxelX, voxelZ, nearPoint, farPoint, hit) :
-				SoftwareRenderer::findDiag2Intersection(voxelX, voxelZ, nearPoint, farPoint, hit);
-
-			if (success)
-			{
-				double diagTopScreenY, diagBottomScreenY;
-				int diagStart, diagEnd;
-
-				SoftwareRenderer::diagProjection(voxelYReal, voxelHeight, hit.point,
-					camera.transform, camera.yShear, frame.height, frame.heightReal,
-					diagTopScreenY, diagBottomScreenY, diagStart, diagEnd);
-
-				SoftwareRenderer::drawPixels(x, diagStart, diagEnd, diagTopScreenY,
-					diagBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
-					hit.normal, textures.at(diagData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::TransparentWall)
-		{
-			// Do nothing. Transparent walls have no back-faces.
-		}
-		else if (voxelData.dataType == VoxelDataType::Edge)
-		{
-			const VoxelData::EdgeData &edgeData = voxelData.edge;
-
-			// Find intersection.
-			RayHit hit;
-			const bool success = SoftwareRenderer::findInitialEdgeIntersection(
-				voxelX, voxelZ, edgeData.facing, nearPoint, farPoint, camera, ray, hit);
-
-			if (success)
-			{
-				const Double3 edgeTopPoint(
-					hit.point.x,
-					voxelYReal + voxelHeight + edgeData.yOffset,
-					hit.point.y);
-
-				const Double3 edgeBottomPoint(
-					hit.point.x,
-					voxelYReal + edgeData.yOffset,
-					hit.point.y);
-
-				const double edgeTopScreenY = SoftwareRenderer::getProjectedY(
-					edgeTopPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double edgeBottomScreenY = SoftwareRenderer::getProjectedY(
-					edgeBottomPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int edgeStart = SoftwareRenderer::getLowerBoundedPixel(
-					edgeTopScreenY, frame.height);
-				const int edgeEnd = SoftwareRenderer::getUpperBoundedPixel(
-					edgeBottomScreenY, frame.height);
-
-				SoftwareRenderer::drawTransparentPixels(x, edgeStart, edgeEnd, edgeTopScreenY,
-					edgeBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
-					hit.normal, textures.at(edgeData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::Chasm)
-		{
-			// Render back-face.
-			const VoxelData::ChasmData &chasmData = voxelData.chasm;
-
-			// Find which far face on the chasm was intersected.
-			const VoxelData::Facing farFacing = SoftwareRenderer::getInitialChasmFarFacing(
-				voxelX, voxelZ, Double2(camera.eye.x, camera.eye.z), ray);
-
-			// Far.
-			if (chasmData.faceIsVisible(farFacing))
-			{
-				const double farU = [&farPoint, farFacing]()
-				{
-					const double uVal = [&farPoint, farFacing]()
-					{
-						if (farFacing == VoxelData::Facing::PositiveX)
-						{
-							return farPoint.y - std::floor(farPoint.y);
-						}
-						else if (farFacing == VoxelData::Facing::NegativeX)
-						{
-							return Constants::JustBelowOne - (farPoint.y - std::floor(farPoint.y));
-						}
-						else if (farFacing == VoxelData::Facing::PositiveZ)
-						{
-							return Constants::JustBelowOne - (farPoint.x - std::floor(farPoint.x));
-						}
-						else
-						{
-							return farPoint.x - std::floor(farPoint.x);
-						}
-					}();
-
-					return std::max(std::min(uVal, Constants::JustBelowOne), 0.0);
-				}();
-
-				const Double3 farNormal = -SoftwareRenderer::getNormal(farFacing);
-
-				const Double3 farCeilingPoint(
-					farPoint.x,
-					voxelYReal + voxelHeight,
-					farPoint.y);
-				const Double3 farFloorPoint(
-					farPoint.x,
-					voxelYReal,
-					farPoint.y);
-
-				const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-					farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-					farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int farStart = SoftwareRenderer::getLowerBoundedPixel(
-					farCeilingScreenY, frame.height);
-				const int farEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farFloorScreenY, frame.height);
-
-				SoftwareRenderer::drawTransparentPixels(x, farStart, farEnd, farCeilingScreenY,
-					farFloorScreenY, farZ, farU, 0.0, Constants::JustBelowOne, farNormal,
-					textures.at(chasmData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::Door)
+		// Empty voxels have nothing to draw, so their voxel data isn't needed.
+		const uint16_t voxelID = column[voxelY * columnStride];
+		const uint8_t voxelDataType = voxelDataTypes[voxelID];
+		if (voxelDataType == static_cast<uint8_t>(VoxelDataType::None))
 		{
-			// To do: find intersection via SoftwareRenderer::findDoorIntersection().
-			// Render nothing for now.
+			return;
 		}
-	};
 
-	auto drawInitialVoxelAbove = [x, voxelX, voxelZ, &camera, &ray, &wallNormal, &nearPoint,
-		&farPoint, nearZ, farZ, wallU, &shadingInfo, ceilingHeight, &voxelGrid, 
-		&textures, &occlusion, &frame](int voxelY)
-	{
-		const uint16_t voxelID = voxelGrid.getVoxels()[voxelX + (voxelY * voxelGrid.getWidth()) +
-			(voxelZ * voxelGrid.getWidth() * voxelGrid.getHeight())];
 		const VoxelData &voxelData = voxelGrid.getVoxelData(voxelID);
-		const double voxelYReal = static_cast<double>(voxelY);
-
-		// Height of the voxel depends on whether it's the main floor.
-		const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
-
-		if (voxelData.dataType == VoxelDataType::Wall)
-		{
-			const VoxelData::WallData &wallData = voxelData.wall;
-
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				voxelYReal,
-				nearPoint.y);
-			const Double3 farFloorPoint(
-				farPoint.x,
-				nearFloorPoint.y,
-				farPoint.y);
-
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-				farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-			const int floorStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearFloorScreenY, frame.height);
-			const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-				farFloorScreenY, frame.height);
-
-			// Floor.
-			SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-				nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
-				farZ, -Double3::UnitY, textures.at(wallData.floorID),
-				shadingInfo, occlusion, frame);
-		}
-		else if (voxelData.dataType == VoxelDataType::Floor)
-		{
-			// Do nothing. Floors can only be seen from above.
-		}
-		else if (voxelData.dataType == VoxelDataType::Ceiling)
-		{
-			// Draw bottom of ceiling voxel.
-			const VoxelData::CeilingData &ceilingData = voxelData.ceiling;
-
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				1.0 + ceilingHeight,
-				nearPoint.y);
-			const Double3 farFloorPoint(
-				farPoint.x,
-				nearFloorPoint.y,
-				farPoint.y);
-
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-				farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-			const int floorStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearFloorScreenY, frame.height);
-			const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-				farFloorScreenY, frame.height);
-
-			SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-				nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
-				farZ, -Double3::UnitY, textures.at(ceilingData.id), shadingInfo,
-				occlusion, frame);
-		}
-		else if (voxelData.dataType == VoxelDataType::Raised)
-		{
-			const VoxelData::RaisedData &raisedData = voxelData.raised;
-
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				voxelYReal + ((raisedData.yOffset + raisedData.ySize) * voxelHeight),
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				voxelYReal + (raisedData.yOffset * voxelHeight),
-				nearPoint.y);
-
-			// Draw order depends on the player's Y position relative to the platform.
-			if (camera.eye.y > nearCeilingPoint.y)
-			{
-				// Above platform.
-				const Double3 farCeilingPoint(
-					farPoint.x,
-					nearCeilingPoint.y,
-					farPoint.y);
-
-				const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-					farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-					nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-					farCeilingScreenY, frame.height);
-				const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
-					nearCeilingScreenY, frame.height);
-
-				// Ceiling.
-				SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-					farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
-					nearZ, Double3::UnitY, textures.at(raisedData.ceilingID),
-					shadingInfo, occlusion, frame);
-			}
-			else if (camera.eye.y < nearFloorPoint.y)
-			{
-				// Below platform.
-				const Double3 farFloorPoint(
-					farPoint.x,
-					nearFloorPoint.y,
-					farPoint.y);
-
-				const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-					nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-					farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int floorStart = SoftwareRenderer::getLowerBoundedPixel(
-					nearFloorScreenY, frame.height);
-				const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farFloorScreenY, frame.height);
-
-				// Floor.
-				SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-					nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
-					farZ, -Double3::UnitY, textures.at(raisedData.floorID),
-					shadingInfo, occlusion, frame);
-			}
-			else
-			{
-				// Between top and bottom.
-				const Double3 farCeilingPoint(
-					farPoint.x,
-					nearCeilingPoint.y,
-					farPoint.y);
-				const Double3 farFloorPoint(
-					farPoint.x,
-					nearFloorPoint.y,
-					farPoint.y);
-
-				const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-					farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-					nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-					farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-					nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-					nearCeilingScreenY, frame.height);
-				const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farCeilingScreenY, frame.height);
-				const int wallStart = ceilingEnd;
-				const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farFloorScreenY, frame.height);
-				const int floorStart = wallEnd;
-				const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-					nearFloorScreenY, frame.height);
-
-				// Ceiling.
-				SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-					nearCeilingScreenY, farCeilingScreenY, nearPoint, farPoint, nearZ,
-					farZ, -Double3::UnitY, textures.at(raisedData.ceilingID),
-					shadingInfo, occlusion, frame);
-
-				// Side.
-				SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, farCeilingScreenY,
-					farFloorScreenY, farZ, wallU, raisedData.vTop, raisedData.vBottom,
-					wallNormal, textures.at(raisedData.sideID), shadingInfo,
-					occlusion, frame);
-
-				// Floor.
-				SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-					farFloorScreenY, nearFloorScreenY, farPoint, nearPoint, farZ,
-					nearZ, Double3::UnitY, textures.at(raisedData.floorID),
-					shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::Diagonal)
-		{
-			const VoxelData::DiagonalData &diagData = voxelData.diagonal;
-
-			// Find intersection.
-			RayHit hit;
-			const bool success = diagData.type1 ?
-				SoftwareRenderer::findDiag1Intersection(voxelX, voxelZ, nearPoint, farPoint, hit) :
-				SoftwareRenderer::findDiag2Intersection(voxelX, voxelZ, nearPoint, farPoint, hit);
-
-			if (success)
-			{
-				double diagTopScreenY, diagBottomScreenY;
-				int diagStart, diagEnd;
-
-				SoftwareRenderer::diagProjection(voxelYReal, voxelHeight, hit.point,
-					camera.transform, camera.yShear, frame.height, frame.heightReal,
-					diagTopScreenY, diagBottomScreenY, diagStart, diagEnd);
-
-				SoftwareRenderer::drawPixels(x, diagStart, diagEnd, diagTopScreenY,
-					diagBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
-					hit.normal, textures.at(diagData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::TransparentWall)
+		if (frame.touchedVoxels != nullptr)
 		{
-			// Do nothing. Transparent walls have no back-faces.
+			frame.touchedVoxels[voxelID] = 1;
 		}
-		else if (voxelData.dataType == VoxelDataType::Edge)
-		{
-			const VoxelData::EdgeData &edgeData = voxelData.edge;
-
-			// Find intersection.
-			RayHit hit;
-			const bool success = SoftwareRenderer::findInitialEdgeIntersection(
-				voxelX, voxelZ, edgeData.facing, nearPoint, farPoint, camera, ray, hit);
 
-			if (success)
-			{
-				const Double3 edgeTopPoint(
-					hit.point.x,
-					voxelYReal + voxelHeight + edgeData.yOffset,
-					hit.point.y);
-
-				const Double3 edgeBottomPoint(
-					hit.point.x,
-					voxelYReal + edgeData.yOffset,
-					hit.point.y);
-
-				const double edgeTopScreenY = SoftwareRenderer::getProjectedY(
-					edgeTopPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double edgeBottomScreenY = SoftwareRenderer::getProjectedY(
-					edgeBottomPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int edgeStart = SoftwareRenderer::getLowerBoundedPixel(
-					edgeTopScreenY, frame.height);
-				const int edgeEnd = SoftwareRenderer::getUpperBoundedPixel(
-					edgeBottomScreenY, frame.height);
-
-				SoftwareRenderer::drawTransparentPixels(x, edgeStart, edgeEnd, edgeTopScreenY,
-					edgeBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
-					hit.normal, textures.at(edgeData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::Chasm)
-		{
-			// Ignore. Chasms should never be above the player's voxel.
-		}
-		else if (voxelData.dataType == VoxelDataType::Door)
-		{
-			// To do: find intersection via SoftwareRenderer::findDoorIntersection().
-			// Render nothing for now.
-		}
+		// Dispatch once to the drawer for the voxel's type.
+		const VoxelDrawFunction drawVoxel = drawers[voxelDataType];
+		drawVoxel(x, voxelX, voxelY, voxelZ, voxelData, camera, ray, facing, wallNormal,
+			nearPoint, farPoint, nearProjector, farProjector, nearZ, farZ, wallU, shadingInfo,
+			ceilingHeight, voxelGrid, textures, occlusion, frame);
 	};
 
 	// Draw the player's current voxel first.
-	drawInitialVoxel();
+	drawVoxelWith(SoftwareRenderer::INITIAL_VOXEL_DRAWERS, camera.eyeVoxel.y);
 
 	// Draw voxels below the player's voxel.
 	for (int voxelY = (camera.eyeVoxel.y - 1); voxelY >= 0; voxelY--)
 	{
-		drawInitialVoxelBelow(voxelY);
+		drawVoxelWith(SoftwareRenderer::INITIAL_VOXEL_BELOW_DRAWERS, voxelY);
 	}
 
 	// Draw voxels above the player's voxel.
 	for (int voxelY = (camera.eyeVoxel.y + 1); voxelY < voxelGrid.getHeight(); voxelY++)
 	{
-		drawInitialVoxelAbove(voxelY);
+		drawVoxelWith(SoftwareRenderer::INITIAL_VOXEL_ABOVE_DRAWERS, voxelY);
 	}
 }
 
 void SoftwareRenderer::drawVoxelColumn(int x, int voxelX, int voxelZ, const Camera &camera,
 	const Ray &ray, VoxelData::Facing facing, const Double2 &nearPoint, const Double2 &farPoint,
 	double nearZ, double farZ, const ShadingInfo &shadingInfo, double ceilingHeight,
-	const VoxelGrid &voxelGrid, const VoxelTextureArray &textures, OcclusionData &occlusion,
-	const FrameView &frame)
+	const VoxelGrid &voxelGrid, const uint8_t *voxelDataTypes, const VoxelTextureArray &textures,
+	OcclusionData &occlusion, const FrameView &frame)
 {
 	// Much of the code here is duplicated from the initial voxel column drawing method, but
 	// there are a couple differences, like the horizontal texture coordinate being flipped,
@@ -2780,1539 +6905,1484 @@ void SoftwareRenderer::drawVoxelColumn(int x, int voxelX, int voxelZ, const Came
 	// this voxel column.
 	const Double3 wallNormal = SoftwareRenderer::getNormal(facing);
 
-	auto drawVoxel = [x, voxelX, voxelZ, &camera, &ray, facing, &wallNormal, &nearPoint,
-		&farPoint, nearZ, farZ, wallU, &shadingInfo, ceilingHeight, &voxelGrid, &textures,
-		&occlusion, &frame]()
+	// Voxel IDs in this column, from the bottom up.
+	const uint16_t *column = voxelGrid.getColumn(voxelX, voxelZ);
+	const int columnStride = voxelGrid.getColumnStride();
+
+	// Screen Y of the near and far points at any height, shared by every voxel drawn.
+	const HeightProjector nearProjector(nearPoint, camera, frame.heightReal);
+	const HeightProjector farProjector(farPoint, camera, frame.heightReal);
+
+	auto drawVoxelWith = [x, voxelX, voxelZ, &camera, &ray, facing, &wallNormal, &nearPoint,
+		&farPoint, &nearProjector, &farProjector, nearZ, farZ, wallU, &shadingInfo,
+		ceilingHeight, &voxelGrid, &textures, &occlusion, &frame, column, columnStride,
+		voxelDataTypes](const VoxelDrawTable &drawers, int voxelY)
+	{
+		// Empty voxels have nothing to draw, so their voxel data isn't needed.
+		const uint16_t voxelID = column[voxelY * columnStride];
+		const uint8_t voxelDataType = voxelDataTypes[voxelID];
+		if (voxelDataType == static_cast<uint8_t>(VoxelDataType::None))
+		{
+			return;
+		}
+
+		const VoxelData &voxelData = voxelGrid.getVoxelData(voxelID);
+		if (frame.touchedVoxels != nullptr)
+		{
+			frame.touchedVoxels[voxelID] = 1;
+		}
+
+		// Dispatch once to the drawer for the voxel's type.
+		const VoxelDrawFunction drawVoxel = drawers[voxelDataType];
+		drawVoxel(x, voxelX, voxelY, voxelZ, voxelData, camera, ray, facing, wallNormal,
+			nearPoint, farPoint, nearProjector, farProjector, nearZ, farZ, wallU, shadingInfo,
+			ceilingHeight, voxelGrid, textures, occlusion, frame);
+	};
+
+	// Only voxels that can reach the column's unoccluded rows are drawn. A voxel below the
+	// eye is highest on-screen at the far edge of the cell, and a voxel above it is lowest
+	// there, so the open rows at the far depth give the range of heights worth drawing. At
+	// one depth, screen Y is linear in height, so the far point's projector gives them.
+	int minVoxelY = 0;
+	int maxVoxelY = voxelGrid.getHeight() - 1;
+	const double farScreenY0 = farProjector.screenY0;
+	const double screenYPerHeight = farProjector.screenYPerHeight;
+	if (screenYPerHeight < 0.0)
+	{
+		// The bounds only hold for voxels entirely below or above the eye.
+		const double lowestHeight = std::min(camera.eye.y,
+			(static_cast<double>(occlusion.yMax) - farScreenY0) / screenYPerHeight);
+		const double highestHeight = std::max(camera.eye.y,
+			(static_cast<double>(occlusion.yMin) - farScreenY0) / screenYPerHeight);
+		const double maxVoxelHeight = std::max(ceilingHeight, 1.0);
+		minVoxelY = std::max(minVoxelY,
+			static_cast<int>(std::floor(lowestHeight - maxVoxelHeight)));
+		maxVoxelY = std::min(maxVoxelY, static_cast<int>(std::floor(highestHeight)));
+	}
+
+	// Draw voxel straight ahead first.
+	drawVoxelWith(SoftwareRenderer::VOXEL_DRAWERS, camera.eyeVoxel.y);
+
+	// Draw voxels below the voxel.
+	for (int voxelY = (camera.eyeVoxel.y - 1); voxelY >= minVoxelY; voxelY--)
+	{
+		drawVoxelWith(SoftwareRenderer::VOXEL_BELOW_DRAWERS, voxelY);
+	}
+
+	// Draw voxels above the voxel.
+	for (int voxelY = (camera.eyeVoxel.y + 1); voxelY <= maxVoxelY; voxelY++)
+	{
+		drawVoxelWith(SoftwareRenderer::VOXEL_ABOVE_DRAWERS, voxelY);
+	}
+}
+
+void SoftwareRenderer::drawFlat(int startX, int endX, const FlatFrame &flatFrame,
+	bool flipped, const Double2 &eye, const ShadingInfo &shadingInfo,
+	const FlatTexture &texture, const FrameView &frame)
+{
+	// X percents across the screen for the given start and end columns.
+	const double startXPercent = (static_cast<double>(startX) + 0.50) / 
+		static_cast<double>(frame.width);
+	const double endXPercent = (static_cast<double>(endX) + 0.50) /
+		static_cast<double>(frame.width);
+
+	const bool startsInRange =
+		(flatFrame.startX >= startXPercent) && (flatFrame.startX <= endXPercent);
+	const bool endsInRange = 
+		(flatFrame.endX >= startXPercent) && (flatFrame.endX <= endXPercent);
+	const bool coversRange =
+		(flatFrame.startX <= startXPercent) && (flatFrame.endX >= endXPercent);
+	
+	// Throw out the draw call if the flat is not in the X range.
+	if (!startsInRange && !endsInRange && !coversRange)
+	{
+		return;
+	}
+
+	// Get the min and max X range of coordinates in screen-space. This range is completely 
+	// contained within the flat.
+	const double clampedStartXPercent = std::max(startXPercent,
+		std::min(flatFrame.startX, flatFrame.endX));
+	const double clampedEndXPercent = std::min(endXPercent,
+		std::max(flatFrame.startX, flatFrame.endX));
+
+	// The percentages from start to end within the flat.
+	const double startFlatPercent = (clampedStartXPercent - flatFrame.startX) /
+		(flatFrame.endX - flatFrame.startX);
+	const double endFlatPercent = (clampedEndXPercent - flatFrame.startX) /
+		(flatFrame.endX - flatFrame.startX);
+
+	// Points interpolated between for per-column depth calculations in the XZ plane.
+	const Double3 startTopPoint = flatFrame.topStart.lerp(flatFrame.topEnd, startFlatPercent);
+	const Double3 endTopPoint = flatFrame.topStart.lerp(flatFrame.topEnd, endFlatPercent);
+
+	// Horizontal texture coordinates in the flat. Although the flat percent can be
+	// equal to 1.0, the texture coordinate needs to be less than 1.0.
+	const double startU = std::max(std::min(startFlatPercent, Constants::JustBelowOne), 0.0);
+	const double endU = std::max(std::min(endFlatPercent, Constants::JustBelowOne), 0.0);
+
+	// Get the start and end coordinates of the projected points (Y values potentially
+	// outside the screen).
+	const double projectedXStart = clampedStartXPercent * frame.widthReal;
+	const double projectedXEnd = clampedEndXPercent * frame.widthReal;
+	const double projectedYStart = flatFrame.startY * frame.heightReal;
+	const double projectedYEnd = flatFrame.endY * frame.heightReal;
+
+	// Clamp the coordinates for where the flat starts and stops on the screen.
+	const int xStart = SoftwareRenderer::getLowerBoundedPixel(projectedXStart, frame.width);
+	// The end column is clamped to the given X range so that neighboring column tiles 
+	// never draw the same column.
+	const int xEnd = std::min(
+		SoftwareRenderer::getUpperBoundedPixel(projectedXEnd, frame.width), endX);
+	const int yStart = SoftwareRenderer::getLowerBoundedPixel(projectedYStart, frame.height);
+	const int yEnd = SoftwareRenderer::getUpperBoundedPixel(projectedYEnd, frame.height);
+
+	// Shading on the texture. All flats share the same normal in a frame.
+	const int shadingIndex = ShadingInfo::FLAT_SHADING_INDEX;
+
+	// Values for stepping down each column in the kernels' pixel precision.
+	const PixelValue columnStart = static_cast<PixelValue>(projectedYStart);
+	const PixelValue columnHeight = static_cast<PixelValue>(projectedYEnd - projectedYStart);
+	const PixelValue textureHeightReal = static_cast<PixelValue>(texture.height);
+
+	// Maps a texel row to the screen row whose center it starts at, for finding the rows
+	// that each opaque run covers.
+	const double runYOffset = projectedYStart - 0.50;
+	const double runYScale = (projectedYEnd - projectedYStart) /
+		static_cast<double>(texture.height);
+
+	// Throw out the whole flat if even its nearest point is behind everything in the
+	// rows it covers.
+	const TileOcclusion *tileOcclusion = frame.tileOcclusion;
+	if ((tileOcclusion != nullptr) && (xStart < xEnd))
+	{
+		const Double2 start2D(startTopPoint.x, startTopPoint.z);
+		const Double2 startToEnd = Double2(endTopPoint.x, endTopPoint.z) - start2D;
+		const double lengthSqr = startToEnd.lengthSquared();
+		const double nearestPercent = (lengthSqr > 0.0) ? std::max(std::min(
+			(eye - start2D).dot(startToEnd) / lengthSqr, 1.0), 0.0) : 0.0;
+		const double nearestDepth = ((start2D + (startToEnd * nearestPercent)) - eye).length();
+
+		if (tileOcclusion->isOccluded(yStart, yEnd, static_cast<DepthValue>(nearestDepth)))
+		{
+			if (frame.stats != nullptr)
+			{
+				frame.stats->occludedFlatColumns += xEnd - xStart;
+				frame.stats->flatDraws++;
+			}
+
+			return;
+		}
+	}
+
+	// Partially transparent texels are shaded in their own batch and given to the
+	// fragment buffer instead of the frame.
+	FragmentBuffer *fragments = frame.fragments;
+	PixelBatch alphaBatch;
+	std::array<int, SpanShading::MAX_PIXELS> alphaRows;
+	std::array<uint8_t, SpanShading::MAX_PIXELS> alphaValues;
+	int fragmentCount = 0;
+	auto flushAlphaBatch = [fragments, &alphaBatch, &alphaRows, &alphaValues, &fragmentCount,
+		shadingIndex, &shadingInfo](int x)
 	{
-		const int voxelY = camera.eyeVoxel.y;
-		const uint16_t voxelID = voxelGrid.getVoxels()[voxelX + (voxelY * voxelGrid.getWidth()) +
-			(voxelZ * voxelGrid.getWidth() * voxelGrid.getHeight())];
-		const VoxelData &voxelData = voxelGrid.getVoxelData(voxelID);
+		SpanShading::Span &span = alphaBatch.span;
+		if (span.count == 0)
+		{
+			return;
+		}
 
-		// Height of the voxel depends on whether it's the main floor.
-		const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
+		SpanShading::shade(span, shadingInfo.getShading(shadingIndex),
+			shadingInfo.horizonSkyColor);
 
-		if (voxelData.dataType == VoxelDataType::Wall)
+		for (int i = 0; i < span.count; i++)
 		{
-			// Draw side.
-			const VoxelData::WallData &wallData = voxelData.wall;
-
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				camera.eyeVoxelReal.y + voxelHeight,
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				camera.eyeVoxelReal.y,
-				nearPoint.y);
+			fragments->add(x, alphaRows[i], alphaBatch.depths[i], span.colors[i],
+				alphaValues[i]);
+		}
 
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-			
-			const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearCeilingScreenY, frame.height);
-			const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearFloorScreenY, frame.height);
+		fragmentCount += span.count;
+		span.count = 0;
+	};
 
-			SoftwareRenderer::drawPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-				nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
-				textures.at(wallData.sideID), shadingInfo, occlusion, frame);
-		}
-		else if (voxelData.dataType == VoxelDataType::Floor)
+	// Draw by-column, similar to wall rendering.
+	PixelBatch batch;
+	int shadedCount = 0;
+	int rejectCount = 0;
+	int occludedCount = 0;
+	for (int x = xStart; x < xEnd; x++)
+	{
+		if (!frame.drawsColumn(x))
 		{
-			// Do nothing. Floors can only be seen from above.
+			continue;
 		}
-		else if (voxelData.dataType == VoxelDataType::Ceiling)
+
+		const double xPercent = ((static_cast<double>(x) + 0.50) - projectedXStart) /
+			(projectedXEnd - projectedXStart);
+
+		// Horizontal texture coordinate.
+		const double u = startU + ((endU - startU) * xPercent);
+
+		// Horizontal texel position.
+		const int textureX = static_cast<int>(
+			(flipped ? (Constants::JustBelowOne - u) : u) *
+			static_cast<double>(texture.width));
+
+		const Double3 topPoint = startTopPoint.lerp(endTopPoint, xPercent);
+
+		// Get the true XZ distance for the depth.
+		const double depth = (Double2(topPoint.x, topPoint.z) - eye).length();
+		const DepthValue bufferDepth = static_cast<DepthValue>(depth);
+
+		// Skip the column if it's behind everything in its rows.
+		if ((tileOcclusion != nullptr) && tileOcclusion->isOccluded(yStart, yEnd, bufferDepth))
 		{
-			// Do nothing. Ceilings can only be seen from below.
+			occludedCount++;
+			continue;
 		}
-		else if (voxelData.dataType == VoxelDataType::Raised)
+
+		// Linearly interpolated fog.
+		const double fogPercent = shadingInfo.getFogPercent(depth);
+
+		// Only rows where the texel column has opaque runs can produce pixels. Each run's
+		// rows are widened by one on both sides to cover rounding, since transparent texels
+		// are still thrown out below. Runs are top to bottom, so rows never overlap.
+		const int runsEnd = texture.columnRuns[textureX + 1];
+		int nextY = yStart;
+		for (int runIndex = texture.columnRuns[textureX]; runIndex < runsEnd; runIndex++)
 		{
-			const VoxelData::RaisedData &raisedData = voxelData.raised;
+			const FlatTexture::OpaqueRun &run = texture.runs[runIndex];
+			const double runYStart = std::floor(
+				runYOffset + (static_cast<double>(run.start) * runYScale)) - 1.0;
+			const double runYEnd = std::ceil(
+				runYOffset + (static_cast<double>(run.start + run.count) * runYScale)) + 1.0;
+			const int yRunStart = static_cast<int>(std::max(runYStart, static_cast<double>(nextY)));
+			const int yRunEnd = static_cast<int>(std::min(runYEnd, static_cast<double>(yEnd)));
+
+			for (int y = yRunStart; y < yRunEnd; y++)
+			{
+				const int index = frame.getIndex(x, y);
 
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				camera.eyeVoxelReal.y + ((raisedData.yOffset + raisedData.ySize) * voxelHeight),
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				camera.eyeVoxelReal.y + (raisedData.yOffset * voxelHeight),
-				nearPoint.y);
+				if (bufferDepth <= frame.depthBuffer[index])
+				{
+					const PixelValue yPercent = ((static_cast<PixelValue>(y) +
+						static_cast<PixelValue>(0.50)) - columnStart) / columnHeight;
 
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
+					// Vertical texture coordinate. The flat's full height maps to just below 1.0.
+					const PixelValue v =
+						static_cast<PixelValue>(Constants::JustBelowOne) * yPercent;
 
-			const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearCeilingScreenY, frame.height);
-			const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearFloorScreenY, frame.height);
+					// Vertical texel position. Clamped since a float can round up to the bottom
+					// edge.
+					const int textureY = std::min(static_cast<int>(v * textureHeightReal),
+						texture.height - 1);
 
-			// Draw order depends on the player's Y position relative to the platform.
-			if (camera.eye.y > nearCeilingPoint.y)
-			{
-				// Above platform.
-				const Double3 farCeilingPoint(
-					farPoint.x,
-					nearCeilingPoint.y,
-					farPoint.y);
-
-				const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-					farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-					farCeilingScreenY, frame.height);
-				const int ceilingEnd = wallStart;
-
-				// Ceiling.
-				SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-					farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
-					nearZ, Double3::UnitY, textures.at(raisedData.ceilingID),
-					shadingInfo, occlusion, frame);
-
-				// Side.
-				SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-					nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
-					wallNormal, textures.at(raisedData.sideID), shadingInfo,
-					occlusion, frame);
-			}
-			else if (camera.eye.y < nearFloorPoint.y)
-			{
-				// Below platform.
-				const Double3 farFloorPoint(
-					farPoint.x,
-					nearFloorPoint.y,
-					farPoint.y);
-
-				const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-					farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int floorStart = wallEnd;
-				const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farFloorScreenY, frame.height);
-
-				// Side.
-				SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-					nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
-					wallNormal, textures.at(raisedData.sideID), shadingInfo, occlusion, frame);
-
-				// Floor.
-				SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-					nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
-					farZ, -Double3::UnitY, textures.at(raisedData.floorID),
-					shadingInfo, occlusion, frame);
-			}
-			else
-			{
-				// Between top and bottom.
-				SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-					nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
-					wallNormal, textures.at(raisedData.sideID), shadingInfo, occlusion, frame);
+					// Alpha is checked in this loop, and transparent texels are not drawn.
+					// Flats do not have emission, so ignore it.
+					const int textureIndex = textureX + (textureY * texture.width);
+					const FlatTexel &texel = texture.texels[textureIndex];
+
+					if ((texel.a == 255) || ((texel.a > 0) && (fragments == nullptr)))
+					{
+						shadedCount++;
+
+						// Shading and fog are applied to several pixels at once. Flats do not 
+						// have emission.
+						if (batch.add(texel.r, texel.g, texel.b, 0, fogPercent, index, bufferDepth))
+						{
+							SoftwareRenderer::flushPixelBatch(
+								batch, shadingIndex, shadingInfo, true, frame);
+						}
+					}
+					else if (texel.a > 0)
+					{
+						// Shaded together like opaque pixels, then kept for blending.
+						const int alphaIndex = alphaBatch.span.count;
+						alphaRows[alphaIndex] = y;
+						alphaValues[alphaIndex] = texel.a;
+						if (alphaBatch.add(texel.r, texel.g, texel.b, 0, fogPercent, index,
+							bufferDepth))
+						{
+							flushAlphaBatch(x);
+						}
+					}
+				}
+				else
+				{
+					rejectCount++;
+				}
 			}
-		}
-		else if (voxelData.dataType == VoxelDataType::Diagonal)
-		{
-			const VoxelData::DiagonalData &diagData = voxelData.diagonal;
 
-			// Find intersection.
-			RayHit hit;
-			const bool success = diagData.type1 ?
-				SoftwareRenderer::findDiag1Intersection(voxelX, voxelZ, nearPoint, farPoint, hit) :
-				SoftwareRenderer::findDiag2Intersection(voxelX, voxelZ, nearPoint, farPoint, hit);
+			nextY = std::max(nextY, yRunEnd);
+		}
 
-			if (success)
-			{
-				double diagTopScreenY, diagBottomScreenY;
-				int diagStart, diagEnd;
+		SoftwareRenderer::flushPixelBatch(batch, shadingIndex, shadingInfo, true, frame);
+		flushAlphaBatch(x);
+	}
 
-				SoftwareRenderer::diagProjection(camera.eyeVoxelReal.y, voxelHeight, hit.point,
-					camera.transform, camera.yShear, frame.height, frame.heightReal,
-					diagTopScreenY, diagBottomScreenY, diagStart, diagEnd);
+	if (frame.stats != nullptr)
+	{
+		frame.stats->flatPixels += shadedCount;
+		frame.stats->flatFragments += fragmentCount;
+		frame.stats->depthRejects += rejectCount;
+		frame.stats->occludedFlatColumns += occludedCount;
+		frame.stats->flatDraws++;
+	}
 
-				SoftwareRenderer::drawPixels(x, diagStart, diagEnd, diagTopScreenY,
-					diagBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne, 
-					hit.normal, textures.at(diagData.id), shadingInfo, occlusion, frame);
+	if (frame.columnCosts != nullptr)
+	{
+		for (int x = xStart; x < xEnd; x++)
+		{
+			if (frame.drawsColumn(x))
+			{
+				frame.columnCosts[x].flatDraws++;
 			}
 		}
-		else if (voxelData.dataType == VoxelDataType::TransparentWall)
-		{
-			// Draw transparent side.
-			const VoxelData::TransparentWallData &transparentWallData = voxelData.transparentWall;
+	}
+}
 
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				camera.eyeVoxelReal.y + voxelHeight,
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				camera.eyeVoxelReal.y,
-				nearPoint.y);
+void SoftwareRenderer::drawFlatDot(int startX, int endX, const FlatFrame &flatFrame,
+	const Double2 &eye, const ShadingInfo &shadingInfo, const FlatTexture &texture,
+	const FrameView &frame)
+{
+	// Pixel at the flat's center, in this X range only so neighboring column tiles
+	// don't both draw it.
+	const double centerX = ((flatFrame.startX + flatFrame.endX) * 0.50) * frame.widthReal;
+	const double centerY = ((flatFrame.startY + flatFrame.endY) * 0.50) * frame.heightReal;
+	if ((centerX < static_cast<double>(startX)) || (centerX >= static_cast<double>(endX)) ||
+		(centerY < 0.0) || (centerY >= frame.heightReal))
+	{
+		return;
+	}
 
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
+	const int x = static_cast<int>(centerX);
+	const int y = static_cast<int>(centerY);
+	if (!frame.drawsColumn(x))
+	{
+		return;
+	}
 
-			const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearCeilingScreenY, frame.height);
-			const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearFloorScreenY, frame.height);
+	const int index = frame.getIndex(x, y);
 
-			SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-				nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal, 
-				textures.at(transparentWallData.id), shadingInfo, occlusion, frame);
-		}
-		else if (voxelData.dataType == VoxelDataType::Edge)
-		{
-			const VoxelData::EdgeData &edgeData = voxelData.edge;
+	const Double3 centerPoint = flatFrame.topStart.lerp(flatFrame.topEnd, 0.50);
+	const double depth = (Double2(centerPoint.x, centerPoint.z) - eye).length();
+	const DepthValue bufferDepth = static_cast<DepthValue>(depth);
 
-			// Find intersection.
-			RayHit hit;
-			const bool success = SoftwareRenderer::findEdgeIntersection(voxelX, voxelZ,
-				edgeData.facing, facing, nearPoint, farPoint, wallU, camera, ray, hit);
+	const bool visible = bufferDepth <= frame.depthBuffer[index];
+	if (visible)
+	{
+		const FlatTexel &texel = texture.averageTexel;
+		const double fogPercent = shadingInfo.getFogPercent(depth);
 
-			if (success)
-			{
-				const Double3 edgeTopPoint(
-					hit.point.x,
-					camera.eyeVoxelReal.y + voxelHeight + edgeData.yOffset,
-					hit.point.y);
-
-				const Double3 edgeBottomPoint(
-					hit.point.x,
-					camera.eyeVoxelReal.y + edgeData.yOffset,
-					hit.point.y);
-
-				const double edgeTopScreenY = SoftwareRenderer::getProjectedY(
-					edgeTopPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double edgeBottomScreenY = SoftwareRenderer::getProjectedY(
-					edgeBottomPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int edgeStart = SoftwareRenderer::getLowerBoundedPixel(
-					edgeTopScreenY, frame.height);
-				const int edgeEnd = SoftwareRenderer::getUpperBoundedPixel(
-					edgeBottomScreenY, frame.height);
-
-				SoftwareRenderer::drawTransparentPixels(x, edgeStart, edgeEnd, edgeTopScreenY,
-					edgeBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
-					hit.normal, textures.at(edgeData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::Chasm)
-		{
-			// Render front and back-faces.
-			const VoxelData::ChasmData &chasmData = voxelData.chasm;
+		PixelBatch batch;
+		batch.add(texel.r, texel.g, texel.b, 0, fogPercent, index, bufferDepth);
+		SoftwareRenderer::flushPixelBatch(batch, ShadingInfo::FLAT_SHADING_INDEX, shadingInfo,
+			true, frame);
+	}
 
-			// Find which faces on the chasm were intersected.
-			const VoxelData::Facing nearFacing = facing;
-			const VoxelData::Facing farFacing = SoftwareRenderer::getChasmFarFacing(
-				voxelX, voxelZ, nearFacing, camera, ray);
+	if (frame.stats != nullptr)
+	{
+		frame.stats->flatPixels += visible ? 1 : 0;
+		frame.stats->depthRejects += visible ? 0 : 1;
+		frame.stats->flatDraws++;
+	}
 
-			// Near.
-			if (chasmData.faceIsVisible(nearFacing))
-			{
-				const double nearU = Constants::JustBelowOne - wallU;
-				const Double3 nearNormal = wallNormal;
-
-				const Double3 nearCeilingPoint(
-					nearPoint.x,
-					camera.eyeVoxelReal.y + voxelHeight,
-					nearPoint.y);
-				const Double3 nearFloorPoint(
-					nearPoint.x,
-					camera.eyeVoxelReal.y,
-					nearPoint.y);
-
-				const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-					nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-					nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int nearStart = SoftwareRenderer::getLowerBoundedPixel(
-					nearCeilingScreenY, frame.height);
-				const int nearEnd = SoftwareRenderer::getUpperBoundedPixel(
-					nearFloorScreenY, frame.height);
-
-				SoftwareRenderer::drawTransparentPixels(x, nearStart, nearEnd, nearCeilingScreenY,
-					nearFloorScreenY, nearZ, nearU, 0.0, Constants::JustBelowOne, nearNormal,
-					textures.at(chasmData.id), shadingInfo, occlusion, frame);
-			}
+	if (frame.columnCosts != nullptr)
+	{
+		frame.columnCosts[x].flatDraws++;
+	}
+}
 
-			// Far.
-			if (chasmData.faceIsVisible(farFacing))
-			{
-				const double farU = [&farPoint, farFacing]()
-				{
-					const double uVal = [&farPoint, farFacing]()
-					{
-						if (farFacing == VoxelData::Facing::PositiveX)
-						{
-							return farPoint.y - std::floor(farPoint.y);
-						}
-						else if (farFacing == VoxelData::Facing::NegativeX)
-						{
-							return Constants::JustBelowOne - (farPoint.y - std::floor(farPoint.y));
-						}
-						else if (farFacing == VoxelData::Facing::PositiveZ)
-						{
-							return Constants::JustBelowOne - (farPoint.x - std::floor(farPoint.x));
-						}
-						else
-						{
-							return farPoint.x - std::floor(farPoint.x);
-						}
-					}();
+void SoftwareRenderer::rayCast2D(int x, const Camera &camera, const Ray &ray,
+	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+	const uint8_t *voxelDataTypes, const VoxelTextureArray &textures, OcclusionData &occlusion,
+	const FrameView &frame)
+{
+	// Initially based on Lode Vandevenne's algorithm, this method of 2.5D ray casting is more 
+	// expensive as it does not stop at the first wall intersection, and it also renders voxels 
+	// above and below the current floor.
 
-					return std::max(std::min(uVal, Constants::JustBelowOne), 0.0);
-				}();
+	// Some floating point behavior assumptions:
+	// -> (value / 0.0) == infinity
+	// -> (value / infinity) == 0.0
+	// -> (int)(-0.8) == 0
+	// -> (int)floor(-0.8) == -1
+	// -> (int)ceil(-0.8) == 0
 
-				const Double3 farNormal = -SoftwareRenderer::getNormal(farFacing);
-
-				const Double3 farCeilingPoint(
-					farPoint.x,
-					camera.eyeVoxelReal.y + voxelHeight,
-					farPoint.y);
-				const Double3 farFloorPoint(
-					farPoint.x,
-					camera.eyeVoxelReal.y,
-					farPoint.y);
-
-				const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-					farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-					farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int farStart = SoftwareRenderer::getLowerBoundedPixel(
-					farCeilingScreenY, frame.height);
-				const int farEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farFloorScreenY, frame.height);
-
-				SoftwareRenderer::drawTransparentPixels(x, farStart, farEnd, farCeilingScreenY,
-					farFloorScreenY, farZ, farU, 0.0, Constants::JustBelowOne, farNormal,
-					textures.at(chasmData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::Door)
-		{
-			// To do: find intersection via SoftwareRenderer::findDoorIntersection().
+	const double dirXSquared = ray.dirX * ray.dirX;
+	const double dirZSquared = ray.dirZ * ray.dirZ;
+
+	const double deltaDistX = std::sqrt(1.0 + (dirZSquared / dirXSquared));
+	const double deltaDistZ = std::sqrt(1.0 + (dirXSquared / dirZSquared));
 
-			// Just render as transparent wall for now.
-			const VoxelData::DoorData &doorData = voxelData.door;
+	const bool nonNegativeDirX = ray.dirX >= 0.0;
+	const bool nonNegativeDirZ = ray.dirZ >= 0.0;
+
+	int stepX, stepZ;
+	double sideDistX, sideDistZ;
+	if (nonNegativeDirX)
+	{
+		stepX = 1;
+		sideDistX = (camera.eyeVoxelReal.x + 1.0 - camera.eye.x) * deltaDistX;
+	}
+	else
+	{
+		stepX = -1;
+		sideDistX = (camera.eye.x - camera.eyeVoxelReal.x) * deltaDistX;
+	}
 
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				camera.eyeVoxelReal.y + voxelHeight,
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				camera.eyeVoxelReal.y,
-				nearPoint.y);
+	if (nonNegativeDirZ)
+	{
+		stepZ = 1;
+		sideDistZ = (camera.eyeVoxelReal.z + 1.0 - camera.eye.z) * deltaDistZ;
+	}
+	else
+	{
+		stepZ = -1;
+		sideDistZ = (camera.eye.z - camera.eyeVoxelReal.z) * deltaDistZ;
+	}
 
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
+	// The Z distance from the camera to the wall, and the X or Z normal of the intersected
+	// voxel face. The first Z distance is a special case, so it's brought outside the 
+	// DDA loop.
+	double zDistance;
+	VoxelData::Facing facing;
 
-			const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearCeilingScreenY, frame.height);
-			const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearFloorScreenY, frame.height);
+	// Verify that the initial voxel coordinate is within the world bounds.
+	bool voxelIsValid = 
+		(camera.eyeVoxel.x >= 0) && 
+		(camera.eyeVoxel.y >= 0) && 
+		(camera.eyeVoxel.z >= 0) &&
+		(camera.eyeVoxel.x < voxelGrid.getWidth()) && 
+		(camera.eyeVoxel.y < voxelGrid.getHeight()) &&
+		(camera.eyeVoxel.z < voxelGrid.getDepth());
 
-			SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-				nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
-				textures.at(doorData.id), shadingInfo, occlusion, frame);
-		}
-	};
+	// Work done by this column, for the render stats.
+	int stepCount = 0;
+	int voxelColumnCount = 0;
 
-	auto drawVoxelBelow = [x, voxelX, voxelZ, &camera, &ray, facing, &wallNormal, &nearPoint,
-		&farPoint, nearZ, farZ, wallU, &shadingInfo, ceilingHeight, &voxelGrid, &textures,
-		&occlusion, &frame](int voxelY)
+	if (voxelIsValid)
 	{
-		const uint16_t voxelID = voxelGrid.getVoxels()[voxelX + (voxelY * voxelGrid.getWidth()) +
-			(voxelZ * voxelGrid.getWidth() * voxelGrid.getHeight())];
-		const VoxelData &voxelData = voxelGrid.getVoxelData(voxelID);
-		const double voxelYReal = static_cast<double>(voxelY);
-
-		// Height of the voxel depends on whether it's the main floor.
-		const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
-
-		if (voxelData.dataType == VoxelDataType::Wall)
-		{
-			const VoxelData::WallData &wallData = voxelData.wall;
-
-			const Double3 farCeilingPoint(
-				farPoint.x,
-				voxelYReal + voxelHeight,
-				farPoint.y);
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				farCeilingPoint.y,
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				voxelYReal,
-				nearPoint.y);
-
-			const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-				farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-			const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-				farCeilingScreenY, frame.height);
-			const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearCeilingScreenY, frame.height);
-			const int wallStart = ceilingEnd;
-			const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearFloorScreenY, frame.height);
-
-			// Ceiling.
-			SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-				farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
-				nearZ, Double3::UnitY, textures.at(wallData.ceilingID),
-				shadingInfo, occlusion, frame);
-
-			// Side.
-			SoftwareRenderer::drawPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-				nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
-				textures.at(wallData.sideID), shadingInfo, occlusion, frame);
-		}
-		else if (voxelData.dataType == VoxelDataType::Floor)
-		{
-			// Draw top of floor voxel.
-			const VoxelData::FloorData &floorData = voxelData.floor;
-
-			const Double3 farCeilingPoint(
-				farPoint.x,
-				voxelYReal + voxelHeight,
-				farPoint.y);
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				farCeilingPoint.y,
-				nearPoint.y);
-
-			const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-				farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-			const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-				farCeilingScreenY, frame.height);
-			const int ceilingEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearCeilingScreenY, frame.height);
-
-			SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-				farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
-				nearZ, Double3::UnitY, textures.at(floorData.id), shadingInfo, 
-				occlusion, frame);
-		}
-		else if (voxelData.dataType == VoxelDataType::Ceiling)
-		{
-			// Do nothing. Ceilings can only be seen from below.
-		}
-		else if (voxelData.dataType == VoxelDataType::Raised)
-		{
-			const VoxelData::RaisedData &raisedData = voxelData.raised;
-
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				voxelYReal + ((raisedData.yOffset + raisedData.ySize) * voxelHeight),
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				voxelYReal + (raisedData.yOffset * voxelHeight),
-				nearPoint.y);
-
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-			const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearCeilingScreenY, frame.height);
-			const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearFloorScreenY, frame.height);
-
-			// Draw order depends on the player's Y position relative to the platform.
-			if (camera.eye.y > nearCeilingPoint.y)
-			{
-				// Above platform.
-				const Double3 farCeilingPoint(
-					farPoint.x,
-					nearCeilingPoint.y,
-					farPoint.y);
-
-				const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-					farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-					farCeilingScreenY, frame.height);
-				const int ceilingEnd = wallStart;
-
-				// Ceiling.
-				SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-					farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
-					nearZ, Double3::UnitY, textures.at(raisedData.ceilingID),
-					shadingInfo, occlusion, frame);
-
-				// Side.
-				SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-					nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
-					wallNormal, textures.at(raisedData.sideID), shadingInfo, 
-					occlusion, frame);
-			}
-			else if (camera.eye.y < nearFloorPoint.y)
-			{
-				// Below platform.
-				const Double3 farFloorPoint(
-					farPoint.x,
-					nearFloorPoint.y,
-					farPoint.y);
-
-				const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-					farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int floorStart = wallEnd;
-				const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farFloorScreenY, frame.height);
-
-				// Side.
-				SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-					nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
-					wallNormal, textures.at(raisedData.sideID), shadingInfo, occlusion, frame);
-
-				// Floor.
-				SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-					nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
-					farZ, -Double3::UnitY, textures.at(raisedData.floorID),
-					shadingInfo, occlusion, frame);
-			}
-			else
-			{
-				// Between top and bottom.
-				SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-					nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
-					wallNormal, textures.at(raisedData.sideID), shadingInfo, occlusion, frame);
-			}
+		// Decide how far the wall is, and which voxel face was hit.
+		if (sideDistX < sideDistZ)
+		{
+			zDistance = sideDistX;
+			facing = nonNegativeDirX ? VoxelData::Facing::NegativeX : 
+				VoxelData::Facing::PositiveX;
 		}
-		else if (voxelData.dataType == VoxelDataType::Diagonal)
+		else
 		{
-			const VoxelData::DiagonalData &diagData = voxelData.diagonal;
+			zDistance = sideDistZ;
+			facing = nonNegativeDirZ ? VoxelData::Facing::NegativeZ : 
+				VoxelData::Facing::PositiveZ;
+		}
 
-			// Find intersection.
-			RayHit hit;
-			const bool success = diagData.type1 ?
-				SoftwareRenderer::findDiag1Intersection(voxelX, voxelZ, nearPoint, farPoint, hit) :
-				SoftwareRenderer::findDiag2Intersection(voxelX, voxelZ, nearPoint, farPoint, hit);
+		// The initial near point is directly in front of the player in the near Z 
+		// camera plane.
+		const Double2 initialNearPoint(
+			camera.eye.x + (ray.dirX * SoftwareRenderer::NEAR_PLANE),
+			camera.eye.z + (ray.dirZ * SoftwareRenderer::NEAR_PLANE));
 
-			if (success)
-			{
-				double diagTopScreenY, diagBottomScreenY;
-				int diagStart, diagEnd;
+		// The initial far point is the wall hit. This is used with the player's position 
+		// for drawing the initial floor and ceiling.
+		const Double2 initialFarPoint(
+			camera.eye.x + (ray.dirX * zDistance),
+			camera.eye.z + (ray.dirZ * zDistance));
 
-				SoftwareRenderer::diagProjection(voxelYReal, voxelHeight, hit.point,
-					camera.transform, camera.yShear, frame.height, frame.heightReal,
-					diagTopScreenY, diagBottomScreenY, diagStart, diagEnd);
+		// Draw all voxels in a column at the player's XZ coordinate.
+		SoftwareRenderer::drawInitialVoxelColumn(x, camera.eyeVoxel.x, camera.eyeVoxel.z,
+			camera, ray, facing, initialNearPoint, initialFarPoint, SoftwareRenderer::NEAR_PLANE, 
+			zDistance, shadingInfo, ceilingHeight, voxelGrid, voxelDataTypes, textures,
+			occlusion, frame);
+		voxelColumnCount++;
+	}
 
-				SoftwareRenderer::drawPixels(x, diagStart, diagEnd, diagTopScreenY,
-					diagBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
-					hit.normal, textures.at(diagData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::TransparentWall)
-		{
-			// Draw transparent side.
-			const VoxelData::TransparentWallData &transparentWallData = voxelData.transparentWall;
+	// The current voxel coordinate in the DDA loop. For all intents and purposes,
+	// the Y cell coordinate is constant.
+	Int3 cell(camera.eyeVoxel.x, camera.eyeVoxel.y, camera.eyeVoxel.z);
 
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				voxelYReal + voxelHeight,
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				voxelYReal,
-				nearPoint.y);
+	// Lambda for stepping to the next XZ coordinate in the grid and updating the Z
+	// distance for the current edge point.
+	auto doDDAStep = [&camera, &ray, &voxelGrid, &sideDistX, &sideDistZ, &cell,
+		&facing, &voxelIsValid, &zDistance, &stepCount, deltaDistX, deltaDistZ, stepX, stepZ,
+		nonNegativeDirX, nonNegativeDirZ]()
+	{
+		stepCount++;
 
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
+		if (sideDistX < sideDistZ)
+		{
+			sideDistX += deltaDistX;
+			cell.x += stepX;
+			facing = nonNegativeDirX ? VoxelData::Facing::NegativeX : 
+				VoxelData::Facing::PositiveX;
+			voxelIsValid &= (cell.x >= 0) && (cell.x < voxelGrid.getWidth());
+		}
+		else
+		{
+			sideDistZ += deltaDistZ;
+			cell.z += stepZ;
+			facing = nonNegativeDirZ ? VoxelData::Facing::NegativeZ : 
+				VoxelData::Facing::PositiveZ;
+			voxelIsValid &= (cell.z >= 0) && (cell.z < voxelGrid.getDepth());
+		}
 
-			const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearCeilingScreenY, frame.height);
-			const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearFloorScreenY, frame.height);
+		const bool onXAxis = (facing == VoxelData::Facing::PositiveX) || 
+			(facing == VoxelData::Facing::NegativeX);
 
-			SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-				nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
-				textures.at(transparentWallData.id), shadingInfo, occlusion, frame);
+		// Update the Z distance depending on which axis was stepped with.
+		if (onXAxis)
+		{
+			zDistance = (static_cast<double>(cell.x) - 
+				camera.eye.x + static_cast<double>((1 - stepX) / 2)) / ray.dirX;
 		}
-		else if (voxelData.dataType == VoxelDataType::Edge)
+		else
 		{
-			const VoxelData::EdgeData &edgeData = voxelData.edge;
+			zDistance = (static_cast<double>(cell.z) -
+				camera.eye.z + static_cast<double>((1 - stepZ) / 2)) / ray.dirZ;
+		}
+	};
+
+	// Step forward in the grid once to leave the initial voxel and update the Z distance.
+	doDDAStep();
+
+	// Step through the voxel grid while the current coordinate is valid, the 
+	// distance stepped is less than the distance at which fog is maximum, and
+	// the column is not completely occluded.
+	while (voxelIsValid && (zDistance < shadingInfo.fogDistance) && 
+		(occlusion.yMin != occlusion.yMax))
+	{
+		// Store the cell coordinates, axis, and Z distance for wall rendering. The
+		// loop needs to do another DDA step to calculate the far point.
+		const int savedCellX = cell.x;
+		const int savedCellZ = cell.z;
+		const VoxelData::Facing savedFacing = facing;
+		const double wallDistance = zDistance;
 
-			// Find intersection.
-			RayHit hit;
-			const bool success = SoftwareRenderer::findEdgeIntersection(voxelX, voxelZ,
-				edgeData.facing, facing, nearPoint, farPoint, wallU, camera, ray, hit);
+		// Decide which voxel in the XZ plane to step to next, and update the Z distance.
+		doDDAStep();
 
-			if (success)
+		// Plain columns only draw floors and ceilings, whose textures repeat every voxel, 
+		// so a run of identical ones can be drawn as one long column from the first near
+		// point to the last far point.
+		if (voxelGrid.isPlainColumn(savedCellX, savedCellZ))
+		{
+			while (voxelIsValid && (zDistance < shadingInfo.fogDistance) &&
+				voxelGrid.columnsMatch(savedCellX, savedCellZ, cell.x, cell.z))
 			{
-				const Double3 edgeTopPoint(
-					hit.point.x,
-					voxelYReal + voxelHeight + edgeData.yOffset,
-					hit.point.y);
-
-				const Double3 edgeBottomPoint(
-					hit.point.x,
-					voxelYReal + edgeData.yOffset,
-					hit.point.y);
-
-				const double edgeTopScreenY = SoftwareRenderer::getProjectedY(
-					edgeTopPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double edgeBottomScreenY = SoftwareRenderer::getProjectedY(
-					edgeBottomPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int edgeStart = SoftwareRenderer::getLowerBoundedPixel(
-					edgeTopScreenY, frame.height);
-				const int edgeEnd = SoftwareRenderer::getUpperBoundedPixel(
-					edgeBottomScreenY, frame.height);
-
-				SoftwareRenderer::drawTransparentPixels(x, edgeStart, edgeEnd, edgeTopScreenY,
-					edgeBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
-					hit.normal, textures.at(edgeData.id), shadingInfo, occlusion, frame);
+				doDDAStep();
 			}
 		}
-		else if (voxelData.dataType == VoxelDataType::Chasm)
-		{
-			// Render front and back-faces.
-			const VoxelData::ChasmData &chasmData = voxelData.chasm;
 
-			// Find which faces on the chasm were intersected.
-			const VoxelData::Facing nearFacing = facing;
-			const VoxelData::Facing farFacing = SoftwareRenderer::getChasmFarFacing(
-				voxelX, voxelZ, nearFacing, camera, ray);
+		// Everything past the fog distance comes out as the fog color, so the last voxel 
+		// column stops there and the rest of the screen column is left for the fog fill.
+		const double farDistance = std::min(zDistance, shadingInfo.fogDistance);
 
-			// Near.
-			if (chasmData.faceIsVisible(nearFacing))
-			{
-				const double nearU = Constants::JustBelowOne - wallU;
-				const Double3 nearNormal = wallNormal;
-
-				const Double3 nearCeilingPoint(
-					nearPoint.x,
-					voxelYReal + voxelHeight,
-					nearPoint.y);
-				const Double3 nearFloorPoint(
-					nearPoint.x,
-					voxelYReal,
-					nearPoint.y);
-
-				const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-					nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-					nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int nearStart = SoftwareRenderer::getLowerBoundedPixel(
-					nearCeilingScreenY, frame.height);
-				const int nearEnd = SoftwareRenderer::getUpperBoundedPixel(
-					nearFloorScreenY, frame.height);
-
-				SoftwareRenderer::drawTransparentPixels(x, nearStart, nearEnd, nearCeilingScreenY,
-					nearFloorScreenY, nearZ, nearU, 0.0, Constants::JustBelowOne, nearNormal,
-					textures.at(chasmData.id), shadingInfo, occlusion, frame);
-			}
+		// Near and far points in the XZ plane. The near point is where the wall is, and 
+		// the far point is used with the near point for drawing the floor and ceiling.
+		const Double2 nearPoint(
+			camera.eye.x + (ray.dirX * wallDistance),
+			camera.eye.z + (ray.dirZ * wallDistance));
+		const Double2 farPoint(
+			camera.eye.x + (ray.dirX * farDistance),
+			camera.eye.z + (ray.dirZ * farDistance));
 
-			// Far.
-			if (chasmData.faceIsVisible(farFacing))
-			{
-				const double farU = [&farPoint, farFacing]()
-				{
-					const double uVal = [&farPoint, farFacing]()
-					{
-						if (farFacing == VoxelData::Facing::PositiveX)
-						{
-							return farPoint.y - std::floor(farPoint.y);
-						}
-						else if (farFacing == VoxelData::Facing::NegativeX)
-						{
-							return Constants::JustBelowOne - (farPoint.y - std::floor(farPoint.y));
-						}
-						else if (farFacing == VoxelData::Facing::PositiveZ)
-						{
-							return Constants::JustBelowOne - (farPoint.x - std::floor(farPoint.x));
-						}
-						else
-						{
-							return farPoint.x - std::floor(farPoint.x);
-						}
-					}();
+		// Draw all voxels in a column at the given XZ coordinate.
+		SoftwareRenderer::drawVoxelColumn(x, savedCellX, savedCellZ, camera, ray, savedFacing,
+			nearPoint, farPoint, wallDistance, farDistance, shadingInfo, ceilingHeight, 
+			voxelGrid, voxelDataTypes, textures, occlusion, frame);
+		voxelColumnCount++;
+	}
 
-					return std::max(std::min(uVal, Constants::JustBelowOne), 0.0);
-				}();
+	if (frame.stats != nullptr)
+	{
+		frame.stats->voxelSteps += stepCount;
+		frame.stats->voxelColumns += voxelColumnCount;
 
-				const Double3 farNormal = -SoftwareRenderer::getNormal(farFacing);
-
-				const Double3 farCeilingPoint(
-					farPoint.x,
-					voxelYReal + voxelHeight,
-					farPoint.y);
-				const Double3 farFloorPoint(
-					farPoint.x,
-					voxelYReal,
-					farPoint.y);
-
-				const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-					farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-					farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int farStart = SoftwareRenderer::getLowerBoundedPixel(
-					farCeilingScreenY, frame.height);
-				const int farEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farFloorScreenY, frame.height);
-
-				SoftwareRenderer::drawTransparentPixels(x, farStart, farEnd, farCeilingScreenY,
-					farFloorScreenY, farZ, farU, 0.0, Constants::JustBelowOne, farNormal, 
-					textures.at(chasmData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::Door)
+		if (occlusion.yMin == occlusion.yMax)
 		{
-			// To do: find intersection via SoftwareRenderer::findDoorIntersection().
+			frame.stats->occludedColumns++;
+		}
+	}
 
-			// Just render as transparent wall for now.
-			const VoxelData::DoorData &doorData = voxelData.door;
+	if (frame.columnCosts != nullptr)
+	{
+		frame.columnCosts[x].voxelSteps += stepCount;
+	}
+}
 
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				voxelYReal + voxelHeight,
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				voxelYReal,
-				nearPoint.y);
+void SoftwareRenderer::getFlatColumnRange(const FlatFrame &flatFrame, int *startColumn,
+	int *endColumn) const
+{
+	// Columns that the flat's projected X range touches, rounded outward.
+	const double startX = std::min(flatFrame.startX, flatFrame.endX);
+	const double endX = std::max(flatFrame.startX, flatFrame.endX);
+	const int lowerColumn = SoftwareRenderer::getLowerBoundedPixel(
+		startX * static_cast<double>(this->width), this->width);
+	const int upperColumn = SoftwareRenderer::getUpperBoundedPixel(
+		endX * static_cast<double>(this->width), this->width);
+
+	*startColumn = std::max(lowerColumn - 1, 0);
+	*endColumn = std::min(upperColumn + 1, this->width);
+}
 
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
+void SoftwareRenderer::updateFlatColumns()
+{
+	ProfileScope("SoftwareRenderer::updateFlatColumns");
 
-			const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearCeilingScreenY, frame.height);
-			const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearFloorScreenY, frame.height);
+	for (const FlatFrame &flatFrame : this->visibleFlats)
+	{
+		int startColumn, endColumn;
+		this->getFlatColumnRange(flatFrame, &startColumn, &endColumn);
 
-			SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-				nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
-				textures.at(doorData.id), shadingInfo, occlusion, frame);
+		for (int x = startColumn; x < endColumn; x++)
+		{
+			this->occlusion[x].hasFlats = true;
 		}
-	};
+	}
+}
+
+void SoftwareRenderer::binVisibleFlats(int tileCount)
+{
+	ProfileScope("SoftwareRenderer::binVisibleFlats");
 
-	auto drawVoxelAbove = [x, voxelX, voxelZ, &camera, &ray, facing, &wallNormal, &nearPoint,
-		&farPoint, nearZ, farZ, wallU, &shadingInfo, ceilingHeight, &voxelGrid, &textures,
-		&occlusion, &frame](int voxelY)
+	// Keep each tile's list allocated between frames.
+	this->flatTiles.resize(tileCount);
+	for (auto &tileFlats : this->flatTiles)
 	{
-		const uint16_t voxelID = voxelGrid.getVoxels()[voxelX + (voxelY * voxelGrid.getWidth()) +
-			(voxelZ * voxelGrid.getWidth() * voxelGrid.getHeight())];
-		const VoxelData &voxelData = voxelGrid.getVoxelData(voxelID);
-		const double voxelYReal = static_cast<double>(voxelY);
-
-		// Height of the voxel depends on whether it's the main floor.
-		const double voxelHeight = (voxelY == 1) ? ceilingHeight : 1.0;
-
-		if (voxelData.dataType == VoxelDataType::Wall)
-		{
-			const VoxelData::WallData &wallData = voxelData.wall;
-
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				voxelYReal + voxelHeight,
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				voxelYReal,
-				nearPoint.y);
-			const Double3 farFloorPoint(
-				farPoint.x,
-				nearFloorPoint.y,
-				farPoint.y);
-
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-				farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-			const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearCeilingScreenY, frame.height);
-			const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearFloorScreenY, frame.height);
-			const int floorStart = wallEnd;
-			const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-				farFloorScreenY, frame.height);
-			
-			// Side.
-			SoftwareRenderer::drawPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-				nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
-				textures.at(wallData.sideID), shadingInfo, occlusion, frame);
-
-			// Floor.
-			SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-				nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
-				farZ, -Double3::UnitY, textures.at(wallData.floorID),
-				shadingInfo, occlusion, frame);
-		}
-		else if (voxelData.dataType == VoxelDataType::Floor)
-		{
-			// Do nothing. Floors can only be seen from above.
-		}
-		else if (voxelData.dataType == VoxelDataType::Ceiling)
-		{
-			// Draw bottom of ceiling voxel.
-			const VoxelData::CeilingData &ceilingData = voxelData.ceiling;
-
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				1.0 + ceilingHeight,
-				nearPoint.y);
-			const Double3 farFloorPoint(
-				farPoint.x,
-				nearFloorPoint.y,
-				farPoint.y);
-
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-				farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-			const int floorStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearFloorScreenY, frame.height);
-			const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-				farFloorScreenY, frame.height);
-
-			SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-				nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
-				farZ, -Double3::UnitY, textures.at(ceilingData.id), shadingInfo,
-				occlusion, frame);
-		}
-		else if (voxelData.dataType == VoxelDataType::Raised)
-		{
-			const VoxelData::RaisedData &raisedData = voxelData.raised;
-
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				voxelYReal + ((raisedData.yOffset + raisedData.ySize) * voxelHeight),
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				voxelYReal + (raisedData.yOffset * voxelHeight),
-				nearPoint.y);
-
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-			const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearCeilingScreenY, frame.height);
-			const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearFloorScreenY, frame.height);
-
-			// Draw order depends on the player's Y position relative to the platform.
-			if (camera.eye.y > nearCeilingPoint.y)
-			{
-				// Above platform.
-				const Double3 farCeilingPoint(
-					farPoint.x,
-					nearCeilingPoint.y,
-					farPoint.y);
-
-				const double farCeilingScreenY = SoftwareRenderer::getProjectedY(
-					farCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int ceilingStart = SoftwareRenderer::getLowerBoundedPixel(
-					farCeilingScreenY, frame.height);
-				const int ceilingEnd = wallStart;
-
-				// Ceiling.
-				SoftwareRenderer::drawPerspectivePixels(x, ceilingStart, ceilingEnd,
-					farCeilingScreenY, nearCeilingScreenY, farPoint, nearPoint, farZ,
-					nearZ, Double3::UnitY, textures.at(raisedData.ceilingID),
-					shadingInfo, occlusion, frame);
-
-				// Side.
-				SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-					nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
-					wallNormal, textures.at(raisedData.sideID), shadingInfo, 
-					occlusion, frame);
-			}
-			else if (camera.eye.y < nearFloorPoint.y)
-			{
-				// Below platform.
-				const Double3 farFloorPoint(
-					farPoint.x,
-					nearFloorPoint.y,
-					farPoint.y);
-
-				const double farFloorScreenY = SoftwareRenderer::getProjectedY(
-					farFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int floorStart = wallEnd;
-				const int floorEnd = SoftwareRenderer::getUpperBoundedPixel(
-					farFloorScreenY, frame.height);
-
-				// Side.
-				SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-					nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
-					wallNormal, textures.at(raisedData.sideID), shadingInfo, occlusion, frame);
-
-				// Floor.
-				SoftwareRenderer::drawPerspectivePixels(x, floorStart, floorEnd,
-					nearFloorScreenY, farFloorScreenY, nearPoint, farPoint, nearZ,
-					farZ, -Double3::UnitY, textures.at(raisedData.floorID),
-					shadingInfo, occlusion, frame);
-			}
-			else
+		tileFlats.clear();
+	}
+
+	// Visible flats are already sorted, so each tile's flats stay back to front.
+	for (size_t i = 0; i < this->visibleFlats.size(); i++)
+	{
+		int startColumn, endColumn;
+		this->getFlatColumnRange(this->visibleFlats[i], &startColumn, &endColumn);
+
+		if (startColumn < endColumn)
+		{
+			const int startTile = startColumn / SoftwareRenderer::COLUMN_TILE_WIDTH;
+			const int endTile = (endColumn - 1) / SoftwareRenderer::COLUMN_TILE_WIDTH;
+
+			for (int tile = startTile; tile <= endTile; tile++)
 			{
-				// Between top and bottom.
-				SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-					nearFloorScreenY, nearZ, wallU, raisedData.vTop, raisedData.vBottom,
-					wallNormal, textures.at(raisedData.sideID), shadingInfo,
-					occlusion, frame);
+				this->flatTiles[tile].push_back(static_cast<int>(i));
 			}
 		}
-		else if (voxelData.dataType == VoxelDataType::Diagonal)
-		{
-			const VoxelData::DiagonalData &diagData = voxelData.diagonal;
+	}
+}
 
-			// Find intersection.
-			RayHit hit;
-			const bool success = diagData.type1 ?
-				SoftwareRenderer::findDiag1Intersection(voxelX, voxelZ, nearPoint, farPoint, hit) :
-				SoftwareRenderer::findDiag2Intersection(voxelX, voxelZ, nearPoint, farPoint, hit);
+void SoftwareRenderer::renderScene(const Double3 &eye, const Double3 &direction, double fovY,
+	double ambient, double daytimePercent, double ceilingHeight, const VoxelGrid &voxelGrid, 
+	OcclusionMode occlusionMode, uint32_t *colorBuffer)
+{
+	ProfileScope("SoftwareRenderer::renderScene");
 
-			if (success)
-			{
-				double diagTopScreenY, diagBottomScreenY;
-				int diagStart, diagEnd;
+	assert(occlusionMode != OcclusionMode::Compare);
 
-				SoftwareRenderer::diagProjection(voxelYReal, voxelHeight, hit.point,
-					camera.transform, camera.yShear, frame.height, frame.heightReal,
-					diagTopScreenY, diagBottomScreenY, diagStart, diagEnd);
+	// Timestamps are only taken for the render stats.
+	const auto setupStartTime = this->renderStatsEnabled ?
+		std::chrono::high_resolution_clock::now() :
+		std::chrono::high_resolution_clock::time_point();
 
-				SoftwareRenderer::drawPixels(x, diagStart, diagEnd, diagTopScreenY,
-					diagBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
-					hit.normal, textures.at(diagData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::TransparentWall)
-		{
-			// Draw transparent side.
-			const VoxelData::TransparentWallData &transparentWallData = voxelData.transparentWall;
+	// Constants for screen dimensions.
+	const double widthReal = static_cast<double>(this->width);
+	const double heightReal = static_cast<double>(this->height);
+	const double aspect = widthReal / heightReal;
 
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				voxelYReal + voxelHeight,
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				voxelYReal,
-				nearPoint.y);
+	// 2.5D camera definition.
+	const Camera camera(eye, direction, fovY, aspect);
 
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
+	// The visible set only applies to the voxels it was baked from.
+	const PotentiallyVisibleSet *visibleSet =
+		((this->visibleSet.get() != nullptr) && this->visibleSet->isCurrent(voxelGrid)) ?
+		this->visibleSet.get() : nullptr;
 
-			const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearCeilingScreenY, frame.height);
-			const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearFloorScreenY, frame.height);
+	// Find and sort the visible flats on a worker while the rest of the frame is set up.
+	const JobSystem::JobHandle visibleFlatsJob = this->jobSystem.add([this, &camera,
+		visibleSet]()
+	{
+		this->updateVisibleFlats(camera, visibleSet);
+	}, std::vector<JobSystem::JobHandle>(), std::function<void()>(),
+		JobSystem::Priority::Frame);
 
-			SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-				nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
-				textures.at(transparentWallData.id), shadingInfo, occlusion, frame);
-		}
-		else if (voxelData.dataType == VoxelDataType::Edge)
-		{
-			const VoxelData::EdgeData &edgeData = voxelData.edge;
+	// Ray directions for each column only change with the FOV and screen dimensions.
+	this->updateColumnRayDirections(camera);
 
-			// Find intersection.
-			RayHit hit;
-			const bool success = SoftwareRenderer::findEdgeIntersection(voxelX, voxelZ,
-				edgeData.facing, facing, nearPoint, farPoint, wallU, camera, ray, hit);
+	// Voxel data types only change with the voxel grid.
+	this->updateVoxelDataTypes(voxelGrid);
 
-			if (success)
-			{
-				const Double3 edgeTopPoint(
-					hit.point.x,
-					voxelYReal + voxelHeight + edgeData.yOffset,
-					hit.point.y);
-
-				const Double3 edgeBottomPoint(
-					hit.point.x,
-					voxelYReal + edgeData.yOffset,
-					hit.point.y);
-
-				const double edgeTopScreenY = SoftwareRenderer::getProjectedY(
-					edgeTopPoint, camera.transform, camera.yShear) * frame.heightReal;
-				const double edgeBottomScreenY = SoftwareRenderer::getProjectedY(
-					edgeBottomPoint, camera.transform, camera.yShear) * frame.heightReal;
-
-				const int edgeStart = SoftwareRenderer::getLowerBoundedPixel(
-					edgeTopScreenY, frame.height);
-				const int edgeEnd = SoftwareRenderer::getUpperBoundedPixel(
-					edgeBottomScreenY, frame.height);
-
-				SoftwareRenderer::drawTransparentPixels(x, edgeStart, edgeEnd, edgeTopScreenY,
-					edgeBottomScreenY, nearZ + hit.innerZ, hit.u, 0.0, Constants::JustBelowOne,
-					hit.normal, textures.at(edgeData.id), shadingInfo, occlusion, frame);
-			}
-		}
-		else if (voxelData.dataType == VoxelDataType::Chasm)
-		{
-			// Ignore. Chasms should never be above the player's voxel.
-		}
-		else if (voxelData.dataType == VoxelDataType::Door)
-		{
-			// To do: find intersection via SoftwareRenderer::findDoorIntersection().
+	// Calculate shading information.
+	const Double3 horizonFogColor = this->getFogColor(daytimePercent);
+	const Double3 zenithFogColor = horizonFogColor * 0.85; // Temp.
+	const Double3 sunDirection = this->getSunDirection(daytimePercent);
+	const Double3 sunColor = [&sunDirection]()
+	{
+		const Double3 baseColor(0.90, 0.875, 0.85);
 
-			// Just render as transparent wall for now.
-			const VoxelData::DoorData &doorData = voxelData.door;
+		// Darken the sun color if it's below the horizon so wall faces aren't lit 
+		// as much during the night. This is just an artistic value to compensate
+		// for the lack of shadows.
+		return (sunDirection.y >= 0.0) ? baseColor :
+			(baseColor * (1.0 - (5.0 * std::abs(sunDirection.y)))).clamped();
+	}();
 
-			const Double3 nearCeilingPoint(
-				nearPoint.x,
-				voxelYReal + voxelHeight,
-				nearPoint.y);
-			const Double3 nearFloorPoint(
-				nearPoint.x,
-				voxelYReal,
-				nearPoint.y);
+	// Normal of all flats (always facing the camera).
+	const Double3 flatNormal = Double3(-camera.forwardX, 0.0, -camera.forwardZ).normalized();
 
-			const double nearCeilingScreenY = SoftwareRenderer::getProjectedY(
-				nearCeilingPoint, camera.transform, camera.yShear) * frame.heightReal;
-			const double nearFloorScreenY = SoftwareRenderer::getProjectedY(
-				nearFloorPoint, camera.transform, camera.yShear) * frame.heightReal;
+	// Create some helper structs to keep similar values together. Shading for each facing
+	// and the depth-to-fog table are calculated here once for the whole frame.
+	ShadingInfo shadingInfo(horizonFogColor, zenithFogColor, sunColor, 
+		sunDirection, ambient, this->fogDistance, flatNormal, 
+		this->forceBaseMipLevel ? 0 : (VoxelTexture::MIP_LEVEL_COUNT - 1));
 
-			const int wallStart = SoftwareRenderer::getLowerBoundedPixel(
-				nearCeilingScreenY, frame.height);
-			const int wallEnd = SoftwareRenderer::getUpperBoundedPixel(
-				nearFloorScreenY, frame.height);
+	// Paletted rendering looks up voxel colors in tables made from the frame's shading.
+	// Deferred shading needs the texels themselves, so it takes priority.
+	shadingInfo.deferred = this->deferredShading;
+	if (this->palettedRendering && !shadingInfo.deferred)
+	{
+		this->updatePaletteShades(shadingInfo);
+		shadingInfo.paletteShades = this->paletteShades.data();
 
-			SoftwareRenderer::drawTransparentPixels(x, wallStart, wallEnd, nearCeilingScreenY,
-				nearFloorScreenY, nearZ, wallU, 0.0, Constants::JustBelowOne, wallNormal,
-				textures.at(doorData.id), shadingInfo, occlusion, frame);
+		// Liquids are animated by cycling their colors instead of swapping their textures.
+		if (this->liquidTextureMask != 0)
+		{
+			this->updateCycledIndices();
+			shadingInfo.cycledIndices = this->cycledIndices.data();
 		}
-	};
-
-	// Draw voxel straight ahead first.
-	drawVoxel();
+	}
 
-	// Draw voxels below the voxel.
-	for (int voxelY = (camera.eyeVoxel.y - 1); voxelY >= 0; voxelY--)
+	// Lights only need to be sorted into the grid again when one of them changes.
+	if (this->lightGridDirty)
 	{
-		drawVoxelBelow(voxelY);
+		this->updateLightGrid();
+		this->lightGridDirty = false;
 	}
 
-	// Draw voxels above the voxel.
-	for (int voxelY = (camera.eyeVoxel.y + 1); voxelY < voxelGrid.getHeight(); voxelY++)
+	if (this->columnRays.size() != static_cast<size_t>(this->width))
 	{
-		drawVoxelAbove(voxelY);
+		this->columnRays.resize(this->width);
 	}
-}
 
-void SoftwareRenderer::drawFlat(int startX, int endX, const Flat::Frame &flatFrame,
-	const Double3 &normal, bool flipped, const Double2 &eye, const ShadingInfo &shadingInfo,
-	const FlatTexture &texture, const FrameView &frame)
-{
-	// Contribution from the sun.
-	const double lightNormalDot = std::max(0.0, shadingInfo.sunDirection.dot(normal));
-	const Double3 sunComponent = (shadingInfo.sunColor * lightNormalDot).clamped(
-		0.0, 1.0 - shadingInfo.ambient);
+	shadingInfo.lightGrid = &this->lightGrid;
+	shadingInfo.lightMap = this->lightMap.get();
+	shadingInfo.columnRays = this->columnRays.data();
+	shadingInfo.eye2D = Double2(eye.x, eye.z);
+	shadingInfo.nightLightsActive = this->nightLightsActive;
+	shadingInfo.nightLightIndex = this->nightLightIndex;
+	shadingInfo.perspectiveSpanLength = this->perspectiveSpanLength;
+
+	// The background only changes with the Y-shear and sky colors, but it's a few hundred
+	// rows at most, so it's just made again every frame.
+	this->updateSkyRowColors(camera, shadingInfo);
+	shadingInfo.skyRowColors = this->skyRowColors.data();
+	shadingInfo.doorOpenPercents = &this->doorOpenPercents;
+
+	// In column-major mode, the scene is drawn into a separate buffer and each column tile
+	// is transposed into the output as soon as it's done, while it's still in the cache.
+	const bool columnMajor = this->columnMajorRendering;
+	if (columnMajor)
+	{
+		this->columnMajorBuffer.resize(this->width * this->height);
+	}
 
-	// X percents across the screen for the given start and end columns.
-	const double startXPercent = (static_cast<double>(startX) + 0.50) / 
-		static_cast<double>(frame.width);
-	const double endXPercent = (static_cast<double>(endX) + 0.50) /
-		static_cast<double>(frame.width);
+	FrameView frame(columnMajor ? this->columnMajorBuffer.data() : colorBuffer,
+		this->depthBuffer.data(), this->width, this->height, columnMajor);
 
-	const bool startsInRange =
-		(flatFrame.startX >= startXPercent) && (flatFrame.startX <= endXPercent);
-	const bool endsInRange = 
-		(flatFrame.endX >= startXPercent) && (flatFrame.endX <= endXPercent);
-	const bool coversRange =
-		(flatFrame.startX <= startXPercent) && (flatFrame.endX >= endXPercent);
-	
-	// Throw out the draw call if the flat is not in the X range.
-	if (!startsInRange && !endsInRange && !coversRange)
+	// The G-buffer has the same layout as the frame being drawn into.
+	if (shadingInfo.deferred)
 	{
-		return;
+		this->gBufferTexels.resize(this->width * this->height);
+		this->gBufferShading.resize(this->width * this->height);
+		frame.texelBuffer = this->gBufferTexels.data();
+		frame.shadingBuffer = this->gBufferShading.data();
 	}
 
-	// Get the min and max X range of coordinates in screen-space. This range is completely 
-	// contained within the flat.
-	const double clampedStartXPercent = std::max(startXPercent,
-		std::min(flatFrame.startX, flatFrame.endX));
-	const double clampedEndXPercent = std::min(endXPercent,
-		std::max(flatFrame.startX, flatFrame.endX));
+	// Interlacing draws every other column, and needs at least one neighbor to fill in the
+	// rest from.
+	const bool interlaced = this->interlacedRendering && (this->width > 1);
+	if (interlaced)
+	{
+		frame.columnParity = this->interlaceParity;
+	}
 
-	// The percentages from start to end within the flat.
-	const double startFlatPercent = (clampedStartXPercent - flatFrame.startX) /
-		(flatFrame.endX - flatFrame.startX);
-	const double endFlatPercent = (clampedEndXPercent - flatFrame.startX) /
-		(flatFrame.endX - flatFrame.startX);
+	// Foveated rendering thins out the columns toward the edges, where wide views stretch
+	// the most pixels over the least of the scene. Interlacing already skips columns all
+	// over, so they aren't combined.
+	const bool foveated = !interlaced && (this->foveatedColumnStride > 1);
+	if (foveated)
+	{
+		const int foveaWidth = static_cast<int>(std::ceil(
+			static_cast<double>(this->width) * SoftwareRenderer::FOVEA_WIDTH_PERCENT));
+		frame.foveaStart = (this->width - foveaWidth) / 2;
+		frame.foveaEnd = frame.foveaStart + foveaWidth;
+		frame.edgeColumnStride = this->foveatedColumnStride;
+	}
 
-	// Points interpolated between for per-column depth calculations in the XZ plane.
-	const Double3 startTopPoint = flatFrame.topStart.lerp(flatFrame.topEnd, startFlatPercent);
-	const Double3 endTopPoint = flatFrame.topStart.lerp(flatFrame.topEnd, endFlatPercent);
+	// The cost view's counters start over with each pass, so a compared frame shows the
+	// culled one.
+	if (this->costView != CostView::Off)
+	{
+		this->overdrawCounts.assign(this->width * this->height, 0);
+		this->columnCosts.assign(this->width, ColumnCost());
+		frame.overdrawCounts = this->overdrawCounts.data();
+		frame.columnCosts = this->columnCosts.data();
+	}
 
-	// Horizontal texture coordinates in the flat. Although the flat percent can be
-	// equal to 1.0, the texture coordinate needs to be less than 1.0.
-	const double startU = std::max(std::min(startFlatPercent, Constants::JustBelowOne), 0.0);
-	const double endU = std::max(std::min(endFlatPercent, Constants::JustBelowOne), 0.0);
+	// Lambda for rendering some columns of pixels. The voxel rendering portion uses 2.5D 
+	// ray casting, which is the cheaper form of ray casting (although still not very 
+	// efficient overall), and results in a "fake" 3D scene.
+	auto renderColumns = [this, &camera, ceilingHeight, &voxelGrid, &shadingInfo](
+		int startX, int endX, const std::vector<int> &tileFlats, const FrameView &frame)
+	{
+		ProfileScope("SoftwareRenderer::renderColumns");
 
-	// Get the start and end coordinates of the projected points (Y values potentially
-	// outside the screen).
-	const double projectedXStart = clampedStartXPercent * frame.widthReal;
-	const double projectedXEnd = clampedEndXPercent * frame.widthReal;
-	const double projectedYStart = flatFrame.startY * frame.heightReal;
-	const double projectedYEnd = flatFrame.endY * frame.heightReal;
+		const bool timed = frame.stats != nullptr;
+		const auto voxelStartTime = timed ? std::chrono::high_resolution_clock::now() :
+			std::chrono::high_resolution_clock::time_point();
 
-	// Clamp the coordinates for where the flat starts and stops on the screen.
-	const int xStart = SoftwareRenderer::getLowerBoundedPixel(projectedXStart, frame.width);
-	const int xEnd = SoftwareRenderer::getUpperBoundedPixel(projectedXEnd, frame.width);
-	const int yStart = SoftwareRenderer::getLowerBoundedPixel(projectedYStart, frame.height);
-	const int yEnd = SoftwareRenderer::getUpperBoundedPixel(projectedYEnd, frame.height);
+		if (frame.planes != nullptr)
+		{
+			frame.planes->reset(startX);
+		}
 
-	// Shading on the texture.
-	// - To do: contribution from lights.
-	const Double3 shading(
-		shadingInfo.ambient + sunComponent.x,
-		shadingInfo.ambient + sunComponent.y,
-		shadingInfo.ambient + sunComponent.z);
+		if (frame.fragments != nullptr)
+		{
+			frame.fragments->reset(startX, frame.height);
+		}
 
-	// Draw by-column, similar to wall rendering.
-	for (int x = xStart; x < xEnd; x++)
-	{
-		const double xPercent = ((static_cast<double>(x) + 0.50) - projectedXStart) /
-			(projectedXEnd - projectedXStart);
+		for (int x = startX; x < endX; x++)
+		{
+			if (!frame.drawsColumn(x))
+			{
+				continue;
+			}
 
-		// Horizontal texture coordinate.
-		const double u = startU + ((endU - startU) * xPercent);
+			// Rotate the column's camera-space ray direction by the camera's yaw. Forward 
+			// and right are perpendicular unit vectors, so it stays normalized.
+			const Double2 &cameraDirection = this->columnRayDirections[x];
+			const Ray ray(
+				(camera.forwardX * cameraDirection.x) + (camera.rightX * cameraDirection.y),
+				(camera.forwardZ * cameraDirection.x) + (camera.rightZ * cameraDirection.y));
+			this->columnRays[x] = Double2(ray.dirX, ray.dirZ);
 
-		// Horizontal texel position.
-		const int textureX = static_cast<int>(
-			(flipped ? (Constants::JustBelowOne - u) : u) *
-			static_cast<double>(texture.width));
+			OcclusionData &occlusion = this->occlusion.at(x);
 
-		const Double3 topPoint = startTopPoint.lerp(endTopPoint, xPercent);
+			// When every pixel is depth tested, the whole column needs its background first.
+			if (occlusion.depthTest)
+			{
+				SoftwareRenderer::clearUnoccludedPixels(x, occlusion, shadingInfo, frame);
+			}
 
-		// Get the true XZ distance for the depth.
-		const double depth = (Double2(topPoint.x, topPoint.z) - eye).length();
+			// Cast the 2D ray and fill in the column's pixels with color.
+			this->rayCast2D(x, camera, ray, shadingInfo, ceilingHeight, voxelGrid,
+				this->voxelDataTypes.data(), this->voxelTextures, occlusion, frame);
 
-		// Linearly interpolated fog.
-		const Double3 &fogColor = shadingInfo.horizonSkyColor;
-		const double fogPercent = std::min(depth / shadingInfo.fogDistance, 1.0);
+			// Otherwise, only the pixels that no voxel covered get the background.
+			if (!occlusion.depthTest)
+			{
+				SoftwareRenderer::clearUnoccludedPixels(x, occlusion, shadingInfo, frame);
+			}
+		}
 
-		for (int y = yStart; y < yEnd; y++)
+		// Floors and ceilings gathered during ray casting are drawn before the flats are 
+		// tested against their depth.
+		if (frame.planes != nullptr)
 		{
-			const int index = x + (y * frame.width);
+			SoftwareRenderer::drawPlaneRows(camera, this->columnDepthScales.data(),
+				this->voxelTextures, shadingInfo, frame);
+		}
 
-			if (depth <= frame.depthBuffer[index])
-			{
-				const double yPercent = ((static_cast<double>(y) + 0.50) - projectedYStart) /
-					(projectedYEnd - projectedYStart);
+		const auto flatStartTime = timed ? std::chrono::high_resolution_clock::now() :
+			std::chrono::high_resolution_clock::time_point();
 
-				// Vertical texture coordinate.
-				const double startV = 0.0;
-				const double endV = Constants::JustBelowOne;
-				const double v = startV + ((endV - startV) * yPercent);
+		// Summarize the tile's depth so flats behind walls can be skipped.
+		if ((frame.tileOcclusion != nullptr) && (tileFlats.size() > 0))
+		{
+			frame.tileOcclusion->update(startX, endX, this->occlusion, frame);
+		}
 
-				// Vertical texel position.
-				const int textureY = static_cast<int>(v * static_cast<double>(texture.height));
+		// Iterate through the flats binned to these columns, rendering those visible within 
+		// the given X range of the screen.
+		for (const int flatIndex : tileFlats)
+		{
+			const FlatFrame &flatFrame = this->visibleFlats[flatIndex];
 
-				// Alpha is checked in this loop, and transparent texels are not drawn.
-				// Flats do not have emission, so ignore it.
-				const int textureIndex = textureX + (textureY * texture.width);
-				const FlatTexel &texel = texture.texels[textureIndex];
+			// Texture of the flat at its level of detail. It might be flipped horizontally
+			// as well, given by the "flatFrame.flipped" value.
+			const FlatTextureSet &textureSet = this->getFlatTextureSet(flatFrame.textureID);
+			const FlatTexture &texture = (flatFrame.lodLevel == 0) ?
+				textureSet.texture : textureSet.lods[flatFrame.lodLevel - 1];
 
-				if (texel.a > 0.0)
-				{
-					// Texture color with shading.
-					const double shadingMax = 1.0;
-					double colorR = texel.r * std::min(shading.x, shadingMax);
-					double colorG = texel.g * std::min(shading.y, shadingMax);
-					double colorB = texel.b * std::min(shading.z, shadingMax);
-
-					// Linearly interpolate with fog.
-					colorR += (fogColor.x - colorR) * fogPercent;
-					colorG += (fogColor.y - colorG) * fogPercent;
-					colorB += (fogColor.z - colorB) * fogPercent;
-
-					// Clamp maximum (don't worry about negative values).
-					const double high = 1.0;
-					colorR = (colorR > high) ? high : colorR;
-					colorG = (colorG > high) ? high : colorG;
-					colorB = (colorB > high) ? high : colorB;
-
-					// Convert floats to integers.
-					const uint32_t colorRGB = static_cast<uint32_t>(
-						((static_cast<uint8_t>(colorR * 255.0)) << 16) |
-						((static_cast<uint8_t>(colorG * 255.0)) << 8) |
-						((static_cast<uint8_t>(colorB * 255.0))));
-
-					frame.colorBuffer[index] = colorRGB;
-					frame.depthBuffer[index] = depth;
-				}
+			const Double2 eye2D(camera.eye.x, camera.eye.z);
+
+			if (flatFrame.drawsAsDot)
+			{
+				SoftwareRenderer::drawFlatDot(startX, endX, flatFrame, eye2D, shadingInfo,
+					texture, frame);
+			}
+			else
+			{
+				SoftwareRenderer::drawFlat(startX, endX, flatFrame, flatFrame.flipped, eye2D,
+					shadingInfo, texture, frame);
 			}
 		}
-	}
-}
 
-void SoftwareRenderer::rayCast2D(int x, const Camera &camera, const Ray &ray,
-	const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
-	const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame)
-{
-	// Initially based on Lode Vandevenne's algorithm, this method of 2.5D ray casting is more 
-	// expensive as it does not stop at the first wall intersection, and it also renders voxels 
-	// above and below the current floor.
+		if (timed)
+		{
+			const auto flatEndTime = std::chrono::high_resolution_clock::now();
+			frame.stats->voxelSeconds += std::chrono::duration<double>(
+				flatStartTime - voxelStartTime).count();
+			frame.stats->flatSeconds += std::chrono::duration<double>(
+				flatEndTime - flatStartTime).count();
+		}
 
-	// Some floating point behavior assumptions:
-	// -> (value / 0.0) == infinity
-	// -> (value / infinity) == 0.0
-	// -> (int)(-0.8) == 0
-	// -> (int)floor(-0.8) == -1
-	// -> (int)ceil(-0.8) == 0
+		// Everything in the tile is in the G-buffer now, so it can be shaded while it's
+		// still in the cache.
+		if (frame.texelBuffer != nullptr)
+		{
+			SoftwareRenderer::shadeDeferredPixels(startX, endX, shadingInfo, frame);
+		}
 
-	const double dirXSquared = ray.dirX * ray.dirX;
-	const double dirZSquared = ray.dirZ * ray.dirZ;
+		// Translucent flat pixels go over the finished colors.
+		if (frame.fragments != nullptr)
+		{
+			frame.fragments->resolve(frame);
+		}
+	};
 
-	const double deltaDistX = std::sqrt(1.0 + (dirZSquared / dirXSquared));
-	const double deltaDistZ = std::sqrt(1.0 + (dirXSquared / dirZSquared));
+	// Reset occlusion.
+	const bool culling = occlusionMode == OcclusionMode::Culling;
+	std::fill(this->occlusion.begin(), this->occlusion.end(), 
+		OcclusionData(0, this->height, culling));
 
-	const bool nonNegativeDirX = ray.dirX >= 0.0;
-	const bool nonNegativeDirZ = ray.dirZ >= 0.0;
+	// The visible flats must be ready before anything else looks at them.
+	this->jobSystem.wait(visibleFlatsJob);
 
-	int stepX, stepZ;
-	double sideDistX, sideDistZ;
-	if (nonNegativeDirX)
-	{
-		stepX = 1;
-		sideDistX = (camera.eyeVoxelReal.x + 1.0 - camera.eye.x) * deltaDistX;
-	}
-	else
+	// Opaque pixels only need to write depth where flats will be tested against them.
+	if (culling)
 	{
-		stepX = -1;
-		sideDistX = (camera.eye.x - camera.eyeVoxelReal.x) * deltaDistX;
+		this->updateFlatColumns();
 	}
 
-	if (nonNegativeDirZ)
-	{
-		stepZ = 1;
-		sideDistZ = (camera.eyeVoxelReal.z + 1.0 - camera.eye.z) * deltaDistZ;
-	}
-	else
+	// Split the screen into column tiles, and give each tile only the flats that overlap it.
+	const int tileCount = (this->width + SoftwareRenderer::COLUMN_TILE_WIDTH - 1) /
+		SoftwareRenderer::COLUMN_TILE_WIDTH;
+	this->binVisibleFlats(tileCount);
+
+	// Render the scene with the render threads. Each thread claims column tiles from a 
+	// shared counter until none are left.
+	std::atomic<int> nextTile(0);
+
+	// Each thread counts into its own stats, so they don't need to be shared.
+	for (auto &stats : this->threadStats)
 	{
-		stepZ = -1;
-		sideDistZ = (camera.eye.z - camera.eyeVoxelReal.z) * deltaDistZ;
+		stats = RenderStats();
 	}
 
-	// Pointer to voxel ID grid data.
-	const uint16_t *voxels = voxelGrid.getVoxels();
+	// Plane spans rely on culling to know that nothing else draws over them.
+	const bool rowPlanes = this->rowPlaneRendering && culling;
+	if (rowPlanes)
+	{
+		const size_t pixelCount = static_cast<size_t>(
+			SoftwareRenderer::COLUMN_TILE_WIDTH * this->height);
 
-	// The Z distance from the camera to the wall, and the X or Z normal of the intersected
-	// voxel face. The first Z distance is a special case, so it's brought outside the 
-	// DDA loop.
-	double zDistance;
-	VoxelData::Facing facing;
+		for (auto &planes : this->threadPlanes)
+		{
+			if (planes.pixelSpans.size() != pixelCount)
+			{
+				planes.pixelSpans.assign(pixelCount, 0);
+			}
+		}
+	}
 
-	// Verify that the initial voxel coordinate is within the world bounds.
-	bool voxelIsValid = 
-		(camera.eyeVoxel.x >= 0) && 
-		(camera.eyeVoxel.y >= 0) && 
-		(camera.eyeVoxel.z >= 0) &&
-		(camera.eyeVoxel.x < voxelGrid.getWidth()) && 
-		(camera.eyeVoxel.y < voxelGrid.getHeight()) &&
-		(camera.eyeVoxel.z < voxelGrid.getDepth());
+	const auto passStartTime = std::chrono::high_resolution_clock::now();
 
-	if (voxelIsValid)
+	const int activeThreadCount = this->activeThreadCount;
+	this->jobSystem.parallelFor(activeThreadCount, [this, &renderColumns, &nextTile, &frame,
+		tileCount, columnMajor, colorBuffer, rowPlanes](int threadIndex)
 	{
-		// Decide how far the wall is, and which voxel face was hit.
-		if (sideDistX < sideDistZ)
+		std::chrono::high_resolution_clock::duration busyTime(0);
+
+		FrameView threadFrame = frame;
+		if (this->renderStatsEnabled)
 		{
-			zDistance = sideDistX;
-			facing = nonNegativeDirX ? VoxelData::Facing::NegativeX : 
-				VoxelData::Facing::PositiveX;
+			threadFrame.stats = &this->threadStats[threadIndex];
 		}
-		else
+
+		if (rowPlanes)
 		{
-			zDistance = sideDistZ;
-			facing = nonNegativeDirZ ? VoxelData::Facing::NegativeZ : 
-				VoxelData::Facing::PositiveZ;
+			threadFrame.planes = &this->threadPlanes[threadIndex];
 		}
 
-		// The initial near point is directly in front of the player in the near Z 
-		// camera plane.
-		const Double2 initialNearPoint(
-			camera.eye.x + (ray.dirX * SoftwareRenderer::NEAR_PLANE),
-			camera.eye.z + (ray.dirZ * SoftwareRenderer::NEAR_PLANE));
+		threadFrame.tileOcclusion = &this->threadTileOcclusion[threadIndex];
+		threadFrame.fragments = &this->threadFragments[threadIndex];
 
-		// The initial far point is the wall hit. This is used with the player's position 
-		// for drawing the initial floor and ceiling.
-		const Double2 initialFarPoint(
-			camera.eye.x + (ray.dirX * zDistance),
-			camera.eye.z + (ray.dirZ * zDistance));
+		std::vector<uint8_t> &touchedVoxels = this->threadTouchedVoxels[threadIndex];
+		touchedVoxels.assign(this->voxelDataTypes.size(), 0);
+		threadFrame.touchedVoxels = touchedVoxels.data();
 
-		// Draw all voxels in a column at the player's XZ coordinate.
-		SoftwareRenderer::drawInitialVoxelColumn(x, camera.eyeVoxel.x, camera.eyeVoxel.z,
-			camera, ray, facing, initialNearPoint, initialFarPoint, SoftwareRenderer::NEAR_PLANE, 
-			zDistance, shadingInfo, ceilingHeight, voxelGrid, textures, occlusion, frame);
-	}
+		int tile = nextTile.fetch_add(1);
+		while (tile < tileCount)
+		{
+			const int startX = tile * SoftwareRenderer::COLUMN_TILE_WIDTH;
+			const int endX = std::min(startX + SoftwareRenderer::COLUMN_TILE_WIDTH, this->width);
 
-	// The current voxel coordinate in the DDA loop. For all intents and purposes,
-	// the Y cell coordinate is constant.
-	Int3 cell(camera.eyeVoxel.x, camera.eyeVoxel.y, camera.eyeVoxel.z);
+			const auto tileStartTime = std::chrono::high_resolution_clock::now();
+			renderColumns(startX, endX, this->flatTiles[tile], threadFrame);
 
-	// Lambda for stepping to the next XZ coordinate in the grid and updating the Z
-	// distance for the current edge point.
-	auto doDDAStep = [&camera, &ray, &voxelGrid, &sideDistX, &sideDistZ, &cell,
-		&facing, &voxelIsValid, &zDistance, deltaDistX, deltaDistZ, stepX, stepZ,
-		nonNegativeDirX, nonNegativeDirZ]()
-	{
-		if (sideDistX < sideDistZ)
-		{
-			sideDistX += deltaDistX;
-			cell.x += stepX;
-			facing = nonNegativeDirX ? VoxelData::Facing::NegativeX : 
-				VoxelData::Facing::PositiveX;
-			voxelIsValid &= (cell.x >= 0) && (cell.x < voxelGrid.getWidth());
+			if (columnMajor)
+			{
+				ProfileScope("FrameTranspose::columnsToRows");
+				FrameTranspose::columnsToRows(frame.colorBuffer, this->width, this->height,
+					startX, endX, colorBuffer);
+			}
+			busyTime += std::chrono::high_resolution_clock::now() - tileStartTime;
+
+			tile = nextTile.fetch_add(1);
 		}
-		else
+
+		this->threadTimes[threadIndex].busySeconds =
+			std::chrono::duration<double>(busyTime).count();
+	}, JobSystem::Priority::Frame);
+
+	// Turn the voxel IDs each thread drew into the texture slots they sample.
+	for (int i = 0; i < activeThreadCount; i++)
+	{
+		const std::vector<uint8_t> &touchedVoxels = this->threadTouchedVoxels[i];
+		for (size_t j = 0; j < touchedVoxels.size(); j++)
 		{
-			sideDistZ += deltaDistZ;
-			cell.z += stepZ;
-			facing = nonNegativeDirZ ? VoxelData::Facing::NegativeZ : 
-				VoxelData::Facing::PositiveZ;
-			voxelIsValid &= (cell.z >= 0) && (cell.z < voxelGrid.getDepth());
+			if (touchedVoxels[j] != 0)
+			{
+				this->touchedVoxelTextures |= this->voxelTextureMasks[j];
+			}
 		}
+	}
 
-		const bool onXAxis = (facing == VoxelData::Facing::PositiveX) || 
-			(facing == VoxelData::Facing::NegativeX);
+	// Whatever part of the pass a thread wasn't busy for, it was waiting on the others.
+	const double passSeconds = std::chrono::duration<double>(
+		std::chrono::high_resolution_clock::now() - passStartTime).count();
 
-		// Update the Z distance depending on which axis was stepped with.
-		if (onXAxis)
+	for (int i = 0; i < this->threadCount; i++)
+	{
+		ThreadTimes &times = this->threadTimes[i];
+		if (i < activeThreadCount)
 		{
-			zDistance = (static_cast<double>(cell.x) - 
-				camera.eye.x + static_cast<double>((1 - stepX) / 2)) / ray.dirX;
+			times.idleSeconds = std::max(passSeconds - times.busySeconds, 0.0);
 		}
 		else
 		{
-			zDistance = (static_cast<double>(cell.z) -
-				camera.eye.z + static_cast<double>((1 - stepZ) / 2)) / ray.dirZ;
+			times = ThreadTimes();
 		}
-	};
+	}
 
-	// Step forward in the grid once to leave the initial voxel and update the Z distance.
-	doDDAStep();
+	this->updateActiveThreadCount(passSeconds);
+
+	const bool reusedHistory = interlaced &&
+		this->fillSkippedColumns(camera, direction, fovY, colorBuffer);
+	const int foveatedColumns = foveated ? this->fillFoveatedColumns(frame, colorBuffer) : 0;
+
+	// Merge the threads' counters now that they're done. Interlacing and foveation are
+	// counted either way, since they say how much of the frame was cast.
+	this->renderStats = RenderStats();
+	const int skippedColumns = interlaced ? ((this->width + this->interlaceParity) / 2) : 0;
+	this->renderStats.castColumns = this->width - skippedColumns - foveatedColumns;
+	this->renderStats.foveatedColumns = foveatedColumns;
+	this->renderStats.reusedColumns = reusedHistory ? skippedColumns : 0;
+	this->renderStats.interpolatedColumns =
+		(interlaced && !reusedHistory) ? skippedColumns : 0;
+	if (this->renderStatsEnabled)
+	{
+		for (const auto &stats : this->threadStats)
+		{
+			this->renderStats.add(stats);
+		}
 
-	// Step through the voxel grid while the current coordinate is valid, the 
-	// distance stepped is less than the distance at which fog is maximum, and
-	// the column is not completely occluded.
-	while (voxelIsValid && (zDistance < shadingInfo.fogDistance) && 
-		(occlusion.yMin != occlusion.yMax))
+		this->renderStats.visibleFlats = static_cast<int>(this->visibleFlats.size());
+		this->renderStats.setupSeconds = std::chrono::duration<double>(
+			passStartTime - setupStartTime).count();
+	}
+}
+
+void SoftwareRenderer::updateActiveThreadCount(double passSeconds)
+{
+	if (this->renderThreadBudget <= 0.0)
 	{
-		// Store the cell coordinates, axis, and Z distance for wall rendering. The
-		// loop needs to do another DDA step to calculate the far point.
-		const int savedCellX = cell.x;
-		const int savedCellZ = cell.z;
-		const VoxelData::Facing savedFacing = facing;
-		const double wallDistance = zDistance;
+		return;
+	}
 
-		// Decide which voxel in the XZ plane to step to next, and update the Z distance.
-		doDDAStep();
+	// The busy times add up to about the same work however many threads split it, so the
+	// count that would fit is the work over the target, rounded up.
+	double busySeconds = 0.0;
+	for (int i = 0; i < this->activeThreadCount; i++)
+	{
+		busySeconds += this->threadTimes[i].busySeconds;
+	}
 
-		// Near and far points in the XZ plane. The near point is where the wall is, and 
-		// the far point is used with the near point for drawing the floor and ceiling.
-		const Double2 nearPoint(
-			camera.eye.x + (ray.dirX * wallDistance),
-			camera.eye.z + (ray.dirZ * wallDistance));
-		const Double2 farPoint(
-			camera.eye.x + (ray.dirX * zDistance),
-			camera.eye.z + (ray.dirZ * zDistance));
+	const double targetSeconds =
+		this->renderThreadBudget * SoftwareRenderer::RENDER_THREAD_BUDGET_TARGET;
+	const int neededCount = std::max(std::min(
+		static_cast<int>(std::ceil(busySeconds / targetSeconds)), this->threadCount), 1);
 
-		// Draw all voxels in a column at the given XZ coordinate.
-		SoftwareRenderer::drawVoxelColumn(x, savedCellX, savedCellZ, camera, ray, savedFacing,
-			nearPoint, farPoint, wallDistance, zDistance, shadingInfo, ceilingHeight, 
-			voxelGrid, textures, occlusion, frame);
+	if ((neededCount > this->activeThreadCount) || (passSeconds > targetSeconds))
+	{
+		// Missing the target is worse than waking a thread, so growing doesn't wait. A pass
+		// that ran long with enough threads (i.e., from uneven tiles) gets one more.
+		this->activeThreadCount = std::min(
+			std::max(neededCount, this->activeThreadCount + 1), this->threadCount);
+		this->threadShrinkFrames = 0;
+	}
+	else if (neededCount < this->activeThreadCount)
+	{
+		this->threadShrinkFrames++;
+		if (this->threadShrinkFrames >= SoftwareRenderer::RENDER_THREAD_SHRINK_FRAMES)
+		{
+			this->activeThreadCount--;
+			this->threadShrinkFrames = 0;
+		}
+	}
+	else
+	{
+		this->threadShrinkFrames = 0;
 	}
 }
 
-void SoftwareRenderer::render(const Double3 &eye, const Double3 &direction, double fovY,
-	double ambient, double daytimePercent, double ceilingHeight, const VoxelGrid &voxelGrid, 
-	uint32_t *colorBuffer)
+void SoftwareRenderer::parallelForBlocks(int count,
+	const std::function<void(int, int)> &function)
 {
-	// Constants for screen dimensions.
-	const double widthReal = static_cast<double>(this->width);
-	const double heightReal = static_cast<double>(this->height);
-	const double aspect = widthReal / heightReal;
-
-	// 2.5D camera definition.
-	const Camera camera(eye, direction, fovY, aspect);
-
-	// Camera values for generating 2D rays with.
-	const Double2 forwardComp = 
-		Double2(camera.forwardX, camera.forwardZ).normalized() * camera.zoom;
-	const Double2 right2D = 
-		Double2(camera.rightX, camera.rightZ).normalized() * camera.aspect;
+	const int blockSize = SoftwareRenderer::PARALLEL_BLOCK_SIZE;
+	const int blockCount = (count + blockSize - 1) / blockSize;
+	this->jobSystem.parallelFor(blockCount, [count, blockSize, &function](int block)
+	{
+		const int start = block * blockSize;
+		function(start, std::min(start + blockSize, count));
+	}, JobSystem::Priority::Frame);
+}
 
-	// Calculate shading information.
-	const Double3 horizonFogColor = this->getFogColor(daytimePercent);
-	const Double3 zenithFogColor = horizonFogColor * 0.85; // Temp.
-	const Double3 sunDirection = this->getSunDirection(daytimePercent);
-	const Double3 sunColor = [&sunDirection]()
+bool SoftwareRenderer::fillSkippedColumns(const Camera &camera, const Double3 &direction,
+	double fovY, uint32_t *colorBuffer)
+{
+	ProfileScope("SoftwareRenderer::fillSkippedColumns");
+
+	const int width = this->width;
+	const int skippedParity = this->interlaceParity ^ 1;
+
+	// The last frame's columns are still in the right place if the camera is nearly where
+	// it was. Half a column's angle of turning keeps them within half a pixel.
+	const double columnAngle = (2.0 * std::atan(camera.aspect / camera.zoom)) /
+		static_cast<double>(width);
+	const double turnCos = std::max(std::min(
+		direction.normalized().dot(this->historyDirection.normalized()), 1.0), -1.0);
+	const bool reuseHistory =
+		(this->interlaceHistory.size() == static_cast<size_t>(width * this->height)) &&
+		(fovY == this->historyFovY) &&
+		((camera.eye - this->historyEye).length() < Constants::Epsilon) &&
+		(std::acos(turnCos) < (columnAngle * 0.50));
+
+	// The output is always stored row by row.
+	this->parallelForBlocks(this->height, [this, colorBuffer, width, skippedParity,
+		reuseHistory](int startY, int endY)
 	{
-		const Double3 baseColor(0.90, 0.875, 0.85);
+		for (int y = startY; y < endY; y++)
+		{
+			uint32_t *row = colorBuffer + (y * width);
+			if (reuseHistory)
+			{
+				const uint32_t *historyRow = this->interlaceHistory.data() + (y * width);
+				for (int x = skippedParity; x < width; x += 2)
+				{
+					row[x] = historyRow[x];
+				}
+			}
+			else
+			{
+				// Edge columns only have one drawn neighbor.
+				for (int x = skippedParity; x < width; x += 2)
+				{
+					const uint32_t left = row[(x > 0) ? (x - 1) : (x + 1)];
+					const uint32_t right = row[((x + 1) < width) ? (x + 1) : (x - 1)];
+					row[x] = ((left >> 1) & 0x7F7F7F7F) + ((right >> 1) & 0x7F7F7F7F);
+				}
+			}
+		}
+	});
 
-		// Darken the sun color if it's below the horizon so wall faces aren't lit 
-		// as much during the night. This is just an artistic value to compensate
-		// for the lack of shadows.
-		return (sunDirection.y >= 0.0) ? baseColor :
-			(baseColor * (1.0 - (5.0 * std::abs(sunDirection.y)))).clamped();
-	}();
+	return reuseHistory;
+}
 
-	// Create some helper structs to keep similar values together.
-	const ShadingInfo shadingInfo(horizonFogColor, zenithFogColor, sunColor, 
-		sunDirection, ambient, this->fogDistance);
-	const FrameView frame(colorBuffer, this->depthBuffer.data(), this->width, this->height);
+int SoftwareRenderer::fillFoveatedColumns(const FrameView &frame, uint32_t *colorBuffer)
+{
+	ProfileScope("SoftwareRenderer::fillFoveatedColumns");
 
-	// Lambda for rendering some columns of pixels. The voxel rendering portion uses 2.5D 
-	// ray casting, which is the cheaper form of ray casting (although still not very 
-	// efficient overall), and results in a "fake" 3D scene.
-	auto renderColumns = [this, &camera, ceilingHeight, &voxelGrid, &shadingInfo,
-		widthReal, &forwardComp, &right2D, &frame](int startX, int endX)
+	// Find the drawn columns on either side of each skipped one. The outermost columns
+	// might only have one.
+	const int width = this->width;
+	this->foveatedFills.clear();
+
+	int left = -1;
+	for (int x = 0; x < width; x++)
 	{
-		for (int x = startX; x < endX; x++)
+		if (frame.drawsColumn(x))
 		{
-			// X percent across the screen.
-			const double xPercent = (static_cast<double>(x) + 0.50) / widthReal;
+			left = x;
+			continue;
+		}
 
-			// "Right" component of the ray direction, based on current screen X.
-			const Double2 rightComp = right2D * ((2.0 * xPercent) - 1.0);
+		int right = x + 1;
+		while ((right < width) && !frame.drawsColumn(right))
+		{
+			right++;
+		}
 
-			// Calculate the ray direction through the pixel.
-			// - If un-normalized, it uses the Z distance, but the insides of voxels
-			//   don't look right then.
-			const Double2 direction = (forwardComp + rightComp).normalized();
-			const Ray ray(direction.x, direction.y);
+		FoveatedFill fill;
+		fill.x = x;
+		fill.left = (left >= 0) ? left : right;
+		fill.right = (right < width) ? right : left;
+		fill.weight = (fill.left != fill.right) ?
+			(((x - fill.left) * 256) / (fill.right - fill.left)) : 0;
+		this->foveatedFills.push_back(fill);
+	}
 
-			// Cast the 2D ray and fill in the column's pixels with color.
-			this->rayCast2D(x, camera, ray, shadingInfo, ceilingHeight, 
-				voxelGrid, this->voxelTextures, this->occlusion.at(x), frame);
+	// The output is always stored row by row. Red and blue, then alpha and green, are
+	// blended two channels at a time, and the weights add up to 256 so they don't carry
+	// into each other.
+	this->parallelForBlocks(this->height, [this, colorBuffer, width](int startY, int endY)
+	{
+		for (int y = startY; y < endY; y++)
+		{
+			uint32_t *row = colorBuffer + (y * width);
+			for (const FoveatedFill &fill : this->foveatedFills)
+			{
+				const uint32_t leftColor = row[fill.left];
+				const uint32_t rightColor = row[fill.right];
+				const uint32_t leftWeight = 256 - fill.weight;
+				const uint32_t rightWeight = fill.weight;
+				const uint32_t redBlue = ((((leftColor & 0x00FF00FF) * leftWeight) +
+					((rightColor & 0x00FF00FF) * rightWeight)) >> 8) & 0x00FF00FF;
+				const uint32_t alphaGreen = ((((leftColor >> 8) & 0x00FF00FF) * leftWeight) +
+					(((rightColor >> 8) & 0x00FF00FF) * rightWeight)) & 0xFF00FF00;
+				row[fill.x] = alphaGreen | redBlue;
+			}
 		}
+	});
 
-		// Iterate through all flats, rendering those visible within the given X range of 
-		// the screen.
-		for (const auto &pair : this->visibleFlats)
-		{
-			const Flat &flat = *pair.first;
-			const Flat::Frame &flatFrame = pair.second;
+	return static_cast<int>(this->foveatedFills.size());
+}
 
-			// Normal of the flat (always facing the camera).
-			const Double3 flatNormal = Double3(-forwardComp.x, 0.0, -forwardComp.y).normalized();
+void SoftwareRenderer::drawCostView(uint32_t *colorBuffer)
+{
+	ProfileScope("SoftwareRenderer::drawCostView");
 
-			// Texture of the flat. It might be flipped horizontally as well, given by
-			// the "flat.flipped" value.
-			const FlatTexture &texture = this->flatTextures[flat.textureID];
+	const int width = this->width;
+	const int height = this->height;
 
-			const Double2 eye2D(camera.eye.x, camera.eye.z);
+	// The counters have the layout of the frame that was drawn into.
+	const bool columnMajor = this->columnMajorRendering;
+	const int xStride = columnMajor ? height : 1;
+	const int yStride = columnMajor ? 1 : width;
+	const uint8_t *overdrawCounts = this->overdrawCounts.data();
 
-			SoftwareRenderer::drawFlat(startX, endX, flatFrame, flatNormal, flat.flipped, 
-				eye2D, shadingInfo, texture, frame);
-		}
+	// Blue, green, yellow, then red from 0 to 1.
+	auto getHeatColor = [](double percent)
+	{
+		const double clamped = std::max(std::min(percent, 1.0), 0.0);
+		const double r = std::min(std::max((clamped * 3.0) - 1.0, 0.0), 1.0);
+		const double g = (clamped < (2.0 / 3.0)) ? std::min(clamped * 3.0, 1.0) :
+			(1.0 - ((clamped - (2.0 / 3.0)) * 3.0));
+		const double b = std::max(1.0 - (clamped * 3.0), 0.0);
+		return (static_cast<uint32_t>(r * 255.0) << 16) |
+			(static_cast<uint32_t>(g * 255.0) << 8) | static_cast<uint32_t>(b * 255.0);
 	};
 
-	// Lambda for clearing some rows on the frame buffer quickly.
-	auto clearRows = [this, colorBuffer, &horizonFogColor, &zenithFogColor](int startY, int endY)
+	auto blend = [](uint32_t color, uint32_t heatColor)
 	{
-		const int startIndex = startY * this->width;
-		const int endIndex = endY * this->width;
+		return ((color >> 1) & 0x7F7F7F7F) + ((heatColor >> 1) & 0x7F7F7F7F);
+	};
 
-		uint32_t *colorPtr = colorBuffer;
-		double *depthPtr = this->depthBuffer.data();
+	if (this->costView == CostView::Columns)
+	{
+		// Each column's shaded pixels plus its weighted voxel steps and flat draws.
+		std::vector<double> costs(width);
+		this->parallelForBlocks(width, [this, &costs, overdrawCounts, xStride, yStride,
+			height](int startX, int endX)
+		{
+			for (int x = startX; x < endX; x++)
+			{
+				int pixelCount = 0;
+				for (int y = 0; y < height; y++)
+				{
+					pixelCount += overdrawCounts[(x * xStride) + (y * yStride)];
+				}
 
-		const uint32_t colorValue = horizonFogColor.toRGB();
-		const double depthValue = std::numeric_limits<double>::infinity();
+				const ColumnCost &columnCost = this->columnCosts[x];
+				costs[x] = static_cast<double>(pixelCount) +
+					(static_cast<double>(columnCost.voxelSteps) *
+						SoftwareRenderer::COST_VIEW_VOXEL_STEP_WEIGHT) +
+					(static_cast<double>(columnCost.flatDraws) *
+						SoftwareRenderer::COST_VIEW_FLAT_DRAW_WEIGHT);
+			}
+		});
 
-		// Clear the color and depth of some rows.
-		for (int i = startIndex; i < endIndex; i++)
+		const double maxCost = *std::max_element(costs.begin(), costs.end());
+		std::vector<uint32_t> heatColors(width);
+		for (int x = 0; x < width; x++)
 		{
-			colorPtr[i] = colorValue;
-			depthPtr[i] = depthValue;
+			heatColors[x] = getHeatColor((maxCost > 0.0) ? (costs[x] / maxCost) : 0.0);
 		}
-	};
 
-	// Start a thread for refreshing the visible flats. This should erase the old list,
-	// calculate a new list, and sort it by depth.
-	std::thread sortThread([this, &camera] { this->updateVisibleFlats(camera); });
-
-	// Prepare render threads. These are used for clearing the frame buffer and rendering.
-	std::vector<std::thread> renderThreads(this->renderThreadCount);
-
-	// Start clearing the frame buffer with the render threads.
-	for (size_t i = 0; i < renderThreads.size(); i++)
+		this->parallelForBlocks(height, [colorBuffer, &heatColors, &blend,
+			width](int startY, int endY)
+		{
+			for (int y = startY; y < endY; y++)
+			{
+				uint32_t *row = colorBuffer + (y * width);
+				for (int x = 0; x < width; x++)
+				{
+					row[x] = blend(row[x], heatColors[x]);
+				}
+			}
+		});
+	}
+	else
 	{
-		// "blockSize" is the approximate number of rows per thread. Rounding is involved so 
-		// the start and stop coordinates are correct for all resolutions.
-		const double blockSize = heightReal / static_cast<double>(this->renderThreadCount);
-		const int startY = static_cast<int>(std::round(static_cast<double>(i) * blockSize));
-		const int endY = static_cast<int>(std::round(static_cast<double>(i + 1) * blockSize));
+		// Pixels that were never shaded (i.e., the sky) are left alone.
+		this->parallelForBlocks(height, [colorBuffer, overdrawCounts, &getHeatColor,
+			&blend, width, xStride, yStride](int startY, int endY)
+		{
+			for (int y = startY; y < endY; y++)
+			{
+				uint32_t *row = colorBuffer + (y * width);
+				for (int x = 0; x < width; x++)
+				{
+					const int count = overdrawCounts[(x * xStride) + (y * yStride)];
+					if (count > 0)
+					{
+						row[x] = blend(row[x],
+							getHeatColor(static_cast<double>(count - 1) / 3.0));
+					}
+				}
+			}
+		});
+	}
+}
+
+void SoftwareRenderer::render(const Double3 &eye, const Double3 &direction, double fovY,
+	double ambient, double daytimePercent, double ceilingHeight, const VoxelGrid &voxelGrid, 
+	uint32_t *colorBuffer)
+{
+	ProfileScope("SoftwareRenderer::render");
 
-		// Make sure the rounding is correct.
-		assert(startY >= 0);
-		assert(endY <= this->height);
+	// Textures are flagged as the frame draws them, then kept as last-used frames below.
+	this->touchedVoxelTextures = 0;
+	this->touchedFlatTextures.assign(this->flatTextures.size(), false);
 
-		renderThreads[i] = std::thread(clearRows, startY, endY);
+	if (this->occlusionMode != OcclusionMode::Compare)
+	{
+		this->renderScene(eye, direction, fovY, ambient, daytimePercent, ceilingHeight,
+			voxelGrid, this->occlusionMode, colorBuffer);
 	}
+	else
+	{
+		// Render the reference frame with depth testing, then the culled frame to the
+		// output, and count how many pixels they disagree on.
+		const int pixelCount = this->width * this->height;
+		this->compareBuffer.resize(pixelCount);
+
+		this->renderScene(eye, direction, fovY, ambient, daytimePercent, ceilingHeight,
+			voxelGrid, OcclusionMode::DepthTest, this->compareBuffer.data());
+		this->renderScene(eye, direction, fovY, ambient, daytimePercent, ceilingHeight,
+			voxelGrid, OcclusionMode::Culling, colorBuffer);
+
+		int mismatchCount = 0;
+		for (int i = 0; i < pixelCount; i++)
+		{
+			if (colorBuffer[i] != this->compareBuffer[i])
+			{
+				mismatchCount++;
+			}
+		}
 
-	// Reset occlusion.
-	std::fill(this->occlusion.begin(), this->occlusion.end(), 
-		OcclusionData(0, this->height));
+		this->occlusionMismatchCount = mismatchCount;
+	}
 
-	// Wait for the render threads to finish clearing.
-	for (auto &thread : renderThreads)
+	// The next interlaced frame draws the other columns, and can fill these ones in from
+	// this frame.
+	if (this->interlacedRendering && (this->width > 1))
 	{
-		thread.join();
+		this->interlaceHistory.assign(colorBuffer, colorBuffer + (this->width * this->height));
+		this->historyEye = eye;
+		this->historyDirection = direction;
+		this->historyFovY = fovY;
+		this->interlaceParity ^= 1;
 	}
 
-	// Wait for the sorting thread to finish.
-	sortThread.join();
-
-	// Start rendering the scene with the render threads.
-	for (size_t i = 0; i < renderThreads.size(); i++)
+	// The heatmap goes over the output only, so the interlace history stays clean.
+	if (this->costView != CostView::Off)
 	{
-		// "blockSize" is the approximate number of columns per thread. Rounding is involved so 
-		// the start and stop coordinates are correct for all resolutions.
-		const double blockSize = widthReal / static_cast<double>(this->renderThreadCount);
-		const int startX = static_cast<int>(std::round(static_cast<double>(i) * blockSize));
-		const int endX = static_cast<int>(std::round(static_cast<double>(i + 1) * blockSize));
+		this->drawCostView(colorBuffer);
+	}
 
-		// Make sure the rounding is correct.
-		assert(startX >= 0);
-		assert(endX <= this->width);
+	this->updateTextureFrames();
+}
 
-		renderThreads[i] = std::thread(renderColumns, startX, endX);
+void SoftwareRenderer::updateTextureFrames()
+{
+	for (int i = 0; i < static_cast<int>(this->voxelTextureFrames.size()); i++)
+	{
+		if ((this->touchedVoxelTextures & (static_cast<uint64_t>(1) << i)) != 0)
+		{
+			this->voxelTextureFrames[i] = this->frameCount;
+		}
 	}
 
-	// Wait for the render threads to finish rendering.
-	for (auto &thread : renderThreads)
+	// The flat texture table can shrink when its highest IDs are removed.
+	this->flatTextureFrames.resize(this->flatTextures.size(), -1);
+	for (size_t i = 0; i < this->touchedFlatTextures.size(); i++)
 	{
-		thread.join();
+		if (this->touchedFlatTextures[i])
+		{
+			this->flatTextureFrames[i] = this->frameCount;
+		}
 	}
+
+	this->frameCount++;
+}
+
+void SoftwareRenderer::packRGB565(const uint32_t *colorBuffer, uint16_t *dstPixels,
+	int dstPitch)
+{
+	ProfileScope("SoftwareRenderer::packRGB565");
+
+	const int width = this->width;
+	this->parallelForBlocks(this->height, [colorBuffer, dstPixels, dstPitch,
+		width](int startY, int endY)
+	{
+		// 4x4 ordered dither, added to each channel below the bits it keeps.
+		static const int DitherMatrix[16] =
+		{
+			0, 8, 2, 10,
+			12, 4, 14, 6,
+			3, 11, 1, 9,
+			15, 7, 13, 5
+		};
+
+		for (int y = startY; y < endY; y++)
+		{
+			const uint32_t *srcRow = colorBuffer + (y * width);
+			uint16_t *dstRow = reinterpret_cast<uint16_t*>(
+				reinterpret_cast<uint8_t*>(dstPixels) + (y * dstPitch));
+			const int *ditherRow = DitherMatrix + ((y & 3) * 4);
+
+			for (int x = 0; x < width; x++)
+			{
+				const uint32_t color = srcRow[x];
+				const int dither = ditherRow[x & 3];
+				const int r = std::min(
+					static_cast<int>((color >> 16) & 0xFF) + (dither >> 1), 255);
+				const int g = std::min(
+					static_cast<int>((color >> 8) & 0xFF) + (dither >> 2), 255);
+				const int b = std::min(static_cast<int>(color & 0xFF) + (dither >> 1), 255);
+				dstRow[x] = static_cast<uint16_t>(
+					((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+			}
+		}
+	});
 }
@@ -3,9 +3,14 @@
 
 #include <array>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
+#include "LightMap.h"
+#include "PotentiallyVisibleSet.h"
+#include "SpanShading.h"
 #include "../Math/Matrix4.h"
 #include "../Math/Vector2.h"
 #include "../Math/Vector3.h"
@@ -14,21 +19,114 @@
 
 // This class runs the CPU-based 3D rendering for the application.
 
+class JobSystem;
 class VoxelGrid;
 
 class SoftwareRenderer
 {
+public:
+	// Time a render thread spent working on column tiles and waiting for other threads 
+	// during the most recent frame. Used for checking how evenly the work is balanced.
+	struct ThreadTimes
+	{
+		double busySeconds, idleSeconds;
+
+		ThreadTimes();
+	};
+
+	// Counts of the work done in the most recent frame, for finding out where a slow 
+	// frame's time went. Each render thread counts into its own copy, and they are added
+	// together at the end of the frame.
+	struct RenderStats
+	{
+		int voxelSteps; // DDA steps through the voxel grid.
+		int voxelColumns; // Voxel columns drawn.
+		int occludedColumns; // Screen columns whose ray stopped because they were covered.
+		int wallPixels, perspectivePixels, transparentPixels, flatPixels; // Pixels shaded.
+		int flatFragments; // Partially transparent flat pixels blended after the flats.
+		int clearedPixels; // Pixels given the background color.
+		int depthRejects; // Pixels that failed the depth test.
+		int occludedFlatColumns; // Flat columns thrown out for being behind walls.
+		int visibleFlats, flatDraws; // Flats in view, and draws of them into column tiles.
+
+		// Screen columns ray cast, and those skipped by interlacing that were filled in from
+		// the last frame or from their neighbors, and those skipped at the screen's edges by
+		// foveated rendering. Counted even when the others aren't.
+		int castColumns, reusedColumns, interpolatedColumns, foveatedColumns;
+		double setupSeconds; // Time before the render threads start.
+		double voxelSeconds, flatSeconds; // Summed over all render threads.
+
+		RenderStats();
+
+		void add(const RenderStats &other);
+	};
+
+	// How opaque voxel pixels are kept from covering nearer ones.
+	enum class OcclusionMode
+	{
+		// Every pixel is depth tested (the reference path).
+		DepthTest,
+
+		// Voxels are walked front to back, and columns are clipped by their occluded 
+		// ranges instead of depth testing opaque pixels.
+		Culling,
+
+		// Renders with both modes and counts the pixels that differ (for debugging).
+		Compare
+	};
+
+	// Debug overlay showing where the frame's work goes.
+	enum class CostView
+	{
+		Off,
+
+		// Each column is tinted by its voxel steps, pixels shaded, and flats drawn, from
+		// blue for the cheapest to red for the most expensive in the frame.
+		Columns,
+
+		// Each pixel is tinted by how many times it was shaded, from blue for once to red
+		// for four or more.
+		Overdraw
+	};
 private:
+	// The kernel benchmark calls the static helpers below directly.
+	friend class KernelBench;
+
+	// Precision of values in the depth buffer, selected at compile time. A float depth buffer
+	// halves the memory traffic of clearing and depth testing, and its precision is plenty 
+	// for the distances that Arena levels reach within the near and far planes.
+#ifdef TES_FLOAT_DEPTH_BUFFER
+	typedef float DepthValue;
+#else
+	typedef double DepthValue;
+#endif
+
+	// Precision of the per-pixel math in the wall, transparent, and flat kernels (i.e., the
+	// percent down a column and the texture coordinate from it), also selected at compile
+	// time. Values within a column are from 0 to 1 or in screen pixels, so floats are
+	// enough there. Camera, ray casting, and intersection math stay in double since they
+	// work in world coordinates.
+#ifdef TES_FLOAT_PIXEL_MATH
+	typedef float PixelValue;
+#else
+	typedef double PixelValue;
+#endif
+
+	// Texels are stored with 8-bit channels to keep textures small and cache-friendly. 
+	// Channels are normalized to 0->1 by SpanShading when shading.
 	struct VoxelTexel
 	{
-		double r, g, b, a, emission;
+		uint8_t r, g, b, a;
+		uint8_t emission; // 0 is no emission, 255 is full emission.
+		uint8_t index; // Palette index of the color, for paletted rendering.
+		uint8_t light; // Night light coverage; black during the day, lit at night.
 
 		VoxelTexel();
 	};
 
 	struct FlatTexel
 	{
-		double r, g, b, a;
+		uint8_t r, g, b, a;
 
 		FlatTexel();
 	};
@@ -39,14 +137,69 @@ private:
 		static const int HEIGHT = VoxelTexture::WIDTH;
 		static const int TEXEL_COUNT = VoxelTexture::WIDTH * VoxelTexture::HEIGHT;
 
+		// Mip levels go from 64x64 (level 0) down to 1x1. Each level has a quarter of the
+		// texels of the one before it, so all levels after the first add up to a third of 
+		// the first (rounded down).
+		static const int MIP_LEVEL_COUNT = 7;
+		static const int MIP_TEXEL_COUNT = (VoxelTexture::TEXEL_COUNT - 1) / 3;
+
+		// Texels are stored column by column since the wall kernels step down a column of 
+		// the texture for each screen column.
 		std::array<VoxelTexel, VoxelTexture::TEXEL_COUNT> texels;
-		std::vector<Int2> lightTexels; // Black during the day, yellow at night.
+		std::array<VoxelTexel, VoxelTexture::MIP_TEXEL_COUNT> mipTexels; // Levels 1 and up.
+
+		// Palette indices of the texels in every mip level from darkest to brightest, which
+		// a liquid's colors cycle through when rendering paletted.
+		std::vector<uint8_t> cycleIndices;
+
+		// Gets the index of a texel in a mip level with the given width.
+		static int getTexelIndex(int x, int y, int mipWidth);
+
+		// Gets the texels of a mip level. Its width and height are WIDTH >> level.
+		const VoxelTexel *getMipTexels(int level) const;
+
+		// Rebuilds each mip level from the one above it. Must be called whenever the base 
+		// texels change.
+		void generateMipmaps();
 	};
 
 	struct FlatTexture
 	{
+		// Rows of opaque texels in a texel column, so flats only step through the parts
+		// of their columns that can produce pixels.
+		struct OpaqueRun
+		{
+			int start, count;
+		};
+
 		std::vector<FlatTexel> texels;
+		std::vector<OpaqueRun> runs; // Each texel column's runs, top to bottom.
+		std::vector<int> columnRuns; // Index of each column's first run, plus the end.
+		FlatTexel averageTexel; // Average of the opaque texels, for flats drawn as a dot.
+		double coverage; // Fraction of texels that aren't transparent.
 		int width, height;
+
+		// Rebuilds the opaque runs, average texel, and coverage from the texels.
+		void updateRuns();
+
+		// Makes this texture a half-size copy of the given one, with each texel averaging a
+		// 2x2 block. A block becomes opaque if at least half of it is.
+		void makeHalfSize(const FlatTexture &texture);
+
+		// Gets the bytes held by the texture's buffers.
+		size_t getByteCount() const;
+	};
+
+	// A flat texture and its reduced copies. Flat texture IDs given the same texels share
+	// one set, i.e., a sprite used by several entity types.
+	struct FlatTextureSet
+	{
+		FlatTexture texture;
+		std::vector<FlatTexture> lods; // Half-size, then quarter-size copies.
+		uint64_t hash; // Of the texels it was made from, for finding it in the shared sets.
+
+		// Gets the bytes held by the texture and its reduced copies.
+		size_t getByteCount() const;
 	};
 
 	// Camera for 2.5D ray casting (with some pre-calculated values to avoid duplicating work).
@@ -64,6 +217,21 @@ private:
 		Camera(const Double3 &eye, const Double3 &direction, double fovY, double aspect);
 	};
 
+	// Projects points on the vertical line through an XZ position to screen Y, in pixels.
+	// The camera only turns about the Y axis, so a point's projected W depends only on its
+	// XZ position, and screen Y is linear in height. Projecting a height is one multiply-add,
+	// and a voxel column shares the projectors of its near and far points with every voxel
+	// in it.
+	struct HeightProjector
+	{
+		double screenY0; // Screen Y at height zero.
+		double screenYPerHeight;
+
+		HeightProjector(const Double2 &point, const Camera &camera, double frameHeight);
+
+		double getScreenY(double y) const;
+	};
+
 	// Ray for 2.5D ray casting. The start point is always at the camera's eye.
 	struct Ray
 	{
@@ -78,10 +246,25 @@ private:
 	// casting loop can return early.
 	struct OcclusionData
 	{
-		// Min is inclusive, max is exclusive.
+		// Min is inclusive, max is exclusive. Pixels outside of this range are covered
+		// by nearer opaque pixels.
 		int yMin, yMax;
 
-		OcclusionData(int yMin, int yMax);
+		// Whether clipping and updating actually do anything. When false, every pixel
+		// relies on the depth test instead.
+		bool culling;
+
+		// Whether pixels in this column need the per-pixel depth test. The occluded range 
+		// only grows from the top and bottom of the column, so once an opaque range is 
+		// drawn that touches neither end (or a transparent range is drawn), the depth 
+		// buffer takes over for the rest of the column.
+		bool depthTest;
+
+		// Whether any visible flats overlap this column, so opaque pixels must still write
+		// their depth for the flats to be tested against.
+		bool hasFlats;
+
+		OcclusionData(int yMin, int yMax, bool culling);
 		OcclusionData();
 
 		// Modifies the given start and end pixel coordinates based on the current occlusion.
@@ -90,6 +273,13 @@ private:
 
 		// Updates the occlusion range given some range of opaque pixels.
 		void update(int yStart, int yEnd);
+
+		// Transparent ranges do not occlude, but opaque pixels drawn behind them later must 
+		// be depth tested.
+		void updateTransparent(int yStart, int yEnd);
+
+		// Whether pixels drawn in this column need to write to the depth buffer.
+		bool writesDepth() const;
 	};
 
 	// Helper struct for ray search operations (i.e., finding if a ray intersects a 
@@ -102,6 +292,32 @@ private:
 		Double3 normal;
 	};
 
+	// A point light. Its light falls off linearly to nothing at the intensity's distance.
+	// Lighting is only in the XZ plane for now, like the rest of the 2.5D geometry.
+	struct Light
+	{
+		Double3 point, color;
+		double intensity;
+	};
+
+	// Lights sorted into the voxel columns (XZ cells) they can reach, so pixels only look
+	// at the few lights near them. Only cells within the lights' bounds are stored.
+	struct LightGrid
+	{
+		std::vector<std::vector<const Light*>> cells;
+		int originX, originZ; // Voxel coordinate of the first cell.
+		int width, depth; // Number of cells in X and Z.
+
+		LightGrid();
+
+		// Gets the lights touching the given voxel column, or null if there are none.
+		const std::vector<const Light*> *getLights(int voxelX, int voxelZ) const;
+
+		// Gets the brightness added by lights at a point in the XZ plane. A light's color
+		// only counts toward its brightness.
+		double getLightLevel(const Double2 &point) const;
+	};
+
 	// Helper struct for keeping shading data organized in the renderer. These values are
 	// computed once per frame.
 	struct ShadingInfo
@@ -118,9 +334,189 @@ private:
 		// Distance at which fog is maximum.
 		double fogDistance;
 
+		// Number of entries in the depth-to-fog table. Each step is well under one color 
+		// step of fog.
+		static const int FOG_TABLE_SIZE = 1024;
+
+		// Ambient plus sun light for each axis-aligned normal (+X, -X, +Y, -Y, +Z, -Z), each
+		// diagonal wall normal (+X+Z, +X-Z, -X+Z, -X-Z), and for flats, whose normal is the
+		// same for all of them in a frame. These are calculated once per frame so the column
+		// kernels don't need to.
+		std::array<Double3, 10> normalShadings;
+		Double3 flatShading;
+
+		// Shading indices after the normals' in the deferred shading buffer, for flats and
+		// for pixels showing the sky.
+		static const int FLAT_SHADING_INDEX = 10;
+		static const int SKY_SHADING_INDEX = 11;
+
+		// Highest mip level the voxel kernels may sample from.
+		int maxMipLevel;
+
+		// Pixels per exact perspective calculation in perspective columns. Pixels in between
+		// are interpolated linearly. 1 is exact for every pixel.
+		int perspectiveSpanLength;
+
+		// Fog percents for quantized depths from zero to the fog distance.
+		std::array<double, ShadingInfo::FOG_TABLE_SIZE> fogPercents;
+		double fogDepthScale; // Converts a depth to a fog table index.
+
+		// Lights for the frame, and the information needed to find the XZ point of a pixel
+		// in a screen column from its depth. The light map is null if the level has no
+		// static lights.
+		const LightGrid *lightGrid;
+		const LightMap *lightMap;
+		const Double2 *columnRays; // World-space ray direction of each screen column.
+		Double2 eye2D;
+
+		// Whether night light texels are lit, and the palette index of their lit color.
+		bool nightLightsActive;
+		uint8_t nightLightIndex;
+
+		// Final colors of each palette index at each fog level when rendering paletted, like
+		// a colormap. There is one table for each normal shading (in the same order) followed
+		// by one for emissive texels. Null when not rendering paletted.
+		const uint32_t *paletteShades;
+
+		// Palette index each index is cycled to, for each voxel texture used by a liquid
+		// chasm. Null when not rendering paletted or no liquids are in the voxel grid.
+		const uint8_t *cycledIndices;
+
+		// Whether the column kernels write texels to the G-buffer and leave lights, shading,
+		// and fog to the shading pass.
+		bool deferred;
+
+		// Background color of each screen row, from the horizon color at and below the
+		// horizon to the zenith color straight up.
+		const uint32_t *skyRowColors;
+
+		// How far open each door is that isn't closed, by voxel. Doors at rest aren't in it.
+		const std::unordered_map<Int3, double> *doorOpenPercents;
+
 		ShadingInfo(const Double3 &horizonSkyColor, const Double3 &zenithSkyColor,
 			const Double3 &sunColor, const Double3 &sunDirection, double ambient,
-			double fogDistance);
+			double fogDistance, const Double3 &flatNormal, int maxMipLevel);
+
+		// Calculates the shading for a surface with the given normal.
+		Double3 calculateShading(const Double3 &normal) const;
+
+		// Gets the index of an axis-aligned or diagonal wall normal in the normal shadings.
+		int getNormalIndex(const Double3 &normal) const;
+
+		// Gets the precalculated shading for an axis-aligned or diagonal wall normal.
+		const Double3 &getNormalShading(const Double3 &normal) const;
+
+		// Gets the precalculated shading for a normal index or the flat shading index.
+		const Double3 &getShading(int shadingIndex) const;
+
+		// Gets the fog percent for the given depth.
+		double getFogPercent(double depth) const;
+
+		// Gets how far open the door in the given voxel is, or zero if it's closed.
+		double getDoorOpenPercent(int voxelX, int voxelY, int voxelZ) const;
+
+		// Gets the palette shade table for an axis-aligned normal, or null if not rendering
+		// paletted.
+		const uint32_t *getPaletteShades(const Double3 &normal) const;
+
+		// Converts a fog percent to a fog level in the palette shade tables.
+		int getPaletteFogLevel(double fogPercent) const;
+
+		// Gets the final color of a voxel texel from a normal's palette shade table.
+		uint32_t getPaletteColor(uint8_t index, uint8_t emission, const uint32_t *shades,
+			int fogLevel) const;
+
+		// Gets the cycled palette indices of a chasm's texture if it's a liquid (i.e., wet or
+		// lava), or null if it's dry or its colors aren't cycled.
+		const uint8_t *getCycledIndices(const VoxelData::ChasmData &chasm) const;
+
+		// Gets a texel with night lights applied to it if they're active. Textures store
+		// night light texels black, so they can be shared between frames and threads.
+		VoxelTexel getLitTexel(const VoxelTexel &texel) const;
+
+		// Returns whether there are any lights to add.
+		bool hasLights() const;
+
+		// Returns whether the column kernels add lights themselves instead of the deferred
+		// shading pass.
+		bool hasColumnLights() const;
+
+		// Gets the XZ point at some depth along a screen column's ray.
+		Double2 getColumnPoint(int x, double depth) const;
+
+		// Gets the texel emission for the static and dynamic light at an XZ point, added to
+		// the texel's own.
+		uint8_t getLightEmission(const Double2 &point) const;
+	};
+
+	// A column of pixels on a horizontal plane (the top of a floor voxel or the bottom of
+	// a ceiling voxel), waiting to be drawn row by row after the column tile is ray cast.
+	struct PlaneSpan
+	{
+		int x, yStart, yEnd;
+		int textureID;
+		double planeY; // Height of the plane.
+	};
+
+	// Plane spans gathered by a render thread for its current column tile. Each pixel of
+	// the tile refers to the span covering it, so the rows can be drawn left to right.
+	struct PlaneBuffer
+	{
+		std::vector<PlaneSpan> spans;
+
+		// Index of each tile pixel's span plus one (zero if none), row by row. Entries are
+		// reset to zero as they are drawn.
+		std::vector<uint16_t> pixelSpans;
+
+		int startX; // First screen column of the tile.
+		int yMin, yMax; // Rows covered by spans.
+
+		PlaneBuffer();
+
+		// Clears the spans for a new tile starting at the given column.
+		void reset(int startX);
+	};
+
+	struct FrameView;
+	struct TileOcclusion;
+
+	// Work done in a screen column, for the cost view.
+	struct ColumnCost
+	{
+		int voxelSteps;
+		int flatDraws;
+	};
+
+	// Partially transparent flat pixels of a column tile. They're kept until every flat in
+	// the tile is drawn, then the ones in front of the opaque pixels are blended back to
+	// front, so overlapping translucent flats don't depend on the flat draw order. Each
+	// column's pixels are contiguous, and each pixel keeps its nearest few fragments.
+	struct FragmentBuffer
+	{
+		static const int MAX_FRAGMENTS; // Per pixel.
+
+		struct Fragment
+		{
+			DepthValue depth;
+			uint32_t color; // Shaded and fogged RGB.
+			uint8_t alpha;
+		};
+
+		std::vector<Fragment> fragments; // Made when the first fragment is added.
+		std::vector<uint8_t> counts; // Fragments of each tile pixel.
+		std::vector<int> columnYMins, columnYMaxes; // Rows with fragments in each column.
+		int startX, height; // First screen column of the tile, and the frame height.
+
+		FragmentBuffer();
+
+		// Clears the fragments for a new tile starting at the given column.
+		void reset(int startX, int height);
+
+		// Adds a fragment to a pixel, replacing the pixel's farthest one if it's full.
+		void add(int x, int y, DepthValue depth, uint32_t color, uint8_t alpha);
+
+		// Blends each column's fragments that pass the depth test into the frame.
+		void resolve(const FrameView &frame);
 	};
 
 	// Helper struct for values related to the frame buffer. The pointers are owned
@@ -128,57 +524,321 @@ private:
 	struct FrameView
 	{
 		uint32_t *colorBuffer;
-		double *depthBuffer;
+		DepthValue *depthBuffer;
 		int width, height;
 		double widthReal, heightReal;
+		int xStride, yStride; // Distance between horizontal and vertical neighbor pixels.
+		RenderStats *stats; // The render thread's counters, or null if not counting.
+		PlaneBuffer *planes; // The render thread's plane spans, or null if drawn by column.
+		TileOcclusion *tileOcclusion; // The render thread's tile summary, or null if unused.
+		FragmentBuffer *fragments; // The render thread's translucent flat pixels, or null.
+		uint8_t *touchedVoxels; // The render thread's flag for each voxel ID drawn, or null.
+
+		// G-buffer with the same layout as the color buffer, or null if pixels are shaded
+		// by the column kernels. Texels are packed as R, G, B, and emission from the low
+		// byte up, and each pixel's shading index says which shading it gets.
+		uint32_t *texelBuffer;
+		uint8_t *shadingBuffer;
+
+		int columnParity; // Parity of the columns drawn when interlacing, otherwise -1.
+
+		// Columns drawn at full density, and every how many columns are drawn outside of
+		// them (counting out from the center). The stride is 1 if not foveated.
+		int foveaStart, foveaEnd, edgeColumnStride;
+
+		// Cost view counters, or null if the view is off. Overdraw counts have the same
+		// layout as the color buffer, and column costs are indexed by screen column.
+		uint8_t *overdrawCounts;
+		ColumnCost *columnCosts;
+
+		// Column-major buffers store each screen column contiguously, so the column
+		// kernels write to consecutive pixels.
+		FrameView(uint32_t *colorBuffer, DepthValue *depthBuffer, int width, int height,
+			bool columnMajor);
+
+		// Gets the buffer index of a pixel.
+		int getIndex(int x, int y) const;
+
+		// Returns whether a screen column is drawn this frame.
+		bool drawsColumn(int x) const;
+
+		// Counts a pixel being shaded, for the cost view.
+		void addOverdraw(int index) const;
+	};
+
+	// Coarse summary of a column tile's depth once its voxels are drawn, so flats (or
+	// columns of them) that are behind walls everywhere they would be drawn can be thrown
+	// out without testing each pixel. Flats only make the depth nearer, so the summary
+	// stays valid while they're drawn.
+	struct TileOcclusion
+	{
+		// Rows in each band of the summary.
+		static const int BAND_HEIGHT;
+
+		std::vector<DepthValue> bandDepths; // Farthest depth in each band of rows.
 
-		FrameView(uint32_t *colorBuffer, double *depthBuffer, int width, int height);
+		// Reads the farthest depth of each band in the given columns. Culled columns with
+		// no flats in them are skipped.
+		void update(int startX, int endX, const std::vector<OcclusionData> &occlusion,
+			const FrameView &frame);
+
+		// Returns whether every pixel in the rows is nearer than the given depth.
+		bool isOccluded(int yStart, int yEnd, DepthValue depth) const;
 	};
 
-	// A flat is a 2D surface always facing perpendicular to the Y axis, and opposite to
-	// the camera's XZ direction.
-	struct Flat
+	// Pixels from a column kernel that passed the depth test, waiting to be shaded together
+	// by SpanShading.
+	struct PixelBatch
+	{
+		SpanShading::Span span;
+		std::array<int, SpanShading::MAX_PIXELS> indices; // Frame buffer indices.
+		std::array<DepthValue, SpanShading::MAX_PIXELS> depths;
+
+		// Adds a pixel to the batch. Returns whether the batch is now full.
+		bool add(uint8_t r, uint8_t g, uint8_t b, uint8_t emission, double fogPercent,
+			int index, DepthValue depth);
+	};
+
+	// Dimensions shared by every flat of the same size, which is usually all the instances
+	// of one kind of doodad or NPC.
+	struct FlatArchetype
 	{
-		Double3 position; // Center of bottom edge.
 		double width, height;
+		int flatCount; // Flats using it. Unused archetypes are taken by the next new size.
+	};
+
+	// A flat is a 2D surface always facing perpendicular to the Y axis, and opposite to
+	// the camera's XZ direction. All flats are packed into parallel arrays, so the visible
+	// flat pass streams through only the values it reads. Removing a flat moves the last
+	// one into its place.
+	struct FlatList
+	{
+		std::vector<int> ids;
+		std::vector<Double3> positions; // Center of bottom edge.
+		std::vector<int> archetypeIndices;
+		std::vector<int> textureIDs;
+		std::vector<bool> flipped;
+		std::unordered_map<int, int> indices; // Index in the arrays of each flat ID.
+		std::vector<FlatArchetype> archetypes;
+
+		int getCount() const;
+
+		// Gets the archetype of a flat.
+		const FlatArchetype &getArchetype(int flatIndex) const;
+
+		// Gets the index of the archetype with the given size for a new user of it, adding
+		// one if there isn't any.
+		int acquireArchetype(double width, double height);
+
+		// Lets go of a user's archetype.
+		void releaseArchetype(int archetypeIndex);
+	};
+
+	// A visible flat's frame consists of their four corner points in world space, and some
+	// screen-space values.
+	struct FlatFrame
+	{
+		// Each "start" is the flat's right or top, and each "end" is the opposite side.
+		// For texture coordinates, start is inclusive, end is exclusive.
+		Double3 topStart, topEnd, bottomStart, bottomEnd;
+
+		// Screen-space coordinates of the flat. The X values determine which columns the 
+		// flat occupies on-screen, and the Y values determine which rows.
+		double startX, endX, startY, endY;
+
+		// Depth of the flat in camera space. Intended only for depth sorting, since the 
+		// renderer uses true XZ depth with each pixel column instead.
+		double z;
+
+		// Copied from the flat so drawing doesn't look it up.
 		int textureID;
 		bool flipped;
 
-		// A flat's frame consists of their four corner points in world space, and some
-		// screen-space values.
-		struct Frame
-		{
-			// Each "start" is the flat's right or top, and each "end" is the opposite side.
-			// For texture coordinates, start is inclusive, end is exclusive.
-			Double3 topStart, topEnd, bottomStart, bottomEnd;
+		int flatIndex; // Index in the flat list, for keeping depth order between frames.
 
-			// Screen-space coordinates of the flat. The X values determine which columns the 
-			// flat occupies on-screen, and the Y values determine which rows.
-			double startX, endX, startY, endY;
+		// Level of detail to draw with (0 is full size), and whether the flat is small
+		// enough on-screen to be drawn as one averaged pixel.
+		int lodLevel;
+		bool drawsAsDot;
+	};
 
-			// Depth of the flat in camera space. Intended only for depth sorting, since the 
-			// renderer uses true XZ depth with each pixel column instead.
-			double z;
-		};
+	// Depth of a visible flat and its index in the visible flats, for sorting them without
+	// moving whole flat frames around.
+	struct FlatSortKey
+	{
+		double z;
+		int index;
+	};
+
+	// Flats bucketed by the XZ chunk of the world their position is in, so whole groups of
+	// flats outside the view can be thrown out without projecting each one.
+	struct FlatChunk
+	{
+		std::vector<int> flatIndices; // Indices into the flat list.
+
+		// Largest distance a flat in the chunk can reach past its position (half width). 
+		// It only grows, which keeps chunk culling conservative.
+		double maxHalfWidth;
+
+		FlatChunk();
 	};
 
 	typedef std::array<VoxelTexture, 64> VoxelTextureArray;
-	typedef std::array<FlatTexture, 256> FlatTextureArray;
 
 	// Clipping planes for Z coordinates.
 	static const double NEAR_PLANE;
 	static const double FAR_PLANE;
 
-	std::vector<double> depthBuffer; // 2D buffer, mostly consists of depth in the XZ plane.
+	// Number of screen columns in each unit of work handed to a render thread. Threads 
+	// grab the next unclaimed tile when done with their current one, so expensive parts 
+	// of the screen get shared instead of stalling a single thread.
+	static const int COLUMN_TILE_WIDTH;
+
+	// Number of rows (or columns) in each job of the passes over the whole output, so a
+	// job has enough work to be worth handing to another thread.
+	static const int PARALLEL_BLOCK_SIZE;
+
+	// Width and depth of each flat chunk in voxels.
+	static const int FLAT_CHUNK_SIZE;
+
+	// Max number of colors in the voxel texture palette, and the number of fog levels in 
+	// each palette shade table.
+	static const int PALETTE_SIZE;
+	static const int PALETTE_FOG_LEVELS;
+
+	// RGB color of night light texels when they're lit.
+	static const uint32_t NIGHT_LIGHT_COLOR;
+
+	// Most insertion sort moves per flat when putting visible flats back in depth order,
+	// before giving up and sorting them from scratch.
+	static const int MAX_FLAT_SORT_MOVES;
+
+	// Number of reduced-size copies of each flat texture (half, quarter).
+	static const int FLAT_LOD_COUNT;
+
+	// Fraction bits of the fixed-point texel rows that wall columns step down.
+	static const int TEXEL_ROW_FRACTION_BITS;
+
+	// Visible flats covering fewer opaque pixels than this are skipped, and those
+	// covering fewer total pixels than this are drawn as a single dot.
+	static const double MIN_FLAT_PIXEL_COVERAGE;
+	static const double FLAT_DOT_PIXEL_AREA;
+
+	// Weights of a voxel step and a flat draw in a column's cost, in shaded pixels.
+	static const double COST_VIEW_VOXEL_STEP_WEIGHT;
+	static const double COST_VIEW_FLAT_DRAW_WEIGHT;
+
+	// Share of the render thread budget that the render pass aims to fit in, leaving the
+	// rest as headroom, and the frames in a row that fewer threads would have been enough
+	// before one of them is let go.
+	static const double RENDER_THREAD_BUDGET_TARGET;
+	static const int RENDER_THREAD_SHRINK_FRAMES;
+
+	// Share of the screen's width in the middle that foveated rendering casts every
+	// column of.
+	static const double FOVEA_WIDTH_PERCENT;
+
+	// A column that foveated rendering skipped, and the drawn columns it's blended from.
+	// The weight of the right one is out of 256.
+	struct FoveatedFill
+	{
+		int x, left, right, weight;
+	};
+
+	std::vector<DepthValue> depthBuffer; // 2D buffer, mostly consists of depth in the XZ plane.
 	std::vector<OcclusionData> occlusion; // Min and max Y for each column.
-	std::unordered_map<int, Flat> flats; // All flats in world.
-	std::vector<std::pair<const Flat*, Flat::Frame>> visibleFlats; // Flats to be drawn.
+	std::vector<Double2> columnRayDirections; // Camera-space (forward, right) ray per column.
+	std::vector<double> columnDepthScales; // Ray distance per unit of forward distance.
+	double columnRayZoom, columnRayAspect; // Camera values the column rays were made with.
+	FlatList flats; // All flats in world.
+	std::unordered_map<int, Light> lights; // All lights in world.
+	std::unordered_map<Int3, double> doorOpenPercents; // Doors that aren't closed.
+	LightGrid lightGrid; // Lights for each voxel column, rebuilt when lights change.
+	std::shared_ptr<const LightMap> lightMap; // Static lights baked by the active level.
+	std::shared_ptr<const PotentiallyVisibleSet> visibleSet; // Of the active interior level.
+	std::vector<Double2> columnRays; // World-space ray direction of each screen column.
+	bool lightGridDirty; // Whether lights changed since the light grid was built.
+	std::unordered_map<Int2, FlatChunk> flatChunks; // Flats grouped by XZ chunk.
+	std::vector<FlatFrame> visibleFlats; // Flats to be drawn.
+	std::vector<FlatFrame> sortedFlats; // Visible flats being put in depth order.
+	std::vector<FlatSortKey> flatSortKeys; // Visible flats in the last frame's order.
+	std::vector<int> visibleFlatOrder; // Flat list indices of last frame's visible flats.
+	std::vector<int> flatRanks; // Each flat's place in the visible flat order, or -1.
+	std::vector<float> flatPoints; // Corner points of visible flats and their projections.
+	std::vector<std::vector<int>> flatTiles; // Indices of visible flats in each column tile.
 	VoxelTextureArray voxelTextures;
-	FlatTextureArray flatTextures;
+	// Flat texture sets by ID, grown to fit the highest ID given. Never null; unset and
+	// removed IDs share the empty set.
+	std::vector<std::shared_ptr<const FlatTextureSet>> flatTextures;
+	std::shared_ptr<const FlatTextureSet> emptyFlatTextureSet;
+
+	// Flat texture sets by the hash of the texels they were made from, for sharing them
+	// between IDs. Entries are erased once no ID uses their set.
+	std::unordered_map<uint64_t, std::weak_ptr<const FlatTextureSet>> flatTextureSets;
+	std::unordered_map<const FlatTextureSet*, int> flatTextureSetUses; // IDs using each set.
+	size_t flatTextureBytes; // Texel bytes of all flat textures, for the memory tracker.
+	std::vector<uint8_t> voxelDataTypes; // VoxelDataType of each voxel ID, for column loops.
+	const VoxelGrid *voxelDataTypesGrid; // Voxel grid the voxel data types were read from.
+	int voxelDataTypesRevision; // Revision of the voxel grid when they were read.
+	std::vector<uint64_t> voxelTextureMasks; // Bit for each voxel texture slot of a voxel ID.
+	uint64_t liquidTextureMask; // Voxel texture slots used by wet and lava chasms.
+
+	// Textures sampled in the current frame. Render threads flag the voxel IDs they draw,
+	// which become voxel texture slots (one bit each) once the pass is done, and flat
+	// textures are flagged when a flat using them is in the draw list.
+	std::vector<std::vector<uint8_t>> threadTouchedVoxels;
+	uint64_t touchedVoxelTextures;
+	std::vector<bool> touchedFlatTextures;
+
+	// Frame each texture was last sampled in, or -1 if it hasn't been since it was set.
+	std::array<int, 64> voxelTextureFrames;
+	std::vector<int> flatTextureFrames;
+	int frameCount; // Frames rendered so far.
 	std::vector<Double3> skyPalette; // Colors for each time of day.
 	double fogDistance; // Distance at which fog is maximum.
 	int width, height; // Dimensions of frame buffer.
-	int renderThreadCount; // Number of threads to use for rendering.
+	JobSystem &jobSystem; // Runs the render threads' work.
+	int threadCount; // Number of render threads, including the one calling render().
+	int activeThreadCount; // Render threads used for the next frame's render pass.
+	int threadShrinkFrames; // Frames in a row that fewer active threads would have done.
+	double renderThreadBudget; // Seconds the render pass should take, or zero if no limit.
+	std::vector<ThreadTimes> threadTimes; // Busy and idle time per render thread.
+	std::vector<RenderStats> threadStats; // Counters per render thread.
+	std::vector<PlaneBuffer> threadPlanes; // Plane spans per render thread.
+	std::vector<TileOcclusion> threadTileOcclusion; // Tile summary per render thread.
+	std::vector<FragmentBuffer> threadFragments; // Translucent flat pixels per render thread.
+	RenderStats renderStats; // Counters merged from all render threads.
+	bool renderStatsEnabled; // Whether render threads count their work.
+	bool forceBaseMipLevel; // Whether voxel textures are only sampled at full size.
+	std::vector<uint32_t> palette; // Colors of voxel texels, learned as textures are set.
+	std::unordered_map<uint32_t, uint8_t> paletteIndices; // Palette index of each RGB color.
+	std::vector<uint32_t> paletteShades; // Palette shade tables for the current frame.
+	std::vector<uint32_t> skyRowColors; // Background color of each screen row this frame.
+	bool palettedRendering; // Whether voxels are shaded with palette tables.
+	bool nightLightsActive; // Whether night light texels are lit.
+	uint8_t nightLightIndex; // Palette index of the night light color.
+	int liquidCycleStep; // Steps each liquid's colors are shifted by when rendering paletted.
+	std::vector<uint8_t> cycledIndices; // Cycled palette indices of each liquid texture.
+	std::vector<uint32_t> compareBuffer; // Depth-tested frame for the occlusion comparison.
+	std::vector<uint32_t> columnMajorBuffer; // Frame drawn by columns before transposing.
+	bool columnMajorRendering; // Whether the frame buffers are stored column by column.
+	int perspectiveSpanLength; // Pixels per exact calculation in perspective columns.
+	bool rowPlaneRendering; // Whether floors and ceilings are drawn by row.
+	std::vector<uint32_t> gBufferTexels; // Unshaded texels for deferred shading.
+	std::vector<uint8_t> gBufferShading; // Shading index of each deferred pixel.
+	bool deferredShading; // Whether pixels are shaded in a pass after each column tile.
+	bool interlacedRendering; // Whether only every other column is drawn each frame.
+	int interlaceParity; // Parity of the columns drawn in the next interlaced frame.
+	std::vector<uint32_t> interlaceHistory; // Last interlaced frame, or empty if none.
+	Double3 historyEye, historyDirection; // Camera the interlace history was drawn with.
+	double historyFovY;
+	int foveatedColumnStride; // Every how many columns are cast at the edges, or 1 if all.
+	std::vector<FoveatedFill> foveatedFills; // Columns skipped in the last foveated frame.
+	OcclusionMode occlusionMode;
+	int occlusionMismatchCount; // Differing pixels in the last occlusion comparison.
+	CostView costView;
+	std::vector<uint8_t> overdrawCounts; // Shaded count of each pixel for the cost view.
+	std::vector<ColumnCost> columnCosts;
 
 	// Gets the fog color (based on the time of day). It returns a value instead of
 	// a reference because it interpolates between two colors for a smoother transition.
@@ -187,20 +847,60 @@ private:
 	// Gets the current sun direction based on the time of day.
 	Double3 getSunDirection(double daytimePercent) const;
 
+	// Gets the palette index of an RGB color. New colors are added while there's room (if 
+	// allowed), and otherwise get the nearest palette color.
+	uint8_t getPaletteIndex(uint8_t r, uint8_t g, uint8_t b, bool canAdd);
+
+	// Assigns palette indices to a voxel texture's texels and mip levels. Only the full-size
+	// texels can add colors to the palette, since averaged colors aren't from the source art.
+	void updatePaletteIndices(VoxelTexture &texture);
+
+	// Recalculates the cycled palette indices of each liquid texture for the current step.
+	void updateCycledIndices();
+
+	// Gets the texture set of a flat texture ID, or the empty set if it has none.
+	const FlatTextureSet &getFlatTextureSet(int id) const;
+
+	// Points a flat texture ID at a texture set. The byte count is changed when a set gets
+	// its first ID or loses its last one, so shared sets are counted once, and a set no ID
+	// uses anymore is forgotten. The empty set isn't counted.
+	void setFlatTextureSet(int id, std::shared_ptr<const FlatTextureSet> textureSet);
+
+	// Converts 64x64 ARGB texels into a voxel texture and generates its mip levels. Returns
+	// whether any texels are night lights. Only touches the texture, so different textures
+	// can be written from different threads.
+	static bool writeVoxelTexels(VoxelTexture &texture, const uint32_t *srcTexels);
+
+	// Recalculates the palette shade tables from the frame's shading.
+	void updatePaletteShades(const ShadingInfo &shadingInfo);
+
 	// A variant of atan2() with a range of [0, 2pi] instead of [-pi, pi].
 	static double fullAtan2(double y, double x);
 
 	// Gets the normal associated with a facing.
 	static Double3 getNormal(VoxelData::Facing facing);
 
+	// Gets the coordinate of the flat chunk that contains the given point.
+	static Int2 getFlatChunkCoord(const Double3 &point);
+
+	// Adds or removes a flat in the chunk that contains its position.
+	void addFlatToChunk(int flatIndex);
+	void removeFlatFromChunk(int flatIndex);
+
 	// Gets the facing value for the far side of a chasm.
 	static VoxelData::Facing getInitialChasmFarFacing(int voxelX, int voxelZ,
 		const Double2 &eye, const Ray &ray);
 	static VoxelData::Facing getChasmFarFacing(int voxelX, int voxelZ,
 		VoxelData::Facing nearFacing, const Camera &camera, const Ray &ray);
 
-	// Calculates the projected Y coordinate of a 3D point given a transform and Y-shear value.
-	static double getProjectedY(const Double3 &point, const Matrix4d &transform, double yShear);
+	// Gets the mip level to sample when each screen pixel spans the given number of texels.
+	static int getMipLevel(double texelsPerPixel, int maxMipLevel);
+
+	// Gets the fixed-point texel row at the center of a column's first drawn pixel and how
+	// much it changes per pixel, so the column kernels don't divide for every pixel.
+	static void getFixedTexelRows(int yStart, int yEnd, double projectedYStart,
+		double projectedYEnd, double vStart, double vEnd, int mipWidth, int *texelRow,
+		int *texelRowStep);
 
 	// Gets the pixel coordinate with the nearest available pixel center based on the projected
 	// value and some bounding rule. This is used to keep integer drawing ranges clamped in such
@@ -233,22 +933,41 @@ private:
 		VoxelData::Facing nearFacing, const Double2 &nearPoint, const Double2 &farPoint,
 		double nearU, const Camera &camera, const Ray &ray, RayHit &hit);
 
-	// Gathers potential intersection data from a voxel containing a door ID. The door
-	// type determines what kind of door formula to calculate for intersection.
-	static bool findDoorIntersection(int voxelX, int voxelZ, VoxelData::DoorData::Type doorType,
-		const Double2 &nearPoint, const Double2 &farPoint, RayHit &hit);
+	// Gathers potential intersection data from a partly open door. Only swinging doors leave
+	// the near face (they turn into the voxel about a hinge at the start of it), so the other
+	// door types never intersect here and are cut down on the near face instead.
+	static bool findDoorIntersection(VoxelData::DoorData::Type doorType, double openPercent,
+		const Double2 &nearPoint, const Double2 &farPoint, const Double3 &wallNormal,
+		double wallU, RayHit &hit);
 
 	// Calculates all the projection data for a diagonal wall after successful intersection
 	// and assigns it to various reference variables. This method assumes that all diagonals
 	// appear only on the main floor.
 	static void diagProjection(double voxelYReal, double voxelHeight, const Double2 &point,
-		const Matrix4d &transform, double yShear, int frameHeight, double heightReal, 
+		const Camera &camera, int frameHeight, double heightReal, 
 		double &diagTopScreenY, double &diagBottomScreenY, int &diagStart, int &diagEnd);
 
 	// Casts a 3D ray from the default start point (eye) and returns the color.
 	// (Unused for now; keeping for reference).
 	//Double3 castRay(const Double3 &direction, const VoxelGrid &voxelGrid) const;
 
+	// Shades the pixels in a batch with the shading at the given index and writes them to 
+	// the frame buffer, then empties the batch. With a G-buffer, the texels and their depths
+	// are written there instead for the shading pass.
+	static void flushPixelBatch(PixelBatch &batch, int shadingIndex,
+		const ShadingInfo &shadingInfo, bool writeDepth, const FrameView &frame);
+
+	// Writes the fog color and farthest depth to the unoccluded range of a column. Since
+	// there's no separate clear pass, this is done once per column per frame: either when
+	// the column starts relying on the depth test, or after ray casting for whatever is left.
+	static void clearUnoccludedPixels(int x, const OcclusionData &occlusion,
+		const ShadingInfo &shadingInfo, const FrameView &frame);
+
+	// Shades the G-buffer pixels in the given screen columns with their shading, lights, 
+	// and fog, and writes them to the frame buffer.
+	static void shadeDeferredPixels(int startX, int endX, const ShadingInfo &shadingInfo,
+		const FrameView &frame);
+
 	// Draws a column of pixels with no perspective or transparency.
 	static void drawPixels(int x, int yStart, int yEnd, double projectedYStart,
 		double projectedYEnd, double depth, double u, double vStart, double vEnd,
@@ -262,45 +981,220 @@ private:
 		double depthStart, double depthEnd, const Double3 &normal, const VoxelTexture &texture,
 		const ShadingInfo &shadingInfo, OcclusionData &occlusion, const FrameView &frame);
 
-	// Draws a column of pixels with transparency but no perspective.
+	// Draws a column of a horizontal plane with the given height. If the frame gathers
+	// plane spans and occlusion can claim the pixels for it, they are recorded to be drawn
+	// by drawPlaneRows() instead.
+	static void drawPlanePixels(int x, int yStart, int yEnd, double projectedYStart,
+		double projectedYEnd, const Double2 &startPoint, const Double2 &endPoint,
+		double depthStart, double depthEnd, double planeY, const Double3 &normal,
+		int textureID, const VoxelTextureArray &textures, const ShadingInfo &shadingInfo,
+		OcclusionData &occlusion, const FrameView &frame);
+
+	// Draws the plane spans gathered for a column tile one row at a time. Each row of a
+	// plane is at one forward distance, so it only needs one divide.
+	static void drawPlaneRows(const Camera &camera, const double *columnDepthScales,
+		const VoxelTextureArray &textures, const ShadingInfo &shadingInfo,
+		const FrameView &frame);
+
+	// Draws a column of pixels with transparency but no perspective. When rendering
+	// paletted, texels are drawn with their cycled palette index if cycled indices are given.
 	static void drawTransparentPixels(int x, int yStart, int yEnd, double projectedYStart,
 		double projectedYEnd, double depth, double u, double vStart, double vEnd,
-		const Double3 &normal, const VoxelTexture &texture, const ShadingInfo &shadingInfo,
-		const OcclusionData &occlusion, const FrameView &frame);
+		const Double3 &normal, const VoxelTexture &texture, const uint8_t *cycledIndices,
+		const ShadingInfo &shadingInfo, OcclusionData &occlusion, const FrameView &frame);
+
+	// Draws a door in its voxel, opened by the given percent in the way of its type. A fully
+	// open door draws nothing.
+	static void drawDoor(int x, VoxelData::DoorData::Type doorType, double openPercent,
+		double voxelYReal, double voxelHeight, const Double2 &nearPoint,
+		const Double2 &farPoint, double nearZ, double wallU, const Double3 &wallNormal,
+		const Camera &camera,
+		const VoxelTexture &texture, const ShadingInfo &shadingInfo, OcclusionData &occlusion,
+		const FrameView &frame);
+
+	// Draws one voxel in a voxel column, given the column's shared values. There is a set of 
+	// these for the player's voxel column and for any other, each split by whether the voxel
+	// is at eye level, below it, or above it, and specialized for each voxel data type. The
+	// column methods look up the drawer for a voxel's type in a table once per voxel, so 
+	// each specialization only contains its own drawing code.
+	typedef void (*VoxelDrawFunction)(int x, int voxelX, int voxelY, int voxelZ,
+		const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+		VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+		const Double2 &farPoint, const HeightProjector &nearProjector,
+		const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+		const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+		const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame);
+	typedef std::array<VoxelDrawFunction, 10> VoxelDrawTable; // Indexed by VoxelDataType.
+
+	template <VoxelDataType Type>
+	static void drawInitialVoxel(int x, int voxelX, int voxelY, int voxelZ,
+		const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+		VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+		const Double2 &farPoint, const HeightProjector &nearProjector,
+		const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+		const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+		const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame);
+
+	template <VoxelDataType Type>
+	static void drawInitialVoxelBelow(int x, int voxelX, int voxelY, int voxelZ,
+		const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+		VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+		const Double2 &farPoint, const HeightProjector &nearProjector,
+		const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+		const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+		const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame);
+
+	template <VoxelDataType Type>
+	static void drawInitialVoxelAbove(int x, int voxelX, int voxelY, int voxelZ,
+		const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+		VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+		const Double2 &farPoint, const HeightProjector &nearProjector,
+		const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+		const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+		const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame);
 
-	// Manages drawing voxels in the column that the player is in.
+	template <VoxelDataType Type>
+	static void drawVoxel(int x, int voxelX, int voxelY, int voxelZ,
+		const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+		VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+		const Double2 &farPoint, const HeightProjector &nearProjector,
+		const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+		const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+		const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame);
+
+	template <VoxelDataType Type>
+	static void drawVoxelBelow(int x, int voxelX, int voxelY, int voxelZ,
+		const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+		VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+		const Double2 &farPoint, const HeightProjector &nearProjector,
+		const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+		const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+		const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame);
+
+	template <VoxelDataType Type>
+	static void drawVoxelAbove(int x, int voxelX, int voxelY, int voxelZ,
+		const VoxelData &voxelData, const Camera &camera, const Ray &ray,
+		VoxelData::Facing facing, const Double3 &wallNormal, const Double2 &nearPoint,
+		const Double2 &farPoint, const HeightProjector &nearProjector,
+		const HeightProjector &farProjector, double nearZ, double farZ, double wallU,
+		const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid,
+		const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame);
+
+	// Tables of the voxel drawers above for each voxel data type.
+	static const VoxelDrawTable INITIAL_VOXEL_DRAWERS;
+	static const VoxelDrawTable INITIAL_VOXEL_BELOW_DRAWERS;
+	static const VoxelDrawTable INITIAL_VOXEL_ABOVE_DRAWERS;
+	static const VoxelDrawTable VOXEL_DRAWERS;
+	static const VoxelDrawTable VOXEL_BELOW_DRAWERS;
+	static const VoxelDrawTable VOXEL_ABOVE_DRAWERS;
+
+	// Manages drawing voxels in the column that the player is in. The voxel data types are
+	// indexed by voxel ID, and empty voxels are skipped without reading their voxel data.
 	static void drawInitialVoxelColumn(int x, int voxelX, int voxelZ, const Camera &camera,
 		const Ray &ray, VoxelData::Facing facing, const Double2 &nearPoint,
 		const Double2 &farPoint, double nearZ, double farZ, const ShadingInfo &shadingInfo,
-		double ceilingHeight, const VoxelGrid &voxelGrid,
+		double ceilingHeight, const VoxelGrid &voxelGrid, const uint8_t *voxelDataTypes,
 		const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame);
 
 	// Manages drawing voxels in the column of the given XZ coordinate in the voxel grid.
 	static void drawVoxelColumn(int x, int voxelX, int voxelZ, const Camera &camera,
 		const Ray &ray, VoxelData::Facing facing, const Double2 &nearPoint,
 		const Double2 &farPoint, double nearZ, double farZ, const ShadingInfo &shadingInfo,
-		double ceilingHeight, const VoxelGrid &voxelGrid, const VoxelTextureArray &textures,
-		OcclusionData &occlusion, const FrameView &frame);
+		double ceilingHeight, const VoxelGrid &voxelGrid, const uint8_t *voxelDataTypes,
+		const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame);
 
 	// Draws the portion of a flat contained within the given X range of the screen. The end
-	// X value is exclusive.
-	static void drawFlat(int startX, int endX, const Flat::Frame &flatFrame, 
-		const Double3 &normal, bool flipped, const Double2 &eye, const ShadingInfo &shadingInfo, 
+	// X value is exclusive. Partially transparent texels go to the frame's fragments if it
+	// has them, or are drawn as opaque otherwise.
+	static void drawFlat(int startX, int endX, const FlatFrame &flatFrame, 
+		bool flipped, const Double2 &eye, const ShadingInfo &shadingInfo, 
 		const FlatTexture &texture, const FrameView &frame);
 
-	// To do: drawAlphaFlat(...), for flats with partial transparency.
-	// - Must be back to front.
+	// Draws a flat too small for its texture to matter as one pixel of its average color,
+	// if its center is within the given X range of the screen.
+	static void drawFlatDot(int startX, int endX, const FlatFrame &flatFrame,
+		const Double2 &eye, const ShadingInfo &shadingInfo, const FlatTexture &texture,
+		const FrameView &frame);
 
 	// Casts a 2D ray that steps through the current floor, rendering all voxels
 	// in the XZ column of each voxel.
 	static void rayCast2D(int x, const Camera &camera, const Ray &ray,
 		const ShadingInfo &shadingInfo, double ceilingHeight, const VoxelGrid &voxelGrid, 
-		const VoxelTextureArray &textures, OcclusionData &occlusion, const FrameView &frame);
+		const uint8_t *voxelDataTypes, const VoxelTextureArray &textures,
+		OcclusionData &occlusion, const FrameView &frame);
+
+	// Gets the voxel texture slots a voxel data samples, one bit per slot.
+	static uint64_t getVoxelTextureMask(const VoxelData &voxelData);
+
+	// Re-reads the type and texture slots of each voxel data if the voxel grid changed
+	// since the last frame.
+	void updateVoxelDataTypes(const VoxelGrid &voxelGrid);
+
+	// Keeps the current frame's sampled textures as their last-used frames.
+	void updateTextureFrames();
+
+	// Rebuilds the camera-space ray direction of each column if the screen width, zoom, or
+	// aspect ratio have changed since the last frame.
+	void updateColumnRayDirections(const Camera &camera);
+
+	// Fills the background color of each screen row for the camera's Y-shear, blending the
+	// horizon and zenith colors by each row's angle above the horizon.
+	void updateSkyRowColors(const Camera &camera, const ShadingInfo &shadingInfo);
+
+	// Refreshes the list of flats to be drawn. Only touches flat members, so it can run on
+	// a worker while the rest of the frame is set up. Chunks the visible set says can't be
+	// seen from the camera's chunk are skipped, if it's given.
+	void updateVisibleFlats(const Camera &camera, const PotentiallyVisibleSet *visibleSet);
+
+	// Sorts the visible flats farthest to nearest, starting from the last frame's order
+	// since it barely changes between frames.
+	void sortVisibleFlats();
+
+	// Re-sorts every light into the voxel columns within its reach.
+	void updateLightGrid();
+
+	// Gets the range of screen columns that a visible flat might cover. The end is exclusive.
+	void getFlatColumnRange(const FlatFrame &flatFrame, int *startColumn, 
+		int *endColumn) const;
+
+	// Marks the columns covered by visible flats in the occlusion data, so the opaque pixels
+	// in them write depth.
+	void updateFlatColumns();
+
+	// Sorts visible flats into the column tiles they overlap, keeping them back to front.
+	void binVisibleFlats(int tileCount);
+
+	// Picks the active render thread count for the next frame from this frame's busy times.
+	// It grows as soon as the pass doesn't fit the budget, and shrinks one thread at a time
+	// once fewer threads would have fit for a while.
+	void updateActiveThreadCount(double passSeconds);
+
+	// Calls the function with each block of indices in [0, count) as [start, end), spread
+	// across the job system at frame priority. Returns when all blocks are done.
+	void parallelForBlocks(int count, const std::function<void(int, int)> &function);
+
+	// Draws the scene to the output color buffer with the given occlusion mode (either 
+	// depth test or culling).
+	void renderScene(const Double3 &eye, const Double3 &direction, double fovY, 
+		double ambient, double daytimePercent, double ceilingHeight,
+		const VoxelGrid &voxelGrid, OcclusionMode occlusionMode, uint32_t *colorBuffer);
+
+	// Fills in the columns that an interlaced frame skipped. They're copied from the last
+	// frame if the camera turned less than half a column since then and didn't move, and
+	// otherwise blended from the drawn columns on either side. Returns whether the last
+	// frame was used.
+	bool fillSkippedColumns(const Camera &camera, const Double3 &direction, double fovY,
+		uint32_t *colorBuffer);
+
+	// Fills in the columns that foveated rendering skipped by blending the nearest drawn
+	// columns on either side. Returns the number of columns filled.
+	int fillFoveatedColumns(const FrameView &frame, uint32_t *colorBuffer);
 
-	// Refreshes the list of flats to be drawn.
-	void updateVisibleFlats(const Camera &camera);
+	// Blends the cost view's heatmap over the finished output.
+	void drawCostView(uint32_t *colorBuffer);
 public:
-	SoftwareRenderer(int width, int height);
+	SoftwareRenderer(int width, int height, JobSystem &jobSystem);
+	~SoftwareRenderer();
 
 	// Adds a flat. Causes an error if the ID exists.
 	void addFlat(int id, const Double3 &position, double width, double height, int textureID);
@@ -309,10 +1203,14 @@ public:
 	void addLight(int id, const Double3 &point, const Double3 &color, double intensity);
 
 	// Updates various data for a flat. If a value doesn't need updating, pass null.
-	// Causes an error if no ID matches.
-	void updateFlat(int id, const Double3 *position, const double *width, 
+	// Causes an error if no ID matches. Returns whether any of the flat's values changed.
+	bool updateFlat(int id, const Double3 *position, const double *width, 
 		const double *height, const int *textureID, const bool *flipped);
 
+	// Returns whether updating a flat with the given values would change it. Only reads the
+	// flat, so it's safe while a frame is being drawn.
+	bool isFlatChanged(int id, const Double3 &position, int textureID, bool flipped) const;
+
 	// Updates various data for a light. If a value doesn't need updating, pass null.
 	// Causes an error if no ID matches.
 	void updateLight(int id, const Double3 *point, const Double3 *color,
@@ -328,30 +1226,135 @@ public:
 	// Overwrites the selected voxel texture's data with the given 64x64 set of texels.
 	void setVoxelTexture(int id, const uint32_t *srcTexels);
 
+	// Overwrites several voxel textures at once, converting them in parallel. Each ID must
+	// be different.
+	void setVoxelTextures(const std::vector<int> &ids,
+		const std::vector<const uint32_t*> &srcTexels);
+
 	// Overwrites the selected flat texture's data with the given set of texels and dimensions.
 	void setFlatTexture(int id, const uint32_t *srcTexels, int width, int height);
 
+	// Sets the active level's baked static lights, or null if it has none. The light map
+	// is shared with the level that caches it.
+	void setLightMap(const std::shared_ptr<const LightMap> &lightMap);
+
+	// Sets which chunks of the active level can see each other, or null if that isn't
+	// known. It's only used while it matches the voxel grid being drawn.
+	void setPotentiallyVisibleSet(const std::shared_ptr<const PotentiallyVisibleSet> &visibleSet);
+
 	// Sets whether night lights and night textures are active. This only needs to be set for
 	// exterior locations (i.e., cities and wilderness) because those are the only places
 	// with time-dependent light sources and textures.
 	void setNightLightsActive(bool active);
 
+	// Sets how many steps the colors of wet and lava chasms are cycled by, like the palette
+	// cycling of the original game. It only animates them when rendering paletted. Returns
+	// whether the next frame looks different because of it.
+	bool setLiquidCycleStep(int step);
+
 	// Removes a flat. Causes an error if no ID matches.
 	void removeFlat(int id);
 
+	// Frees a flat texture that's no longer used (i.e., an animation frame of something
+	// that left the level), so its ID can be set again. Flats still using the ID draw
+	// nothing.
+	void removeFlatTexture(int id);
+
 	// Removes a light. Causes an error if no ID matches.
 	void removeLight(int id);
 
+	// Sets how far open the door in the given voxel is. A closed door is removed, since
+	// doors at rest aren't stored.
+	void setDoorOpenPercent(const Int3 &voxel, double percent);
+
+	// Closes all doors, like when the level changes.
+	void clearDoors();
+
 	// Zeroes out all voxel and flat textures.
 	void clearTextures();
 
 	// Resizes the frame buffer and related values.
 	void resize(int width, int height);
 
+	// Gets the busy and idle times of each render thread from the most recent frame.
+	// Threads that weren't active are zero.
+	const std::vector<ThreadTimes> &getThreadTimes() const;
+
+	// Gets the number of frames rendered so far, and the frame a voxel or flat texture was
+	// last sampled in, or -1 if it hasn't been since it was set. For finding the textures
+	// a level actually draws.
+	int getFrameCount() const;
+	int getVoxelTextureLastFrame(int id) const;
+	int getFlatTextureLastFrame(int id) const;
+
+	// Sets how long the render pass should take. When it takes a fraction of that, the
+	// pass runs on fewer threads, down to one, so idle workers aren't woken for nothing.
+	// Zero always uses every render thread.
+	void setRenderThreadBudget(double seconds);
+
+	// Gets the counters from the most recent frame. They are all zero unless enabled.
+	const RenderStats &getRenderStats() const;
+
+	// Sets whether render threads count their work each frame.
+	void setRenderStatsEnabled(bool renderStatsEnabled);
+
+	// Sets whether voxel textures always use their full-size mip level (the original look).
+	void setForceBaseMipLevel(bool forceBaseMipLevel);
+
+	// Sets whether voxels are drawn from palette indices with precalculated shade tables 
+	// instead of being shaded per pixel. Shading and fog are quantized in this mode.
+	void setPalettedRendering(bool palettedRendering);
+
+	// Sets whether the scene is drawn into column-major buffers and transposed into the
+	// output afterwards, so the column kernels don't stride across rows.
+	void setColumnMajorRendering(bool columnMajorRendering);
+
+	// Sets how many pixels of a floor or ceiling column share an exact perspective-correct
+	// calculation (like Quake's spans). 1 gives exact perspective for every pixel.
+	void setPerspectiveSpanLength(int perspectiveSpanLength);
+
+	// Sets whether the floor and ceiling planes are gathered while ray casting and then drawn 
+	// row by row, instead of with perspective inside each column.
+	void setRowPlaneRendering(bool rowPlaneRendering);
+
+	// Sets whether the column kernels only write texels, facings, and depths, and a separate
+	// pass shades each column tile afterwards. This overrides paletted rendering.
+	void setDeferredShading(bool deferredShading);
+
+	// Sets whether only half of the columns are ray cast each frame, alternating between
+	// even and odd ones, with the others filled in afterwards.
+	void setInterlacedRendering(bool interlacedRendering);
+
+	// Sets every how many columns are ray cast toward the left and right edges of the
+	// screen, where the rest are blended from their neighbors. The middle of the screen is
+	// always cast in full. 1 casts every column. It has no effect while interlacing.
+	void setFoveatedColumnStride(int foveatedColumnStride);
+
+	// Gets the current occlusion mode.
+	OcclusionMode getOcclusionMode() const;
+
+	// Gets the number of pixels that differed between the depth-tested and culled frames 
+	// in the last frame rendered with OcclusionMode::Compare.
+	int getOcclusionMismatchCount() const;
+
+	// Sets how opaque voxel pixels are occluded.
+	void setOcclusionMode(OcclusionMode occlusionMode);
+
+	// Gets the current cost view.
+	CostView getCostView() const;
+
+	// Sets which debug heatmap, if any, is drawn over the scene.
+	void setCostView(CostView costView);
+
 	// Draws the scene to the output color buffer in ARGB8888 format.
 	void render(const Double3 &eye, const Double3 &direction, double fovY, 
 		double ambient, double daytimePercent, double ceilingHeight,
 		const VoxelGrid &voxelGrid, uint32_t *colorBuffer);
+
+	// Converts a frame from render() to RGB565 pixels, blocks of rows spread across the
+	// job system. An ordered dither hides the banding fog and shading gradients would
+	// otherwise have. The pitch is in bytes.
+	void packRGB565(const uint32_t *colorBuffer, uint16_t *dstPixels, int dstPitch);
 };
 
 #endif
@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "SDL.h"
+
+#include "SpanShading.h"
+
+// Decide which vector paths can be compiled for the target architecture. AVX2 is compiled
+// per-function so the rest of the program doesn't require it.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SPAN_SHADING_SSE2
+#include <emmintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SPAN_SHADING_AVX2
+#define SPAN_SHADING_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define SPAN_SHADING_AVX2
+#define SPAN_SHADING_AVX2_TARGET
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define SPAN_SHADING_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// Percent values for each 8-bit channel. Using a table keeps the reference path's
+	// colors identical to dividing by 255 without a division per channel.
+	const std::array<double, 256> ChannelPercents = []()
+	{
+		std::array<double, 256> percents;
+		for (size_t i = 0; i < percents.size(); i++)
+		{
+			percents[i] = static_cast<double>(i) / 255.0;
+		}
+
+		return percents;
+	}();
+
+	void shadeScalar(SpanShading::Span &span, const Double3 &shading, const Double3 &fogColor)
+	{
+		for (int i = 0; i < span.count; i++)
+		{
+			// Texture color with shading.
+			const double shadingMax = 1.0;
+			const double emission = ChannelPercents[span.emission[i]];
+			double colorR = ChannelPercents[span.r[i]] *
+				std::min(shading.x + emission, shadingMax);
+			double colorG = ChannelPercents[span.g[i]] *
+				std::min(shading.y + emission, shadingMax);
+			double colorB = ChannelPercents[span.b[i]] *
+				std::min(shading.z + emission, shadingMax);
+
+			// Linearly interpolate with fog.
+			const double fogPercent = span.fogPercents[i];
+			colorR += (fogColor.x - colorR) * fogPercent;
+			colorG += (fogColor.y - colorG) * fogPercent;
+			colorB += (fogColor.z - colorB) * fogPercent;
+
+			// Clamp maximum (don't worry about negative values).
+			const double high = 1.0;
+			colorR = (colorR > high) ? high : colorR;
+			colorG = (colorG > high) ? high : colorG;
+			colorB = (colorB > high) ? high : colorB;
+
+			// Convert floats to integers.
+			span.colors[i] = static_cast<uint32_t>(
+				((static_cast<uint8_t>(colorR * 255.0)) << 16) |
+				((static_cast<uint8_t>(colorG * 255.0)) << 8) |
+				((static_cast<uint8_t>(colorB * 255.0))));
+		}
+	}
+
+#ifdef SPAN_SHADING_SSE2
+	// Converts four 8-bit channel values to 0->1 floats.
+	__m128 loadChannelSSE2(const uint8_t *channel)
+	{
+		int32_t packed;
+		std::memcpy(&packed, channel, sizeof(packed));
+
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i bytes = _mm_cvtsi32_si128(packed);
+		const __m128i words = _mm_unpacklo_epi8(bytes, zero);
+		const __m128i dwords = _mm_unpacklo_epi16(words, zero);
+		return _mm_mul_ps(_mm_cvtepi32_ps(dwords), _mm_set1_ps(1.0f / 255.0f));
+	}
+
+	// Applies shading and fog to four values of one channel and converts them to 0->255.
+	__m128i shadeChannelSSE2(__m128 texel, __m128 emission, __m128 shading, __m128 fogColor,
+		__m128 fogPercent)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		__m128 color = _mm_mul_ps(texel, _mm_min_ps(_mm_add_ps(shading, emission), one));
+		color = _mm_add_ps(color, _mm_mul_ps(_mm_sub_ps(fogColor, color), fogPercent));
+		color = _mm_min_ps(color, one);
+		return _mm_cvttps_epi32(_mm_mul_ps(color, _mm_set1_ps(255.0f)));
+	}
+
+	void shadeSSE2(SpanShading::Span &span, const Double3 &shading, const Double3 &fogColor)
+	{
+		const __m128 shadingR = _mm_set1_ps(static_cast<float>(shading.x));
+		const __m128 shadingG = _mm_set1_ps(static_cast<float>(shading.y));
+		const __m128 shadingB = _mm_set1_ps(static_cast<float>(shading.z));
+		const __m128 fogR = _mm_set1_ps(static_cast<float>(fogColor.x));
+		const __m128 fogG = _mm_set1_ps(static_cast<float>(fogColor.y));
+		const __m128 fogB = _mm_set1_ps(static_cast<float>(fogColor.z));
+
+		for (int i = 0; i < span.count; i += 4)
+		{
+			const __m128 texelR = loadChannelSSE2(span.r + i);
+			const __m128 texelG = loadChannelSSE2(span.g + i);
+			const __m128 texelB = loadChannelSSE2(span.b + i);
+			const __m128 emission = loadChannelSSE2(span.emission + i);
+			const __m128 fogPercent = _mm_movelh_ps(
+				_mm_cvtpd_ps(_mm_load_pd(span.fogPercents + i)),
+				_mm_cvtpd_ps(_mm_load_pd(span.fogPercents + i + 2)));
+
+			const __m128i colorR = shadeChannelSSE2(texelR, emission, shadingR, fogR, fogPercent);
+			const __m128i colorG = shadeChannelSSE2(texelG, emission, shadingG, fogG, fogPercent);
+			const __m128i colorB = shadeChannelSSE2(texelB, emission, shadingB, fogB, fogPercent);
+
+			const __m128i colorRGB = _mm_or_si128(_mm_or_si128(
+				_mm_slli_epi32(colorR, 16), _mm_slli_epi32(colorG, 8)), colorB);
+			_mm_store_si128(reinterpret_cast<__m128i*>(span.colors + i), colorRGB);
+		}
+	}
+#endif
+
+#ifdef SPAN_SHADING_AVX2
+	// Converts eight 8-bit channel values to 0->1 floats.
+	SPAN_SHADING_AVX2_TARGET __m256 loadChannelAVX2(const uint8_t *channel)
+	{
+		const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(channel));
+		return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)),
+			_mm256_set1_ps(1.0f / 255.0f));
+	}
+
+	// Applies shading and fog to eight values of one channel and converts them to 0->255.
+	SPAN_SHADING_AVX2_TARGET __m256i shadeChannelAVX2(__m256 texel, __m256 emission,
+		__m256 shading, __m256 fogColor, __m256 fogPercent)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		__m256 color = _mm256_mul_ps(texel, _mm256_min_ps(_mm256_add_ps(shading, emission), one));
+		color = _mm256_add_ps(color, _mm256_mul_ps(_mm256_sub_ps(fogColor, color), fogPercent));
+		color = _mm256_min_ps(color, one);
+		return _mm256_cvttps_epi32(_mm256_mul_ps(color, _mm256_set1_ps(255.0f)));
+	}
+
+	SPAN_SHADING_AVX2_TARGET void shadeAVX2(SpanShading::Span &span, const Double3 &shading,
+		const Double3 &fogColor)
+	{
+		const __m256 shadingR = _mm256_set1_ps(static_cast<float>(shading.x));
+		const __m256 shadingG = _mm256_set1_ps(static_cast<float>(shading.y));
+		const __m256 shadingB = _mm256_set1_ps(static_cast<float>(shading.z));
+		const __m256 fogR = _mm256_set1_ps(static_cast<float>(fogColor.x));
+		const __m256 fogG = _mm256_set1_ps(static_cast<float>(fogColor.y));
+		const __m256 fogB = _mm256_set1_ps(static_cast<float>(fogColor.z));
+
+		for (int i = 0; i < span.count; i += 8)
+		{
+			const __m256 texelR = loadChannelAVX2(span.r + i);
+			const __m256 texelG = loadChannelAVX2(span.g + i);
+			const __m256 texelB = loadChannelAVX2(span.b + i);
+			const __m256 emission = loadChannelAVX2(span.emission + i);
+			const __m256 fogPercent = _mm256_insertf128_ps(
+				_mm256_castps128_ps256(_mm256_cvtpd_ps(_mm256_load_pd(span.fogPercents + i))),
+				_mm256_cvtpd_ps(_mm256_load_pd(span.fogPercents + i + 4)), 1);
+
+			const __m256i colorR = shadeChannelAVX2(texelR, emission, shadingR, fogR, fogPercent);
+			const __m256i colorG = shadeChannelAVX2(texelG, emission, shadingG, fogG, fogPercent);
+			const __m256i colorB = shadeChannelAVX2(texelB, emission, shadingB, fogB, fogPercent);
+
+			const __m256i colorRGB = _mm256_or_si256(_mm256_or_si256(
+				_mm256_slli_epi32(colorR, 16), _mm256_slli_epi32(colorG, 8)), colorB);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(span.colors + i), colorRGB);
+		}
+	}
+#endif
+
+#ifdef SPAN_SHADING_NEON
+	// Applies shading and fog to four values of one channel and converts them to 0->255.
+	uint32x4_t shadeChannelNEON(float32x4_t texel, float32x4_t emission, float32x4_t shading,
+		float32x4_t fogColor, float32x4_t fogPercent)
+	{
+		const float32x4_t one = vdupq_n_f32(1.0f);
+		float32x4_t color = vmulq_f32(texel, vminq_f32(vaddq_f32(shading, emission), one));
+		color = vaddq_f32(color, vmulq_f32(vsubq_f32(fogColor, color), fogPercent));
+		color = vminq_f32(color, one);
+		return vcvtq_u32_f32(vmulq_f32(color, vdupq_n_f32(255.0f)));
+	}
+
+	void shadeNEON(SpanShading::Span &span, const Double3 &shading, const Double3 &fogColor)
+	{
+		const float32x4_t shadingR = vdupq_n_f32(static_cast<float>(shading.x));
+		const float32x4_t shadingG = vdupq_n_f32(static_cast<float>(shading.y));
+		const float32x4_t shadingB = vdupq_n_f32(static_cast<float>(shading.z));
+		const float32x4_t fogR = vdupq_n_f32(static_cast<float>(fogColor.x));
+		const float32x4_t fogG = vdupq_n_f32(static_cast<float>(fogColor.y));
+		const float32x4_t fogB = vdupq_n_f32(static_cast<float>(fogColor.z));
+		const float32x4_t channelScale = vdupq_n_f32(1.0f / 255.0f);
+
+		// All eight values of each channel are widened at once, then shaded in two halves.
+		const uint16x8_t wideR = vmovl_u8(vld1_u8(span.r));
+		const uint16x8_t wideG = vmovl_u8(vld1_u8(span.g));
+		const uint16x8_t wideB = vmovl_u8(vld1_u8(span.b));
+		const uint16x8_t wideEmission = vmovl_u8(vld1_u8(span.emission));
+
+		alignas(16) float fogPercents[SpanShading::MAX_PIXELS];
+		for (int i = 0; i < span.count; i++)
+		{
+			fogPercents[i] = static_cast<float>(span.fogPercents[i]);
+		}
+
+		for (int half = 0; (half * 4) < span.count; half++)
+		{
+			auto toPercents = [half, channelScale](uint16x8_t wide)
+			{
+				const uint16x4_t narrow = (half == 0) ? vget_low_u16(wide) : vget_high_u16(wide);
+				return vmulq_f32(vcvtq_f32_u32(vmovl_u16(narrow)), channelScale);
+			};
+
+			const float32x4_t texelR = toPercents(wideR);
+			const float32x4_t texelG = toPercents(wideG);
+			const float32x4_t texelB = toPercents(wideB);
+			const float32x4_t emission = toPercents(wideEmission);
+			const float32x4_t fogPercent = vld1q_f32(fogPercents + (half * 4));
+
+			const uint32x4_t colorR = shadeChannelNEON(texelR, emission, shadingR, fogR, fogPercent);
+			const uint32x4_t colorG = shadeChannelNEON(texelG, emission, shadingG, fogG, fogPercent);
+			const uint32x4_t colorB = shadeChannelNEON(texelB, emission, shadingB, fogB, fogPercent);
+
+			const uint32x4_t colorRGB = vorrq_u32(vorrq_u32(
+				vshlq_n_u32(colorR, 16), vshlq_n_u32(colorG, 8)), colorB);
+			vst1q_u32(span.colors + (half * 4), colorRGB);
+		}
+	}
+#endif
+
+	// Instruction set used by SpanShading::shade(). Picked once at startup.
+	SpanShading::InstructionSet CurrentInstructionSet = SpanShading::getBestInstructionSet();
+}
+
+SpanShading::Span::Span()
+{
+	// Zero everything so unused vector lanes never see uninitialized values.
+	std::fill(std::begin(this->r), std::end(this->r), 0);
+	std::fill(std::begin(this->g), std::end(this->g), 0);
+	std::fill(std::begin(this->b), std::end(this->b), 0);
+	std::fill(std::begin(this->emission), std::end(this->emission), 0);
+	std::fill(std::begin(this->fogPercents), std::end(this->fogPercents), 0.0);
+	std::fill(std::begin(this->colors), std::end(this->colors), 0);
+	this->count = 0;
+}
+
+SpanShading::InstructionSet SpanShading::getBestInstructionSet()
+{
+#ifdef SPAN_SHADING_AVX2
+	if (SDL_HasAVX2())
+	{
+		return InstructionSet::AVX2;
+	}
+#endif
+
+#ifdef SPAN_SHADING_SSE2
+	if (SDL_HasSSE2())
+	{
+		return InstructionSet::SSE2;
+	}
+#endif
+
+#ifdef SPAN_SHADING_NEON
+#if SDL_VERSION_ATLEAST(2, 0, 6)
+	if (SDL_HasNEON())
+	{
+		return InstructionSet::NEON;
+	}
+#else
+	// The build itself targets NEON, so the CPU must have it.
+	return InstructionSet::NEON;
+#endif
+#endif
+
+	return InstructionSet::Scalar;
+}
+
+SpanShading::InstructionSet SpanShading::getInstructionSet()
+{
+	return CurrentInstructionSet;
+}
+
+const char *SpanShading::getInstructionSetName(InstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+	case InstructionSet::SSE2:
+		return "SSE2";
+	case InstructionSet::AVX2:
+		return "AVX2";
+	case InstructionSet::NEON:
+		return "NEON";
+	default:
+		return "Scalar";
+	}
+}
+
+void SpanShading::setInstructionSet(InstructionSet instructionSet)
+{
+	// Only allow instruction sets that this build and CPU support.
+	const InstructionSet bestSet = SpanShading::getBestInstructionSet();
+	const bool supported = (instructionSet == InstructionSet::Scalar) ||
+		(instructionSet == bestSet) ||
+		((instructionSet == InstructionSet::SSE2) && (bestSet == InstructionSet::AVX2));
+
+	CurrentInstructionSet = supported ? instructionSet : InstructionSet::Scalar;
+}
+
+void SpanShading::shade(Span &span, const Double3 &shading, const Double3 &fogColor)
+{
+	switch (CurrentInstructionSet)
+	{
+#ifdef SPAN_SHADING_SSE2
+	case InstructionSet::SSE2:
+		shadeSSE2(span, shading, fogColor);
+		break;
+#endif
+#ifdef SPAN_SHADING_AVX2
+	case InstructionSet::AVX2:
+		shadeAVX2(span, shading, fogColor);
+		break;
+#endif
+#ifdef SPAN_SHADING_NEON
+	case InstructionSet::NEON:
+		shadeNEON(span, shading, fogColor);
+		break;
+#endif
+	default:
+		shadeScalar(span, shading, fogColor);
+		break;
+	}
+}
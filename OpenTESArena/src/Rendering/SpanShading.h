@@ -0,0 +1,67 @@
+#ifndef SPAN_SHADING_H
+#define SPAN_SHADING_H
+
+#include <cstdint>
+
+#include "../Math/Vector3.h"
+
+// Static class for shading runs of texels in a screen column. The software renderer's
+// column kernels collect the texels that pass the depth test into a span, and this class
+// applies shading and fog to all of them at once and packs the results to RGB.
+
+// The scalar path is the reference implementation. The vector paths process four or eight
+// pixels per iteration in single precision, so they may differ from the reference by one
+// color step at most.
+
+class SpanShading
+{
+public:
+	enum class InstructionSet
+	{
+		Scalar,
+		SSE2,
+		AVX2,
+		NEON
+	};
+
+	// Max number of pixels in a span.
+	static const int MAX_PIXELS = 8;
+
+	// A run of texels and their fog amounts, stored as separate arrays so they can be
+	// loaded straight into vector registers.
+	struct Span
+	{
+		alignas(16) uint8_t r[SpanShading::MAX_PIXELS];
+		alignas(16) uint8_t g[SpanShading::MAX_PIXELS];
+		alignas(16) uint8_t b[SpanShading::MAX_PIXELS];
+		alignas(16) uint8_t emission[SpanShading::MAX_PIXELS];
+		alignas(32) double fogPercents[SpanShading::MAX_PIXELS];
+		alignas(32) uint32_t colors[SpanShading::MAX_PIXELS]; // Output RGB colors.
+		int count;
+
+		Span();
+	};
+private:
+	SpanShading() = delete;
+	~SpanShading() = delete;
+public:
+	// Gets the fastest instruction set supported by both the build and the CPU.
+	static InstructionSet getBestInstructionSet();
+
+	// Gets the instruction set currently used by shade().
+	static InstructionSet getInstructionSet();
+
+	// Gets the display name of an instruction set.
+	static const char *getInstructionSetName(InstructionSet instructionSet);
+
+	// Overrides the instruction set used by shade() (i.e., for comparing against the scalar
+	// reference). Unsupported instruction sets fall back to scalar. This must not be called
+	// while rendering.
+	static void setInstructionSet(InstructionSet instructionSet);
+
+	// Shades every texel in the span with the given light and fog color, writing the packed
+	// RGB results to the span's colors.
+	static void shade(Span &span, const Double3 &shading, const Double3 &fogColor);
+};
+
+#endif
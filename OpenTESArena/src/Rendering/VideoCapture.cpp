@@ -0,0 +1,418 @@
+#include <algorithm>
+#include <fstream>
+
+#include "Renderer.h"
+#include "VideoCapture.h"
+#include "../Math/Vector2.h"
+#include "../Utilities/Debug.h"
+#include "../Utilities/Profiler.h"
+
+namespace
+{
+	// Bytes before the first frame chunk: the RIFF header, the header list with the main
+	// and stream headers, and the start of the movie list.
+	const int AviHeaderBytes = 224;
+
+	// Bytes in each row of a frame, padded to four.
+	int GetAviStride(int width)
+	{
+		return ((width * 3) + 3) & ~3;
+	}
+
+	void AppendLE16(std::vector<uint8_t> &bytes, uint16_t value)
+	{
+		bytes.push_back(static_cast<uint8_t>(value));
+		bytes.push_back(static_cast<uint8_t>(value >> 8));
+	}
+
+	void AppendLE32(std::vector<uint8_t> &bytes, uint32_t value)
+	{
+		AppendLE16(bytes, static_cast<uint16_t>(value));
+		AppendLE16(bytes, static_cast<uint16_t>(value >> 16));
+	}
+
+	void AppendFourCC(std::vector<uint8_t> &bytes, const char *fourCC)
+	{
+		bytes.insert(bytes.end(), fourCC, fourCC + 4);
+	}
+
+	// Makes the headers of an AVI file with one uncompressed 24-bit video stream. The
+	// movie bytes include the 'movi' type.
+	std::vector<uint8_t> MakeAviHeader(int width, int height, int framesPerSecond,
+		uint32_t frameCount, uint32_t movieBytes, uint32_t indexBytes)
+	{
+		const uint32_t frameBytes = GetAviStride(width) * height;
+
+		std::vector<uint8_t> bytes;
+		AppendFourCC(bytes, "RIFF");
+		AppendLE32(bytes, (AviHeaderBytes - 8) + (movieBytes - 4) + (8 + indexBytes));
+		AppendFourCC(bytes, "AVI ");
+
+		AppendFourCC(bytes, "LIST");
+		AppendLE32(bytes, 192);
+		AppendFourCC(bytes, "hdrl");
+
+		AppendFourCC(bytes, "avih");
+		AppendLE32(bytes, 56);
+		AppendLE32(bytes, 1000000 / framesPerSecond);
+		AppendLE32(bytes, frameBytes * framesPerSecond);
+		AppendLE32(bytes, 0);
+		AppendLE32(bytes, 0x10); // Has an index.
+		AppendLE32(bytes, frameCount);
+		AppendLE32(bytes, 0);
+		AppendLE32(bytes, 1); // Streams.
+		AppendLE32(bytes, frameBytes);
+		AppendLE32(bytes, width);
+		AppendLE32(bytes, height);
+		for (int i = 0; i < 4; i++)
+		{
+			AppendLE32(bytes, 0);
+		}
+
+		AppendFourCC(bytes, "LIST");
+		AppendLE32(bytes, 116);
+		AppendFourCC(bytes, "strl");
+
+		AppendFourCC(bytes, "strh");
+		AppendLE32(bytes, 56);
+		AppendFourCC(bytes, "vids");
+		AppendFourCC(bytes, "DIB ");
+		AppendLE32(bytes, 0);
+		AppendLE16(bytes, 0);
+		AppendLE16(bytes, 0);
+		AppendLE32(bytes, 0);
+		AppendLE32(bytes, 1); // Scale.
+		AppendLE32(bytes, framesPerSecond); // Rate.
+		AppendLE32(bytes, 0);
+		AppendLE32(bytes, frameCount);
+		AppendLE32(bytes, frameBytes);
+		AppendLE32(bytes, 0xFFFFFFFF); // Default quality.
+		AppendLE32(bytes, 0);
+		AppendLE16(bytes, 0);
+		AppendLE16(bytes, 0);
+		AppendLE16(bytes, static_cast<uint16_t>(width));
+		AppendLE16(bytes, static_cast<uint16_t>(height));
+
+		AppendFourCC(bytes, "strf");
+		AppendLE32(bytes, 40);
+		AppendLE32(bytes, 40);
+		AppendLE32(bytes, width);
+		AppendLE32(bytes, height); // Positive, so rows are bottom-up.
+		AppendLE16(bytes, 1); // Planes.
+		AppendLE16(bytes, 24); // Bits per pixel.
+		AppendLE32(bytes, 0); // Uncompressed.
+		AppendLE32(bytes, frameBytes);
+		for (int i = 0; i < 4; i++)
+		{
+			AppendLE32(bytes, 0);
+		}
+
+		AppendFourCC(bytes, "LIST");
+		AppendLE32(bytes, movieBytes);
+		AppendFourCC(bytes, "movi");
+
+		DebugAssert(static_cast<int>(bytes.size()) == AviHeaderBytes,
+			"AVI header is " + std::to_string(bytes.size()) + " bytes.");
+		return bytes;
+	}
+}
+
+const int VideoCapture::FRAMES_PER_SECOND = 30;
+const int VideoCapture::BUFFER_COUNT = 8;
+const int VideoCapture::MAX_WIDTH = 960;
+const uint32_t VideoCapture::MAX_MOVIE_BYTES = 1u << 30;
+
+VideoCapture::VideoCapture()
+{
+	this->pendingSeconds = 0.0;
+	this->droppedFrames = 0;
+	this->recording = false;
+	this->stopping = false;
+	this->full = false;
+}
+
+VideoCapture::~VideoCapture()
+{
+	this->stop();
+
+	if (this->thread.joinable())
+	{
+		this->thread.join();
+	}
+}
+
+bool VideoCapture::isRecording() const
+{
+	return this->recording;
+}
+
+void VideoCapture::start(const std::string &filename)
+{
+	if (this->recording)
+	{
+		return;
+	}
+
+	// The previous recording's file is finished before its buffers are reused.
+	if (this->thread.joinable())
+	{
+		this->thread.join();
+	}
+
+	this->buffers.resize(VideoCapture::BUFFER_COUNT);
+	this->freeBuffers.clear();
+	for (int i = 0; i < VideoCapture::BUFFER_COUNT; i++)
+	{
+		this->freeBuffers.push_back(i);
+	}
+
+	this->frames.clear();
+
+	// The frame being presented now is the first one of the video.
+	this->pendingSeconds = 1.0 / static_cast<double>(VideoCapture::FRAMES_PER_SECOND);
+	this->droppedFrames = 0;
+	this->recording = true;
+	this->stopping = false;
+	this->full = false;
+	this->thread = std::thread(&VideoCapture::encode, this, filename);
+
+	DebugMention("Recording video to \"" + filename + "\".");
+}
+
+void VideoCapture::stop()
+{
+	if (!this->recording)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stopping = true;
+	}
+
+	this->frameCondition.notify_one();
+	this->recording = false;
+}
+
+void VideoCapture::captureFrame(Renderer &renderer, double dt)
+{
+	if (!this->recording)
+	{
+		return;
+	}
+
+	ProfileScope("VideoCapture::captureFrame");
+
+	// Frames shorter than the video's frame time are skipped, and longer ones are shown
+	// for as many video frames as they cover.
+	this->pendingSeconds += dt;
+	const int count = static_cast<int>(
+		this->pendingSeconds * static_cast<double>(VideoCapture::FRAMES_PER_SECOND));
+	if (count == 0)
+	{
+		return;
+	}
+
+	this->pendingSeconds -=
+		static_cast<double>(count) / static_cast<double>(VideoCapture::FRAMES_PER_SECOND);
+
+	int bufferIndex = -1;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (this->full)
+		{
+			DebugWarning("Video file is full, recording stopped.");
+			this->stopping = true;
+			this->recording = false;
+		}
+		else if (this->freeBuffers.size() > 0)
+		{
+			bufferIndex = this->freeBuffers.back();
+			this->freeBuffers.pop_back();
+		}
+	}
+
+	if (!this->recording)
+	{
+		this->frameCondition.notify_one();
+		return;
+	}
+
+	// The encoder is behind, so this frame is dropped rather than waited for.
+	if (bufferIndex < 0)
+	{
+		this->droppedFrames += count;
+		return;
+	}
+
+	// Buffers taken from the free list belong to the main thread until they're queued.
+	const Int2 dimensions = renderer.getScreenshot(this->buffers[bufferIndex]);
+
+	Frame frame;
+	frame.bufferIndex = bufferIndex;
+	frame.width = dimensions.x;
+	frame.height = dimensions.y;
+	frame.repeatsBefore = this->droppedFrames;
+	frame.count = count;
+	this->droppedFrames = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->frames.push_back(frame);
+	}
+
+	this->frameCondition.notify_one();
+}
+
+void VideoCapture::encode(const std::string &filename)
+{
+	std::ofstream stream(filename, std::ios::binary);
+	if (!stream.is_open())
+	{
+		DebugWarning("Couldn't open \"" + filename + "\" for recording.");
+	}
+
+	// The headers are written again with the sizes once the recording is over.
+	stream.write(std::vector<char>(AviHeaderBytes, 0).data(), AviHeaderBytes);
+
+	std::vector<uint8_t> index; // 'idx1' entries.
+	std::vector<uint8_t> chunk;
+	uint32_t movieBytes = 4; // Includes the 'movi' type, which chunk offsets are from.
+	uint32_t frameCount = 0;
+	int droppedCount = 0;
+	int width = 0;
+	int height = 0;
+	bool full = !stream.is_open();
+
+	// Appends a frame chunk, or a repeat of the previous frame if it's empty.
+	auto writeChunk = [&stream, &index, &movieBytes, &frameCount](const uint8_t *data,
+		uint32_t size)
+	{
+		AppendFourCC(index, "00db");
+		AppendLE32(index, (size > 0) ? 0x10 : 0); // Key frame.
+		AppendLE32(index, movieBytes);
+		AppendLE32(index, size);
+
+		std::vector<uint8_t> header;
+		AppendFourCC(header, "00db");
+		AppendLE32(header, size);
+		stream.write(reinterpret_cast<const char*>(header.data()), header.size());
+		stream.write(reinterpret_cast<const char*>(data), size);
+
+		movieBytes += 8 + size;
+		frameCount++;
+	};
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+	while (true)
+	{
+		this->frameCondition.wait(lock, [this]()
+		{
+			return this->stopping || (this->frames.size() > 0);
+		});
+
+		if (this->frames.size() == 0)
+		{
+			break;
+		}
+
+		const Frame frame = this->frames.front();
+		this->frames.pop_front();
+		lock.unlock();
+
+		if (!full)
+		{
+			ProfileScope("VideoCapture::encodeFrame");
+
+			// The first frame decides the video's size. Later ones of another size (i.e.,
+			// after a resize) are stretched to it.
+			if (width == 0)
+			{
+				width = frame.width;
+				height = frame.height;
+				while (width > VideoCapture::MAX_WIDTH)
+				{
+					width /= 2;
+					height /= 2;
+				}
+			}
+
+			// Nearest samples of the frame, converted to bottom-up BGR rows.
+			const int stride = GetAviStride(width);
+			chunk.assign(stride * height, 0);
+			const uint32_t *pixels = this->buffers[frame.bufferIndex].data();
+			for (int y = 0; y < height; y++)
+			{
+				const int srcY = (y * frame.height) / height;
+				const uint32_t *srcRow = pixels + (srcY * frame.width);
+				uint8_t *dstRow = chunk.data() + ((height - 1 - y) * stride);
+				for (int x = 0; x < width; x++)
+				{
+					const uint32_t pixel = srcRow[(x * frame.width) / width];
+					dstRow[(x * 3)] = static_cast<uint8_t>(pixel);
+					dstRow[(x * 3) + 1] = static_cast<uint8_t>(pixel >> 8);
+					dstRow[(x * 3) + 2] = static_cast<uint8_t>(pixel >> 16);
+				}
+			}
+
+			// Repeats are empty chunks, apart from the index entry.
+			const uint32_t chunkBytes = static_cast<uint32_t>(chunk.size());
+			const uint32_t neededBytes = chunkBytes + 8 + ((frame.repeatsBefore +
+				frame.count - 1) * 8);
+			if (neededBytes > (VideoCapture::MAX_MOVIE_BYTES - movieBytes))
+			{
+				full = true;
+			}
+			else
+			{
+				for (int i = 0; i < frame.repeatsBefore; i++)
+				{
+					writeChunk(nullptr, 0);
+				}
+
+				writeChunk(chunk.data(), chunkBytes);
+
+				for (int i = 1; i < frame.count; i++)
+				{
+					writeChunk(nullptr, 0);
+				}
+
+				droppedCount += frame.repeatsBefore;
+			}
+		}
+
+		lock.lock();
+		this->freeBuffers.push_back(frame.bufferIndex);
+		this->full |= full;
+	}
+
+	lock.unlock();
+
+	if (!stream.is_open())
+	{
+		return;
+	}
+
+	// An empty recording still gets valid headers.
+	if (width == 0)
+	{
+		width = 1;
+		height = 1;
+	}
+
+	const uint32_t indexBytes = static_cast<uint32_t>(index.size());
+	std::vector<uint8_t> indexHeader;
+	AppendFourCC(indexHeader, "idx1");
+	AppendLE32(indexHeader, indexBytes);
+	stream.write(reinterpret_cast<const char*>(indexHeader.data()), indexHeader.size());
+	stream.write(reinterpret_cast<const char*>(index.data()), indexBytes);
+
+	const std::vector<uint8_t> header = MakeAviHeader(width, height,
+		VideoCapture::FRAMES_PER_SECOND, frameCount, movieBytes, indexBytes);
+	stream.seekp(0);
+	stream.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+	DebugMention("Video saved to \"" + filename + "\" (" + std::to_string(frameCount) +
+		" frames, " + std::to_string(droppedCount) + " dropped).");
+}
@@ -0,0 +1,77 @@
+#ifndef VIDEO_CAPTURE_H
+#define VIDEO_CAPTURE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records presented frames to an uncompressed AVI file, for showing hitches in bug reports.
+// Frames are read into a fixed pool of buffers on the main thread and written by an encoder
+// thread. When every buffer is still waiting to be written, the frame is dropped instead of
+// waiting, and the video repeats the previous one so it keeps real time.
+
+// Presented frames are sampled at the video's frame rate, so a stutter shows up as repeated
+// frames. Frames are scaled down to a width the disk can keep up with.
+
+class Renderer;
+
+class VideoCapture
+{
+private:
+	// Frame rate of the video.
+	static const int FRAMES_PER_SECOND;
+
+	// Frames that can be waiting on the encoder before new ones are dropped.
+	static const int BUFFER_COUNT;
+
+	// Frames are halved until they're no wider than this.
+	static const int MAX_WIDTH;
+
+	// Recording stops before the file's frame data would pass this, since players don't
+	// handle AVI files over this size without extended indices.
+	static const uint32_t MAX_MOVIE_BYTES;
+
+	struct Frame
+	{
+		int bufferIndex;
+		int width, height;
+		int repeatsBefore; // Frames dropped since the last one, shown as repeats of it.
+		int count; // Video frames it lasts.
+	};
+
+	std::vector<std::vector<uint32_t>> buffers;
+	std::vector<int> freeBuffers; // Indices of buffers not waiting on the encoder.
+	std::deque<Frame> frames; // Waiting on the encoder, oldest first.
+	std::mutex mutex;
+	std::condition_variable frameCondition; // Notified when a frame is queued, or on stop.
+	std::thread thread;
+	double pendingSeconds; // Presented time not yet covered by video frames.
+	int droppedFrames; // Since the last queued frame.
+	bool recording;
+	bool stopping; // The encoder finishes the file once the queue is empty.
+	bool full; // Set by the encoder once the file can't take any more frames.
+
+	// Writes queued frames to the file until stopped. Runs on the encoder thread.
+	void encode(const std::string &filename);
+public:
+	VideoCapture();
+	~VideoCapture();
+
+	bool isRecording() const;
+
+	// Starts recording to the given file. Does nothing if already recording.
+	void start(const std::string &filename);
+
+	// Stops recording. The encoder finishes the file in the background.
+	void stop();
+
+	// Reads the renderer's last presented frame if it's time for another video frame.
+	// Called after each present with the frame's delta time.
+	void captureFrame(Renderer &renderer, double dt);
+};
+
+#endif
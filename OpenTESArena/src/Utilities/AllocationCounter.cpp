@@ -0,0 +1,74 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+#ifndef NDEBUG
+namespace
+{
+	// A plain global so it's usable before any static constructors run.
+	std::atomic<uint64_t> Count(0);
+
+	void *Allocate(size_t size)
+	{
+		Count.fetch_add(1, std::memory_order_relaxed);
+
+		void *ptr = std::malloc((size > 0) ? size : 1);
+		if (ptr == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+
+		return ptr;
+	}
+}
+
+void *operator new(size_t size)
+{
+	return Allocate(size);
+}
+
+void *operator new[](size_t size)
+{
+	return Allocate(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+#endif
+
+bool AllocationCounter::isEnabled()
+{
+#ifndef NDEBUG
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64_t AllocationCounter::getCount()
+{
+#ifndef NDEBUG
+	return Count.load(std::memory_order_relaxed);
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,23 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+// Static class for counting heap allocations in debug builds, so the debug text can show
+// how many a frame makes. It replaces the global operator new, which counts on every
+// thread. Release builds use the standard one and the count is always zero.
+
+class AllocationCounter
+{
+private:
+	AllocationCounter() = delete;
+	~AllocationCounter() = delete;
+public:
+	// Whether allocations are being counted in this build.
+	static bool isEnabled();
+
+	// Gets the number of allocations since the program started.
+	static uint64_t getCount();
+};
+
+#endif
@@ -17,6 +17,17 @@ uint32_t Bytes::getLE32(const uint8_t *buf)
 	return buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
 }
 
+uint64_t Bytes::hash(const uint8_t *buf, size_t size)
+{
+	uint64_t value = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < size; i++)
+	{
+		value = (value ^ buf[i]) * 0x100000001B3ULL;
+	}
+
+	return value;
+}
+
 uint16_t Bytes::ror16(uint16_t value, unsigned int count)
 {
 	const unsigned int mask = (CHAR_BIT * sizeof(value)) - 1;
@@ -1,6 +1,7 @@
 #ifndef BYTES_H
 #define BYTES_H
 
+#include <cstddef>
 #include <cstdint>
 
 // Static class for interacting with bits and bytes. For example, reading bytes from a 
@@ -21,6 +22,9 @@ public:
 
 	// Circular rotation of a 32-bit integer to the left.
 	static uint32_t rol32(uint32_t value, unsigned int count);
+
+	// 64-bit FNV-1a hash of a byte buffer. Fast and well spread, but not cryptographic.
+	static uint64_t hash(const uint8_t *buf, size_t size);
 };
 
 #endif
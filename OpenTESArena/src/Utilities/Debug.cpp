@@ -1,5 +1,10 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -29,6 +34,124 @@ namespace
 		{ Debug::MessageType::Warning, "Warning: " },
 		{ Debug::MessageType::Error, "Error: " },
 	};
+
+	// A debug message waiting to be written. File paths are from __FILE__, so they're
+	// string literals that outlive the queue.
+	struct LogEntry
+	{
+		Debug::MessageType type;
+		const char *file;
+		int lineNumber;
+		std::string message;
+	};
+
+	// Messages queued for the logging thread, oldest first. The thread is started by the
+	// first message and joined when the program exits, after writing what's left.
+	class LogSink
+	{
+	public:
+		typedef void (*Writer)(const LogEntry &entry);
+	private:
+		std::deque<LogEntry> entries;
+		std::mutex mutex;
+		std::condition_variable entryCondition; // Notified when an entry is queued.
+		std::condition_variable flushCondition; // Notified when a batch is written.
+		std::thread thread;
+		Writer writer;
+		bool writing, exiting;
+
+		void run()
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			while (true)
+			{
+				this->entryCondition.wait(lock, [this]()
+				{
+					return this->exiting || (this->entries.size() > 0);
+				});
+
+				if (this->entries.size() == 0)
+				{
+					break;
+				}
+
+				std::deque<LogEntry> batch;
+				batch.swap(this->entries);
+				this->writing = true;
+				lock.unlock();
+
+				for (const LogEntry &entry : batch)
+				{
+					this->writer(entry);
+				}
+
+				lock.lock();
+				this->writing = false;
+				this->flushCondition.notify_all();
+			}
+		}
+	public:
+		// Set once the sink is destroyed, so messages from later static destructors are
+		// written directly instead.
+		static std::atomic<bool> destroyed;
+
+		LogSink()
+		{
+			this->writer = nullptr;
+			this->writing = false;
+			this->exiting = false;
+		}
+
+		~LogSink()
+		{
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->exiting = true;
+			}
+
+			this->entryCondition.notify_one();
+
+			if (this->thread.joinable())
+			{
+				this->thread.join();
+			}
+
+			LogSink::destroyed = true;
+		}
+
+		void push(LogEntry &&entry, Writer writer)
+		{
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				if (!this->thread.joinable())
+				{
+					this->writer = writer;
+					this->thread = std::thread(&LogSink::run, this);
+				}
+
+				this->entries.push_back(std::move(entry));
+			}
+
+			this->entryCondition.notify_one();
+		}
+
+		void flush()
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->flushCondition.wait(lock, [this]()
+			{
+				return !this->writing && (this->entries.size() == 0);
+			});
+		}
+	};
+
+	std::atomic<bool> LogSink::destroyed(false);
+
+	LogSink &getLogSink()
+	{
+		static LogSink sink;
+		return sink;
+	}
 }
 
 const std::string Debug::LOG_FILENAME = "log.txt";
@@ -61,20 +184,46 @@ void Debug::write(Debug::MessageType type, const std::string &filePath,
 		messageType << message << "\n";
 }
 
+void Debug::post(Debug::MessageType type, const char *__file__, int lineNumber,
+	const std::string &message)
+{
+	if (LogSink::destroyed)
+	{
+		Debug::write(type, Debug::getShorterPath(__file__), lineNumber, message);
+		return;
+	}
+
+	// Shortening the path is left to the logging thread too.
+	getLogSink().push(LogEntry { type, __file__, lineNumber, message },
+		[](const LogEntry &entry)
+	{
+		Debug::write(entry.type, Debug::getShorterPath(entry.file), entry.lineNumber,
+			entry.message);
+	});
+}
+
 void Debug::mention(const char *__file__, int lineNumber, const std::string &message)
 {
-	Debug::write(Debug::MessageType::Info, Debug::getShorterPath(__file__),
-		lineNumber, message);
+	Debug::post(Debug::MessageType::Info, __file__, lineNumber, message);
 }
 
 void Debug::warning(const char *__file__, int lineNumber, const std::string &message)
 {
-	Debug::write(Debug::MessageType::Warning, Debug::getShorterPath(__file__),
-		lineNumber, message);
+	Debug::post(Debug::MessageType::Warning, __file__, lineNumber, message);
+}
+
+void Debug::flush()
+{
+	if (!LogSink::destroyed)
+	{
+		getLogSink().flush();
+	}
 }
 
 void Debug::crash(const char *__file__, int lineNumber, const std::string &message)
 {
+	// Earlier messages go first, and the error is written right away.
+	Debug::flush();
 	Debug::write(Debug::MessageType::Error, Debug::getShorterPath(__file__),
 		lineNumber, message);
 
@@ -92,12 +241,3 @@ void Debug::crash(const char *__file__, int lineNumber, const std::string &messa
 
 	exit(EXIT_FAILURE);
 }
-
-void Debug::check(bool condition, const char *__file__, int lineNumber,
-	const std::string &message)
-{
-	if (!condition)
-	{
-		Debug::crash(__file__, lineNumber, message);
-	}
-}
@@ -7,6 +7,14 @@
 // that should be accompanied with messages and logging. Plain old asserts like 
 // "assert(width > 0)" are for sanity checks and don't need to use these heavier methods.
 
+// DebugAssert() only builds its message when the condition is false, so messages that
+// concatenate strings are fine in hot paths. Mentions and warnings are queued and written
+// by a logging thread, so they don't wait on the console. A crash writes everything still
+// queued before exiting.
+
+// Release builds made with TES_STRIP_DEBUG_MENTIONS compile out DebugMention(), message
+// and all. Warnings, crashes, and asserts are always kept.
+
 class Debug
 {
 public:
@@ -28,6 +36,10 @@ private:
 	// Writes a debug message to the console with the file path and line number.
 	static void write(Debug::MessageType type, const std::string &filePath,
 		int lineNumber, const std::string &message);
+
+	// Queues a debug message for the logging thread to write.
+	static void post(Debug::MessageType type, const char *__file__, int lineNumber,
+		const std::string &message);
 public:
 	// Use DebugMention() instead. Helper method for mentioning something about program state.
 	static void mention(const char *__file__, int lineNumber, const std::string &message);
@@ -38,15 +50,25 @@ public:
 	// Use DebugCrash() instead. Helper method for crashing the program with a reason.
 	static void crash(const char *__file__, int lineNumber, const std::string &message);
 
-	// Use DebugAssert() instead. Helper method for verifying that a condition is true, and
-	// crashing the program if it is false.
-	static void check(bool condition, const char *__file__, int lineNumber, 
-		const std::string &message);
+	// Blocks until every queued message has been written.
+	static void flush();
 
+#if defined(TES_STRIP_DEBUG_MENTIONS) && defined(NDEBUG)
+#define DebugMention(message) static_cast<void>(0)
+#else
 #define DebugMention(message) Debug::mention(__FILE__, __LINE__, message)
+#endif
+
 #define DebugWarning(message) Debug::warning(__FILE__, __LINE__, message)
 #define DebugCrash(message) Debug::crash(__FILE__, __LINE__, message)
-#define DebugAssert(condition, message) Debug::check(condition, __FILE__, __LINE__, message)
+#define DebugAssert(condition, message) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			Debug::crash(__FILE__, __LINE__, message); \
+		} \
+	} while (false)
 #define DebugNotImplemented() Debug::crash(__FILE__, __LINE__, "Not implemented.")
 };
 
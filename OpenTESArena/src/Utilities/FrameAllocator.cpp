@@ -0,0 +1,87 @@
+#include <algorithm>
+
+#include "Debug.h"
+#include "FrameAllocator.h"
+
+const size_t FrameAllocator::DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+FrameAllocator::FrameAllocator()
+{
+	this->blockIndex = 0;
+	this->offset = 0;
+	this->usedBytes = 0;
+	this->peakBytes = 0;
+	this->addBlock(FrameAllocator::DEFAULT_BLOCK_SIZE);
+}
+
+void FrameAllocator::addBlock(size_t size)
+{
+	Block block;
+	block.size = std::max(size, FrameAllocator::DEFAULT_BLOCK_SIZE);
+	block.data = std::make_unique<uint8_t[]>(block.size);
+	this->blocks.push_back(std::move(block));
+}
+
+void *FrameAllocator::allocate(size_t size, size_t alignment)
+{
+	DebugAssert((alignment > 0) && ((alignment & (alignment - 1)) == 0),
+		"Alignment " + std::to_string(alignment) + " isn't a power of two.");
+
+	// Move to the next block (adding one if needed) when this one is too full. A block
+	// starts aligned for any fundamental type, so the start of a new one is always fine.
+	size_t start = (this->offset + (alignment - 1)) & ~(alignment - 1);
+	while ((start + size) > this->blocks[this->blockIndex].size)
+	{
+		this->usedBytes += this->blocks[this->blockIndex].size - this->offset;
+		this->blockIndex++;
+		this->offset = 0;
+		start = 0;
+
+		if (this->blockIndex == this->blocks.size())
+		{
+			this->addBlock(size + alignment);
+		}
+	}
+
+	this->usedBytes += (start + size) - this->offset;
+	this->offset = start + size;
+	return this->blocks[this->blockIndex].data.get() + start;
+}
+
+size_t FrameAllocator::getUsedBytes() const
+{
+	return this->usedBytes;
+}
+
+size_t FrameAllocator::getPeakBytes() const
+{
+	return this->peakBytes;
+}
+
+size_t FrameAllocator::getCapacity() const
+{
+	size_t capacity = 0;
+	for (const Block &block : this->blocks)
+	{
+		capacity += block.size;
+	}
+
+	return capacity;
+}
+
+void FrameAllocator::reset()
+{
+	this->peakBytes = std::max(this->peakBytes, this->usedBytes);
+
+	// Merge the blocks so a frame like this one fits in a single block next time.
+	if (this->blocks.size() > 1)
+	{
+		const size_t capacity = this->getCapacity();
+		this->blocks.clear();
+		this->addBlock(capacity);
+	}
+
+	this->blockIndex = 0;
+	this->offset = 0;
+	this->usedBytes = 0;
+}
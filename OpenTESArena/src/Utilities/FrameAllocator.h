@@ -0,0 +1,116 @@
+#ifndef FRAME_ALLOCATOR_H
+#define FRAME_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A linear allocator for memory that only lives until the end of the frame, like debug
+// text and scratch lists. Allocating just moves an offset forward, freeing does nothing,
+// and everything is released at once when the game loop resets it at the top of the
+// next frame.
+
+// When a frame needs more than one block, the blocks are merged into one big enough for
+// all of them on the next reset, so after a few frames the allocator is one block and
+// doesn't touch the heap anymore. It's only for the main thread.
+
+class FrameAllocator
+{
+private:
+	struct Block
+	{
+		std::unique_ptr<uint8_t[]> data;
+		size_t size;
+	};
+
+	std::vector<Block> blocks;
+	size_t blockIndex; // Block being allocated from.
+	size_t offset; // Into the current block.
+	size_t usedBytes; // Allocated this frame, including alignment padding.
+	size_t peakBytes; // Most used in one frame.
+
+	// Size of the first block, and the least a new block gets.
+	static const size_t DEFAULT_BLOCK_SIZE;
+
+	// Adds a block with room for at least the given bytes.
+	void addBlock(size_t size);
+public:
+	FrameAllocator();
+	FrameAllocator(const FrameAllocator&) = delete;
+
+	FrameAllocator &operator=(const FrameAllocator&) = delete;
+
+	// Gets memory for the rest of the frame. The alignment must be a power of two.
+	void *allocate(size_t size, size_t alignment);
+
+	// Gets the bytes allocated since the last reset.
+	size_t getUsedBytes() const;
+
+	// Gets the most bytes used in one frame so far.
+	size_t getPeakBytes() const;
+
+	// Gets the total size of the blocks.
+	size_t getCapacity() const;
+
+	// Releases everything allocated this frame. Any pointers into it are invalid after.
+	void reset();
+};
+
+// Adaptor so standard containers can use a frame allocator. Deallocating does nothing,
+// so containers that grow a lot in one frame leave their old buffers behind until the
+// reset. Reserving up front avoids that.
+template <typename T>
+class FrameStlAllocator
+{
+private:
+	FrameAllocator *allocator;
+
+	template <typename U>
+	friend class FrameStlAllocator;
+public:
+	typedef T value_type;
+
+	FrameStlAllocator(FrameAllocator &allocator)
+	{
+		this->allocator = &allocator;
+	}
+
+	template <typename U>
+	FrameStlAllocator(const FrameStlAllocator<U> &other)
+	{
+		this->allocator = other.allocator;
+	}
+
+	T *allocate(size_t count)
+	{
+		return static_cast<T*>(this->allocator->allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T*, size_t)
+	{
+		// Freed by the reset.
+	}
+
+	template <typename U>
+	bool operator==(const FrameStlAllocator<U> &other) const
+	{
+		return this->allocator == other.allocator;
+	}
+
+	template <typename U>
+	bool operator!=(const FrameStlAllocator<U> &other) const
+	{
+		return this->allocator != other.allocator;
+	}
+};
+
+// Containers allocated for one frame. They must not outlive it, so they are locals and
+// never members.
+typedef std::basic_string<char, std::char_traits<char>, FrameStlAllocator<char>> FrameString;
+
+template <typename T>
+using FrameVector = std::vector<T, FrameStlAllocator<T>>;
+
+#endif
@@ -3,11 +3,60 @@
 #include "Debug.h"
 #include "HeapView.h"
 
+const int HeapView::CLASS_COUNT;
+const size_t HeapView::NO_SPACE = std::numeric_limits<size_t>::max();
+
+HeapView::HeapView(size_t capacity)
+{
+	DebugAssert(capacity > 0, "Capacity must be positive.");
+
+	this->capacity = capacity;
+	this->reset();
+}
+
 HeapView::HeapView()
+	: HeapView(std::numeric_limits<size_t>::max()) { }
+
+int HeapView::getSizeClass(size_t size)
+{
+	int sizeClass = 0;
+	while ((size >>= 1) > 0)
+	{
+		sizeClass++;
+	}
+
+	return sizeClass;
+}
+
+void HeapView::addFreeBlock(size_t offset, size_t size)
+{
+	const int sizeClass = HeapView::getSizeClass(size);
+	this->classes[sizeClass].insert(offset);
+	this->classMask |= static_cast<uint64_t>(1) << sizeClass;
+	this->freeBlocks.insert(std::make_pair(offset, size));
+}
+
+void HeapView::removeFreeBlock(size_t offset, size_t size)
+{
+	const int sizeClass = HeapView::getSizeClass(size);
+	std::set<size_t> &offsets = this->classes[sizeClass];
+	offsets.erase(offset);
+	if (offsets.empty())
+	{
+		this->classMask &= ~(static_cast<uint64_t>(1) << sizeClass);
+	}
+
+	this->freeBlocks.erase(offset);
+}
+
+size_t HeapView::getCapacity() const
 {
-	// Allocate one "infinite" free block.
-	Block block(0, std::numeric_limits<size_t>::max());
-	this->blocks.push_back(block);
+	return this->capacity;
+}
+
+size_t HeapView::getUsedBytes() const
+{
+	return this->usedBytes;
 }
 
 size_t HeapView::allocate(size_t size)
@@ -15,40 +64,55 @@ size_t HeapView::allocate(size_t size)
 	// Allocation request must be at least 1 byte.
 	DebugAssert(size > 0, "Allocation size must be positive.");
 
-	// Offset in bytes to a suitable free block.
-	size_t offset = 0;
+	// Every block in a class above the request's is at least as big. Blocks in the
+	// request's own class might be too small, so those are only checked if no bigger
+	// class has one.
+	const int requestClass = HeapView::getSizeClass(size);
+	size_t offset = NO_SPACE;
+	size_t blockSize = 0;
 
-	// Find a spot with enough contiguous free bytes. The buffer view is assumed
-	// to have infinite capacity, so it will always eventually find an offset.
-	for (auto block = this->blocks.begin(); block != this->blocks.end(); ++block)
+	const uint64_t biggerClasses = (requestClass < (HeapView::CLASS_COUNT - 1)) ?
+		(this->classMask >> (requestClass + 1)) : 0;
+	if (biggerClasses != 0)
 	{
-		// Does the block have at least the requested bytes (first fit)?
-		if (block->size >= size)
+		int sizeClass = requestClass + 1;
+		while ((this->classMask & (static_cast<uint64_t>(1) << sizeClass)) == 0)
 		{
-			// Set the start of the allocation to where the free block starts.
-			offset = block->offset;
-
-			// Add a new block header so the block can be deallocated later.
-			this->sizes.insert(std::make_pair(offset, size));
+			sizeClass++;
+		}
 
-			if (block->size > size)
-			{
-				// Subtract the allocated space from the free block.
-				block->offset += size;
-				block->size -= size;
-			}
-			else
+		offset = *this->classes[sizeClass].begin();
+		blockSize = this->freeBlocks.at(offset);
+	}
+	else
+	{
+		for (const size_t blockOffset : this->classes[requestClass])
+		{
+			const size_t candidateSize = this->freeBlocks.at(blockOffset);
+			if (candidateSize >= size)
 			{
-				// The block size equals the requested size. Remove the free block.
-				this->blocks.erase(block);
+				offset = blockOffset;
+				blockSize = candidateSize;
+				break;
 			}
-
-			break;
 		}
 	}
 
-	// If the sum of the returned offset and the requested size is greater than the 
-	// caller's buffer size, then their buffer needs to be resized.
+	if (offset == NO_SPACE)
+	{
+		return NO_SPACE;
+	}
+
+	// Subtract the allocated space from the free block, keeping any remainder.
+	this->removeFreeBlock(offset, blockSize);
+	if (blockSize > size)
+	{
+		this->addFreeBlock(offset + size, blockSize - size);
+	}
+
+	// Add a new block header so the block can be deallocated later.
+	this->sizes.insert(std::make_pair(offset, size));
+	this->usedBytes += size;
 	return offset;
 }
 
@@ -60,62 +124,48 @@ void HeapView::deallocate(size_t offset)
 		"Invalid index for deallocation (" + std::to_string(offset) + ").");
 
 	// Get size of block at offset.
-	const size_t size = sizeIter->second;
+	size_t blockOffset = offset;
+	size_t blockSize = sizeIter->second;
+	this->usedBytes -= blockSize;
+	this->sizes.erase(sizeIter);
 
-	// Get an iterator to the nearest free block after the allocated block.
-	// It is guaranteed that there will always be at least one free block somewhere
-	// to the right of an allocation.
-	const auto nextFreeIter = [this, offset]()
+	// Merge with adjacent free blocks to the right and left.
+	const auto nextIter = this->freeBlocks.lower_bound(offset);
+	if ((nextIter != this->freeBlocks.end()) && (nextIter->first == (offset + blockSize)))
 	{
-		auto it = this->blocks.begin();
-		while (it->offset <= offset)
-		{
-			++it;
-		}
-
-		return it;
-	}();
+		const size_t nextSize = nextIter->second;
+		this->removeFreeBlock(nextIter->first, nextSize);
+		blockSize += nextSize;
+	}
 
-	// When coalescing, check if there are adjacent free blocks to the left and right
-	// of the allocated block.
-	const bool adjToFreeRight = (offset + size) == nextFreeIter->offset;
-	const bool adjToFreeLeft = [this, &nextFreeIter, offset]()
+	const auto prevIter = this->freeBlocks.lower_bound(offset);
+	if (prevIter != this->freeBlocks.begin())
 	{
-		if (nextFreeIter != this->blocks.begin())
+		const auto leftIter = std::prev(prevIter);
+		if ((leftIter->first + leftIter->second) == offset)
 		{
-			const auto prevFreeIter = std::prev(nextFreeIter);
-			return (prevFreeIter->offset + prevFreeIter->size) == offset;
+			blockOffset = leftIter->first;
+			const size_t leftSize = leftIter->second;
+			this->removeFreeBlock(blockOffset, leftSize);
+			blockSize += leftSize;
 		}
-		else return false;
-	}();
+	}
 
-	if (adjToFreeLeft && adjToFreeRight)
-	{
-		// Free blocks on the left and right.
-		const auto prevFreeIter = std::prev(nextFreeIter);
-		prevFreeIter->size += size + nextFreeIter->size;
+	this->addFreeBlock(blockOffset, blockSize);
+}
 
-		// Combine the left and right free blocks together.
-		this->blocks.erase(nextFreeIter);
-	}
-	else if (adjToFreeLeft && !adjToFreeRight)
-	{
-		// Free block on the left.
-		const auto prevFreeIter = std::prev(nextFreeIter);
-		prevFreeIter->size += size;
-	}
-	else if (!adjToFreeLeft && adjToFreeRight)
-	{
-		// Free block on the right.
-		nextFreeIter->offset -= size;
-		nextFreeIter->size += size;
-	}
-	else
+void HeapView::reset()
+{
+	for (std::set<size_t> &offsets : this->classes)
 	{
-		// Not adjacent to any free blocks. Create a new free block.
-		this->blocks.insert(nextFreeIter, Block(offset, size));
+		offsets.clear();
 	}
 
-	// Remove the allocation's header.
-	this->sizes.erase(sizeIter);
+	this->classMask = 0;
+	this->freeBlocks.clear();
+	this->sizes.clear();
+	this->usedBytes = 0;
+
+	// One free block for the whole buffer.
+	this->addFreeBlock(0, this->capacity);
 }
@@ -1,49 +1,80 @@
 #ifndef HEAP_VIEW_H
 #define HEAP_VIEW_H
 
-#include <list>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
 #include <unordered_map>
 
 // A heap view is an imaginary overlay for a memory buffer so it can be treated like
 // a stand-alone heap.
 
 // In other words, it is a guide telling the caller where to allocate a request in an
-// actual buffer. The heap view itself assumes infinite capacity, so it is the caller's
-// job to make sure their buffer can fit an allocation at the suggested byte offset.
+// actual buffer. A heap view made without a capacity assumes infinite capacity, so it is
+// the caller's job to make sure their buffer can fit an allocation at the suggested byte
+// offset. One with a capacity says when a request doesn't fit instead.
 
-// The heap view doesn't do any allocations itself. It simply maintains the positions 
+// The heap view doesn't do any allocations itself. It simply maintains the positions
 // and sizes of imaginary ones.
 
+// Free blocks are sorted into size classes by the highest set bit of their size, like
+// TLSF, so finding one that fits doesn't search through every free block. Any block in
+// a class above the request's is big enough, and a bitmask says which classes have any.
+
 class HeapView
 {
 private:
-	struct Block
-	{
-		size_t offset, size;
+	static const int CLASS_COUNT = 64;
 
-		Block(size_t offset, size_t size)
-		{
-			this->offset = offset;
-			this->size = size;
-		}
-	};
+	// Offsets of free blocks in each size class, lowest first so allocations stay toward
+	// the front of the buffer.
+	std::array<std::set<size_t>, CLASS_COUNT> classes;
+	uint64_t classMask; // Bit set for each size class with a free block.
 
-	// Linked list of free blocks.
-	std::list<Block> blocks;
+	// Sizes of free blocks by offset, for merging neighbors when freeing.
+	std::map<size_t, size_t> freeBlocks;
 
 	// Mapping of allocated block offsets to their sizes (block headers, basically).
 	std::unordered_map<size_t, size_t> sizes;
+
+	size_t capacity;
+	size_t usedBytes;
+
+	// Gets the size class holding free blocks of the given size.
+	static int getSizeClass(size_t size);
+
+	void addFreeBlock(size_t offset, size_t size);
+	void removeFreeBlock(size_t offset, size_t size);
 public:
+	// Returned by allocate() when a view with a capacity has no room for the request.
+	static const size_t NO_SPACE;
+
+	// Makes a view over a buffer of the given size.
+	HeapView(size_t capacity);
+
+	// Makes a view over an infinite buffer.
 	HeapView();
 
-	// Returns the byte offset for where an allocation of the requested size should 
-	// occur. If the returned value points to an offset that would overflow the
-	// caller's buffer, their buffer would need to be resized.
+	// Gets the size of the viewed buffer.
+	size_t getCapacity() const;
+
+	// Gets the total size of the current allocations.
+	size_t getUsedBytes() const;
+
+	// Returns the byte offset for where an allocation of the requested size should
+	// occur. If the view has infinite capacity and the returned value points to an
+	// offset that would overflow the caller's buffer, their buffer would need to be
+	// resized. Otherwise, NO_SPACE means no free block is big enough.
 	size_t allocate(size_t size);
 
-	// Frees an allocation at the given offset, allowing it to be allocated again. 
+	// Frees an allocation at the given offset, allowing it to be allocated again.
 	// If no allocation at the offset exists, an error occurs.
 	void deallocate(size_t offset);
+
+	// Frees every allocation at once.
+	void reset();
 };
 
 #endif
@@ -0,0 +1,470 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+#include "Debug.h"
+#include "JobSystem.h"
+#include "Platform.h"
+
+namespace
+{
+	// Which job system and worker the calling thread belongs to, if any.
+	thread_local const JobSystem *CurrentJobSystem = nullptr;
+	thread_local int CurrentWorkerIndex = -1;
+
+	// Priority of the job the calling thread is running, and how many jobs deep it is (a
+	// job waiting on another runs queued jobs in the meantime).
+	thread_local JobSystem::Priority CurrentJobPriority = JobSystem::Priority::Normal;
+	thread_local int CurrentJobDepth = 0;
+
+	// Priority of the jobs the calling worker last set its OS priority for.
+	thread_local JobSystem::Priority CurrentThreadPriority = JobSystem::Priority::Normal;
+}
+
+JobSystem::Job::Job()
+	: remainingDependencies(0), done(false)
+{
+	this->priority = Priority::Normal;
+	this->finished = false;
+}
+
+JobSystem::JobSystem(int threadCount)
+	: queuedJobCount(0), nextQueueIndex(0), threadPriorities(false)
+{
+	assert(threadCount > 0);
+
+	this->exiting = false;
+	for (auto &count : this->queuedPriorityCounts)
+	{
+		count.store(0);
+	}
+
+	// The main thread is busy with the game loop most of the time, and helps run jobs
+	// when it waits on one, so it doesn't get a worker of its own.
+	const int workerCount = std::max(threadCount - 1, 1);
+
+	for (int i = 0; i < workerCount; i++)
+	{
+		this->queues.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	this->threads.reserve(workerCount);
+	for (int i = 0; i < workerCount; i++)
+	{
+		this->threads.push_back(std::thread(&JobSystem::workerLoop, this, i));
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	// Wake up the workers one last time so they can return. Jobs that haven't started
+	// are dropped.
+	{
+		std::lock_guard<std::mutex> lock(this->sleepMutex);
+		this->exiting = true;
+	}
+
+	this->workCondition.notify_all();
+
+	for (auto &thread : this->threads)
+	{
+		thread.join();
+	}
+}
+
+int JobSystem::getCurrentWorkerIndex() const
+{
+	return (CurrentJobSystem == this) ? CurrentWorkerIndex : -1;
+}
+
+void JobSystem::queueJob(const JobHandle &job)
+{
+	// Workers keep their own jobs in their deque so related work stays on one thread.
+	// Other threads spread theirs across the workers.
+	const int workerIndex = this->getCurrentWorkerIndex();
+	const int queueIndex = (workerIndex >= 0) ? workerIndex :
+		(this->nextQueueIndex.fetch_add(1) % static_cast<int>(this->queues.size()));
+
+	const int priorityIndex = static_cast<int>(job->priority);
+	WorkerQueue &queue = *this->queues[queueIndex];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs[priorityIndex].push_back(job);
+	}
+
+	// The count is changed before taking the sleep mutex, so a worker that's about to
+	// sleep either sees it or gets the notification.
+	this->queuedPriorityCounts[priorityIndex]++;
+	this->queuedJobCount++;
+	{
+		std::lock_guard<std::mutex> lock(this->sleepMutex);
+	}
+
+	this->workCondition.notify_one();
+}
+
+JobSystem::JobHandle JobSystem::takeJob(int workerIndex, Priority minPriority)
+{
+	const int queueCount = static_cast<int>(this->queues.size());
+
+	// A stolen frame job comes before any of the worker's own lower priority jobs. The
+	// counts let priorities with nothing queued be skipped without locking anything.
+	const int minPriorityIndex = static_cast<int>(minPriority);
+	for (int priorityIndex = JobSystem::PRIORITY_COUNT - 1; priorityIndex >= minPriorityIndex;
+		priorityIndex--)
+	{
+		if (this->queuedPriorityCounts[priorityIndex].load() == 0)
+		{
+			continue;
+		}
+
+		// Newest job from its own deque first, since its data is most likely in the cache.
+		if (workerIndex >= 0)
+		{
+			WorkerQueue &queue = *this->queues[workerIndex];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			std::deque<JobHandle> &jobs = queue.jobs[priorityIndex];
+			if (jobs.size() > 0)
+			{
+				JobHandle job = std::move(jobs.back());
+				jobs.pop_back();
+				this->queuedPriorityCounts[priorityIndex]--;
+				this->queuedJobCount--;
+				return job;
+			}
+		}
+
+		// Otherwise, steal the oldest job from the next worker that has one.
+		const int startIndex = (workerIndex >= 0) ? (workerIndex + 1) : 0;
+		for (int i = 0; i < queueCount; i++)
+		{
+			const int queueIndex = (startIndex + i) % queueCount;
+			if (queueIndex == workerIndex)
+			{
+				continue;
+			}
+
+			WorkerQueue &queue = *this->queues[queueIndex];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			std::deque<JobHandle> &jobs = queue.jobs[priorityIndex];
+			if (jobs.size() > 0)
+			{
+				JobHandle job = std::move(jobs.front());
+				jobs.pop_front();
+				this->queuedPriorityCounts[priorityIndex]--;
+				this->queuedJobCount--;
+				return job;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+void JobSystem::setWorkerPriority(Priority priority)
+{
+	if (!this->threadPriorities.load() || (priority == CurrentThreadPriority))
+	{
+		return;
+	}
+
+	const Platform::ThreadPriority threadPriority = [priority]()
+	{
+		switch (priority)
+		{
+		case Priority::Background:
+			return Platform::ThreadPriority::Background;
+		case Priority::Frame:
+			return Platform::ThreadPriority::AboveNormal;
+		default:
+			return Platform::ThreadPriority::Normal;
+		}
+	}();
+
+	// It isn't tried again if the OS refuses, since that's usually for lack of privileges.
+	Platform::setCurrentThreadPriority(threadPriority);
+	CurrentThreadPriority = priority;
+}
+
+void JobSystem::runJob(const JobHandle &job)
+{
+	// Only workers change their OS priority. A job run by a thread waiting on it gets the
+	// waiting thread's priority. A worker's priority is only put back after a job that ran
+	// inside another one, since the next job it takes sets its own.
+	const bool isWorker = this->getCurrentWorkerIndex() >= 0;
+	const Priority previousPriority = CurrentJobPriority;
+	CurrentJobPriority = job->priority;
+	CurrentJobDepth++;
+	if (isWorker)
+	{
+		this->setWorkerPriority(job->priority);
+	}
+
+	job->work();
+
+	CurrentJobDepth--;
+	CurrentJobPriority = previousPriority;
+	if (isWorker && (CurrentJobDepth > 0))
+	{
+		this->setWorkerPriority(previousPriority);
+	}
+
+	// Nothing can be added to the continuations once the job is finished, so they can be
+	// released without the lock.
+	std::vector<JobHandle> continuations;
+	{
+		std::lock_guard<std::mutex> lock(job->mutex);
+		job->finished = true;
+		continuations.swap(job->continuations);
+	}
+
+	// The callback is queued before the job is done, so a thread that waited on the job
+	// finds it in the next runMainThreadCallbacks().
+	if (job->onComplete)
+	{
+		std::lock_guard<std::mutex> lock(this->mainThreadMutex);
+		this->mainThreadCallbacks.push_back(job->onComplete);
+	}
+
+	job->done.store(true, std::memory_order_release);
+
+	for (const JobHandle &continuation : continuations)
+	{
+		if (continuation->remainingDependencies.fetch_sub(1) == 1)
+		{
+			this->queueJob(continuation);
+		}
+	}
+}
+
+void JobSystem::workerLoop(int workerIndex)
+{
+	CurrentJobSystem = this;
+	CurrentWorkerIndex = workerIndex;
+
+	while (true)
+	{
+		JobHandle job = this->takeJob(workerIndex, Priority::Background);
+		if (job.get() != nullptr)
+		{
+			this->runJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(this->sleepMutex);
+		this->workCondition.wait(lock, [this]()
+		{
+			return this->exiting || (this->queuedJobCount.load() > 0);
+		});
+
+		if (this->exiting)
+		{
+			return;
+		}
+	}
+}
+
+int JobSystem::getThreadCount() const
+{
+	return static_cast<int>(this->threads.size());
+}
+
+int JobSystem::pinThreads(const std::vector<int> &processorIDs)
+{
+	const int processorCount = static_cast<int>(processorIDs.size());
+	int pinnedCount = 0;
+	if ((processorCount > 0) && Platform::setCurrentThreadAffinity(processorIDs[0]))
+	{
+		pinnedCount++;
+	}
+
+	const int workerCount = std::min(static_cast<int>(this->threads.size()), processorCount - 1);
+	for (int i = 0; i < workerCount; i++)
+	{
+		if (Platform::setThreadAffinity(this->threads[i], processorIDs[i + 1]))
+		{
+			pinnedCount++;
+		}
+	}
+
+	return pinnedCount;
+}
+
+void JobSystem::setThreadPriorities(bool enabled)
+{
+	this->threadPriorities.store(enabled);
+}
+
+JobSystem::JobHandle JobSystem::add(const std::function<void()> &work,
+	const std::vector<JobHandle> &dependencies, const std::function<void()> &onComplete,
+	Priority priority)
+{
+	JobHandle job = std::make_shared<Job>();
+	job->work = work;
+	job->onComplete = onComplete;
+	job->priority = priority;
+
+	// The extra dependency keeps the job from being queued by a dependency that finishes
+	// while the others are still being added.
+	job->remainingDependencies = 1;
+
+	for (const JobHandle &dependency : dependencies)
+	{
+		DebugAssert(dependency.get() != nullptr, "Job dependency cannot be null.");
+
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if (!dependency->finished)
+		{
+			job->remainingDependencies++;
+			dependency->continuations.push_back(job);
+		}
+	}
+
+	if (job->remainingDependencies.fetch_sub(1) == 1)
+	{
+		this->queueJob(job);
+	}
+
+	return job;
+}
+
+JobSystem::JobHandle JobSystem::add(const std::function<void()> &work,
+	const std::vector<JobHandle> &dependencies, const std::function<void()> &onComplete)
+{
+	return this->add(work, dependencies, onComplete, CurrentJobPriority);
+}
+
+JobSystem::JobHandle JobSystem::add(const std::function<void()> &work,
+	const std::vector<JobHandle> &dependencies)
+{
+	return this->add(work, dependencies, std::function<void()>(), CurrentJobPriority);
+}
+
+JobSystem::JobHandle JobSystem::add(const std::function<void()> &work)
+{
+	return this->add(work, std::vector<JobHandle>(), std::function<void()>(),
+		CurrentJobPriority);
+}
+
+JobSystem::JobHandle JobSystem::addSignal(Priority priority)
+{
+	// The extra dependency is only released by signal().
+	JobHandle job = std::make_shared<Job>();
+	job->work = []() { };
+	job->priority = priority;
+	job->remainingDependencies = 1;
+	return job;
+}
+
+void JobSystem::signal(const JobHandle &job)
+{
+	// There's nothing to run, so it doesn't need to go through a worker's deque.
+	const int remaining = job->remainingDependencies.fetch_sub(1);
+	DebugAssert(remaining == 1, "Job was already signaled.");
+	this->runJob(job);
+}
+
+bool JobSystem::isDone(const JobHandle &job) const
+{
+	return job->done.load(std::memory_order_acquire);
+}
+
+void JobSystem::wait(const JobHandle &job)
+{
+	const int workerIndex = this->getCurrentWorkerIndex();
+
+	// Running a lower priority job here would hold up the job being waited in (and lower
+	// a worker's OS priority in the middle of it).
+	Priority minPriority = job->priority;
+	if ((CurrentJobDepth > 0) &&
+		(static_cast<int>(CurrentJobPriority) > static_cast<int>(minPriority)))
+	{
+		minPriority = CurrentJobPriority;
+	}
+
+	while (!this->isDone(job))
+	{
+		JobHandle otherJob = this->takeJob(workerIndex, minPriority);
+		if (otherJob.get() != nullptr)
+		{
+			this->runJob(otherJob);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::parallelFor(int count, const std::function<void(int)> &function,
+	Priority priority)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	std::vector<JobHandle> jobs;
+	jobs.reserve(count - 1);
+	for (int i = 1; i < count; i++)
+	{
+		jobs.push_back(this->add([&function, i]()
+		{
+			function(i);
+		}, std::vector<JobHandle>(), std::function<void()>(), priority));
+	}
+
+	function(0);
+
+	for (const JobHandle &job : jobs)
+	{
+		this->wait(job);
+	}
+}
+
+void JobSystem::parallelFor(int count, const std::function<void(int)> &function)
+{
+	this->parallelFor(count, function, CurrentJobPriority);
+}
+
+void JobSystem::addMainThreadCallback(const std::function<void()> &callback)
+{
+	std::lock_guard<std::mutex> lock(this->mainThreadMutex);
+	this->mainThreadCallbacks.push_back(callback);
+}
+
+void JobSystem::runMainThreadCallbacks(double budgetSeconds)
+{
+	const auto startTime = std::chrono::steady_clock::now();
+
+	// The lock isn't held during a callback, since it might queue more callbacks.
+	while (true)
+	{
+		std::function<void()> callback;
+		{
+			std::lock_guard<std::mutex> lock(this->mainThreadMutex);
+			if (this->mainThreadCallbacks.size() == 0)
+			{
+				return;
+			}
+
+			callback = std::move(this->mainThreadCallbacks.front());
+			this->mainThreadCallbacks.pop_front();
+		}
+
+		callback();
+
+		const double elapsedSeconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - startTime).count();
+		if (elapsedSeconds >= budgetSeconds)
+		{
+			return;
+		}
+	}
+}
+
+int JobSystem::getMainThreadCallbackCount()
+{
+	std::lock_guard<std::mutex> lock(this->mainThreadMutex);
+	return static_cast<int>(this->mainThreadCallbacks.size());
+}
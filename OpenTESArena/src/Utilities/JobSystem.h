@@ -0,0 +1,163 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A shared set of worker threads for everything that can run off the main thread (the 3D
+// renderer, asset decoding, level generation, etc.), so separate systems don't each make
+// their own threads and oversubscribe the machine.
+
+// Each worker has its own deque of jobs. It takes the newest job from its own deque and
+// steals the oldest one from another worker's deque when its own is empty. A job can
+// depend on other jobs and only starts once all of them are finished.
+
+// A job can also have a completion callback, which is run on the main thread by
+// runMainThreadCallbacks() after the job finishes. SDL and OpenAL calls belong there. The
+// callbacks only get the time left in a frame, and the rest wait for later frames.
+
+// Jobs have a priority. Workers take frame jobs before any others, and background jobs
+// (prefetching and generation) only when nothing else is queued. With thread priorities
+// on, a worker also runs each job at an OS priority to match, so a decode that's already
+// running doesn't hold up the frame's jobs on a busy machine.
+
+class JobSystem
+{
+public:
+	// Jobs added without a priority get the priority of the job adding them, so the jobs
+	// a background job splits its work into are background too.
+	enum class Priority { Background, Normal, Frame };
+private:
+	static const int PRIORITY_COUNT = 3;
+
+	struct Job
+	{
+		std::function<void()> work;
+		std::function<void()> onComplete; // Run on the main thread afterwards, if any.
+		Priority priority;
+		std::vector<std::shared_ptr<Job>> continuations; // Jobs waiting on this one.
+		std::mutex mutex; // For continuations and finished.
+		std::atomic<int> remainingDependencies; // Plus one until the job is submitted.
+		std::atomic<bool> done; // For waiting without the mutex.
+		bool finished;
+
+		Job();
+	};
+public:
+	typedef std::shared_ptr<Job> JobHandle;
+private:
+	struct WorkerQueue
+	{
+		std::array<std::deque<JobHandle>, JobSystem::PRIORITY_COUNT> jobs; // By priority.
+		std::mutex mutex;
+	};
+
+	std::vector<std::thread> threads;
+	std::vector<std::unique_ptr<WorkerQueue>> queues; // One per worker.
+	std::deque<std::function<void()>> mainThreadCallbacks; // Oldest first.
+	std::mutex mainThreadMutex;
+	std::mutex sleepMutex;
+	std::condition_variable workCondition; // Notified when a job is queued.
+	std::atomic<int> queuedJobCount;
+	std::array<std::atomic<int>, JobSystem::PRIORITY_COUNT> queuedPriorityCounts;
+	std::atomic<int> nextQueueIndex; // For jobs queued from non-worker threads.
+	bool exiting; // Guarded by the sleep mutex.
+	std::atomic<bool> threadPriorities; // Whether workers match their OS priority to jobs.
+
+	// Gets the index of the calling thread's worker in this job system, or -1 if it isn't
+	// one of them.
+	int getCurrentWorkerIndex() const;
+
+	// Puts a job whose dependencies are finished into a worker's deque and wakes a worker.
+	void queueJob(const JobHandle &job);
+
+	// Takes the highest priority job from the given worker's deques, or steals one from
+	// another worker's if it has none of that priority. Jobs below the given priority are
+	// left alone. Returns null if there are no such queued jobs.
+	JobHandle takeJob(int workerIndex, Priority minPriority);
+
+	// Sets the calling worker's OS priority for running jobs of the given priority, if
+	// thread priorities are on and it isn't at that priority already.
+	void setWorkerPriority(Priority priority);
+
+	// Runs a job and releases the jobs that depend on it.
+	void runJob(const JobHandle &job);
+
+	// Entry point for each worker thread.
+	void workerLoop(int workerIndex);
+public:
+	// Makes one worker for each of the given threads besides the main thread, and at least
+	// one.
+	JobSystem(int threadCount);
+	JobSystem(const JobSystem&) = delete;
+	JobSystem(JobSystem&&) = delete;
+	~JobSystem();
+
+	JobSystem &operator=(const JobSystem&) = delete;
+	JobSystem &operator=(JobSystem&&) = delete;
+
+	// Gets the number of worker threads.
+	int getThreadCount() const;
+
+	// Pins the calling thread to the first of the given logical processors and each worker
+	// to one of the next ones, in order. Threads past the end of the list are left as they
+	// are. Returns the number of threads pinned.
+	int pinThreads(const std::vector<int> &processorIDs);
+
+	// Sets whether workers run frame jobs above normal OS priority and background jobs
+	// below it. It's meant to be set once before jobs are added. Off by default.
+	void setThreadPriorities(bool enabled);
+
+	// Adds a job that runs after the given jobs are finished. The completion callback, if
+	// not empty, is run on the main thread after the job is done.
+	JobHandle add(const std::function<void()> &work, const std::vector<JobHandle> &dependencies,
+		const std::function<void()> &onComplete, Priority priority);
+	JobHandle add(const std::function<void()> &work, const std::vector<JobHandle> &dependencies,
+		const std::function<void()> &onComplete);
+	JobHandle add(const std::function<void()> &work,
+		const std::vector<JobHandle> &dependencies);
+	JobHandle add(const std::function<void()> &work);
+
+	// Adds a job with no work that isn't finished until signal() is called with it, so
+	// other jobs can depend on something outside the job system (like a file being read)
+	// without a worker blocking on it.
+	JobHandle addSignal(Priority priority);
+
+	// Finishes a job from addSignal() and queues the jobs depending on it. Can be called
+	// from any thread, but only once per job.
+	void signal(const JobHandle &job);
+
+	// Returns whether the job's work is done. Its completion callback might not have run.
+	bool isDone(const JobHandle &job) const;
+
+	// Blocks until the job's work is done. The calling thread runs queued jobs in the
+	// meantime, so workers can wait on other jobs without deadlocking. Only jobs at or
+	// above the priority of the waited job and of the job the thread is inside are run,
+	// so waiting in a frame job never picks up background work.
+	void wait(const JobHandle &job);
+
+	// Calls the function once for each index in [0, count) spread across the workers, and
+	// returns when all calls are done. The calling thread runs index 0 itself.
+	void parallelFor(int count, const std::function<void(int)> &function, Priority priority);
+	void parallelFor(int count, const std::function<void(int)> &function);
+
+	// Queues a function to run on the main thread during the next runMainThreadCallbacks().
+	void addMainThreadCallback(const std::function<void()> &callback);
+
+	// Runs the completion callbacks of finished jobs and any other main thread callbacks,
+	// oldest first, until the given time budget is used up. At least one is run if any
+	// are waiting, so they always make progress. Must be called from the main thread.
+	void runMainThreadCallbacks(double budgetSeconds);
+
+	// Gets the number of main thread callbacks waiting to run.
+	int getMainThreadCallbackCount();
+};
+
+#endif
@@ -0,0 +1,44 @@
+#include <algorithm>
+
+#include "LoadProgress.h"
+
+LoadProgress::LoadProgress()
+	: cancelled(false)
+{
+	this->stagePercent = 0.0;
+}
+
+std::string LoadProgress::getStageName() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->stageName;
+}
+
+double LoadProgress::getStagePercent() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->stagePercent;
+}
+
+bool LoadProgress::isCancelled() const
+{
+	return this->cancelled;
+}
+
+void LoadProgress::beginStage(const std::string &stageName)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->stageName = stageName;
+	this->stagePercent = 0.0;
+}
+
+void LoadProgress::setStagePercent(double stagePercent)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->stagePercent = std::max(std::min(stagePercent, 1.0), 0.0);
+}
+
+void LoadProgress::cancel()
+{
+	this->cancelled = true;
+}
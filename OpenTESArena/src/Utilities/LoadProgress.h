@@ -0,0 +1,41 @@
+#ifndef LOAD_PROGRESS_H
+#define LOAD_PROGRESS_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+// Progress of a load running on a worker thread, for showing on the main thread. The load
+// reports each stage it starts and how far along it is, and checks between steps whether
+// it's been cancelled so it can stop early. Safe to use from any thread.
+
+class LoadProgress
+{
+private:
+	mutable std::mutex mutex;
+	std::string stageName;
+	double stagePercent;
+	std::atomic<bool> cancelled;
+public:
+	LoadProgress();
+
+	// Gets the description of the current stage, or empty if none has started.
+	std::string getStageName() const;
+
+	// Gets how far along the current stage is, from 0 to 1.
+	double getStagePercent() const;
+
+	// Returns whether the load should stop. Its result will be thrown away.
+	bool isCancelled() const;
+
+	// Starts a new stage of the load with the given description.
+	void beginStage(const std::string &stageName);
+
+	// Sets how far along the current stage is, from 0 to 1.
+	void setStagePercent(double stagePercent);
+
+	// Asks the load to stop at its next check.
+	void cancel();
+};
+
+#endif
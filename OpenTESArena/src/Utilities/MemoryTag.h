@@ -0,0 +1,17 @@
+#ifndef MEMORY_TAG_H
+#define MEMORY_TAG_H
+
+// The subsystems whose memory is counted by the memory tracker.
+
+enum class MemoryTag
+{
+	RendererTextures, // The 3D renderer's own copies of voxel and flat textures.
+	TextureCaches, // Surfaces, textures, and images kept by the texture manager.
+	Cinematics, // Decoded video frames waiting to be shown.
+	LevelData, // Voxel chunks of loaded levels.
+	LevelCaches, // Decoded level files kept for loading levels again.
+	SoundBuffers, // Sound effect samples in OpenAL buffers.
+	MusicCache // Songs synthesized ahead of time.
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include <atomic>
+
+#include "Debug.h"
+#include "MemoryTracker.h"
+#include "String.h"
+
+namespace
+{
+	const int TagCount = 7;
+
+	const char *TagNames[] =
+	{
+		"Renderer textures",
+		"Texture caches",
+		"Cinematics",
+		"Level data",
+		"Level caches",
+		"Sound buffers",
+		"Music cache"
+	};
+
+	std::atomic<size_t> CurrentBytes[TagCount];
+	std::atomic<size_t> PeakBytes[TagCount];
+
+	double ToMegabytes(size_t bytes)
+	{
+		return static_cast<double>(bytes) / (1024.0 * 1024.0);
+	}
+
+	// Raises the tag's peak if the current bytes are above it.
+	void UpdatePeak(int index, size_t bytes)
+	{
+		size_t peak = PeakBytes[index].load(std::memory_order_relaxed);
+		while ((bytes > peak) &&
+			!PeakBytes[index].compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) { }
+	}
+}
+
+const int MemoryTracker::TAG_COUNT = TagCount;
+
+void MemoryTracker::add(MemoryTag tag, size_t bytes)
+{
+	const int index = static_cast<int>(tag);
+	const size_t current = CurrentBytes[index].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	UpdatePeak(index, current);
+}
+
+void MemoryTracker::remove(MemoryTag tag, size_t bytes)
+{
+	const int index = static_cast<int>(tag);
+	const size_t previous = CurrentBytes[index].fetch_sub(bytes, std::memory_order_relaxed);
+	DebugAssert(previous >= bytes, std::string("More bytes removed from \"") +
+		TagNames[index] + "\" than were added.");
+}
+
+void MemoryTracker::set(MemoryTag tag, size_t bytes)
+{
+	const int index = static_cast<int>(tag);
+	CurrentBytes[index].store(bytes, std::memory_order_relaxed);
+	UpdatePeak(index, bytes);
+}
+
+size_t MemoryTracker::getCurrentBytes(MemoryTag tag)
+{
+	return CurrentBytes[static_cast<int>(tag)].load(std::memory_order_relaxed);
+}
+
+size_t MemoryTracker::getPeakBytes(MemoryTag tag)
+{
+	return PeakBytes[static_cast<int>(tag)].load(std::memory_order_relaxed);
+}
+
+const char *MemoryTracker::getTagName(MemoryTag tag)
+{
+	return TagNames[static_cast<int>(tag)];
+}
+
+std::string MemoryTracker::getReport()
+{
+	std::string text = "Memory (current/peak MB):";
+	size_t totalBytes = 0;
+	for (int i = 0; i < TagCount; i++)
+	{
+		const MemoryTag tag = static_cast<MemoryTag>(i);
+		const size_t currentBytes = MemoryTracker::getCurrentBytes(tag);
+		totalBytes += currentBytes;
+
+		text += std::string("\n") + MemoryTracker::getTagName(tag) + ": " +
+			String::fixedPrecision(ToMegabytes(currentBytes), 1) + "/" +
+			String::fixedPrecision(ToMegabytes(MemoryTracker::getPeakBytes(tag)), 1);
+	}
+
+	text += "\nTotal: " + String::fixedPrecision(ToMegabytes(totalBytes), 1);
+	return text;
+}
+
+void MemoryTracker::logReport()
+{
+	DebugMention(MemoryTracker::getReport());
+}
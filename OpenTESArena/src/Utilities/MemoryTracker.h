@@ -0,0 +1,48 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <cstddef>
+#include <string>
+
+#include "MemoryTag.h"
+
+// Static class for counting how many bytes each subsystem has allocated, for the debug
+// text and for deciding on memory budgets. Subsystems report their own allocations with
+// add() and remove(), or set() if they already keep a total. Counts are atomic, so any
+// thread can report.
+
+// Only the big allocations are counted (pixels, voxels, samples), not every container,
+// so the totals are a little under what the process really uses.
+
+class MemoryTracker
+{
+private:
+	MemoryTracker() = delete;
+	~MemoryTracker() = delete;
+public:
+	// Number of memory tags.
+	static const int TAG_COUNT;
+
+	static void add(MemoryTag tag, size_t bytes);
+	static void remove(MemoryTag tag, size_t bytes);
+
+	// Replaces the tag's current bytes, for subsystems that count them themselves.
+	static void set(MemoryTag tag, size_t bytes);
+
+	// Gets the bytes currently reported for the tag.
+	static size_t getCurrentBytes(MemoryTag tag);
+
+	// Gets the most bytes the tag has had at once.
+	static size_t getPeakBytes(MemoryTag tag);
+
+	// Gets the display name of the tag.
+	static const char *getTagName(MemoryTag tag);
+
+	// Gets one line for each tag with its current and peak megabytes, and a total.
+	static std::string getReport();
+
+	// Writes the report to the log.
+	static void logReport();
+};
+
+#endif
@@ -1,11 +1,269 @@
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <set>
 #include <thread>
+#include <utility>
 
 #include "SDL.h"
 
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#include <sys/sysctl.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #include "Debug.h"
 #include "Platform.h"
 #include "String.h"
 
+namespace
+{
+#if defined(__linux__)
+	// Reads a list of CPU IDs like "0-3,8,10-11" from a sysfs file.
+	bool ReadCpuList(const std::string &path, std::vector<int> &cpus)
+	{
+		std::ifstream ifs(path);
+		std::string text;
+		if (!ifs.is_open() || !std::getline(ifs, text))
+		{
+			return false;
+		}
+
+		for (const std::string &range : String::split(text, ','))
+		{
+			const bool isRange = (range.size() > 0) &&
+				(range.find_first_not_of("0123456789-") == std::string::npos);
+			if (!isRange)
+			{
+				continue;
+			}
+
+			const size_t dashIndex = range.find('-');
+			const int first = std::stoi(range.substr(0, dashIndex));
+			const int last = (dashIndex != std::string::npos) ?
+				std::stoi(range.substr(dashIndex + 1)) : first;
+
+			for (int cpu = first; cpu <= last; cpu++)
+			{
+				cpus.push_back(cpu);
+			}
+		}
+
+		return cpus.size() > 0;
+	}
+
+	// Reads a single integer from a sysfs file.
+	bool ReadInt(const std::string &path, int &value)
+	{
+		std::ifstream ifs(path);
+		return static_cast<bool>(ifs >> value);
+	}
+
+	bool SetAffinity(pthread_t thread, int processorID)
+	{
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		CPU_SET(processorID, &cpuSet);
+		return pthread_setaffinity_np(thread, sizeof(cpuSet), &cpuSet) == 0;
+	}
+
+	// Sets the calling thread's nice value. Only the thread's own ID works with
+	// setpriority(), and glibc didn't wrap gettid() until 2.30.
+	bool SetCurrentNiceValue(int niceValue)
+	{
+		const id_t threadID = static_cast<id_t>(syscall(SYS_gettid));
+		return setpriority(PRIO_PROCESS, threadID, niceValue) == 0;
+	}
+#elif defined(_WIN32)
+	bool SetAffinity(HANDLE thread, int processorID)
+	{
+		// Processors are in groups of up to 64.
+		GROUP_AFFINITY affinity = GROUP_AFFINITY();
+		affinity.Group = static_cast<WORD>(processorID / 64);
+		affinity.Mask = static_cast<KAFFINITY>(1) << (processorID % 64);
+		return SetThreadGroupAffinity(thread, &affinity, nullptr) != 0;
+	}
+#elif defined(__APPLE__)
+	bool ReadSysctlInt(const char *name, int &value)
+	{
+		size_t size = sizeof(value);
+		return sysctlbyname(name, &value, &size, nullptr, 0) == 0;
+	}
+#endif
+}
+
+Platform::CpuTopology::CpuTopology()
+{
+	this->logicalCount = 0;
+	this->physicalCount = 0;
+	this->performanceCount = 0;
+}
+
+Platform::CpuTopology Platform::detectCpuTopology()
+{
+	CpuTopology topology;
+
+#if defined(_WIN32)
+	// Each entry is one core and the logical processors on it. Higher efficiency classes
+	// are faster cores, and they're all zero on CPUs with only one kind.
+	DWORD length = 0;
+	GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &length);
+	std::vector<uint8_t> buffer(length);
+	if ((length > 0) && GetLogicalProcessorInformationEx(RelationProcessorCore,
+		reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()), &length))
+	{
+		auto getCore = [&buffer](DWORD offset)
+		{
+			return reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(
+				buffer.data() + offset);
+		};
+
+		int maxEfficiencyClass = 0;
+		for (DWORD offset = 0; offset < length; offset += getCore(offset)->Size)
+		{
+			maxEfficiencyClass = std::max(maxEfficiencyClass,
+				static_cast<int>(getCore(offset)->Processor.EfficiencyClass));
+		}
+
+		for (DWORD offset = 0; offset < length; offset += getCore(offset)->Size)
+		{
+			// A core's processors are always in one group.
+			const PROCESSOR_RELATIONSHIP &core = getCore(offset)->Processor;
+			const GROUP_AFFINITY &groupMask = core.GroupMask[0];
+
+			int firstProcessor = -1;
+			for (int i = 0; i < 64; i++)
+			{
+				if (((static_cast<uint64_t>(groupMask.Mask) >> i) & 1) != 0)
+				{
+					topology.logicalCount++;
+					if (firstProcessor < 0)
+					{
+						firstProcessor = (static_cast<int>(groupMask.Group) * 64) + i;
+					}
+				}
+			}
+
+			topology.physicalCount++;
+			if (static_cast<int>(core.EfficiencyClass) == maxEfficiencyClass)
+			{
+				topology.performanceCount++;
+				topology.performanceProcessors.push_back(firstProcessor);
+			}
+		}
+	}
+#elif defined(__APPLE__)
+	// Apple silicon lists its performance cores as the first performance level. Intel
+	// Macs don't have levels.
+	int logicalCount, physicalCount;
+	if (ReadSysctlInt("hw.logicalcpu", logicalCount) &&
+		ReadSysctlInt("hw.physicalcpu", physicalCount))
+	{
+		int performanceCount;
+		if (!ReadSysctlInt("hw.perflevel0.physicalcpu", performanceCount))
+		{
+			performanceCount = physicalCount;
+		}
+
+		topology.logicalCount = logicalCount;
+		topology.physicalCount = physicalCount;
+		topology.performanceCount = performanceCount;
+	}
+#elif defined(__linux__)
+	std::vector<int> cpus;
+	if (ReadCpuList("/sys/devices/system/cpu/online", cpus))
+	{
+		// Intel hybrid CPUs list their performance cores' processors separately, and other
+		// hybrid CPUs (i.e., ARM) give each processor a relative capacity instead.
+		std::vector<int> performanceCpus;
+		const bool hasPerformanceList = ReadCpuList("/sys/devices/cpu_core/cpus",
+			performanceCpus);
+
+		std::vector<int> capacities(cpus.size(), 0);
+		int maxCapacity = 0;
+		for (size_t i = 0; i < cpus.size(); i++)
+		{
+			ReadInt("/sys/devices/system/cpu/cpu" + std::to_string(cpus[i]) +
+				"/cpu_capacity", capacities[i]);
+			maxCapacity = std::max(maxCapacity, capacities[i]);
+		}
+
+		// SMT siblings share a package and core ID.
+		std::set<std::pair<int, int>> cores, performanceCores;
+		for (size_t i = 0; i < cpus.size(); i++)
+		{
+			const int cpu = cpus[i];
+			const std::string topologyPath = "/sys/devices/system/cpu/cpu" +
+				std::to_string(cpu) + "/topology/";
+
+			int packageID = 0;
+			int coreID = cpu;
+			ReadInt(topologyPath + "physical_package_id", packageID);
+			ReadInt(topologyPath + "core_id", coreID);
+
+			const std::pair<int, int> core(packageID, coreID);
+			cores.insert(core);
+
+			const bool isPerformance = hasPerformanceList ?
+				(std::find(performanceCpus.begin(), performanceCpus.end(), cpu) !=
+					performanceCpus.end()) :
+				(capacities[i] == maxCapacity);
+
+			if (isPerformance && performanceCores.insert(core).second)
+			{
+				topology.performanceProcessors.push_back(cpu);
+			}
+		}
+
+		topology.logicalCount = static_cast<int>(cpus.size());
+		topology.physicalCount = static_cast<int>(cores.size());
+		topology.performanceCount = static_cast<int>(performanceCores.size());
+	}
+#endif
+
+	// Without a layout, every hardware thread counts as its own performance core.
+	if (topology.logicalCount <= 0)
+	{
+		const int threadCount = static_cast<int>(std::thread::hardware_concurrency());
+
+		// hardware_concurrency() might return 0, so it needs to be clamped positive.
+		if (threadCount == 0)
+		{
+			DebugWarning("hardware_concurrency() returned 0.");
+		}
+
+		topology = CpuTopology();
+		topology.logicalCount = std::max(threadCount, 1);
+		topology.physicalCount = topology.logicalCount;
+		topology.performanceCount = topology.logicalCount;
+	}
+
+	topology.physicalCount = std::max(std::min(topology.physicalCount,
+		topology.logicalCount), 1);
+	topology.performanceCount = std::max(std::min(topology.performanceCount,
+		topology.physicalCount), 1);
+
+	DebugMention("CPU has " + std::to_string(topology.logicalCount) + " logical processors, " +
+		std::to_string(topology.physicalCount) + " cores, and " +
+		std::to_string(topology.performanceCount) + " performance cores.");
+
+	return topology;
+}
+
 std::string Platform::getPlatform()
 {
 	return std::string(SDL_GetPlatform());
@@ -47,6 +305,24 @@ std::string Platform::getOptionsPath()
 	return String::replace(optionsPathString, '\\', '/');
 }
 
+std::string Platform::getCachePath()
+{
+	// SDL_GetPrefPath() creates the desired folder if it doesn't exist.
+	char *cachePathPtr = SDL_GetPrefPath("OpenTESArena", "cache");
+
+	if (cachePathPtr == nullptr)
+	{
+		DebugMention("SDL_GetPrefPath() not available on this platform.");
+		cachePathPtr = SDL_strdup("cache/");
+	}
+
+	const std::string cachePathString(cachePathPtr);
+	SDL_free(cachePathPtr);
+
+	// Convert Windows backslashes to forward slashes.
+	return String::replace(cachePathString, '\\', '/');
+}
+
 std::string Platform::getScreenshotPath()
 {
 	// SDL_GetPrefPath() creates the desired folder if it doesn't exist.
@@ -101,18 +377,105 @@ std::string Platform::getLogPath()
 	}
 }
 
+const Platform::CpuTopology &Platform::getCpuTopology()
+{
+	static const CpuTopology topology = Platform::detectCpuTopology();
+	return topology;
+}
+
 int Platform::getThreadCount()
 {
-	const int threadCount = static_cast<int>(std::thread::hardware_concurrency());
-	
-	// hardware_concurrency() might return 0, so it needs to be clamped positive.
-	if (threadCount == 0)
+	return Platform::getCpuTopology().performanceCount;
+}
+
+bool Platform::setThreadAffinity(std::thread &thread, int processorID)
+{
+#if defined(_WIN32)
+	return SetAffinity(static_cast<HANDLE>(thread.native_handle()), processorID);
+#elif defined(__linux__)
+	return SetAffinity(thread.native_handle(), processorID);
+#else
+	static_cast<void>(thread);
+	static_cast<void>(processorID);
+	return false;
+#endif
+}
+
+bool Platform::setCurrentThreadAffinity(int processorID)
+{
+#if defined(_WIN32)
+	return SetAffinity(GetCurrentThread(), processorID);
+#elif defined(__linux__)
+	return SetAffinity(pthread_self(), processorID);
+#else
+	static_cast<void>(processorID);
+	return false;
+#endif
+}
+
+bool Platform::setCurrentThreadPriority(ThreadPriority priority)
+{
+#if defined(_WIN32)
+	const int value = [priority]()
 	{
-		DebugWarning("hardware_concurrency() returned 0.");
-		return 1;
+		switch (priority)
+		{
+		case ThreadPriority::Background:
+			return THREAD_PRIORITY_LOWEST;
+		case ThreadPriority::AboveNormal:
+			return THREAD_PRIORITY_ABOVE_NORMAL;
+		case ThreadPriority::Audio:
+			return THREAD_PRIORITY_TIME_CRITICAL;
+		default:
+			return THREAD_PRIORITY_NORMAL;
+		}
+	}();
+
+	return SetThreadPriority(GetCurrentThread(), value) != 0;
+#elif defined(__APPLE__)
+	const qos_class_t qosClass = [priority]()
+	{
+		switch (priority)
+		{
+		case ThreadPriority::Background:
+			return QOS_CLASS_UTILITY;
+		case ThreadPriority::AboveNormal:
+		case ThreadPriority::Audio:
+			return QOS_CLASS_USER_INTERACTIVE;
+		default:
+			return QOS_CLASS_DEFAULT;
+		}
+	}();
+
+	return pthread_set_qos_class_self_np(qosClass, 0) == 0;
+#elif defined(__linux__)
+	// Real-time scheduling needs RLIMIT_RTPRIO or CAP_SYS_NICE. Without it, audio falls
+	// back to a lower nice value, which needs RLIMIT_NICE or CAP_SYS_NICE instead.
+	if (priority == ThreadPriority::Audio)
+	{
+		sched_param param = sched_param();
+		param.sched_priority = sched_get_priority_min(SCHED_RR);
+		if (pthread_setschedparam(pthread_self(), SCHED_RR, &param) == 0)
+		{
+			return true;
+		}
 	}
-	else
+
+	// Background threads are batch scheduled instead of given a higher nice value, since
+	// the nice value can't be lowered back without privileges.
+	const int policy = (priority == ThreadPriority::Background) ? SCHED_BATCH : SCHED_OTHER;
+	sched_param param = sched_param();
+	param.sched_priority = 0;
+	if (pthread_setschedparam(pthread_self(), policy, &param) != 0)
 	{
-		return threadCount;
+		return false;
 	}
+
+	const bool raised = (priority == ThreadPriority::AboveNormal) ||
+		(priority == ThreadPriority::Audio);
+	return SetCurrentNiceValue(raised ? -5 : 0);
+#else
+	static_cast<void>(priority);
+	return false;
+#endif
 }
@@ -2,14 +2,40 @@
 #define PLATFORM_H
 
 #include <string>
+#include <thread>
+#include <vector>
 
 // Static class for various platform-specific functions.
 
 class Platform
 {
+public:
+	// Layout of the CPU's processors. On hybrid CPUs, performance cores are the fastest 
+	// kind, and on other CPUs, every core is one.
+	struct CpuTopology
+	{
+		int logicalCount; // Hardware threads.
+		int physicalCount; // Cores, with SMT siblings counted once.
+		int performanceCount; // Performance cores, with SMT siblings counted once.
+
+		// One logical processor ID on each performance core, for pinning threads. Empty if
+		// the platform doesn't say which processor is which.
+		std::vector<int> performanceProcessors;
+
+		CpuTopology();
+	};
+
+	// How a thread is scheduled against other threads when there are more of them than
+	// processors. Background is for work that nothing waits on yet (i.e., prefetching and
+	// generation), above normal is for work a frame waits on, and audio is for threads
+	// that stutter if they're late at all, like the music stream.
+	enum class ThreadPriority { Background, Normal, AboveNormal, Audio };
 private:
 	Platform() = delete;
 	~Platform() = delete;
+
+	// Reads the processor layout from the operating system.
+	static CpuTopology detectCpuTopology();
 public:
 	// Gets the current platform name via SDL_GetPlatform().
 	static std::string getPlatform();
@@ -20,14 +46,35 @@ public:
 	// Gets the options folder path via SDL_GetPrefPath().
 	static std::string getOptionsPath();
 
+	// Gets the folder path for cached decoded assets via SDL_GetPrefPath().
+	static std::string getCachePath();
+
 	// Gets the screenshot folder path via SDL_GetPrefPath().
 	static std::string getScreenshotPath();
 
 	// Gets the log folder path for logging program messages.
 	static std::string getLogPath();
 
-	// Gets the max number of threads available on the CPU.
+	// Gets the layout of the CPU's processors. It's detected on the first call.
+	static const CpuTopology &getCpuTopology();
+
+	// Gets the number of threads the job system (and with it, the 3D renderer) should
+	// have: one per performance core. Frame work is split evenly between threads, so
+	// the frame would wait on one sharing a core with its SMT sibling or running on an
+	// efficiency core.
 	static int getThreadCount();
+
+	// Binds a thread to one logical processor, by the IDs in the CPU topology. Returns
+	// false if it couldn't be done, which is always the case on macOS since it only takes
+	// affinity hints.
+	static bool setThreadAffinity(std::thread &thread, int processorID);
+	static bool setCurrentThreadAffinity(int processorID);
+
+	// Sets the calling thread's priority. Returns false if the OS refused, which on Linux
+	// is usual for anything above normal unless the user has real-time or nice limits
+	// raised. Audio is real-time on Linux when allowed, and the highest priority in the
+	// normal class on Windows.
+	static bool setCurrentThreadPriority(ThreadPriority priority);
 };
 
 #endif
@@ -0,0 +1,110 @@
+#include <algorithm>
+
+#include "Debug.h"
+#include "MemoryTracker.h"
+#include "PoolAllocator.h"
+
+const size_t PoolAllocator::ALIGNMENT = 16;
+const size_t PoolAllocator::DEFAULT_PAGE_SIZE = 256 * 1024;
+
+PoolAllocator::Page::Page(size_t size)
+	: data(std::make_unique<uint8_t[]>(size)), heapView(size) { }
+
+PoolAllocator::PoolAllocator(size_t pageSize, MemoryTag tag)
+{
+	DebugAssert(pageSize > 0, "Page size must be positive.");
+	this->pageSize = pageSize;
+	this->tag = tag;
+}
+
+PoolAllocator::PoolAllocator(MemoryTag tag)
+	: PoolAllocator(PoolAllocator::DEFAULT_PAGE_SIZE, tag) { }
+
+PoolAllocator::~PoolAllocator()
+{
+	MemoryTracker::remove(this->tag, this->getCapacity());
+}
+
+PoolAllocator::Page &PoolAllocator::addPage(size_t size)
+{
+	// Page sizes are multiples of the alignment so every offset is aligned.
+	const size_t pageSize = std::max(size, this->pageSize);
+	const size_t alignedSize = ((pageSize + PoolAllocator::ALIGNMENT - 1) /
+		PoolAllocator::ALIGNMENT) * PoolAllocator::ALIGNMENT;
+	this->pages.push_back(std::make_unique<Page>(alignedSize));
+	MemoryTracker::add(this->tag, alignedSize);
+	return *this->pages.back();
+}
+
+void *PoolAllocator::allocate(size_t size)
+{
+	// Rounding sizes up keeps every free block's offset aligned too.
+	const size_t alignedSize = ((std::max(size, static_cast<size_t>(1)) +
+		PoolAllocator::ALIGNMENT - 1) / PoolAllocator::ALIGNMENT) * PoolAllocator::ALIGNMENT;
+
+	for (const auto &page : this->pages)
+	{
+		const size_t offset = page->heapView.allocate(alignedSize);
+		if (offset != HeapView::NO_SPACE)
+		{
+			return page->data.get() + offset;
+		}
+	}
+
+	Page &page = this->addPage(alignedSize);
+	const size_t offset = page.heapView.allocate(alignedSize);
+	return page.data.get() + offset;
+}
+
+void PoolAllocator::deallocate(void *ptr)
+{
+	const uint8_t *bytes = static_cast<const uint8_t*>(ptr);
+	for (const auto &page : this->pages)
+	{
+		const uint8_t *begin = page->data.get();
+		if ((bytes >= begin) && (bytes < (begin + page->heapView.getCapacity())))
+		{
+			page->heapView.deallocate(static_cast<size_t>(bytes - begin));
+			return;
+		}
+	}
+
+	DebugCrash("Pointer isn't from this pool.");
+}
+
+size_t PoolAllocator::getUsedBytes() const
+{
+	size_t usedBytes = 0;
+	for (const auto &page : this->pages)
+	{
+		usedBytes += page->heapView.getUsedBytes();
+	}
+
+	return usedBytes;
+}
+
+size_t PoolAllocator::getCapacity() const
+{
+	size_t capacity = 0;
+	for (const auto &page : this->pages)
+	{
+		capacity += page->heapView.getCapacity();
+	}
+
+	return capacity;
+}
+
+void PoolAllocator::reset()
+{
+	if (this->pages.size() > 1)
+	{
+		const size_t capacity = this->getCapacity();
+		MemoryTracker::remove(this->tag, capacity);
+		this->pages.clear();
+		this->addPage(capacity);
+	}
+	else if (this->pages.size() == 1)
+	{
+		this->pages.front()->heapView.reset();
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "HeapView.h"
+#include "MemoryTag.h"
+
+// A pool of memory for things that live about as long as each other, like the data of
+// one level. It hands out pieces of a few big pages with a heap view over each one, so
+// the allocations sit next to each other, and freeing the whole pool (or resetting it)
+// is one release per page instead of one for every allocation.
+
+// Allocations are aligned to ALIGNMENT bytes. Pages never move, so pointers stay valid
+// until the allocation is freed or the pool is reset or destroyed.
+
+class PoolAllocator
+{
+private:
+	struct Page
+	{
+		std::unique_ptr<uint8_t[]> data;
+		HeapView heapView;
+
+		Page(size_t size);
+	};
+
+	std::vector<std::unique_ptr<Page>> pages;
+	size_t pageSize;
+	MemoryTag tag; // Pages are reported to the memory tracker under this.
+
+	// Adds a page with room for at least the given bytes.
+	Page &addPage(size_t size);
+public:
+	// Alignment of every allocation.
+	static const size_t ALIGNMENT;
+
+	// Default size of each page.
+	static const size_t DEFAULT_PAGE_SIZE;
+
+	PoolAllocator(size_t pageSize, MemoryTag tag);
+	PoolAllocator(MemoryTag tag);
+	PoolAllocator(const PoolAllocator&) = delete;
+	~PoolAllocator();
+
+	PoolAllocator &operator=(const PoolAllocator&) = delete;
+
+	// Gets memory from the first page with room for it, adding a page if none have any.
+	void *allocate(size_t size);
+
+	// Frees an allocation from this pool so its space can be used again.
+	void deallocate(void *ptr);
+
+	// Gets the total size of the allocations.
+	size_t getUsedBytes() const;
+
+	// Gets the total size of the pages.
+	size_t getCapacity() const;
+
+	// Frees every allocation at once. Pages are kept for reuse, except that several are
+	// merged into one big enough for all of them, so a pool filled the same way again
+	// is contiguous.
+	void reset();
+};
+
+#endif
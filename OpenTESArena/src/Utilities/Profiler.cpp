@@ -0,0 +1,146 @@
+#include <fstream>
+
+#include "Debug.h"
+#include "Profiler.h"
+
+const int Profiler::MAX_EVENTS_PER_THREAD = 1 << 16;
+
+std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Profiler::threadBuffers;
+std::mutex Profiler::threadBuffersMutex;
+std::atomic<bool> Profiler::capturing(false);
+std::chrono::steady_clock::time_point Profiler::captureStartTime;
+std::string Profiler::captureFilename;
+int Profiler::captureFramesLeft = 0;
+
+Profiler::Scope::Scope(const char *name)
+{
+	this->name = name;
+	this->startMicroseconds = Profiler::isCapturing() ? Profiler::getCaptureMicroseconds() : -1;
+}
+
+Profiler::Scope::~Scope()
+{
+	// Only scopes that started during the capture are recorded, and only if the buffer
+	// has room. The event is written before the count is published so the reader never
+	// sees a half-written one.
+	if (this->startMicroseconds >= 0)
+	{
+		ThreadBuffer &buffer = Profiler::getThreadBuffer();
+		const int index = buffer.count.load(std::memory_order_relaxed);
+		if (index < static_cast<int>(buffer.events.size()))
+		{
+			Event &event = buffer.events[index];
+			event.name = this->name;
+			event.startMicroseconds = this->startMicroseconds;
+			event.durationMicroseconds =
+				Profiler::getCaptureMicroseconds() - this->startMicroseconds;
+			buffer.count.store(index + 1, std::memory_order_release);
+		}
+	}
+}
+
+Profiler::ThreadBuffer::ThreadBuffer(int threadID)
+	: events(Profiler::MAX_EVENTS_PER_THREAD), count(0)
+{
+	this->threadID = threadID;
+}
+
+Profiler::ThreadBuffer &Profiler::getThreadBuffer()
+{
+	thread_local ThreadBuffer *buffer = nullptr;
+	if (buffer == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(Profiler::threadBuffersMutex);
+		const int threadID = static_cast<int>(Profiler::threadBuffers.size());
+		Profiler::threadBuffers.push_back(std::make_unique<ThreadBuffer>(threadID));
+		buffer = Profiler::threadBuffers.back().get();
+	}
+
+	return *buffer;
+}
+
+int64_t Profiler::getCaptureMicroseconds()
+{
+	const auto now = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		now - Profiler::captureStartTime).count();
+}
+
+void Profiler::writeChromeTrace()
+{
+	std::ofstream ofs(Profiler::captureFilename);
+	if (!ofs.is_open())
+	{
+		DebugWarning("Could not open \"" + Profiler::captureFilename + "\" for writing.");
+		return;
+	}
+
+	// Complete ("X") events, one per profiled scope.
+	ofs << "{\"traceEvents\":[";
+
+	bool first = true;
+	std::lock_guard<std::mutex> lock(Profiler::threadBuffersMutex);
+	for (const auto &buffer : Profiler::threadBuffers)
+	{
+		const int count = buffer->count.load(std::memory_order_acquire);
+		for (int i = 0; i < count; i++)
+		{
+			const Event &event = buffer->events[i];
+			ofs << (first ? "" : ",") << '\n' <<
+				"{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"ts\":" <<
+				event.startMicroseconds << ",\"dur\":" << event.durationMicroseconds <<
+				",\"pid\":0,\"tid\":" << buffer->threadID << '}';
+			first = false;
+		}
+	}
+
+	ofs << '\n' << "]}" << '\n';
+
+	DebugMention("Trace saved to \"" + Profiler::captureFilename + "\".");
+}
+
+bool Profiler::isCapturing()
+{
+	return Profiler::capturing.load(std::memory_order_relaxed);
+}
+
+void Profiler::beginCapture(int frameCount, const std::string &filename)
+{
+	DebugAssert(frameCount > 0, "Capture frame count must be positive.");
+
+	if (Profiler::isCapturing())
+	{
+		return;
+	}
+
+	// Events from the last capture are discarded.
+	{
+		std::lock_guard<std::mutex> lock(Profiler::threadBuffersMutex);
+		for (auto &buffer : Profiler::threadBuffers)
+		{
+			buffer->count.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	Profiler::captureStartTime = std::chrono::steady_clock::now();
+	Profiler::captureFilename = filename;
+	Profiler::captureFramesLeft = frameCount;
+	Profiler::capturing.store(true, std::memory_order_release);
+
+	DebugMention("Capturing a trace of the next " + std::to_string(frameCount) + " frames.");
+}
+
+void Profiler::endFrame()
+{
+	if (!Profiler::isCapturing())
+	{
+		return;
+	}
+
+	Profiler::captureFramesLeft--;
+	if (Profiler::captureFramesLeft == 0)
+	{
+		Profiler::capturing.store(false, std::memory_order_release);
+		Profiler::writeChromeTrace();
+	}
+}
@@ -0,0 +1,94 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Static class for recording how long scopes of code take over a few frames, and writing
+// them as a Chrome trace (viewable in chrome://tracing or Perfetto).
+
+// Each thread records into its own fixed-size buffer, so recording doesn't lock. A thread
+// only takes a lock the first time it records, to register its buffer. The buffers are
+// read once the capture is over, which must be at a point where no other thread is inside
+// a profiled scope (i.e., after the render threads are done with the frame).
+
+// The ProfileScope() macro does nothing unless the build defines TES_PROFILER.
+
+class Profiler
+{
+public:
+	// Records the time from construction to destruction if a capture is running. Use
+	// ProfileScope() instead. The name must be a string literal.
+	class Scope
+	{
+	private:
+		const char *name;
+		int64_t startMicroseconds; // Negative if not capturing.
+	public:
+		Scope(const char *name);
+		~Scope();
+	};
+private:
+	struct Event
+	{
+		const char *name;
+		int64_t startMicroseconds, durationMicroseconds;
+	};
+
+	struct ThreadBuffer
+	{
+		std::vector<Event> events;
+		std::atomic<int> count;
+		int threadID;
+
+		ThreadBuffer(int threadID);
+	};
+
+	// Max events each thread stores per capture. Later ones are dropped.
+	static const int MAX_EVENTS_PER_THREAD;
+
+	static std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+	static std::mutex threadBuffersMutex;
+	static std::atomic<bool> capturing;
+	static std::chrono::steady_clock::time_point captureStartTime;
+	static std::string captureFilename;
+	static int captureFramesLeft;
+
+	Profiler() = delete;
+	~Profiler() = delete;
+
+	// Gets the calling thread's buffer, registering a new one on its first call.
+	static ThreadBuffer &getThreadBuffer();
+
+	// Gets the microseconds since the capture started.
+	static int64_t getCaptureMicroseconds();
+
+	// Writes every thread's events to the capture's file.
+	static void writeChromeTrace();
+public:
+	// Whether a capture is running.
+	static bool isCapturing();
+
+	// Starts recording for the given number of frames, after which the trace is written
+	// to the given file. Does nothing if a capture is already running.
+	static void beginCapture(int frameCount, const std::string &filename);
+
+	// Counts down the frames of a running capture and ends it when done. Must be called
+	// once per frame from the main thread while no other thread is recording.
+	static void endFrame();
+
+#if defined(TES_PROFILER)
+#define ProfileScopeConcat2(a, b) a##b
+#define ProfileScopeConcat(a, b) ProfileScopeConcat2(a, b)
+#define ProfileScope(name) Profiler::Scope ProfileScopeConcat(profileScope, __LINE__)(name)
+#else
+#define ProfileScope(name)
+#endif
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+
+#include "Debug.h"
+#include "File.h"
+#include "StartupTimeline.h"
+#include "String.h"
+
+const std::string StartupTimeline::FILENAME = "startup.csv";
+
+std::vector<StartupTimeline::Phase> StartupTimeline::phases;
+std::chrono::steady_clock::time_point StartupTimeline::startTime;
+std::chrono::steady_clock::time_point StartupTimeline::lastMarkTime;
+bool StartupTimeline::started = false;
+bool StartupTimeline::finished = false;
+
+void StartupTimeline::start()
+{
+	if (StartupTimeline::started)
+	{
+		return;
+	}
+
+	StartupTimeline::startTime = std::chrono::steady_clock::now();
+	StartupTimeline::lastMarkTime = StartupTimeline::startTime;
+	StartupTimeline::started = true;
+}
+
+void StartupTimeline::mark(const std::string &name)
+{
+	if (!StartupTimeline::started || StartupTimeline::finished)
+	{
+		return;
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+
+	Phase phase;
+	phase.name = name;
+	phase.startSeconds = std::chrono::duration<double>(
+		StartupTimeline::lastMarkTime - StartupTimeline::startTime).count();
+	phase.durationSeconds = std::chrono::duration<double>(
+		now - StartupTimeline::lastMarkTime).count();
+	StartupTimeline::phases.push_back(phase);
+
+	StartupTimeline::lastMarkTime = now;
+}
+
+bool StartupTimeline::isFinished()
+{
+	return StartupTimeline::finished;
+}
+
+void StartupTimeline::finish(const std::string &directory)
+{
+	if (!StartupTimeline::started || StartupTimeline::finished)
+	{
+		return;
+	}
+
+	StartupTimeline::finished = true;
+
+	const double totalSeconds = std::chrono::duration<double>(
+		StartupTimeline::lastMarkTime - StartupTimeline::startTime).count();
+
+	// Pad the names so the columns line up.
+	size_t nameWidth = 0;
+	for (const Phase &phase : StartupTimeline::phases)
+	{
+		nameWidth = std::max(nameWidth, phase.name.size());
+	}
+
+	std::string table = "Startup timeline (start ms, duration ms):";
+	for (const Phase &phase : StartupTimeline::phases)
+	{
+		table += "\n  " + phase.name + std::string(nameWidth - phase.name.size(), ' ') +
+			"  " + String::fixedPrecision(phase.startSeconds * 1000.0, 1) + "  " +
+			String::fixedPrecision(phase.durationSeconds * 1000.0, 1);
+	}
+
+	table += "\n  Total: " + String::fixedPrecision(totalSeconds * 1000.0, 1) + " ms";
+	DebugMention(table);
+
+	if (directory.size() == 0)
+	{
+		return;
+	}
+
+	// One row per phase, with the launch time telling runs apart.
+	const std::string filename(directory + StartupTimeline::FILENAME);
+	const bool writeHeader = !File::exists(filename);
+	std::ofstream ofs(filename, std::ios::app);
+	if (!ofs.is_open())
+	{
+		DebugWarning("Could not open \"" + filename + "\" for writing.");
+		return;
+	}
+
+	if (writeHeader)
+	{
+		ofs << "launch_time,phase,start_ms,duration_ms" << '\n';
+	}
+
+	const std::string launchTime = std::to_string(static_cast<long long>(std::time(nullptr)));
+	for (const Phase &phase : StartupTimeline::phases)
+	{
+		ofs << launchTime << ',' << phase.name << ',' <<
+			String::fixedPrecision(phase.startSeconds * 1000.0, 2) << ',' <<
+			String::fixedPrecision(phase.durationSeconds * 1000.0, 2) << '\n';
+	}
+
+	ofs << launchTime << ",total,0.00," << String::fixedPrecision(totalSeconds * 1000.0, 2) <<
+		'\n';
+}
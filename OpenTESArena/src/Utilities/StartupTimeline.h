@@ -0,0 +1,46 @@
+#ifndef STARTUP_TIMELINE_H
+#define STARTUP_TIMELINE_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Static class for recording how long each phase of program startup takes, from the top
+// of main() until the first frame is presented. Phases are back to back: each one starts
+// where the previous one ended. All calls must be from the main thread.
+
+class StartupTimeline
+{
+private:
+	struct Phase
+	{
+		std::string name;
+		double startSeconds, durationSeconds;
+	};
+
+	static std::vector<Phase> phases;
+	static std::chrono::steady_clock::time_point startTime, lastMarkTime;
+	static bool started, finished;
+
+	StartupTimeline() = delete;
+	~StartupTimeline() = delete;
+public:
+	// Filename of the CSV file the timeline is appended to, if saving is enabled.
+	static const std::string FILENAME;
+
+	// Starts the timeline. Should be the first thing in main().
+	static void start();
+
+	// Ends the current phase, giving it the name. The next phase starts now.
+	static void mark(const std::string &name);
+
+	// Whether finish() has been called.
+	static bool isFinished();
+
+	// Ends the timeline and writes a table of the phases to the log. If the directory isn't
+	// empty, the phases are also appended to the CSV file in it, so startup times can be
+	// compared between runs and builds. Later calls to the class do nothing.
+	static void finish(const std::string &directory);
+};
+
+#endif
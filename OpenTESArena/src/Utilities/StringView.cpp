@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Debug.h"
+#include "StringView.h"
+
+const size_t StringView::NPOS = static_cast<size_t>(-1);
+
+StringView::StringView(const char *chars, size_t length)
+	: chars(chars), length(length) { }
+
+StringView::StringView(const char *str)
+	: chars(str), length(std::strlen(str)) { }
+
+StringView::StringView(const std::string &str)
+	: chars(str.data()), length(str.size()) { }
+
+StringView::StringView()
+	: chars(nullptr), length(0) { }
+
+const char *StringView::data() const
+{
+	return this->chars;
+}
+
+size_t StringView::size() const
+{
+	return this->length;
+}
+
+bool StringView::empty() const
+{
+	return this->length == 0;
+}
+
+char StringView::front() const
+{
+	return this->chars[0];
+}
+
+char StringView::back() const
+{
+	return this->chars[this->length - 1];
+}
+
+char StringView::operator[](size_t index) const
+{
+	return this->chars[index];
+}
+
+StringView StringView::substr(size_t pos, size_t count) const
+{
+	const size_t start = std::min(pos, this->length);
+	return StringView(this->chars + start, std::min(count, this->length - start));
+}
+
+size_t StringView::find(char c) const
+{
+	for (size_t i = 0; i < this->length; i++)
+	{
+		if (this->chars[i] == c)
+		{
+			return i;
+		}
+	}
+
+	return StringView::NPOS;
+}
+
+bool StringView::operator==(const StringView &other) const
+{
+	return (this->length == other.length) &&
+		(std::memcmp(this->chars, other.chars, this->length) == 0);
+}
+
+bool StringView::operator!=(const StringView &other) const
+{
+	return !(*this == other);
+}
+
+std::string StringView::toString() const
+{
+	return std::string(this->chars, this->length);
+}
+
+void StringView::split(StringView str, char separator, std::vector<StringView> &tokens)
+{
+	tokens.clear();
+
+	size_t tokenStart = 0;
+	for (size_t i = 0; i < str.size(); i++)
+	{
+		if (str[i] == separator)
+		{
+			tokens.push_back(str.substr(tokenStart, i - tokenStart));
+			tokenStart = i + 1;
+		}
+	}
+
+	tokens.push_back(str.substr(tokenStart));
+}
+
+StringView StringView::trimBack(StringView str)
+{
+	size_t length = str.size();
+	while ((length > 0) && ((str[length - 1] == ' ') || (str[length - 1] == '\t')))
+	{
+		length--;
+	}
+
+	return str.substr(0, length);
+}
+
+int StringView::toInt(StringView str)
+{
+	size_t i = 0;
+	while ((i < str.size()) && ((str[i] == ' ') || (str[i] == '\t')))
+	{
+		i++;
+	}
+
+	bool negative = false;
+	if ((i < str.size()) && ((str[i] == '-') || (str[i] == '+')))
+	{
+		negative = str[i] == '-';
+		i++;
+	}
+
+	const size_t digitsStart = i;
+	int value = 0;
+	while ((i < str.size()) && (str[i] >= '0') && (str[i] <= '9'))
+	{
+		value = (value * 10) + (str[i] - '0');
+		i++;
+	}
+
+	if (i == digitsStart)
+	{
+		DebugCrash("\"" + str.toString() + "\" is not an integer.");
+	}
+
+	return negative ? -value : value;
+}
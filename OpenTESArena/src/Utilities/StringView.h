@@ -0,0 +1,57 @@
+#ifndef STRING_VIEW_H
+#define STRING_VIEW_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A read-only slice of characters owned by something else, for parsing text without
+// copying every line and token into its own string (like C++17's std::string_view).
+// The characters must outlive the view.
+
+class StringView
+{
+private:
+	const char *chars;
+	size_t length;
+public:
+	// Returned by find() when the character isn't there.
+	static const size_t NPOS;
+
+	StringView(const char *chars, size_t length);
+	StringView(const char *str);
+	StringView(const std::string &str);
+	StringView();
+
+	const char *data() const;
+	size_t size() const;
+	bool empty() const;
+	char front() const;
+	char back() const;
+	char operator[](size_t index) const;
+
+	// Gets the characters from the position up to the given count, clamped to the end.
+	StringView substr(size_t pos, size_t count = NPOS) const;
+
+	// Gets the position of the first instance of the character, or NPOS.
+	size_t find(char c) const;
+
+	bool operator==(const StringView &other) const;
+	bool operator!=(const StringView &other) const;
+
+	// Copies the characters into a new string.
+	std::string toString() const;
+
+	// Splits the view on the given character, like String::split(). Empty tokens are kept.
+	// The tokens vector is cleared first, so it can be reused without reallocating.
+	static void split(StringView str, char separator, std::vector<StringView> &tokens);
+
+	// Removes trailing spaces and tabs.
+	static StringView trimBack(StringView str);
+
+	// Parses a decimal integer like std::stoi(): leading whitespace is skipped, and parsing
+	// stops at the first character that isn't a digit. It's an error if there are no digits.
+	static int toInt(StringView str);
+};
+
+#endif
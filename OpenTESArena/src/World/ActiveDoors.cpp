@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <string>
+
+#include "ActiveDoors.h"
+#include "../Utilities/Debug.h"
+
+const double ActiveDoors::SWING_SECONDS = 1.0;
+const double ActiveDoors::STAY_OPEN_SECONDS = 3.0;
+
+bool ActiveDoors::isEmpty() const
+{
+	return this->doors.empty();
+}
+
+int ActiveDoors::getCount() const
+{
+	return static_cast<int>(this->doors.size());
+}
+
+const ActiveDoors::Door &ActiveDoors::getDoor(int index) const
+{
+	DebugAssert((index >= 0) && (index < this->getCount()),
+		"Active door index " + std::to_string(index) + " out of range.");
+	return this->doors[index];
+}
+
+double ActiveDoors::getOpenPercent(const Int3 &voxel) const
+{
+	const auto iter = this->indices.find(voxel);
+	return (iter != this->indices.end()) ? this->doors[iter->second].openPercent : 0.0;
+}
+
+void ActiveDoors::open(const Int3 &voxel, VoxelData::DoorData::Type type)
+{
+	const auto iter = this->indices.find(voxel);
+	if (iter != this->indices.end())
+	{
+		Door &door = this->doors[iter->second];
+		door.direction = Direction::Opening;
+		door.secondsOpen = 0.0;
+		return;
+	}
+
+	Door door;
+	door.voxel = voxel;
+	door.type = type;
+	door.openPercent = 0.0;
+	door.direction = Direction::Opening;
+	door.secondsOpen = 0.0;
+
+	this->indices.insert(std::make_pair(voxel, static_cast<int>(this->doors.size())));
+	this->doors.push_back(door);
+}
+
+void ActiveDoors::tick(double dt, std::vector<Change> &changes)
+{
+	changes.clear();
+
+	const double percentDelta = dt / ActiveDoors::SWING_SECONDS;
+	size_t i = 0;
+	while (i < this->doors.size())
+	{
+		Door &door = this->doors[i];
+		const double oldPercent = door.openPercent;
+
+		if (door.direction == Direction::Opening)
+		{
+			if (door.openPercent < 1.0)
+			{
+				door.openPercent = std::min(door.openPercent + percentDelta, 1.0);
+			}
+			else
+			{
+				door.secondsOpen += dt;
+				if (door.secondsOpen >= ActiveDoors::STAY_OPEN_SECONDS)
+				{
+					door.direction = Direction::Closing;
+				}
+			}
+		}
+		else
+		{
+			door.openPercent = std::max(door.openPercent - percentDelta, 0.0);
+		}
+
+		if (door.openPercent != oldPercent)
+		{
+			Change change;
+			change.voxel = door.voxel;
+			change.openPercent = door.openPercent;
+			changes.push_back(change);
+		}
+
+		if ((door.openPercent == 0.0) && (door.direction == Direction::Closing))
+		{
+			// Closed, so it goes back to costing nothing. The last door takes its place.
+			this->indices.erase(door.voxel);
+			if (i != (this->doors.size() - 1))
+			{
+				this->doors[i] = this->doors.back();
+				this->indices[this->doors[i].voxel] = static_cast<int>(i);
+			}
+
+			this->doors.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+void ActiveDoors::scroll(int dx, int dz, int gridWidth, int gridDepth)
+{
+	std::vector<Door> oldDoors = std::move(this->doors);
+	this->doors.clear();
+	this->indices.clear();
+
+	for (Door &door : oldDoors)
+	{
+		door.voxel.x += dx;
+		door.voxel.z += dz;
+		if ((door.voxel.x >= 0) && (door.voxel.x < gridWidth) &&
+			(door.voxel.z >= 0) && (door.voxel.z < gridDepth))
+		{
+			this->indices.insert(
+				std::make_pair(door.voxel, static_cast<int>(this->doors.size())));
+			this->doors.push_back(door);
+		}
+	}
+}
+
+void ActiveDoors::clear()
+{
+	this->doors.clear();
+	this->indices.clear();
+}
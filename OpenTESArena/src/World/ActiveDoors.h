@@ -0,0 +1,69 @@
+#ifndef ACTIVE_DOORS_H
+#define ACTIVE_DOORS_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "VoxelData.h"
+#include "../Math/Vector3.h"
+
+// The doors in a level that aren't closed. A door is added when it's opened and removed
+// once it closes again, so only moving and open doors are ever ticked, and the voxel grid
+// keeps describing every door as it is at rest. The renderer is given each door's open
+// percent as it changes.
+
+class ActiveDoors
+{
+public:
+	enum class Direction { Opening, Closing };
+
+	struct Door
+	{
+		Int3 voxel;
+		VoxelData::DoorData::Type type;
+		double openPercent; // 0 is closed, 1 is fully open.
+		Direction direction;
+		double secondsOpen; // How long it's been fully open.
+	};
+
+	// A door whose open percent changed in a tick. A closed door has zero and is no longer
+	// active.
+	struct Change
+	{
+		Int3 voxel;
+		double openPercent;
+	};
+private:
+	// Seconds a door takes to open or close all the way.
+	static const double SWING_SECONDS;
+
+	// Seconds a door stays fully open before it starts closing.
+	static const double STAY_OPEN_SECONDS;
+
+	std::vector<Door> doors;
+	std::unordered_map<Int3, int> indices; // Index in the doors of each active door's voxel.
+public:
+	bool isEmpty() const;
+	int getCount() const;
+	const Door &getDoor(int index) const;
+
+	// Gets how far open the door in the given voxel is, or zero if it's closed.
+	double getOpenPercent(const Int3 &voxel) const;
+
+	// Starts opening the door in the given voxel. A closing door turns back around, and an
+	// open one stays open for longer.
+	void open(const Int3 &voxel, VoxelData::DoorData::Type type);
+
+	// Moves each door along and writes the ones whose open percent changed to the given
+	// list, which is cleared first. Doors that closed are removed.
+	void tick(double dt, std::vector<Change> &changes);
+
+	// Moves every door by the given X and Z, like when the wilderness grid scrolls. Doors
+	// moved off a grid of the given size are dropped.
+	void scroll(int dx, int dz, int gridWidth, int gridDepth);
+
+	// Closes every door at once.
+	void clear();
+};
+
+#endif
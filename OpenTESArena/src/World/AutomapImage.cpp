@@ -0,0 +1,250 @@
+#include <algorithm>
+
+#include "AutomapImage.h"
+#include "VoxelData.h"
+#include "VoxelDataType.h"
+#include "VoxelGrid.h"
+#include "../Media/Color.h"
+#include "../Utilities/Debug.h"
+
+namespace
+{
+	// Colors for automap pixels. Ground pixels (y == 0) are transparent.
+	const Color AutomapFloor(0, 0, 0, 0);
+	const Color AutomapWall(130, 89, 48);
+	const Color AutomapRaised(97, 85, 60);
+	const Color AutomapDoor(146, 0, 0);
+	const Color AutomapLevelUp(0, 105, 0);
+	const Color AutomapLevelDown(0, 0, 255);
+	const Color AutomapDryChasm(20, 40, 40);
+	const Color AutomapWetChasm(109, 138, 174);
+	const Color AutomapLavaChasm(255, 0, 0);
+	const Color AutomapNotImplemented(255, 0, 255);
+}
+
+const int AutomapImage::PIXELS_PER_VOXEL = 3;
+
+AutomapImage::AutomapImage()
+{
+	this->width = 0;
+	this->height = 0;
+	this->revision = -1;
+	this->gridID = -1;
+}
+
+const Color &AutomapImage::getPixelColor(const VoxelData &floorData, const VoxelData &wallData)
+{
+	const VoxelDataType floorDataType = floorData.dataType;
+	const VoxelDataType wallDataType = wallData.dataType;
+
+	if (floorDataType == VoxelDataType::Chasm)
+	{
+		const VoxelData::ChasmData::Type chasmType = floorData.chasm.type;
+
+		if (chasmType == VoxelData::ChasmData::Type::Dry)
+		{
+			// Dry chasms are a different color if a wall is over them.
+			return (wallDataType == VoxelDataType::Wall) ? AutomapRaised : AutomapDryChasm;
+		}
+		else if (chasmType == VoxelData::ChasmData::Type::Lava)
+		{
+			// Lava chasms ignore all but raised platforms.
+			return (wallDataType == VoxelDataType::Raised) ? AutomapRaised : AutomapLavaChasm;
+		}
+		else if (chasmType == VoxelData::ChasmData::Type::Wet)
+		{
+			// Water chasms ignore all but raised platforms.
+			return (wallDataType == VoxelDataType::Raised) ? AutomapRaised : AutomapWetChasm;
+		}
+		else
+		{
+			DebugWarning("Unrecognized chasm type \"" +
+				std::to_string(static_cast<int>(chasmType)) + "\".");
+			return AutomapNotImplemented;
+		}
+	}
+	else if (floorDataType == VoxelDataType::Floor)
+	{
+		// If nothing is over the floor, return transparent. Otherwise, choose from
+		// a number of cases.
+		if (wallDataType == VoxelDataType::None)
+		{
+			return AutomapFloor;
+		}
+		else if (wallDataType == VoxelDataType::Wall)
+		{
+			const VoxelData::WallData::Type wallType = wallData.wall.type;
+
+			if (wallType == VoxelData::WallData::Type::Solid)
+			{
+				return AutomapWall;
+			}
+			else if (wallType == VoxelData::WallData::Type::LevelUp)
+			{
+				return AutomapLevelUp;
+			}
+			else if (wallType == VoxelData::WallData::Type::LevelDown)
+			{
+				return AutomapLevelDown;
+			}
+			else if (wallType == VoxelData::WallData::Type::Menu)
+			{
+				// Menu blocks are the same color as doors.
+				return AutomapDoor;
+			}
+			else
+			{
+				DebugWarning("Unrecognized wall type \"" +
+					std::to_string(static_cast<int>(wallType)) + "\".");
+				return AutomapNotImplemented;
+			}
+		}
+		else if (wallDataType == VoxelDataType::Raised)
+		{
+			return AutomapRaised;
+		}
+		else if (wallDataType == VoxelDataType::Diagonal)
+		{
+			return AutomapFloor;
+		}
+		else if (wallDataType == VoxelDataType::Door)
+		{
+			return AutomapDoor;
+		}
+		else if (wallDataType == VoxelDataType::TransparentWall)
+		{
+			// Transparent walls with collision (hedges) are shown, while
+			// ones without collision (archways) are not.
+			const VoxelData::TransparentWallData &transparentWallData = wallData.transparentWall;
+			return transparentWallData.collider ? AutomapWall : AutomapFloor;
+		}
+		else if (wallDataType == VoxelDataType::Edge)
+		{
+			return AutomapWall;
+		}
+		else
+		{
+			DebugWarning("Unrecognized wall data type \"" +
+				std::to_string(static_cast<int>(wallDataType)) + "\".");
+			return AutomapNotImplemented;
+		}
+	}
+	else
+	{
+		DebugWarning("Unrecognized floor data type \"" +
+			std::to_string(static_cast<int>(floorDataType)) + "\".");
+		return AutomapNotImplemented;
+	}
+}
+
+void AutomapImage::drawChunk(const VoxelGrid &voxelGrid, int chunkX, int chunkZ)
+{
+	auto getVoxelData = [&voxelGrid](int x, int y, int z) -> const VoxelData&
+	{
+		return voxelGrid.getVoxelData(voxelGrid.getVoxel(x, y, z));
+	};
+
+	const int startX = chunkX * VoxelGrid::CHUNK_SIZE;
+	const int startZ = chunkZ * VoxelGrid::CHUNK_SIZE;
+	const int endX = std::min(startX + VoxelGrid::CHUNK_SIZE, voxelGrid.getWidth());
+	const int endZ = std::min(startZ + VoxelGrid::CHUNK_SIZE, voxelGrid.getDepth());
+	const int squareSize = AutomapImage::PIXELS_PER_VOXEL;
+
+	// The color depends on a couple factors, like whether the voxel is a wall, a door,
+	// water, etc., and some context-sensitive cases like whether a dry chasm has a wall
+	// over it.
+	for (int x = startX; x < endX; x++)
+	{
+		for (int z = startZ; z < endZ; z++)
+		{
+			const VoxelData &floorData = getVoxelData(x, 0, z);
+			const VoxelData &wallData = getVoxelData(x, 1, z);
+			const uint32_t color = AutomapImage::getPixelColor(floorData, wallData).toARGB();
+
+			// Fill in the column's square.
+			const int left = z * squareSize;
+			const int top = this->height - squareSize - (x * squareSize);
+			for (int y = top; y < (top + squareSize); y++)
+			{
+				uint32_t *row = this->pixels.data() + (y * this->width);
+				std::fill(row + left, row + left + squareSize, color);
+			}
+		}
+	}
+}
+
+bool AutomapImage::update(const VoxelGrid &voxelGrid)
+{
+	if ((voxelGrid.getID() == this->gridID) && (voxelGrid.getRevision() == this->revision))
+	{
+		return false;
+	}
+
+	const int chunkCountX = voxelGrid.getChunkCountX();
+	const int chunkCountZ = voxelGrid.getChunkCountZ();
+	const int newWidth = voxelGrid.getDepth() * AutomapImage::PIXELS_PER_VOXEL;
+	const int newHeight = voxelGrid.getWidth() * AutomapImage::PIXELS_PER_VOXEL;
+
+	// A differently sized grid needs every chunk drawn again.
+	if ((newWidth != this->width) || (newHeight != this->height))
+	{
+		this->width = newWidth;
+		this->height = newHeight;
+		this->pixels = std::vector<uint32_t>(newWidth * newHeight, AutomapFloor.toARGB());
+		this->chunkRevisions = std::vector<int>(chunkCountX * chunkCountZ, -1);
+	}
+
+	bool changed = false;
+	auto updateChunk = [this, &voxelGrid, chunkCountX, &changed](int chunkX, int chunkZ)
+	{
+		const int chunkRevision = voxelGrid.getChunkRevision(chunkX, chunkZ);
+		int &drawnRevision = this->chunkRevisions[chunkX + (chunkZ * chunkCountX)];
+		if (chunkRevision != drawnRevision)
+		{
+			this->drawChunk(voxelGrid, chunkX, chunkZ);
+			drawnRevision = chunkRevision;
+			changed = true;
+		}
+	};
+
+	// The same grid can say which chunks changed since the last update. Any other grid
+	// (or one whose log doesn't go back that far) has every chunk checked.
+	std::vector<Int2> changedChunks;
+	if ((voxelGrid.getID() == this->gridID) &&
+		voxelGrid.getChangedChunks(this->revision, changedChunks))
+	{
+		for (const Int2 &chunk : changedChunks)
+		{
+			updateChunk(chunk.x, chunk.y);
+		}
+	}
+	else
+	{
+		for (int chunkZ = 0; chunkZ < chunkCountZ; chunkZ++)
+		{
+			for (int chunkX = 0; chunkX < chunkCountX; chunkX++)
+			{
+				updateChunk(chunkX, chunkZ);
+			}
+		}
+	}
+
+	this->revision = voxelGrid.getRevision();
+	this->gridID = voxelGrid.getID();
+	return changed;
+}
+
+int AutomapImage::getWidth() const
+{
+	return this->width;
+}
+
+int AutomapImage::getHeight() const
+{
+	return this->height;
+}
+
+const uint32_t *AutomapImage::getPixels() const
+{
+	return this->pixels.data();
+}
@@ -0,0 +1,48 @@
+#ifndef AUTOMAP_IMAGE_H
+#define AUTOMAP_IMAGE_H
+
+#include <cstdint>
+#include <vector>
+
+// The automap's picture of a level, with a 3x3 square of color for each XZ column based
+// on its floor and wall voxels. It's kept with the level and only redrawn for chunks of the
+// voxel grid that changed since the last update, so opening the automap is just an upload.
+
+// (0, 0) is the bottom left, +X (north) is up, and +Z (east) is right. The player's arrow
+// isn't part of the image, since it changes every time the automap is opened.
+
+class Color;
+class VoxelData;
+class VoxelGrid;
+
+class AutomapImage
+{
+public:
+	// Width and height in pixels of each voxel column's square, enough for every direction
+	// of the player's arrow.
+	static const int PIXELS_PER_VOXEL;
+private:
+	std::vector<uint32_t> pixels; // ARGB, top row first.
+	std::vector<int> chunkRevisions; // Chunk revisions the pixels were last drawn from.
+	int width, height;
+	int revision; // Voxel grid revision of the last update.
+	int gridID; // Voxel grid ID of the last update.
+
+	// Gets the display color for a voxel column, given its floor and wall voxel data.
+	static const Color &getPixelColor(const VoxelData &floorData, const VoxelData &wallData);
+
+	// Draws the squares of every column in a chunk.
+	void drawChunk(const VoxelGrid &voxelGrid, int chunkX, int chunkZ);
+public:
+	AutomapImage();
+
+	// Draws the parts of the image whose chunks changed since the last update (all of it
+	// the first time). Returns whether any pixels changed.
+	bool update(const VoxelGrid &voxelGrid);
+
+	int getWidth() const;
+	int getHeight() const;
+	const uint32_t *getPixels() const;
+};
+
+#endif
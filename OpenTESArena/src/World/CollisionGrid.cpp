@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "CollisionGrid.h"
+#include "VoxelData.h"
+#include "VoxelDataType.h"
+
+const uint8_t CollisionGrid::SOLID = 1 << 0;
+const uint8_t CollisionGrid::PLATFORM = 1 << 1;
+const uint8_t CollisionGrid::CHASM = 1 << 2;
+const uint8_t CollisionGrid::DOOR = 1 << 3;
+
+CollisionGrid::CollisionGrid(int width, int height, int depth)
+	: flags(width * height * depth, 0)
+{
+	this->width = width;
+	this->height = height;
+	this->depth = depth;
+}
+
+uint8_t CollisionGrid::makeFlags(const VoxelData &voxelData)
+{
+	const VoxelDataType dataType = voxelData.dataType;
+	if (dataType == VoxelDataType::None)
+	{
+		return 0;
+	}
+	else if (dataType == VoxelDataType::TransparentWall)
+	{
+		return voxelData.transparentWall.collider ? CollisionGrid::SOLID : 0;
+	}
+	else if (dataType == VoxelDataType::Edge)
+	{
+		// To do: treat as edge, not solid voxel.
+		return voxelData.edge.collider ? CollisionGrid::SOLID : 0;
+	}
+	else if (dataType == VoxelDataType::Door)
+	{
+		return CollisionGrid::DOOR;
+	}
+	else if (dataType == VoxelDataType::Wall)
+	{
+		// -- Temporary hack for "on voxel enter" transitions --
+		// - To do: replace with "on would enter voxel" event and near facing check.
+		const VoxelData::WallData::Type wallType = voxelData.wall.type;
+		const bool isLevelUpDown = (wallType == VoxelData::WallData::Type::LevelUp) ||
+			(wallType == VoxelData::WallData::Type::LevelDown);
+		return isLevelUpDown ? 0 : CollisionGrid::SOLID;
+	}
+	else if (dataType == VoxelDataType::Raised)
+	{
+		return CollisionGrid::SOLID | CollisionGrid::PLATFORM;
+	}
+	else if (dataType == VoxelDataType::Chasm)
+	{
+		return CollisionGrid::SOLID | CollisionGrid::CHASM;
+	}
+	else
+	{
+		// Floors, ceilings, and diagonals.
+		return CollisionGrid::SOLID;
+	}
+}
+
+uint8_t CollisionGrid::getFlags(int x, int y, int z) const
+{
+	if ((x < 0) || (x >= this->width) || (y < 0) || (y >= this->height) ||
+		(z < 0) || (z >= this->depth))
+	{
+		return 0;
+	}
+
+	return this->flags[x + (y * this->width) + (z * this->width * this->height)];
+}
+
+void CollisionGrid::setFlags(int x, int y, int z, uint8_t flags)
+{
+	this->flags[x + (y * this->width) + (z * this->width * this->height)] = flags;
+}
+
+void CollisionGrid::scroll(int dx, int dz)
+{
+	std::vector<uint8_t> newFlags(this->flags.size(), 0);
+	const int sliceSize = this->width * this->height;
+	for (int z = 0; z < this->depth; z++)
+	{
+		const int newZ = z + dz;
+		if ((newZ < 0) || (newZ >= this->depth))
+		{
+			continue;
+		}
+
+		for (int y = 0; y < this->height; y++)
+		{
+			// Copy the part of the row that stays inside the grid.
+			const int startX = std::max(0, -dx);
+			const int endX = std::min(this->width, this->width - dx);
+			if (startX < endX)
+			{
+				const auto srcBegin = this->flags.begin() + startX + (y * this->width) +
+					(z * sliceSize);
+				const auto dstBegin = newFlags.begin() + (startX + dx) + (y * this->width) +
+					(newZ * sliceSize);
+				std::copy(srcBegin, srcBegin + (endX - startX), dstBegin);
+			}
+		}
+	}
+
+	this->flags = std::move(newFlags);
+}
+
+Double3 CollisionGrid::sweepBox(const Double3 &boxMin, const Double3 &boxMax,
+	const Double3 &displacement, uint8_t blockingFlags) const
+{
+	std::array<double, 3> mins = { boxMin.x, boxMin.y, boxMin.z };
+	std::array<double, 3> maxes = { boxMax.x, boxMax.y, boxMax.z };
+	std::array<double, 3> moves = { displacement.x, displacement.y, displacement.z };
+
+	// Gets the range of voxels the box covers on an axis. A box side on a voxel boundary
+	// doesn't cover the voxel past it, unless the box has no size there.
+	auto getCoveredRange = [&mins, &maxes](int axis, int *first, int *last)
+	{
+		*first = static_cast<int>(std::floor(mins[axis]));
+		*last = std::max(*first, static_cast<int>(std::ceil(maxes[axis])) - 1);
+	};
+
+	const std::array<int, 3> axisOrder = { 0, 2, 1 };
+	for (const int axis : axisOrder)
+	{
+		const double move = moves[axis];
+		if (move == 0.0)
+		{
+			continue;
+		}
+
+		// Voxel layers on this axis that the leading side of the box enters.
+		const bool positive = move > 0.0;
+		const double lead = positive ? maxes[axis] : mins[axis];
+		const int firstLayer = positive ? static_cast<int>(std::ceil(lead)) :
+			(static_cast<int>(std::ceil(lead)) - 1);
+		const int lastLayer = positive ? (static_cast<int>(std::ceil(lead + move)) - 1) :
+			static_cast<int>(std::floor(lead + move));
+		const int layerStep = positive ? 1 : -1;
+
+		// The other two axes' voxel ranges stay the same while moving on this one.
+		const int axisA = (axis == 0) ? 1 : 0;
+		const int axisB = (axis == 2) ? 1 : 2;
+		int firstA, lastA, firstB, lastB;
+		getCoveredRange(axisA, &firstA, &lastA);
+		getCoveredRange(axisB, &firstB, &lastB);
+
+		double allowedMove = move;
+		bool blocked = false;
+		for (int layer = firstLayer; !blocked && (layer * layerStep) <= (lastLayer * layerStep);
+			layer += layerStep)
+		{
+			for (int a = firstA; !blocked && (a <= lastA); a++)
+			{
+				for (int b = firstB; !blocked && (b <= lastB); b++)
+				{
+					std::array<int, 3> voxel;
+					voxel[axis] = layer;
+					voxel[axisA] = a;
+					voxel[axisB] = b;
+
+					blocked = (this->getFlags(voxel[0], voxel[1], voxel[2]) & blockingFlags) != 0;
+				}
+			}
+
+			if (blocked)
+			{
+				// Stop where the box touches the blocking layer.
+				allowedMove = positive ? (static_cast<double>(layer) - lead) :
+					(static_cast<double>(layer + 1) - lead);
+			}
+		}
+
+		mins[axis] += allowedMove;
+		maxes[axis] += allowedMove;
+		moves[axis] = allowedMove;
+	}
+
+	return Double3(moves[0], moves[1], moves[2]);
+}
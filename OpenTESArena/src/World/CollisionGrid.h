@@ -0,0 +1,50 @@
+#ifndef COLLISION_GRID_H
+#define COLLISION_GRID_H
+
+#include <cstdint>
+#include <vector>
+
+#include "../Math/Vector3.h"
+
+// Collision properties of each voxel in a level, packed as bit flags so movement code can
+// test voxels without looking up their voxel data. The voxel grid keeps it current as
+// voxels are set. Voxels outside the grid have no flags (air).
+
+class VoxelData;
+
+class CollisionGrid
+{
+private:
+	std::vector<uint8_t> flags;
+	int width, height, depth;
+public:
+	// Bit flags for a voxel.
+	static const uint8_t SOLID; // Blocks movement into the voxel.
+	static const uint8_t PLATFORM; // Raised platform that might be low enough to step on.
+	static const uint8_t CHASM;
+	static const uint8_t DOOR;
+
+	CollisionGrid(int width, int height, int depth);
+
+	// Gets the collision flags that voxels with the given voxel data have.
+	static uint8_t makeFlags(const VoxelData &voxelData);
+
+	// Gets the collision flags of a voxel.
+	uint8_t getFlags(int x, int y, int z) const;
+
+	// Sets the collision flags of a voxel inside the grid.
+	void setFlags(int x, int y, int z, uint8_t flags);
+
+	// Moves every voxel's flags by the given X and Z. Flags moved off the grid are dropped,
+	// and the voxels left behind have none.
+	void scroll(int dx, int dz);
+
+	// Moves an axis-aligned box from its min and max corners by the displacement, one axis
+	// at a time (X, Z, then Y), and returns how far it can go before entering a voxel with
+	// any of the blocking flags. Voxels the box already overlaps don't block it, so it can
+	// always move out of them. A box with no size works as a point.
+	Double3 sweepBox(const Double3 &boxMin, const Double3 &boxMax,
+		const Double3 &displacement, uint8_t blockingFlags) const;
+};
+
+#endif
@@ -1,11 +1,16 @@
 #include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <functional>
+#include <cstring>
+#include <mutex>
 #include <sstream>
+#include <type_traits>
+#include <unordered_set>
 
 #include "LevelData.h"
 #include "VoxelData.h"
 #include "VoxelDataType.h"
+#include "../Assets/AssetCache.h"
 #include "../Assets/INFFile.h"
 #include "../Assets/RMDFile.h"
 #include "../Math/Constants.h"
@@ -14,7 +19,116 @@
 #include "../Rendering/Renderer.h"
 #include "../Utilities/Bytes.h"
 #include "../Utilities/Debug.h"
-#include "../Utilities/String.h"
+#include "../Utilities/JobSystem.h"
+#include "../Utilities/LoadProgress.h"
+
+#include "components/vfs/manager.hpp"
+
+namespace
+{
+	// A cached level starts with this. Offsets are from the start of the entry's data, and
+	// strings aren't null-terminated.
+	struct CacheHeader
+	{
+		double ceilingHeight;
+		int32_t width, height, depth;
+		int32_t layout; // VoxelGrid::Layout.
+		int32_t outdoorDungeon;
+		uint32_t voxelDataCount;
+		uint32_t voxelDataOffset; // Array of VoxelData.
+		uint32_t chunkCount; // Chunks that aren't air.
+		uint32_t chunksOffset; // Array of CacheChunkRecord.
+		uint32_t voxelsOffset; // Each chunk's voxel IDs in the grid's layout, one after another.
+		uint32_t lockCount;
+		uint32_t locksOffset; // Array of CacheLockRecord.
+		uint32_t textTriggerCount;
+		uint32_t textTriggersOffset; // Array of CacheTriggerRecord.
+		uint32_t soundTriggerCount;
+		uint32_t soundTriggersOffset; // Array of CacheTriggerRecord.
+		uint32_t nameOffset, nameSize;
+		uint32_t infNameOffset, infNameSize;
+	};
+
+	struct CacheChunkRecord
+	{
+		int32_t chunkX, chunkZ;
+	};
+
+	struct CacheLockRecord
+	{
+		int32_t x, z;
+		int32_t lockLevel;
+	};
+
+	// A text or sound trigger. Sound triggers are never displayed once.
+	struct CacheTriggerRecord
+	{
+		int32_t x, z;
+		uint32_t textOffset, textSize;
+		int32_t displayedOnce;
+	};
+
+	static_assert(sizeof(CacheHeader) == 88, "Unexpected CacheHeader padding.");
+	static_assert(sizeof(CacheChunkRecord) == 8, "Unexpected CacheChunkRecord padding.");
+	static_assert(sizeof(CacheLockRecord) == 12, "Unexpected CacheLockRecord padding.");
+	static_assert(sizeof(CacheTriggerRecord) == 20, "Unexpected CacheTriggerRecord padding.");
+	static_assert(std::is_trivially_copyable<VoxelData>::value,
+		"Voxel data must be trivially copyable for caching.");
+
+	// Each array starts at a multiple of this, which suits every type in the entry.
+	const size_t CacheAlignment = 8;
+
+	// Appends values to the cache data at the next aligned offset and returns the offset.
+	template <typename T>
+	uint32_t AppendCacheArray(std::vector<uint8_t> &data, const T *values, size_t count)
+	{
+		const size_t offset = (data.size() + CacheAlignment - 1) & ~(CacheAlignment - 1);
+		data.resize(offset + (count * sizeof(T)));
+
+		if (count > 0)
+		{
+			std::memcpy(data.data() + offset, values, count * sizeof(T));
+		}
+
+		return static_cast<uint32_t>(offset);
+	}
+
+	uint32_t AppendCacheString(std::vector<uint8_t> &data, const std::string &str)
+	{
+		return AppendCacheArray(data, str.data(), str.size());
+	}
+
+	// Gets an array in the cache data, or null if it isn't all in the data or isn't aligned
+	// for its type.
+	template <typename T>
+	const T *GetCacheArray(const uint8_t *data, size_t size, uint32_t offset, size_t count)
+	{
+		const uint8_t *begin = data + offset;
+		const bool aligned = (reinterpret_cast<uintptr_t>(begin) % alignof(T)) == 0;
+		const bool inside = (offset <= size) && (count <= ((size - offset) / sizeof(T)));
+		return (aligned && inside) ? reinterpret_cast<const T*>(begin) : nullptr;
+	}
+
+	// Warnings about a level's .INF file, each given once per read instead of once for
+	// every voxel it's about. Shared by the workers reading the level.
+	class LevelWarnings
+	{
+	private:
+		std::unordered_set<std::string> messages;
+		std::mutex mutex;
+	public:
+		void warn(const std::string &message)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if (this->messages.insert(message).second)
+			{
+				DebugWarning(message);
+			}
+		}
+	};
+}
+
+const uint32_t LevelData::CACHE_VERSION = 1;
 
 LevelData::Lock::Lock(const Int2 &position, int lockLevel)
 	: position(position)
@@ -60,15 +174,314 @@ void LevelData::TextTrigger::setPreviouslyDisplayed(bool previouslyDisplayed)
 }
 
 LevelData::LevelData(int gridWidth, int gridHeight, int gridDepth)
-	: voxelGrid(gridWidth, gridHeight, gridDepth)
+	: voxelGrid(gridWidth, gridHeight, gridDepth), navigation(gridWidth, gridDepth)
 {
 	// Just for initializing grid dimensions. The rest is initialized by load methods.
 }
 
+uint64_t LevelData::getCityCacheHash(const MIFFile::Level &level, uint32_t citySeed,
+	int cityDim, const std::vector<CityBlock> &cityBlocks, const Int2 &startPosition,
+	const INFFile &inf, int gridWidth, int gridDepth)
+{
+	std::vector<uint8_t> key;
+	auto append = [&key](const void *values, size_t size)
+	{
+		const uint8_t *bytes = static_cast<const uint8_t*>(values);
+		key.insert(key.end(), bytes, bytes + size);
+	};
+
+	// The engine's side: the generator's version, and the size and byte order of what's
+	// stored straight from memory.
+	const uint32_t version = LevelData::CACHE_VERSION;
+	const uint32_t voxelDataSize = sizeof(VoxelData);
+	const uint16_t byteOrder = 1;
+	append(&version, sizeof(version));
+	append(&voxelDataSize, sizeof(voxelDataSize));
+	append(&byteOrder, sizeof(byteOrder));
+	append(&VoxelGrid::CHUNK_SIZE, sizeof(VoxelGrid::CHUNK_SIZE));
+
+	// The generator's inputs.
+	append(&citySeed, sizeof(citySeed));
+	append(&cityDim, sizeof(cityDim));
+	append(&startPosition.x, sizeof(startPosition.x));
+	append(&startPosition.y, sizeof(startPosition.y));
+	append(&gridWidth, sizeof(gridWidth));
+	append(&gridDepth, sizeof(gridDepth));
+
+	// The Arena files the city is built from, so changing them (or switching between the
+	// floppy and CD versions) makes the city be generated again. The .INF decides the voxel
+	// data and trigger text. Their views are usually mapped, so hashing them doesn't parse
+	// anything.
+	auto appendFile = [&append](const std::string &filename)
+	{
+		append(filename.data(), filename.size());
+
+		const VFS::DataView view = VFS::Manager::get().openView(filename);
+		const uint64_t fileHash = view.isOpen() ? AssetCache::hash(view.data(), view.size()) : 0;
+		append(&fileHash, sizeof(fileHash));
+	};
+
+	appendFile(inf.getName());
+	for (const CityBlock &cityBlock : cityBlocks)
+	{
+		append(&cityBlock.planIndex, sizeof(cityBlock.planIndex));
+		appendFile(cityBlock.mifName);
+	}
+
+	const size_t mifVoxelsSize = gridWidth * gridDepth * sizeof(uint16_t);
+	for (const uint16_t *voxels : { level.getFLOR(), level.getMAP1(), level.getMAP2() })
+	{
+		if (voxels != nullptr)
+		{
+			append(voxels, mifVoxelsSize);
+		}
+	}
+
+	return AssetCache::hash(key.data(), key.size());
+}
+
+std::vector<uint8_t> LevelData::writeCache() const
+{
+	DebugAssert(this->interiorSkyColor == nullptr, "Only exteriors can be cached.");
+	DebugAssert(this->wilderness == nullptr, "Wildernesses can't be cached.");
+	DebugAssert(this->journal.isEmpty(), "Levels must be cached as they loaded.");
+
+	const VoxelGrid &voxelGrid = this->voxelGrid;
+	std::vector<uint8_t> data(sizeof(CacheHeader), 0);
+	CacheHeader header;
+	header.ceilingHeight = this->ceilingHeight;
+	header.width = voxelGrid.getWidth();
+	header.height = voxelGrid.getHeight();
+	header.depth = voxelGrid.getDepth();
+	header.layout = static_cast<int32_t>(voxelGrid.getLayout());
+	header.outdoorDungeon = this->outdoorDungeon ? 1 : 0;
+
+	std::vector<VoxelData> voxelDatas;
+	for (int i = 0; i < voxelGrid.getVoxelDataCount(); i++)
+	{
+		voxelDatas.push_back(voxelGrid.getVoxelData(static_cast<uint16_t>(i)));
+	}
+
+	header.voxelDataCount = static_cast<uint32_t>(voxelDatas.size());
+	header.voxelDataOffset = AppendCacheArray(data, voxelDatas.data(), voxelDatas.size());
+
+	std::vector<CacheChunkRecord> chunkRecords;
+	std::vector<uint16_t> chunkVoxels;
+	const int chunkVoxelCount = voxelGrid.getChunkVoxelCount();
+	for (int chunkZ = 0; chunkZ < voxelGrid.getChunkCountZ(); chunkZ++)
+	{
+		for (int chunkX = 0; chunkX < voxelGrid.getChunkCountX(); chunkX++)
+		{
+			const uint16_t *chunk = voxelGrid.getChunk(chunkX, chunkZ);
+			if (chunk != nullptr)
+			{
+				CacheChunkRecord record;
+				record.chunkX = chunkX;
+				record.chunkZ = chunkZ;
+				chunkRecords.push_back(record);
+				chunkVoxels.insert(chunkVoxels.end(), chunk, chunk + chunkVoxelCount);
+			}
+		}
+	}
+
+	header.chunkCount = static_cast<uint32_t>(chunkRecords.size());
+	header.chunksOffset = AppendCacheArray(data, chunkRecords.data(), chunkRecords.size());
+	header.voxelsOffset = AppendCacheArray(data, chunkVoxels.data(), chunkVoxels.size());
+
+	std::vector<CacheLockRecord> lockRecords;
+	for (const auto &pair : this->locks)
+	{
+		CacheLockRecord record;
+		record.x = pair.first.x;
+		record.z = pair.first.y;
+		record.lockLevel = pair.second.getLockLevel();
+		lockRecords.push_back(record);
+	}
+
+	header.lockCount = static_cast<uint32_t>(lockRecords.size());
+	header.locksOffset = AppendCacheArray(data, lockRecords.data(), lockRecords.size());
+
+	// Trigger strings go after the records, so the records are made first.
+	auto makeTriggerRecord = [](const Int2 &voxel, bool displayedOnce)
+	{
+		CacheTriggerRecord record;
+		record.x = voxel.x;
+		record.z = voxel.y;
+		record.textOffset = 0;
+		record.textSize = 0;
+		record.displayedOnce = displayedOnce ? 1 : 0;
+		return record;
+	};
+
+	std::vector<CacheTriggerRecord> textRecords, soundRecords;
+	std::vector<const std::string*> textStrings, soundStrings;
+	for (const auto &pair : this->textTriggers)
+	{
+		textRecords.push_back(makeTriggerRecord(pair.first, pair.second.isSingleDisplay()));
+		textStrings.push_back(&pair.second.getText());
+	}
+
+	for (const auto &pair : this->soundTriggers)
+	{
+		soundRecords.push_back(makeTriggerRecord(pair.first, false));
+		soundStrings.push_back(&pair.second);
+	}
+
+	header.textTriggerCount = static_cast<uint32_t>(textRecords.size());
+	header.textTriggersOffset = AppendCacheArray(data, textRecords.data(), textRecords.size());
+	header.soundTriggerCount = static_cast<uint32_t>(soundRecords.size());
+	header.soundTriggersOffset = AppendCacheArray(
+		data, soundRecords.data(), soundRecords.size());
+
+	auto appendTriggerStrings = [&data](uint32_t recordsOffset,
+		const std::vector<const std::string*> &strings)
+	{
+		for (size_t i = 0; i < strings.size(); i++)
+		{
+			const uint32_t textOffset = AppendCacheString(data, *strings[i]);
+			CacheTriggerRecord *record = reinterpret_cast<CacheTriggerRecord*>(
+				data.data() + recordsOffset) + i;
+			record->textOffset = textOffset;
+			record->textSize = static_cast<uint32_t>(strings[i]->size());
+		}
+	};
+
+	appendTriggerStrings(header.textTriggersOffset, textStrings);
+	appendTriggerStrings(header.soundTriggersOffset, soundStrings);
+
+	header.nameOffset = AppendCacheString(data, this->name);
+	header.nameSize = static_cast<uint32_t>(this->name.size());
+	header.infNameOffset = AppendCacheString(data, this->infName);
+	header.infNameSize = static_cast<uint32_t>(this->infName.size());
+
+	std::memcpy(data.data(), &header, sizeof(header));
+	return data;
+}
+
+bool LevelData::readCache(const uint8_t *data, size_t size)
+{
+	if (size < sizeof(CacheHeader))
+	{
+		return false;
+	}
+
+	CacheHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	VoxelGrid &voxelGrid = this->voxelGrid;
+	const int chunkCount = voxelGrid.getChunkCountX() * voxelGrid.getChunkCountZ();
+	if ((header.width != voxelGrid.getWidth()) || (header.height != voxelGrid.getHeight()) ||
+		(header.depth != voxelGrid.getDepth()) ||
+		(header.layout != static_cast<int32_t>(voxelGrid.getLayout())) ||
+		(header.chunkCount > static_cast<uint32_t>(chunkCount)))
+	{
+		return false;
+	}
+
+	const int chunkVoxelCount = voxelGrid.getChunkVoxelCount();
+	const VoxelData *voxelDatas = GetCacheArray<VoxelData>(
+		data, size, header.voxelDataOffset, header.voxelDataCount);
+	const CacheChunkRecord *chunkRecords = GetCacheArray<CacheChunkRecord>(
+		data, size, header.chunksOffset, header.chunkCount);
+	const uint16_t *chunkVoxels = GetCacheArray<uint16_t>(
+		data, size, header.voxelsOffset, header.chunkCount * chunkVoxelCount);
+	const CacheLockRecord *lockRecords = GetCacheArray<CacheLockRecord>(
+		data, size, header.locksOffset, header.lockCount);
+	const CacheTriggerRecord *textRecords = GetCacheArray<CacheTriggerRecord>(
+		data, size, header.textTriggersOffset, header.textTriggerCount);
+	const CacheTriggerRecord *soundRecords = GetCacheArray<CacheTriggerRecord>(
+		data, size, header.soundTriggersOffset, header.soundTriggerCount);
+	const char *nameChars = GetCacheArray<char>(
+		data, size, header.nameOffset, header.nameSize);
+	const char *infNameChars = GetCacheArray<char>(
+		data, size, header.infNameOffset, header.infNameSize);
+
+	if ((voxelDatas == nullptr) || (chunkRecords == nullptr) || (chunkVoxels == nullptr) ||
+		(lockRecords == nullptr) || (textRecords == nullptr) || (soundRecords == nullptr) ||
+		(nameChars == nullptr) || (infNameChars == nullptr) || (header.voxelDataCount == 0))
+	{
+		return false;
+	}
+
+	// The definitions were all different when written, so they keep their IDs.
+	for (uint32_t i = 0; i < header.voxelDataCount; i++)
+	{
+		if (voxelGrid.addVoxelData(voxelDatas[i]) != i)
+		{
+			return false;
+		}
+	}
+
+	const uint16_t *voxelsEnd = chunkVoxels + (header.chunkCount * chunkVoxelCount);
+	if (std::any_of(chunkVoxels, voxelsEnd,
+		[&header](uint16_t id) { return id >= header.voxelDataCount; }))
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < header.chunkCount; i++)
+	{
+		const CacheChunkRecord &record = chunkRecords[i];
+		if ((record.chunkX < 0) || (record.chunkX >= voxelGrid.getChunkCountX()) ||
+			(record.chunkZ < 0) || (record.chunkZ >= voxelGrid.getChunkCountZ()))
+		{
+			return false;
+		}
+
+		voxelGrid.setChunk(record.chunkX, record.chunkZ, chunkVoxels + (i * chunkVoxelCount));
+	}
+
+	for (uint32_t i = 0; i < header.lockCount; i++)
+	{
+		const CacheLockRecord &record = lockRecords[i];
+		const Int2 lockPosition(record.x, record.z);
+		this->locks.insert(std::make_pair(
+			lockPosition, LevelData::Lock(lockPosition, record.lockLevel)));
+	}
+
+	// Gets a trigger's string, or null if it isn't in the data.
+	auto getTriggerText = [data, size](const CacheTriggerRecord &record)
+	{
+		return GetCacheArray<char>(data, size, record.textOffset, record.textSize);
+	};
+
+	for (uint32_t i = 0; i < header.textTriggerCount; i++)
+	{
+		const CacheTriggerRecord &record = textRecords[i];
+		const char *text = getTriggerText(record);
+		if (text == nullptr)
+		{
+			return false;
+		}
+
+		this->textTriggers.insert(std::make_pair(Int2(record.x, record.z),
+			TextTrigger(std::string(text, record.textSize), record.displayedOnce != 0)));
+	}
+
+	for (uint32_t i = 0; i < header.soundTriggerCount; i++)
+	{
+		const CacheTriggerRecord &record = soundRecords[i];
+		const char *text = getTriggerText(record);
+		if (text == nullptr)
+		{
+			return false;
+		}
+
+		this->soundTriggers.insert(std::make_pair(Int2(record.x, record.z),
+			std::string(text, record.textSize)));
+	}
+
+	this->name = std::string(nameChars, header.nameSize);
+	this->infName = std::string(infNameChars, header.infNameSize);
+	this->ceilingHeight = header.ceilingHeight;
+	this->outdoorDungeon = header.outdoorDungeon != 0;
+	return true;
+}
+
 LevelData LevelData::loadInterior(const MIFFile::Level &level, int gridWidth, int gridDepth)
 {
 	// .INF file associated with the interior level.
-	const INFFile inf(String::toUppercase(level.info));
+	const INFFile &inf = INFFile::get(level.info);
 
 	// Interior level.
 	LevelData levelData(gridWidth, level.getHeight(), gridDepth);
@@ -85,8 +498,10 @@ LevelData LevelData::loadInterior(const MIFFile::Level &level, int gridWidth, in
 	const int emptyID = levelData.voxelGrid.addVoxelData(VoxelData());
 
 	// Load FLOR and MAP1 voxels.
-	levelData.readFLOR(level.flor.data(), inf, gridWidth, gridDepth);
-	levelData.readMAP1(level.map1.data(), inf, gridWidth, gridDepth);
+	levelData.readFLOR(level.getFLOR(), inf, gridWidth, gridDepth, nullptr);
+	levelData.readMAP1(level.getMAP1(), inf, gridWidth, gridDepth, nullptr);
+	levelData.readStaticLights(LevelData::getArrayVoxels(level.getMAP1(), gridDepth), inf,
+		gridWidth, gridDepth);
 
 	// All interiors have ceilings except some main quest dungeons which have a 1
 	// as the third number after *CEILING in their .INF file.
@@ -112,42 +527,19 @@ LevelData LevelData::loadDungeon(ArenaRandom &random, const std::vector<MIFFile:
 	int levelUpBlock, const int *levelDownBlock, int widthChunks, int depthChunks,
 	const INFFile &inf, int gridWidth, int gridDepth)
 {
-	// Create temp buffers for dungeon voxel data.
-	std::vector<uint16_t> tempFlor(gridWidth * gridDepth, 0);
-	std::vector<uint16_t> tempMap1(gridWidth * gridDepth, 0);
-
+	// Pick the level for each chunk from the .MIF file. Their voxels are read in place
+	// rather than copied into one array.
 	const int chunkDim = 32;
 	const int tileSet = random.next() % 4;
+	std::vector<const MIFFile::Level*> chunkLevels(widthChunks * depthChunks);
 
 	for (int row = 0; row < depthChunks; row++)
 	{
-		const int dZ = row * chunkDim;
 		for (int column = 0; column < widthChunks; column++)
 		{
-			const int dX = column * chunkDim;
-
 			// Get the selected level from the .MIF file.
 			const int blockIndex = (tileSet * 8) + (random.next() % 8);
-			const auto &blockLevel = levels.at(blockIndex);
-
-			// Copy block data to temp buffers.
-			for (int z = 0; z < chunkDim; z++)
-			{
-				const int srcIndex = z * chunkDim;
-				const int dstIndex = dX + ((z + dZ) * gridDepth);
-
-				auto writeRow = [chunkDim, srcIndex, dstIndex](
-					const std::vector<uint16_t> &src, std::vector<uint16_t> &dst)
-				{
-					const auto srcBegin = src.begin() + srcIndex;
-					const auto srcEnd = srcBegin + chunkDim;
-					const auto dstBegin = dst.begin() + dstIndex;
-					std::copy(srcBegin, srcEnd, dstBegin);
-				};
-
-				writeRow(blockLevel.flor, tempFlor);
-				writeRow(blockLevel.map1, tempMap1);
-			}
+			chunkLevels[column + (row * widthChunks)] = &levels.at(blockIndex);
 
 			// To do: Assign locks?
 
@@ -155,32 +547,58 @@ LevelData LevelData::loadDungeon(ArenaRandom &random, const std::vector<MIFFile:
 		}
 	}
 
-	// Draw perimeter blocks. First top and bottom, then right and left.
-	const uint16_t perimeterVoxel = 0x7800;
-	std::fill(tempMap1.begin(), tempMap1.begin() + gridDepth, perimeterVoxel);
-	std::fill(tempMap1.rbegin(), tempMap1.rbegin() + gridDepth, perimeterVoxel);
-
-	for (int z = 1; z < (gridWidth - 1); z++)
+	// Lambda for obtaining a voxel from whichever chunk covers it.
+	auto getChunkVoxel = [&chunkLevels, widthChunks, chunkDim](
+		const uint16_t *(MIFFile::Level::*getVoxels)() const, int mifX, int mifZ)
 	{
-		tempMap1.at(z * gridDepth) = perimeterVoxel;
-		tempMap1.at((z * gridDepth) + (gridDepth - 1)) = perimeterVoxel;
-	}
+		const int column = mifX / chunkDim;
+		const int row = mifZ / chunkDim;
+		const MIFFile::Level &chunkLevel = *chunkLevels[column + (row * widthChunks)];
+		const uint16_t *voxel = (chunkLevel.*getVoxels)() + (mifX - (column * chunkDim)) +
+			((mifZ - (row * chunkDim)) * chunkDim);
+		return Bytes::getLE16(reinterpret_cast<const uint8_t*>(voxel));
+	};
 
-	// Put transition blocks, unless null. Unpack the level up/down block indices
-	// into X and Z chunk offsets.
+	// Perimeter blocks go around the edges. Transition blocks go in their chunks, unless
+	// null. Unpack the level up/down block indices into X and Z chunk offsets.
+	const uint16_t perimeterVoxel = 0x7800;
 	const uint8_t levelUpVoxelByte = *inf.getLevelUpIndex() + 1;
 	const int levelUpX = 10 + ((levelUpBlock % 10) * chunkDim);
 	const int levelUpZ = 10 + ((levelUpBlock / 10) * chunkDim);
-	tempMap1.at(levelUpX + (levelUpZ * gridDepth)) = (levelUpVoxelByte << 8) | levelUpVoxelByte;
+	const uint16_t levelUpVoxel = (levelUpVoxelByte << 8) | levelUpVoxelByte;
+
+	const bool hasLevelDown = levelDownBlock != nullptr;
+	const uint8_t levelDownVoxelByte = hasLevelDown ? (*inf.getLevelDownIndex() + 1) : 0;
+	const int levelDownX = hasLevelDown ? (10 + ((*levelDownBlock % 10) * chunkDim)) : -1;
+	const int levelDownZ = hasLevelDown ? (10 + ((*levelDownBlock / 10) * chunkDim)) : -1;
+	const uint16_t levelDownVoxel = (levelDownVoxelByte << 8) | levelDownVoxelByte;
 
-	if (levelDownBlock != nullptr)
+	auto getFlor = [&getChunkVoxel](int mifX, int mifZ)
 	{
-		const uint8_t levelDownVoxelByte = *inf.getLevelDownIndex() + 1;
-		const int levelDownX = 10 + ((*levelDownBlock % 10) * chunkDim);
-		const int levelDownZ = 10 + ((*levelDownBlock / 10) * chunkDim);
-		tempMap1.at(levelDownX + (levelDownZ * gridDepth)) =
-			(levelDownVoxelByte << 8) | levelDownVoxelByte;
-	}
+		return getChunkVoxel(&MIFFile::Level::getFLOR, mifX, mifZ);
+	};
+
+	auto getMap1 = [&getChunkVoxel, gridWidth, gridDepth, perimeterVoxel, levelUpX, levelUpZ,
+		levelUpVoxel, levelDownX, levelDownZ, levelDownVoxel](int mifX, int mifZ)
+	{
+		if ((mifX == levelDownX) && (mifZ == levelDownZ))
+		{
+			return levelDownVoxel;
+		}
+		else if ((mifX == levelUpX) && (mifZ == levelUpZ))
+		{
+			return levelUpVoxel;
+		}
+		else if ((mifX == 0) || (mifX == (gridDepth - 1)) || (mifZ == 0) ||
+			(mifZ == (gridWidth - 1)))
+		{
+			return perimeterVoxel;
+		}
+		else
+		{
+			return getChunkVoxel(&MIFFile::Level::getMAP1, mifX, mifZ);
+		}
+	};
 
 	// Dungeon (either named or in wilderness).
 	LevelData levelData(gridWidth, 3, gridDepth);
@@ -195,8 +613,9 @@ LevelData LevelData::loadDungeon(ArenaRandom &random, const std::vector<MIFFile:
 	const int emptyID = levelData.voxelGrid.addVoxelData(VoxelData());
 
 	// Load FLOR, MAP1, and ceiling into the voxel grid.
-	levelData.readFLOR(tempFlor.data(), inf, gridWidth, gridDepth);
-	levelData.readMAP1(tempMap1.data(), inf, gridWidth, gridDepth);
+	levelData.readFLOR(getFlor, inf, gridWidth, gridDepth, nullptr);
+	levelData.readMAP1(getMap1, inf, gridWidth, gridDepth, nullptr);
+	levelData.readStaticLights(getMap1, inf, gridWidth, gridDepth);
 	levelData.readCeiling(inf, gridWidth, gridDepth);
 
 	return levelData;
@@ -216,23 +635,57 @@ LevelData LevelData::loadPremadeCity(const MIFFile::Level &level, const INFFile
 	const int emptyID = levelData.voxelGrid.addVoxelData(VoxelData());
 
 	// Load FLOR, MAP1, and MAP2 voxels. No locks or triggers.
-	levelData.readFLOR(level.flor.data(), inf, gridWidth, gridDepth);
-	levelData.readMAP1(level.map1.data(), inf, gridWidth, gridDepth);
-	levelData.readMAP2(level.map2.data(), inf, gridWidth, gridDepth);
+	levelData.readFLOR(level.getFLOR(), inf, gridWidth, gridDepth, nullptr);
+	levelData.readMAP1(level.getMAP1(), inf, gridWidth, gridDepth, nullptr);
+	levelData.readMAP2(level.getMAP2(), gridWidth, gridDepth, nullptr);
 
 	return levelData;
 }
 
 LevelData LevelData::loadCity(const MIFFile::Level &level, uint32_t citySeed, int cityDim,
 	const std::vector<uint8_t> &reservedBlocks, const Int2 &startPosition,
-	const INFFile &inf, int gridWidth, int gridDepth)
+	const INFFile &inf, int gridWidth, int gridDepth, const AssetCache &assetCache,
+	JobSystem &jobSystem, LoadProgress &progress)
 {
-	// Create temp voxel data buffers and write the city skeleton data to them. Each city
-	// block will be written to them as well.
-	std::vector<uint16_t> tempFlor(level.flor.begin(), level.flor.end());
-	std::vector<uint16_t> tempMap1(level.map1.begin(), level.map1.end());
-	std::vector<uint16_t> tempMap2(level.map2.begin(), level.map2.end());
+	// Entries are named by the seed and .INF (which changes with the weather), and the
+	// hash covers the rest, so a city's weathers are cached side by side.
+	std::stringstream cacheName;
+	cacheName << "city_" << std::hex << citySeed << '_' << inf.getName();
+	const std::vector<CityBlock> cityBlocks = LevelData::planCity(
+		citySeed, cityDim, reservedBlocks);
+	const uint64_t cacheHash = LevelData::getCityCacheHash(level, citySeed, cityDim,
+		cityBlocks, startPosition, inf, gridWidth, gridDepth);
+
+	const VFS::DataView cachedView = assetCache.read(cacheName.str(), cacheHash);
+	if (cachedView.isOpen())
+	{
+		progress.beginStage("Reading cached city");
+		LevelData levelData(gridWidth, level.getHeight(), gridDepth);
+		if (levelData.readCache(cachedView.data(), cachedView.size()))
+		{
+			progress.setStagePercent(1.0);
+			return levelData;
+		}
+
+		DebugWarning("Cached \"" + cacheName.str() + "\" is malformed.");
+	}
+
+	LevelData levelData = LevelData::generateCity(level, cityBlocks, cityDim, startPosition,
+		inf, gridWidth, gridDepth, jobSystem, progress);
+
+	// A cancelled city is left empty, so it isn't cached.
+	if (assetCache.isEnabled() && !progress.isCancelled())
+	{
+		const std::vector<uint8_t> cacheData = levelData.writeCache();
+		assetCache.write(cacheName.str(), cacheHash, cacheData.data(), cacheData.size());
+	}
 
+	return levelData;
+}
+
+std::vector<LevelData::CityBlock> LevelData::planCity(uint32_t citySeed, int cityDim,
+	const std::vector<uint8_t> &reservedBlocks)
+{
 	// Decide which city blocks to load.
 	enum class BlockType
 	{
@@ -309,7 +762,9 @@ LevelData LevelData::loadCity(const MIFFile::Level &level, uint32_t citySeed, in
 		placeBlock(blockType);
 	}
 
-	// Build the city, loading data for each block. Load blocks right to left, top to bottom.
+	// Pick the .MIF file for each block. Load blocks right to left, top to bottom. This is
+	// done in order so the random numbers are drawn the same way as the original engine.
+	std::vector<CityBlock> cityBlocks;
 	int xDim = 0;
 	int yDim = 0;
 
@@ -337,38 +792,11 @@ LevelData LevelData::loadCity(const MIFFile::Level &level, uint32_t citySeed, in
 			const std::string &rotation = Rotations.at(random.next() % Rotations.size());
 			const int variationCount = VariationCounts.at(blockIndex);
 			const int variation = std::max(random.next() % variationCount, 1);
-			const std::string blockMifName = blockCode + "BD" +
-				std::to_string(variation) + rotation + ".MIF";
-
-			// Load the block's .MIF data into the level.
-			const MIFFile blockMif(blockMifName);
-			const auto &blockLevel = blockMif.getLevels().front();
-
-			// Offset of the block in the voxel grid.
-			const int xOffset = startPosition.x + (xDim * 20);
-			const int zOffset = startPosition.y + (yDim * 20);
-
-			// Copy block data to temp buffers.
-			for (int z = 0; z < blockMif.getDepth(); z++)
-			{
-				const int srcIndex = z * blockMif.getWidth();
-				const int dstIndex = xOffset + ((z + zOffset) * gridDepth);
 
-				auto writeRow = [&blockMif, srcIndex, dstIndex](
-					const std::vector<uint16_t> &src, std::vector<uint16_t> &dst)
-				{
-					const auto srcBegin = src.begin() + srcIndex;
-					const auto srcEnd = srcBegin + blockMif.getWidth();
-					const auto dstBegin = dst.begin() + dstIndex;
-					std::copy(srcBegin, srcEnd, dstBegin);
-				};
-
-				writeRow(blockLevel.flor, tempFlor);
-				writeRow(blockLevel.map1, tempMap1);
-				writeRow(blockLevel.map2, tempMap2);
-			}
-
-			// To do: load flats.
+			CityBlock cityBlock;
+			cityBlock.mifName = blockCode + "BD" + std::to_string(variation) + rotation + ".MIF";
+			cityBlock.planIndex = xDim + (yDim * cityDim);
+			cityBlocks.push_back(std::move(cityBlock));
 		}
 
 		xDim++;
@@ -381,6 +809,85 @@ LevelData LevelData::loadCity(const MIFFile::Level &level, uint32_t citySeed, in
 		}
 	}
 
+	return cityBlocks;
+}
+
+LevelData LevelData::generateCity(const MIFFile::Level &level,
+	const std::vector<CityBlock> &cityBlocks, int cityDim, const Int2 &startPosition,
+	const INFFile &inf, int gridWidth, int gridDepth, JobSystem &jobSystem,
+	LoadProgress &progress)
+{
+	const int citySize = cityDim * cityDim;
+	const int blockDim = 20;
+
+	// Get each block's .MIF file, in parallel since most are parsed for the first time here.
+	// Their voxels are read in place over the city skeleton rather than copied into it.
+	progress.beginStage("Building city blocks");
+	const int cityBlockCount = static_cast<int>(cityBlocks.size());
+	std::vector<const MIFFile*> planMifs(citySize, nullptr);
+	std::atomic<int> loadedBlockCount(0);
+
+	jobSystem.parallelFor(cityBlockCount, [&cityBlocks, cityBlockCount, &planMifs,
+		&loadedBlockCount, &progress](int index)
+	{
+		if (progress.isCancelled())
+		{
+			return;
+		}
+
+		const CityBlock &cityBlock = cityBlocks[index];
+		planMifs[cityBlock.planIndex] = &MIFFile::get(cityBlock.mifName);
+
+		// To do: load flats.
+
+		const int loadedCount = ++loadedBlockCount;
+		progress.setStagePercent(static_cast<double>(loadedCount) /
+			static_cast<double>(cityBlockCount));
+	});
+
+	// Lambda for obtaining a voxel from the block covering it, or from the skeleton if
+	// there isn't one.
+	auto getCityVoxel = [&level, &planMifs, &startPosition, cityDim, blockDim, gridDepth](
+		const uint16_t *(MIFFile::Level::*getVoxels)() const, int mifX, int mifZ)
+	{
+		const int cityX = mifX - startPosition.x;
+		const int cityZ = mifZ - startPosition.y;
+		const int cityEnd = cityDim * blockDim;
+		if ((cityX >= 0) && (cityX < cityEnd) && (cityZ >= 0) && (cityZ < cityEnd))
+		{
+			const int planIndex = (cityX / blockDim) + ((cityZ / blockDim) * cityDim);
+			const MIFFile *blockMif = planMifs[planIndex];
+			const int blockX = cityX % blockDim;
+			const int blockZ = cityZ % blockDim;
+			if ((blockMif != nullptr) && (blockX < blockMif->getWidth()) &&
+				(blockZ < blockMif->getDepth()))
+			{
+				const MIFFile::Level &blockLevel = blockMif->getLevels().front();
+				const uint16_t *voxel = (blockLevel.*getVoxels)() + blockX +
+					(blockZ * blockMif->getWidth());
+				return Bytes::getLE16(reinterpret_cast<const uint8_t*>(voxel));
+			}
+		}
+
+		const uint16_t *voxel = (level.*getVoxels)() + mifX + (mifZ * gridDepth);
+		return Bytes::getLE16(reinterpret_cast<const uint8_t*>(voxel));
+	};
+
+	auto getFlor = [&getCityVoxel](int mifX, int mifZ)
+	{
+		return getCityVoxel(&MIFFile::Level::getFLOR, mifX, mifZ);
+	};
+
+	auto getMap1 = [&getCityVoxel](int mifX, int mifZ)
+	{
+		return getCityVoxel(&MIFFile::Level::getMAP1, mifX, mifZ);
+	};
+
+	auto getMap2 = [&getCityVoxel](int mifX, int mifZ)
+	{
+		return getCityVoxel(&MIFFile::Level::getMAP2, mifX, mifZ);
+	};
+
 	// Create the level for the voxel data to be written into.
 	LevelData levelData(gridWidth, level.getHeight(), gridDepth);
 	levelData.name = level.name;
@@ -392,68 +899,32 @@ LevelData LevelData::loadCity(const MIFFile::Level &level, uint32_t citySeed, in
 	const int emptyID = levelData.voxelGrid.addVoxelData(VoxelData());
 
 	// Load FLOR, MAP1, and MAP2 voxels into the voxel grid.
-	levelData.readFLOR(tempFlor.data(), inf, gridWidth, gridDepth);
-	levelData.readMAP1(tempMap1.data(), inf, gridWidth, gridDepth);
-	levelData.readMAP2(tempMap2.data(), inf, gridWidth, gridDepth);
+	progress.beginStage("Placing voxels");
+	if (progress.isCancelled())
+	{
+		return levelData;
+	}
+
+	levelData.readFLOR(getFlor, inf, gridWidth, gridDepth, &jobSystem);
+	progress.setStagePercent(1.0 / 3.0);
+	levelData.readMAP1(getMap1, inf, gridWidth, gridDepth, &jobSystem);
+	progress.setStagePercent(2.0 / 3.0);
+	levelData.readMAP2(getMap2, gridWidth, gridDepth, &jobSystem);
+	progress.setStagePercent(1.0);
 
 	return levelData;
 }
 
 LevelData LevelData::loadWilderness(int rmdTR, int rmdTL, int rmdBR, int rmdBL, const INFFile &inf)
 {
-	// Load WILD.MIF (blank slate, to be filled in by four .RMD files).
-	const MIFFile mif("WILD.MIF");
+	// WILD.MIF is only a blank slate for the .RMD blocks, so just its name and height are
+	// used. The first window has the four given blocks at its bottom left, which puts the
+	// point where they meet in the middle of the grid.
+	const MIFFile &mif = MIFFile::get("WILD.MIF");
 	const MIFFile::Level &level = mif.getLevels().front();
-	const int gridWidth = 128;
+	const int gridWidth = WildernessWindow::GRID_SIZE;
 	const int gridDepth = gridWidth;
 
-	// Copy voxel data into temp buffers. Each floor in the four 64x64 wilderness blocks
-	// is 8192 bytes.
-	std::array<uint16_t, 4096 * 4> tempFlor, tempMap1, tempMap2;
-	std::copy(level.flor.begin(), level.flor.end(), tempFlor.begin());
-	std::copy(level.map1.begin(), level.map1.end(), tempMap1.begin());
-	std::copy(level.map2.begin(), level.map2.end(), tempMap2.begin());
-
-	auto writeRMD = [gridDepth, &tempFlor, &tempMap1, &tempMap2](
-		int rmdID, int xOffset, int zOffset)
-	{
-		const std::string rmdName = [rmdID]()
-		{
-			std::stringstream ss;
-			ss << std::setw(3) << std::setfill('0') << rmdID;
-			return "WILD" + ss.str() + ".RMD";
-		}();
-
-		const RMDFile rmd(rmdName);
-
-		// Copy .RMD voxel data to temp buffers.
-		for (int z = 0; z < RMDFile::DEPTH; z++)
-		{
-			const int srcIndex = z * RMDFile::WIDTH;
-			const int dstIndex = xOffset + ((z + zOffset) * gridDepth);
-
-			auto writeRow = [srcIndex, dstIndex](const RMDFile::ArrayType &src,
-				std::array<uint16_t, 4096 * 4> &dst)
-			{
-				const auto srcBegin = src.begin() + srcIndex;
-				const auto srcEnd = srcBegin + RMDFile::WIDTH;
-				const auto dstBegin = dst.begin() + dstIndex;
-				std::copy(srcBegin, srcEnd, dstBegin);
-			};
-
-			writeRow(rmd.getFLOR(), tempFlor);
-			writeRow(rmd.getMAP1(), tempMap1);
-			writeRow(rmd.getMAP2(), tempMap2);
-		}
-	};
-
-	// Load four .RMD files into the wilderness skeleton, each at some X and Z offset in
-	// the voxel grid.
-	writeRMD(rmdTR, 0, 0); // Top right.
-	writeRMD(rmdTL, RMDFile::WIDTH, 0); // Top left.
-	writeRMD(rmdBR, 0, RMDFile::DEPTH); // Bottom right.
-	writeRMD(rmdBL, RMDFile::WIDTH, RMDFile::DEPTH); // Bottom left.
-
 	// Create the level for the voxel data to be written into.
 	LevelData levelData(gridWidth, level.getHeight(), gridDepth);
 	levelData.name = level.name;
@@ -464,10 +935,24 @@ LevelData LevelData::loadWilderness(int rmdTR, int rmdTL, int rmdBR, int rmdBL,
 	// Empty voxel data (for air).
 	const int emptyID = levelData.voxelGrid.addVoxelData(VoxelData());
 
-	// Load FLOR, MAP1, and MAP2 voxels into the voxel grid.
-	levelData.readFLOR(tempFlor.data(), inf, gridWidth, gridDepth);
-	levelData.readMAP1(tempMap1.data(), inf, gridWidth, gridDepth);
-	levelData.readMAP2(tempMap2.data(), inf, gridWidth, gridDepth);
+	const std::array<int, 4> rmdIDs = { rmdTR, rmdTL, rmdBR, rmdBL };
+	levelData.wilderness = std::make_unique<WildernessWindow>(rmdIDs, Int2(-1, -1));
+
+	// Load every block in the window, then FLOR, MAP1, and MAP2 voxels into the voxel grid.
+	const Int2 &origin = levelData.wilderness->getOrigin();
+	for (int z = 0; z < WildernessWindow::BLOCKS; z++)
+	{
+		for (int x = 0; x < WildernessWindow::BLOCKS; x++)
+		{
+			const Int2 block(origin.x + x, origin.y + z);
+			const int rmdID = levelData.wilderness->getRmdID(block);
+			levelData.wilderness->writeBlock(block, *RMDFile::get(rmdID));
+		}
+	}
+
+	levelData.readFLOR(levelData.wilderness->getFLOR(), inf, gridWidth, gridDepth, nullptr);
+	levelData.readMAP1(levelData.wilderness->getMAP1(), inf, gridWidth, gridDepth, nullptr);
+	levelData.readMAP2(levelData.wilderness->getMAP2(), gridWidth, gridDepth, nullptr);
 	// To do: load FLAT from WILD.MIF level data. levelData.readFLAT(level.flat, ...)?
 
 	return levelData;
@@ -499,606 +984,885 @@ uint32_t LevelData::getInteriorSkyColor() const
 	return *this->interiorSkyColor.get();
 }
 
-VoxelGrid &LevelData::getVoxelGrid()
+bool LevelData::Journal::isEmpty() const
 {
-	return this->voxelGrid;
+	return this->voxels.empty() && this->displayedTextTriggers.empty();
 }
 
-const VoxelGrid &LevelData::getVoxelGrid() const
+const LevelData::Journal &LevelData::getJournal() const
+{
+	return this->journal;
+}
+
+VoxelGrid &LevelData::getVoxelGrid()
 {
 	return this->voxelGrid;
 }
 
-const LevelData::Lock *LevelData::getLock(const Int2 &voxel) const
+AutomapImage &LevelData::getAutomap()
 {
-	const auto lockIter = this->locks.find(voxel);
-	return (lockIter != this->locks.end()) ? (&lockIter->second) : nullptr;
+	return this->automap;
 }
 
-LevelData::TextTrigger *LevelData::getTextTrigger(const Int2 &voxel)
+ActiveDoors &LevelData::getActiveDoors()
 {
-	const auto textIter = this->textTriggers.find(voxel);
-	return (textIter != this->textTriggers.end()) ? (&textIter->second) : nullptr;
+	return this->activeDoors;
 }
 
-const std::string *LevelData::getSoundTrigger(const Int2 &voxel) const
+const ActiveDoors &LevelData::getActiveDoors() const
+{
+	return this->activeDoors;
+}
+
+NavigationGrid &LevelData::getNavigation()
+{
+	return this->navigation;
+}
+
+const NavigationGrid &LevelData::getNavigation() const
+{
+	return this->navigation;
+}
+
+const VoxelGrid &LevelData::getVoxelGrid() const
+{
+	return this->voxelGrid;
+}
+
+const std::vector<LightMap::Light> &LevelData::getStaticLights() const
+{
+	return this->staticLights;
+}
+
+const std::shared_ptr<const LightMap> &LevelData::getLightMap() const
+{
+	return this->lightMap;
+}
+
+void LevelData::setLightMap(const std::shared_ptr<const LightMap> &lightMap)
+{
+	this->lightMap = lightMap;
+}
+
+const std::shared_ptr<const PotentiallyVisibleSet> &LevelData::getVisibleSet() const
+{
+	return this->visibleSet;
+}
+
+void LevelData::setVisibleSet(const std::shared_ptr<const PotentiallyVisibleSet> &visibleSet)
+{
+	this->visibleSet = visibleSet;
+}
+
+const LevelData::Lock *LevelData::getLock(const Int2 &voxel) const
+{
+	const auto lockIter = this->locks.find(voxel);
+	return (lockIter != this->locks.end()) ? (&lockIter->second) : nullptr;
+}
+
+LevelData::TextTrigger *LevelData::getTextTrigger(const Int2 &voxel)
+{
+	const auto textIter = this->textTriggers.find(voxel);
+	return (textIter != this->textTriggers.end()) ? (&textIter->second) : nullptr;
+}
+
+const std::string *LevelData::getSoundTrigger(const Int2 &voxel) const
 {
 	const auto soundIter = this->soundTriggers.find(voxel);
 	return (soundIter != this->soundTriggers.end()) ? (&soundIter->second) : nullptr;
 }
 
-void LevelData::setVoxel(int x, int y, int z, uint16_t id)
+const std::unordered_map<Int2, std::string> &LevelData::getSoundTriggers() const
+{
+	return this->soundTriggers;
+}
+
+void LevelData::changeVoxel(int x, int y, int z, uint16_t id)
 {
-	uint16_t *voxels = this->voxelGrid.getVoxels();
-	const int index = x + (y * this->voxelGrid.getWidth()) +
+	const uint16_t currentID = this->voxelGrid.getVoxel(x, y, z);
+	if (currentID == id)
+	{
+		return;
+	}
+
+	// A voxel changed more than once keeps its first entry, so the journal never grows
+	// past the number of voxels that were touched.
+	const int voxelIndex = x + (y * this->voxelGrid.getWidth()) +
 		(z * this->voxelGrid.getWidth() * this->voxelGrid.getHeight());
+	const auto indexIter = this->journalVoxelIndices.find(voxelIndex);
+	if (indexIter != this->journalVoxelIndices.end())
+	{
+		this->journal.voxels[indexIter->second].id = id;
+	}
+	else
+	{
+		Journal::VoxelChange change;
+		change.x = x;
+		change.y = y;
+		change.z = z;
+		change.id = id;
+		change.originalID = currentID;
+
+		this->journalVoxelIndices.insert(
+			std::make_pair(voxelIndex, static_cast<int>(this->journal.voxels.size())));
+		this->journal.voxels.push_back(change);
+	}
 
-	voxels[index] = id;
+	this->voxelGrid.setVoxel(x, y, z, id);
 }
 
-void LevelData::readFLOR(const uint16_t *flor, const INFFile &inf, int gridWidth, int gridDepth)
+void LevelData::setTextTriggerDisplayed(const Int2 &voxel)
 {
-	// Lambda for obtaining a two-byte FLOR voxel.
-	auto getFlorVoxel = [flor, gridWidth, gridDepth](int x, int z)
+	TextTrigger *textTrigger = this->getTextTrigger(voxel);
+	DebugAssert(textTrigger != nullptr, "No text trigger at (" + voxel.toString() + ").");
+
+	if (!textTrigger->hasBeenDisplayed())
 	{
-		// Read voxel data in reverse order.
-		const int index = (((gridDepth - 1) - z) * 2) + ((((gridWidth - 1) - x) * 2) * gridDepth);
-		const uint16_t voxel = Bytes::getLE16(reinterpret_cast<const uint8_t*>(flor) + index);
-		return voxel;
+		textTrigger->setPreviouslyDisplayed(true);
+		this->journal.displayedTextTriggers.push_back(voxel);
+	}
+}
+
+void LevelData::applyJournal(const Journal &journal)
+{
+	const int voxelDataCount = this->voxelGrid.getVoxelDataCount();
+	for (const Journal::VoxelChange &change : journal.voxels)
+	{
+		const bool inGrid = (change.x >= 0) && (change.x < this->voxelGrid.getWidth()) &&
+			(change.y >= 0) && (change.y < this->voxelGrid.getHeight()) &&
+			(change.z >= 0) && (change.z < this->voxelGrid.getDepth());
+		if (inGrid && (change.id < voxelDataCount))
+		{
+			this->changeVoxel(change.x, change.y, change.z, change.id);
+		}
+		else
+		{
+			DebugWarning("Ignoring invalid voxel change at (" + std::to_string(change.x) +
+				", " + std::to_string(change.y) + ", " + std::to_string(change.z) + ").");
+		}
+	}
+
+	for (const Int2 &voxel : journal.displayedTextTriggers)
+	{
+		if (this->getTextTrigger(voxel) != nullptr)
+		{
+			this->setTextTriggerDisplayed(voxel);
+		}
+	}
+}
+
+void LevelData::revertJournal()
+{
+	for (const Journal::VoxelChange &change : this->journal.voxels)
+	{
+		this->voxelGrid.setVoxel(change.x, change.y, change.z, change.originalID);
+	}
+
+	for (const Int2 &voxel : this->journal.displayedTextTriggers)
+	{
+		this->getTextTrigger(voxel)->setPreviouslyDisplayed(false);
+	}
+
+	this->journal.voxels.clear();
+	this->journal.displayedTextTriggers.clear();
+	this->journalVoxelIndices.clear();
+}
+
+const Int2 *LevelData::getWildernessOrigin() const
+{
+	return (this->wilderness != nullptr) ? &this->wilderness->getOrigin() : nullptr;
+}
+
+void LevelData::setWildernessOrigin(const Int2 &origin)
+{
+	DebugAssert(this->wilderness != nullptr, "Level \"" + this->name + "\" isn't a wilderness.");
+
+	const INFFile &inf = INFFile::get(this->infName);
+	const std::vector<Int2> newBlocks =
+		this->scrollWilderness(origin - this->wilderness->getOrigin());
+	for (const Int2 &block : newBlocks)
+	{
+		const int rmdID = this->wilderness->getRmdID(block);
+		this->wilderness->writeBlock(block, *RMDFile::get(rmdID));
+		this->readWildernessBlock(block, inf, nullptr);
+	}
+}
+
+Int2 LevelData::updateWilderness(const Double3 &playerPosition, JobSystem &jobSystem)
+{
+	if (this->wilderness == nullptr)
+	{
+		return Int2();
+	}
+
+	const INFFile &inf = INFFile::get(this->infName);
+	for (const Int2 &block : this->wilderness->writeDecodedBlocks(jobSystem))
+	{
+		this->readWildernessBlock(block, inf, &jobSystem);
+	}
+
+	const Double2 point = VoxelGrid::getTransformedCoordinate(
+		Double2(playerPosition.x, playerPosition.z), this->voxelGrid.getWidth(),
+		this->voxelGrid.getDepth());
+	const Int2 blockDelta = this->wilderness->getScroll(point);
+	if (blockDelta == Int2())
+	{
+		return Int2();
+	}
+
+	for (const Int2 &block : this->scrollWilderness(blockDelta))
+	{
+		this->wilderness->requestBlock(block, jobSystem);
+	}
+
+	// Arena's X and Z are the grid's Z and X, reversed.
+	return Int2(blockDelta.y * RMDFile::DEPTH, blockDelta.x * RMDFile::WIDTH);
+}
+
+void LevelData::setVoxel(int x, int y, int z, uint16_t id)
+{
+	this->voxelGrid.setVoxel(x, y, z, id);
+}
+
+void LevelData::readVoxels(int startX, int endX, int startZ, int endZ, int y,
+	JobSystem *jobSystem, const std::function<int(int, int, VoxelData&)> &getVoxel)
+{
+	// Voxels read by one band of X columns. Each band lists its voxel data in the order it
+	// was first seen, so merging the bands in order gives the same IDs as a serial read.
+	struct Band
+	{
+		std::vector<VoxelData> voxelDatas;
+		std::vector<int> dataIndices; // Index into voxelDatas per voxel, or -1 if empty.
+		std::vector<int> heights;
 	};
 
-	// Write the voxel IDs into the voxel grid.
-	for (int x = 0; x < gridWidth; x++)
+	const int regionWidth = endX - startX;
+	const int regionDepth = endZ - startZ;
+	const int bandCount = (jobSystem != nullptr) ?
+		std::max(std::min(jobSystem->getThreadCount() + 1, regionWidth), 1) : 1;
+	std::vector<Band> bands(bandCount);
+
+	auto getBandStartX = [startX, regionWidth, bandCount](int bandIndex)
 	{
-		for (int z = 0; z < gridDepth; z++)
+		return startX + ((regionWidth * bandIndex) / bandCount);
+	};
+
+	auto readBand = [startZ, endZ, regionDepth, &getVoxel, &bands, &getBandStartX](
+		int bandIndex)
+	{
+		const int bandStartX = getBandStartX(bandIndex);
+		const int bandEndX = getBandStartX(bandIndex + 1);
+		const int voxelCount = (bandEndX - bandStartX) * regionDepth;
+
+		Band &band = bands[bandIndex];
+		band.dataIndices.resize(voxelCount, -1);
+		band.heights.resize(voxelCount, 0);
+
+		std::unordered_map<VoxelData, int> bandDataIndices;
+		for (int x = bandStartX; x < bandEndX; x++)
 		{
-			auto getFloorTextureID = [](uint16_t voxel)
+			for (int z = startZ; z < endZ; z++)
 			{
-				return (voxel & 0xFF00) >> 8;
-			};
+				VoxelData voxelData;
+				const int height = getVoxel(x, z, voxelData);
+				if (height > 0)
+				{
+					auto iter = bandDataIndices.find(voxelData);
+					if (iter == bandDataIndices.end())
+					{
+						const int dataIndex = static_cast<int>(band.voxelDatas.size());
+						iter = bandDataIndices.emplace(voxelData, dataIndex).first;
+						band.voxelDatas.push_back(voxelData);
+					}
 
-			auto isChasm = [](int id)
-			{
-				return (id == MIFFile::DRY_CHASM) ||
-					(id == MIFFile::LAVA_CHASM) ||
-					(id == MIFFile::WET_CHASM);
-			};
+					const int index = ((x - bandStartX) * regionDepth) + (z - startZ);
+					band.dataIndices[index] = iter->second;
+					band.heights[index] = height;
+				}
+			}
+		}
+	};
 
-			const uint16_t florVoxel = getFlorVoxel(x, z);
-			const int floorTextureID = getFloorTextureID(florVoxel);
+	if (bandCount > 1)
+	{
+		jobSystem->parallelFor(bandCount, readBand);
+	}
+	else
+	{
+		readBand(0);
+	}
+
+	// Merge the bands into the voxel grid in order.
+	std::vector<uint16_t> ids;
+	for (int bandIndex = 0; bandIndex < bandCount; bandIndex++)
+	{
+		const Band &band = bands[bandIndex];
+		ids.clear();
+		for (const VoxelData &voxelData : band.voxelDatas)
+		{
+			ids.push_back(this->voxelGrid.addVoxelData(voxelData));
+		}
 
-			// See if the floor voxel is either solid or a chasm.
-			if (!isChasm(floorTextureID))
+		const int bandStartX = getBandStartX(bandIndex);
+		const int bandEndX = getBandStartX(bandIndex + 1);
+		for (int x = bandStartX; x < bandEndX; x++)
+		{
+			for (int z = startZ; z < endZ; z++)
 			{
-				// Get the voxel data index associated with the floor value, or add it
-				// if it doesn't exist yet.
-				const int dataIndex = [this, florVoxel, floorTextureID]()
+				const int index = ((x - bandStartX) * regionDepth) + (z - startZ);
+				const int dataIndex = band.dataIndices[index];
+				if (dataIndex >= 0)
 				{
-					const auto floorIter = this->floorDataMappings.find(florVoxel);
-					if (floorIter != this->floorDataMappings.end())
+					for (int i = 0; i < band.heights[index]; i++)
 					{
-						return floorIter->second;
+						this->setVoxel(x, y + i, z, ids[dataIndex]);
 					}
-					else
+				}
+			}
+		}
+	}
+}
+
+LevelData::MIFVoxelFunction LevelData::getArrayVoxels(const uint16_t *voxels, int gridDepth)
+{
+	return [voxels, gridDepth](int mifX, int mifZ)
+	{
+		const uint16_t *voxel = voxels + mifX + (mifZ * gridDepth);
+		return Bytes::getLE16(reinterpret_cast<const uint8_t*>(voxel));
+	};
+}
+
+void LevelData::readFLOR(const uint16_t *flor, const INFFile &inf, int gridWidth, int gridDepth,
+	JobSystem *jobSystem)
+{
+	this->readFLOR(LevelData::getArrayVoxels(flor, gridDepth), inf, gridWidth, gridDepth,
+		jobSystem);
+}
+
+void LevelData::readFLOR(const MIFVoxelFunction &getFlor, const INFFile &inf, int gridWidth,
+	int gridDepth, JobSystem *jobSystem)
+{
+	this->readFLOR(getFlor, inf, gridWidth, gridDepth, 0, gridWidth, 0, gridDepth, jobSystem);
+}
+
+void LevelData::readFLOR(const MIFVoxelFunction &getFlor, const INFFile &inf, int gridWidth,
+	int gridDepth, int startX, int endX, int startZ, int endZ, JobSystem *jobSystem)
+{
+	// Lambda for obtaining a two-byte FLOR voxel.
+	auto getFlorVoxel = [&getFlor, gridWidth, gridDepth](int x, int z)
+	{
+		// Read voxel data in reverse order.
+		return getFlor((gridDepth - 1) - z, (gridWidth - 1) - x);
+	};
+
+	// Write the voxel IDs into the voxel grid. Each voxel's height is returned, or zero
+	// if it's empty.
+	LevelWarnings warnings;
+	this->readVoxels(startX, endX, startZ, endZ, 0, jobSystem,
+		[&inf, &getFlorVoxel, &warnings, gridWidth, gridDepth](int x, int z,
+			VoxelData &voxelData)
+	{
+		auto getFloorTextureID = [](uint16_t voxel)
+		{
+			return (voxel & 0xFF00) >> 8;
+		};
+
+		auto isChasm = [](int id)
+		{
+			return (id == MIFFile::DRY_CHASM) ||
+				(id == MIFFile::LAVA_CHASM) ||
+				(id == MIFFile::WET_CHASM);
+		};
+
+		const uint16_t florVoxel = getFlorVoxel(x, z);
+		const int floorTextureID = getFloorTextureID(florVoxel);
+
+		// See if the floor voxel is either solid or a chasm.
+		if (!isChasm(floorTextureID))
+		{
+			// Use the voxel data associated with the floor value (the grid reuses the
+			// existing one if it was already added).
+			voxelData = VoxelData::makeFloor(floorTextureID);
+			return 1;
+		}
+		else
+		{
+			// The voxel is a chasm. See which of its four faces are adjacent to
+			// a solid floor voxel.
+			const uint16_t northVoxel = getFlorVoxel(std::min(x + 1, gridWidth - 1), z);
+			const uint16_t eastVoxel = getFlorVoxel(x, std::min(z + 1, gridDepth - 1));
+			const uint16_t southVoxel = getFlorVoxel(std::max(x - 1, 0), z);
+			const uint16_t westVoxel = getFlorVoxel(x, std::max(z - 1, 0));
+
+			const std::array<bool, 4> adjacentFaces
+			{
+				!isChasm(getFloorTextureID(northVoxel)), // North.
+				!isChasm(getFloorTextureID(eastVoxel)), // East.
+				!isChasm(getFloorTextureID(southVoxel)), // South.
+				!isChasm(getFloorTextureID(westVoxel)) // West.
+			};
+
+			if (floorTextureID == MIFFile::DRY_CHASM)
+			{
+				voxelData = [&inf, &warnings, &adjacentFaces]()
+				{
+					const int dryChasmID = [&inf, &warnings]()
 					{
-						const int index = this->voxelGrid.addVoxelData(
-							VoxelData::makeFloor(floorTextureID));
-						return this->floorDataMappings.insert(
-							std::make_pair(florVoxel, index)).first->second;
-					}
+						const int *ptr = inf.getDryChasmIndex();
+						if (ptr != nullptr)
+						{
+							return *ptr;
+						}
+						else
+						{
+							warnings.warn("Missing *DRYCHASM ID.");
+							return 0;
+						}
+					}();
+
+					return VoxelData::makeChasm(
+						dryChasmID,
+						adjacentFaces.at(0),
+						adjacentFaces.at(1),
+						adjacentFaces.at(2),
+						adjacentFaces.at(3),
+						VoxelData::ChasmData::Type::Dry);
 				}();
 
-				this->setVoxel(x, 0, z, dataIndex);
+				return 1;
 			}
-			else
+			else if (floorTextureID == MIFFile::LAVA_CHASM)
 			{
-				// The voxel is a chasm. See which of its four faces are adjacent to
-				// a solid floor voxel.
-				const uint16_t northVoxel = getFlorVoxel(std::min(x + 1, gridWidth - 1), z);
-				const uint16_t eastVoxel = getFlorVoxel(x, std::min(z + 1, gridDepth - 1));
-				const uint16_t southVoxel = getFlorVoxel(std::max(x - 1, 0), z);
-				const uint16_t westVoxel = getFlorVoxel(x, std::max(z - 1, 0));
-
-				const std::array<bool, 4> adjacentFaces
+				voxelData = [&inf, &warnings, &adjacentFaces]()
 				{
-					!isChasm(getFloorTextureID(northVoxel)), // North.
-					!isChasm(getFloorTextureID(eastVoxel)), // East.
-					!isChasm(getFloorTextureID(southVoxel)), // South.
-					!isChasm(getFloorTextureID(westVoxel)) // West.
-				};
-
-				// Lambda for obtaining the index of a newly-added VoxelData object, and
-				// inserting it into the chasm data mappings if it hasn't been already. The
-				// function parameter decodes the voxel and returns the created VoxelData.
-				auto getChasmDataIndex = [this, &inf, florVoxel, &adjacentFaces](
-					const std::function<VoxelData(void)> &function)
-				{
-					const auto chasmPair = std::make_pair(florVoxel, adjacentFaces);
-					const auto chasmIter = this->chasmDataMappings.find(chasmPair);
-					if (chasmIter != this->chasmDataMappings.end())
+					const int lavaChasmID = [&inf, &warnings]()
 					{
-						return chasmIter->second;
-					}
-					else
+						const int *ptr = inf.getLavaChasmIndex();
+						if (ptr != nullptr)
+						{
+							return *ptr;
+						}
+						else
+						{
+							warnings.warn("Missing *LAVACHASM ID.");
+							return 0;
+						}
+					}();
+
+					return VoxelData::makeChasm(
+						lavaChasmID,
+						adjacentFaces.at(0),
+						adjacentFaces.at(1),
+						adjacentFaces.at(2),
+						adjacentFaces.at(3),
+						VoxelData::ChasmData::Type::Lava);
+				}();
+
+				return 1;
+			}
+			else if (floorTextureID == MIFFile::WET_CHASM)
+			{
+				voxelData = [&inf, &warnings, &adjacentFaces]()
+				{
+					const int wetChasmID = [&inf, &warnings]()
 					{
-						const int index = this->voxelGrid.addVoxelData(function());
-						return this->chasmDataMappings.insert(
-							std::make_pair(chasmPair, index)).first->second;
-					}
-				};
+						const int *ptr = inf.getWetChasmIndex();
+						if (ptr != nullptr)
+						{
+							return *ptr;
+						}
+						else
+						{
+							warnings.warn("Missing *WETCHASM ID.");
+							return 0;
+						}
+					}();
+
+					return VoxelData::makeChasm(
+						wetChasmID,
+						adjacentFaces.at(0),
+						adjacentFaces.at(1),
+						adjacentFaces.at(2),
+						adjacentFaces.at(3),
+						VoxelData::ChasmData::Type::Wet);
+				}();
+
+				return 1;
+			}
+		}
+
+		return 0;
+	});
+}
 
-				if (floorTextureID == MIFFile::DRY_CHASM)
+void LevelData::readMAP1(const uint16_t *map1, const INFFile &inf, int gridWidth, int gridDepth,
+	JobSystem *jobSystem)
+{
+	this->readMAP1(LevelData::getArrayVoxels(map1, gridDepth), inf, gridWidth, gridDepth,
+		jobSystem);
+}
+
+void LevelData::readMAP1(const MIFVoxelFunction &getMap1, const INFFile &inf, int gridWidth,
+	int gridDepth, JobSystem *jobSystem)
+{
+	this->readMAP1(getMap1, inf, gridWidth, gridDepth, 0, gridWidth, 0, gridDepth, jobSystem);
+}
+
+void LevelData::readMAP1(const MIFVoxelFunction &getMap1, const INFFile &inf, int gridWidth,
+	int gridDepth, int startX, int endX, int startZ, int endZ, JobSystem *jobSystem)
+{
+	// Lambda for obtaining a two-byte MAP1 voxel.
+	auto getMap1Voxel = [&getMap1, gridWidth, gridDepth](int x, int z)
+	{
+		// Read voxel data in reverse order.
+		return getMap1((gridDepth - 1) - z, (gridWidth - 1) - x);
+	};
+
+	// Write the voxel IDs into the voxel grid. Each voxel's height is returned, or zero
+	// if it's empty.
+	LevelWarnings warnings;
+	this->readVoxels(startX, endX, startZ, endZ, 1, jobSystem,
+		[&inf, &getMap1Voxel, &warnings](int x, int z, VoxelData &voxelData)
+	{
+		const uint16_t map1Voxel = getMap1Voxel(x, z);
+
+		if ((map1Voxel & 0x8000) == 0)
+		{
+			// A voxel of some kind.
+			const bool voxelIsEmpty = map1Voxel == 0;
+
+			if (!voxelIsEmpty)
+			{
+				const uint8_t mostSigByte = (map1Voxel & 0x7F00) >> 8;
+				const uint8_t leastSigByte = map1Voxel & 0x007F;
+				const bool voxelIsSolid = mostSigByte == leastSigByte;
+
+				if (voxelIsSolid)
 				{
-					const int dataIndex = getChasmDataIndex(
-						[&inf, floorTextureID, &adjacentFaces]()
+					// Regular solid wall.
+					voxelData = [&inf, mostSigByte]()
 					{
-						const int dryChasmID = [&inf]()
+						const int textureIndex = mostSigByte - 1;
+
+						// Menu index if the voxel has the *MENU tag, or -1 if it is
+						// not a *MENU voxel.
+						const int menuIndex = inf.getMenuIndex(textureIndex);
+						const bool isMenu = menuIndex != -1;
+
+						// Determine what the type of the wall is (level up/down, menu, 
+						// or just plain solid).
+						const VoxelData::WallData::Type type = [&inf, textureIndex, isMenu]()
 						{
-							const int *ptr = inf.getDryChasmIndex();
-							if (ptr != nullptr)
+							// Returns whether the given index pointer is non-null and
+							// matches the current texture index.
+							auto matchesIndex = [textureIndex](const int *index)
 							{
-								return *ptr;
+								return (index != nullptr) && (*index == textureIndex);
+							};
+
+							if (matchesIndex(inf.getLevelUpIndex()))
+							{
+								return VoxelData::WallData::Type::LevelUp;
+							}
+							else if (matchesIndex(inf.getLevelDownIndex()))
+							{
+								return VoxelData::WallData::Type::LevelDown;
+							}
+							else if (isMenu)
+							{
+								return VoxelData::WallData::Type::Menu;
 							}
 							else
 							{
-								DebugWarning("Missing *DRYCHASM ID.");
-								return 0;
+								return VoxelData::WallData::Type::Solid;
 							}
 						}();
 
-						return VoxelData::makeChasm(
-							dryChasmID,
-							adjacentFaces.at(0),
-							adjacentFaces.at(1),
-							adjacentFaces.at(2),
-							adjacentFaces.at(3),
-							VoxelData::ChasmData::Type::Dry);
-					});
+						VoxelData voxelData = VoxelData::makeWall(
+							textureIndex, textureIndex, textureIndex,
+							(isMenu ? &menuIndex : nullptr), type);
+
+						// Set the *MENU index if it's a menu voxel.
+						if (isMenu)
+						{
+							VoxelData::WallData &wallData = voxelData.wall;
+							wallData.menuID = menuIndex;
+						}
+
+						return voxelData;
+					}();
 
-					this->setVoxel(x, 0, z, dataIndex);
+					return 1;
 				}
-				else if (floorTextureID == MIFFile::LAVA_CHASM)
+				else
 				{
-					const int dataIndex = getChasmDataIndex(
-						[&inf, floorTextureID, &adjacentFaces]()
+					// Raised platform.
+					voxelData = [&inf, &warnings, map1Voxel, mostSigByte]()
 					{
-						const int lavaChasmID = [&inf]()
+						const uint8_t wallTextureID = map1Voxel & 0x000F;
+						const uint8_t capTextureID = (map1Voxel & 0x00F0) >> 4;
+
+						const int sideID = [&inf, &warnings, wallTextureID]()
 						{
-							const int *ptr = inf.getLavaChasmIndex();
+							const int *ptr = inf.getBoxSide(wallTextureID);
 							if (ptr != nullptr)
 							{
 								return *ptr;
 							}
 							else
 							{
-								DebugWarning("Missing *LAVACHASM ID.");
+								warnings.warn("Missing *BOXSIDE ID \"" +
+									std::to_string(wallTextureID) + "\".");
 								return 0;
 							}
 						}();
 
-						return VoxelData::makeChasm(
-							lavaChasmID,
-							adjacentFaces.at(0),
-							adjacentFaces.at(1),
-							adjacentFaces.at(2),
-							adjacentFaces.at(3),
-							VoxelData::ChasmData::Type::Lava);
-					});
+						const int floorID = [&inf, &warnings]()
+						{
+							const int id = inf.getCeiling().textureIndex;
 
-					this->setVoxel(x, 0, z, dataIndex);
-				}
-				else if (floorTextureID == MIFFile::WET_CHASM)
-				{
-					const int dataIndex = getChasmDataIndex(
-						[&inf, floorTextureID, &adjacentFaces]()
-					{
-						const int wetChasmID = [&inf]()
+							if (id >= 0)
+							{
+								return id;
+							}
+							else
+							{
+								warnings.warn("Invalid platform floor ID \"" +
+									std::to_string(id) + "\".");
+								return 0;
+							}
+						}();
+
+						const int ceilingID = [&inf, &warnings, capTextureID]()
 						{
-							const int *ptr = inf.getWetChasmIndex();
+							const int *ptr = inf.getBoxCap(capTextureID);
 							if (ptr != nullptr)
 							{
 								return *ptr;
 							}
 							else
 							{
-								DebugWarning("Missing *WETCHASM ID.");
+								warnings.warn("Missing *BOXCAP ID \"" +
+									std::to_string(capTextureID) + "\".");
 								return 0;
 							}
 						}();
 
-						return VoxelData::makeChasm(
-							wetChasmID,
-							adjacentFaces.at(0),
-							adjacentFaces.at(1),
-							adjacentFaces.at(2),
-							adjacentFaces.at(3),
-							VoxelData::ChasmData::Type::Wet);
-					});
+						// To do: The height appears to be some fraction of 64, and 
+						// when it's greater than 64, then that determines the offset?
+						const double platformHeight = static_cast<double>(mostSigByte) /
+							static_cast<double>(MIFFile::ARENA_UNITS);
+
+						const double yOffset = 0.0;
+						const double ySize = platformHeight;
 
-					this->setVoxel(x, 0, z, dataIndex);
+						// To do: Clamp top V coordinate positive until the correct platform 
+						// height calculation is figured out. Maybe the platform height
+						// needs to be multiplied by the ratio between the current ceiling
+						// height and the default ceiling height (128)? I.e., multiply by
+						// "ceilingHeight"?
+						const double vTop = std::max(0.0, 1.0 - platformHeight);
+						const double vBottom = Constants::JustBelowOne; // To do: should also be a function.
+
+						return VoxelData::makeRaised(sideID, floorID, ceilingID,
+							yOffset, ySize, vTop, vBottom);
+					}();
+
+					return 1;
 				}
 			}
 		}
-	}
-}
-
-void LevelData::readMAP1(const uint16_t *map1, const INFFile &inf, int gridWidth, int gridDepth)
-{
-	// Lambda for obtaining a two-byte MAP1 voxel.
-	auto getMap1Voxel = [map1, gridWidth, gridDepth](int x, int z)
-	{
-		// Read voxel data in reverse order.
-		const int index = (((gridDepth - 1) - z) * 2) + ((((gridWidth - 1) - x) * 2) * gridDepth);
-		const uint16_t voxel = Bytes::getLE16(reinterpret_cast<const uint8_t*>(map1) + index);
-		return voxel;
-	};
-
-	// Write the voxel IDs into the voxel grid.
-	for (int x = 0; x < gridWidth; x++)
-	{
-		for (int z = 0; z < gridDepth; z++)
+		else
 		{
-			const uint16_t map1Voxel = getMap1Voxel(x, z);
+			// A special voxel, or an object of some kind.
+			const uint8_t mostSigNibble = (map1Voxel & 0xF000) >> 12;
 
-			// Lambda for obtaining the index of a newly-added VoxelData object, and inserting
-			// it into the data mappings if it hasn't been already. The function parameter
-			// decodes the voxel and returns the created VoxelData.
-			auto getDataIndex = [this, &inf, map1Voxel](
-				const std::function<VoxelData(void)> &function)
+			if (mostSigNibble == 0x8)
 			{
-				const auto wallIter = this->wallDataMappings.find(map1Voxel);
-				if (wallIter != this->wallDataMappings.end())
-				{
-					return wallIter->second;
-				}
-				else
-				{
-					const int index = this->voxelGrid.addVoxelData(function());
-					return this->wallDataMappings.insert(
-						std::make_pair(map1Voxel, index)).first->second;
-				}
-			};
-
-			if ((map1Voxel & 0x8000) == 0)
+				// The lower byte determines the index of a FLAT for an object.
+				const uint8_t flatIndex = map1Voxel & 0x00FF;
+				// To do.
+			}
+			else if (mostSigNibble == 0x9)
 			{
-				// A voxel of some kind.
-				const bool voxelIsEmpty = map1Voxel == 0;
-
-				if (!voxelIsEmpty)
+				// Transparent block with 1-sided texture on all sides, such as wooden 
+				// arches in dungeons. These do not have back-faces (especially when 
+				// standing in the voxel itself).
+				voxelData = [map1Voxel]()
 				{
-					const uint8_t mostSigByte = (map1Voxel & 0x7F00) >> 8;
-					const uint8_t leastSigByte = map1Voxel & 0x007F;
-					const bool voxelIsSolid = mostSigByte == leastSigByte;
-
-					if (voxelIsSolid)
-					{
-						// Regular solid wall.
-						const int dataIndex = getDataIndex([&inf, mostSigByte]()
-						{
-							const int textureIndex = mostSigByte - 1;
-
-							// Menu index if the voxel has the *MENU tag, or -1 if it is
-							// not a *MENU voxel.
-							const int menuIndex = inf.getMenuIndex(textureIndex);
-							const bool isMenu = menuIndex != -1;
-
-							// Determine what the type of the wall is (level up/down, menu, 
-							// or just plain solid).
-							const VoxelData::WallData::Type type = [&inf, textureIndex, isMenu]()
-							{
-								// Returns whether the given index pointer is non-null and
-								// matches the current texture index.
-								auto matchesIndex = [textureIndex](const int *index)
-								{
-									return (index != nullptr) && (*index == textureIndex);
-								};
-
-								if (matchesIndex(inf.getLevelUpIndex()))
-								{
-									return VoxelData::WallData::Type::LevelUp;
-								}
-								else if (matchesIndex(inf.getLevelDownIndex()))
-								{
-									return VoxelData::WallData::Type::LevelDown;
-								}
-								else if (isMenu)
-								{
-									return VoxelData::WallData::Type::Menu;
-								}
-								else
-								{
-									return VoxelData::WallData::Type::Solid;
-								}
-							}();
-
-							VoxelData voxelData = VoxelData::makeWall(
-								textureIndex, textureIndex, textureIndex,
-								(isMenu ? &menuIndex : nullptr), type);
-
-							// Set the *MENU index if it's a menu voxel.
-							if (isMenu)
-							{
-								VoxelData::WallData &wallData = voxelData.wall;
-								wallData.menuID = menuIndex;
-							}
-
-							return voxelData;
-						});
-
-						this->setVoxel(x, 1, z, dataIndex);
-					}
-					else
-					{
-						// Raised platform.
-						const int dataIndex = getDataIndex([&inf, map1Voxel, mostSigByte]()
-						{
-							const uint8_t wallTextureID = map1Voxel & 0x000F;
-							const uint8_t capTextureID = (map1Voxel & 0x00F0) >> 4;
+					const int textureIndex = (map1Voxel & 0x00FF) - 1;
+					const bool collider = (map1Voxel & 0x0100) == 0;
+					return VoxelData::makeTransparentWall(textureIndex, collider);
+				}();
 
-							const int sideID = [&inf, wallTextureID]()
-							{
-								const int *ptr = inf.getBoxSide(wallTextureID);
-								if (ptr != nullptr)
-								{
-									return *ptr;
-								}
-								else
-								{
-									DebugWarning("Missing *BOXSIDE ID \"" +
-										std::to_string(wallTextureID) + "\".");
-									return 0;
-								}
-							}();
-
-							const int floorID = [&inf]()
-							{
-								const int id = inf.getCeiling().textureIndex;
-
-								if (id >= 0)
-								{
-									return id;
-								}
-								else
-								{
-									DebugWarning("Invalid platform floor ID \"" +
-										std::to_string(id) + "\".");
-									return 0;
-								}
-							}();
-
-							const int ceilingID = [&inf, capTextureID]()
-							{
-								const int *ptr = inf.getBoxCap(capTextureID);
-								if (ptr != nullptr)
-								{
-									return *ptr;
-								}
-								else
-								{
-									DebugWarning("Missing *BOXCAP ID \"" +
-										std::to_string(capTextureID) + "\".");
-									return 0;
-								}
-							}();
-
-							// To do: The height appears to be some fraction of 64, and 
-							// when it's greater than 64, then that determines the offset?
-							const double platformHeight = static_cast<double>(mostSigByte) /
-								static_cast<double>(MIFFile::ARENA_UNITS);
-
-							const double yOffset = 0.0;
-							const double ySize = platformHeight;
-
-							// To do: Clamp top V coordinate positive until the correct platform 
-							// height calculation is figured out. Maybe the platform height
-							// needs to be multiplied by the ratio between the current ceiling
-							// height and the default ceiling height (128)? I.e., multiply by
-							// "ceilingHeight"?
-							const double vTop = std::max(0.0, 1.0 - platformHeight);
-							const double vBottom = Constants::JustBelowOne; // To do: should also be a function.
-
-							return VoxelData::makeRaised(sideID, floorID, ceilingID,
-								yOffset, ySize, vTop, vBottom);
-						});
-
-						this->setVoxel(x, 1, z, dataIndex);
-					}
-				}
+				return 1;
 			}
-			else
+			else if (mostSigNibble == 0xA)
 			{
-				// A special voxel, or an object of some kind.
-				const uint8_t mostSigNibble = (map1Voxel & 0xF000) >> 12;
-
-				if (mostSigNibble == 0x8)
-				{
-					// The lower byte determines the index of a FLAT for an object.
-					const uint8_t flatIndex = map1Voxel & 0x00FF;
-					// To do.
-				}
-				else if (mostSigNibble == 0x9)
-				{
-					// Transparent block with 1-sided texture on all sides, such as wooden 
-					// arches in dungeons. These do not have back-faces (especially when 
-					// standing in the voxel itself).
-					const int dataIndex = getDataIndex([map1Voxel]()
-					{
-						const int textureIndex = (map1Voxel & 0x00FF) - 1;
-						const bool collider = (map1Voxel & 0x0100) == 0;
-						return VoxelData::makeTransparentWall(textureIndex, collider);
-					});
+				// Transparent block with 2-sided texture on one side (i.e., fence).
+				const int textureIndex = (map1Voxel & 0x003F) - 1;
 
-					this->setVoxel(x, 1, z, dataIndex);
-				}
-				else if (mostSigNibble == 0xA)
+				// It is clamped non-negative due to a case in IMPERIAL.MIF where one temple
+				// voxel has all zeroes for its texture index, and it appears solid gray
+				// in the original game (presumably a silent bug).
+				if (textureIndex >= 0)
 				{
-					// Transparent block with 2-sided texture on one side (i.e., fence).
-					const int textureIndex = (map1Voxel & 0x003F) - 1;
-
-					// It is clamped non-negative due to a case in IMPERIAL.MIF where one temple
-					// voxel has all zeroes for its texture index, and it appears solid gray
-					// in the original game (presumably a silent bug).
-					if (textureIndex >= 0)
+					voxelData = [map1Voxel, textureIndex]()
 					{
-						const int dataIndex = getDataIndex([map1Voxel, textureIndex]()
-						{
-							const double yOffset =
-								static_cast<double>((map1Voxel & 0x0E00) >> 8) / 7.0;
-							const bool collider = (map1Voxel & 0x0100) != 0;
+						const double yOffset =
+							static_cast<double>((map1Voxel & 0x0E00) >> 8) / 7.0;
+						const bool collider = (map1Voxel & 0x0100) != 0;
 
-							const VoxelData::Facing facing = [map1Voxel]()
-							{
-								// Orientation is a multiple of 4 (0, 4, 8, C), where 0 is north
-								// and C is east. It is stored in two bits above the texture index.
-								const int orientation = (map1Voxel & 0x00C0) >> 4;
-								if (orientation == 0x0)
-								{
-									return VoxelData::Facing::PositiveX;
-								}
-								else if (orientation == 0x4)
-								{
-									return VoxelData::Facing::NegativeZ;
-								}
-								else if (orientation == 0x8)
-								{
-									return VoxelData::Facing::NegativeX;
-								}
-								else
-								{
-									return VoxelData::Facing::PositiveZ;
-								}
-							}();
-
-							return VoxelData::makeEdge(textureIndex, yOffset, collider, facing);
-						});
-
-						this->setVoxel(x, 1, z, dataIndex);
-					}
-				}
-				else if (mostSigNibble == 0xB)
-				{
-					// Door voxel.
-					const int dataIndex = getDataIndex([map1Voxel]()
-					{
-						const int textureIndex = (map1Voxel & 0x003F) - 1;
-						const VoxelData::DoorData::Type doorType = [map1Voxel]()
+						const VoxelData::Facing facing = [map1Voxel]()
 						{
-							const int type = (map1Voxel & 0x00C0) >> 4;
-							if (type == 0x0)
+							// Orientation is a multiple of 4 (0, 4, 8, C), where 0 is north
+							// and C is east. It is stored in two bits above the texture index.
+							const int orientation = (map1Voxel & 0x00C0) >> 4;
+							if (orientation == 0x0)
 							{
-								return VoxelData::DoorData::Type::Swinging;
+								return VoxelData::Facing::PositiveX;
 							}
-							else if (type == 0x4)
+							else if (orientation == 0x4)
 							{
-								return VoxelData::DoorData::Type::Sliding;
+								return VoxelData::Facing::NegativeZ;
 							}
-							else if (type == 0x8)
+							else if (orientation == 0x8)
 							{
-								return VoxelData::DoorData::Type::Raising;
+								return VoxelData::Facing::NegativeX;
 							}
 							else
 							{
-								// I don't believe any doors in Arena split (but they are
-								// supported by the engine).
-								throw std::runtime_error("Bad door type \"" +
-									std::to_string(type) + "\".");
+								return VoxelData::Facing::PositiveZ;
 							}
 						}();
 
-						return VoxelData::makeDoor(textureIndex, doorType);
-					});
+						return VoxelData::makeEdge(textureIndex, yOffset, collider, facing);
+					}();
 
-					this->setVoxel(x, 1, z, dataIndex);
-				}
-				else if (mostSigNibble == 0xC)
-				{
-					// Unknown.
-					DebugWarning("Voxel type 0xC not implemented.");
+					return 1;
 				}
-				else if (mostSigNibble == 0xD)
+			}
+			else if (mostSigNibble == 0xB)
+			{
+				// Door voxel.
+				voxelData = [map1Voxel]()
 				{
-					// Diagonal wall. Its type is determined by the nineth bit.
-					const int dataIndex = getDataIndex([map1Voxel]()
+					const int textureIndex = (map1Voxel & 0x003F) - 1;
+					const VoxelData::DoorData::Type doorType = [map1Voxel]()
 					{
-						const int textureIndex = (map1Voxel & 0x00FF) - 1;
-						const bool isRightDiag = (map1Voxel & 0x0100) == 0;
-						return VoxelData::makeDiagonal(textureIndex, isRightDiag);
-					});
+						const int type = (map1Voxel & 0x00C0) >> 4;
+						if (type == 0x0)
+						{
+							return VoxelData::DoorData::Type::Swinging;
+						}
+						else if (type == 0x4)
+						{
+							return VoxelData::DoorData::Type::Sliding;
+						}
+						else if (type == 0x8)
+						{
+							return VoxelData::DoorData::Type::Raising;
+						}
+						else
+						{
+							// I don't believe any doors in Arena split (but they are
+							// supported by the engine).
+							throw std::runtime_error("Bad door type \"" +
+								std::to_string(type) + "\".");
+						}
+					}();
+
+					return VoxelData::makeDoor(textureIndex, doorType);
+				}();
 
-					this->setVoxel(x, 1, z, dataIndex);
-				}
+				return 1;
+			}
+			else if (mostSigNibble == 0xC)
+			{
+				// Unknown.
+				warnings.warn("Voxel type 0xC not implemented.");
+			}
+			else if (mostSigNibble == 0xD)
+			{
+				// Diagonal wall. Its type is determined by the nineth bit.
+				voxelData = [map1Voxel]()
+				{
+					const int textureIndex = (map1Voxel & 0x00FF) - 1;
+					const bool isRightDiag = (map1Voxel & 0x0100) == 0;
+					return VoxelData::makeDiagonal(textureIndex, isRightDiag);
+				}();
+
+				return 1;
 			}
 		}
-	}
+
+		return 0;
+	});
 }
 
-void LevelData::readMAP2(const uint16_t *map2, const INFFile &inf, int gridWidth, int gridDepth)
+void LevelData::readMAP2(const uint16_t *map2, int gridWidth, int gridDepth,
+	JobSystem *jobSystem)
+{
+	this->readMAP2(LevelData::getArrayVoxels(map2, gridDepth), gridWidth, gridDepth,
+		jobSystem);
+}
+
+void LevelData::readMAP2(const MIFVoxelFunction &getMap2, int gridWidth, int gridDepth,
+	JobSystem *jobSystem)
+{
+	this->readMAP2(getMap2, gridWidth, gridDepth, 0, gridWidth, 0, gridDepth, jobSystem);
+}
+
+void LevelData::readMAP2(const MIFVoxelFunction &getMap2, int gridWidth, int gridDepth,
+	int startX, int endX, int startZ, int endZ, JobSystem *jobSystem)
 {
 	// Lambda for obtaining a two-byte MAP2 voxel.
-	auto getMap2Voxel = [map2, gridWidth, gridDepth](int x, int z)
+	auto getMap2Voxel = [&getMap2, gridWidth, gridDepth](int x, int z)
 	{
 		// Read voxel data in reverse order.
-		const int index = (((gridDepth - 1) - z) * 2) + ((((gridWidth - 1) - x) * 2) * gridDepth);
-		const uint16_t voxel = Bytes::getLE16(reinterpret_cast<const uint8_t*>(map2) + index);
-		return voxel;
+		return getMap2((gridDepth - 1) - z, (gridWidth - 1) - x);
 	};
 
-	// Write the voxel IDs into the voxel grid.
-	for (int x = 0; x < gridWidth; x++)
+	// Write the voxel IDs into the voxel grid. Each voxel's height is returned, or zero
+	// if it's empty.
+	this->readVoxels(startX, endX, startZ, endZ, 2, jobSystem,
+		[&getMap2Voxel](int x, int z, VoxelData &voxelData)
 	{
-		for (int z = 0; z < gridDepth; z++)
-		{
-			const uint16_t map2Voxel = getMap2Voxel(x, z);
+		const uint16_t map2Voxel = getMap2Voxel(x, z);
 
-			if (map2Voxel != 0)
+		if (map2Voxel != 0)
+		{
+			// Number of blocks to extend upwards (including second story).
+			const int height = [map2Voxel]()
 			{
-				// Number of blocks to extend upwards (including second story).
-				const int height = [map2Voxel]()
+				if ((map2Voxel & 0x80) == 0x80)
 				{
-					if ((map2Voxel & 0x80) == 0x80)
-					{
-						return 2;
-					}
-					else if ((map2Voxel & 0x8000) == 0x8000)
-					{
-						return 3;
-					}
-					else if ((map2Voxel & 0x8080) == 0x8080)
-					{
-						return 4;
-					}
-					else
-					{
-						return 1;
-					}
-				}();
-
-				const int dataIndex = [this, &inf, map2Voxel, height]()
+					return 2;
+				}
+				else if ((map2Voxel & 0x8000) == 0x8000)
 				{
-					const auto map2Iter = this->map2DataMappings.find(map2Voxel);
-					if (map2Iter != this->map2DataMappings.end())
-					{
-						return map2Iter->second;
-					}
-					else
-					{
-						const int textureIndex = (map2Voxel & 0x007F) - 1;
-						const int *menuID = nullptr;
-						const int index = this->voxelGrid.addVoxelData(VoxelData::makeWall(
-							textureIndex, textureIndex, textureIndex, menuID,
-							VoxelData::WallData::Type::Solid));
-						return this->map2DataMappings.insert(
-							std::make_pair(map2Voxel, index)).first->second;
-					}
-				}();
-
-				for (int y = 2; y < (height + 2); y++)
+					return 3;
+				}
+				else if ((map2Voxel & 0x8080) == 0x8080)
 				{
-					this->setVoxel(x, y, z, dataIndex);
+					return 4;
 				}
-			}
+				else
+				{
+					return 1;
+				}
+			}();
+
+			const int textureIndex = (map2Voxel & 0x007F) - 1;
+			const int *menuID = nullptr;
+			voxelData = VoxelData::makeWall(textureIndex, textureIndex, textureIndex, menuID,
+				VoxelData::WallData::Type::Solid);
+
+			return height;
 		}
-	}
+
+		return 0;
+	});
 }
 
 void LevelData::readCeiling(const INFFile &inf, int width, int depth)
@@ -1134,6 +1898,47 @@ void LevelData::readCeiling(const INFFile &inf, int width, int depth)
 	}
 }
 
+void LevelData::readStaticLights(const MIFVoxelFunction &getMap1, const INFFile &inf,
+	int gridWidth, int gridDepth)
+{
+	this->staticLights.clear();
+
+	for (int x = 0; x < gridWidth; x++)
+	{
+		for (int z = 0; z < gridDepth; z++)
+		{
+			// Read voxel data in reverse order, like readMAP1().
+			const uint16_t map1Voxel = getMap1((gridDepth - 1) - z, (gridWidth - 1) - x);
+			if ((map1Voxel & 0xF000) != 0x8000)
+			{
+				continue;
+			}
+
+			// The lower byte is the index of the object's FLAT.
+			const int flatIndex = map1Voxel & 0x00FF;
+			if (flatIndex >= inf.getFlatCount())
+			{
+				continue;
+			}
+
+			// S:# is the light's reach. It's taken as voxels for now, with full brightness
+			// at the source.
+			const INFFile::FlatData &flat = inf.getFlat(flatIndex);
+			if ((flat.lightIntensity.get() == nullptr) || (*flat.lightIntensity <= 0))
+			{
+				continue;
+			}
+
+			LightMap::Light light;
+			light.point = Double2(static_cast<double>(x) + 0.50,
+				static_cast<double>(z) + 0.50);
+			light.radius = static_cast<double>(*flat.lightIntensity);
+			light.brightness = 1.0;
+			this->staticLights.push_back(light);
+		}
+	}
+}
+
 void LevelData::readLocks(const std::vector<MIFFile::Level::Lock> &locks, int width, int depth)
 {
 	for (const auto &lock : locks)
@@ -1172,3 +1977,79 @@ void LevelData::readTriggers(const std::vector<MIFFile::Level::Trigger> &trigger
 		}
 	}
 }
+
+void LevelData::readWildernessBlock(const Int2 &block, const INFFile &inf, JobSystem *jobSystem)
+{
+	// The block's X and Z range in the voxel grid (Arena's Z and X).
+	const int gridSize = WildernessWindow::GRID_SIZE;
+	const Int2 corner = this->wilderness->getGridCorner(block);
+	const int startX = corner.x;
+	const int endX = corner.x + RMDFile::DEPTH;
+	const int startZ = corner.y;
+	const int endZ = corner.y + RMDFile::WIDTH;
+
+	const WildernessWindow &window = *this->wilderness;
+	const MIFVoxelFunction getFlor = LevelData::getArrayVoxels(window.getFLOR(), gridSize);
+	const MIFVoxelFunction getMap1 = LevelData::getArrayVoxels(window.getMAP1(), gridSize);
+	const MIFVoxelFunction getMap2 = LevelData::getArrayVoxels(window.getMAP2(), gridSize);
+	this->readFLOR(getFlor, inf, gridSize, gridSize, std::max(startX - 1, 0),
+		std::min(endX + 1, gridSize), std::max(startZ - 1, 0), std::min(endZ + 1, gridSize),
+		jobSystem);
+	this->readMAP1(getMap1, inf, gridSize, gridSize, startX, endX, startZ, endZ, jobSystem);
+	this->readMAP2(getMap2, gridSize, gridSize, startX, endX, startZ, endZ, jobSystem);
+}
+
+std::vector<Int2> LevelData::scrollWilderness(const Int2 &blockDelta)
+{
+	const Int2 oldOrigin = this->wilderness->getOrigin();
+	this->wilderness->scroll(blockDelta);
+
+	// Arena's X and Z are the grid's Z and X, reversed, and the voxels move the opposite way
+	// to the window.
+	const int chunksPerBlock = RMDFile::WIDTH / VoxelGrid::CHUNK_SIZE;
+	const int dx = blockDelta.y * RMDFile::DEPTH;
+	const int dz = blockDelta.x * RMDFile::WIDTH;
+	this->voxelGrid.scroll(blockDelta.y * chunksPerBlock, blockDelta.x * chunksPerBlock);
+
+	// Journal entries move with their voxels, and the ones moved off the grid are forgotten
+	// with their blocks.
+	std::vector<Journal::VoxelChange> voxelChanges = std::move(this->journal.voxels);
+	this->journal.voxels.clear();
+	this->journalVoxelIndices.clear();
+	for (Journal::VoxelChange &change : voxelChanges)
+	{
+		change.x += dx;
+		change.z += dz;
+		if ((change.x >= 0) && (change.x < this->voxelGrid.getWidth()) &&
+			(change.z >= 0) && (change.z < this->voxelGrid.getDepth()))
+		{
+			const int voxelIndex = change.x + (change.y * this->voxelGrid.getWidth()) +
+				(change.z * this->voxelGrid.getWidth() * this->voxelGrid.getHeight());
+			this->journalVoxelIndices.insert(
+				std::make_pair(voxelIndex, static_cast<int>(this->journal.voxels.size())));
+			this->journal.voxels.push_back(change);
+		}
+	}
+
+	this->activeDoors.scroll(dx, dz, this->voxelGrid.getWidth(), this->voxelGrid.getDepth());
+	this->navigation.scroll(dx, dz);
+
+	// Blocks that weren't in the old window are still empty.
+	std::vector<Int2> newBlocks;
+	const Int2 &origin = this->wilderness->getOrigin();
+	for (int z = 0; z < WildernessWindow::BLOCKS; z++)
+	{
+		for (int x = 0; x < WildernessWindow::BLOCKS; x++)
+		{
+			const Int2 block(origin.x + x, origin.y + z);
+			const Int2 oldSlot = block - oldOrigin;
+			if ((oldSlot.x < 0) || (oldSlot.x >= WildernessWindow::BLOCKS) ||
+				(oldSlot.y < 0) || (oldSlot.y >= WildernessWindow::BLOCKS))
+			{
+				newBlocks.push_back(block);
+			}
+		}
+	}
+
+	return newBlocks;
+}
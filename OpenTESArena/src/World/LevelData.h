@@ -3,14 +3,22 @@
 
 #include <array>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "ActiveDoors.h"
+#include "AutomapImage.h"
+#include "NavigationGrid.h"
 #include "VoxelGrid.h"
+#include "WildernessWindow.h"
 #include "../Assets/MIFFile.h"
 #include "../Math/Vector2.h"
+#include "../Math/Vector3.h"
+#include "../Rendering/LightMap.h"
+#include "../Rendering/PotentiallyVisibleSet.h"
 
 // Holds all the data necessary for defining the contents of a level.
 
@@ -25,26 +33,11 @@
 // |
 // Max (mapWidth - 1, mapDepth - 1)
 
-// Hash specialization for readFLOR() chasm mappings.
-namespace std
-{
-	template <>
-	struct hash<std::pair<uint16_t, std::array<bool, 4>>>
-	{
-		size_t operator()(const std::pair<uint16_t, std::array<bool, 4>> &p) const
-		{
-			// XOR with some arbitrary prime numbers (not sure if this is any good).
-			return static_cast<size_t>(p.first ^
-				(p.second.at(0) ? 41 : 73) ^
-				(p.second.at(1) ? 89 : 113) ^
-				(p.second.at(2) ? 127 : 149) ^
-				(p.second.at(3) ? 157 : 193));
-		}
-	};
-}
-
 class ArenaRandom;
+class AssetCache;
 class INFFile;
+class JobSystem;
+class LoadProgress;
 
 class LevelData
 {
@@ -75,34 +68,140 @@ public:
 		bool hasBeenDisplayed() const;
 		void setPreviouslyDisplayed(bool previouslyDisplayed);
 	};
+
+	// What the player changed in a level after it loaded. Levels always load the same from
+	// their files and seeds, so loading one again and applying its journal gives back the
+	// level the player left. Saved games only need to store this. In a wilderness, changes
+	// move with the voxels and are dropped when their block leaves the window.
+	struct Journal
+	{
+		struct VoxelChange
+		{
+			int x, y, z;
+			uint16_t id;
+			uint16_t originalID; // ID from loading, for reverting.
+		};
+
+		std::vector<VoxelChange> voxels; // At most one per voxel, in order of first change.
+		std::vector<Int2> displayedTextTriggers; // In order of display.
+
+		bool isEmpty() const;
+	};
 private:
 	std::unordered_map<Int2, Lock> locks;
 	std::unordered_map<Int2, TextTrigger> textTriggers;
 	std::unordered_map<Int2, std::string> soundTriggers;
 
-	// Mappings of IDs to voxel data indices. Chasms are treated separately since their voxel
-	// data index is also a function of the four adjacent voxels. These maps are stored here
-	// because they might be shared between multiple calls to read{FLOR,MAP1,MAP2}().
-	std::unordered_map<uint16_t, int> wallDataMappings, floorDataMappings, map2DataMappings;
-	std::unordered_map<std::pair<uint16_t, std::array<bool, 4>>, int> chasmDataMappings;
-
 	std::unique_ptr<uint32_t> interiorSkyColor; // Null for exteriors, non-null for interiors.
 	VoxelGrid voxelGrid;
+	Journal journal;
+	std::unordered_map<int, int> journalVoxelIndices; // Journal entry of each changed voxel.
+	AutomapImage automap; // Brought up to date with the voxel grid when the automap opens.
+	ActiveDoors activeDoors; // Doors that aren't closed. Not journaled, since doors close.
+	NavigationGrid navigation; // Where NPCs can walk, kept current with the voxels and doors.
+	std::vector<LightMap::Light> staticLights; // Light sources that never move.
+	std::shared_ptr<const LightMap> lightMap; // Static lights baked once the level is active.
+	std::shared_ptr<const PotentiallyVisibleSet> visibleSet; // Null unless baked (interiors).
+	std::unique_ptr<WildernessWindow> wilderness; // Null unless the level is a wilderness.
 	std::string name, infName;
 	double ceilingHeight;
 	bool outdoorDungeon;
 
+	// Version of cached levels. Increment it whenever generating levels or the layout of
+	// their cache entries changes, so levels cached by older builds are generated again.
+	static const uint32_t CACHE_VERSION;
+
 	// Private constructor for static LevelData load methods.
 	LevelData(int gridWidth, int gridHeight, int gridDepth);
 
+	// A city block's .MIF file and its index in the city plan.
+	struct CityBlock
+	{
+		std::string mifName;
+		int planIndex;
+	};
+
+	// Picks the .MIF file of each city block from the city's seed, drawing random numbers
+	// the same way as the original engine.
+	static std::vector<CityBlock> planCity(uint32_t citySeed, int cityDim,
+		const std::vector<uint8_t> &reservedBlocks);
+
+	// Gets the hash of everything a city is generated from, including the Arena files it's
+	// built from, for telling whether its cache entry is still current.
+	static uint64_t getCityCacheHash(const MIFFile::Level &level, uint32_t citySeed,
+		int cityDim, const std::vector<CityBlock> &cityBlocks, const Int2 &startPosition,
+		const INFFile &inf, int gridWidth, int gridDepth);
+
+	// Writes the level as it loaded for the asset cache. The voxel grid, its voxel data,
+	// locks, and triggers are in the machine's own byte order and aligned, so readCache()
+	// can use them straight from the mapped entry.
+	std::vector<uint8_t> writeCache() const;
+
+	// Fills a new level with the same dimensions from writeCache() data. Returns false if
+	// the data doesn't fit the level, in which case it has to be loaded some other way.
+	bool readCache(const uint8_t *data, size_t size);
+
+	// Generates a city from its planned blocks (see loadCity()).
+	static LevelData generateCity(const MIFFile::Level &level,
+		const std::vector<CityBlock> &cityBlocks, int cityDim, const Int2 &startPosition,
+		const INFFile &inf, int gridWidth, int gridDepth, JobSystem &jobSystem,
+		LoadProgress &progress);
+
 	void setVoxel(int x, int y, int z, uint16_t id);
-	void readFLOR(const uint16_t *flor, const INFFile &inf, int gridWidth, int gridDepth);
-	void readMAP1(const uint16_t *map1, const INFFile &inf, int gridWidth, int gridDepth);
-	void readMAP2(const uint16_t *map2, const INFFile &inf, int gridWidth, int gridDepth);
+
+	// Fills voxels upwards from the given Y using the function, which writes the voxel data
+	// at (X, Z) and returns its height (zero if empty), for each column in the given X and Z
+	// range. Columns are read in parallel if a job system is given, and the resulting voxel
+	// data IDs match a serial read.
+	void readVoxels(int startX, int endX, int startZ, int endZ, int y, JobSystem *jobSystem,
+		const std::function<int(int, int, VoxelData&)> &getVoxel);
+
+	// Gets the two-byte voxel at the given .MIF X and Z. Levels made of blocks read each
+	// voxel from the block covering it rather than copying the blocks into one array first.
+	// Called from several threads at once when reading with a job system.
+	using MIFVoxelFunction = std::function<uint16_t(int, int)>;
+
+	// Gets the voxel function for a whole .MIF array, with rows as long as the grid is deep.
+	static MIFVoxelFunction getArrayVoxels(const uint16_t *voxels, int gridDepth);
+
+	// The job system can be null for reading on the calling thread only. Either the whole
+	// grid is read or only the columns in the given X and Z range.
+	void readFLOR(const uint16_t *flor, const INFFile &inf, int gridWidth, int gridDepth,
+		JobSystem *jobSystem);
+	void readFLOR(const MIFVoxelFunction &getFlor, const INFFile &inf, int gridWidth,
+		int gridDepth, JobSystem *jobSystem);
+	void readFLOR(const MIFVoxelFunction &getFlor, const INFFile &inf, int gridWidth,
+		int gridDepth, int startX, int endX, int startZ, int endZ, JobSystem *jobSystem);
+	void readMAP1(const uint16_t *map1, const INFFile &inf, int gridWidth, int gridDepth,
+		JobSystem *jobSystem);
+	void readMAP1(const MIFVoxelFunction &getMap1, const INFFile &inf, int gridWidth,
+		int gridDepth, JobSystem *jobSystem);
+	void readMAP1(const MIFVoxelFunction &getMap1, const INFFile &inf, int gridWidth,
+		int gridDepth, int startX, int endX, int startZ, int endZ, JobSystem *jobSystem);
+	void readMAP2(const uint16_t *map2, int gridWidth, int gridDepth,
+		JobSystem *jobSystem);
+	void readMAP2(const MIFVoxelFunction &getMap2, int gridWidth, int gridDepth,
+		JobSystem *jobSystem);
+	void readMAP2(const MIFVoxelFunction &getMap2, int gridWidth, int gridDepth,
+		int startX, int endX, int startZ, int endZ, JobSystem *jobSystem);
 	void readCeiling(const INFFile &inf, int width, int depth);
+
+	// Finds the MAP1 flats that give off light (candles, torches, etc.). It's a separate pass
+	// from readMAP1() since those voxels aren't written to the grid, and the lights are in
+	// the same order however the grid was read.
+	void readStaticLights(const MIFVoxelFunction &getMap1, const INFFile &inf, int gridWidth,
+		int gridDepth);
 	void readLocks(const std::vector<MIFFile::Level::Lock> &locks, int width, int depth);
 	void readTriggers(const std::vector<MIFFile::Level::Trigger> &triggers, const INFFile &inf,
 		int width, int depth);
+
+	// Reads a wilderness block's voxels from the window into the voxel grid. The floors next
+	// to it are read again too, since their chasm walls depend on it.
+	void readWildernessBlock(const Int2 &block, const INFFile &inf, JobSystem *jobSystem);
+
+	// Moves the wilderness window and the voxel grid by the given number of blocks, and
+	// returns the blocks that came into view (still empty).
+	std::vector<Int2> scrollWilderness(const Int2 &blockDelta);
 public:
 	LevelData(LevelData &&levelData) = default;
 
@@ -121,13 +220,17 @@ public:
 
 	// Exterior level with a pre-defined .INF file (for randomly generated cities). This loads
 	// the skeleton of the level (city walls, etc.), and fills in the rest by loading the
-	// required .MIF chunks.
+	// required .MIF chunks. Each stage is reported to the progress, and the level is left
+	// empty if it's cancelled. Generated cities are kept in the asset cache when it's
+	// enabled, so entering the same city again reads it back instead.
 	static LevelData loadCity(const MIFFile::Level &level, uint32_t citySeed, int cityDim,
 		const std::vector<uint8_t> &reservedBlocks, const Int2 &startPosition,
-		const INFFile &inf, int gridWidth, int gridDepth);
+		const INFFile &inf, int gridWidth, int gridDepth, const AssetCache &assetCache,
+		JobSystem &jobSystem, LoadProgress &progress);
 
-	// Wilderness with a pre-defined .INF file. This loads the skeleton of the wilderness
-	// and fills in the rest by loading the required .RMD chunks.
+	// Wilderness with a pre-defined .INF file. Only the blocks in a window around the player
+	// are loaded at a time (see WildernessWindow), starting with the four given .RMD blocks
+	// around the middle of the grid. The rest come in with updateWilderness().
 	static LevelData loadWilderness(int rmdTR, int rmdTL, int rmdBR, int rmdBL,
 		const INFFile &inf);
 
@@ -141,9 +244,37 @@ public:
 	// Exteriors have dynamic sky palettes, so it cannot be stored by the level data.
 	uint32_t getInteriorSkyColor() const;
 
+	// Gets everything changed in the level since it loaded.
+	const Journal &getJournal() const;
+
 	VoxelGrid &getVoxelGrid();
 	const VoxelGrid &getVoxelGrid() const;
 
+	AutomapImage &getAutomap();
+
+	// Gets the doors that are opening, open, or closing.
+	ActiveDoors &getActiveDoors();
+	const ActiveDoors &getActiveDoors() const;
+
+	// Gets the walkable cells and the flow fields NPCs steer by.
+	NavigationGrid &getNavigation();
+	const NavigationGrid &getNavigation() const;
+
+	// Gets the light sources that never move, for baking into a light map.
+	const std::vector<LightMap::Light> &getStaticLights() const;
+
+	// Gets the baked static lights, or null if they haven't been baked yet.
+	const std::shared_ptr<const LightMap> &getLightMap() const;
+
+	// Keeps the baked static lights, so switching back to the level doesn't bake them again.
+	void setLightMap(const std::shared_ptr<const LightMap> &lightMap);
+
+	// Gets the baked chunk visibility, or null if it hasn't been baked.
+	const std::shared_ptr<const PotentiallyVisibleSet> &getVisibleSet() const;
+
+	// Keeps the baked chunk visibility for when the level is active again.
+	void setVisibleSet(const std::shared_ptr<const PotentiallyVisibleSet> &visibleSet);
+
 	// Returns a pointer to some lock if the given voxel has a lock, or null if it doesn't.
 	const Lock *getLock(const Int2 &voxel) const;
 
@@ -155,6 +286,39 @@ public:
 	// Returns a pointer to a sound filename if the given voxel has a sound trigger, or
 	// null if it doesn't.
 	const std::string *getSoundTrigger(const Int2 &voxel) const;
+
+	// Gets every sound trigger in the level, for loading their sounds ahead of time.
+	const std::unordered_map<Int2, std::string> &getSoundTriggers() const;
+
+	// Sets a voxel ID after loading and records it in the journal. The ID's voxel data must
+	// already exist. Gameplay changes to voxels should go through here rather than through
+	// the voxel grid, or they would be lost when the level is loaded again.
+	void changeVoxel(int x, int y, int z, uint16_t id);
+
+	// Marks the text trigger at the given voxel as displayed and records it in the journal.
+	void setTextTriggerDisplayed(const Int2 &voxel);
+
+	// Makes the changes in a journal from an earlier copy of this level. Changes that the
+	// level can't have (outside the grid or with unknown voxel IDs) are skipped.
+	void applyJournal(const Journal &journal);
+
+	// Undoes every change in the journal, giving back the level as it loaded.
+	void revertJournal();
+
+	// Gets the wilderness block at the top right of the level, or null if the level isn't a
+	// wilderness.
+	const Int2 *getWildernessOrigin() const;
+
+	// Moves the wilderness window so the given block is at its top right, and loads every
+	// block that came into view on the calling thread.
+	void setWildernessOrigin(const Int2 &origin);
+
+	// Brings in wilderness blocks around the player. Blocks that finished decoding on
+	// workers are read into the voxel grid, and if the player is far enough into another
+	// block, the level moves over by a block and starts decoding the new ones. Returns how
+	// far the level moved along X and Z in voxels, which the player should move too so
+	// they stay in the same place. Does nothing for levels that aren't a wilderness.
+	Int2 updateWilderness(const Double3 &playerPosition, JobSystem &jobSystem);
 };
 
 #endif
@@ -0,0 +1,504 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+
+#include "CollisionGrid.h"
+#include "NavigationGrid.h"
+#include "VoxelGrid.h"
+#include "../Utilities/Debug.h"
+
+namespace
+{
+	// Walkability of a cell.
+	const uint8_t CellBlocked = 0;
+	const uint8_t CellWalkable = 1;
+	const uint8_t CellClosedDoor = 2;
+
+	// Offsets to each neighbor, straight ones first so they win ties.
+	const std::array<Int2, 8> NeighborOffsets =
+	{
+		Int2(1, 0), Int2(-1, 0), Int2(0, 1), Int2(0, -1),
+		Int2(1, 1), Int2(1, -1), Int2(-1, 1), Int2(-1, -1)
+	};
+
+	// Costs roughly in proportion to the distance moved, kept as integers so fields come out
+	// the same however they're built.
+	const int StraightCost = 2;
+	const int DiagonalCost = 3;
+
+	int getStepCost(int directionIndex)
+	{
+		return (directionIndex < 4) ? StraightCost : DiagonalCost;
+	}
+
+	// Gets whether a move from the cell by one of the neighbor offsets stays on walkable
+	// cells without cutting a corner.
+	bool canStep(const std::vector<uint8_t> &walkable, int width, int depth, int x, int z,
+		int directionIndex)
+	{
+		auto isWalkable = [&walkable, width, depth](int cellX, int cellZ)
+		{
+			return (cellX >= 0) && (cellX < width) && (cellZ >= 0) && (cellZ < depth) &&
+				(walkable[cellX + (cellZ * width)] == CellWalkable);
+		};
+
+		const Int2 &offset = NeighborOffsets[directionIndex];
+		if (!isWalkable(x + offset.x, z + offset.y))
+		{
+			return false;
+		}
+
+		// Diagonal steps need both cells beside them open, so they don't clip a wall's
+		// corner.
+		const bool diagonal = (offset.x != 0) && (offset.y != 0);
+		return !diagonal || (isWalkable(x + offset.x, z) && isWalkable(x, z + offset.y));
+	}
+
+	// Cost and index of a cell waiting to be expanded, cheapest first.
+	typedef std::pair<int, int> QueuedCell;
+	typedef std::priority_queue<QueuedCell, std::vector<QueuedCell>,
+		std::greater<QueuedCell>> CellQueue;
+
+	// Takes cells off the queue in order of cost and lowers their neighbors' distances
+	// through them. Cells whose distance changed are added to the list, if given.
+	void spreadDistances(const std::vector<uint8_t> &walkable, int width, int depth,
+		CellQueue &queue, std::vector<int> &distances, std::vector<int> *changedIndices)
+	{
+		while (!queue.empty())
+		{
+			const QueuedCell queued = queue.top();
+			queue.pop();
+
+			const int distance = queued.first;
+			const int index = queued.second;
+			if (distance != distances[index])
+			{
+				// A cheaper way here was already expanded.
+				continue;
+			}
+
+			const int x = index % width;
+			const int z = index / width;
+			for (int i = 0; i < static_cast<int>(NeighborOffsets.size()); i++)
+			{
+				if (!canStep(walkable, width, depth, x, z, i))
+				{
+					continue;
+				}
+
+				const Int2 &offset = NeighborOffsets[i];
+				const int neighborIndex = (x + offset.x) + ((z + offset.y) * width);
+				const int neighborDistance = distance + getStepCost(i);
+				int &oldDistance = distances[neighborIndex];
+				if ((oldDistance < 0) || (neighborDistance < oldDistance))
+				{
+					oldDistance = neighborDistance;
+					queue.push(std::make_pair(neighborDistance, neighborIndex));
+
+					if (changedIndices != nullptr)
+					{
+						changedIndices->push_back(neighborIndex);
+					}
+				}
+			}
+		}
+	}
+}
+
+const int NavigationGrid::PLAYER_GOAL = 0;
+const int NavigationGrid::WALK_Y = 1;
+
+NavigationGrid::FlowField::FlowField(int width, int depth)
+	: distances(width * depth, -1), directions(width * depth, -1)
+{
+	this->width = width;
+	this->depth = depth;
+}
+
+Double2 NavigationGrid::FlowField::getDirection(int x, int z) const
+{
+	if ((x < 0) || (x >= this->width) || (z < 0) || (z >= this->depth))
+	{
+		return Double2();
+	}
+
+	const int directionIndex = this->directions[x + (z * this->width)];
+	if (directionIndex < 0)
+	{
+		return Double2();
+	}
+
+	const Int2 &offset = NeighborOffsets[directionIndex];
+	return Double2(static_cast<double>(offset.x), static_cast<double>(offset.y)).normalized();
+}
+
+int NavigationGrid::FlowField::getDistance(int x, int z) const
+{
+	if ((x < 0) || (x >= this->width) || (z < 0) || (z >= this->depth))
+	{
+		return -1;
+	}
+
+	return this->distances[x + (z * this->width)];
+}
+
+NavigationGrid::Goal::Goal()
+{
+	this->dirty = false;
+}
+
+NavigationGrid::NavigationGrid(int width, int depth)
+	: walkable(width * depth, CellBlocked)
+{
+	this->width = width;
+	this->depth = depth;
+	this->voxelRevision = -1;
+
+	// The player's goal is always there, even if nothing follows it yet.
+	const int playerGoal = this->addGoal();
+	DebugAssert(playerGoal == NavigationGrid::PLAYER_GOAL, "Player goal must be first.");
+	static_cast<void>(playerGoal);
+}
+
+void NavigationGrid::updateDirection(const std::vector<uint8_t> &walkable, int x, int z,
+	FlowField &field)
+{
+	const int index = x + (z * field.width);
+	const int distance = field.distances[index];
+
+	int8_t bestDirection = -1;
+	if (distance > 0)
+	{
+		int bestDistance = distance;
+		for (int i = 0; i < static_cast<int>(NeighborOffsets.size()); i++)
+		{
+			if (!canStep(walkable, field.width, field.depth, x, z, i))
+			{
+				continue;
+			}
+
+			const Int2 &offset = NeighborOffsets[i];
+			const int neighborDistance =
+				field.distances[(x + offset.x) + ((z + offset.y) * field.width)];
+			if ((neighborDistance >= 0) && (neighborDistance < bestDistance))
+			{
+				bestDistance = neighborDistance;
+				bestDirection = static_cast<int8_t>(i);
+			}
+		}
+	}
+
+	field.directions[index] = bestDirection;
+}
+
+void NavigationGrid::buildField(const std::vector<uint8_t> &walkable,
+	const std::vector<Int2> &goalCells, FlowField &field)
+{
+	const int width = field.width;
+	const int depth = field.depth;
+	std::fill(field.distances.begin(), field.distances.end(), -1);
+
+	CellQueue queue;
+	for (const Int2 &cell : goalCells)
+	{
+		if ((cell.x >= 0) && (cell.x < width) && (cell.y >= 0) && (cell.y < depth))
+		{
+			const int index = cell.x + (cell.y * width);
+			if ((walkable[index] == CellWalkable) && (field.distances[index] != 0))
+			{
+				field.distances[index] = 0;
+				queue.push(std::make_pair(0, index));
+			}
+		}
+	}
+
+	spreadDistances(walkable, width, depth, queue, field.distances, nullptr);
+
+	for (int z = 0; z < depth; z++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			NavigationGrid::updateDirection(walkable, x, z, field);
+		}
+	}
+}
+
+void NavigationGrid::relaxField(const std::vector<uint8_t> &walkable, int x, int z,
+	FlowField &field)
+{
+	const int width = field.width;
+	const int depth = field.depth;
+
+	// The opened cell and the ones around it might reach the goal more cheaply now, since
+	// diagonal steps past the cell are allowed too.
+	CellQueue queue;
+	std::vector<int> changedIndices;
+	for (int seedZ = std::max(z - 1, 0); seedZ <= std::min(z + 1, depth - 1); seedZ++)
+	{
+		for (int seedX = std::max(x - 1, 0); seedX <= std::min(x + 1, width - 1); seedX++)
+		{
+			const int seedIndex = seedX + (seedZ * width);
+			int &seedDistance = field.distances[seedIndex];
+			if (walkable[seedIndex] != CellWalkable)
+			{
+				continue;
+			}
+
+			for (int i = 0; i < static_cast<int>(NeighborOffsets.size()); i++)
+			{
+				if (!canStep(walkable, width, depth, seedX, seedZ, i))
+				{
+					continue;
+				}
+
+				const Int2 &offset = NeighborOffsets[i];
+				const int neighborDistance =
+					field.distances[(seedX + offset.x) + ((seedZ + offset.y) * width)];
+				if (neighborDistance < 0)
+				{
+					continue;
+				}
+
+				const int distance = neighborDistance + getStepCost(i);
+				if ((seedDistance < 0) || (distance < seedDistance))
+				{
+					seedDistance = distance;
+				}
+			}
+
+			changedIndices.push_back(seedIndex);
+			if (seedDistance >= 0)
+			{
+				queue.push(std::make_pair(seedDistance, seedIndex));
+			}
+		}
+	}
+
+	spreadDistances(walkable, width, depth, queue, field.distances, &changedIndices);
+
+	// Cells that got closer, and their neighbors, might point elsewhere now.
+	for (const int index : changedIndices)
+	{
+		const int cellX = index % width;
+		const int cellZ = index / width;
+		for (int neighborZ = std::max(cellZ - 1, 0);
+			neighborZ <= std::min(cellZ + 1, depth - 1); neighborZ++)
+		{
+			for (int neighborX = std::max(cellX - 1, 0);
+				neighborX <= std::min(cellX + 1, width - 1); neighborX++)
+			{
+				NavigationGrid::updateDirection(walkable, neighborX, neighborZ, field);
+			}
+		}
+	}
+}
+
+void NavigationGrid::readWalkable(const VoxelGrid &voxelGrid)
+{
+	DebugAssert((voxelGrid.getWidth() == this->width) && (voxelGrid.getDepth() == this->depth),
+		"Voxel grid size doesn't match the navigation grid.");
+
+	// A cell can be walked on if it has a floor that isn't a chasm and nothing solid above
+	// it. Doors are kept apart, since they can be walked through while open.
+	const CollisionGrid &collisionGrid = voxelGrid.getCollisionGrid();
+	for (int z = 0; z < this->depth; z++)
+	{
+		for (int x = 0; x < this->width; x++)
+		{
+			const uint8_t floorFlags = collisionGrid.getFlags(x, NavigationGrid::WALK_Y - 1, z);
+			const uint8_t flags = collisionGrid.getFlags(x, NavigationGrid::WALK_Y, z);
+			const bool hasFloor = ((floorFlags & CollisionGrid::SOLID) != 0) &&
+				((floorFlags & CollisionGrid::CHASM) == 0);
+
+			uint8_t &cell = this->walkable[x + (z * this->width)];
+			if (!hasFloor || ((flags & CollisionGrid::SOLID) != 0))
+			{
+				cell = CellBlocked;
+			}
+			else if ((flags & CollisionGrid::DOOR) != 0)
+			{
+				const bool open = this->openDoors.find(Int2(x, z)) != this->openDoors.end();
+				cell = open ? CellWalkable : CellClosedDoor;
+			}
+			else
+			{
+				cell = CellWalkable;
+			}
+		}
+	}
+}
+
+void NavigationGrid::markAllDirty()
+{
+	for (Goal &goal : this->goals)
+	{
+		goal.dirty = true;
+	}
+}
+
+int NavigationGrid::addGoal()
+{
+	this->goals.push_back(Goal());
+	return static_cast<int>(this->goals.size()) - 1;
+}
+
+void NavigationGrid::setGoal(int goalID, const std::vector<Int2> &cells)
+{
+	DebugAssert((goalID >= 0) && (goalID < static_cast<int>(this->goals.size())),
+		"Invalid navigation goal " + std::to_string(goalID) + ".");
+
+	Goal &goal = this->goals[goalID];
+	if (goal.cells != cells)
+	{
+		goal.cells = cells;
+		goal.dirty = true;
+	}
+}
+
+const NavigationGrid::FlowField *NavigationGrid::getField(int goalID) const
+{
+	DebugAssert((goalID >= 0) && (goalID < static_cast<int>(this->goals.size())),
+		"Invalid navigation goal " + std::to_string(goalID) + ".");
+
+	return this->goals[goalID].field.get();
+}
+
+Double2 NavigationGrid::getDirection(int goalID, const Double3 &point) const
+{
+	const FlowField *field = this->getField(goalID);
+	if (field == nullptr)
+	{
+		return Double2();
+	}
+
+	const int x = static_cast<int>(std::floor(point.x));
+	const int z = static_cast<int>(std::floor(point.z));
+	return field->getDirection(x, z);
+}
+
+void NavigationGrid::setDoorOpen(const Int3 &voxel, bool open)
+{
+	if ((voxel.y != NavigationGrid::WALK_Y) || (voxel.x < 0) || (voxel.x >= this->width) ||
+		(voxel.z < 0) || (voxel.z >= this->depth))
+	{
+		return;
+	}
+
+	const Int2 cell(voxel.x, voxel.z);
+	uint8_t &walkableCell = this->walkable[cell.x + (cell.y * this->width)];
+	if (open)
+	{
+		if (!this->openDoors.insert(cell).second || (walkableCell != CellClosedDoor))
+		{
+			return;
+		}
+
+		// Finished fields are updated through the door right away. Ones still building
+		// started without it, so they're built again afterwards.
+		walkableCell = CellWalkable;
+		for (Goal &goal : this->goals)
+		{
+			if (goal.field != nullptr)
+			{
+				NavigationGrid::relaxField(this->walkable, cell.x, cell.y, *goal.field);
+			}
+
+			if (goal.job != nullptr)
+			{
+				goal.dirty = true;
+			}
+		}
+	}
+	else
+	{
+		if ((this->openDoors.erase(cell) == 0) || (walkableCell != CellWalkable))
+		{
+			return;
+		}
+
+		// Paths through the door have to go another way, which could be anywhere.
+		walkableCell = CellClosedDoor;
+		this->markAllDirty();
+	}
+}
+
+void NavigationGrid::scroll(int dx, int dz)
+{
+	auto inGrid = [this](const Int2 &cell)
+	{
+		return (cell.x >= 0) && (cell.x < this->width) && (cell.y >= 0) &&
+			(cell.y < this->depth);
+	};
+
+	std::unordered_set<Int2> movedDoors;
+	for (const Int2 &cell : this->openDoors)
+	{
+		const Int2 movedCell(cell.x + dx, cell.y + dz);
+		if (inGrid(movedCell))
+		{
+			movedDoors.insert(movedCell);
+		}
+	}
+
+	this->openDoors = std::move(movedDoors);
+
+	for (Goal &goal : this->goals)
+	{
+		std::vector<Int2> movedCells;
+		for (const Int2 &cell : goal.cells)
+		{
+			const Int2 movedCell(cell.x + dx, cell.y + dz);
+			if (inGrid(movedCell))
+			{
+				movedCells.push_back(movedCell);
+			}
+		}
+
+		goal.cells = std::move(movedCells);
+	}
+
+	this->markAllDirty();
+}
+
+void NavigationGrid::update(const VoxelGrid &voxelGrid, JobSystem &jobSystem)
+{
+	if (voxelGrid.getRevision() != this->voxelRevision)
+	{
+		this->readWalkable(voxelGrid);
+		this->voxelRevision = voxelGrid.getRevision();
+		this->markAllDirty();
+	}
+
+	for (Goal &goal : this->goals)
+	{
+		if ((goal.job != nullptr) && jobSystem.isDone(goal.job))
+		{
+			goal.field = std::move(goal.pendingField);
+			goal.job = nullptr;
+		}
+
+		if (!goal.dirty || (goal.job != nullptr))
+		{
+			continue;
+		}
+
+		goal.dirty = false;
+		if (goal.cells.empty())
+		{
+			goal.field = nullptr;
+			continue;
+		}
+
+		// The job has its own copy of the walkable cells, so doors can change meanwhile.
+		auto field = std::make_shared<FlowField>(this->width, this->depth);
+		goal.pendingField = field;
+		goal.job = jobSystem.add([field, walkable = this->walkable, cells = goal.cells]()
+		{
+			NavigationGrid::buildField(walkable, cells, *field);
+		});
+	}
+}
@@ -0,0 +1,118 @@
+#ifndef NAVIGATION_GRID_H
+#define NAVIGATION_GRID_H
+
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "../Math/Vector2.h"
+#include "../Math/Vector3.h"
+#include "../Utilities/JobSystem.h"
+
+// Which XZ cells of a level's main floor can be walked on, taken from the voxel grid's
+// collision flags, and flow fields that lead every cell toward a few shared goals (the
+// player, a plaza, a city gate, etc.). However many NPCs head for a goal, they all read the
+// same field, so steering is one lookup per NPC instead of a path search each.
+
+// Fields are built on the job system, and readers always get the last finished one, so
+// they never wait. When a door opens, the fields are updated in place through it. Closing
+// doors and changed voxels rebuild them instead.
+
+class VoxelGrid;
+
+class NavigationGrid
+{
+public:
+	// Distances and directions toward the nearest cell of a goal. Moving diagonally costs
+	// more than moving straight, and doesn't cut past blocked corners.
+	class FlowField
+	{
+	private:
+		friend class NavigationGrid;
+
+		std::vector<int> distances; // Cost to the goal, or -1 if it can't be reached.
+		std::vector<int8_t> directions; // Index of the next cell's offset, or -1 if none.
+		int width, depth;
+	public:
+		FlowField(int width, int depth);
+
+		// Gets the unit XZ direction from the cell toward the goal, or zero if the cell is
+		// a goal, can't reach one, or is outside the grid.
+		Double2 getDirection(int x, int z) const;
+
+		// Gets the cost of reaching the goal from the cell, or -1 if it can't be reached.
+		int getDistance(int x, int z) const;
+	};
+
+	// Goal that follows the player. Other goals are added by whatever needs them.
+	static const int PLAYER_GOAL;
+private:
+	struct Goal
+	{
+		std::vector<Int2> cells;
+		std::shared_ptr<FlowField> field; // Last finished field, or null before the first.
+		std::shared_ptr<FlowField> pendingField; // Being built by the job, if any.
+		JobSystem::JobHandle job;
+		bool dirty; // Needs building again once the job in progress is done.
+
+		Goal();
+	};
+
+	// Height of the voxels that are walked through. The floor is the layer below.
+	static const int WALK_Y;
+
+	std::vector<uint8_t> walkable; // Whether each cell is blocked, walkable, or a closed door.
+	std::unordered_set<Int2> openDoors; // Door cells that can be walked through.
+	std::vector<Goal> goals;
+	int width, depth;
+	int voxelRevision; // Of the voxel grid when walkability was last read, or -1.
+
+	// Points the cell at its neighbor closest to the goal.
+	static void updateDirection(const std::vector<uint8_t> &walkable, int x, int z,
+		FlowField &field);
+
+	// Builds the field toward the goal cells from scratch.
+	static void buildField(const std::vector<uint8_t> &walkable,
+		const std::vector<Int2> &goalCells, FlowField &field);
+
+	// Lowers the field's distances through a cell that just became walkable, and spreads
+	// the change to every cell it makes closer.
+	static void relaxField(const std::vector<uint8_t> &walkable, int x, int z,
+		FlowField &field);
+
+	// Reads which cells are walkable from the voxel grid's collision flags.
+	void readWalkable(const VoxelGrid &voxelGrid);
+
+	void markAllDirty();
+public:
+	NavigationGrid(int width, int depth);
+
+	// Adds a goal with no cells, and returns its ID.
+	int addGoal();
+
+	// Sets the cells a goal's field leads to, rebuilding it if they changed.
+	void setGoal(int goalID, const std::vector<Int2> &cells);
+
+	// Gets the goal's last finished field, or null if none has finished yet.
+	const FlowField *getField(int goalID) const;
+
+	// Gets the unit XZ direction toward the goal from the given point, or zero if there
+	// isn't one yet.
+	Double2 getDirection(int goalID, const Double3 &point) const;
+
+	// Sets whether a door voxel can be walked through. Doors are only passable while fully
+	// open.
+	void setDoorOpen(const Int3 &voxel, bool open);
+
+	// Moves the open doors by the given X and Z along with the voxel grid. The fields are
+	// rebuilt from the moved voxels.
+	void scroll(int dx, int dz);
+
+	// Re-reads walkability if the voxel grid changed, swaps in fields that finished
+	// building, and starts building the ones that are out of date. Called on the main thread
+	// while nothing else reads the fields.
+	void update(const VoxelGrid &voxelGrid, JobSystem &jobSystem);
+};
+
+#endif
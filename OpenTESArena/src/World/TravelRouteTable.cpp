@@ -0,0 +1,66 @@
+#include "TravelRouteTable.h"
+#include "../Assets/MiscAssets.h"
+#include "../Utilities/JobSystem.h"
+
+TravelRouteTable::Row::Row()
+	: ready(false) { }
+
+const int TravelRouteTable::LOCATIONS_PER_PROVINCE = 48;
+
+int TravelRouteTable::getGlobalIndex(int locationID, int provinceID)
+{
+	return locationID + (provinceID * TravelRouteTable::LOCATIONS_PER_PROVINCE);
+}
+
+void TravelRouteTable::prepare(int startLocationID, int startProvinceID,
+	const CityDataFile &cityData, const MiscAssets &miscAssets, JobSystem &jobSystem)
+{
+	const int startIndex = TravelRouteTable::getGlobalIndex(startLocationID, startProvinceID);
+	if (this->rows.find(startIndex) != this->rows.end())
+	{
+		return;
+	}
+
+	// The row is shared with the job, so it stays alive if the table goes away first. The
+	// city data is copied for the same reason; location positions never change anyway.
+	std::shared_ptr<Row> row = std::make_shared<Row>();
+	this->rows.insert(std::make_pair(startIndex, row));
+
+	jobSystem.add([row, startLocationID, startProvinceID, cityData, &miscAssets]()
+	{
+		const int locationCount = CityDataFile::PROVINCE_COUNT *
+			TravelRouteTable::LOCATIONS_PER_PROVINCE;
+		row->routes.resize(locationCount);
+
+		for (int provinceID = 0; provinceID < CityDataFile::PROVINCE_COUNT; provinceID++)
+		{
+			for (int locationID = 0; locationID < TravelRouteTable::LOCATIONS_PER_PROVINCE;
+				locationID++)
+			{
+				const int index = TravelRouteTable::getGlobalIndex(locationID, provinceID);
+				row->routes[index] = cityData.getTravelRoute(startLocationID, startProvinceID,
+					locationID, provinceID, miscAssets);
+			}
+		}
+
+		row->ready.store(true, std::memory_order_release);
+	});
+}
+
+int TravelRouteTable::getTravelDays(int startLocationID, int startProvinceID,
+	int endLocationID, int endProvinceID, int month,
+	const std::array<WeatherType, 36> &weathers, ArenaRandom &random,
+	const CityDataFile &cityData, const MiscAssets &miscAssets) const
+{
+	const int startIndex = TravelRouteTable::getGlobalIndex(startLocationID, startProvinceID);
+	const auto iter = this->rows.find(startIndex);
+	if ((iter != this->rows.end()) && iter->second->ready.load(std::memory_order_acquire))
+	{
+		const int endIndex = TravelRouteTable::getGlobalIndex(endLocationID, endProvinceID);
+		const CityDataFile::TravelRoute &route = iter->second->routes.at(endIndex);
+		return CityDataFile::getTravelDays(route, month, weathers, random, miscAssets);
+	}
+
+	return cityData.getTravelDays(startLocationID, startProvinceID, endLocationID,
+		endProvinceID, month, weathers, random, miscAssets);
+}
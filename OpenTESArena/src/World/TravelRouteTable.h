@@ -0,0 +1,53 @@
+#ifndef TRAVEL_ROUTE_TABLE_H
+#define TRAVEL_ROUTE_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../Assets/CityDataFile.h"
+
+// The travel routes from a starting location to every location in the world, so picking a
+// destination doesn't walk the world map pixel by pixel each time. Rows are built on a
+// worker the first time a start location is prepared, and kept for when the player returns
+// there. Only the month and weather are applied when asking for travel days.
+
+class ArenaRandom;
+class JobSystem;
+class MiscAssets;
+
+enum class WeatherType;
+
+class TravelRouteTable
+{
+private:
+	// Routes from one start location, indexed by global location index.
+	struct Row
+	{
+		std::vector<CityDataFile::TravelRoute> routes;
+		std::atomic<bool> ready; // Set by the worker once the routes are filled in.
+
+		Row();
+	};
+
+	static const int LOCATIONS_PER_PROVINCE;
+
+	std::unordered_map<int, std::shared_ptr<Row>> rows; // Keyed by the start's global index.
+
+	static int getGlobalIndex(int locationID, int provinceID);
+public:
+	// Starts building the routes from the given location on a worker, unless they're
+	// already built or being built.
+	void prepare(int startLocationID, int startProvinceID, const CityDataFile &cityData,
+		const MiscAssets &miscAssets, JobSystem &jobSystem);
+
+	// Gets the number of days required to travel from one location to another. Uses the
+	// prepared route if its row is ready, otherwise walks the route here instead.
+	int getTravelDays(int startLocationID, int startProvinceID, int endLocationID,
+		int endProvinceID, int month, const std::array<WeatherType, 36> &weathers,
+		ArenaRandom &random, const CityDataFile &cityData, const MiscAssets &miscAssets) const;
+};
+
+#endif
@@ -1,10 +1,22 @@
 #include <cassert>
+#include <functional>
 #include <stdexcept>
 
 #include "VoxelData.h"
 #include "VoxelDataType.h"
 #include "../Utilities/Debug.h"
 
+namespace
+{
+	// Mixes a value into a running hash (the same way as boost::hash_combine).
+	template <typename T>
+	void combineHash(size_t &hash, const T &value)
+	{
+		const size_t valueHash = std::hash<T>()(value);
+		hash ^= valueHash + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+	}
+}
+
 bool VoxelData::ChasmData::faceIsVisible(VoxelData::Facing facing) const
 {
 	if (facing == VoxelData::Facing::PositiveX)
@@ -232,3 +244,138 @@ VoxelData VoxelData::makeDoor(int id, DoorData::Type type)
 
 	return data;
 }
+
+bool VoxelData::operator==(const VoxelData &other) const
+{
+	if (this->dataType != other.dataType)
+	{
+		return false;
+	}
+
+	if (this->dataType == VoxelDataType::Wall)
+	{
+		const WallData &a = this->wall;
+		const WallData &b = other.wall;
+		return (a.sideID == b.sideID) && (a.floorID == b.floorID) &&
+			(a.ceilingID == b.ceilingID) && (a.menuID == b.menuID) && (a.type == b.type);
+	}
+	else if (this->dataType == VoxelDataType::Floor)
+	{
+		return this->floor.id == other.floor.id;
+	}
+	else if (this->dataType == VoxelDataType::Ceiling)
+	{
+		return this->ceiling.id == other.ceiling.id;
+	}
+	else if (this->dataType == VoxelDataType::Raised)
+	{
+		const RaisedData &a = this->raised;
+		const RaisedData &b = other.raised;
+		return (a.sideID == b.sideID) && (a.floorID == b.floorID) &&
+			(a.ceilingID == b.ceilingID) && (a.yOffset == b.yOffset) &&
+			(a.ySize == b.ySize) && (a.vTop == b.vTop) && (a.vBottom == b.vBottom);
+	}
+	else if (this->dataType == VoxelDataType::Diagonal)
+	{
+		return (this->diagonal.id == other.diagonal.id) &&
+			(this->diagonal.type1 == other.diagonal.type1);
+	}
+	else if (this->dataType == VoxelDataType::TransparentWall)
+	{
+		return (this->transparentWall.id == other.transparentWall.id) &&
+			(this->transparentWall.collider == other.transparentWall.collider);
+	}
+	else if (this->dataType == VoxelDataType::Edge)
+	{
+		const EdgeData &a = this->edge;
+		const EdgeData &b = other.edge;
+		return (a.id == b.id) && (a.yOffset == b.yOffset) && (a.collider == b.collider) &&
+			(a.facing == b.facing);
+	}
+	else if (this->dataType == VoxelDataType::Chasm)
+	{
+		const ChasmData &a = this->chasm;
+		const ChasmData &b = other.chasm;
+		return (a.id == b.id) && (a.north == b.north) && (a.east == b.east) &&
+			(a.south == b.south) && (a.west == b.west) && (a.type == b.type);
+	}
+	else if (this->dataType == VoxelDataType::Door)
+	{
+		return (this->door.id == other.door.id) && (this->door.type == other.door.type);
+	}
+	else
+	{
+		// Empty voxels have no other data.
+		return true;
+	}
+}
+
+bool VoxelData::operator!=(const VoxelData &other) const
+{
+	return !(*this == other);
+}
+
+size_t VoxelData::getHash() const
+{
+	size_t hash = static_cast<size_t>(this->dataType);
+
+	if (this->dataType == VoxelDataType::Wall)
+	{
+		combineHash(hash, this->wall.sideID);
+		combineHash(hash, this->wall.floorID);
+		combineHash(hash, this->wall.ceilingID);
+		combineHash(hash, this->wall.menuID);
+		combineHash(hash, static_cast<int>(this->wall.type));
+	}
+	else if (this->dataType == VoxelDataType::Floor)
+	{
+		combineHash(hash, this->floor.id);
+	}
+	else if (this->dataType == VoxelDataType::Ceiling)
+	{
+		combineHash(hash, this->ceiling.id);
+	}
+	else if (this->dataType == VoxelDataType::Raised)
+	{
+		combineHash(hash, this->raised.sideID);
+		combineHash(hash, this->raised.floorID);
+		combineHash(hash, this->raised.ceilingID);
+		combineHash(hash, this->raised.yOffset);
+		combineHash(hash, this->raised.ySize);
+		combineHash(hash, this->raised.vTop);
+		combineHash(hash, this->raised.vBottom);
+	}
+	else if (this->dataType == VoxelDataType::Diagonal)
+	{
+		combineHash(hash, this->diagonal.id);
+		combineHash(hash, this->diagonal.type1);
+	}
+	else if (this->dataType == VoxelDataType::TransparentWall)
+	{
+		combineHash(hash, this->transparentWall.id);
+		combineHash(hash, this->transparentWall.collider);
+	}
+	else if (this->dataType == VoxelDataType::Edge)
+	{
+		combineHash(hash, this->edge.id);
+		combineHash(hash, this->edge.yOffset);
+		combineHash(hash, this->edge.collider);
+		combineHash(hash, static_cast<int>(this->edge.facing));
+	}
+	else if (this->dataType == VoxelDataType::Chasm)
+	{
+		combineHash(hash, this->chasm.id);
+		combineHash(hash, this->chasm.north);
+		combineHash(hash, this->chasm.east);
+		combineHash(hash, this->chasm.south);
+		combineHash(hash, this->chasm.west);
+		combineHash(hash, static_cast<int>(this->chasm.type));
+	}
+	else if (this->dataType == VoxelDataType::Door)
+	{
+		combineHash(hash, this->door.id);
+		combineHash(hash, static_cast<int>(this->door.type));
+	}
+
+	return hash;
+}
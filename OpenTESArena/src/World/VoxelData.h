@@ -1,6 +1,8 @@
 #ifndef VOXEL_DATA_H
 #define VOXEL_DATA_H
 
+#include <functional>
+
 // Voxel data is the definition of a voxel that a voxel ID points to. Since there will 
 // only be a few kinds of voxel data per world, their size can be much larger than just 
 // a byte or two.
@@ -130,6 +132,28 @@ public:
 	static VoxelData makeChasm(int id, bool north, bool east, bool south, bool west,
 		ChasmData::Type type);
 	static VoxelData makeDoor(int id, DoorData::Type type);
+
+	// Voxel data are equal when they have the same data type and the same values in that
+	// type's struct. Unused union members are ignored.
+	bool operator==(const VoxelData &other) const;
+	bool operator!=(const VoxelData &other) const;
+
+	// Gets a hash of the data type and the values in that type's struct, consistent with
+	// operator==.
+	size_t getHash() const;
 };
 
+// Hash specialization for interning voxel data.
+namespace std
+{
+	template <>
+	struct hash<VoxelData>
+	{
+		size_t operator()(const VoxelData &voxelData) const
+		{
+			return voxelData.getHash();
+		}
+	};
+}
+
 #endif
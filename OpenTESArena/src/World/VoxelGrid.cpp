@@ -1,16 +1,117 @@
 #include <algorithm>
+#include <atomic>
 
+#include "VoxelDataType.h"
 #include "VoxelGrid.h"
+#include "../Utilities/Debug.h"
 
-VoxelGrid::VoxelGrid(int width, int height, int depth)
+namespace
+{
+	// Revision numbers are handed out from one counter so no two grids ever have the same
+	// revision, even if one is built at another's old address.
+	std::atomic<int> NextRevision(0);
+	std::atomic<int> NextID(0);
+}
+
+const int VoxelGrid::CHUNK_SIZE = 16;
+const int VoxelGrid::MAX_CHUNK_CHANGES = 1024;
+
+VoxelGrid::VoxelGrid(int width, int height, int depth, VoxelGrid::Layout layout)
+	: collisionGrid(width, height, depth)
 {
-	const int voxelCount = width * height * depth;
-	this->voxels = std::vector<uint16_t>(voxelCount);
-	std::fill(this->voxels.begin(), this->voxels.end(), 0);
+	// Every chunk starts out as air, so none of them need their own voxels yet.
+	this->chunkCountX = (width + VoxelGrid::CHUNK_SIZE - 1) / VoxelGrid::CHUNK_SIZE;
+	this->chunkCountZ = (depth + VoxelGrid::CHUNK_SIZE - 1) / VoxelGrid::CHUNK_SIZE;
+	this->chunks = std::vector<uint16_t*>(this->chunkCountX * this->chunkCountZ, nullptr);
+	this->airChunk = std::vector<uint16_t>(
+		VoxelGrid::CHUNK_SIZE * VoxelGrid::CHUNK_SIZE * height, 0);
+
+	this->chunkPool = this->makeChunkPool();
+
+	// Every column starts out with only empty voxels.
+	this->plainColumns = std::vector<uint8_t>(width * depth, 1);
 
 	this->width = width;
 	this->height = height;
 	this->depth = depth;
+	this->revision = NextRevision++;
+	this->id = NextID++;
+	this->layout = layout;
+	this->chunkRevisions = std::vector<int>(this->chunks.size(), this->revision);
+	this->chunkChangesStart = this->revision;
+	this->packed = false;
+}
+
+VoxelGrid::VoxelGrid(int width, int height, int depth)
+	: VoxelGrid(width, height, depth, VoxelGrid::Layout::YFirst) { }
+
+std::unique_ptr<PoolAllocator> VoxelGrid::makeChunkPool() const
+{
+	// Small grids don't need a whole default-sized page for their chunks.
+	const size_t allChunksSize = this->chunks.size() * this->airChunk.size() * sizeof(uint16_t);
+	return std::make_unique<PoolAllocator>(
+		std::min(allChunksSize, PoolAllocator::DEFAULT_PAGE_SIZE), MemoryTag::LevelData);
+}
+
+int VoxelGrid::getChunkVoxelIndex(int x, int y, int z) const
+{
+	const int chunkX = x % VoxelGrid::CHUNK_SIZE;
+	const int chunkZ = z % VoxelGrid::CHUNK_SIZE;
+	const int sliceIndex = chunkZ * VoxelGrid::CHUNK_SIZE * this->height;
+	return (this->layout == VoxelGrid::Layout::YFirst) ?
+		(y + (chunkX * this->height) + sliceIndex) :
+		(chunkX + (y * VoxelGrid::CHUNK_SIZE) + sliceIndex);
+}
+
+const uint16_t *VoxelGrid::getChunkVoxels(int x, int z) const
+{
+	const int chunkIndex = (x / VoxelGrid::CHUNK_SIZE) +
+		((z / VoxelGrid::CHUNK_SIZE) * this->chunkCountX);
+	const uint16_t *chunk = this->chunks[chunkIndex];
+	return (chunk == nullptr) ? this->airChunk.data() : chunk;
+}
+
+void VoxelGrid::updatePlainColumn(int x, int z)
+{
+	const uint16_t *column = this->getColumn(x, z);
+	const int stride = this->getColumnStride();
+
+	bool plain = true;
+	for (int y = 0; (y < this->height) && plain; y++)
+	{
+		const uint16_t id = column[y * stride];
+		const VoxelDataType dataType = this->voxelData.at(id).dataType;
+		plain = (dataType == VoxelDataType::None) || (dataType == VoxelDataType::Floor) ||
+			(dataType == VoxelDataType::Ceiling);
+	}
+
+	this->plainColumns[x + (z * this->width)] = plain ? 1 : 0;
+}
+
+void VoxelGrid::recordChunkChange(int chunkIndex)
+{
+	this->revision = NextRevision++;
+	this->chunkRevisions[chunkIndex] = this->revision;
+
+	// Runs of writes to one chunk (i.e., while a level is built) only need one entry.
+	if ((this->chunkChanges.size() > 0) && (this->chunkChanges.back().chunkIndex == chunkIndex))
+	{
+		this->chunkChanges.back().revision = this->revision;
+	}
+	else
+	{
+		if (this->chunkChanges.size() == (VoxelGrid::MAX_CHUNK_CHANGES * 2))
+		{
+			const auto keptBegin = this->chunkChanges.end() - VoxelGrid::MAX_CHUNK_CHANGES;
+			this->chunkChangesStart = (keptBegin - 1)->revision;
+			this->chunkChanges.erase(this->chunkChanges.begin(), keptBegin);
+		}
+
+		VoxelGrid::ChunkChange change;
+		change.revision = this->revision;
+		change.chunkIndex = chunkIndex;
+		this->chunkChanges.push_back(change);
+	}
 }
 
 Int2 VoxelGrid::getTransformedCoordinate(const Int2 &voxel, int gridWidth, int gridDepth)
@@ -45,19 +146,122 @@ int VoxelGrid::getDepth() const
 	return this->depth;
 }
 
-uint16_t *VoxelGrid::getVoxels()
+int VoxelGrid::getRevision() const
 {
-	return this->voxels.data();
+	return this->revision;
 }
 
-const uint16_t *VoxelGrid::getVoxels() const
+int VoxelGrid::getID() const
 {
-	return this->voxels.data();
+	return this->id;
 }
 
-VoxelData &VoxelGrid::getVoxelData(uint16_t id)
+int VoxelGrid::getVoxelDataCount() const
 {
-	return this->voxelData.at(id);
+	return static_cast<int>(this->voxelData.size());
+}
+
+VoxelGrid::Layout VoxelGrid::getLayout() const
+{
+	return this->layout;
+}
+
+int VoxelGrid::getChunkCountX() const
+{
+	return this->chunkCountX;
+}
+
+int VoxelGrid::getChunkCountZ() const
+{
+	return this->chunkCountZ;
+}
+
+bool VoxelGrid::isAirChunk(int chunkX, int chunkZ) const
+{
+	return this->chunks[chunkX + (chunkZ * this->chunkCountX)] == nullptr;
+}
+
+const uint16_t *VoxelGrid::getChunk(int chunkX, int chunkZ) const
+{
+	DebugAssert(!this->packed, "Can't get chunks of a packed grid.");
+	return this->chunks[chunkX + (chunkZ * this->chunkCountX)];
+}
+
+int VoxelGrid::getChunkVoxelCount() const
+{
+	return static_cast<int>(this->airChunk.size());
+}
+
+int VoxelGrid::getChunkRevision(int chunkX, int chunkZ) const
+{
+	return this->chunkRevisions[chunkX + (chunkZ * this->chunkCountX)];
+}
+
+bool VoxelGrid::getChangedChunks(int sinceRevision, std::vector<Int2> &chunks) const
+{
+	chunks.clear();
+
+	if (sinceRevision < this->chunkChangesStart)
+	{
+		return false;
+	}
+
+	// The log is in revision order, so only its end can be newer.
+	auto iter = std::upper_bound(this->chunkChanges.begin(), this->chunkChanges.end(),
+		sinceRevision, [](int revision, const VoxelGrid::ChunkChange &change)
+	{
+		return revision < change.revision;
+	});
+
+	for (; iter != this->chunkChanges.end(); ++iter)
+	{
+		chunks.push_back(Int2(iter->chunkIndex % this->chunkCountX,
+			iter->chunkIndex / this->chunkCountX));
+	}
+
+	return true;
+}
+
+uint16_t VoxelGrid::getVoxel(int x, int y, int z) const
+{
+	return this->getChunkVoxels(x, z)[this->getChunkVoxelIndex(x, y, z)];
+}
+
+const uint16_t *VoxelGrid::getColumn(int x, int z) const
+{
+	return this->getChunkVoxels(x, z) + this->getChunkVoxelIndex(x, 0, z);
+}
+
+int VoxelGrid::getColumnStride() const
+{
+	return (this->layout == VoxelGrid::Layout::YFirst) ? 1 : VoxelGrid::CHUNK_SIZE;
+}
+
+bool VoxelGrid::isPlainColumn(int x, int z) const
+{
+	return this->plainColumns[x + (z * this->width)] != 0;
+}
+
+bool VoxelGrid::columnsMatch(int x1, int z1, int x2, int z2) const
+{
+	const int stride = this->getColumnStride();
+	const uint16_t *column1 = this->getColumn(x1, z1);
+	const uint16_t *column2 = this->getColumn(x2, z2);
+
+	for (int y = 0; y < this->height; y++)
+	{
+		if (column1[y * stride] != column2[y * stride])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const CollisionGrid &VoxelGrid::getCollisionGrid() const
+{
+	return this->collisionGrid;
 }
 
 const VoxelData &VoxelGrid::getVoxelData(uint16_t id) const
@@ -65,9 +269,308 @@ const VoxelData &VoxelGrid::getVoxelData(uint16_t id) const
 	return this->voxelData.at(id);
 }
 
+void VoxelGrid::setVoxel(int x, int y, int z, uint16_t id)
+{
+	DebugAssert(!this->packed, "Can't set voxels of a packed grid.");
+
+	const int chunkIndex = (x / VoxelGrid::CHUNK_SIZE) +
+		((z / VoxelGrid::CHUNK_SIZE) * this->chunkCountX);
+	uint16_t *&chunk = this->chunks[chunkIndex];
+
+	// Air chunks only get their own copy once something non-empty is written to them.
+	if ((chunk == nullptr) && (id != 0))
+	{
+		chunk = static_cast<uint16_t*>(
+			this->chunkPool->allocate(this->airChunk.size() * sizeof(uint16_t)));
+		std::copy(this->airChunk.begin(), this->airChunk.end(), chunk);
+	}
+
+	if (chunk != nullptr)
+	{
+		chunk[this->getChunkVoxelIndex(x, y, z)] = id;
+	}
+
+	this->updatePlainColumn(x, z);
+	this->collisionGrid.setFlags(x, y, z, this->voxelDataCollisionFlags.at(id));
+	this->recordChunkChange(chunkIndex);
+}
+
+void VoxelGrid::setChunk(int chunkX, int chunkZ, const uint16_t *voxels)
+{
+	DebugAssert(!this->packed, "Can't set voxels of a packed grid.");
+
+	const int chunkIndex = chunkX + (chunkZ * this->chunkCountX);
+	uint16_t *&chunk = this->chunks[chunkIndex];
+	const size_t chunkVoxelCount = this->airChunk.size();
+	const bool air = std::all_of(voxels, voxels + chunkVoxelCount,
+		[](uint16_t id) { return id == 0; });
+
+	if ((chunk == nullptr) && !air)
+	{
+		chunk = static_cast<uint16_t*>(
+			this->chunkPool->allocate(chunkVoxelCount * sizeof(uint16_t)));
+	}
+
+	if (chunk != nullptr)
+	{
+		std::copy(voxels, voxels + chunkVoxelCount, chunk);
+	}
+
+	// Columns past the grid's edge are only padding, so they have no flags to update.
+	const int startX = chunkX * VoxelGrid::CHUNK_SIZE;
+	const int startZ = chunkZ * VoxelGrid::CHUNK_SIZE;
+	const int endX = std::min(startX + VoxelGrid::CHUNK_SIZE, this->width);
+	const int endZ = std::min(startZ + VoxelGrid::CHUNK_SIZE, this->depth);
+	const int stride = this->getColumnStride();
+
+	for (int z = startZ; z < endZ; z++)
+	{
+		for (int x = startX; x < endX; x++)
+		{
+			const uint16_t *column = this->getColumn(x, z);
+			for (int y = 0; y < this->height; y++)
+			{
+				const uint16_t id = column[y * stride];
+				this->collisionGrid.setFlags(x, y, z, this->voxelDataCollisionFlags.at(id));
+			}
+
+			this->updatePlainColumn(x, z);
+		}
+	}
+
+	this->recordChunkChange(chunkIndex);
+}
+
+void VoxelGrid::copyChangesFrom(const VoxelGrid &grid)
+{
+	DebugAssert((grid.width == this->width) && (grid.height == this->height) &&
+		(grid.depth == this->depth) && (grid.layout == this->layout),
+		"Voxel grids must match to copy changes.");
+	DebugAssert(!this->packed && !grid.packed, "Can't copy changes of packed grids.");
+
+	if ((grid.id == this->id) && (grid.revision == this->revision))
+	{
+		return;
+	}
+
+	const size_t chunkSize = this->airChunk.size() * sizeof(uint16_t);
+	auto copyChunk = [this, &grid, chunkSize](int i)
+	{
+		if (grid.chunkRevisions[i] == this->chunkRevisions[i])
+		{
+			return;
+		}
+
+		const uint16_t *srcChunk = grid.chunks[i];
+		uint16_t *&dstChunk = this->chunks[i];
+		if (srcChunk == nullptr)
+		{
+			if (dstChunk != nullptr)
+			{
+				this->chunkPool->deallocate(dstChunk);
+				dstChunk = nullptr;
+			}
+		}
+		else
+		{
+			if (dstChunk == nullptr)
+			{
+				dstChunk = static_cast<uint16_t*>(this->chunkPool->allocate(chunkSize));
+			}
+
+			std::copy(srcChunk, srcChunk + this->airChunk.size(), dstChunk);
+		}
+
+		this->chunkRevisions[i] = grid.chunkRevisions[i];
+	};
+
+	// If this grid was last copied from the same one, only the chunks in its log since
+	// then can differ. Otherwise every chunk's revision is compared.
+	std::vector<Int2> changedChunks;
+	if ((grid.id == this->id) && grid.getChangedChunks(this->revision, changedChunks))
+	{
+		for (const Int2 &chunk : changedChunks)
+		{
+			copyChunk(chunk.x + (chunk.y * this->chunkCountX));
+		}
+	}
+	else
+	{
+		for (int i = 0; i < static_cast<int>(this->chunks.size()); i++)
+		{
+			copyChunk(i);
+		}
+	}
+
+	// The rest is small next to the voxels, so it's copied whole.
+	this->voxelData = grid.voxelData;
+	this->voxelDataIDs = grid.voxelDataIDs;
+	this->plainColumns = grid.plainColumns;
+	this->voxelDataCollisionFlags = grid.voxelDataCollisionFlags;
+	this->collisionGrid = grid.collisionGrid;
+	this->chunkChanges = grid.chunkChanges;
+	this->chunkChangesStart = grid.chunkChangesStart;
+	this->revision = grid.revision;
+	this->id = grid.id;
+}
+
+void VoxelGrid::scroll(int chunkDX, int chunkDZ)
+{
+	DebugAssert(((this->width % VoxelGrid::CHUNK_SIZE) == 0) &&
+		((this->depth % VoxelGrid::CHUNK_SIZE) == 0),
+		"Only grids of whole chunks can be scrolled.");
+	DebugAssert(!this->packed, "Can't scroll a packed grid.");
+
+	// Chunks keep their storage as they move. Ones pushed off the grid are freed, and their
+	// space is used again by the next chunks that need it.
+	std::vector<uint16_t*> newChunks(this->chunks.size(), nullptr);
+	for (int chunkZ = 0; chunkZ < this->chunkCountZ; chunkZ++)
+	{
+		for (int chunkX = 0; chunkX < this->chunkCountX; chunkX++)
+		{
+			uint16_t *chunk = this->chunks[chunkX + (chunkZ * this->chunkCountX)];
+			const int newChunkX = chunkX + chunkDX;
+			const int newChunkZ = chunkZ + chunkDZ;
+			if ((newChunkX >= 0) && (newChunkX < this->chunkCountX) &&
+				(newChunkZ >= 0) && (newChunkZ < this->chunkCountZ))
+			{
+				newChunks[newChunkX + (newChunkZ * this->chunkCountX)] = chunk;
+			}
+			else if (chunk != nullptr)
+			{
+				this->chunkPool->deallocate(chunk);
+			}
+		}
+	}
+
+	this->chunks = std::move(newChunks);
+
+	// Columns moved in are all air, which is plain.
+	const int dx = chunkDX * VoxelGrid::CHUNK_SIZE;
+	const int dz = chunkDZ * VoxelGrid::CHUNK_SIZE;
+	std::vector<uint8_t> newPlainColumns(this->plainColumns.size(), 1);
+	for (int z = std::max(0, -dz); z < std::min(this->depth, this->depth - dz); z++)
+	{
+		for (int x = std::max(0, -dx); x < std::min(this->width, this->width - dx); x++)
+		{
+			newPlainColumns[(x + dx) + ((z + dz) * this->width)] =
+				this->plainColumns[x + (z * this->width)];
+		}
+	}
+
+	this->plainColumns = std::move(newPlainColumns);
+	this->collisionGrid.scroll(dx, dz);
+	this->revision = NextRevision++;
+	std::fill(this->chunkRevisions.begin(), this->chunkRevisions.end(), this->revision);
+
+	// Every chunk changed, so the log can't say anything useful about older revisions.
+	this->chunkChanges.clear();
+	this->chunkChangesStart = this->revision;
+}
+
+bool VoxelGrid::isPacked() const
+{
+	return this->packed;
+}
+
+void VoxelGrid::pack()
+{
+	if (this->packed)
+	{
+		return;
+	}
+
+	const int chunkVoxelCount = static_cast<int>(this->airChunk.size());
+	this->packedRuns.clear();
+	this->packedChunkOffsets.resize(this->chunks.size() + 1);
+	for (size_t i = 0; i < this->chunks.size(); i++)
+	{
+		this->packedChunkOffsets[i] = static_cast<int>(this->packedRuns.size());
+
+		// Air chunks have no runs.
+		const uint16_t *chunk = this->chunks[i];
+		if (chunk == nullptr)
+		{
+			continue;
+		}
+
+		int start = 0;
+		while (start < chunkVoxelCount)
+		{
+			const uint16_t id = chunk[start];
+			int end = start + 1;
+			while ((end < chunkVoxelCount) && (chunk[end] == id) &&
+				((end - start) < UINT16_MAX))
+			{
+				end++;
+			}
+
+			this->packedRuns.push_back(id);
+			this->packedRuns.push_back(static_cast<uint16_t>(end - start));
+			start = end;
+		}
+	}
+
+	this->packedChunkOffsets.back() = static_cast<int>(this->packedRuns.size());
+	this->packedRuns.shrink_to_fit();
+
+	// A new pool gives the old one's pages back, which freeing each chunk wouldn't.
+	std::fill(this->chunks.begin(), this->chunks.end(), nullptr);
+	this->chunkPool = this->makeChunkPool();
+	this->packed = true;
+}
+
+void VoxelGrid::unpack()
+{
+	if (!this->packed)
+	{
+		return;
+	}
+
+	const size_t chunkSize = this->airChunk.size() * sizeof(uint16_t);
+	for (size_t i = 0; i < this->chunks.size(); i++)
+	{
+		const int runsBegin = this->packedChunkOffsets[i];
+		const int runsEnd = this->packedChunkOffsets[i + 1];
+
+		// A chunk that's one run of empty voxels can go back to being air.
+		if ((runsBegin == runsEnd) ||
+			(((runsEnd - runsBegin) == 2) && (this->packedRuns[runsBegin] == 0)))
+		{
+			continue;
+		}
+
+		uint16_t *chunk = static_cast<uint16_t*>(this->chunkPool->allocate(chunkSize));
+		uint16_t *dst = chunk;
+		for (int j = runsBegin; j < runsEnd; j += 2)
+		{
+			const uint16_t id = this->packedRuns[j];
+			const uint16_t count = this->packedRuns[j + 1];
+			std::fill(dst, dst + count, id);
+			dst += count;
+		}
+
+		this->chunks[i] = chunk;
+	}
+
+	this->packedRuns = std::vector<uint16_t>();
+	this->packedChunkOffsets = std::vector<int>();
+	this->packed = false;
+}
+
 uint16_t VoxelGrid::addVoxelData(const VoxelData &voxelData)
 {
+	const auto iter = this->voxelDataIDs.find(voxelData);
+	if (iter != this->voxelDataIDs.end())
+	{
+		return iter->second;
+	}
+
+	const uint16_t id = static_cast<uint16_t>(this->voxelData.size());
 	this->voxelData.push_back(voxelData);
+	this->voxelDataIDs.insert(std::make_pair(voxelData, id));
+	this->voxelDataCollisionFlags.push_back(CollisionGrid::makeFlags(voxelData));
+	this->revision = NextRevision++;
 
-	return static_cast<uint16_t>(this->voxelData.size() - 1);
+	return id;
 }
@@ -2,10 +2,14 @@
 #define VOXEL_GRID_H
 
 #include <cstdint>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
+#include "CollisionGrid.h"
 #include "VoxelData.h"
 #include "../Math/Vector2.h"
+#include "../Utilities/PoolAllocator.h"
 
 // A voxel grid is a 3D array of voxel IDs with their associated voxel definitions.
 
@@ -13,13 +17,105 @@
 // there are over a few hundred unique voxel data definitions, which mandates that the voxel
 // type itself be at least unsigned 16-bit.
 
+// The grid also remembers which XZ columns are "plain" (only empty, floor, and ceiling
+// voxels). Those only draw horizontal surfaces, so the renderer can step over runs of 
+// matching ones at once. Voxel IDs should be written with setVoxel() to keep this current.
+
+// Collision flags for every voxel are kept in a collision grid the same way, so movement
+// code doesn't need to look up voxel data.
+
+// A revision number also changes with every setVoxel() and every new definition from
+// addVoxelData(), so a renderer can tell whether the grid is the same as in its last frame.
+// Revisions are unique across all grids. Each chunk also keeps the revision of its last
+// change, so things built from part of the grid (like the automap) can redo just that part.
+// Recent chunk changes are also kept in a log in revision order, so those things can ask
+// which chunks changed since their last update instead of checking every chunk. Only so
+// many are kept, and anything older than the log has to be rebuilt from scratch.
+
+// Voxels are stored in chunks of CHUNK_SIZE x CHUNK_SIZE XZ columns at full height. Chunks
+// that are still all empty (ID 0) share a single read-only air chunk, and get their own
+// storage the first time a non-empty voxel is written to them. That storage comes from the
+// grid's own pool, so a level's voxels are contiguous and are freed all at once with it.
+
+// The order of voxels within a chunk is selectable. Arena's own order has X change fastest,
+// but the renderers and collision mostly walk up and down XZ columns, so by default each
+// column's Y voxels are next to each other instead. Code outside the grid should go through
+// the accessors rather than computing indices itself.
+
+// A grid can also be kept as a snapshot of another one with the same dimensions, for reading
+// on another thread while the original changes. Updating it only copies the chunks whose
+// revision changed, so a snapshot of a mostly static level costs almost nothing per frame.
+
+// A grid that won't be used for a while (like an inactive level) can be packed. Each chunk's
+// voxels become runs of equal IDs, which are short since levels are mostly long stretches of
+// the same floor, wall, or air, and the chunks' pages are freed. It has to be unpacked before
+// its voxels are read or written again.
+
+// A grid can also be scrolled by whole chunks, for levels that are a window onto a bigger
+// world (like the wilderness). Chunks moved off the grid go back to the pool and the ones
+// moved in are air, so the grid's memory stays the same however far it's scrolled. Its
+// dimensions must be whole chunks for this.
+
 class VoxelGrid
 {
+public:
+	enum class Layout
+	{
+		XFirst, // x + (y * CHUNK_SIZE) + (z * CHUNK_SIZE * height) within a chunk.
+		YFirst // y + (x * height) + (z * CHUNK_SIZE * height) within a chunk.
+	};
+
+	// Width and depth of a chunk in voxels.
+	static const int CHUNK_SIZE;
 private:
-	std::vector<uint16_t> voxels;
+	// A chunk that changed, and the grid revision of the change.
+	struct ChunkChange
+	{
+		int revision;
+		int chunkIndex;
+	};
+
+	// Most chunk changes kept in the log. It's trimmed back to this once it's twice as long.
+	static const int MAX_CHUNK_CHANGES;
+
+	std::unique_ptr<PoolAllocator> chunkPool; // Storage of every chunk that isn't air.
+	std::vector<uint16_t*> chunks; // Null for chunks that are all air.
+	std::vector<uint16_t> airChunk; // Shared by every chunk that is all air.
 	std::vector<VoxelData> voxelData;
+	std::unordered_map<VoxelData, uint16_t> voxelDataIDs; // For finding existing definitions.
+	std::vector<int> chunkRevisions; // Revision of each chunk's last setVoxel().
+	std::vector<uint16_t> packedRuns; // (ID, count) pairs of each chunk's voxels while packed.
+	std::vector<int> packedChunkOffsets; // Where each chunk's runs start, plus the end.
+	std::vector<VoxelGrid::ChunkChange> chunkChanges; // Recent changes, oldest first.
+	int chunkChangesStart; // Revision the log starts after. Older changes weren't kept.
+	std::vector<uint8_t> plainColumns; // Non-zero for each plain XZ column.
+	std::vector<uint8_t> voxelDataCollisionFlags; // Collision flags of each voxel ID.
+	CollisionGrid collisionGrid;
 	int width, height, depth;
+	int chunkCountX, chunkCountZ;
+	int revision;
+	int id; // Unique to each grid's history of revisions, so shared by its snapshots.
+	VoxelGrid::Layout layout;
+	bool packed;
+
+	// Makes an empty pool for the chunks' storage, sized for the grid.
+	std::unique_ptr<PoolAllocator> makeChunkPool() const;
+
+	// Gets the index of a voxel within its chunk.
+	int getChunkVoxelIndex(int x, int y, int z) const;
+
+	// Gets the voxel IDs of the chunk containing the given XZ column.
+	const uint16_t *getChunkVoxels(int x, int z) const;
+
+	// Recalculates whether the given XZ column is plain.
+	void updatePlainColumn(int x, int z);
+
+	// Gives the chunk a new revision and adds it to the change log.
+	void recordChunkChange(int chunkIndex);
 public:
+	VoxelGrid(int width, int height, int depth, VoxelGrid::Layout layout);
+
+	// Uses the Y-first layout.
 	VoxelGrid(int width, int height, int depth);
 
 	// Transformation methods for converting voxel coordinates between Arena's format
@@ -33,15 +129,90 @@ public:
 	int getHeight() const;
 	int getDepth() const;
 
-	// Gets a pointer to the voxel grid data.
-	uint16_t *getVoxels();
-	const uint16_t *getVoxels() const;
+	// Gets a number that changes whenever the grid's voxels or voxel data change.
+	int getRevision() const;
+
+	// Gets a number unique to this grid, for telling whether a revision came from it. A
+	// snapshot takes on the ID of the grid it copies.
+	int getID() const;
 
-	// Gets the voxel data associated with an ID.
-	VoxelData &getVoxelData(uint16_t id);
+	// Gets the number of voxel data definitions (one past the highest voxel ID).
+	int getVoxelDataCount() const;
+
+	// Gets how the voxels are ordered in memory.
+	VoxelGrid::Layout getLayout() const;
+
+	// Gets the number of chunks along X and Z.
+	int getChunkCountX() const;
+	int getChunkCountZ() const;
+
+	// Returns whether the chunk has nothing but empty voxels, so it can be skipped whole.
+	bool isAirChunk(int chunkX, int chunkZ) const;
+
+	// Gets the voxel IDs of a chunk in the grid's layout, or null if it's all air. Each
+	// chunk has getChunkVoxelCount() of them.
+	const uint16_t *getChunk(int chunkX, int chunkZ) const;
+	int getChunkVoxelCount() const;
+
+	// Gets the grid revision of the chunk's most recent setVoxel(), or of the grid's
+	// creation if it hasn't had any.
+	int getChunkRevision(int chunkX, int chunkZ) const;
+
+	// Gets the chunks changed since the given revision of this grid, oldest change first.
+	// A chunk changed more than once may be listed more than once. Returns false if the
+	// log doesn't go back that far, in which case every chunk has to be treated as changed.
+	bool getChangedChunks(int sinceRevision, std::vector<Int2> &chunks) const;
+
+	// Gets the voxel ID at the given coordinate.
+	uint16_t getVoxel(int x, int y, int z) const;
+
+	// Gets a pointer to the bottom voxel of an XZ column. The voxel at height Y is at
+	// Y * getColumnStride() from there (the stride is 1 in the Y-first layout).
+	const uint16_t *getColumn(int x, int z) const;
+	int getColumnStride() const;
+
+	// Returns whether the XZ column has nothing but empty, floor, and ceiling voxels.
+	bool isPlainColumn(int x, int z) const;
+
+	// Gets the collision flags of every voxel.
+	const CollisionGrid &getCollisionGrid() const;
+
+	// Returns whether two XZ columns have the same voxel IDs at every height.
+	bool columnsMatch(int x1, int z1, int x2, int z2) const;
+
+	// Gets the voxel data associated with an ID. Voxel data are read-only once added since
+	// an ID may be shared by every voxel with an equal definition.
 	const VoxelData &getVoxelData(uint16_t id) const;
 
-	// Adds a voxel data object and returns its assigned ID.
+	// Sets the voxel ID at the given coordinate. The ID's voxel data must already exist.
+	void setVoxel(int x, int y, int z, uint16_t id);
+
+	// Sets every voxel of a chunk at once from IDs in the grid's layout (i.e., from
+	// getChunk() of a grid with the same height and layout), the same as setVoxel() on each.
+	// Every ID's voxel data must already exist.
+	void setChunk(int chunkX, int chunkZ, const uint16_t *voxels);
+
+	// Makes this grid the same as another one with the same dimensions and layout, copying
+	// only the chunks whose revision differs. The two grids then have the same revision.
+	void copyChangesFrom(const VoxelGrid &grid);
+
+	// Moves every voxel by the given number of chunks along X and Z. Voxels moved off the
+	// grid are dropped, and the chunks left behind are air. Every chunk's revision changes.
+	void scroll(int chunkDX, int chunkDZ);
+
+	// Returns whether the voxels are packed, so they can't be read or written.
+	bool isPacked() const;
+
+	// Packs every chunk's voxels into runs and frees their storage. The dimensions, voxel
+	// data, and revisions can still be read. Does nothing if already packed.
+	void pack();
+
+	// Gives each non-air chunk its storage back from the packed runs. Does nothing if not
+	// packed.
+	void unpack();
+
+	// Adds a voxel data object and returns its assigned ID. If an equal definition was
+	// already added, its ID is returned instead.
 	uint16_t addVoxelData(const VoxelData &voxelData);
 };
 
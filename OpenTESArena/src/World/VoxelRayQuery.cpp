@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include "VoxelDataType.h"
+#include "VoxelGrid.h"
+#include "VoxelRayQuery.h"
+#include "../Utilities/JobSystem.h"
+
+namespace
+{
+	// Smallest number of rays worth handing to a worker.
+	const int RaysPerBatch = 64;
+}
+
+VoxelRayQuery::Ray::Ray(const Double3 &origin, const Double3 &direction, double maxDistance)
+	: origin(origin), direction(direction)
+{
+	this->maxDistance = maxDistance;
+}
+
+VoxelRayQuery::Ray::Ray()
+	: Ray(Double3::Zero, Double3::UnitX, 0.0) { }
+
+VoxelRayQuery::Hit::Hit()
+{
+	this->type = Hit::Type::None;
+	this->distance = std::numeric_limits<double>::infinity();
+	this->facing = VoxelData::Facing::PositiveX;
+	this->verticalFace = false;
+	this->flatID = -1;
+}
+
+VoxelRayQuery::Hit VoxelRayQuery::castVoxels(const VoxelGrid &voxelGrid, const Ray &ray)
+{
+	Hit hit;
+
+	const Double3 direction = ray.direction.normalized();
+	const std::array<double, 3> origin = { ray.origin.x, ray.origin.y, ray.origin.z };
+	const std::array<double, 3> dir = { direction.x, direction.y, direction.z };
+	const std::array<int, 3> dims =
+	{
+		voxelGrid.getWidth(), voxelGrid.getHeight(), voxelGrid.getDepth()
+	};
+
+	// Clip the ray to the grid's bounds, since everything outside is air.
+	double tEnter = 0.0;
+	double tExit = ray.maxDistance;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (dir[axis] != 0.0)
+		{
+			const double t1 = (0.0 - origin[axis]) / dir[axis];
+			const double t2 = (static_cast<double>(dims[axis]) - origin[axis]) / dir[axis];
+			tEnter = std::max(tEnter, std::min(t1, t2));
+			tExit = std::min(tExit, std::max(t1, t2));
+		}
+		else if ((origin[axis] < 0.0) || (origin[axis] >= static_cast<double>(dims[axis])))
+		{
+			return hit;
+		}
+	}
+
+	if (tEnter >= tExit)
+	{
+		return hit;
+	}
+
+	std::array<int, 3> step, cell;
+	std::array<double, 3> tDelta, tMax;
+
+	// Sets the distances to the next cell boundary on each axis from the current cell.
+	auto seed = [&origin, &dir, &step, &cell, &tMax]()
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (dir[axis] != 0.0)
+			{
+				const double boundary = static_cast<double>(cell[axis] + ((step[axis] > 0) ? 1 : 0));
+				tMax[axis] = (boundary - origin[axis]) / dir[axis];
+			}
+			else
+			{
+				tMax[axis] = std::numeric_limits<double>::infinity();
+			}
+		}
+	};
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		step[axis] = (dir[axis] > 0.0) ? 1 : ((dir[axis] < 0.0) ? -1 : 0);
+		tDelta[axis] = (dir[axis] != 0.0) ? std::abs(1.0 / dir[axis]) :
+			std::numeric_limits<double>::infinity();
+
+		const double coord = origin[axis] + (dir[axis] * tEnter);
+		cell[axis] = std::min(std::max(static_cast<int>(std::floor(coord)), 0), dims[axis] - 1);
+	}
+
+	seed();
+
+	// The face the ray entered the current cell through. The first cell only has one if the
+	// ray started outside the grid.
+	double t = tEnter;
+	int enteredAxis = -1;
+	if (tEnter > 0.0)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (dir[axis] != 0.0)
+			{
+				const double t1 = (0.0 - origin[axis]) / dir[axis];
+				const double t2 = (static_cast<double>(dims[axis]) - origin[axis]) / dir[axis];
+				if (std::min(t1, t2) == tEnter)
+				{
+					enteredAxis = axis;
+				}
+			}
+		}
+	}
+
+	const int chunkSize = VoxelGrid::CHUNK_SIZE;
+	while (t < tExit)
+	{
+		const int chunkX = cell[0] / chunkSize;
+		const int chunkZ = cell[2] / chunkSize;
+
+		if (voxelGrid.isAirChunk(chunkX, chunkZ))
+		{
+			// Jump to where the ray leaves the chunk. Chunks are full height, so only X and
+			// Z bound them.
+			const std::array<int, 3> chunkMin = { chunkX * chunkSize, 0, chunkZ * chunkSize };
+			double tChunkExit = tExit;
+			int exitAxis = -1;
+			for (const int axis : { 0, 2 })
+			{
+				if (dir[axis] != 0.0)
+				{
+					const double boundary = static_cast<double>(chunkMin[axis] +
+						((step[axis] > 0) ? chunkSize : 0));
+					const double tBoundary = (boundary - origin[axis]) / dir[axis];
+					if (tBoundary < tChunkExit)
+					{
+						tChunkExit = tBoundary;
+						exitAxis = axis;
+					}
+				}
+			}
+
+			if (exitAxis < 0)
+			{
+				break;
+			}
+
+			// The cell past the exit face, and the cell the ray is in on the other axes.
+			t = tChunkExit;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (axis == exitAxis)
+				{
+					cell[axis] = chunkMin[axis] + ((step[axis] > 0) ? chunkSize : -1);
+				}
+				else
+				{
+					const int minCell = (axis == 1) ? 0 : chunkMin[axis];
+					const int maxCell = (axis == 1) ? (dims[1] - 1) :
+						std::min(chunkMin[axis] + chunkSize, dims[axis]) - 1;
+					const double coord = origin[axis] + (dir[axis] * t);
+					cell[axis] = std::min(std::max(
+						static_cast<int>(std::floor(coord)), minCell), maxCell);
+				}
+			}
+
+			if ((cell[exitAxis] < 0) || (cell[exitAxis] >= dims[exitAxis]))
+			{
+				break;
+			}
+
+			seed();
+			enteredAxis = exitAxis;
+			continue;
+		}
+
+		const uint16_t id = voxelGrid.getVoxel(cell[0], cell[1], cell[2]);
+		if ((id != 0) && (voxelGrid.getVoxelData(id).dataType != VoxelDataType::None))
+		{
+			hit.type = Hit::Type::Voxel;
+			hit.distance = t;
+			hit.point = ray.origin + (direction * t);
+			hit.voxel = Int3(cell[0], cell[1], cell[2]);
+			hit.verticalFace = enteredAxis == 1;
+
+			if (enteredAxis == 0)
+			{
+				hit.facing = (step[0] > 0) ? VoxelData::Facing::NegativeX :
+					VoxelData::Facing::PositiveX;
+			}
+			else if (enteredAxis == 2)
+			{
+				hit.facing = (step[2] > 0) ? VoxelData::Facing::NegativeZ :
+					VoxelData::Facing::PositiveZ;
+			}
+
+			return hit;
+		}
+
+		// Step to the nearest cell boundary.
+		int axis = 0;
+		if (tMax[1] < tMax[axis])
+		{
+			axis = 1;
+		}
+
+		if (tMax[2] < tMax[axis])
+		{
+			axis = 2;
+		}
+
+		t = tMax[axis];
+		tMax[axis] += tDelta[axis];
+		cell[axis] += step[axis];
+		enteredAxis = axis;
+
+		if ((cell[axis] < 0) || (cell[axis] >= dims[axis]))
+		{
+			break;
+		}
+	}
+
+	return hit;
+}
+
+bool VoxelRayQuery::castFlat(const Ray &ray, const Flat &flat, Hit &hit)
+{
+	const Double3 direction = ray.direction.normalized();
+	const Double2 direction2D(direction.x, direction.z);
+	const double length2D = direction2D.length();
+	if (length2D == 0.0)
+	{
+		return false;
+	}
+
+	// The flat faces the ray, so its plane is perpendicular to the ray in the XZ plane.
+	const Double2 normal = direction2D / length2D;
+	const Double2 offset(flat.position.x - ray.origin.x, flat.position.z - ray.origin.z);
+	const double t = offset.dot(normal) / length2D;
+	if ((t < 0.0) || (t > ray.maxDistance) || (t >= hit.distance))
+	{
+		return false;
+	}
+
+	const Double3 point = ray.origin + (direction * t);
+	const Double2 lateral(point.x - flat.position.x, point.z - flat.position.z);
+	const double pointHeight = point.y - flat.position.y;
+	if ((lateral.length() > (flat.width * 0.50)) || (pointHeight < 0.0) ||
+		(pointHeight > flat.height))
+	{
+		return false;
+	}
+
+	hit.type = Hit::Type::Flat;
+	hit.distance = t;
+	hit.point = point;
+	hit.flatID = flat.id;
+	return true;
+}
+
+VoxelRayQuery::Hit VoxelRayQuery::castRay(const VoxelGrid &voxelGrid, const Ray &ray)
+{
+	return VoxelRayQuery::castVoxels(voxelGrid, ray);
+}
+
+VoxelRayQuery::Hit VoxelRayQuery::castRay(const VoxelGrid &voxelGrid, const Ray &ray,
+	const std::vector<Flat> &flats)
+{
+	Hit hit = VoxelRayQuery::castVoxels(voxelGrid, ray);
+
+	// Only flats nearer than the voxel hit are visible to the ray.
+	for (const Flat &flat : flats)
+	{
+		VoxelRayQuery::castFlat(ray, flat, hit);
+	}
+
+	return hit;
+}
+
+VoxelRayQuery::Hit VoxelRayQuery::castRay2D(const VoxelGrid &voxelGrid, const Double2 &origin,
+	const Double2 &direction, int y, double maxDistance)
+{
+	// A level ray through the middle of the layer never leaves it.
+	const Ray ray(Double3(origin.x, static_cast<double>(y) + 0.50, origin.y),
+		Double3(direction.x, 0.0, direction.y), maxDistance);
+	return VoxelRayQuery::castVoxels(voxelGrid, ray);
+}
+
+void VoxelRayQuery::castRays(const VoxelGrid &voxelGrid, const std::vector<Ray> &rays,
+	const std::vector<Flat> &flats, std::vector<Hit> &hits, JobSystem *jobSystem)
+{
+	const int rayCount = static_cast<int>(rays.size());
+	hits.resize(rayCount);
+
+	auto castBatch = [&voxelGrid, &rays, &flats, &hits, rayCount](int batchIndex)
+	{
+		const int startIndex = batchIndex * RaysPerBatch;
+		const int endIndex = std::min(startIndex + RaysPerBatch, rayCount);
+		for (int i = startIndex; i < endIndex; i++)
+		{
+			hits[i] = VoxelRayQuery::castRay(voxelGrid, rays[i], flats);
+		}
+	};
+
+	const int batchCount = (rayCount + RaysPerBatch - 1) / RaysPerBatch;
+	if ((jobSystem != nullptr) && (batchCount > 1))
+	{
+		jobSystem->parallelFor(batchCount, castBatch);
+	}
+	else
+	{
+		for (int i = 0; i < batchCount; i++)
+		{
+			castBatch(i);
+		}
+	}
+}
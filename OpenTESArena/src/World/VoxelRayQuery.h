@@ -0,0 +1,78 @@
+#ifndef VOXEL_RAY_QUERY_H
+#define VOXEL_RAY_QUERY_H
+
+#include <vector>
+
+#include "VoxelData.h"
+#include "../Math/Vector2.h"
+#include "../Math/Vector3.h"
+
+// Ray queries against a voxel grid, for picking things in the game world and for line of
+// sight. Rays step through voxels with a 3D DDA, and jump across whole chunks that are
+// all air (the same chunks the renderers skip), so long rays over open ground are cheap.
+// Flats can be tested too, treated as camera-facing quads like the renderer draws them.
+
+class JobSystem;
+class VoxelGrid;
+
+class VoxelRayQuery
+{
+public:
+	struct Ray
+	{
+		Double3 origin, direction; // The direction doesn't need to be normalized.
+		double maxDistance;
+
+		Ray(const Double3 &origin, const Double3 &direction, double maxDistance);
+		Ray();
+	};
+
+	// A flat to test rays against. It turns to face each ray in the XZ plane.
+	struct Flat
+	{
+		int id;
+		Double3 position; // Center of bottom edge.
+		double width, height;
+	};
+
+	struct Hit
+	{
+		enum class Type { None, Voxel, Flat };
+
+		Type type;
+		double distance; // Along the normalized ray direction.
+		Double3 point;
+		Int3 voxel; // Voxel that was hit, if any.
+		VoxelData::Facing facing; // Side of the voxel the ray came in through.
+		bool verticalFace; // Whether the ray came in through the top or bottom instead.
+		int flatID; // Flat that was hit, if any.
+
+		Hit();
+	};
+private:
+	// Steps through the grid and returns the first voxel the ray enters that has data.
+	static Hit castVoxels(const VoxelGrid &voxelGrid, const Ray &ray);
+
+	// Returns whether the ray hits the flat nearer than the given distance, and updates the
+	// hit if it does.
+	static bool castFlat(const Ray &ray, const Flat &flat, Hit &hit);
+public:
+	// Casts a ray through the voxel grid in 3D.
+	static Hit castRay(const VoxelGrid &voxelGrid, const Ray &ray);
+
+	// Casts a ray through the voxel grid and the given flats, and returns the nearest hit.
+	static Hit castRay(const VoxelGrid &voxelGrid, const Ray &ray,
+		const std::vector<Flat> &flats);
+
+	// Casts a ray through one layer of voxels at height Y, like the renderer's 2.5D rays.
+	// The distance is in the XZ plane.
+	static Hit castRay2D(const VoxelGrid &voxelGrid, const Double2 &origin,
+		const Double2 &direction, int y, double maxDistance);
+
+	// Casts each ray and writes the results to the hits in the same order. If a job system
+	// is given, the rays are split between its workers. The flats can be empty.
+	static void castRays(const VoxelGrid &voxelGrid, const std::vector<Ray> &rays,
+		const std::vector<Flat> &flats, std::vector<Hit> &hits, JobSystem *jobSystem);
+};
+
+#endif
@@ -0,0 +1,198 @@
+#include <algorithm>
+
+#include "WildernessWindow.h"
+#include "../Assets/RMDFile.h"
+#include "../Utilities/Debug.h"
+
+namespace
+{
+	// How far into a neighboring block the player can go before the window moves.
+	const double ScrollMargin = 8.0;
+}
+
+const int WildernessWindow::BLOCKS = 3;
+const int WildernessWindow::GRID_SIZE = WildernessWindow::BLOCKS * 64;
+
+WildernessWindow::WildernessWindow(const std::array<int, 4> &rmdIDs, const Int2 &origin)
+	: rmdIDs(rmdIDs), origin(origin)
+{
+	DebugAssert((RMDFile::WIDTH * WildernessWindow::BLOCKS) == WildernessWindow::GRID_SIZE,
+		"Window size doesn't match .RMD size.");
+
+	const int voxelCount = WildernessWindow::GRID_SIZE * WildernessWindow::GRID_SIZE;
+	this->flor = std::vector<uint16_t>(voxelCount, 0);
+	this->map1 = std::vector<uint16_t>(voxelCount, 0);
+	this->map2 = std::vector<uint16_t>(voxelCount, 0);
+}
+
+const Int2 &WildernessWindow::getOrigin() const
+{
+	return this->origin;
+}
+
+int WildernessWindow::getRmdID(const Int2 &block) const
+{
+	const int index = (block.x & 1) + ((block.y & 1) * 2);
+	return this->rmdIDs.at(index);
+}
+
+bool WildernessWindow::contains(const Int2 &block) const
+{
+	return (block.x >= this->origin.x) &&
+		(block.x < (this->origin.x + WildernessWindow::BLOCKS)) &&
+		(block.y >= this->origin.y) &&
+		(block.y < (this->origin.y + WildernessWindow::BLOCKS));
+}
+
+Int2 WildernessWindow::getGridCorner(const Int2 &block) const
+{
+	// Arena's X is the grid's Z and vice versa, both reversed.
+	const int slotX = block.x - this->origin.x;
+	const int slotZ = block.y - this->origin.y;
+	return Int2(
+		WildernessWindow::GRID_SIZE - ((slotZ + 1) * RMDFile::DEPTH),
+		WildernessWindow::GRID_SIZE - ((slotX + 1) * RMDFile::WIDTH));
+}
+
+Int2 WildernessWindow::getScroll(const Double2 &point) const
+{
+	auto getAxisScroll = [](double value, int blockSize)
+	{
+		const double centerStart = static_cast<double>((WildernessWindow::BLOCKS / 2) * blockSize);
+		const double centerEnd = centerStart + static_cast<double>(blockSize);
+		if (value < (centerStart - ScrollMargin))
+		{
+			return -1;
+		}
+		else if (value >= (centerEnd + ScrollMargin))
+		{
+			return 1;
+		}
+		else
+		{
+			return 0;
+		}
+	};
+
+	return Int2(
+		getAxisScroll(point.x, RMDFile::WIDTH),
+		getAxisScroll(point.y, RMDFile::DEPTH));
+}
+
+void WildernessWindow::scroll(const Int2 &blockDelta)
+{
+	this->origin = this->origin + blockDelta;
+
+	const int dx = blockDelta.x * RMDFile::WIDTH;
+	const int dz = blockDelta.y * RMDFile::DEPTH;
+	const int gridSize = WildernessWindow::GRID_SIZE;
+	auto scrollVoxels = [dx, dz, gridSize](std::vector<uint16_t> &voxels)
+	{
+		std::vector<uint16_t> newVoxels(voxels.size(), 0);
+		const int startX = std::max(0, dx);
+		const int endX = std::min(gridSize, gridSize + dx);
+		for (int z = std::max(0, dz); (z < std::min(gridSize, gridSize + dz)) &&
+			(startX < endX); z++)
+		{
+			const auto srcBegin = voxels.begin() + startX + (z * gridSize);
+			const auto dstBegin = newVoxels.begin() + (startX - dx) + ((z - dz) * gridSize);
+			std::copy(srcBegin, srcBegin + (endX - startX), dstBegin);
+		}
+
+		voxels = std::move(newVoxels);
+	};
+
+	scrollVoxels(this->flor);
+	scrollVoxels(this->map1);
+	scrollVoxels(this->map2);
+}
+
+void WildernessWindow::requestBlock(const Int2 &block, JobSystem &jobSystem)
+{
+	const auto iter = std::find_if(this->pendingBlocks.begin(), this->pendingBlocks.end(),
+		[&block](const PendingBlock &pendingBlock) { return pendingBlock.block == block; });
+	if (iter != this->pendingBlocks.end())
+	{
+		return;
+	}
+
+	PendingBlock pendingBlock;
+	pendingBlock.block = block;
+	pendingBlock.rmd = std::make_shared<std::shared_ptr<const RMDFile>>();
+
+	// The job only touches its own result, so it's fine for the window to go away first.
+	const int rmdID = this->getRmdID(block);
+	std::shared_ptr<std::shared_ptr<const RMDFile>> rmd = pendingBlock.rmd;
+	pendingBlock.job = jobSystem.add([rmd, rmdID]()
+	{
+		*rmd = RMDFile::get(rmdID);
+	}, std::vector<JobSystem::JobHandle>(), std::function<void()>(),
+		JobSystem::Priority::Background);
+
+	this->pendingBlocks.push_back(std::move(pendingBlock));
+}
+
+std::vector<Int2> WildernessWindow::writeDecodedBlocks(JobSystem &jobSystem)
+{
+	std::vector<Int2> writtenBlocks;
+	auto iter = this->pendingBlocks.begin();
+	while (iter != this->pendingBlocks.end())
+	{
+		if (!jobSystem.isDone(iter->job))
+		{
+			++iter;
+			continue;
+		}
+
+		// Blocks that left the window while decoding aren't needed anymore.
+		if (this->contains(iter->block))
+		{
+			this->writeBlock(iter->block, **iter->rmd);
+			writtenBlocks.push_back(iter->block);
+		}
+
+		iter = this->pendingBlocks.erase(iter);
+	}
+
+	return writtenBlocks;
+}
+
+void WildernessWindow::writeBlock(const Int2 &block, const RMDFile &rmd)
+{
+	DebugAssert(this->contains(block), "Block (" + block.toString() + ") not in window.");
+
+	const int xOffset = (block.x - this->origin.x) * RMDFile::WIDTH;
+	const int zOffset = (block.y - this->origin.y) * RMDFile::DEPTH;
+	for (int z = 0; z < RMDFile::DEPTH; z++)
+	{
+		const int srcIndex = z * RMDFile::WIDTH;
+		const int dstIndex = xOffset + ((z + zOffset) * WildernessWindow::GRID_SIZE);
+
+		auto writeRow = [srcIndex, dstIndex](const RMDFile::ArrayType &src,
+			std::vector<uint16_t> &dst)
+		{
+			const auto srcBegin = src.begin() + srcIndex;
+			const auto srcEnd = srcBegin + RMDFile::WIDTH;
+			std::copy(srcBegin, srcEnd, dst.begin() + dstIndex);
+		};
+
+		writeRow(rmd.getFLOR(), this->flor);
+		writeRow(rmd.getMAP1(), this->map1);
+		writeRow(rmd.getMAP2(), this->map2);
+	}
+}
+
+const uint16_t *WildernessWindow::getFLOR() const
+{
+	return this->flor.data();
+}
+
+const uint16_t *WildernessWindow::getMAP1() const
+{
+	return this->map1.data();
+}
+
+const uint16_t *WildernessWindow::getMAP2() const
+{
+	return this->map2.data();
+}
@@ -0,0 +1,89 @@
+#ifndef WILDERNESS_WINDOW_H
+#define WILDERNESS_WINDOW_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../Math/Vector2.h"
+#include "../Utilities/JobSystem.h"
+
+// The part of the wilderness that a level holds at once: BLOCKS x BLOCKS of the 64x64
+// .RMD blocks, with the player somewhere in the center one. When the player walks far
+// enough into another block, the window moves over by a block so that one is the center.
+// The blocks that come into view on the far side are decoded on workers, and the ones
+// behind are dropped, so the wilderness never takes more memory than the window.
+
+// Block coordinates use Arena's directions (+X west, +Z south), and the voxels are kept in
+// .MIF order like the rest of a level's data so the level's readers can use them as-is.
+
+class RMDFile;
+
+class WildernessWindow
+{
+public:
+	// Width and depth of the window in blocks.
+	static const int BLOCKS;
+
+	// Width and depth of the window in voxels.
+	static const int GRID_SIZE;
+private:
+	// A block being decoded on a worker.
+	struct PendingBlock
+	{
+		Int2 block;
+		std::shared_ptr<std::shared_ptr<const RMDFile>> rmd; // Set by the job.
+		JobSystem::JobHandle job;
+	};
+
+	std::array<int, 4> rmdIDs;
+	std::vector<uint16_t> flor, map1, map2;
+	std::vector<PendingBlock> pendingBlocks;
+	Int2 origin; // Block at the window's top right corner.
+public:
+	// The .RMD IDs are for the top right, top left, bottom right, and bottom left blocks
+	// around the wilderness' starting point.
+	WildernessWindow(const std::array<int, 4> &rmdIDs, const Int2 &origin);
+
+	// Gets the block at the window's top right corner.
+	const Int2 &getOrigin() const;
+
+	// Gets the .RMD ID of a block. There's no wilderness map yet, so the four starting
+	// blocks repeat in every direction.
+	int getRmdID(const Int2 &block) const;
+
+	// Returns whether the block is inside the window.
+	bool contains(const Int2 &block) const;
+
+	// Gets the voxel grid coordinate of the block's corner nearest the grid's origin.
+	Int2 getGridCorner(const Int2 &block) const;
+
+	// Gets how many blocks the window should move along X and Z to have a point (in Arena's
+	// voxel coordinates within the window) in its center block. Points just past the
+	// center block don't count, so walking back and forth over an edge doesn't move it
+	// every time.
+	Int2 getScroll(const Double2 &point) const;
+
+	// Moves the window by the given number of blocks. Voxels of blocks still in it move
+	// with them, and the rest are empty until their block is written.
+	void scroll(const Int2 &blockDelta);
+
+	// Starts getting the block on a worker (from the .RMD cache if it's there), unless it
+	// already is.
+	void requestBlock(const Int2 &block, JobSystem &jobSystem);
+
+	// Writes each block that has finished decoding into the window, and returns the ones
+	// that are still in it.
+	std::vector<Int2> writeDecodedBlocks(JobSystem &jobSystem);
+
+	// Copies a decoded block into its place in the window.
+	void writeBlock(const Int2 &block, const RMDFile &rmd);
+
+	// Gets the window's voxels, GRID_SIZE x GRID_SIZE of them.
+	const uint16_t *getFLOR() const;
+	const uint16_t *getMAP1() const;
+	const uint16_t *getMAP2() const;
+};
+
+#endif
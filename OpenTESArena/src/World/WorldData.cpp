@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cassert>
+#include <unordered_set>
 
 #include "SDL.h"
 
@@ -7,6 +9,7 @@
 #include "WeatherType.h"
 #include "WorldData.h"
 #include "WorldType.h"
+#include "../Assets/AssetName.h"
 #include "../Assets/CityDataFile.h"
 #include "../Assets/INFFile.h"
 #include "../Assets/MiscAssets.h"
@@ -16,13 +19,65 @@
 #include "../Media/TextureManager.h"
 #include "../Rendering/Renderer.h"
 #include "../Utilities/Debug.h"
-#include "../Utilities/String.h"
+#include "../Utilities/MemoryTracker.h"
+#include "../Utilities/Profiler.h"
+
+namespace
+{
+	// Starts decoding a voxel texture on the job system. Names without a recognized
+	// extension are left for setLevelActive() to handle.
+	void prefetchVoxelTexture(const AssetName &textureName, TextureManager &textureManager)
+	{
+		const AssetName::Extension extension = textureName.getExtension();
+
+		if (extension == AssetName::Extension::SET)
+		{
+			textureManager.prefetchSet(textureName.getString());
+		}
+		else if (extension == AssetName::Extension::IMG)
+		{
+			textureManager.prefetch(textureName.getString());
+		}
+	}
+
+	// Marks a voxel texture's source image as used, so it's kept longer than the others.
+	void touchVoxelTexture(const AssetName &textureName, TextureManager &textureManager)
+	{
+		const AssetName::Extension extension = textureName.getExtension();
+
+		if (extension == AssetName::Extension::SET)
+		{
+			textureManager.touchSet(textureName.getString());
+		}
+		else if (extension == AssetName::Extension::IMG)
+		{
+			textureManager.touch(textureManager.getImageHandle(textureName.getString()));
+		}
+	}
+}
+
+WorldData::LevelSlot::LevelSlot()
+{
+	this->jobSystem = nullptr;
+	this->voxelsPacked = false;
+}
+
+WorldData::LevelSlot::~LevelSlot()
+{
+	// The pack job works on the level in place, so it has to finish before the level goes.
+	if (this->packJob != nullptr)
+	{
+		this->jobSystem->wait(this->packJob);
+	}
+}
 
 WorldData::WorldData()
 {
 	// Partially initialized until constructed through one of the static load methods.
 	this->worldType = WorldType::City;
 	this->currentLevel = -1;
+	this->startLevel = -1;
+	this->levelActiveFrame = -1;
 }
 
 std::string WorldData::generateCityInfName(ClimateType climateType, WeatherType weatherType)
@@ -143,15 +198,38 @@ std::string WorldData::generateWildernessInfName(ClimateType climateType, Weathe
 	return climateLetter + locationLetter + weatherLetter + ".INF";
 }
 
+void WorldData::addLevel(LevelData &&levelData)
+{
+	LevelSlot slot;
+	slot.infName = levelData.getInfName();
+	slot.level = std::make_unique<LevelData>(std::move(levelData));
+	this->levels.push_back(std::move(slot));
+}
+
+void WorldData::addLevel(const std::function<LevelData()> &generate, const std::string &infName)
+{
+	LevelSlot slot;
+	slot.generate = generate;
+	slot.infName = infName;
+	this->levels.push_back(std::move(slot));
+}
+
 WorldData WorldData::loadInterior(const MIFFile &mif)
 {
 	WorldData worldData;
 
-	// Generate levels.
-	for (const auto &level : mif.getLevels())
+	// The .MIF might not outlive the world, so its levels are copied for generating them
+	// later.
+	const auto mifLevels = std::make_shared<const std::vector<MIFFile::Level>>(mif.getLevels());
+	const int gridWidth = mif.getDepth();
+	const int gridDepth = mif.getWidth();
+	for (size_t i = 0; i < mifLevels->size(); i++)
 	{
-		worldData.levels.push_back(LevelData::loadInterior(
-			level, mif.getDepth(), mif.getWidth()));
+		const MIFFile::Level &level = mifLevels->at(i);
+		worldData.addLevel([mifLevels, i, gridWidth, gridDepth]()
+		{
+			return LevelData::loadInterior(mifLevels->at(i), gridWidth, gridDepth);
+		}, level.info);
 	}
 
 	// Convert start points from the old coordinate system to the new one.
@@ -162,8 +240,10 @@ WorldData WorldData::loadInterior(const MIFFile &mif)
 	}
 
 	worldData.currentLevel = mif.getStartingLevelIndex();
+	worldData.startLevel = worldData.currentLevel;
 	worldData.worldType = WorldType::Interior;
 	worldData.mifName = mif.getName();
+	worldData.getLevel(worldData.currentLevel);
 
 	return worldData;
 }
@@ -172,7 +252,7 @@ WorldData WorldData::loadDungeon(uint32_t seed, int widthChunks, int depthChunks
 	bool isArtifactDungeon)
 {
 	// Load the .MIF file with all the dungeon chunks in it. Dimensions should be 32x32.
-	const MIFFile mif("RANDOM1.MIF");
+	const MIFFile &mif = MIFFile::get("RANDOM1.MIF");
 
 	ArenaRandom random(seed);
 
@@ -216,26 +296,35 @@ WorldData WorldData::loadDungeon(uint32_t seed, int widthChunks, int depthChunks
 	}
 
 	// .INF file for each level is the same (RD1.INF).
-	const std::string infName = String::toUppercase(mif.getLevels().front().info);
-	const INFFile inf(infName);
+	const std::string &infName = mif.getLevels().front().info;
+	const INFFile &inf = INFFile::get(infName);
 
 	WorldData worldData;
 	const int gridWidth = mif.getDepth() * depthChunks;
 	const int gridDepth = mif.getWidth() * widthChunks;
 
-	// Generate each level, deciding which dungeon blocks to use.
+	// Each level decides which dungeon blocks to use from its own seed, so it comes out the
+	// same whenever it's generated. RANDOM1.MIF and the .INF stay cached, so the levels can
+	// refer to them.
+	const MIFFile *mifPtr = &mif;
+	const INFFile *infPtr = &inf;
 	for (int i = 0; i < levelCount; i++)
 	{
-		random.srand(seed2 + i);
+		const uint32_t levelSeed = seed2 + i;
 		const int levelUpBlock = transitions.at(i);
 
 		// No *LEVELDOWN block on the lowest level.
-		const int *levelDownBlock = (i < (levelCount - 1)) ?
-			(&transitions.at(i + 1)) : nullptr;
+		const bool hasLevelDown = i < (levelCount - 1);
+		const int levelDownBlock = hasLevelDown ? transitions.at(i + 1) : 0;
 
-		worldData.levels.push_back(LevelData::loadDungeon(
-			random, mif.getLevels(), levelUpBlock, levelDownBlock, widthChunks,
-			depthChunks, inf, gridWidth, gridDepth));
+		worldData.addLevel([mifPtr, infPtr, levelSeed, levelUpBlock, hasLevelDown,
+			levelDownBlock, widthChunks, depthChunks, gridWidth, gridDepth]()
+		{
+			ArenaRandom levelRandom(levelSeed);
+			return LevelData::loadDungeon(levelRandom, mifPtr->getLevels(), levelUpBlock,
+				hasLevelDown ? &levelDownBlock : nullptr, widthChunks, depthChunks, *infPtr,
+				gridWidth, gridDepth);
+		}, infName);
 	}
 
 	// The start point depends on where the level up voxel is on the first level.
@@ -250,8 +339,10 @@ WorldData WorldData::loadDungeon(uint32_t seed, int widthChunks, int depthChunks
 		startPoint, gridWidth, gridDepth));
 
 	worldData.currentLevel = 0;
+	worldData.startLevel = worldData.currentLevel;
 	worldData.worldType = WorldType::Interior;
 	worldData.mifName = mif.getName();
+	worldData.getLevel(worldData.currentLevel);
 
 	return worldData;
 }
@@ -264,9 +355,8 @@ WorldData WorldData::loadPremadeCity(const MIFFile &mif, ClimateType climateType
 	// Generate level.
 	const auto &level = mif.getLevels().front();
 	const std::string infName = WorldData::generateCityInfName(climateType, weatherType);
-	const INFFile inf(infName);
-	worldData.levels.push_back(LevelData::loadPremadeCity(
-		level, inf, mif.getDepth(), mif.getWidth()));
+	const INFFile &inf = INFFile::get(infName);
+	worldData.addLevel(LevelData::loadPremadeCity(level, inf, mif.getDepth(), mif.getWidth()));
 
 	// Convert start points from the old coordinate system to the new one.
 	for (const auto &point : mif.getStartPoints())
@@ -276,6 +366,7 @@ WorldData WorldData::loadPremadeCity(const MIFFile &mif, ClimateType climateType
 	}
 
 	worldData.currentLevel = mif.getStartingLevelIndex();
+	worldData.startLevel = worldData.currentLevel;
 	worldData.worldType = WorldType::City;
 	worldData.mifName = mif.getName();
 
@@ -284,7 +375,7 @@ WorldData WorldData::loadPremadeCity(const MIFFile &mif, ClimateType climateType
 
 WorldData WorldData::loadCity(int localCityID, int provinceID, const MIFFile &mif, int cityDim,
 	const std::vector<uint8_t> &reservedBlocks, const Int2 &startPosition, WeatherType weatherType,
-	const MiscAssets &miscAssets)
+	const MiscAssets &miscAssets, JobSystem &jobSystem, LoadProgress &progress)
 {
 	WorldData worldData;
 
@@ -300,9 +391,10 @@ WorldData WorldData::loadCity(int localCityID, int provinceID, const MIFFile &mi
 	const uint32_t citySeed = cityData.getCitySeed(localCityID, provinceID);
 
 	const std::string infName = WorldData::generateCityInfName(climateType, weatherType);
-	const INFFile inf(infName);
-	worldData.levels.push_back(LevelData::loadCity(level, citySeed, cityDim, reservedBlocks,
-		startPosition, inf, mif.getDepth(), mif.getWidth()));
+	const INFFile &inf = INFFile::get(infName);
+	worldData.addLevel(LevelData::loadCity(level, citySeed, cityDim, reservedBlocks,
+		startPosition, inf, mif.getDepth(), mif.getWidth(), miscAssets.getAssetCache(),
+		jobSystem, progress));
 
 	// Convert start points from the old coordinate system to the new one.
 	for (const auto &point : mif.getStartPoints())
@@ -312,6 +404,7 @@ WorldData WorldData::loadCity(int localCityID, int provinceID, const MIFFile &mi
 	}
 
 	worldData.currentLevel = mif.getStartingLevelIndex();
+	worldData.startLevel = worldData.currentLevel;
 	worldData.worldType = WorldType::City;
 	worldData.mifName = mif.getName();
 
@@ -324,12 +417,14 @@ WorldData WorldData::loadWilderness(int rmdTR, int rmdTL, int rmdBR, int rmdBL,
 	WorldData worldData;
 
 	const std::string infName = WorldData::generateWildernessInfName(climateType, weatherType);
-	const INFFile inf(infName);
+	const INFFile &inf = INFFile::get(infName);
 
-	// Load wilderness data (128x128 blank slate with four chunks. No starting points to load).
-	worldData.levels.push_back(LevelData::loadWilderness(rmdTR, rmdTL, rmdBR, rmdBL, inf));
+	// Load wilderness data (a window of blocks around the four given ones. No starting points
+	// to load).
+	worldData.addLevel(LevelData::loadWilderness(rmdTR, rmdTL, rmdBR, rmdBL, inf));
 
 	worldData.currentLevel = 0;
+	worldData.startLevel = worldData.currentLevel;
 	worldData.worldType = WorldType::Wilderness;
 	worldData.mifName = "WILD.MIF";
 
@@ -361,39 +456,333 @@ const EntityManager &WorldData::getEntityManager() const
 	return this->entityManager;
 }
 
+AnimationLibrary &WorldData::getAnimationLibrary()
+{
+	return this->animationLibrary;
+}
+
+const AnimationLibrary &WorldData::getAnimationLibrary() const
+{
+	return this->animationLibrary;
+}
+
 const std::vector<Double2> &WorldData::getStartPoints() const
 {
 	return this->startPoints;
 }
 
-std::vector<LevelData> &WorldData::getLevels()
+int WorldData::getLevelCount() const
+{
+	return static_cast<int>(this->levels.size());
+}
+
+LevelData &WorldData::getActiveLevel()
+{
+	return *this->levels.at(this->currentLevel).level;
+}
+
+const LevelData &WorldData::getActiveLevel() const
+{
+	return *this->levels.at(this->currentLevel).level;
+}
+
+void WorldData::unpackLevel(LevelSlot &slot)
+{
+	if (slot.packJob != nullptr)
+	{
+		slot.jobSystem->wait(slot.packJob);
+		slot.packJob = nullptr;
+	}
+
+	if (slot.voxelsPacked)
+	{
+		ProfileScope("WorldData::unpackLevel");
+		slot.level->getVoxelGrid().unpack();
+		slot.voxelsPacked = false;
+	}
+}
+
+LevelData &WorldData::getLevel(int levelIndex)
+{
+	LevelSlot &slot = this->levels.at(levelIndex);
+	if (slot.level == nullptr)
+	{
+		if (slot.job != nullptr)
+		{
+			slot.jobSystem->wait(slot.job);
+			slot.level = std::move(*slot.pendingLevel);
+			slot.job = nullptr;
+			slot.pendingLevel = nullptr;
+		}
+		else
+		{
+			ProfileScope("WorldData::generateLevel");
+			slot.level = std::make_unique<LevelData>(slot.generate());
+		}
+	}
+
+	WorldData::unpackLevel(slot);
+	return *slot.level;
+}
+
+LevelData *WorldData::findLevel(int levelIndex)
+{
+	LevelSlot &slot = this->levels.at(levelIndex);
+	if (slot.level != nullptr)
+	{
+		WorldData::unpackLevel(slot);
+	}
+
+	return slot.level.get();
+}
+
+const LevelData *WorldData::findLevel(int levelIndex) const
+{
+	return this->levels.at(levelIndex).level.get();
+}
+
+void WorldData::prefetchLevel(int levelIndex, TextureManager &textureManager,
+	JobSystem &jobSystem)
+{
+	if ((levelIndex < 0) || (levelIndex >= static_cast<int>(this->levels.size())))
+	{
+		return;
+	}
+
+	// The job only writes its own result, so the world can go away before it's done.
+	LevelSlot &slot = this->levels[levelIndex];
+	if ((slot.level == nullptr) && (slot.job == nullptr))
+	{
+		const std::function<LevelData()> generate = slot.generate;
+		std::shared_ptr<std::unique_ptr<LevelData>> pendingLevel =
+			std::make_shared<std::unique_ptr<LevelData>>();
+		slot.pendingLevel = pendingLevel;
+		slot.jobSystem = &jobSystem;
+		slot.job = jobSystem.add([generate, pendingLevel]()
+		{
+			*pendingLevel = std::make_unique<LevelData>(generate());
+		}, std::vector<JobSystem::JobHandle>(), std::function<void()>(),
+			JobSystem::Priority::Background);
+	}
+	else if ((slot.level != nullptr) && slot.voxelsPacked)
+	{
+		// Unpack it after any packing still going on.
+		std::vector<JobSystem::JobHandle> dependencies;
+		if (slot.packJob != nullptr)
+		{
+			dependencies.push_back(slot.packJob);
+		}
+
+		LevelData *level = slot.level.get();
+		slot.jobSystem = &jobSystem;
+		slot.packJob = jobSystem.add([level]()
+		{
+			level->getVoxelGrid().unpack();
+		}, dependencies);
+		slot.voxelsPacked = false;
+	}
+
+	// A level that's been drawn only needs the textures it drew.
+	if (slot.textureWorkingSet.size() > 0)
+	{
+		for (const std::string &textureName : slot.textureWorkingSet)
+		{
+			prefetchVoxelTexture(AssetName(textureName), textureManager);
+		}
+
+		return;
+	}
+
+	const INFFile &inf = INFFile::get(slot.infName);
+	for (const auto &textureData : inf.getVoxelTextures())
+	{
+		prefetchVoxelTexture(AssetName(textureData.filename), textureManager);
+	}
+}
+
+void WorldData::recordTextureWorkingSet(TextureManager &textureManager, Renderer &renderer)
+{
+	if ((this->levelActiveFrame < 0) || (this->currentLevel < 0))
+	{
+		return;
+	}
+
+	// Slots are the level's .INF voxel texture indices, so a slot drawn since the level
+	// became active holds one of its textures.
+	LevelSlot &slot = this->levels.at(this->currentLevel);
+	const INFFile &inf = INFFile::get(slot.infName);
+	const auto &voxelTextures = inf.getVoxelTextures();
+
+	std::vector<std::string> workingSet;
+	for (int i = 0; i < static_cast<int>(voxelTextures.size()); i++)
+	{
+		const std::string &textureName = voxelTextures[i].filename;
+		if ((renderer.getVoxelTextureLastFrame(i) >= this->levelActiveFrame) &&
+			(std::find(workingSet.begin(), workingSet.end(), textureName) == workingSet.end()))
+		{
+			workingSet.push_back(textureName);
+		}
+	}
+
+	// Entity textures aren't kept between visits, so they're only counted.
+	std::unordered_set<int> flatTextureIDs;
+	for (const auto *entity : this->entityManager.getAllEntities())
+	{
+		const int flatTextureID = entity->getTextureID();
+		if (renderer.getFlatTextureLastFrame(flatTextureID) >= this->levelActiveFrame)
+		{
+			flatTextureIDs.insert(flatTextureID);
+		}
+	}
+
+	this->levelActiveFrame = -1;
+
+	// Nothing drawn (i.e., the level was left right away) says nothing about what it uses.
+	if (workingSet.size() == 0)
+	{
+		return;
+	}
+
+	for (const std::string &textureName : workingSet)
+	{
+		touchVoxelTexture(AssetName(textureName), textureManager);
+	}
+
+	DebugMention("Level " + std::to_string(this->currentLevel) + " of \"" + this->mifName +
+		"\" drew " + std::to_string(workingSet.size()) + " voxel and " +
+		std::to_string(flatTextureIDs.size()) + " flat textures.");
+
+	slot.textureWorkingSet = std::move(workingSet);
+}
+
+void WorldData::packInactiveLevels(JobSystem &jobSystem)
 {
-	return this->levels;
+	for (int i = 0; i < static_cast<int>(this->levels.size()); i++)
+	{
+		LevelSlot &slot = this->levels[i];
+		if ((i == this->currentLevel) || (slot.level == nullptr) || slot.voxelsPacked)
+		{
+			continue;
+		}
+
+		// Pack it after any unpacking still going on.
+		std::vector<JobSystem::JobHandle> dependencies;
+		if (slot.packJob != nullptr)
+		{
+			dependencies.push_back(slot.packJob);
+		}
+
+		LevelData *level = slot.level.get();
+		slot.jobSystem = &jobSystem;
+		slot.packJob = jobSystem.add([level]()
+		{
+			level->getVoxelGrid().pack();
+		}, dependencies);
+		slot.voxelsPacked = true;
+	}
 }
 
-const std::vector<LevelData> &WorldData::getLevels() const
+void WorldData::reset()
 {
-	return this->levels;
+	// Levels still being prefetched haven't been changed yet. Packed ones are only
+	// unpacked if they have changes to revert.
+	for (LevelSlot &slot : this->levels)
+	{
+		if (slot.level.get() != nullptr)
+		{
+			if (!slot.level->getJournal().isEmpty())
+			{
+				WorldData::unpackLevel(slot);
+			}
+
+			slot.level->revertJournal();
+			slot.level->getActiveDoors().clear();
+		}
+	}
+
+	// Entities are made again by setLevelActive().
+	this->entityManager.clear();
+	this->currentLevel = this->startLevel;
+	this->levelActiveFrame = -1;
+
+	LevelSlot &startSlot = this->levels.at(this->currentLevel);
+	if (startSlot.level != nullptr)
+	{
+		WorldData::unpackLevel(startSlot);
+	}
 }
 
 void WorldData::setLevelActive(int levelIndex, TextureManager &textureManager,
 	Renderer &renderer)
 {
+	ProfileScope("WorldData::setLevelActive");
+
 	assert(levelIndex < this->levels.size());
+
+	// The level being left keeps what it drew, while the renderer's slots still hold it.
+	this->recordTextureWorkingSet(textureManager, renderer);
+
+	this->getLevel(levelIndex);
 	this->currentLevel = levelIndex;
 
-	// Clear all entities.
+	// Clear all entities, along with the flat textures of their animations. The new
+	// level's entities set their own.
+	std::unordered_set<int> flatTextureIDs;
 	for (const auto *entity : this->entityManager.getAllEntities())
 	{
 		renderer.removeFlat(entity->getID());
-		this->entityManager.remove(entity->getID());
+		flatTextureIDs.insert(entity->getTextureID());
 	}
 
-	// Clear software renderer textures.
-	renderer.clearTextures();
+	for (const int flatTextureID : flatTextureIDs)
+	{
+		renderer.removeFlatTexture(flatTextureID);
+	}
+
+	this->entityManager.clear();
+
+	// Voxel textures stay in the renderer across level switches, so only the slots that
+	// change are uploaded below. The new level's grid still needs meshing from scratch.
+	renderer.clearVoxelMeshes();
 
 	// Get the level being switched to.
-	const auto &level = this->levels.at(this->currentLevel);
+	LevelData &level = this->getActiveLevel();
+
+	// Static lights are baked on workers the first time the level is active, and the level
+	// keeps them for when it's active again.
+	if (level.getLightMap().get() == nullptr)
+	{
+		level.setLightMap(renderer.bakeLightMap(level.getStaticLights()));
+	}
+
+	renderer.setLightMap(level.getLightMap());
+
+	// Interiors also bake which of their chunks can see each other, kept the same way. It's
+	// baked again if the voxels changed since (i.e., from a loaded save's changes).
+	if (this->worldType == WorldType::Interior)
+	{
+		const std::shared_ptr<const PotentiallyVisibleSet> &visibleSet = level.getVisibleSet();
+		if ((visibleSet.get() == nullptr) || !visibleSet->isCurrent(level.getVoxelGrid()))
+		{
+			level.setVisibleSet(renderer.bakePotentiallyVisibleSet(level.getVoxelGrid()));
+		}
+
+		renderer.setPotentiallyVisibleSet(level.getVisibleSet());
+	}
+	else
+	{
+		renderer.setPotentiallyVisibleSet(nullptr);
+	}
+
+	// Levels keep their doors while inactive, so any that were left open are given to the
+	// renderer in place of the last level's.
+	renderer.clearDoors();
+	const ActiveDoors &activeDoors = level.getActiveDoors();
+	for (int i = 0; i < activeDoors.getCount(); i++)
+	{
+		const ActiveDoors::Door &door = activeDoors.getDoor(i);
+		renderer.setDoorOpenPercent(door.voxel, door.openPercent);
+	}
 
 	// If the world is an interior, change the sky palette. The outdoor dungeons have a gray
 	// sky while their lower levels have a black sky.
@@ -403,34 +792,64 @@ void WorldData::setLevelActive(int levelIndex, TextureManager &textureManager,
 		renderer.setSkyPalette(&skyColor, 1);
 	}
 
-	// Load the .INF file associated with the level.
-	// - To do: not sure if LevelData should store its own INFFile or just the name.
-	const INFFile inf(level.getInfName());
+	// Get the .INF file associated with the level. It's usually been parsed already when
+	// the level was loaded, so only the name needs to be kept in the level.
+	const INFFile &inf = INFFile::get(level.getInfName());
+
+	// Each slot's texture is named by its file and .SET index, so a slot that already holds
+	// the same texture from the last level is kept as-is.
+	auto getResidentName = [](const AssetName &textureName, int setIndex)
+	{
+		return textureName.getString() + '#' + std::to_string(setIndex);
+	};
 
-	// Load .INF voxel textures into the renderer. Assume all voxel textures are 64x64.
+	// Start decoding the voxel textures on the job system, so they're decoded in parallel
+	// instead of one at a time below.
 	const int voxelTextureCount = static_cast<int>(inf.getVoxelTextures().size());
 	for (int i = 0; i < voxelTextureCount; i++)
 	{
 		const auto &textureData = inf.getVoxelTextures().at(i);
+		const AssetName textureName(textureData.filename);
 
-		const std::string textureName = String::toUppercase(textureData.filename);
-		const std::string extension = String::getExtension(textureName);
+		if (!renderer.hasVoxelTexture(i, getResidentName(textureName, textureData.setIndex)))
+		{
+			prefetchVoxelTexture(textureName, textureManager);
+		}
+	}
 
-		const bool isIMG = extension == ".IMG";
-		const bool isSET = extension == ".SET";
-		const bool noExtension = extension.size() == 0;
+	// Load .INF voxel textures into the renderer. Assume all voxel textures are 64x64. They're
+	// sent as one batch so the renderer can convert them in parallel.
+	std::vector<Renderer::VoxelTextureUpdate> voxelTextureUpdates;
+	for (int i = 0; i < voxelTextureCount; i++)
+	{
+		const auto &textureData = inf.getVoxelTextures().at(i);
+
+		const AssetName textureName(textureData.filename);
+		const AssetName::Extension extension = textureName.getExtension();
+
+		const bool isIMG = extension == AssetName::Extension::IMG;
+		const bool isSET = extension == AssetName::Extension::SET;
+		const bool noExtension = extension == AssetName::Extension::None;
+		const std::string residentName = getResidentName(textureName, textureData.setIndex);
+
+		if (renderer.hasVoxelTexture(i, residentName))
+		{
+			continue;
+		}
 
 		if (isSET)
 		{
 			// Use the texture data's .SET index to obtain the correct surface.
-			const auto &surfaces = textureManager.getSurfaces(textureName);
+			const auto &surfaces = textureManager.getSurfaces(textureName.getString());
 			const SDL_Surface *surface = surfaces.at(textureData.setIndex);
-			renderer.setVoxelTexture(i, static_cast<const uint32_t*>(surface->pixels));
+			voxelTextureUpdates.push_back(Renderer::VoxelTextureUpdate { i, residentName,
+				static_cast<const uint32_t*>(surface->pixels) });
 		}
 		else if (isIMG)
 		{
-			const SDL_Surface *surface = textureManager.getSurface(textureName);
-			renderer.setVoxelTexture(i, static_cast<const uint32_t*>(surface->pixels));
+			const SDL_Surface *surface = textureManager.getSurface(textureName.getString());
+			voxelTextureUpdates.push_back(Renderer::VoxelTextureUpdate { i, residentName,
+				static_cast<const uint32_t*>(surface->pixels) });
 		}
 		else if (noExtension)
 		{
@@ -440,10 +859,13 @@ void WorldData::setLevelActive(int levelIndex, TextureManager &textureManager,
 		}
 		else
 		{
-			DebugCrash("Unrecognized voxel texture extension \"" + extension + "\".");
+			DebugCrash("Unrecognized voxel texture extension in \"" +
+				textureName.getString() + "\".");
 		}
 	}
 
+	renderer.setVoxelTextures(voxelTextureUpdates);
+
 	// Load .INF flat textures into the renderer.
 	// - To do: maybe turn this into a while loop, so the index variable can be incremented
 	//   by the size of each .DFA. It's incorrect as-is.
@@ -487,4 +909,12 @@ void WorldData::setLevelActive(int levelIndex, TextureManager &textureManager,
 			DebugCrash("Unrecognized flat texture extension \"" + extension + "\".");
 		}
 	}*/
+
+	// Frames from here on count toward the level's working set.
+	this->levelActiveFrame = renderer.getWorldFrameCount();
+
+	// The texture caches are normally reported at the end of a frame, but this is the point
+	// after a level change where everything for the new level is loaded.
+	MemoryTracker::set(MemoryTag::TextureCaches, textureManager.getMemoryStats().getTotalBytes());
+	MemoryTracker::logReport();
 }
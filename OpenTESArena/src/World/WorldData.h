@@ -2,17 +2,31 @@
 #define WORLD_DATA_H
 
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "LevelData.h"
+#include "../Entities/AnimationLibrary.h"
 #include "../Entities/EntityManager.h"
 #include "../Math/Vector2.h"
+#include "../Utilities/JobSystem.h"
 
 // This class stores data regarding elements in the game world. It should be constructible
 // from a pair of .MIF and .INF files.
 
+// Levels of interiors and dungeons are generated the first time they're needed rather than
+// all at once, since most visits only see some of them. Each one keeps what it takes to
+// generate it (its .MIF level, or its dungeon seed and transition blocks), and levels
+// near the player can be generated ahead of time on a worker with prefetchLevel().
+
+// Generated levels the player isn't on can have their voxels packed on a worker with
+// packInactiveLevels(), since deep dungeons would otherwise keep every level's full grid.
+// A packed level is unpacked when it's needed again, or ahead of time by prefetchLevel().
+
 class INFFile;
+class LoadProgress;
 class MIFFile;
 class MiscAssets;
 class Renderer;
@@ -26,28 +40,71 @@ enum class WorldType;
 class WorldData
 {	
 private:
-	std::vector<LevelData> levels;
+	// A level that might not be generated yet.
+	struct LevelSlot
+	{
+		std::unique_ptr<LevelData> level; // Null until generated.
+		std::function<LevelData()> generate; // Makes the level the same way every time.
+		std::string infName; // For prefetching textures before the level exists.
+
+		// Set by a prefetch job generating the level on a worker, if any.
+		std::shared_ptr<std::unique_ptr<LevelData>> pendingLevel;
+		JobSystem::JobHandle job;
+		JobSystem *jobSystem;
+
+		// Set by a job packing or unpacking the level's voxels on a worker, if any. Nothing
+		// else touches the voxels until it's waited for.
+		JobSystem::JobHandle packJob;
+		bool voxelsPacked; // Whether the voxels are packed, or will be once the job is done.
+
+		// Voxel textures the 3D renderer drew the last time the level was active, or empty
+		// if it hasn't been drawn.
+		std::vector<std::string> textureWorkingSet;
+
+		LevelSlot();
+		LevelSlot(LevelSlot&&) = default;
+		~LevelSlot();
+
+		LevelSlot &operator=(LevelSlot&&) = default;
+	};
+
+	std::vector<LevelSlot> levels;
 	std::vector<Double2> startPoints;
 	EntityManager entityManager;
+	AnimationLibrary animationLibrary; // Animations of the world's entities.
 	std::string mifName;
 	WorldType worldType;
 	int currentLevel;
+	int startLevel; // Level the world is entered at, for reset().
+	int levelActiveFrame; // 3D renderer frame count when the level became active, or -1.
 
-	// Generates the .INF name for a city given a climate and current weather.
-	static std::string generateCityInfName(ClimateType climateType, WeatherType weatherType);
+	// Adds a level that's already generated.
+	void addLevel(LevelData &&levelData);
 
-	// Generates the .INF name for the wilderness given a climate and current weather.
-	static std::string generateWildernessInfName(ClimateType climateType, WeatherType weatherType);
+	// Adds a level that's generated by the function when it's first needed. The function may
+	// run on a worker, so it shouldn't refer to anything that might go away.
+	void addLevel(const std::function<LevelData()> &generate, const std::string &infName);
+
+	// Waits for any job packing or unpacking the level's voxels, and unpacks them if they're
+	// packed.
+	static void unpackLevel(LevelSlot &slot);
 public:
 	WorldData();
 	WorldData(WorldData &&worldData) = default;
 
 	WorldData &operator=(WorldData &&worldData) = default;
 
-	// Loads all levels of an interior .MIF file.
+	// Generates the .INF name for a city given a climate and current weather.
+	static std::string generateCityInfName(ClimateType climateType, WeatherType weatherType);
+
+	// Generates the .INF name for the wilderness given a climate and current weather.
+	static std::string generateWildernessInfName(ClimateType climateType, WeatherType weatherType);
+
+	// Loads an interior .MIF file. Only its starting level is generated right away.
 	static WorldData loadInterior(const MIFFile &mif);
 
-	// Loads a set of levels randomly selected from RANDOM1.MIF based on the given seed.
+	// Loads a set of levels randomly selected from RANDOM1.MIF based on the given seed. Only
+	// the first level is generated right away.
 	static WorldData loadDungeon(uint32_t seed, int widthChunks, int depthChunks,
 		bool isArtifactDungeon);
 
@@ -55,10 +112,12 @@ public:
 	static WorldData loadPremadeCity(const MIFFile &mif, ClimateType climateType,
 		WeatherType weatherType);
 
-	// Loads an exterior city skeleton and its random .MIF chunks.
+	// Loads an exterior city skeleton and its random .MIF chunks, reporting each stage to
+	// the progress. The chunks are converted to voxels on the job system's workers.
 	static WorldData loadCity(int localCityID, int provinceID, const MIFFile &mif, int cityDim,
 		const std::vector<uint8_t> &reservedBlocks, const Int2 &startPosition,
-		WeatherType weatherType, const MiscAssets &miscAssets);
+		WeatherType weatherType, const MiscAssets &miscAssets, JobSystem &jobSystem,
+		LoadProgress &progress);
 
 	// Loads some wilderness blocks.
 	static WorldData loadWilderness(int rmdTR, int rmdTL, int rmdBR, int rmdBL,
@@ -69,11 +128,48 @@ public:
 	const std::string &getMifName() const;
 	EntityManager &getEntityManager();
 	const EntityManager &getEntityManager() const;
+	AnimationLibrary &getAnimationLibrary();
+	const AnimationLibrary &getAnimationLibrary() const;
 	const std::vector<Double2> &getStartPoints() const;
-	std::vector<LevelData> &getLevels();
-	const std::vector<LevelData> &getLevels() const;
 
-	// Refreshes texture manager and renderer state using the selected level's data.
+	// Gets the number of levels, generated or not.
+	int getLevelCount() const;
+
+	// Gets the current level, which is always generated.
+	LevelData &getActiveLevel();
+	const LevelData &getActiveLevel() const;
+
+	// Gets a level, generating it first if it hasn't been (or waiting for its prefetch).
+	LevelData &getLevel(int levelIndex);
+
+	// Gets a level if it's been generated, or null if it hasn't. The non-const one unpacks
+	// its voxels. The const one leaves them as they are, so it's only for the level's other
+	// data unless the level is active.
+	LevelData *findLevel(int levelIndex);
+	const LevelData *findLevel(int levelIndex) const;
+
+	// Starts generating the given level on a worker if it hasn't been, and decoding its voxel
+	// textures, so a later setLevelActive() for it doesn't have to wait on them. Only the
+	// textures in its working set are decoded once it has one. Does nothing if there's no
+	// such level.
+	void prefetchLevel(int levelIndex, TextureManager &textureManager, JobSystem &jobSystem);
+
+	// Keeps the voxel textures the 3D renderer drew since the active level became active as
+	// the level's working set, and marks them used in the texture manager so the level's
+	// other textures are evicted first. Called when the level is left, since it's only
+	// recorded once per activation. Does nothing if the level hasn't been drawn.
+	void recordTextureWorkingSet(TextureManager &textureManager, Renderer &renderer);
+
+	// Starts packing the voxels of every generated level besides the active one on workers.
+	void packInactiveLevels(JobSystem &jobSystem);
+
+	// Undoes what the player changed in the generated levels (their journals and open
+	// doors) and goes back to the starting level, so the world is the same as when it
+	// loaded. Used for keeping a world after the player leaves it.
+	void reset();
+
+	// Refreshes texture manager and renderer state using the selected level's data,
+	// generating it first if needed.
 	void setLevelActive(int levelIndex, TextureManager &textureManager,
 		Renderer &renderer);
 };
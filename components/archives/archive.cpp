@@ -81,4 +81,55 @@ ConstrainedFileStreamBuf::pos_type ConstrainedFileStreamBuf::seekpos(pos_type po
 }
 
 
+MemoryStreamBuf::MemoryStreamBuf(const uint8_t *data, size_t size)
+  : mBegin(reinterpret_cast<char*>(const_cast<uint8_t*>(data))), mEnd(mBegin + size)
+{
+    // The get area is never written through, so the const_cast is safe.
+    setg(mBegin, mBegin, mEnd);
+}
+
+MemoryStreamBuf::int_type MemoryStreamBuf::underflow()
+{
+    if(gptr() == egptr())
+        return traits_type::eof();
+
+    return traits_type::to_int_type(*gptr());
+}
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekoff(off_type offset, std::ios_base::seekdir whence, std::ios_base::openmode mode)
+{
+    if((mode&std::ios_base::out) || !(mode&std::ios_base::in))
+        return traits_type::eof();
+
+    off_type newPos;
+    switch(whence)
+    {
+        case std::ios_base::beg:
+            newPos = offset;
+            break;
+        case std::ios_base::cur:
+            newPos = offset + (gptr()-mBegin);
+            break;
+        case std::ios_base::end:
+            newPos = offset + (mEnd-mBegin);
+            break;
+        default:
+            return traits_type::eof();
+    }
+
+    return seekpos(newPos, mode);
+}
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekpos(pos_type pos, std::ios_base::openmode mode)
+{
+    if((mode&std::ios_base::out) || !(mode&std::ios_base::in))
+        return traits_type::eof();
+
+    if(pos < 0 || pos > (mEnd-mBegin))
+        return traits_type::eof();
+
+    setg(mBegin, mBegin + static_cast<off_type>(pos), mEnd);
+    return pos;
+}
+
 } // namespace Archives
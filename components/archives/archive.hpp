@@ -1,6 +1,9 @@
 #ifndef COMPONENTS_ARCHIVES_ARCHIVE_HPP
 #define COMPONENTS_ARCHIVES_ARCHIVE_HPP
 
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -30,6 +33,40 @@ inline uint16_t read_le16(std::istream &stream)
     return ((uint16_t(buf[0]   )&0x00ff) | (uint16_t(buf[1]<<8)&0xff00));
 }
 
+// Gets a character the way names are compared: uppercase, with '/' as the separator.
+// Arena's files don't have consistent casing between versions, so lookups ignore it.
+inline char foldChar(char c)
+{
+    if(c == '\\')
+        return '/';
+    return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+}
+
+// Hashes a name's folded characters (FNV-1a) without making a folded copy of it.
+inline uint64_t foldedHash(const char *name, size_t length)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for(size_t i = 0;i < length;++i)
+    {
+        hash ^= static_cast<unsigned char>(foldChar(name[i]));
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Returns whether two names are the same once folded.
+inline bool foldedEquals(const char *a, size_t aLength, const char *b, size_t bLength)
+{
+    if(aLength != bLength)
+        return false;
+    for(size_t i = 0;i < aLength;++i)
+    {
+        if(foldChar(a[i]) != foldChar(b[i]))
+            return false;
+    }
+    return true;
+}
+
 
 class ConstrainedFileStreamBuf : public std::streambuf {
     std::streamsize mStart, mEnd;
@@ -61,11 +98,68 @@ public:
     }
 };
 
+// Stream over bytes already in memory, such as part of a mapped archive. The bytes must
+// outlive the stream.
+class MemoryStreamBuf : public std::streambuf {
+    char *mBegin, *mEnd;
+
+public:
+    MemoryStreamBuf(const uint8_t *data, size_t size);
+
+    virtual int_type underflow();
+
+    virtual pos_type seekoff(off_type offset, std::ios_base::seekdir whence, std::ios_base::openmode mode);
+    virtual pos_type seekpos(pos_type pos, std::ios_base::openmode mode);
+};
+
+class MemoryStream : public std::istream {
+    MemoryStreamBuf mBuffer;
+
+public:
+    MemoryStream(const uint8_t *data, size_t size)
+        : std::istream(nullptr), mBuffer(data, size)
+    {
+        rdbuf(&mBuffer);
+    }
+};
+
+
+// Read-only view of a file's bytes, like a span. Whatever owns the bytes is kept alive by
+// the view if it isn't the archive itself.
+class DataView {
+    std::shared_ptr<const void> mOwner;
+    const uint8_t *mData;
+    size_t mSize;
+    bool mOpen;
+
+public:
+    DataView() : mData(nullptr), mSize(0), mOpen(false) { }
+    DataView(const uint8_t *data, size_t size, std::shared_ptr<const void> owner=nullptr)
+        : mOwner(std::move(owner)), mData(data), mSize(size), mOpen(true)
+    { }
+
+    // False if the file wasn't found.
+    bool isOpen() const { return mOpen; }
+
+    const uint8_t *data() const { return mData; }
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    // What keeps the bytes alive, if not the archive. Views with the same owner point into
+    // the same mapping.
+    const void *owner() const { return mOwner.get(); }
+
+    const uint8_t *begin() const { return mData; }
+    const uint8_t *end() const { return mData + mSize; }
+    const uint8_t &operator[](size_t i) const { return mData[i]; }
+};
+
 
 class Archive {
 public:
     virtual ~Archive() { }
     virtual IStreamPtr open(const char *name) = 0;
+    virtual DataView openView(const char *name) = 0;
     virtual bool exists(const char *name) const = 0;
     virtual const std::vector<std::string> &list() const = 0;
 };
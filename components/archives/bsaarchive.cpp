@@ -2,6 +2,7 @@
 #include "bsaarchive.hpp"
 
 #include <algorithm>
+#include <cstring>
 #include <sstream>
 #include <fstream>
 
@@ -43,12 +44,19 @@ void BsaArchive::loadNamed(size_t count, std::istream& stream)
         if(iter == mLookupName.end() || *iter != name)
             mLookupName.insert(iter, name);
     }
-    mEntries.resize(mLookupName.size());
-    for(size_t i = 0;i < count;++i)
+    // Names that only differ by case share the first one's index.
+    mIndex.reserve(mLookupName.size());
+    for(size_t i = 0;i < mLookupName.size();++i)
     {
-        auto iter = std::find(mLookupName.cbegin(), mLookupName.cend(), names[i]);
-        mEntries[std::distance(mLookupName.cbegin(), iter)] = entries[i];
+        const std::string &name = mLookupName[i];
+        if(findIndex(name.c_str()) == static_cast<size_t>(-1))
+            mIndex.emplace(foldedHash(name.c_str(), name.size()), i);
     }
+
+    // Later entries with the same name take precedence.
+    mEntries.resize(mLookupName.size());
+    for(size_t i = 0;i < count;++i)
+        mEntries[findIndex(names[i].c_str())] = entries[i];
 }
 
 void BsaArchive::load(const std::string &fname)
@@ -63,27 +71,93 @@ void BsaArchive::load(const std::string &fname)
 
     mEntries.reserve(count);
     loadNamed(count, stream);
+
+    // Entries are only usable from the mapping if they all fit in it.
+    if(mMapping.open(mFilename))
+    {
+        for(const Entry &entry : mEntries)
+        {
+            if(entry.mStart < 0 || entry.mEnd < entry.mStart ||
+               static_cast<size_t>(entry.mEnd) > mMapping.size())
+            {
+                mMapping.close();
+                break;
+            }
+        }
+    }
 }
 
 IStreamPtr BsaArchive::open(const Entry &entry)
 {
+    if(mMapping.isOpen())
+    {
+        return IStreamPtr(new MemoryStream(mMapping.data() + entry.mStart,
+            static_cast<size_t>(entry.mEnd - entry.mStart)));
+    }
+
     std::unique_ptr<std::istream> stream(new std::ifstream(mFilename.c_str(), std::ios::binary));
     if(!stream->seekg(entry.mStart))
         return IStreamPtr(nullptr);
     return IStreamPtr(new ConstrainedFileStream(std::move(stream), entry.mStart, entry.mEnd));
 }
 
+DataView BsaArchive::openView(const Entry &entry)
+{
+    const size_t size = static_cast<size_t>(entry.mEnd - entry.mStart);
+    if(mMapping.isOpen())
+        return DataView(mMapping.data() + entry.mStart, size);
+
+    // Without a mapping, the view has to own a copy.
+    std::ifstream stream(mFilename.c_str(), std::ios::binary);
+    if(!stream.seekg(entry.mStart))
+        return DataView();
+
+    auto bytes = std::make_shared<std::vector<uint8_t>>(size);
+    if(!stream.read(reinterpret_cast<char*>(bytes->data()), size))
+        return DataView();
+    return DataView(bytes->data(), bytes->size(), bytes);
+}
+
+size_t BsaArchive::findIndex(const char *name) const
+{
+    const size_t length = std::strlen(name);
+    auto range = mIndex.equal_range(foldedHash(name, length));
+    for(auto iter = range.first;iter != range.second;++iter)
+    {
+        const std::string &entryName = mLookupName[iter->second];
+        if(foldedEquals(name, length, entryName.c_str(), entryName.size()))
+            return iter->second;
+    }
+    return static_cast<size_t>(-1);
+}
+
+const BsaArchive::Entry *BsaArchive::find(const char *name) const
+{
+    const size_t index = findIndex(name);
+    if(index == static_cast<size_t>(-1))
+        return nullptr;
+    return &mEntries[index];
+}
+
 IStreamPtr BsaArchive::open(const char *name)
 {
-    auto iter = std::lower_bound(mLookupName.begin(), mLookupName.end(), name);
-    if(iter == mLookupName.end() || *iter != name)
+    const Entry *entry = find(name);
+    if(entry == nullptr)
         return IStreamPtr(nullptr);
-    return open(mEntries[std::distance(mLookupName.begin(), iter)]);
+    return open(*entry);
+}
+
+DataView BsaArchive::openView(const char *name)
+{
+    const Entry *entry = find(name);
+    if(entry == nullptr)
+        return DataView();
+    return openView(*entry);
 }
 
 bool BsaArchive::exists(const char *name) const
 {
-    return std::binary_search(mLookupName.begin(), mLookupName.end(), name);
+    return find(name) != nullptr;
 }
 
 } // namespace Archives
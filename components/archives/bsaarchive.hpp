@@ -5,8 +5,10 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <unordered_map>
 
 #include "archive.hpp"
+#include "mappedfile.hpp"
 
 
 namespace Archives
@@ -21,17 +23,35 @@ class BsaArchive : public Archive {
     };
     std::vector<Entry> mEntries;
 
+    // Index into mEntries by folded name hash. Names that happen to share a hash are
+    // told apart by comparing them.
+    std::unordered_multimap<uint64_t, size_t> mIndex;
+
     std::string mFilename;
 
+    // The whole archive, mapped once at load. If mapping fails, entries are read from
+    // the file instead.
+    MappedFile mMapping;
+
     void loadNamed(size_t count, std::istream &stream);
 
     IStreamPtr open(const Entry &entry);
+    DataView openView(const Entry &entry);
+
+    // Returns the index of the entry with the name ignoring case, or -1 if there isn't one.
+    size_t findIndex(const char *name) const;
+
+    // Returns null if there's no entry with the name, ignoring case.
+    const Entry *find(const char *name) const;
 
 public:
     void load(const std::string &fname);
 
     virtual IStreamPtr open(const char *name);
 
+    // Entries point straight into the mapping, which lives as long as the archive.
+    virtual DataView openView(const char *name);
+
     virtual bool exists(const char *name) const;
 
     virtual const std::vector<std::string> &list() const final
@@ -0,0 +1,137 @@
+#include "mappedfile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace Archives
+{
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+  : mData(nullptr), mSize(0), mOpen(false), mFile(INVALID_HANDLE_VALUE), mMapping(nullptr)
+{
+}
+
+bool MappedFile::open(const std::string &fname)
+{
+    close();
+
+    mFile = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(mFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(mFile, &size))
+    {
+        close();
+        return false;
+    }
+
+    mSize = static_cast<size_t>(size.QuadPart);
+    if(mSize > 0)
+    {
+        mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(mMapping == nullptr)
+        {
+            close();
+            return false;
+        }
+
+        mData = static_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+        if(mData == nullptr)
+        {
+            close();
+            return false;
+        }
+    }
+
+    mOpen = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(mData != nullptr)
+        UnmapViewOfFile(mData);
+    if(mMapping != nullptr)
+        CloseHandle(mMapping);
+    if(mFile != INVALID_HANDLE_VALUE)
+        CloseHandle(mFile);
+
+    mData = nullptr;
+    mSize = 0;
+    mOpen = false;
+    mFile = INVALID_HANDLE_VALUE;
+    mMapping = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile()
+  : mData(nullptr), mSize(0), mOpen(false)
+{
+}
+
+bool MappedFile::open(const std::string &fname)
+{
+    close();
+
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    mSize = static_cast<size_t>(st.st_size);
+    if(mSize > 0)
+    {
+        void *data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED)
+        {
+            ::close(fd);
+            mSize = 0;
+            return false;
+        }
+        mData = static_cast<const uint8_t*>(data);
+    }
+
+    // The mapping doesn't need the descriptor once it's made.
+    ::close(fd);
+
+    mOpen = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(mData != nullptr)
+        munmap(const_cast<uint8_t*>(mData), mSize);
+
+    mData = nullptr;
+    mSize = 0;
+    mOpen = false;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+} // namespace Archives
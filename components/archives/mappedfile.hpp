@@ -0,0 +1,43 @@
+#ifndef COMPONENTS_ARCHIVES_MAPPEDFILE_HPP
+#define COMPONENTS_ARCHIVES_MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace Archives
+{
+
+// Read-only memory mapping of a whole file. The mapping stays valid until close() or the
+// destructor.
+class MappedFile {
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t *mData;
+    size_t mSize;
+    bool mOpen;
+
+#ifdef _WIN32
+    void *mFile;
+    void *mMapping;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Returns false if the file can't be opened or mapped. An empty file opens with a null
+    // data pointer.
+    bool open(const std::string &fname);
+    void close();
+
+    bool isOpen() const { return mOpen; }
+    const uint8_t *data() const { return mData; }
+    size_t size() const { return mSize; }
+};
+
+} // namespace Archives
+
+#endif /* COMPONENTS_ARCHIVES_MAPPEDFILE_HPP */
@@ -6,18 +6,27 @@
 #include "../misc/fnmatch.h"
 #else
 #include <dirent.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <fnmatch.h>
 #endif
 
 #include <algorithm>
 #include <cctype>
+#include <condition_variable>
+#include <cstdint>
 #include <cstring>
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "../archives/bsaarchive.hpp"
+#include "../archives/mappedfile.hpp"
 
 
 namespace
@@ -26,16 +35,203 @@ namespace
 std::vector<std::string> gRootPaths;
 Archives::BsaArchive gGlobalBsa;
 
+struct LooseFile
+{
+    std::string name; // Relative to its root path.
+    std::string path;
+};
+
+// Each loose file in the root paths, by folded relative name hash. Files in newer paths
+// replace ones with the same name in older paths.
+std::unordered_multimap<uint64_t, LooseFile> gLooseFiles;
+
+LooseFile *findLooseFileEntry(const char *name, size_t length, uint64_t hash)
+{
+    auto range = gLooseFiles.equal_range(hash);
+    for(auto iter = range.first;iter != range.second;++iter)
+    {
+        const std::string &fileName = iter->second.name;
+        if(Archives::foldedEquals(name, length, fileName.c_str(), fileName.size()))
+            return &iter->second;
+    }
+    return nullptr;
+}
+
+// Returns null if there's no loose file with the name, ignoring case.
+const std::string *findLooseFile(const char *name)
+{
+    const size_t length = std::strlen(name);
+    const LooseFile *file = findLooseFileEntry(name, length,
+        Archives::foldedHash(name, length));
+    return (file != nullptr) ? &file->path : nullptr;
+}
+
+// Touched once per page to make the disk read it.
+const size_t gPageSize = 4096;
+
+// Entries of the same mapping at most this far apart are read through as one range, since
+// reading the gap costs less than seeking over it.
+const size_t gReadMergeGap = 64 * 1024;
+
+const size_t gReadPriorityCount = 3;
+
+std::mutex gReadMutex;
+std::condition_variable gReadQueued; // Notified when a request is queued, or on shutdown.
+std::condition_variable gReadFinished; // Notified when requests are done or canceled.
+std::deque<VFS::ReadRequestPtr> gReadQueues[gReadPriorityCount]; // By priority.
+std::thread gReadThread; // Started by the first request.
+bool gReadStopping = false;
+
+// Written so touching pages isn't optimized out.
+volatile uint8_t gReadSink = 0;
+
+size_t getPriorityIndex(VFS::ReadPriority priority)
+{
+    return static_cast<size_t>(priority);
+}
+
+// Removes a queued request from its priority's queue. Must hold the read mutex.
+void unqueueRequest(const VFS::ReadRequest *request, VFS::ReadPriority priority)
+{
+    std::deque<VFS::ReadRequestPtr> &queue = gReadQueues[getPriorityIndex(priority)];
+    auto iter = std::find_if(queue.begin(), queue.end(),
+        [request](const VFS::ReadRequestPtr &queued) { return queued.get() == request; });
+    if(iter != queue.end())
+        queue.erase(iter);
+}
+
+// Index of the most urgent priority with queued requests, or the priority count if none.
+// Must hold the read mutex.
+size_t getQueuedPriorityIndex()
+{
+    size_t index = 0;
+    while(index < gReadPriorityCount && gReadQueues[index].empty())
+        ++index;
+    return index;
+}
+
+// Calls the done callbacks of finished requests. Must not hold the read mutex, since they
+// might make more requests.
+void callDone(std::vector<std::function<void()>> &callbacks)
+{
+    for(const std::function<void()> &callback : callbacks)
+        callback();
+    callbacks.clear();
+}
+
+// Brings a range of mapped bytes into memory.
+void pageIn(const uint8_t *begin, const uint8_t *end)
+{
+#ifndef _WIN32
+    // Ask for the whole range up front, so it's read in large sequential pieces instead of
+    // a page at a time as it's touched.
+    const uintptr_t start = reinterpret_cast<uintptr_t>(begin) & ~uintptr_t(gPageSize - 1);
+    const size_t length = reinterpret_cast<uintptr_t>(end) - start;
+    madvise(reinterpret_cast<void*>(start), length, MADV_WILLNEED);
+#endif
+
+    uint8_t sum = 0;
+    for(const uint8_t *page = begin;page < end;page += std::min<size_t>(gPageSize, end - page))
+        sum += *page;
+    if(end > begin)
+        sum += end[-1];
+    gReadSink = sum;
+}
+
 }
 
 
 namespace VFS
 {
 
+ReadRequest::ReadRequest(std::vector<std::string>&& names, ReadPriority priority)
+  : mNames(std::move(names)), mPriority(priority), mState(State::Queued)
+{
+}
+
+void ReadRequest::finish(State state, std::vector<std::function<void()>> &callbacks)
+{
+    mState = state;
+    for(std::function<void()> &callback : mOnDone)
+        callbacks.push_back(std::move(callback));
+    mOnDone.clear();
+}
+
+bool ReadRequest::isDone() const
+{
+    std::lock_guard<std::mutex> lock(gReadMutex);
+    return mState == State::Done || mState == State::Canceled;
+}
+
+void ReadRequest::wait() const
+{
+    std::unique_lock<std::mutex> lock(gReadMutex);
+    gReadFinished.wait(lock, [this]()
+    {
+        return mState == State::Done || mState == State::Canceled;
+    });
+}
+
+void ReadRequest::onDone(std::function<void()> callback)
+{
+    {
+        std::lock_guard<std::mutex> lock(gReadMutex);
+        if(mState != State::Done && mState != State::Canceled)
+        {
+            mOnDone.push_back(std::move(callback));
+            return;
+        }
+    }
+
+    callback();
+}
+
+void ReadRequest::cancel()
+{
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(gReadMutex);
+        if(mState == State::Done || mState == State::Canceled)
+            return;
+
+        // A request being read is skipped by the I/O thread from its next range on.
+        if(mState == State::Queued)
+            unqueueRequest(this, mPriority);
+        finish(State::Canceled, callbacks);
+    }
+
+    gReadFinished.notify_all();
+    callDone(callbacks);
+}
+
+
 Manager::Manager()
 {
 }
 
+Manager::~Manager()
+{
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(gReadMutex);
+        gReadStopping = true;
+
+        // Nothing should be waiting this late, but don't leave anything hanging if it is.
+        for(std::deque<ReadRequestPtr> &queue : gReadQueues)
+        {
+            for(const ReadRequestPtr &request : queue)
+                request->finish(ReadRequest::State::Canceled, callbacks);
+            queue.clear();
+        }
+    }
+
+    gReadQueued.notify_all();
+    gReadFinished.notify_all();
+    callDone(callbacks);
+    if(gReadThread.joinable())
+        gReadThread.join();
+}
+
 void Manager::initialize(std::string&& root_path)
 {
     if(root_path.empty())
@@ -45,6 +241,7 @@ void Manager::initialize(std::string&& root_path)
 
     gGlobalBsa.load(root_path+"GLOBAL.BSA");
 
+    addLooseFiles(root_path);
     gRootPaths.push_back(std::move(root_path));
 }
 
@@ -54,69 +251,243 @@ void Manager::addDataPath(std::string&& path)
         path += "./";
     else if(path.back() != '/' && path.back() != '\\')
         path += "/";
+
+    addLooseFiles(path);
     gRootPaths.push_back(std::move(path));
 }
 
+void Manager::addLooseFiles(const std::string &path)
+{
+    std::vector<std::string> names;
+    add_dir(path+".", "", nullptr, names);
+
+    for(const std::string &name : names)
+    {
+        const uint64_t hash = Archives::foldedHash(name.c_str(), name.size());
+        LooseFile *file = findLooseFileEntry(name.c_str(), name.size(), hash);
+        if(file != nullptr)
+            file->path = path+name;
+        else
+            gLooseFiles.emplace(hash, LooseFile { name, path+name });
+    }
+}
+
 
 IStreamPtr Manager::open(const char *name)
 {
-    std::unique_ptr<std::ifstream> stream(new std::ifstream());
-    // Search in reverse, so newer paths take precedence.
-    auto piter = gRootPaths.rbegin();
-    while(piter != gRootPaths.rend())
+    const std::string *path = findLooseFile(name);
+    if(path != nullptr)
     {
-        stream->open((*piter+name).c_str(), std::ios_base::binary);
+        std::unique_ptr<std::ifstream> stream(new std::ifstream(path->c_str(), std::ios_base::binary));
         if(stream->good()) return IStreamPtr(std::move(stream));
-        ++piter;
     }
 
     return gGlobalBsa.open(name);
 }
 
-IStreamPtr Manager::openCaseInsensitive(const std::string &name)
+DataView Manager::openView(const char *name)
 {
-	// Since the given filename is assumed to be unique in its directory, we only need to
-	// worry about filenames just like it but with different casing.
-	std::string newName = name;
+    const std::string *path = findLooseFile(name);
+    if(path != nullptr)
+    {
+        auto file = std::make_shared<Archives::MappedFile>();
+        if(file->open(*path))
+        {
+            const uint8_t *data = file->data();
+            const size_t size = file->size();
+            return DataView(data, size, std::move(file));
+        }
+    }
 
-	// Case 1: All uppercase.
-	for (char &c : newName)
-	{
-		c = std::toupper(c);
-	}
+    return gGlobalBsa.openView(name);
+}
 
-	IStreamPtr stream = this->open(newName);
+ReadRequestPtr Manager::readAsync(std::vector<std::string> names, ReadPriority priority)
+{
+    auto request = std::make_shared<ReadRequest>(std::move(names), priority);
+    if(request->mNames.empty())
+    {
+        request->mState = ReadRequest::State::Done;
+        return request;
+    }
 
-	if (stream != nullptr)
-	{
-		return stream;
-	}
-	else
-	{
-		// Case 2: Normal case (upper first character, lower rest).
-		newName.front() = std::toupper(newName.front());
-		for (auto iter = newName.begin() + 1; iter != newName.end(); ++iter)
-		{
-			*iter = std::tolower(*iter);
-		}
+    {
+        std::lock_guard<std::mutex> lock(gReadMutex);
+        if(!gReadThread.joinable())
+            gReadThread = std::thread(&Manager::ioLoop, this);
+        gReadQueues[getPriorityIndex(priority)].push_back(request);
+    }
+
+    gReadQueued.notify_one();
+    return request;
+}
 
-		stream = this->open(newName);
+void Manager::raisePriority(const ReadRequestPtr &request, ReadPriority priority)
+{
+    std::lock_guard<std::mutex> lock(gReadMutex);
+    if(getPriorityIndex(priority) >= getPriorityIndex(request->mPriority))
+        return;
 
-		// The caller does error checking to see if this is null.
-		return stream;
-	}
+    // One being read goes back in at its new priority if the I/O thread is preempted.
+    if(request->mState == ReadRequest::State::Queued)
+    {
+        unqueueRequest(request.get(), request->mPriority);
+        gReadQueues[getPriorityIndex(priority)].push_back(request);
+        gReadQueued.notify_one();
+    }
+    request->mPriority = priority;
 }
 
-bool Manager::exists(const char *name)
+void Manager::ioLoop()
 {
-    std::ifstream file;
-    for(const std::string &path : gRootPaths)
+    // A file's bytes, and which request they're for.
+    struct Span {
+        const uint8_t *begin;
+        const uint8_t *end;
+        const void *owner;
+        size_t request;
+    };
+
+    std::vector<std::function<void()>> callbacks;
+    std::unique_lock<std::mutex> lock(gReadMutex);
+    while(true)
     {
-        file.open((path+name).c_str(), std::ios_base::binary);
-        if(file.is_open()) return true;
+        gReadQueued.wait(lock, []()
+        {
+            return gReadStopping || getQueuedPriorityIndex() < gReadPriorityCount;
+        });
+        if(gReadStopping)
+            break;
+
+        // Everything queued at the most urgent priority is read in one pass, so entries
+        // requested separately can still be read together.
+        const size_t priorityIndex = getQueuedPriorityIndex();
+        std::deque<ReadRequestPtr> &queue = gReadQueues[priorityIndex];
+        std::vector<ReadRequestPtr> requests(queue.begin(), queue.end());
+        queue.clear();
+        for(const ReadRequestPtr &request : requests)
+            request->mState = ReadRequest::State::Reading;
+        lock.unlock();
+
+        // Names don't change after the request is made, so they're read without the lock.
+        // The views keep loose file mappings open until the pass is over.
+        std::vector<DataView> views;
+        std::vector<Span> spans;
+        std::vector<size_t> remaining(requests.size(), 0);
+        for(size_t i = 0;i < requests.size();++i)
+        {
+            for(const std::string &name : requests[i]->mNames)
+            {
+                DataView view = openView(name);
+                if(!view.isOpen() || view.empty())
+                    continue;
+
+                spans.push_back(Span { view.begin(), view.end(), view.owner(), i });
+                views.push_back(std::move(view));
+                ++remaining[i];
+            }
+        }
+
+        // In order of where they are in each mapping, which is their order on disk.
+        std::sort(spans.begin(), spans.end(), [](const Span &a, const Span &b)
+        {
+            if(a.owner != b.owner)
+                return std::less<const void*>()(a.owner, b.owner);
+            return std::less<const uint8_t*>()(a.begin, b.begin);
+        });
+
+        lock.lock();
+        bool finished = false;
+        for(size_t i = 0;i < requests.size();++i)
+        {
+            if(remaining[i] == 0 && requests[i]->mState == ReadRequest::State::Reading)
+            {
+                requests[i]->finish(ReadRequest::State::Done, callbacks);
+                finished = true;
+            }
+        }
+
+        size_t spanIndex = 0;
+        bool preempted = false;
+        while(spanIndex < spans.size() && !preempted && !gReadStopping)
+        {
+            // Merge the following spans of the same mapping that are close enough.
+            const Span &first = spans[spanIndex];
+            const uint8_t *end = first.end;
+            bool wanted = false;
+            size_t nextIndex = spanIndex;
+            while(nextIndex < spans.size())
+            {
+                const Span &span = spans[nextIndex];
+                if(nextIndex > spanIndex && (span.owner != first.owner ||
+                    (span.begin > end && size_t(span.begin - end) > gReadMergeGap)))
+                    break;
+
+                end = std::max(end, span.end);
+                wanted |= requests[span.request]->mState == ReadRequest::State::Reading;
+                ++nextIndex;
+            }
+
+            // Ranges only canceled requests wanted aren't read.
+            if(wanted)
+            {
+                lock.unlock();
+                pageIn(first.begin, end);
+                lock.lock();
+            }
+
+            for(size_t i = spanIndex;i < nextIndex;++i)
+            {
+                const size_t requestIndex = spans[i].request;
+                ReadRequest &request = *requests[requestIndex];
+                --remaining[requestIndex];
+                if(remaining[requestIndex] == 0 && request.mState == ReadRequest::State::Reading)
+                {
+                    request.finish(ReadRequest::State::Done, callbacks);
+                    finished = true;
+                }
+            }
+
+            spanIndex = nextIndex;
+            preempted = getQueuedPriorityIndex() < priorityIndex;
+        }
+
+        // Unfinished requests wait behind the more urgent ones, ahead of anything that was
+        // queued after them. On shutdown they're canceled instead.
+        for(auto iter = requests.rbegin();iter != requests.rend();++iter)
+        {
+            const ReadRequestPtr &request = *iter;
+            if(request->mState != ReadRequest::State::Reading)
+                continue;
+
+            if(gReadStopping)
+            {
+                request->finish(ReadRequest::State::Canceled, callbacks);
+                finished = true;
+            }
+            else
+            {
+                request->mState = ReadRequest::State::Queued;
+                gReadQueues[getPriorityIndex(request->mPriority)].push_front(request);
+            }
+        }
+
+        if(finished)
+            gReadFinished.notify_all();
+
+        // Called between passes, so a request made by one goes in the next pass.
+        if(!callbacks.empty())
+        {
+            lock.unlock();
+            callDone(callbacks);
+            lock.lock();
+        }
     }
+}
 
-    return gGlobalBsa.exists(name);
+bool Manager::exists(const char *name)
+{
+    return findLooseFile(name) != nullptr || gGlobalBsa.exists(name);
 }
 
 
@@ -131,7 +502,7 @@ void Manager::add_dir(const std::string &path, const std::string &pre, const cha
         if(strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
             continue;
 
-        if(!S_ISDIR(ent->d_type))
+        if(ent->d_type != DT_DIR)
         {
             std::string fname = pre + ent->d_name;
             if(!pattern || fnmatch(pattern, fname.c_str(), 0) == 0)
@@ -2,16 +2,20 @@
 #define COMPONENTS_VFS_MANAGER_HPP
 
 #include <string>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "../archives/archive.hpp"
+
 
 namespace VFS
 {
 
 typedef std::shared_ptr<std::istream> IStreamPtr;
+typedef Archives::DataView DataView;
 
 inline uint32_t read_le32(std::istream &stream)
 {
@@ -31,30 +35,92 @@ inline uint16_t read_le16(std::istream &stream)
 }
 
 
+// How soon a background read is needed. Reads are served in this order.
+enum class ReadPriority {
+    Audio,    // Sounds about to play.
+    Visible,  // Something being drawn now, or about to be.
+    Prefetch, // Might be needed later.
+};
+
+// Files being read in the background by the manager's I/O thread. Their bytes are paged in,
+// so opening them afterward doesn't wait on the disk.
+class ReadRequest {
+    friend class Manager;
+
+    enum class State { Queued, Reading, Done, Canceled };
+
+    std::vector<std::string> mNames;
+    ReadPriority mPriority;
+    State mState;
+    std::vector<std::function<void()>> mOnDone;
+
+    // Sets the request's final state and moves its done callbacks into the list, to be
+    // called once the read mutex is released. Must hold the read mutex.
+    void finish(State state, std::vector<std::function<void()>> &callbacks);
+
+public:
+    ReadRequest(std::vector<std::string>&& names, ReadPriority priority);
+
+    // True once the files are read, or the request was canceled.
+    bool isDone() const;
+
+    // Blocks until the request is done or canceled.
+    void wait() const;
+
+    // Calls the function once the request is done or canceled, on whichever thread
+    // finishes it (usually the I/O thread), or right away if it already is. It should only
+    // hand the work off, like queueing a job, so it doesn't hold up other reads.
+    void onDone(std::function<void()> callback);
+
+    // Drops the request if it hasn't been read yet, and wakes anything waiting on it. The
+    // files can still be opened, only they're read on demand.
+    void cancel();
+};
+
+typedef std::shared_ptr<ReadRequest> ReadRequestPtr;
+
+
 class Manager {
     Manager(const Manager&) = delete;
     Manager& operator=(const Manager&) = delete;
 
     static void add_dir(const std::string &path, const std::string &pre, const char *pattern, std::vector<std::string> &names);
 
+    // Adds every file under the path to the loose file index.
+    static void addLooseFiles(const std::string &path);
+
     Manager();
+    ~Manager();
+
+    // Reads queued requests of the most urgent priority until it's told to stop.
+    void ioLoop();
 
 public:
     void initialize(std::string&& root_path=std::string());
     void addDataPath(std::string&& path);
 
+    // Names are looked up in hash indices of the archive and of the loose files in the data
+    // paths, made when each is added, so they ignore case (Arena's floppy and CD versions
+    // don't have consistent casing for some files, like SPELLSG.65). Loose files added to a
+    // data path after that aren't found.
     IStreamPtr open(const char *name);
     IStreamPtr open(const std::string &name) { return open(name.c_str()); }
     IStreamPtr open(std::string &&name) { return open(name.c_str()); }
 
-	// Special open method intended for Unix systems since the Arena floppy and CD versions don't
-	// have consistent casing for some files (like SPELLSG.65). This method is specific to Arena's
-	// files and is not a general solution for case-insensitive file loading.
-	// - For some reason, certain files are still found on Unix (like Arrows.cif) even when the
-	//   program requests different casing (like ARROWS.CIF), so this may be an issue of Unix
-	//   checking the filename without its extension when (supposedly) resolving ambiguities.
-	// - To do: replace with something using std::filesystem::equivalent() (C++17)?
-	IStreamPtr openCaseInsensitive(const std::string &name);
+    // Gets a file's bytes without copying them, found the same way as open(). Loose files
+    // are mapped, and archive entries point into the archive's mapping. isOpen() on the
+    // view is false if the file doesn't exist.
+    DataView openView(const char *name);
+    DataView openView(const std::string &name) { return openView(name.c_str()); }
+
+    // Queues the files to be read on the I/O thread, after any request with the same or a
+    // more urgent priority. Queued requests are read together in order of where they are on
+    // disk, so neighboring archive entries are read as one.
+    ReadRequestPtr readAsync(std::vector<std::string> names, ReadPriority priority);
+
+    // Moves a queued request up to the given priority, if that's more urgent (i.e., when
+    // something has to wait on it now).
+    void raisePriority(const ReadRequestPtr &request, ReadPriority priority);
 
     bool exists(const char *name);
     std::vector<std::string> list(const char *pattern=nullptr) const;